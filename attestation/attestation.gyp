@@ -28,6 +28,11 @@
       # "attestation/...".
       '<(platform2_root)/../aosp/system/tpm',
     ],
+    'conditions': [
+      ['USE_tpm2 == 1', {
+        'defines': [ 'USE_TPM2' ],
+      }],
+    ],
   },
   'targets': [
     # A library for just the protobufs.
@@ -60,7 +65,7 @@
       'type': 'static_library',
       'sources': [
         'common/crypto_utility_impl.cc',
-        'common/tpm_utility_v1.cc',
+        'common/merkle_tree.cc',
       ],
       'all_dependent_settings': {
         'variables': {
@@ -68,10 +73,29 @@
             'openssl',
           ],
         },
-        'libraries': [
-          '-ltspi',
-        ],
       },
+      'conditions': [
+        ['USE_tpm2 == 1', {
+          'sources': [
+            'common/tpm_utility_v2.cc',
+          ],
+          'all_dependent_settings': {
+            'libraries': [
+              '-ltrunks',
+            ],
+          },
+        }],
+        ['USE_tpm2 == 0', {
+          'sources': [
+            'common/tpm_utility_v1.cc',
+          ],
+          'all_dependent_settings': {
+            'libraries': [
+              '-ltspi',
+            ],
+          },
+        }],
+      ],
       'dependencies': [
         'proto_library',
       ],
@@ -126,6 +150,7 @@
         'server/attestation_service.cc',
         'server/dbus_service.cc',
         'server/database_impl.cc',
+        'server/file_key_store.cc',
         'server/pkcs11_key_store.cc',
       ],
       'all_dependent_settings': {
@@ -155,6 +180,19 @@
         'server_library',
       ],
     },
+    # A load generator which runs the service against a mock Attestation CA.
+    {
+      'target_name': 'attestation_bench',
+      'type': 'executable',
+      'sources': [
+        'server/attestation_bench.cc',
+      ],
+      'dependencies': [
+        'common_library',
+        'proto_library',
+        'server_library',
+      ],
+    },
   ],
   'conditions': [
     ['USE_test == 1', {
@@ -173,15 +211,27 @@
             'attestation_testrunner.cc',
             'client/dbus_proxy_test.cc',
             'common/crypto_utility_impl_test.cc',
+            'common/merkle_tree_test.cc',
             'common/mock_crypto_utility.cc',
             'common/mock_tpm_utility.cc',
             'server/attestation_service_test.cc',
             'server/database_impl_test.cc',
             'server/dbus_service_test.cc',
+            'server/file_key_store_test.cc',
             'server/mock_database.cc',
             'server/mock_key_store.cc',
             'server/pkcs11_key_store_test.cc',
           ],
+          'conditions': [
+            ['USE_tpm2 == 1', {
+              'sources': [
+                'common/tpm_utility_v2_test.cc',
+              ],
+              'libraries': [
+                '-ltrunks_test',
+              ],
+            }],
+          ],
           'dependencies': [
             'common_library',
             'client_library',
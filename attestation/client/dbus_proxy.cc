@@ -152,6 +152,59 @@ void DBusProxy::Sign(const SignRequest& request, const SignCallback& callback) {
       attestation::kSign, callback, base::Bind(on_error), request);
 }
 
+void DBusProxy::DecryptBatch(const DecryptBatchRequest& request,
+                             const DecryptBatchCallback& callback) {
+  auto on_error = [callback](brillo::Error* error) {
+    DecryptBatchReply reply;
+    reply.set_status(STATUS_NOT_AVAILABLE);
+    callback.Run(reply);
+  };
+  brillo::dbus_utils::CallMethodWithTimeout(
+      kDBusTimeoutMS, object_proxy_, attestation::kAttestationInterface,
+      attestation::kDecryptBatch, callback, base::Bind(on_error), request);
+}
+
+void DBusProxy::SignBatch(const SignBatchRequest& request,
+                          const SignBatchCallback& callback) {
+  auto on_error = [callback](brillo::Error* error) {
+    SignBatchReply reply;
+    reply.set_status(STATUS_NOT_AVAILABLE);
+    callback.Run(reply);
+  };
+  brillo::dbus_utils::CallMethodWithTimeout(
+      kDBusTimeoutMS, object_proxy_, attestation::kAttestationInterface,
+      attestation::kSignBatch, callback, base::Bind(on_error), request);
+}
+
+void DBusProxy::SignAggregated(const SignAggregatedRequest& request,
+                               const SignAggregatedCallback& callback) {
+  auto on_error = [callback](brillo::Error* error) {
+    SignAggregatedReply reply;
+    reply.set_status(STATUS_NOT_AVAILABLE);
+    callback.Run(reply);
+  };
+  brillo::dbus_utils::CallMethodWithTimeout(
+      kDBusTimeoutMS, object_proxy_, attestation::kAttestationInterface,
+      attestation::kSignAggregated, callback, base::Bind(on_error), request);
+}
+
+void DBusProxy::SignFile(const SignFileRequest& request,
+                         int fd,
+                         const SignCallback& callback) {
+  auto on_error = [callback](brillo::Error* error) {
+    SignReply reply;
+    reply.set_status(STATUS_NOT_AVAILABLE);
+    callback.Run(reply);
+  };
+  dbus::FileDescriptor fd_arg(fd);
+  fd_arg.CheckValidity();
+  brillo::dbus_utils::CallMethodWithTimeout(
+      kDBusTimeoutMS, object_proxy_, attestation::kAttestationInterface,
+      attestation::kSignFile, callback, base::Bind(on_error), request, fd_arg);
+  // The dbus::FileDescriptor argument must not close the caller's fd.
+  fd_arg.TakeValue();
+}
+
 void DBusProxy::RegisterKeyWithChapsToken(
     const RegisterKeyWithChapsTokenRequest& request,
     const RegisterKeyWithChapsTokenCallback& callback) {
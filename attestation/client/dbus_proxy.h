@@ -23,6 +23,7 @@
 
 #include <base/memory/ref_counted.h>
 #include <dbus/bus.h>
+#include <dbus/file_descriptor.h>
 #include <dbus/object_proxy.h>
 
 namespace attestation {
@@ -58,6 +59,15 @@ class DBusProxy : public AttestationInterface {
   void Decrypt(const DecryptRequest& request,
                const DecryptCallback& callback) override;
   void Sign(const SignRequest& request, const SignCallback& callback) override;
+  void DecryptBatch(const DecryptBatchRequest& request,
+                    const DecryptBatchCallback& callback) override;
+  void SignBatch(const SignBatchRequest& request,
+                 const SignBatchCallback& callback) override;
+  void SignAggregated(const SignAggregatedRequest& request,
+                      const SignAggregatedCallback& callback) override;
+  void SignFile(const SignFileRequest& request,
+                int fd,
+                const SignCallback& callback) override;
   void RegisterKeyWithChapsToken(
       const RegisterKeyWithChapsTokenRequest& request,
       const RegisterKeyWithChapsTokenCallback& callback) override;
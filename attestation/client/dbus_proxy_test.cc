@@ -14,9 +14,14 @@
 // limitations under the License.
 //
 
+#include <fcntl.h>
+
 #include <string>
 
+#include <base/files/scoped_file.h>
+#include <base/posix/eintr_wrapper.h>
 #include <brillo/bind_lambda.h>
+#include <dbus/file_descriptor.h>
 #include <dbus/mock_object_proxy.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -377,6 +382,137 @@ TEST_F(DBusProxyTest, Sign) {
   EXPECT_EQ(1, callback_count);
 }
 
+TEST_F(DBusProxyTest, SignBatch) {
+  auto fake_dbus_call = [](
+      dbus::MethodCall* method_call,
+      const dbus::MockObjectProxy::ResponseCallback& response_callback) {
+    // Verify request protobuf.
+    dbus::MessageReader reader(method_call);
+    SignBatchRequest request_proto;
+    EXPECT_TRUE(reader.PopArrayOfBytesAsProto(&request_proto));
+    EXPECT_EQ("label", request_proto.key_label());
+    EXPECT_EQ("user", request_proto.username());
+    ASSERT_EQ(2, request_proto.data_to_sign_size());
+    EXPECT_EQ("data2", request_proto.data_to_sign(1));
+    // Create reply protobuf.
+    auto response = dbus::Response::CreateEmpty();
+    dbus::MessageWriter writer(response.get());
+    SignBatchReply reply_proto;
+    reply_proto.set_status(STATUS_SUCCESS);
+    reply_proto.add_signature("signature1");
+    reply_proto.add_signature("signature2");
+    writer.AppendProtoAsArrayOfBytes(reply_proto);
+    response_callback.Run(response.release());
+  };
+  EXPECT_CALL(*mock_object_proxy_, CallMethodWithErrorCallback(_, _, _, _))
+      .WillOnce(WithArgs<0, 2>(Invoke(fake_dbus_call)));
+
+  // Set expectations on the outputs.
+  int callback_count = 0;
+  auto callback = [&callback_count](const SignBatchReply& reply) {
+    callback_count++;
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    ASSERT_EQ(2, reply.signature_size());
+    EXPECT_EQ("signature2", reply.signature(1));
+  };
+  SignBatchRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  request.add_data_to_sign("data1");
+  request.add_data_to_sign("data2");
+  proxy_.SignBatch(request, base::Bind(callback));
+  EXPECT_EQ(1, callback_count);
+}
+
+TEST_F(DBusProxyTest, SignAggregated) {
+  auto fake_dbus_call = [](
+      dbus::MethodCall* method_call,
+      const dbus::MockObjectProxy::ResponseCallback& response_callback) {
+    // Verify request protobuf.
+    dbus::MessageReader reader(method_call);
+    SignAggregatedRequest request_proto;
+    EXPECT_TRUE(reader.PopArrayOfBytesAsProto(&request_proto));
+    EXPECT_EQ("label", request_proto.key_label());
+    EXPECT_EQ("user", request_proto.username());
+    EXPECT_EQ("nonce", request_proto.nonce());
+    // Create reply protobuf.
+    auto response = dbus::Response::CreateEmpty();
+    dbus::MessageWriter writer(response.get());
+    SignAggregatedReply reply_proto;
+    reply_proto.set_status(STATUS_SUCCESS);
+    reply_proto.set_signature("signature");
+    reply_proto.set_merkle_root("root");
+    reply_proto.set_leaf_index(1);
+    reply_proto.set_leaf_count(2);
+    reply_proto.add_inclusion_proof("sibling");
+    writer.AppendProtoAsArrayOfBytes(reply_proto);
+    response_callback.Run(response.release());
+  };
+  EXPECT_CALL(*mock_object_proxy_, CallMethodWithErrorCallback(_, _, _, _))
+      .WillOnce(WithArgs<0, 2>(Invoke(fake_dbus_call)));
+
+  // Set expectations on the outputs.
+  int callback_count = 0;
+  auto callback = [&callback_count](const SignAggregatedReply& reply) {
+    callback_count++;
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ("signature", reply.signature());
+    EXPECT_EQ("root", reply.merkle_root());
+    EXPECT_EQ(1, reply.leaf_index());
+    EXPECT_EQ(2, reply.leaf_count());
+    ASSERT_EQ(1, reply.inclusion_proof_size());
+    EXPECT_EQ("sibling", reply.inclusion_proof(0));
+  };
+  SignAggregatedRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  request.set_nonce("nonce");
+  proxy_.SignAggregated(request, base::Bind(callback));
+  EXPECT_EQ(1, callback_count);
+}
+
+TEST_F(DBusProxyTest, SignFile) {
+  auto fake_dbus_call = [](
+      dbus::MethodCall* method_call,
+      const dbus::MockObjectProxy::ResponseCallback& response_callback) {
+    // Verify request protobuf and file descriptor.
+    dbus::MessageReader reader(method_call);
+    SignFileRequest request_proto;
+    EXPECT_TRUE(reader.PopArrayOfBytesAsProto(&request_proto));
+    EXPECT_EQ("label", request_proto.key_label());
+    EXPECT_EQ("user", request_proto.username());
+    dbus::FileDescriptor fd;
+    EXPECT_TRUE(reader.PopFileDescriptor(&fd));
+    // Create reply protobuf.
+    auto response = dbus::Response::CreateEmpty();
+    dbus::MessageWriter writer(response.get());
+    SignReply reply_proto;
+    reply_proto.set_status(STATUS_SUCCESS);
+    reply_proto.set_signature("signature");
+    writer.AppendProtoAsArrayOfBytes(reply_proto);
+    response_callback.Run(response.release());
+  };
+  EXPECT_CALL(*mock_object_proxy_, CallMethodWithErrorCallback(_, _, _, _))
+      .WillOnce(WithArgs<0, 2>(Invoke(fake_dbus_call)));
+
+  // Set expectations on the outputs.
+  int callback_count = 0;
+  auto callback = [&callback_count](const SignReply& reply) {
+    callback_count++;
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ("signature", reply.signature());
+  };
+  base::ScopedFD fd(HANDLE_EINTR(open("/dev/null", O_RDONLY)));
+  ASSERT_TRUE(fd.is_valid());
+  SignFileRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  proxy_.SignFile(request, fd.get(), base::Bind(callback));
+  EXPECT_EQ(1, callback_count);
+  // The proxy leaves the caller's descriptor open.
+  EXPECT_LE(0, fcntl(fd.get(), F_GETFD));
+}
+
 TEST_F(DBusProxyTest, RegisterKeyWithChapsToken) {
   auto fake_dbus_call = [](
       dbus::MethodCall* method_call,
@@ -17,12 +17,16 @@
 #include <stdio.h>
 #include <sysexits.h>
 
+#include <deque>
 #include <memory>
 #include <string>
 
 #include <base/command_line.h>
 #include <base/files/file_util.h>
+#include <base/json/json_reader.h>
 #include <base/message_loop/message_loop.h>
+#include <base/strings/string_split.h>
+#include <base/values.h>
 #include <brillo/bind_lambda.h>
 #include <brillo/daemons/daemon.h>
 #include <brillo/syslog_logging.h>
@@ -47,8 +51,13 @@ const char kDecryptCommand[] = "decrypt";
 const char kSignCommand[] = "sign";
 const char kVerifyCommand[] = "verify";
 const char kRegisterCommand[] = "register";
+const char kBatchSwitch[] = "batch";
 const char kUsage[] = R"(
 Usage: attestation_client <command> [<args>]
+       attestation_client --batch=<batch_file>
+Runs one command, or with --batch the commands listed in a file ('-' for stdin)
+one after another over a single connection. Each line of a batch file is a JSON
+array of the arguments of one command, e.g. ["info", "--label=mykey"].
 Commands:
   create_and_certify [--user=<email>] [--label=<keylabel>]
       Creates a key and requests certification by the Google Attestation CA.
@@ -89,6 +98,46 @@ Commands:
       Registers a key with a PKCS #11 token.
 )";
 
+// Reads the commands of a batch file at |path|, or stdin if it is "-". Each
+// non-empty line is a JSON array of the arguments of a command, which are
+// parsed as if they followed |program|. Returns false if the file cannot be
+// read or a line is malformed.
+bool ReadBatch(const std::string& path,
+               const base::FilePath& program,
+               std::deque<base::CommandLine>* commands) {
+  std::string contents;
+  if (!base::ReadFileToString(
+          base::FilePath(path == "-" ? "/dev/stdin" : path), &contents)) {
+    LOG(ERROR) << "Failed to read batch file " << path;
+    return false;
+  }
+  int line_number = 0;
+  for (const std::string& line : base::SplitString(
+           contents, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL)) {
+    ++line_number;
+    if (line.empty()) {
+      continue;
+    }
+    std::unique_ptr<base::Value> value = base::JSONReader::Read(line);
+    base::ListValue* args = nullptr;
+    if (!value || !value->GetAsList(&args)) {
+      LOG(ERROR) << "Batch line " << line_number << " is not a JSON array.";
+      return false;
+    }
+    base::CommandLine::StringVector argv = {program.value()};
+    for (size_t i = 0; i < args->GetSize(); ++i) {
+      std::string arg;
+      if (!args->GetString(i, &arg)) {
+        LOG(ERROR) << "Batch line " << line_number << " has a non-string.";
+        return false;
+      }
+      argv.push_back(arg);
+    }
+    commands->emplace_back(argv);
+  }
+  return true;
+}
+
 // The Daemon class works well as a client loop as well.
 using ClientLoopBase = brillo::Daemon;
 
@@ -107,7 +156,17 @@ class ClientLoop : public ClientLoopBase {
     if (!attestation_->Initialize()) {
       return EX_UNAVAILABLE;
     }
-    exit_code = ScheduleCommand();
+    base::CommandLine* command_line = base::CommandLine::ForCurrentProcess();
+    if (command_line->HasSwitch(kBatchSwitch)) {
+      batch_mode_ = true;
+      if (!ReadBatch(command_line->GetSwitchValueASCII(kBatchSwitch),
+                     command_line->GetProgram(), &batch_)) {
+        return EX_DATAERR;
+      }
+      exit_code = ScheduleBatchCommand();
+    } else {
+      exit_code = ScheduleCommand(command_line);
+    }
     if (exit_code == EX_USAGE) {
       printf("%s", kUsage);
     }
@@ -120,10 +179,38 @@ class ClientLoop : public ClientLoopBase {
   }
 
  private:
-  // Posts tasks according to the command line options.
-  int ScheduleCommand() {
+  // Posts the next command of the batch, or a task to quit once the batch is
+  // done.
+  int ScheduleBatchCommand() {
+    if (batch_.empty()) {
+      base::MessageLoop::current()->PostTask(
+          FROM_HERE,
+          base::Bind(&ClientLoop::Quit, weak_factory_.GetWeakPtr()));
+      return EX_OK;
+    }
+    base::CommandLine command_line = batch_.front();
+    batch_.pop_front();
+    return ScheduleCommand(&command_line);
+  }
+
+  // Quits, or in batch mode goes on with the next command. The connection to
+  // attestationd is kept for the whole batch.
+  void FinishCommand() {
+    if (!batch_mode_) {
+      Quit();
+      return;
+    }
+    int exit_code = ScheduleBatchCommand();
+    if (exit_code != EX_OK) {
+      LOG(ERROR) << "Invalid command in batch.";
+      QuitWithExitCode(exit_code);
+    }
+  }
+
+  // Posts tasks according to the options in |command_line|.
+  int ScheduleCommand(const base::CommandLine* command_line) {
     base::Closure task;
-    base::CommandLine* command_line = base::CommandLine::ForCurrentProcess();
+    output_file_ = command_line->GetSwitchValueASCII("output");
     const auto& args = command_line->GetArgs();
     if (command_line->HasSwitch("help") || command_line->HasSwitch("h") ||
         (!args.empty() && args.front() == "help")) {
@@ -258,17 +345,20 @@ class ClientLoop : public ClientLoopBase {
   template <typename ProtobufType>
   void PrintReplyAndQuit(const ProtobufType& reply) {
     printf("%s\n", GetProtoDebugString(reply).c_str());
-    Quit();
+    FinishCommand();
   }
 
-  void WriteOutput(const std::string& output) {
-    base::FilePath filename(
-        base::CommandLine::ForCurrentProcess()->GetSwitchValueASCII("output"));
+  // Writes |output| to the --output file of the current command. Returns false
+  // and quits on failure.
+  bool WriteOutput(const std::string& output) {
+    base::FilePath filename(output_file_);
     if (base::WriteFile(filename, output.data(), output.size()) !=
         static_cast<int>(output.size())) {
       LOG(ERROR) << "Failed to write file: " << filename.value();
       QuitWithExitCode(EX_IOERR);
+      return false;
     }
+    return true;
   }
 
   void CallCreateGoogleAttestedKey(const std::string& label,
@@ -335,6 +425,7 @@ class ClientLoop : public ClientLoopBase {
                            const GetEndorsementInfoReply& endorsement_info) {
     if (endorsement_info.status() != STATUS_SUCCESS) {
       PrintReplyAndQuit(endorsement_info);
+      return;
     }
     GetAttestationKeyInfoRequest request;
     request.set_key_type(KEY_TYPE_RSA);
@@ -350,6 +441,7 @@ class ClientLoop : public ClientLoopBase {
       const GetAttestationKeyInfoReply& attestation_key_info) {
     if (attestation_key_info.status() != STATUS_SUCCESS) {
       PrintReplyAndQuit(attestation_key_info);
+      return;
     }
     CryptoUtilityImpl crypto(nullptr);
     EncryptedIdentityCredential encrypted;
@@ -357,11 +449,13 @@ class ClientLoop : public ClientLoopBase {
             input, endorsement_info.ek_public_key(),
             attestation_key_info.public_key_tpm_format(), &encrypted)) {
       QuitWithExitCode(EX_SOFTWARE);
+      return;
     }
     std::string output;
     encrypted.SerializeToString(&output);
-    WriteOutput(output);
-    Quit();
+    if (WriteOutput(output)) {
+      FinishCommand();
+    }
   }
 
   void CallCreateCertifiableKey(const std::string& label,
@@ -384,6 +478,7 @@ class ClientLoop : public ClientLoopBase {
     GetKeyInfoRequest request;
     request.set_key_label(label);
     request.set_username(username);
+    request.set_field_mask(KEY_INFO_PUBLIC_KEY);
     attestation_->GetKeyInfo(
         request,
         base::Bind(&ClientLoop::Encrypt2, weak_factory_.GetWeakPtr(), input));
@@ -394,9 +489,11 @@ class ClientLoop : public ClientLoopBase {
     std::string output;
     if (!crypto.EncryptForUnbind(key_info.public_key(), input, &output)) {
       QuitWithExitCode(EX_SOFTWARE);
+      return;
+    }
+    if (WriteOutput(output)) {
+      FinishCommand();
     }
-    WriteOutput(output);
-    Quit();
   }
 
   void CallDecrypt(const std::string& label,
@@ -423,9 +520,9 @@ class ClientLoop : public ClientLoopBase {
   }
 
   void OnSignComplete(const SignReply& reply) {
-    if (reply.status() == STATUS_SUCCESS &&
-        base::CommandLine::ForCurrentProcess()->HasSwitch("output")) {
-      WriteOutput(reply.signature());
+    if (reply.status() == STATUS_SUCCESS && !output_file_.empty() &&
+        !WriteOutput(reply.signature())) {
+      return;
     }
     PrintReplyAndQuit<SignReply>(reply);
   }
@@ -437,6 +534,7 @@ class ClientLoop : public ClientLoopBase {
     GetKeyInfoRequest request;
     request.set_key_label(label);
     request.set_username(username);
+    request.set_field_mask(KEY_INFO_PUBLIC_KEY);
     attestation_->GetKeyInfo(
         request, base::Bind(&ClientLoop::VerifySignature2,
                             weak_factory_.GetWeakPtr(), input, signature));
@@ -451,7 +549,7 @@ class ClientLoop : public ClientLoopBase {
     } else {
       printf("Signature is BAD!\n");
     }
-    Quit();
+    FinishCommand();
   }
 
   void CallRegister(const std::string& label, const std::string& username) {
@@ -467,6 +565,12 @@ class ClientLoop : public ClientLoopBase {
 
   std::unique_ptr<attestation::AttestationInterface> attestation_;
 
+  // Whether commands come from a batch file, and those still to run.
+  bool batch_mode_ = false;
+  std::deque<base::CommandLine> batch_;
+  // The --output file of the current command.
+  std::string output_file_;
+
   // Declare this last so weak pointers will be destroyed first.
   base::WeakPtrFactory<ClientLoop> weak_factory_{this};
 
@@ -92,6 +92,29 @@ class AttestationInterface {
   virtual void Sign(const SignRequest& request,
                     const SignCallback& callback) = 0;
 
+  // Processes a DecryptBatchRequest and responds with a DecryptBatchReply.
+  using DecryptBatchCallback = base::Callback<void(const DecryptBatchReply&)>;
+  virtual void DecryptBatch(const DecryptBatchRequest& request,
+                            const DecryptBatchCallback& callback) = 0;
+
+  // Processes a SignBatchRequest and responds with a SignBatchReply.
+  using SignBatchCallback = base::Callback<void(const SignBatchReply&)>;
+  virtual void SignBatch(const SignBatchRequest& request,
+                         const SignBatchCallback& callback) = 0;
+
+  // Processes a SignAggregatedRequest and responds with a
+  // SignAggregatedReply.
+  using SignAggregatedCallback =
+      base::Callback<void(const SignAggregatedReply&)>;
+  virtual void SignAggregated(const SignAggregatedRequest& request,
+                              const SignAggregatedCallback& callback) = 0;
+
+  // Processes a SignFileRequest, signing the contents of the file open at
+  // |fd|, and responds with a SignReply. |fd| is not closed.
+  virtual void SignFile(const SignFileRequest& request,
+                        int fd,
+                        const SignCallback& callback) = 0;
+
   // Processes a RegisterKeyWithChapsTokenRequest and responds with a
   // RegisterKeyWithChapsTokenReply.
   using RegisterKeyWithChapsTokenCallback =
@@ -0,0 +1,33 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef ATTESTATION_COMMON_BOOT_TRACE_H_
+#define ATTESTATION_COMMON_BOOT_TRACE_H_
+
+// Boot tracing comes with trunks, so attestationd only records its startup
+// phases on TPM 2.0 devices. See trunks/boot_trace.h.
+#if defined(USE_TPM2)
+#include <trunks/boot_trace.h>
+
+// Records the enclosing scope as a boot trace phase called |name|.
+#define ATTESTATION_BOOT_TRACE_PHASE(name) \
+  trunks::ScopedBootTracePhase boot_trace_phase(name)
+#else
+#define ATTESTATION_BOOT_TRACE_PHASE(name)
+#endif
+
+#endif  // ATTESTATION_COMMON_BOOT_TRACE_H_
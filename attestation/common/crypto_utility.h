@@ -53,6 +53,12 @@ class CryptoUtility {
                          std::string* aes_key,
                          std::string* sealed_key) = 0;
 
+  // Extracts the |sealed_key| embedded in the given |encrypted_data| without
+  // unsealing it, so callers can tell whether a key they already hold
+  // decrypts it. Returns true on success.
+  virtual bool GetSealedKey(const std::string& encrypted_data,
+                            std::string* sealed_key) = 0;
+
   // Decrypts |encrypted_data| using |aes_key|, producing the decrypted |data|.
   // Returns true on success.
   virtual bool DecryptData(const std::string& encrypted_data,
@@ -91,6 +97,11 @@ class CryptoUtility {
   virtual bool VerifySignature(const std::string& public_key,
                                const std::string& data,
                                const std::string& signature) = 0;
+
+  // Reads the end of the validity period of an X.509 |certificate| in DER
+  // form into |not_after|, in seconds since the Unix epoch.
+  virtual bool GetCertificateNotAfter(const std::string& certificate,
+                                      int64_t* not_after) = 0;
 };
 
 }  // namespace attestation
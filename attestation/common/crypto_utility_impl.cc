@@ -38,6 +38,14 @@ namespace {
 
 const size_t kAesKeySize = 32;
 const size_t kAesBlockSize = 16;
+const size_t kAesGcmIvSize = 12;
+const size_t kAesGcmTagSize = 16;
+// The number of parsed public keys to keep. A few keys, like the EK and the
+// Attestation CA keys, are used over and over.
+const size_t kMaxCachedPublicKeys = 8;
+
+typedef crypto::ScopedOpenSSL<X509, X509_free> ScopedX509;
+typedef crypto::ScopedOpenSSL<ASN1_TIME, ASN1_TIME_free> ScopedASN1_TIME;
 
 std::string GetOpenSSLError() {
   BIO* bio = BIO_new(BIO_s_mem());
@@ -61,9 +69,13 @@ CryptoUtilityImpl::CryptoUtilityImpl(TpmUtility* tpm_utility)
     : tpm_utility_(tpm_utility) {
   OpenSSL_add_all_algorithms();
   ERR_load_crypto_strings();
+  EVP_CIPHER_CTX_init(&gcm_context_);
+  CHECK(EVP_CipherInit_ex(&gcm_context_, EVP_aes_256_gcm(), nullptr, nullptr,
+                          nullptr, 1));
 }
 
 CryptoUtilityImpl::~CryptoUtilityImpl() {
+  EVP_CIPHER_CTX_cleanup(&gcm_context_);
   EVP_cleanup();
   ERR_free_strings();
 }
@@ -97,20 +109,18 @@ bool CryptoUtilityImpl::EncryptData(const std::string& data,
                                     const std::string& sealed_key,
                                     std::string* encrypted_data) {
   std::string iv;
-  if (!GetRandom(kAesBlockSize, &iv)) {
+  if (!GetRandom(kAesGcmIvSize, &iv)) {
     LOG(ERROR) << __func__ << ": GetRandom failed.";
     return false;
   }
-  std::string raw_encrypted_data;
-  if (!AesEncrypt(data, aes_key, iv, &raw_encrypted_data)) {
+  EncryptedData encrypted_pb;
+  if (!AesGcmEncrypt(data, aes_key, iv, encrypted_pb.mutable_encrypted_data(),
+                     encrypted_pb.mutable_tag())) {
     LOG(ERROR) << __func__ << ": AES encryption failed.";
     return false;
   }
-  EncryptedData encrypted_pb;
   encrypted_pb.set_wrapped_key(sealed_key);
   encrypted_pb.set_iv(iv);
-  encrypted_pb.set_encrypted_data(raw_encrypted_data);
-  encrypted_pb.set_mac(HmacSha512(iv + raw_encrypted_data, aes_key));
   if (!encrypted_pb.SerializeToString(encrypted_data)) {
     LOG(ERROR) << __func__ << ": Failed to serialize protobuf.";
     return false;
@@ -134,6 +144,17 @@ bool CryptoUtilityImpl::UnsealKey(const std::string& encrypted_data,
   return true;
 }
 
+bool CryptoUtilityImpl::GetSealedKey(const std::string& encrypted_data,
+                                     std::string* sealed_key) {
+  EncryptedData encrypted_pb;
+  if (!encrypted_pb.ParseFromString(encrypted_data)) {
+    LOG(ERROR) << __func__ << ": Failed to parse protobuf.";
+    return false;
+  }
+  *sealed_key = encrypted_pb.wrapped_key();
+  return true;
+}
+
 bool CryptoUtilityImpl::DecryptData(const std::string& encrypted_data,
                                     const std::string& aes_key,
                                     std::string* data) {
@@ -142,6 +163,15 @@ bool CryptoUtilityImpl::DecryptData(const std::string& encrypted_data,
     LOG(ERROR) << __func__ << ": Failed to parse protobuf.";
     return false;
   }
+  if (encrypted_pb.has_tag()) {
+    if (!AesGcmDecrypt(encrypted_pb.encrypted_data(), aes_key,
+                       encrypted_pb.iv(), encrypted_pb.tag(), data)) {
+      LOG(ERROR) << __func__ << ": AES decryption failed.";
+      return false;
+    }
+    return true;
+  }
+  // Data encrypted before AES-GCM was used.
   std::string mac =
       HmacSha512(encrypted_pb.iv() + encrypted_pb.encrypted_data(), aes_key);
   if (mac.length() != encrypted_pb.mac().length()) {
@@ -186,10 +216,7 @@ bool CryptoUtilityImpl::GetRSASubjectPublicKeyInfo(
 
 bool CryptoUtilityImpl::GetRSAPublicKey(const std::string& public_key_info,
                                         std::string* public_key) {
-  auto asn1_ptr =
-      reinterpret_cast<const unsigned char*>(public_key_info.data());
-  crypto::ScopedRSA rsa(
-      d2i_RSA_PUBKEY(NULL, &asn1_ptr, public_key_info.size()));
+  crypto::ScopedRSA rsa = ParsePublicKeyInfo(public_key_info);
   if (!rsa.get()) {
     LOG(ERROR) << __func__
                << ": Failed to decode public key: " << GetOpenSSLError();
@@ -237,10 +264,7 @@ bool CryptoUtilityImpl::EncryptIdentityCredential(
       asym_header + aes_key + base::SHA1HashString(aik_public_key);
 
   // Encrypt the TPM_ASYM_CA_CONTENTS with the EK public key.
-  auto asn1_ptr =
-      reinterpret_cast<const unsigned char*>(ek_public_key_info.data());
-  crypto::ScopedRSA rsa(
-      d2i_RSA_PUBKEY(NULL, &asn1_ptr, ek_public_key_info.size()));
+  crypto::ScopedRSA rsa = ParsePublicKeyInfo(ek_public_key_info);
   if (!rsa.get()) {
     LOG(ERROR) << __func__
                << ": Failed to decode EK public key: " << GetOpenSSLError();
@@ -275,8 +299,7 @@ bool CryptoUtilityImpl::EncryptForUnbind(const std::string& public_key,
   std::string bound_data = header + data;
 
   // Encrypt using the TPM_ES_RSAESOAEP_SHA1_MGF1 scheme.
-  auto asn1_ptr = reinterpret_cast<const unsigned char*>(public_key.data());
-  crypto::ScopedRSA rsa(d2i_RSA_PUBKEY(NULL, &asn1_ptr, public_key.size()));
+  crypto::ScopedRSA rsa = ParsePublicKeyInfo(public_key);
   if (!rsa.get()) {
     LOG(ERROR) << __func__
                << ": Failed to decode public key: " << GetOpenSSLError();
@@ -292,8 +315,7 @@ bool CryptoUtilityImpl::EncryptForUnbind(const std::string& public_key,
 bool CryptoUtilityImpl::VerifySignature(const std::string& public_key,
                                         const std::string& data,
                                         const std::string& signature) {
-  auto asn1_ptr = reinterpret_cast<const unsigned char*>(public_key.data());
-  crypto::ScopedRSA rsa(d2i_RSA_PUBKEY(NULL, &asn1_ptr, public_key.size()));
+  crypto::ScopedRSA rsa = ParsePublicKeyInfo(public_key);
   if (!rsa.get()) {
     LOG(ERROR) << __func__
                << ": Failed to decode public key: " << GetOpenSSLError();
@@ -307,6 +329,58 @@ bool CryptoUtilityImpl::VerifySignature(const std::string& public_key,
                      signature.size(), rsa.get()) == 1);
 }
 
+bool CryptoUtilityImpl::GetCertificateNotAfter(const std::string& certificate,
+                                               int64_t* not_after) {
+  auto asn1_ptr = reinterpret_cast<const unsigned char*>(certificate.data());
+  ScopedX509 x509(d2i_X509(nullptr, &asn1_ptr, certificate.size()));
+  if (!x509.get()) {
+    LOG(ERROR) << __func__
+               << ": Failed to decode certificate: " << GetOpenSSLError();
+    return false;
+  }
+  ScopedASN1_TIME epoch(ASN1_TIME_set(nullptr, 0));
+  int days = 0;
+  int seconds = 0;
+  if (!epoch.get() || !ASN1_TIME_diff(&days, &seconds, epoch.get(),
+                                      X509_get_notAfter(x509.get()))) {
+    LOG(ERROR) << __func__
+               << ": Failed to read certificate expiry: " << GetOpenSSLError();
+    return false;
+  }
+  *not_after = static_cast<int64_t>(days) * 24 * 60 * 60 + seconds;
+  return true;
+}
+
+crypto::ScopedRSA CryptoUtilityImpl::ParsePublicKeyInfo(
+    const std::string& public_key_info) {
+  std::string digest = crypto::SHA256HashString(public_key_info);
+  base::AutoLock lock(public_key_cache_lock_);
+  for (auto it = public_key_cache_.begin(); it != public_key_cache_.end();
+       ++it) {
+    if (it->digest == digest) {
+      public_key_cache_.splice(public_key_cache_.begin(), public_key_cache_,
+                               it);
+      RSA_up_ref(it->rsa.get());
+      return crypto::ScopedRSA(it->rsa.get());
+    }
+  }
+  auto asn1_ptr =
+      reinterpret_cast<const unsigned char*>(public_key_info.data());
+  crypto::ScopedRSA rsa(
+      d2i_RSA_PUBKEY(nullptr, &asn1_ptr, public_key_info.size()));
+  if (!rsa.get()) {
+    return rsa;
+  }
+  public_key_cache_.emplace_front();
+  public_key_cache_.front().digest = digest;
+  RSA_up_ref(rsa.get());
+  public_key_cache_.front().rsa.reset(rsa.get());
+  if (public_key_cache_.size() > kMaxCachedPublicKeys) {
+    public_key_cache_.pop_back();
+  }
+  return rsa;
+}
+
 bool CryptoUtilityImpl::AesEncrypt(const std::string& data,
                                    const std::string& key,
                                    const std::string& iv,
@@ -407,6 +481,104 @@ bool CryptoUtilityImpl::AesDecrypt(const std::string& encrypted_data,
   return true;
 }
 
+bool CryptoUtilityImpl::AesGcmEncrypt(const std::string& data,
+                                      const std::string& key,
+                                      const std::string& iv,
+                                      std::string* encrypted_data,
+                                      std::string* tag) {
+  if (key.size() != kAesKeySize || iv.size() != kAesGcmIvSize) {
+    return false;
+  }
+  if (data.size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+    // EVP_EncryptUpdate takes a signed int.
+    return false;
+  }
+  auto key_buffer = reinterpret_cast<const unsigned char*>(key.data());
+  auto iv_buffer = reinterpret_cast<const unsigned char*>(iv.data());
+  // GCM needs no padding, so the output is no larger than the input.
+  encrypted_data->resize(data.size());
+  int output_size = 0;
+  base::AutoLock lock(gcm_context_lock_);
+  if (!EVP_EncryptInit_ex(&gcm_context_, nullptr, nullptr, key_buffer,
+                          iv_buffer)) {
+    LOG(ERROR) << __func__ << ": " << GetOpenSSLError();
+    return false;
+  }
+  if (!data.empty() &&
+      !EVP_EncryptUpdate(
+          &gcm_context_, StringAsOpenSSLBuffer(encrypted_data), &output_size,
+          reinterpret_cast<const unsigned char*>(data.data()), data.size())) {
+    LOG(ERROR) << __func__ << ": " << GetOpenSSLError();
+    return false;
+  }
+  int final_size = 0;
+  unsigned char final_buffer[kAesBlockSize];
+  if (!EVP_EncryptFinal_ex(&gcm_context_, final_buffer, &final_size)) {
+    LOG(ERROR) << __func__ << ": " << GetOpenSSLError();
+    return false;
+  }
+  DCHECK_EQ(0, final_size);
+  encrypted_data->resize(output_size);
+  tag->resize(kAesGcmTagSize);
+  if (!EVP_CIPHER_CTX_ctrl(&gcm_context_, EVP_CTRL_GCM_GET_TAG, kAesGcmTagSize,
+                           StringAsOpenSSLBuffer(tag))) {
+    LOG(ERROR) << __func__ << ": " << GetOpenSSLError();
+    return false;
+  }
+  return true;
+}
+
+bool CryptoUtilityImpl::AesGcmDecrypt(const std::string& encrypted_data,
+                                      const std::string& key,
+                                      const std::string& iv,
+                                      const std::string& tag,
+                                      std::string* data) {
+  if (key.size() != kAesKeySize || iv.size() != kAesGcmIvSize ||
+      tag.size() != kAesGcmTagSize) {
+    return false;
+  }
+  if (encrypted_data.size() >
+      static_cast<size_t>(std::numeric_limits<int>::max())) {
+    // EVP_DecryptUpdate takes a signed int.
+    return false;
+  }
+  auto key_buffer = reinterpret_cast<const unsigned char*>(key.data());
+  auto iv_buffer = reinterpret_cast<const unsigned char*>(iv.data());
+  std::string mutable_tag(tag);
+  data->resize(encrypted_data.size());
+  int output_size = 0;
+  base::AutoLock lock(gcm_context_lock_);
+  if (!EVP_DecryptInit_ex(&gcm_context_, nullptr, nullptr, key_buffer,
+                          iv_buffer)) {
+    LOG(ERROR) << __func__ << ": " << GetOpenSSLError();
+    return false;
+  }
+  if (!encrypted_data.empty() &&
+      !EVP_DecryptUpdate(
+          &gcm_context_, StringAsOpenSSLBuffer(data), &output_size,
+          reinterpret_cast<const unsigned char*>(encrypted_data.data()),
+          encrypted_data.size())) {
+    LOG(ERROR) << __func__ << ": " << GetOpenSSLError();
+    return false;
+  }
+  if (!EVP_CIPHER_CTX_ctrl(&gcm_context_, EVP_CTRL_GCM_SET_TAG, kAesGcmTagSize,
+                           StringAsOpenSSLBuffer(&mutable_tag))) {
+    LOG(ERROR) << __func__ << ": " << GetOpenSSLError();
+    return false;
+  }
+  int final_size = 0;
+  unsigned char final_buffer[kAesBlockSize];
+  if (!EVP_DecryptFinal_ex(&gcm_context_, final_buffer, &final_size)) {
+    // Do not hand out data that failed authentication.
+    data->clear();
+    LOG(ERROR) << __func__ << ": Corrupted data in encrypted pb.";
+    return false;
+  }
+  DCHECK_EQ(0, final_size);
+  data->resize(output_size);
+  return true;
+}
+
 std::string CryptoUtilityImpl::HmacSha512(const std::string& data,
                                           const std::string& key) {
   unsigned char mac[SHA512_DIGEST_LENGTH];
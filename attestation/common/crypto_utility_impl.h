@@ -19,8 +19,12 @@
 
 #include "attestation/common/crypto_utility.h"
 
+#include <list>
 #include <string>
 
+#include <base/synchronization/lock.h>
+#include <crypto/scoped_openssl_types.h>
+#include <openssl/evp.h>
 #include <openssl/rsa.h>
 
 #include "attestation/common/tpm_utility.h"
@@ -44,6 +48,8 @@ class CryptoUtilityImpl : public CryptoUtility {
   bool UnsealKey(const std::string& encrypted_data,
                  std::string* aes_key,
                  std::string* sealed_key) override;
+  bool GetSealedKey(const std::string& encrypted_data,
+                    std::string* sealed_key) override;
   bool DecryptData(const std::string& encrypted_data,
                    const std::string& aes_key,
                    std::string* data) override;
@@ -62,8 +68,21 @@ class CryptoUtilityImpl : public CryptoUtility {
   bool VerifySignature(const std::string& public_key,
                        const std::string& data,
                        const std::string& signature) override;
+  bool GetCertificateNotAfter(const std::string& certificate,
+                              int64_t* not_after) override;
 
  private:
+  // A parsed public key, identified by the SHA-256 digest of its DER encoding.
+  struct CachedPublicKey {
+    std::string digest;
+    crypto::ScopedRSA rsa;
+  };
+
+  // Parses a DER-encoded X.509 SubjectPublicKeyInfo, reusing an earlier parse
+  // of the same key if there is one. Returns a new reference to the key, or
+  // nullptr if |public_key_info| cannot be parsed.
+  crypto::ScopedRSA ParsePublicKeyInfo(const std::string& public_key_info);
+
   // Encrypts |data| using |key| and |iv| for AES in CBC mode with PKCS #5
   // padding and produces the |encrypted_data|. Returns true on success.
   bool AesEncrypt(const std::string& data,
@@ -78,6 +97,23 @@ class CryptoUtilityImpl : public CryptoUtility {
                   const std::string& iv,
                   std::string* data);
 
+  // Encrypts |data| using |key| and |iv| for AES in GCM mode and produces the
+  // |encrypted_data| and its authentication |tag|. Returns true on success.
+  bool AesGcmEncrypt(const std::string& data,
+                     const std::string& key,
+                     const std::string& iv,
+                     std::string* encrypted_data,
+                     std::string* tag);
+
+  // Decrypts |encrypted_data| using |key| and |iv| for AES in GCM mode and
+  // produces the decrypted |data| iff it matches the authentication |tag|.
+  // Returns true on success.
+  bool AesGcmDecrypt(const std::string& encrypted_data,
+                     const std::string& key,
+                     const std::string& iv,
+                     const std::string& tag,
+                     std::string* data);
+
   // Computes and returns an HMAC of |data| using |key| and SHA-512.
   std::string HmacSha512(const std::string& data, const std::string& key);
 
@@ -93,6 +129,13 @@ class CryptoUtilityImpl : public CryptoUtility {
                                 std::string* output);
 
   TpmUtility* tpm_utility_;
+  // An AES-256-GCM context set up once and reused for every AesGcmEncrypt()
+  // and AesGcmDecrypt() call, which only supply a key and an IV.
+  base::Lock gcm_context_lock_;
+  EVP_CIPHER_CTX gcm_context_;
+  // Recently parsed public keys, most recently used first.
+  base::Lock public_key_cache_lock_;
+  std::list<CachedPublicKey> public_key_cache_;
 };
 
 }  // namespace attestation
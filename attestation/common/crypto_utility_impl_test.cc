@@ -20,8 +20,14 @@
 
 #include <base/logging.h>
 #include <base/strings/string_number_conversions.h>
+#include <crypto/scoped_openssl_types.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <openssl/bn.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
 
 #include "attestation/common/crypto_utility_impl.h"
 #include "attestation/common/mock_tpm_utility.h"
@@ -51,6 +57,40 @@ std::string HexDecode(const std::string hex) {
   return std::string(reinterpret_cast<char*>(output.data()), output.size());
 }
 
+// Encrypts |data| with |key| the way EncryptData() did before AES-GCM, using
+// AES-256-CBC and an HMAC-SHA512 over the IV and the encrypted data.
+std::string LegacyEncryptData(const std::string& data, const std::string& key) {
+  std::string iv(16, 'i');
+  std::string encrypted(data.size() + 16, 0);
+  auto output = reinterpret_cast<unsigned char*>(&encrypted[0]);
+  int length = 0;
+  int final_length = 0;
+  EVP_CIPHER_CTX context;
+  EVP_CIPHER_CTX_init(&context);
+  CHECK(EVP_EncryptInit_ex(&context, EVP_aes_256_cbc(), nullptr,
+                           reinterpret_cast<const unsigned char*>(key.data()),
+                           reinterpret_cast<const unsigned char*>(iv.data())));
+  CHECK(EVP_EncryptUpdate(&context, output, &length,
+                          reinterpret_cast<const unsigned char*>(data.data()),
+                          data.size()));
+  CHECK(EVP_EncryptFinal_ex(&context, output + length, &final_length));
+  EVP_CIPHER_CTX_cleanup(&context);
+  encrypted.resize(length + final_length);
+  std::string mac_input = iv + encrypted;
+  unsigned char mac[EVP_MAX_MD_SIZE];
+  unsigned int mac_length = 0;
+  HMAC(EVP_sha512(), key.data(), key.size(),
+       reinterpret_cast<const unsigned char*>(mac_input.data()),
+       mac_input.size(), mac, &mac_length);
+  attestation::EncryptedData encrypted_pb;
+  encrypted_pb.set_iv(iv);
+  encrypted_pb.set_encrypted_data(encrypted);
+  encrypted_pb.set_mac(std::string(reinterpret_cast<char*>(mac), mac_length));
+  std::string output_pb;
+  CHECK(encrypted_pb.SerializeToString(&output_pb));
+  return output_pb;
+}
+
 }  // namespace
 
 namespace attestation {
@@ -97,6 +137,51 @@ TEST_F(CryptoUtilityImplTest, PairwiseSealedEncryption) {
   EXPECT_EQ("test", data);
 }
 
+TEST_F(CryptoUtilityImplTest, EncryptionIsAuthenticated) {
+  std::string key(32, 'k');
+  std::string encrypted_data;
+  EXPECT_TRUE(crypto_utility_->EncryptData("test", key, key, &encrypted_data));
+  EncryptedData encrypted_pb;
+  ASSERT_TRUE(encrypted_pb.ParseFromString(encrypted_data));
+  EXPECT_FALSE(encrypted_pb.tag().empty());
+  EXPECT_FALSE(encrypted_pb.has_mac());
+  std::string data;
+  EXPECT_TRUE(crypto_utility_->DecryptData(encrypted_data, key, &data));
+  EXPECT_EQ("test", data);
+  // Decrypting twice reuses the cipher context.
+  EXPECT_TRUE(crypto_utility_->DecryptData(encrypted_data, key, &data));
+  EXPECT_EQ("test", data);
+  // Any change to the encrypted data is detected.
+  (*encrypted_pb.mutable_encrypted_data())[0] ^= 1;
+  ASSERT_TRUE(encrypted_pb.SerializeToString(&encrypted_data));
+  EXPECT_FALSE(crypto_utility_->DecryptData(encrypted_data, key, &data));
+}
+
+TEST_F(CryptoUtilityImplTest, DecryptLegacyData) {
+  std::string key(32, 'k');
+  std::string encrypted_data = LegacyEncryptData("legacy", key);
+  std::string data;
+  EXPECT_TRUE(crypto_utility_->DecryptData(encrypted_data, key, &data));
+  EXPECT_EQ("legacy", data);
+  std::string wrong_key(32, 'x');
+  EXPECT_FALSE(crypto_utility_->DecryptData(encrypted_data, wrong_key, &data));
+}
+
+TEST_F(CryptoUtilityImplTest, GetSealedKey) {
+  std::string key;
+  std::string sealed_key;
+  EXPECT_TRUE(crypto_utility_->CreateSealedKey(&key, &sealed_key));
+  std::string encrypted_data;
+  EXPECT_TRUE(
+      crypto_utility_->EncryptData("test", key, sealed_key, &encrypted_data));
+  // No unseal is needed to read the sealed key.
+  EXPECT_CALL(mock_tpm_utility_, Unseal(_, _)).Times(0);
+  std::string output;
+  EXPECT_TRUE(crypto_utility_->GetSealedKey(encrypted_data, &output));
+  EXPECT_EQ(sealed_key, output);
+  EXPECT_FALSE(crypto_utility_->GetSealedKey("invalid", &output));
+}
+
 TEST_F(CryptoUtilityImplTest, SealFailure) {
   EXPECT_CALL(mock_tpm_utility_, SealToPCR0(_, _))
       .WillRepeatedly(Return(false));
@@ -174,6 +259,21 @@ TEST_F(CryptoUtilityImplTest, GetRSASubjectPublicKeyInfoPairWise) {
   EXPECT_EQ(public_key, public_key2);
 }
 
+TEST_F(CryptoUtilityImplTest, GetRSAPublicKeyCached) {
+  std::string public_key_info;
+  EXPECT_TRUE(crypto_utility_->GetRSASubjectPublicKeyInfo(
+      HexDecode(kValidPublicKeyHex), &public_key_info));
+  std::string public_key;
+  EXPECT_FALSE(crypto_utility_->GetRSAPublicKey("invalid", &public_key));
+  // The second call uses the key parsed by the first.
+  for (int i = 0; i < 2; ++i) {
+    public_key.clear();
+    EXPECT_TRUE(crypto_utility_->GetRSAPublicKey(public_key_info, &public_key));
+    EXPECT_EQ(HexDecode(kValidPublicKeyHex), public_key);
+  }
+  EXPECT_FALSE(crypto_utility_->GetRSAPublicKey("invalid", &public_key));
+}
+
 TEST_F(CryptoUtilityImplTest, EncryptIdentityCredential) {
   std::string public_key = HexDecode(kValidPublicKeyHex);
   std::string public_key_info;
@@ -233,4 +333,32 @@ TEST_F(CryptoUtilityImplTest, VerifySignatureBadKey) {
   EXPECT_FALSE(crypto_utility_->VerifySignature("bad_key", "input", ""));
 }
 
+TEST_F(CryptoUtilityImplTest, GetCertificateNotAfter) {
+  const int64_t kNotAfter = 1500000000;
+  crypto::ScopedRSA rsa(RSA_new());
+  crypto::ScopedBIGNUM exponent(BN_new());
+  ASSERT_TRUE(BN_set_word(exponent.get(), RSA_F4));
+  ASSERT_TRUE(RSA_generate_key_ex(rsa.get(), 2048, exponent.get(), nullptr));
+  crypto::ScopedEVP_PKEY key(EVP_PKEY_new());
+  ASSERT_TRUE(EVP_PKEY_set1_RSA(key.get(), rsa.get()));
+  crypto::ScopedOpenSSL<X509, X509_free> x509(X509_new());
+  ASSERT_TRUE(ASN1_TIME_set(X509_get_notBefore(x509.get()), 0));
+  ASSERT_TRUE(ASN1_TIME_set(X509_get_notAfter(x509.get()), kNotAfter));
+  ASSERT_TRUE(X509_set_pubkey(x509.get(), key.get()));
+  ASSERT_TRUE(X509_sign(x509.get(), key.get(), EVP_sha256()));
+  unsigned char* buffer = nullptr;
+  int length = i2d_X509(x509.get(), &buffer);
+  ASSERT_GT(length, 0);
+  std::string certificate(reinterpret_cast<char*>(buffer), length);
+  OPENSSL_free(buffer);
+  int64_t not_after = 0;
+  EXPECT_TRUE(crypto_utility_->GetCertificateNotAfter(certificate, &not_after));
+  EXPECT_EQ(kNotAfter, not_after);
+}
+
+TEST_F(CryptoUtilityImplTest, GetCertificateNotAfterBadCertificate) {
+  int64_t not_after = 0;
+  EXPECT_FALSE(crypto_utility_->GetCertificateNotAfter("bad", &not_after));
+}
+
 }  // namespace attestation
@@ -33,6 +33,10 @@ constexpr char kActivateAttestationKey[] = "ActivateAttestationKey";
 constexpr char kCreateCertifiableKey[] = "CreateCertifiableKey";
 constexpr char kDecrypt[] = "Decrypt";
 constexpr char kSign[] = "Sign";
+constexpr char kDecryptBatch[] = "DecryptBatch";
+constexpr char kSignBatch[] = "SignBatch";
+constexpr char kSignAggregated[] = "SignAggregated";
+constexpr char kSignFile[] = "SignFile";
 constexpr char kRegisterKeyWithChapsToken[] = "RegisterKeyWithChapsToken";
 
 }  // namespace attestation
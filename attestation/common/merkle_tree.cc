@@ -0,0 +1,116 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "attestation/common/merkle_tree.h"
+
+#include <base/logging.h>
+#include <crypto/sha2.h>
+
+namespace {
+
+const char kLeafPrefix[] = {0x00};
+const char kNodePrefix[] = {0x01};
+
+}  // namespace
+
+namespace attestation {
+
+MerkleTree::MerkleTree(const std::vector<std::string>& leaves) {
+  CHECK(!leaves.empty());
+  levels_.emplace_back();
+  levels_.back().reserve(leaves.size());
+  for (const std::string& leaf : leaves) {
+    levels_.back().push_back(HashLeaf(leaf));
+  }
+  while (levels_.back().size() > 1) {
+    const std::vector<std::string>& level = levels_.back();
+    std::vector<std::string> parents;
+    parents.reserve((level.size() + 1) / 2);
+    for (size_t i = 0; i + 1 < level.size(); i += 2) {
+      parents.push_back(HashChildren(level[i], level[i + 1]));
+    }
+    if (level.size() % 2 == 1) {
+      parents.push_back(level.back());
+    }
+    levels_.push_back(std::move(parents));
+  }
+}
+
+MerkleTree::~MerkleTree() {}
+
+std::vector<std::string> MerkleTree::GetInclusionProof(size_t index) const {
+  CHECK_LT(index, leaf_count());
+  std::vector<std::string> proof;
+  for (size_t level = 0; level + 1 < levels_.size(); ++level) {
+    const std::vector<std::string>& nodes = levels_[level];
+    size_t sibling = index ^ 1;
+    // The last node of an odd level has no sibling and is passed up as is.
+    if (sibling < nodes.size()) {
+      proof.push_back(nodes[sibling]);
+    }
+    index /= 2;
+  }
+  return proof;
+}
+
+// static
+bool MerkleTree::VerifyInclusionProof(const std::string& leaf,
+                                      size_t index,
+                                      size_t leaf_count,
+                                      const std::vector<std::string>& proof,
+                                      const std::string& root) {
+  if (index >= leaf_count) {
+    return false;
+  }
+  // As in RFC 9162 Section 2.1.3.2: |node| is the index of the current hash on
+  // its level and |last_node| the index of the level's last node.
+  size_t node = index;
+  size_t last_node = leaf_count - 1;
+  std::string hash = HashLeaf(leaf);
+  for (const std::string& sibling : proof) {
+    if (last_node == 0) {
+      return false;
+    }
+    if (node % 2 == 1 || node == last_node) {
+      hash = HashChildren(sibling, hash);
+      // Skip the levels where this node had no right sibling.
+      while (node % 2 == 0 && node != 0) {
+        node /= 2;
+        last_node /= 2;
+      }
+    } else {
+      hash = HashChildren(hash, sibling);
+    }
+    node /= 2;
+    last_node /= 2;
+  }
+  return last_node == 0 && hash == root;
+}
+
+// static
+std::string MerkleTree::HashLeaf(const std::string& leaf) {
+  return crypto::SHA256HashString(
+      std::string(kLeafPrefix, sizeof(kLeafPrefix)) + leaf);
+}
+
+// static
+std::string MerkleTree::HashChildren(const std::string& left,
+                                     const std::string& right) {
+  return crypto::SHA256HashString(
+      std::string(kNodePrefix, sizeof(kNodePrefix)) + left + right);
+}
+
+}  // namespace attestation
@@ -0,0 +1,67 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ATTESTATION_COMMON_MERKLE_TREE_H_
+#define ATTESTATION_COMMON_MERKLE_TREE_H_
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+namespace attestation {
+
+// A SHA-256 Merkle tree over a list of byte strings, hashed as specified in
+// RFC 6962 Section 2.1: a leaf hash is SHA256(0x00 || data) and an interior
+// node hash is SHA256(0x01 || left || right). One signature of the root then
+// covers every leaf, and an inclusion proof shows that a single leaf is part
+// of the signed tree.
+class MerkleTree {
+ public:
+  // Builds the tree over |leaves|, which must not be empty.
+  explicit MerkleTree(const std::vector<std::string>& leaves);
+  ~MerkleTree();
+
+  // Returns the root hash.
+  const std::string& root() const { return levels_.back().front(); }
+
+  size_t leaf_count() const { return levels_.front().size(); }
+
+  // Returns the inclusion proof (audit path) of the leaf at |index|, from the
+  // leaf's sibling up to the root's child.
+  std::vector<std::string> GetInclusionProof(size_t index) const;
+
+  // Returns true iff |proof| shows that |leaf| is at |index| in a tree of
+  // |leaf_count| leaves with the given |root|.
+  static bool VerifyInclusionProof(const std::string& leaf,
+                                   size_t index,
+                                   size_t leaf_count,
+                                   const std::vector<std::string>& proof,
+                                   const std::string& root);
+
+  static std::string HashLeaf(const std::string& leaf);
+  static std::string HashChildren(const std::string& left,
+                                  const std::string& right);
+
+ private:
+  // The node hashes of each level, leaves first. A level with an odd number of
+  // nodes passes its last node up unchanged, which yields the RFC 6962 tree.
+  std::vector<std::vector<std::string>> levels_;
+};
+
+}  // namespace attestation
+
+#endif  // ATTESTATION_COMMON_MERKLE_TREE_H_
@@ -0,0 +1,85 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "attestation/common/merkle_tree.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace attestation {
+
+namespace {
+
+std::vector<std::string> GetLeaves(size_t count) {
+  std::vector<std::string> leaves;
+  for (size_t i = 0; i < count; ++i) {
+    leaves.push_back("nonce" + std::to_string(i));
+  }
+  return leaves;
+}
+
+}  // namespace
+
+TEST(MerkleTreeTest, SingleLeaf) {
+  MerkleTree tree({"nonce"});
+  EXPECT_EQ(MerkleTree::HashLeaf("nonce"), tree.root());
+  EXPECT_TRUE(tree.GetInclusionProof(0).empty());
+  EXPECT_TRUE(MerkleTree::VerifyInclusionProof("nonce", 0, 1, {}, tree.root()));
+}
+
+TEST(MerkleTreeTest, ThreeLeaves) {
+  // RFC 6962 splits at the largest power of two below the leaf count.
+  MerkleTree tree({"a", "b", "c"});
+  std::string ab = MerkleTree::HashChildren(MerkleTree::HashLeaf("a"),
+                                            MerkleTree::HashLeaf("b"));
+  EXPECT_EQ(MerkleTree::HashChildren(ab, MerkleTree::HashLeaf("c")),
+            tree.root());
+  EXPECT_EQ(std::vector<std::string>({ab}), tree.GetInclusionProof(2));
+}
+
+TEST(MerkleTreeTest, InclusionProofs) {
+  for (size_t count = 1; count <= 17; ++count) {
+    std::vector<std::string> leaves = GetLeaves(count);
+    MerkleTree tree(leaves);
+    for (size_t i = 0; i < count; ++i) {
+      std::vector<std::string> proof = tree.GetInclusionProof(i);
+      EXPECT_TRUE(MerkleTree::VerifyInclusionProof(leaves[i], i, count, proof,
+                                                   tree.root()))
+          << count << " leaves, index " << i;
+    }
+  }
+}
+
+TEST(MerkleTreeTest, BadInclusionProofs) {
+  std::vector<std::string> leaves = GetLeaves(5);
+  MerkleTree tree(leaves);
+  std::vector<std::string> proof = tree.GetInclusionProof(1);
+  EXPECT_FALSE(
+      MerkleTree::VerifyInclusionProof("other", 1, 5, proof, tree.root()));
+  EXPECT_FALSE(
+      MerkleTree::VerifyInclusionProof(leaves[1], 0, 5, proof, tree.root()));
+  EXPECT_FALSE(
+      MerkleTree::VerifyInclusionProof(leaves[1], 1, 4, proof, tree.root()));
+  EXPECT_FALSE(
+      MerkleTree::VerifyInclusionProof(leaves[1], 5, 5, proof, tree.root()));
+  proof.pop_back();
+  EXPECT_FALSE(
+      MerkleTree::VerifyInclusionProof(leaves[1], 1, 5, proof, tree.root()));
+}
+
+}  // namespace attestation
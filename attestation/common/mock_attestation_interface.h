@@ -50,6 +50,15 @@ class MockAttestationInterface : public AttestationInterface {
                     const CreateCertifiableKeyCallback&));
   MOCK_METHOD2(Decrypt, void(const DecryptRequest&, const DecryptCallback&));
   MOCK_METHOD2(Sign, void(const SignRequest&, const SignCallback&));
+  MOCK_METHOD2(DecryptBatch,
+               void(const DecryptBatchRequest&, const DecryptBatchCallback&));
+  MOCK_METHOD2(SignBatch,
+               void(const SignBatchRequest&, const SignBatchCallback&));
+  MOCK_METHOD2(SignAggregated,
+               void(const SignAggregatedRequest&,
+                    const SignAggregatedCallback&));
+  MOCK_METHOD3(SignFile,
+               void(const SignFileRequest&, int, const SignCallback&));
   MOCK_METHOD2(RegisterKeyWithChapsToken,
                void(const RegisterKeyWithChapsTokenRequest&,
                     const RegisterKeyWithChapsTokenCallback&));
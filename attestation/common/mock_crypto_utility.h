@@ -46,6 +46,10 @@ class MockCryptoUtility : public CryptoUtility {
                     std::string* aes_key,
                     std::string* sealed_key));
 
+  MOCK_METHOD2(GetSealedKey,
+               bool(const std::string& encrypted_data,
+                    std::string* sealed_key));
+
   MOCK_METHOD3(DecryptData,
                bool(const std::string& encrypted_data,
                     const std::string& aes_key,
@@ -64,6 +68,7 @@ class MockCryptoUtility : public CryptoUtility {
                bool(const std::string&,
                     const std::string&,
                     const std::string&));
+  MOCK_METHOD2(GetCertificateNotAfter, bool(const std::string&, int64_t*));
 };
 
 }  // namespace attestation
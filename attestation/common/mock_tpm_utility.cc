@@ -70,6 +70,7 @@ MockTpmUtility::MockTpmUtility() {
       .WillByDefault(WithArgs<1, 2>(Invoke(TransformString("Unbind"))));
   ON_CALL(*this, Sign(_, _, _))
       .WillByDefault(WithArgs<1, 2>(Invoke(TransformString("Sign"))));
+  ON_CALL(*this, SignFile(_, _, _)).WillByDefault(Return(true));
 }
 
 MockTpmUtility::~MockTpmUtility() {}
@@ -61,6 +61,7 @@ class MockTpmUtility : public TpmUtility {
                bool(const std::string&, const std::string&, std::string*));
   MOCK_METHOD3(Sign,
                bool(const std::string&, const std::string&, std::string*));
+  MOCK_METHOD3(SignFile, bool(const std::string&, int, std::string*));
 };
 
 }  // namespace attestation
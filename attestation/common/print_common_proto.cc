@@ -18,10 +18,26 @@
 
 #include "attestation/common/print_common_proto.h"
 
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <sstream>
 #include <string>
 
-#include <base/strings/string_number_conversions.h>
-#include <base/strings/stringprintf.h>
+namespace {
+
+void WriteBytes(const std::string& value, bool elide_bytes, std::ostream* out) {
+  if (elide_bytes) {
+    *out << "<" << value.size() << " bytes>";
+    return;
+  }
+  const char kHexDigits[] = "0123456789ABCDEF";
+  for (unsigned char byte : value) {
+    *out << kHexDigits[byte >> 4] << kHexDigits[byte & 0xF];
+  }
+}
+
+}  // namespace
 
 namespace attestation {
 
@@ -30,13 +46,24 @@ std::string GetProtoDebugString(KeyType value) {
 }
 
 std::string GetProtoDebugStringWithIndent(KeyType value, int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(KeyType value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   if (value == KEY_TYPE_RSA) {
-    return "KEY_TYPE_RSA";
+    *out << "KEY_TYPE_RSA";
+    return;
   }
   if (value == KEY_TYPE_ECC) {
-    return "KEY_TYPE_ECC";
+    *out << "KEY_TYPE_ECC";
+    return;
   }
-  return "<unknown>";
+  *out << "<unknown>";
 }
 
 std::string GetProtoDebugString(KeyUsage value) {
@@ -44,13 +71,24 @@ std::string GetProtoDebugString(KeyUsage value) {
 }
 
 std::string GetProtoDebugStringWithIndent(KeyUsage value, int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(KeyUsage value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   if (value == KEY_USAGE_SIGN) {
-    return "KEY_USAGE_SIGN";
+    *out << "KEY_USAGE_SIGN";
+    return;
   }
   if (value == KEY_USAGE_DECRYPT) {
-    return "KEY_USAGE_DECRYPT";
+    *out << "KEY_USAGE_DECRYPT";
+    return;
   }
-  return "<unknown>";
+  *out << "<unknown>";
 }
 
 std::string GetProtoDebugString(CertificateProfile value) {
@@ -59,25 +97,40 @@ std::string GetProtoDebugString(CertificateProfile value) {
 
 std::string GetProtoDebugStringWithIndent(CertificateProfile value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(CertificateProfile value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   if (value == ENTERPRISE_MACHINE_CERTIFICATE) {
-    return "ENTERPRISE_MACHINE_CERTIFICATE";
+    *out << "ENTERPRISE_MACHINE_CERTIFICATE";
+    return;
   }
   if (value == ENTERPRISE_USER_CERTIFICATE) {
-    return "ENTERPRISE_USER_CERTIFICATE";
+    *out << "ENTERPRISE_USER_CERTIFICATE";
+    return;
   }
   if (value == CONTENT_PROTECTION_CERTIFICATE) {
-    return "CONTENT_PROTECTION_CERTIFICATE";
+    *out << "CONTENT_PROTECTION_CERTIFICATE";
+    return;
   }
   if (value == CONTENT_PROTECTION_CERTIFICATE_WITH_STABLE_ID) {
-    return "CONTENT_PROTECTION_CERTIFICATE_WITH_STABLE_ID";
+    *out << "CONTENT_PROTECTION_CERTIFICATE_WITH_STABLE_ID";
+    return;
   }
   if (value == CAST_CERTIFICATE) {
-    return "CAST_CERTIFICATE";
+    *out << "CAST_CERTIFICATE";
+    return;
   }
   if (value == GFSC_CERTIFICATE) {
-    return "GFSC_CERTIFICATE";
+    *out << "GFSC_CERTIFICATE";
+    return;
   }
-  return "<unknown>";
+  *out << "<unknown>";
 }
 
 std::string GetProtoDebugString(const Quote& value) {
@@ -85,43 +138,39 @@ std::string GetProtoDebugString(const Quote& value) {
 }
 
 std::string GetProtoDebugStringWithIndent(const Quote& value, int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const Quote& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_quote()) {
-    output += indent + "  quote: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.quote().data(), value.quote().size()).c_str());
-    output += "\n";
+    *out << indent << "  quote: ";
+    WriteBytes(value.quote(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_quoted_data()) {
-    output += indent + "  quoted_data: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.quoted_data().data(), value.quoted_data().size())
-            .c_str());
-    output += "\n";
+    *out << indent << "  quoted_data: ";
+    WriteBytes(value.quoted_data(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_quoted_pcr_value()) {
-    output += indent + "  quoted_pcr_value: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.quoted_pcr_value().data(),
-                                        value.quoted_pcr_value().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  quoted_pcr_value: ";
+    WriteBytes(value.quoted_pcr_value(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_pcr_source_hint()) {
-    output += indent + "  pcr_source_hint: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.pcr_source_hint().data(),
-                                        value.pcr_source_hint().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  pcr_source_hint: ";
+    WriteBytes(value.pcr_source_hint(), elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const EncryptedData& value) {
@@ -130,50 +179,49 @@ std::string GetProtoDebugString(const EncryptedData& value) {
 
 std::string GetProtoDebugStringWithIndent(const EncryptedData& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const EncryptedData& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_wrapped_key()) {
-    output += indent + "  wrapped_key: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.wrapped_key().data(), value.wrapped_key().size())
-            .c_str());
-    output += "\n";
+    *out << indent << "  wrapped_key: ";
+    WriteBytes(value.wrapped_key(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_iv()) {
-    output += indent + "  iv: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.iv().data(), value.iv().size()).c_str());
-    output += "\n";
+    *out << indent << "  iv: ";
+    WriteBytes(value.iv(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_mac()) {
-    output += indent + "  mac: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.mac().data(), value.mac().size()).c_str());
-    output += "\n";
+    *out << indent << "  mac: ";
+    WriteBytes(value.mac(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_encrypted_data()) {
-    output += indent + "  encrypted_data: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.encrypted_data().data(),
-                                        value.encrypted_data().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  encrypted_data: ";
+    WriteBytes(value.encrypted_data(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_wrapping_key_id()) {
-    output += indent + "  wrapping_key_id: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.wrapping_key_id().data(),
-                                        value.wrapping_key_id().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  wrapping_key_id: ";
+    WriteBytes(value.wrapping_key_id(), elide_bytes, out);
+    *out << "\n";
+  }
+  if (value.has_tag()) {
+    *out << indent << "  tag: ";
+    WriteBytes(value.tag(), elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const SignedData& value) {
@@ -182,26 +230,29 @@ std::string GetProtoDebugString(const SignedData& value) {
 
 std::string GetProtoDebugStringWithIndent(const SignedData& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const SignedData& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_data()) {
-    output += indent + "  data: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.data().data(), value.data().size()).c_str());
-    output += "\n";
+    *out << indent << "  data: ";
+    WriteBytes(value.data(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_signature()) {
-    output += indent + "  signature: ";
-    base::StringAppendF(&output, "%s", base::HexEncode(value.signature().data(),
-                                                       value.signature().size())
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  signature: ";
+    WriteBytes(value.signature(), elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const EncryptedIdentityCredential& value) {
@@ -211,28 +262,29 @@ std::string GetProtoDebugString(const EncryptedIdentityCredential& value) {
 std::string GetProtoDebugStringWithIndent(
     const EncryptedIdentityCredential& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const EncryptedIdentityCredential& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_asym_ca_contents()) {
-    output += indent + "  asym_ca_contents: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.asym_ca_contents().data(),
-                                        value.asym_ca_contents().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  asym_ca_contents: ";
+    WriteBytes(value.asym_ca_contents(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_sym_ca_attestation()) {
-    output += indent + "  sym_ca_attestation: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.sym_ca_attestation().data(),
-                                        value.sym_ca_attestation().size())
-                            .c_str());
-    output += "\n";
-  }
-  output += indent + "}\n";
-  return output;
+    *out << indent << "  sym_ca_attestation: ";
+    WriteBytes(value.sym_ca_attestation(), elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "}\n";
 }
 
 }  // namespace attestation
@@ -19,31 +19,64 @@
 #ifndef ATTESTATION_COMMON_PRINT_COMMON_PROTO_H_
 #define ATTESTATION_COMMON_PRINT_COMMON_PROTO_H_
 
+#include <ostream>
 #include <string>
 
 #include "attestation/common/common.pb.h"
 
 namespace attestation {
 
+// WriteProtoDebugString() writes the text returned by GetProtoDebugString() to
+// |out| without building intermediate strings. If |elide_bytes| is true, bytes
+// fields are written as their size instead of as hex.
+
 std::string GetProtoDebugStringWithIndent(KeyType value, int indent_size);
 std::string GetProtoDebugString(KeyType value);
+void WriteProtoDebugString(KeyType value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(KeyUsage value, int indent_size);
 std::string GetProtoDebugString(KeyUsage value);
+void WriteProtoDebugString(KeyUsage value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(CertificateProfile value,
                                           int indent_size);
 std::string GetProtoDebugString(CertificateProfile value);
+void WriteProtoDebugString(CertificateProfile value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const Quote& value, int indent_size);
 std::string GetProtoDebugString(const Quote& value);
+void WriteProtoDebugString(const Quote& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const EncryptedData& value,
                                           int indent_size);
 std::string GetProtoDebugString(const EncryptedData& value);
+void WriteProtoDebugString(const EncryptedData& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const SignedData& value,
                                           int indent_size);
 std::string GetProtoDebugString(const SignedData& value);
+void WriteProtoDebugString(const SignedData& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const EncryptedIdentityCredential& value,
     int indent_size);
 std::string GetProtoDebugString(const EncryptedIdentityCredential& value);
+void WriteProtoDebugString(const EncryptedIdentityCredential& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 
 }  // namespace attestation
 
@@ -18,13 +18,29 @@
 
 #include "attestation/common/print_interface_proto.h"
 
-#include <string>
+#include <inttypes.h>
+#include <stdio.h>
 
-#include <base/strings/string_number_conversions.h>
-#include <base/strings/stringprintf.h>
+#include <sstream>
+#include <string>
 
 #include "attestation/common/print_common_proto.h"
 
+namespace {
+
+void WriteBytes(const std::string& value, bool elide_bytes, std::ostream* out) {
+  if (elide_bytes) {
+    *out << "<" << value.size() << " bytes>";
+    return;
+  }
+  const char kHexDigits[] = "0123456789ABCDEF";
+  for (unsigned char byte : value) {
+    *out << kHexDigits[byte >> 4] << kHexDigits[byte & 0xF];
+  }
+}
+
+}  // namespace
+
 namespace attestation {
 
 std::string GetProtoDebugString(AttestationStatus value) {
@@ -33,31 +49,78 @@ std::string GetProtoDebugString(AttestationStatus value) {
 
 std::string GetProtoDebugStringWithIndent(AttestationStatus value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(AttestationStatus value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   if (value == STATUS_SUCCESS) {
-    return "STATUS_SUCCESS";
+    *out << "STATUS_SUCCESS";
+    return;
   }
   if (value == STATUS_UNEXPECTED_DEVICE_ERROR) {
-    return "STATUS_UNEXPECTED_DEVICE_ERROR";
+    *out << "STATUS_UNEXPECTED_DEVICE_ERROR";
+    return;
   }
   if (value == STATUS_NOT_AVAILABLE) {
-    return "STATUS_NOT_AVAILABLE";
+    *out << "STATUS_NOT_AVAILABLE";
+    return;
   }
   if (value == STATUS_NOT_READY) {
-    return "STATUS_NOT_READY";
+    *out << "STATUS_NOT_READY";
+    return;
   }
   if (value == STATUS_NOT_ALLOWED) {
-    return "STATUS_NOT_ALLOWED";
+    *out << "STATUS_NOT_ALLOWED";
+    return;
   }
   if (value == STATUS_INVALID_PARAMETER) {
-    return "STATUS_INVALID_PARAMETER";
+    *out << "STATUS_INVALID_PARAMETER";
+    return;
   }
   if (value == STATUS_REQUEST_DENIED_BY_CA) {
-    return "STATUS_REQUEST_DENIED_BY_CA";
+    *out << "STATUS_REQUEST_DENIED_BY_CA";
+    return;
   }
   if (value == STATUS_CA_NOT_AVAILABLE) {
-    return "STATUS_CA_NOT_AVAILABLE";
+    *out << "STATUS_CA_NOT_AVAILABLE";
+    return;
+  }
+  *out << "<unknown>";
+}
+
+std::string GetProtoDebugString(KeyInfoField value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(KeyInfoField value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(KeyInfoField value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  if (value == KEY_INFO_PUBLIC_KEY) {
+    *out << "KEY_INFO_PUBLIC_KEY";
+    return;
+  }
+  if (value == KEY_INFO_CERTIFY_INFO) {
+    *out << "KEY_INFO_CERTIFY_INFO";
+    return;
+  }
+  if (value == KEY_INFO_CERTIFICATE) {
+    *out << "KEY_INFO_CERTIFICATE";
+    return;
   }
-  return "<unknown>";
+  *out << "<unknown>";
 }
 
 std::string GetProtoDebugString(const CreateGoogleAttestedKeyRequest& value) {
@@ -67,49 +130,50 @@ std::string GetProtoDebugString(const CreateGoogleAttestedKeyRequest& value) {
 std::string GetProtoDebugStringWithIndent(
     const CreateGoogleAttestedKeyRequest& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const CreateGoogleAttestedKeyRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_key_label()) {
-    output += indent + "  key_label: ";
-    base::StringAppendF(&output, "%s", value.key_label().c_str());
-    output += "\n";
+    *out << indent << "  key_label: ";
+    *out << value.key_label();
+    *out << "\n";
   }
   if (value.has_key_type()) {
-    output += indent + "  key_type: ";
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.key_type(), indent_size + 2)
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  key_type: ";
+    WriteProtoDebugString(value.key_type(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_key_usage()) {
-    output += indent + "  key_usage: ";
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.key_usage(), indent_size + 2)
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  key_usage: ";
+    WriteProtoDebugString(value.key_usage(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_certificate_profile()) {
-    output += indent + "  certificate_profile: ";
-    base::StringAppendF(&output, "%s",
-                        GetProtoDebugStringWithIndent(
-                            value.certificate_profile(), indent_size + 2)
-                            .c_str());
-    output += "\n";
+    *out << indent << "  certificate_profile: ";
+    WriteProtoDebugString(value.certificate_profile(), indent_size + 2,
+                          elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_username()) {
-    output += indent + "  username: ";
-    base::StringAppendF(&output, "%s", value.username().c_str());
-    output += "\n";
+    *out << indent << "  username: ";
+    *out << value.username();
+    *out << "\n";
   }
   if (value.has_origin()) {
-    output += indent + "  origin: ";
-    base::StringAppendF(&output, "%s", value.origin().c_str());
-    output += "\n";
+    *out << indent << "  origin: ";
+    *out << value.origin();
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const CreateGoogleAttestedKeyReply& value) {
@@ -119,29 +183,34 @@ std::string GetProtoDebugString(const CreateGoogleAttestedKeyReply& value) {
 std::string GetProtoDebugStringWithIndent(
     const CreateGoogleAttestedKeyReply& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const CreateGoogleAttestedKeyReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_status()) {
-    output += indent + "  status: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.status(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_server_error()) {
-    output += indent + "  server_error: ";
-    base::StringAppendF(&output, "%s", value.server_error().c_str());
-    output += "\n";
+    *out << indent << "  server_error: ";
+    *out << value.server_error();
+    *out << "\n";
   }
   if (value.has_certificate_chain()) {
-    output += indent + "  certificate_chain: ";
-    base::StringAppendF(&output, "%s", value.certificate_chain().c_str());
-    output += "\n";
+    *out << indent << "  certificate_chain: ";
+    *out << value.certificate_chain();
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const GetKeyInfoRequest& value) {
@@ -150,22 +219,34 @@ std::string GetProtoDebugString(const GetKeyInfoRequest& value) {
 
 std::string GetProtoDebugStringWithIndent(const GetKeyInfoRequest& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const GetKeyInfoRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_key_label()) {
-    output += indent + "  key_label: ";
-    base::StringAppendF(&output, "%s", value.key_label().c_str());
-    output += "\n";
+    *out << indent << "  key_label: ";
+    *out << value.key_label();
+    *out << "\n";
   }
   if (value.has_username()) {
-    output += indent + "  username: ";
-    base::StringAppendF(&output, "%s", value.username().c_str());
-    output += "\n";
+    *out << indent << "  username: ";
+    *out << value.username();
+    *out << "\n";
+  }
+  if (value.has_field_mask()) {
+    *out << indent << "  field_mask: ";
+    *out << value.field_mask();
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const GetKeyInfoReply& value) {
@@ -174,65 +255,54 @@ std::string GetProtoDebugString(const GetKeyInfoReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const GetKeyInfoReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const GetKeyInfoReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_status()) {
-    output += indent + "  status: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.status(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_key_type()) {
-    output += indent + "  key_type: ";
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.key_type(), indent_size + 2)
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  key_type: ";
+    WriteProtoDebugString(value.key_type(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_key_usage()) {
-    output += indent + "  key_usage: ";
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.key_usage(), indent_size + 2)
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  key_usage: ";
+    WriteProtoDebugString(value.key_usage(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_public_key()) {
-    output += indent + "  public_key: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.public_key().data(), value.public_key().size())
-            .c_str());
-    output += "\n";
+    *out << indent << "  public_key: ";
+    WriteBytes(value.public_key(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_certify_info()) {
-    output += indent + "  certify_info: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.certify_info().data(),
-                                        value.certify_info().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  certify_info: ";
+    WriteBytes(value.certify_info(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_certify_info_signature()) {
-    output += indent + "  certify_info_signature: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.certify_info_signature().data(),
-                                        value.certify_info_signature().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  certify_info_signature: ";
+    WriteBytes(value.certify_info_signature(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_certificate()) {
-    output += indent + "  certificate: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.certificate().data(), value.certificate().size())
-            .c_str());
-    output += "\n";
+    *out << indent << "  certificate: ";
+    WriteBytes(value.certificate(), elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const GetEndorsementInfoRequest& value) {
@@ -242,19 +312,24 @@ std::string GetProtoDebugString(const GetEndorsementInfoRequest& value) {
 std::string GetProtoDebugStringWithIndent(
     const GetEndorsementInfoRequest& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const GetEndorsementInfoRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_key_type()) {
-    output += indent + "  key_type: ";
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.key_type(), indent_size + 2)
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  key_type: ";
+    WriteProtoDebugString(value.key_type(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const GetEndorsementInfoReply& value) {
@@ -263,35 +338,34 @@ std::string GetProtoDebugString(const GetEndorsementInfoReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const GetEndorsementInfoReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const GetEndorsementInfoReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_status()) {
-    output += indent + "  status: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.status(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_ek_public_key()) {
-    output += indent + "  ek_public_key: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.ek_public_key().data(),
-                                        value.ek_public_key().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  ek_public_key: ";
+    WriteBytes(value.ek_public_key(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_ek_certificate()) {
-    output += indent + "  ek_certificate: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.ek_certificate().data(),
-                                        value.ek_certificate().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  ek_certificate: ";
+    WriteBytes(value.ek_certificate(), elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const GetAttestationKeyInfoRequest& value) {
@@ -301,19 +375,24 @@ std::string GetProtoDebugString(const GetAttestationKeyInfoRequest& value) {
 std::string GetProtoDebugStringWithIndent(
     const GetAttestationKeyInfoRequest& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const GetAttestationKeyInfoRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_key_type()) {
-    output += indent + "  key_type: ";
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.key_type(), indent_size + 2)
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  key_type: ";
+    WriteProtoDebugString(value.key_type(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const GetAttestationKeyInfoReply& value) {
@@ -323,57 +402,51 @@ std::string GetProtoDebugString(const GetAttestationKeyInfoReply& value) {
 std::string GetProtoDebugStringWithIndent(
     const GetAttestationKeyInfoReply& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const GetAttestationKeyInfoReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_status()) {
-    output += indent + "  status: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.status(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_public_key()) {
-    output += indent + "  public_key: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.public_key().data(), value.public_key().size())
-            .c_str());
-    output += "\n";
+    *out << indent << "  public_key: ";
+    WriteBytes(value.public_key(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_public_key_tpm_format()) {
-    output += indent + "  public_key_tpm_format: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.public_key_tpm_format().data(),
-                                        value.public_key_tpm_format().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  public_key_tpm_format: ";
+    WriteBytes(value.public_key_tpm_format(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_certificate()) {
-    output += indent + "  certificate: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.certificate().data(), value.certificate().size())
-            .c_str());
-    output += "\n";
+    *out << indent << "  certificate: ";
+    WriteBytes(value.certificate(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_pcr0_quote()) {
-    output += indent + "  pcr0_quote: ";
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.pcr0_quote(), indent_size + 2)
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  pcr0_quote: ";
+    WriteProtoDebugString(value.pcr0_quote(), indent_size + 2, elide_bytes,
+                          out);
+    *out << "\n";
   }
   if (value.has_pcr1_quote()) {
-    output += indent + "  pcr1_quote: ";
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.pcr1_quote(), indent_size + 2)
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  pcr1_quote: ";
+    WriteProtoDebugString(value.pcr1_quote(), indent_size + 2, elide_bytes,
+                          out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const ActivateAttestationKeyRequest& value) {
@@ -383,33 +456,35 @@ std::string GetProtoDebugString(const ActivateAttestationKeyRequest& value) {
 std::string GetProtoDebugStringWithIndent(
     const ActivateAttestationKeyRequest& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const ActivateAttestationKeyRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_key_type()) {
-    output += indent + "  key_type: ";
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.key_type(), indent_size + 2)
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  key_type: ";
+    WriteProtoDebugString(value.key_type(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_encrypted_certificate()) {
-    output += indent + "  encrypted_certificate: ";
-    base::StringAppendF(&output, "%s",
-                        GetProtoDebugStringWithIndent(
-                            value.encrypted_certificate(), indent_size + 2)
-                            .c_str());
-    output += "\n";
+    *out << indent << "  encrypted_certificate: ";
+    WriteProtoDebugString(value.encrypted_certificate(), indent_size + 2,
+                          elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_save_certificate()) {
-    output += indent + "  save_certificate: ";
-    base::StringAppendF(&output, "%s",
-                        value.save_certificate() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  save_certificate: ";
+    *out << (value.save_certificate() ? "true" : "false");
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const ActivateAttestationKeyReply& value) {
@@ -419,27 +494,29 @@ std::string GetProtoDebugString(const ActivateAttestationKeyReply& value) {
 std::string GetProtoDebugStringWithIndent(
     const ActivateAttestationKeyReply& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const ActivateAttestationKeyReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_status()) {
-    output += indent + "  status: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.status(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_certificate()) {
-    output += indent + "  certificate: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.certificate().data(), value.certificate().size())
-            .c_str());
-    output += "\n";
+    *out << indent << "  certificate: ";
+    WriteBytes(value.certificate(), elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const CreateCertifiableKeyRequest& value) {
@@ -449,36 +526,39 @@ std::string GetProtoDebugString(const CreateCertifiableKeyRequest& value) {
 std::string GetProtoDebugStringWithIndent(
     const CreateCertifiableKeyRequest& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const CreateCertifiableKeyRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_key_label()) {
-    output += indent + "  key_label: ";
-    base::StringAppendF(&output, "%s", value.key_label().c_str());
-    output += "\n";
+    *out << indent << "  key_label: ";
+    *out << value.key_label();
+    *out << "\n";
   }
   if (value.has_username()) {
-    output += indent + "  username: ";
-    base::StringAppendF(&output, "%s", value.username().c_str());
-    output += "\n";
+    *out << indent << "  username: ";
+    *out << value.username();
+    *out << "\n";
   }
   if (value.has_key_type()) {
-    output += indent + "  key_type: ";
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.key_type(), indent_size + 2)
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  key_type: ";
+    WriteProtoDebugString(value.key_type(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_key_usage()) {
-    output += indent + "  key_usage: ";
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.key_usage(), indent_size + 2)
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  key_usage: ";
+    WriteProtoDebugString(value.key_usage(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const CreateCertifiableKeyReply& value) {
@@ -488,43 +568,39 @@ std::string GetProtoDebugString(const CreateCertifiableKeyReply& value) {
 std::string GetProtoDebugStringWithIndent(
     const CreateCertifiableKeyReply& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const CreateCertifiableKeyReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_status()) {
-    output += indent + "  status: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.status(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_public_key()) {
-    output += indent + "  public_key: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.public_key().data(), value.public_key().size())
-            .c_str());
-    output += "\n";
+    *out << indent << "  public_key: ";
+    WriteBytes(value.public_key(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_certify_info()) {
-    output += indent + "  certify_info: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.certify_info().data(),
-                                        value.certify_info().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  certify_info: ";
+    WriteBytes(value.certify_info(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_certify_info_signature()) {
-    output += indent + "  certify_info_signature: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.certify_info_signature().data(),
-                                        value.certify_info_signature().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  certify_info_signature: ";
+    WriteBytes(value.certify_info_signature(), elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const DecryptRequest& value) {
@@ -533,30 +609,34 @@ std::string GetProtoDebugString(const DecryptRequest& value) {
 
 std::string GetProtoDebugStringWithIndent(const DecryptRequest& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const DecryptRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_key_label()) {
-    output += indent + "  key_label: ";
-    base::StringAppendF(&output, "%s", value.key_label().c_str());
-    output += "\n";
+    *out << indent << "  key_label: ";
+    *out << value.key_label();
+    *out << "\n";
   }
   if (value.has_username()) {
-    output += indent + "  username: ";
-    base::StringAppendF(&output, "%s", value.username().c_str());
-    output += "\n";
+    *out << indent << "  username: ";
+    *out << value.username();
+    *out << "\n";
   }
   if (value.has_encrypted_data()) {
-    output += indent + "  encrypted_data: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.encrypted_data().data(),
-                                        value.encrypted_data().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  encrypted_data: ";
+    WriteBytes(value.encrypted_data(), elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const DecryptReply& value) {
@@ -565,27 +645,29 @@ std::string GetProtoDebugString(const DecryptReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const DecryptReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const DecryptReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_status()) {
-    output += indent + "  status: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.status(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_decrypted_data()) {
-    output += indent + "  decrypted_data: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.decrypted_data().data(),
-                                        value.decrypted_data().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  decrypted_data: ";
+    WriteBytes(value.decrypted_data(), elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const SignRequest& value) {
@@ -594,30 +676,34 @@ std::string GetProtoDebugString(const SignRequest& value) {
 
 std::string GetProtoDebugStringWithIndent(const SignRequest& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const SignRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_key_label()) {
-    output += indent + "  key_label: ";
-    base::StringAppendF(&output, "%s", value.key_label().c_str());
-    output += "\n";
+    *out << indent << "  key_label: ";
+    *out << value.key_label();
+    *out << "\n";
   }
   if (value.has_username()) {
-    output += indent + "  username: ";
-    base::StringAppendF(&output, "%s", value.username().c_str());
-    output += "\n";
+    *out << indent << "  username: ";
+    *out << value.username();
+    *out << "\n";
   }
   if (value.has_data_to_sign()) {
-    output += indent + "  data_to_sign: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.data_to_sign().data(),
-                                        value.data_to_sign().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  data_to_sign: ";
+    WriteBytes(value.data_to_sign(), elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const SignReply& value) {
@@ -626,26 +712,296 @@ std::string GetProtoDebugString(const SignReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const SignReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const SignReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  if (value.has_status()) {
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
+  }
+  if (value.has_signature()) {
+    *out << indent << "  signature: ";
+    WriteBytes(value.signature(), elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const DecryptBatchRequest& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const DecryptBatchRequest& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const DecryptBatchRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  if (value.has_key_label()) {
+    *out << indent << "  key_label: ";
+    *out << value.key_label();
+    *out << "\n";
+  }
+  if (value.has_username()) {
+    *out << indent << "  username: ";
+    *out << value.username();
+    *out << "\n";
+  }
+  *out << indent << "  encrypted_data: {";
+  for (int i = 0; i < value.encrypted_data_size(); ++i) {
+    if (i > 0) {
+      *out << ", ";
+    }
+    WriteBytes(value.encrypted_data(i), elide_bytes, out);
+  }
+  *out << "}\n";
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const DecryptBatchReply& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const DecryptBatchReply& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const DecryptBatchReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_status()) {
-    output += indent + "  status: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.status(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "  decrypted_data: {";
+  for (int i = 0; i < value.decrypted_data_size(); ++i) {
+    if (i > 0) {
+      *out << ", ";
+    }
+    WriteBytes(value.decrypted_data(i), elide_bytes, out);
+  }
+  *out << "}\n";
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const SignBatchRequest& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const SignBatchRequest& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const SignBatchRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  if (value.has_key_label()) {
+    *out << indent << "  key_label: ";
+    *out << value.key_label();
+    *out << "\n";
+  }
+  if (value.has_username()) {
+    *out << indent << "  username: ";
+    *out << value.username();
+    *out << "\n";
+  }
+  *out << indent << "  data_to_sign: {";
+  for (int i = 0; i < value.data_to_sign_size(); ++i) {
+    if (i > 0) {
+      *out << ", ";
+    }
+    WriteBytes(value.data_to_sign(i), elide_bytes, out);
+  }
+  *out << "}\n";
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const SignBatchReply& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const SignBatchReply& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const SignBatchReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  if (value.has_status()) {
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "  signature: {";
+  for (int i = 0; i < value.signature_size(); ++i) {
+    if (i > 0) {
+      *out << ", ";
+    }
+    WriteBytes(value.signature(i), elide_bytes, out);
+  }
+  *out << "}\n";
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const SignAggregatedRequest& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const SignAggregatedRequest& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const SignAggregatedRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  if (value.has_key_label()) {
+    *out << indent << "  key_label: ";
+    *out << value.key_label();
+    *out << "\n";
+  }
+  if (value.has_username()) {
+    *out << indent << "  username: ";
+    *out << value.username();
+    *out << "\n";
+  }
+  if (value.has_nonce()) {
+    *out << indent << "  nonce: ";
+    WriteBytes(value.nonce(), elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const SignAggregatedReply& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const SignAggregatedReply& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const SignAggregatedReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  if (value.has_status()) {
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_signature()) {
-    output += indent + "  signature: ";
-    base::StringAppendF(&output, "%s", base::HexEncode(value.signature().data(),
-                                                       value.signature().size())
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  signature: ";
+    WriteBytes(value.signature(), elide_bytes, out);
+    *out << "\n";
+  }
+  if (value.has_merkle_root()) {
+    *out << indent << "  merkle_root: ";
+    WriteBytes(value.merkle_root(), elide_bytes, out);
+    *out << "\n";
+  }
+  if (value.has_leaf_index()) {
+    *out << indent << "  leaf_index: ";
+    *out << value.leaf_index();
+    *out << "\n";
+  }
+  if (value.has_leaf_count()) {
+    *out << indent << "  leaf_count: ";
+    *out << value.leaf_count();
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "  inclusion_proof: {";
+  for (int i = 0; i < value.inclusion_proof_size(); ++i) {
+    if (i > 0) {
+      *out << ", ";
+    }
+    WriteBytes(value.inclusion_proof(i), elide_bytes, out);
+  }
+  *out << "}\n";
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const SignFileRequest& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const SignFileRequest& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const SignFileRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  if (value.has_key_label()) {
+    *out << indent << "  key_label: ";
+    *out << value.key_label();
+    *out << "\n";
+  }
+  if (value.has_username()) {
+    *out << indent << "  username: ";
+    *out << value.username();
+    *out << "\n";
+  }
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const RegisterKeyWithChapsTokenRequest& value) {
@@ -655,22 +1011,29 @@ std::string GetProtoDebugString(const RegisterKeyWithChapsTokenRequest& value) {
 std::string GetProtoDebugStringWithIndent(
     const RegisterKeyWithChapsTokenRequest& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const RegisterKeyWithChapsTokenRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_key_label()) {
-    output += indent + "  key_label: ";
-    base::StringAppendF(&output, "%s", value.key_label().c_str());
-    output += "\n";
+    *out << indent << "  key_label: ";
+    *out << value.key_label();
+    *out << "\n";
   }
   if (value.has_username()) {
-    output += indent + "  username: ";
-    base::StringAppendF(&output, "%s", value.username().c_str());
-    output += "\n";
+    *out << indent << "  username: ";
+    *out << value.username();
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const RegisterKeyWithChapsTokenReply& value) {
@@ -680,19 +1043,24 @@ std::string GetProtoDebugString(const RegisterKeyWithChapsTokenReply& value) {
 std::string GetProtoDebugStringWithIndent(
     const RegisterKeyWithChapsTokenReply& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const RegisterKeyWithChapsTokenReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_status()) {
-    output += indent + "  status: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.status(), indent_size + 2).c_str());
-    output += "\n";
-  }
-  output += indent + "}\n";
-  return output;
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "}\n";
 }
 
 }  // namespace attestation
@@ -19,80 +19,217 @@
 #ifndef ATTESTATION_COMMON_PRINT_INTERFACE_PROTO_H_
 #define ATTESTATION_COMMON_PRINT_INTERFACE_PROTO_H_
 
+#include <ostream>
 #include <string>
 
 #include "attestation/common/interface.pb.h"
 
 namespace attestation {
 
+// WriteProtoDebugString() writes the text returned by GetProtoDebugString() to
+// |out| without building intermediate strings. If |elide_bytes| is true, bytes
+// fields are written as their size instead of as hex.
+
 std::string GetProtoDebugStringWithIndent(AttestationStatus value,
                                           int indent_size);
 std::string GetProtoDebugString(AttestationStatus value);
+void WriteProtoDebugString(AttestationStatus value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(KeyInfoField value,
+                                          int indent_size);
+std::string GetProtoDebugString(KeyInfoField value);
+void WriteProtoDebugString(KeyInfoField value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const CreateGoogleAttestedKeyRequest& value,
     int indent_size);
 std::string GetProtoDebugString(const CreateGoogleAttestedKeyRequest& value);
+void WriteProtoDebugString(const CreateGoogleAttestedKeyRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const CreateGoogleAttestedKeyReply& value,
     int indent_size);
 std::string GetProtoDebugString(const CreateGoogleAttestedKeyReply& value);
+void WriteProtoDebugString(const CreateGoogleAttestedKeyReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const GetKeyInfoRequest& value,
                                           int indent_size);
 std::string GetProtoDebugString(const GetKeyInfoRequest& value);
+void WriteProtoDebugString(const GetKeyInfoRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const GetKeyInfoReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const GetKeyInfoReply& value);
+void WriteProtoDebugString(const GetKeyInfoReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const GetEndorsementInfoRequest& value,
     int indent_size);
 std::string GetProtoDebugString(const GetEndorsementInfoRequest& value);
+void WriteProtoDebugString(const GetEndorsementInfoRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const GetEndorsementInfoReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const GetEndorsementInfoReply& value);
+void WriteProtoDebugString(const GetEndorsementInfoReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const GetAttestationKeyInfoRequest& value,
     int indent_size);
 std::string GetProtoDebugString(const GetAttestationKeyInfoRequest& value);
+void WriteProtoDebugString(const GetAttestationKeyInfoRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const GetAttestationKeyInfoReply& value,
     int indent_size);
 std::string GetProtoDebugString(const GetAttestationKeyInfoReply& value);
+void WriteProtoDebugString(const GetAttestationKeyInfoReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const ActivateAttestationKeyRequest& value,
     int indent_size);
 std::string GetProtoDebugString(const ActivateAttestationKeyRequest& value);
+void WriteProtoDebugString(const ActivateAttestationKeyRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const ActivateAttestationKeyReply& value,
     int indent_size);
 std::string GetProtoDebugString(const ActivateAttestationKeyReply& value);
+void WriteProtoDebugString(const ActivateAttestationKeyReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const CreateCertifiableKeyRequest& value,
     int indent_size);
 std::string GetProtoDebugString(const CreateCertifiableKeyRequest& value);
+void WriteProtoDebugString(const CreateCertifiableKeyRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const CreateCertifiableKeyReply& value,
     int indent_size);
 std::string GetProtoDebugString(const CreateCertifiableKeyReply& value);
+void WriteProtoDebugString(const CreateCertifiableKeyReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const DecryptRequest& value,
                                           int indent_size);
 std::string GetProtoDebugString(const DecryptRequest& value);
+void WriteProtoDebugString(const DecryptRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const DecryptReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const DecryptReply& value);
+void WriteProtoDebugString(const DecryptReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const SignRequest& value,
                                           int indent_size);
 std::string GetProtoDebugString(const SignRequest& value);
+void WriteProtoDebugString(const SignRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const SignReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const SignReply& value);
+void WriteProtoDebugString(const SignReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const DecryptBatchRequest& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const DecryptBatchRequest& value);
+void WriteProtoDebugString(const DecryptBatchRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const DecryptBatchReply& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const DecryptBatchReply& value);
+void WriteProtoDebugString(const DecryptBatchReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const SignBatchRequest& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const SignBatchRequest& value);
+void WriteProtoDebugString(const SignBatchRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const SignBatchReply& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const SignBatchReply& value);
+void WriteProtoDebugString(const SignBatchReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const SignAggregatedRequest& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const SignAggregatedRequest& value);
+void WriteProtoDebugString(const SignAggregatedRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const SignAggregatedReply& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const SignAggregatedReply& value);
+void WriteProtoDebugString(const SignAggregatedReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const SignFileRequest& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const SignFileRequest& value);
+void WriteProtoDebugString(const SignFileRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const RegisterKeyWithChapsTokenRequest& value,
     int indent_size);
 std::string GetProtoDebugString(const RegisterKeyWithChapsTokenRequest& value);
+void WriteProtoDebugString(const RegisterKeyWithChapsTokenRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const RegisterKeyWithChapsTokenReply& value,
     int indent_size);
 std::string GetProtoDebugString(const RegisterKeyWithChapsTokenReply& value);
+void WriteProtoDebugString(const RegisterKeyWithChapsTokenReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 
 }  // namespace attestation
 
@@ -23,6 +23,10 @@ this is not available when using only MessageLite. This script generates code to
 emulate Message::DebugString() without using reflection. The input must be a
 valid .proto file.
 
+For each type the generated code writes the text to a std::ostream with
+WriteProtoDebugString(), which can optionally elide bytes fields, and wraps it in
+GetProtoDebugString() for callers which want a std::string.
+
 Usage: proto_print.py [--subdir=foo] <bar.proto>
 
 Files named print_bar_proto.h and print_bar_proto.cc will be created in the
@@ -178,14 +182,56 @@ def ParseProto(input_file):
   return package, imports, messages, enums
 
 
-def GenerateFileHeaders(proto_name, package, imports, subdir, header_file_name,
-                        header_file, impl_file):
+def GenerateHelpers(messages):
+  """Generates the file local helpers needed to print |messages|.
+
+  Args:
+    messages: A list of Message instances.
+
+  Returns:
+    The helper definitions, or an empty string if none are needed.
+  """
+  unsigned_helper = """
+// Writes |value| in decimal and in hex, zero-padded to |hex_digits|.
+void WriteUnsigned(uint64_t value, int hex_digits, std::ostream* out) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%" PRIu64 " (0x%0*" PRIX64 ")", value,
+           hex_digits, value);
+  *out << buffer;
+}
+"""
+  bytes_helper = """
+void WriteBytes(const std::string& value, bool elide_bytes, std::ostream* out) {
+  if (elide_bytes) {
+    *out << "<" << value.size() << " bytes>";
+    return;
+  }
+  const char kHexDigits[] = "0123456789ABCDEF";
+  for (unsigned char byte : value) {
+    *out << kHexDigits[byte >> 4] << kHexDigits[byte & 0xF];
+  }
+}
+"""
+  types = set(field.type_ for message in messages for field in message.fields)
+  helpers = ''
+  if types & set(['uint32', 'uint64']):
+    helpers += unsigned_helper
+  if 'bytes' in types:
+    helpers += bytes_helper
+  if not helpers:
+    return ''
+  return '\nnamespace {\n%s\n}  // namespace\n' % helpers
+
+
+def GenerateFileHeaders(proto_name, package, imports, messages, subdir,
+                        header_file_name, header_file, impl_file):
   """Generates and prints file headers.
 
   Args:
     proto_name: The name of the proto file.
     package: The protobuf package.
     imports: A list of imported protos.
+    messages: A list of Message objects.
     subdir: The --subdir arg.
     header_file_name: The header file name.
     header_file: The header file handle, open for writing.
@@ -213,11 +259,16 @@ def GenerateFileHeaders(proto_name, package, imports, subdir, header_file_name,
 #ifndef %(guard_name)s
 #define %(guard_name)s
 
+#include <ostream>
 #include <string>
 
 #include "%(package_with_subdir)s/%(proto)s.pb.h"
 
 namespace %(package)s {
+
+// WriteProtoDebugString() writes the text returned by GetProtoDebugString() to
+// |out| without building intermediate strings. If |elide_bytes| is true, bytes
+// fields are written as their size instead of as hex.
 """ % {'year': date.today().year,
        'guard_name': guard_name,
        'package': package,
@@ -232,19 +283,21 @@ namespace %(package)s {
 
 #include "%(package_with_subdir)s/%(header_file_name)s"
 
-#include <string>
+#include <inttypes.h>
+#include <stdio.h>
 
-#include <base/strings/string_number_conversions.h>
-#include <base/strings/stringprintf.h>
+#include <sstream>
+#include <string>
 
 %(includes)s
-
+%(helpers)s
 namespace %(package)s {
 """ % {'year': date.today().year,
        'package': package,
        'package_with_subdir': package_with_subdir,
        'header_file_name': header_file_name,
-       'includes': includes}
+       'includes': includes,
+       'helpers': GenerateHelpers(messages)}
 
   header_file.write(header)
   impl_file.write(impl)
@@ -290,21 +343,35 @@ def GenerateEnumPrinter(enum, header_file, impl_file):
   """
   declare = """
 std::string GetProtoDebugStringWithIndent(%(name)s value, int indent_size);
-std::string GetProtoDebugString(%(name)s value);""" % {'name': enum.name}
+std::string GetProtoDebugString(%(name)s value);
+void WriteProtoDebugString(%(name)s value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);""" % {'name': enum.name}
   define_begin = """
 std::string GetProtoDebugString(%(name)s value) {
   return GetProtoDebugStringWithIndent(value, 0);
 }
 
 std::string GetProtoDebugStringWithIndent(%(name)s value, int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(%(name)s value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
 """ % {'name': enum.name}
   define_end = """
-  return "<unknown>";
+  *out << "<unknown>";
 }
 """
   condition = """
   if (value == %(value_name)s) {
-    return "%(value_name)s";
+    *out << "%(value_name)s";
+    return;
   }"""
 
   header_file.write(declare)
@@ -325,8 +392,11 @@ def GenerateMessagePrinter(message, header_file, impl_file):
   declare = """
 std::string GetProtoDebugStringWithIndent(const %(name)s& value,
                                           int indent_size);
-std::string GetProtoDebugString(const %(name)s& value);""" % {'name':
-                                                              message.name}
+std::string GetProtoDebugString(const %(name)s& value);
+void WriteProtoDebugString(const %(name)s& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);""" % {'name': message.name}
   define_begin = """
 std::string GetProtoDebugString(const %(name)s& value) {
   return GetProtoDebugStringWithIndent(value, 0);
@@ -334,42 +404,48 @@ std::string GetProtoDebugString(const %(name)s& value) {
 
 std::string GetProtoDebugStringWithIndent(const %(name)s& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const %(name)s& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output = base::StringPrintf("[%%s] {\\n",
-                                          value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\\n";
 """ % {'name': message.name}
   define_end = """
-  output += indent + "}\\n";
-  return output;
+  *out << indent << "}\\n";
 }
 """
   singular_field = """
   if (value.has_%(name)s()) {
-    output += indent + "  %(name)s: ";
-    base::StringAppendF(&output, %(format)s);
-    output += "\\n";
+    *out << indent << "  %(name)s: ";
+    %(write)s;
+    *out << "\\n";
   }"""
   repeated_field = """
-  output += indent + "  %(name)s: {";
+  *out << indent << "  %(name)s: {";
   for (int i = 0; i < value.%(name)s_size(); ++i) {
     if (i > 0) {
-      base::StringAppendF(&output, ", ");
+      *out << ", ";
     }
-    base::StringAppendF(&output, %(format)s);
+    %(write)s;
   }
-  output += "}\\n";"""
+  *out << "}\\n";"""
   singular_field_get = 'value.%(name)s()'
   repeated_field_get = 'value.%(name)s(i)'
-  formats = {'bool': '"%%s", %(value)s ? "true" : "false"',
-             'int32': '"%%d", %(value)s',
-             'int64': '"%%ld", %(value)s',
-             'uint32': '"%%u (0x%%08X)", %(value)s, %(value)s',
-             'uint64': '"%%lu (0x%%016X)", %(value)s, %(value)s',
-             'string': '"%%s", %(value)s.c_str()',
-             'bytes': """"%%s", base::HexEncode(%(value)s.data(),
-                                                %(value)s.size()).c_str()"""}
-  subtype_format = ('"%%s", GetProtoDebugStringWithIndent(%(value)s, '
-                    'indent_size + 2).c_str()')
+  formats = {'bool': '*out << (%(value)s ? "true" : "false")',
+             'int32': '*out << %(value)s',
+             'int64': '*out << %(value)s',
+             'uint32': 'WriteUnsigned(%(value)s, 8, out)',
+             'uint64': 'WriteUnsigned(%(value)s, 16, out)',
+             'string': '*out << %(value)s',
+             'bytes': 'WriteBytes(%(value)s, elide_bytes, out)'}
+  subtype_format = ('WriteProtoDebugString(%(value)s, indent_size + 2, '
+                    'elide_bytes, out)')
 
   header_file.write(declare)
   impl_file.write(define_begin)
@@ -385,7 +461,7 @@ std::string GetProtoDebugStringWithIndent(const %(name)s& value,
     else:
       value_format = subtype_format % {'value': value_get}
     impl_file.write(field_code % {'name': field.name,
-                                  'format': value_format})
+                                  'write': value_format})
   impl_file.write(define_end)
 
 
@@ -405,7 +481,7 @@ def main():
   impl_file_name = 'print_%s_proto.cc' % proto_name
   with open(header_file_name, 'w') as header_file:
     with open(impl_file_name, 'w') as impl_file:
-      GenerateFileHeaders(proto_name, package, imports, args.subdir,
+      GenerateFileHeaders(proto_name, package, imports, messages, args.subdir,
                           header_file_name, header_file, impl_file)
       for enum in enums:
         GenerateEnumPrinter(enum, header_file, impl_file)
@@ -90,6 +90,13 @@ class TpmUtility {
   virtual bool Sign(const std::string& key_blob,
                     const std::string& data_to_sign,
                     std::string* signature) = 0;
+
+  // Like Sign, but signs the contents of the file open at |fd|. The file is
+  // memory-mapped and hashed in place rather than read into a string. |fd| is
+  // not closed.
+  virtual bool SignFile(const std::string& key_blob,
+                        int fd,
+                        std::string* signature) = 0;
 };
 
 }  // namespace attestation
@@ -16,11 +16,19 @@
 
 #include "attestation/common/tpm_utility_v1.h"
 
+#include <fcntl.h>
+
+#include <utility>
+
+#include <base/files/file.h>
 #include <base/files/file_path.h>
 #include <base/files/file_util.h>
+#include <base/files/memory_mapped_file.h>
 #include <base/logging.h>
 #include <base/memory/scoped_ptr.h>
+#include <base/posix/eintr_wrapper.h>
 #include <base/stl_util.h>
+#include <base/strings/string_piece.h>
 #include <crypto/scoped_openssl_types.h>
 #include <crypto/sha2.h>
 #include <openssl/rsa.h>
@@ -37,6 +45,7 @@ using trousers::ScopedTssContext;
 using trousers::ScopedTssKey;
 using trousers::ScopedTssMemory;
 using trousers::ScopedTssPcrs;
+using trousers::ScopedTssPolicy;
 
 namespace {
 
@@ -52,6 +61,9 @@ const unsigned int kWellKnownExponent = 65537;
 const unsigned char kSha256DigestInfo[] = {
     0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01,
     0x65, 0x03, 0x04, 0x02, 0x01, 0x05, 0x00, 0x04, 0x20};
+// The number of keys kept loaded besides the SRK. This covers the identity
+// key and a few certified keys; tcsd swaps them out of the TPM as needed.
+const size_t kMaxLoadedKeys = 4;
 
 std::string GetFirstByte(const char* file_name) {
   std::string content;
@@ -70,6 +82,18 @@ std::string TSSBufferAsString(const BYTE* buffer, size_t length) {
   return std::string(reinterpret_cast<const char*>(buffer), length);
 }
 
+// Returns true if |result| means the TSS context, or the handles in it, can no
+// longer be used; for example, after tcsd restarted.
+bool IsStaleContextError(TSS_RESULT result) {
+  switch (ERROR_CODE(result)) {
+    case TSS_E_COMM_FAILURE:
+    case TSS_E_INVALID_HANDLE:
+    case TPM_E_INVALID_KEYHANDLE:
+      return true;
+  }
+  return false;
+}
+
 }  // namespace
 
 namespace attestation {
@@ -113,31 +137,15 @@ bool TpmUtilityV1::ActivateIdentity(const std::string& delegate_blob,
     return false;
   }
 
-  // Connect to the TPM as the owner delegate.
-  ScopedTssContext context_handle;
-  TSS_HTPM tpm_handle;
-  if (!ConnectContextAsDelegate(delegate_blob, delegate_secret, &context_handle,
-                                &tpm_handle)) {
-    LOG(ERROR) << __func__ << ": Could not connect to the TPM.";
-    return false;
-  }
-  // Load the Storage Root Key.
-  TSS_RESULT result;
-  ScopedTssKey srk_handle(context_handle);
-  if (!LoadSrk(context_handle, &srk_handle)) {
-    LOG(ERROR) << __func__ << ": Failed to load SRK.";
+  // Act as the owner delegate.
+  if (!SetupDelegate(delegate_blob, delegate_secret)) {
+    LOG(ERROR) << __func__ << ": Could not authorize as the owner delegate.";
     return false;
   }
   // Load the AIK (which is wrapped by the SRK).
-  std::string mutable_identity_key_blob(identity_key_blob);
-  BYTE* identity_key_blob_buffer =
-      StringAsTSSBuffer(&mutable_identity_key_blob);
-  ScopedTssKey identity_key(context_handle);
-  result = Tspi_Context_LoadKeyByBlob(
-      context_handle, srk_handle, identity_key_blob.size(),
-      identity_key_blob_buffer, identity_key.ptr());
-  if (TPM_ERROR(result)) {
-    TPM_LOG(ERROR, result) << __func__ << ": Failed to load AIK.";
+  TSS_HKEY identity_key = 0;
+  if (!GetLoadedKey(identity_key_blob, &identity_key)) {
+    LOG(ERROR) << __func__ << ": Failed to load AIK.";
     return false;
   }
   std::string mutable_asym_ca_contents(asym_ca_contents);
@@ -146,13 +154,14 @@ bool TpmUtilityV1::ActivateIdentity(const std::string& delegate_blob,
   BYTE* sym_ca_attestation_buffer =
       StringAsTSSBuffer(&mutable_sym_ca_attestation);
   UINT32 credential_length = 0;
-  ScopedTssMemory credential_buffer(context_handle);
-  result = Tspi_TPM_ActivateIdentity(
-      tpm_handle, identity_key, asym_ca_contents.size(),
+  ScopedTssMemory credential_buffer(context_handle_);
+  TSS_RESULT result = Tspi_TPM_ActivateIdentity(
+      tpm_handle_, identity_key, asym_ca_contents.size(),
       asym_ca_contents_buffer, sym_ca_attestation.size(),
       sym_ca_attestation_buffer, &credential_length, credential_buffer.ptr());
   if (TPM_ERROR(result)) {
     TPM_LOG(ERROR, result) << __func__ << ": Failed to activate identity.";
+    HandleKeyError(result, identity_key_blob);
     return false;
   }
   credential->assign(
@@ -180,9 +189,8 @@ bool TpmUtilityV1::CreateCertifiedKey(KeyType key_type,
   }
 
   // Load the AIK (which is wrapped by the SRK).
-  ScopedTssKey identity_key(context_handle_);
-  if (!LoadKeyFromBlob(identity_key_blob, context_handle_, srk_handle_,
-                       &identity_key)) {
+  TSS_HKEY identity_key = 0;
+  if (!GetLoadedKey(identity_key_blob, &identity_key)) {
     LOG(ERROR) << __func__ << "Failed to load AIK.";
     return false;
   }
@@ -232,6 +240,7 @@ bool TpmUtilityV1::CreateCertifiedKey(KeyType key_type,
   result = Tspi_Key_CertifyKey(key, identity_key, &validation);
   if (TPM_ERROR(result)) {
     TPM_LOG(ERROR, result) << __func__ << ": Failed to certify key.";
+    HandleKeyError(result, identity_key_blob);
     return false;
   }
   ScopedTssMemory scoped_certified_data(0, validation.rgbData);
@@ -305,6 +314,9 @@ bool TpmUtilityV1::SealToPCR0(const std::string& data,
                     Tspi_Data_Seal(encrypted_data_handle, srk_handle_,
                                    data.size(), data_buffer, pcrs_handle))) {
     TPM_LOG(ERROR, result) << __func__ << ": Error calling Tspi_Data_Seal";
+    if (IsStaleContextError(result)) {
+      ResetContext();
+    }
     return false;
   }
 
@@ -358,6 +370,9 @@ bool TpmUtilityV1::Unseal(const std::string& sealed_data, std::string* data) {
                                           &decrypted_data_length,
                                           decrypted_data.ptr()))) {
     TPM_LOG(ERROR, result) << __func__ << ": Error calling Tspi_Data_Unseal";
+    if (IsStaleContextError(result)) {
+      ResetContext();
+    }
     return false;
   }
   data->assign(
@@ -397,8 +412,8 @@ bool TpmUtilityV1::Unbind(const std::string& key_blob,
     LOG(ERROR) << "SRK is not ready.";
     return false;
   }
-  ScopedTssKey key_handle(context_handle_);
-  if (!LoadKeyFromBlob(key_blob, context_handle_, srk_handle_, &key_handle)) {
+  TSS_HKEY key_handle = 0;
+  if (!GetLoadedKey(key_blob, &key_handle)) {
     return false;
   }
   TSS_RESULT result;
@@ -423,6 +438,7 @@ bool TpmUtilityV1::Unbind(const std::string& key_blob,
   if (TPM_ERROR(result = Tspi_Data_Unbind(data_handle, key_handle, &length,
                                           decrypted_data.ptr()))) {
     TPM_LOG(ERROR, result) << __func__ << ": Tspi_Data_Unbind failed.";
+    HandleKeyError(result, key_blob);
     return false;
   }
   data->assign(TSSBufferAsString(decrypted_data.value(), length));
@@ -432,19 +448,48 @@ bool TpmUtilityV1::Unbind(const std::string& key_blob,
 bool TpmUtilityV1::Sign(const std::string& key_blob,
                         const std::string& data_to_sign,
                         std::string* signature) {
+  return SignDigest(key_blob, crypto::SHA256HashString(data_to_sign),
+                    signature);
+}
+
+bool TpmUtilityV1::SignFile(const std::string& key_blob,
+                            int fd,
+                            std::string* signature) {
+  base::File file(HANDLE_EINTR(fcntl(fd, F_DUPFD_CLOEXEC, 0)));
+  if (!file.IsValid()) {
+    PLOG(ERROR) << __func__ << ": Failed to duplicate file descriptor";
+    return false;
+  }
+  // mmap() refuses empty files, which hash as "".
+  base::MemoryMappedFile mapped_file;
+  base::StringPiece contents;
+  if (file.GetLength() > 0) {
+    if (!mapped_file.Initialize(std::move(file))) {
+      LOG(ERROR) << __func__ << ": Failed to map file to sign.";
+      return false;
+    }
+    contents.set(reinterpret_cast<const char*>(mapped_file.data()),
+                 mapped_file.length());
+  }
+  return SignDigest(key_blob, crypto::SHA256HashString(contents), signature);
+}
+
+bool TpmUtilityV1::SignDigest(const std::string& key_blob,
+                              const std::string& digest,
+                              std::string* signature) {
   CHECK(signature);
   if (!SetupSrk()) {
     LOG(ERROR) << "SRK is not ready.";
     return false;
   }
-  ScopedTssKey key_handle(context_handle_);
-  if (!LoadKeyFromBlob(key_blob, context_handle_, srk_handle_, &key_handle)) {
+  TSS_HKEY key_handle = 0;
+  if (!GetLoadedKey(key_blob, &key_handle)) {
     return false;
   }
   // Construct an ASN.1 DER DigestInfo.
   std::string digest_to_sign(std::begin(kSha256DigestInfo),
                              std::end(kSha256DigestInfo));
-  digest_to_sign += crypto::SHA256HashString(data_to_sign);
+  digest_to_sign += digest;
   // Create a hash object to hold the digest.
   ScopedTssHash hash_handle(context_handle_);
   TSS_RESULT result = Tspi_Context_CreateObject(
@@ -464,6 +509,7 @@ bool TpmUtilityV1::Sign(const std::string& key_blob,
   result = Tspi_Hash_Sign(hash_handle, key_handle, &length, buffer.ptr());
   if (TPM_ERROR(result)) {
     TPM_LOG(ERROR, result) << __func__ << ": Failed to generate signature.";
+    HandleKeyError(result, key_blob);
     return false;
   }
   signature->assign(TSSBufferAsString(buffer.value(), length));
@@ -490,26 +536,28 @@ bool TpmUtilityV1::ConnectContext(ScopedTssContext* context, TSS_HTPM* tpm) {
   return true;
 }
 
-bool TpmUtilityV1::ConnectContextAsDelegate(const std::string& delegate_blob,
-                                            const std::string& delegate_secret,
-                                            ScopedTssContext* context,
-                                            TSS_HTPM* tpm) {
-  *tpm = 0;
-  if (!ConnectContext(context, tpm)) {
-    return false;
+bool TpmUtilityV1::SetupDelegate(const std::string& delegate_blob,
+                                 const std::string& delegate_secret) {
+  if (tpm_usage_policy_ && delegate_blob == delegate_blob_ &&
+      delegate_secret == delegate_secret_) {
+    return true;
   }
+  // Use a policy of our own; the default policy is shared with the SRK.
+  tpm_usage_policy_.reset(context_handle_, 0);
+  delegate_blob_.clear();
+  delegate_secret_.clear();
   TSS_RESULT result;
-  TSS_HPOLICY tpm_usage_policy;
-  if (TPM_ERROR(result = Tspi_GetPolicyObject(*tpm, TSS_POLICY_USAGE,
-                                              &tpm_usage_policy))) {
+  if (TPM_ERROR(result = Tspi_Context_CreateObject(
+                    context_handle_, TSS_OBJECT_TYPE_POLICY, TSS_POLICY_USAGE,
+                    tpm_usage_policy_.ptr()))) {
     TPM_LOG(ERROR, result) << __func__
-                           << ": Error calling Tspi_GetPolicyObject";
+                           << ": Error calling Tspi_Context_CreateObject";
     return false;
   }
   std::string mutable_delegate_secret(delegate_secret);
   BYTE* secret_buffer = StringAsTSSBuffer(&mutable_delegate_secret);
   if (TPM_ERROR(result = Tspi_Policy_SetSecret(
-                    tpm_usage_policy, TSS_SECRET_MODE_PLAIN,
+                    tpm_usage_policy_, TSS_SECRET_MODE_PLAIN,
                     delegate_secret.size(), secret_buffer))) {
     TPM_LOG(ERROR, result) << __func__
                            << ": Error calling Tspi_Policy_SetSecret";
@@ -518,12 +566,23 @@ bool TpmUtilityV1::ConnectContextAsDelegate(const std::string& delegate_blob,
   std::string mutable_delegate_blob(delegate_blob);
   BYTE* blob_buffer = StringAsTSSBuffer(&mutable_delegate_blob);
   if (TPM_ERROR(result = Tspi_SetAttribData(
-                    tpm_usage_policy, TSS_TSPATTRIB_POLICY_DELEGATION_INFO,
+                    tpm_usage_policy_, TSS_TSPATTRIB_POLICY_DELEGATION_INFO,
                     TSS_TSPATTRIB_POLDEL_OWNERBLOB, delegate_blob.size(),
                     blob_buffer))) {
     TPM_LOG(ERROR, result) << __func__ << ": Error calling Tspi_SetAttribData";
     return false;
   }
+  if (TPM_ERROR(result = Tspi_Policy_AssignToObject(tpm_usage_policy_,
+                                                    tpm_handle_))) {
+    TPM_LOG(ERROR, result) << __func__
+                           << ": Error calling Tspi_Policy_AssignToObject";
+    if (IsStaleContextError(result)) {
+      ResetContext();
+    }
+    return false;
+  }
+  delegate_blob_ = delegate_blob;
+  delegate_secret_ = delegate_secret;
   return true;
 }
 
@@ -534,6 +593,11 @@ bool TpmUtilityV1::SetupSrk() {
   if (srk_handle_) {
     return true;
   }
+  if (!context_handle_ && !ConnectContext(&context_handle_, &tpm_handle_)) {
+    LOG(ERROR) << __func__ << ": Failed to connect to the TPM.";
+    ResetContext();
+    return false;
+  }
   srk_handle_.reset(context_handle_, 0);
   if (!LoadSrk(context_handle_, &srk_handle_)) {
     LOG(ERROR) << __func__ << ": Failed to load SRK.";
@@ -595,22 +659,62 @@ bool TpmUtilityV1::LoadSrk(TSS_HCONTEXT context_handle,
   return true;
 }
 
-bool TpmUtilityV1::LoadKeyFromBlob(const std::string& key_blob,
-                                   TSS_HCONTEXT context_handle,
-                                   TSS_HKEY parent_key_handle,
-                                   ScopedTssKey* key_handle) {
+bool TpmUtilityV1::GetLoadedKey(const std::string& key_blob,
+                                TSS_HKEY* key_handle) {
+  for (auto it = loaded_keys_.begin(); it != loaded_keys_.end(); ++it) {
+    if (it->blob == key_blob) {
+      loaded_keys_.splice(loaded_keys_.begin(), loaded_keys_, it);
+      *key_handle = loaded_keys_.front().handle;
+      return true;
+    }
+  }
+  std::list<LoadedKey> new_key;
+  new_key.emplace_back(context_handle_);
   std::string mutable_key_blob(key_blob);
   BYTE* key_blob_buffer = StringAsTSSBuffer(&mutable_key_blob);
   TSS_RESULT result = Tspi_Context_LoadKeyByBlob(
-      context_handle, parent_key_handle, key_blob.size(), key_blob_buffer,
-      key_handle->ptr());
+      context_handle_, srk_handle_, key_blob.size(), key_blob_buffer,
+      new_key.front().handle.ptr());
   if (TPM_ERROR(result)) {
     TPM_LOG(ERROR, result) << __func__ << ": Failed to load key by blob.";
+    if (IsStaleContextError(result)) {
+      ResetContext();
+    }
     return false;
   }
+  new_key.front().blob = key_blob;
+  loaded_keys_.splice(loaded_keys_.begin(), new_key);
+  while (loaded_keys_.size() > kMaxLoadedKeys) {
+    loaded_keys_.pop_back();
+  }
+  *key_handle = loaded_keys_.front().handle;
   return true;
 }
 
+void TpmUtilityV1::HandleKeyError(TSS_RESULT result,
+                                  const std::string& key_blob) {
+  if (IsStaleContextError(result)) {
+    ResetContext();
+    return;
+  }
+  for (auto it = loaded_keys_.begin(); it != loaded_keys_.end(); ++it) {
+    if (it->blob == key_blob) {
+      loaded_keys_.erase(it);
+      return;
+    }
+  }
+}
+
+void TpmUtilityV1::ResetContext() {
+  loaded_keys_.clear();
+  tpm_usage_policy_.reset(context_handle_, 0);
+  delegate_blob_.clear();
+  delegate_secret_.clear();
+  srk_handle_.reset(context_handle_, 0);
+  tpm_handle_ = 0;
+  context_handle_.reset();
+}
+
 bool TpmUtilityV1::GetDataAttribute(TSS_HCONTEXT context,
                                     TSS_HOBJECT object,
                                     TSS_FLAG flag,
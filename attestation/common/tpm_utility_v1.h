@@ -19,6 +19,7 @@
 
 #include "attestation/common/tpm_utility.h"
 
+#include <list>
 #include <string>
 
 #include <base/macros.h>
@@ -63,6 +64,9 @@ class TpmUtilityV1 : public TpmUtility {
   bool Sign(const std::string& key_blob,
             const std::string& data_to_sign,
             std::string* signature) override;
+  bool SignFile(const std::string& key_blob,
+                int fd,
+                std::string* signature) override;
 
  private:
   // Populates |context_handle| with a valid TSS_HCONTEXT and |tpm_handle| with
@@ -71,29 +75,39 @@ class TpmUtilityV1 : public TpmUtility {
   bool ConnectContext(trousers::ScopedTssContext* context_handle,
                       TSS_HTPM* tpm_handle);
 
-  // Populates |context_handle| with a valid TSS_HCONTEXT and |tpm_handle| with
-  // its matching TPM object authorized by the given |delegate_blob| and
-  // |delegate_secret|. Returns true on success.
-  bool ConnectContextAsDelegate(const std::string& delegate_blob,
-                                const std::string& delegate_secret,
-                                trousers::ScopedTssContext* context,
-                                TSS_HTPM* tpm);
-
-  // Sets up srk_handle_ if necessary. Returns true iff the SRK is ready.
+  // Signs a SHA-256 |digest| as Sign does the digest of its input.
+  bool SignDigest(const std::string& key_blob,
+                  const std::string& digest,
+                  std::string* signature);
+
+  // Authorizes tpm_handle_ with the given |delegate_blob| and
+  // |delegate_secret|, unless it already is. Returns true on success.
+  bool SetupDelegate(const std::string& delegate_blob,
+                     const std::string& delegate_secret);
+
+  // Sets up context_handle_ and srk_handle_ if necessary. Returns true iff the
+  // SRK is ready.
   bool SetupSrk();
 
+  // Populates |key_handle| with the key loaded from |key_blob| under the SRK,
+  // loading it only if it is not already resident. The handle is owned by
+  // loaded_keys_ and stays valid until the next call that loads a key. Returns
+  // true on success.
+  bool GetLoadedKey(const std::string& key_blob, TSS_HKEY* key_handle);
+
+  // Handles a TSS error |result| from an operation that used the loaded key
+  // for |key_blob|: the key is unloaded, and the whole context is dropped when
+  // |result| indicates it is no longer usable. Either is reloaded on the next
+  // call.
+  void HandleKeyError(TSS_RESULT result, const std::string& key_blob);
+
+  // Drops the context and everything loaded in it.
+  void ResetContext();
+
   // Loads the storage root key (SRK) and populates |srk_handle|. The
   // |context_handle| must be connected and valid. Returns true on success.
   bool LoadSrk(TSS_HCONTEXT context_handle, trousers::ScopedTssKey* srk_handle);
 
-  // Loads a key in the TPM given a |key_blob| and a |parent_key_handle|. The
-  // |context_handle| must be connected and valid. Returns true and populates
-  // |key_handle| on success.
-  bool LoadKeyFromBlob(const std::string& key_blob,
-                       TSS_HCONTEXT context_handle,
-                       TSS_HKEY parent_key_handle,
-                       trousers::ScopedTssKey* key_handle);
-
   // Retrieves a |data| attribute defined by |flag| and |sub_flag| from a TSS
   // |object_handle|. The |context_handle| is only used for TSS memory
   // management.
@@ -107,10 +121,25 @@ class TpmUtilityV1 : public TpmUtility {
   bool ConvertPublicKeyToDER(const std::string& public_key,
                              std::string* public_key_der);
 
+  // A key kept loaded in context_handle_, identified by its blob.
+  struct LoadedKey {
+    explicit LoadedKey(TSS_HCONTEXT context) : handle(context) {}
+
+    std::string blob;
+    trousers::ScopedTssKey handle;
+  };
+
   bool is_ready_{false};
   trousers::ScopedTssContext context_handle_;
   TSS_HTPM tpm_handle_{0};
   trousers::ScopedTssKey srk_handle_{0};
+  // The usage policy assigned to tpm_handle_ by SetupDelegate, and the
+  // delegation it holds.
+  trousers::ScopedTssPolicy tpm_usage_policy_{0};
+  std::string delegate_blob_;
+  std::string delegate_secret_;
+  // Keys loaded under the SRK, most recently used first.
+  std::list<LoadedKey> loaded_keys_;
 
   DISALLOW_COPY_AND_ASSIGN(TpmUtilityV1);
 };
@@ -0,0 +1,595 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "attestation/common/tpm_utility_v2.h"
+
+#include <base/logging.h>
+#include <base/stl_util.h>
+#include <crypto/scoped_openssl_types.h>
+#include <openssl/rsa.h>
+#include <trunks/authorization_delegate.h>
+#include <trunks/error_codes.h>
+#include <trunks/multiple_authorization_delegate.h>
+#include <trunks/policy_session.h>
+#include <trunks/tpm_constants.h>
+#include <trunks/tpm_state.h>
+
+using trunks::GetErrorString;
+using trunks::TPM_HANDLE;
+using trunks::TPM_RC;
+using trunks::TPM_RC_SUCCESS;
+
+namespace {
+
+// The TCG default handle of the persistent RSA endorsement key.
+const TPM_HANDLE kEndorsementKeyHandle = 0x81010001;
+// The policy of the TCG default endorsement key template:
+// PolicySecret(TPM_RH_ENDORSEMENT).
+const uint8_t kEndorsementKeyPolicy[] = {
+    0x83, 0x71, 0x97, 0x67, 0x44, 0x84, 0xb3, 0xf8, 0x1a, 0x90, 0xcc,
+    0x8d, 0x46, 0xa5, 0xd7, 0x24, 0xfd, 0x52, 0xd7, 0x6e, 0x06, 0x52,
+    0x0b, 0x64, 0xf2, 0xa1, 0xda, 0x1b, 0x33, 0x14, 0x69, 0xaa};
+const int kRSAKeySize = 2048;
+const int kCertifiedKeyModulusBits = 2048;
+const uint32_t kWellKnownExponent = 0x10001;
+// The number of keys kept loaded. This covers the identity key and a few
+// certified keys; the trunks resource manager swaps them out of the TPM as
+// needed.
+const size_t kMaxLoadedKeys = 4;
+
+std::string NameFromHandle(TPM_HANDLE handle) {
+  std::string name;
+  trunks::Serialize_TPM_HANDLE(handle, &name);
+  return name;
+}
+
+// Returns the default TCG template for a 2048-bit RSA endorsement key.
+trunks::TPMT_PUBLIC GetEndorsementKeyTemplate() {
+  trunks::TPMT_PUBLIC public_area;
+  public_area.type = trunks::TPM_ALG_RSA;
+  public_area.name_alg = trunks::TPM_ALG_SHA256;
+  public_area.object_attributes =
+      trunks::kFixedTPM | trunks::kFixedParent |
+      trunks::kSensitiveDataOrigin | trunks::kAdminWithPolicy |
+      trunks::kRestricted | trunks::kDecrypt;
+  public_area.auth_policy = trunks::Make_TPM2B_DIGEST(
+      std::string(reinterpret_cast<const char*>(kEndorsementKeyPolicy),
+                  sizeof(kEndorsementKeyPolicy)));
+  public_area.parameters.rsa_detail.symmetric.algorithm = trunks::TPM_ALG_AES;
+  public_area.parameters.rsa_detail.symmetric.key_bits.aes = 128;
+  public_area.parameters.rsa_detail.symmetric.mode.aes = trunks::TPM_ALG_CFB;
+  public_area.parameters.rsa_detail.scheme.scheme = trunks::TPM_ALG_NULL;
+  public_area.parameters.rsa_detail.key_bits = kRSAKeySize;
+  public_area.parameters.rsa_detail.exponent = 0;
+  public_area.unique.rsa =
+      trunks::Make_TPM2B_PUBLIC_KEY_RSA(std::string(kRSAKeySize / 8, 0));
+  return public_area;
+}
+
+}  // namespace
+
+namespace attestation {
+
+TpmUtilityV2::TpmUtilityV2()
+    : default_trunks_factory_(new trunks::TrunksFactoryImpl()),
+      trunks_factory_(default_trunks_factory_.get()) {}
+
+TpmUtilityV2::TpmUtilityV2(trunks::TrunksFactory* trunks_factory)
+    : trunks_factory_(trunks_factory) {}
+
+TpmUtilityV2::~TpmUtilityV2() {
+  if (flush_queue_) {
+    for (const LoadedKey& key : loaded_keys_) {
+      flush_queue_->Add(key.handle);
+    }
+    flush_queue_->Flush();
+  }
+}
+
+bool TpmUtilityV2::Initialize() {
+  if (default_trunks_factory_) {
+    // Initialize() runs on the service thread but the TPM is used from the
+    // TPM thread. The shared connection is thread-safe, and other factories
+    // of the daemon reuse it.
+    default_trunks_factory_->UseSharedConnection();
+    if (!default_trunks_factory_->Initialize()) {
+      LOG(ERROR) << __func__ << ": Failed to initialize trunks.";
+      return false;
+    }
+  }
+  trunks_utility_ = trunks_factory_->GetTpmUtility();
+  flush_queue_.reset(new trunks::HandleFlushQueue(*trunks_factory_));
+  if (!IsTpmReady()) {
+    LOG(WARNING) << __func__ << ": TPM is not owned; attestation services will "
+                 << "not be available until ownership is taken.";
+  }
+  return true;
+}
+
+bool TpmUtilityV2::IsTpmReady() {
+  if (!is_ready_) {
+    std::unique_ptr<trunks::TpmState> tpm_state =
+        trunks_factory_->GetTpmState();
+    TPM_RC result = tpm_state->Initialize();
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << __func__ << ": Failed to read TPM state: "
+                 << GetErrorString(result);
+      return false;
+    }
+    is_ready_ = tpm_state->IsEnabled() && tpm_state->IsOwned();
+  }
+  return is_ready_;
+}
+
+bool TpmUtilityV2::ActivateIdentity(const std::string& delegate_blob,
+                                    const std::string& delegate_secret,
+                                    const std::string& identity_key_blob,
+                                    const std::string& asym_ca_contents,
+                                    const std::string& sym_ca_attestation,
+                                    std::string* credential) {
+  CHECK(credential);
+  std::unique_ptr<trunks::AuthorizationDelegate> identity_key_authorization =
+      trunks_factory_->GetPasswordAuthorization("");
+  TPM_HANDLE identity_key_handle;
+  if (!GetLoadedKey(identity_key_blob, identity_key_authorization.get(),
+                    &identity_key_handle)) {
+    LOG(ERROR) << __func__ << ": Failed to load identity key.";
+    return false;
+  }
+  std::string identity_key_name;
+  TPM_RC result =
+      trunks_utility_->GetKeyName(identity_key_handle, &identity_key_name);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to get identity key name: "
+               << GetErrorString(result);
+    DropLoadedKey(identity_key_blob);
+    return false;
+  }
+  trunks::ScopedKeyHandle scoped_endorsement_key(*trunks_factory_);
+  TPM_HANDLE endorsement_key_handle;
+  std::string endorsement_key_name;
+  trunks::TPMT_PUBLIC endorsement_public_area;
+  if (!GetEndorsementKey(delegate_secret, &scoped_endorsement_key,
+                         &endorsement_key_handle, &endorsement_key_name,
+                         &endorsement_public_area)) {
+    return false;
+  }
+  // The endorsement key can only be used through its policy, which needs the
+  // endorsement hierarchy authorization.
+  std::unique_ptr<trunks::AuthorizationDelegate> endorsement_authorization =
+      trunks_factory_->GetPasswordAuthorization(delegate_secret);
+  std::unique_ptr<trunks::PolicySession> policy_session =
+      trunks_factory_->GetPolicySession();
+  result = policy_session->StartUnboundSession(false);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to start policy session: "
+               << GetErrorString(result);
+    return false;
+  }
+  result = policy_session->PolicySecret(
+      trunks::TPM_RH_ENDORSEMENT, NameFromHandle(trunks::TPM_RH_ENDORSEMENT),
+      endorsement_authorization.get());
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to authorize endorsement key: "
+               << GetErrorString(result);
+    return false;
+  }
+  // TPM2_ActivateCredential authorizes the identity key first and the
+  // endorsement key second.
+  trunks::MultipleAuthorizations authorizations;
+  authorizations.AddAuthorizationDelegate(identity_key_authorization.get());
+  authorizations.AddAuthorizationDelegate(policy_session->GetDelegate());
+  trunks::TPM2B_DIGEST certinfo;
+  result = trunks_factory_->GetTpm()->ActivateCredentialSync(
+      identity_key_handle, identity_key_name, endorsement_key_handle,
+      endorsement_key_name, trunks::Make_TPM2B_ID_OBJECT(sym_ca_attestation),
+      trunks::Make_TPM2B_ENCRYPTED_SECRET(asym_ca_contents), &certinfo,
+      &authorizations);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to activate credential: "
+               << GetErrorString(result);
+    DropLoadedKey(identity_key_blob);
+    return false;
+  }
+  *credential = trunks::StringFrom_TPM2B_DIGEST(certinfo);
+  return true;
+}
+
+bool TpmUtilityV2::CreateCertifiedKey(KeyType key_type,
+                                      KeyUsage key_usage,
+                                      const std::string& identity_key_blob,
+                                      const std::string& external_data,
+                                      std::string* key_blob,
+                                      std::string* public_key,
+                                      std::string* public_key_tpm_format,
+                                      std::string* key_info,
+                                      std::string* proof) {
+  CHECK(key_blob && public_key && public_key_tpm_format && key_info && proof);
+  if (key_type != KEY_TYPE_RSA) {
+    LOG(ERROR) << __func__ << ": Only RSA supported.";
+    return false;
+  }
+  std::unique_ptr<trunks::HmacSession> session = StartHmacSession();
+  if (!session) {
+    return false;
+  }
+  trunks::TpmUtility::AsymmetricKeyUsage trunks_key_usage =
+      (key_usage == KEY_USAGE_SIGN) ? trunks::TpmUtility::kSignKey
+                                    : trunks::TpmUtility::kDecryptKey;
+  TPM_RC result = trunks_utility_->CreateRSAKeyPair(
+      trunks_key_usage, kCertifiedKeyModulusBits, kWellKnownExponent,
+      "",  // No authorization.
+      "",  // No policy.
+      false, trunks::kNoCreationPCR, session->GetDelegate(), key_blob,
+      nullptr);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to create key: "
+               << GetErrorString(result);
+    return false;
+  }
+  TPM_HANDLE identity_key_handle;
+  if (!GetLoadedKey(identity_key_blob, session->GetDelegate(),
+                    &identity_key_handle)) {
+    LOG(ERROR) << __func__ << ": Failed to load identity key.";
+    return false;
+  }
+  // The new key is certified right away and is loaded again when it is used,
+  // so it is not cached.
+  TPM_HANDLE key_handle;
+  result = trunks_utility_->LoadKey(*key_blob, session->GetDelegate(),
+                                    &key_handle);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to load key: "
+               << GetErrorString(result);
+    return false;
+  }
+  trunks::ScopedKeyHandle scoped_key_handle(*trunks_factory_, key_handle);
+  std::string key_name;
+  std::string identity_key_name;
+  result = trunks_utility_->GetKeyName(key_handle, &key_name);
+  if (result == TPM_RC_SUCCESS) {
+    result =
+        trunks_utility_->GetKeyName(identity_key_handle, &identity_key_name);
+  }
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to get key names: "
+               << GetErrorString(result);
+    DropLoadedKey(identity_key_blob);
+    return false;
+  }
+  trunks::TPMT_PUBLIC public_area;
+  result = trunks_utility_->GetKeyPublicArea(key_handle, &public_area);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to read public key: "
+               << GetErrorString(result);
+    return false;
+  }
+  if (!ConvertPublicAreaToDER(public_area, public_key)) {
+    return false;
+  }
+  public_key_tpm_format->clear();
+  result = trunks::Serialize_TPMT_PUBLIC(public_area, public_key_tpm_format);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to serialize public key: "
+               << GetErrorString(result);
+    return false;
+  }
+
+  // TPM2_Certify authorizes the certified key first and the identity key
+  // second; neither has an authorization value.
+  std::unique_ptr<trunks::AuthorizationDelegate> key_authorization =
+      trunks_factory_->GetPasswordAuthorization("");
+  std::unique_ptr<trunks::AuthorizationDelegate> identity_key_authorization =
+      trunks_factory_->GetPasswordAuthorization("");
+  trunks::MultipleAuthorizations authorizations;
+  authorizations.AddAuthorizationDelegate(key_authorization.get());
+  authorizations.AddAuthorizationDelegate(identity_key_authorization.get());
+  trunks::TPMT_SIG_SCHEME scheme;
+  scheme.scheme = trunks::TPM_ALG_RSASSA;
+  scheme.details.rsassa.hash_alg = trunks::TPM_ALG_SHA256;
+  trunks::TPM2B_ATTEST certify_info;
+  trunks::TPMT_SIGNATURE signature;
+  result = trunks_factory_->GetTpm()->CertifySync(
+      key_handle, key_name, identity_key_handle, identity_key_name,
+      trunks::Make_TPM2B_DATA(external_data), scheme, &certify_info,
+      &signature, &authorizations);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to certify key: "
+               << GetErrorString(result);
+    DropLoadedKey(identity_key_blob);
+    return false;
+  }
+  *key_info = trunks::StringFrom_TPM2B_ATTEST(certify_info);
+  *proof =
+      trunks::StringFrom_TPM2B_PUBLIC_KEY_RSA(signature.signature.rsassa.sig);
+  return true;
+}
+
+bool TpmUtilityV2::SealToPCR0(const std::string& data,
+                              std::string* sealed_data) {
+  CHECK(sealed_data);
+  std::string policy_digest;
+  TPM_RC result =
+      trunks_utility_->GetPolicyDigestForPcrValue(0, "", &policy_digest);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to compute PCR0 policy: "
+               << GetErrorString(result);
+    return false;
+  }
+  std::unique_ptr<trunks::HmacSession> session = StartHmacSession();
+  if (!session) {
+    return false;
+  }
+  result = trunks_utility_->SealData(data, policy_digest,
+                                     session->GetDelegate(), sealed_data);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to seal data: "
+               << GetErrorString(result);
+    return false;
+  }
+  return true;
+}
+
+bool TpmUtilityV2::Unseal(const std::string& sealed_data, std::string* data) {
+  CHECK(data);
+  std::unique_ptr<trunks::PolicySession> policy_session =
+      trunks_factory_->GetPolicySession();
+  TPM_RC result = policy_session->StartUnboundSession(true);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to start policy session: "
+               << GetErrorString(result);
+    return false;
+  }
+  result = policy_session->PolicyPCR(0, "");
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to bind policy to PCR0: "
+               << GetErrorString(result);
+    return false;
+  }
+  result = trunks_utility_->UnsealData(sealed_data,
+                                       policy_session->GetDelegate(), data);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to unseal data: "
+               << GetErrorString(result);
+    return false;
+  }
+  return true;
+}
+
+bool TpmUtilityV2::GetEndorsementPublicKey(std::string* public_key) {
+  CHECK(public_key);
+  trunks::ScopedKeyHandle scoped_endorsement_key(*trunks_factory_);
+  TPM_HANDLE endorsement_key_handle;
+  std::string endorsement_key_name;
+  trunks::TPMT_PUBLIC public_area;
+  // Without a persistent key this only works while the endorsement hierarchy
+  // has no password.
+  if (!GetEndorsementKey("", &scoped_endorsement_key, &endorsement_key_handle,
+                         &endorsement_key_name, &public_area)) {
+    return false;
+  }
+  return ConvertPublicAreaToDER(public_area, public_key);
+}
+
+bool TpmUtilityV2::Unbind(const std::string& key_blob,
+                          const std::string& bound_data,
+                          std::string* data) {
+  CHECK(data);
+  std::unique_ptr<trunks::HmacSession> session = StartHmacSession();
+  if (!session) {
+    return false;
+  }
+  TPM_HANDLE key_handle;
+  if (!GetLoadedKey(key_blob, session->GetDelegate(), &key_handle)) {
+    LOG(ERROR) << __func__ << ": Failed to load key.";
+    return false;
+  }
+  TPM_RC result = trunks_utility_->AsymmetricDecrypt(
+      key_handle, trunks::TPM_ALG_OAEP, trunks::TPM_ALG_SHA1, bound_data,
+      session->GetDelegate(), data);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to decrypt: "
+               << GetErrorString(result);
+    DropLoadedKey(key_blob);
+    return false;
+  }
+  return true;
+}
+
+bool TpmUtilityV2::Sign(const std::string& key_blob,
+                        const std::string& data_to_sign,
+                        std::string* signature) {
+  CHECK(signature);
+  std::unique_ptr<trunks::HmacSession> session = StartHmacSession();
+  if (!session) {
+    return false;
+  }
+  TPM_HANDLE key_handle;
+  if (!GetLoadedKey(key_blob, session->GetDelegate(), &key_handle)) {
+    LOG(ERROR) << __func__ << ": Failed to load key.";
+    return false;
+  }
+  TPM_RC result = trunks_utility_->Sign(
+      key_handle, trunks::TPM_ALG_RSASSA, trunks::TPM_ALG_SHA256, data_to_sign,
+      session->GetDelegate(), signature);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to sign: " << GetErrorString(result);
+    DropLoadedKey(key_blob);
+    return false;
+  }
+  return true;
+}
+
+bool TpmUtilityV2::SignFile(const std::string& key_blob,
+                            int fd,
+                            std::string* signature) {
+  CHECK(signature);
+  std::unique_ptr<trunks::HmacSession> session = StartHmacSession();
+  if (!session) {
+    return false;
+  }
+  TPM_HANDLE key_handle;
+  if (!GetLoadedKey(key_blob, session->GetDelegate(), &key_handle)) {
+    LOG(ERROR) << __func__ << ": Failed to load key.";
+    return false;
+  }
+  TPM_RC result = trunks_utility_->SignFile(
+      key_handle, trunks::TPM_ALG_RSASSA, trunks::TPM_ALG_SHA256, fd,
+      session->GetDelegate(), signature);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to sign: " << GetErrorString(result);
+    DropLoadedKey(key_blob);
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<trunks::HmacSession> TpmUtilityV2::StartHmacSession() {
+  std::unique_ptr<trunks::HmacSession> session =
+      trunks_factory_->GetHmacSession();
+  TPM_RC result = trunks_utility_->StartSession(session.get());
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to start HMAC session: "
+               << GetErrorString(result);
+    return nullptr;
+  }
+  return session;
+}
+
+bool TpmUtilityV2::GetLoadedKey(const std::string& key_blob,
+                                trunks::AuthorizationDelegate* delegate,
+                                TPM_HANDLE* key_handle) {
+  for (auto it = loaded_keys_.begin(); it != loaded_keys_.end(); ++it) {
+    if (it->blob == key_blob) {
+      loaded_keys_.splice(loaded_keys_.begin(), loaded_keys_, it);
+      *key_handle = loaded_keys_.front().handle;
+      return true;
+    }
+  }
+  TPM_HANDLE new_handle;
+  TPM_RC result = trunks_utility_->LoadKey(key_blob, delegate, &new_handle);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to load key: "
+               << GetErrorString(result);
+    return false;
+  }
+  loaded_keys_.push_front(LoadedKey{key_blob, new_handle});
+  while (loaded_keys_.size() > kMaxLoadedKeys) {
+    flush_queue_->Add(loaded_keys_.back().handle);
+    loaded_keys_.pop_back();
+  }
+  *key_handle = new_handle;
+  return true;
+}
+
+void TpmUtilityV2::DropLoadedKey(const std::string& key_blob) {
+  for (auto it = loaded_keys_.begin(); it != loaded_keys_.end(); ++it) {
+    if (it->blob == key_blob) {
+      flush_queue_->Add(it->handle);
+      loaded_keys_.erase(it);
+      return;
+    }
+  }
+}
+
+bool TpmUtilityV2::GetEndorsementKey(const std::string& endorsement_password,
+                                     trunks::ScopedKeyHandle* scoped_handle,
+                                     TPM_HANDLE* key_handle,
+                                     std::string* name,
+                                     trunks::TPMT_PUBLIC* public_area) {
+  trunks::Tpm* tpm = trunks_factory_->GetTpm();
+  trunks::TPM2B_PUBLIC public_data;
+  trunks::TPM2B_NAME public_name;
+  trunks::TPM2B_NAME qualified_name;
+  TPM_RC result = tpm->ReadPublicSync(
+      kEndorsementKeyHandle, NameFromHandle(kEndorsementKeyHandle),
+      &public_data, &public_name, &qualified_name, nullptr);
+  if (result == TPM_RC_SUCCESS) {
+    *key_handle = kEndorsementKeyHandle;
+    *name = trunks::StringFrom_TPM2B_NAME(public_name);
+    *public_area = public_data.public_area;
+    return true;
+  }
+  // There is no persistent key, so derive it from the endorsement seed.
+  trunks::TPMS_SENSITIVE_CREATE sensitive;
+  sensitive.user_auth = trunks::Make_TPM2B_DIGEST("");
+  sensitive.data = trunks::Make_TPM2B_SENSITIVE_DATA("");
+  trunks::TPML_PCR_SELECTION creation_pcrs;
+  creation_pcrs.count = 0;
+  trunks::TPM2B_CREATION_DATA creation_data;
+  trunks::TPM2B_DIGEST creation_digest;
+  trunks::TPMT_TK_CREATION creation_ticket;
+  public_name.size = 0;
+  std::unique_ptr<trunks::AuthorizationDelegate> delegate =
+      trunks_factory_->GetPasswordAuthorization(endorsement_password);
+  result = tpm->CreatePrimarySync(
+      trunks::TPM_RH_ENDORSEMENT, NameFromHandle(trunks::TPM_RH_ENDORSEMENT),
+      trunks::Make_TPM2B_SENSITIVE_CREATE(sensitive),
+      trunks::Make_TPM2B_PUBLIC(GetEndorsementKeyTemplate()),
+      trunks::Make_TPM2B_DATA(""), creation_pcrs, key_handle, &public_data,
+      &creation_data, &creation_digest, &creation_ticket, &public_name,
+      delegate.get());
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Failed to create endorsement key: "
+               << GetErrorString(result);
+    return false;
+  }
+  scoped_handle->reset(*key_handle);
+  *name = trunks::StringFrom_TPM2B_NAME(public_name);
+  *public_area = public_data.public_area;
+  return true;
+}
+
+bool TpmUtilityV2::ConvertPublicAreaToDER(
+    const trunks::TPMT_PUBLIC& public_area,
+    std::string* public_key_der) {
+  if (public_area.type != trunks::TPM_ALG_RSA) {
+    LOG(ERROR) << __func__ << ": Not an RSA key.";
+    return false;
+  }
+  crypto::ScopedRSA rsa(RSA_new());
+  CHECK(rsa.get());
+  // An exponent of zero selects the default exponent.
+  uint32_t exponent = public_area.parameters.rsa_detail.exponent;
+  if (exponent == 0) {
+    exponent = kWellKnownExponent;
+  }
+  rsa.get()->e = BN_new();
+  CHECK(rsa.get()->e);
+  BN_set_word(rsa.get()->e, exponent);
+  rsa.get()->n = BN_bin2bn(public_area.unique.rsa.buffer,
+                           public_area.unique.rsa.size, nullptr);
+  CHECK(rsa.get()->n);
+
+  // DER encode.
+  int der_length = i2d_RSAPublicKey(rsa.get(), nullptr);
+  if (der_length < 0) {
+    LOG(ERROR) << "Failed to DER-encode public key.";
+    return false;
+  }
+  public_key_der->resize(der_length);
+  unsigned char* der_buffer =
+      reinterpret_cast<unsigned char*>(string_as_array(public_key_der));
+  der_length = i2d_RSAPublicKey(rsa.get(), &der_buffer);
+  if (der_length < 0) {
+    LOG(ERROR) << "Failed to DER-encode public key.";
+    return false;
+  }
+  public_key_der->resize(der_length);
+  return true;
+}
+
+}  // namespace attestation
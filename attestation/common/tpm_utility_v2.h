@@ -0,0 +1,145 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ATTESTATION_COMMON_TPM_UTILITY_V2_H_
+#define ATTESTATION_COMMON_TPM_UTILITY_V2_H_
+
+#include "attestation/common/tpm_utility.h"
+
+#include <list>
+#include <memory>
+#include <string>
+
+#include <base/macros.h>
+#include <trunks/hmac_session.h>
+#include <trunks/scoped_key_handle.h>
+#include <trunks/tpm_generated.h>
+#include <trunks/tpm_utility.h>
+#include <trunks/trunks_factory.h>
+#include <trunks/trunks_factory_impl.h>
+
+namespace attestation {
+
+// A TpmUtility implementation for TPM 2.0 modules, built on trunks.
+//
+// The arguments of the TpmUtility methods map to TPM 2.0 as follows:
+//   - Key blobs are trunks key blobs, created under the trunks storage root
+//     key.
+//   - ActivateIdentity: |delegate_blob| is not used and |delegate_secret| is
+//     the endorsement hierarchy password. |asym_ca_contents| is the encrypted
+//     seed (TPM2B_ENCRYPTED_SECRET) and |sym_ca_attestation| the credential
+//     blob (TPM2B_ID_OBJECT) made by TPM2_MakeCredential.
+//   - CreateCertifiedKey: |public_key_tpm_format| is the serialized
+//     TPMT_PUBLIC, |key_info| the TPMS_ATTEST made by TPM2_Certify, and
+//     |proof| the RSASSA-SHA256 signature of |key_info|.
+//   - Unbind: |bound_data| is raw RSAES-OAEP (SHA-1) ciphertext.
+//
+// Identity and certified keys are kept loaded between calls, so that a burst
+// of operations with the same key only loads it once. HMAC sessions come from
+// the trunks session pool.
+class TpmUtilityV2 : public TpmUtility {
+ public:
+  TpmUtilityV2();
+  // Does not take ownership of |trunks_factory|, which must be initialized.
+  explicit TpmUtilityV2(trunks::TrunksFactory* trunks_factory);
+  ~TpmUtilityV2() override;
+
+  // Initializes a TpmUtilityV2 instance. This method must be called
+  // successfully before calling any other methods.
+  bool Initialize();
+
+  // TpmUtility methods.
+  bool IsTpmReady() override;
+  bool ActivateIdentity(const std::string& delegate_blob,
+                        const std::string& delegate_secret,
+                        const std::string& identity_key_blob,
+                        const std::string& asym_ca_contents,
+                        const std::string& sym_ca_attestation,
+                        std::string* credential) override;
+  bool CreateCertifiedKey(KeyType key_type,
+                          KeyUsage key_usage,
+                          const std::string& identity_key_blob,
+                          const std::string& external_data,
+                          std::string* key_blob,
+                          std::string* public_key,
+                          std::string* public_key_tpm_format,
+                          std::string* key_info,
+                          std::string* proof) override;
+  bool SealToPCR0(const std::string& data, std::string* sealed_data) override;
+  bool Unseal(const std::string& sealed_data, std::string* data) override;
+  bool GetEndorsementPublicKey(std::string* public_key) override;
+  bool Unbind(const std::string& key_blob,
+              const std::string& bound_data,
+              std::string* data) override;
+  bool Sign(const std::string& key_blob,
+            const std::string& data_to_sign,
+            std::string* signature) override;
+  bool SignFile(const std::string& key_blob,
+                int fd,
+                std::string* signature) override;
+
+ private:
+  // Starts an HMAC session for keys with an empty authorization value.
+  // Returns nullptr on failure.
+  std::unique_ptr<trunks::HmacSession> StartHmacSession();
+
+  // Populates |key_handle| with the key loaded from |key_blob|, loading it
+  // only if it is not already resident. The handle is owned by loaded_keys_
+  // and stays valid until the next call that loads a key. Returns true on
+  // success.
+  bool GetLoadedKey(const std::string& key_blob,
+                    trunks::AuthorizationDelegate* delegate,
+                    trunks::TPM_HANDLE* key_handle);
+
+  // Forgets the loaded key for |key_blob| after an operation with it failed,
+  // so that it is loaded again on the next call.
+  void DropLoadedKey(const std::string& key_blob);
+
+  // Gets a handle to the endorsement key: the persistent key at the TCG
+  // default handle if there is one, otherwise a primary key created from the
+  // default TCG template with |endorsement_password|. A created key is owned
+  // by |scoped_handle|. Also populates |name| and |public_area|.
+  bool GetEndorsementKey(const std::string& endorsement_password,
+                         trunks::ScopedKeyHandle* scoped_handle,
+                         trunks::TPM_HANDLE* key_handle,
+                         std::string* name,
+                         trunks::TPMT_PUBLIC* public_area);
+
+  // Converts the public area of an RSA key to a DER-encoded RSAPublicKey.
+  bool ConvertPublicAreaToDER(const trunks::TPMT_PUBLIC& public_area,
+                              std::string* public_key_der);
+
+  // A key kept loaded by trunks, identified by its blob.
+  struct LoadedKey {
+    std::string blob;
+    trunks::TPM_HANDLE handle;
+  };
+
+  std::unique_ptr<trunks::TrunksFactoryImpl> default_trunks_factory_;
+  trunks::TrunksFactory* trunks_factory_;
+  std::unique_ptr<trunks::TpmUtility> trunks_utility_;
+  bool is_ready_{false};
+  // Keys loaded under the storage root key, most recently used first.
+  std::list<LoadedKey> loaded_keys_;
+  // Evicted keys are flushed together rather than one at a time.
+  std::unique_ptr<trunks::HandleFlushQueue> flush_queue_;
+
+  DISALLOW_COPY_AND_ASSIGN(TpmUtilityV2);
+};
+
+}  // namespace attestation
+
+#endif  // ATTESTATION_COMMON_TPM_UTILITY_V2_H_
@@ -0,0 +1,254 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "attestation/common/tpm_utility_v2.h"
+
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <trunks/mock_hmac_session.h>
+#include <trunks/mock_policy_session.h>
+#include <trunks/mock_tpm.h>
+#include <trunks/mock_tpm_state.h>
+#include <trunks/mock_tpm_utility.h>
+#include <trunks/trunks_factory_for_test.h>
+
+using testing::_;
+using testing::DoAll;
+using testing::NiceMock;
+using testing::Return;
+using testing::SetArgPointee;
+using trunks::TPM_RC_FAILURE;
+using trunks::TPM_RC_SUCCESS;
+
+namespace {
+
+trunks::TPMT_PUBLIC GetRSAPublicArea() {
+  trunks::TPMT_PUBLIC public_area = {};
+  public_area.type = trunks::TPM_ALG_RSA;
+  public_area.unique.rsa =
+      trunks::Make_TPM2B_PUBLIC_KEY_RSA(std::string(256, 'a'));
+  return public_area;
+}
+
+}  // namespace
+
+namespace attestation {
+
+class TpmUtilityV2Test : public testing::Test {
+ public:
+  TpmUtilityV2Test() : tpm_utility_(&trunks_factory_) {}
+  ~TpmUtilityV2Test() override = default;
+
+  void SetUp() override {
+    trunks_factory_.set_tpm(&mock_tpm_);
+    trunks_factory_.set_tpm_state(&mock_tpm_state_);
+    trunks_factory_.set_tpm_utility(&mock_tpm_utility_);
+    trunks_factory_.set_hmac_session(&mock_hmac_session_);
+    trunks_factory_.set_policy_session(&mock_policy_session_);
+    ON_CALL(mock_tpm_state_, IsEnabled()).WillByDefault(Return(true));
+    ON_CALL(mock_tpm_state_, IsOwned()).WillByDefault(Return(true));
+    ASSERT_TRUE(tpm_utility_.Initialize());
+  }
+
+ protected:
+  NiceMock<trunks::MockTpm> mock_tpm_;
+  NiceMock<trunks::MockTpmState> mock_tpm_state_;
+  NiceMock<trunks::MockTpmUtility> mock_tpm_utility_;
+  NiceMock<trunks::MockHmacSession> mock_hmac_session_;
+  NiceMock<trunks::MockPolicySession> mock_policy_session_;
+  trunks::TrunksFactoryForTest trunks_factory_;
+  TpmUtilityV2 tpm_utility_;
+};
+
+TEST_F(TpmUtilityV2Test, IsTpmReady) {
+  EXPECT_TRUE(tpm_utility_.IsTpmReady());
+}
+
+TEST_F(TpmUtilityV2Test, IsTpmReadyNotOwned) {
+  TpmUtilityV2 tpm_utility(&trunks_factory_);
+  EXPECT_CALL(mock_tpm_state_, IsOwned()).WillRepeatedly(Return(false));
+  ASSERT_TRUE(tpm_utility.Initialize());
+  EXPECT_FALSE(tpm_utility.IsTpmReady());
+}
+
+TEST_F(TpmUtilityV2Test, SignKeepsKeyLoaded) {
+  EXPECT_CALL(mock_tpm_utility_, LoadKey("key_blob", _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(trunks::TRANSIENT_FIRST),
+                      Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_utility_,
+              Sign(trunks::TRANSIENT_FIRST, trunks::TPM_ALG_RSASSA,
+                   trunks::TPM_ALG_SHA256, "data", _, _))
+      .Times(2)
+      .WillRepeatedly(
+          DoAll(SetArgPointee<5>("signature"), Return(TPM_RC_SUCCESS)));
+  std::string signature;
+  EXPECT_TRUE(tpm_utility_.Sign("key_blob", "data", &signature));
+  EXPECT_EQ("signature", signature);
+  EXPECT_TRUE(tpm_utility_.Sign("key_blob", "data", &signature));
+}
+
+TEST_F(TpmUtilityV2Test, SignFailureReloadsKey) {
+  EXPECT_CALL(mock_tpm_utility_, LoadKey("key_blob", _, _))
+      .Times(2)
+      .WillRepeatedly(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_tpm_utility_, Sign(_, _, _, _, _, _))
+      .WillOnce(Return(TPM_RC_FAILURE))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  std::string signature;
+  EXPECT_FALSE(tpm_utility_.Sign("key_blob", "data", &signature));
+  EXPECT_TRUE(tpm_utility_.Sign("key_blob", "data", &signature));
+}
+
+TEST_F(TpmUtilityV2Test, SignFile) {
+  EXPECT_CALL(mock_tpm_utility_,
+              SignFile(_, trunks::TPM_ALG_RSASSA, trunks::TPM_ALG_SHA256, 7, _,
+                       _))
+      .WillOnce(DoAll(SetArgPointee<5>("signature"), Return(TPM_RC_SUCCESS)));
+  std::string signature;
+  EXPECT_TRUE(tpm_utility_.SignFile("key_blob", 7, &signature));
+  EXPECT_EQ("signature", signature);
+}
+
+TEST_F(TpmUtilityV2Test, Unbind) {
+  EXPECT_CALL(mock_tpm_utility_,
+              AsymmetricDecrypt(_, trunks::TPM_ALG_OAEP, trunks::TPM_ALG_SHA1,
+                                "bound_data", _, _))
+      .WillOnce(DoAll(SetArgPointee<5>("data"), Return(TPM_RC_SUCCESS)));
+  std::string data;
+  EXPECT_TRUE(tpm_utility_.Unbind("key_blob", "bound_data", &data));
+  EXPECT_EQ("data", data);
+}
+
+TEST_F(TpmUtilityV2Test, SealAndUnseal) {
+  EXPECT_CALL(mock_tpm_utility_, GetPolicyDigestForPcrValue(0, "", _))
+      .WillOnce(DoAll(SetArgPointee<2>("policy"), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_utility_, SealData("data", "policy", _, _))
+      .WillOnce(DoAll(SetArgPointee<3>("sealed"), Return(TPM_RC_SUCCESS)));
+  std::string sealed_data;
+  EXPECT_TRUE(tpm_utility_.SealToPCR0("data", &sealed_data));
+  EXPECT_EQ("sealed", sealed_data);
+
+  EXPECT_CALL(mock_policy_session_, PolicyPCR(0, ""))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_tpm_utility_, UnsealData("sealed", _, _))
+      .WillOnce(DoAll(SetArgPointee<2>("data"), Return(TPM_RC_SUCCESS)));
+  std::string data;
+  EXPECT_TRUE(tpm_utility_.Unseal(sealed_data, &data));
+  EXPECT_EQ("data", data);
+}
+
+TEST_F(TpmUtilityV2Test, GetEndorsementPublicKeyPersistent) {
+  trunks::TPM2B_PUBLIC public_data =
+      trunks::Make_TPM2B_PUBLIC(GetRSAPublicArea());
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(0x81010001, _, _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(public_data), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_, CreatePrimarySyncShort(_, _, _, _, _, _, _, _, _, _))
+      .Times(0);
+  std::string public_key;
+  EXPECT_TRUE(tpm_utility_.GetEndorsementPublicKey(&public_key));
+  EXPECT_FALSE(public_key.empty());
+}
+
+TEST_F(TpmUtilityV2Test, GetEndorsementPublicKeyCreatesPrimary) {
+  trunks::TPM2B_PUBLIC public_data =
+      trunks::Make_TPM2B_PUBLIC(GetRSAPublicArea());
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(_, _, _, _, _, _))
+      .WillOnce(Return(trunks::TPM_RC_HANDLE));
+  trunks::TPM2B_PUBLIC in_public;
+  EXPECT_CALL(mock_tpm_, CreatePrimarySyncShort(trunks::TPM_RH_ENDORSEMENT, _,
+                                                _, _, _, _, _, _, _, _))
+      .WillOnce(DoAll(testing::SaveArg<1>(&in_public),
+                      SetArgPointee<4>(public_data), Return(TPM_RC_SUCCESS)));
+  std::string public_key;
+  EXPECT_TRUE(tpm_utility_.GetEndorsementPublicKey(&public_key));
+  EXPECT_FALSE(public_key.empty());
+  EXPECT_EQ(trunks::TPM_ALG_RSA, in_public.public_area.type);
+  EXPECT_EQ(32, in_public.public_area.auth_policy.size);
+}
+
+TEST_F(TpmUtilityV2Test, ActivateIdentity) {
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(_, _, _, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_policy_session_,
+              PolicySecret(trunks::TPM_RH_ENDORSEMENT, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  trunks::TPM2B_DIGEST credential_digest =
+      trunks::Make_TPM2B_DIGEST("credential");
+  EXPECT_CALL(mock_tpm_,
+              ActivateCredentialSync(_, _, 0x81010001, _, _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<6>(credential_digest),
+                      Return(TPM_RC_SUCCESS)));
+  std::string credential;
+  EXPECT_TRUE(tpm_utility_.ActivateIdentity("", "endorsement_password",
+                                            "identity_key_blob", "secret",
+                                            "credential_blob", &credential));
+  EXPECT_EQ("credential", credential);
+}
+
+TEST_F(TpmUtilityV2Test, ActivateIdentityPolicyFailure) {
+  EXPECT_CALL(mock_policy_session_, PolicySecret(_, _, _))
+      .WillOnce(Return(trunks::TPM_RC_AUTH_FAIL));
+  EXPECT_CALL(mock_tpm_, ActivateCredentialSync(_, _, _, _, _, _, _, _))
+      .Times(0);
+  std::string credential;
+  EXPECT_FALSE(tpm_utility_.ActivateIdentity("", "bad_password",
+                                             "identity_key_blob", "secret",
+                                             "credential_blob", &credential));
+}
+
+TEST_F(TpmUtilityV2Test, CreateCertifiedKey) {
+  EXPECT_CALL(mock_tpm_utility_,
+              CreateRSAKeyPair(trunks::TpmUtility::kSignKey, 2048, _, "", "",
+                               false, trunks::kNoCreationPCR, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<8>("key_blob"), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_utility_, GetKeyPublicArea(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(GetRSAPublicArea()), Return(TPM_RC_SUCCESS)));
+  trunks::TPM2B_ATTEST certify_info = trunks::Make_TPM2B_ATTEST("key_info");
+  trunks::TPMT_SIGNATURE signature = {};
+  signature.signature.rsassa.sig = trunks::Make_TPM2B_PUBLIC_KEY_RSA("proof");
+  EXPECT_CALL(mock_tpm_, CertifySync(_, _, _, _, _, _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<6>(certify_info),
+                      SetArgPointee<7>(signature), Return(TPM_RC_SUCCESS)));
+  std::string key_blob;
+  std::string public_key;
+  std::string public_key_tpm_format;
+  std::string key_info;
+  std::string proof;
+  EXPECT_TRUE(tpm_utility_.CreateCertifiedKey(
+      KEY_TYPE_RSA, KEY_USAGE_SIGN, "identity_key_blob", "external_data",
+      &key_blob, &public_key, &public_key_tpm_format, &key_info, &proof));
+  EXPECT_EQ("key_blob", key_blob);
+  EXPECT_FALSE(public_key.empty());
+  EXPECT_FALSE(public_key_tpm_format.empty());
+  EXPECT_EQ("key_info", key_info);
+  EXPECT_EQ("proof", proof);
+}
+
+TEST_F(TpmUtilityV2Test, CreateCertifiedKeyECCNotSupported) {
+  std::string key_blob;
+  std::string public_key;
+  std::string public_key_tpm_format;
+  std::string key_info;
+  std::string proof;
+  EXPECT_FALSE(tpm_utility_.CreateCertifiedKey(
+      KEY_TYPE_ECC, KEY_USAGE_SIGN, "identity_key_blob", "external_data",
+      &key_blob, &public_key, &public_key_tpm_format, &key_info, &proof));
+}
+
+}  // namespace attestation
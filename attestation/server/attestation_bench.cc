@@ -0,0 +1,981 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// attestation_bench measures attestation throughput and latency. It runs the
+// attestation service in-process on the real TPM, with a mock Attestation CA
+// in place of the network, and has many simulated users issue a weighted mix
+// of requests concurrently. Besides per-request latency it reports how long
+// each phase took: TPM key creation and certification, the CA round trip,
+// database saves and chaps registration.
+//
+// The device must already be enrolled. Database changes are written to a
+// scratch copy so the benchmark leaves the real attestation database intact.
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <base/barrier_closure.h>
+#include <base/bind.h>
+#include <base/command_line.h>
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/files/important_file_writer.h>
+#include <base/logging.h>
+#include <base/message_loop/message_loop.h>
+#include <base/run_loop.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/strings/stringprintf.h>
+#include <base/synchronization/lock.h>
+#include <base/threading/platform_thread.h>
+#include <base/time/time.h>
+#include <brillo/http/http_transport_fake.h>
+#include <brillo/mime_utils.h>
+#include <brillo/syslog_logging.h>
+#include <chaps/token_manager_client.h>
+
+#include "attestation/common/attestation_ca.pb.h"
+#include "attestation/common/crypto_utility_impl.h"
+#if defined(USE_TPM2)
+#include "attestation/common/tpm_utility_v2.h"
+#else
+#include "attestation/common/tpm_utility_v1.h"
+#endif
+#include "attestation/server/attestation_service.h"
+#include "attestation/server/database_impl.h"
+#include "attestation/server/pkcs11_key_store.h"
+
+namespace attestation {
+namespace {
+
+using brillo::http::fake::ServerRequest;
+using brillo::http::fake::ServerResponse;
+
+const char kDefaultWorkload[] = "create:1,sign:4,decrypt:2,key_info:4";
+const int kDefaultUsers = 10;
+const int kDefaultDurationSeconds = 30;
+const int kDefaultCALatencyMs = 100;
+const char kDefaultScratchDir[] =
+    "/mnt/stateful_partition/unencrypted/preserve";
+const char kScratchDatabaseName[] = "attestation_bench.epb";
+const char kDataToSign[] = "attestation_bench";
+const char kDataToEncrypt[] = "attestation_bench";
+
+enum Operation {
+  kCreate,
+  kSign,
+  kDecrypt,
+  kKeyInfo,
+  kRegister,
+  kNumOperations,
+};
+
+const char* const kOperationNames[kNumOperations] = {
+    "create", "sign", "decrypt", "key_info", "register",
+};
+
+enum Phase {
+  kTpmCreateCertifiedKey,
+  kTpmSign,
+  kTpmUnbind,
+  kCARoundTrip,
+  kDatabaseSave,
+  kKeyStoreWrite,
+  kChapsRegisterKey,
+  kChapsRegisterCertificate,
+  kNumPhases,
+};
+
+const char* const kPhaseNames[kNumPhases] = {
+    "tpm_keygen_certify", "tpm_sign",      "tpm_unbind",
+    "aca_round_trip",     "database_save", "key_store_write",
+    "chaps_register_key", "chaps_register_cert",
+};
+
+void PrintUsage() {
+  puts("Usage: attestation_bench [options]");
+  printf("  --users=<N> - Concurrent simulated users, %d by default.\n",
+         kDefaultUsers);
+  printf("  --duration=<seconds> - How long to run, %d by default.\n",
+         kDefaultDurationSeconds);
+  puts("  --workload=<op>:<weight>,... - The request mix. Operations:");
+  puts("      create (CreateGoogleAttestedKey), sign, decrypt, key_info and");
+  puts("      register (RegisterKeyWithChapsToken). The default is:");
+  printf("      %s\n", kDefaultWorkload);
+  printf("  --aca_latency_ms=<N> - Mock CA response time, %d by default.\n",
+         kDefaultCALatencyMs);
+  puts("  --username=<user> - Creates keys for a signed-in user instead of");
+  puts("      device keys. register adds keys to this user's chaps token, or");
+  puts("      to the system token without --username.");
+  puts("  --scratch_dir=<dir> - Where database changes are written, by");
+  printf("      default %s.\n", kDefaultScratchDir);
+  puts("  --seed=<N> - Seeds the request mix, 1 by default.");
+  puts("  --json - Prints results as JSON.");
+}
+
+// Parses a |workload| into one weight per operation. Returns false if it names
+// an unknown operation or has no positive weight.
+bool ParseWorkload(const std::string& workload, std::vector<int>* weights) {
+  weights->assign(kNumOperations, 0);
+  base::StringPairs pairs;
+  if (!base::SplitStringIntoKeyValuePairs(workload, ':', ',', &pairs)) {
+    return false;
+  }
+  int total = 0;
+  for (const auto& pair : pairs) {
+    const char* const* name = std::find(
+        kOperationNames, kOperationNames + kNumOperations, pair.first);
+    int weight = 0;
+    if (name == kOperationNames + kNumOperations ||
+        !base::StringToInt(pair.second, &weight) || weight < 0) {
+      LOG(ERROR) << "Invalid workload entry: " << pair.first;
+      return false;
+    }
+    (*weights)[name - kOperationNames] = weight;
+    total += weight;
+  }
+  return total > 0;
+}
+
+// Collects phase durations. Phases are timed on the service threads and read
+// on the main thread.
+class PhaseRecorder {
+ public:
+  PhaseRecorder() {}
+
+  void Record(Phase phase, base::TimeDelta duration) {
+    base::AutoLock lock(lock_);
+    durations_[phase].push_back(duration);
+  }
+
+  // Discards everything recorded so far.
+  void Clear() {
+    base::AutoLock lock(lock_);
+    for (auto& durations : durations_) {
+      durations.clear();
+    }
+  }
+
+  // Returns the durations recorded for |phase| in ascending order.
+  std::vector<base::TimeDelta> GetSorted(Phase phase) {
+    base::AutoLock lock(lock_);
+    std::vector<base::TimeDelta> durations = durations_[phase];
+    std::sort(durations.begin(), durations.end());
+    return durations;
+  }
+
+ private:
+  base::Lock lock_;
+  std::vector<base::TimeDelta> durations_[kNumPhases];
+
+  DISALLOW_COPY_AND_ASSIGN(PhaseRecorder);
+};
+
+// Records the lifetime of the object as one |phase|.
+class ScopedPhaseTimer {
+ public:
+  ScopedPhaseTimer(PhaseRecorder* recorder, Phase phase)
+      : recorder_(recorder), phase_(phase), start_(base::TimeTicks::Now()) {}
+  ~ScopedPhaseTimer() {
+    recorder_->Record(phase_, base::TimeTicks::Now() - start_);
+  }
+
+ private:
+  PhaseRecorder* recorder_;
+  const Phase phase_;
+  const base::TimeTicks start_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedPhaseTimer);
+};
+
+// Times the TPM operations behind key creation, signing and decryption.
+class TimingTpmUtility : public TpmUtility {
+ public:
+  TimingTpmUtility(TpmUtility* tpm_utility, PhaseRecorder* recorder)
+      : tpm_utility_(tpm_utility), recorder_(recorder) {}
+  ~TimingTpmUtility() override = default;
+
+  // TpmUtility methods.
+  bool IsTpmReady() override { return tpm_utility_->IsTpmReady(); }
+  bool ActivateIdentity(const std::string& delegate_blob,
+                        const std::string& delegate_secret,
+                        const std::string& identity_key_blob,
+                        const std::string& asym_ca_contents,
+                        const std::string& sym_ca_attestation,
+                        std::string* credential) override {
+    return tpm_utility_->ActivateIdentity(
+        delegate_blob, delegate_secret, identity_key_blob, asym_ca_contents,
+        sym_ca_attestation, credential);
+  }
+  bool CreateCertifiedKey(KeyType key_type,
+                          KeyUsage key_usage,
+                          const std::string& identity_key_blob,
+                          const std::string& external_data,
+                          std::string* key_blob,
+                          std::string* public_key,
+                          std::string* public_key_tpm_format,
+                          std::string* key_info,
+                          std::string* proof) override {
+    ScopedPhaseTimer timer(recorder_, kTpmCreateCertifiedKey);
+    return tpm_utility_->CreateCertifiedKey(
+        key_type, key_usage, identity_key_blob, external_data, key_blob,
+        public_key, public_key_tpm_format, key_info, proof);
+  }
+  bool SealToPCR0(const std::string& data, std::string* sealed_data) override {
+    return tpm_utility_->SealToPCR0(data, sealed_data);
+  }
+  bool Unseal(const std::string& sealed_data, std::string* data) override {
+    return tpm_utility_->Unseal(sealed_data, data);
+  }
+  bool GetEndorsementPublicKey(std::string* public_key) override {
+    return tpm_utility_->GetEndorsementPublicKey(public_key);
+  }
+  bool Unbind(const std::string& key_blob,
+              const std::string& bound_data,
+              std::string* data) override {
+    ScopedPhaseTimer timer(recorder_, kTpmUnbind);
+    return tpm_utility_->Unbind(key_blob, bound_data, data);
+  }
+  bool Sign(const std::string& key_blob,
+            const std::string& data_to_sign,
+            std::string* signature) override {
+    ScopedPhaseTimer timer(recorder_, kTpmSign);
+    return tpm_utility_->Sign(key_blob, data_to_sign, signature);
+  }
+  bool SignFile(const std::string& key_blob,
+                int fd,
+                std::string* signature) override {
+    ScopedPhaseTimer timer(recorder_, kTpmSign);
+    return tpm_utility_->SignFile(key_blob, fd, signature);
+  }
+
+ private:
+  TpmUtility* tpm_utility_;
+  PhaseRecorder* recorder_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimingTpmUtility);
+};
+
+// Reads the real attestation database but writes changes to a scratch file,
+// the same way DatabaseImpl writes the real one.
+class ScratchDatabaseIO : public DatabaseIO {
+ public:
+  ScratchDatabaseIO(DatabaseIO* source, const base::FilePath& scratch_path)
+      : source_(source), scratch_path_(scratch_path) {}
+  ~ScratchDatabaseIO() = default;
+
+  // DatabaseIO methods.
+  bool Read(std::string* data) override {
+    if (base::PathExists(scratch_path_)) {
+      return base::ReadFileToString(scratch_path_, data);
+    }
+    return source_->Read(data);
+  }
+  bool Write(const std::string& data) override {
+    if (!base::ImportantFileWriter::WriteFileAtomically(scratch_path_, data)) {
+      LOG(ERROR) << "Failed to write file: " << scratch_path_.value();
+      return false;
+    }
+    return true;
+  }
+  // The scratch copy diverges from the real database by design.
+  void Watch(const base::Closure& callback) override {}
+
+ private:
+  DatabaseIO* source_;
+  const base::FilePath scratch_path_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScratchDatabaseIO);
+};
+
+// A DatabaseImpl on a scratch copy which times each save. DatabaseImpl must
+// be used on one thread, so it is initialized by the first call, which comes
+// from the service worker thread.
+class BenchDatabase : public Database {
+ public:
+  BenchDatabase(CryptoUtility* crypto,
+                const base::FilePath& scratch_path,
+                PhaseRecorder* recorder)
+      : database_(crypto),
+        io_(&database_, scratch_path),
+        recorder_(recorder) {
+    database_.set_io(&io_);
+  }
+  ~BenchDatabase() override = default;
+
+  // Database methods.
+  const AttestationDatabase& GetProtobuf() const override {
+    EnsureInitialized();
+    return database_.GetProtobuf();
+  }
+  const CertifiedKey* FindDeviceKey(
+      const std::string& key_name) const override {
+    EnsureInitialized();
+    return database_.FindDeviceKey(key_name);
+  }
+  const OriginTemporalIndexes* FindTemporalIndexes(
+      const std::string& origin_hash) const override {
+    EnsureInitialized();
+    return database_.FindTemporalIndexes(origin_hash);
+  }
+  void AddTemporalIndexRecord(const std::string& user_hash,
+                              const std::string& origin_hash,
+                              int temporal_index) override {
+    EnsureInitialized();
+    database_.AddTemporalIndexRecord(user_hash, origin_hash, temporal_index);
+  }
+  AttestationDatabase* GetMutableProtobuf() override {
+    EnsureInitialized();
+    return database_.GetMutableProtobuf();
+  }
+  bool SaveChanges() override {
+    EnsureInitialized();
+    ScopedPhaseTimer timer(recorder_, kDatabaseSave);
+    return database_.SaveChanges();
+  }
+  void ScheduleSaveChanges() override {
+    EnsureInitialized();
+    database_.ScheduleSaveChanges();
+  }
+  bool Reload() override {
+    EnsureInitialized();
+    return database_.Reload();
+  }
+  void SetReloadCallback(const base::Closure& callback) override {
+    database_.SetReloadCallback(callback);
+  }
+
+ private:
+  void EnsureInitialized() const {
+    if (!initialized_) {
+      database_.Initialize();
+      initialized_ = true;
+    }
+  }
+
+  mutable DatabaseImpl database_;
+  ScratchDatabaseIO io_;
+  PhaseRecorder* recorder_;
+  mutable bool initialized_{false};
+
+  DISALLOW_COPY_AND_ASSIGN(BenchDatabase);
+};
+
+// Times writes to the key store and chaps registration.
+class TimingKeyStore : public KeyStore {
+ public:
+  TimingKeyStore(KeyStore* key_store, PhaseRecorder* recorder)
+      : key_store_(key_store), recorder_(recorder) {}
+  ~TimingKeyStore() override = default;
+
+  // KeyStore methods.
+  bool Read(const std::string& username,
+            const std::string& key_label,
+            std::string* key_data) override {
+    return key_store_->Read(username, key_label, key_data);
+  }
+  bool Write(const std::string& username,
+             const std::string& key_label,
+             const std::string& key_data) override {
+    ScopedPhaseTimer timer(recorder_, kKeyStoreWrite);
+    return key_store_->Write(username, key_label, key_data);
+  }
+  bool Delete(const std::string& username,
+              const std::string& key_label) override {
+    return key_store_->Delete(username, key_label);
+  }
+  bool DeleteByPrefix(const std::string& username,
+                      const std::string& key_prefix) override {
+    return key_store_->DeleteByPrefix(username, key_prefix);
+  }
+  bool DeleteByPrefixes(
+      const std::vector<std::string>& usernames,
+      const std::vector<std::string>& key_prefixes) override {
+    return key_store_->DeleteByPrefixes(usernames, key_prefixes);
+  }
+  bool Register(const std::string& username,
+                const std::string& label,
+                KeyType key_type,
+                KeyUsage key_usage,
+                const std::string& private_key_blob,
+                const std::string& public_key_der,
+                const std::string& certificate) override {
+    ScopedPhaseTimer timer(recorder_, kChapsRegisterKey);
+    return key_store_->Register(username, label, key_type, key_usage,
+                                private_key_blob, public_key_der, certificate);
+  }
+  bool RegisterCertificate(const std::string& username,
+                           const std::string& certificate) override {
+    ScopedPhaseTimer timer(recorder_, kChapsRegisterCertificate);
+    return key_store_->RegisterCertificate(username, certificate);
+  }
+  bool RegisterWithCertificateChain(
+      const std::string& username,
+      const std::string& label,
+      KeyType key_type,
+      KeyUsage key_usage,
+      const std::string& private_key_blob,
+      const std::string& public_key_der,
+      const std::string& certificate,
+      const std::vector<std::string>& intermediate_ca_certs) override {
+    ScopedPhaseTimer timer(recorder_, kChapsRegisterKey);
+    return key_store_->RegisterWithCertificateChain(
+        username, label, key_type, key_usage, private_key_blob, public_key_der,
+        certificate, intermediate_ca_certs);
+  }
+
+ private:
+  KeyStore* key_store_;
+  PhaseRecorder* recorder_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimingKeyStore);
+};
+
+// An Attestation CA which issues certificates after a fixed delay. It does
+// not enroll devices because that needs the real CA's keys.
+class MockCA {
+ public:
+  MockCA(base::TimeDelta latency, PhaseRecorder* recorder)
+      : latency_(latency), recorder_(recorder) {}
+
+  // Serves requests to |origin| made through |transport|.
+  void Install(const std::string& origin,
+               brillo::http::fake::Transport* transport) {
+    transport->AddHandler(
+        origin + "/enroll", brillo::http::request_type::kPost,
+        base::Bind(&MockCA::Enroll, base::Unretained(this)));
+    transport->AddHandler(origin + "/sign", brillo::http::request_type::kPost,
+                          base::Bind(&MockCA::Sign, base::Unretained(this)));
+  }
+
+ private:
+  void Enroll(const ServerRequest& request, ServerResponse* response) {
+    AttestationEnrollmentResponse response_pb;
+    response_pb.set_status(SERVER_ERROR);
+    response_pb.set_detail("The mock CA does not enroll devices.");
+    Reply(response_pb, response);
+  }
+
+  void Sign(const ServerRequest& request, ServerResponse* response) {
+    // The service waits for the reply so this covers the whole round trip.
+    ScopedPhaseTimer timer(recorder_, kCARoundTrip);
+    base::PlatformThread::Sleep(latency_);
+    AttestationCertificateRequest request_pb;
+    AttestationCertificateResponse response_pb;
+    if (!request_pb.ParseFromString(request.GetDataAsString())) {
+      response_pb.set_status(BAD_REQUEST);
+      response_pb.set_detail("Failed to parse request.");
+    } else {
+      response_pb.set_status(OK);
+      response_pb.set_message_id(request_pb.message_id());
+      response_pb.set_certified_key_credential("bench_certificate");
+      response_pb.set_intermediate_ca_cert("bench_ca_certificate");
+    }
+    Reply(response_pb, response);
+  }
+
+  template <typename ResponseProtobufType>
+  void Reply(const ResponseProtobufType& response_pb,
+             ServerResponse* response) {
+    std::string data;
+    response_pb.SerializeToString(&data);
+    response->ReplyText(brillo::http::status_code::Ok, data,
+                        brillo::mime::application::kOctet_stream);
+  }
+
+  const base::TimeDelta latency_;
+  PhaseRecorder* recorder_;
+
+  DISALLOW_COPY_AND_ASSIGN(MockCA);
+};
+
+struct OperationResults {
+  std::vector<base::TimeDelta> latencies;
+  uint64_t failures = 0;
+};
+
+// A simulated user with one request outstanding at a time. Each user signs and
+// decrypts with its own pair of keys, created during setup. Users run on the
+// main thread; the service runs their requests on its threads as it does for
+// D-Bus clients.
+class SimulatedUser {
+ public:
+  SimulatedUser(int id,
+                const std::string& username,
+                const std::vector<int>& weights,
+                uint32_t seed,
+                AttestationInterface* service,
+                CryptoUtility* crypto_utility)
+      : id_(id),
+        username_(username),
+        service_(service),
+        crypto_utility_(crypto_utility),
+        random_(seed + id),
+        choose_operation_(weights.begin(), weights.end()) {}
+
+  // Creates the user's keys and runs |done|. setup_ok() reports the result.
+  void SetUp(const base::Closure& done) {
+    setup_done_ = done;
+    CreateGoogleAttestedKeyRequest request =
+        MakeCreateRequest(GetSetupKeyLabel(KEY_USAGE_SIGN), KEY_USAGE_SIGN);
+    service_->CreateGoogleAttestedKey(
+        request, base::Bind(&SimulatedUser::OnSignKeyCreated,
+                            base::Unretained(this)));
+  }
+
+  // Issues requests until |end_time|, then runs |done|.
+  void Run(base::TimeTicks end_time, const base::Closure& done) {
+    end_time_ = end_time;
+    run_done_ = done;
+    Next();
+  }
+
+  bool setup_ok() const { return setup_ok_; }
+  const OperationResults& results(Operation operation) const {
+    return results_[operation];
+  }
+
+ private:
+  std::string GetSetupKeyLabel(KeyUsage key_usage) const {
+    return base::StringPrintf(
+        "bench_%d_%s", id_, key_usage == KEY_USAGE_SIGN ? "sign" : "decrypt");
+  }
+
+  CreateGoogleAttestedKeyRequest MakeCreateRequest(const std::string& label,
+                                                   KeyUsage key_usage) const {
+    CreateGoogleAttestedKeyRequest request;
+    request.set_key_label(label);
+    request.set_key_type(KEY_TYPE_RSA);
+    request.set_key_usage(key_usage);
+    request.set_certificate_profile(username_.empty()
+                                        ? ENTERPRISE_MACHINE_CERTIFICATE
+                                        : ENTERPRISE_USER_CERTIFICATE);
+    request.set_username(username_);
+    return request;
+  }
+
+  void OnSignKeyCreated(const CreateGoogleAttestedKeyReply& reply) {
+    if (reply.status() != STATUS_SUCCESS) {
+      LOG(ERROR) << "User " << id_ << ": Failed to create key: "
+                 << reply.status() << " " << reply.server_error();
+      setup_done_.Run();
+      return;
+    }
+    CreateGoogleAttestedKeyRequest request = MakeCreateRequest(
+        GetSetupKeyLabel(KEY_USAGE_DECRYPT), KEY_USAGE_DECRYPT);
+    service_->CreateGoogleAttestedKey(
+        request, base::Bind(&SimulatedUser::OnDecryptKeyCreated,
+                            base::Unretained(this)));
+  }
+
+  void OnDecryptKeyCreated(const CreateGoogleAttestedKeyReply& reply) {
+    if (reply.status() != STATUS_SUCCESS) {
+      LOG(ERROR) << "User " << id_ << ": Failed to create key: "
+                 << reply.status() << " " << reply.server_error();
+      setup_done_.Run();
+      return;
+    }
+    GetKeyInfoRequest request;
+    request.set_key_label(GetSetupKeyLabel(KEY_USAGE_DECRYPT));
+    request.set_username(username_);
+    service_->GetKeyInfo(request, base::Bind(&SimulatedUser::OnDecryptKeyInfo,
+                                             base::Unretained(this)));
+  }
+
+  void OnDecryptKeyInfo(const GetKeyInfoReply& reply) {
+    if (reply.status() != STATUS_SUCCESS ||
+        !crypto_utility_->EncryptForUnbind(reply.public_key(), kDataToEncrypt,
+                                           &encrypted_data_)) {
+      LOG(ERROR) << "User " << id_ << ": Failed to encrypt data.";
+    } else {
+      setup_ok_ = true;
+    }
+    setup_done_.Run();
+  }
+
+  void Next() {
+    if (base::TimeTicks::Now() >= end_time_) {
+      run_done_.Run();
+      return;
+    }
+    Operation operation =
+        static_cast<Operation>(choose_operation_(random_));
+    // There is nothing to register until a key has been created.
+    if (operation == kRegister && unregistered_keys_.empty()) {
+      operation = kCreate;
+    }
+    base::TimeTicks start = base::TimeTicks::Now();
+    switch (operation) {
+      case kCreate: {
+        std::string label =
+            base::StringPrintf("bench_%d_%d", id_, next_key_id_++);
+        service_->CreateGoogleAttestedKey(
+            MakeCreateRequest(label, KEY_USAGE_SIGN),
+            base::Bind(&SimulatedUser::OnKeyCreated, base::Unretained(this),
+                       label, start));
+        break;
+      }
+      case kSign: {
+        SignRequest request;
+        request.set_key_label(GetSetupKeyLabel(KEY_USAGE_SIGN));
+        request.set_username(username_);
+        request.set_data_to_sign(kDataToSign);
+        service_->Sign(request,
+                       base::Bind(&SimulatedUser::OnReply<SignReply>,
+                                  base::Unretained(this), operation, start));
+        break;
+      }
+      case kDecrypt: {
+        DecryptRequest request;
+        request.set_key_label(GetSetupKeyLabel(KEY_USAGE_DECRYPT));
+        request.set_username(username_);
+        request.set_encrypted_data(encrypted_data_);
+        service_->Decrypt(request,
+                          base::Bind(&SimulatedUser::OnReply<DecryptReply>,
+                                     base::Unretained(this), operation, start));
+        break;
+      }
+      case kKeyInfo: {
+        GetKeyInfoRequest request;
+        request.set_key_label(GetSetupKeyLabel(KEY_USAGE_SIGN));
+        request.set_username(username_);
+        service_->GetKeyInfo(
+            request, base::Bind(&SimulatedUser::OnReply<GetKeyInfoReply>,
+                                base::Unretained(this), operation, start));
+        break;
+      }
+      case kRegister: {
+        // Registration moves the key to chaps so each key is registered once.
+        RegisterKeyWithChapsTokenRequest request;
+        request.set_key_label(unregistered_keys_.back());
+        request.set_username(username_);
+        unregistered_keys_.pop_back();
+        service_->RegisterKeyWithChapsToken(
+            request,
+            base::Bind(&SimulatedUser::OnReply<RegisterKeyWithChapsTokenReply>,
+                       base::Unretained(this), operation, start));
+        break;
+      }
+      default:
+        NOTREACHED();
+    }
+  }
+
+  void OnKeyCreated(const std::string& label,
+                    base::TimeTicks start,
+                    const CreateGoogleAttestedKeyReply& reply) {
+    if (reply.status() == STATUS_SUCCESS) {
+      unregistered_keys_.push_back(label);
+    }
+    OnReply(kCreate, start, reply);
+  }
+
+  template <typename ReplyProtobufType>
+  void OnReply(Operation operation,
+               base::TimeTicks start,
+               const ReplyProtobufType& reply) {
+    if (reply.status() == STATUS_SUCCESS) {
+      results_[operation].latencies.push_back(base::TimeTicks::Now() - start);
+    } else {
+      ++results_[operation].failures;
+    }
+    Next();
+  }
+
+  const int id_;
+  const std::string username_;
+  AttestationInterface* service_;
+  CryptoUtility* crypto_utility_;
+  std::minstd_rand random_;
+  std::discrete_distribution<int> choose_operation_;
+  base::Closure setup_done_;
+  bool setup_ok_{false};
+  std::string encrypted_data_;
+  base::TimeTicks end_time_;
+  base::Closure run_done_;
+  int next_key_id_{0};
+  std::vector<std::string> unregistered_keys_;
+  OperationResults results_[kNumOperations];
+
+  DISALLOW_COPY_AND_ASSIGN(SimulatedUser);
+};
+
+// Returns the |percentile| of sorted |latencies| in microseconds.
+int64_t GetPercentile(const std::vector<base::TimeDelta>& latencies,
+                      int percentile) {
+  if (latencies.empty()) {
+    return 0;
+  }
+  size_t index = std::min(latencies.size() - 1,
+                          latencies.size() * percentile / 100);
+  return latencies[index].InMicroseconds();
+}
+
+// Formats one row of results: a |name|, the sorted |latencies| and, when
+// |failures| is not null, a failure count.
+void AppendRow(const std::string& name,
+               const std::vector<base::TimeDelta>& latencies,
+               const uint64_t* failures,
+               double seconds,
+               bool json,
+               bool first,
+               std::string* output) {
+  base::TimeDelta total;
+  for (const auto& latency : latencies) {
+    total += latency;
+  }
+  if (json) {
+    base::StringAppendF(output, "%s\"%s\": {\"count\": %zu, ",
+                        first ? "" : ", ", name.c_str(), latencies.size());
+    if (failures) {
+      base::StringAppendF(output, "\"failures\": %llu, \"ops_per_sec\": %.2f, ",
+                          static_cast<unsigned long long>(*failures),
+                          latencies.size() / seconds);
+    } else {
+      base::StringAppendF(output, "\"total_ms\": %lld, ",
+                          static_cast<long long>(total.InMilliseconds()));
+    }
+    base::StringAppendF(
+        output, "\"p50_us\": %lld, \"p95_us\": %lld, \"p99_us\": %lld}",
+        static_cast<long long>(GetPercentile(latencies, 50)),
+        static_cast<long long>(GetPercentile(latencies, 95)),
+        static_cast<long long>(GetPercentile(latencies, 99)));
+    return;
+  }
+  if (failures) {
+    base::StringAppendF(output, "%-20s %8zu %8llu %10.2f", name.c_str(),
+                        latencies.size(),
+                        static_cast<unsigned long long>(*failures),
+                        latencies.size() / seconds);
+  } else {
+    base::StringAppendF(output, "%-20s %8zu %10lld", name.c_str(),
+                        latencies.size(),
+                        static_cast<long long>(total.InMilliseconds()));
+  }
+  base::StringAppendF(output, " %10lld %10lld %10lld\n",
+                      static_cast<long long>(GetPercentile(latencies, 50)),
+                      static_cast<long long>(GetPercentile(latencies, 95)),
+                      static_cast<long long>(GetPercentile(latencies, 99)));
+}
+
+// Formats the request |results| and phase durations of a run of |elapsed|
+// time with |users| simulated users.
+std::string FormatResults(OperationResults* results,
+                          PhaseRecorder* recorder,
+                          int users,
+                          base::TimeDelta elapsed,
+                          bool json) {
+  double seconds = elapsed.InSecondsF();
+  uint64_t total_ops = 0;
+  for (int i = 0; i < kNumOperations; ++i) {
+    total_ops += results[i].latencies.size();
+  }
+  std::string output;
+  if (json) {
+    base::StringAppendF(&output,
+                        "{\"users\": %d, \"duration_s\": %.3f, "
+                        "\"total_ops\": %llu, \"ops_per_sec\": %.2f, "
+                        "\"operations\": {",
+                        users, seconds,
+                        static_cast<unsigned long long>(total_ops),
+                        total_ops / seconds);
+  } else {
+    base::StringAppendF(&output, "%-20s %8s %8s %10s %10s %10s %10s\n",
+                        "operation", "count", "failed", "ops/s", "p50_us",
+                        "p95_us", "p99_us");
+  }
+  bool first = true;
+  for (int i = 0; i < kNumOperations; ++i) {
+    OperationResults& result = results[i];
+    if (result.latencies.empty() && result.failures == 0) {
+      continue;
+    }
+    std::sort(result.latencies.begin(), result.latencies.end());
+    AppendRow(kOperationNames[i], result.latencies, &result.failures, seconds,
+              json, first, &output);
+    first = false;
+  }
+  if (json) {
+    output += "}, \"phases\": {";
+  } else {
+    base::StringAppendF(&output, "\n%-20s %8s %10s %10s %10s %10s\n", "phase",
+                        "count", "total_ms", "p50_us", "p95_us", "p99_us");
+  }
+  first = true;
+  for (int i = 0; i < kNumPhases; ++i) {
+    std::vector<base::TimeDelta> durations =
+        recorder->GetSorted(static_cast<Phase>(i));
+    if (durations.empty()) {
+      continue;
+    }
+    AppendRow(kPhaseNames[i], durations, nullptr, seconds, json, first,
+              &output);
+    first = false;
+  }
+  if (json) {
+    output += "}}\n";
+  } else {
+    base::StringAppendF(&output, "\n%d users, %.1f s: %llu ops, %.2f ops/s\n",
+                        users, seconds,
+                        static_cast<unsigned long long>(total_ops),
+                        total_ops / seconds);
+  }
+  return output;
+}
+
+int RunBenchmark(base::CommandLine* cl) {
+  int users = kDefaultUsers;
+  int duration = kDefaultDurationSeconds;
+  int aca_latency_ms = kDefaultCALatencyMs;
+  uint32_t seed = 1;
+  std::vector<int> weights;
+  std::string workload = kDefaultWorkload;
+  if (cl->HasSwitch("workload")) {
+    workload = cl->GetSwitchValueASCII("workload");
+  }
+  if ((cl->HasSwitch("users") &&
+       !base::StringToInt(cl->GetSwitchValueASCII("users"), &users)) ||
+      users < 1 ||
+      (cl->HasSwitch("duration") &&
+       !base::StringToInt(cl->GetSwitchValueASCII("duration"), &duration)) ||
+      duration < 1 ||
+      (cl->HasSwitch("aca_latency_ms") &&
+       !base::StringToInt(cl->GetSwitchValueASCII("aca_latency_ms"),
+                          &aca_latency_ms)) ||
+      aca_latency_ms < 0 ||
+      (cl->HasSwitch("seed") &&
+       !base::StringToUint(cl->GetSwitchValueASCII("seed"), &seed)) ||
+      !ParseWorkload(workload, &weights)) {
+    PrintUsage();
+    return -1;
+  }
+  std::string username = cl->GetSwitchValueASCII("username");
+  base::FilePath scratch_dir(kDefaultScratchDir);
+  if (cl->HasSwitch("scratch_dir")) {
+    scratch_dir = cl->GetSwitchValuePath("scratch_dir");
+  }
+  base::FilePath scratch_path = scratch_dir.Append(kScratchDatabaseName);
+  // Start from the real database, not from a previous run.
+  base::DeleteFile(scratch_path, false);
+
+  base::MessageLoopForIO message_loop;
+  PhaseRecorder recorder;
+#if defined(USE_TPM2)
+  TpmUtilityV2 tpm_utility;
+#else
+  TpmUtilityV1 tpm_utility;
+#endif
+  if (!tpm_utility.Initialize()) {
+    LOG(ERROR) << "Failed to initialize the TPM.";
+    return -1;
+  }
+  TimingTpmUtility timing_tpm_utility(&tpm_utility, &recorder);
+  CryptoUtilityImpl crypto_utility(&timing_tpm_utility);
+  BenchDatabase database(&crypto_utility, scratch_path, &recorder);
+  chaps::TokenManagerClient token_manager;
+  Pkcs11KeyStore key_store(&token_manager);
+  TimingKeyStore timing_key_store(&key_store, &recorder);
+  auto transport = std::make_shared<brillo::http::fake::Transport>();
+  MockCA mock_ca(base::TimeDelta::FromMilliseconds(aca_latency_ms),
+                 &recorder);
+  std::vector<std::unique_ptr<SimulatedUser>> simulated_users;
+  OperationResults results[kNumOperations];
+  base::TimeDelta elapsed;
+  bool setup_ok = true;
+  {
+    // The service is destroyed first so its threads stop before the objects
+    // they use.
+    AttestationService service;
+    service.set_crypto_utility(&crypto_utility);
+    service.set_database(&database);
+    service.set_http_transport(transport);
+    service.set_key_store(&timing_key_store);
+    service.set_tpm_utility(&timing_tpm_utility);
+    if (!service.Initialize()) {
+      LOG(ERROR) << "Failed to initialize the attestation service.";
+      return -1;
+    }
+    mock_ca.Install(service.attestation_ca_origin(), transport.get());
+
+    base::RunLoop setup_loop;
+    base::Closure setup_done = base::BarrierClosure(users,
+                                                    setup_loop.QuitClosure());
+    for (int i = 0; i < users; ++i) {
+      simulated_users.emplace_back(new SimulatedUser(
+          i, username, weights, seed, &service, &crypto_utility));
+      simulated_users.back()->SetUp(setup_done);
+    }
+    // Key creation during setup is not part of the results.
+    setup_loop.Run();
+    for (const auto& user : simulated_users) {
+      setup_ok = setup_ok && user->setup_ok();
+    }
+    if (setup_ok) {
+      recorder.Clear();
+      base::RunLoop run_loop;
+      base::Closure run_done =
+          base::BarrierClosure(users, run_loop.QuitClosure());
+      base::TimeTicks start = base::TimeTicks::Now();
+      base::TimeTicks end_time =
+          start + base::TimeDelta::FromSeconds(duration);
+      for (const auto& user : simulated_users) {
+        user->Run(end_time, run_done);
+      }
+      run_loop.Run();
+      elapsed = base::TimeTicks::Now() - start;
+    }
+  }
+  base::DeleteFile(scratch_path, false);
+  if (!setup_ok) {
+    LOG(ERROR) << "Benchmark setup failed. Is the device enrolled?";
+    return -1;
+  }
+  for (const auto& user : simulated_users) {
+    for (int op = 0; op < kNumOperations; ++op) {
+      const OperationResults& user_results =
+          user->results(static_cast<Operation>(op));
+      results[op].latencies.insert(results[op].latencies.end(),
+                                   user_results.latencies.begin(),
+                                   user_results.latencies.end());
+      results[op].failures += user_results.failures;
+    }
+  }
+  fputs(FormatResults(results, &recorder, users, elapsed,
+                      cl->HasSwitch("json"))
+            .c_str(),
+        stdout);
+  return 0;
+}
+
+}  // namespace
+}  // namespace attestation
+
+int main(int argc, char** argv) {
+  base::CommandLine::Init(argc, argv);
+  brillo::InitLog(brillo::kLogToStderr);
+  base::CommandLine* cl = base::CommandLine::ForCurrentProcess();
+  if (cl->HasSwitch("help")) {
+    attestation::PrintUsage();
+    return 0;
+  }
+  return attestation::RunBenchmark(cl);
+}
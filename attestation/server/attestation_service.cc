@@ -16,16 +16,24 @@
 
 #include "attestation/server/attestation_service.h"
 
+#include <fcntl.h>
+
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include <base/callback.h>
+#include <base/posix/eintr_wrapper.h>
+#include <base/synchronization/waitable_event.h>
 #include <brillo/bind_lambda.h>
-#include <brillo/data_encoding.h>
 #include <brillo/http/http_utils.h>
+#include <brillo/message_loops/base_message_loop.h>
 #include <brillo/mime_utils.h>
 #include <crypto/sha2.h>
+#include <openssl/evp.h>
 
 #include "attestation/common/attestation_ca.pb.h"
+#include "attestation/common/boot_trace.h"
 #include "attestation/common/database.pb.h"
 #include "attestation/server/database_impl.h"
 
@@ -38,21 +46,103 @@ const char kACAWebOrigin[] = "https://asbestos-qa.corp.google.com";
 #endif
 const size_t kNonceSize = 20;  // As per TPM_NONCE definition.
 const int kNumTemporalValues = 5;
+// The number of user keys FindKeyByLabel keeps parsed.
+const size_t kMaxCachedKeys = 8;
+const char kBeginCertificate[] = "-----BEGIN CERTIFICATE-----\n";
+const char kEndCertificate[] = "-----END CERTIFICATE-----";
+// PEM wraps base64 at 64 characters, which encode 48 bytes.
+const size_t kPEMBytesPerLine = 48;
+const size_t kPEMCharsPerLine = 64;
+// How long background preparation waits before trying again.
+const int kBackgroundRetryDelaySeconds = 60;
+// How long SignAggregated waits for more nonces to sign with the same key, and
+// how many nonces one signature covers at most.
+const int kDefaultSignAggregationWindowMs = 20;
+const size_t kMaxAggregatedSignatures = 256;
+// Prefetched keys are RSA signing keys, the kind most profiles are used with.
+const attestation::KeyType kPrefetchKeyType = attestation::KEY_TYPE_RSA;
+const attestation::KeyUsage kPrefetchKeyUsage = attestation::KEY_USAGE_SIGN;
+// How often key renewal checks for keys due for renewal, which is also how
+// long a key waits after a failed renewal before it is tried again.
+const int kDefaultKeyRenewalIntervalSeconds = 60 * 60;
+
+// Returns true if |database_pb| holds what enrollment needs, given a ready
+// TPM.
+bool IsDatabasePreparedForEnrollment(
+    const attestation::AttestationDatabase& database_pb) {
+  if (!database_pb.has_credentials()) {
+    return false;
+  }
+  return (
+      database_pb.credentials().has_endorsement_credential() ||
+      database_pb.credentials().has_default_encrypted_endorsement_credential());
+}
+
+// A thread which also runs a brillo::MessageLoop, which the HTTP transport
+// needs for asynchronous transfers.
+class NetworkThread : public base::Thread {
+ public:
+  explicit NetworkThread(const std::string& name) : base::Thread(name) {}
+  ~NetworkThread() override { Stop(); }
+
+ protected:
+  void Init() override {
+    message_loop_.reset(
+        new brillo::BaseMessageLoop(base::MessageLoopForIO::current()));
+    message_loop_->SetAsCurrent();
+  }
+
+  void CleanUp() override { message_loop_.reset(); }
+
+ private:
+  std::unique_ptr<brillo::BaseMessageLoop> message_loop_;
+
+  DISALLOW_COPY_AND_ASSIGN(NetworkThread);
+};
 
 }  // namespace
 
 namespace attestation {
 
 AttestationService::AttestationService()
-    : attestation_ca_origin_(kACAWebOrigin), weak_factory_(this) {}
+    : attestation_ca_origin_(kACAWebOrigin),
+      sign_aggregation_window_(
+          base::TimeDelta::FromMilliseconds(kDefaultSignAggregationWindowMs)),
+      key_renewal_interval_(
+          base::TimeDelta::FromSeconds(kDefaultKeyRenewalIntervalSeconds)),
+      weak_factory_(this) {}
+
+AttestationService::~AttestationService() {
+  // The TPM thread starts CA requests so it is stopped first. The transport is
+  // then released on the network thread, whose message loop drives its
+  // transfers.
+  tpm_thread_.reset();
+  if (network_thread_) {
+    network_thread_->task_runner()->PostTask(
+        FROM_HERE,
+        base::Bind([](std::shared_ptr<brillo::http::Transport> transport) {},
+                   base::Passed(&http_transport_)));
+    network_thread_.reset();
+  }
+}
 
 bool AttestationService::Initialize() {
   LOG(INFO) << "Attestation service started.";
+  ATTESTATION_BOOT_TRACE_PHASE("AttestationService::Initialize");
   worker_thread_.reset(new base::Thread("Attestation Service Worker"));
   worker_thread_->StartWithOptions(
       base::Thread::Options(base::MessageLoop::TYPE_IO, 0));
+  tpm_thread_.reset(new base::Thread("Attestation Service TPM"));
+  tpm_thread_->Start();
+  network_thread_.reset(new NetworkThread("Attestation Service Network"));
+  network_thread_->StartWithOptions(
+      base::Thread::Options(base::MessageLoop::TYPE_IO, 0));
   if (!tpm_utility_) {
+#if defined(USE_TPM2)
+    default_tpm_utility_.reset(new TpmUtilityV2());
+#else
     default_tpm_utility_.reset(new TpmUtilityV1());
+#endif
     if (!default_tpm_utility_->Initialize()) {
       return false;
     }
@@ -69,10 +159,30 @@ bool AttestationService::Initialize() {
                               base::Unretained(default_database_.get())));
     database_ = default_database_.get();
   }
+  worker_thread_->task_runner()->PostTask(
+      FROM_HERE,
+      base::Bind(&Database::SetReloadCallback, base::Unretained(database_),
+                 base::Bind(&AttestationService::DropDatabaseSnapshot,
+                            base::Unretained(this))));
   if (!key_store_) {
     pkcs11_token_manager_.reset(new chaps::TokenManagerClient());
     default_key_store_.reset(new Pkcs11KeyStore(pkcs11_token_manager_.get()));
     key_store_ = default_key_store_.get();
+    if (file_key_store_) {
+      default_file_key_store_.reset(
+          new FileKeyStore(crypto_utility_, default_key_store_.get()));
+      key_store_ = default_file_key_store_.get();
+    }
+  }
+  if (background_preparation_) {
+    tpm_thread_->task_runner()->PostTask(
+        FROM_HERE, base::Bind(&AttestationService::BackgroundPreparationTask,
+                              base::Unretained(this)));
+  }
+  if (!key_renewal_window_.is_zero()) {
+    tpm_thread_->task_runner()->PostTask(
+        FROM_HERE, base::Bind(&AttestationService::KeyRenewalTask,
+                              base::Unretained(this)));
   }
   return true;
 }
@@ -83,48 +193,76 @@ void AttestationService::CreateGoogleAttestedKey(
   auto result = std::make_shared<CreateGoogleAttestedKeyReply>();
   base::Closure task =
       base::Bind(&AttestationService::CreateGoogleAttestedKeyTask,
-                 base::Unretained(this), request, result);
-  base::Closure reply = base::Bind(
-      &AttestationService::TaskRelayCallback<CreateGoogleAttestedKeyReply>,
-      GetWeakPtr(), callback, result);
-  worker_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
+                 base::Unretained(this), request, result,
+                 CreateReplyClosure(callback, result));
+  tpm_thread_->task_runner()->PostTask(FROM_HERE, task);
 }
 
 void AttestationService::CreateGoogleAttestedKeyTask(
     const CreateGoogleAttestedKeyRequest& request,
-    const std::shared_ptr<CreateGoogleAttestedKeyReply>& result) {
+    const std::shared_ptr<CreateGoogleAttestedKeyReply>& result,
+    const base::Closure& done) {
   LOG(INFO) << "Creating attested key: " << request.key_label();
   if (!IsPreparedForEnrollment()) {
     LOG(ERROR) << "Attestation: TPM is not ready.";
     result->set_status(STATUS_NOT_READY);
+    done.Run();
     return;
   }
-  if (!IsEnrolled()) {
-    std::string enroll_request;
-    if (!CreateEnrollRequest(&enroll_request)) {
-      result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
-      return;
-    }
-    std::string enroll_reply;
-    if (!SendACARequestAndBlock(kEnroll, enroll_request, &enroll_reply)) {
-      result->set_status(STATUS_CA_NOT_AVAILABLE);
-      return;
-    }
-    std::string server_error;
-    if (!FinishEnroll(enroll_reply, &server_error)) {
-      if (server_error.empty()) {
-        result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
-        return;
-      }
-      result->set_status(STATUS_REQUEST_DENIED_BY_CA);
+  if (IsEnrolled()) {
+    RequestCertificateTask(request, result, done);
+    return;
+  }
+  EnrollTask(base::Bind(&AttestationService::ContinueAfterEnrollTask,
+                        base::Unretained(this), request, result, done));
+}
+
+void AttestationService::ContinueAfterEnrollTask(
+    const CreateGoogleAttestedKeyRequest& request,
+    const std::shared_ptr<CreateGoogleAttestedKeyReply>& result,
+    const base::Closure& done,
+    AttestationStatus status,
+    const std::string& server_error) {
+  if (status != STATUS_SUCCESS) {
+    result->set_status(status);
+    if (!server_error.empty()) {
       result->set_server_error(server_error);
-      return;
     }
+    done.Run();
+    return;
   }
+  RequestCertificateTask(request, result, done);
+}
+
+void AttestationService::RequestCertificateTask(
+    const CreateGoogleAttestedKeyRequest& request,
+    const std::shared_ptr<CreateGoogleAttestedKeyReply>& result,
+    const base::Closure& done) {
   CertifiedKey key;
+  if (TakePrefetchedKey(request, &key)) {
+    key.set_key_name(request.key_label());
+    bool saved = SaveKey(request.username(), request.key_label(), key);
+    if (!saved) {
+      result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
+    } else {
+      result->set_certificate_chain(
+          GetCertificateChain(request.username(), request.key_label(), key));
+    }
+    done.Run();
+    if (saved) {
+      TrackKeyExpiry(request.username(), request.key_label(),
+                     request.certificate_profile(), request.origin(), key);
+    }
+    // Replace the key that was handed out.
+    tpm_thread_->task_runner()->PostTask(
+        FROM_HERE, base::Bind(&AttestationService::BackgroundPreparationTask,
+                              base::Unretained(this)));
+    return;
+  }
   if (!CreateKey(request.username(), request.key_label(), request.key_type(),
                  request.key_usage(), &key)) {
     result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
+    done.Run();
     return;
   }
   std::string certificate_request;
@@ -133,28 +271,372 @@ void AttestationService::CreateGoogleAttestedKeyTask(
                                 request.certificate_profile(), request.origin(),
                                 &certificate_request, &message_id)) {
     result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
+    done.Run();
     return;
   }
-  std::string certificate_reply;
-  if (!SendACARequestAndBlock(kGetCertificate, certificate_request,
-                              &certificate_reply)) {
+  PostACARequest(kGetCertificate, certificate_request,
+                 base::Bind(&AttestationService::FinishCertificateTask,
+                            base::Unretained(this), request, result, done, key,
+                            message_id));
+}
+
+void AttestationService::FinishCertificateTask(
+    const CreateGoogleAttestedKeyRequest& request,
+    const std::shared_ptr<CreateGoogleAttestedKeyReply>& result,
+    const base::Closure& done,
+    const CertifiedKey& key,
+    const std::string& message_id,
+    bool success,
+    const std::string& certificate_reply) {
+  if (!success) {
     result->set_status(STATUS_CA_NOT_AVAILABLE);
+    done.Run();
     return;
   }
+  CertifiedKey certified_key = key;
   std::string certificate_chain;
   std::string server_error;
   if (!FinishCertificateRequest(certificate_reply, request.username(),
-                                request.key_label(), message_id, &key,
-                                &certificate_chain, &server_error)) {
+                                request.key_label(), message_id,
+                                &certified_key, &certificate_chain,
+                                &server_error)) {
     if (server_error.empty()) {
       result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
-      return;
+    } else {
+      result->set_status(STATUS_REQUEST_DENIED_BY_CA);
+      result->set_server_error(server_error);
     }
-    result->set_status(STATUS_REQUEST_DENIED_BY_CA);
-    result->set_server_error(server_error);
+    done.Run();
     return;
   }
   result->set_certificate_chain(certificate_chain);
+  done.Run();
+  TrackKeyExpiry(request.username(), request.key_label(),
+                 request.certificate_profile(), request.origin(),
+                 certified_key);
+}
+
+void AttestationService::EnrollTask(const EnrollCallback& callback) {
+  enroll_callbacks_.push_back(callback);
+  if (enroll_callbacks_.size() > 1) {
+    // Joins the enrollment in progress.
+    return;
+  }
+  std::string enroll_request;
+  if (!CreateEnrollRequest(&enroll_request)) {
+    RunEnrollCallbacks(STATUS_UNEXPECTED_DEVICE_ERROR, std::string());
+    return;
+  }
+  PostACARequest(kEnroll, enroll_request,
+                 base::Bind(&AttestationService::FinishEnrollTask,
+                            base::Unretained(this)));
+}
+
+void AttestationService::FinishEnrollTask(bool success,
+                                          const std::string& enroll_reply) {
+  if (!success) {
+    RunEnrollCallbacks(STATUS_CA_NOT_AVAILABLE, std::string());
+    return;
+  }
+  std::string server_error;
+  if (!FinishEnroll(enroll_reply, &server_error)) {
+    RunEnrollCallbacks(server_error.empty() ? STATUS_UNEXPECTED_DEVICE_ERROR
+                                            : STATUS_REQUEST_DENIED_BY_CA,
+                       server_error);
+    return;
+  }
+  RunEnrollCallbacks(STATUS_SUCCESS, std::string());
+}
+
+void AttestationService::RunEnrollCallbacks(AttestationStatus status,
+                                            const std::string& server_error) {
+  std::vector<EnrollCallback> callbacks;
+  callbacks.swap(enroll_callbacks_);
+  for (const auto& callback : callbacks) {
+    callback.Run(status, server_error);
+  }
+}
+
+void AttestationService::BackgroundPreparationTask() {
+  ATTESTATION_BOOT_TRACE_PHASE("AttestationService::BackgroundPreparation");
+  if (!IsPreparedForEnrollment()) {
+    ScheduleBackgroundPreparation();
+    return;
+  }
+  if (!IsEnrolled()) {
+    EnrollTask(
+        base::Bind(&AttestationService::ContinueBackgroundPreparationTask,
+                   base::Unretained(this)));
+    return;
+  }
+  for (CertificateProfile profile : prefetch_profiles_) {
+    if (prefetched_keys_.count(profile) == 0 &&
+        prefetches_in_flight_.count(profile) == 0) {
+      PrefetchCertificateTask(profile);
+    }
+  }
+}
+
+void AttestationService::ContinueBackgroundPreparationTask(
+    AttestationStatus status,
+    const std::string& server_error) {
+  if (status != STATUS_SUCCESS) {
+    LOG(WARNING) << "Attestation: Background enrollment failed.";
+    ScheduleBackgroundPreparation();
+    return;
+  }
+  BackgroundPreparationTask();
+}
+
+void AttestationService::ScheduleBackgroundPreparation() {
+  tpm_thread_->task_runner()->PostDelayedTask(
+      FROM_HERE, base::Bind(&AttestationService::BackgroundPreparationTask,
+                            base::Unretained(this)),
+      base::TimeDelta::FromSeconds(kBackgroundRetryDelaySeconds));
+}
+
+void AttestationService::PrefetchCertificateTask(CertificateProfile profile) {
+  CertifiedKey key;
+  std::string certificate_request;
+  std::string message_id;
+  if (!CreateCertifiedKey(kPrefetchKeyType, kPrefetchKeyUsage, &key) ||
+      !CreateCertificateRequest(std::string(), key, profile, std::string(),
+                                &certificate_request, &message_id)) {
+    LOG(WARNING) << "Attestation: Failed to prefetch a certificate.";
+    ScheduleBackgroundPreparation();
+    return;
+  }
+  prefetches_in_flight_.insert(profile);
+  PostACARequest(kGetCertificate, certificate_request,
+                 base::Bind(&AttestationService::FinishPrefetchTask,
+                            base::Unretained(this), profile, key, message_id));
+}
+
+void AttestationService::FinishPrefetchTask(
+    CertificateProfile profile,
+    const CertifiedKey& key,
+    const std::string& message_id,
+    bool success,
+    const std::string& certificate_reply) {
+  prefetches_in_flight_.erase(profile);
+  CertifiedKey certified_key = key;
+  std::string server_error;
+  if (!success || !ProcessCertificateResponse(certificate_reply, message_id,
+                                              &certified_key, &server_error)) {
+    LOG(WARNING) << "Attestation: Failed to prefetch a certificate.";
+    ScheduleBackgroundPreparation();
+    return;
+  }
+  prefetched_keys_[profile] = certified_key;
+}
+
+bool AttestationService::TakePrefetchedKey(
+    const CreateGoogleAttestedKeyRequest& request,
+    CertifiedKey* key) {
+  if (request.key_type() != kPrefetchKeyType ||
+      request.key_usage() != kPrefetchKeyUsage) {
+    return false;
+  }
+  // Certificates with a stable ID depend on the origin and the user.
+  if (request.certificate_profile() ==
+          CONTENT_PROTECTION_CERTIFICATE_WITH_STABLE_ID &&
+      !request.origin().empty()) {
+    return false;
+  }
+  auto iter = prefetched_keys_.find(request.certificate_profile());
+  if (iter == prefetched_keys_.end()) {
+    return false;
+  }
+  key->Swap(&iter->second);
+  prefetched_keys_.erase(iter);
+  return true;
+}
+
+void AttestationService::TrackKeyExpiry(const std::string& username,
+                                        const std::string& key_label,
+                                        CertificateProfile profile,
+                                        const std::string& origin,
+                                        const CertifiedKey& key) {
+  if (key_renewal_window_.is_zero()) {
+    return;
+  }
+  int64_t not_after = 0;
+  if (!crypto_utility_->GetCertificateNotAfter(key.certified_key_credential(),
+                                               &not_after)) {
+    LOG(WARNING) << "Attestation: Key " << key_label
+                 << " will not be renewed, its certificate has no expiry.";
+    return;
+  }
+  RenewableKey renewable_key;
+  renewable_key.set_username(username);
+  renewable_key.set_key_label(key_label);
+  renewable_key.set_certificate_profile(profile);
+  renewable_key.set_origin(origin);
+  renewable_key.set_not_after(not_after);
+  RunOnWorkerThreadAndWait(base::Bind(&AttestationService::SaveRenewableKey,
+                                      base::Unretained(this), renewable_key));
+}
+
+void AttestationService::SaveRenewableKey(const RenewableKey& renewable_key) {
+  DCHECK(IsOnWorkerThread());
+  auto* database_pb = database_->GetMutableProtobuf();
+  RenewableKey* record = nullptr;
+  for (int i = 0; i < database_pb->renewable_keys_size(); ++i) {
+    const RenewableKey& existing = database_pb->renewable_keys(i);
+    if (existing.username() == renewable_key.username() &&
+        existing.key_label() == renewable_key.key_label()) {
+      record = database_pb->mutable_renewable_keys(i);
+      break;
+    }
+  }
+  if (!record) {
+    record = database_pb->add_renewable_keys();
+  }
+  // A renewed key keeps the time of its last attempt, so a certificate which
+  // already expires within the window is not renewed again right away.
+  int64_t last_attempt = record->last_attempt();
+  *record = renewable_key;
+  record->set_last_attempt(last_attempt);
+  database_->ScheduleSaveChanges();
+}
+
+void AttestationService::RemoveRenewableKey(const std::string& username,
+                                            const std::string& key_label) {
+  DCHECK(IsOnWorkerThread());
+  auto* database_pb = database_->GetMutableProtobuf();
+  for (int i = 0; i < database_pb->renewable_keys_size(); ++i) {
+    if (database_pb->renewable_keys(i).username() == username &&
+        database_pb->renewable_keys(i).key_label() == key_label) {
+      int last = database_pb->renewable_keys_size() - 1;
+      if (i < last) {
+        database_pb->mutable_renewable_keys()->SwapElements(i, last);
+      }
+      database_pb->mutable_renewable_keys()->RemoveLast();
+      database_->ScheduleSaveChanges();
+      return;
+    }
+  }
+}
+
+bool AttestationService::TakeDueRenewableKey(int64_t now,
+                                             RenewableKey* renewable_key) {
+  DCHECK(IsOnWorkerThread());
+  auto* database_pb = database_->GetMutableProtobuf();
+  RenewableKey* due = nullptr;
+  for (int i = 0; i < database_pb->renewable_keys_size(); ++i) {
+    RenewableKey* record = database_pb->mutable_renewable_keys(i);
+    if (record->not_after() > now + key_renewal_window_.InSeconds() ||
+        record->last_attempt() + key_renewal_interval_.InSeconds() > now) {
+      continue;
+    }
+    if (!due || record->not_after() < due->not_after()) {
+      due = record;
+    }
+  }
+  if (!due) {
+    return false;
+  }
+  due->set_last_attempt(now);
+  database_->ScheduleSaveChanges();
+  *renewable_key = *due;
+  return true;
+}
+
+void AttestationService::KeyRenewalTask() {
+  RenewableKey renewable_key;
+  int64_t now = base::Time::Now().ToTimeT();
+  if (!IsEnrolled() ||
+      !CallOnWorkerThread(base::Bind(&AttestationService::TakeDueRenewableKey,
+                                     base::Unretained(this), now,
+                                     &renewable_key))) {
+    ScheduleKeyRenewal(key_renewal_interval_);
+    return;
+  }
+  const std::string& username = renewable_key.username();
+  const std::string& key_label = renewable_key.key_label();
+  CertifiedKey old_key;
+  if (!FindKeyByLabel(username, key_label, &old_key)) {
+    // A user key is not found while the user's token is not loaded, so its
+    // record is only dropped once it could no longer be renewed anyway.
+    if (renewable_key.not_after() <= now) {
+      RunOnWorkerThreadAndWait(
+          base::Bind(&AttestationService::RemoveRenewableKey,
+                     base::Unretained(this), username, key_label));
+    }
+    ScheduleKeyRenewal(base::TimeDelta());
+    return;
+  }
+  LOG(INFO) << "Attestation: Renewing key " << key_label << ".";
+  CertifiedKey new_key;
+  std::string certificate_request;
+  std::string message_id;
+  if (!CreateCertifiedKey(old_key.key_type(), old_key.key_usage(),
+                          &new_key) ||
+      !CreateCertificateRequest(username, new_key,
+                                renewable_key.certificate_profile(),
+                                renewable_key.origin(), &certificate_request,
+                                &message_id)) {
+    LOG(WARNING) << "Attestation: Failed to renew key " << key_label << ".";
+    ScheduleKeyRenewal(base::TimeDelta());
+    return;
+  }
+  new_key.set_key_name(key_label);
+  PostACARequest(kGetCertificate, certificate_request,
+                 base::Bind(&AttestationService::FinishKeyRenewalTask,
+                            base::Unretained(this), renewable_key, old_key,
+                            new_key, message_id));
+}
+
+void AttestationService::FinishKeyRenewalTask(
+    const RenewableKey& renewable_key,
+    const CertifiedKey& old_key,
+    const CertifiedKey& new_key,
+    const std::string& message_id,
+    bool success,
+    const std::string& certificate_reply) {
+  CertifiedKey certified_key = new_key;
+  std::string server_error;
+  if (!success ||
+      !ProcessCertificateResponse(certificate_reply, message_id,
+                                  &certified_key, &server_error) ||
+      !CallOnWorkerThread(base::Bind(
+          &AttestationService::ReplaceRenewedKey, base::Unretained(this),
+          renewable_key.username(), renewable_key.key_label(), old_key,
+          &certified_key))) {
+    LOG(WARNING) << "Attestation: Failed to renew key "
+                 << renewable_key.key_label() << ".";
+  } else {
+    LOG(INFO) << "Attestation: Renewed key " << renewable_key.key_label()
+              << ".";
+    TrackKeyExpiry(renewable_key.username(), renewable_key.key_label(),
+                   renewable_key.certificate_profile(), renewable_key.origin(),
+                   certified_key);
+  }
+  ScheduleKeyRenewal(base::TimeDelta());
+}
+
+void AttestationService::ScheduleKeyRenewal(base::TimeDelta delay) {
+  tpm_thread_->task_runner()->PostDelayedTask(
+      FROM_HERE,
+      base::Bind(&AttestationService::KeyRenewalTask, base::Unretained(this)),
+      delay);
+}
+
+bool AttestationService::ReplaceRenewedKey(const std::string& username,
+                                           const std::string& key_label,
+                                           const CertifiedKey& old_key,
+                                           CertifiedKey* new_key) {
+  DCHECK(IsOnWorkerThread());
+  CertifiedKey current_key;
+  if (!FindKeyByLabel(username, key_label, &current_key) ||
+      current_key.public_key() != old_key.public_key() ||
+      current_key.key_blob() != old_key.key_blob()) {
+    LOG(INFO) << "Attestation: Key " << key_label
+              << " was replaced while it was renewed.";
+    return false;
+  }
+  new_key->set_payload(current_key.payload());
+  return SaveKey(username, key_label, *new_key);
 }
 
 void AttestationService::GetKeyInfo(const GetKeyInfoRequest& request,
@@ -176,20 +658,30 @@ void AttestationService::GetKeyInfoTask(
     result->set_status(STATUS_INVALID_PARAMETER);
     return;
   }
-  std::string public_key_info;
-  if (!GetSubjectPublicKeyInfo(key.key_type(), key.public_key(),
-                               &public_key_info)) {
-    LOG(ERROR) << __func__ << ": Bad public key.";
-    result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
-    return;
+  // Unrequested fields are not even assembled.
+  int field_mask = request.has_field_mask() ? request.field_mask() : ~0;
+  if (field_mask & KEY_INFO_PUBLIC_KEY) {
+    std::string public_key_info;
+    if (!GetSubjectPublicKeyInfo(key.key_type(), key.public_key(),
+                                 &public_key_info)) {
+      LOG(ERROR) << __func__ << ": Bad public key.";
+      result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
+      return;
+    }
+    result->set_public_key(public_key_info);
   }
   result->set_key_type(key.key_type());
   result->set_key_usage(key.key_usage());
-  result->set_public_key(public_key_info);
-  result->set_certify_info(key.certified_key_info());
-  result->set_certify_info_signature(key.certified_key_proof());
+  if (field_mask & KEY_INFO_CERTIFY_INFO) {
+    result->set_certify_info(key.certified_key_info());
+    result->set_certify_info_signature(key.certified_key_proof());
+  }
+  if (!(field_mask & KEY_INFO_CERTIFICATE)) {
+    return;
+  }
   if (key.has_intermediate_ca_cert()) {
-    result->set_certificate(CreatePEMCertificateChain(key));
+    result->set_certificate(
+        GetCertificateChain(request.username(), request.key_label(), key));
   } else {
     result->set_certificate(key.certified_key_credential());
   }
@@ -199,12 +691,27 @@ void AttestationService::GetEndorsementInfo(
     const GetEndorsementInfoRequest& request,
     const GetEndorsementInfoCallback& callback) {
   auto result = std::make_shared<GetEndorsementInfoReply>();
-  base::Closure task = base::Bind(&AttestationService::GetEndorsementInfoTask,
-                                  base::Unretained(this), request, result);
   base::Closure reply = base::Bind(
       &AttestationService::TaskRelayCallback<GetEndorsementInfoReply>,
       GetWeakPtr(), callback, result);
-  worker_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
+  if (request.key_type() == KEY_TYPE_RSA) {
+    if (GetKeptReply(endorsement_info_, result.get())) {
+      base::ThreadTaskRunnerHandle::Get()->PostTask(FROM_HERE, reply);
+      return;
+    }
+    std::shared_ptr<const AttestationDatabase> snapshot =
+        GetKeptDatabaseSnapshot();
+    if (snapshot && snapshot->credentials().has_endorsement_public_key()) {
+      // Nothing to ask the TPM.
+      GetEndorsementInfoFromDatabase(request, *snapshot, result.get());
+      KeepReply(snapshot, *result, &endorsement_info_);
+      base::ThreadTaskRunnerHandle::Get()->PostTask(FROM_HERE, reply);
+      return;
+    }
+  }
+  base::Closure task = base::Bind(&AttestationService::GetEndorsementInfoTask,
+                                  base::Unretained(this), request, result);
+  tpm_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
 }
 
 void AttestationService::GetEndorsementInfoTask(
@@ -214,17 +721,25 @@ void AttestationService::GetEndorsementInfoTask(
     result->set_status(STATUS_INVALID_PARAMETER);
     return;
   }
-  auto database_pb = database_->GetProtobuf();
-  if (!database_pb.has_credentials() ||
-      !database_pb.credentials().has_endorsement_public_key()) {
+  std::shared_ptr<const AttestationDatabase> snapshot = ReadDatabaseSnapshot();
+  if (!snapshot->credentials().has_endorsement_public_key()) {
     // Try to read the public key directly.
     std::string public_key;
     if (!tpm_utility_->GetEndorsementPublicKey(&public_key)) {
       result->set_status(STATUS_NOT_AVAILABLE);
       return;
     }
-    database_pb.mutable_credentials()->set_endorsement_public_key(public_key);
+    SaveEndorsementPublicKey(public_key);
+    snapshot = ReadDatabaseSnapshot();
   }
+  GetEndorsementInfoFromDatabase(request, *snapshot, result.get());
+  KeepReply(snapshot, *result, &endorsement_info_);
+}
+
+void AttestationService::GetEndorsementInfoFromDatabase(
+    const GetEndorsementInfoRequest& request,
+    const AttestationDatabase& database_pb,
+    GetEndorsementInfoReply* result) {
   std::string public_key_info;
   if (!GetSubjectPublicKeyInfo(
           request.key_type(),
@@ -245,12 +760,25 @@ void AttestationService::GetAttestationKeyInfo(
     const GetAttestationKeyInfoRequest& request,
     const GetAttestationKeyInfoCallback& callback) {
   auto result = std::make_shared<GetAttestationKeyInfoReply>();
-  base::Closure task =
-      base::Bind(&AttestationService::GetAttestationKeyInfoTask,
-                 base::Unretained(this), request, result);
   base::Closure reply = base::Bind(
       &AttestationService::TaskRelayCallback<GetAttestationKeyInfoReply>,
       GetWeakPtr(), callback, result);
+  if (GetKeptReply(attestation_key_info_, result.get())) {
+    base::ThreadTaskRunnerHandle::Get()->PostTask(FROM_HERE, reply);
+    return;
+  }
+  std::shared_ptr<const AttestationDatabase> snapshot =
+      GetKeptDatabaseSnapshot();
+  if (snapshot) {
+    // A snapshot is only kept while the TPM is ready.
+    GetAttestationKeyInfoFromDatabase(request, *snapshot, result.get());
+    KeepReply(snapshot, *result, &attestation_key_info_);
+    base::ThreadTaskRunnerHandle::Get()->PostTask(FROM_HERE, reply);
+    return;
+  }
+  base::Closure task =
+      base::Bind(&AttestationService::GetAttestationKeyInfoTask,
+                 base::Unretained(this), request, result);
   worker_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
 }
 
@@ -261,8 +789,25 @@ void AttestationService::GetAttestationKeyInfoTask(
     result->set_status(STATUS_INVALID_PARAMETER);
     return;
   }
-  auto database_pb = database_->GetProtobuf();
-  if (!IsPreparedForEnrollment() || !database_pb.has_identity_key()) {
+  if (!tpm_utility_->IsTpmReady()) {
+    result->set_status(STATUS_NOT_AVAILABLE);
+    return;
+  }
+  std::shared_ptr<const AttestationDatabase> snapshot = ReadDatabaseSnapshot();
+  GetAttestationKeyInfoFromDatabase(request, *snapshot, result.get());
+  KeepReply(snapshot, *result, &attestation_key_info_);
+}
+
+void AttestationService::GetAttestationKeyInfoFromDatabase(
+    const GetAttestationKeyInfoRequest& request,
+    const AttestationDatabase& database_pb,
+    GetAttestationKeyInfoReply* result) {
+  if (request.key_type() != KEY_TYPE_RSA) {
+    result->set_status(STATUS_INVALID_PARAMETER);
+    return;
+  }
+  if (!IsDatabasePreparedForEnrollment(database_pb) ||
+      !database_pb.has_identity_key()) {
     result->set_status(STATUS_NOT_AVAILABLE);
     return;
   }
@@ -304,7 +849,7 @@ void AttestationService::ActivateAttestationKey(
   base::Closure reply = base::Bind(
       &AttestationService::TaskRelayCallback<ActivateAttestationKeyReply>,
       GetWeakPtr(), callback, result);
-  worker_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
+  tpm_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
 }
 
 void AttestationService::ActivateAttestationKeyTask(
@@ -315,7 +860,8 @@ void AttestationService::ActivateAttestationKeyTask(
     return;
   }
   std::string certificate;
-  auto database_pb = database_->GetProtobuf();
+  std::shared_ptr<const AttestationDatabase> snapshot = ReadDatabaseSnapshot();
+  const AttestationDatabase& database_pb = *snapshot;
   if (!tpm_utility_->ActivateIdentity(
           database_pb.delegate().blob(), database_pb.delegate().secret(),
           database_pb.identity_key().identity_key_blob(),
@@ -325,14 +871,8 @@ void AttestationService::ActivateAttestationKeyTask(
     result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
     return;
   }
-  if (request.save_certificate()) {
-    database_->GetMutableProtobuf()
-        ->mutable_identity_key()
-        ->set_identity_credential(certificate);
-    if (!database_->SaveChanges()) {
-      LOG(ERROR) << __func__ << ": Failed to persist database changes.";
-      result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
-    }
+  if (request.save_certificate() && !SaveIdentityCredential(certificate)) {
+    result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
   }
   result->set_certificate(certificate);
 }
@@ -346,7 +886,7 @@ void AttestationService::CreateCertifiableKey(
   base::Closure reply = base::Bind(
       &AttestationService::TaskRelayCallback<CreateCertifiableKeyReply>,
       GetWeakPtr(), callback, result);
-  worker_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
+  tpm_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
 }
 
 void AttestationService::CreateCertifiableKeyTask(
@@ -378,7 +918,7 @@ void AttestationService::Decrypt(const DecryptRequest& request,
   base::Closure reply =
       base::Bind(&AttestationService::TaskRelayCallback<DecryptReply>,
                  GetWeakPtr(), callback, result);
-  worker_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
+  tpm_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
 }
 
 void AttestationService::DecryptTask(
@@ -405,7 +945,7 @@ void AttestationService::Sign(const SignRequest& request,
   base::Closure reply =
       base::Bind(&AttestationService::TaskRelayCallback<SignReply>,
                  GetWeakPtr(), callback, result);
-  worker_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
+  tpm_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
 }
 
 void AttestationService::SignTask(const SignRequest& request,
@@ -423,6 +963,169 @@ void AttestationService::SignTask(const SignRequest& request,
   result->set_signature(signature);
 }
 
+void AttestationService::DecryptBatch(const DecryptBatchRequest& request,
+                                      const DecryptBatchCallback& callback) {
+  auto result = std::make_shared<DecryptBatchReply>();
+  base::Closure task = base::Bind(&AttestationService::DecryptBatchTask,
+                                  base::Unretained(this), request, result);
+  base::Closure reply =
+      base::Bind(&AttestationService::TaskRelayCallback<DecryptBatchReply>,
+                 GetWeakPtr(), callback, result);
+  tpm_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
+}
+
+void AttestationService::DecryptBatchTask(
+    const DecryptBatchRequest& request,
+    const std::shared_ptr<DecryptBatchReply>& result) {
+  CertifiedKey key;
+  if (!FindKeyByLabel(request.username(), request.key_label(), &key)) {
+    result->set_status(STATUS_INVALID_PARAMETER);
+    return;
+  }
+  for (const auto& encrypted_data : request.encrypted_data()) {
+    if (!tpm_utility_->Unbind(key.key_blob(), encrypted_data,
+                              result->add_decrypted_data())) {
+      result->clear_decrypted_data();
+      result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
+      return;
+    }
+  }
+}
+
+void AttestationService::SignBatch(const SignBatchRequest& request,
+                                   const SignBatchCallback& callback) {
+  auto result = std::make_shared<SignBatchReply>();
+  base::Closure task = base::Bind(&AttestationService::SignBatchTask,
+                                  base::Unretained(this), request, result);
+  base::Closure reply =
+      base::Bind(&AttestationService::TaskRelayCallback<SignBatchReply>,
+                 GetWeakPtr(), callback, result);
+  tpm_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
+}
+
+void AttestationService::SignBatchTask(
+    const SignBatchRequest& request,
+    const std::shared_ptr<SignBatchReply>& result) {
+  CertifiedKey key;
+  if (!FindKeyByLabel(request.username(), request.key_label(), &key)) {
+    result->set_status(STATUS_INVALID_PARAMETER);
+    return;
+  }
+  for (const auto& data_to_sign : request.data_to_sign()) {
+    if (!tpm_utility_->Sign(key.key_blob(), data_to_sign,
+                            result->add_signature())) {
+      result->clear_signature();
+      result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
+      return;
+    }
+  }
+}
+
+void AttestationService::SignAggregated(
+    const SignAggregatedRequest& request,
+    const SignAggregatedCallback& callback) {
+  PendingSignatureBatch& batch =
+      pending_signatures_[std::make_pair(request.username(),
+                                         request.key_label())];
+  batch.push_back(PendingSignature{request.nonce(), callback});
+  if (batch.size() >= kMaxAggregatedSignatures) {
+    FlushSignatureBatch(request.username(), request.key_label());
+  } else if (batch.size() == 1) {
+    // If the batch fills up first, this flushes the next batch of the key
+    // early, which only makes that batch smaller.
+    base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&AttestationService::FlushSignatureBatch, GetWeakPtr(),
+                   request.username(), request.key_label()),
+        sign_aggregation_window_);
+  }
+}
+
+void AttestationService::FlushSignatureBatch(const std::string& username,
+                                             const std::string& key_label) {
+  auto iter = pending_signatures_.find(std::make_pair(username, key_label));
+  if (iter == pending_signatures_.end()) {
+    return;
+  }
+  auto batch = std::make_shared<PendingSignatureBatch>();
+  batch->swap(iter->second);
+  pending_signatures_.erase(iter);
+  std::vector<std::string> nonces;
+  for (const auto& pending : *batch) {
+    nonces.push_back(pending.nonce);
+  }
+  auto tree = std::make_shared<MerkleTree>(nonces);
+  SignRequest request;
+  request.set_username(username);
+  request.set_key_label(key_label);
+  request.set_data_to_sign(tree->root());
+  auto result = std::make_shared<SignReply>();
+  base::Closure task = base::Bind(&AttestationService::SignTask,
+                                  base::Unretained(this), request, result);
+  base::Closure reply =
+      base::Bind(&AttestationService::OnSignatureBatchDone, GetWeakPtr(),
+                 tree, batch, result);
+  tpm_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
+}
+
+void AttestationService::OnSignatureBatchDone(
+    const std::shared_ptr<MerkleTree>& tree,
+    const std::shared_ptr<PendingSignatureBatch>& batch,
+    const std::shared_ptr<SignReply>& result) {
+  for (size_t i = 0; i < batch->size(); ++i) {
+    SignAggregatedReply reply;
+    reply.set_status(result->status());
+    if (result->status() == STATUS_SUCCESS) {
+      reply.set_signature(result->signature());
+      reply.set_merkle_root(tree->root());
+      reply.set_leaf_index(i);
+      reply.set_leaf_count(tree->leaf_count());
+      for (const auto& hash : tree->GetInclusionProof(i)) {
+        reply.add_inclusion_proof(hash);
+      }
+    }
+    (*batch)[i].callback.Run(reply);
+  }
+}
+
+void AttestationService::SignFile(const SignFileRequest& request,
+                                  int fd,
+                                  const SignCallback& callback) {
+  auto result = std::make_shared<SignReply>();
+  base::Closure reply =
+      base::Bind(&AttestationService::TaskRelayCallback<SignReply>,
+                 GetWeakPtr(), callback, result);
+  // |fd| is only valid during this call, so the TPM thread signs a duplicate.
+  base::ScopedFD file_fd(HANDLE_EINTR(fcntl(fd, F_DUPFD_CLOEXEC, 0)));
+  if (!file_fd.is_valid()) {
+    PLOG(ERROR) << __func__ << ": Failed to duplicate file descriptor";
+    result->set_status(STATUS_INVALID_PARAMETER);
+    base::ThreadTaskRunnerHandle::Get()->PostTask(FROM_HERE, reply);
+    return;
+  }
+  base::Closure task =
+      base::Bind(&AttestationService::SignFileTask, base::Unretained(this),
+                 request, base::Passed(&file_fd), result);
+  tpm_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
+}
+
+void AttestationService::SignFileTask(
+    const SignFileRequest& request,
+    base::ScopedFD fd,
+    const std::shared_ptr<SignReply>& result) {
+  CertifiedKey key;
+  if (!FindKeyByLabel(request.username(), request.key_label(), &key)) {
+    result->set_status(STATUS_INVALID_PARAMETER);
+    return;
+  }
+  std::string signature;
+  if (!tpm_utility_->SignFile(key.key_blob(), fd.get(), &signature)) {
+    result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
+    return;
+  }
+  result->set_signature(signature);
+}
+
 void AttestationService::RegisterKeyWithChapsToken(
     const RegisterKeyWithChapsTokenRequest& request,
     const RegisterKeyWithChapsTokenCallback& callback) {
@@ -444,43 +1147,40 @@ void AttestationService::RegisterKeyWithChapsTokenTask(
     result->set_status(STATUS_INVALID_PARAMETER);
     return;
   }
-  if (!key_store_->Register(request.username(), request.key_label(),
-                            key.key_type(), key.key_usage(), key.key_blob(),
-                            key.public_key(), key.certified_key_credential())) {
-    result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
-    return;
-  }
-  if (key.has_intermediate_ca_cert() &&
-      !key_store_->RegisterCertificate(request.username(),
-                                       key.intermediate_ca_cert())) {
+  std::vector<std::string> intermediate_ca_certs;
+  if (key.has_intermediate_ca_cert()) {
+    intermediate_ca_certs.push_back(key.intermediate_ca_cert());
+  }
+  intermediate_ca_certs.insert(intermediate_ca_certs.end(),
+                               key.additional_intermediate_ca_cert().begin(),
+                               key.additional_intermediate_ca_cert().end());
+  if (!key_store_->RegisterWithCertificateChain(
+          request.username(), request.key_label(), key.key_type(),
+          key.key_usage(), key.key_blob(), key.public_key(),
+          key.certified_key_credential(), intermediate_ca_certs)) {
     result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
     return;
   }
-  for (int i = 0; i < key.additional_intermediate_ca_cert_size(); ++i) {
-    if (!key_store_->RegisterCertificate(
-            request.username(), key.additional_intermediate_ca_cert(i))) {
-      result->set_status(STATUS_UNEXPECTED_DEVICE_ERROR);
-      return;
-    }
-  }
   DeleteKey(request.username(), request.key_label());
 }
 
 bool AttestationService::IsPreparedForEnrollment() {
-  if (!tpm_utility_->IsTpmReady()) {
-    return false;
+  if (!IsOnWorkerThread()) {
+    return CallOnWorkerThread(base::Bind(
+        &AttestationService::IsPreparedForEnrollment, base::Unretained(this)));
   }
-  auto database_pb = database_->GetProtobuf();
-  if (!database_pb.has_credentials()) {
+  if (!tpm_utility_->IsTpmReady()) {
     return false;
   }
-  return (
-      database_pb.credentials().has_endorsement_credential() ||
-      database_pb.credentials().has_default_encrypted_endorsement_credential());
+  return IsDatabasePreparedForEnrollment(database_->GetProtobuf());
 }
 
 bool AttestationService::IsEnrolled() {
-  auto database_pb = database_->GetProtobuf();
+  if (!IsOnWorkerThread()) {
+    return CallOnWorkerThread(
+        base::Bind(&AttestationService::IsEnrolled, base::Unretained(this)));
+  }
+  const AttestationDatabase& database_pb = database_->GetProtobuf();
   return database_pb.has_identity_key() &&
          database_pb.identity_key().has_identity_credential();
 }
@@ -491,7 +1191,8 @@ bool AttestationService::CreateEnrollRequest(std::string* enroll_request) {
                << "does not exist.";
     return false;
   }
-  auto database_pb = database_->GetProtobuf();
+  std::shared_ptr<const AttestationDatabase> snapshot = ReadDatabaseSnapshot();
+  const AttestationDatabase& database_pb = *snapshot;
   AttestationEnrollmentRequest request_pb;
   *request_pb.mutable_encrypted_endorsement_credential() =
       database_pb.credentials().default_encrypted_endorsement_credential();
@@ -523,7 +1224,8 @@ bool AttestationService::FinishEnroll(const std::string& enroll_response,
     return false;
   }
   std::string credential;
-  auto database_pb = database_->GetProtobuf();
+  std::shared_ptr<const AttestationDatabase> snapshot = ReadDatabaseSnapshot();
+  const AttestationDatabase& database_pb = *snapshot;
   if (!tpm_utility_->ActivateIdentity(
           database_pb.delegate().blob(), database_pb.delegate().secret(),
           database_pb.identity_key().identity_key_blob(),
@@ -533,11 +1235,7 @@ bool AttestationService::FinishEnroll(const std::string& enroll_response,
     LOG(ERROR) << __func__ << ": Failed to activate identity.";
     return false;
   }
-  database_->GetMutableProtobuf()
-      ->mutable_identity_key()
-      ->set_identity_credential(credential);
-  if (!database_->SaveChanges()) {
-    LOG(ERROR) << __func__ << ": Failed to persist database changes.";
+  if (!SaveIdentityCredential(credential)) {
     return false;
   }
   LOG(INFO) << "Attestation: Enrollment complete.";
@@ -564,7 +1262,8 @@ bool AttestationService::CreateCertificateRequest(
     return false;
   }
   request_pb.set_message_id(*message_id);
-  auto database_pb = database_->GetProtobuf();
+  std::shared_ptr<const AttestationDatabase> snapshot = ReadDatabaseSnapshot();
+  const AttestationDatabase& database_pb = *snapshot;
   request_pb.set_identity_credential(
       database_pb.identity_key().identity_credential());
   request_pb.set_profile(profile);
@@ -583,17 +1282,11 @@ bool AttestationService::CreateCertificateRequest(
   return true;
 }
 
-bool AttestationService::FinishCertificateRequest(
+bool AttestationService::ProcessCertificateResponse(
     const std::string& certificate_response,
-    const std::string& username,
-    const std::string& key_label,
     const std::string& message_id,
     CertifiedKey* key,
-    std::string* certificate_chain,
     std::string* server_error) {
-  if (!tpm_utility_->IsTpmReady()) {
-    return false;
-  }
   AttestationCertificateResponse response_pb;
   if (!response_pb.ParseFromString(certificate_response)) {
     LOG(ERROR) << __func__ << ": Failed to parse response from Privacy CA.";
@@ -610,60 +1303,219 @@ bool AttestationService::FinishCertificateRequest(
     return false;
   }
 
-  // Finish populating the CertifiedKey protobuf and store it.
+  // Finish populating the CertifiedKey protobuf.
   key->set_certified_key_credential(response_pb.certified_key_credential());
   key->set_intermediate_ca_cert(response_pb.intermediate_ca_cert());
   key->mutable_additional_intermediate_ca_cert()->MergeFrom(
       response_pb.additional_intermediate_ca_cert());
+  return true;
+}
+
+bool AttestationService::FinishCertificateRequest(
+    const std::string& certificate_response,
+    const std::string& username,
+    const std::string& key_label,
+    const std::string& message_id,
+    CertifiedKey* key,
+    std::string* certificate_chain,
+    std::string* server_error) {
+  if (!tpm_utility_->IsTpmReady()) {
+    return false;
+  }
+  if (!ProcessCertificateResponse(certificate_response, message_id, key,
+                                  server_error)) {
+    return false;
+  }
   if (!SaveKey(username, key_label, *key)) {
     return false;
   }
   LOG(INFO) << "Attestation: Certified key credential received and stored.";
-  *certificate_chain = CreatePEMCertificateChain(*key);
+  *certificate_chain = GetCertificateChain(username, key_label, *key);
   return true;
 }
 
-bool AttestationService::SendACARequestAndBlock(ACARequestType request_type,
-                                                const std::string& request,
-                                                std::string* reply) {
-  std::shared_ptr<brillo::http::Transport> transport = http_transport_;
-  if (!transport) {
-    transport = brillo::http::Transport::CreateDefault();
-  }
-  std::unique_ptr<brillo::http::Response> response = PostBinaryAndBlock(
+void AttestationService::PostACARequest(ACARequestType request_type,
+                                        const std::string& request,
+                                        const ACAReplyCallback& callback) {
+  network_thread_->task_runner()->PostTask(
+      FROM_HERE,
+      base::Bind(&AttestationService::StartACARequestTask,
+                 base::Unretained(this), request_type, request,
+                 base::ThreadTaskRunnerHandle::Get(), callback));
+}
+
+void AttestationService::StartACARequestTask(
+    ACARequestType request_type,
+    const std::string& request,
+    const scoped_refptr<base::TaskRunner>& reply_task_runner,
+    const ACAReplyCallback& callback) {
+  // Kept for the life of the service so connections to the CA, and their TLS
+  // sessions, are reused.
+  if (!http_transport_) {
+    http_transport_ = brillo::http::Transport::CreateDefault();
+  }
+  brillo::http::PostBinary(
       GetACAURL(request_type), request.data(), request.size(),
       brillo::mime::application::kOctet_stream, {},  // headers
-      transport,
-      nullptr);  // error
-  if (!response || !response->IsSuccessful()) {
+      http_transport_,
+      base::Bind(&AttestationService::OnACAResponse, base::Unretained(this),
+                 reply_task_runner, callback),
+      base::Bind(&AttestationService::OnACAError, base::Unretained(this),
+                 reply_task_runner, callback));
+}
+
+void AttestationService::OnACAResponse(
+    const scoped_refptr<base::TaskRunner>& reply_task_runner,
+    const ACAReplyCallback& callback,
+    brillo::http::RequestID request_id,
+    std::unique_ptr<brillo::http::Response> response) {
+  if (!response->IsSuccessful()) {
     LOG(ERROR) << "HTTP request to Attestation CA failed.";
+    reply_task_runner->PostTask(FROM_HERE,
+                                base::Bind(callback, false, std::string()));
+    return;
+  }
+  reply_task_runner->PostTask(
+      FROM_HERE, base::Bind(callback, true, response->ExtractDataAsString()));
+}
+
+void AttestationService::OnACAError(
+    const scoped_refptr<base::TaskRunner>& reply_task_runner,
+    const ACAReplyCallback& callback,
+    brillo::http::RequestID request_id,
+    const brillo::Error* error) {
+  LOG(ERROR) << "HTTP request to Attestation CA failed: "
+             << error->GetMessage();
+  reply_task_runner->PostTask(FROM_HERE,
+                              base::Bind(callback, false, std::string()));
+}
+
+std::shared_ptr<const AttestationDatabase>
+AttestationService::ReadDatabaseSnapshot() {
+  std::shared_ptr<const AttestationDatabase> kept_snapshot =
+      GetKeptDatabaseSnapshot();
+  if (kept_snapshot) {
+    return kept_snapshot;
+  }
+  if (!IsOnWorkerThread()) {
+    return CallOnWorkerThread(base::Bind(
+        &AttestationService::ReadDatabaseSnapshot, base::Unretained(this)));
+  }
+  // Field by field, so the device keys and their certificate chains are never
+  // copied.
+  const AttestationDatabase& database_pb = database_->GetProtobuf();
+  auto snapshot = std::make_shared<AttestationDatabase>();
+  if (database_pb.has_credentials()) {
+    *snapshot->mutable_credentials() = database_pb.credentials();
+  }
+  if (database_pb.has_identity_binding()) {
+    *snapshot->mutable_identity_binding() = database_pb.identity_binding();
+  }
+  if (database_pb.has_identity_key()) {
+    *snapshot->mutable_identity_key() = database_pb.identity_key();
+  }
+  if (database_pb.has_pcr0_quote()) {
+    *snapshot->mutable_pcr0_quote() = database_pb.pcr0_quote();
+  }
+  if (database_pb.has_pcr1_quote()) {
+    *snapshot->mutable_pcr1_quote() = database_pb.pcr1_quote();
+  }
+  if (database_pb.has_delegate()) {
+    *snapshot->mutable_delegate() = database_pb.delegate();
+  }
+  if (tpm_utility_->IsTpmReady()) {
+    base::AutoLock lock(database_snapshot_lock_);
+    database_snapshot_ = snapshot;
+  }
+  return snapshot;
+}
+
+std::shared_ptr<const AttestationDatabase>
+AttestationService::GetKeptDatabaseSnapshot() {
+  base::AutoLock lock(database_snapshot_lock_);
+  return database_snapshot_;
+}
+
+void AttestationService::DropDatabaseSnapshot() {
+  DCHECK(IsOnWorkerThread());
+  base::AutoLock lock(database_snapshot_lock_);
+  database_snapshot_.reset();
+  endorsement_info_.reset();
+  attestation_key_info_.reset();
+}
+
+void AttestationService::SaveEndorsementPublicKey(
+    const std::string& public_key) {
+  if (!IsOnWorkerThread()) {
+    RunOnWorkerThreadAndWait(
+        base::Bind(&AttestationService::SaveEndorsementPublicKey,
+                   base::Unretained(this), public_key));
+    return;
+  }
+  database_->GetMutableProtobuf()
+      ->mutable_credentials()
+      ->set_endorsement_public_key(public_key);
+  DropDatabaseSnapshot();
+  // The TPM can be asked again if this is lost.
+  database_->ScheduleSaveChanges();
+}
+
+bool AttestationService::SaveIdentityCredential(
+    const std::string& credential) {
+  if (!IsOnWorkerThread()) {
+    return CallOnWorkerThread(
+        base::Bind(&AttestationService::SaveIdentityCredential,
+                   base::Unretained(this), credential));
+  }
+  database_->GetMutableProtobuf()
+      ->mutable_identity_key()
+      ->set_identity_credential(credential);
+  DropDatabaseSnapshot();
+  if (!database_->SaveChanges()) {
+    LOG(ERROR) << __func__ << ": Failed to persist database changes.";
     return false;
   }
-  *reply = response->ExtractDataAsString();
   return true;
 }
 
 bool AttestationService::FindKeyByLabel(const std::string& username,
                                         const std::string& key_label,
                                         CertifiedKey* key) {
+  if (!IsOnWorkerThread()) {
+    return CallOnWorkerThread(base::Bind(&AttestationService::FindKeyByLabel,
+                                         base::Unretained(this), username,
+                                         key_label, key));
+  }
   if (!username.empty()) {
+    const CertifiedKey* cached_key = FindCachedKey(username, key_label);
+    if (cached_key) {
+      if (key) {
+        *key = *cached_key;
+      }
+      return true;
+    }
     std::string key_data;
     if (!key_store_->Read(username, key_label, &key_data)) {
       LOG(INFO) << "Key not found: " << key_label;
       return false;
     }
-    if (key && !key->ParseFromString(key_data)) {
+    CertifiedKey parsed_key;
+    if (!parsed_key.ParseFromString(key_data)) {
       LOG(ERROR) << "Failed to parse key: " << key_label;
       return false;
     }
+    CacheKey(username, key_label, parsed_key);
+    if (key) {
+      *key = parsed_key;
+    }
     return true;
   }
-  auto database_pb = database_->GetProtobuf();
-  for (int i = 0; i < database_pb.device_keys_size(); ++i) {
-    if (database_pb.device_keys(i).key_name() == key_label) {
-      *key = database_pb.device_keys(i);
-      return true;
+  const CertifiedKey* device_key = database_->FindDeviceKey(key_label);
+  if (device_key) {
+    if (key) {
+      *key = *device_key;
     }
+    return true;
   }
   LOG(INFO) << "Key not found: " << key_label;
   return false;
@@ -674,6 +1526,16 @@ bool AttestationService::CreateKey(const std::string& username,
                                    KeyType key_type,
                                    KeyUsage key_usage,
                                    CertifiedKey* key) {
+  if (!CreateCertifiedKey(key_type, key_usage, key)) {
+    return false;
+  }
+  key->set_key_name(key_label);
+  return SaveKey(username, key_label, *key);
+}
+
+bool AttestationService::CreateCertifiedKey(KeyType key_type,
+                                            KeyUsage key_usage,
+                                            CertifiedKey* key) {
   std::string nonce;
   if (!crypto_utility_->GetRandom(kNonceSize, &nonce)) {
     LOG(ERROR) << __func__ << ": GetRandom(nonce) failed.";
@@ -684,7 +1546,8 @@ bool AttestationService::CreateKey(const std::string& username,
   std::string public_key_tpm_format;
   std::string key_info;
   std::string proof;
-  auto database_pb = database_->GetProtobuf();
+  std::shared_ptr<const AttestationDatabase> snapshot = ReadDatabaseSnapshot();
+  const AttestationDatabase& database_pb = *snapshot;
   if (!tpm_utility_->CreateCertifiedKey(
           key_type, key_usage, database_pb.identity_key().identity_key_blob(),
           nonce, &key_blob, &public_key, &public_key_tpm_format, &key_info,
@@ -693,26 +1556,35 @@ bool AttestationService::CreateKey(const std::string& username,
   }
   key->set_key_blob(key_blob);
   key->set_public_key(public_key);
-  key->set_key_name(key_label);
   key->set_public_key_tpm_format(public_key_tpm_format);
   key->set_certified_key_info(key_info);
   key->set_certified_key_proof(proof);
-  return SaveKey(username, key_label, *key);
+  key->set_key_type(key_type);
+  key->set_key_usage(key_usage);
+  return true;
 }
 
 bool AttestationService::SaveKey(const std::string& username,
                                  const std::string& key_label,
                                  const CertifiedKey& key) {
+  if (!IsOnWorkerThread()) {
+    return CallOnWorkerThread(base::Bind(&AttestationService::SaveKey,
+                                         base::Unretained(this), username,
+                                         key_label, key));
+  }
   if (!username.empty()) {
     std::string key_data;
     if (!key.SerializeToString(&key_data)) {
       LOG(ERROR) << __func__ << ": Failed to serialize protobuf.";
       return false;
     }
+    // Whatever was cached is stale even if the write fails.
+    EvictCachedKey(username, key_label);
     if (!key_store_->Write(username, key_label, key_data)) {
       LOG(ERROR) << __func__ << ": Failed to store certified key for user.";
       return false;
     }
+    CacheKey(username, key_label, key);
   } else {
     if (!AddDeviceKey(key_label, key)) {
       LOG(ERROR) << __func__ << ": Failed to store certified key for device.";
@@ -724,11 +1596,74 @@ bool AttestationService::SaveKey(const std::string& username,
 
 void AttestationService::DeleteKey(const std::string& username,
                                    const std::string& key_label) {
+  if (!IsOnWorkerThread()) {
+    RunOnWorkerThreadAndWait(base::Bind(&AttestationService::DeleteKey,
+                                        base::Unretained(this), username,
+                                        key_label));
+    return;
+  }
   if (!username.empty()) {
+    EvictCachedKey(username, key_label);
     key_store_->Delete(username, key_label);
   } else {
     RemoveDeviceKey(key_label);
   }
+  RemoveRenewableKey(username, key_label);
+}
+
+const CertifiedKey* AttestationService::FindCachedKey(
+    const std::string& username,
+    const std::string& key_label) {
+  DCHECK(IsOnWorkerThread());
+  for (auto it = key_cache_.begin(); it != key_cache_.end(); ++it) {
+    if (it->username == username && it->key_label == key_label) {
+      key_cache_.splice(key_cache_.begin(), key_cache_, it);
+      return &key_cache_.front().key;
+    }
+  }
+  return nullptr;
+}
+
+void AttestationService::CacheKey(const std::string& username,
+                                  const std::string& key_label,
+                                  const CertifiedKey& key) {
+  DCHECK(IsOnWorkerThread());
+  EvictCachedKey(username, key_label);
+  key_cache_.push_front(CachedKey{username, key_label, key, std::string()});
+  if (key_cache_.size() > kMaxCachedKeys) {
+    key_cache_.pop_back();
+  }
+}
+
+void AttestationService::EvictCachedKey(const std::string& username,
+                                        const std::string& key_label) {
+  DCHECK(IsOnWorkerThread());
+  for (auto it = key_cache_.begin(); it != key_cache_.end(); ++it) {
+    if (it->username == username && it->key_label == key_label) {
+      key_cache_.erase(it);
+      return;
+    }
+  }
+}
+
+std::string AttestationService::GetCertificateChain(
+    const std::string& username,
+    const std::string& key_label,
+    const CertifiedKey& key) {
+  if (!IsOnWorkerThread()) {
+    return CallOnWorkerThread(
+        base::Bind(&AttestationService::GetCertificateChain,
+                   base::Unretained(this), username, key_label, key));
+  }
+  if (!username.empty() && FindCachedKey(username, key_label)) {
+    // FindCachedKey moved the entry to the front.
+    CachedKey& cached_key = key_cache_.front();
+    if (cached_key.certificate_chain.empty()) {
+      cached_key.certificate_chain = CreatePEMCertificateChain(cached_key.key);
+    }
+    return cached_key.certificate_chain;
+  }
+  return CreatePEMCertificateChain(key);
 }
 
 bool AttestationService::AddDeviceKey(const std::string& key_label,
@@ -763,9 +1698,8 @@ void AttestationService::RemoveDeviceKey(const std::string& key_label) {
     }
   }
   if (found) {
-    if (!database_->SaveChanges()) {
-      LOG(WARNING) << __func__ << ": Failed to persist key deletion.";
-    }
+    // A key which comes back after a crash can be deleted again.
+    database_->ScheduleSaveChanges();
   }
 }
 
@@ -775,49 +1709,78 @@ std::string AttestationService::CreatePEMCertificateChain(
     LOG(WARNING) << "Certificate is empty.";
     return std::string();
   }
-  std::string pem = CreatePEMCertificate(key.certified_key_credential());
+  std::vector<const std::string*> certificates;
+  certificates.push_back(&key.certified_key_credential());
   if (!key.intermediate_ca_cert().empty()) {
-    pem += "\n";
-    pem += CreatePEMCertificate(key.intermediate_ca_cert());
-  }
-  for (int i = 0; i < key.additional_intermediate_ca_cert_size(); ++i) {
-    pem += "\n";
-    pem += CreatePEMCertificate(key.additional_intermediate_ca_cert(i));
+    certificates.push_back(&key.intermediate_ca_cert());
+  }
+  for (const auto& certificate : key.additional_intermediate_ca_cert()) {
+    certificates.push_back(&certificate);
+  }
+  size_t size = 0;
+  for (const std::string* certificate : certificates) {
+    size_t lines = (certificate->size() + kPEMBytesPerLine - 1) /
+                   kPEMBytesPerLine;
+    size += sizeof(kBeginCertificate) + sizeof(kEndCertificate) +
+            lines * (kPEMCharsPerLine + 1);
+  }
+  std::string pem;
+  pem.reserve(size);
+  for (const std::string* certificate : certificates) {
+    if (!pem.empty()) {
+      pem += "\n";
+    }
+    AppendPEMCertificate(*certificate, &pem);
   }
   return pem;
 }
 
-std::string AttestationService::CreatePEMCertificate(
-    const std::string& certificate) {
-  const char kBeginCertificate[] = "-----BEGIN CERTIFICATE-----\n";
-  const char kEndCertificate[] = "-----END CERTIFICATE-----";
-
-  std::string pem = kBeginCertificate;
-  pem += brillo::data_encoding::Base64EncodeWrapLines(certificate);
-  pem += kEndCertificate;
-  return pem;
+void AttestationService::AppendPEMCertificate(const std::string& certificate,
+                                              std::string* pem) {
+  *pem += kBeginCertificate;
+  // Encode in place, one wrapped line at a time. EVP_EncodeBlock terminates
+  // each line with a NUL, which the newline then replaces.
+  for (size_t offset = 0; offset < certificate.size();
+       offset += kPEMBytesPerLine) {
+    size_t length =
+        std::min(certificate.size() - offset, kPEMBytesPerLine);
+    size_t line_start = pem->size();
+    pem->resize(line_start + kPEMCharsPerLine + 1);
+    int encoded_length = EVP_EncodeBlock(
+        reinterpret_cast<unsigned char*>(&(*pem)[line_start]),
+        reinterpret_cast<const unsigned char*>(certificate.data() + offset),
+        length);
+    pem->resize(line_start + encoded_length);
+    *pem += "\n";
+  }
+  *pem += kEndCertificate;
 }
 
 int AttestationService::ChooseTemporalIndex(const std::string& user,
                                             const std::string& origin) {
+  // The choice must not race with that of another request.
+  if (!IsOnWorkerThread()) {
+    return CallOnWorkerThread(
+        base::Bind(&AttestationService::ChooseTemporalIndex,
+                   base::Unretained(this), user, origin));
+  }
   std::string user_hash = crypto::SHA256HashString(user);
   std::string origin_hash = crypto::SHA256HashString(origin);
   int histogram[kNumTemporalValues] = {};
-  auto database_pb = database_->GetProtobuf();
-  for (int i = 0; i < database_pb.temporal_index_record_size(); ++i) {
-    const AttestationDatabase::TemporalIndexRecord& record =
-        database_pb.temporal_index_record(i);
+  const Database::OriginTemporalIndexes* indexes =
+      database_->FindTemporalIndexes(origin_hash);
+  if (indexes) {
+    auto user_iter = indexes->user_indexes.find(user_hash);
     // Ignore out-of-range index values.
-    if (record.temporal_index() < 0 ||
-        record.temporal_index() >= kNumTemporalValues)
-      continue;
-    if (record.origin_hash() == origin_hash) {
-      if (record.user_hash() == user_hash) {
-        // We've previously chosen this index for this user, reuse it.
-        return record.temporal_index();
-      } else {
-        // We've previously chosen this index for another user.
-        ++histogram[record.temporal_index()];
+    if (user_iter != indexes->user_indexes.end() && user_iter->second >= 0 &&
+        user_iter->second < kNumTemporalValues) {
+      // We've previously chosen this index for this user, reuse it.
+      return user_iter->second;
+    }
+    // Count the indexes we've previously chosen for other users.
+    for (const auto& index_count : indexes->index_counts) {
+      if (index_count.first >= 0 && index_count.first < kNumTemporalValues) {
+        histogram[index_count.first] = index_count.second;
       }
     }
   }
@@ -830,12 +1793,9 @@ int AttestationService::ChooseTemporalIndex(const std::string& user,
     LOG(WARNING) << "Unique origin-specific identifiers have been exhausted.";
   }
   // Record our choice for later reference.
-  AttestationDatabase::TemporalIndexRecord* new_record =
-      database_pb.add_temporal_index_record();
-  new_record->set_origin_hash(origin_hash);
-  new_record->set_user_hash(user_hash);
-  new_record->set_temporal_index(least_used_index);
-  database_->SaveChanges();
+  database_->AddTemporalIndexRecord(user_hash, origin_hash, least_used_index);
+  // Losing the record only risks choosing another index next time.
+  database_->ScheduleSaveChanges();
   return least_used_index;
 }
 
@@ -866,6 +1826,26 @@ bool AttestationService::GetSubjectPublicKeyInfo(
                                                      public_key_info);
 }
 
+void AttestationService::RunOnWorkerThreadAndWait(const base::Closure& task) {
+  if (IsOnWorkerThread()) {
+    task.Run();
+    return;
+  }
+  base::WaitableEvent event(base::WaitableEvent::ResetPolicy::MANUAL,
+                            base::WaitableEvent::InitialState::NOT_SIGNALED);
+  worker_thread_->task_runner()->PostTask(
+      FROM_HERE, base::Bind(
+                     [&task, &event]() {
+                       task.Run();
+                       event.Signal();
+                     }));
+  event.Wait();
+}
+
+bool AttestationService::IsOnWorkerThread() const {
+  return worker_thread_->task_runner()->BelongsToCurrentThread();
+}
+
 base::WeakPtr<AttestationService> AttestationService::GetWeakPtr() {
   return weak_factory_.GetWeakPtr();
 }
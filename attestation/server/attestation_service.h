@@ -19,22 +19,40 @@
 
 #include "attestation/common/attestation_interface.h"
 
+#include <list>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include <base/bind.h>
 #include <base/callback.h>
+#include <base/files/scoped_file.h>
 #include <base/macros.h>
 #include <base/memory/weak_ptr.h>
+#include <base/synchronization/lock.h>
 #include <base/threading/thread.h>
+#include <base/threading/thread_task_runner_handle.h>
+#include <base/time/time.h>
 #include <brillo/bind_lambda.h>
+#include <brillo/errors/error.h>
+#include <brillo/http/http_request.h>
 #include <brillo/http/http_transport.h>
 
 #include "attestation/common/crypto_utility.h"
 #include "attestation/common/crypto_utility_impl.h"
+#include "attestation/common/merkle_tree.h"
 #include "attestation/common/tpm_utility.h"
+#if defined(USE_TPM2)
+#include "attestation/common/tpm_utility_v2.h"
+#else
 #include "attestation/common/tpm_utility_v1.h"
+#endif
 #include "attestation/server/database.h"
 #include "attestation/server/database_impl.h"
+#include "attestation/server/file_key_store.h"
 #include "attestation/server/key_store.h"
 #include "attestation/server/pkcs11_key_store.h"
 
@@ -51,20 +69,42 @@ namespace attestation {
 //   attestation->CreateGoogleAttestedKey(...);
 //
 // THREADING NOTES:
-// This class runs a worker thread and delegates all calls to it. This keeps the
+// This class runs three threads and delegates all calls to them. This keeps the
 // public methods non-blocking while allowing complex implementation details
 // with dependencies on the TPM, network, and filesystem to be coded in a more
-// readable way. It also serves to serialize method execution which reduces
-// complexity with TPM state.
+// readable way:
+//   - The worker thread owns the database and the key store. Lookups which
+//     need nothing else (GetKeyInfo, GetAttestationKeyInfo and
+//     RegisterKeyWithChapsToken) run on it directly. It also keeps a snapshot
+//     of the device identity in the database, which GetAttestationKeyInfo and
+//     GetEndorsementInfo answer from on the calling thread once it is kept.
+//   - The TPM thread runs requests which use the TPM, one at a time, which
+//     keeps TPM state simple. Their database and key store accesses are run
+//     on the worker thread while the TPM thread waits, so the database is only
+//     ever read and written on one thread.
+//   - When background preparation is enabled, the TPM thread also enrolls the
+//     device as soon as it is prepared and keeps a certified key ready for
+//     each prefetched certificate profile, between user requests. When key
+//     renewal is enabled, it renews certified keys one at a time once their
+//     certificates are about to expire, also between user requests.
+//   - The network thread sends Attestation CA requests. The TPM thread moves on
+//     to other requests while one is in flight and resumes the request that
+//     sent it when the reply arrives. Requests are asynchronous transfers on
+//     one long-lived HTTP transport, so several can be in flight at once and
+//     connections to the CA are reused.
+// So a lookup never waits for TPM key generation and a Sign never waits for an
+// Attestation CA round trip. The worker thread never waits for the other two,
+// which rules out deadlocks. Besides sealing the database key, it only asks the
+// TPM utility whether the TPM is ready.
 //
-// Tasks that run on the worker thread are bound with base::Unretained which is
-// safe because the thread is owned by this class (so it is guaranteed not to
-// process a task after destruction). Weak pointers are used to post replies
+// Tasks that run on these threads are bound with base::Unretained which is
+// safe because the threads are owned by this class (so they are guaranteed not
+// to process a task after destruction). Weak pointers are used to post replies
 // back to the main thread.
 class AttestationService : public AttestationInterface {
  public:
   AttestationService();
-  ~AttestationService() override = default;
+  ~AttestationService() override;
 
   // AttestationInterface methods.
   bool Initialize() override;
@@ -87,6 +127,15 @@ class AttestationService : public AttestationInterface {
   void Decrypt(const DecryptRequest& request,
                const DecryptCallback& callback) override;
   void Sign(const SignRequest& request, const SignCallback& callback) override;
+  void DecryptBatch(const DecryptBatchRequest& request,
+                    const DecryptBatchCallback& callback) override;
+  void SignBatch(const SignBatchRequest& request,
+                 const SignBatchCallback& callback) override;
+  void SignAggregated(const SignAggregatedRequest& request,
+                      const SignAggregatedCallback& callback) override;
+  void SignFile(const SignFileRequest& request,
+                int fd,
+                const SignCallback& callback) override;
   void RegisterKeyWithChapsToken(
       const RegisterKeyWithChapsTokenRequest& request,
       const RegisterKeyWithChapsTokenCallback& callback) override;
@@ -107,6 +156,38 @@ class AttestationService : public AttestationInterface {
 
   void set_tpm_utility(TpmUtility* tpm_utility) { tpm_utility_ = tpm_utility; }
 
+  void set_sign_aggregation_window(base::TimeDelta window) {
+    sign_aggregation_window_ = window;
+  }
+
+  void set_key_renewal_interval(base::TimeDelta interval) {
+    key_renewal_interval_ = interval;
+  }
+
+  // Enables background work which enrolls the device as soon as it is
+  // prepared for enrollment and then keeps an RSA signing key, certified for
+  // each of |prefetch_profiles|, ready for CreateGoogleAttestedKey. Must be
+  // called before Initialize().
+  void EnableBackgroundPreparation(
+      const std::vector<CertificateProfile>& prefetch_profiles) {
+    background_preparation_ = true;
+    prefetch_profiles_ = prefetch_profiles;
+  }
+
+  // Stores user keys with FileKeyStore instead of in PKCS #11 tokens, unless a
+  // key store has been set with set_key_store(). Keys are still registered
+  // with PKCS #11 tokens on request. Must be called before Initialize().
+  void EnableFileKeyStore() { file_key_store_ = true; }
+
+  // Enables background work which replaces a key certified by
+  // CreateGoogleAttestedKey with a new key, certified for the same profile
+  // and origin, once its certificate expires within |window|. The new key
+  // keeps the label and payload of the old one. Must be called before
+  // Initialize().
+  void EnableKeyRenewal(base::TimeDelta window) {
+    key_renewal_window_ = window;
+  }
+
   // So tests don't need to duplicate URL decisions.
   const std::string& attestation_ca_origin() { return attestation_ca_origin_; }
 
@@ -125,11 +206,168 @@ class AttestationService : public AttestationInterface {
     callback.Run(*reply);
   }
 
-  // A blocking implementation of CreateGoogleAttestedKey appropriate to run on
-  // the worker thread.
+  // Returns a closure which, run on any thread, posts |callback| with |reply|
+  // to the current thread. For requests which hop between threads and so
+  // cannot use TaskRunner::PostTaskAndReply.
+  template <typename ReplyProtobufType>
+  base::Closure CreateReplyClosure(
+      const base::Callback<void(const ReplyProtobufType&)>& callback,
+      const std::shared_ptr<ReplyProtobufType>& reply) {
+    return base::Bind(
+        base::IgnoreResult(&base::TaskRunner::PostTask),
+        base::ThreadTaskRunnerHandle::Get(), FROM_HERE,
+        base::Bind(&AttestationService::TaskRelayCallback<ReplyProtobufType>,
+                   GetWeakPtr(), callback, reply));
+  }
+
+  // Runs |function| on the worker thread, waiting for it unless already there,
+  // and returns its result.
+  template <typename ResultType>
+  ResultType CallOnWorkerThread(const base::Callback<ResultType()>& function) {
+    ResultType result{};
+    RunOnWorkerThreadAndWait(base::Bind(
+        [&result, &function]() { result = function.Run(); }));
+    return result;
+  }
+
+  // Runs |task| on the worker thread and waits for it unless already there.
+  void RunOnWorkerThreadAndWait(const base::Closure& task);
+
+  // Returns true if called on the worker thread.
+  bool IsOnWorkerThread() const;
+
+  // Called with whether an Attestation CA request succeeded and its reply.
+  using ACAReplyCallback =
+      base::Callback<void(bool success, const std::string& reply)>;
+
+  // Called with the outcome of an enrollment and, if the CA refused it, the
+  // error it gave.
+  using EnrollCallback = base::Callback<void(AttestationStatus status,
+                                             const std::string& server_error)>;
+
+  // The first step of CreateGoogleAttestedKey, run on the TPM thread. Enrolls
+  // the device if needed. Each step runs |done| unless it hands over to the
+  // next step.
   void CreateGoogleAttestedKeyTask(
       const CreateGoogleAttestedKeyRequest& request,
-      const std::shared_ptr<CreateGoogleAttestedKeyReply>& result);
+      const std::shared_ptr<CreateGoogleAttestedKeyReply>& result,
+      const base::Closure& done);
+
+  // Continues CreateGoogleAttestedKey once enrollment has finished.
+  void ContinueAfterEnrollTask(
+      const CreateGoogleAttestedKeyRequest& request,
+      const std::shared_ptr<CreateGoogleAttestedKeyReply>& result,
+      const base::Closure& done,
+      AttestationStatus status,
+      const std::string& server_error);
+
+  // Creates the key and asks the Attestation CA to certify it, unless a
+  // prefetched key matches the |request|.
+  void RequestCertificateTask(
+      const CreateGoogleAttestedKeyRequest& request,
+      const std::shared_ptr<CreateGoogleAttestedKeyReply>& result,
+      const base::Closure& done);
+
+  // Stores the certificate in the |certificate_reply| of the Attestation CA
+  // with the |key| it certifies.
+  void FinishCertificateTask(
+      const CreateGoogleAttestedKeyRequest& request,
+      const std::shared_ptr<CreateGoogleAttestedKeyReply>& result,
+      const base::Closure& done,
+      const CertifiedKey& key,
+      const std::string& message_id,
+      bool success,
+      const std::string& certificate_reply);
+
+  // Enrolls with the Attestation CA, or joins the enrollment in progress, and
+  // runs |callback| with the outcome. Runs on the TPM thread.
+  void EnrollTask(const EnrollCallback& callback);
+
+  // Finishes enrollment with the |enroll_reply| of the Attestation CA and runs
+  // the pending enroll callbacks.
+  void FinishEnrollTask(bool success, const std::string& enroll_reply);
+
+  // Runs and clears the pending enroll callbacks.
+  void RunEnrollCallbacks(AttestationStatus status,
+                          const std::string& server_error);
+
+  // The background preparation step, run on the TPM thread. Enrolls if needed
+  // and starts a prefetch for each profile without a key ready or in flight.
+  void BackgroundPreparationTask();
+
+  // Continues background preparation once enrollment has finished.
+  void ContinueBackgroundPreparationTask(AttestationStatus status,
+                                         const std::string& server_error);
+
+  // Runs BackgroundPreparationTask again later, after a failure or while the
+  // device is not prepared for enrollment.
+  void ScheduleBackgroundPreparation();
+
+  // Creates a key and asks the Attestation CA to certify it for |profile|.
+  void PrefetchCertificateTask(CertificateProfile profile);
+
+  // Keeps the prefetched |key| once the |certificate_reply| is in.
+  void FinishPrefetchTask(CertificateProfile profile,
+                          const CertifiedKey& key,
+                          const std::string& message_id,
+                          bool success,
+                          const std::string& certificate_reply);
+
+  // Moves a prefetched key which can serve |request| into |key|. Returns false
+  // if there is none.
+  bool TakePrefetchedKey(const CreateGoogleAttestedKeyRequest& request,
+                         CertifiedKey* key);
+
+  // Records when the certificate of |key|, stored for |username| and
+  // |key_label| and requested for |profile| and |origin|, expires, so the key
+  // is renewed in time. Does nothing unless key renewal is enabled.
+  void TrackKeyExpiry(const std::string& username,
+                      const std::string& key_label,
+                      CertificateProfile profile,
+                      const std::string& origin,
+                      const CertifiedKey& key);
+
+  // Adds or updates the renewal record for the key |renewable_key| describes.
+  // Runs on the worker thread.
+  void SaveRenewableKey(const RenewableKey& renewable_key);
+
+  // Removes the renewal record for |username| and |key_label|, if any. Runs on
+  // the worker thread.
+  void RemoveRenewableKey(const std::string& username,
+                          const std::string& key_label);
+
+  // Copies the record of the key due for renewal at |now| whose certificate
+  // expires first to |renewable_key| and marks the attempt. A key is due once
+  // its certificate expires within the renewal window, unless renewal was
+  // attempted within the last renewal interval. Returns false if no key is
+  // due. Runs on the worker thread.
+  bool TakeDueRenewableKey(int64_t now, RenewableKey* renewable_key);
+
+  // The key renewal step, run on the TPM thread. Renews one due key and runs
+  // again once that is done, or checks again after the renewal interval if
+  // there is none.
+  void KeyRenewalTask();
+
+  // Stores the |new_key| which renews |old_key| once the |certificate_reply|
+  // is in, then continues with the next due key.
+  void FinishKeyRenewalTask(const RenewableKey& renewable_key,
+                            const CertifiedKey& old_key,
+                            const CertifiedKey& new_key,
+                            const std::string& message_id,
+                            bool success,
+                            const std::string& certificate_reply);
+
+  // Runs KeyRenewalTask after |delay|. The next step is posted rather than
+  // run, so requests queued on the TPM thread go first.
+  void ScheduleKeyRenewal(base::TimeDelta delay);
+
+  // Saves |new_key| for |username| and |key_label| with the payload of the
+  // stored key, unless the stored key is no longer |old_key|. Returns true on
+  // success. Runs on the worker thread.
+  bool ReplaceRenewedKey(const std::string& username,
+                         const std::string& key_label,
+                         const CertifiedKey& old_key,
+                         CertifiedKey* new_key);
 
   // A blocking implementation of GetKeyInfo.
   void GetKeyInfoTask(const GetKeyInfoRequest& request,
@@ -145,6 +383,19 @@ class AttestationService : public AttestationInterface {
       const GetAttestationKeyInfoRequest& request,
       const std::shared_ptr<GetAttestationKeyInfoReply>& result);
 
+  // Fills |result| for a GetEndorsementInfo |request| of an RSA key from
+  // |database_pb|, which must hold the endorsement public key.
+  void GetEndorsementInfoFromDatabase(const GetEndorsementInfoRequest& request,
+                                      const AttestationDatabase& database_pb,
+                                      GetEndorsementInfoReply* result);
+
+  // Fills |result| for a GetAttestationKeyInfo |request| from |database_pb|.
+  // The TPM must be ready.
+  void GetAttestationKeyInfoFromDatabase(
+      const GetAttestationKeyInfoRequest& request,
+      const AttestationDatabase& database_pb,
+      GetAttestationKeyInfoReply* result);
+
   // A blocking implementation of ActivateAttestationKey.
   void ActivateAttestationKeyTask(
       const ActivateAttestationKeyRequest& request,
@@ -163,6 +414,39 @@ class AttestationService : public AttestationInterface {
   void SignTask(const SignRequest& request,
                 const std::shared_ptr<SignReply>& result);
 
+  // A blocking implementation of DecryptBatch. The key is looked up once and
+  // stays loaded for all payloads.
+  void DecryptBatchTask(const DecryptBatchRequest& request,
+                        const std::shared_ptr<DecryptBatchReply>& result);
+
+  // A blocking implementation of SignBatch. The key is looked up once and
+  // stays loaded for all payloads.
+  void SignBatchTask(const SignBatchRequest& request,
+                     const std::shared_ptr<SignBatchReply>& result);
+
+  // A blocking implementation of SignFile.
+  void SignFileTask(const SignFileRequest& request,
+                    base::ScopedFD fd,
+                    const std::shared_ptr<SignReply>& result);
+
+  // A SignAggregated request waiting for its batch to be signed.
+  struct PendingSignature {
+    std::string nonce;
+    SignAggregatedCallback callback;
+  };
+  using PendingSignatureBatch = std::vector<PendingSignature>;
+
+  // Signs the Merkle root over the nonces pending for |key_label| of
+  // |username|, if any, on the TPM thread.
+  void FlushSignatureBatch(const std::string& username,
+                           const std::string& key_label);
+
+  // Replies to every request of |batch| with the signature in |result| of the
+  // root of |tree| and the request's inclusion proof.
+  void OnSignatureBatchDone(const std::shared_ptr<MerkleTree>& tree,
+                            const std::shared_ptr<PendingSignatureBatch>& batch,
+                            const std::shared_ptr<SignReply>& result);
+
   // A synchronous implementation of RegisterKeyWithChapsToken.
   void RegisterKeyWithChapsTokenTask(
       const RegisterKeyWithChapsTokenRequest& request,
@@ -196,6 +480,14 @@ class AttestationService : public AttestationInterface {
                                 std::string* certificate_request,
                                 std::string* message_id);
 
+  // Decodes the |certificate_response| for the request with |message_id| and
+  // adds the certificates to |key|. Returns true on success. On failure,
+  // returns false and sets |server_error| to the error string from the CA.
+  bool ProcessCertificateResponse(const std::string& certificate_response,
+                                  const std::string& message_id,
+                                  CertifiedKey* key,
+                                  std::string* server_error);
+
   // Finishes a certificate request by decoding the |certificate_response| to
   // recover the |certificate_chain| and storing it in association with the
   // |key| identified by |username| and |key_label|. Returns true on success. On
@@ -209,11 +501,85 @@ class AttestationService : public AttestationInterface {
                                 std::string* certificate_chain,
                                 std::string* server_error);
 
-  // Sends a |request_type| |request| to the Google Attestation CA and waits for
-  // the |reply|. Returns true on success.
-  bool SendACARequestAndBlock(ACARequestType request_type,
-                              const std::string& request,
-                              std::string* reply);
+  // Sends a |request_type| |request| to the Google Attestation CA on the
+  // network thread. Once it is done, |callback| runs on the calling thread.
+  void PostACARequest(ACARequestType request_type,
+                      const std::string& request,
+                      const ACAReplyCallback& callback);
+
+  // Starts sending |request| on the network thread. The outcome is posted to
+  // |reply_task_runner| as a call to |callback|.
+  void StartACARequestTask(
+      ACARequestType request_type,
+      const std::string& request,
+      const scoped_refptr<base::TaskRunner>& reply_task_runner,
+      const ACAReplyCallback& callback);
+
+  // Completion handlers for the transfers started by StartACARequestTask.
+  void OnACAResponse(const scoped_refptr<base::TaskRunner>& reply_task_runner,
+                     const ACAReplyCallback& callback,
+                     brillo::http::RequestID request_id,
+                     std::unique_ptr<brillo::http::Response> response);
+  void OnACAError(const scoped_refptr<base::TaskRunner>& reply_task_runner,
+                  const ACAReplyCallback& callback,
+                  brillo::http::RequestID request_id,
+                  const brillo::Error* error);
+
+  // Returns a copy of the parts of the database protobuf which describe the
+  // device identity: everything but the device keys, the temporal index
+  // records, the alternate identity and the renewable keys. Read on the worker
+  // thread unless a snapshot is kept.
+  std::shared_ptr<const AttestationDatabase> ReadDatabaseSnapshot();
+
+  // Returns the kept database snapshot, or nullptr if there is none. Never
+  // waits for the worker thread.
+  std::shared_ptr<const AttestationDatabase> GetKeptDatabaseSnapshot();
+
+  // Drops the kept database snapshot and the replies kept with it once the
+  // database has changed. Called on the worker thread.
+  void DropDatabaseSnapshot();
+
+  // Copies |kept_reply| to |reply| if there is one. Returns true on success.
+  template <typename ReplyProtobufType>
+  bool GetKeptReply(const std::unique_ptr<ReplyProtobufType>& kept_reply,
+                    ReplyProtobufType* reply) {
+    base::AutoLock lock(database_snapshot_lock_);
+    if (!kept_reply) {
+      return false;
+    }
+    *reply = *kept_reply;
+    return true;
+  }
+
+  // Keeps a successful |reply| computed from |snapshot| in |kept_reply| if
+  // |snapshot| is still the kept database snapshot, so both are dropped
+  // together.
+  template <typename ReplyProtobufType>
+  void KeepReply(const std::shared_ptr<const AttestationDatabase>& snapshot,
+                 const ReplyProtobufType& reply,
+                 std::unique_ptr<ReplyProtobufType>* kept_reply) {
+    if (reply.status() != STATUS_SUCCESS) {
+      return;
+    }
+    base::AutoLock lock(database_snapshot_lock_);
+    if (snapshot == database_snapshot_) {
+      kept_reply->reset(new ReplyProtobufType(reply));
+    }
+  }
+
+  // Stores the endorsement |public_key| read from the TPM in the database. It
+  // is fixed for the life of the TPM, and the database only decrypts on the
+  // TPM which sealed its key, so it need not be read from the TPM again.
+  void SaveEndorsementPublicKey(const std::string& public_key);
+
+  // Stores the identity |credential| in the database. Returns true on success.
+  bool SaveIdentityCredential(const std::string& credential);
+
+  // Creates and certifies a new |key| with the given |key_type| and
+  // |key_usage| without saving it. Returns true on success.
+  bool CreateCertifiedKey(KeyType key_type,
+                          KeyUsage key_usage,
+                          CertifiedKey* key);
 
   // Creates, certifies, and saves a new |key| for |username| with the given
   // |key_label|, |key_type|, and |key_usage|. Returns true on success.
@@ -238,6 +604,29 @@ class AttestationService : public AttestationInterface {
   // Deletes the key associated with |username| and |key_label|.
   void DeleteKey(const std::string& username, const std::string& key_label);
 
+  // Returns the cached user key for |username| and |key_label| and marks it as
+  // most recently used, or nullptr if it is not cached. The key stays valid
+  // until the next change to the cache.
+  const CertifiedKey* FindCachedKey(const std::string& username,
+                                    const std::string& key_label);
+
+  // Caches the user |key| for |username| and |key_label|, evicting the least
+  // recently used key if the cache is full.
+  void CacheKey(const std::string& username,
+                const std::string& key_label,
+                const CertifiedKey& key);
+
+  // Removes any cached user key for |username| and |key_label|.
+  void EvictCachedKey(const std::string& username,
+                      const std::string& key_label);
+
+  // Returns the PEM certificate chain of |key|, which must be the key stored
+  // for |username| and |key_label|. The chain of a cached user key is built
+  // once and kept with it.
+  std::string GetCertificateChain(const std::string& username,
+                                  const std::string& key_label,
+                                  const CertifiedKey& key);
+
   // Adds named device-wide key to the attestation database.
   bool AddDeviceKey(const std::string& key_label, const CertifiedKey& key);
 
@@ -247,8 +636,9 @@ class AttestationService : public AttestationInterface {
   // Creates a PEM certificate chain from the credential fields of a |key|.
   std::string CreatePEMCertificateChain(const CertifiedKey& key);
 
-  // Creates a certificate in PEM format from a DER encoded X.509 certificate.
-  std::string CreatePEMCertificate(const std::string& certificate);
+  // Appends a certificate in PEM format from a DER encoded X.509 certificate
+  // to |pem|.
+  void AppendPEMCertificate(const std::string& certificate, std::string* pem);
 
   // Chooses a temporal index which will be used by the ACA to create a
   // certificate.  This decision factors in the currently signed-in |user| and
@@ -269,27 +659,81 @@ class AttestationService : public AttestationInterface {
 
   const std::string attestation_ca_origin_;
 
-  // Other than initialization and destruction, these are used only by the
-  // worker thread.
+  // Other than initialization and destruction, the database and the key store
+  // are used only by the worker thread, the HTTP transport only by the network
+  // thread and the others mostly by the TPM thread.
   CryptoUtility* crypto_utility_{nullptr};
   Database* database_{nullptr};
   std::shared_ptr<brillo::http::Transport> http_transport_;
   KeyStore* key_store_{nullptr};
   TpmUtility* tpm_utility_{nullptr};
 
+  // Used only by the worker thread. Recently used user keys, most recently
+  // used first, so hot keys are not read back from the key store and parsed
+  // on every use. Device keys are indexed by the database instead. The
+  // certificate chain is built on first use; saving a key replaces its entry.
+  struct CachedKey {
+    std::string username;
+    std::string key_label;
+    CertifiedKey key;
+    std::string certificate_chain;
+  };
+  std::list<CachedKey> key_cache_;
+
+  // The snapshot ReadDatabaseSnapshot() last read, kept while the database is
+  // unchanged so lookups need not wait for the worker thread. Written only by
+  // the worker thread and only while the TPM is ready, which it then stays.
+  base::Lock database_snapshot_lock_;
+  std::shared_ptr<const AttestationDatabase> database_snapshot_;
+  // Identity lookup replies computed from |database_snapshot_|, so public keys
+  // are not converted again on every lookup.
+  std::unique_ptr<GetEndorsementInfoReply> endorsement_info_;
+  std::unique_ptr<GetAttestationKeyInfoReply> attestation_key_info_;
+
+  // See EnableFileKeyStore.
+  bool file_key_store_{false};
+
+  // Background preparation settings, see EnableBackgroundPreparation.
+  bool background_preparation_{false};
+  std::vector<CertificateProfile> prefetch_profiles_;
+
+  // Used only by the TPM thread. Callbacks waiting for the enrollment in
+  // progress, if any, and prefetched keys with their certificates by profile.
+  std::vector<EnrollCallback> enroll_callbacks_;
+  std::map<CertificateProfile, CertifiedKey> prefetched_keys_;
+  std::set<CertificateProfile> prefetches_in_flight_;
+
+  // Key renewal settings, see EnableKeyRenewal. Renewal is disabled while the
+  // window is zero.
+  base::TimeDelta key_renewal_window_;
+  base::TimeDelta key_renewal_interval_;
+
+  // Used only by the origin thread. SignAggregated requests waiting for the
+  // aggregation window of their key to close, by username and key label.
+  base::TimeDelta sign_aggregation_window_;
+  std::map<std::pair<std::string, std::string>, PendingSignatureBatch>
+      pending_signatures_;
+
   // Default implementations for the above interfaces. These will be setup
   // during Initialize() if the corresponding interface has not been set with a
   // mutator.
   std::unique_ptr<CryptoUtilityImpl> default_crypto_utility_;
   std::unique_ptr<DatabaseImpl> default_database_;
   std::unique_ptr<Pkcs11KeyStore> default_key_store_;
+  std::unique_ptr<FileKeyStore> default_file_key_store_;
   std::unique_ptr<chaps::TokenManagerClient> pkcs11_token_manager_;
+#if defined(USE_TPM2)
+  std::unique_ptr<TpmUtilityV2> default_tpm_utility_;
+#else
   std::unique_ptr<TpmUtilityV1> default_tpm_utility_;
+#endif
 
-  // All work is done in the background. This serves to serialize requests and
-  // allow synchronous implementation of complex methods. This is intentionally
-  // declared after the thread-owned members.
+  // All work is done in the background, see THREADING NOTES. These are
+  // intentionally declared after the thread-owned members, and in this order
+  // so each thread is stopped before the threads it posts to or waits for.
   std::unique_ptr<base::Thread> worker_thread_;
+  std::unique_ptr<base::Thread> network_thread_;
+  std::unique_ptr<base::Thread> tpm_thread_;
 
   // Declared last so any weak pointers are destroyed first.
   base::WeakPtrFactory<AttestationService> weak_factory_;
@@ -14,12 +14,18 @@
 // limitations under the License.
 //
 
+#include <fcntl.h>
+
 #include <string>
+#include <vector>
 
 #include <base/bind.h>
 #include <base/callback.h>
+#include <base/files/scoped_file.h>
 #include <base/message_loop/message_loop.h>
+#include <base/posix/eintr_wrapper.h>
 #include <base/run_loop.h>
+#include <base/synchronization/waitable_event.h>
 #include <brillo/bind_lambda.h>
 #include <brillo/data_encoding.h>
 #include <brillo/http/http_transport_fake.h>
@@ -28,6 +34,7 @@
 #include <gtest/gtest.h>
 
 #include "attestation/common/attestation_ca.pb.h"
+#include "attestation/common/merkle_tree.h"
 #include "attestation/common/mock_crypto_utility.h"
 #include "attestation/common/mock_tpm_utility.h"
 #include "attestation/server/attestation_service.h"
@@ -38,6 +45,9 @@ using brillo::http::fake::ServerRequest;
 using brillo::http::fake::ServerResponse;
 using testing::_;
 using testing::DoAll;
+using testing::DoDefault;
+using testing::ElementsAre;
+using testing::Invoke;
 using testing::NiceMock;
 using testing::Return;
 using testing::ReturnRef;
@@ -56,13 +66,8 @@ class AttestationServiceTest : public testing::Test {
 
   ~AttestationServiceTest() override = default;
   void SetUp() override {
-    service_.reset(new AttestationService);
-    service_->set_database(&mock_database_);
-    service_->set_crypto_utility(&mock_crypto_utility_);
     fake_http_transport_ = std::make_shared<brillo::http::fake::Transport>();
-    service_->set_http_transport(fake_http_transport_);
-    service_->set_key_store(&mock_key_store_);
-    service_->set_tpm_utility(&mock_tpm_utility_);
+    CreateService();
     // Setup a fake wrapped EK certificate by default.
     mock_database_.GetMutableProtobuf()
         ->mutable_credentials()
@@ -75,6 +80,16 @@ class AttestationServiceTest : public testing::Test {
   }
 
  protected:
+  // Replaces |service_| with a new, uninitialized service using the mocks.
+  void CreateService() {
+    service_.reset(new AttestationService);
+    service_->set_database(&mock_database_);
+    service_->set_crypto_utility(&mock_crypto_utility_);
+    service_->set_http_transport(fake_http_transport_);
+    service_->set_key_store(&mock_key_store_);
+    service_->set_tpm_utility(&mock_tpm_utility_);
+  }
+
   void SetupFakeCAEnroll(FakeCAState state) {
     fake_http_transport_->AddHandler(
         service_->attestation_ca_origin() + "/enroll",
@@ -121,6 +136,11 @@ class AttestationServiceTest : public testing::Test {
 
   void Quit() { run_loop_.Quit(); }
 
+  // Unless nullptr, the fake Attestation CA waits for this before answering
+  // enroll requests.
+  base::WaitableEvent* enroll_gate_{nullptr};
+  // The number of enroll requests the fake Attestation CA has received.
+  int enroll_count_{0};
   std::shared_ptr<brillo::http::fake::Transport> fake_http_transport_;
   NiceMock<MockCryptoUtility> mock_crypto_utility_;
   NiceMock<MockDatabase> mock_database_;
@@ -132,6 +152,10 @@ class AttestationServiceTest : public testing::Test {
   void FakeCAEnroll(FakeCAState state,
                     const ServerRequest& request,
                     ServerResponse* response) {
+    if (enroll_gate_) {
+      EXPECT_TRUE(enroll_gate_->TimedWait(base::TimeDelta::FromSeconds(5)));
+    }
+    ++enroll_count_;
     AttestationEnrollmentRequest request_pb;
     EXPECT_TRUE(request_pb.ParseFromString(request.GetDataAsString()));
     if (state == kHttpFailure) {
@@ -219,6 +243,102 @@ TEST_F(AttestationServiceTest, CreateGoogleAttestedKeySuccessNoUser) {
   Run();
 }
 
+// Tests that a request made while background enrollment is in progress waits
+// for it instead of enrolling again.
+TEST_F(AttestationServiceTest, CreateGoogleAttestedKeyDuringBackgroundEnroll) {
+  CreateService();
+  service_->EnableBackgroundPreparation(std::vector<CertificateProfile>());
+  ASSERT_TRUE(service_->Initialize());
+  auto callback = [this](const CreateGoogleAttestedKeyReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ(GetFakeCertificateChain(), reply.certificate_chain());
+    Quit();
+  };
+  service_->CreateGoogleAttestedKey(GetCreateRequest(), base::Bind(callback));
+  Run();
+  EXPECT_EQ(1, enroll_count_);
+}
+
+// Tests that a request for a prefetched profile is served with the prefetched
+// key, without another Attestation CA round trip.
+TEST_F(AttestationServiceTest, CreateGoogleAttestedKeyPrefetched) {
+  CreateService();
+  service_->EnableBackgroundPreparation({ENTERPRISE_USER_CERTIFICATE});
+  ASSERT_TRUE(service_->Initialize());
+  // The prefetch is sent as soon as enrollment is done, so by the time this
+  // request for another profile has been answered the prefetched key is ready.
+  base::RunLoop first_run_loop;
+  auto first_callback = [&first_run_loop](
+                            const CreateGoogleAttestedKeyReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    first_run_loop.Quit();
+  };
+  service_->CreateGoogleAttestedKey(GetCreateRequest(),
+                                    base::Bind(first_callback));
+  first_run_loop.Run();
+  SetupFakeCASign(kHttpFailure);
+  EXPECT_CALL(mock_key_store_, Write("user", "prefetched_label", _))
+      .WillOnce(Return(true));
+  auto callback = [this](const CreateGoogleAttestedKeyReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ(GetFakeCertificateChain(), reply.certificate_chain());
+    Quit();
+  };
+  CreateGoogleAttestedKeyRequest request = GetCreateRequest();
+  request.set_key_label("prefetched_label");
+  request.set_key_type(KEY_TYPE_RSA);
+  request.set_certificate_profile(ENTERPRISE_USER_CERTIFICATE);
+  request.clear_origin();
+  service_->CreateGoogleAttestedKey(request, base::Bind(callback));
+  Run();
+}
+
+// Tests that a key whose certificate expires within the renewal window is
+// replaced with a new key, certified for the same profile.
+TEST_F(AttestationServiceTest, RenewKeyBeforeCertificateExpires) {
+  CreateService();
+  service_->EnableKeyRenewal(base::TimeDelta::FromDays(30));
+  service_->set_key_renewal_interval(base::TimeDelta::FromMilliseconds(10));
+  ASSERT_TRUE(service_->Initialize());
+  int64_t now = base::Time::Now().ToTimeT();
+  // Only the first certificate expires within the window.
+  EXPECT_CALL(mock_crypto_utility_, GetCertificateNotAfter("fake_cert", _))
+      .WillOnce(DoAll(SetArgumentPointee<1>(now + 60), Return(true)))
+      .WillRepeatedly(
+          DoAll(SetArgumentPointee<1>(now + 365 * 24 * 60 * 60), Return(true)));
+  EXPECT_CALL(mock_tpm_utility_, CreateCertifiedKey(_, _, _, _, _, _, _, _, _))
+      .WillOnce(DoAll(SetArgumentPointee<4>(std::string("old_blob")),
+                      Return(true)))
+      .WillOnce(DoAll(SetArgumentPointee<4>(std::string("new_blob")),
+                      Return(true)));
+  base::WaitableEvent renewed(base::WaitableEvent::ResetPolicy::MANUAL,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED);
+  CertifiedKey renewed_key;
+  // The key is written once when it is created, once with its certificate and
+  // once more when it is renewed.
+  EXPECT_CALL(mock_key_store_, Write("user", "label", _))
+      .WillOnce(Return(true))
+      .WillOnce(Return(true))
+      .WillOnce(Invoke([&renewed, &renewed_key](const std::string& username,
+                                                const std::string& key_label,
+                                                const std::string& key_data) {
+        EXPECT_TRUE(renewed_key.ParseFromString(key_data));
+        renewed.Signal();
+        return true;
+      }));
+  auto callback = [this](const CreateGoogleAttestedKeyReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    Quit();
+  };
+  service_->CreateGoogleAttestedKey(GetCreateRequest(), base::Bind(callback));
+  Run();
+  ASSERT_TRUE(renewed.TimedWait(base::TimeDelta::FromSeconds(5)));
+  EXPECT_EQ("new_blob", renewed_key.key_blob());
+  EXPECT_EQ("label", renewed_key.key_name());
+  EXPECT_EQ(KEY_TYPE_ECC, renewed_key.key_type());
+  EXPECT_EQ("fake_cert", renewed_key.certified_key_credential());
+}
+
 TEST_F(AttestationServiceTest, CreateGoogleAttestedKeyWithEnrollHttpError) {
   SetupFakeCAEnroll(kHttpFailure);
   // Set expectations on the outputs.
@@ -437,6 +557,73 @@ TEST_F(AttestationServiceTest, CreateGoogleAttestedKeyAndCancel2) {
   EXPECT_EQ(0, callback_count);
 }
 
+TEST_F(AttestationServiceTest, SignDuringCARequest) {
+  // The enrollment reply is held back until the Sign is done, which would
+  // never happen if the TPM thread waited for it.
+  base::WaitableEvent sign_done(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  enroll_gate_ = &sign_done;
+  int callback_count = 0;
+  auto create_callback =
+      [this, &callback_count](const CreateGoogleAttestedKeyReply& reply) {
+        EXPECT_EQ(STATUS_SUCCESS, reply.status());
+        if (++callback_count == 2) {
+          Quit();
+        }
+      };
+  auto sign_callback = [this, &callback_count,
+                        &sign_done](const SignReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    sign_done.Signal();
+    if (++callback_count == 2) {
+      Quit();
+    }
+  };
+  service_->CreateGoogleAttestedKey(GetCreateRequest(),
+                                    base::Bind(create_callback));
+  SignRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  request.set_data_to_sign("data");
+  service_->Sign(request, base::Bind(sign_callback));
+  Run();
+}
+
+TEST_F(AttestationServiceTest, GetKeyInfoDuringTpmOperation) {
+  // The Sign is held in the TPM until the GetKeyInfo sent after it is done,
+  // which would never happen if lookups waited for the TPM.
+  base::WaitableEvent lookup_done(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  EXPECT_CALL(mock_tpm_utility_, Sign(_, "data", _))
+      .WillOnce(Invoke([&lookup_done](const std::string& key_blob,
+                                      const std::string& data_to_sign,
+                                      std::string* signature) {
+        EXPECT_TRUE(lookup_done.TimedWait(base::TimeDelta::FromSeconds(5)));
+        *signature = "signature";
+        return true;
+      }));
+  auto sign_callback = [this](const SignReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ("signature", reply.signature());
+    Quit();
+  };
+  auto key_info_callback = [&lookup_done](const GetKeyInfoReply& reply) {
+    lookup_done.Signal();
+  };
+  SignRequest sign_request;
+  sign_request.set_key_label("label");
+  sign_request.set_username("user");
+  sign_request.set_data_to_sign("data");
+  service_->Sign(sign_request, base::Bind(sign_callback));
+  GetKeyInfoRequest key_info_request;
+  key_info_request.set_key_label("label");
+  key_info_request.set_username("user");
+  service_->GetKeyInfo(key_info_request, base::Bind(key_info_callback));
+  Run();
+}
+
 TEST_F(AttestationServiceTest, GetKeyInfoSuccess) {
   // Setup a certified key in the key store.
   CertifiedKey key;
@@ -472,6 +659,71 @@ TEST_F(AttestationServiceTest, GetKeyInfoSuccess) {
   Run();
 }
 
+TEST_F(AttestationServiceTest, GetKeyInfoFieldMask) {
+  // Setup a certified key in the key store.
+  CertifiedKey key;
+  key.set_public_key("public_key");
+  key.set_certified_key_credential("fake_cert");
+  key.set_intermediate_ca_cert("fake_ca_cert");
+  key.set_key_name("label");
+  key.set_certified_key_info("certify_info");
+  key.set_certified_key_proof("signature");
+  key.set_key_type(KEY_TYPE_RSA);
+  key.set_key_usage(KEY_USAGE_SIGN);
+  std::string key_bytes;
+  key.SerializeToString(&key_bytes);
+  EXPECT_CALL(mock_key_store_, Read("user", "label", _))
+      .WillOnce(DoAll(SetArgumentPointee<2>(key_bytes), Return(true)));
+
+  // Set expectations on the outputs.
+  auto callback = [this](const GetKeyInfoReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ(KEY_TYPE_RSA, reply.key_type());
+    EXPECT_EQ("public_key", reply.public_key());
+    EXPECT_FALSE(reply.has_certify_info());
+    EXPECT_FALSE(reply.has_certify_info_signature());
+    EXPECT_FALSE(reply.has_certificate());
+    Quit();
+  };
+  GetKeyInfoRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  request.set_field_mask(KEY_INFO_PUBLIC_KEY);
+  service_->GetKeyInfo(request, base::Bind(callback));
+  Run();
+}
+
+TEST_F(AttestationServiceTest, GetKeyInfoEmptyFieldMask) {
+  CertifiedKey key;
+  key.set_public_key("public_key");
+  key.set_key_name("label");
+  key.set_key_type(KEY_TYPE_RSA);
+  key.set_key_usage(KEY_USAGE_SIGN);
+  std::string key_bytes;
+  key.SerializeToString(&key_bytes);
+  EXPECT_CALL(mock_key_store_, Read("user", "label", _))
+      .WillOnce(DoAll(SetArgumentPointee<2>(key_bytes), Return(true)));
+  // An empty mask only checks that the key exists, so the public key is not
+  // converted.
+  EXPECT_CALL(mock_crypto_utility_, GetRSASubjectPublicKeyInfo(_, _)).Times(0);
+
+  // Set expectations on the outputs.
+  auto callback = [this](const GetKeyInfoReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ(KEY_USAGE_SIGN, reply.key_usage());
+    EXPECT_FALSE(reply.has_public_key());
+    EXPECT_FALSE(reply.has_certify_info());
+    EXPECT_FALSE(reply.has_certificate());
+    Quit();
+  };
+  GetKeyInfoRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  request.set_field_mask(0);
+  service_->GetKeyInfo(request, base::Bind(callback));
+  Run();
+}
+
 TEST_F(AttestationServiceTest, GetKeyInfoSuccessNoUser) {
   // Setup a certified key in the device key store.
   CertifiedKey& key = *mock_database_.GetMutableProtobuf()->add_device_keys();
@@ -565,6 +817,31 @@ TEST_F(AttestationServiceTest, GetEndorsementInfoNoInfo) {
   Run();
 }
 
+TEST_F(AttestationServiceTest, GetEndorsementInfoReadsTpmOnce) {
+  // The public key read from the TPM is stored for later lookups.
+  EXPECT_CALL(mock_tpm_utility_, GetEndorsementPublicKey(_))
+      .WillOnce(DoAll(SetArgumentPointee<0>(std::string("public_key")),
+                      Return(true)));
+  GetEndorsementInfoRequest request;
+  request.set_key_type(KEY_TYPE_RSA);
+  auto second_callback = [this](const GetEndorsementInfoReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ("public_key", reply.ek_public_key());
+    EXPECT_EQ("public_key", mock_database_.GetProtobuf()
+                                .credentials()
+                                .endorsement_public_key());
+    Quit();
+  };
+  auto first_callback = [this, request, second_callback](
+      const GetEndorsementInfoReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ("public_key", reply.ek_public_key());
+    service_->GetEndorsementInfo(request, base::Bind(second_callback));
+  };
+  service_->GetEndorsementInfo(request, base::Bind(first_callback));
+  Run();
+}
+
 TEST_F(AttestationServiceTest, GetEndorsementInfoNoCert) {
   AttestationDatabase* database = mock_database_.GetMutableProtobuf();
   database->mutable_credentials()->set_endorsement_public_key("public_key");
@@ -641,6 +918,63 @@ TEST_F(AttestationServiceTest, GetAttestationKeyInfoSomeInfo) {
   Run();
 }
 
+TEST_F(AttestationServiceTest, GetAttestationKeyInfoFromSnapshot) {
+  AttestationDatabase* database = mock_database_.GetMutableProtobuf();
+  database->mutable_identity_key()->set_identity_credential("certificate");
+  GetAttestationKeyInfoRequest request;
+  request.set_key_type(KEY_TYPE_RSA);
+  // The second lookup is answered from the snapshot the first one kept, so it
+  // does not see a change the database was not told about.
+  auto second_callback = [this](const GetAttestationKeyInfoReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ("certificate", reply.certificate());
+    Quit();
+  };
+  auto first_callback = [this, database, request, second_callback](
+      const GetAttestationKeyInfoReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ("certificate", reply.certificate());
+    database->mutable_identity_key()->set_identity_credential("unseen");
+    service_->GetAttestationKeyInfo(request, base::Bind(second_callback));
+  };
+  service_->GetAttestationKeyInfo(request, base::Bind(first_callback));
+  Run();
+}
+
+TEST_F(AttestationServiceTest, GetAttestationKeyInfoAfterActivate) {
+  AttestationDatabase* database = mock_database_.GetMutableProtobuf();
+  database->mutable_identity_key()->set_identity_credential("old_certificate");
+  EXPECT_CALL(mock_tpm_utility_, ActivateIdentity(_, _, _, _, _, _))
+      .WillOnce(DoAll(SetArgumentPointee<5>(std::string("certificate")),
+                      Return(true)));
+  GetAttestationKeyInfoRequest info_request;
+  info_request.set_key_type(KEY_TYPE_RSA);
+  ActivateAttestationKeyRequest activate_request;
+  activate_request.set_key_type(KEY_TYPE_RSA);
+  activate_request.set_save_certificate(true);
+  // Saving the certificate drops the snapshot the first lookup kept.
+  auto new_info_callback = [this](const GetAttestationKeyInfoReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ("certificate", reply.certificate());
+    Quit();
+  };
+  auto activate_callback = [this, info_request, new_info_callback](
+      const ActivateAttestationKeyReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    service_->GetAttestationKeyInfo(info_request,
+                                    base::Bind(new_info_callback));
+  };
+  auto old_info_callback = [this, activate_request, activate_callback](
+      const GetAttestationKeyInfoReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ("old_certificate", reply.certificate());
+    service_->ActivateAttestationKey(activate_request,
+                                     base::Bind(activate_callback));
+  };
+  service_->GetAttestationKeyInfo(info_request, base::Bind(old_info_callback));
+  Run();
+}
+
 TEST_F(AttestationServiceTest, ActivateAttestationKeySuccess) {
   EXPECT_CALL(mock_database_, SaveChanges()).Times(1);
   EXPECT_CALL(mock_tpm_utility_,
@@ -1006,6 +1340,253 @@ TEST_F(AttestationServiceTest, SignUnbindFailure) {
   Run();
 }
 
+TEST_F(AttestationServiceTest, SignUsesCachedKey) {
+  // Only the first Sign reads the key from the key store.
+  EXPECT_CALL(mock_key_store_, Read("user", "label", _)).Times(1);
+  int callback_count = 0;
+  auto callback = [this, &callback_count](const SignReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    if (++callback_count == 2) {
+      Quit();
+    }
+  };
+  SignRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  request.set_data_to_sign("data");
+  service_->Sign(request, base::Bind(callback));
+  service_->Sign(request, base::Bind(callback));
+  Run();
+}
+
+TEST_F(AttestationServiceTest, GetKeyInfoAfterNewCertificate) {
+  // Setup a certified key in the key store with another certificate.
+  CertifiedKey key;
+  key.set_certified_key_credential("old_cert");
+  key.set_intermediate_ca_cert("fake_ca_cert");
+  key.set_key_name("label");
+  std::string key_bytes;
+  key.SerializeToString(&key_bytes);
+  EXPECT_CALL(mock_key_store_, Read("user", "label", _))
+      .WillOnce(DoAll(SetArgumentPointee<2>(key_bytes), Return(true)));
+  // The certificate chain cached with the old key is not reused.
+  GetKeyInfoRequest info_request;
+  info_request.set_key_label("label");
+  info_request.set_username("user");
+  auto new_info_callback = [this](const GetKeyInfoReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ(GetFakeCertificateChain(), reply.certificate());
+    Quit();
+  };
+  auto create_callback =
+      [this, info_request,
+       new_info_callback](const CreateGoogleAttestedKeyReply& reply) {
+        EXPECT_EQ(STATUS_SUCCESS, reply.status());
+        service_->GetKeyInfo(info_request, base::Bind(new_info_callback));
+      };
+  auto old_info_callback = [this,
+                            create_callback](const GetKeyInfoReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_NE(GetFakeCertificateChain(), reply.certificate());
+    service_->CreateGoogleAttestedKey(GetCreateRequest(),
+                                      base::Bind(create_callback));
+  };
+  service_->GetKeyInfo(info_request, base::Bind(old_info_callback));
+  Run();
+}
+
+TEST_F(AttestationServiceTest, SignAfterRegisterReadsKey) {
+  // Registering deletes the key, so it is not served from the cache after.
+  EXPECT_CALL(mock_key_store_, Read("user", "label", _))
+      .WillOnce(DoDefault())
+      .WillOnce(Return(false));
+  auto sign_callback = [this](const SignReply& reply) {
+    EXPECT_NE(STATUS_SUCCESS, reply.status());
+    Quit();
+  };
+  auto register_callback =
+      [this, sign_callback](const RegisterKeyWithChapsTokenReply& reply) {
+        EXPECT_EQ(STATUS_SUCCESS, reply.status());
+        SignRequest request;
+        request.set_key_label("label");
+        request.set_username("user");
+        request.set_data_to_sign("data");
+        service_->Sign(request, base::Bind(sign_callback));
+      };
+  RegisterKeyWithChapsTokenRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  service_->RegisterKeyWithChapsToken(request, base::Bind(register_callback));
+  Run();
+}
+
+TEST_F(AttestationServiceTest, DecryptBatchSuccess) {
+  // The key is looked up once for the whole batch.
+  EXPECT_CALL(mock_key_store_, Read("user", "label", _)).Times(1);
+  // Set expectations on the outputs.
+  auto callback = [this](const DecryptBatchReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_THAT(reply.decrypted_data(),
+                ElementsAre(MockTpmUtility::Transform("Unbind", "data1"),
+                            MockTpmUtility::Transform("Unbind", "data2")));
+    Quit();
+  };
+  DecryptBatchRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  request.add_encrypted_data("data1");
+  request.add_encrypted_data("data2");
+  service_->DecryptBatch(request, base::Bind(callback));
+  Run();
+}
+
+TEST_F(AttestationServiceTest, SignBatchSuccess) {
+  // The key is looked up once for the whole batch.
+  EXPECT_CALL(mock_key_store_, Read("user", "label", _)).Times(1);
+  // Set expectations on the outputs.
+  auto callback = [this](const SignBatchReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_THAT(reply.signature(),
+                ElementsAre(MockTpmUtility::Transform("Sign", "data1"),
+                            MockTpmUtility::Transform("Sign", "data2")));
+    Quit();
+  };
+  SignBatchRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  request.add_data_to_sign("data1");
+  request.add_data_to_sign("data2");
+  service_->SignBatch(request, base::Bind(callback));
+  Run();
+}
+
+TEST_F(AttestationServiceTest, SignBatchFailure) {
+  // The second signature fails.
+  EXPECT_CALL(mock_tpm_utility_, Sign(_, _, _))
+      .WillOnce(DoDefault())
+      .WillOnce(Return(false));
+  // Set expectations on the outputs.
+  auto callback = [this](const SignBatchReply& reply) {
+    EXPECT_NE(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ(0, reply.signature_size());
+    Quit();
+  };
+  SignBatchRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  request.add_data_to_sign("data1");
+  request.add_data_to_sign("data2");
+  service_->SignBatch(request, base::Bind(callback));
+  Run();
+}
+
+TEST_F(AttestationServiceTest, SignAggregatedSuccess) {
+  // Nonces for the same key which arrive together share one signature.
+  EXPECT_CALL(mock_tpm_utility_, Sign(_, _, _)).Times(1);
+  std::vector<std::string> nonces = {"nonce1", "nonce2", "nonce3"};
+  MerkleTree tree(nonces);
+  int callback_count = 0;
+  auto callback = [this, &nonces, &tree, &callback_count](
+      const SignAggregatedReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ(MockTpmUtility::Transform("Sign", tree.root()),
+              reply.signature());
+    EXPECT_EQ(tree.root(), reply.merkle_root());
+    EXPECT_EQ(3, reply.leaf_count());
+    std::vector<std::string> proof(reply.inclusion_proof().begin(),
+                                   reply.inclusion_proof().end());
+    EXPECT_TRUE(MerkleTree::VerifyInclusionProof(
+        nonces[reply.leaf_index()], reply.leaf_index(), reply.leaf_count(),
+        proof, reply.merkle_root()));
+    if (++callback_count == 3) {
+      Quit();
+    }
+  };
+  service_->set_sign_aggregation_window(base::TimeDelta());
+  for (const auto& nonce : nonces) {
+    SignAggregatedRequest request;
+    request.set_key_label("label");
+    request.set_username("user");
+    request.set_nonce(nonce);
+    service_->SignAggregated(request, base::Bind(callback));
+  }
+  Run();
+}
+
+TEST_F(AttestationServiceTest, SignAggregatedFailure) {
+  EXPECT_CALL(mock_tpm_utility_, Sign(_, _, _)).WillOnce(Return(false));
+  int callback_count = 0;
+  auto callback = [this, &callback_count](const SignAggregatedReply& reply) {
+    EXPECT_NE(STATUS_SUCCESS, reply.status());
+    EXPECT_FALSE(reply.has_signature());
+    EXPECT_EQ(0, reply.inclusion_proof_size());
+    if (++callback_count == 2) {
+      Quit();
+    }
+  };
+  service_->set_sign_aggregation_window(base::TimeDelta());
+  SignAggregatedRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  request.set_nonce("nonce1");
+  service_->SignAggregated(request, base::Bind(callback));
+  request.set_nonce("nonce2");
+  service_->SignAggregated(request, base::Bind(callback));
+  Run();
+}
+
+TEST_F(AttestationServiceTest, SignFileSuccess) {
+  EXPECT_CALL(mock_tpm_utility_, SignFile(_, _, _))
+      .WillOnce(DoAll(SetArgumentPointee<2>("signature"), Return(true)));
+  // Set expectations on the outputs.
+  auto callback = [this](const SignReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_EQ("signature", reply.signature());
+    Quit();
+  };
+  base::ScopedFD fd(HANDLE_EINTR(open("/dev/null", O_RDONLY)));
+  ASSERT_TRUE(fd.is_valid());
+  SignFileRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  service_->SignFile(request, fd.get(), base::Bind(callback));
+  // The service does not depend on the caller's descriptor staying open.
+  fd.reset();
+  Run();
+}
+
+TEST_F(AttestationServiceTest, SignFileBadFileDescriptor) {
+  EXPECT_CALL(mock_tpm_utility_, SignFile(_, _, _)).Times(0);
+  // Set expectations on the outputs.
+  auto callback = [this](const SignReply& reply) {
+    EXPECT_EQ(STATUS_INVALID_PARAMETER, reply.status());
+    EXPECT_FALSE(reply.has_signature());
+    Quit();
+  };
+  SignFileRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  service_->SignFile(request, -1, base::Bind(callback));
+  Run();
+}
+
+TEST_F(AttestationServiceTest, SignFileFailure) {
+  EXPECT_CALL(mock_tpm_utility_, SignFile(_, _, _)).WillOnce(Return(false));
+  // Set expectations on the outputs.
+  auto callback = [this](const SignReply& reply) {
+    EXPECT_NE(STATUS_SUCCESS, reply.status());
+    EXPECT_FALSE(reply.has_signature());
+    Quit();
+  };
+  base::ScopedFD fd(HANDLE_EINTR(open("/dev/null", O_RDONLY)));
+  ASSERT_TRUE(fd.is_valid());
+  SignFileRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  service_->SignFile(request, fd.get(), base::Bind(callback));
+  Run();
+}
+
 TEST_F(AttestationServiceTest, RegisterSuccess) {
   // Setup a key in the user key store.
   CertifiedKey key;
@@ -1023,14 +1604,15 @@ TEST_F(AttestationServiceTest, RegisterSuccess) {
       .WillOnce(DoAll(SetArgumentPointee<2>(key_bytes), Return(true)));
   // Cardinality is verified here to verify various steps are performed and to
   // catch performance regressions.
+  std::vector<std::string> ca_certs = {"fake_ca_cert", "fake_ca_cert2"};
   EXPECT_CALL(mock_key_store_,
-              Register("user", "label", KEY_TYPE_RSA, KEY_USAGE_SIGN,
-                       "key_blob", "public_key", "fake_cert"))
-      .Times(1);
-  EXPECT_CALL(mock_key_store_, RegisterCertificate("user", "fake_ca_cert"))
-      .Times(1);
-  EXPECT_CALL(mock_key_store_, RegisterCertificate("user", "fake_ca_cert2"))
+              RegisterWithCertificateChain("user", "label", KEY_TYPE_RSA,
+                                           KEY_USAGE_SIGN, "key_blob",
+                                           "public_key", "fake_cert",
+                                           ca_certs))
       .Times(1);
+  EXPECT_CALL(mock_key_store_, Register(_, _, _, _, _, _, _)).Times(0);
+  EXPECT_CALL(mock_key_store_, RegisterCertificate(_, _)).Times(0);
   EXPECT_CALL(mock_key_store_, Delete("user", "label")).Times(1);
   // Set expectations on the outputs.
   auto callback = [this](const RegisterKeyWithChapsTokenReply& reply) {
@@ -1057,14 +1639,15 @@ TEST_F(AttestationServiceTest, RegisterSuccessNoUser) {
   key.set_key_usage(KEY_USAGE_SIGN);
   // Cardinality is verified here to verify various steps are performed and to
   // catch performance regressions.
+  std::vector<std::string> ca_certs = {"fake_ca_cert", "fake_ca_cert2"};
   EXPECT_CALL(mock_key_store_,
-              Register("", "label", KEY_TYPE_RSA, KEY_USAGE_SIGN, "key_blob",
-                       "public_key", "fake_cert"))
-      .Times(1);
-  EXPECT_CALL(mock_key_store_, RegisterCertificate("", "fake_ca_cert"))
-      .Times(1);
-  EXPECT_CALL(mock_key_store_, RegisterCertificate("", "fake_ca_cert2"))
+              RegisterWithCertificateChain("", "label", KEY_TYPE_RSA,
+                                           KEY_USAGE_SIGN, "key_blob",
+                                           "public_key", "fake_cert",
+                                           ca_certs))
       .Times(1);
+  EXPECT_CALL(mock_key_store_, Register(_, _, _, _, _, _, _)).Times(0);
+  EXPECT_CALL(mock_key_store_, RegisterCertificate(_, _)).Times(0);
   // Set expectations on the outputs.
   auto callback = [this](const RegisterKeyWithChapsTokenReply& reply) {
     EXPECT_EQ(STATUS_SUCCESS, reply.status());
@@ -1112,7 +1695,8 @@ TEST_F(AttestationServiceTest, RegisterFailure) {
   key.SerializeToString(&key_bytes);
   EXPECT_CALL(mock_key_store_, Read("user", "label", _))
       .WillOnce(DoAll(SetArgumentPointee<2>(key_bytes), Return(true)));
-  EXPECT_CALL(mock_key_store_, Register(_, _, _, _, _, _, _))
+  EXPECT_CALL(mock_key_store_,
+              RegisterWithCertificateChain(_, _, _, _, _, _, _, _))
       .WillRepeatedly(Return(false));
   // Set expectations on the outputs.
   auto callback = [this](const RegisterKeyWithChapsTokenReply& reply) {
@@ -1135,7 +1719,9 @@ TEST_F(AttestationServiceTest, RegisterIntermediateFailure) {
   key.SerializeToString(&key_bytes);
   EXPECT_CALL(mock_key_store_, Read("user", "label", _))
       .WillOnce(DoAll(SetArgumentPointee<2>(key_bytes), Return(true)));
-  EXPECT_CALL(mock_key_store_, RegisterCertificate(_, _))
+  EXPECT_CALL(mock_key_store_,
+              RegisterWithCertificateChain(_, _, _, _, _, _, _,
+                                           ElementsAre("fake_ca_cert")))
       .WillRepeatedly(Return(false));
   // Set expectations on the outputs.
   auto callback = [this](const RegisterKeyWithChapsTokenReply& reply) {
@@ -1158,7 +1744,9 @@ TEST_F(AttestationServiceTest, RegisterAdditionalFailure) {
   key.SerializeToString(&key_bytes);
   EXPECT_CALL(mock_key_store_, Read("user", "label", _))
       .WillOnce(DoAll(SetArgumentPointee<2>(key_bytes), Return(true)));
-  EXPECT_CALL(mock_key_store_, RegisterCertificate(_, _))
+  EXPECT_CALL(mock_key_store_,
+              RegisterWithCertificateChain(_, _, _, _, _, _, _,
+                                           ElementsAre("fake_ca_cert2")))
       .WillRepeatedly(Return(false));
   // Set expectations on the outputs.
   auto callback = [this](const RegisterKeyWithChapsTokenReply& reply) {
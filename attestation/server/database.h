@@ -17,6 +17,11 @@
 #ifndef ATTESTATION_SERVER_DATABASE_H_
 #define ATTESTATION_SERVER_DATABASE_H_
 
+#include <map>
+#include <string>
+
+#include <base/callback.h>
+
 #include "attestation/common/database.pb.h"
 
 namespace attestation {
@@ -24,21 +29,61 @@ namespace attestation {
 // Manages a persistent database of attestation-related data.
 class Database {
  public:
+  // The temporal index records for one origin hash.
+  struct OriginTemporalIndexes {
+    // The temporal index recorded for each user hash. The last record for a
+    // user wins.
+    std::map<std::string, int> user_indexes;
+    // The number of records with each temporal index.
+    std::map<int, int> index_counts;
+  };
+
   virtual ~Database() = default;
 
   // Const access to the database protobuf.
   virtual const AttestationDatabase& GetProtobuf() const = 0;
 
+  // Returns the device key named |key_name|, or nullptr if there is none. The
+  // key is found without scanning device_keys and stays valid until the next
+  // call to GetMutableProtobuf() or Reload().
+  virtual const CertifiedKey* FindDeviceKey(
+      const std::string& key_name) const = 0;
+
+  // Returns the temporal index records for |origin_hash|, or nullptr if there
+  // are none. The records are found without scanning temporal_index_record and
+  // stay valid until the next call to GetMutableProtobuf(), Reload() or
+  // AddTemporalIndexRecord().
+  virtual const OriginTemporalIndexes* FindTemporalIndexes(
+      const std::string& origin_hash) const = 0;
+
+  // Appends a temporal index record to the database protobuf. Unlike a change
+  // through GetMutableProtobuf(), this keeps what FindDeviceKey() and
+  // FindTemporalIndexes() have indexed. The record is persisted like any other
+  // change.
+  virtual void AddTemporalIndexRecord(const std::string& user_hash,
+                                      const std::string& origin_hash,
+                                      int temporal_index) = 0;
+
   // Mutable access to the database protobuf. Changes made to the protobuf will
   // be reflected immediately by GetProtobuf() but will not be persisted to disk
   // until SaveChanges is called successfully.
   virtual AttestationDatabase* GetMutableProtobuf() = 0;
 
-  // Writes the current database protobuf to disk.
+  // Writes the current database protobuf to disk, including the changes of
+  // any scheduled save. For changes which must not be lost.
   virtual bool SaveChanges() = 0;
 
+  // Writes the current database protobuf to disk soon. Changes scheduled close
+  // together are written at once, so this is cheaper than SaveChanges() for
+  // bursts of changes which may be lost, e.g. if the device crashes.
+  virtual void ScheduleSaveChanges() = 0;
+
   // Reloads the database protobuf from disk.
   virtual bool Reload() = 0;
+
+  // Sets a |callback| to run whenever Reload() replaces the database protobuf,
+  // e.g. when another process has written the database.
+  virtual void SetReloadCallback(const base::Closure& callback) = 0;
 };
 
 }  // namespace attestation
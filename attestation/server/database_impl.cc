@@ -17,6 +17,7 @@
 #include "attestation/server/database_impl.h"
 
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -29,6 +30,9 @@
 #include <base/logging.h>
 #include <base/stl_util.h>
 #include <brillo/secure_blob.h>
+#include <crypto/sha2.h>
+
+#include "attestation/common/boot_trace.h"
 
 using base::FilePath;
 
@@ -37,62 +41,182 @@ namespace {
 const char kDatabasePath[] =
     "/mnt/stateful_partition/unencrypted/preserve/attestation.epb";
 const mode_t kDatabasePermissions = 0600;
+// How long ScheduleSaveChanges() waits for more changes before writing.
+const int kSaveDelayMs = 2000;
 
 // A base::FilePathWatcher::Callback that just relays to |callback|.
 void FileWatcherCallback(const base::Closure& callback, const FilePath&, bool) {
   callback.Run();
 }
 
+// Adds |record| to the index of temporal index records by origin hash.
+void AddToTemporalIndexMap(
+    const attestation::AttestationDatabase::TemporalIndexRecord& record,
+    std::unordered_map<std::string,
+                       attestation::Database::OriginTemporalIndexes>* map) {
+  attestation::Database::OriginTemporalIndexes* indexes =
+      &(*map)[record.origin_hash()];
+  indexes->user_indexes[record.user_hash()] = record.temporal_index();
+  ++indexes->index_counts[record.temporal_index()];
+}
+
 }  // namespace
 
 namespace attestation {
 
 DatabaseImpl::DatabaseImpl(CryptoUtility* crypto)
-    : io_(this), crypto_(crypto) {}
+    : io_(this),
+      crypto_(crypto),
+      save_delay_(base::TimeDelta::FromMilliseconds(kSaveDelayMs)) {}
 
 DatabaseImpl::~DatabaseImpl() {
+  // The owner may be destroyed after the thread it used this on, so this is
+  // the last chance to write a scheduled save.
+  if (save_timer_.IsRunning()) {
+    save_timer_.Stop();
+    if (!WriteProtobuf()) {
+      LOG(ERROR) << "Attestation: Failed to write scheduled database changes.";
+    }
+  }
   brillo::SecureMemset(string_as_array(&database_key_), 0,
                        database_key_.size());
+  UnlockDatabaseKey();
 }
 
 void DatabaseImpl::Initialize() {
   // Start thread-checking now.
   thread_checker_.DetachFromThread();
   DCHECK(thread_checker_.CalledOnValidThread());
-  io_->Watch(base::Bind(base::IgnoreResult(&DatabaseImpl::Reload),
-                        base::Unretained(this)));
-  if (!Reload()) {
+  io_->Watch(
+      base::Bind(&DatabaseImpl::OnFileChanged, base::Unretained(this)));
+}
+
+void DatabaseImpl::LoadIfNeeded() const {
+  if (loaded_) {
+    return;
+  }
+  if (!const_cast<DatabaseImpl*>(this)->Reload()) {
     LOG(WARNING) << "Creating new attestation database.";
   }
 }
 
 const AttestationDatabase& DatabaseImpl::GetProtobuf() const {
   DCHECK(thread_checker_.CalledOnValidThread());
+  LoadIfNeeded();
   return protobuf_;
 }
 
+const CertifiedKey* DatabaseImpl::FindDeviceKey(
+    const std::string& key_name) const {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  LoadIfNeeded();
+  if (!device_key_index_valid_) {
+    device_key_index_.clear();
+    // The first of any keys with the same name wins, as with a scan.
+    for (int i = 0; i < protobuf_.device_keys_size(); ++i) {
+      device_key_index_.emplace(protobuf_.device_keys(i).key_name(), i);
+    }
+    device_key_index_valid_ = true;
+  }
+  auto iter = device_key_index_.find(key_name);
+  if (iter == device_key_index_.end()) {
+    return nullptr;
+  }
+  return &protobuf_.device_keys(iter->second);
+}
+
+const Database::OriginTemporalIndexes* DatabaseImpl::FindTemporalIndexes(
+    const std::string& origin_hash) const {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  LoadIfNeeded();
+  if (!temporal_index_map_valid_) {
+    temporal_index_map_.clear();
+    for (const auto& record : protobuf_.temporal_index_record()) {
+      AddToTemporalIndexMap(record, &temporal_index_map_);
+    }
+    temporal_index_map_valid_ = true;
+  }
+  auto iter = temporal_index_map_.find(origin_hash);
+  if (iter == temporal_index_map_.end()) {
+    return nullptr;
+  }
+  return &iter->second;
+}
+
+void DatabaseImpl::AddTemporalIndexRecord(const std::string& user_hash,
+                                          const std::string& origin_hash,
+                                          int temporal_index) {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  LoadIfNeeded();
+  AttestationDatabase::TemporalIndexRecord* record =
+      protobuf_.add_temporal_index_record();
+  record->set_user_hash(user_hash);
+  record->set_origin_hash(origin_hash);
+  record->set_temporal_index(temporal_index);
+  if (temporal_index_map_valid_) {
+    AddToTemporalIndexMap(*record, &temporal_index_map_);
+  }
+}
+
 AttestationDatabase* DatabaseImpl::GetMutableProtobuf() {
   DCHECK(thread_checker_.CalledOnValidThread());
+  LoadIfNeeded();
+  device_key_index_valid_ = false;
+  temporal_index_map_valid_ = false;
   return &protobuf_;
 }
 
 bool DatabaseImpl::SaveChanges() {
   DCHECK(thread_checker_.CalledOnValidThread());
+  LoadIfNeeded();
+  save_timer_.Stop();
+  return WriteProtobuf();
+}
+
+void DatabaseImpl::ScheduleSaveChanges() {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  if (save_timer_.IsRunning()) {
+    return;
+  }
+  save_timer_.Start(FROM_HERE, save_delay_,
+                    base::Bind(base::IgnoreResult(&DatabaseImpl::SaveChanges),
+                               base::Unretained(this)));
+}
+
+bool DatabaseImpl::WriteProtobuf() {
   std::string buffer;
   if (!EncryptProtobuf(&buffer)) {
     return false;
   }
-  return io_->Write(buffer);
+  if (!io_->Write(buffer)) {
+    return false;
+  }
+  file_hash_ = crypto::SHA256HashString(buffer);
+  return true;
 }
 
 bool DatabaseImpl::Reload() {
   DCHECK(thread_checker_.CalledOnValidThread());
   LOG(INFO) << "Loading attestation database.";
+  ATTESTATION_BOOT_TRACE_PHASE("DatabaseImpl::Reload");
+  // Even a failed load counts, so a missing database is created afresh.
+  loaded_ = true;
   std::string buffer;
   if (!io_->Read(&buffer)) {
     return false;
   }
-  return DecryptProtobuf(buffer);
+  file_hash_ = crypto::SHA256HashString(buffer);
+  // Even a failed decrypt may have changed the protobuf.
+  bool result = DecryptProtobuf(buffer);
+  if (!reload_callback_.is_null()) {
+    reload_callback_.Run();
+  }
+  return result;
+}
+
+void DatabaseImpl::SetReloadCallback(const base::Closure& callback) {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  reload_callback_ = callback;
 }
 
 bool DatabaseImpl::Read(std::string* data) {
@@ -156,6 +280,49 @@ void DatabaseImpl::Watch(const base::Closure& callback) {
   }
 }
 
+void DatabaseImpl::OnFileChanged() {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  if (!loaded_) {
+    // The change is picked up by the first access.
+    return;
+  }
+  std::string buffer;
+  if (!io_->Read(&buffer)) {
+    return;
+  }
+  // Our own writes trigger the watcher too.
+  std::string hash = crypto::SHA256HashString(buffer);
+  if (hash == file_hash_) {
+    VLOG(1) << "Attestation database unchanged, not reloading.";
+    return;
+  }
+  LOG(INFO) << "Reloading changed attestation database.";
+  file_hash_ = hash;
+  DecryptProtobuf(buffer);
+}
+
+void DatabaseImpl::LockDatabaseKey() {
+  UnlockDatabaseKey();
+  if (database_key_.empty()) {
+    return;
+  }
+  void* key = string_as_array(&database_key_);
+  if (mlock(key, database_key_.size()) != 0) {
+    PLOG(WARNING) << "Failed to lock the database key in memory";
+    return;
+  }
+  locked_key_ = key;
+  locked_key_size_ = database_key_.size();
+}
+
+void DatabaseImpl::UnlockDatabaseKey() {
+  if (locked_key_) {
+    munlock(locked_key_, locked_key_size_);
+    locked_key_ = nullptr;
+    locked_key_size_ = 0;
+  }
+}
+
 bool DatabaseImpl::EncryptProtobuf(std::string* encrypted_output) {
   std::string serial_proto;
   if (!protobuf_.SerializeToString(&serial_proto)) {
@@ -163,10 +330,12 @@ bool DatabaseImpl::EncryptProtobuf(std::string* encrypted_output) {
     return false;
   }
   if (database_key_.empty() || sealed_database_key_.empty()) {
+    UnlockDatabaseKey();
     if (!crypto_->CreateSealedKey(&database_key_, &sealed_database_key_)) {
       LOG(ERROR) << "Failed to generate database key.";
       return false;
     }
+    LockDatabaseKey();
   }
   if (!crypto_->EncryptData(serial_proto, database_key_, sealed_database_key_,
                             encrypted_output)) {
@@ -177,10 +346,21 @@ bool DatabaseImpl::EncryptProtobuf(std::string* encrypted_output) {
 }
 
 bool DatabaseImpl::DecryptProtobuf(const std::string& encrypted_input) {
-  if (!crypto_->UnsealKey(encrypted_input, &database_key_,
-                          &sealed_database_key_)) {
-    LOG(ERROR) << "Attestation: Could not unseal decryption key.";
-    return false;
+  device_key_index_valid_ = false;
+  temporal_index_map_valid_ = false;
+  // The key stays the same for the life of the database, so it only needs to
+  // be unsealed again if the file was replaced by one with another key.
+  std::string sealed_key;
+  if (database_key_.empty() ||
+      !crypto_->GetSealedKey(encrypted_input, &sealed_key) ||
+      sealed_key != sealed_database_key_) {
+    UnlockDatabaseKey();
+    if (!crypto_->UnsealKey(encrypted_input, &database_key_,
+                            &sealed_database_key_)) {
+      LOG(ERROR) << "Attestation: Could not unseal decryption key.";
+      return false;
+    }
+    LockDatabaseKey();
   }
   std::string serial_proto;
   if (!crypto_->DecryptData(encrypted_input, database_key_, &serial_proto)) {
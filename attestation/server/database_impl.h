@@ -20,10 +20,13 @@
 #include "attestation/server/database.h"
 
 #include <string>
+#include <unordered_map>
 
-#include <base/callback_forward.h>
+#include <base/callback.h>
 #include <base/files/file_path_watcher.h>
 #include <base/threading/thread_checker.h>
+#include <base/time/time.h>
+#include <base/timer/timer.h>
 
 #include "attestation/common/crypto_utility.h"
 
@@ -41,22 +44,34 @@ class DatabaseIO {
 };
 
 // An implementation of Database backed by an ordinary file. Not thread safe.
-// All methods must be called on the same thread as the Initialize() call.
+// All methods must be called on the same thread as the Initialize() call, which
+// needs a message loop for scheduled saves. A save which is still scheduled is
+// written on destruction.
 class DatabaseImpl : public Database, public DatabaseIO {
  public:
   // Does not take ownership of pointers.
   explicit DatabaseImpl(CryptoUtility* crypto);
   ~DatabaseImpl() override;
 
-  // Reads and decrypts any existing database on disk synchronously. Must be
-  // called before calling other methods.
+  // Starts watching the database on disk. Must be called before calling other
+  // methods. Any existing database is read and decrypted synchronously on
+  // first access, so a daemon which does not need it yet starts without
+  // unsealing its key.
   void Initialize();
 
   // Database methods.
   const AttestationDatabase& GetProtobuf() const override;
+  const CertifiedKey* FindDeviceKey(const std::string& key_name) const override;
+  const OriginTemporalIndexes* FindTemporalIndexes(
+      const std::string& origin_hash) const override;
+  void AddTemporalIndexRecord(const std::string& user_hash,
+                              const std::string& origin_hash,
+                              int temporal_index) override;
   AttestationDatabase* GetMutableProtobuf() override;
   bool SaveChanges() override;
+  void ScheduleSaveChanges() override;
   bool Reload() override;
+  void SetReloadCallback(const base::Closure& callback) override;
 
   // DatabaseIO methods.
   bool Read(std::string* data) override;
@@ -65,8 +80,26 @@ class DatabaseImpl : public Database, public DatabaseIO {
 
   // Useful for testing.
   void set_io(DatabaseIO* io) { io_ = io; }
+  void set_save_delay(base::TimeDelta delay) { save_delay_ = delay; }
 
  private:
+  // Reads and decrypts the database on disk unless that has been done.
+  // Loading is not an observable change, so this may be called from const
+  // methods.
+  void LoadIfNeeded() const;
+
+  // Encrypts and writes |protobuf_|. Returns true on success.
+  bool WriteProtobuf();
+
+  // Reloads the database when the file has changed other than by our own
+  // writes.
+  void OnFileChanged();
+
+  // Locks |database_key_| in memory so it is never swapped out, unlocking
+  // whatever was locked before.
+  void LockDatabaseKey();
+  void UnlockDatabaseKey();
+
   // Encrypts |protobuf_| into |encrypted_output|. Returns true on success.
   bool EncryptProtobuf(std::string* encrypted_output);
 
@@ -75,11 +108,32 @@ class DatabaseImpl : public Database, public DatabaseIO {
   bool DecryptProtobuf(const std::string& encrypted_input);
 
   AttestationDatabase protobuf_;
+  // Whether protobuf_ holds the database on disk, see LoadIfNeeded().
+  bool loaded_ = false;
+  // Maps key names to their index in protobuf_.device_keys(). Rebuilt on
+  // demand once protobuf_ may have changed.
+  mutable std::unordered_map<std::string, int> device_key_index_;
+  mutable bool device_key_index_valid_ = false;
+  // Indexes protobuf_.temporal_index_record() by origin hash. Rebuilt on
+  // demand once protobuf_ may have changed, and kept up to date by
+  // AddTemporalIndexRecord().
+  mutable std::unordered_map<std::string, OriginTemporalIndexes>
+      temporal_index_map_;
+  mutable bool temporal_index_map_valid_ = false;
   DatabaseIO* io_;
   CryptoUtility* crypto_;
+  // Unsealed once and kept for the life of the daemon.
   std::string database_key_;
   std::string sealed_database_key_;
+  void* locked_key_ = nullptr;
+  size_t locked_key_size_ = 0;
+  // The SHA-256 hash of the file as last read or written.
+  std::string file_hash_;
   std::unique_ptr<base::FilePathWatcher> file_watcher_;
+  // Runs while a save is scheduled.
+  base::OneShotTimer save_timer_;
+  base::TimeDelta save_delay_;
+  base::Closure reload_callback_;
   base::ThreadChecker thread_checker_;
 };
 
@@ -17,6 +17,10 @@
 #include <memory>
 #include <string>
 
+#include <base/bind.h>
+#include <base/message_loop/message_loop.h>
+#include <base/run_loop.h>
+#include <brillo/bind_lambda.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -24,9 +28,11 @@
 #include "attestation/server/database_impl.h"
 
 using testing::_;
+using testing::DoAll;
 using testing::Invoke;
 using testing::NiceMock;
 using testing::Return;
+using testing::SetArgPointee;
 using testing::WithArgs;
 
 namespace {
@@ -49,6 +55,7 @@ class DatabaseImplTest : public testing::Test, public DatabaseIO {
 
   // Fake DatabaseIO::Read.
   bool Read(std::string* data) override {
+    ++read_count_;
     if (fake_persistent_data_readable_) {
       *data = fake_persistent_data_;
     }
@@ -59,6 +66,7 @@ class DatabaseImplTest : public testing::Test, public DatabaseIO {
   bool Write(const std::string& data) override {
     if (fake_persistent_data_writable_) {
       fake_persistent_data_ = data;
+      ++write_count_;
     }
     return fake_persistent_data_writable_;
   }
@@ -80,6 +88,9 @@ class DatabaseImplTest : public testing::Test, public DatabaseIO {
   bool fake_persistent_data_readable_{true};
   bool fake_persistent_data_writable_{true};
   base::Closure fake_watch_callback_;
+  int read_count_{0};
+  int write_count_{0};
+  base::MessageLoop message_loop_;
   NiceMock<MockCryptoUtility> mock_crypto_utility_;
   std::unique_ptr<DatabaseImpl> database_;
 };
@@ -140,7 +151,30 @@ TEST_F(DatabaseImplTest, IgnoreLegacyEncryptJunk) {
             database_->GetProtobuf().credentials().conformance_credential());
 }
 
+TEST_F(DatabaseImplTest, LoadOnFirstAccess) {
+  EXPECT_EQ(0, read_count_);
+  // A change before the first access needs no reload.
+  fake_watch_callback_.Run();
+  EXPECT_EQ(0, read_count_);
+  EXPECT_EQ(std::string(kFakeCredential),
+            database_->GetProtobuf().credentials().conformance_credential());
+  EXPECT_EQ(1, read_count_);
+  database_->GetProtobuf();
+  EXPECT_EQ(1, read_count_);
+}
+
+TEST_F(DatabaseImplTest, LoadBeforeSave) {
+  // Saving before any access keeps what is on disk.
+  EXPECT_TRUE(database_->SaveChanges());
+  EXPECT_EQ(1, read_count_);
+  EXPECT_TRUE(database_->Reload());
+  EXPECT_EQ(std::string(kFakeCredential),
+            database_->GetProtobuf().credentials().conformance_credential());
+}
+
 TEST_F(DatabaseImplTest, Reload) {
+  // Load the original database first.
+  database_->GetProtobuf();
   AttestationDatabase proto;
   proto.mutable_credentials()->set_platform_credential(kFakeCredential);
   proto.SerializeToString(&fake_persistent_data_);
@@ -152,6 +186,8 @@ TEST_F(DatabaseImplTest, Reload) {
 }
 
 TEST_F(DatabaseImplTest, AutoReload) {
+  // Load the original database first.
+  database_->GetProtobuf();
   AttestationDatabase proto;
   proto.mutable_credentials()->set_platform_credential(kFakeCredential);
   proto.SerializeToString(&fake_persistent_data_);
@@ -162,4 +198,131 @@ TEST_F(DatabaseImplTest, AutoReload) {
             database_->GetProtobuf().credentials().platform_credential());
 }
 
+TEST_F(DatabaseImplTest, AutoReloadRunsReloadCallback) {
+  int reload_count = 0;
+  database_->SetReloadCallback(
+      base::Bind([&reload_count]() { ++reload_count; }));
+  // Load the original database first.
+  database_->GetProtobuf();
+  EXPECT_EQ(1, reload_count);
+  AttestationDatabase proto;
+  proto.mutable_credentials()->set_platform_credential(kFakeCredential);
+  proto.SerializeToString(&fake_persistent_data_);
+  fake_watch_callback_.Run();
+  EXPECT_EQ(2, reload_count);
+  // Our own writes are not reloaded.
+  EXPECT_TRUE(database_->SaveChanges());
+  fake_watch_callback_.Run();
+  EXPECT_EQ(2, reload_count);
+}
+
+TEST_F(DatabaseImplTest, FindDeviceKey) {
+  CertifiedKey* key = database_->GetMutableProtobuf()->add_device_keys();
+  key->set_key_name("first");
+  key->set_key_blob("first_blob");
+  EXPECT_EQ(nullptr, database_->FindDeviceKey("second"));
+  ASSERT_NE(nullptr, database_->FindDeviceKey("first"));
+  EXPECT_EQ("first_blob", database_->FindDeviceKey("first")->key_blob());
+  // Changes through the mutable protobuf are picked up.
+  key = database_->GetMutableProtobuf()->add_device_keys();
+  key->set_key_name("second");
+  key->set_key_blob("second_blob");
+  ASSERT_NE(nullptr, database_->FindDeviceKey("second"));
+  EXPECT_EQ("second_blob", database_->FindDeviceKey("second")->key_blob());
+  database_->GetMutableProtobuf()->mutable_device_keys()->RemoveLast();
+  EXPECT_EQ(nullptr, database_->FindDeviceKey("second"));
+  // So is a reload, which drops both keys.
+  EXPECT_TRUE(database_->Reload());
+  EXPECT_EQ(nullptr, database_->FindDeviceKey("first"));
+}
+
+TEST_F(DatabaseImplTest, FindTemporalIndexes) {
+  AttestationDatabase::TemporalIndexRecord* record =
+      database_->GetMutableProtobuf()->add_temporal_index_record();
+  record->set_user_hash("user1");
+  record->set_origin_hash("origin1");
+  record->set_temporal_index(2);
+  EXPECT_EQ(nullptr, database_->FindTemporalIndexes("origin2"));
+  const Database::OriginTemporalIndexes* indexes =
+      database_->FindTemporalIndexes("origin1");
+  ASSERT_NE(nullptr, indexes);
+  EXPECT_EQ(2, indexes->user_indexes.at("user1"));
+  EXPECT_EQ(1, indexes->index_counts.at(2));
+  // New records are indexed as they are added.
+  database_->AddTemporalIndexRecord("user2", "origin1", 2);
+  database_->AddTemporalIndexRecord("user1", "origin2", 0);
+  indexes = database_->FindTemporalIndexes("origin1");
+  ASSERT_NE(nullptr, indexes);
+  EXPECT_EQ(2, indexes->user_indexes.at("user2"));
+  EXPECT_EQ(2, indexes->index_counts.at(2));
+  ASSERT_NE(nullptr, database_->FindTemporalIndexes("origin2"));
+  EXPECT_EQ(3, database_->GetProtobuf().temporal_index_record_size());
+  // Changes through the mutable protobuf are picked up.
+  database_->GetMutableProtobuf()
+      ->mutable_temporal_index_record()
+      ->RemoveLast();
+  EXPECT_EQ(nullptr, database_->FindTemporalIndexes("origin2"));
+  // So is a reload, which drops all records.
+  EXPECT_TRUE(database_->Reload());
+  EXPECT_EQ(nullptr, database_->FindTemporalIndexes("origin1"));
+}
+
+TEST_F(DatabaseImplTest, ScheduledSavesCoalesce) {
+  database_->set_save_delay(base::TimeDelta());
+  database_->GetMutableProtobuf()
+      ->mutable_credentials()
+      ->set_platform_credential(kFakeCredential);
+  database_->ScheduleSaveChanges();
+  database_->GetMutableProtobuf()->add_device_keys()->set_key_name("key");
+  database_->ScheduleSaveChanges();
+  EXPECT_EQ(0, write_count_);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(1, write_count_);
+  // Both changes were written.
+  database_->GetMutableProtobuf()->Clear();
+  EXPECT_TRUE(database_->Reload());
+  EXPECT_EQ(std::string(kFakeCredential),
+            database_->GetProtobuf().credentials().platform_credential());
+  EXPECT_EQ(1, database_->GetProtobuf().device_keys_size());
+}
+
+TEST_F(DatabaseImplTest, SaveChangesFlushesScheduledSave) {
+  database_->set_save_delay(base::TimeDelta());
+  database_->ScheduleSaveChanges();
+  EXPECT_TRUE(database_->SaveChanges());
+  EXPECT_EQ(1, write_count_);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(1, write_count_);
+}
+
+TEST_F(DatabaseImplTest, ScheduledSaveWrittenOnDestruction) {
+  database_->GetMutableProtobuf()->add_device_keys()->set_key_name("key");
+  database_->ScheduleSaveChanges();
+  database_.reset();
+  EXPECT_EQ(1, write_count_);
+}
+
+TEST_F(DatabaseImplTest, ReloadReusesUnsealedKey) {
+  EXPECT_CALL(mock_crypto_utility_, UnsealKey(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<1>("key"), SetArgPointee<2>("sealed"),
+                      Return(true)));
+  EXPECT_CALL(mock_crypto_utility_, GetSealedKey(_, _))
+      .WillRepeatedly(DoAll(SetArgPointee<1>("sealed"), Return(true)));
+  EXPECT_TRUE(database_->Reload());
+  EXPECT_TRUE(database_->Reload());
+  // A file sealed with another key needs another unseal.
+  EXPECT_CALL(mock_crypto_utility_, GetSealedKey(_, _))
+      .WillRepeatedly(DoAll(SetArgPointee<1>("other"), Return(true)));
+  EXPECT_CALL(mock_crypto_utility_, UnsealKey(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<1>("key2"), SetArgPointee<2>("other"),
+                      Return(true)));
+  EXPECT_TRUE(database_->Reload());
+}
+
+TEST_F(DatabaseImplTest, AutoReloadSkipsOwnWrites) {
+  EXPECT_TRUE(database_->SaveChanges());
+  EXPECT_CALL(mock_crypto_utility_, DecryptData(_, _, _)).Times(0);
+  fake_watch_callback_.Run();
+}
+
 }  // namespace attestation
@@ -58,6 +58,14 @@ void DBusService::Register(const CompletionAction& callback) {
                                    &DBusService::HandleDecrypt);
   dbus_interface->AddMethodHandler(kSign, base::Unretained(this),
                                    &DBusService::HandleSign);
+  dbus_interface->AddMethodHandler(kDecryptBatch, base::Unretained(this),
+                                   &DBusService::HandleDecryptBatch);
+  dbus_interface->AddMethodHandler(kSignBatch, base::Unretained(this),
+                                   &DBusService::HandleSignBatch);
+  dbus_interface->AddMethodHandler(kSignAggregated, base::Unretained(this),
+                                   &DBusService::HandleSignAggregated);
+  dbus_interface->AddMethodHandler(kSignFile, base::Unretained(this),
+                                   &DBusService::HandleSignFile);
   dbus_interface->AddMethodHandler(
       kRegisterKeyWithChapsToken, base::Unretained(this),
       &DBusService::HandleRegisterKeyWithChapsToken);
@@ -208,6 +216,76 @@ void DBusService::HandleSign(
       base::Bind(callback, SharedResponsePointer(std::move(response))));
 }
 
+void DBusService::HandleDecryptBatch(
+    std::unique_ptr<DBusMethodResponse<const DecryptBatchReply&>> response,
+    const DecryptBatchRequest& request) {
+  VLOG(1) << __func__;
+  // Convert |response| to a shared_ptr so |service_| can safely copy the
+  // callback.
+  using SharedResponsePointer =
+      std::shared_ptr<DBusMethodResponse<const DecryptBatchReply&>>;
+  // A callback that fills the reply protobuf and sends it.
+  auto callback = [](const SharedResponsePointer& response,
+                     const DecryptBatchReply& reply) {
+    response->Return(reply);
+  };
+  service_->DecryptBatch(
+      request,
+      base::Bind(callback, SharedResponsePointer(std::move(response))));
+}
+
+void DBusService::HandleSignBatch(
+    std::unique_ptr<DBusMethodResponse<const SignBatchReply&>> response,
+    const SignBatchRequest& request) {
+  VLOG(1) << __func__;
+  // Convert |response| to a shared_ptr so |service_| can safely copy the
+  // callback.
+  using SharedResponsePointer =
+      std::shared_ptr<DBusMethodResponse<const SignBatchReply&>>;
+  // A callback that fills the reply protobuf and sends it.
+  auto callback = [](const SharedResponsePointer& response,
+                     const SignBatchReply& reply) { response->Return(reply); };
+  service_->SignBatch(
+      request,
+      base::Bind(callback, SharedResponsePointer(std::move(response))));
+}
+
+void DBusService::HandleSignAggregated(
+    std::unique_ptr<DBusMethodResponse<const SignAggregatedReply&>> response,
+    const SignAggregatedRequest& request) {
+  VLOG(1) << __func__;
+  // Convert |response| to a shared_ptr so |service_| can safely copy the
+  // callback.
+  using SharedResponsePointer =
+      std::shared_ptr<DBusMethodResponse<const SignAggregatedReply&>>;
+  // A callback that fills the reply protobuf and sends it.
+  auto callback = [](const SharedResponsePointer& response,
+                     const SignAggregatedReply& reply) {
+    response->Return(reply);
+  };
+  service_->SignAggregated(
+      request,
+      base::Bind(callback, SharedResponsePointer(std::move(response))));
+}
+
+void DBusService::HandleSignFile(
+    std::unique_ptr<DBusMethodResponse<const SignReply&>> response,
+    const SignFileRequest& request,
+    const dbus::FileDescriptor& fd) {
+  VLOG(1) << __func__;
+  // Convert |response| to a shared_ptr so |service_| can safely copy the
+  // callback.
+  using SharedResponsePointer =
+      std::shared_ptr<DBusMethodResponse<const SignReply&>>;
+  // A callback that fills the reply protobuf and sends it.
+  auto callback = [](const SharedResponsePointer& response,
+                     const SignReply& reply) { response->Return(reply); };
+  // The D-Bus message owns |fd|; the service duplicates it if needed.
+  service_->SignFile(
+      request, fd.value(),
+      base::Bind(callback, SharedResponsePointer(std::move(response))));
+}
+
 void DBusService::HandleRegisterKeyWithChapsToken(
     std::unique_ptr<DBusMethodResponse<const RegisterKeyWithChapsTokenReply&>>
         response,
@@ -22,6 +22,7 @@
 #include <brillo/dbus/dbus_method_response.h>
 #include <brillo/dbus/dbus_object.h>
 #include <dbus/bus.h>
+#include <dbus/file_descriptor.h>
 
 #include "attestation/common/attestation_interface.h"
 
@@ -95,6 +96,33 @@ class DBusService {
           response,
       const SignRequest& request);
 
+  // Handles a DecryptBatch D-Bus call.
+  void HandleDecryptBatch(
+      std::unique_ptr<brillo::dbus_utils::DBusMethodResponse<
+          const DecryptBatchReply&>> response,
+      const DecryptBatchRequest& request);
+
+  // Handles a SignBatch D-Bus call.
+  void HandleSignBatch(
+      std::unique_ptr<
+          brillo::dbus_utils::DBusMethodResponse<const SignBatchReply&>>
+          response,
+      const SignBatchRequest& request);
+
+  // Handles a SignAggregated D-Bus call.
+  void HandleSignAggregated(
+      std::unique_ptr<
+          brillo::dbus_utils::DBusMethodResponse<const SignAggregatedReply&>>
+          response,
+      const SignAggregatedRequest& request);
+
+  // Handles a SignFile D-Bus call.
+  void HandleSignFile(
+      std::unique_ptr<brillo::dbus_utils::DBusMethodResponse<const SignReply&>>
+          response,
+      const SignFileRequest& request,
+      const dbus::FileDescriptor& fd);
+
   // Handles a RegisterKeyWithChapsToken D-Bus call.
   void HandleRegisterKeyWithChapsToken(
       std::unique_ptr<brillo::dbus_utils::DBusMethodResponse<
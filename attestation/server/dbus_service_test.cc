@@ -14,10 +14,14 @@
 // limitations under the License.
 //
 
+#include <fcntl.h>
+
 #include <string>
 
+#include <base/posix/eintr_wrapper.h>
 #include <brillo/bind_lambda.h>
 #include <brillo/dbus/dbus_object_test_helpers.h>
+#include <dbus/file_descriptor.h>
 #include <dbus/mock_bus.h>
 #include <dbus/mock_exported_object.h>
 #include <gmock/gmock.h>
@@ -352,6 +356,104 @@ TEST_F(DBusServiceTest, Sign) {
   EXPECT_EQ("signature", reply.signature());
 }
 
+TEST_F(DBusServiceTest, SignBatch) {
+  SignBatchRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  request.add_data_to_sign("data1");
+  request.add_data_to_sign("data2");
+  EXPECT_CALL(mock_service_, SignBatch(_, _))
+      .WillOnce(
+          Invoke([](const SignBatchRequest& request,
+                    const AttestationInterface::SignBatchCallback& callback) {
+            EXPECT_EQ("label", request.key_label());
+            EXPECT_EQ("user", request.username());
+            ASSERT_EQ(2, request.data_to_sign_size());
+            EXPECT_EQ("data2", request.data_to_sign(1));
+            SignBatchReply reply;
+            reply.set_status(STATUS_SUCCESS);
+            reply.add_signature("signature1");
+            reply.add_signature("signature2");
+            callback.Run(reply);
+          }));
+  std::unique_ptr<dbus::MethodCall> call = CreateMethodCall(kSignBatch);
+  dbus::MessageWriter writer(call.get());
+  writer.AppendProtoAsArrayOfBytes(request);
+  auto response = CallMethod(call.get());
+  dbus::MessageReader reader(response.get());
+  SignBatchReply reply;
+  EXPECT_TRUE(reader.PopArrayOfBytesAsProto(&reply));
+  EXPECT_EQ(STATUS_SUCCESS, reply.status());
+  ASSERT_EQ(2, reply.signature_size());
+  EXPECT_EQ("signature2", reply.signature(1));
+}
+
+TEST_F(DBusServiceTest, SignAggregated) {
+  SignAggregatedRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  request.set_nonce("nonce");
+  EXPECT_CALL(mock_service_, SignAggregated(_, _))
+      .WillOnce(Invoke(
+          [](const SignAggregatedRequest& request,
+             const AttestationInterface::SignAggregatedCallback& callback) {
+            EXPECT_EQ("label", request.key_label());
+            EXPECT_EQ("user", request.username());
+            EXPECT_EQ("nonce", request.nonce());
+            SignAggregatedReply reply;
+            reply.set_status(STATUS_SUCCESS);
+            reply.set_signature("signature");
+            reply.set_merkle_root("root");
+            reply.set_leaf_index(1);
+            reply.set_leaf_count(2);
+            reply.add_inclusion_proof("sibling");
+            callback.Run(reply);
+          }));
+  std::unique_ptr<dbus::MethodCall> call = CreateMethodCall(kSignAggregated);
+  dbus::MessageWriter writer(call.get());
+  writer.AppendProtoAsArrayOfBytes(request);
+  auto response = CallMethod(call.get());
+  dbus::MessageReader reader(response.get());
+  SignAggregatedReply reply;
+  EXPECT_TRUE(reader.PopArrayOfBytesAsProto(&reply));
+  EXPECT_EQ(STATUS_SUCCESS, reply.status());
+  EXPECT_EQ("signature", reply.signature());
+  EXPECT_EQ("root", reply.merkle_root());
+  EXPECT_EQ(1, reply.leaf_index());
+  EXPECT_EQ(2, reply.leaf_count());
+  ASSERT_EQ(1, reply.inclusion_proof_size());
+  EXPECT_EQ("sibling", reply.inclusion_proof(0));
+}
+
+TEST_F(DBusServiceTest, SignFile) {
+  SignFileRequest request;
+  request.set_key_label("label");
+  request.set_username("user");
+  EXPECT_CALL(mock_service_, SignFile(_, _, _))
+      .WillOnce(Invoke([](const SignFileRequest& request, int fd,
+                          const AttestationInterface::SignCallback& callback) {
+        EXPECT_EQ("label", request.key_label());
+        EXPECT_EQ("user", request.username());
+        EXPECT_LE(0, fd);
+        SignReply reply;
+        reply.set_status(STATUS_SUCCESS);
+        reply.set_signature("signature");
+        callback.Run(reply);
+      }));
+  std::unique_ptr<dbus::MethodCall> call = CreateMethodCall(kSignFile);
+  dbus::MessageWriter writer(call.get());
+  writer.AppendProtoAsArrayOfBytes(request);
+  dbus::FileDescriptor fd(HANDLE_EINTR(open("/dev/null", O_RDONLY)));
+  fd.CheckValidity();
+  writer.AppendFileDescriptor(fd);
+  auto response = CallMethod(call.get());
+  dbus::MessageReader reader(response.get());
+  SignReply reply;
+  EXPECT_TRUE(reader.PopArrayOfBytesAsProto(&reply));
+  EXPECT_EQ(STATUS_SUCCESS, reply.status());
+  EXPECT_EQ("signature", reply.signature());
+}
+
 TEST_F(DBusServiceTest, RegisterKeyWithChapsToken) {
   RegisterKeyWithChapsTokenRequest request;
   request.set_key_label("label");
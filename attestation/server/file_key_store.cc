@@ -0,0 +1,305 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "attestation/server/file_key_store.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <base/files/file_util.h>
+#include <base/files/important_file_writer.h>
+#include <base/logging.h>
+#include <base/stl_util.h>
+#include <base/strings/string_util.h>
+#include <brillo/cryptohome.h>
+#include <brillo/secure_blob.h>
+
+#include "attestation/common/database.pb.h"
+
+using base::FilePath;
+
+namespace {
+
+const char kKeyStoreDirectory[] = "attestation";
+const char kKeyStoreFile[] = "keys.epb";
+const int kKeyStorePermissions = 0600;
+
+// Returns true if |key_name| starts with any of |key_prefixes|.
+bool HasAnyPrefix(const std::string& key_name,
+                  const std::vector<std::string>& key_prefixes) {
+  for (const auto& key_prefix : key_prefixes) {
+    if (base::StartsWith(key_name, key_prefix, base::CompareCase::SENSITIVE)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Overwrites the key data in |keys|, which is about to be released.
+void ClearKeys(std::unordered_map<std::string, std::string>* keys) {
+  for (auto& entry : *keys) {
+    brillo::SecureMemset(string_as_array(&entry.second), 0,
+                         entry.second.size());
+  }
+  keys->clear();
+}
+
+}  // namespace
+
+namespace attestation {
+
+FileKeyStore::FileKeyStore(CryptoUtility* crypto, KeyStore* registration_store)
+    : crypto_(crypto), registration_store_(registration_store) {}
+
+FileKeyStore::~FileKeyStore() {
+  for (auto& entry : user_keys_) {
+    ClearKeys(&entry.second.keys);
+    brillo::SecureMemset(string_as_array(&entry.second.aes_key), 0,
+                         entry.second.aes_key.size());
+  }
+}
+
+bool FileKeyStore::Read(const std::string& username,
+                        const std::string& key_name,
+                        std::string* key_data) {
+  base::AutoLock lock(lock_);
+  UserKeys* user_keys = GetUserKeys(username);
+  if (!user_keys) {
+    return false;
+  }
+  auto iter = user_keys->keys.find(key_name);
+  if (iter == user_keys->keys.end()) {
+    LOG(WARNING) << "Key data not found: " << key_name;
+    return false;
+  }
+  *key_data = iter->second;
+  return true;
+}
+
+bool FileKeyStore::Write(const std::string& username,
+                         const std::string& key_name,
+                         const std::string& key_data) {
+  base::AutoLock lock(lock_);
+  UserKeys* user_keys = GetUserKeys(username);
+  if (!user_keys) {
+    return false;
+  }
+  KeyMap keys = user_keys->keys;
+  keys[key_name] = key_data;
+  return SaveUserKeys(username, user_keys, &keys);
+}
+
+bool FileKeyStore::Delete(const std::string& username,
+                          const std::string& key_name) {
+  base::AutoLock lock(lock_);
+  UserKeys* user_keys = GetUserKeys(username);
+  if (!user_keys) {
+    return false;
+  }
+  if (user_keys->keys.count(key_name) == 0) {
+    return true;
+  }
+  KeyMap keys = user_keys->keys;
+  keys.erase(key_name);
+  return SaveUserKeys(username, user_keys, &keys);
+}
+
+bool FileKeyStore::DeleteByPrefix(const std::string& username,
+                                  const std::string& key_prefix) {
+  base::AutoLock lock(lock_);
+  return DeleteByPrefixesLocked(username, {key_prefix});
+}
+
+bool FileKeyStore::DeleteByPrefixes(
+    const std::vector<std::string>& usernames,
+    const std::vector<std::string>& key_prefixes) {
+  base::AutoLock lock(lock_);
+  bool result = true;
+  for (const auto& username : usernames) {
+    if (!DeleteByPrefixesLocked(username, key_prefixes)) {
+      result = false;
+    }
+  }
+  return result;
+}
+
+bool FileKeyStore::Register(const std::string& username,
+                            const std::string& label,
+                            KeyType key_type,
+                            KeyUsage key_usage,
+                            const std::string& private_key_blob,
+                            const std::string& public_key_der,
+                            const std::string& certificate) {
+  if (!registration_store_) {
+    LOG(ERROR) << "FileKeyStore: Keys cannot be registered.";
+    return false;
+  }
+  return registration_store_->Register(username, label, key_type, key_usage,
+                                       private_key_blob, public_key_der,
+                                       certificate);
+}
+
+bool FileKeyStore::RegisterCertificate(const std::string& username,
+                                       const std::string& certificate) {
+  if (!registration_store_) {
+    LOG(ERROR) << "FileKeyStore: Certificates cannot be registered.";
+    return false;
+  }
+  return registration_store_->RegisterCertificate(username, certificate);
+}
+
+bool FileKeyStore::RegisterWithCertificateChain(
+    const std::string& username,
+    const std::string& label,
+    KeyType key_type,
+    KeyUsage key_usage,
+    const std::string& private_key_blob,
+    const std::string& public_key_der,
+    const std::string& certificate,
+    const std::vector<std::string>& intermediate_ca_certs) {
+  if (!registration_store_) {
+    LOG(ERROR) << "FileKeyStore: Keys cannot be registered.";
+    return false;
+  }
+  return registration_store_->RegisterWithCertificateChain(
+      username, label, key_type, key_usage, private_key_blob, public_key_der,
+      certificate, intermediate_ca_certs);
+}
+
+FileKeyStore::UserKeys* FileKeyStore::GetUserKeys(
+    const std::string& username) {
+  lock_.AssertAcquired();
+  // The file is only there while the cryptohome is mounted. A stat is much
+  // cheaper than a read, and keys are not kept beyond a logout.
+  if (!base::DirectoryExists(GetUserPath(username))) {
+    auto iter = user_keys_.find(username);
+    if (iter != user_keys_.end()) {
+      ClearKeys(&iter->second.keys);
+      user_keys_.erase(iter);
+    }
+    LOG(WARNING) << "FileKeyStore: User cryptohome is not mounted.";
+    return nullptr;
+  }
+  auto iter = user_keys_.find(username);
+  if (iter != user_keys_.end()) {
+    return &iter->second;
+  }
+  UserKeys user_keys;
+  FilePath path = GetKeyFilePath(username);
+  if (base::PathExists(path)) {
+    std::string encrypted_file;
+    if (!base::ReadFileToString(path, &encrypted_file)) {
+      PLOG(ERROR) << "FileKeyStore: Failed to read " << path.value();
+      return nullptr;
+    }
+    std::string serialized_file;
+    if (!crypto_->UnsealKey(encrypted_file, &user_keys.aes_key,
+                            &user_keys.sealed_key) ||
+        !crypto_->DecryptData(encrypted_file, user_keys.aes_key,
+                              &serialized_file)) {
+      LOG(ERROR) << "FileKeyStore: Failed to decrypt " << path.value();
+      return nullptr;
+    }
+    KeyStoreFile key_file;
+    bool parsed = key_file.ParseFromString(serialized_file);
+    brillo::SecureMemset(string_as_array(&serialized_file), 0,
+                         serialized_file.size());
+    if (!parsed) {
+      LOG(ERROR) << "FileKeyStore: Failed to parse " << path.value();
+      return nullptr;
+    }
+    for (const auto& entry : key_file.keys()) {
+      user_keys.keys[entry.key_name()] = entry.key_data();
+    }
+  }
+  return &(user_keys_[username] = std::move(user_keys));
+}
+
+bool FileKeyStore::SaveUserKeys(const std::string& username,
+                                UserKeys* user_keys,
+                                KeyMap* keys) {
+  lock_.AssertAcquired();
+  if (user_keys->aes_key.empty() &&
+      !crypto_->CreateSealedKey(&user_keys->aes_key, &user_keys->sealed_key)) {
+    LOG(ERROR) << "FileKeyStore: Failed to create a file key.";
+    return false;
+  }
+  KeyStoreFile key_file;
+  for (const auto& entry : *keys) {
+    KeyStoreFile::Entry* file_entry = key_file.add_keys();
+    file_entry->set_key_name(entry.first);
+    file_entry->set_key_data(entry.second);
+  }
+  std::string serialized_file;
+  std::string encrypted_file;
+  bool encrypted =
+      key_file.SerializeToString(&serialized_file) &&
+      crypto_->EncryptData(serialized_file, user_keys->aes_key,
+                           user_keys->sealed_key, &encrypted_file);
+  brillo::SecureMemset(string_as_array(&serialized_file), 0,
+                       serialized_file.size());
+  if (!encrypted) {
+    LOG(ERROR) << "FileKeyStore: Failed to encrypt key data.";
+    return false;
+  }
+  FilePath path = GetKeyFilePath(username);
+  if (!base::CreateDirectory(path.DirName())) {
+    LOG(ERROR) << "FileKeyStore: Cannot create " << path.DirName().value();
+    return false;
+  }
+  if (!base::ImportantFileWriter::WriteFileAtomically(path, encrypted_file) ||
+      !base::SetPosixFilePermissions(path, kKeyStorePermissions)) {
+    LOG(ERROR) << "FileKeyStore: Failed to write " << path.value();
+    return false;
+  }
+  ClearKeys(&user_keys->keys);
+  user_keys->keys.swap(*keys);
+  return true;
+}
+
+bool FileKeyStore::DeleteByPrefixesLocked(
+    const std::string& username,
+    const std::vector<std::string>& key_prefixes) {
+  UserKeys* user_keys = GetUserKeys(username);
+  if (!user_keys) {
+    // Without a mounted cryptohome there is nothing to delete.
+    return !base::DirectoryExists(GetUserPath(username));
+  }
+  KeyMap keys;
+  for (const auto& entry : user_keys->keys) {
+    if (!HasAnyPrefix(entry.first, key_prefixes)) {
+      keys.insert(entry);
+    }
+  }
+  if (keys.size() == user_keys->keys.size()) {
+    return true;
+  }
+  return SaveUserKeys(username, user_keys, &keys);
+}
+
+FilePath FileKeyStore::GetUserPath(const std::string& username) const {
+  if (!test_user_directory_.empty()) {
+    return test_user_directory_.Append(username);
+  }
+  return brillo::cryptohome::home::GetRootPath(username);
+}
+
+FilePath FileKeyStore::GetKeyFilePath(const std::string& username) const {
+  return GetUserPath(username).Append(kKeyStoreDirectory).Append(kKeyStoreFile);
+}
+
+}  // namespace attestation
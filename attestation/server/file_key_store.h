@@ -0,0 +1,138 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ATTESTATION_SERVER_FILE_KEY_STORE_H_
+#define ATTESTATION_SERVER_FILE_KEY_STORE_H_
+
+#include "attestation/server/key_store.h"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <base/files/file_path.h>
+#include <base/macros.h>
+#include <base/synchronization/lock.h>
+
+#include "attestation/common/crypto_utility.h"
+
+namespace attestation {
+
+// A KeyStore which keeps the key data of each user in a single encrypted file
+// in the user's cryptohome instead of in PKCS #11 data objects. A user's file
+// is read and decrypted on first use and then indexed by key name in memory, so
+// lookups are O(1) and involve neither chaps nor a file read. Every change is
+// written out with one file write, including changes to many keys at once such
+// as DeleteByPrefixes(). The file is encrypted like the attestation database,
+// under a key sealed to the TPM.
+//
+// The registration methods are forwarded to |registration_store|, usually a
+// Pkcs11KeyStore, so exposing a key through PKCS #11 stays a separate, explicit
+// step. Key data already stored in PKCS #11 tokens is not migrated.
+//
+// A user's keys are forgotten once the user's cryptohome is unmounted. This
+// class is thread-safe.
+class FileKeyStore : public KeyStore {
+ public:
+  // Does not take ownership of pointers. If |registration_store| is null,
+  // registration fails.
+  FileKeyStore(CryptoUtility* crypto, KeyStore* registration_store);
+  ~FileKeyStore() override;
+
+  // KeyStore interface.
+  bool Read(const std::string& username,
+            const std::string& key_name,
+            std::string* key_data) override;
+  bool Write(const std::string& username,
+             const std::string& key_name,
+             const std::string& key_data) override;
+  bool Delete(const std::string& username,
+              const std::string& key_name) override;
+  bool DeleteByPrefix(const std::string& username,
+                      const std::string& key_prefix) override;
+  bool DeleteByPrefixes(const std::vector<std::string>& usernames,
+                        const std::vector<std::string>& key_prefixes) override;
+  bool Register(const std::string& username,
+                const std::string& label,
+                KeyType key_type,
+                KeyUsage key_usage,
+                const std::string& private_key_blob,
+                const std::string& public_key_der,
+                const std::string& certificate) override;
+  bool RegisterCertificate(const std::string& username,
+                           const std::string& certificate) override;
+  bool RegisterWithCertificateChain(
+      const std::string& username,
+      const std::string& label,
+      KeyType key_type,
+      KeyUsage key_usage,
+      const std::string& private_key_blob,
+      const std::string& public_key_der,
+      const std::string& certificate,
+      const std::vector<std::string>& intermediate_ca_certs) override;
+
+  // Useful for testing. Stands in for the cryptohome mount points, so the
+  // cryptohome of each user is |directory|/<username>.
+  void set_user_directory_for_testing(const base::FilePath& directory) {
+    test_user_directory_ = directory;
+  }
+
+ private:
+  using KeyMap = std::unordered_map<std::string, std::string>;
+
+  // The decrypted file of a user.
+  struct UserKeys {
+    KeyMap keys;
+    // The file's encryption key, created on the first write.
+    std::string aes_key;
+    std::string sealed_key;
+  };
+
+  // Returns the keys of |username|, reading the user's file unless it has been
+  // read already. Returns nullptr if the user's cryptohome is not mounted or
+  // the file cannot be read.
+  UserKeys* GetUserKeys(const std::string& username);
+
+  // Replaces the keys of |username|, as returned by GetUserKeys(), with |keys|
+  // after writing them to the user's file. Returns true on success.
+  bool SaveUserKeys(const std::string& username,
+                    UserKeys* user_keys,
+                    KeyMap* keys);
+
+  // Removes the keys with any of |key_prefixes| from the file of |username|.
+  bool DeleteByPrefixesLocked(const std::string& username,
+                              const std::vector<std::string>& key_prefixes);
+
+  // Returns where the cryptohome of |username| is mounted.
+  base::FilePath GetUserPath(const std::string& username) const;
+
+  // Returns the path of the key file of |username|.
+  base::FilePath GetKeyFilePath(const std::string& username) const;
+
+  CryptoUtility* crypto_;
+  KeyStore* registration_store_;
+  base::FilePath test_user_directory_;
+  // Guards |user_keys_|.
+  base::Lock lock_;
+  std::map<std::string, UserKeys> user_keys_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileKeyStore);
+};
+
+}  // namespace attestation
+
+#endif  // ATTESTATION_SERVER_FILE_KEY_STORE_H_
@@ -0,0 +1,154 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "attestation/server/file_key_store.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "attestation/common/mock_crypto_utility.h"
+#include "attestation/server/mock_key_store.h"
+
+using testing::_;
+using testing::NiceMock;
+using testing::Return;
+using testing::StrictMock;
+
+namespace attestation {
+
+class FileKeyStoreTest : public testing::Test {
+ public:
+  ~FileKeyStoreTest() override = default;
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    ASSERT_TRUE(base::CreateDirectory(temp_dir_.path().Append("user")));
+    key_store_.reset(CreateKeyStore());
+  }
+
+ protected:
+  FileKeyStore* CreateKeyStore() {
+    FileKeyStore* key_store =
+        new FileKeyStore(&mock_crypto_utility_, &mock_registration_store_);
+    key_store->set_user_directory_for_testing(temp_dir_.path());
+    return key_store;
+  }
+
+  base::ScopedTempDir temp_dir_;
+  NiceMock<MockCryptoUtility> mock_crypto_utility_;
+  StrictMock<MockKeyStore> mock_registration_store_;
+  std::unique_ptr<FileKeyStore> key_store_;
+};
+
+TEST_F(FileKeyStoreTest, WriteReadDelete) {
+  std::string key_data;
+  EXPECT_FALSE(key_store_->Read("user", "key1", &key_data));
+  EXPECT_TRUE(key_store_->Write("user", "key1", "data1"));
+  EXPECT_TRUE(key_store_->Write("user", "key2", "data2"));
+  EXPECT_TRUE(key_store_->Read("user", "key1", &key_data));
+  EXPECT_EQ("data1", key_data);
+  EXPECT_TRUE(key_store_->Write("user", "key1", "data3"));
+  EXPECT_TRUE(key_store_->Delete("user", "key2"));
+  EXPECT_FALSE(key_store_->Read("user", "key2", &key_data));
+  // The keys are in the file, so another instance finds them.
+  std::unique_ptr<FileKeyStore> key_store2(CreateKeyStore());
+  EXPECT_TRUE(key_store2->Read("user", "key1", &key_data));
+  EXPECT_EQ("data3", key_data);
+  EXPECT_FALSE(key_store2->Read("user", "key2", &key_data));
+}
+
+TEST_F(FileKeyStoreTest, ReadsFileOnce) {
+  EXPECT_TRUE(key_store_->Write("user", "key1", "data1"));
+  std::unique_ptr<FileKeyStore> key_store2(CreateKeyStore());
+  EXPECT_CALL(mock_crypto_utility_, DecryptData(_, _, _)).Times(1);
+  std::string key_data;
+  EXPECT_TRUE(key_store2->Read("user", "key1", &key_data));
+  EXPECT_TRUE(key_store2->Read("user", "key1", &key_data));
+  EXPECT_FALSE(key_store2->Read("user", "key2", &key_data));
+}
+
+TEST_F(FileKeyStoreTest, KeyCreatedOnce) {
+  EXPECT_CALL(mock_crypto_utility_, CreateSealedKey(_, _)).Times(1);
+  EXPECT_TRUE(key_store_->Write("user", "key1", "data1"));
+  EXPECT_TRUE(key_store_->Write("user", "key2", "data2"));
+}
+
+TEST_F(FileKeyStoreTest, NotMounted) {
+  std::string key_data;
+  EXPECT_FALSE(key_store_->Write("other_user", "key1", "data1"));
+  EXPECT_FALSE(key_store_->Read("other_user", "key1", &key_data));
+  EXPECT_TRUE(key_store_->DeleteByPrefix("other_user", "key"));
+}
+
+TEST_F(FileKeyStoreTest, ForgetsKeysAfterUnmount) {
+  EXPECT_TRUE(key_store_->Write("user", "key1", "data1"));
+  ASSERT_TRUE(base::DeleteFile(temp_dir_.path().Append("user"), true));
+  std::string key_data;
+  EXPECT_FALSE(key_store_->Read("user", "key1", &key_data));
+}
+
+TEST_F(FileKeyStoreTest, DeleteByPrefixes) {
+  ASSERT_TRUE(base::CreateDirectory(temp_dir_.path().Append("user2")));
+  EXPECT_TRUE(key_store_->Write("user", "a1", "data"));
+  EXPECT_TRUE(key_store_->Write("user", "a2", "data"));
+  EXPECT_TRUE(key_store_->Write("user", "b1", "data"));
+  EXPECT_TRUE(key_store_->Write("user", "c1", "data"));
+  EXPECT_TRUE(key_store_->Write("user2", "a1", "data"));
+  // Each user's file is written once.
+  EXPECT_CALL(mock_crypto_utility_, EncryptData(_, _, _, _)).Times(2);
+  EXPECT_TRUE(key_store_->DeleteByPrefixes({"user", "user2"}, {"a", "b"}));
+  std::string key_data;
+  EXPECT_FALSE(key_store_->Read("user", "a1", &key_data));
+  EXPECT_FALSE(key_store_->Read("user", "a2", &key_data));
+  EXPECT_FALSE(key_store_->Read("user", "b1", &key_data));
+  EXPECT_TRUE(key_store_->Read("user", "c1", &key_data));
+  EXPECT_FALSE(key_store_->Read("user2", "a1", &key_data));
+}
+
+TEST_F(FileKeyStoreTest, BadFile) {
+  EXPECT_TRUE(key_store_->Write("user", "key1", "data1"));
+  std::unique_ptr<FileKeyStore> key_store2(CreateKeyStore());
+  EXPECT_CALL(mock_crypto_utility_, DecryptData(_, _, _))
+      .WillRepeatedly(Return(false));
+  std::string key_data;
+  EXPECT_FALSE(key_store2->Read("user", "key1", &key_data));
+  // An unreadable file is not replaced.
+  EXPECT_FALSE(key_store2->Write("user", "key2", "data2"));
+  EXPECT_TRUE(key_store_->Read("user", "key1", &key_data));
+}
+
+TEST_F(FileKeyStoreTest, Register) {
+  EXPECT_CALL(mock_registration_store_,
+              Register("user", "label", KEY_TYPE_RSA, KEY_USAGE_SIGN, "blob",
+                       "public_key", "certificate"))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_registration_store_,
+              RegisterCertificate("user", "certificate"))
+      .WillOnce(Return(false));
+  EXPECT_TRUE(key_store_->Register("user", "label", KEY_TYPE_RSA,
+                                   KEY_USAGE_SIGN, "blob", "public_key",
+                                   "certificate"));
+  EXPECT_FALSE(key_store_->RegisterCertificate("user", "certificate"));
+  FileKeyStore key_store(&mock_crypto_utility_, nullptr);
+  EXPECT_FALSE(key_store.RegisterCertificate("user", "certificate"));
+}
+
+}  // namespace attestation
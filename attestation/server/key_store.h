@@ -18,6 +18,7 @@
 #define ATTESTATION_SERVER_KEY_STORE_H_
 
 #include <string>
+#include <vector>
 
 #include <base/macros.h>
 
@@ -54,6 +55,14 @@ class KeyStore {
   virtual bool DeleteByPrefix(const std::string& username,
                               const std::string& key_prefix) = 0;
 
+  // Deletes key data for all keys identified by any of |key_prefixes| and by
+  // any of |usernames|, e.g. every key a logout cleans up at once. The keys of
+  // each user are only looked up once, and every user is cleaned up even if
+  // another fails. Returns false if key data exists but could not be deleted.
+  virtual bool DeleteByPrefixes(
+      const std::vector<std::string>& usernames,
+      const std::vector<std::string>& key_prefixes) = 0;
+
   // Registers a key to be associated with |username|.
   // The provided |label| will be associated with all registered objects.
   // |private_key_blob| holds the private key in some opaque format and
@@ -73,6 +82,20 @@ class KeyStore {
   virtual bool RegisterCertificate(const std::string& username,
                                    const std::string& certificate) = 0;
 
+  // Registers a key as Register() does, together with |intermediate_ca_certs|
+  // as RegisterCertificate() does, in a single pass.  Certificates that are
+  // already registered for |username| are not registered again.  Returns true
+  // on success.
+  virtual bool RegisterWithCertificateChain(
+      const std::string& username,
+      const std::string& label,
+      KeyType key_type,
+      KeyUsage key_usage,
+      const std::string& private_key_blob,
+      const std::string& public_key_der,
+      const std::string& certificate,
+      const std::vector<std::string>& intermediate_ca_certs) = 0;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(KeyStore);
 };
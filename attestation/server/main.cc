@@ -18,14 +18,20 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
+#include <base/bind.h>
 #include <base/command_line.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/threading/thread_task_runner_handle.h>
 #include <brillo/daemons/dbus_daemon.h>
 #include <brillo/dbus/async_event_sequencer.h>
 #include <brillo/minijail/minijail.h>
 #include <brillo/syslog_logging.h>
 #include <brillo/userdb_utils.h>
 
+#include "attestation/common/boot_trace.h"
 #include "attestation/common/dbus_interface.h"
 #include "attestation/server/attestation_service.h"
 #include "attestation/server/dbus_service.h"
@@ -39,6 +45,34 @@ const char kAttestationUser[] = "attestation";
 const char kAttestationGroup[] = "attestation";
 const char kAttestationSeccompPath[] =
     "/usr/share/policy/attestationd-seccomp.policy";
+const char kPrefetchProfilesSwitch[] = "prefetch_profiles";
+// Stores user keys in cryptohome files instead of in PKCS #11 tokens.
+const char kFileKeyStoreSwitch[] = "file_key_store";
+// Renews certified keys this many days before their certificates expire.
+const char kKeyRenewalDaysSwitch[] = "key_renewal_days";
+#if defined(USE_TPM2)
+// Records the startup phases of attestationd and the TPM commands they send,
+// and writes them to the given path once background preparation had time to
+// run. See trunks/boot_trace.h.
+const char kBootTraceSwitch[] = "boot_trace";
+const int kBootTraceWindowSeconds = 120;
+#endif
+
+// Parses a comma-separated list of CertificateProfile names.
+bool ParseCertificateProfiles(
+    const std::string& value,
+    std::vector<attestation::CertificateProfile>* profiles) {
+  for (const std::string& name : base::SplitString(
+           value, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    attestation::CertificateProfile profile;
+    if (!attestation::CertificateProfile_Parse(name, &profile)) {
+      LOG(ERROR) << "Unknown certificate profile: " << name;
+      return false;
+    }
+    profiles->push_back(profile);
+  }
+  return true;
+}
 
 void InitMinijailSandbox() {
   uid_t attestation_uid;
@@ -67,9 +101,21 @@ using brillo::dbus_utils::AsyncEventSequencer;
 
 class AttestationDaemon : public brillo::DBusServiceDaemon {
  public:
-  AttestationDaemon()
+  AttestationDaemon(
+      const std::vector<attestation::CertificateProfile>& prefetch_profiles,
+      bool file_key_store,
+      int key_renewal_days)
       : brillo::DBusServiceDaemon(attestation::kAttestationServiceName) {
-    attestation_service_.reset(new attestation::AttestationService);
+    attestation::AttestationService* service =
+        new attestation::AttestationService;
+    service->EnableBackgroundPreparation(prefetch_profiles);
+    if (file_key_store) {
+      service->EnableFileKeyStore();
+    }
+    if (key_renewal_days > 0) {
+      service->EnableKeyRenewal(base::TimeDelta::FromDays(key_renewal_days));
+    }
+    attestation_service_.reset(service);
     // Move initialize call down to OnInit
     CHECK(attestation_service_->Initialize());
   }
@@ -105,7 +151,38 @@ int main(int argc, char* argv[]) {
     flags |= brillo::kLogToStderr;
   }
   brillo::InitLog(flags);
-  AttestationDaemon daemon;
+  std::vector<attestation::CertificateProfile> prefetch_profiles;
+  if (!ParseCertificateProfiles(
+          cl->GetSwitchValueASCII(kPrefetchProfilesSwitch),
+          &prefetch_profiles)) {
+    return EX_USAGE;
+  }
+  int key_renewal_days = 0;
+  if (cl->HasSwitch(kKeyRenewalDaysSwitch) &&
+      !base::StringToInt(cl->GetSwitchValueASCII(kKeyRenewalDaysSwitch),
+                         &key_renewal_days)) {
+    LOG(ERROR) << "Invalid number of days: "
+               << cl->GetSwitchValueASCII(kKeyRenewalDaysSwitch);
+    return EX_USAGE;
+  }
+#if defined(USE_TPM2)
+  if (cl->HasSwitch(kBootTraceSwitch)) {
+    trunks::EnableBootTrace(true);
+  }
+#endif
+  AttestationDaemon daemon(prefetch_profiles,
+                           cl->HasSwitch(kFileKeyStoreSwitch),
+                           key_renewal_days);
+#if defined(USE_TPM2)
+  if (trunks::IsBootTraceEnabled()) {
+    base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(base::IgnoreResult(&trunks::WriteBootTrace),
+                   cl->GetSwitchValuePath(kBootTraceSwitch),
+                   std::string("attestationd")),
+        base::TimeDelta::FromSeconds(kBootTraceWindowSeconds));
+  }
+#endif
   LOG(INFO) << "Attestation Daemon Started.";
   InitMinijailSandbox();
   return daemon.Run();
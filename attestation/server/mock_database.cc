@@ -16,6 +16,8 @@
 
 #include "attestation/server/mock_database.h"
 
+using testing::_;
+using testing::Invoke;
 using testing::Return;
 using testing::ReturnRef;
 
@@ -23,6 +25,12 @@ namespace attestation {
 
 MockDatabase::MockDatabase() {
   ON_CALL(*this, GetProtobuf()).WillByDefault(ReturnRef(fake_));
+  ON_CALL(*this, FindDeviceKey(_))
+      .WillByDefault(Invoke(this, &MockDatabase::FakeFindDeviceKey));
+  ON_CALL(*this, FindTemporalIndexes(_))
+      .WillByDefault(Invoke(this, &MockDatabase::FakeFindTemporalIndexes));
+  ON_CALL(*this, AddTemporalIndexRecord(_, _, _))
+      .WillByDefault(Invoke(this, &MockDatabase::FakeAddTemporalIndexRecord));
   ON_CALL(*this, GetMutableProtobuf()).WillByDefault(Return(&fake_));
   ON_CALL(*this, SaveChanges()).WillByDefault(Return(true));
   ON_CALL(*this, Reload()).WillByDefault(Return(true));
@@ -30,4 +38,39 @@ MockDatabase::MockDatabase() {
 
 MockDatabase::~MockDatabase() {}
 
+const CertifiedKey* MockDatabase::FakeFindDeviceKey(
+    const std::string& key_name) const {
+  for (const auto& key : fake_.device_keys()) {
+    if (key.key_name() == key_name) {
+      return &key;
+    }
+  }
+  return nullptr;
+}
+
+const Database::OriginTemporalIndexes* MockDatabase::FakeFindTemporalIndexes(
+    const std::string& origin_hash) const {
+  fake_temporal_indexes_ = OriginTemporalIndexes();
+  bool found = false;
+  for (const auto& record : fake_.temporal_index_record()) {
+    if (record.origin_hash() == origin_hash) {
+      fake_temporal_indexes_.user_indexes[record.user_hash()] =
+          record.temporal_index();
+      ++fake_temporal_indexes_.index_counts[record.temporal_index()];
+      found = true;
+    }
+  }
+  return found ? &fake_temporal_indexes_ : nullptr;
+}
+
+void MockDatabase::FakeAddTemporalIndexRecord(const std::string& user_hash,
+                                              const std::string& origin_hash,
+                                              int temporal_index) {
+  AttestationDatabase::TemporalIndexRecord* record =
+      fake_.add_temporal_index_record();
+  record->set_user_hash(user_hash);
+  record->set_origin_hash(origin_hash);
+  record->set_temporal_index(temporal_index);
+}
+
 }  // namespace attestation
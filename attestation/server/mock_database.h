@@ -19,6 +19,8 @@
 
 #include "attestation/server/database.h"
 
+#include <string>
+
 #include <gmock/gmock.h>
 
 namespace attestation {
@@ -29,12 +31,31 @@ class MockDatabase : public Database {
   ~MockDatabase() override;
 
   MOCK_CONST_METHOD0(GetProtobuf, const AttestationDatabase&());
+  MOCK_CONST_METHOD1(FindDeviceKey, const CertifiedKey*(const std::string&));
+  MOCK_CONST_METHOD1(FindTemporalIndexes,
+                     const OriginTemporalIndexes*(const std::string&));
+  MOCK_METHOD3(AddTemporalIndexRecord,
+               void(const std::string&, const std::string&, int));
   MOCK_METHOD0(GetMutableProtobuf, AttestationDatabase*());
   MOCK_METHOD0(SaveChanges, bool());
+  MOCK_METHOD0(ScheduleSaveChanges, void());
   MOCK_METHOD0(Reload, bool());
+  MOCK_METHOD1(SetReloadCallback, void(const base::Closure&));
 
  private:
+  // Scans the fake database for the device key named |key_name|.
+  const CertifiedKey* FakeFindDeviceKey(const std::string& key_name) const;
+  // Scans the fake database for the temporal index records of |origin_hash|.
+  const OriginTemporalIndexes* FakeFindTemporalIndexes(
+      const std::string& origin_hash) const;
+  // Appends a temporal index record to the fake database.
+  void FakeAddTemporalIndexRecord(const std::string& user_hash,
+                                  const std::string& origin_hash,
+                                  int temporal_index);
+
   AttestationDatabase fake_;
+  // The result of the last FakeFindTemporalIndexes() call.
+  mutable OriginTemporalIndexes fake_temporal_indexes_;
 };
 
 }  // namespace attestation
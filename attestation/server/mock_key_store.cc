@@ -26,8 +26,11 @@ MockKeyStore::MockKeyStore() {
   ON_CALL(*this, Write(_, _, _)).WillByDefault(Return(true));
   ON_CALL(*this, Delete(_, _)).WillByDefault(Return(true));
   ON_CALL(*this, DeleteByPrefix(_, _)).WillByDefault(Return(true));
+  ON_CALL(*this, DeleteByPrefixes(_, _)).WillByDefault(Return(true));
   ON_CALL(*this, Register(_, _, _, _, _, _, _)).WillByDefault(Return(true));
   ON_CALL(*this, RegisterCertificate(_, _)).WillByDefault(Return(true));
+  ON_CALL(*this, RegisterWithCertificateChain(_, _, _, _, _, _, _, _))
+      .WillByDefault(Return(true));
 }
 
 MockKeyStore::~MockKeyStore() {}
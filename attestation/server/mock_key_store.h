@@ -20,6 +20,7 @@
 #include "attestation/server/key_store.h"
 
 #include <string>
+#include <vector>
 
 #include <base/macros.h>
 #include <gmock/gmock.h>
@@ -44,6 +45,9 @@ class MockKeyStore : public KeyStore {
   MOCK_METHOD2(DeleteByPrefix,
                bool(const std::string& username,
                     const std::string& key_prefix));
+  MOCK_METHOD2(DeleteByPrefixes,
+               bool(const std::vector<std::string>& usernames,
+                    const std::vector<std::string>& key_prefixes));
   MOCK_METHOD7(Register,
                bool(const std::string& username,
                     const std::string& label,
@@ -55,6 +59,15 @@ class MockKeyStore : public KeyStore {
   MOCK_METHOD2(RegisterCertificate,
                bool(const std::string& username,
                     const std::string& certificate));
+  MOCK_METHOD8(RegisterWithCertificateChain,
+               bool(const std::string& username,
+                    const std::string& label,
+                    KeyType key_type,
+                    KeyUsage key_usage,
+                    const std::string& private_key_blob,
+                    const std::string& public_key_der,
+                    const std::string& certificate,
+                    const std::vector<std::string>& intermediate_ca_certs));
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MockKeyStore);
@@ -16,8 +16,11 @@
 
 #include "attestation/server/pkcs11_key_store.h"
 
+#include <algorithm>
 #include <memory>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <base/bind.h>
 #include <base/callback.h>
@@ -52,36 +55,78 @@ typedef crypto::ScopedOpenSSL<X509, X509_free> ScopedX509;
 // An arbitrary application ID to identify PKCS #11 objects.
 const char kApplicationID[] = "CrOS_d5bbc079d2497110feadfc97c40d718ae46f4658";
 
-// A helper class to scope a PKCS #11 session.
-class ScopedSession {
- public:
-  explicit ScopedSession(CK_SLOT_ID slot) : handle_(CK_INVALID_HANDLE) {
-    CK_RV rv = C_Initialize(nullptr);
-    if (rv != CKR_OK && rv != CKR_CRYPTOKI_ALREADY_INITIALIZED) {
-      // This may be normal in a test environment.
-      LOG(INFO) << "PKCS #11 is not available.";
-      return;
+// Buffer sizes offered for attribute values; most values fit, so they can be
+// read without first asking for their length.
+const size_t kKeyNameSizeHint = 256;
+const size_t kKeyDataSizeHint = 4096;
+
+// Reads the attribute |type| of |object_handle| into |value|.  A buffer of
+// |size_hint| bytes is offered first and the length is only queried if the
+// value does not fit.  Returns true on success.
+bool ReadAttribute(CK_SESSION_HANDLE session_handle,
+                   CK_OBJECT_HANDLE object_handle,
+                   CK_ATTRIBUTE_TYPE type,
+                   size_t size_hint,
+                   std::string* value) {
+  DCHECK_GT(size_hint, 0u);
+  value->resize(size_hint);
+  CK_ATTRIBUTE attribute = {type, string_as_array(value), value->size()};
+  CK_RV rv = C_GetAttributeValue(session_handle, object_handle, &attribute, 1);
+  if (rv == CKR_BUFFER_TOO_SMALL) {
+    attribute.pValue = nullptr;
+    attribute.ulValueLen = 0;
+    if (C_GetAttributeValue(session_handle, object_handle, &attribute, 1) !=
+        CKR_OK) {
+      return false;
     }
-    CK_FLAGS flags = CKF_RW_SESSION | CKF_SERIAL_SESSION;
-    if (C_OpenSession(slot, flags, nullptr, nullptr, &handle_) != CKR_OK) {
-      LOG(ERROR) << "Failed to open PKCS #11 session.";
-      return;
+    value->resize(attribute.ulValueLen);
+    attribute.pValue = string_as_array(value);
+    rv = C_GetAttributeValue(session_handle, object_handle, &attribute, 1);
+  }
+  if (rv != CKR_OK)
+    return false;
+  value->resize(attribute.ulValueLen);
+  return true;
+}
+
+// A helper class to scope the use of a pooled PKCS #11 session.  If the pooled
+// session for the user's slot turns out to be stale, the slot is looked up
+// again once, since the token may have moved to a different slot.
+class Pkcs11KeyStore::ScopedSession {
+ public:
+  ScopedSession(Pkcs11KeyStore* key_store, const std::string& username)
+      : key_store_(key_store) {
+    for (int attempt = 0; attempt < 2 && !IsValid(); ++attempt) {
+      if (!key_store_->GetUserSlot(username, &slot_)) {
+        LOG(ERROR) << "Pkcs11KeyStore: No token for user.";
+        return;
+      }
+      handle_ = key_store_->AcquireSession(slot_);
     }
   }
 
   ~ScopedSession() {
-    if (IsValid() && (C_CloseSession(handle_) != CKR_OK)) {
-      LOG(WARNING) << "Failed to close PKCS #11 session.";
-      handle_ = CK_INVALID_HANDLE;
-    }
+    if (IsValid())
+      key_store_->ReleaseSession(slot_, handle_);
+  }
+
+  // Closes every session on the slot, including this one, so that other
+  // modules will find objects created through it.
+  void CloseAllSessions() {
+    key_store_->CloseAllSessions(slot_);
+    handle_ = CK_INVALID_HANDLE;
   }
 
+  CK_SLOT_ID slot() const { return slot_; }
+
   CK_SESSION_HANDLE handle() const { return handle_; }
 
   bool IsValid() const { return (handle_ != CK_INVALID_HANDLE); }
 
  private:
-  CK_SESSION_HANDLE handle_;
+  Pkcs11KeyStore* key_store_;
+  CK_SLOT_ID slot_ = 0;
+  CK_SESSION_HANDLE handle_ = CK_INVALID_HANDLE;
 
   DISALLOW_COPY_AND_ASSIGN(ScopedSession);
 };
@@ -89,41 +134,36 @@ class ScopedSession {
 Pkcs11KeyStore::Pkcs11KeyStore(chaps::TokenManagerClient* token_manager)
     : token_manager_(token_manager) {}
 
-Pkcs11KeyStore::~Pkcs11KeyStore() {}
+Pkcs11KeyStore::~Pkcs11KeyStore() {
+  for (const auto& entry : idle_sessions_) {
+    for (CK_SESSION_HANDLE session_handle : entry.second) {
+      C_CloseSession(session_handle);
+    }
+  }
+}
 
 bool Pkcs11KeyStore::Read(const std::string& username,
                           const std::string& key_name,
                           std::string* key_data) {
-  CK_SLOT_ID slot;
-  if (!GetUserSlot(username, &slot)) {
-    LOG(ERROR) << "Pkcs11KeyStore: No token for user.";
-    return false;
-  }
-  ScopedSession session(slot);
+  ScopedSession session(this, username);
   if (!session.IsValid()) {
     LOG(ERROR) << "Pkcs11KeyStore: Failed to open token session.";
     return false;
   }
-  CK_OBJECT_HANDLE key_handle = FindObject(session.handle(), key_name);
+  CK_OBJECT_HANDLE key_handle =
+      FindObject(session.slot(), session.handle(), key_name);
   if (key_handle == CK_INVALID_HANDLE) {
     LOG(WARNING) << "Pkcs11KeyStore: Key does not exist: " << key_name;
     return false;
   }
-  // First get the attribute with a NULL buffer which will give us the length.
-  CK_ATTRIBUTE attribute = {CKA_VALUE, nullptr, 0};
-  if (C_GetAttributeValue(session.handle(), key_handle, &attribute, 1) !=
-      CKR_OK) {
-    LOG(ERROR) << "Pkcs11KeyStore: Failed to read key data: " << key_name;
-    return false;
-  }
-  key_data->resize(attribute.ulValueLen);
-  attribute.pValue = string_as_array(key_data);
-  if (C_GetAttributeValue(session.handle(), key_handle, &attribute, 1) !=
-      CKR_OK) {
+  if (!ReadAttribute(session.handle(), key_handle, CKA_VALUE, kKeyDataSizeHint,
+                     key_data)) {
     LOG(ERROR) << "Pkcs11KeyStore: Failed to read key data: " << key_name;
+    // The object may have been destroyed by another module; rebuild the index
+    // on the next operation.
+    key_indexes_.erase(session.slot());
     return false;
   }
-  key_data->resize(attribute.ulValueLen);
   return true;
 }
 
@@ -134,12 +174,7 @@ bool Pkcs11KeyStore::Write(const std::string& username,
   if (!Delete(username, key_name)) {
     return false;
   }
-  CK_SLOT_ID slot;
-  if (!GetUserSlot(username, &slot)) {
-    LOG(ERROR) << "Pkcs11KeyStore: No token for user.";
-    return false;
-  }
-  ScopedSession session(slot);
+  ScopedSession session(this, username);
   if (!session.IsValid()) {
     LOG(ERROR) << "Pkcs11KeyStore: Failed to open token session.";
     return false;
@@ -166,50 +201,88 @@ bool Pkcs11KeyStore::Write(const std::string& username,
     LOG(ERROR) << "Pkcs11KeyStore: Failed to write key data: " << key_name;
     return false;
   }
+  auto iter = key_indexes_.find(session.slot());
+  if (iter != key_indexes_.end())
+    iter->second[key_name] = key_handle;
   return true;
 }
 
 bool Pkcs11KeyStore::Delete(const std::string& username,
                             const std::string& key_name) {
-  CK_SLOT_ID slot;
-  if (!GetUserSlot(username, &slot)) {
-    LOG(ERROR) << "Pkcs11KeyStore: No token for user.";
-    return false;
-  }
-  ScopedSession session(slot);
+  ScopedSession session(this, username);
   if (!session.IsValid()) {
     LOG(ERROR) << "Pkcs11KeyStore: Failed to open token session.";
     return false;
   }
-  CK_OBJECT_HANDLE key_handle = FindObject(session.handle(), key_name);
+  CK_OBJECT_HANDLE key_handle =
+      FindObject(session.slot(), session.handle(), key_name);
   if (key_handle != CK_INVALID_HANDLE) {
     if (C_DestroyObject(session.handle(), key_handle) != CKR_OK) {
       LOG(ERROR) << "Pkcs11KeyStore: Failed to delete key data.";
+      key_indexes_.erase(session.slot());
       return false;
     }
+    key_indexes_[session.slot()].erase(key_name);
   }
   return true;
 }
 
 bool Pkcs11KeyStore::DeleteByPrefix(const std::string& username,
                                     const std::string& key_prefix) {
-  CK_SLOT_ID slot;
-  if (!GetUserSlot(username, &slot)) {
-    LOG(ERROR) << "Pkcs11KeyStore: No token for user.";
-    return false;
+  return DeleteKeysWithPrefixes(username,
+                                std::vector<std::string>(1, key_prefix));
+}
+
+bool Pkcs11KeyStore::DeleteByPrefixes(
+    const std::vector<std::string>& usernames,
+    const std::vector<std::string>& key_prefixes) {
+  // Once sorted, a prefix starting with another follows it and is dropped, as
+  // the shorter prefix deletes its keys too.
+  std::vector<std::string> prefixes(key_prefixes);
+  std::sort(prefixes.begin(), prefixes.end());
+  prefixes.erase(std::unique(prefixes.begin(), prefixes.end(),
+                             [](const std::string& kept,
+                                const std::string& prefix) {
+                               return base::StartsWith(
+                                   prefix, kept, base::CompareCase::SENSITIVE);
+                             }),
+                 prefixes.end());
+  bool result = true;
+  for (const std::string& username : usernames) {
+    if (!DeleteKeysWithPrefixes(username, prefixes)) {
+      result = false;
+    }
   }
-  ScopedSession session(slot);
+  return result;
+}
+
+bool Pkcs11KeyStore::DeleteKeysWithPrefixes(
+    const std::string& username,
+    const std::vector<std::string>& key_prefixes) {
+  ScopedSession session(this, username);
   if (!session.IsValid()) {
     LOG(ERROR) << "Pkcs11KeyStore: Failed to open token session.";
     return false;
   }
-  EnumObjectsCallback callback =
-      base::Bind(&Pkcs11KeyStore::DeleteIfMatchesPrefix, base::Unretained(this),
-                 session.handle(), key_prefix);
-  if (!EnumObjects(session.handle(), callback)) {
+  KeyIndex* index = GetKeyIndex(session.slot(), session.handle());
+  if (!index) {
     LOG(ERROR) << "Pkcs11KeyStore: Failed to delete key data.";
     return false;
   }
+  // Keys sharing a prefix are adjacent in the index.
+  for (const std::string& key_prefix : key_prefixes) {
+    auto iter = index->lower_bound(key_prefix);
+    while (iter != index->end() &&
+           base::StartsWith(iter->first, key_prefix,
+                            base::CompareCase::SENSITIVE)) {
+      if (C_DestroyObject(session.handle(), iter->second) != CKR_OK) {
+        LOG(ERROR) << "C_DestroyObject failed.";
+        key_indexes_.erase(session.slot());
+        return false;
+      }
+      iter = index->erase(iter);
+    }
+  }
   return true;
 }
 
@@ -220,22 +293,65 @@ bool Pkcs11KeyStore::Register(const std::string& username,
                               const std::string& private_key_blob,
                               const std::string& public_key_der,
                               const std::string& certificate) {
-  const CK_ATTRIBUTE_TYPE kKeyBlobAttribute = CKA_VENDOR_DEFINED + 1;
+  return RegisterWithCertificateChain(username, label, key_type, key_usage,
+                                      private_key_blob, public_key_der,
+                                      certificate, std::vector<std::string>());
+}
 
+bool Pkcs11KeyStore::RegisterWithCertificateChain(
+    const std::string& username,
+    const std::string& label,
+    KeyType key_type,
+    KeyUsage key_usage,
+    const std::string& private_key_blob,
+    const std::string& public_key_der,
+    const std::string& certificate,
+    const std::vector<std::string>& intermediate_ca_certs) {
   if (key_type != KEY_TYPE_RSA) {
     LOG(ERROR) << "Pkcs11KeyStore: Only RSA supported.";
     return false;
   }
-  CK_SLOT_ID slot;
-  if (!GetUserSlot(username, &slot)) {
-    LOG(ERROR) << "Pkcs11KeyStore: No token for user.";
+  ScopedSession session(this, username);
+  if (!session.IsValid()) {
+    LOG(ERROR) << "Pkcs11KeyStore: Failed to open token session.";
     return false;
   }
-  ScopedSession session(slot);
+  if (!CreateKeyObjects(session.handle(), label, key_usage, private_key_blob,
+                        public_key_der, certificate)) {
+    return false;
+  }
+  for (const std::string& ca_certificate : intermediate_ca_certs) {
+    if (!AddCertificateIfMissing(session.slot(), session.handle(),
+                                 ca_certificate)) {
+      return false;
+    }
+  }
+
+  // Close all sessions in an attempt to trigger other modules to find the new
+  // objects.
+  session.CloseAllSessions();
+
+  return true;
+}
+
+bool Pkcs11KeyStore::RegisterCertificate(const std::string& username,
+                                         const std::string& certificate) {
+  ScopedSession session(this, username);
   if (!session.IsValid()) {
     LOG(ERROR) << "Pkcs11KeyStore: Failed to open token session.";
     return false;
   }
+  return AddCertificateIfMissing(session.slot(), session.handle(),
+                                 certificate);
+}
+
+bool Pkcs11KeyStore::CreateKeyObjects(CK_SESSION_HANDLE session_handle,
+                                      const std::string& label,
+                                      KeyUsage key_usage,
+                                      const std::string& private_key_blob,
+                                      const std::string& public_key_der,
+                                      const std::string& certificate) {
+  const CK_ATTRIBUTE_TYPE kKeyBlobAttribute = CKA_VENDOR_DEFINED + 1;
 
   // Extract the modulus from the public key.
   const unsigned char* asn1_ptr =
@@ -283,7 +399,7 @@ bool Pkcs11KeyStore::Register(const std::string& username,
       {CKA_MODULUS, string_as_array(&modulus), modulus.size()}};
 
   CK_OBJECT_HANDLE object_handle = CK_INVALID_HANDLE;
-  if (C_CreateObject(session.handle(), public_key_attributes,
+  if (C_CreateObject(session_handle, public_key_attributes,
                      arraysize(public_key_attributes),
                      &object_handle) != CKR_OK) {
     LOG(ERROR) << "Pkcs11KeyStore: Failed to create public key object.";
@@ -312,70 +428,24 @@ bool Pkcs11KeyStore::Register(const std::string& username,
       {kKeyBlobAttribute, string_as_array(&mutable_private_key_blob),
        mutable_private_key_blob.size()}};
 
-  if (C_CreateObject(session.handle(), private_key_attributes,
+  if (C_CreateObject(session_handle, private_key_attributes,
                      arraysize(private_key_attributes),
                      &object_handle) != CKR_OK) {
     LOG(ERROR) << "Pkcs11KeyStore: Failed to create private key object.";
     return false;
   }
 
-  if (!certificate.empty()) {
-    std::string subject;
-    std::string issuer;
-    std::string serial_number;
-    if (!GetCertificateFields(certificate, &subject, &issuer, &serial_number)) {
-      LOG(WARNING) << "Pkcs11KeyStore: Failed to find certificate fields.";
-    }
-    // Construct a PKCS #11 template for a certificate object.
-    std::string mutable_certificate = certificate;
-    CK_OBJECT_CLASS certificate_class = CKO_CERTIFICATE;
-    CK_CERTIFICATE_TYPE certificate_type = CKC_X_509;
-    CK_ATTRIBUTE certificate_attributes[] = {
-        {CKA_CLASS, &certificate_class, sizeof(certificate_class)},
-        {CKA_TOKEN, &true_value, sizeof(true_value)},
-        {CKA_PRIVATE, &false_value, sizeof(false_value)},
-        {CKA_ID, string_as_array(&id), id.size()},
-        {CKA_LABEL, string_as_array(&mutable_label), mutable_label.size()},
-        {CKA_CERTIFICATE_TYPE, &certificate_type, sizeof(certificate_type)},
-        {CKA_SUBJECT, string_as_array(&subject), subject.size()},
-        {CKA_ISSUER, string_as_array(&issuer), issuer.size()},
-        {CKA_SERIAL_NUMBER, string_as_array(&serial_number),
-         serial_number.size()},
-        {CKA_VALUE, string_as_array(&mutable_certificate),
-         mutable_certificate.size()}};
-
-    if (C_CreateObject(session.handle(), certificate_attributes,
-                       arraysize(certificate_attributes),
-                       &object_handle) != CKR_OK) {
-      LOG(ERROR) << "Pkcs11KeyStore: Failed to create certificate object.";
-      return false;
-    }
+  if (!certificate.empty() &&
+      !CreateCertificateObject(session_handle, certificate, id, label)) {
+    return false;
   }
-
-  // Close all sessions in an attempt to trigger other modules to find the new
-  // objects.
-  C_CloseAllSessions(slot);
-
   return true;
 }
 
-bool Pkcs11KeyStore::RegisterCertificate(const std::string& username,
-                                         const std::string& certificate) {
-  CK_SLOT_ID slot;
-  if (!GetUserSlot(username, &slot)) {
-    LOG(ERROR) << "Pkcs11KeyStore: No token for user.";
-    return false;
-  }
-  ScopedSession session(slot);
-  if (!session.IsValid()) {
-    LOG(ERROR) << "Pkcs11KeyStore: Failed to open token session.";
-    return false;
-  }
-
-  if (DoesCertificateExist(session.handle(), certificate)) {
-    LOG(INFO) << "Pkcs11KeyStore: Certificate already exists.";
-    return true;
-  }
+bool Pkcs11KeyStore::CreateCertificateObject(CK_SESSION_HANDLE session_handle,
+                                             const std::string& certificate,
+                                             const std::string& id,
+                                             const std::string& label) {
   std::string subject;
   std::string issuer;
   std::string serial_number;
@@ -384,11 +454,13 @@ bool Pkcs11KeyStore::RegisterCertificate(const std::string& username,
   }
   // Construct a PKCS #11 template for a certificate object.
   std::string mutable_certificate = certificate;
+  std::string mutable_id = id;
+  std::string mutable_label = label;
   CK_OBJECT_CLASS certificate_class = CKO_CERTIFICATE;
   CK_CERTIFICATE_TYPE certificate_type = CKC_X_509;
   CK_BBOOL true_value = CK_TRUE;
   CK_BBOOL false_value = CK_FALSE;
-  CK_ATTRIBUTE certificate_attributes[] = {
+  std::vector<CK_ATTRIBUTE> certificate_attributes = {
       {CKA_CLASS, &certificate_class, sizeof(certificate_class)},
       {CKA_TOKEN, &true_value, sizeof(true_value)},
       {CKA_PRIVATE, &false_value, sizeof(false_value)},
@@ -399,9 +471,18 @@ bool Pkcs11KeyStore::RegisterCertificate(const std::string& username,
        serial_number.size()},
       {CKA_VALUE, string_as_array(&mutable_certificate),
        mutable_certificate.size()}};
+  // Certificates registered with a key are linked to it by ID and label.
+  if (!mutable_id.empty()) {
+    certificate_attributes.push_back(
+        {CKA_ID, string_as_array(&mutable_id), mutable_id.size()});
+  }
+  if (!mutable_label.empty()) {
+    certificate_attributes.push_back(
+        {CKA_LABEL, string_as_array(&mutable_label), mutable_label.size()});
+  }
   CK_OBJECT_HANDLE object_handle = CK_INVALID_HANDLE;
-  if (C_CreateObject(session.handle(), certificate_attributes,
-                     arraysize(certificate_attributes),
+  if (C_CreateObject(session_handle, certificate_attributes.data(),
+                     certificate_attributes.size(),
                      &object_handle) != CKR_OK) {
     LOG(ERROR) << "Pkcs11KeyStore: Failed to create certificate object.";
     return false;
@@ -409,38 +490,70 @@ bool Pkcs11KeyStore::RegisterCertificate(const std::string& username,
   return true;
 }
 
-CK_OBJECT_HANDLE Pkcs11KeyStore::FindObject(CK_SESSION_HANDLE session_handle,
+bool Pkcs11KeyStore::AddCertificateIfMissing(CK_SLOT_ID slot,
+                                             CK_SESSION_HANDLE session_handle,
+                                             const std::string& certificate) {
+  std::set<std::string>& known = known_certificates_[slot];
+  std::string certificate_hash = Sha1(certificate);
+  if (known.count(certificate_hash) > 0 ||
+      DoesCertificateExist(session_handle, certificate)) {
+    LOG(INFO) << "Pkcs11KeyStore: Certificate already exists.";
+    known.insert(certificate_hash);
+    return true;
+  }
+  if (!CreateCertificateObject(session_handle, certificate, std::string(),
+                               std::string())) {
+    return false;
+  }
+  known.insert(certificate_hash);
+  return true;
+}
+
+CK_OBJECT_HANDLE Pkcs11KeyStore::FindObject(CK_SLOT_ID slot,
+                                            CK_SESSION_HANDLE session_handle,
                                             const std::string& key_name) {
-  // Assemble a search template.
-  std::string mutable_key_name(key_name);
-  std::string mutable_application_id(kApplicationID);
-  CK_OBJECT_CLASS object_class = CKO_DATA;
-  CK_BBOOL true_value = CK_TRUE;
-  CK_BBOOL false_value = CK_FALSE;
-  CK_ATTRIBUTE attributes[] = {
-      {CKA_CLASS, &object_class, sizeof(object_class)},
-      {CKA_LABEL, string_as_array(&mutable_key_name), mutable_key_name.size()},
-      {CKA_APPLICATION, string_as_array(&mutable_application_id),
-       mutable_application_id.size()},
-      {CKA_TOKEN, &true_value, sizeof(true_value)},
-      {CKA_PRIVATE, &true_value, sizeof(true_value)},
-      {CKA_MODIFIABLE, &false_value, sizeof(false_value)}};
-  CK_OBJECT_HANDLE key_handle = CK_INVALID_HANDLE;
-  CK_ULONG count = 0;
-  if ((C_FindObjectsInit(session_handle, attributes, arraysize(attributes)) !=
-       CKR_OK) ||
-      (C_FindObjects(session_handle, &key_handle, 1, &count) != CKR_OK) ||
-      (C_FindObjectsFinal(session_handle) != CKR_OK)) {
+  KeyIndex* index = GetKeyIndex(slot, session_handle);
+  if (!index) {
     LOG(ERROR) << "Key search failed: " << key_name;
     return CK_INVALID_HANDLE;
   }
-  if (count == 1)
-    return key_handle;
-  return CK_INVALID_HANDLE;
+  auto iter = index->find(key_name);
+  if (iter == index->end())
+    return CK_INVALID_HANDLE;
+  return iter->second;
+}
+
+Pkcs11KeyStore::KeyIndex* Pkcs11KeyStore::GetKeyIndex(
+    CK_SLOT_ID slot,
+    CK_SESSION_HANDLE session_handle) {
+  auto iter = key_indexes_.find(slot);
+  if (iter != key_indexes_.end())
+    return &iter->second;
+  KeyIndex index;
+  EnumObjectsCallback callback = base::Bind(
+      &Pkcs11KeyStore::AddToKeyIndex, base::Unretained(this), &index);
+  if (!EnumObjects(session_handle, callback))
+    return nullptr;
+  KeyIndex* result = &key_indexes_[slot];
+  result->swap(index);
+  return result;
 }
 
 bool Pkcs11KeyStore::GetUserSlot(const std::string& username,
                                  CK_SLOT_ID_PTR slot) {
+  auto iter = user_slots_.find(username);
+  if (iter != user_slots_.end()) {
+    *slot = iter->second;
+    return true;
+  }
+  if (!FindUserSlot(username, slot))
+    return false;
+  user_slots_[username] = *slot;
+  return true;
+}
+
+bool Pkcs11KeyStore::FindUserSlot(const std::string& username,
+                                  CK_SLOT_ID_PTR slot) {
   const char kChapsDaemonName[] = "chaps";
   const char kChapsSystemToken[] = "/var/lib/chaps";
   base::FilePath token_path =
@@ -448,10 +561,13 @@ bool Pkcs11KeyStore::GetUserSlot(const std::string& username,
           ? base::FilePath(kChapsSystemToken)
           : brillo::cryptohome::home::GetDaemonPath(username, kChapsDaemonName);
   CK_RV rv;
-  rv = C_Initialize(nullptr);
-  if (rv != CKR_OK && rv != CKR_CRYPTOKI_ALREADY_INITIALIZED) {
-    LOG(WARNING) << __func__ << ": C_Initialize failed.";
-    return false;
+  if (!pkcs11_initialized_) {
+    rv = C_Initialize(nullptr);
+    if (rv != CKR_OK && rv != CKR_CRYPTOKI_ALREADY_INITIALIZED) {
+      LOG(WARNING) << __func__ << ": C_Initialize failed.";
+      return false;
+    }
+    pkcs11_initialized_ = true;
   }
   CK_ULONG num_slots = 0;
   rv = C_GetSlotList(CK_TRUE, nullptr, &num_slots);
@@ -480,6 +596,54 @@ bool Pkcs11KeyStore::GetUserSlot(const std::string& username,
   return false;
 }
 
+CK_SESSION_HANDLE Pkcs11KeyStore::AcquireSession(CK_SLOT_ID slot) {
+  std::vector<CK_SESSION_HANDLE>& idle = idle_sessions_[slot];
+  if (!idle.empty()) {
+    CK_SESSION_HANDLE session_handle = idle.back();
+    idle.pop_back();
+    CK_SESSION_INFO session_info;
+    if (C_GetSessionInfo(session_handle, &session_info) == CKR_OK)
+      return session_handle;
+    // Chaps closes the sessions of a token when it is unloaded; the slot may
+    // now hold a different token, or none.
+    LOG(INFO) << "Pkcs11KeyStore: Pooled session is stale, dropping slot.";
+    InvalidateSlot(slot);
+    return CK_INVALID_HANDLE;
+  }
+  CK_SESSION_HANDLE session_handle = CK_INVALID_HANDLE;
+  CK_FLAGS flags = CKF_RW_SESSION | CKF_SERIAL_SESSION;
+  if (C_OpenSession(slot, flags, nullptr, nullptr, &session_handle) !=
+      CKR_OK) {
+    LOG(ERROR) << "Failed to open PKCS #11 session.";
+    InvalidateSlot(slot);
+    return CK_INVALID_HANDLE;
+  }
+  return session_handle;
+}
+
+void Pkcs11KeyStore::ReleaseSession(CK_SLOT_ID slot,
+                                    CK_SESSION_HANDLE session_handle) {
+  idle_sessions_[slot].push_back(session_handle);
+}
+
+void Pkcs11KeyStore::CloseAllSessions(CK_SLOT_ID slot) {
+  C_CloseAllSessions(slot);
+  idle_sessions_.erase(slot);
+}
+
+void Pkcs11KeyStore::InvalidateSlot(CK_SLOT_ID slot) {
+  CloseAllSessions(slot);
+  key_indexes_.erase(slot);
+  known_certificates_.erase(slot);
+  for (auto user_iter = user_slots_.begin(); user_iter != user_slots_.end();) {
+    if (user_iter->second == slot) {
+      user_iter = user_slots_.erase(user_iter);
+    } else {
+      ++user_iter;
+    }
+  }
+}
+
 bool Pkcs11KeyStore::EnumObjects(
     CK_SESSION_HANDLE session_handle,
     const Pkcs11KeyStore::EnumObjectsCallback& callback) {
@@ -520,7 +684,8 @@ bool Pkcs11KeyStore::EnumObjects(
     }
   }
   if (C_FindObjectsFinal(session_handle) != CKR_OK) {
-    LOG(WARNING) << "Failed to finalize key search.";
+    LOG(ERROR) << "Failed to finalize key search.";
+    return false;
   }
   return true;
 }
@@ -528,32 +693,18 @@ bool Pkcs11KeyStore::EnumObjects(
 bool Pkcs11KeyStore::GetKeyName(CK_SESSION_HANDLE session_handle,
                                 CK_OBJECT_HANDLE object_handle,
                                 std::string* key_name) {
-  CK_ATTRIBUTE attribute = {CKA_LABEL, nullptr, 0};
-  if (C_GetAttributeValue(session_handle, object_handle, &attribute, 1) !=
-      CKR_OK) {
-    LOG(ERROR) << "C_GetAttributeValue(CKA_LABEL) [length] failed.";
-    return false;
-  }
-  key_name->resize(attribute.ulValueLen);
-  attribute.pValue = string_as_array(key_name);
-  if (C_GetAttributeValue(session_handle, object_handle, &attribute, 1) !=
-      CKR_OK) {
+  if (!ReadAttribute(session_handle, object_handle, CKA_LABEL,
+                     kKeyNameSizeHint, key_name)) {
     LOG(ERROR) << "C_GetAttributeValue(CKA_LABEL) failed.";
     return false;
   }
   return true;
 }
 
-bool Pkcs11KeyStore::DeleteIfMatchesPrefix(CK_SESSION_HANDLE session_handle,
-                                           const std::string& key_prefix,
-                                           const std::string& key_name,
-                                           CK_OBJECT_HANDLE object_handle) {
-  if (base::StartsWith(key_name, key_prefix, base::CompareCase::SENSITIVE)) {
-    if (C_DestroyObject(session_handle, object_handle) != CKR_OK) {
-      LOG(ERROR) << "C_DestroyObject failed.";
-      return false;
-    }
-  }
+bool Pkcs11KeyStore::AddToKeyIndex(KeyIndex* index,
+                                   const std::string& key_name,
+                                   CK_OBJECT_HANDLE object_handle) {
+  (*index)[key_name] = object_handle;
   return true;
 }
 
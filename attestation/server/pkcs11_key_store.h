@@ -19,7 +19,10 @@
 
 #include "attestation/server/key_store.h"
 
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <base/callback_forward.h>
 #include <base/macros.h>
@@ -41,6 +44,17 @@ namespace attestation {
 // objects residing in the same token.  In practice, this means that any
 // component with access to the PKCS #11 token also has access to read or delete
 // key data.
+//
+// Slot lookups and read/write sessions are cached: the slot found for a user is
+// remembered, and sessions are returned to a per-slot pool instead of being
+// closed after each operation.  A pooled session is checked before it is
+// reused; if chaps has closed it (e.g. because the token was removed when the
+// user logged out, or chaps restarted) the pool for that slot and every cached
+// slot lookup pointing at it are dropped and the slot is looked up again.
+//
+// The key data objects on each token are indexed by label the first time the
+// token is used, and the index is kept up to date by Write and Delete, so key
+// lookups do not have to search the token.
 class Pkcs11KeyStore : public KeyStore {
  public:
   // Does not take ownership of pointers.
@@ -58,6 +72,8 @@ class Pkcs11KeyStore : public KeyStore {
               const std::string& key_name) override;
   bool DeleteByPrefix(const std::string& username,
                       const std::string& key_prefix) override;
+  bool DeleteByPrefixes(const std::vector<std::string>& usernames,
+                        const std::vector<std::string>& key_prefixes) override;
   bool Register(const std::string& username,
                 const std::string& label,
                 KeyType key_type,
@@ -67,21 +83,64 @@ class Pkcs11KeyStore : public KeyStore {
                 const std::string& certificate) override;
   bool RegisterCertificate(const std::string& username,
                            const std::string& certificate) override;
+  bool RegisterWithCertificateChain(
+      const std::string& username,
+      const std::string& label,
+      KeyType key_type,
+      KeyUsage key_usage,
+      const std::string& private_key_blob,
+      const std::string& public_key_der,
+      const std::string& certificate,
+      const std::vector<std::string>& intermediate_ca_certs) override;
 
  private:
+  class ScopedSession;
+
   using EnumObjectsCallback =
       base::Callback<bool(const std::string& key_name,
                           CK_OBJECT_HANDLE object_handle)>;
-
-  // Searches for a PKCS #11 object for a given key name.  If one exists, the
-  // object handle is returned, otherwise CK_INVALID_HANDLE is returned.
-  CK_OBJECT_HANDLE FindObject(CK_SESSION_HANDLE session_handle,
+  // Maps key names to the handles of their PKCS #11 objects.
+  using KeyIndex = std::map<std::string, CK_OBJECT_HANDLE>;
+
+  // Deletes the keys of |username| named with any of |key_prefixes|, which
+  // must be sorted and none of which may start with another.  Returns true on
+  // success.
+  bool DeleteKeysWithPrefixes(const std::string& username,
+                              const std::vector<std::string>& key_prefixes);
+
+  // Looks up the PKCS #11 object for a given key name on |slot|.  If one
+  // exists, the object handle is returned, otherwise CK_INVALID_HANDLE is
+  // returned.
+  CK_OBJECT_HANDLE FindObject(CK_SLOT_ID slot,
+                              CK_SESSION_HANDLE session_handle,
                               const std::string& key_name);
 
+  // Returns the key index for |slot|, building it with |session_handle| if
+  // necessary.  Returns nullptr if the token could not be searched.
+  KeyIndex* GetKeyIndex(CK_SLOT_ID slot, CK_SESSION_HANDLE session_handle);
+
   // Gets a slot for the given |username| if |is_user_specific| or the system
-  // slot otherwise. Returns false if no appropriate slot is found.
+  // slot otherwise. Returns false if no appropriate slot is found.  Cached
+  // results are returned without querying PKCS #11 or the token manager.
   bool GetUserSlot(const std::string& username, CK_SLOT_ID_PTR slot);
 
+  // Looks up the slot for |username| without consulting the cache.
+  bool FindUserSlot(const std::string& username, CK_SLOT_ID_PTR slot);
+
+  // Takes a read/write session on |slot| from the pool, or opens a new one.
+  // Returns CK_INVALID_HANDLE if no valid session could be obtained.
+  CK_SESSION_HANDLE AcquireSession(CK_SLOT_ID slot);
+
+  // Returns a session obtained from AcquireSession to the pool for |slot|.
+  void ReleaseSession(CK_SLOT_ID slot, CK_SESSION_HANDLE session_handle);
+
+  // Closes all sessions on |slot|, including pooled ones.
+  void CloseAllSessions(CK_SLOT_ID slot);
+
+  // Closes all sessions on |slot| and forgets every cached slot lookup that
+  // resolved to |slot|.
+  void InvalidateSlot(CK_SLOT_ID slot);
+
   // Enumerates all PKCS #11 objects associated with keys.  The |callback| is
   // called once for each object.
   bool EnumObjects(CK_SESSION_HANDLE session_handle,
@@ -93,13 +152,11 @@ class Pkcs11KeyStore : public KeyStore {
                   CK_OBJECT_HANDLE object_handle,
                   std::string* key_name);
 
-  // An EnumObjectsCallback for use with DeleteByPrefix.  Destroys the key
-  // object identified by |object_handle| if |key_name| matches |key_prefix|.
-  // Returns true on success.
-  bool DeleteIfMatchesPrefix(CK_SESSION_HANDLE session_handle,
-                             const std::string& key_prefix,
-                             const std::string& key_name,
-                             CK_OBJECT_HANDLE object_handle);
+  // An EnumObjectsCallback for use with GetKeyIndex.  Adds the key object
+  // identified by |object_handle| to |index|.  Always returns true.
+  bool AddToKeyIndex(KeyIndex* index,
+                     const std::string& key_name,
+                     CK_OBJECT_HANDLE object_handle);
 
   // Extracts the |subject|, |issuer|, and |serial_number| information from an
   // X.509 |certificate|. Returns false if the value cannot be determined.
@@ -112,7 +169,41 @@ class Pkcs11KeyStore : public KeyStore {
   bool DoesCertificateExist(CK_SESSION_HANDLE session_handle,
                             const std::string& certificate);
 
+  // Creates the public key, private key and, if |certificate| is not empty,
+  // certificate objects for a key.  Returns true on success.
+  bool CreateKeyObjects(CK_SESSION_HANDLE session_handle,
+                        const std::string& label,
+                        KeyUsage key_usage,
+                        const std::string& private_key_blob,
+                        const std::string& public_key_der,
+                        const std::string& certificate);
+
+  // Creates a certificate object.  The object is linked to a key by |id| and
+  // |label| unless they are empty.  Returns true on success.
+  bool CreateCertificateObject(CK_SESSION_HANDLE session_handle,
+                               const std::string& certificate,
+                               const std::string& id,
+                               const std::string& label);
+
+  // Creates a certificate object on |slot| unless the certificate is known to
+  // be there already or is found by DoesCertificateExist.  Returns true on
+  // success.
+  bool AddCertificateIfMissing(CK_SLOT_ID slot,
+                               CK_SESSION_HANDLE session_handle,
+                               const std::string& certificate);
+
   chaps::TokenManagerClient* token_manager_;
+  // Whether C_Initialize has succeeded.
+  bool pkcs11_initialized_ = false;
+  // Maps a username (empty for the system token) to its slot.
+  std::map<std::string, CK_SLOT_ID> user_slots_;
+  // Idle read/write sessions, by slot.
+  std::map<CK_SLOT_ID, std::vector<CK_SESSION_HANDLE>> idle_sessions_;
+  // Key indexes, by slot.  A slot without an entry has not been indexed yet.
+  std::map<CK_SLOT_ID, KeyIndex> key_indexes_;
+  // SHA-1 digests of the unassociated certificates known to be on each slot's
+  // token, so that a shared CA chain is only searched for once.
+  std::map<CK_SLOT_ID, std::set<std::string>> known_certificates_;
 
   DISALLOW_COPY_AND_ASSIGN(Pkcs11KeyStore);
 };
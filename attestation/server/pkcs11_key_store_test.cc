@@ -194,7 +194,7 @@ class KeyStoreTest : public testing::Test {
     return CKR_OK;
   }
 
-  // Supports reading CKA_VALUE.
+  // Supports reading CKA_VALUE and CKA_LABEL.
   virtual uint32_t GetAttributeValue(const brillo::SecureBlob& isolate,
                                      uint64_t session_id,
                                      uint64_t object_handle,
@@ -209,10 +209,11 @@ class KeyStoreTest : public testing::Test {
       value = label;
     if (parsed.num_attributes() != 1 ||
         (parsed.attributes()[0].type != CKA_VALUE &&
-         parsed.attributes()[0].type != CKA_LABEL) ||
-        (parsed.attributes()[0].pValue &&
-         parsed.attributes()[0].ulValueLen != value.size()))
+         parsed.attributes()[0].type != CKA_LABEL))
       return CKR_GENERAL_ERROR;
+    if (parsed.attributes()[0].pValue &&
+        parsed.attributes()[0].ulValueLen < value.size())
+      return CKR_BUFFER_TOO_SMALL;
     parsed.attributes()[0].ulValueLen = value.size();
     if (parsed.attributes()[0].pValue)
       memcpy(parsed.attributes()[0].pValue, value.data(), value.size());
@@ -442,14 +443,17 @@ TEST_F(KeyStoreTest, FindFail) {
   EXPECT_FALSE(key_store.Read(kDefaultUser, "test", &blob));
 }
 
-// Tests the key store when PKCS #11 successfully finds zero objects.
+// Tests the key store when PKCS #11 successfully finds zero objects.  The key
+// is written by a different key store instance so that it is not already in
+// the reading instance's index.
 TEST_F(KeyStoreTest, FindNoObjects) {
   std::vector<uint64_t> empty;
   EXPECT_CALL(pkcs11_, FindObjects(_, _, _, _))
       .WillRepeatedly(DoAll(SetArgumentPointee<3>(empty), Return(CKR_OK)));
+  Pkcs11KeyStore writer(&token_manager_);
+  EXPECT_TRUE(writer.Write(kDefaultUser, "test", "test_data"));
   Pkcs11KeyStore key_store(&token_manager_);
   std::string blob;
-  EXPECT_TRUE(key_store.Write(kDefaultUser, "test", "test_data"));
   EXPECT_FALSE(key_store.Read(kDefaultUser, "test", &blob));
 }
 
@@ -546,6 +550,92 @@ TEST_F(KeyStoreTest, RegisterCertificateSystemToken) {
   EXPECT_TRUE(key_store.RegisterCertificate(kDefaultUser, certificate_der));
 }
 
+// Tests that a key and its CA chain are registered together and that a CA
+// certificate is only searched for and created once.
+TEST_F(KeyStoreTest, RegisterWithCertificateChain) {
+  std::string public_key_der = HexDecode(kValidPublicKeyHex);
+  std::vector<std::string> ca_certs = {HexDecode(kValidCertificateHex),
+                                       HexDecode(kValidCertificateHex)};
+  EXPECT_CALL(pkcs11_, CreateObject(_, _, _, _))
+      .Times(5);  // Public and private for each key, the CA once.
+  EXPECT_CALL(pkcs11_, FindObjectsInit(_, _, _)).Times(1);
+  EXPECT_CALL(pkcs11_, CloseAllSessions(_, 1)).Times(2);
+  Pkcs11KeyStore key_store(&token_manager_);
+  EXPECT_TRUE(key_store.RegisterWithCertificateChain(
+      kDefaultUser, "label1", KEY_TYPE_RSA, KEY_USAGE_SIGN, "private_key_blob",
+      public_key_der, "", ca_certs));
+  EXPECT_TRUE(key_store.RegisterWithCertificateChain(
+      kDefaultUser, "label2", KEY_TYPE_RSA, KEY_USAGE_SIGN, "private_key_blob",
+      public_key_der, "", ca_certs));
+  EXPECT_TRUE(key_store.RegisterCertificate(kDefaultUser, ca_certs[0]));
+}
+
+// Tests that the slot lookup and the session are reused across operations.
+TEST_F(KeyStoreTest, SessionReuse) {
+  EXPECT_CALL(pkcs11_, GetSlotList(_, _, _)).Times(2);  // Count, then list.
+  EXPECT_CALL(pkcs11_, OpenSession(_, _, _, _)).Times(1);
+  EXPECT_CALL(pkcs11_, CloseSession(_, kSession)).Times(1);  // On destruction.
+  Pkcs11KeyStore key_store(&token_manager_);
+  std::string blob;
+  EXPECT_TRUE(key_store.Write(kDefaultUser, "test", "test_data"));
+  EXPECT_TRUE(key_store.Read(kDefaultUser, "test", &blob));
+  EXPECT_TRUE(key_store.Delete(kDefaultUser, "test"));
+  EXPECT_TRUE(key_store.DeleteByPrefix(kDefaultUser, "prefix"));
+}
+
+// Tests that DeleteByPrefixes() removes the keys matching any prefix, searching
+// the token once, and keeps the rest.
+TEST_F(KeyStoreTest, DeleteByPrefixes) {
+  Pkcs11KeyStore key_store(&token_manager_);
+  ASSERT_TRUE(key_store.Write(kDefaultUser, "a_key", "test"));
+  ASSERT_TRUE(key_store.Write(kDefaultUser, "ab_key", "test"));
+  ASSERT_TRUE(key_store.Write(kDefaultUser, "b_key", "test"));
+  ASSERT_TRUE(key_store.Write(kDefaultUser, "c_key", "test"));
+  EXPECT_CALL(pkcs11_, FindObjectsInit(_, _, _)).Times(0);
+  ASSERT_TRUE(key_store.DeleteByPrefixes({kDefaultUser},
+                                         {"c", "ab", "a", "missing"}));
+  std::string blob;
+  EXPECT_FALSE(key_store.Read(kDefaultUser, "a_key", &blob));
+  EXPECT_FALSE(key_store.Read(kDefaultUser, "ab_key", &blob));
+  EXPECT_TRUE(key_store.Read(kDefaultUser, "b_key", &blob));
+  EXPECT_FALSE(key_store.Read(kDefaultUser, "c_key", &blob));
+}
+
+// Tests that Register() still closes all sessions on the slot and that the
+// next operation opens a new one without looking up the slot again.
+TEST_F(KeyStoreTest, RegisterClosesPooledSessions) {
+  EXPECT_CALL(pkcs11_, GetSlotList(_, _, _)).Times(2);
+  EXPECT_CALL(pkcs11_, OpenSession(_, 1, _, _)).Times(2);
+  EXPECT_CALL(pkcs11_, CloseAllSessions(_, 1)).Times(1);
+  Pkcs11KeyStore key_store(&token_manager_);
+  std::string public_key_der = HexDecode(kValidPublicKeyHex);
+  EXPECT_TRUE(key_store.Register(kDefaultUser, "test_label", KEY_TYPE_RSA,
+                                 KEY_USAGE_SIGN, "private_key_blob",
+                                 public_key_der, ""));
+  EXPECT_TRUE(key_store.Write(kDefaultUser, "test", "test_data"));
+}
+
+// Tests that the token is searched once and later lookups use the key index.
+TEST_F(KeyStoreTest, IndexedLookups) {
+  Pkcs11KeyStore writer(&token_manager_);
+  EXPECT_TRUE(writer.Write(kDefaultUser, "existing", "existing_data"));
+  EXPECT_CALL(pkcs11_, FindObjectsInit(_, _, _)).Times(1);
+  Pkcs11KeyStore key_store(&token_manager_);
+  std::string blob;
+  EXPECT_TRUE(key_store.Read(kDefaultUser, "existing", &blob));
+  EXPECT_EQ("existing_data", blob);
+  EXPECT_TRUE(key_store.Write(kDefaultUser, "test", "test_data"));
+  EXPECT_TRUE(key_store.Read(kDefaultUser, "test", &blob));
+  EXPECT_EQ("test_data", blob);
+  EXPECT_TRUE(key_store.Write(kDefaultUser, "test", "test_data2"));
+  EXPECT_TRUE(key_store.Read(kDefaultUser, "test", &blob));
+  EXPECT_EQ("test_data2", blob);
+  EXPECT_TRUE(key_store.Delete(kDefaultUser, "test"));
+  EXPECT_FALSE(key_store.Read(kDefaultUser, "test", &blob));
+  EXPECT_TRUE(key_store.DeleteByPrefix(kDefaultUser, "exist"));
+  EXPECT_FALSE(key_store.Read(kDefaultUser, "existing", &blob));
+}
+
 // Tests that the DeleteByPrefix() method removes the correct objects and only
 // the correct objects.
 TEST_F(KeyStoreTest, DeleteByPrefix) {
@@ -141,6 +141,19 @@ LOCAL_SRC_FILES := \
   client/main.cc
 include $(BUILD_EXECUTABLE)
 
+# tpm_manager_bench
+# ========================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := tpm_manager_bench
+LOCAL_CPP_EXTENSION := $(defaultCppExtension)
+LOCAL_CFLAGS := $(defaultCFlags)
+LOCAL_CLANG := true
+LOCAL_C_INCLUDES := $(defaultIncludes)
+LOCAL_SHARED_LIBRARIES := $(defaultSharedLibraries) libtpm_manager
+LOCAL_SRC_FILES := \
+  client/tpm_manager_bench.cc
+include $(BUILD_EXECUTABLE)
+
 # Target unit tests
 # ========================================================
 include $(CLEAR_VARS)
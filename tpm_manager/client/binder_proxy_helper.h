@@ -19,6 +19,9 @@ namespace tpm_manager {
 // Handles protobuf conversions for a binder proxy. Implements ITpmManagerClient
 // and acts as a response observer for async requests it sends out. The
 // |RequestProtobufType| and |ResponseProtobufType| types can be any protobufs.
+// All ITpmNvram and ITpmOwnership methods are oneway, so SendRequest() returns
+// as soon as the transaction is queued; each request gets its own observer
+// and any number of requests may be outstanding at once.
 template<typename RequestProtobufType, typename ResponseProtobufType>
 class BinderProxyHelper {
  public:
@@ -46,13 +49,15 @@ class BinderProxyHelper {
     VLOG(2) << __func__;
     android::sp<ResponseObserver> observer(
         new ResponseObserver(callback_, get_error_response_));
-    std::vector<uint8_t> request_bytes;
-    request_bytes.resize(request.ByteSize());
-    if (!request.SerializeToArray(request_bytes.data(), request_bytes.size())) {
+    if (!request.IsInitialized()) {
       LOG(ERROR) << "BinderProxyHelper: Failed to serialize protobuf.";
       SendErrorResponse();
       return;
     }
+    // ByteSize() caches the sizes, so serialize without walking the message
+    // again.
+    std::vector<uint8_t> request_bytes(request.ByteSize());
+    request.SerializeWithCachedSizesToArray(request_bytes.data());
     android::binder::Status status = method_.Run(request_bytes, observer);
     if (!status.isOk()) {
       LOG(ERROR) << "BinderProxyHelper: Binder error: " << status.toString8();
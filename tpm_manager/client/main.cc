@@ -18,14 +18,18 @@
 #include <stdlib.h>
 #include <sysexits.h>
 
+#include <deque>
 #include <memory>
 #include <string>
 
 #include <base/command_line.h>
 #include <base/files/file_util.h>
+#include <base/json/json_reader.h>
 #include <base/logging.h>
 #include <base/memory/ptr_util.h>
 #include <base/message_loop/message_loop.h>
+#include <base/strings/string_split.h>
+#include <base/values.h>
 #include <brillo/bind_lambda.h>
 #if defined(USE_BINDER_IPC)
 #include <brillo/binder_watcher.h>
@@ -65,12 +69,19 @@ constexpr char kAttributesSwitch[] = "attributes";
 constexpr char kPasswordSwitch[] = "password";
 constexpr char kBindToPCR0Switch[] = "bind_to_pcr0";
 constexpr char kFileSwitch[] = "file";
+constexpr char kOffsetSwitch[] = "offset";
+constexpr char kChunkSizeSwitch[] = "chunk_size";
 constexpr char kUseOwnerSwitch[] = "use_owner_authorization";
 constexpr char kLockRead[] = "lock_read";
 constexpr char kLockWrite[] = "lock_write";
+constexpr char kBatchSwitch[] = "batch";
 
 constexpr char kUsage[] = R"(
 Usage: tpm_manager_client <command> [<arguments>]
+       tpm_manager_client --batch=<batch_file>
+Runs one command, or with --batch the commands listed in a file ('-' for stdin)
+one after another over a single connection. Each line of a batch file is a JSON
+array of the arguments of one command, e.g. ["get_space_info", "--index=1"].
 Commands:
   status
       Prints TPM status information.
@@ -101,9 +112,12 @@ Commands:
       Destroys an NV space. This command requires that owner authorization is
       available.
   write_space --index=<index> --file=<input_file> [--password=<password>]
-              [--use_owner_authorization]
-      Writes data from a file to an NV space. Any existing data will be
-      overwritten.
+              [--use_owner_authorization] [--offset=<offset>]
+              [--chunk_size=<chunk_size>]
+      Writes data from a file to an NV space, starting at the given offset.
+      Any existing data in that range will be overwritten. With a chunk size,
+      the data is sent in requests of at most that many bytes and progress is
+      reported after each one.
   read_space --index=<index> --file=<output_file> [--password=<password>]
              [--use_owner_authorization]
       Reads the entire contents of an NV space to a file.
@@ -153,6 +167,45 @@ uint32_t StringToNvramIndex(const std::string& s) {
   return trunks::HR_HANDLE_MASK & StringToUint32(s);
 }
 
+// Reads the commands of a batch file at |path|, or stdin if it is "-". Each
+// non-empty line is a JSON array of the arguments of a command, which are
+// parsed as if they followed |program|. Returns false if the file cannot be
+// read or a line is malformed.
+bool ReadBatch(const std::string& path,
+               const base::FilePath& program,
+               std::deque<base::CommandLine>* commands) {
+  std::string contents;
+  if (!ReadFileToString(path == "-" ? "/dev/stdin" : path, &contents)) {
+    LOG(ERROR) << "Failed to read batch file " << path;
+    return false;
+  }
+  int line_number = 0;
+  for (const std::string& line : base::SplitString(
+           contents, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL)) {
+    ++line_number;
+    if (line.empty()) {
+      continue;
+    }
+    std::unique_ptr<base::Value> value = base::JSONReader::Read(line);
+    base::ListValue* args = nullptr;
+    if (!value || !value->GetAsList(&args)) {
+      LOG(ERROR) << "Batch line " << line_number << " is not a JSON array.";
+      return false;
+    }
+    base::CommandLine::StringVector argv = {program.value()};
+    for (size_t i = 0; i < args->GetSize(); ++i) {
+      std::string arg;
+      if (!args->GetString(i, &arg)) {
+        LOG(ERROR) << "Batch line " << line_number << " has a non-string.";
+        return false;
+      }
+      argv.push_back(arg);
+    }
+    commands->emplace_back(argv);
+  }
+  return true;
+}
+
 using ClientLoopBase = brillo::Daemon;
 class ClientLoop : public ClientLoopBase {
  public:
@@ -191,7 +244,17 @@ class ClientLoop : public ClientLoopBase {
     }
     tpm_nvram_ = std::move(nvram_proxy);
     tpm_ownership_ = std::move(ownership_proxy);
-    exit_code = ScheduleCommand();
+    base::CommandLine* command_line = base::CommandLine::ForCurrentProcess();
+    if (command_line->HasSwitch(kBatchSwitch)) {
+      batch_mode_ = true;
+      if (!ReadBatch(command_line->GetSwitchValueASCII(kBatchSwitch),
+                     command_line->GetProgram(), &batch_)) {
+        return EX_DATAERR;
+      }
+      exit_code = ScheduleBatchCommand();
+    } else {
+      exit_code = ScheduleCommand(command_line);
+    }
     if (exit_code == EX_USAGE) {
       printf("%s%s", kUsage, kKnownNVRAMSpaces);
     }
@@ -205,10 +268,37 @@ class ClientLoop : public ClientLoopBase {
   }
 
  private:
-  // Posts tasks on to the message loop based on command line flags.
-  int ScheduleCommand() {
+  // Posts the next command of the batch, or a task to quit once the batch is
+  // done, on to the message loop.
+  int ScheduleBatchCommand() {
+    if (batch_.empty()) {
+      base::MessageLoop::current()->task_runner()->PostTask(
+          FROM_HERE,
+          base::Bind(&ClientLoop::Quit, weak_factory_.GetWeakPtr()));
+      return EX_OK;
+    }
+    base::CommandLine command_line = batch_.front();
+    batch_.pop_front();
+    return ScheduleCommand(&command_line);
+  }
+
+  // Quits, or in batch mode goes on with the next command. Connections and
+  // proxies are kept for the whole batch.
+  void FinishCommand() {
+    if (!batch_mode_) {
+      Quit();
+      return;
+    }
+    int exit_code = ScheduleBatchCommand();
+    if (exit_code != EX_OK) {
+      LOG(ERROR) << "Invalid command in batch.";
+      QuitWithExitCode(exit_code);
+    }
+  }
+
+  // Posts tasks on to the message loop based on the flags of |command_line|.
+  int ScheduleCommand(const base::CommandLine* command_line) {
     base::Closure task;
-    base::CommandLine* command_line = base::CommandLine::ForCurrentProcess();
     if (command_line->HasSwitch("help") || command_line->HasSwitch("h") ||
         command_line->GetArgs().size() == 0) {
       return EX_USAGE;
@@ -255,6 +345,8 @@ class ClientLoop : public ClientLoopBase {
           &ClientLoop::HandleWriteSpace, weak_factory_.GetWeakPtr(),
           StringToNvramIndex(command_line->GetSwitchValueASCII(kIndexSwitch)),
           command_line->GetSwitchValueASCII(kFileSwitch),
+          StringToUint32(command_line->GetSwitchValueASCII(kOffsetSwitch)),
+          StringToUint32(command_line->GetSwitchValueASCII(kChunkSizeSwitch)),
           command_line->GetSwitchValueASCII(kPasswordSwitch),
           command_line->HasSwitch(kUseOwnerSwitch));
     } else if (command == kReadSpaceCommand) {
@@ -297,11 +389,24 @@ class ClientLoop : public ClientLoopBase {
     return EX_OK;
   }
 
+  // Template to log a reply protobuf. The reply is streamed straight into the
+  // log message, and only if INFO messages are logged. Bytes fields are logged
+  // by size; their contents can be large and are handled by the caller.
+  template <typename ProtobufType>
+  void LogReply(const ProtobufType& reply) {
+    if (!LOG_IS_ON(INFO)) {
+      return;
+    }
+    logging::LogMessage message(__FILE__, __LINE__, logging::LOG_INFO);
+    message.stream() << "Message Reply: ";
+    WriteProtoDebugString(reply, 0, true /* elide_bytes */, &message.stream());
+  }
+
   // Template to print reply protobuf.
   template <typename ProtobufType>
   void PrintReplyAndQuit(const ProtobufType& reply) {
-    LOG(INFO) << "Message Reply: " << GetProtoDebugString(reply);
-    Quit();
+    LogReply(reply);
+    FinishCommand();
   }
 
   void HandleGetTpmStatus() {
@@ -418,6 +523,8 @@ class ClientLoop : public ClientLoopBase {
 
   void HandleWriteSpace(uint32_t index,
                         const std::string& input_file,
+                        uint32_t offset,
+                        uint32_t chunk_size,
                         const std::string& password,
                         bool use_owner_authorization) {
     WriteSpaceRequest request;
@@ -428,12 +535,47 @@ class ClientLoop : public ClientLoopBase {
       Quit();
       return;
     }
-    request.set_data(data);
+    request.set_offset(offset);
     request.set_authorization_value(crypto::SHA256HashString(password));
     request.set_use_owner_authorization(use_owner_authorization);
+    if (chunk_size == 0) {
+      // The service splits the data into NV commands itself.
+      request.set_data(data);
+      tpm_nvram_->WriteSpace(
+          request, base::Bind(&ClientLoop::PrintReplyAndQuit<WriteSpaceReply>,
+                              weak_factory_.GetWeakPtr()));
+      return;
+    }
+    WriteSpaceChunk(request, data, chunk_size, 0);
+  }
+
+  // Writes the next |chunk_size| bytes of |data| after the |written| ones, at
+  // the matching offset from the one in |request|.
+  void WriteSpaceChunk(const WriteSpaceRequest& request,
+                       const std::string& data,
+                       uint32_t chunk_size,
+                       size_t written) {
+    WriteSpaceRequest chunk_request = request;
+    chunk_request.set_offset(request.offset() + written);
+    chunk_request.set_data(data.substr(written, chunk_size));
     tpm_nvram_->WriteSpace(
-        request, base::Bind(&ClientLoop::PrintReplyAndQuit<WriteSpaceReply>,
-                            weak_factory_.GetWeakPtr()));
+        chunk_request,
+        base::Bind(&ClientLoop::HandleWriteSpaceChunkReply,
+                   weak_factory_.GetWeakPtr(), request, data, chunk_size,
+                   written + chunk_request.data().size()));
+  }
+
+  void HandleWriteSpaceChunkReply(const WriteSpaceRequest& request,
+                                  const std::string& data,
+                                  uint32_t chunk_size,
+                                  size_t written,
+                                  const WriteSpaceReply& reply) {
+    if (reply.result() != NVRAM_RESULT_SUCCESS || written >= data.size()) {
+      PrintReplyAndQuit(reply);
+      return;
+    }
+    LOG(INFO) << "Wrote " << written << " of " << data.size() << " bytes.";
+    WriteSpaceChunk(request, data, chunk_size, written);
   }
 
   void HandleReadSpaceReply(const std::string& output_file,
@@ -441,8 +583,8 @@ class ClientLoop : public ClientLoopBase {
     if (!WriteStringToFile(reply.data(), output_file)) {
       LOG(ERROR) << "Failed to write output file.";
     }
-    LOG(INFO) << "Message Reply: " << GetProtoDebugString(reply);
-    Quit();
+    LogReply(reply);
+    FinishCommand();
   }
 
   void HandleReadSpace(uint32_t index,
@@ -490,6 +632,10 @@ class ClientLoop : public ClientLoopBase {
                             weak_factory_.GetWeakPtr()));
   }
 
+  // Whether commands come from a batch file, and those still to run.
+  bool batch_mode_ = false;
+  std::deque<base::CommandLine> batch_;
+
   // IPC proxy interfaces.
   std::unique_ptr<tpm_manager::TpmNvramInterface> tpm_nvram_;
   std::unique_ptr<tpm_manager::TpmOwnershipInterface> tpm_ownership_;
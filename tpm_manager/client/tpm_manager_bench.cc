@@ -0,0 +1,636 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// tpm_manager_bench measures tpm_managerd throughput and latency. Several
+// clients, each with its own connection, call one operation back to back for
+// a number of iterations; operations and NVRAM space sizes are measured one
+// after another. With TPM 2.0 each phase is also broken down using the trunksd
+// resource manager counters: the TPM commands and round trips behind each
+// call, and the time spent in trunksd and in the TPM. The rest of the latency
+// is IPC and tpm_managerd.
+
+#include <stdio.h>
+#include <sysexits.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <base/bind.h>
+#include <base/command_line.h>
+#include <base/logging.h>
+#include <base/memory/ptr_util.h>
+#include <base/message_loop/message_loop.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/strings/stringprintf.h>
+#include <base/time/time.h>
+#if defined(USE_BINDER_IPC)
+#include <brillo/binder_watcher.h>
+#endif
+#include <brillo/daemons/daemon.h>
+#include <brillo/syslog_logging.h>
+
+#if defined(USE_BINDER_IPC)
+#include "tpm_manager/client/tpm_nvram_binder_proxy.h"
+#include "tpm_manager/client/tpm_ownership_binder_proxy.h"
+#else
+#include "tpm_manager/client/tpm_nvram_dbus_proxy.h"
+#include "tpm_manager/client/tpm_ownership_dbus_proxy.h"
+#endif
+#include "tpm_manager/common/tpm_manager.pb.h"
+#if defined(USE_TPM2) && !defined(USE_BINDER_IPC)
+#include "trunks/interface.pb.h"
+#include "trunks/trunks_dbus_proxy.h"
+#define TPM_MANAGER_BENCH_TRUNKS_STATS
+#endif
+
+namespace tpm_manager {
+namespace {
+
+constexpr char kDefaultOperations[] =
+    "status,list_spaces,space_info,read,write";
+constexpr char kDefaultSizes[] = "32";
+constexpr int kDefaultClients = 4;
+constexpr int kDefaultIterations = 50;
+// Each client has one space per size, in the range reserved for software.
+constexpr uint32_t kIndexBase = 0x800100;
+constexpr uint32_t kMaxSizesPerRun = 16;
+// The index used by the define operation is distinct from the other spaces.
+constexpr uint32_t kDefineIndexOffset = kMaxSizesPerRun - 1;
+
+constexpr char kUsage[] = R"(
+Usage: tpm_manager_bench [options]
+  --clients=<N> - Concurrent clients, 4 by default.
+  --iterations=<N> - Calls per client and phase, 50 by default.
+  --operations=<op>,... - The operations to measure, one after another:
+      status (GetTpmStatus), list_spaces, space_info, read, write and define
+      (DefineSpace followed by DestroySpace). The default is:
+      status,list_spaces,space_info,read,write
+  --sizes=<bytes>,... - NVRAM space sizes for space_info, read, write and
+      define, 32 by default. Each size is a separate phase.
+  --json - Prints results as JSON.
+Spaces are defined for the run and destroyed afterwards, which needs the owner
+authorization tpm_managerd holds until ownership is fully handed over.
+)";
+
+enum Operation {
+  kStatus,
+  kListSpaces,
+  kSpaceInfo,
+  kRead,
+  kWrite,
+  kDefine,
+  kNumOperations,
+};
+
+constexpr const char* kOperationNames[kNumOperations] = {
+    "status", "list_spaces", "space_info", "read", "write", "define",
+};
+
+bool UsesSpaces(Operation operation) {
+  return operation != kStatus && operation != kListSpaces;
+}
+
+// Totals of the trunksd resource manager counters.
+struct TpmTotals {
+  uint64_t commands = 0;
+  uint64_t round_trips = 0;
+  uint64_t trunksd_us = 0;
+  uint64_t tpm_us = 0;
+};
+
+// The results of one phase: one operation, at one space size if it uses
+// spaces.
+struct PhaseResults {
+  std::string name;
+  std::vector<base::TimeDelta> latencies;
+  uint64_t failures = 0;
+  base::TimeDelta elapsed;
+  bool has_tpm_totals = false;
+  TpmTotals tpm_totals;
+};
+
+struct ClientState {
+  std::unique_ptr<TpmNvramInterface> nvram;
+  std::unique_ptr<TpmOwnershipInterface> ownership;
+  int remaining = 0;
+};
+
+bool IsSuccess(const GetTpmStatusReply& reply) {
+  return reply.status() == STATUS_SUCCESS;
+}
+
+template <typename ReplyProtobufType>
+bool IsSuccess(const ReplyProtobufType& reply) {
+  return reply.result() == NVRAM_RESULT_SUCCESS;
+}
+
+// Returns the |percentile| of sorted |latencies| in microseconds.
+int64_t GetPercentile(const std::vector<base::TimeDelta>& latencies,
+                      int percentile) {
+  if (latencies.empty()) {
+    return 0;
+  }
+  size_t index = std::min(latencies.size() - 1,
+                          latencies.size() * percentile / 100);
+  return latencies[index].InMicroseconds();
+}
+
+class BenchLoop : public brillo::Daemon {
+ public:
+  BenchLoop(int clients,
+            int iterations,
+            const std::vector<Operation>& operations,
+            const std::vector<uint32_t>& sizes,
+            bool json)
+      : num_clients_(clients),
+        iterations_(iterations),
+        operations_(operations),
+        sizes_(sizes),
+        json_(json) {}
+  ~BenchLoop() override = default;
+
+ protected:
+  int OnInit() override {
+    int exit_code = brillo::Daemon::OnInit();
+    if (exit_code != EX_OK) {
+      return exit_code;
+    }
+#if defined(USE_BINDER_IPC)
+    if (!binder_watcher_.Init()) {
+      LOG(ERROR) << "Error initializing binder watcher.";
+      return EX_UNAVAILABLE;
+    }
+#endif
+    for (int i = 0; i < num_clients_; ++i) {
+#if defined(USE_BINDER_IPC)
+      auto nvram = base::MakeUnique<TpmNvramBinderProxy>();
+      auto ownership = base::MakeUnique<TpmOwnershipBinderProxy>();
+#else
+      auto nvram = base::MakeUnique<TpmNvramDBusProxy>();
+      auto ownership = base::MakeUnique<TpmOwnershipDBusProxy>();
+#endif
+      if (!nvram->Initialize() || !ownership->Initialize()) {
+        LOG(ERROR) << "Error initializing tpm_manager proxies.";
+        return EX_UNAVAILABLE;
+      }
+      clients_.emplace_back();
+      clients_.back().nvram = std::move(nvram);
+      clients_.back().ownership = std::move(ownership);
+    }
+#if defined(TPM_MANAGER_BENCH_TRUNKS_STATS)
+    if (!trunks_proxy_.Init()) {
+      LOG(WARNING) << "No trunksd connection; TPM totals are unavailable.";
+    }
+#endif
+    // Spaces are defined first, one at a time.
+    if (std::any_of(operations_.begin(), operations_.end(), UsesSpaces)) {
+      for (int client = 0; client < num_clients_; ++client) {
+        for (size_t size = 0; size < sizes_.size(); ++size) {
+          pending_spaces_.push_back(std::make_pair(client, size));
+        }
+      }
+    }
+    base::MessageLoop::current()->task_runner()->PostTask(
+        FROM_HERE,
+        base::Bind(&BenchLoop::DefineNextSpace, base::Unretained(this)));
+    return EX_OK;
+  }
+
+  void OnShutdown(int* exit_code) override {
+    clients_.clear();
+    brillo::Daemon::OnShutdown(exit_code);
+  }
+
+ private:
+  uint32_t GetIndex(int client, size_t size) const {
+    return kIndexBase + client * kMaxSizesPerRun + size;
+  }
+
+  DefineSpaceRequest MakeDefineRequest(uint32_t index, uint32_t size) const {
+    DefineSpaceRequest request;
+    request.set_index(index);
+    request.set_size(size);
+    request.set_policy(NVRAM_POLICY_NONE);
+    return request;
+  }
+
+  void DefineNextSpace() {
+    if (pending_spaces_.empty()) {
+      StartNextPhase();
+      return;
+    }
+    int client = pending_spaces_.front().first;
+    size_t size = pending_spaces_.front().second;
+    uint32_t index = GetIndex(client, size);
+    defined_indexes_.push_back(index);
+    clients_[client].nvram->DefineSpace(
+        MakeDefineRequest(index, sizes_[size]),
+        base::Bind(&BenchLoop::OnSpaceDefined, base::Unretained(this)));
+  }
+
+  void OnSpaceDefined(const DefineSpaceReply& reply) {
+    pending_spaces_.erase(pending_spaces_.begin());
+    if (reply.result() != NVRAM_RESULT_SUCCESS) {
+      LOG(ERROR) << "Failed to define space " << defined_indexes_.back()
+                 << ": " << reply.result()
+                 << ". Is owner authorization available?";
+      defined_indexes_.pop_back();
+      failed_ = true;
+      DestroyNextSpace();
+      return;
+    }
+    DefineNextSpace();
+  }
+
+  void DestroyNextSpace() {
+    if (defined_indexes_.empty()) {
+      Finish();
+      return;
+    }
+    DestroySpaceRequest request;
+    request.set_index(defined_indexes_.back());
+    defined_indexes_.pop_back();
+    clients_[0].nvram->DestroySpace(
+        request,
+        base::Bind(&BenchLoop::OnSpaceDestroyed, base::Unretained(this),
+                   request.index()));
+  }
+
+  void OnSpaceDestroyed(uint32_t index, const DestroySpaceReply& reply) {
+    if (reply.result() != NVRAM_RESULT_SUCCESS) {
+      LOG(WARNING) << "Failed to destroy space " << index << ": "
+                   << reply.result();
+    }
+    DestroyNextSpace();
+  }
+
+  // Runs the phases in order: each operation, at each size if it uses spaces.
+  void StartNextPhase() {
+    if (next_operation_ == operations_.size()) {
+      DestroyNextSpace();
+      return;
+    }
+    current_operation_ = operations_[next_operation_];
+    current_size_ = next_size_;
+    if (!UsesSpaces(current_operation_) || ++next_size_ == sizes_.size()) {
+      next_size_ = 0;
+      ++next_operation_;
+    }
+    results_.emplace_back();
+    PhaseResults& phase = results_.back();
+    phase.name = kOperationNames[current_operation_];
+    if (UsesSpaces(current_operation_)) {
+      phase.name += base::StringPrintf("/%u", sizes_[current_size_]);
+    }
+    if (current_operation_ == kDefine) {
+      // Destroying is measured as a phase of its own.
+      results_.emplace_back();
+      results_.back().name =
+          base::StringPrintf("destroy/%u", sizes_[current_size_]);
+    }
+    phase_tpm_totals_ok_ = GetTpmTotals(&phase_start_tpm_totals_);
+    phase_start_ = base::TimeTicks::Now();
+    outstanding_clients_ = num_clients_;
+    for (int client = 0; client < num_clients_; ++client) {
+      clients_[client].remaining = iterations_;
+      IssueNext(client);
+    }
+  }
+
+  PhaseResults* current_phase() {
+    return &results_[results_.size() - (current_operation_ == kDefine ? 2 : 1)];
+  }
+
+  void IssueNext(int client) {
+    ClientState& state = clients_[client];
+    if (state.remaining == 0) {
+      if (--outstanding_clients_ == 0) {
+        FinishPhase();
+      }
+      return;
+    }
+    --state.remaining;
+    uint32_t index = GetIndex(client, current_size_);
+    base::TimeTicks start = base::TimeTicks::Now();
+    PhaseResults* phase = current_phase();
+    switch (current_operation_) {
+      case kStatus:
+        state.ownership->GetTpmStatus(
+            GetTpmStatusRequest(),
+            base::Bind(&BenchLoop::OnReply<GetTpmStatusReply>,
+                       base::Unretained(this), client, phase, start));
+        break;
+      case kListSpaces:
+        state.nvram->ListSpaces(
+            ListSpacesRequest(),
+            base::Bind(&BenchLoop::OnReply<ListSpacesReply>,
+                       base::Unretained(this), client, phase, start));
+        break;
+      case kSpaceInfo: {
+        GetSpaceInfoRequest request;
+        request.set_index(index);
+        state.nvram->GetSpaceInfo(
+            request, base::Bind(&BenchLoop::OnReply<GetSpaceInfoReply>,
+                                base::Unretained(this), client, phase, start));
+        break;
+      }
+      case kRead: {
+        ReadSpaceRequest request;
+        request.set_index(index);
+        state.nvram->ReadSpace(
+            request, base::Bind(&BenchLoop::OnReply<ReadSpaceReply>,
+                                base::Unretained(this), client, phase, start));
+        break;
+      }
+      case kWrite: {
+        WriteSpaceRequest request;
+        request.set_index(index);
+        request.set_data(std::string(sizes_[current_size_], 'b'));
+        state.nvram->WriteSpace(
+            request, base::Bind(&BenchLoop::OnReply<WriteSpaceReply>,
+                                base::Unretained(this), client, phase, start));
+        break;
+      }
+      case kDefine: {
+        uint32_t define_index = kIndexBase + client * kMaxSizesPerRun +
+                                kDefineIndexOffset;
+        state.nvram->DefineSpace(
+            MakeDefineRequest(define_index, sizes_[current_size_]),
+            base::Bind(&BenchLoop::OnDefined, base::Unretained(this), client,
+                       define_index, start));
+        break;
+      }
+      default:
+        NOTREACHED();
+    }
+  }
+
+  template <typename ReplyProtobufType>
+  void OnReply(int client,
+               PhaseResults* phase,
+               base::TimeTicks start,
+               const ReplyProtobufType& reply) {
+    if (IsSuccess(reply)) {
+      phase->latencies.push_back(base::TimeTicks::Now() - start);
+    } else {
+      ++phase->failures;
+    }
+    IssueNext(client);
+  }
+
+  void OnDefined(int client,
+                 uint32_t index,
+                 base::TimeTicks start,
+                 const DefineSpaceReply& reply) {
+    PhaseResults* define_phase = current_phase();
+    if (!IsSuccess(reply)) {
+      ++define_phase->failures;
+      IssueNext(client);
+      return;
+    }
+    define_phase->latencies.push_back(base::TimeTicks::Now() - start);
+    DestroySpaceRequest request;
+    request.set_index(index);
+    clients_[client].nvram->DestroySpace(
+        request, base::Bind(&BenchLoop::OnReply<DestroySpaceReply>,
+                            base::Unretained(this), client,
+                            &results_.back(), base::TimeTicks::Now()));
+  }
+
+  void FinishPhase() {
+    base::TimeDelta elapsed = base::TimeTicks::Now() - phase_start_;
+    TpmTotals end_totals;
+    bool has_tpm_totals = phase_tpm_totals_ok_ && GetTpmTotals(&end_totals);
+    // The TPM totals of a define phase cover the destroys too, so they are
+    // reported on the define row only.
+    PhaseResults* phase = current_phase();
+    for (size_t i = phase - results_.data(); i < results_.size(); ++i) {
+      std::sort(results_[i].latencies.begin(), results_[i].latencies.end());
+      results_[i].elapsed = elapsed;
+    }
+    if (has_tpm_totals) {
+      phase->has_tpm_totals = true;
+      phase->tpm_totals.commands =
+          end_totals.commands - phase_start_tpm_totals_.commands;
+      phase->tpm_totals.round_trips =
+          end_totals.round_trips - phase_start_tpm_totals_.round_trips;
+      phase->tpm_totals.trunksd_us =
+          end_totals.trunksd_us - phase_start_tpm_totals_.trunksd_us;
+      phase->tpm_totals.tpm_us =
+          end_totals.tpm_us - phase_start_tpm_totals_.tpm_us;
+    }
+    StartNextPhase();
+  }
+
+  // Reads the trunksd resource manager totals. Returns false if they are
+  // unavailable.
+  bool GetTpmTotals(TpmTotals* totals) {
+#if defined(TPM_MANAGER_BENCH_TRUNKS_STATS)
+    trunks::ResourceManagerStats stats;
+    if (!trunks_proxy_.GetResourceManagerStats(&stats, nullptr, nullptr)) {
+      return false;
+    }
+    *totals = TpmTotals();
+    for (const auto& command : stats.commands()) {
+      totals->commands += command.count();
+      totals->round_trips += command.tpm_round_trips();
+      totals->trunksd_us += command.total_latency().total_us() +
+                            command.queue_latency().total_us();
+      totals->tpm_us += command.tpm_latency().total_us();
+    }
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void Finish() {
+    if (!failed_) {
+      fputs(FormatResults().c_str(), stdout);
+    }
+    QuitWithExitCode(failed_ ? EX_SOFTWARE : EX_OK);
+  }
+
+  std::string FormatResults() const {
+    std::string output;
+    if (json_) {
+      base::StringAppendF(&output, "{\"clients\": %d, \"phases\": {",
+                          num_clients_);
+    } else {
+      base::StringAppendF(&output,
+                          "%-16s %6s %6s %9s %9s %9s %9s %8s %8s %9s %9s\n",
+                          "phase", "count", "failed", "ops/s", "p50_us",
+                          "p95_us", "p99_us", "cmds/op", "trips/op",
+                          "trunksd_us", "tpm_us");
+    }
+    bool first = true;
+    for (const PhaseResults& phase : results_) {
+      size_t count = phase.latencies.size();
+      double seconds = phase.elapsed.InSecondsF();
+      double ops_per_sec = seconds > 0 ? count / seconds : 0.0;
+      // Per-call averages; the trunksd time includes the TPM time.
+      uint64_t calls = count + phase.failures;
+      double commands = 0, round_trips = 0, trunksd_us = 0, tpm_us = 0;
+      if (phase.has_tpm_totals && calls) {
+        commands = static_cast<double>(phase.tpm_totals.commands) / calls;
+        round_trips =
+            static_cast<double>(phase.tpm_totals.round_trips) / calls;
+        trunksd_us = static_cast<double>(phase.tpm_totals.trunksd_us) / calls;
+        tpm_us = static_cast<double>(phase.tpm_totals.tpm_us) / calls;
+      }
+      if (json_) {
+        base::StringAppendF(
+            &output,
+            "%s\"%s\": {\"count\": %zu, \"failures\": %llu, "
+            "\"ops_per_sec\": %.2f, \"p50_us\": %lld, \"p95_us\": %lld, "
+            "\"p99_us\": %lld",
+            first ? "" : ", ", phase.name.c_str(), count,
+            static_cast<unsigned long long>(phase.failures), ops_per_sec,
+            static_cast<long long>(GetPercentile(phase.latencies, 50)),
+            static_cast<long long>(GetPercentile(phase.latencies, 95)),
+            static_cast<long long>(GetPercentile(phase.latencies, 99)));
+        if (phase.has_tpm_totals) {
+          base::StringAppendF(&output,
+                              ", \"tpm_commands_per_op\": %.2f, "
+                              "\"tpm_round_trips_per_op\": %.2f, "
+                              "\"trunksd_us_per_op\": %.0f, "
+                              "\"tpm_us_per_op\": %.0f",
+                              commands, round_trips, trunksd_us, tpm_us);
+        }
+        output += "}";
+      } else {
+        base::StringAppendF(
+            &output, "%-16s %6zu %6llu %9.2f %9lld %9lld %9lld",
+            phase.name.c_str(), count,
+            static_cast<unsigned long long>(phase.failures), ops_per_sec,
+            static_cast<long long>(GetPercentile(phase.latencies, 50)),
+            static_cast<long long>(GetPercentile(phase.latencies, 95)),
+            static_cast<long long>(GetPercentile(phase.latencies, 99)));
+        if (phase.has_tpm_totals) {
+          base::StringAppendF(&output, " %8.2f %8.2f %9.0f %9.0f\n", commands,
+                              round_trips, trunksd_us, tpm_us);
+        } else {
+          output += "\n";
+        }
+      }
+      first = false;
+    }
+    if (json_) {
+      output += "}}\n";
+    }
+    return output;
+  }
+
+  const int num_clients_;
+  const int iterations_;
+  const std::vector<Operation> operations_;
+  const std::vector<uint32_t> sizes_;
+  const bool json_;
+
+#if defined(USE_BINDER_IPC)
+  brillo::BinderWatcher binder_watcher_;
+#endif
+#if defined(TPM_MANAGER_BENCH_TRUNKS_STATS)
+  trunks::TrunksDBusProxy trunks_proxy_;
+#endif
+  std::vector<ClientState> clients_;
+  // (client, size position) pairs of the spaces still to be defined.
+  std::vector<std::pair<int, size_t>> pending_spaces_;
+  std::vector<uint32_t> defined_indexes_;
+  bool failed_ = false;
+
+  size_t next_operation_ = 0;
+  size_t next_size_ = 0;
+  Operation current_operation_ = kStatus;
+  size_t current_size_ = 0;
+  int outstanding_clients_ = 0;
+  base::TimeTicks phase_start_;
+  bool phase_tpm_totals_ok_ = false;
+  TpmTotals phase_start_tpm_totals_;
+  std::vector<PhaseResults> results_;
+
+  DISALLOW_COPY_AND_ASSIGN(BenchLoop);
+};
+
+bool ParseOperations(const std::string& value,
+                     std::vector<Operation>* operations) {
+  for (const std::string& name : base::SplitString(
+           value, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    const char* const* found = std::find(
+        kOperationNames, kOperationNames + kNumOperations, name);
+    if (found == kOperationNames + kNumOperations) {
+      LOG(ERROR) << "Unknown operation: " << name;
+      return false;
+    }
+    operations->push_back(static_cast<Operation>(found - kOperationNames));
+  }
+  return !operations->empty();
+}
+
+bool ParseSizes(const std::string& value, std::vector<uint32_t>* sizes) {
+  for (const std::string& size_string : base::SplitString(
+           value, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    uint32_t size = 0;
+    if (!base::StringToUint(size_string, &size) || size == 0) {
+      LOG(ERROR) << "Invalid size: " << size_string;
+      return false;
+    }
+    sizes->push_back(size);
+  }
+  return !sizes->empty() && sizes->size() < kMaxSizesPerRun;
+}
+
+}  // namespace
+}  // namespace tpm_manager
+
+int main(int argc, char* argv[]) {
+  base::CommandLine::Init(argc, argv);
+  brillo::InitLog(brillo::kLogToStderr);
+  base::CommandLine* cl = base::CommandLine::ForCurrentProcess();
+  int clients = tpm_manager::kDefaultClients;
+  int iterations = tpm_manager::kDefaultIterations;
+  std::vector<tpm_manager::Operation> operations;
+  std::vector<uint32_t> sizes;
+  std::string operations_value = tpm_manager::kDefaultOperations;
+  if (cl->HasSwitch("operations")) {
+    operations_value = cl->GetSwitchValueASCII("operations");
+  }
+  std::string sizes_value = tpm_manager::kDefaultSizes;
+  if (cl->HasSwitch("sizes")) {
+    sizes_value = cl->GetSwitchValueASCII("sizes");
+  }
+  if (cl->HasSwitch("help") ||
+      (cl->HasSwitch("clients") &&
+       !base::StringToInt(cl->GetSwitchValueASCII("clients"), &clients)) ||
+      clients < 1 ||
+      (cl->HasSwitch("iterations") &&
+       !base::StringToInt(cl->GetSwitchValueASCII("iterations"),
+                          &iterations)) ||
+      iterations < 1 ||
+      !tpm_manager::ParseOperations(operations_value, &operations) ||
+      !tpm_manager::ParseSizes(sizes_value, &sizes)) {
+    printf("%s", tpm_manager::kUsage);
+    return EX_USAGE;
+  }
+  tpm_manager::BenchLoop loop(clients, iterations, operations, sizes,
+                              cl->HasSwitch("json"));
+  return loop.Run();
+}
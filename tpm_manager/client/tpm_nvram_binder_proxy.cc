@@ -122,4 +122,37 @@ void TpmNvramBinderProxy::GetSpaceInfo(const GetSpaceInfoRequest& request,
   helper.SendRequest(request);
 }
 
+void TpmNvramBinderProxy::ReadSpaceBatch(
+    const ReadSpaceBatchRequest& request,
+    const ReadSpaceBatchCallback& callback) {
+  auto method =
+      base::Bind(&ITpmNvram::ReadSpaceBatch, base::Unretained(binder_));
+  auto get_error = base::Bind(&CreateErrorResponse<ReadSpaceBatchReply>);
+  BinderProxyHelper<ReadSpaceBatchRequest, ReadSpaceBatchReply> helper(
+      method, callback, get_error);
+  helper.SendRequest(request);
+}
+
+void TpmNvramBinderProxy::GetSpaceInfoBatch(
+    const GetSpaceInfoBatchRequest& request,
+    const GetSpaceInfoBatchCallback& callback) {
+  auto method =
+      base::Bind(&ITpmNvram::GetSpaceInfoBatch, base::Unretained(binder_));
+  auto get_error = base::Bind(&CreateErrorResponse<GetSpaceInfoBatchReply>);
+  BinderProxyHelper<GetSpaceInfoBatchRequest, GetSpaceInfoBatchReply> helper(
+      method, callback, get_error);
+  helper.SendRequest(request);
+}
+
+void TpmNvramBinderProxy::DefineSpaceBatch(
+    const DefineSpaceBatchRequest& request,
+    const DefineSpaceBatchCallback& callback) {
+  auto method =
+      base::Bind(&ITpmNvram::DefineSpaceBatch, base::Unretained(binder_));
+  auto get_error = base::Bind(&CreateErrorResponse<DefineSpaceBatchReply>);
+  BinderProxyHelper<DefineSpaceBatchRequest, DefineSpaceBatchReply> helper(
+      method, callback, get_error);
+  helper.SendRequest(request);
+}
+
 }  // namespace tpm_manager
@@ -52,6 +52,12 @@ class TPM_MANAGER_EXPORT TpmNvramBinderProxy : public TpmNvramInterface {
                   const ListSpacesCallback& callback) override;
   void GetSpaceInfo(const GetSpaceInfoRequest& request,
                     const GetSpaceInfoCallback& callback) override;
+  void ReadSpaceBatch(const ReadSpaceBatchRequest& request,
+                      const ReadSpaceBatchCallback& callback) override;
+  void GetSpaceInfoBatch(const GetSpaceInfoBatchRequest& request,
+                         const GetSpaceInfoBatchCallback& callback) override;
+  void DefineSpaceBatch(const DefineSpaceBatchRequest& request,
+                        const DefineSpaceBatchCallback& callback) override;
 
  private:
   android::sp<android::tpm_manager::ITpmNvram> default_binder_;
@@ -16,11 +16,15 @@
 
 #include "tpm_manager/client/tpm_nvram_dbus_proxy.h"
 
+#include <base/logging.h>
+#include <base/threading/thread_task_runner_handle.h>
 #include <brillo/bind_lambda.h>
 #include <brillo/dbus/dbus_method_invoker.h>
+#include <dbus/message.h>
 
 #include "tpm_manager/common/tpm_manager_constants.h"
 #include "tpm_manager/common/tpm_nvram_dbus_interface.h"
+#include "tpm_manager/common/tpm_ownership_dbus_interface.h"
 
 namespace {
 
@@ -31,6 +35,8 @@ const int kDBusTimeoutMS = 2 * 60 * 1000;
 
 namespace tpm_manager {
 
+TpmNvramDBusProxy::TpmNvramDBusProxy() : weak_factory_(this) {}
+
 TpmNvramDBusProxy::~TpmNvramDBusProxy() {
   if (bus_) {
     bus_->ShutdownAndBlock();
@@ -47,18 +53,34 @@ bool TpmNvramDBusProxy::Initialize() {
   return (object_proxy_ != nullptr);
 }
 
+void TpmNvramDBusProxy::EnableSpaceCache(base::TimeDelta max_age) {
+  space_cache_max_age_ = max_age;
+  // Clearing the TPM removes its spaces, and tpm_managerd reports that as a
+  // status change.
+  object_proxy_->ConnectToSignal(
+      tpm_manager::kTpmOwnershipInterface, tpm_manager::kTpmStatusChanged,
+      base::Bind(&TpmNvramDBusProxy::OnTpmStatusChanged,
+                 weak_factory_.GetWeakPtr()),
+      base::Bind(&TpmNvramDBusProxy::OnSignalConnected,
+                 weak_factory_.GetWeakPtr()));
+}
+
 void TpmNvramDBusProxy::DefineSpace(const DefineSpaceRequest& request,
                                     const DefineSpaceCallback& callback) {
+  InvalidateSpaceCache();
   CallMethod<DefineSpaceReply>(tpm_manager::kDefineSpace, request, callback);
 }
 
 void TpmNvramDBusProxy::DestroySpace(const DestroySpaceRequest& request,
                                      const DestroySpaceCallback& callback) {
+  InvalidateSpaceCache();
   CallMethod<DestroySpaceReply>(tpm_manager::kDestroySpace, request, callback);
 }
 
 void TpmNvramDBusProxy::WriteSpace(const WriteSpaceRequest& request,
                                    const WriteSpaceCallback& callback) {
+  // Writes can lock write-once spaces.
+  InvalidateSpaceCache();
   CallMethod<WriteSpaceReply>(tpm_manager::kWriteSpace, request, callback);
 }
 
@@ -69,17 +91,116 @@ void TpmNvramDBusProxy::ReadSpace(const ReadSpaceRequest& request,
 
 void TpmNvramDBusProxy::LockSpace(const LockSpaceRequest& request,
                                   const LockSpaceCallback& callback) {
+  InvalidateSpaceCache();
   CallMethod<LockSpaceReply>(tpm_manager::kLockSpace, request, callback);
 }
 
 void TpmNvramDBusProxy::ListSpaces(const ListSpacesRequest& request,
                                    const ListSpacesCallback& callback) {
-  CallMethod<ListSpacesReply>(tpm_manager::kListSpaces, request, callback);
+  if (space_cache_max_age_.is_zero()) {
+    CallMethod<ListSpacesReply>(tpm_manager::kListSpaces, request, callback);
+    return;
+  }
+  if (cached_list_spaces_ && IsFresh(cached_list_spaces_time_)) {
+    base::ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE, base::Bind(callback, *cached_list_spaces_));
+    return;
+  }
+  CallMethod<ListSpacesReply>(
+      tpm_manager::kListSpaces, request,
+      base::Bind(&TpmNvramDBusProxy::OnListSpacesReply,
+                 weak_factory_.GetWeakPtr(), space_cache_generation_,
+                 callback));
 }
 
 void TpmNvramDBusProxy::GetSpaceInfo(const GetSpaceInfoRequest& request,
                                      const GetSpaceInfoCallback& callback) {
-  CallMethod<GetSpaceInfoReply>(tpm_manager::kGetSpaceInfo, request, callback);
+  if (space_cache_max_age_.is_zero()) {
+    CallMethod<GetSpaceInfoReply>(tpm_manager::kGetSpaceInfo, request,
+                                  callback);
+    return;
+  }
+  auto iter = cached_space_info_.find(request.index());
+  if (iter != cached_space_info_.end() && IsFresh(iter->second.time)) {
+    base::ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE, base::Bind(callback, iter->second.reply));
+    return;
+  }
+  CallMethod<GetSpaceInfoReply>(
+      tpm_manager::kGetSpaceInfo, request,
+      base::Bind(&TpmNvramDBusProxy::OnGetSpaceInfoReply,
+                 weak_factory_.GetWeakPtr(), space_cache_generation_,
+                 request.index(), callback));
+}
+
+void TpmNvramDBusProxy::ReadSpaceBatch(const ReadSpaceBatchRequest& request,
+                                       const ReadSpaceBatchCallback& callback) {
+  CallMethod<ReadSpaceBatchReply>(tpm_manager::kReadSpaceBatch, request,
+                                  callback);
+}
+
+void TpmNvramDBusProxy::GetSpaceInfoBatch(
+    const GetSpaceInfoBatchRequest& request,
+    const GetSpaceInfoBatchCallback& callback) {
+  CallMethod<GetSpaceInfoBatchReply>(tpm_manager::kGetSpaceInfoBatch, request,
+                                     callback);
+}
+
+void TpmNvramDBusProxy::DefineSpaceBatch(
+    const DefineSpaceBatchRequest& request,
+    const DefineSpaceBatchCallback& callback) {
+  InvalidateSpaceCache();
+  CallMethod<DefineSpaceBatchReply>(tpm_manager::kDefineSpaceBatch, request,
+                                    callback);
+}
+
+void TpmNvramDBusProxy::InvalidateSpaceCache() {
+  cached_list_spaces_.reset();
+  cached_space_info_.clear();
+  space_cache_generation_++;
+}
+
+void TpmNvramDBusProxy::OnListSpacesReply(int generation,
+                                          const ListSpacesCallback& callback,
+                                          const ListSpacesReply& reply) {
+  if (generation == space_cache_generation_ &&
+      reply.result() == NVRAM_RESULT_SUCCESS) {
+    cached_list_spaces_.reset(new ListSpacesReply(reply));
+    cached_list_spaces_time_ = base::TimeTicks::Now();
+  }
+  callback.Run(reply);
+}
+
+void TpmNvramDBusProxy::OnGetSpaceInfoReply(
+    int generation,
+    uint32_t index,
+    const GetSpaceInfoCallback& callback,
+    const GetSpaceInfoReply& reply) {
+  if (generation == space_cache_generation_ &&
+      reply.result() == NVRAM_RESULT_SUCCESS) {
+    CachedSpaceInfo& entry = cached_space_info_[index];
+    entry.reply = reply;
+    entry.time = base::TimeTicks::Now();
+  }
+  callback.Run(reply);
+}
+
+void TpmNvramDBusProxy::OnTpmStatusChanged(dbus::Signal* signal) {
+  InvalidateSpaceCache();
+}
+
+void TpmNvramDBusProxy::OnSignalConnected(const std::string& interface_name,
+                                          const std::string& signal_name,
+                                          bool success) {
+  if (!success) {
+    // Without the signal only |space_cache_max_age_| bounds staleness.
+    LOG(WARNING) << __func__ << ": Failed to connect to " << interface_name
+                 << "." << signal_name;
+  }
+}
+
+bool TpmNvramDBusProxy::IsFresh(base::TimeTicks time) const {
+  return base::TimeTicks::Now() - time < space_cache_max_age_;
 }
 
 template <typename ReplyProtobufType,
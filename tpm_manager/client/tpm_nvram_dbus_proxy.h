@@ -19,10 +19,16 @@
 
 #include "tpm_manager/common/tpm_nvram_interface.h"
 
+#include <stdint.h>
+
+#include <map>
+#include <memory>
 #include <string>
 
 #include <base/macros.h>
 #include <base/memory/ref_counted.h>
+#include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
 #include <dbus/bus.h>
 #include <dbus/object_proxy.h>
 
@@ -37,7 +43,7 @@ namespace tpm_manager {
 // tpm_manager->DefineSpace(...);
 class TPM_MANAGER_EXPORT TpmNvramDBusProxy : public TpmNvramInterface {
  public:
-  TpmNvramDBusProxy() = default;
+  TpmNvramDBusProxy();
   virtual ~TpmNvramDBusProxy();
 
   // Performs initialization tasks. This method must be called before calling
@@ -59,12 +65,52 @@ class TPM_MANAGER_EXPORT TpmNvramDBusProxy : public TpmNvramInterface {
                   const ListSpacesCallback& callback) override;
   void GetSpaceInfo(const GetSpaceInfoRequest& request,
                     const GetSpaceInfoCallback& callback) override;
+  void ReadSpaceBatch(const ReadSpaceBatchRequest& request,
+                      const ReadSpaceBatchCallback& callback) override;
+  void GetSpaceInfoBatch(const GetSpaceInfoBatchRequest& request,
+                         const GetSpaceInfoBatchCallback& callback) override;
+  void DefineSpaceBatch(const DefineSpaceBatchRequest& request,
+                        const DefineSpaceBatchCallback& callback) override;
+
+  // Serves ListSpaces and GetSpaceInfo from their last successful replies
+  // while those are younger than |max_age|. Cached replies are dropped when
+  // tpm_managerd signals a TPM status change and when this proxy sends a
+  // request that modifies a space. Caching is off by default; call this after
+  // Initialize() or set_object_proxy().
+  void EnableSpaceCache(base::TimeDelta max_age);
 
   void set_object_proxy(dbus::ObjectProxy* object_proxy) {
     object_proxy_ = object_proxy;
   }
 
  private:
+  struct CachedSpaceInfo {
+    GetSpaceInfoReply reply;
+    base::TimeTicks time;
+  };
+
+  // Drops all cached replies and any replies still in flight for them.
+  void InvalidateSpaceCache();
+
+  // Keep a reply if the cache was not invalidated since the request
+  // identified by |generation| was sent, then forward it to |callback|.
+  void OnListSpacesReply(int generation,
+                         const ListSpacesCallback& callback,
+                         const ListSpacesReply& reply);
+  void OnGetSpaceInfoReply(int generation,
+                           uint32_t index,
+                           const GetSpaceInfoCallback& callback,
+                           const GetSpaceInfoReply& reply);
+
+  // Handlers for the kTpmStatusChanged signal.
+  void OnTpmStatusChanged(dbus::Signal* signal);
+  void OnSignalConnected(const std::string& interface_name,
+                         const std::string& signal_name,
+                         bool success);
+
+  // Returns true if a reply cached at |time| may still be served.
+  bool IsFresh(base::TimeTicks time) const;
+
   // Template method to call a given |method_name| remotely via dbus.
   template <typename ReplyProtobufType,
             typename RequestProtobufType,
@@ -75,6 +121,16 @@ class TPM_MANAGER_EXPORT TpmNvramDBusProxy : public TpmNvramInterface {
 
   scoped_refptr<dbus::Bus> bus_;
   dbus::ObjectProxy* object_proxy_;
+  // Space caching state. A zero |space_cache_max_age_| means caching is
+  // disabled. |space_cache_generation_| is bumped on every invalidation so
+  // that replies to requests sent before it are not cached.
+  base::TimeDelta space_cache_max_age_;
+  int space_cache_generation_ = 0;
+  std::unique_ptr<ListSpacesReply> cached_list_spaces_;
+  base::TimeTicks cached_list_spaces_time_;
+  std::map<uint32_t, CachedSpaceInfo> cached_space_info_;
+  // Declared last so weak pointers are invalidated first.
+  base::WeakPtrFactory<TpmNvramDBusProxy> weak_factory_;
   DISALLOW_COPY_AND_ASSIGN(TpmNvramDBusProxy);
 };
 
@@ -15,16 +15,22 @@
 //
 
 #include <string>
+#include <vector>
 
+#include <base/message_loop/message_loop.h>
+#include <base/run_loop.h>
 #include <brillo/bind_lambda.h>
 #include <dbus/mock_object_proxy.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include "tpm_manager/client/tpm_nvram_dbus_proxy.h"
+#include "tpm_manager/common/tpm_nvram_dbus_interface.h"
+#include "tpm_manager/common/tpm_ownership_dbus_interface.h"
 
 using testing::_;
 using testing::Invoke;
+using testing::SaveArg;
 using testing::StrictMock;
 using testing::WithArgs;
 
@@ -296,4 +302,129 @@ TEST_F(TpmNvramDBusProxyTest, GetSpaceInfo) {
   EXPECT_EQ(1, callback_count);
 }
 
+TEST_F(TpmNvramDBusProxyTest, GetSpaceInfoCached) {
+  base::MessageLoop message_loop;
+  EXPECT_CALL(*mock_object_proxy_,
+              ConnectToSignal(kTpmOwnershipInterface, kTpmStatusChanged, _, _));
+  proxy_.EnableSpaceCache(base::TimeDelta::FromMinutes(1));
+  int dbus_call_count = 0;
+  auto fake_dbus_call = [&dbus_call_count](
+      dbus::MethodCall* method_call,
+      const dbus::MockObjectProxy::ResponseCallback& response_callback) {
+    dbus_call_count++;
+    auto response = dbus::Response::CreateEmpty();
+    dbus::MessageWriter writer(response.get());
+    if (method_call->GetMember() == kGetSpaceInfo) {
+      dbus::MessageReader reader(method_call);
+      GetSpaceInfoRequest request;
+      EXPECT_TRUE(reader.PopArrayOfBytesAsProto(&request));
+      GetSpaceInfoReply reply;
+      reply.set_result(NVRAM_RESULT_SUCCESS);
+      reply.set_size(request.index() * 2);
+      writer.AppendProtoAsArrayOfBytes(reply);
+    } else {
+      LockSpaceReply reply;
+      reply.set_result(NVRAM_RESULT_SUCCESS);
+      writer.AppendProtoAsArrayOfBytes(reply);
+    }
+    response_callback.Run(response.release());
+  };
+  EXPECT_CALL(*mock_object_proxy_, CallMethodWithErrorCallback(_, _, _, _))
+      .WillRepeatedly(WithArgs<0, 2>(Invoke(fake_dbus_call)));
+  std::vector<uint32_t> sizes;
+  auto callback = [&sizes](const GetSpaceInfoReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+    sizes.push_back(reply.size());
+  };
+  GetSpaceInfoRequest request;
+  request.set_index(5);
+  proxy_.GetSpaceInfo(request, base::Bind(callback));
+  proxy_.GetSpaceInfo(request, base::Bind(callback));
+  base::RunLoop().RunUntilIdle();
+  request.set_index(6);
+  proxy_.GetSpaceInfo(request, base::Bind(callback));
+  EXPECT_EQ(2, dbus_call_count);
+  ASSERT_EQ(3u, sizes.size());
+  EXPECT_EQ(10u, sizes[0]);
+  EXPECT_EQ(10u, sizes[1]);
+  EXPECT_EQ(12u, sizes[2]);
+  // Locking a space through this proxy drops the cached replies.
+  LockSpaceRequest lock_request;
+  lock_request.set_index(6);
+  proxy_.LockSpace(lock_request,
+                   base::Bind([](const LockSpaceReply& reply) {}));
+  proxy_.GetSpaceInfo(request, base::Bind(callback));
+  EXPECT_EQ(4, dbus_call_count);
+  EXPECT_EQ(4u, sizes.size());
+}
+
+TEST_F(TpmNvramDBusProxyTest, ListSpacesCacheExpires) {
+  base::MessageLoop message_loop;
+  EXPECT_CALL(*mock_object_proxy_, ConnectToSignal(_, _, _, _));
+  // A negative age expires replies as soon as they are cached.
+  proxy_.EnableSpaceCache(base::TimeDelta::FromMicroseconds(-1));
+  auto fake_dbus_call = [](
+      dbus::MethodCall* method_call,
+      const dbus::MockObjectProxy::ResponseCallback& response_callback) {
+    auto response = dbus::Response::CreateEmpty();
+    dbus::MessageWriter writer(response.get());
+    ListSpacesReply reply;
+    reply.set_result(NVRAM_RESULT_SUCCESS);
+    writer.AppendProtoAsArrayOfBytes(reply);
+    response_callback.Run(response.release());
+  };
+  EXPECT_CALL(*mock_object_proxy_, CallMethodWithErrorCallback(_, _, _, _))
+      .Times(2)
+      .WillRepeatedly(WithArgs<0, 2>(Invoke(fake_dbus_call)));
+  int callback_count = 0;
+  auto callback = [&callback_count](const ListSpacesReply& reply) {
+    callback_count++;
+  };
+  ListSpacesRequest request;
+  proxy_.ListSpaces(request, base::Bind(callback));
+  proxy_.ListSpaces(request, base::Bind(callback));
+  EXPECT_EQ(2, callback_count);
+}
+
+TEST_F(TpmNvramDBusProxyTest, ReadSpaceBatch) {
+  uint32_t nvram_index = 5;
+  std::string nvram_data("nvram_data");
+  auto fake_dbus_call = [nvram_index, nvram_data](
+      dbus::MethodCall* method_call,
+      const dbus::MockObjectProxy::ResponseCallback& response_callback) {
+    // Verify request protobuf.
+    dbus::MessageReader reader(method_call);
+    ReadSpaceBatchRequest request;
+    EXPECT_TRUE(reader.PopArrayOfBytesAsProto(&request));
+    EXPECT_EQ(1, request.requests_size());
+    EXPECT_EQ(nvram_index, request.requests(0).index());
+    // Create reply protobuf.
+    auto response = dbus::Response::CreateEmpty();
+    dbus::MessageWriter writer(response.get());
+    ReadSpaceBatchReply reply;
+    reply.set_result(NVRAM_RESULT_SUCCESS);
+    ReadSpaceReply* space_reply = reply.add_replies();
+    space_reply->set_result(NVRAM_RESULT_SUCCESS);
+    space_reply->set_data(nvram_data);
+    writer.AppendProtoAsArrayOfBytes(reply);
+    response_callback.Run(response.release());
+  };
+  EXPECT_CALL(*mock_object_proxy_, CallMethodWithErrorCallback(_, _, _, _))
+      .WillOnce(WithArgs<0, 2>(Invoke(fake_dbus_call)));
+  // Set expectations on the outputs.
+  int callback_count = 0;
+  auto callback = [&callback_count,
+                   nvram_data](const ReadSpaceBatchReply& reply) {
+    callback_count++;
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+    ASSERT_EQ(1, reply.replies_size());
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.replies(0).result());
+    EXPECT_EQ(nvram_data, reply.replies(0).data());
+  };
+  ReadSpaceBatchRequest request;
+  request.add_requests()->set_index(nvram_index);
+  proxy_.ReadSpaceBatch(request, base::Bind(callback));
+  EXPECT_EQ(1, callback_count);
+}
+
 }  // namespace tpm_manager
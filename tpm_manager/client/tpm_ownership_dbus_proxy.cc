@@ -16,8 +16,11 @@
 
 #include "tpm_manager/client/tpm_ownership_dbus_proxy.h"
 
+#include <base/logging.h>
+#include <base/threading/thread_task_runner_handle.h>
 #include <brillo/bind_lambda.h>
 #include <brillo/dbus/dbus_method_invoker.h>
+#include <dbus/message.h>
 
 #include "tpm_manager/common/tpm_manager_constants.h"
 #include "tpm_manager/common/tpm_ownership_dbus_interface.h"
@@ -31,6 +34,8 @@ const int kDBusTimeoutMS = 2 * 60 * 1000;
 
 namespace tpm_manager {
 
+TpmOwnershipDBusProxy::TpmOwnershipDBusProxy() : weak_factory_(this) {}
+
 TpmOwnershipDBusProxy::~TpmOwnershipDBusProxy() {
   if (bus_) {
     bus_->ShutdownAndBlock();
@@ -47,14 +52,41 @@ bool TpmOwnershipDBusProxy::Initialize() {
   return (object_proxy_ != nullptr);
 }
 
+void TpmOwnershipDBusProxy::EnableStatusCache(base::TimeDelta max_age) {
+  status_cache_max_age_ = max_age;
+  object_proxy_->ConnectToSignal(
+      tpm_manager::kTpmOwnershipInterface, tpm_manager::kTpmStatusChanged,
+      base::Bind(&TpmOwnershipDBusProxy::OnTpmStatusChanged,
+                 weak_factory_.GetWeakPtr()),
+      base::Bind(&TpmOwnershipDBusProxy::OnSignalConnected,
+                 weak_factory_.GetWeakPtr()));
+}
+
 void TpmOwnershipDBusProxy::GetTpmStatus(const GetTpmStatusRequest& request,
                                          const GetTpmStatusCallback& callback) {
-  CallMethod<GetTpmStatusReply>(tpm_manager::kGetTpmStatus, request, callback);
+  if (status_cache_max_age_.is_zero()) {
+    CallMethod<GetTpmStatusReply>(tpm_manager::kGetTpmStatus, request,
+                                  callback);
+    return;
+  }
+  if (cached_tpm_status_ &&
+      base::TimeTicks::Now() - cached_tpm_status_time_ <
+          status_cache_max_age_) {
+    base::ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE, base::Bind(callback, *cached_tpm_status_));
+    return;
+  }
+  CallMethod<GetTpmStatusReply>(
+      tpm_manager::kGetTpmStatus, request,
+      base::Bind(&TpmOwnershipDBusProxy::OnGetTpmStatusReply,
+                 weak_factory_.GetWeakPtr(), status_cache_generation_,
+                 callback));
 }
 
 void TpmOwnershipDBusProxy::TakeOwnership(
     const TakeOwnershipRequest& request,
     const TakeOwnershipCallback& callback) {
+  InvalidateStatusCache();
   CallMethod<TakeOwnershipReply>(tpm_manager::kTakeOwnership, request,
                                  callback);
 }
@@ -62,10 +94,45 @@ void TpmOwnershipDBusProxy::TakeOwnership(
 void TpmOwnershipDBusProxy::RemoveOwnerDependency(
     const RemoveOwnerDependencyRequest& request,
     const RemoveOwnerDependencyCallback& callback) {
+  InvalidateStatusCache();
   CallMethod<RemoveOwnerDependencyReply>(tpm_manager::kRemoveOwnerDependency,
                                          request, callback);
 }
 
+void TpmOwnershipDBusProxy::InvalidateStatusCache() {
+  cached_tpm_status_.reset();
+  status_cache_generation_++;
+}
+
+void TpmOwnershipDBusProxy::OnGetTpmStatusReply(
+    int generation,
+    const GetTpmStatusCallback& callback,
+    const GetTpmStatusReply& reply) {
+  if (generation == status_cache_generation_ &&
+      reply.status() == STATUS_SUCCESS) {
+    cached_tpm_status_.reset(new GetTpmStatusReply(reply));
+    cached_tpm_status_time_ = base::TimeTicks::Now();
+  }
+  callback.Run(reply);
+}
+
+void TpmOwnershipDBusProxy::OnTpmStatusChanged(dbus::Signal* signal) {
+  // The signal carries a status without local data, so it can't replace the
+  // cached reply; the next GetTpmStatus fetches a fresh one.
+  InvalidateStatusCache();
+}
+
+void TpmOwnershipDBusProxy::OnSignalConnected(
+    const std::string& interface_name,
+    const std::string& signal_name,
+    bool success) {
+  if (!success) {
+    // Without the signal only |status_cache_max_age_| bounds staleness.
+    LOG(WARNING) << __func__ << ": Failed to connect to " << interface_name
+                 << "." << signal_name;
+  }
+}
+
 template <typename ReplyProtobufType,
           typename RequestProtobufType,
           typename CallbackType>
@@ -19,10 +19,13 @@
 
 #include "tpm_manager/common/tpm_ownership_interface.h"
 
+#include <memory>
 #include <string>
 
 #include <base/macros.h>
 #include <base/memory/ref_counted.h>
+#include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
 #include <dbus/bus.h>
 #include <dbus/object_proxy.h>
 
@@ -37,7 +40,7 @@ namespace tpm_manager {
 // tpm_->GetTpmStatus(...);
 class TPM_MANAGER_EXPORT TpmOwnershipDBusProxy : public TpmOwnershipInterface {
  public:
-  TpmOwnershipDBusProxy() = default;
+  TpmOwnershipDBusProxy();
   virtual ~TpmOwnershipDBusProxy();
 
   // Performs initialization tasks. This method must be called before calling
@@ -53,11 +56,33 @@ class TPM_MANAGER_EXPORT TpmOwnershipDBusProxy : public TpmOwnershipInterface {
       const RemoveOwnerDependencyRequest& request,
       const RemoveOwnerDependencyCallback& callback) override;
 
+  // Serves GetTpmStatus from the last successful reply while it is younger
+  // than |max_age|. The cached reply is dropped when tpm_managerd signals a
+  // status change and when this proxy sends TakeOwnership or
+  // RemoveOwnerDependency. Caching is off by default; call this after
+  // Initialize() or set_object_proxy().
+  void EnableStatusCache(base::TimeDelta max_age);
+
   void set_object_proxy(dbus::ObjectProxy* object_proxy) {
     object_proxy_ = object_proxy;
   }
 
  private:
+  // Drops the cached status and any reply still in flight for it.
+  void InvalidateStatusCache();
+
+  // Keeps |reply| if the cache was not invalidated since the request
+  // identified by |generation| was sent, then forwards it to |callback|.
+  void OnGetTpmStatusReply(int generation,
+                           const GetTpmStatusCallback& callback,
+                           const GetTpmStatusReply& reply);
+
+  // Handlers for the kTpmStatusChanged signal.
+  void OnTpmStatusChanged(dbus::Signal* signal);
+  void OnSignalConnected(const std::string& interface_name,
+                         const std::string& signal_name,
+                         bool success);
+
   // Template method to call a given |method_name| remotely via dbus.
   template <typename ReplyProtobufType,
             typename RequestProtobufType,
@@ -68,6 +93,15 @@ class TPM_MANAGER_EXPORT TpmOwnershipDBusProxy : public TpmOwnershipInterface {
 
   scoped_refptr<dbus::Bus> bus_;
   dbus::ObjectProxy* object_proxy_;
+  // Status caching state. A zero |status_cache_max_age_| means caching is
+  // disabled. |status_cache_generation_| is bumped on every invalidation so
+  // that replies to requests sent before it are not cached.
+  base::TimeDelta status_cache_max_age_;
+  int status_cache_generation_ = 0;
+  std::unique_ptr<GetTpmStatusReply> cached_tpm_status_;
+  base::TimeTicks cached_tpm_status_time_;
+  // Declared last so weak pointers are invalidated first.
+  base::WeakPtrFactory<TpmOwnershipDBusProxy> weak_factory_;
   DISALLOW_COPY_AND_ASSIGN(TpmOwnershipDBusProxy);
 };
 
@@ -16,15 +16,19 @@
 
 #include <string>
 
+#include <base/message_loop/message_loop.h>
+#include <base/run_loop.h>
 #include <brillo/bind_lambda.h>
 #include <dbus/mock_object_proxy.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include "tpm_manager/client/tpm_ownership_dbus_proxy.h"
+#include "tpm_manager/common/tpm_ownership_dbus_interface.h"
 
 using testing::_;
 using testing::Invoke;
+using testing::SaveArg;
 using testing::StrictMock;
 using testing::WithArgs;
 
@@ -86,6 +90,54 @@ TEST_F(TpmOwnershipDBusProxyTest, GetTpmStatus) {
   EXPECT_EQ(1, callback_count);
 }
 
+TEST_F(TpmOwnershipDBusProxyTest, GetTpmStatusCached) {
+  base::MessageLoop message_loop;
+  dbus::ObjectProxy::SignalCallback signal_callback;
+  EXPECT_CALL(*mock_object_proxy_,
+              ConnectToSignal(kTpmOwnershipInterface, kTpmStatusChanged, _, _))
+      .WillOnce(SaveArg<2>(&signal_callback));
+  proxy_.EnableStatusCache(base::TimeDelta::FromMinutes(1));
+  int dbus_call_count = 0;
+  auto fake_dbus_call = [&dbus_call_count](
+      dbus::MethodCall* method_call,
+      const dbus::MockObjectProxy::ResponseCallback& response_callback) {
+    dbus_call_count++;
+    auto response = dbus::Response::CreateEmpty();
+    dbus::MessageWriter writer(response.get());
+    GetTpmStatusReply reply;
+    reply.set_status(STATUS_SUCCESS);
+    reply.set_owned(true);
+    writer.AppendProtoAsArrayOfBytes(reply);
+    response_callback.Run(response.release());
+  };
+  EXPECT_CALL(*mock_object_proxy_, CallMethodWithErrorCallback(_, _, _, _))
+      .WillRepeatedly(WithArgs<0, 2>(Invoke(fake_dbus_call)));
+  int callback_count = 0;
+  auto callback = [&callback_count](const GetTpmStatusReply& reply) {
+    callback_count++;
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_TRUE(reply.owned());
+  };
+  GetTpmStatusRequest request;
+  proxy_.GetTpmStatus(request, base::Bind(callback));
+  proxy_.GetTpmStatus(request, base::Bind(callback));
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(2, callback_count);
+  EXPECT_EQ(1, dbus_call_count);
+  // A status change signal drops the cached reply.
+  dbus::Signal signal(kTpmOwnershipInterface, kTpmStatusChanged);
+  signal_callback.Run(&signal);
+  proxy_.GetTpmStatus(request, base::Bind(callback));
+  EXPECT_EQ(3, callback_count);
+  EXPECT_EQ(2, dbus_call_count);
+  // So does taking ownership through this proxy.
+  proxy_.TakeOwnership(TakeOwnershipRequest(),
+                       base::Bind([](const TakeOwnershipReply& reply) {}));
+  proxy_.GetTpmStatus(request, base::Bind(callback));
+  EXPECT_EQ(4, callback_count);
+  EXPECT_EQ(4, dbus_call_count);
+}
+
 TEST_F(TpmOwnershipDBusProxyTest, TakeOwnership) {
   auto fake_dbus_call = [](
       dbus::MethodCall* method_call,
@@ -49,6 +49,15 @@ class MockTpmNvramInterface : public TpmNvramInterface {
   MOCK_METHOD2(GetSpaceInfo,
                void(const GetSpaceInfoRequest& request,
                     const GetSpaceInfoCallback& callback));
+  MOCK_METHOD2(ReadSpaceBatch,
+               void(const ReadSpaceBatchRequest& request,
+                    const ReadSpaceBatchCallback& callback));
+  MOCK_METHOD2(GetSpaceInfoBatch,
+               void(const GetSpaceInfoBatchRequest& request,
+                    const GetSpaceInfoBatchCallback& callback));
+  MOCK_METHOD2(DefineSpaceBatch,
+               void(const DefineSpaceBatchRequest& request,
+                    const DefineSpaceBatchCallback& callback));
 };
 
 }  // namespace tpm_manager
@@ -6,10 +6,34 @@
 
 #include "tpm_manager/common/print_tpm_manager_proto.h"
 
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <sstream>
 #include <string>
 
-#include <base/strings/string_number_conversions.h>
-#include <base/strings/stringprintf.h>
+namespace {
+
+// Writes |value| in decimal and in hex, zero-padded to |hex_digits|.
+void WriteUnsigned(uint64_t value, int hex_digits, std::ostream* out) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%" PRIu64 " (0x%0*" PRIX64 ")", value,
+           hex_digits, value);
+  *out << buffer;
+}
+
+void WriteBytes(const std::string& value, bool elide_bytes, std::ostream* out) {
+  if (elide_bytes) {
+    *out << "<" << value.size() << " bytes>";
+    return;
+  }
+  const char kHexDigits[] = "0123456789ABCDEF";
+  for (unsigned char byte : value) {
+    *out << kHexDigits[byte >> 4] << kHexDigits[byte & 0xF];
+  }
+}
+
+}  // namespace
 
 namespace tpm_manager {
 
@@ -19,16 +43,28 @@ std::string GetProtoDebugString(TpmManagerStatus value) {
 
 std::string GetProtoDebugStringWithIndent(TpmManagerStatus value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(TpmManagerStatus value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   if (value == STATUS_SUCCESS) {
-    return "STATUS_SUCCESS";
+    *out << "STATUS_SUCCESS";
+    return;
   }
   if (value == STATUS_DEVICE_ERROR) {
-    return "STATUS_DEVICE_ERROR";
+    *out << "STATUS_DEVICE_ERROR";
+    return;
   }
   if (value == STATUS_NOT_AVAILABLE) {
-    return "STATUS_NOT_AVAILABLE";
+    *out << "STATUS_NOT_AVAILABLE";
+    return;
   }
-  return "<unknown>";
+  *out << "<unknown>";
 }
 
 std::string GetProtoDebugString(NvramResult value) {
@@ -36,34 +72,52 @@ std::string GetProtoDebugString(NvramResult value) {
 }
 
 std::string GetProtoDebugStringWithIndent(NvramResult value, int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(NvramResult value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   if (value == NVRAM_RESULT_SUCCESS) {
-    return "NVRAM_RESULT_SUCCESS";
+    *out << "NVRAM_RESULT_SUCCESS";
+    return;
   }
   if (value == NVRAM_RESULT_DEVICE_ERROR) {
-    return "NVRAM_RESULT_DEVICE_ERROR";
+    *out << "NVRAM_RESULT_DEVICE_ERROR";
+    return;
   }
   if (value == NVRAM_RESULT_ACCESS_DENIED) {
-    return "NVRAM_RESULT_ACCESS_DENIED";
+    *out << "NVRAM_RESULT_ACCESS_DENIED";
+    return;
   }
   if (value == NVRAM_RESULT_INVALID_PARAMETER) {
-    return "NVRAM_RESULT_INVALID_PARAMETER";
+    *out << "NVRAM_RESULT_INVALID_PARAMETER";
+    return;
   }
   if (value == NVRAM_RESULT_SPACE_DOES_NOT_EXIST) {
-    return "NVRAM_RESULT_SPACE_DOES_NOT_EXIST";
+    *out << "NVRAM_RESULT_SPACE_DOES_NOT_EXIST";
+    return;
   }
   if (value == NVRAM_RESULT_SPACE_ALREADY_EXISTS) {
-    return "NVRAM_RESULT_SPACE_ALREADY_EXISTS";
+    *out << "NVRAM_RESULT_SPACE_ALREADY_EXISTS";
+    return;
   }
   if (value == NVRAM_RESULT_OPERATION_DISABLED) {
-    return "NVRAM_RESULT_OPERATION_DISABLED";
+    *out << "NVRAM_RESULT_OPERATION_DISABLED";
+    return;
   }
   if (value == NVRAM_RESULT_INSUFFICIENT_SPACE) {
-    return "NVRAM_RESULT_INSUFFICIENT_SPACE";
+    *out << "NVRAM_RESULT_INSUFFICIENT_SPACE";
+    return;
   }
   if (value == NVRAM_RESULT_IPC_ERROR) {
-    return "NVRAM_RESULT_IPC_ERROR";
+    *out << "NVRAM_RESULT_IPC_ERROR";
+    return;
   }
-  return "<unknown>";
+  *out << "<unknown>";
 }
 
 std::string GetProtoDebugString(NvramSpaceAttribute value) {
@@ -72,37 +126,56 @@ std::string GetProtoDebugString(NvramSpaceAttribute value) {
 
 std::string GetProtoDebugStringWithIndent(NvramSpaceAttribute value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(NvramSpaceAttribute value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   if (value == NVRAM_PERSISTENT_WRITE_LOCK) {
-    return "NVRAM_PERSISTENT_WRITE_LOCK";
+    *out << "NVRAM_PERSISTENT_WRITE_LOCK";
+    return;
   }
   if (value == NVRAM_BOOT_WRITE_LOCK) {
-    return "NVRAM_BOOT_WRITE_LOCK";
+    *out << "NVRAM_BOOT_WRITE_LOCK";
+    return;
   }
   if (value == NVRAM_BOOT_READ_LOCK) {
-    return "NVRAM_BOOT_READ_LOCK";
+    *out << "NVRAM_BOOT_READ_LOCK";
+    return;
   }
   if (value == NVRAM_WRITE_AUTHORIZATION) {
-    return "NVRAM_WRITE_AUTHORIZATION";
+    *out << "NVRAM_WRITE_AUTHORIZATION";
+    return;
   }
   if (value == NVRAM_READ_AUTHORIZATION) {
-    return "NVRAM_READ_AUTHORIZATION";
+    *out << "NVRAM_READ_AUTHORIZATION";
+    return;
   }
   if (value == NVRAM_WRITE_EXTEND) {
-    return "NVRAM_WRITE_EXTEND";
+    *out << "NVRAM_WRITE_EXTEND";
+    return;
   }
   if (value == NVRAM_GLOBAL_LOCK) {
-    return "NVRAM_GLOBAL_LOCK";
+    *out << "NVRAM_GLOBAL_LOCK";
+    return;
   }
   if (value == NVRAM_PLATFORM_WRITE) {
-    return "NVRAM_PLATFORM_WRITE";
+    *out << "NVRAM_PLATFORM_WRITE";
+    return;
   }
   if (value == NVRAM_OWNER_WRITE) {
-    return "NVRAM_OWNER_WRITE";
+    *out << "NVRAM_OWNER_WRITE";
+    return;
   }
   if (value == NVRAM_OWNER_READ) {
-    return "NVRAM_OWNER_READ";
+    *out << "NVRAM_OWNER_READ";
+    return;
   }
-  return "<unknown>";
+  *out << "<unknown>";
 }
 
 std::string GetProtoDebugString(NvramSpacePolicy value) {
@@ -111,13 +184,24 @@ std::string GetProtoDebugString(NvramSpacePolicy value) {
 
 std::string GetProtoDebugStringWithIndent(NvramSpacePolicy value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(NvramSpacePolicy value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   if (value == NVRAM_POLICY_NONE) {
-    return "NVRAM_POLICY_NONE";
+    *out << "NVRAM_POLICY_NONE";
+    return;
   }
   if (value == NVRAM_POLICY_PCR0) {
-    return "NVRAM_POLICY_PCR0";
+    *out << "NVRAM_POLICY_PCR0";
+    return;
   }
-  return "<unknown>";
+  *out << "<unknown>";
 }
 
 std::string GetProtoDebugString(const NvramPolicyRecord& value) {
@@ -126,47 +210,47 @@ std::string GetProtoDebugString(const NvramPolicyRecord& value) {
 
 std::string GetProtoDebugStringWithIndent(const NvramPolicyRecord& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const NvramPolicyRecord& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_index()) {
-    output += indent + "  index: ";
-    base::StringAppendF(&output, "%u (0x%08X)", value.index(), value.index());
-    output += "\n";
+    *out << indent << "  index: ";
+    WriteUnsigned(value.index(), 8, out);
+    *out << "\n";
   }
   if (value.has_policy()) {
-    output += indent + "  policy: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.policy(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  policy: ";
+    WriteProtoDebugString(value.policy(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_world_read_allowed()) {
-    output += indent + "  world_read_allowed: ";
-    base::StringAppendF(&output, "%s",
-                        value.world_read_allowed() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  world_read_allowed: ";
+    *out << (value.world_read_allowed() ? "true" : "false");
+    *out << "\n";
   }
   if (value.has_world_write_allowed()) {
-    output += indent + "  world_write_allowed: ";
-    base::StringAppendF(&output, "%s",
-                        value.world_write_allowed() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  world_write_allowed: ";
+    *out << (value.world_write_allowed() ? "true" : "false");
+    *out << "\n";
   }
-  output += indent + "  policy_digests: {";
+  *out << indent << "  policy_digests: {";
   for (int i = 0; i < value.policy_digests_size(); ++i) {
     if (i > 0) {
-      base::StringAppendF(&output, ", ");
+      *out << ", ";
     }
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.policy_digests(i).data(),
-                                        value.policy_digests(i).size())
-                            .c_str());
+    WriteBytes(value.policy_digests(i), elide_bytes, out);
   }
-  output += "}\n";
-  output += indent + "}\n";
-  return output;
+  *out << "}\n";
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const LocalData& value) {
@@ -175,55 +259,51 @@ std::string GetProtoDebugString(const LocalData& value) {
 
 std::string GetProtoDebugStringWithIndent(const LocalData& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const LocalData& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_owner_password()) {
-    output += indent + "  owner_password: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.owner_password().data(),
-                                        value.owner_password().size())
-                            .c_str());
-    output += "\n";
-  }
-  output += indent + "  owner_dependency: {";
+    *out << indent << "  owner_password: ";
+    WriteBytes(value.owner_password(), elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "  owner_dependency: {";
   for (int i = 0; i < value.owner_dependency_size(); ++i) {
     if (i > 0) {
-      base::StringAppendF(&output, ", ");
+      *out << ", ";
     }
-    base::StringAppendF(&output, "%s", value.owner_dependency(i).c_str());
+    *out << value.owner_dependency(i);
   }
-  output += "}\n";
+  *out << "}\n";
   if (value.has_endorsement_password()) {
-    output += indent + "  endorsement_password: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.endorsement_password().data(),
-                                        value.endorsement_password().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  endorsement_password: ";
+    WriteBytes(value.endorsement_password(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_lockout_password()) {
-    output += indent + "  lockout_password: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.lockout_password().data(),
-                                        value.lockout_password().size())
-                            .c_str());
-    output += "\n";
-  }
-  output += indent + "  nvram_policy: {";
+    *out << indent << "  lockout_password: ";
+    WriteBytes(value.lockout_password(), elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "  nvram_policy: {";
   for (int i = 0; i < value.nvram_policy_size(); ++i) {
     if (i > 0) {
-      base::StringAppendF(&output, ", ");
+      *out << ", ";
     }
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.nvram_policy(i), indent_size + 2)
-            .c_str());
+    WriteProtoDebugString(value.nvram_policy(i), indent_size + 2, elide_bytes,
+                          out);
   }
-  output += "}\n";
-  output += indent + "}\n";
-  return output;
+  *out << "}\n";
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const DefineSpaceRequest& value) {
@@ -232,47 +312,48 @@ std::string GetProtoDebugString(const DefineSpaceRequest& value) {
 
 std::string GetProtoDebugStringWithIndent(const DefineSpaceRequest& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const DefineSpaceRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_index()) {
-    output += indent + "  index: ";
-    base::StringAppendF(&output, "%u (0x%08X)", value.index(), value.index());
-    output += "\n";
+    *out << indent << "  index: ";
+    WriteUnsigned(value.index(), 8, out);
+    *out << "\n";
   }
   if (value.has_size()) {
-    output += indent + "  size: ";
-    base::StringAppendF(&output, "%u (0x%08X)", value.size(), value.size());
-    output += "\n";
+    *out << indent << "  size: ";
+    WriteUnsigned(value.size(), 8, out);
+    *out << "\n";
   }
-  output += indent + "  attributes: {";
+  *out << indent << "  attributes: {";
   for (int i = 0; i < value.attributes_size(); ++i) {
     if (i > 0) {
-      base::StringAppendF(&output, ", ");
+      *out << ", ";
     }
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.attributes(i), indent_size + 2)
-                                           .c_str());
+    WriteProtoDebugString(value.attributes(i), indent_size + 2, elide_bytes,
+                          out);
   }
-  output += "}\n";
+  *out << "}\n";
   if (value.has_authorization_value()) {
-    output += indent + "  authorization_value: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.authorization_value().data(),
-                                        value.authorization_value().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  authorization_value: ";
+    WriteBytes(value.authorization_value(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_policy()) {
-    output += indent + "  policy: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.policy(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  policy: ";
+    WriteProtoDebugString(value.policy(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const DefineSpaceReply& value) {
@@ -281,19 +362,87 @@ std::string GetProtoDebugString(const DefineSpaceReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const DefineSpaceReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const DefineSpaceReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  if (value.has_result()) {
+    *out << indent << "  result: ";
+    WriteProtoDebugString(value.result(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const DefineSpaceBatchRequest& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const DefineSpaceBatchRequest& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const DefineSpaceBatchRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  *out << indent << "  requests: {";
+  for (int i = 0; i < value.requests_size(); ++i) {
+    if (i > 0) {
+      *out << ", ";
+    }
+    WriteProtoDebugString(value.requests(i), indent_size + 2, elide_bytes, out);
+  }
+  *out << "}\n";
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const DefineSpaceBatchReply& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const DefineSpaceBatchReply& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const DefineSpaceBatchReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_result()) {
-    output += indent + "  result: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.result(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  result: ";
+    WriteProtoDebugString(value.result(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "  replies: {";
+  for (int i = 0; i < value.replies_size(); ++i) {
+    if (i > 0) {
+      *out << ", ";
+    }
+    WriteProtoDebugString(value.replies(i), indent_size + 2, elide_bytes, out);
+  }
+  *out << "}\n";
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const DestroySpaceRequest& value) {
@@ -302,17 +451,24 @@ std::string GetProtoDebugString(const DestroySpaceRequest& value) {
 
 std::string GetProtoDebugStringWithIndent(const DestroySpaceRequest& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const DestroySpaceRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_index()) {
-    output += indent + "  index: ";
-    base::StringAppendF(&output, "%u (0x%08X)", value.index(), value.index());
-    output += "\n";
+    *out << indent << "  index: ";
+    WriteUnsigned(value.index(), 8, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const DestroySpaceReply& value) {
@@ -321,19 +477,24 @@ std::string GetProtoDebugString(const DestroySpaceReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const DestroySpaceReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const DestroySpaceReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_result()) {
-    output += indent + "  result: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.result(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  result: ";
+    WriteProtoDebugString(value.result(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const WriteSpaceRequest& value) {
@@ -342,38 +503,44 @@ std::string GetProtoDebugString(const WriteSpaceRequest& value) {
 
 std::string GetProtoDebugStringWithIndent(const WriteSpaceRequest& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const WriteSpaceRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_index()) {
-    output += indent + "  index: ";
-    base::StringAppendF(&output, "%u (0x%08X)", value.index(), value.index());
-    output += "\n";
+    *out << indent << "  index: ";
+    WriteUnsigned(value.index(), 8, out);
+    *out << "\n";
   }
   if (value.has_data()) {
-    output += indent + "  data: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.data().data(), value.data().size()).c_str());
-    output += "\n";
+    *out << indent << "  data: ";
+    WriteBytes(value.data(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_authorization_value()) {
-    output += indent + "  authorization_value: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.authorization_value().data(),
-                                        value.authorization_value().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  authorization_value: ";
+    WriteBytes(value.authorization_value(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_use_owner_authorization()) {
-    output += indent + "  use_owner_authorization: ";
-    base::StringAppendF(&output, "%s",
-                        value.use_owner_authorization() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  use_owner_authorization: ";
+    *out << (value.use_owner_authorization() ? "true" : "false");
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  if (value.has_offset()) {
+    *out << indent << "  offset: ";
+    WriteUnsigned(value.offset(), 8, out);
+    *out << "\n";
+  }
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const WriteSpaceReply& value) {
@@ -382,19 +549,24 @@ std::string GetProtoDebugString(const WriteSpaceReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const WriteSpaceReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const WriteSpaceReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_result()) {
-    output += indent + "  result: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.result(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  result: ";
+    WriteProtoDebugString(value.result(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const ReadSpaceRequest& value) {
@@ -403,31 +575,44 @@ std::string GetProtoDebugString(const ReadSpaceRequest& value) {
 
 std::string GetProtoDebugStringWithIndent(const ReadSpaceRequest& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const ReadSpaceRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_index()) {
-    output += indent + "  index: ";
-    base::StringAppendF(&output, "%u (0x%08X)", value.index(), value.index());
-    output += "\n";
+    *out << indent << "  index: ";
+    WriteUnsigned(value.index(), 8, out);
+    *out << "\n";
   }
   if (value.has_authorization_value()) {
-    output += indent + "  authorization_value: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.authorization_value().data(),
-                                        value.authorization_value().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  authorization_value: ";
+    WriteBytes(value.authorization_value(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_use_owner_authorization()) {
-    output += indent + "  use_owner_authorization: ";
-    base::StringAppendF(&output, "%s",
-                        value.use_owner_authorization() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  use_owner_authorization: ";
+    *out << (value.use_owner_authorization() ? "true" : "false");
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  if (value.has_offset()) {
+    *out << indent << "  offset: ";
+    WriteUnsigned(value.offset(), 8, out);
+    *out << "\n";
+  }
+  if (value.has_size()) {
+    *out << indent << "  size: ";
+    WriteUnsigned(value.size(), 8, out);
+    *out << "\n";
+  }
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const ReadSpaceReply& value) {
@@ -436,26 +621,92 @@ std::string GetProtoDebugString(const ReadSpaceReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const ReadSpaceReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const ReadSpaceReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_result()) {
-    output += indent + "  result: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.result(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  result: ";
+    WriteProtoDebugString(value.result(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_data()) {
-    output += indent + "  data: ";
-    base::StringAppendF(
-        &output, "%s",
-        base::HexEncode(value.data().data(), value.data().size()).c_str());
-    output += "\n";
+    *out << indent << "  data: ";
+    WriteBytes(value.data(), elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const ReadSpaceBatchRequest& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const ReadSpaceBatchRequest& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const ReadSpaceBatchRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  *out << indent << "  requests: {";
+  for (int i = 0; i < value.requests_size(); ++i) {
+    if (i > 0) {
+      *out << ", ";
+    }
+    WriteProtoDebugString(value.requests(i), indent_size + 2, elide_bytes, out);
+  }
+  *out << "}\n";
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const ReadSpaceBatchReply& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const ReadSpaceBatchReply& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const ReadSpaceBatchReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  if (value.has_result()) {
+    *out << indent << "  result: ";
+    WriteProtoDebugString(value.result(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "  replies: {";
+  for (int i = 0; i < value.replies_size(); ++i) {
+    if (i > 0) {
+      *out << ", ";
+    }
+    WriteProtoDebugString(value.replies(i), indent_size + 2, elide_bytes, out);
+  }
+  *out << "}\n";
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const LockSpaceRequest& value) {
@@ -464,41 +715,44 @@ std::string GetProtoDebugString(const LockSpaceRequest& value) {
 
 std::string GetProtoDebugStringWithIndent(const LockSpaceRequest& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const LockSpaceRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_index()) {
-    output += indent + "  index: ";
-    base::StringAppendF(&output, "%u (0x%08X)", value.index(), value.index());
-    output += "\n";
+    *out << indent << "  index: ";
+    WriteUnsigned(value.index(), 8, out);
+    *out << "\n";
   }
   if (value.has_lock_read()) {
-    output += indent + "  lock_read: ";
-    base::StringAppendF(&output, "%s", value.lock_read() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  lock_read: ";
+    *out << (value.lock_read() ? "true" : "false");
+    *out << "\n";
   }
   if (value.has_lock_write()) {
-    output += indent + "  lock_write: ";
-    base::StringAppendF(&output, "%s", value.lock_write() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  lock_write: ";
+    *out << (value.lock_write() ? "true" : "false");
+    *out << "\n";
   }
   if (value.has_authorization_value()) {
-    output += indent + "  authorization_value: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.authorization_value().data(),
-                                        value.authorization_value().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  authorization_value: ";
+    WriteBytes(value.authorization_value(), elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_use_owner_authorization()) {
-    output += indent + "  use_owner_authorization: ";
-    base::StringAppendF(&output, "%s",
-                        value.use_owner_authorization() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  use_owner_authorization: ";
+    *out << (value.use_owner_authorization() ? "true" : "false");
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const LockSpaceReply& value) {
@@ -507,19 +761,24 @@ std::string GetProtoDebugString(const LockSpaceReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const LockSpaceReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const LockSpaceReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_result()) {
-    output += indent + "  result: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.result(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  result: ";
+    WriteProtoDebugString(value.result(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const ListSpacesRequest& value) {
@@ -528,12 +787,19 @@ std::string GetProtoDebugString(const ListSpacesRequest& value) {
 
 std::string GetProtoDebugStringWithIndent(const ListSpacesRequest& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const ListSpacesRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const ListSpacesReply& value) {
@@ -542,28 +808,32 @@ std::string GetProtoDebugString(const ListSpacesReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const ListSpacesReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const ListSpacesReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_result()) {
-    output += indent + "  result: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.result(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  result: ";
+    WriteProtoDebugString(value.result(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "  index_list: {";
+  *out << indent << "  index_list: {";
   for (int i = 0; i < value.index_list_size(); ++i) {
     if (i > 0) {
-      base::StringAppendF(&output, ", ");
+      *out << ", ";
     }
-    base::StringAppendF(&output, "%u (0x%08X)", value.index_list(i),
-                        value.index_list(i));
+    WriteUnsigned(value.index_list(i), 8, out);
   }
-  output += "}\n";
-  output += indent + "}\n";
-  return output;
+  *out << "}\n";
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const GetSpaceInfoRequest& value) {
@@ -572,17 +842,24 @@ std::string GetProtoDebugString(const GetSpaceInfoRequest& value) {
 
 std::string GetProtoDebugStringWithIndent(const GetSpaceInfoRequest& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const GetSpaceInfoRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_index()) {
-    output += indent + "  index: ";
-    base::StringAppendF(&output, "%u (0x%08X)", value.index(), value.index());
-    output += "\n";
+    *out << indent << "  index: ";
+    WriteUnsigned(value.index(), 8, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const GetSpaceInfoReply& value) {
@@ -591,53 +868,116 @@ std::string GetProtoDebugString(const GetSpaceInfoReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const GetSpaceInfoReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const GetSpaceInfoReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_result()) {
-    output += indent + "  result: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.result(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  result: ";
+    WriteProtoDebugString(value.result(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_size()) {
-    output += indent + "  size: ";
-    base::StringAppendF(&output, "%u (0x%08X)", value.size(), value.size());
-    output += "\n";
+    *out << indent << "  size: ";
+    WriteUnsigned(value.size(), 8, out);
+    *out << "\n";
   }
   if (value.has_is_read_locked()) {
-    output += indent + "  is_read_locked: ";
-    base::StringAppendF(&output, "%s",
-                        value.is_read_locked() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  is_read_locked: ";
+    *out << (value.is_read_locked() ? "true" : "false");
+    *out << "\n";
   }
   if (value.has_is_write_locked()) {
-    output += indent + "  is_write_locked: ";
-    base::StringAppendF(&output, "%s",
-                        value.is_write_locked() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  is_write_locked: ";
+    *out << (value.is_write_locked() ? "true" : "false");
+    *out << "\n";
   }
-  output += indent + "  attributes: {";
+  *out << indent << "  attributes: {";
   for (int i = 0; i < value.attributes_size(); ++i) {
     if (i > 0) {
-      base::StringAppendF(&output, ", ");
+      *out << ", ";
     }
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.attributes(i), indent_size + 2)
-                                           .c_str());
+    WriteProtoDebugString(value.attributes(i), indent_size + 2, elide_bytes,
+                          out);
   }
-  output += "}\n";
+  *out << "}\n";
   if (value.has_policy()) {
-    output += indent + "  policy: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.policy(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  policy: ";
+    WriteProtoDebugString(value.policy(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const GetSpaceInfoBatchRequest& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const GetSpaceInfoBatchRequest& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const GetSpaceInfoBatchRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  *out << indent << "  index_list: {";
+  for (int i = 0; i < value.index_list_size(); ++i) {
+    if (i > 0) {
+      *out << ", ";
+    }
+    WriteUnsigned(value.index_list(i), 8, out);
+  }
+  *out << "}\n";
+  *out << indent << "}\n";
+}
+
+std::string GetProtoDebugString(const GetSpaceInfoBatchReply& value) {
+  return GetProtoDebugStringWithIndent(value, 0);
+}
+
+std::string GetProtoDebugStringWithIndent(const GetSpaceInfoBatchReply& value,
+                                          int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const GetSpaceInfoBatchReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
+  std::string indent(indent_size, ' ');
+  *out << "[" << value.GetTypeName() << "] {\n";
+
+  if (value.has_result()) {
+    *out << indent << "  result: ";
+    WriteProtoDebugString(value.result(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "  replies: {";
+  for (int i = 0; i < value.replies_size(); ++i) {
+    if (i > 0) {
+      *out << ", ";
+    }
+    WriteProtoDebugString(value.replies(i), indent_size + 2, elide_bytes, out);
   }
-  output += indent + "}\n";
-  return output;
+  *out << "}\n";
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const GetTpmStatusRequest& value) {
@@ -646,12 +986,19 @@ std::string GetProtoDebugString(const GetTpmStatusRequest& value) {
 
 std::string GetProtoDebugStringWithIndent(const GetTpmStatusRequest& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const GetTpmStatusRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const GetTpmStatusReply& value) {
@@ -660,64 +1007,60 @@ std::string GetProtoDebugString(const GetTpmStatusReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const GetTpmStatusReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const GetTpmStatusReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_status()) {
-    output += indent + "  status: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.status(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
   if (value.has_enabled()) {
-    output += indent + "  enabled: ";
-    base::StringAppendF(&output, "%s", value.enabled() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  enabled: ";
+    *out << (value.enabled() ? "true" : "false");
+    *out << "\n";
   }
   if (value.has_owned()) {
-    output += indent + "  owned: ";
-    base::StringAppendF(&output, "%s", value.owned() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  owned: ";
+    *out << (value.owned() ? "true" : "false");
+    *out << "\n";
   }
   if (value.has_local_data()) {
-    output += indent + "  local_data: ";
-    base::StringAppendF(&output, "%s", GetProtoDebugStringWithIndent(
-                                           value.local_data(), indent_size + 2)
-                                           .c_str());
-    output += "\n";
+    *out << indent << "  local_data: ";
+    WriteProtoDebugString(value.local_data(), indent_size + 2, elide_bytes,
+                          out);
+    *out << "\n";
   }
   if (value.has_dictionary_attack_counter()) {
-    output += indent + "  dictionary_attack_counter: ";
-    base::StringAppendF(&output, "%u (0x%08X)",
-                        value.dictionary_attack_counter(),
-                        value.dictionary_attack_counter());
-    output += "\n";
+    *out << indent << "  dictionary_attack_counter: ";
+    WriteUnsigned(value.dictionary_attack_counter(), 8, out);
+    *out << "\n";
   }
   if (value.has_dictionary_attack_threshold()) {
-    output += indent + "  dictionary_attack_threshold: ";
-    base::StringAppendF(&output, "%u (0x%08X)",
-                        value.dictionary_attack_threshold(),
-                        value.dictionary_attack_threshold());
-    output += "\n";
+    *out << indent << "  dictionary_attack_threshold: ";
+    WriteUnsigned(value.dictionary_attack_threshold(), 8, out);
+    *out << "\n";
   }
   if (value.has_dictionary_attack_lockout_in_effect()) {
-    output += indent + "  dictionary_attack_lockout_in_effect: ";
-    base::StringAppendF(
-        &output, "%s",
-        value.dictionary_attack_lockout_in_effect() ? "true" : "false");
-    output += "\n";
+    *out << indent << "  dictionary_attack_lockout_in_effect: ";
+    *out << (value.dictionary_attack_lockout_in_effect() ? "true" : "false");
+    *out << "\n";
   }
   if (value.has_dictionary_attack_lockout_seconds_remaining()) {
-    output += indent + "  dictionary_attack_lockout_seconds_remaining: ";
-    base::StringAppendF(&output, "%u (0x%08X)",
-                        value.dictionary_attack_lockout_seconds_remaining(),
-                        value.dictionary_attack_lockout_seconds_remaining());
-    output += "\n";
+    *out << indent << "  dictionary_attack_lockout_seconds_remaining: ";
+    WriteUnsigned(value.dictionary_attack_lockout_seconds_remaining(), 8, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const TakeOwnershipRequest& value) {
@@ -726,12 +1069,19 @@ std::string GetProtoDebugString(const TakeOwnershipRequest& value) {
 
 std::string GetProtoDebugStringWithIndent(const TakeOwnershipRequest& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const TakeOwnershipRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const TakeOwnershipReply& value) {
@@ -740,19 +1090,24 @@ std::string GetProtoDebugString(const TakeOwnershipReply& value) {
 
 std::string GetProtoDebugStringWithIndent(const TakeOwnershipReply& value,
                                           int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const TakeOwnershipReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_status()) {
-    output += indent + "  status: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.status(), indent_size + 2).c_str());
-    output += "\n";
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const RemoveOwnerDependencyRequest& value) {
@@ -762,20 +1117,24 @@ std::string GetProtoDebugString(const RemoveOwnerDependencyRequest& value) {
 std::string GetProtoDebugStringWithIndent(
     const RemoveOwnerDependencyRequest& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const RemoveOwnerDependencyRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_owner_dependency()) {
-    output += indent + "  owner_dependency: ";
-    base::StringAppendF(&output, "%s",
-                        base::HexEncode(value.owner_dependency().data(),
-                                        value.owner_dependency().size())
-                            .c_str());
-    output += "\n";
+    *out << indent << "  owner_dependency: ";
+    WriteBytes(value.owner_dependency(), elide_bytes, out);
+    *out << "\n";
   }
-  output += indent + "}\n";
-  return output;
+  *out << indent << "}\n";
 }
 
 std::string GetProtoDebugString(const RemoveOwnerDependencyReply& value) {
@@ -785,19 +1144,24 @@ std::string GetProtoDebugString(const RemoveOwnerDependencyReply& value) {
 std::string GetProtoDebugStringWithIndent(
     const RemoveOwnerDependencyReply& value,
     int indent_size) {
+  std::ostringstream out;
+  WriteProtoDebugString(value, indent_size, false, &out);
+  return out.str();
+}
+
+void WriteProtoDebugString(const RemoveOwnerDependencyReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out) {
   std::string indent(indent_size, ' ');
-  std::string output =
-      base::StringPrintf("[%s] {\n", value.GetTypeName().c_str());
+  *out << "[" << value.GetTypeName() << "] {\n";
 
   if (value.has_status()) {
-    output += indent + "  status: ";
-    base::StringAppendF(
-        &output, "%s",
-        GetProtoDebugStringWithIndent(value.status(), indent_size + 2).c_str());
-    output += "\n";
-  }
-  output += indent + "}\n";
-  return output;
+    *out << indent << "  status: ";
+    WriteProtoDebugString(value.status(), indent_size + 2, elide_bytes, out);
+    *out << "\n";
+  }
+  *out << indent << "}\n";
 }
 
 }  // namespace tpm_manager
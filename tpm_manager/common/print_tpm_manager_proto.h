@@ -7,91 +7,242 @@
 #ifndef TPM_MANAGER_COMMON_PRINT_TPM_MANAGER_PROTO_H_
 #define TPM_MANAGER_COMMON_PRINT_TPM_MANAGER_PROTO_H_
 
+#include <ostream>
 #include <string>
 
 #include "tpm_manager/common/tpm_manager.pb.h"
 
 namespace tpm_manager {
 
+// WriteProtoDebugString() writes the text returned by GetProtoDebugString() to
+// |out| without building intermediate strings. If |elide_bytes| is true, bytes
+// fields are written as their size instead of as hex.
+
 std::string GetProtoDebugStringWithIndent(TpmManagerStatus value,
                                           int indent_size);
 std::string GetProtoDebugString(TpmManagerStatus value);
+void WriteProtoDebugString(TpmManagerStatus value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(NvramResult value, int indent_size);
 std::string GetProtoDebugString(NvramResult value);
+void WriteProtoDebugString(NvramResult value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(NvramSpaceAttribute value,
                                           int indent_size);
 std::string GetProtoDebugString(NvramSpaceAttribute value);
+void WriteProtoDebugString(NvramSpaceAttribute value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(NvramSpacePolicy value,
                                           int indent_size);
 std::string GetProtoDebugString(NvramSpacePolicy value);
+void WriteProtoDebugString(NvramSpacePolicy value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const NvramPolicyRecord& value,
                                           int indent_size);
 std::string GetProtoDebugString(const NvramPolicyRecord& value);
+void WriteProtoDebugString(const NvramPolicyRecord& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const LocalData& value,
                                           int indent_size);
 std::string GetProtoDebugString(const LocalData& value);
+void WriteProtoDebugString(const LocalData& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const DefineSpaceRequest& value,
                                           int indent_size);
 std::string GetProtoDebugString(const DefineSpaceRequest& value);
+void WriteProtoDebugString(const DefineSpaceRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const DefineSpaceReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const DefineSpaceReply& value);
+void WriteProtoDebugString(const DefineSpaceReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const DefineSpaceBatchRequest& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const DefineSpaceBatchRequest& value);
+void WriteProtoDebugString(const DefineSpaceBatchRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const DefineSpaceBatchReply& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const DefineSpaceBatchReply& value);
+void WriteProtoDebugString(const DefineSpaceBatchReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const DestroySpaceRequest& value,
                                           int indent_size);
 std::string GetProtoDebugString(const DestroySpaceRequest& value);
+void WriteProtoDebugString(const DestroySpaceRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const DestroySpaceReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const DestroySpaceReply& value);
+void WriteProtoDebugString(const DestroySpaceReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const WriteSpaceRequest& value,
                                           int indent_size);
 std::string GetProtoDebugString(const WriteSpaceRequest& value);
+void WriteProtoDebugString(const WriteSpaceRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const WriteSpaceReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const WriteSpaceReply& value);
+void WriteProtoDebugString(const WriteSpaceReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const ReadSpaceRequest& value,
                                           int indent_size);
 std::string GetProtoDebugString(const ReadSpaceRequest& value);
+void WriteProtoDebugString(const ReadSpaceRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const ReadSpaceReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const ReadSpaceReply& value);
+void WriteProtoDebugString(const ReadSpaceReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const ReadSpaceBatchRequest& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const ReadSpaceBatchRequest& value);
+void WriteProtoDebugString(const ReadSpaceBatchRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const ReadSpaceBatchReply& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const ReadSpaceBatchReply& value);
+void WriteProtoDebugString(const ReadSpaceBatchReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const LockSpaceRequest& value,
                                           int indent_size);
 std::string GetProtoDebugString(const LockSpaceRequest& value);
+void WriteProtoDebugString(const LockSpaceRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const LockSpaceReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const LockSpaceReply& value);
+void WriteProtoDebugString(const LockSpaceReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const ListSpacesRequest& value,
                                           int indent_size);
 std::string GetProtoDebugString(const ListSpacesRequest& value);
+void WriteProtoDebugString(const ListSpacesRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const ListSpacesReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const ListSpacesReply& value);
+void WriteProtoDebugString(const ListSpacesReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const GetSpaceInfoRequest& value,
                                           int indent_size);
 std::string GetProtoDebugString(const GetSpaceInfoRequest& value);
+void WriteProtoDebugString(const GetSpaceInfoRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const GetSpaceInfoReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const GetSpaceInfoReply& value);
+void WriteProtoDebugString(const GetSpaceInfoReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const GetSpaceInfoBatchRequest& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const GetSpaceInfoBatchRequest& value);
+void WriteProtoDebugString(const GetSpaceInfoBatchRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
+std::string GetProtoDebugStringWithIndent(const GetSpaceInfoBatchReply& value,
+                                          int indent_size);
+std::string GetProtoDebugString(const GetSpaceInfoBatchReply& value);
+void WriteProtoDebugString(const GetSpaceInfoBatchReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const GetTpmStatusRequest& value,
                                           int indent_size);
 std::string GetProtoDebugString(const GetTpmStatusRequest& value);
+void WriteProtoDebugString(const GetTpmStatusRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const GetTpmStatusReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const GetTpmStatusReply& value);
+void WriteProtoDebugString(const GetTpmStatusReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const TakeOwnershipRequest& value,
                                           int indent_size);
 std::string GetProtoDebugString(const TakeOwnershipRequest& value);
+void WriteProtoDebugString(const TakeOwnershipRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(const TakeOwnershipReply& value,
                                           int indent_size);
 std::string GetProtoDebugString(const TakeOwnershipReply& value);
+void WriteProtoDebugString(const TakeOwnershipReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const RemoveOwnerDependencyRequest& value,
     int indent_size);
 std::string GetProtoDebugString(const RemoveOwnerDependencyRequest& value);
+void WriteProtoDebugString(const RemoveOwnerDependencyRequest& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 std::string GetProtoDebugStringWithIndent(
     const RemoveOwnerDependencyReply& value,
     int indent_size);
 std::string GetProtoDebugString(const RemoveOwnerDependencyReply& value);
+void WriteProtoDebugString(const RemoveOwnerDependencyReply& value,
+                           int indent_size,
+                           bool elide_bytes,
+                           std::ostream* out);
 
 }  // namespace tpm_manager
 
@@ -29,6 +29,9 @@ constexpr char kReadSpace[] = "ReadSpace";
 constexpr char kLockSpace[] = "LockSpace";
 constexpr char kListSpaces[] = "ListSpaces";
 constexpr char kGetSpaceInfo[] = "GetSpaceInfo";
+constexpr char kReadSpaceBatch[] = "ReadSpaceBatch";
+constexpr char kGetSpaceInfoBatch[] = "GetSpaceInfoBatch";
+constexpr char kDefineSpaceBatch[] = "DefineSpaceBatch";
 
 }  // namespace tpm_manager
 
@@ -65,6 +65,26 @@ class TPM_MANAGER_EXPORT TpmNvramInterface {
   using GetSpaceInfoCallback = base::Callback<void(const GetSpaceInfoReply&)>;
   virtual void GetSpaceInfo(const GetSpaceInfoRequest& request,
                             const GetSpaceInfoCallback& callback) = 0;
+
+  // Processes a ReadSpaceBatchRequest and responds with a ReadSpaceBatchReply.
+  using ReadSpaceBatchCallback =
+      base::Callback<void(const ReadSpaceBatchReply&)>;
+  virtual void ReadSpaceBatch(const ReadSpaceBatchRequest& request,
+                              const ReadSpaceBatchCallback& callback) = 0;
+
+  // Processes a GetSpaceInfoBatchRequest and responds with a
+  // GetSpaceInfoBatchReply.
+  using GetSpaceInfoBatchCallback =
+      base::Callback<void(const GetSpaceInfoBatchReply&)>;
+  virtual void GetSpaceInfoBatch(const GetSpaceInfoBatchRequest& request,
+                                 const GetSpaceInfoBatchCallback& callback) = 0;
+
+  // Processes a DefineSpaceBatchRequest and responds with a
+  // DefineSpaceBatchReply.
+  using DefineSpaceBatchCallback =
+      base::Callback<void(const DefineSpaceBatchReply&)>;
+  virtual void DefineSpaceBatch(const DefineSpaceBatchRequest& request,
+                                const DefineSpaceBatchCallback& callback) = 0;
 };
 
 }  // namespace tpm_manager
@@ -32,11 +32,10 @@ void ResponseHandler(
     const android::sp<android::tpm_manager::ITpmManagerClient>& client,
     const ResponseProtobufType& response_proto) {
   VLOG(2) << __func__;
-  std::vector<uint8_t> binder_response;
-  binder_response.resize(response_proto.ByteSize());
-  CHECK(response_proto.SerializeToArray(binder_response.data(),
-                                        binder_response.size()))
+  CHECK(response_proto.IsInitialized())
       << "BinderService: Failed to serialize protobuf.";
+  std::vector<uint8_t> binder_response(response_proto.ByteSize());
+  response_proto.SerializeWithCachedSizesToArray(binder_response.data());
   android::binder::Status status = client->OnCommandResponse(binder_response);
   if (!status.isOk()) {
     LOG(ERROR) << "BinderService: Failed to send response to client: "
@@ -199,6 +198,36 @@ android::binder::Status BinderService::NvramServiceInternal::GetSpaceInfo(
   return android::binder::Status::ok();
 }
 
+android::binder::Status BinderService::NvramServiceInternal::ReadSpaceBatch(
+    const std::vector<uint8_t>& command_proto,
+    const android::sp<android::tpm_manager::ITpmManagerClient>& client) {
+  RequestHandler<ReadSpaceBatchRequest, ReadSpaceBatchReply>(
+      command_proto, base::Bind(&TpmNvramInterface::ReadSpaceBatch,
+                                base::Unretained(nvram_service_)),
+      base::Bind(CreateNvramErrorResponse<ReadSpaceBatchReply>), client);
+  return android::binder::Status::ok();
+}
+
+android::binder::Status BinderService::NvramServiceInternal::GetSpaceInfoBatch(
+    const std::vector<uint8_t>& command_proto,
+    const android::sp<android::tpm_manager::ITpmManagerClient>& client) {
+  RequestHandler<GetSpaceInfoBatchRequest, GetSpaceInfoBatchReply>(
+      command_proto, base::Bind(&TpmNvramInterface::GetSpaceInfoBatch,
+                                base::Unretained(nvram_service_)),
+      base::Bind(CreateNvramErrorResponse<GetSpaceInfoBatchReply>), client);
+  return android::binder::Status::ok();
+}
+
+android::binder::Status BinderService::NvramServiceInternal::DefineSpaceBatch(
+    const std::vector<uint8_t>& command_proto,
+    const android::sp<android::tpm_manager::ITpmManagerClient>& client) {
+  RequestHandler<DefineSpaceBatchRequest, DefineSpaceBatchReply>(
+      command_proto, base::Bind(&TpmNvramInterface::DefineSpaceBatch,
+                                base::Unretained(nvram_service_)),
+      base::Bind(CreateNvramErrorResponse<DefineSpaceBatchReply>), client);
+  return android::binder::Status::ok();
+}
+
 BinderService::OwnershipServiceInternal::OwnershipServiceInternal(
     TpmOwnershipInterface* ownership_service)
     : ownership_service_(ownership_service) {}
@@ -83,6 +83,18 @@ class BinderService : public brillo::Daemon {
         const std::vector<uint8_t>& command_proto,
         const android::sp<android::tpm_manager::ITpmManagerClient>& client)
         override;
+    android::binder::Status ReadSpaceBatch(
+        const std::vector<uint8_t>& command_proto,
+        const android::sp<android::tpm_manager::ITpmManagerClient>& client)
+        override;
+    android::binder::Status GetSpaceInfoBatch(
+        const std::vector<uint8_t>& command_proto,
+        const android::sp<android::tpm_manager::ITpmManagerClient>& client)
+        override;
+    android::binder::Status DefineSpaceBatch(
+        const std::vector<uint8_t>& command_proto,
+        const android::sp<android::tpm_manager::ITpmManagerClient>& client)
+        override;
     android::binder::Status LockSpace(
         const std::vector<uint8_t>& command_proto,
         const android::sp<android::tpm_manager::ITpmManagerClient>& client)
@@ -15,6 +15,7 @@
 //
 
 #include <string>
+#include <vector>
 
 #include <brillo/bind_lambda.h>
 #include <gmock/gmock.h>
@@ -149,6 +150,36 @@ TEST_F(BinderServiceTest, RemoveOwnerDependency) {
   EXPECT_EQ(STATUS_SUCCESS, reply.status());
 }
 
+TEST_F(BinderServiceTest, PipelinedRequests) {
+  // Hold requests in the service and answer them in reverse order.
+  std::vector<base::Closure> pending;
+  EXPECT_CALL(mock_nvram_service_, GetSpaceInfo(_, _))
+      .Times(3)
+      .WillRepeatedly(Invoke([&pending](
+          const GetSpaceInfoRequest& request,
+          const TpmNvramInterface::GetSpaceInfoCallback& callback) {
+        GetSpaceInfoReply reply;
+        reply.set_result(NVRAM_RESULT_SUCCESS);
+        reply.set_size(request.index());
+        pending.push_back(base::Bind(callback, reply));
+      }));
+  GetSpaceInfoReply replies[3];
+  for (uint32_t i = 0; i < 3; ++i) {
+    GetSpaceInfoRequest request;
+    request.set_index(i + 1);
+    nvram_proxy_->GetSpaceInfo(request,
+                               GetCallback<GetSpaceInfoReply>(&replies[i]));
+  }
+  ASSERT_EQ(3u, pending.size());
+  for (auto iter = pending.rbegin(); iter != pending.rend(); ++iter) {
+    iter->Run();
+  }
+  for (uint32_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, replies[i].result());
+    EXPECT_EQ(i + 1, replies[i].size());
+  }
+}
+
 TEST_F(BinderServiceTest, DefineSpace) {
   uint32_t nvram_index = 5;
   size_t nvram_length = 32;
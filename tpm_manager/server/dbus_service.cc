@@ -78,6 +78,10 @@ void DBusService::RegisterDBusObjectsAsync(
           RemoveOwnerDependencyRequest, RemoveOwnerDependencyReply,
           &TpmOwnershipInterface::RemoveOwnerDependency>);
 
+  tpm_status_changed_signal_ =
+      ownership_dbus_interface->RegisterSignal<GetTpmStatusReply>(
+          kTpmStatusChanged);
+
   brillo::dbus_utils::DBusInterface* nvram_dbus_interface =
       dbus_object_->AddOrGetInterface(kTpmNvramInterface);
 
@@ -118,10 +122,35 @@ void DBusService::RegisterDBusObjectsAsync(
                                           GetSpaceInfoReply,
                                           &TpmNvramInterface::GetSpaceInfo>);
 
+  nvram_dbus_interface->AddMethodHandler(
+      kReadSpaceBatch, base::Unretained(this),
+      &DBusService::HandleNvramDBusMethod<ReadSpaceBatchRequest,
+                                          ReadSpaceBatchReply,
+                                          &TpmNvramInterface::ReadSpaceBatch>);
+
+  nvram_dbus_interface->AddMethodHandler(
+      kGetSpaceInfoBatch, base::Unretained(this),
+      &DBusService::HandleNvramDBusMethod<
+          GetSpaceInfoBatchRequest, GetSpaceInfoBatchReply,
+          &TpmNvramInterface::GetSpaceInfoBatch>);
+
+  nvram_dbus_interface->AddMethodHandler(
+      kDefineSpaceBatch, base::Unretained(this),
+      &DBusService::HandleNvramDBusMethod<
+          DefineSpaceBatchRequest, DefineSpaceBatchReply,
+          &TpmNvramInterface::DefineSpaceBatch>);
+
   dbus_object_->RegisterAsync(
       sequencer->GetHandler("Failed to register D-Bus object.", true));
 }
 
+void DBusService::SendTpmStatusChangedSignal(const GetTpmStatusReply& status) {
+  auto signal = tpm_status_changed_signal_.lock();
+  if (signal) {
+    signal->Send(status);
+  }
+}
+
 template <typename RequestProtobufType,
           typename ReplyProtobufType,
           DBusService::HandlerFunction<RequestProtobufType,
@@ -22,6 +22,7 @@
 #include <brillo/daemons/dbus_daemon.h>
 #include <brillo/dbus/dbus_method_response.h>
 #include <brillo/dbus/dbus_object.h>
+#include <brillo/dbus/dbus_signal.h>
 #include <dbus/bus.h>
 
 #include "tpm_manager/common/tpm_nvram_interface.h"
@@ -49,6 +50,10 @@ class DBusService : public brillo::DBusServiceDaemon {
   void RegisterDBusObjectsAsync(
       brillo::dbus_utils::AsyncEventSequencer* sequencer) override;
 
+  // Emits the TpmStatusChanged signal with |status|. Does nothing until the
+  // D-Bus objects are registered.
+  void SendTpmStatusChangedSignal(const GetTpmStatusReply& status);
+
  private:
   friend class DBusServiceTest;
 
@@ -81,6 +86,8 @@ class DBusService : public brillo::DBusServiceDaemon {
   std::unique_ptr<brillo::dbus_utils::DBusObject> dbus_object_;
   TpmNvramInterface* nvram_service_;
   TpmOwnershipInterface* ownership_service_;
+  std::weak_ptr<brillo::dbus_utils::DBusSignal<GetTpmStatusReply>>
+      tpm_status_changed_signal_;
   DISALLOW_COPY_AND_ASSIGN(DBusService);
 };
 
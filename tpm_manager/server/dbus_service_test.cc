@@ -103,6 +103,21 @@ TEST_F(DBusServiceTest, CopyableCallback) {
   ExecuteMethod(kGetTpmStatus, request, &reply, kTpmOwnershipInterface);
 }
 
+TEST_F(DBusServiceTest, TpmStatusChangedSignal) {
+  EXPECT_CALL(*mock_exported_object_, SendSignal(_))
+      .WillOnce(Invoke([](dbus::Signal* signal) {
+        EXPECT_EQ(kTpmOwnershipInterface, signal->GetInterface());
+        EXPECT_EQ(kTpmStatusChanged, signal->GetMember());
+        dbus::MessageReader reader(signal);
+        GetTpmStatusReply status;
+        EXPECT_TRUE(reader.PopArrayOfBytesAsProto(&status));
+        EXPECT_TRUE(status.owned());
+      }));
+  GetTpmStatusReply status;
+  status.set_owned(true);
+  dbus_service_->SendTpmStatusChangedSignal(status);
+}
+
 TEST_F(DBusServiceTest, GetTpmStatus) {
   GetTpmStatusRequest request;
   EXPECT_CALL(mock_ownership_service_, GetTpmStatus(_, _))
@@ -327,4 +342,51 @@ TEST_F(DBusServiceTest, GetSpaceInfo) {
   EXPECT_TRUE(reply.is_write_locked());
 }
 
+TEST_F(DBusServiceTest, GetSpaceInfoBatch) {
+  GetSpaceInfoBatchRequest request;
+  request.add_index_list(5);
+  request.add_index_list(6);
+  EXPECT_CALL(mock_nvram_service_, GetSpaceInfoBatch(_, _))
+      .WillOnce(Invoke([](
+          const GetSpaceInfoBatchRequest& request,
+          const TpmNvramInterface::GetSpaceInfoBatchCallback& callback) {
+        EXPECT_EQ(2, request.index_list_size());
+        GetSpaceInfoBatchReply reply;
+        reply.set_result(NVRAM_RESULT_SUCCESS);
+        reply.add_replies()->set_result(NVRAM_RESULT_SUCCESS);
+        reply.add_replies()->set_result(NVRAM_RESULT_SPACE_DOES_NOT_EXIST);
+        callback.Run(reply);
+      }));
+  GetSpaceInfoBatchReply reply;
+  ExecuteMethod(kGetSpaceInfoBatch, request, &reply, kTpmNvramInterface);
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+  ASSERT_EQ(2, reply.replies_size());
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.replies(0).result());
+  EXPECT_EQ(NVRAM_RESULT_SPACE_DOES_NOT_EXIST, reply.replies(1).result());
+}
+
+TEST_F(DBusServiceTest, DefineSpaceBatch) {
+  DefineSpaceBatchRequest request;
+  request.add_requests()->set_index(5);
+  request.add_requests()->set_index(6);
+  EXPECT_CALL(mock_nvram_service_, DefineSpaceBatch(_, _))
+      .WillOnce(Invoke([](
+          const DefineSpaceBatchRequest& request,
+          const TpmNvramInterface::DefineSpaceBatchCallback& callback) {
+        EXPECT_EQ(2, request.requests_size());
+        EXPECT_EQ(6, request.requests(1).index());
+        DefineSpaceBatchReply reply;
+        reply.set_result(NVRAM_RESULT_SUCCESS);
+        reply.add_replies()->set_result(NVRAM_RESULT_SUCCESS);
+        reply.add_replies()->set_result(NVRAM_RESULT_SPACE_ALREADY_EXISTS);
+        callback.Run(reply);
+      }));
+  DefineSpaceBatchReply reply;
+  ExecuteMethod(kDefineSpaceBatch, request, &reply, kTpmNvramInterface);
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+  ASSERT_EQ(2, reply.replies_size());
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.replies(0).result());
+  EXPECT_EQ(NVRAM_RESULT_SPACE_ALREADY_EXISTS, reply.replies(1).result());
+}
+
 }  // namespace tpm_manager
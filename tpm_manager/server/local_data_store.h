@@ -35,6 +35,15 @@ class LocalDataStore {
 
   // Writes local |data| to persistent storage. Returns true on success.
   virtual bool Write(const LocalData& data) = 0;
+
+  // Like Write(), but |data| may only reach persistent storage with the next
+  // Commit(), so that several writes share one. Read() returns |data|
+  // meanwhile. Returns true on success.
+  virtual bool WriteDeferred(const LocalData& data) { return Write(data); }
+
+  // Writes the data left by WriteDeferred() to persistent storage. Returns
+  // false if any of it was lost, in which case Read() returns what is stored.
+  virtual bool Commit() { return true; }
 };
 
 }  // namespace tpm_manager
@@ -35,8 +35,23 @@ const char kTpmLocalDataFile[] = "/var/lib/tpm_manager/local_tpm_data";
 #endif
 const mode_t kLocalDataPermissions = 0600;
 
+LocalDataStoreImpl::~LocalDataStoreImpl() {
+  Commit();
+}
+
 bool LocalDataStoreImpl::Read(LocalData* data) {
   CHECK(data);
+  if (!cached_) {
+    if (!ReadFromDisk(&cached_data_)) {
+      return false;
+    }
+    cached_ = true;
+  }
+  *data = cached_data_;
+  return true;
+}
+
+bool LocalDataStoreImpl::ReadFromDisk(LocalData* data) {
   FilePath path(kTpmLocalDataFile);
   if (!base::PathExists(path)) {
     data->Clear();
@@ -60,6 +75,42 @@ bool LocalDataStoreImpl::Read(LocalData* data) {
 }
 
 bool LocalDataStoreImpl::Write(const LocalData& data) {
+  // Whatever happens, the file may no longer match the cache.
+  cached_ = false;
+  // |data| was built on what Read() returned, so it includes any deferred
+  // writes.
+  bool had_uncommitted = uncommitted_;
+  uncommitted_ = false;
+  if (!WriteToDisk(data)) {
+    uncommitted_lost_ |= had_uncommitted;
+    return false;
+  }
+  cached_data_ = data;
+  cached_ = true;
+  return true;
+}
+
+bool LocalDataStoreImpl::WriteDeferred(const LocalData& data) {
+  cached_data_ = data;
+  cached_ = true;
+  uncommitted_ = true;
+  return true;
+}
+
+bool LocalDataStoreImpl::Commit() {
+  bool result = !uncommitted_lost_;
+  uncommitted_lost_ = false;
+  if (uncommitted_) {
+    uncommitted_ = false;
+    if (!WriteToDisk(cached_data_)) {
+      cached_ = false;
+      result = false;
+    }
+  }
+  return result;
+}
+
+bool LocalDataStoreImpl::WriteToDisk(const LocalData& data) {
   std::string file_data;
   if (!data.SerializeToString(&file_data)) {
     LOG(ERROR) << "Error serializing file to string.";
@@ -25,16 +25,39 @@
 
 namespace tpm_manager {
 
+// Keeps the local data in memory once it has been read or written, so reads
+// do no I/O. tpm_managerd is the only writer of the local data file. The file
+// is therefore parsed at most once per process, and Tpm2NvramImpl keeps the
+// policy records it needs indexed by NV index, so the file stays a plain
+// LocalData protobuf that other tools can read. WriteDeferred() only updates
+// the cache, and Commit() writes it out with a single fsync.
 class LocalDataStoreImpl : public LocalDataStore {
  public:
   LocalDataStoreImpl() = default;
-  ~LocalDataStoreImpl() override = default;
+  ~LocalDataStoreImpl() override;
 
   // LocalDataStore methods.
   bool Read(LocalData* data) override;
   bool Write(const LocalData& data) override;
+  bool WriteDeferred(const LocalData& data) override;
+  bool Commit() override;
 
  private:
+  // Reads and parses the local data file into |data|. Returns true on success.
+  bool ReadFromDisk(LocalData* data);
+
+  // Atomically replaces the local data file with |data|. Returns true on
+  // success.
+  bool WriteToDisk(const LocalData& data);
+
+  // The local data as last read or written, valid if |cached_|.
+  LocalData cached_data_;
+  bool cached_ = false;
+  // Whether |cached_data_| holds deferred writes that are not on disk yet, and
+  // whether deferred writes were lost since the last Commit().
+  bool uncommitted_ = false;
+  bool uncommitted_lost_ = false;
+
   DISALLOW_COPY_AND_ASSIGN(LocalDataStoreImpl);
 };
 
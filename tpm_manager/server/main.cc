@@ -16,9 +16,11 @@
 
 #include <string>
 
+#include <base/bind.h>
 #include <base/command_line.h>
 #include <brillo/syslog_logging.h>
 #if defined(USE_TPM2)
+#include <trunks/boot_trace.h>
 #include <trunks/trunks_factory_impl.h>
 #endif
 
@@ -45,6 +47,7 @@ namespace {
 
 constexpr char kWaitForOwnershipTriggerSwitch[] = "wait_for_ownership_trigger";
 constexpr char kLogToStderrSwitch[] = "log_to_stderr";
+constexpr char kBootTraceSwitch[] = "boot_trace";
 
 }  // namespace
 
@@ -59,15 +62,28 @@ int main(int argc, char* argv[]) {
 
   tpm_manager::LocalDataStoreImpl local_data_store;
 #if defined(USE_TPM2)
+  // Records the startup phases of tpm_managerd and the TPM commands they send
+  // until initialization is done. See trunks/boot_trace.h.
+  if (cl->HasSwitch(kBootTraceSwitch)) {
+    trunks::EnableBootTrace(true);
+  }
   trunks::TrunksFactoryImpl trunks_factory;
+  // Any other factory created in this process reuses the same connection.
+  trunks_factory.UseSharedConnection();
   // Tolerate some delay in trunksd being up and ready.
   constexpr int kTrunksDaemonTimeoutMS = 30000;  // 30 seconds
   int ms_waited = 0;
-  while (!trunks_factory.Initialize() && ms_waited < kTrunksDaemonTimeoutMS) {
-    usleep(300000);
-    ms_waited += 300;
+  {
+    trunks::ScopedBootTracePhase phase("WaitForTrunksd");
+    while (!trunks_factory.Initialize() &&
+           ms_waited < kTrunksDaemonTimeoutMS) {
+      usleep(300000);
+      ms_waited += 300;
+    }
   }
-  tpm_manager::Tpm2StatusImpl tpm_status(trunks_factory);
+  // Status is polled frequently; let bursts of queries share one refresh.
+  tpm_manager::Tpm2StatusImpl tpm_status(trunks_factory,
+                                         base::TimeDelta::FromSeconds(1));
   tpm_manager::Tpm2InitializerImpl tpm_initializer(
       trunks_factory, &local_data_store, &tpm_status);
   tpm_manager::Tpm2NvramImpl tpm_nvram(trunks_factory, &local_data_store);
@@ -87,6 +103,16 @@ int main(int argc, char* argv[]) {
 #else
   tpm_manager::DBusService ipc_service(&tpm_manager_service,
                                        &tpm_manager_service);
+  tpm_manager_service.SetTpmStatusChangedCallback(
+      base::Bind(&tpm_manager::DBusService::SendTpmStatusChangedSignal,
+                 base::Unretained(&ipc_service)));
+#endif
+#if defined(USE_TPM2)
+  if (trunks::IsBootTraceEnabled()) {
+    tpm_manager_service.SetInitializationDoneCallback(base::Bind(
+        base::IgnoreResult(&trunks::WriteBootTrace),
+        cl->GetSwitchValuePath(kBootTraceSwitch), std::string("tpm_managerd")));
+  }
 #endif
   CHECK(tpm_manager_service.Initialize()) << "Failed to initialize service.";
   LOG(INFO) << "Starting TPM Manager...";
@@ -30,6 +30,9 @@ MockLocalDataStore::MockLocalDataStore() {
       .WillByDefault(DoAll(SetArgPointee<0>(ByRef(fake_)), Return(true)));
   ON_CALL(*this, Write(_))
       .WillByDefault(DoAll(SaveArg<0>(&fake_), Return(true)));
+  ON_CALL(*this, WriteDeferred(_))
+      .WillByDefault(DoAll(SaveArg<0>(&fake_), Return(true)));
+  ON_CALL(*this, Commit()).WillByDefault(Return(true));
 }
 MockLocalDataStore::~MockLocalDataStore() {}
 
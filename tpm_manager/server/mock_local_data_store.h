@@ -30,6 +30,8 @@ class MockLocalDataStore : public LocalDataStore {
 
   MOCK_METHOD1(Read, bool(LocalData*));
   MOCK_METHOD1(Write, bool(const LocalData&));
+  MOCK_METHOD1(WriteDeferred, bool(const LocalData&));
+  MOCK_METHOD0(Commit, bool());
 
   const LocalData& GetFakeData() const { return fake_; }
   LocalData& GetMutableFakeData() { return fake_; }
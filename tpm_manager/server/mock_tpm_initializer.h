@@ -29,6 +29,7 @@ class MockTpmInitializer : public TpmInitializer {
   ~MockTpmInitializer() override;
 
   MOCK_METHOD0(InitializeTpm, bool());
+  MOCK_METHOD0(PreInitializeTpm, bool());
   MOCK_METHOD0(VerifiedBootHelper, void());
   MOCK_METHOD0(ResetDictionaryAttackLock, bool());
 };
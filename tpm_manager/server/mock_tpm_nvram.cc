@@ -16,6 +16,8 @@
 
 #include "tpm_manager/server/mock_tpm_nvram.h"
 
+#include <set>
+
 namespace tpm_manager {
 
 using testing::_;
@@ -25,11 +27,13 @@ using testing::Return;
 MockTpmNvram::MockTpmNvram() {
   ON_CALL(*this, DefineSpace(_, _, _, _, _))
       .WillByDefault(Invoke(this, &MockTpmNvram::FakeDefineSpace));
+  ON_CALL(*this, DefineSpaces(_, _))
+      .WillByDefault(Invoke(this, &MockTpmNvram::FakeDefineSpaces));
   ON_CALL(*this, DestroySpace(_))
       .WillByDefault(Invoke(this, &MockTpmNvram::FakeDestroySpace));
-  ON_CALL(*this, WriteSpace(_, _, _))
+  ON_CALL(*this, WriteSpace(_, _, _, _))
       .WillByDefault(Invoke(this, &MockTpmNvram::FakeWriteSpace));
-  ON_CALL(*this, ReadSpace(_, _, _))
+  ON_CALL(*this, ReadSpace(_, _, _, _, _))
       .WillByDefault(Invoke(this, &MockTpmNvram::FakeReadSpace));
   ON_CALL(*this, LockSpace(_, _, _, _))
       .WillByDefault(Invoke(this, &MockTpmNvram::FakeLockSpace));
@@ -64,6 +68,25 @@ NvramResult MockTpmNvram::FakeDefineSpace(
   return NVRAM_RESULT_SUCCESS;
 }
 
+NvramResult MockTpmNvram::FakeDefineSpaces(
+    const std::vector<NvramSpaceDefinition>& spaces,
+    std::vector<NvramResult>* results) {
+  std::set<uint32_t> indexes;
+  for (const NvramSpaceDefinition& space : spaces) {
+    if (space.size == 0 || !indexes.insert(space.index).second) {
+      return NVRAM_RESULT_INVALID_PARAMETER;
+    }
+  }
+  results->clear();
+  for (const NvramSpaceDefinition& space : spaces) {
+    results->push_back(FakeDefineSpace(space.index, space.size,
+                                       space.attributes,
+                                       space.authorization_value,
+                                       space.policy));
+  }
+  return NVRAM_RESULT_SUCCESS;
+}
+
 NvramResult MockTpmNvram::FakeDestroySpace(uint32_t index) {
   if (nvram_map_.count(index) == 0) {
     return NVRAM_RESULT_SPACE_DOES_NOT_EXIST;
@@ -74,6 +97,7 @@ NvramResult MockTpmNvram::FakeDestroySpace(uint32_t index) {
 
 NvramResult MockTpmNvram::FakeWriteSpace(
     uint32_t index,
+    uint32_t offset,
     const std::string& data,
     const std::string& authorization_value) {
   if (nvram_map_.count(index) == 0) {
@@ -87,16 +111,17 @@ NvramResult MockTpmNvram::FakeWriteSpace(
   }
   std::string& space_data = nvram_map_[index].data;
   size_t size = space_data.size();
-  if (data.size() > size) {
+  if (offset > size || data.size() > size - offset) {
     return NVRAM_RESULT_INVALID_PARAMETER;
   }
-  space_data = data;
-  space_data.resize(size);
+  space_data.replace(offset, data.size(), data);
   return NVRAM_RESULT_SUCCESS;
 }
 
 NvramResult MockTpmNvram::FakeReadSpace(
     uint32_t index,
+    uint32_t offset,
+    uint32_t size,
     std::string* data,
     const std::string& authorization_value) {
   if (nvram_map_.count(index) == 0) {
@@ -108,7 +133,11 @@ NvramResult MockTpmNvram::FakeReadSpace(
   if (nvram_map_[index].read_locked) {
     return NVRAM_RESULT_OPERATION_DISABLED;
   }
-  *data = nvram_map_[index].data;
+  const std::string& space_data = nvram_map_[index].data;
+  if (offset > space_data.size() || size > space_data.size() - offset) {
+    return NVRAM_RESULT_INVALID_PARAMETER;
+  }
+  *data = space_data.substr(offset, size ? size : std::string::npos);
   return NVRAM_RESULT_SUCCESS;
 }
 
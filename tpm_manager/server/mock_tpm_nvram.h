@@ -46,11 +46,21 @@ class MockTpmNvram : public TpmNvram {
                            const std::vector<NvramSpaceAttribute>&,
                            const std::string&,
                            NvramSpacePolicy));
+  MOCK_METHOD2(DefineSpaces,
+               NvramResult(const std::vector<NvramSpaceDefinition>&,
+                           std::vector<NvramResult>*));
   MOCK_METHOD1(DestroySpace, NvramResult(uint32_t));
-  MOCK_METHOD3(WriteSpace,
-               NvramResult(uint32_t, const std::string&, const std::string&));
-  MOCK_METHOD3(ReadSpace,
-               NvramResult(uint32_t, std::string*, const std::string&));
+  MOCK_METHOD4(WriteSpace,
+               NvramResult(uint32_t,
+                           uint32_t,
+                           const std::string&,
+                           const std::string&));
+  MOCK_METHOD5(ReadSpace,
+               NvramResult(uint32_t,
+                           uint32_t,
+                           uint32_t,
+                           std::string*,
+                           const std::string&));
   MOCK_METHOD4(LockSpace,
                NvramResult(uint32_t, bool, bool, const std::string&));
   MOCK_METHOD1(ListSpaces, NvramResult(std::vector<uint32_t>*));
@@ -69,11 +79,16 @@ class MockTpmNvram : public TpmNvram {
       const std::vector<NvramSpaceAttribute>& attributes,
       const std::string& authorization_value,
       NvramSpacePolicy policy);
+  NvramResult FakeDefineSpaces(const std::vector<NvramSpaceDefinition>& spaces,
+                               std::vector<NvramResult>* results);
   NvramResult FakeDestroySpace(uint32_t index);
   NvramResult FakeWriteSpace(uint32_t index,
+                             uint32_t offset,
                              const std::string& data,
                              const std::string& authorization_value);
   NvramResult FakeReadSpace(uint32_t index,
+                            uint32_t offset,
+                            uint32_t size,
                             std::string* data,
                             const std::string& authorization_value);
   NvramResult FakeLockSpace(uint32_t index,
@@ -16,9 +16,12 @@
 
 #include "tpm_manager/server/tpm2_initializer_impl.h"
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include <base/logging.h>
+#include <trunks/boot_trace.h>
 #include <trunks/error_codes.h>
 #include <trunks/tpm_utility.h>
 #include <trunks/trunks_factory_impl.h>
@@ -42,7 +45,8 @@ Tpm2InitializerImpl::Tpm2InitializerImpl(const trunks::TrunksFactory& factory,
     : trunks_factory_(factory),
       openssl_util_(new OpensslCryptoUtilImpl()),
       local_data_store_(local_data_store),
-      tpm_status_(tpm_status) {}
+      tpm_status_(tpm_status),
+      trunks_utility_(trunks_factory_.GetTpmUtility()) {}
 
 Tpm2InitializerImpl::Tpm2InitializerImpl(const trunks::TrunksFactory& factory,
                                          OpensslCryptoUtil* openssl_util,
@@ -51,9 +55,11 @@ Tpm2InitializerImpl::Tpm2InitializerImpl(const trunks::TrunksFactory& factory,
     : trunks_factory_(factory),
       openssl_util_(openssl_util),
       local_data_store_(local_data_store),
-      tpm_status_(tpm_status) {}
+      tpm_status_(tpm_status),
+      trunks_utility_(trunks_factory_.GetTpmUtility()) {}
 
 bool Tpm2InitializerImpl::InitializeTpm() {
+  trunks::ScopedBootTracePhase phase("Tpm2InitializerImpl::InitializeTpm");
   if (!SeedTpmRng()) {
     return false;
   }
@@ -79,18 +85,19 @@ bool Tpm2InitializerImpl::InitializeTpm() {
     endorsement_password.assign(local_data.endorsement_password());
     lockout_password.assign(local_data.lockout_password());
   } else {
-    if (!GetTpmRandomData(kDefaultPasswordSize, &owner_password)) {
-      LOG(ERROR) << "Error generating a random owner password.";
-      return false;
-    }
-    if (!GetTpmRandomData(kDefaultPasswordSize, &endorsement_password)) {
-      LOG(ERROR) << "Error generating a random endorsement password.";
-      return false;
-    }
-    if (!GetTpmRandomData(kDefaultPasswordSize, &lockout_password)) {
-      LOG(ERROR) << "Error generating a random lockout password.";
+    // All three passwords come from one request so the TPM can return them in
+    // as few GetRandom commands as it allows.
+    std::string random_data;
+    if (!GetTpmRandomData(3 * kDefaultPasswordSize, &random_data) ||
+        random_data.size() != 3 * kDefaultPasswordSize) {
+      LOG(ERROR) << "Error generating random passwords.";
       return false;
     }
+    owner_password.assign(random_data, 0, kDefaultPasswordSize);
+    endorsement_password.assign(random_data, kDefaultPasswordSize,
+                                kDefaultPasswordSize);
+    lockout_password.assign(random_data, 2 * kDefaultPasswordSize,
+                            kDefaultPasswordSize);
   }
   // We write the passwords to disk, in case there is an error while taking
   // ownership.
@@ -105,7 +112,7 @@ bool Tpm2InitializerImpl::InitializeTpm() {
     LOG(ERROR) << "Error saving local data.";
     return false;
   }
-  TPM_RC result = trunks_factory_.GetTpmUtility()->TakeOwnership(
+  TPM_RC result = trunks_utility_->TakeOwnership(
       owner_password, endorsement_password, lockout_password);
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << "Error taking ownership of TPM2.0";
@@ -115,23 +122,42 @@ bool Tpm2InitializerImpl::InitializeTpm() {
   return true;
 }
 
+bool Tpm2InitializerImpl::PreInitializeTpm() {
+  trunks::ScopedBootTracePhase phase("Tpm2InitializerImpl::PreInitializeTpm");
+  if (tpm_status_->IsTpmOwned()) {
+    VLOG(1) << "Tpm already owned.";
+    return true;
+  }
+  TPM_RC result = trunks_utility_->PrepareForOwnership();
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << "Error preparing TPM2.0 for ownership: "
+               << trunks::GetErrorString(result);
+    return false;
+  }
+  return true;
+}
+
 void Tpm2InitializerImpl::VerifiedBootHelper() {
+  trunks::ScopedBootTracePhase phase("Tpm2InitializerImpl::VerifiedBootHelper");
   constexpr char kVerifiedBootLateStageTag[] = "BOOT_PCR_LATE_STAGE";
-  std::unique_ptr<trunks::TpmUtility> tpm_utility =
-      trunks_factory_.GetTpmUtility();
   // Make sure PCRs 0-3 can't be spoofed from this point forward.
-  for (int pcr : {0, 1, 2, 3}) {
-    std::string value;
-    TPM_RC result = tpm_utility->ReadPCR(pcr, &value);
-    if (result) {
-      LOG(ERROR) << "Failed to read PCR " << pcr << ": "
-                 << trunks::GetErrorString(result);
-      continue;
-    }
-    if (value == std::string(32, 0)) {
+  const std::vector<int> kVerifiedBootPCRs = {0, 1, 2, 3};
+  std::map<trunks::TPM_ALG_ID, std::vector<std::string>> pcr_values;
+  TPM_RC result = trunks_utility_->ReadPCRs(
+      kVerifiedBootPCRs, {trunks::TPM_ALG_SHA256}, &pcr_values);
+  if (result) {
+    LOG(ERROR) << "Failed to read verified boot PCRs: "
+               << trunks::GetErrorString(result);
+    return;
+  }
+  const std::vector<std::string>& values = pcr_values[trunks::TPM_ALG_SHA256];
+  for (size_t i = 0; i < kVerifiedBootPCRs.size(); ++i) {
+    int pcr = kVerifiedBootPCRs[i];
+    if (values[i] == std::string(32, 0)) {
       LOG(WARNING) << "WARNING: Verified boot PCR " << pcr
                    << " is not initialized.";
-      result = tpm_utility->ExtendPCR(pcr, kVerifiedBootLateStageTag, nullptr);
+      result =
+          trunks_utility_->ExtendPCR(pcr, kVerifiedBootLateStageTag, nullptr);
       if (result) {
         LOG(ERROR) << "Failed to extend PCR " << pcr << ": "
                    << trunks::GetErrorString(result);
@@ -159,10 +185,7 @@ bool Tpm2InitializerImpl::ResetDictionaryAttackLock() {
     return false;
   }
   session->SetEntityAuthorizationValue(local_data.lockout_password());
-  std::unique_ptr<trunks::TpmUtility> tpm_utility =
-      trunks_factory_.GetTpmUtility();
-  result =
-      tpm_utility->ResetDictionaryAttackLock(session->GetDelegate());
+  result = trunks_utility_->ResetDictionaryAttackLock(session->GetDelegate());
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << __func__ << ": Error resetting lock: "
                << trunks::GetErrorString(result);
@@ -176,7 +199,7 @@ bool Tpm2InitializerImpl::SeedTpmRng() {
   if (!openssl_util_->GetRandomBytes(kDefaultPasswordSize, &random_bytes)) {
     return false;
   }
-  TPM_RC result = trunks_factory_.GetTpmUtility()->StirRandom(
+  TPM_RC result = trunks_utility_->StirRandom(
       random_bytes, nullptr /* No Authorization */);
   if (result != TPM_RC_SUCCESS) {
     return false;
@@ -186,7 +209,7 @@ bool Tpm2InitializerImpl::SeedTpmRng() {
 
 bool Tpm2InitializerImpl::GetTpmRandomData(size_t num_bytes,
                                            std::string* random_data) {
-  TPM_RC result = trunks_factory_.GetTpmUtility()->GenerateRandom(
+  TPM_RC result = trunks_utility_->GenerateRandom(
       num_bytes, nullptr /* No Authorization */, random_data);
   if (result != TPM_RC_SUCCESS) {
     return false;
@@ -23,6 +23,7 @@
 #include <memory>
 
 #include <base/macros.h>
+#include <trunks/tpm_utility.h>
 #include <trunks/trunks_factory.h>
 
 #include "tpm_manager/server/local_data_store.h"
@@ -55,6 +56,7 @@ class Tpm2InitializerImpl : public TpmInitializer {
 
   // TpmInitializer methods.
   bool InitializeTpm() override;
+  bool PreInitializeTpm() override;
   void VerifiedBootHelper() override;
   bool ResetDictionaryAttackLock() override;
 
@@ -71,6 +73,9 @@ class Tpm2InitializerImpl : public TpmInitializer {
   OpensslCryptoUtil* openssl_util_;
   LocalDataStore* local_data_store_;
   TpmStatus* tpm_status_;
+  // Kept for the lifetime of this class so that the names and public areas it
+  // caches are shared by all initialization steps, like Tpm2NvramImpl does.
+  std::unique_ptr<trunks::TpmUtility> trunks_utility_;
 
   DISALLOW_COPY_AND_ASSIGN(Tpm2InitializerImpl);
 };
@@ -16,7 +16,10 @@
 
 #include "tpm_manager/server/tpm2_initializer_impl.h"
 
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -55,6 +58,13 @@ class Tpm2InitializerTest : public testing::Test {
           fake_local_data_ = arg;
           return true;
         }));
+    ON_CALL(mock_tpm_utility_, GenerateRandom(_, _, _))
+        .WillByDefault(Invoke([](size_t num_bytes,
+                                 trunks::AuthorizationDelegate* delegate,
+                                 std::string* random_data) {
+          random_data->assign(num_bytes, 'r');
+          return trunks::TPM_RC_SUCCESS;
+        }));
     factory_.set_tpm_utility(&mock_tpm_utility_);
     tpm_initializer_.reset(new Tpm2InitializerImpl(
         factory_, &mock_openssl_util_, &mock_data_store_, &mock_tpm_status_));
@@ -105,18 +115,32 @@ TEST_F(Tpm2InitializerTest, InitializeTpmOwnershipError) {
 
 TEST_F(Tpm2InitializerTest, InitializeTpmSuccess) {
   EXPECT_CALL(mock_tpm_status_, IsTpmOwned()).WillOnce(Return(false));
-  std::string password = "hunter2";
-  EXPECT_CALL(mock_tpm_utility_, GenerateRandom(_, _, _))
-      .Times(3)  // Once for owner, endorsement and lockout passwords
-      .WillRepeatedly(
-          DoAll(SetArgPointee<2>(password), Return(trunks::TPM_RC_SUCCESS)));
-  EXPECT_CALL(mock_tpm_utility_, TakeOwnership(_, _, _))
+  std::string owner_password(20, 'o');
+  std::string endorsement_password(20, 'e');
+  std::string lockout_password(20, 'l');
+  // One request covers the owner, endorsement and lockout passwords.
+  EXPECT_CALL(mock_tpm_utility_, GenerateRandom(60, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(owner_password + endorsement_password +
+                                       lockout_password),
+                      Return(trunks::TPM_RC_SUCCESS)));
+  EXPECT_CALL(
+      mock_tpm_utility_,
+      TakeOwnership(owner_password, endorsement_password, lockout_password))
       .WillOnce(Return(trunks::TPM_RC_SUCCESS));
   EXPECT_TRUE(tpm_initializer_->InitializeTpm());
   EXPECT_LT(0, fake_local_data_.owner_dependency_size());
-  EXPECT_EQ(password, fake_local_data_.owner_password());
-  EXPECT_EQ(password, fake_local_data_.endorsement_password());
-  EXPECT_EQ(password, fake_local_data_.lockout_password());
+  EXPECT_EQ(owner_password, fake_local_data_.owner_password());
+  EXPECT_EQ(endorsement_password, fake_local_data_.endorsement_password());
+  EXPECT_EQ(lockout_password, fake_local_data_.lockout_password());
+}
+
+TEST_F(Tpm2InitializerTest, InitializeTpmShortRandomData) {
+  EXPECT_CALL(mock_tpm_status_, IsTpmOwned()).WillOnce(Return(false));
+  EXPECT_CALL(mock_tpm_utility_, GenerateRandom(_, _, _))
+      .WillOnce(
+          DoAll(SetArgPointee<2>("short"), Return(trunks::TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_utility_, TakeOwnership(_, _, _)).Times(0);
+  EXPECT_FALSE(tpm_initializer_->InitializeTpm());
 }
 
 TEST_F(Tpm2InitializerTest, InitializeTpmSuccessAfterError) {
@@ -139,11 +163,36 @@ TEST_F(Tpm2InitializerTest, InitializeTpmSuccessAfterError) {
   EXPECT_EQ(lockout_password, fake_local_data_.lockout_password());
 }
 
+TEST_F(Tpm2InitializerTest, PreInitializeTpmAlreadyOwned) {
+  EXPECT_CALL(mock_tpm_status_, IsTpmOwned()).WillRepeatedly(Return(true));
+  EXPECT_CALL(mock_tpm_utility_, PrepareForOwnership()).Times(0);
+  EXPECT_TRUE(tpm_initializer_->PreInitializeTpm());
+}
+
+TEST_F(Tpm2InitializerTest, PreInitializeTpmSuccess) {
+  EXPECT_CALL(mock_tpm_status_, IsTpmOwned()).WillRepeatedly(Return(false));
+  EXPECT_CALL(mock_tpm_utility_, PrepareForOwnership())
+      .WillOnce(Return(trunks::TPM_RC_SUCCESS));
+  // No passwords are generated or saved before taking ownership.
+  EXPECT_CALL(mock_tpm_utility_, GenerateRandom(_, _, _)).Times(0);
+  EXPECT_CALL(mock_data_store_, Write(_)).Times(0);
+  EXPECT_TRUE(tpm_initializer_->PreInitializeTpm());
+}
+
+TEST_F(Tpm2InitializerTest, PreInitializeTpmFailure) {
+  EXPECT_CALL(mock_tpm_status_, IsTpmOwned()).WillRepeatedly(Return(false));
+  EXPECT_CALL(mock_tpm_utility_, PrepareForOwnership())
+      .WillOnce(Return(trunks::TPM_RC_FAILURE));
+  EXPECT_FALSE(tpm_initializer_->PreInitializeTpm());
+}
+
 TEST_F(Tpm2InitializerTest, PCRSpoofGuard) {
   // Setup empty PCRs that need to be extended.
-  EXPECT_CALL(mock_tpm_utility_, ReadPCR(_, _))
-      .WillRepeatedly(DoAll(SetArgPointee<1>(std::string(32, 0)),
-                            Return(trunks::TPM_RC_SUCCESS)));
+  std::map<trunks::TPM_ALG_ID, std::vector<std::string>> pcr_values;
+  pcr_values[trunks::TPM_ALG_SHA256].assign(4, std::string(32, 0));
+  EXPECT_CALL(mock_tpm_utility_, ReadPCRs(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(pcr_values),
+                      Return(trunks::TPM_RC_SUCCESS)));
   // Expect at least four PCRs to be extended.
   EXPECT_CALL(mock_tpm_utility_, ExtendPCR(_, _, _))
       .Times(AtLeast(4))
@@ -152,15 +201,18 @@ TEST_F(Tpm2InitializerTest, PCRSpoofGuard) {
 }
 
 TEST_F(Tpm2InitializerTest, PCRSpoofGuardReadFailure) {
-  EXPECT_CALL(mock_tpm_utility_, ReadPCR(_, _))
+  EXPECT_CALL(mock_tpm_utility_, ReadPCRs(_, _, _))
       .WillRepeatedly(Return(trunks::TPM_RC_FAILURE));
+  EXPECT_CALL(mock_tpm_utility_, ExtendPCR(_, _, _)).Times(0);
   tpm_initializer_->VerifiedBootHelper();
 }
 
 TEST_F(Tpm2InitializerTest, PCRSpoofGuardExtendFailure) {
-  EXPECT_CALL(mock_tpm_utility_, ReadPCR(_, _))
-      .WillRepeatedly(DoAll(SetArgPointee<1>(std::string(32, 0)),
-                            Return(trunks::TPM_RC_SUCCESS)));
+  std::map<trunks::TPM_ALG_ID, std::vector<std::string>> pcr_values;
+  pcr_values[trunks::TPM_ALG_SHA256].assign(4, std::string(32, 0));
+  EXPECT_CALL(mock_tpm_utility_, ReadPCRs(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(pcr_values),
+                      Return(trunks::TPM_RC_SUCCESS)));
   EXPECT_CALL(mock_tpm_utility_, ExtendPCR(_, _, _))
       .WillRepeatedly(Return(trunks::TPM_RC_FAILURE));
   tpm_initializer_->VerifiedBootHelper();
@@ -16,13 +16,22 @@
 
 #include "tpm_manager/server/tpm2_nvram_impl.h"
 
+#include <algorithm>
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <base/logging.h>
+#include <base/stl_util.h>
+#include <openssl/crypto.h>
+#include <trunks/boot_trace.h>
 #include <trunks/error_codes.h>
+#include <trunks/interface.pb.h>
 #include <trunks/policy_session.h>
 #include <trunks/tpm_constants.h>
+#include <trunks/tpm_state.h>
 #include <trunks/tpm_utility.h>
 
 namespace tpm_manager {
@@ -114,6 +123,9 @@ NvramResult MapTpmError(TPM_RC tpm_error) {
     case trunks::TPM_RC_AUTH_FAIL:
     case trunks::TPM_RC_POLICY_FAIL:
       return NVRAM_RESULT_ACCESS_DENIED;
+    case trunks::TPM_RC_NV_RATE:
+      // trunksd has retried until its budget ran out.
+      return NVRAM_RESULT_DEVICE_ERROR;
     case trunks::TPM_RC_NV_SPACE:
       return NVRAM_RESULT_INSUFFICIENT_SPACE;
     case trunks::TPM_RC_NV_DEFINED:
@@ -124,6 +136,42 @@ NvramResult MapTpmError(TPM_RC tpm_error) {
   return NVRAM_RESULT_DEVICE_ERROR;
 }
 
+// Returns true if the space described by |nvram_public| and |policy_record|
+// has been written and may be read by anyone without a PCR policy, so its
+// contents can be read back before a write.
+bool CanReadWithoutAuthorization(const trunks::TPMS_NV_PUBLIC& nvram_public,
+                                 const NvramPolicyRecord& policy_record) {
+  return (nvram_public.attributes & trunks::TPMA_NV_POLICYREAD) != 0 &&
+         (nvram_public.attributes & trunks::TPMA_NV_WRITTEN) != 0 &&
+         (nvram_public.attributes & trunks::TPMA_NV_READLOCKED) == 0 &&
+         policy_record.world_read_allowed() &&
+         policy_record.policy() == NVRAM_POLICY_NONE;
+}
+
+// Splits a write of |data| over the |current| contents of the same range into
+// pieces of at most |max_chunk_size| bytes, trims the bytes each piece leaves
+// unchanged and returns the (offset, size) pairs in |data| left to write.
+std::vector<std::pair<size_t, size_t>> GetChangedRanges(
+    const std::string& current,
+    const std::string& data,
+    size_t max_chunk_size) {
+  std::vector<std::pair<size_t, size_t>> ranges;
+  for (size_t start = 0; start < data.size(); start += max_chunk_size) {
+    size_t begin = start;
+    size_t end = std::min(start + max_chunk_size, data.size());
+    while (begin < end && current[begin] == data[begin]) {
+      ++begin;
+    }
+    while (end > begin && current[end - 1] == data[end - 1]) {
+      --end;
+    }
+    if (begin < end) {
+      ranges.push_back(std::make_pair(begin, end - begin));
+    }
+  }
+  return ranges;
+}
+
 }  // namespace
 
 Tpm2NvramImpl::Tpm2NvramImpl(const trunks::TrunksFactory& factory,
@@ -132,6 +180,7 @@ Tpm2NvramImpl::Tpm2NvramImpl(const trunks::TrunksFactory& factory,
       local_data_store_(local_data_store),
       initialized_(false),
       trunks_session_(trunks_factory_.GetHmacSession()),
+      policy_session_(trunks_factory_.GetPolicySession()),
       trunks_utility_(trunks_factory_.GetTpmUtility()) {}
 
 NvramResult Tpm2NvramImpl::DefineSpace(
@@ -140,6 +189,8 @@ NvramResult Tpm2NvramImpl::DefineSpace(
     const std::vector<NvramSpaceAttribute>& attributes,
     const std::string& authorization_value,
     NvramSpacePolicy policy) {
+  space_contents_.erase(index);
+  space_list_loaded_ = false;
   if (!Initialize()) {
     return NVRAM_RESULT_DEVICE_ERROR;
   }
@@ -158,14 +209,23 @@ NvramResult Tpm2NvramImpl::DefineSpace(
   policy_record.set_policy(policy);
   policy_record.set_world_read_allowed(world_read_allowed);
   policy_record.set_world_write_allowed(world_write_allowed);
+  std::string pcr_value;
+  if (!ReadPolicyPCRValue(policy, &pcr_value)) {
+    return NVRAM_RESULT_DEVICE_ERROR;
+  }
   std::string policy_digest;
-  if (!ComputePolicyDigest(&policy_record, &policy_digest)) {
+  if (!ComputePolicyDigest(pcr_value, &policy_record, &policy_digest)) {
     LOG(ERROR) << "Failed to compute policy digest.";
     return NVRAM_RESULT_DEVICE_ERROR;
   }
   TPM_RC result = trunks_utility_->DefineNVSpace(
       index, size, attribute_flags, authorization_value, policy_digest,
       trunks_session_->GetDelegate());
+  if (trunks_session_->RestartIfInvalidated(result)) {
+    result = trunks_utility_->DefineNVSpace(
+        index, size, attribute_flags, authorization_value, policy_digest,
+        trunks_session_->GetDelegate());
+  }
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << "Error defining nvram space: " << GetErrorString(result);
     return MapTpmError(result);
@@ -177,7 +237,96 @@ NvramResult Tpm2NvramImpl::DefineSpace(
   return NVRAM_RESULT_SUCCESS;
 }
 
+NvramResult Tpm2NvramImpl::DefineSpaces(
+    const std::vector<NvramSpaceDefinition>& spaces,
+    std::vector<NvramResult>* results) {
+  results->clear();
+  if (spaces.empty()) {
+    return NVRAM_RESULT_SUCCESS;
+  }
+  space_list_loaded_ = false;
+  // Check every space and build its policy record before touching the TPM.
+  std::set<uint32_t> indexes;
+  std::vector<trunks::TPMA_NV> attribute_flags(spaces.size());
+  std::vector<NvramPolicyRecord> policy_records(spaces.size());
+  bool needs_pcr_value = false;
+  for (size_t i = 0; i < spaces.size(); ++i) {
+    const NvramSpaceDefinition& space = spaces[i];
+    if (!indexes.insert(space.index).second) {
+      LOG(ERROR) << "NVRAM index repeated in batch: " << space.index;
+      return NVRAM_RESULT_INVALID_PARAMETER;
+    }
+    bool world_read_allowed = false;
+    bool world_write_allowed = false;
+    if (!MapAttributesToTpm(space.attributes, &attribute_flags[i],
+                            &world_read_allowed, &world_write_allowed)) {
+      LOG(ERROR) << "Unsupported attributes for NVRAM space: " << space.index;
+      return NVRAM_RESULT_INVALID_PARAMETER;
+    }
+    policy_records[i].set_index(space.index);
+    policy_records[i].set_policy(space.policy);
+    policy_records[i].set_world_read_allowed(world_read_allowed);
+    policy_records[i].set_world_write_allowed(world_write_allowed);
+    needs_pcr_value |= (space.policy == NVRAM_POLICY_PCR0);
+  }
+  if (!Initialize()) {
+    return NVRAM_RESULT_DEVICE_ERROR;
+  }
+  if (!SetupOwnerSession()) {
+    return NVRAM_RESULT_OPERATION_DISABLED;
+  }
+  // A single PCR read serves every space in the batch.
+  std::string pcr_value;
+  if (needs_pcr_value && !ReadPolicyPCRValue(NVRAM_POLICY_PCR0, &pcr_value)) {
+    return NVRAM_RESULT_DEVICE_ERROR;
+  }
+  std::vector<std::string> policy_digests(spaces.size());
+  for (size_t i = 0; i < spaces.size(); ++i) {
+    if (!ComputePolicyDigest(pcr_value, &policy_records[i],
+                             &policy_digests[i])) {
+      LOG(ERROR) << "Failed to compute policy digest.";
+      return NVRAM_RESULT_DEVICE_ERROR;
+    }
+  }
+  results->assign(spaces.size(), NVRAM_RESULT_SUCCESS);
+  std::vector<NvramPolicyRecord> defined_records;
+  for (size_t i = 0; i < spaces.size(); ++i) {
+    const NvramSpaceDefinition& space = spaces[i];
+    space_contents_.erase(space.index);
+    TPM_RC result = trunks_utility_->DefineNVSpace(
+        space.index, space.size, attribute_flags[i], space.authorization_value,
+        policy_digests[i], trunks_session_->GetDelegate());
+    if (trunks_session_->RestartIfInvalidated(result)) {
+      result = trunks_utility_->DefineNVSpace(
+          space.index, space.size, attribute_flags[i],
+          space.authorization_value, policy_digests[i],
+          trunks_session_->GetDelegate());
+    }
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << "Error defining nvram space " << space.index << ": "
+                 << GetErrorString(result);
+      (*results)[i] = MapTpmError(result);
+      continue;
+    }
+    defined_records.push_back(policy_records[i]);
+  }
+  if (!defined_records.empty() && !SavePolicyRecords(defined_records)) {
+    // Without their policy records the new spaces would be unusable.
+    for (size_t i = 0; i < spaces.size(); ++i) {
+      if ((*results)[i] == NVRAM_RESULT_SUCCESS) {
+        trunks_utility_->DestroyNVSpace(spaces[i].index,
+                                        trunks_session_->GetDelegate());
+        (*results)[i] = NVRAM_RESULT_DEVICE_ERROR;
+      }
+    }
+    return NVRAM_RESULT_DEVICE_ERROR;
+  }
+  return NVRAM_RESULT_SUCCESS;
+}
+
 NvramResult Tpm2NvramImpl::DestroySpace(uint32_t index) {
+  space_contents_.erase(index);
+  space_list_loaded_ = false;
   if (!Initialize()) {
     return NVRAM_RESULT_DEVICE_ERROR;
   }
@@ -186,6 +335,10 @@ NvramResult Tpm2NvramImpl::DestroySpace(uint32_t index) {
   }
   TPM_RC result =
       trunks_utility_->DestroyNVSpace(index, trunks_session_->GetDelegate());
+  if (trunks_session_->RestartIfInvalidated(result)) {
+    result =
+        trunks_utility_->DestroyNVSpace(index, trunks_session_->GetDelegate());
+  }
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << "Error destroying nvram space:" << GetErrorString(result);
     return MapTpmError(result);
@@ -195,8 +348,10 @@ NvramResult Tpm2NvramImpl::DestroySpace(uint32_t index) {
 }
 
 NvramResult Tpm2NvramImpl::WriteSpace(uint32_t index,
+                                      uint32_t offset,
                                       const std::string& data,
                                       const std::string& authorization_value) {
+  space_contents_.erase(index);
   if (!Initialize()) {
     return NVRAM_RESULT_DEVICE_ERROR;
   }
@@ -210,26 +365,26 @@ NvramResult Tpm2NvramImpl::WriteSpace(uint32_t index,
   if (nvram_public.attributes & trunks::TPMA_NV_WRITELOCKED) {
     return NVRAM_RESULT_OPERATION_DISABLED;
   }
+  bool extend = (nvram_public.attributes & trunks::TPMA_NV_EXTEND) != 0;
+  if (extend && offset != 0) {
+    // An extend always covers the whole space.
+    return NVRAM_RESULT_INVALID_PARAMETER;
+  }
+  if (!extend && (offset > nvram_public.data_size ||
+                  data.size() > nvram_public.data_size - offset)) {
+    return NVRAM_RESULT_INVALID_PARAMETER;
+  }
   trunks::AuthorizationDelegate* authorization = nullptr;
-  std::unique_ptr<trunks::PolicySession> policy_session =
-      trunks_factory_.GetPolicySession();
+  NvramPolicyRecord policy_record;
+  bool use_policy_session = false;
   bool using_owner_authorization = false;
-  bool extend = (nvram_public.attributes & trunks::TPMA_NV_EXTEND) != 0;
   if (nvram_public.attributes & trunks::TPMA_NV_POLICYWRITE) {
-    NvramPolicyRecord policy_record;
     if (!GetPolicyRecord(index, &policy_record)) {
       LOG(ERROR) << "Policy record missing.";
       return NVRAM_RESULT_INVALID_PARAMETER;
     }
-    if (!SetupPolicySession(
-            policy_record, authorization_value,
-            extend ? trunks::TPM_CC_NV_Extend : trunks::TPM_CC_NV_Write,
-            policy_session.get())) {
-      // This will fail if policy is not met, e.g. a PCR value is not the
-      // required value.
-      return NVRAM_RESULT_ACCESS_DENIED;
-    }
-    authorization = policy_session->GetDelegate();
+    use_policy_session = true;
+    authorization = policy_session_->GetDelegate();
   } else if (nvram_public.attributes & trunks::TPMA_NV_AUTHWRITE) {
     trunks_session_->SetEntityAuthorizationValue(authorization_value);
     authorization = trunks_session_->GetDelegate();
@@ -244,19 +399,71 @@ NvramResult Tpm2NvramImpl::WriteSpace(uint32_t index,
     // TPMA_NV_PPWRITE: Platform authorization is long gone.
     return NVRAM_RESULT_OPERATION_DISABLED;
   }
-  result = trunks_utility_->WriteNVSpace(index, 0 /* offset */, data,
-                                         using_owner_authorization, extend,
-                                         authorization);
-  if (result != TPM_RC_SUCCESS) {
-    LOG(ERROR) << "Error writing to nvram space: " << GetErrorString(result);
-    return MapTpmError(result);
+  // Write in chunks the TPM accepts. An extend takes |data| as one input.
+  const size_t max_chunk_size = extend ? data.size() : GetNVBufferMax();
+  std::vector<std::pair<size_t, size_t>> ranges;
+  std::string current;
+  if (!extend && !data.empty() && use_policy_session &&
+      CanReadWithoutAuthorization(nvram_public, policy_record) &&
+      ReadSpace(index, offset, data.size(), &current, authorization_value) ==
+          NVRAM_RESULT_SUCCESS &&
+      current.size() == data.size()) {
+    // NV writes are slow, wear the NV and are rate limited by the TPM, so
+    // only the bytes that change are written.
+    ranges = GetChangedRanges(current, data, max_chunk_size);
+    if (ranges.empty() &&
+        !(policy_record.world_write_allowed() &&
+          policy_record.policy() == NVRAM_POLICY_NONE)) {
+      // Skipping the write would report success to a caller without the
+      // authorization to write, so the smallest write is sent to check it.
+      ranges.push_back(std::make_pair(0, 1));
+    }
+    if (ranges.empty()) {
+      VLOG(1) << "NVRAM space " << index << " already holds the data written.";
+    }
+  } else {
+    size_t start = 0;
+    do {
+      ranges.push_back(std::make_pair(
+          start, std::min(max_chunk_size, data.size() - start)));
+      start += max_chunk_size;
+    } while (start < data.size());
+  }
+  for (const auto& range : ranges) {
+    // Each command uses up the policy, so it is set up for every chunk.
+    if (use_policy_session &&
+        !SetupPolicySession(
+            policy_record, authorization_value,
+            extend ? trunks::TPM_CC_NV_Extend : trunks::TPM_CC_NV_Write)) {
+      // This will fail if policy is not met, e.g. a PCR value is not the
+      // required value.
+      return NVRAM_RESULT_ACCESS_DENIED;
+    }
+    result = trunks_utility_->WriteNVSpace(
+        index, offset + range.first, data.substr(range.first, range.second),
+        using_owner_authorization, extend, authorization);
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << "Error writing to nvram space: " << GetErrorString(result);
+      return MapTpmError(result);
+    }
   }
   return NVRAM_RESULT_SUCCESS;
 }
 
 NvramResult Tpm2NvramImpl::ReadSpace(uint32_t index,
+                                     uint32_t offset,
+                                     uint32_t size,
                                      std::string* data,
                                      const std::string& authorization_value) {
+  auto iter = space_contents_.find(index);
+  if (iter != space_contents_.end()) {
+    const std::string& contents = iter->second;
+    if (offset > contents.size() || size > contents.size() - offset) {
+      return NVRAM_RESULT_INVALID_PARAMETER;
+    }
+    *data = contents.substr(offset, size ? size : std::string::npos);
+    return NVRAM_RESULT_SUCCESS;
+  }
   if (!Initialize()) {
     return NVRAM_RESULT_DEVICE_ERROR;
   }
@@ -270,28 +477,35 @@ NvramResult Tpm2NvramImpl::ReadSpace(uint32_t index,
   if (nvram_public.attributes & trunks::TPMA_NV_READLOCKED) {
     return NVRAM_RESULT_OPERATION_DISABLED;
   }
+  if (offset > nvram_public.data_size ||
+      size > nvram_public.data_size - offset) {
+    return NVRAM_RESULT_INVALID_PARAMETER;
+  }
+  if (size == 0) {
+    size = nvram_public.data_size - offset;
+  }
   // Handle the case when the space has never been written to.
   if ((nvram_public.attributes & trunks::TPMA_NV_WRITTEN) == 0) {
-    *data = std::string(nvram_public.data_size, 0);
+    *data = std::string(size, 0);
     return NVRAM_RESULT_SUCCESS;
   }
   trunks::AuthorizationDelegate* authorization = nullptr;
-  std::unique_ptr<trunks::PolicySession> policy_session =
-      trunks_factory_.GetPolicySession();
+  NvramPolicyRecord policy_record;
+  bool use_policy_session = false;
   bool using_owner_authorization = false;
+  bool keep_contents = false;
   if (nvram_public.attributes & trunks::TPMA_NV_POLICYREAD) {
-    NvramPolicyRecord policy_record;
     if (!GetPolicyRecord(index, &policy_record)) {
       LOG(ERROR) << "Policy record missing.";
       return NVRAM_RESULT_INVALID_PARAMETER;
     }
-    if (!SetupPolicySession(policy_record, authorization_value,
-                            trunks::TPM_CC_NV_Read, policy_session.get())) {
-      // This will fail if policy is not met, e.g. a PCR value is not the
-      // required value.
-      return NVRAM_RESULT_ACCESS_DENIED;
-    }
-    authorization = policy_session->GetDelegate();
+    keep_contents =
+        (nvram_public.attributes & trunks::TPMA_NV_WRITELOCKED) != 0 &&
+        policy_record.world_read_allowed() &&
+        policy_record.policy() == NVRAM_POLICY_NONE &&
+        size == nvram_public.data_size;
+    use_policy_session = true;
+    authorization = policy_session_->GetDelegate();
   } else if (nvram_public.attributes & trunks::TPMA_NV_AUTHREAD) {
     trunks_session_->SetEntityAuthorizationValue(authorization_value);
     authorization = trunks_session_->GetDelegate();
@@ -306,12 +520,36 @@ NvramResult Tpm2NvramImpl::ReadSpace(uint32_t index,
     // TPMA_NV_PPREAD: Platform authorization is long gone.
     return NVRAM_RESULT_OPERATION_DISABLED;
   }
-  result = trunks_utility_->ReadNVSpace(
-      index, 0 /* offset */, nvram_public.data_size, using_owner_authorization,
-      data, authorization);
-  if (result != TPM_RC_SUCCESS) {
-    LOG(ERROR) << "Error reading nvram space: " << GetErrorString(result);
-    return MapTpmError(result);
+  // Read in chunks the TPM accepts, asking for no more than |size| bytes.
+  const size_t max_chunk_size = GetNVBufferMax();
+  data->clear();
+  while (data->size() < size) {
+    // Each command uses up the policy, so it is set up for every chunk.
+    if (use_policy_session &&
+        !SetupPolicySession(policy_record, authorization_value,
+                            trunks::TPM_CC_NV_Read)) {
+      // This will fail if policy is not met, e.g. a PCR value is not the
+      // required value.
+      return NVRAM_RESULT_ACCESS_DENIED;
+    }
+    size_t chunk_size = std::min(size - data->size(), max_chunk_size);
+    std::string chunk;
+    result = trunks_utility_->ReadNVSpace(index, offset + data->size(),
+                                          chunk_size, using_owner_authorization,
+                                          &chunk, authorization);
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << "Error reading nvram space: " << GetErrorString(result);
+      return MapTpmError(result);
+    }
+    data->append(chunk);
+    if (chunk.size() < chunk_size) {
+      // The TPM had no more to give.
+      keep_contents = false;
+      break;
+    }
+  }
+  if (keep_contents) {
+    space_contents_[index] = *data;
   }
   return NVRAM_RESULT_SUCCESS;
 }
@@ -320,6 +558,9 @@ NvramResult Tpm2NvramImpl::LockSpace(uint32_t index,
                                      bool lock_read,
                                      bool lock_write,
                                      const std::string& authorization_value) {
+  if (lock_read) {
+    space_contents_.erase(index);
+  }
   if (!Initialize()) {
     return NVRAM_RESULT_DEVICE_ERROR;
   }
@@ -342,8 +583,6 @@ NvramResult Tpm2NvramImpl::LockSpace(uint32_t index,
   // different.
   if (lock_read && !is_read_locked) {
     trunks::AuthorizationDelegate* authorization = nullptr;
-    std::unique_ptr<trunks::PolicySession> policy_session =
-        trunks_factory_.GetPolicySession();
     bool using_owner_authorization = false;
     if (nvram_public.attributes & trunks::TPMA_NV_POLICYREAD) {
       NvramPolicyRecord policy_record;
@@ -352,13 +591,12 @@ NvramResult Tpm2NvramImpl::LockSpace(uint32_t index,
         return NVRAM_RESULT_INVALID_PARAMETER;
       }
       if (!SetupPolicySession(policy_record, authorization_value,
-                              trunks::TPM_CC_NV_ReadLock,
-                              policy_session.get())) {
+                              trunks::TPM_CC_NV_ReadLock)) {
         // This will fail if policy is not met, e.g. a PCR value is not the
         // required value.
         return NVRAM_RESULT_ACCESS_DENIED;
       }
-      authorization = policy_session->GetDelegate();
+      authorization = policy_session_->GetDelegate();
     } else if (nvram_public.attributes & trunks::TPMA_NV_AUTHREAD) {
       trunks_session_->SetEntityAuthorizationValue(authorization_value);
       authorization = trunks_session_->GetDelegate();
@@ -383,8 +621,6 @@ NvramResult Tpm2NvramImpl::LockSpace(uint32_t index,
   }
   if (lock_write && !is_write_locked) {
     trunks::AuthorizationDelegate* authorization = nullptr;
-    std::unique_ptr<trunks::PolicySession> policy_session =
-        trunks_factory_.GetPolicySession();
     bool using_owner_authorization = false;
     if (nvram_public.attributes & trunks::TPMA_NV_POLICYWRITE) {
       NvramPolicyRecord policy_record;
@@ -393,13 +629,12 @@ NvramResult Tpm2NvramImpl::LockSpace(uint32_t index,
         return NVRAM_RESULT_INVALID_PARAMETER;
       }
       if (!SetupPolicySession(policy_record, authorization_value,
-                              trunks::TPM_CC_NV_WriteLock,
-                              policy_session.get())) {
+                              trunks::TPM_CC_NV_WriteLock)) {
         // This will fail if policy is not met, e.g. a PCR value is not the
         // required value.
         return NVRAM_RESULT_ACCESS_DENIED;
       }
-      authorization = policy_session->GetDelegate();
+      authorization = policy_session_->GetDelegate();
     } else if (nvram_public.attributes & trunks::TPMA_NV_AUTHWRITE) {
       trunks_session_->SetEntityAuthorizationValue(authorization_value);
       authorization = trunks_session_->GetDelegate();
@@ -426,7 +661,31 @@ NvramResult Tpm2NvramImpl::LockSpace(uint32_t index,
 }
 
 NvramResult Tpm2NvramImpl::ListSpaces(std::vector<uint32_t>* index_list) {
-  return MapTpmError(trunks_utility_->ListNVSpaces(index_list));
+  uint64_t instance = 0;
+  uint64_t nv_epoch = 0;
+  if (space_list_loaded_) {
+    bool has_epoch = GetNVIndexesEpoch(&instance, &nv_epoch);
+    if (has_epoch == space_list_has_epoch_ &&
+        (!has_epoch || (instance == space_list_instance_ &&
+                        nv_epoch == space_list_nv_epoch_))) {
+      index_list->insert(index_list->end(), space_list_.begin(),
+                         space_list_.end());
+      return NVRAM_RESULT_SUCCESS;
+    }
+  }
+  std::vector<uint32_t> space_list;
+  TPM_RC result = trunks_utility_->ListNVSpaces(&space_list);
+  if (result != TPM_RC_SUCCESS) {
+    space_list_loaded_ = false;
+    return MapTpmError(result);
+  }
+  space_list_.swap(space_list);
+  space_list_loaded_ = true;
+  // The list came with the latest response, so these are its epochs.
+  space_list_has_epoch_ = GetNVIndexesEpoch(&space_list_instance_,
+                                            &space_list_nv_epoch_);
+  index_list->insert(index_list->end(), space_list_.begin(), space_list_.end());
+  return NVRAM_RESULT_SUCCESS;
 }
 
 NvramResult Tpm2NvramImpl::GetSpaceInfo(
@@ -467,6 +726,7 @@ bool Tpm2NvramImpl::Initialize() {
   if (initialized_) {
     return true;
   }
+  trunks::ScopedBootTracePhase phase("Tpm2NvramImpl::Initialize");
   TPM_RC result =
       trunks_session_->StartUnboundSession(true /* enable_encryption */);
   if (result != TPM_RC_SUCCESS) {
@@ -478,55 +738,72 @@ bool Tpm2NvramImpl::Initialize() {
   return true;
 }
 
-std::string Tpm2NvramImpl::GetOwnerPassword() {
+trunks::SecureString Tpm2NvramImpl::GetOwnerPassword() {
   LocalData local_data;
   if (local_data_store_ && local_data_store_->Read(&local_data)) {
-    return local_data.owner_password();
+    // Wipes the copy in |local_data|.
+    return trunks::SecureString::TakeString(
+        local_data.mutable_owner_password());
   }
   LOG(ERROR) << "TPM owner password requested but not available.";
-  return std::string();
+  return trunks::SecureString();
 }
 
 bool Tpm2NvramImpl::SetupOwnerSession() {
-  std::string owner_password = GetOwnerPassword();
+  trunks::SecureString owner_password = GetOwnerPassword();
   if (owner_password.empty()) {
     LOG(ERROR) << "Owner authorization required but not available.";
     return false;
   }
-  trunks_session_->SetEntityAuthorizationValue(owner_password);
+  std::string value = owner_password.ToString();
+  trunks_session_->SetEntityAuthorizationValue(value);
+  OPENSSL_cleanse(base::string_as_array(&value), value.size());
   return true;
 }
 
 bool Tpm2NvramImpl::SetupPolicySession(
     const NvramPolicyRecord& policy_record,
     const std::string& authorization_value,
-    trunks::TPM_CC command_code,
-    trunks::PolicySession* session) {
-  TPM_RC result = session->StartUnboundSession(true /* enable_encryption */);
-  if (result != TPM_RC_SUCCESS) {
-    LOG(ERROR) << "Error starting a policy authorization session: "
-               << GetErrorString(result);
-    return false;
+    trunks::TPM_CC command_code) {
+  trunks::PolicySession* session = policy_session_.get();
+  TPM_RC result = TPM_RC_SUCCESS;
+  if (policy_session_started_) {
+    // Clears what is left of the last policy. If this fails the session is
+    // most likely gone, so a new one is started.
+    result = session->PolicyRestart();
+    policy_session_started_ = (result == TPM_RC_SUCCESS);
+  }
+  if (!policy_session_started_) {
+    result = session->StartUnboundSession(true /* enable_encryption */);
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << "Error starting a policy authorization session: "
+                 << GetErrorString(result);
+      return false;
+    }
+    policy_session_started_ = true;
   }
   session->SetEntityAuthorizationValue(authorization_value);
-  if (!AddPoliciesForCommand(policy_record, command_code, session)) {
-    return false;
-  }
-  if (!AddPolicyOR(policy_record, session)) {
+  // An empty PCR value binds the session to the current PCR value, so the PCR
+  // does not need to be read first. All policy commands go out as one batch.
+  trunks::PolicyTemplate policy;
+  AddPoliciesForCommand(policy_record, command_code, "", &policy);
+  std::vector<std::string> digests(policy_record.policy_digests().begin(),
+                                   policy_record.policy_digests().end());
+  policy.AddOR(digests);
+  result = session->ApplyPolicy(policy);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << "Failed to setup policy session: " << GetErrorString(result);
     return false;
   }
   return true;
 }
 
-bool Tpm2NvramImpl::AddPoliciesForCommand(
+void Tpm2NvramImpl::AddPoliciesForCommand(
     const NvramPolicyRecord& policy_record,
     trunks::TPM_CC command_code,
-    trunks::PolicySession* session) {
-  TPM_RC result = session->PolicyCommandCode(command_code);
-  if (result != TPM_RC_SUCCESS) {
-    LOG(ERROR) << "Failed to setup command code policy.";
-    return false;
-  }
+    const std::string& pcr_value,
+    trunks::PolicyTemplate* policy) {
+  policy->AddCommandCode(command_code);
   bool is_write_command = (command_code == trunks::TPM_CC_NV_Write ||
                            command_code == trunks::TPM_CC_NV_WriteLock ||
                            command_code == trunks::TPM_CC_NV_Extend);
@@ -534,124 +811,187 @@ bool Tpm2NvramImpl::AddPoliciesForCommand(
   // Check if this operation requires an authorization value.
   if ((is_read_command && !policy_record.world_read_allowed()) ||
       (is_write_command && !policy_record.world_write_allowed())) {
-    result = session->PolicyAuthValue();
-    if (result != TPM_RC_SUCCESS) {
-      LOG(ERROR) << "Failed to setup auth policy.";
-      return false;
-    }
+    policy->AddAuthValue();
   }
   if (policy_record.policy() == NVRAM_POLICY_PCR0) {
-    std::string current_pcr_value;
-    result = trunks_utility_->ReadPCR(0, &current_pcr_value);
-    if (result != TPM_RC_SUCCESS) {
-      LOG(ERROR) << "Failed to read the current PCR value.";
-      return false;
-    }
-    result = session->PolicyPCR(0, current_pcr_value);
-    if (result != TPM_RC_SUCCESS) {
-      LOG(ERROR) << "Failed to setup PCR policy.";
-      return false;
-    }
+    policy->AddPCR(0, pcr_value);
   }
-  return true;
 }
 
-bool Tpm2NvramImpl::AddPolicyOR(
-    const NvramPolicyRecord& policy_record,
-    trunks::PolicySession* session) {
-  std::vector<std::string> digests;
-  for (int i = 0; i < policy_record.policy_digests_size(); ++i) {
-    digests.push_back(policy_record.policy_digests(i));
+bool Tpm2NvramImpl::ReadPolicyPCRValue(NvramSpacePolicy policy,
+                                       std::string* pcr_value) {
+  // The only TPM command a policy digest needs. The value is deliberately not
+  // cached across calls: any TPM client may extend the PCR, and a space bound
+  // to a stale value could never be accessed.
+  pcr_value->clear();
+  if (policy != NVRAM_POLICY_PCR0) {
+    return true;
   }
-  TPM_RC result = session->PolicyOR(digests);
+  TPM_RC result = trunks_utility_->ReadPCR(0, pcr_value);
   if (result != TPM_RC_SUCCESS) {
-    LOG(ERROR) << "Failed to setup OR policy.";
+    LOG(ERROR) << "Failed to read the current PCR value.";
     return false;
   }
   return true;
 }
 
-bool Tpm2NvramImpl::ComputePolicyDigest(NvramPolicyRecord* policy_record,
+bool Tpm2NvramImpl::ComputePolicyDigest(const std::string& pcr_value,
+                                        NvramPolicyRecord* policy_record,
                                         std::string* digest) {
   // Compute a policy digest for each command then OR them all together. This
   // approach gives flexibility to have different requirements for read and
   // write operations, and the ability to support authorization values combined
-  // with other policies.
-  std::unique_ptr<trunks::PolicySession> trial_session;
+  // with other policies. The digests are computed in software.
   for (trunks::TPM_CC command_code :
        {trunks::TPM_CC_NV_Extend, trunks::TPM_CC_NV_Write,
         trunks::TPM_CC_NV_WriteLock, trunks::TPM_CC_NV_Read,
         trunks::TPM_CC_NV_ReadLock, trunks::TPM_CC_NV_Certify}) {
-    trial_session = trunks_factory_.GetTrialSession();
-    if (trial_session->StartUnboundSession(false /* enable_encryption */) !=
-        TPM_RC_SUCCESS) {
-      return false;
-    }
-    if (!AddPoliciesForCommand(*policy_record, command_code,
-                               trial_session.get())) {
-      return false;
-    }
-    if (trial_session->GetDigest(digest) != TPM_RC_SUCCESS) {
+    trunks::PolicyTemplate command_policy;
+    AddPoliciesForCommand(*policy_record, command_code, pcr_value,
+                          &command_policy);
+    if (command_policy.ComputeDigest(digest) != TPM_RC_SUCCESS) {
       return false;
     }
     policy_record->add_policy_digests(*digest);
   }
-  if (!AddPolicyOR(*policy_record, trial_session.get())) {
+  // Every branch above is a valid starting point for the OR; use the last.
+  trunks::PolicyTemplate or_policy;
+  AddPoliciesForCommand(*policy_record, trunks::TPM_CC_NV_Certify,
+                        pcr_value, &or_policy);
+  std::vector<std::string> digests(policy_record->policy_digests().begin(),
+                                   policy_record->policy_digests().end());
+  or_policy.AddOR(digests);
+  if (or_policy.ComputeDigest(digest) != TPM_RC_SUCCESS) {
     return false;
   }
-  if (trial_session->GetDigest(digest) != TPM_RC_SUCCESS) {
+  return true;
+}
+
+bool Tpm2NvramImpl::GetNVIndexesEpoch(uint64_t* instance,
+                                      uint64_t* nv_indexes) {
+  trunks::TpmStateEpochs epochs;
+  if (!trunks_factory_.GetLastStateEpochs(&epochs) ||
+      !epochs.has_nv_indexes()) {
     return false;
   }
+  *instance = epochs.instance();
+  *nv_indexes = epochs.nv_indexes();
   return true;
 }
 
+size_t Tpm2NvramImpl::GetNVBufferMax() {
+  if (nv_buffer_max_ == 0) {
+    uint32_t value = 0;
+    std::unique_ptr<trunks::TpmState> tpm_state =
+        trunks_factory_.GetTpmState();
+    if (tpm_state->Initialize() == TPM_RC_SUCCESS &&
+        tpm_state->GetTpmProperty(trunks::TPM_PT_NV_BUFFER_MAX, &value) &&
+        value) {
+      nv_buffer_max_ = std::min<uint32_t>(value, MAX_NV_BUFFER_SIZE);
+    } else {
+      LOG(WARNING) << "Using the default NV buffer size.";
+      nv_buffer_max_ = MAX_NV_BUFFER_SIZE;
+    }
+  }
+  return nv_buffer_max_;
+}
+
 bool Tpm2NvramImpl::GetPolicyRecord(uint32_t index, NvramPolicyRecord* record) {
+  if (!LoadPolicyRecords()) {
+    return false;
+  }
+  auto iter = policy_records_.find(index);
+  if (iter == policy_records_.end()) {
+    return false;
+  }
+  *record = iter->second;
+  return true;
+}
+
+bool Tpm2NvramImpl::LoadPolicyRecords() {
+  if (policy_records_loaded_) {
+    return true;
+  }
   LocalData local_data;
-  if (local_data_store_ && local_data_store_->Read(&local_data)) {
-    for (int i = 0; i < local_data.nvram_policy_size(); ++i) {
-      if (local_data.nvram_policy(i).index() == index) {
-        *record = local_data.nvram_policy(i);
-        return true;
-      }
-    }
+  if (!local_data_store_ || !local_data_store_->Read(&local_data)) {
+    return false;
   }
-  return false;
+  policy_records_.clear();
+  // The first record for an index wins, as with a scan.
+  for (const NvramPolicyRecord& record : local_data.nvram_policy()) {
+    policy_records_.emplace(record.index(), record);
+  }
+  policy_records_loaded_ = true;
+  return true;
 }
 
 bool Tpm2NvramImpl::SavePolicyRecord(const NvramPolicyRecord& record) {
+  return SavePolicyRecords({record});
+}
+
+bool Tpm2NvramImpl::SavePolicyRecords(
+    const std::vector<NvramPolicyRecord>& new_records) {
   LocalData local_data;
   if (!local_data_store_ || !local_data_store_->Read(&local_data)) {
     LOG(ERROR) << "Failed to read local data.";
     return false;
   }
-  LocalData new_local_data = local_data;
-  new_local_data.clear_nvram_policy();
-  for (int i = 0; i < local_data.nvram_policy_size(); ++i) {
-    // Keep only the ones that don't match |record|.
-    if (local_data.nvram_policy(i).index() != record.index()) {
-      *new_local_data.add_nvram_policy() = local_data.nvram_policy(i);
+  auto* records = local_data.mutable_nvram_policy();
+  for (const NvramPolicyRecord& record : new_records) {
+    // Replace the first record for the index and drop any others, or append.
+    bool found = false;
+    int i = 0;
+    while (i < records->size()) {
+      if (records->Get(i).index() != record.index()) {
+        ++i;
+      } else if (!found) {
+        *records->Mutable(i++) = record;
+        found = true;
+      } else {
+        records->DeleteSubrange(i, 1);
+      }
+    }
+    if (!found) {
+      *records->Add() = record;
     }
   }
-  *new_local_data.add_nvram_policy() = record;
-  if (!local_data_store_->Write(new_local_data)) {
+  if (!local_data_store_->Write(local_data)) {
     LOG(ERROR) << "Failed to write local data.";
+    // What was written, if anything, is unknown.
+    policy_records_loaded_ = false;
     return false;
   }
+  if (policy_records_loaded_) {
+    for (const NvramPolicyRecord& record : new_records) {
+      policy_records_[record.index()] = record;
+    }
+  }
   return true;
 }
 
 void Tpm2NvramImpl::DeletePolicyRecord(uint32_t index) {
+  if (LoadPolicyRecords() && policy_records_.count(index) == 0) {
+    // Nothing to delete.
+    return;
+  }
   LocalData local_data;
   if (local_data_store_ && local_data_store_->Read(&local_data)) {
-    LocalData new_local_data = local_data;
-    new_local_data.clear_nvram_policy();
-    for (int i = 0; i < local_data.nvram_policy_size(); ++i) {
-      // Keep only the ones that don't match |index|.
-      if (local_data.nvram_policy(i).index() != index) {
-        *new_local_data.add_nvram_policy() = local_data.nvram_policy(i);
+    auto* records = local_data.mutable_nvram_policy();
+    int i = 0;
+    while (i < records->size()) {
+      if (records->Get(i).index() == index) {
+        records->DeleteSubrange(i, 1);
+      } else {
+        ++i;
       }
     }
-    local_data_store_->Write(new_local_data);
+    // A record left behind is harmless, so this need not reach the disk
+    // before the reply.
+    if (local_data_store_->WriteDeferred(local_data)) {
+      policy_records_.erase(index);
+    } else {
+      policy_records_loaded_ = false;
+    }
   }
 }
 
@@ -19,10 +19,14 @@
 
 #include "tpm_manager/server/tpm_nvram.h"
 
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <base/macros.h>
+#include <trunks/policy_template.h>
+#include <trunks/secure_arena.h>
 #include <trunks/trunks_factory.h>
 
 #include "tpm_manager/common/tpm_manager.pb.h"
@@ -45,11 +49,16 @@ class Tpm2NvramImpl : public TpmNvram {
                           const std::vector<NvramSpaceAttribute>& attributes,
                           const std::string& authorization_value,
                           NvramSpacePolicy policy) override;
+  NvramResult DefineSpaces(const std::vector<NvramSpaceDefinition>& spaces,
+                           std::vector<NvramResult>* results) override;
   NvramResult DestroySpace(uint32_t index) override;
   NvramResult WriteSpace(uint32_t index,
+                         uint32_t offset,
                          const std::string& data,
                          const std::string& authorization_value) override;
   NvramResult ReadSpace(uint32_t index,
+                        uint32_t offset,
+                        uint32_t size,
                         std::string* data,
                         const std::string& authorization_value) override;
   NvramResult LockSpace(uint32_t index,
@@ -70,49 +79,93 @@ class Tpm2NvramImpl : public TpmNvram {
   // times and will be very fast if already initialized.
   bool Initialize();
 
-  // Gets the TPM owner password. Returns an empty string if not available.
-  std::string GetOwnerPassword();
+  // Gets the TPM owner password. Returns an empty value if not available.
+  trunks::SecureString GetOwnerPassword();
 
   // Configures |trunks_session_| with owner authorization. Returns true on
   // success.
   bool SetupOwnerSession();
 
-  // Configures a new policy |session| for a given |policy_record|,
+  // Configures |policy_session_| for a given |policy_record|,
   // |authorization_value|, and |command_code|. Returns true on success.
   bool SetupPolicySession(const NvramPolicyRecord& policy_record,
                           const std::string& authorization_value,
-                          trunks::TPM_CC command_code,
-                          trunks::PolicySession* session);
+                          trunks::TPM_CC command_code);
 
-  // A helper to add policies to a |session| for a particular |command_code| and
-  // |policy_record|. Returns true on success.
-  bool AddPoliciesForCommand(const NvramPolicyRecord& policy_record,
+  // A helper to add policies to |policy| for a particular |command_code| and
+  // |policy_record|. A PCR policy is bound to |pcr_value|, or to the current
+  // PCR value if |pcr_value| is empty.
+  void AddPoliciesForCommand(const NvramPolicyRecord& policy_record,
                              trunks::TPM_CC command_code,
-                             trunks::PolicySession* session);
+                             const std::string& pcr_value,
+                             trunks::PolicyTemplate* policy);
 
-  // A helper to add an OR policy to |session| based on |policy_record|. Returns
-  // true on success.
-  bool AddPolicyOR(const NvramPolicyRecord& policy_record,
-                   trunks::PolicySession* session);
+  // Reads the current value of PCR 0 into |pcr_value| if |policy| binds a
+  // space to it, otherwise clears |pcr_value|. Returns true on success.
+  bool ReadPolicyPCRValue(NvramSpacePolicy policy, std::string* pcr_value);
 
   // Computes the policy |digest| for a given |policy_record| and fills the
-  // policy_digests field in the |policy_record|.
-  bool ComputePolicyDigest(NvramPolicyRecord* policy_record,
+  // policy_digests field in the |policy_record|. A PCR policy is bound to
+  // |pcr_value|, as read by ReadPolicyPCRValue().
+  bool ComputePolicyDigest(const std::string& pcr_value,
+                           NvramPolicyRecord* policy_record,
                            std::string* digest);
 
+  // Gets the NV index epoch from the TPM state epochs trunksd last reported,
+  // along with the trunksd |instance| it belongs to. Returns false if the
+  // epochs are not known.
+  bool GetNVIndexesEpoch(uint64_t* instance, uint64_t* nv_indexes);
+
+  // Returns the most data a single NV read or write command may carry, taken
+  // from the TPM_PT_NV_BUFFER_MAX property the first time it is needed.
+  size_t GetNVBufferMax();
+
   // Gets the policy |record| for the given |index|. Returns true on success.
   bool GetPolicyRecord(uint32_t index, NvramPolicyRecord* record);
 
+  // Fills |policy_records_| from the local_data_store_ unless that has been
+  // done. Returns true on success.
+  bool LoadPolicyRecords();
+
   // Saves a policy |record| in the local_data_store_.
   bool SavePolicyRecord(const NvramPolicyRecord& record);
 
+  // Saves all policy |records| in the local_data_store_ with a single write.
+  bool SavePolicyRecords(const std::vector<NvramPolicyRecord>& records);
+
   // Best effort delete of the policy |record| for |index|.
   void DeletePolicyRecord(uint32_t index);
 
   const trunks::TrunksFactory& trunks_factory_;
   LocalDataStore* local_data_store_;
+  // The policy records in the local_data_store_ by NV index, valid if
+  // |policy_records_loaded_|. Kept up to date by SavePolicyRecord and
+  // DeletePolicyRecord.
+  std::map<uint32_t, NvramPolicyRecord> policy_records_;
+  bool policy_records_loaded_ = false;
+  // The contents of spaces read before by NV index. Only spaces that are
+  // write-locked and readable by anyone without a PCR policy are kept, so the
+  // contents cannot change and a read needs no authorization. Entries are
+  // dropped by any call that could change the space or lock it for reading.
+  // A TPM clear reboots the device, which starts over with an empty map.
+  std::map<uint32_t, std::string> space_contents_;
+  // The indexes of all spaces, valid if |space_list_loaded_|. Dropped when a
+  // space is defined or destroyed from here, and when the NV index epoch
+  // trunksd reports moves on from the one seen when the list was read, as
+  // with a space defined by another TPM client.
+  std::vector<uint32_t> space_list_;
+  bool space_list_loaded_ = false;
+  bool space_list_has_epoch_ = false;
+  uint64_t space_list_instance_ = 0;
+  uint64_t space_list_nv_epoch_ = 0;
+  size_t nv_buffer_max_ = 0;
   bool initialized_;
   std::unique_ptr<trunks::HmacSession> trunks_session_;
+  // The policy session for NV commands. A command uses up the policy but not
+  // the session, so the session is started once and then restarted for each
+  // policy. Calls are serialized by the service, so one session is enough.
+  std::unique_ptr<trunks::PolicySession> policy_session_;
+  bool policy_session_started_ = false;
   std::unique_ptr<trunks::TpmUtility> trunks_utility_;
 
   friend class Tpm2NvramTest;
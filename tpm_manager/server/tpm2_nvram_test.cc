@@ -18,9 +18,12 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <trunks/interface.pb.h>
 #include <trunks/mock_hmac_session.h>
 #include <trunks/mock_policy_session.h>
+#include <trunks/mock_tpm_state.h>
 #include <trunks/mock_tpm_utility.h>
+#include <trunks/policy_template.h>
 #include <trunks/tpm_constants.h>
 #include <trunks/trunks_factory_for_test.h>
 
@@ -38,6 +41,34 @@ trunks::AuthorizationDelegate* const kPolicyAuth =
     reinterpret_cast<trunks::AuthorizationDelegate*>(2ull);
 constexpr trunks::TPMA_NV kNoExtraAttributes = 0;
 
+bool HasAssertion(const trunks::PolicyTemplate& policy,
+                  trunks::PolicyTemplate::AssertionType type) {
+  for (const auto& assertion : policy.assertions()) {
+    if (assertion.type == type) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HasAuthValue(const trunks::PolicyTemplate& policy) {
+  return HasAssertion(policy,
+                      trunks::PolicyTemplate::AssertionType::kAuthValue);
+}
+
+// Matches a policy bound to the current value of PCR 0 that requires an
+// authorization value.
+bool HasCurrentPCRAndAuthValue(const trunks::PolicyTemplate& policy) {
+  bool has_current_pcr = false;
+  for (const auto& assertion : policy.assertions()) {
+    if (assertion.type == trunks::PolicyTemplate::AssertionType::kPCR &&
+        assertion.pcr_index == 0 && assertion.pcr_value.empty()) {
+      has_current_pcr = true;
+    }
+  }
+  return has_current_pcr && HasAuthValue(policy);
+}
+
 }  // namespace
 
 namespace tpm_manager {
@@ -49,7 +80,9 @@ using testing::DoAll;
 using testing::Mock;
 using testing::NiceMock;
 using testing::Return;
+using testing::SaveArg;
 using testing::SetArgPointee;
+using testing::Truly;
 using trunks::TPM_RC_SUCCESS;
 using trunks::TPM_RC_FAILURE;
 using trunks::TPM_RC_HANDLE;
@@ -63,6 +96,7 @@ class Tpm2NvramTest : public testing::Test {
     factory_.set_hmac_session(&mock_hmac_session_);
     factory_.set_policy_session(&mock_policy_session_);
     factory_.set_trial_session(&mock_trial_session_);
+    factory_.set_tpm_state(&mock_tpm_state_);
     factory_.set_tpm_utility(&mock_tpm_utility_);
     tpm_nvram_.reset(new Tpm2NvramImpl(factory_, &mock_data_store_));
     ON_CALL(mock_hmac_session_, GetDelegate()).WillByDefault(Return(kHMACAuth));
@@ -76,6 +110,11 @@ class Tpm2NvramTest : public testing::Test {
             DoAll(SetArgPointee<0>(kFakePolicyDigest), Return(TPM_RC_SUCCESS)));
   }
 
+  void SetupNVBufferMax(uint32_t nv_buffer_max) {
+    ON_CALL(mock_tpm_state_, GetTpmProperty(trunks::TPM_PT_NV_BUFFER_MAX, _))
+        .WillByDefault(DoAll(SetArgPointee<1>(nv_buffer_max), Return(true)));
+  }
+
   void SetupOwnerPassword() {
     LocalData& local_data = mock_data_store_.GetMutableFakeData();
     local_data.set_owner_password(kTestOwnerPassword);
@@ -120,7 +159,8 @@ class Tpm2NvramTest : public testing::Test {
       EXPECT_CALL(mock_hmac_session_, SetEntityAuthorizationValue(_)).Times(0);
       EXPECT_CALL(mock_policy_session_, SetEntityAuthorizationValue(_))
           .Times(0);
-      EXPECT_CALL(mock_policy_session_, PolicyAuthValue()).Times(0);
+      EXPECT_CALL(mock_policy_session_, ApplyPolicy(Truly(HasAuthValue)))
+          .Times(0);
     } else if (auth_type == NORMAL_AUTH) {
       EXPECT_CALL(mock_hmac_session_,
                   SetEntityAuthorizationValue(kFakeAuthorizationValue))
@@ -136,21 +176,40 @@ class Tpm2NvramTest : public testing::Test {
                   SetEntityAuthorizationValue(kFakeAuthorizationValue))
           .Times(AtLeast(1));
       EXPECT_CALL(mock_hmac_session_, SetEntityAuthorizationValue("")).Times(0);
-      EXPECT_CALL(mock_tpm_utility_, ReadPCR(0, _))
-          .Times(AtLeast(1))
-          .WillRepeatedly(
-              DoAll(SetArgPointee<1>(kFakePCRValue), Return(TPM_RC_SUCCESS)));
-      EXPECT_CALL(mock_policy_session_, PolicyAuthValue()).Times(AtLeast(1));
-      EXPECT_CALL(mock_policy_session_, PolicyPCR(0, kFakePCRValue))
+      // The session is bound to the current PCR value without reading it.
+      EXPECT_CALL(mock_tpm_utility_, ReadPCR(_, _)).Times(0);
+      EXPECT_CALL(mock_policy_session_,
+                  ApplyPolicy(Truly(HasCurrentPCRAndAuthValue)))
           .Times(AtLeast(1));
     }
   }
 
+  // Sets up a written space with an empty policy which anyone may read.
+  void SetupWorldReadableSpace(uint32_t index,
+                               uint32_t size,
+                               bool world_write_allowed) {
+    trunks::TPMS_NV_PUBLIC public_data;
+    public_data.nv_index = index;
+    public_data.data_size = size;
+    public_data.attributes = trunks::TPMA_NV_POLICYREAD |
+                             trunks::TPMA_NV_POLICYWRITE |
+                             trunks::TPMA_NV_WRITTEN;
+    ON_CALL(mock_tpm_utility_, GetNVSpacePublicArea(index, _))
+        .WillByDefault(
+            DoAll(SetArgPointee<1>(public_data), Return(TPM_RC_SUCCESS)));
+    NvramPolicyRecord& policy_record =
+        *mock_data_store_.GetMutableFakeData().add_nvram_policy();
+    policy_record.set_index(index);
+    policy_record.set_world_read_allowed(true);
+    policy_record.set_world_write_allowed(world_write_allowed);
+  }
+
  protected:
   trunks::TrunksFactoryForTest factory_;
   NiceMock<trunks::MockHmacSession> mock_hmac_session_;
   NiceMock<trunks::MockPolicySession> mock_policy_session_;
   NiceMock<trunks::MockPolicySession> mock_trial_session_;
+  NiceMock<trunks::MockTpmState> mock_tpm_state_;
   NiceMock<MockLocalDataStore> mock_data_store_;
   NiceMock<trunks::MockTpmUtility> mock_tpm_utility_;
   std::unique_ptr<Tpm2NvramImpl> tpm_nvram_;
@@ -168,8 +227,8 @@ TEST_F(Tpm2NvramTest, SessionFailure) {
   EXPECT_NE(NVRAM_RESULT_SUCCESS,
             tpm_nvram_->DefineSpace(0, 0, {}, "", NVRAM_POLICY_NONE));
   EXPECT_NE(NVRAM_RESULT_SUCCESS, tpm_nvram_->DestroySpace(0));
-  EXPECT_NE(NVRAM_RESULT_SUCCESS, tpm_nvram_->WriteSpace(0, "", ""));
-  EXPECT_NE(NVRAM_RESULT_SUCCESS, tpm_nvram_->ReadSpace(0, nullptr, ""));
+  EXPECT_NE(NVRAM_RESULT_SUCCESS, tpm_nvram_->WriteSpace(0, 0, "", ""));
+  EXPECT_NE(NVRAM_RESULT_SUCCESS, tpm_nvram_->ReadSpace(0, 0, 0, nullptr, ""));
   EXPECT_NE(NVRAM_RESULT_SUCCESS, tpm_nvram_->LockSpace(0, false, false, ""));
 }
 
@@ -178,18 +237,20 @@ TEST_F(Tpm2NvramTest, DefineSpaceSuccess) {
   EXPECT_CALL(mock_hmac_session_,
               SetEntityAuthorizationValue(kTestOwnerPassword))
       .Times(AtLeast(1));
-  EXPECT_CALL(mock_trial_session_, PolicyAuthValue()).Times(0);
-  EXPECT_CALL(mock_trial_session_, PolicyPCR(_, _)).Times(0);
+  // Policy digests are computed in software.
+  EXPECT_CALL(mock_trial_session_, StartUnboundSession(_)).Times(0);
+  EXPECT_CALL(mock_tpm_utility_, ReadPCR(_, _)).Times(0);
   uint32_t index = 42;
   size_t size = 20;
   std::vector<NvramSpaceAttribute> attributes{NVRAM_PERSISTENT_WRITE_LOCK};
+  std::string policy_digest;
   EXPECT_CALL(
       mock_tpm_utility_,
       DefineNVSpace(index, size,
                     trunks::TPMA_NV_WRITEDEFINE | trunks::TPMA_NV_POLICYWRITE |
                         trunks::TPMA_NV_POLICYREAD,
-                    kFakeAuthorizationValue, kFakePolicyDigest, kHMACAuth))
-      .WillOnce(Return(TPM_RC_SUCCESS));
+                    kFakeAuthorizationValue, _, kHMACAuth))
+      .WillOnce(DoAll(SaveArg<4>(&policy_digest), Return(TPM_RC_SUCCESS)));
   EXPECT_EQ(
       NVRAM_RESULT_SUCCESS,
       tpm_nvram_->DefineSpace(index, size, attributes, kFakeAuthorizationValue,
@@ -198,6 +259,16 @@ TEST_F(Tpm2NvramTest, DefineSpaceSuccess) {
   EXPECT_EQ(1, local_data.nvram_policy_size());
   EXPECT_EQ(index, local_data.nvram_policy(0).index());
   EXPECT_EQ(NVRAM_POLICY_NONE, local_data.nvram_policy(0).policy());
+  // One digest per NV command, ORed together into the space's policy.
+  const NvramPolicyRecord& record = local_data.nvram_policy(0);
+  ASSERT_EQ(6, record.policy_digests_size());
+  trunks::PolicyTemplate policy;
+  policy.AddCommandCode(trunks::TPM_CC_NV_Certify);
+  policy.AddOR(std::vector<std::string>(record.policy_digests().begin(),
+                                        record.policy_digests().end()));
+  std::string expected_digest;
+  ASSERT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&expected_digest));
+  EXPECT_EQ(expected_digest, policy_digest);
 }
 
 TEST_F(Tpm2NvramTest, DefineSpaceFailure) {
@@ -232,25 +303,33 @@ TEST_F(Tpm2NvramTest, DefineSpaceWithPolicy) {
   EXPECT_CALL(mock_hmac_session_,
               SetEntityAuthorizationValue(kTestOwnerPassword))
       .Times(AtLeast(1));
-  EXPECT_CALL(mock_trial_session_, PolicyAuthValue()).Times(AtLeast(1));
+  EXPECT_CALL(mock_trial_session_, StartUnboundSession(_)).Times(0);
   EXPECT_CALL(mock_tpm_utility_, ReadPCR(0, _))
-      .WillRepeatedly(
-          DoAll(SetArgPointee<1>(kFakePCRValue), Return(TPM_RC_SUCCESS)));
-  EXPECT_CALL(mock_trial_session_, PolicyPCR(0, kFakePCRValue))
-      .Times(AtLeast(1));
+      .WillOnce(DoAll(SetArgPointee<1>(kFakePCRValue), Return(TPM_RC_SUCCESS)));
   uint32_t index = 42;
   size_t size = 20;
   std::vector<NvramSpaceAttribute> attributes{NVRAM_WRITE_AUTHORIZATION};
+  std::string policy_digest;
   EXPECT_CALL(
       mock_tpm_utility_,
       DefineNVSpace(index, size,
                     trunks::TPMA_NV_POLICYWRITE | trunks::TPMA_NV_POLICYREAD,
-                    kFakeAuthorizationValue, kFakePolicyDigest, kHMACAuth))
-      .WillOnce(Return(TPM_RC_SUCCESS));
+                    kFakeAuthorizationValue, _, kHMACAuth))
+      .WillOnce(DoAll(SaveArg<4>(&policy_digest), Return(TPM_RC_SUCCESS)));
   EXPECT_EQ(
       NVRAM_RESULT_SUCCESS,
       tpm_nvram_->DefineSpace(index, size, attributes, kFakeAuthorizationValue,
                               NVRAM_POLICY_PCR0));
+  const NvramPolicyRecord& record =
+      mock_data_store_.GetFakeData().nvram_policy(0);
+  trunks::PolicyTemplate policy;
+  policy.AddCommandCode(trunks::TPM_CC_NV_Certify);
+  policy.AddPCR(0, kFakePCRValue);
+  policy.AddOR(std::vector<std::string>(record.policy_digests().begin(),
+                                        record.policy_digests().end()));
+  std::string expected_digest;
+  ASSERT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&expected_digest));
+  EXPECT_EQ(expected_digest, policy_digest);
 }
 
 TEST_F(Tpm2NvramTest, DefineSpaceWithExistingLocalData) {
@@ -282,6 +361,84 @@ TEST_F(Tpm2NvramTest, DefineSpaceClobberExistingLocalData) {
             local_data.nvram_policy(2).index());
 }
 
+TEST_F(Tpm2NvramTest, DefineSpacesSuccess) {
+  SetupOwnerPassword();
+  LocalData& local_data = mock_data_store_.GetMutableFakeData();
+  local_data.add_nvram_policy()->set_index(4);
+  // One PCR read and one local data write serve the whole batch.
+  EXPECT_CALL(mock_tpm_utility_, ReadPCR(0, _))
+      .WillOnce(DoAll(SetArgPointee<1>(kFakePCRValue), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_data_store_, Write(_)).Times(1);
+  EXPECT_CALL(mock_tpm_utility_, DefineNVSpace(4, 32, _, _, _, kHMACAuth))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_tpm_utility_, DefineNVSpace(5, 64, _, _, _, kHMACAuth))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_tpm_utility_, DefineNVSpace(6, 32, _, _, _, kHMACAuth))
+      .WillOnce(Return(trunks::TPM_RC_NV_DEFINED));
+  std::vector<NvramSpaceDefinition> spaces(3);
+  spaces[0].index = 4;
+  spaces[0].size = 32;
+  spaces[0].policy = NVRAM_POLICY_PCR0;
+  spaces[1].index = 5;
+  spaces[1].size = 64;
+  spaces[1].attributes = {NVRAM_PERSISTENT_WRITE_LOCK};
+  spaces[1].policy = NVRAM_POLICY_PCR0;
+  spaces[2].index = 6;
+  spaces[2].size = 32;
+  std::vector<NvramResult> results;
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, tpm_nvram_->DefineSpaces(spaces, &results));
+  ASSERT_EQ(3u, results.size());
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, results[0]);
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, results[1]);
+  EXPECT_EQ(NVRAM_RESULT_SPACE_ALREADY_EXISTS, results[2]);
+  // The stale record for index 4 is replaced, and 6 gets none.
+  ASSERT_EQ(2, local_data.nvram_policy_size());
+  EXPECT_EQ(4, local_data.nvram_policy(0).index());
+  EXPECT_EQ(NVRAM_POLICY_PCR0, local_data.nvram_policy(0).policy());
+  EXPECT_EQ(5, local_data.nvram_policy(1).index());
+}
+
+TEST_F(Tpm2NvramTest, DefineSpacesInvalid) {
+  SetupOwnerPassword();
+  EXPECT_CALL(mock_tpm_utility_, DefineNVSpace(_, _, _, _, _, _)).Times(0);
+  EXPECT_CALL(mock_data_store_, Write(_)).Times(0);
+  std::vector<NvramSpaceDefinition> spaces(2);
+  spaces[0].index = 4;
+  spaces[0].size = 32;
+  spaces[1].index = 5;
+  spaces[1].size = 32;
+  spaces[1].attributes = {NVRAM_OWNER_WRITE};
+  std::vector<NvramResult> results;
+  EXPECT_EQ(NVRAM_RESULT_INVALID_PARAMETER,
+            tpm_nvram_->DefineSpaces(spaces, &results));
+  // A repeated index is rejected too.
+  spaces[1] = spaces[0];
+  EXPECT_EQ(NVRAM_RESULT_INVALID_PARAMETER,
+            tpm_nvram_->DefineSpaces(spaces, &results));
+}
+
+TEST_F(Tpm2NvramTest, DefineSpacesLocalDataFailure) {
+  SetupOwnerPassword();
+  EXPECT_CALL(mock_tpm_utility_, DefineNVSpace(_, _, _, _, _, _))
+      .WillRepeatedly(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_data_store_, Write(_)).WillOnce(Return(false));
+  EXPECT_CALL(mock_tpm_utility_, DestroyNVSpace(4, kHMACAuth))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_tpm_utility_, DestroyNVSpace(5, kHMACAuth))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  std::vector<NvramSpaceDefinition> spaces(2);
+  spaces[0].index = 4;
+  spaces[0].size = 32;
+  spaces[1].index = 5;
+  spaces[1].size = 32;
+  std::vector<NvramResult> results;
+  EXPECT_EQ(NVRAM_RESULT_DEVICE_ERROR,
+            tpm_nvram_->DefineSpaces(spaces, &results));
+  ASSERT_EQ(2u, results.size());
+  EXPECT_EQ(NVRAM_RESULT_DEVICE_ERROR, results[0]);
+  EXPECT_EQ(NVRAM_RESULT_DEVICE_ERROR, results[1]);
+}
+
 TEST_F(Tpm2NvramTest, DestroySpaceSuccess) {
   SetupOwnerPassword();
   LocalData& local_data = mock_data_store_.GetMutableFakeData();
@@ -296,6 +453,20 @@ TEST_F(Tpm2NvramTest, DestroySpaceSuccess) {
   EXPECT_EQ(0, local_data.nvram_policy_size());
 }
 
+TEST_F(Tpm2NvramTest, DestroySpaceWithoutPolicyRecord) {
+  SetupOwnerPassword();
+  LocalData& local_data = mock_data_store_.GetMutableFakeData();
+  local_data.add_nvram_policy()->set_index(7);
+  uint32_t index = 42;
+  EXPECT_CALL(mock_tpm_utility_, DestroyNVSpace(index, kHMACAuth))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  // There is no record to delete, so the local data is not rewritten.
+  EXPECT_CALL(mock_data_store_, Write(_)).Times(0);
+  EXPECT_CALL(mock_data_store_, WriteDeferred(_)).Times(0);
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, tpm_nvram_->DestroySpace(index));
+  EXPECT_EQ(1, local_data.nvram_policy_size());
+}
+
 TEST_F(Tpm2NvramTest, DestroySpaceFailure) {
   SetupOwnerPassword();
   uint32_t index = 42;
@@ -307,6 +478,21 @@ TEST_F(Tpm2NvramTest, DestroySpaceFailure) {
   EXPECT_EQ(1, local_data.nvram_policy_size());
 }
 
+TEST_F(Tpm2NvramTest, DestroySpaceRestartsInvalidatedSession) {
+  SetupOwnerPassword();
+  uint32_t index = 42;
+  LocalData& local_data = mock_data_store_.GetMutableFakeData();
+  local_data.add_nvram_policy()->set_index(index);
+  EXPECT_CALL(mock_tpm_utility_, DestroyNVSpace(index, kHMACAuth))
+      .WillOnce(Return(trunks::TPM_RC_REFERENCE_S0))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_hmac_session_,
+              RestartIfInvalidated(trunks::TPM_RC_REFERENCE_S0))
+      .WillOnce(Return(true));
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, tpm_nvram_->DestroySpace(index));
+  EXPECT_EQ(0, local_data.nvram_policy_size());
+}
+
 TEST_F(Tpm2NvramTest, DestroySpaceWithExistingLocalData) {
   SetupOwnerPassword();
   LocalData& local_data = mock_data_store_.GetMutableFakeData();
@@ -329,7 +515,7 @@ TEST_F(Tpm2NvramTest, WriteSpaceSuccess) {
               WriteNVSpace(index, 0, data, false, false, kHMACAuth))
       .WillOnce(Return(TPM_RC_SUCCESS));
   EXPECT_EQ(NVRAM_RESULT_SUCCESS,
-            tpm_nvram_->WriteSpace(index, data, kFakeAuthorizationValue));
+            tpm_nvram_->WriteSpace(index, 0, data, kFakeAuthorizationValue));
 }
 
 TEST_F(Tpm2NvramTest, WriteSpaceExtend) {
@@ -341,7 +527,7 @@ TEST_F(Tpm2NvramTest, WriteSpaceExtend) {
               WriteNVSpace(index, 0, data, false, true, kHMACAuth))
       .WillOnce(Return(TPM_RC_SUCCESS));
   EXPECT_EQ(NVRAM_RESULT_SUCCESS,
-            tpm_nvram_->WriteSpace(index, data, kFakeAuthorizationValue));
+            tpm_nvram_->WriteSpace(index, 0, data, kFakeAuthorizationValue));
 }
 
 TEST_F(Tpm2NvramTest, WriteSpaceNonexistant) {
@@ -350,7 +536,7 @@ TEST_F(Tpm2NvramTest, WriteSpaceNonexistant) {
       .WillRepeatedly(Return(TPM_RC_HANDLE));
   std::string read_data;
   EXPECT_EQ(NVRAM_RESULT_SPACE_DOES_NOT_EXIST,
-            tpm_nvram_->WriteSpace(index, "data", kFakeAuthorizationValue));
+            tpm_nvram_->WriteSpace(index, 0, "data", kFakeAuthorizationValue));
 }
 
 TEST_F(Tpm2NvramTest, WriteSpaceFailure) {
@@ -359,7 +545,7 @@ TEST_F(Tpm2NvramTest, WriteSpaceFailure) {
   EXPECT_CALL(mock_tpm_utility_, WriteNVSpace(index, _, _, _, _, _))
       .WillRepeatedly(Return(TPM_RC_FAILURE));
   EXPECT_NE(NVRAM_RESULT_SUCCESS,
-            tpm_nvram_->WriteSpace(index, "data", kFakeAuthorizationValue));
+            tpm_nvram_->WriteSpace(index, 0, "data", kFakeAuthorizationValue));
 }
 
 TEST_F(Tpm2NvramTest, WriteSpacePolicy) {
@@ -370,7 +556,30 @@ TEST_F(Tpm2NvramTest, WriteSpacePolicy) {
               WriteNVSpace(index, 0, data, false, false, kPolicyAuth))
       .WillOnce(Return(TPM_RC_SUCCESS));
   EXPECT_EQ(NVRAM_RESULT_SUCCESS,
-            tpm_nvram_->WriteSpace(index, data, kFakeAuthorizationValue));
+            tpm_nvram_->WriteSpace(index, 0, data, kFakeAuthorizationValue));
+}
+
+TEST_F(Tpm2NvramTest, PolicySessionRestartedAfterLoss) {
+  uint32_t index = 42;
+  SetupExistingSpace(index, 20, kNoExtraAttributes, EXPECT_AUTH, POLICY_AUTH);
+  EXPECT_CALL(mock_tpm_utility_, WriteNVSpace(index, 0, _, _, _, kPolicyAuth))
+      .Times(3)
+      .WillRepeatedly(Return(TPM_RC_SUCCESS));
+  // The session is started once and reused by the next write.
+  EXPECT_CALL(mock_policy_session_, StartUnboundSession(true)).Times(1);
+  EXPECT_CALL(mock_policy_session_, PolicyRestart())
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS,
+            tpm_nvram_->WriteSpace(index, 0, "data", kFakeAuthorizationValue));
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS,
+            tpm_nvram_->WriteSpace(index, 0, "data", kFakeAuthorizationValue));
+  Mock::VerifyAndClearExpectations(&mock_policy_session_);
+  // A session that is gone is started again.
+  EXPECT_CALL(mock_policy_session_, PolicyRestart())
+      .WillOnce(Return(trunks::TPM_RC_REFERENCE_S0));
+  EXPECT_CALL(mock_policy_session_, StartUnboundSession(true)).Times(1);
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS,
+            tpm_nvram_->WriteSpace(index, 0, "data", kFakeAuthorizationValue));
 }
 
 TEST_F(Tpm2NvramTest, WriteSpaceOwner) {
@@ -382,7 +591,7 @@ TEST_F(Tpm2NvramTest, WriteSpaceOwner) {
               WriteNVSpace(index, 0, data, true, false, kHMACAuth))
       .WillOnce(Return(TPM_RC_SUCCESS));
   EXPECT_EQ(NVRAM_RESULT_SUCCESS,
-            tpm_nvram_->WriteSpace(index, data, kFakeAuthorizationValue));
+            tpm_nvram_->WriteSpace(index, 0, data, kFakeAuthorizationValue));
 }
 
 TEST_F(Tpm2NvramTest, ReadSpaceSuccess) {
@@ -394,17 +603,88 @@ TEST_F(Tpm2NvramTest, ReadSpaceSuccess) {
       .WillOnce(DoAll(SetArgPointee<4>(tpm_data), Return(TPM_RC_SUCCESS)));
   std::string read_data;
   EXPECT_EQ(NVRAM_RESULT_SUCCESS,
-            tpm_nvram_->ReadSpace(index, &read_data, kFakeAuthorizationValue));
+            tpm_nvram_->ReadSpace(index, 0, 0, &read_data,
+                                  kFakeAuthorizationValue));
   EXPECT_EQ(read_data, tpm_data);
 }
 
+TEST_F(Tpm2NvramTest, WriteSpaceInChunks) {
+  uint32_t index = 42;
+  SetupNVBufferMax(4);
+  SetupExistingSpace(index, 20, kNoExtraAttributes, EXPECT_AUTH, POLICY_AUTH);
+  // Each chunk gets a fresh policy in the same session.
+  EXPECT_CALL(mock_policy_session_, StartUnboundSession(true)).Times(1);
+  EXPECT_CALL(mock_policy_session_, PolicyRestart()).Times(2);
+  EXPECT_CALL(mock_tpm_utility_,
+              WriteNVSpace(index, 2, "0123", false, false, kPolicyAuth))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_tpm_utility_,
+              WriteNVSpace(index, 6, "4567", false, false, kPolicyAuth))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_tpm_utility_,
+              WriteNVSpace(index, 10, "89", false, false, kPolicyAuth))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS,
+            tpm_nvram_->WriteSpace(index, 2, "0123456789",
+                                   kFakeAuthorizationValue));
+}
+
+TEST_F(Tpm2NvramTest, WriteSpaceOutOfRange) {
+  uint32_t index = 42;
+  SetupExistingSpace(index, 20, kNoExtraAttributes, NO_EXPECT_AUTH,
+                     NORMAL_AUTH);
+  EXPECT_CALL(mock_tpm_utility_, WriteNVSpace(_, _, _, _, _, _)).Times(0);
+  EXPECT_EQ(NVRAM_RESULT_INVALID_PARAMETER,
+            tpm_nvram_->WriteSpace(index, 18, "data", kFakeAuthorizationValue));
+  EXPECT_EQ(NVRAM_RESULT_INVALID_PARAMETER,
+            tpm_nvram_->WriteSpace(index, 21, "", kFakeAuthorizationValue));
+}
+
+TEST_F(Tpm2NvramTest, WriteSpaceOnlyChangedBytes) {
+  uint32_t index = 42;
+  SetupNVBufferMax(4);
+  SetupWorldReadableSpace(index, 16, true /* world_write_allowed */);
+  EXPECT_CALL(mock_tpm_utility_, ReadNVSpace(index, 0, 4, false, _, _))
+      .WillOnce(DoAll(SetArgPointee<4>("abcd"), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_utility_, ReadNVSpace(index, 4, 4, false, _, _))
+      .WillOnce(DoAll(SetArgPointee<4>("efgh"), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_utility_, WriteNVSpace(index, _, _, _, _, _)).Times(0);
+  EXPECT_CALL(mock_tpm_utility_,
+              WriteNVSpace(index, 6, "X", false, false, kPolicyAuth))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS,
+            tpm_nvram_->WriteSpace(index, 0, "abcdefXh", ""));
+}
+
+TEST_F(Tpm2NvramTest, WriteSpaceSkipsUnchangedData) {
+  uint32_t index = 42;
+  SetupWorldReadableSpace(index, 16, true /* world_write_allowed */);
+  EXPECT_CALL(mock_tpm_utility_, ReadNVSpace(index, 2, 4, false, _, _))
+      .WillOnce(DoAll(SetArgPointee<4>("data"), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_utility_, WriteNVSpace(_, _, _, _, _, _)).Times(0);
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, tpm_nvram_->WriteSpace(index, 2, "data", ""));
+}
+
+TEST_F(Tpm2NvramTest, WriteSpaceUnchangedDataChecksAuthorization) {
+  uint32_t index = 42;
+  SetupWorldReadableSpace(index, 16, false /* world_write_allowed */);
+  EXPECT_CALL(mock_tpm_utility_, ReadNVSpace(index, 0, 4, false, _, _))
+      .WillOnce(DoAll(SetArgPointee<4>("data"), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_utility_,
+              WriteNVSpace(index, 0, "d", false, false, kPolicyAuth))
+      .WillOnce(Return(trunks::TPM_RC_AUTH_FAIL));
+  EXPECT_EQ(NVRAM_RESULT_ACCESS_DENIED,
+            tpm_nvram_->WriteSpace(index, 0, "data", "wrong"));
+}
+
 TEST_F(Tpm2NvramTest, ReadSpaceNonexistant) {
   uint32_t index = 42;
   EXPECT_CALL(mock_tpm_utility_, GetNVSpacePublicArea(index, _))
       .WillRepeatedly(Return(TPM_RC_HANDLE));
   std::string read_data;
   EXPECT_EQ(NVRAM_RESULT_SPACE_DOES_NOT_EXIST,
-            tpm_nvram_->ReadSpace(index, &read_data, kFakeAuthorizationValue));
+            tpm_nvram_->ReadSpace(index, 0, 0, &read_data,
+                                  kFakeAuthorizationValue));
 }
 
 TEST_F(Tpm2NvramTest, ReadSpaceFailure) {
@@ -415,7 +695,8 @@ TEST_F(Tpm2NvramTest, ReadSpaceFailure) {
       .WillRepeatedly(Return(TPM_RC_FAILURE));
   std::string read_data;
   EXPECT_NE(NVRAM_RESULT_SUCCESS,
-            tpm_nvram_->ReadSpace(index, &read_data, kFakeAuthorizationValue));
+            tpm_nvram_->ReadSpace(index, 0, 0, &read_data,
+                                  kFakeAuthorizationValue));
 }
 
 TEST_F(Tpm2NvramTest, ReadSpacePolicy) {
@@ -428,7 +709,8 @@ TEST_F(Tpm2NvramTest, ReadSpacePolicy) {
       .WillOnce(DoAll(SetArgPointee<4>(tpm_data), Return(TPM_RC_SUCCESS)));
   std::string read_data;
   EXPECT_EQ(NVRAM_RESULT_SUCCESS,
-            tpm_nvram_->ReadSpace(index, &read_data, kFakeAuthorizationValue));
+            tpm_nvram_->ReadSpace(index, 0, 0, &read_data,
+                                  kFakeAuthorizationValue));
   EXPECT_EQ(read_data, tpm_data);
 }
 
@@ -442,8 +724,91 @@ TEST_F(Tpm2NvramTest, ReadSpaceOwner) {
       .WillOnce(DoAll(SetArgPointee<4>(tpm_data), Return(TPM_RC_SUCCESS)));
   std::string read_data;
   EXPECT_EQ(NVRAM_RESULT_SUCCESS,
-            tpm_nvram_->ReadSpace(index, &read_data, kFakeAuthorizationValue));
+            tpm_nvram_->ReadSpace(index, 0, 0, &read_data,
+                                  kFakeAuthorizationValue));
+  EXPECT_EQ(read_data, tpm_data);
+}
+
+TEST_F(Tpm2NvramTest, ReadSpaceInChunks) {
+  uint32_t index = 42;
+  SetupNVBufferMax(4);
+  SetupExistingSpace(index, 32, trunks::TPMA_NV_WRITTEN, EXPECT_AUTH,
+                     NORMAL_AUTH);
+  EXPECT_CALL(mock_tpm_utility_, ReadNVSpace(index, 8, 4, false, _, kHMACAuth))
+      .WillOnce(DoAll(SetArgPointee<4>("0123"), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_utility_, ReadNVSpace(index, 12, 2, false, _, kHMACAuth))
+      .WillOnce(DoAll(SetArgPointee<4>("45"), Return(TPM_RC_SUCCESS)));
+  std::string read_data;
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS,
+            tpm_nvram_->ReadSpace(index, 8, 6, &read_data,
+                                  kFakeAuthorizationValue));
+  EXPECT_EQ("012345", read_data);
+}
+
+TEST_F(Tpm2NvramTest, ReadSpaceOutOfRange) {
+  uint32_t index = 42;
+  SetupExistingSpace(index, 32, trunks::TPMA_NV_WRITTEN, NO_EXPECT_AUTH,
+                     NORMAL_AUTH);
+  EXPECT_CALL(mock_tpm_utility_, ReadNVSpace(_, _, _, _, _, _)).Times(0);
+  std::string read_data;
+  EXPECT_EQ(NVRAM_RESULT_INVALID_PARAMETER,
+            tpm_nvram_->ReadSpace(index, 30, 4, &read_data,
+                                  kFakeAuthorizationValue));
+  EXPECT_EQ(NVRAM_RESULT_INVALID_PARAMETER,
+            tpm_nvram_->ReadSpace(index, 33, 0, &read_data,
+                                  kFakeAuthorizationValue));
+}
+
+TEST_F(Tpm2NvramTest, ReadSpaceKeepsWriteLockedContents) {
+  uint32_t index = 42;
+  trunks::TPMS_NV_PUBLIC public_data;
+  public_data.nv_index = index;
+  public_data.data_size = 32;
+  public_data.attributes =
+      trunks::TPMA_NV_POLICYREAD | trunks::TPMA_NV_POLICYWRITE |
+      trunks::TPMA_NV_WRITTEN | trunks::TPMA_NV_WRITELOCKED;
+  ON_CALL(mock_tpm_utility_, GetNVSpacePublicArea(index, _))
+      .WillByDefault(
+          DoAll(SetArgPointee<1>(public_data), Return(TPM_RC_SUCCESS)));
+  NvramPolicyRecord& policy_record =
+      *mock_data_store_.GetMutableFakeData().add_nvram_policy();
+  policy_record.set_index(index);
+  policy_record.set_world_read_allowed(true);
+  std::string tpm_data(32, 'x');
+  EXPECT_CALL(mock_tpm_utility_, ReadNVSpace(index, 0, 32, false, _, _))
+      .Times(2)
+      .WillRepeatedly(
+          DoAll(SetArgPointee<4>(tpm_data), Return(TPM_RC_SUCCESS)));
+  std::string read_data;
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS,
+            tpm_nvram_->ReadSpace(index, 0, 0, &read_data, ""));
+  EXPECT_EQ(read_data, tpm_data);
+  // Read again without the TPM.
+  read_data.clear();
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS,
+            tpm_nvram_->ReadSpace(index, 0, 0, &read_data, ""));
   EXPECT_EQ(read_data, tpm_data);
+  // A write attempt drops the kept contents.
+  EXPECT_EQ(NVRAM_RESULT_OPERATION_DISABLED,
+            tpm_nvram_->WriteSpace(index, 0, "new", ""));
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS,
+            tpm_nvram_->ReadSpace(index, 0, 0, &read_data, ""));
+}
+
+TEST_F(Tpm2NvramTest, ReadSpaceDoesNotKeepWritableContents) {
+  uint32_t index = 42;
+  SetupExistingSpace(index, 32, trunks::TPMA_NV_WRITTEN, EXPECT_AUTH,
+                     NORMAL_AUTH);
+  EXPECT_CALL(mock_tpm_utility_, ReadNVSpace(index, 0, 32, false, _, kHMACAuth))
+      .Times(2)
+      .WillRepeatedly(Return(TPM_RC_SUCCESS));
+  std::string read_data;
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS,
+            tpm_nvram_->ReadSpace(index, 0, 0, &read_data,
+                                  kFakeAuthorizationValue));
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS,
+            tpm_nvram_->ReadSpace(index, 0, 0, &read_data,
+                                  kFakeAuthorizationValue));
 }
 
 TEST_F(Tpm2NvramTest, LockSpaceSuccess) {
@@ -534,6 +899,57 @@ TEST_F(Tpm2NvramTest, ListSpacesSuccess) {
   EXPECT_EQ(spaces, expected_spaces);
 }
 
+TEST_F(Tpm2NvramTest, ListSpacesCached) {
+  SetupOwnerPassword();
+  std::vector<uint32_t> initial_spaces{1, 5};
+  std::vector<uint32_t> later_spaces{1, 5, 42};
+  EXPECT_CALL(mock_tpm_utility_, ListNVSpaces(_))
+      .WillOnce(
+          DoAll(SetArgPointee<0>(initial_spaces), Return(TPM_RC_SUCCESS)))
+      .WillOnce(DoAll(SetArgPointee<0>(later_spaces), Return(TPM_RC_SUCCESS)));
+  std::vector<uint32_t> spaces;
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, tpm_nvram_->ListSpaces(&spaces));
+  EXPECT_EQ(initial_spaces, spaces);
+  spaces.clear();
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, tpm_nvram_->ListSpaces(&spaces));
+  EXPECT_EQ(initial_spaces, spaces);
+  // Defining a space drops the cached list.
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS,
+            tpm_nvram_->DefineSpace(42, 32, {}, "", NVRAM_POLICY_NONE));
+  spaces.clear();
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, tpm_nvram_->ListSpaces(&spaces));
+  EXPECT_EQ(later_spaces, spaces);
+}
+
+TEST_F(Tpm2NvramTest, ListSpacesNVEpochChanged) {
+  trunks::TpmStateEpochs epochs;
+  epochs.set_instance(7);
+  epochs.set_nv_indexes(1);
+  factory_.set_state_epochs(&epochs);
+  std::vector<uint32_t> initial_spaces{1, 5};
+  std::vector<uint32_t> later_spaces{1, 5, 42};
+  EXPECT_CALL(mock_tpm_utility_, ListNVSpaces(_))
+      .WillOnce(
+          DoAll(SetArgPointee<0>(initial_spaces), Return(TPM_RC_SUCCESS)))
+      .WillOnce(DoAll(SetArgPointee<0>(later_spaces), Return(TPM_RC_SUCCESS)))
+      .WillOnce(DoAll(SetArgPointee<0>(later_spaces), Return(TPM_RC_SUCCESS)));
+  std::vector<uint32_t> spaces;
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, tpm_nvram_->ListSpaces(&spaces));
+  // Other epochs do not matter.
+  epochs.set_pcrs(3);
+  spaces.clear();
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, tpm_nvram_->ListSpaces(&spaces));
+  EXPECT_EQ(initial_spaces, spaces);
+  // Another client defined a space.
+  epochs.set_nv_indexes(2);
+  spaces.clear();
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, tpm_nvram_->ListSpaces(&spaces));
+  EXPECT_EQ(later_spaces, spaces);
+  // trunksd restarted.
+  epochs.set_instance(8);
+  EXPECT_EQ(NVRAM_RESULT_SUCCESS, tpm_nvram_->ListSpaces(&spaces));
+}
+
 TEST_F(Tpm2NvramTest, ListSpacesFailure) {
   std::vector<uint32_t> spaces;
   EXPECT_CALL(mock_tpm_utility_, ListNVSpaces(_))
@@ -27,7 +27,12 @@ using trunks::TPM_RC_SUCCESS;
 namespace tpm_manager {
 
 Tpm2StatusImpl::Tpm2StatusImpl(const trunks::TrunksFactory& factory)
-    : trunks_factory_(factory),
+    : Tpm2StatusImpl(factory, base::TimeDelta()) {}
+
+Tpm2StatusImpl::Tpm2StatusImpl(const trunks::TrunksFactory& factory,
+                               base::TimeDelta max_staleness)
+    : max_staleness_(max_staleness),
+      trunks_factory_(factory),
       trunks_tpm_state_(trunks_factory_.GetTpmState()) {}
 
 bool Tpm2StatusImpl::IsTpmEnabled() {
@@ -69,6 +74,10 @@ bool Tpm2StatusImpl::GetDictionaryAttackInfo(int* counter,
 }
 
 bool Tpm2StatusImpl::Refresh() {
+  base::TimeTicks now = base::TimeTicks::Now();
+  if (initialized_ && now - last_refresh_ < max_staleness_) {
+    return true;
+  }
   TPM_RC result = trunks_tpm_state_->Initialize();
   if (result != TPM_RC_SUCCESS) {
     LOG(WARNING) << "Error initializing trunks tpm state: "
@@ -76,6 +85,7 @@ bool Tpm2StatusImpl::Refresh() {
     return false;
   }
   initialized_ = true;
+  last_refresh_ = now;
   return true;
 }
 
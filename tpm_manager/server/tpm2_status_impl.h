@@ -22,6 +22,7 @@
 #include <memory>
 
 #include <base/macros.h>
+#include <base/time/time.h>
 #include <trunks/tpm_state.h>
 #include <trunks/trunks_factory.h>
 
@@ -31,6 +32,10 @@ class Tpm2StatusImpl : public TpmStatus {
  public:
   // Does not take ownership of |factory|.
   explicit Tpm2StatusImpl(const trunks::TrunksFactory& factory);
+  // As above, but status queries arriving within |max_staleness| of the last
+  // successful refresh reuse its result instead of querying the TPM again.
+  Tpm2StatusImpl(const trunks::TrunksFactory& factory,
+                 base::TimeDelta max_staleness);
   ~Tpm2StatusImpl() override = default;
 
   // TpmState methods.
@@ -44,11 +49,14 @@ class Tpm2StatusImpl : public TpmStatus {
  private:
   // Refreshes the Tpm state information. Can be called as many times as needed
   // to refresh the cached information in this class. Return true if the
-  // refresh operation succeeded.
+  // refresh operation succeeded. A refresh younger than |max_staleness_| is
+  // reused as-is.
   bool Refresh();
 
   bool initialized_{false};
   bool is_owned_{false};
+  base::TimeDelta max_staleness_;
+  base::TimeTicks last_refresh_;
   const trunks::TrunksFactory& trunks_factory_;
   std::unique_ptr<trunks::TpmState> trunks_tpm_state_;
 
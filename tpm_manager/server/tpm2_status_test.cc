@@ -139,4 +139,16 @@ TEST_F(Tpm2StatusTest, GetDictionaryAttackInfoAlwaysRefresh) {
                                                    &seconds_remaining));
 }
 
+TEST_F(Tpm2StatusTest, GetDictionaryAttackInfoReusesFreshRefresh) {
+  tpm_status_.reset(
+      new Tpm2StatusImpl(factory_, base::TimeDelta::FromHours(1)));
+  EXPECT_CALL(mock_tpm_state_, Initialize()).WillOnce(Return(TPM_RC_SUCCESS));
+  int count;
+  EXPECT_TRUE(
+      tpm_status_->GetDictionaryAttackInfo(&count, nullptr, nullptr, nullptr));
+  EXPECT_TRUE(
+      tpm_status_->GetDictionaryAttackInfo(&count, nullptr, nullptr, nullptr));
+  EXPECT_TRUE(tpm_status_->IsTpmEnabled());
+}
+
 }  // namespace tpm_manager
@@ -27,8 +27,9 @@
 
 namespace {
 
-const int kTpmConnectRetries = 10;
-const int kTpmConnectIntervalMs = 100;
+const int kTpmConnectRetries = 8;
+// The wait between attempts doubles from this, for about 1.3s in total.
+const int kTpmConnectInitialIntervalMs = 10;
 
 }  // namespace
 
@@ -58,6 +59,13 @@ TSS_HTPM TpmConnection::GetTpm() {
   return tpm_handle;
 }
 
+void TpmConnection::HandleError(TSS_RESULT result) {
+  if (ERROR_CODE(result) == TSS_E_COMM_FAILURE) {
+    LOG(WARNING) << "Lost the connection to the TPM.";
+    context_.reset();
+  }
+}
+
 bool TpmConnection::ConnectContextIfNeeded() {
   if (context_.value() != 0) {
     return true;
@@ -67,20 +75,26 @@ bool TpmConnection::ConnectContextIfNeeded() {
     TPM_LOG(ERROR, result) << "Error connecting to TPM.";
     return false;
   }
-  // We retry on failure. It might be that tcsd is starting up.
+  // We retry on failure. It might be that tcsd is starting up, so the first
+  // retries come quickly and later ones back off.
+  base::TimeDelta interval =
+      base::TimeDelta::FromMilliseconds(kTpmConnectInitialIntervalMs);
   for (int i = 0; i < kTpmConnectRetries; i++) {
-    if (TPM_ERROR(result = Tspi_Context_Connect(context_, nullptr))) {
-      if (ERROR_CODE(result) == TSS_E_COMM_FAILURE) {
-        base::PlatformThread::Sleep(
-            base::TimeDelta::FromMilliseconds(kTpmConnectIntervalMs));
-      } else {
-        TPM_LOG(ERROR, result) << "Error connecting to TPM.";
-        return false;
-      }
-    } else {
+    if (i > 0) {
+      base::PlatformThread::Sleep(interval);
+      interval *= 2;
+    }
+    result = Tspi_Context_Connect(context_, nullptr);
+    if (!TPM_ERROR(result) || ERROR_CODE(result) != TSS_E_COMM_FAILURE) {
       break;
     }
   }
+  if (TPM_ERROR(result)) {
+    // Don't keep a context that never got connected.
+    TPM_LOG(ERROR, result) << "Error connecting to TPM.";
+    context_.reset();
+    return false;
+  }
   if (context_.value() == 0) {
     LOG(ERROR) << "Unexpected NULL context.";
     return false;
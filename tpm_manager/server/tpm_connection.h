@@ -40,6 +40,14 @@ class TpmConnection {
   // This method tries to get a handle to the TPM. Returns 0 on failure.
   TSS_HTPM GetTpm();
 
+  // Drops the context if |result| shows that tcsd can no longer be reached,
+  // so that the next call connects again instead of failing for good.
+  void HandleError(TSS_RESULT result);
+
+  const std::string& authorization_value() const {
+    return authorization_value_;
+  }
+
  private:
   // This method connects to the Tpm. Returns true on success.
   bool ConnectContextIfNeeded();
@@ -31,6 +31,11 @@ class TpmInitializer {
   // the process picks up where it left off.
   virtual bool InitializeTpm() = 0;
 
+  // Does the slow parts of initialization that need no passwords, e.g. key
+  // creation, so that a later InitializeTpm() has less left to do. This has no
+  // effect if the TPM is already owned. Returns true on success.
+  virtual bool PreInitializeTpm() = 0;
+
   // This will be called when the service is initializing. It is an early
   // opportunity to perform tasks related to verified boot.
   virtual void VerifiedBootHelper() = 0;
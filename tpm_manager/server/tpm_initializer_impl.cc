@@ -79,6 +79,16 @@ bool TpmInitializerImpl::InitializeTpm() {
   return true;
 }
 
+bool TpmInitializerImpl::PreInitializeTpm() {
+  if (tpm_status_->IsTpmOwned()) {
+    VLOG(1) << "Tpm already owned.";
+    return true;
+  }
+  // Creating the EK is the slow part and needs no owner.
+  TpmConnection connection(GetDefaultOwnerPassword());
+  return InitializeEndorsementKey(&connection);
+}
+
 void TpmInitializerImpl::VerifiedBootHelper() {
   // Nothing to do.
 }
@@ -49,6 +49,7 @@ class TpmInitializerImpl : public TpmInitializer {
 
   // TpmInitializer methods.
   bool InitializeTpm() override;
+  bool PreInitializeTpm() override;
   void VerifiedBootHelper() override;
   bool ResetDictionaryAttackLock() override;
 
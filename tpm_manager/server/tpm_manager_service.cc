@@ -16,10 +16,30 @@
 
 #include "tpm_manager/server/tpm_manager_service.h"
 
+#include <base/bind_helpers.h>
 #include <base/callback.h>
 #include <base/command_line.h>
+#include <base/threading/thread_task_runner_handle.h>
 #include <brillo/bind_lambda.h>
 
+namespace {
+
+// How long GetTpmStatus may answer with a kept status while the worker thread
+// is idle. Bounds how stale the dictionary attack counters can get.
+constexpr int kTpmStatusMaxAgeMs = 1000;
+
+// Marks a |reply| failed because the local data changes of its request were
+// not committed.
+void SetCommitFailed(tpm_manager::RemoveOwnerDependencyReply* reply) {
+  reply->set_status(tpm_manager::STATUS_DEVICE_ERROR);
+}
+
+void SetCommitFailed(tpm_manager::DestroySpaceReply* reply) {
+  // The space is gone; a policy record left behind is harmless.
+}
+
+}  // namespace
+
 namespace tpm_manager {
 
 TpmManagerService::TpmManagerService(bool wait_for_ownership,
@@ -35,34 +55,93 @@ TpmManagerService::TpmManagerService(bool wait_for_ownership,
       weak_factory_(this) {}
 
 bool TpmManagerService::Initialize() {
+  origin_task_runner_ = base::ThreadTaskRunnerHandle::Get();
   worker_thread_.reset(new base::Thread("TpmManager Service Worker"));
   worker_thread_->StartWithOptions(
       base::Thread::Options(base::MessageLoop::TYPE_IO, 0));
-  base::Closure task =
-      base::Bind(&TpmManagerService::InitializeTask, base::Unretained(this));
+  // Run on the worker thread to report back to this one.
+  base::Closure done = base::Bind(
+      [](const scoped_refptr<base::SingleThreadTaskRunner>& task_runner,
+         const base::Closure& callback) {
+        task_runner->PostTask(FROM_HERE, callback);
+      },
+      base::ThreadTaskRunnerHandle::Get(),
+      base::Bind(&TpmManagerService::OnInitializationDone,
+                 weak_factory_.GetWeakPtr()));
+  base::Closure task = base::Bind(&TpmManagerService::InitializeTask,
+                                  base::Unretained(this), done);
   worker_thread_->task_runner()->PostNonNestableTask(FROM_HERE, task);
   VLOG(1) << "Worker thread started.";
+  RefreshTpmStatus();
   return true;
 }
 
-void TpmManagerService::InitializeTask() {
+void TpmManagerService::SetTpmStatusChangedCallback(
+    const TpmStatusChangedCallback& callback) {
+  tpm_status_changed_callback_ = callback;
+}
+
+void TpmManagerService::SetInitializationDoneCallback(
+    const base::Closure& callback) {
+  initialization_done_callback_ = callback;
+}
+
+void TpmManagerService::InitializeTask(const base::Closure& done) {
   VLOG(1) << "Initializing service...";
   if (!tpm_status_->IsTpmEnabled()) {
     LOG(WARNING) << __func__ << ": TPM is disabled.";
+    done.Run();
     return;
   }
   tpm_initializer_->VerifiedBootHelper();
-  if (!wait_for_ownership_) {
-    VLOG(1) << "Initializing TPM.";
-    if (!tpm_initializer_->InitializeTpm()) {
-      LOG(WARNING) << __func__ << ": TPM initialization failed.";
-      return;
-    }
+  // This is done even when waiting for ownership so that taking ownership
+  // later is quick. InitializeTpm() redoes anything that fails here.
+  if (!tpm_initializer_->PreInitializeTpm()) {
+    LOG(WARNING) << __func__ << ": TPM pre-initialization failed.";
+  }
+  if (wait_for_ownership_) {
+    done.Run();
+    return;
+  }
+  // Status queries and reads that came in meanwhile go first.
+  base::Closure task = base::Bind(&TpmManagerService::InitializeTpmTask,
+                                  base::Unretained(this), done);
+  worker_thread_->task_runner()->PostNonNestableTask(FROM_HERE, task);
+}
+
+void TpmManagerService::InitializeTpmTask(const base::Closure& done) {
+  VLOG(1) << "Initializing TPM.";
+  if (!tpm_initializer_->InitializeTpm()) {
+    LOG(WARNING) << __func__ << ": TPM initialization failed.";
+  }
+  done.Run();
+}
+
+void TpmManagerService::OnInitializationDone() {
+  VLOG(1) << "Service initialized.";
+  initialization_done_ = true;
+  ++state_changes_;
+  for (const auto& task_and_reply : deferred_tasks_) {
+    worker_thread_->task_runner()->PostTaskAndReply(
+        FROM_HERE, task_and_reply.first, task_and_reply.second);
+  }
+  deferred_tasks_.clear();
+  if (!initialization_done_callback_.is_null()) {
+    initialization_done_callback_.Run();
   }
 }
 
 void TpmManagerService::GetTpmStatus(const GetTpmStatusRequest& request,
                                      const GetTpmStatusCallback& callback) {
+  if (last_tpm_status_ &&
+      (pending_tasks_ > 0 ||
+       base::TimeTicks::Now() - last_tpm_status_time_ <
+           base::TimeDelta::FromMilliseconds(kTpmStatusMaxAgeMs))) {
+    // Don't go to the worker thread for what it just returned.
+    base::ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE, base::Bind(callback, *last_tpm_status_));
+    return;
+  }
   PostTaskToWorkerThread<GetTpmStatusReply>(
       request, callback, &TpmManagerService::GetTpmStatusTask);
 }
@@ -88,13 +167,14 @@ void TpmManagerService::GetTpmStatusTask(
     reply->set_dictionary_attack_lockout_in_effect(lockout);
     reply->set_dictionary_attack_lockout_seconds_remaining(
         lockout_time_remaining);
+    UpdateDictionaryAttackState(counter, lockout, lockout_time_remaining);
   }
   reply->set_status(STATUS_SUCCESS);
 }
 
 void TpmManagerService::TakeOwnership(const TakeOwnershipRequest& request,
                                       const TakeOwnershipCallback& callback) {
-  PostTaskToWorkerThread<TakeOwnershipReply>(
+  PostTaskToWorkerThreadAfterInitialization<TakeOwnershipReply>(
       request, callback, &TpmManagerService::TakeOwnershipTask);
 }
 
@@ -116,7 +196,7 @@ void TpmManagerService::TakeOwnershipTask(
 void TpmManagerService::RemoveOwnerDependency(
     const RemoveOwnerDependencyRequest& request,
     const RemoveOwnerDependencyCallback& callback) {
-  PostTaskToWorkerThread<RemoveOwnerDependencyReply>(
+  PostCommittingTaskToWorkerThread<RemoveOwnerDependencyReply>(
       request, callback, &TpmManagerService::RemoveOwnerDependencyTask);
 }
 
@@ -130,7 +210,7 @@ void TpmManagerService::RemoveOwnerDependencyTask(
     return;
   }
   RemoveOwnerDependency(request.owner_dependency(), &local_data);
-  if (!local_data_store_->Write(local_data)) {
+  if (!local_data_store_->WriteDeferred(local_data)) {
     reply->set_status(STATUS_DEVICE_ERROR);
     return;
   }
@@ -158,8 +238,8 @@ void TpmManagerService::RemoveOwnerDependency(
 
 void TpmManagerService::DefineSpace(const DefineSpaceRequest& request,
                                     const DefineSpaceCallback& callback) {
-  PostTaskToWorkerThread<DefineSpaceReply>(request, callback,
-                                           &TpmManagerService::DefineSpaceTask);
+  PostTaskToWorkerThreadAfterInitialization<DefineSpaceReply>(
+      request, callback, &TpmManagerService::DefineSpaceTask);
 }
 
 void TpmManagerService::DefineSpaceTask(
@@ -177,7 +257,7 @@ void TpmManagerService::DefineSpaceTask(
 
 void TpmManagerService::DestroySpace(const DestroySpaceRequest& request,
                                      const DestroySpaceCallback& callback) {
-  PostTaskToWorkerThread<DestroySpaceReply>(
+  PostCommittingTaskToWorkerThread<DestroySpaceReply>(
       request, callback, &TpmManagerService::DestroySpaceTask);
 }
 
@@ -190,8 +270,8 @@ void TpmManagerService::DestroySpaceTask(
 
 void TpmManagerService::WriteSpace(const WriteSpaceRequest& request,
                                    const WriteSpaceCallback& callback) {
-  PostTaskToWorkerThread<WriteSpaceReply>(request, callback,
-                                          &TpmManagerService::WriteSpaceTask);
+  PostTaskToWorkerThreadAfterInitialization<WriteSpaceReply>(
+      request, callback, &TpmManagerService::WriteSpaceTask);
 }
 
 void TpmManagerService::WriteSpaceTask(
@@ -205,9 +285,14 @@ void TpmManagerService::WriteSpaceTask(
       reply->set_result(NVRAM_RESULT_ACCESS_DENIED);
       return;
     }
+  } else if (!CheckDictionaryAttackLockout(authorization_value)) {
+    reply->set_result(NVRAM_RESULT_ACCESS_DENIED);
+    return;
   }
-  reply->set_result(tpm_nvram_->WriteSpace(request.index(), request.data(),
+  reply->set_result(tpm_nvram_->WriteSpace(request.index(), request.offset(),
+                                           request.data(),
                                            authorization_value));
+  OnAuthorizedCommandResult(request.authorization_value(), reply->result());
 }
 
 void TpmManagerService::ReadSpace(const ReadSpaceRequest& request,
@@ -220,6 +305,11 @@ void TpmManagerService::ReadSpaceTask(
     const ReadSpaceRequest& request,
     const std::shared_ptr<ReadSpaceReply>& reply) {
   VLOG(1) << __func__;
+  ReadSpaceInternal(request, reply.get());
+}
+
+void TpmManagerService::ReadSpaceInternal(const ReadSpaceRequest& request,
+                                          ReadSpaceReply* reply) {
   std::string authorization_value = request.authorization_value();
   if (request.use_owner_authorization()) {
     authorization_value = GetOwnerPassword();
@@ -227,15 +317,20 @@ void TpmManagerService::ReadSpaceTask(
       reply->set_result(NVRAM_RESULT_ACCESS_DENIED);
       return;
     }
+  } else if (!CheckDictionaryAttackLockout(authorization_value)) {
+    reply->set_result(NVRAM_RESULT_ACCESS_DENIED);
+    return;
   }
-  reply->set_result(tpm_nvram_->ReadSpace(
-      request.index(), reply->mutable_data(), authorization_value));
+  reply->set_result(tpm_nvram_->ReadSpace(request.index(), request.offset(),
+                                          request.size(), reply->mutable_data(),
+                                          authorization_value));
+  OnAuthorizedCommandResult(request.authorization_value(), reply->result());
 }
 
 void TpmManagerService::LockSpace(const LockSpaceRequest& request,
                                   const LockSpaceCallback& callback) {
-  PostTaskToWorkerThread<LockSpaceReply>(request, callback,
-                                         &TpmManagerService::LockSpaceTask);
+  PostTaskToWorkerThreadAfterInitialization<LockSpaceReply>(
+      request, callback, &TpmManagerService::LockSpaceTask);
 }
 
 void TpmManagerService::LockSpaceTask(
@@ -249,10 +344,14 @@ void TpmManagerService::LockSpaceTask(
       reply->set_result(NVRAM_RESULT_ACCESS_DENIED);
       return;
     }
+  } else if (!CheckDictionaryAttackLockout(authorization_value)) {
+    reply->set_result(NVRAM_RESULT_ACCESS_DENIED);
+    return;
   }
   reply->set_result(tpm_nvram_->LockSpace(request.index(), request.lock_read(),
                                           request.lock_write(),
                                           authorization_value));
+  OnAuthorizedCommandResult(request.authorization_value(), reply->result());
 }
 
 void TpmManagerService::ListSpaces(const ListSpacesRequest& request,
@@ -284,14 +383,19 @@ void TpmManagerService::GetSpaceInfoTask(
     const GetSpaceInfoRequest& request,
     const std::shared_ptr<GetSpaceInfoReply>& reply) {
   VLOG(1) << __func__;
+  GetSpaceInfoInternal(request.index(), reply.get());
+}
+
+void TpmManagerService::GetSpaceInfoInternal(uint32_t index,
+                                             GetSpaceInfoReply* reply) {
   std::vector<NvramSpaceAttribute> attributes;
   size_t size = 0;
   bool is_read_locked = false;
   bool is_write_locked = false;
   NvramSpacePolicy policy = NVRAM_POLICY_NONE;
-  reply->set_result(tpm_nvram_->GetSpaceInfo(request.index(), &size,
-                                             &is_read_locked, &is_write_locked,
-                                             &attributes, &policy));
+  reply->set_result(tpm_nvram_->GetSpaceInfo(index, &size, &is_read_locked,
+                                             &is_write_locked, &attributes,
+                                             &policy));
   if (reply->result() == NVRAM_RESULT_SUCCESS) {
     reply->set_size(size);
     reply->set_is_read_locked(is_read_locked);
@@ -303,6 +407,69 @@ void TpmManagerService::GetSpaceInfoTask(
   }
 }
 
+void TpmManagerService::ReadSpaceBatch(const ReadSpaceBatchRequest& request,
+                                       const ReadSpaceBatchCallback& callback) {
+  PostTaskToWorkerThread<ReadSpaceBatchReply>(
+      request, callback, &TpmManagerService::ReadSpaceBatchTask);
+}
+
+void TpmManagerService::ReadSpaceBatchTask(
+    const ReadSpaceBatchRequest& request,
+    const std::shared_ptr<ReadSpaceBatchReply>& reply) {
+  VLOG(1) << __func__;
+  for (const ReadSpaceRequest& space_request : request.requests()) {
+    ReadSpaceInternal(space_request, reply->add_replies());
+  }
+  reply->set_result(NVRAM_RESULT_SUCCESS);
+}
+
+void TpmManagerService::GetSpaceInfoBatch(
+    const GetSpaceInfoBatchRequest& request,
+    const GetSpaceInfoBatchCallback& callback) {
+  PostTaskToWorkerThread<GetSpaceInfoBatchReply>(
+      request, callback, &TpmManagerService::GetSpaceInfoBatchTask);
+}
+
+void TpmManagerService::GetSpaceInfoBatchTask(
+    const GetSpaceInfoBatchRequest& request,
+    const std::shared_ptr<GetSpaceInfoBatchReply>& reply) {
+  VLOG(1) << __func__;
+  for (uint32_t index : request.index_list()) {
+    GetSpaceInfoInternal(index, reply->add_replies());
+  }
+  reply->set_result(NVRAM_RESULT_SUCCESS);
+}
+
+void TpmManagerService::DefineSpaceBatch(
+    const DefineSpaceBatchRequest& request,
+    const DefineSpaceBatchCallback& callback) {
+  PostTaskToWorkerThreadAfterInitialization<DefineSpaceBatchReply>(
+      request, callback, &TpmManagerService::DefineSpaceBatchTask);
+}
+
+void TpmManagerService::DefineSpaceBatchTask(
+    const DefineSpaceBatchRequest& request,
+    const std::shared_ptr<DefineSpaceBatchReply>& reply) {
+  VLOG(1) << __func__;
+  std::vector<NvramSpaceDefinition> spaces;
+  for (const DefineSpaceRequest& space_request : request.requests()) {
+    NvramSpaceDefinition space;
+    space.index = space_request.index();
+    space.size = space_request.size();
+    for (int i = 0; i < space_request.attributes_size(); ++i) {
+      space.attributes.push_back(space_request.attributes(i));
+    }
+    space.authorization_value = space_request.authorization_value();
+    space.policy = space_request.policy();
+    spaces.push_back(space);
+  }
+  std::vector<NvramResult> results;
+  reply->set_result(tpm_nvram_->DefineSpaces(spaces, &results));
+  for (NvramResult result : results) {
+    reply->add_replies()->set_result(result);
+  }
+}
+
 std::string TpmManagerService::GetOwnerPassword() {
   LocalData local_data;
   if (local_data_store_ && local_data_store_->Read(&local_data)) {
@@ -312,10 +479,86 @@ std::string TpmManagerService::GetOwnerPassword() {
   return std::string();
 }
 
+bool TpmManagerService::CheckDictionaryAttackLockout(
+    const std::string& authorization_value) {
+  if (authorization_value.empty() ||
+      base::TimeTicks::Now() >= dictionary_attack_lockout_end_) {
+    return true;
+  }
+  LOG(WARNING) << "Not sending an authorized NV command: the TPM is in "
+               << "dictionary attack lockout.";
+  return false;
+}
+
+void TpmManagerService::OnAuthorizedCommandResult(
+    const std::string& authorization_value,
+    NvramResult result) {
+  if (authorization_value.empty() || result != NVRAM_RESULT_ACCESS_DENIED) {
+    return;
+  }
+  int counter;
+  int threshold;
+  bool lockout;
+  int lockout_time_remaining;
+  if (tpm_status_->GetDictionaryAttackInfo(&counter, &threshold, &lockout,
+                                           &lockout_time_remaining)) {
+    UpdateDictionaryAttackState(counter, lockout, lockout_time_remaining);
+  }
+}
+
+void TpmManagerService::UpdateDictionaryAttackState(int counter,
+                                                    bool lockout,
+                                                    int seconds_remaining) {
+  // Only try a reset when the counter went up, so that a TPM or local data
+  // that cannot reset it is not asked again on every status query.
+  if (counter > dictionary_attack_counter_ &&
+      tpm_initializer_->ResetDictionaryAttackLock()) {
+    VLOG(1) << "Dictionary attack counter reset.";
+    counter = 0;
+    lockout = false;
+  }
+  dictionary_attack_counter_ = counter;
+  if (lockout) {
+    dictionary_attack_lockout_end_ =
+        base::TimeTicks::Now() +
+        base::TimeDelta::FromSeconds(seconds_remaining);
+  } else {
+    dictionary_attack_lockout_end_ = base::TimeTicks();
+  }
+}
+
+void TpmManagerService::RefreshTpmStatus() {
+  if (tpm_status_changed_callback_.is_null()) {
+    return;
+  }
+  GetTpmStatusRequest request;
+  GetTpmStatusCallback callback = base::Bind([](const GetTpmStatusReply&) {});
+  PostTaskToWorkerThread<GetTpmStatusReply>(
+      request, callback, &TpmManagerService::GetTpmStatusTask);
+}
+
+void TpmManagerService::OnTaskReply(const GetTpmStatusReply& reply) {
+  last_tpm_status_.reset(new GetTpmStatusReply(reply));
+  last_tpm_status_time_ = base::TimeTicks::Now();
+  if (tpm_status_changed_callback_.is_null()) {
+    return;
+  }
+  GetTpmStatusReply status = reply;
+  status.clear_local_data();
+  if (reported_tpm_status_ &&
+      reported_tpm_status_->SerializeAsString() == status.SerializeAsString()) {
+    return;
+  }
+  reported_tpm_status_.reset(new GetTpmStatusReply(status));
+  tpm_status_changed_callback_.Run(status);
+}
+
 template <typename ReplyProtobufType>
 void TpmManagerService::TaskRelayCallback(
     const base::Callback<void(const ReplyProtobufType&)> callback,
     const std::shared_ptr<ReplyProtobufType>& reply) {
+  --pending_tasks_;
+  OnTaskReply(*reply);
   callback.Run(*reply);
 }
 
@@ -326,14 +569,146 @@ template <typename ReplyProtobufType,
 void TpmManagerService::PostTaskToWorkerThread(RequestProtobufType& request,
                                                ReplyCallbackType& callback,
                                                TaskType task) {
+  std::string key = request.GetTypeName() + ":" + request.SerializeAsString();
+  auto iter = pending_reads_.find(key);
+  // Initialization changes TPM state on the worker thread, so reads are not
+  // joined until it is done.
+  if (initialization_done_ && iter != pending_reads_.end() &&
+      iter->second.state_changes == state_changes_) {
+    // Only the reply goes through the worker thread, so it comes after those
+    // of the requests made before and the result is filled in by then.
+    auto result =
+        std::static_pointer_cast<ReplyProtobufType>(iter->second.result);
+    ++pending_tasks_;
+    PostTaskAndReplyToWorkerThread(
+        base::Bind(&base::DoNothing),
+        base::Bind(&TpmManagerService::TaskRelayCallback<ReplyProtobufType>,
+                   weak_factory_.GetWeakPtr(), callback, result));
+    return;
+  }
+  auto result = std::make_shared<ReplyProtobufType>();
+  pending_reads_[key] = PendingRead{result, state_changes_};
+  base::Closure background_task =
+      base::Bind(task, base::Unretained(this), request, result);
+  base::Closure reply = base::Bind(
+      &TpmManagerService::FinishPendingRead, weak_factory_.GetWeakPtr(), key,
+      std::shared_ptr<void>(result),
+      base::Bind(&TpmManagerService::TaskRelayCallback<ReplyProtobufType>,
+                 weak_factory_.GetWeakPtr(), callback, result));
+  ++pending_tasks_;
+  PostTaskAndReplyToWorkerThread(background_task, reply);
+}
+
+template <typename ReplyProtobufType,
+          typename RequestProtobufType,
+          typename ReplyCallbackType,
+          typename TaskType>
+void TpmManagerService::PostTaskToWorkerThreadAfterInitialization(
+    RequestProtobufType& request,
+    ReplyCallbackType& callback,
+    TaskType task) {
   auto result = std::make_shared<ReplyProtobufType>();
   base::Closure background_task =
       base::Bind(task, base::Unretained(this), request, result);
   base::Closure reply =
       base::Bind(&TpmManagerService::TaskRelayCallback<ReplyProtobufType>,
                  weak_factory_.GetWeakPtr(), callback, result);
-  worker_thread_->task_runner()->PostTaskAndReply(FROM_HERE, background_task,
-                                                  reply);
+  ++pending_tasks_;
+  ++state_changes_;
+  if (initialization_done_) {
+    worker_thread_->task_runner()->PostTaskAndReply(FROM_HERE, background_task,
+                                                    reply);
+    return;
+  }
+  deferred_tasks_.emplace_back(background_task, reply);
+}
+
+template <typename ReplyProtobufType,
+          typename RequestProtobufType,
+          typename ReplyCallbackType,
+          typename TaskType>
+void TpmManagerService::PostCommittingTaskToWorkerThread(
+    RequestProtobufType& request,
+    ReplyCallbackType& callback,
+    TaskType task) {
+  auto result = std::make_shared<ReplyProtobufType>();
+  base::Closure reply =
+      base::Bind(&TpmManagerService::TaskRelayCallback<ReplyProtobufType>,
+                 weak_factory_.GetWeakPtr(), callback, result);
+  base::Closure background_task = base::Bind(
+      &TpmManagerService::RunTaskInCommitGroup<ReplyProtobufType>,
+      base::Unretained(this),
+      base::Bind(task, base::Unretained(this), request, result), result,
+      reply);
+  ++pending_tasks_;
+  ++state_changes_;
+  if (!initialization_done_) {
+    deferred_tasks_.emplace_back(background_task, base::Bind(&base::DoNothing));
+    return;
+  }
+  worker_thread_->task_runner()->PostTask(FROM_HERE, background_task);
+}
+
+void TpmManagerService::PostTaskAndReplyToWorkerThread(
+    const base::Closure& task,
+    const base::Closure& reply) {
+  // Once anything waits for initialization, later requests wait behind it so
+  // that each client sees its requests run in order.
+  if (!initialization_done_ && !deferred_tasks_.empty()) {
+    deferred_tasks_.emplace_back(task, reply);
+    return;
+  }
+  worker_thread_->task_runner()->PostTaskAndReply(FROM_HERE, task, reply);
+}
+
+void TpmManagerService::FinishPendingRead(const std::string& key,
+                                          const std::shared_ptr<void>& result,
+                                          const base::Closure& reply) {
+  auto iter = pending_reads_.find(key);
+  if (iter != pending_reads_.end() && iter->second.result == result) {
+    pending_reads_.erase(iter);
+  }
+  reply.Run();
+}
+
+template <typename ReplyProtobufType>
+void TpmManagerService::RunTaskInCommitGroup(
+    const base::Closure& task,
+    const std::shared_ptr<ReplyProtobufType>& result,
+    const base::Closure& reply) {
+  task.Run();
+  uncommitted_replies_.push_back(
+      base::Bind(&TpmManagerService::ReplyAfterCommit<ReplyProtobufType>,
+                 base::Unretained(this), result, reply));
+  if (uncommitted_replies_.size() == 1) {
+    // Runs after the requests already queued, so their changes are committed
+    // along with these.
+    worker_thread_->task_runner()->PostNonNestableTask(
+        FROM_HERE,
+        base::Bind(&TpmManagerService::CommitTask, base::Unretained(this)));
+  }
+}
+
+template <typename ReplyProtobufType>
+void TpmManagerService::ReplyAfterCommit(
+    const std::shared_ptr<ReplyProtobufType>& result,
+    const base::Closure& reply,
+    bool committed) {
+  if (!committed) {
+    SetCommitFailed(result.get());
+  }
+  origin_task_runner_->PostTask(FROM_HERE, reply);
+}
+
+void TpmManagerService::CommitTask() {
+  VLOG(1) << __func__ << ": " << uncommitted_replies_.size() << " requests.";
+  bool committed = local_data_store_->Commit();
+  LOG_IF(ERROR, !committed) << __func__ << ": Failed to commit local data.";
+  std::vector<base::Callback<void(bool)>> replies;
+  replies.swap(uncommitted_replies_);
+  for (const auto& reply : replies) {
+    reply.Run(committed);
+  }
 }
 
 }  // namespace tpm_manager
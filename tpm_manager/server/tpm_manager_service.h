@@ -17,12 +17,18 @@
 #ifndef TPM_MANAGER_SERVER_TPM_MANAGER_SERVICE_H_
 #define TPM_MANAGER_SERVER_TPM_MANAGER_SERVICE_H_
 
+#include <map>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <base/callback.h>
 #include <base/macros.h>
 #include <base/memory/weak_ptr.h>
+#include <base/single_thread_task_runner.h>
 #include <base/threading/thread.h>
+#include <base/time/time.h>
 #include <brillo/bind_lambda.h>
 
 #include "tpm_manager/common/tpm_nvram_interface.h"
@@ -49,6 +55,29 @@ namespace tpm_manager {
 // readable way. It also serves to serialize method execution which reduces
 // complexity with TPM state.
 //
+// GetTpmStatus is answered with the last status it returned, as long as no
+// other request has completed since and the status is either younger than a
+// second or the worker thread is busy, e.g. taking ownership. Nothing the
+// status reports can have changed without a request completing on the worker
+// thread, except the dictionary attack counters, which are then at most as old
+// as the second or the request in progress.
+//
+// Initialization runs on the worker thread in steps, so status queries and
+// other requests that only read get their turn between them. Requests that
+// need the owner or change TPM state are held back until initialization is
+// done, along with any request made after one of them.
+//
+// Requests whose local data changes need not be on disk before their task
+// returns, like RemoveOwnerDependency, only update the data kept in memory.
+// A commit task runs after the requests already queued, writes the local data
+// once for all of them and then sends their replies, which report whether the
+// changes were committed.
+//
+// Once initialization is done, a read made while an identical one, down to
+// the authorization value, is still pending shares its result, unless a
+// request that needs the owner or changes TPM state was made in between. Its
+// reply still comes after those of the requests made before it.
+//
 // Tasks that run on the worker thread are bound with base::Unretained which is
 // safe because the thread is owned by this class (so it is guaranteed not to
 // process a task after destruction). Weak pointers are used to post replies
@@ -70,6 +99,18 @@ class TpmManagerService : public TpmNvramInterface,
   // any other method in this class. Returns true on success.
   bool Initialize();
 
+  // Sets a |callback| to run on the main thread whenever the status reported
+  // by GetTpmStatus changes, e.g. after ownership is taken. The status passed
+  // to |callback| never carries local data, which holds secrets. Set before
+  // Initialize() to also be told the status the service starts with.
+  using TpmStatusChangedCallback =
+      base::Callback<void(const GetTpmStatusReply&)>;
+  void SetTpmStatusChangedCallback(const TpmStatusChangedCallback& callback);
+
+  // Sets a |callback| to run on the main thread once initialization, including
+  // taking ownership unless waiting for it, is done. Set before Initialize().
+  void SetInitializationDoneCallback(const base::Closure& callback);
+
   // TpmOwnershipInterface methods.
   void GetTpmStatus(const GetTpmStatusRequest& request,
                     const GetTpmStatusCallback& callback) override;
@@ -94,6 +135,12 @@ class TpmManagerService : public TpmNvramInterface,
                   const ListSpacesCallback& callback) override;
   void GetSpaceInfo(const GetSpaceInfoRequest& request,
                     const GetSpaceInfoCallback& callback) override;
+  void ReadSpaceBatch(const ReadSpaceBatchRequest& request,
+                      const ReadSpaceBatchCallback& callback) override;
+  void GetSpaceInfoBatch(const GetSpaceInfoBatchRequest& request,
+                         const GetSpaceInfoBatchCallback& callback) override;
+  void DefineSpaceBatch(const DefineSpaceBatchRequest& request,
+                        const DefineSpaceBatchCallback& callback) override;
 
  private:
   // A relay callback which allows the use of weak pointer semantics for a reply
@@ -106,6 +153,8 @@ class TpmManagerService : public TpmNvramInterface,
   // This templated method posts the provided |TaskType| to the background
   // thread with the provided |RequestProtobufType|. When |TaskType| finishes
   // executing, the |ReplyCallbackType| is called with the |ReplyProtobufType|.
+  // Only for requests that read: an identical pending request is joined, see
+  // THREADING NOTES.
   template <typename ReplyProtobufType,
             typename RequestProtobufType,
             typename ReplyCallbackType,
@@ -114,11 +163,74 @@ class TpmManagerService : public TpmNvramInterface,
                               ReplyCallbackType& callback,
                               TaskType task);
 
+  // Like PostTaskToWorkerThread, but for requests that depend on the owner or
+  // change TPM state. Until initialization is done these are held on the main
+  // thread, so they neither run before ownership is taken nor hold up the
+  // requests that need neither.
+  template <typename ReplyProtobufType,
+            typename RequestProtobufType,
+            typename ReplyCallbackType,
+            typename TaskType>
+  void PostTaskToWorkerThreadAfterInitialization(RequestProtobufType& request,
+                                                 ReplyCallbackType& callback,
+                                                 TaskType task);
+
+  // Like PostTaskToWorkerThreadAfterInitialization, but for requests whose
+  // |TaskType| persists local data with WriteDeferred(). The reply is sent once
+  // the data is committed.
+  template <typename ReplyProtobufType,
+            typename RequestProtobufType,
+            typename ReplyCallbackType,
+            typename TaskType>
+  void PostCommittingTaskToWorkerThread(RequestProtobufType& request,
+                                        ReplyCallbackType& callback,
+                                        TaskType task);
+
+  // Posts |task| to the worker thread and |reply| back to this one, or holds
+  // both until initialization is done if requests are held back already.
+  void PostTaskAndReplyToWorkerThread(const base::Closure& task,
+                                      const base::Closure& reply);
+
+  // Runs |reply| once the read posted under |key| with |result| is no longer
+  // pending, so later reads do not join it.
+  void FinishPendingRead(const std::string& key,
+                         const std::shared_ptr<void>& result,
+                         const base::Closure& reply);
+
+  // Runs |task| on the worker thread and holds its |reply| until the next
+  // CommitTask, which is posted unless one is pending.
+  template <typename ReplyProtobufType>
+  void RunTaskInCommitGroup(const base::Closure& task,
+                            const std::shared_ptr<ReplyProtobufType>& result,
+                            const base::Closure& reply);
+
+  // Marks |result| failed unless |committed| and posts |reply| to the main
+  // thread.
+  template <typename ReplyProtobufType>
+  void ReplyAfterCommit(const std::shared_ptr<ReplyProtobufType>& result,
+                        const base::Closure& reply,
+                        bool committed);
+
+  // Commits the local data written by the tasks run since the last commit
+  // and sends their replies.
+  void CommitTask();
+
   // Synchronously initializes the TPM according to the current configuration.
   // If an initialization process was interrupted it will be continued. If the
   // TPM is already initialized or cannot yet be initialized, this method has no
-  // effect.
-  void InitializeTask();
+  // effect. Only the preparation is done here; taking ownership is left to
+  // TakeOwnershipTask or posted as InitializeTpmTask, so requests that came in
+  // meanwhile do not wait for all of it. Runs |done| once there is nothing
+  // left to initialize.
+  void InitializeTask(const base::Closure& done);
+
+  // Synchronously takes ownership of the TPM as part of InitializeTask, then
+  // runs |done|.
+  void InitializeTpmTask(const base::Closure& done);
+
+  // Called on the main thread when initialization is done. Posts the requests
+  // held back until then.
+  void OnInitializationDone();
 
   // Blocking implementation of GetTpmStatus that can be executed on the
   // background worker thread.
@@ -177,10 +289,67 @@ class TpmManagerService : public TpmNvramInterface,
   void GetSpaceInfoTask(const GetSpaceInfoRequest& request,
                         const std::shared_ptr<GetSpaceInfoReply>& result);
 
+  // Blocking implementation of ReadSpaceBatch that can be executed on the
+  // background worker thread.
+  void ReadSpaceBatchTask(const ReadSpaceBatchRequest& request,
+                          const std::shared_ptr<ReadSpaceBatchReply>& result);
+
+  // Blocking implementation of GetSpaceInfoBatch that can be executed on the
+  // background worker thread.
+  void GetSpaceInfoBatchTask(
+      const GetSpaceInfoBatchRequest& request,
+      const std::shared_ptr<GetSpaceInfoBatchReply>& result);
+
+  // Blocking implementation of DefineSpaceBatch that can be executed on the
+  // background worker thread.
+  void DefineSpaceBatchTask(
+      const DefineSpaceBatchRequest& request,
+      const std::shared_ptr<DefineSpaceBatchReply>& result);
+
+  // Reads a space as asked by |request| into |reply|, on the worker thread.
+  void ReadSpaceInternal(const ReadSpaceRequest& request,
+                         ReadSpaceReply* reply);
+
+  // Gets the info of the space at |index| into |reply|, on the worker thread.
+  void GetSpaceInfoInternal(uint32_t index, GetSpaceInfoReply* reply);
+
   // Gets the owner password from local storage. Returns an empty string if the
   // owner password is not available.
   std::string GetOwnerPassword();
 
+  // Returns false, on the worker thread, if an NV command authorized with a
+  // non-empty |authorization_value| should fail without being sent because
+  // the TPM is in dictionary attack lockout. Sending it would only fail and
+  // may extend the lockout.
+  bool CheckDictionaryAttackLockout(const std::string& authorization_value);
+
+  // Called on the worker thread after an NV command authorized with
+  // |authorization_value| finished with |result|. A denied command may have
+  // counted as a dictionary attack failure, so the counters are read again.
+  void OnAuthorizedCommandResult(const std::string& authorization_value,
+                                 NvramResult result);
+
+  // Records the dictionary attack state read from the TPM on the worker
+  // thread. When the failure counter went up, resets it right away if the TPM
+  // allows that.
+  void UpdateDictionaryAttackState(int counter,
+                                   bool lockout,
+                                   int seconds_remaining);
+
+  // Queries the status on the worker thread so that a change is reported to
+  // the status changed callback. Does nothing if no callback is set.
+  void RefreshTpmStatus();
+
+  // Called on the main thread with the |reply| to a task, before it is sent.
+  // A status reply is kept for later GetTpmStatus calls and reported if it
+  // changed. Any other reply drops the kept status and refreshes it.
+  void OnTaskReply(const GetTpmStatusReply& reply);
+  template <typename ReplyProtobufType>
+  void OnTaskReply(const ReplyProtobufType& reply) {
+    last_tpm_status_.reset();
+    RefreshTpmStatus();
+  }
+
   LocalDataStore* local_data_store_;
   TpmStatus* tpm_status_;
   TpmInitializer* tpm_initializer_;
@@ -191,6 +360,40 @@ class TpmManagerService : public TpmNvramInterface,
   // Background thread to allow processing of potentially lengthy TPM requests
   // in the background.
   std::unique_ptr<base::Thread> worker_thread_;
+  // Used only on the worker thread. The dictionary attack failure counter as
+  // last seen, and until when NV commands that need authorization fail fast.
+  int dictionary_attack_counter_ = 0;
+  base::TimeTicks dictionary_attack_lockout_end_;
+  // Used only on the worker thread. The replies waiting for CommitTask, which
+  // is pending if there are any.
+  std::vector<base::Callback<void(bool)>> uncommitted_replies_;
+  // The main thread, to which held replies are posted.
+  scoped_refptr<base::SingleThreadTaskRunner> origin_task_runner_;
+  // Used only on the main thread. The number of tasks posted to the worker
+  // thread whose replies have not been sent yet, the status kept by
+  // OnTaskReply and when it was kept, if any, and the status last passed to
+  // |tpm_status_changed_callback_|.
+  int pending_tasks_ = 0;
+  std::unique_ptr<GetTpmStatusReply> last_tpm_status_;
+  base::TimeTicks last_tpm_status_time_;
+  TpmStatusChangedCallback tpm_status_changed_callback_;
+  base::Closure initialization_done_callback_;
+  std::unique_ptr<GetTpmStatusReply> reported_tpm_status_;
+  // Used only on the main thread. Whether initialization is done, and the
+  // tasks and replies of requests held back until it is.
+  bool initialization_done_ = false;
+  std::vector<std::pair<base::Closure, base::Closure>> deferred_tasks_;
+  // Used only on the main thread. The number of requests made so far that
+  // need the owner or change TPM state, and the reads whose replies are
+  // pending, by request type and serialized request. Each holds the result
+  // the read fills in, of its reply type, and the number of such requests
+  // made before it.
+  struct PendingRead {
+    std::shared_ptr<void> result;
+    int state_changes;
+  };
+  int state_changes_ = 0;
+  std::map<std::string, PendingRead> pending_reads_;
   // Declared last so any weak pointers are destroyed first.
   base::WeakPtrFactory<TpmManagerService> weak_factory_;
 
@@ -16,6 +16,7 @@
 
 #include <base/at_exit.h>
 #include <base/run_loop.h>
+#include <base/synchronization/waitable_event.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -27,6 +28,8 @@
 
 using testing::_;
 using testing::AtLeast;
+using testing::DoAll;
+using testing::InSequence;
 using testing::Invoke;
 using testing::NiceMock;
 using testing::Return;
@@ -105,8 +108,19 @@ TEST_F(TpmManagerServiceTest_NoWaitForOwnership, AutoInitialize) {
   RunServiceWorkerAndQuit();
 }
 
+TEST_F(TpmManagerServiceTest_NoWaitForOwnership, InitializationDoneCallback) {
+  auto callback = [](decltype(this) test) { test->Quit(); };
+  service_->SetInitializationDoneCallback(
+      base::Bind(callback, base::Unretained(this)));
+  EXPECT_CALL(mock_tpm_initializer_, InitializeTpm()).Times(1);
+  SetupService();
+  // Only returns once |callback| has run, after InitializeTpm().
+  Run();
+}
+
 TEST_F(TpmManagerServiceTest_NoWaitForOwnership, AutoInitializeNoTpm) {
   EXPECT_CALL(mock_tpm_status_, IsTpmEnabled()).WillRepeatedly(Return(false));
+  EXPECT_CALL(mock_tpm_initializer_, PreInitializeTpm()).Times(0);
   EXPECT_CALL(mock_tpm_initializer_, InitializeTpm()).Times(0);
   SetupService();
   RunServiceWorkerAndQuit();
@@ -132,11 +146,67 @@ TEST_F(TpmManagerServiceTest_NoWaitForOwnership,
   Run();
 }
 
+TEST_F(TpmManagerServiceTest_NoWaitForOwnership,
+       AutoInitializeAfterPreInitializeFailure) {
+  EXPECT_CALL(mock_tpm_initializer_, PreInitializeTpm())
+      .WillOnce(Return(false));
+  EXPECT_CALL(mock_tpm_initializer_, InitializeTpm()).Times(1);
+  SetupService();
+  RunServiceWorkerAndQuit();
+}
+
+TEST_F(TpmManagerServiceTest_NoWaitForOwnership,
+       ReadsNotHeldBackByInitialization) {
+  // Hold pre-initialization until both requests are in.
+  base::WaitableEvent requests_sent(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  EXPECT_CALL(mock_tpm_initializer_, PreInitializeTpm())
+      .WillOnce(Invoke([&requests_sent]() {
+        requests_sent.Wait();
+        return true;
+      }));
+  {
+    // The read gets ahead of ownership; defining a space waits for it.
+    InSequence sequence;
+    EXPECT_CALL(mock_tpm_nvram_, ListSpaces(_))
+        .WillOnce(Return(NVRAM_RESULT_SUCCESS));
+    EXPECT_CALL(mock_tpm_initializer_, InitializeTpm()).WillOnce(Return(true));
+    EXPECT_CALL(mock_tpm_nvram_, DefineSpace(5, 4, _, _, _))
+        .WillOnce(Return(NVRAM_RESULT_SUCCESS));
+  }
+  SetupService();
+  service_->ListSpaces(ListSpacesRequest(),
+                       base::Bind([](const ListSpacesReply& reply) {}));
+  auto define_callback = [this](const DefineSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+    Quit();
+  };
+  DefineSpaceRequest define_request;
+  define_request.set_index(5);
+  define_request.set_size(4);
+  service_->DefineSpace(define_request, base::Bind(define_callback));
+  requests_sent.Signal();
+  Run();
+}
+
 TEST_F(TpmManagerServiceTest, NoAutoInitialize) {
   EXPECT_CALL(mock_tpm_initializer_, InitializeTpm()).Times(0);
   RunServiceWorkerAndQuit();
 }
 
+TEST_F(TpmManagerServiceTest, PreInitializeWhileWaitingForOwnership) {
+  // Start over with a service that is set up after the expectations.
+  service_.reset();
+  EXPECT_CALL(mock_tpm_initializer_, PreInitializeTpm()).Times(1);
+  EXPECT_CALL(mock_tpm_initializer_, InitializeTpm()).Times(0);
+  service_.reset(new TpmManagerService(
+      true /*wait_for_ownership*/, &mock_local_data_store_, &mock_tpm_status_,
+      &mock_tpm_initializer_, &mock_tpm_nvram_));
+  SetupService();
+  RunServiceWorkerAndQuit();
+}
+
 TEST_F(TpmManagerServiceTest, GetTpmStatusSuccess) {
   EXPECT_CALL(mock_tpm_status_, GetDictionaryAttackInfo(_, _, _, _))
       .WillRepeatedly(Invoke([](int* counter, int* threshold, bool* lockout,
@@ -218,6 +288,96 @@ TEST_F(TpmManagerServiceTest, TakeOwnershipSuccess) {
   Run();
 }
 
+TEST_F(TpmManagerServiceTest, GetTpmStatusDuringTakeOwnership) {
+  // Keep a status first.
+  base::RunLoop status_loop;
+  auto first_status_callback = [&status_loop](const GetTpmStatusReply& reply) {
+    status_loop.Quit();
+  };
+  service_->GetTpmStatus(GetTpmStatusRequest(),
+                         base::Bind(first_status_callback));
+  status_loop.Run();
+  // Ownership is held back until the status query sent after it is answered,
+  // which would never happen if the query waited for the worker thread.
+  base::WaitableEvent status_done(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  EXPECT_CALL(mock_tpm_initializer_, InitializeTpm())
+      .WillOnce(Invoke([&status_done]() {
+        status_done.Wait();
+        return true;
+      }));
+  auto ownership_callback = [this](const TakeOwnershipReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    Quit();
+  };
+  service_->TakeOwnership(TakeOwnershipRequest(),
+                          base::Bind(ownership_callback));
+  auto status_callback = [&status_done](const GetTpmStatusReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    status_done.Signal();
+  };
+  service_->GetTpmStatus(GetTpmStatusRequest(), base::Bind(status_callback));
+  Run();
+}
+
+TEST_F(TpmManagerServiceTest, GetTpmStatusKept) {
+  EXPECT_CALL(mock_tpm_status_, IsTpmOwned()).WillOnce(Return(true));
+  base::RunLoop status_loop;
+  auto first_status_callback = [&status_loop](const GetTpmStatusReply& reply) {
+    status_loop.Quit();
+  };
+  service_->GetTpmStatus(GetTpmStatusRequest(),
+                         base::Bind(first_status_callback));
+  status_loop.Run();
+  // Answered with the kept status without querying the TPM again.
+  auto callback = [](decltype(this) test, const GetTpmStatusReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    EXPECT_TRUE(reply.owned());
+    test->Quit();
+  };
+  service_->GetTpmStatus(GetTpmStatusRequest(),
+                         base::Bind(callback, base::Unretained(this)));
+  Run();
+}
+
+TEST_F(TpmManagerServiceTest, TpmStatusChangedAfterTakeOwnership) {
+  bool owned = false;
+  EXPECT_CALL(mock_tpm_status_, IsTpmOwned())
+      .WillRepeatedly(Invoke([&owned]() { return owned; }));
+  EXPECT_CALL(mock_tpm_initializer_, InitializeTpm())
+      .WillOnce(Invoke([&owned]() {
+        owned = true;
+        return true;
+      }));
+  LocalData local_data;
+  local_data.set_owner_password(kOwnerPassword);
+  EXPECT_CALL(mock_local_data_store_, Read(_))
+      .WillRepeatedly(DoAll(SetArgPointee<0>(local_data), Return(true)));
+  int changes = 0;
+  auto status_changed_callback = [this, &changes](
+      const GetTpmStatusReply& status) {
+    ++changes;
+    EXPECT_FALSE(status.has_local_data());
+    if (status.owned()) {
+      Quit();
+    }
+  };
+  service_->SetTpmStatusChangedCallback(base::Bind(status_changed_callback));
+  // The first status is reported as a change.
+  base::RunLoop status_loop;
+  auto status_callback = [&status_loop](const GetTpmStatusReply& reply) {
+    status_loop.Quit();
+  };
+  service_->GetTpmStatus(GetTpmStatusRequest(), base::Bind(status_callback));
+  status_loop.Run();
+  EXPECT_EQ(1, changes);
+  service_->TakeOwnership(TakeOwnershipRequest(),
+                          base::Bind([](const TakeOwnershipReply& reply) {}));
+  Run();
+  EXPECT_EQ(2, changes);
+}
+
 TEST_F(TpmManagerServiceTest, TakeOwnershipFailure) {
   EXPECT_CALL(mock_tpm_initializer_, InitializeTpm())
       .WillRepeatedly(Return(false));
@@ -253,8 +413,8 @@ TEST_F(TpmManagerServiceTest, RemoveOwnerDependencyReadFailure) {
   Run();
 }
 
-TEST_F(TpmManagerServiceTest, RemoveOwnerDependencyWriteFailure) {
-  EXPECT_CALL(mock_local_data_store_, Write(_)).WillRepeatedly(Return(false));
+TEST_F(TpmManagerServiceTest, RemoveOwnerDependencyCommitFailure) {
+  EXPECT_CALL(mock_local_data_store_, Commit()).WillRepeatedly(Return(false));
   auto callback = [](decltype(this) test, const RemoveOwnerDependencyReply& reply) {
     EXPECT_EQ(STATUS_DEVICE_ERROR, reply.status());
     test->Quit();
@@ -272,7 +432,7 @@ TEST_F(TpmManagerServiceTest, RemoveOwnerDependencyNotCleared) {
   local_data.add_owner_dependency(kOtherDependency);
   EXPECT_CALL(mock_local_data_store_, Read(_))
       .WillOnce(DoAll(SetArgPointee<0>(local_data), Return(true)));
-  EXPECT_CALL(mock_local_data_store_, Write(_))
+  EXPECT_CALL(mock_local_data_store_, WriteDeferred(_))
       .WillOnce(DoAll(SaveArg<0>(&local_data), Return(true)));
   auto callback = [](decltype(this) test, LocalData* local_data,
                      const RemoveOwnerDependencyReply& reply) {
@@ -297,7 +457,7 @@ TEST_F(TpmManagerServiceTest, RemoveOwnerDependencyCleared) {
   local_data.add_owner_dependency(kOwnerDependency);
   EXPECT_CALL(mock_local_data_store_, Read(_))
       .WillOnce(DoAll(SetArgPointee<0>(local_data), Return(true)));
-  EXPECT_CALL(mock_local_data_store_, Write(_))
+  EXPECT_CALL(mock_local_data_store_, WriteDeferred(_))
       .WillOnce(DoAll(SaveArg<0>(&local_data), Return(true)));
   auto callback = [](decltype(this) test, LocalData* local_data,
                      const RemoveOwnerDependencyReply& reply) {
@@ -320,7 +480,7 @@ TEST_F(TpmManagerServiceTest, RemoveOwnerDependencyNotPresent) {
   local_data.add_owner_dependency(kOwnerDependency);
   EXPECT_CALL(mock_local_data_store_, Read(_))
       .WillOnce(DoAll(SetArgPointee<0>(local_data), Return(true)));
-  EXPECT_CALL(mock_local_data_store_, Write(_))
+  EXPECT_CALL(mock_local_data_store_, WriteDeferred(_))
       .WillOnce(DoAll(SaveArg<0>(&local_data), Return(true)));
   auto callback = [](decltype(this) test, const LocalData& local_data,
                      const RemoveOwnerDependencyReply& reply) {
@@ -338,6 +498,33 @@ TEST_F(TpmManagerServiceTest, RemoveOwnerDependencyNotPresent) {
   Run();
 }
 
+TEST_F(TpmManagerServiceTest, RemoveOwnerDependencyGroupCommit) {
+  LocalData& local_data = mock_local_data_store_.GetMutableFakeData();
+  local_data.set_owner_password(kOwnerPassword);
+  local_data.add_owner_dependency(kOwnerDependency);
+  local_data.add_owner_dependency(kOtherDependency);
+  // Both requests are held until initialization is done and then queued
+  // together, so one commit covers both.
+  EXPECT_CALL(mock_local_data_store_, WriteDeferred(_)).Times(2);
+  EXPECT_CALL(mock_local_data_store_, Write(_)).Times(0);
+  EXPECT_CALL(mock_local_data_store_, Commit()).WillOnce(Return(true));
+  int replies = 0;
+  auto callback = [this, &replies](const RemoveOwnerDependencyReply& reply) {
+    EXPECT_EQ(STATUS_SUCCESS, reply.status());
+    if (++replies == 2) {
+      Quit();
+    }
+  };
+  RemoveOwnerDependencyRequest request;
+  request.set_owner_dependency(kOwnerDependency);
+  service_->RemoveOwnerDependency(request, base::Bind(callback));
+  request.set_owner_dependency(kOtherDependency);
+  service_->RemoveOwnerDependency(request, base::Bind(callback));
+  Run();
+  EXPECT_EQ(0, mock_local_data_store_.GetFakeData().owner_dependency_size());
+  EXPECT_FALSE(mock_local_data_store_.GetFakeData().has_owner_password());
+}
+
 TEST_F(TpmManagerServiceTest, DefineSpaceFailure) {
   uint32_t nvram_index = 5;
   size_t nvram_size = 32;
@@ -529,4 +716,288 @@ TEST_F(TpmManagerServiceTest, ReadWriteSpaceSuccess) {
   RunServiceWorkerAndQuit();
 }
 
+TEST_F(TpmManagerServiceTest, ReadWriteSpaceOffset) {
+  uint32_t nvram_index = 5;
+  auto define_callback = [](const DefineSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+  };
+  auto write_callback = [](const WriteSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+  };
+  auto read_callback = [](const ReadSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+    EXPECT_EQ("data", reply.data());
+  };
+  DefineSpaceRequest define_request;
+  define_request.set_index(nvram_index);
+  define_request.set_size(10);
+  service_->DefineSpace(define_request, base::Bind(define_callback));
+  WriteSpaceRequest write_request;
+  write_request.set_index(nvram_index);
+  write_request.set_offset(4);
+  write_request.set_data("data");
+  service_->WriteSpace(write_request, base::Bind(write_callback));
+  ReadSpaceRequest read_request;
+  read_request.set_index(nvram_index);
+  read_request.set_offset(4);
+  read_request.set_size(4);
+  service_->ReadSpace(read_request, base::Bind(read_callback));
+  RunServiceWorkerAndQuit();
+}
+
+TEST_F(TpmManagerServiceTest, DictionaryAttackLockoutFailsFast) {
+  EXPECT_CALL(mock_tpm_status_, GetDictionaryAttackInfo(_, _, _, _))
+      .WillRepeatedly(Invoke([](int* counter, int* threshold, bool* lockout,
+                                int* seconds_remaining) {
+        *counter = 10;
+        *threshold = 10;
+        *lockout = true;
+        *seconds_remaining = 600;
+        return true;
+      }));
+  // Asked once, when the counter is first seen to go up.
+  EXPECT_CALL(mock_tpm_initializer_, ResetDictionaryAttackLock())
+      .WillOnce(Return(false));
+  EXPECT_CALL(mock_tpm_nvram_, ReadSpace(_, _, _, _, "password")).Times(0);
+  auto read_callback = [](const ReadSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_ACCESS_DENIED, reply.result());
+  };
+  auto world_read_callback = [](const ReadSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SPACE_DOES_NOT_EXIST, reply.result());
+  };
+  // The status query reads the lockout state first.
+  service_->GetTpmStatus(GetTpmStatusRequest(),
+                         base::Bind([](const GetTpmStatusReply& reply) {}));
+  ReadSpaceRequest read_request;
+  read_request.set_index(5);
+  read_request.set_authorization_value("password");
+  service_->ReadSpace(read_request, base::Bind(read_callback));
+  // Commands without an authorization value are still sent.
+  read_request.clear_authorization_value();
+  service_->ReadSpace(read_request, base::Bind(world_read_callback));
+  RunServiceWorkerAndQuit();
+}
+
+TEST_F(TpmManagerServiceTest, DictionaryAttackResetAfterAccessDenied) {
+  EXPECT_CALL(mock_tpm_status_, GetDictionaryAttackInfo(_, _, _, _))
+      .WillOnce(Invoke([](int* counter, int* threshold, bool* lockout,
+                          int* seconds_remaining) {
+        *counter = 1;
+        *threshold = 10;
+        *lockout = false;
+        *seconds_remaining = 0;
+        return true;
+      }))
+      .WillRepeatedly(Return(false));
+  EXPECT_CALL(mock_tpm_initializer_, ResetDictionaryAttackLock())
+      .WillOnce(Return(true));
+  uint32_t nvram_index = 5;
+  auto define_callback = [](const DefineSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+  };
+  auto write_callback = [](const WriteSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_ACCESS_DENIED, reply.result());
+  };
+  DefineSpaceRequest define_request;
+  define_request.set_index(nvram_index);
+  define_request.set_size(4);
+  define_request.set_authorization_value("password");
+  service_->DefineSpace(define_request, base::Bind(define_callback));
+  WriteSpaceRequest write_request;
+  write_request.set_index(nvram_index);
+  write_request.set_data("data");
+  write_request.set_authorization_value("wrong");
+  service_->WriteSpace(write_request, base::Bind(write_callback));
+  RunServiceWorkerAndQuit();
+}
+
+TEST_F(TpmManagerServiceTest, IdenticalReadsCoalesced) {
+  // Reads are joined once initialization is done.
+  base::RunLoop status_loop;
+  auto status_callback = [&status_loop](const GetTpmStatusReply& reply) {
+    status_loop.Quit();
+  };
+  service_->GetTpmStatus(GetTpmStatusRequest(), base::Bind(status_callback));
+  status_loop.Run();
+  EXPECT_CALL(mock_tpm_nvram_, ReadSpace(5, _, _, _, "password"))
+      .WillOnce(DoAll(SetArgPointee<3>(std::string("data")),
+                      Return(NVRAM_RESULT_SUCCESS)));
+  // Other authorization values are not joined.
+  EXPECT_CALL(mock_tpm_nvram_, ReadSpace(5, _, _, _, "other"))
+      .WillOnce(Return(NVRAM_RESULT_ACCESS_DENIED));
+  int reply_count = 0;
+  auto read_callback = [&reply_count](const ReadSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+    EXPECT_EQ("data", reply.data());
+    ++reply_count;
+  };
+  auto other_read_callback = [&reply_count](const ReadSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_ACCESS_DENIED, reply.result());
+    ++reply_count;
+  };
+  ReadSpaceRequest read_request;
+  read_request.set_index(5);
+  read_request.set_authorization_value("password");
+  service_->ReadSpace(read_request, base::Bind(read_callback));
+  service_->ReadSpace(read_request, base::Bind(read_callback));
+  ReadSpaceRequest other_read_request = read_request;
+  other_read_request.set_authorization_value("other");
+  service_->ReadSpace(other_read_request, base::Bind(other_read_callback));
+  service_->ReadSpace(read_request, base::Bind(read_callback));
+  RunServiceWorkerAndQuit();
+  EXPECT_EQ(4, reply_count);
+}
+
+TEST_F(TpmManagerServiceTest, ReadAfterWriteNotCoalesced) {
+  base::RunLoop status_loop;
+  auto status_callback = [&status_loop](const GetTpmStatusReply& reply) {
+    status_loop.Quit();
+  };
+  service_->GetTpmStatus(GetTpmStatusRequest(), base::Bind(status_callback));
+  status_loop.Run();
+  auto define_callback = [](const DefineSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+  };
+  auto write_callback = [](const WriteSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+  };
+  auto first_read_callback = [](const ReadSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+    EXPECT_EQ("old", reply.data());
+  };
+  auto second_read_callback = [](const ReadSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+    EXPECT_EQ("new", reply.data());
+  };
+  DefineSpaceRequest define_request;
+  define_request.set_index(5);
+  define_request.set_size(3);
+  service_->DefineSpace(define_request, base::Bind(define_callback));
+  WriteSpaceRequest write_request;
+  write_request.set_index(5);
+  write_request.set_data("old");
+  service_->WriteSpace(write_request, base::Bind(write_callback));
+  ReadSpaceRequest read_request;
+  read_request.set_index(5);
+  service_->ReadSpace(read_request, base::Bind(first_read_callback));
+  write_request.set_data("new");
+  service_->WriteSpace(write_request, base::Bind(write_callback));
+  service_->ReadSpace(read_request, base::Bind(second_read_callback));
+  RunServiceWorkerAndQuit();
+}
+
+TEST_F(TpmManagerServiceTest, ReadSpaceBatch) {
+  uint32_t nvram_index = 5;
+  std::string nvram_data("nvram_data");
+  auto define_callback = [](const DefineSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+  };
+  auto write_callback = [](const WriteSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+  };
+  auto read_callback = [](const std::string& nvram_data,
+                          const ReadSpaceBatchReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+    ASSERT_EQ(2, reply.replies_size());
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.replies(0).result());
+    EXPECT_EQ(nvram_data, reply.replies(0).data());
+    EXPECT_EQ(NVRAM_RESULT_SPACE_DOES_NOT_EXIST, reply.replies(1).result());
+  };
+  DefineSpaceRequest define_request;
+  define_request.set_index(nvram_index);
+  define_request.set_size(nvram_data.size());
+  service_->DefineSpace(define_request, base::Bind(define_callback));
+  WriteSpaceRequest write_request;
+  write_request.set_index(nvram_index);
+  write_request.set_data(nvram_data);
+  service_->WriteSpace(write_request, base::Bind(write_callback));
+  ReadSpaceBatchRequest read_request;
+  read_request.add_requests()->set_index(nvram_index);
+  read_request.add_requests()->set_index(nvram_index + 1);
+  service_->ReadSpaceBatch(read_request, base::Bind(read_callback, nvram_data));
+  RunServiceWorkerAndQuit();
+}
+
+TEST_F(TpmManagerServiceTest, GetSpaceInfoBatch) {
+  uint32_t nvram_size = 32;
+  auto define_callback = [](const DefineSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+  };
+  auto info_callback = [](uint32_t nvram_size,
+                          const GetSpaceInfoBatchReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+    ASSERT_EQ(3, reply.replies_size());
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.replies(0).result());
+    EXPECT_EQ(nvram_size, reply.replies(0).size());
+    EXPECT_EQ(NVRAM_RESULT_SPACE_DOES_NOT_EXIST, reply.replies(1).result());
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.replies(2).result());
+    EXPECT_EQ(nvram_size * 2, reply.replies(2).size());
+  };
+  DefineSpaceRequest define_request;
+  define_request.set_index(5);
+  define_request.set_size(nvram_size);
+  service_->DefineSpace(define_request, base::Bind(define_callback));
+  define_request.set_index(7);
+  define_request.set_size(nvram_size * 2);
+  service_->DefineSpace(define_request, base::Bind(define_callback));
+  GetSpaceInfoBatchRequest info_request;
+  info_request.add_index_list(5);
+  info_request.add_index_list(6);
+  info_request.add_index_list(7);
+  service_->GetSpaceInfoBatch(info_request,
+                              base::Bind(info_callback, nvram_size));
+  RunServiceWorkerAndQuit();
+}
+
+TEST_F(TpmManagerServiceTest, DefineSpaceBatch) {
+  uint32_t nvram_size = 32;
+  auto existing_callback = [](const DefineSpaceReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+  };
+  auto define_callback = [](const DefineSpaceBatchReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+    ASSERT_EQ(2, reply.replies_size());
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.replies(0).result());
+    EXPECT_EQ(NVRAM_RESULT_SPACE_ALREADY_EXISTS, reply.replies(1).result());
+  };
+  auto list_callback = [](const ListSpacesReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+    ASSERT_EQ(2, reply.index_list_size());
+    EXPECT_EQ(5u, reply.index_list(0));
+    EXPECT_EQ(7u, reply.index_list(1));
+  };
+  DefineSpaceRequest existing_request;
+  existing_request.set_index(7);
+  existing_request.set_size(nvram_size);
+  service_->DefineSpace(existing_request, base::Bind(existing_callback));
+  DefineSpaceBatchRequest define_request;
+  DefineSpaceRequest* space_request = define_request.add_requests();
+  space_request->set_index(5);
+  space_request->set_size(nvram_size);
+  space_request->add_attributes(NVRAM_PERSISTENT_WRITE_LOCK);
+  *define_request.add_requests() = existing_request;
+  service_->DefineSpaceBatch(define_request, base::Bind(define_callback));
+  service_->ListSpaces(ListSpacesRequest(), base::Bind(list_callback));
+  RunServiceWorkerAndQuit();
+}
+
+TEST_F(TpmManagerServiceTest, DefineSpaceBatchInvalid) {
+  auto define_callback = [](const DefineSpaceBatchReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_INVALID_PARAMETER, reply.result());
+    EXPECT_EQ(0, reply.replies_size());
+  };
+  auto list_callback = [](const ListSpacesReply& reply) {
+    EXPECT_EQ(NVRAM_RESULT_SUCCESS, reply.result());
+    EXPECT_EQ(0, reply.index_list_size());
+  };
+  DefineSpaceBatchRequest define_request;
+  define_request.add_requests()->set_index(5);
+  define_request.mutable_requests(0)->set_size(32);
+  // A size of zero is rejected, so neither space is defined.
+  define_request.add_requests()->set_index(6);
+  service_->DefineSpaceBatch(define_request, base::Bind(define_callback));
+  service_->ListSpaces(ListSpacesRequest(), base::Bind(list_callback));
+  RunServiceWorkerAndQuit();
+}
+
 }  // namespace tpm_manager
@@ -24,6 +24,15 @@
 
 namespace tpm_manager {
 
+// The arguments of one TpmNvram::DefineSpace() call.
+struct NvramSpaceDefinition {
+  uint32_t index = 0;
+  size_t size = 0;
+  std::vector<NvramSpaceAttribute> attributes;
+  std::string authorization_value;
+  NvramSpacePolicy policy = NVRAM_POLICY_NONE;
+};
+
 // TpmNvram is an interface for working with TPM NVRAM.
 class TpmNvram {
  public:
@@ -38,18 +47,32 @@ class TpmNvram {
       const std::string& authorization_value,
       NvramSpacePolicy policy) = 0;
 
+  // Creates each of the NVRAM |spaces| as DefineSpace() would and sets
+  // |results| to the result for each, in the same order. All |spaces| are
+  // checked before any is created; if one is invalid or an index is repeated
+  // none are created and NVRAM_RESULT_INVALID_PARAMETER is returned. Returns
+  // NVRAM_RESULT_SUCCESS unless the batch could not be processed at all.
+  virtual NvramResult DefineSpaces(
+      const std::vector<NvramSpaceDefinition>& spaces,
+      std::vector<NvramResult>* results) = 0;
+
   // Destroys an NVRAM space in the TPM. Returns true on success.
   virtual NvramResult DestroySpace(uint32_t index) = 0;
 
-  // Writes |data| to the NVRAM space at |index|. The size of |data| must be
-  // equal or less than the size of the NVRAM space. Returns true on success.
+  // Writes |data| to the NVRAM space at |index|, starting |offset| bytes into
+  // the space. |data| must fit in the space from |offset| on. Returns true on
+  // success.
   virtual NvramResult WriteSpace(uint32_t index,
+                                 uint32_t offset,
                                  const std::string& data,
                                  const std::string& authorization_value) = 0;
 
-  // Reads all the |data| in the NVRAM space at |index|. Returns true on
-  // success.
+  // Reads |size| bytes of |data| from the NVRAM space at |index|, starting
+  // |offset| bytes into the space. A |size| of 0 reads up to the end of the
+  // space. Returns true on success.
   virtual NvramResult ReadSpace(uint32_t index,
+                                uint32_t offset,
+                                uint32_t size,
                                 std::string* data,
                                 const std::string& authorization_value) = 0;
 
@@ -18,6 +18,7 @@
 
 #include <arpa/inet.h>
 
+#include <set>
 #include <string>
 
 #include <base/logging.h>
@@ -103,7 +104,10 @@ TPM_NV_PER_ATTRIBUTES MapAttributesToTpm(
   return tpm_flags;
 }
 
-NvramResult MapTpmError(TSS_RESULT tpm_error) {
+// Maps |tpm_error| from a call made through |connection|, which is given the
+// chance to drop a broken context.
+NvramResult MapTpmError(TSS_RESULT tpm_error, TpmConnection* connection) {
+  connection->HandleError(tpm_error);
   switch (TPM_ERROR(tpm_error)) {
     case TPM_SUCCESS:
       return NVRAM_RESULT_SUCCESS;
@@ -142,13 +146,15 @@ NvramResult TpmNvramImpl::DefineSpace(
     const std::vector<NvramSpaceAttribute>& attributes,
     const std::string& authorization_value,
     NvramSpacePolicy policy) {
+  space_info_.erase(index);
+  space_list_loaded_ = false;
   std::string owner_password;
   if (!GetOwnerPassword(&owner_password)) {
     return NVRAM_RESULT_OPERATION_DISABLED;
   }
-  TpmConnection owner_connection(owner_password);
-  ScopedTssNvStore nv_handle(owner_connection.GetContext());
-  if (!InitializeNvramHandle(index, &nv_handle, &owner_connection)) {
+  TpmConnection* owner_connection = GetOwnerConnection(owner_password);
+  ScopedTssNvStore nv_handle(owner_connection->GetContext());
+  if (!InitializeNvramHandle(index, &nv_handle, owner_connection)) {
     return NVRAM_RESULT_DEVICE_ERROR;
   }
   TSS_RESULT result;
@@ -166,14 +172,14 @@ NvramResult TpmNvramImpl::DefineSpace(
   }
   // Set authorization.
   if (!authorization_value.empty() &&
-      !SetUsagePolicy(authorization_value, &nv_handle, &owner_connection)) {
+      !SetUsagePolicy(authorization_value, &nv_handle, owner_connection)) {
     return NVRAM_RESULT_DEVICE_ERROR;
   }
   // Bind to PCR0.
   TSS_HPCRS pcr_handle = 0;
-  ScopedTssPcrs scoped_pcr_handle(owner_connection.GetContext());
+  ScopedTssPcrs scoped_pcr_handle(owner_connection->GetContext());
   if (policy == NVRAM_POLICY_PCR0) {
-    if (!SetCompositePcr0(&scoped_pcr_handle, &owner_connection)) {
+    if (!SetCompositePcr0(&scoped_pcr_handle, owner_connection)) {
       return NVRAM_RESULT_DEVICE_ERROR;
     }
     pcr_handle = scoped_pcr_handle;
@@ -182,38 +188,65 @@ NvramResult TpmNvramImpl::DefineSpace(
                                pcr_handle /*Write*/);
   if (TPM_ERROR(result)) {
     TPM_LOG(ERROR, result) << "Could not define NVRAM space: " << index;
-    return MapTpmError(result);
+    return MapTpmError(result, owner_connection);
+  }
+  return NVRAM_RESULT_SUCCESS;
+}
+
+NvramResult TpmNvramImpl::DefineSpaces(
+    const std::vector<NvramSpaceDefinition>& spaces,
+    std::vector<NvramResult>* results) {
+  // TPM 1.2 spaces have no policy records to persist, so each space is simply
+  // defined in turn over the cached owner connection.
+  std::set<uint32_t> indexes;
+  for (const NvramSpaceDefinition& space : spaces) {
+    if (!indexes.insert(space.index).second) {
+      LOG(ERROR) << "NVRAM index repeated in batch: " << space.index;
+      return NVRAM_RESULT_INVALID_PARAMETER;
+    }
+  }
+  results->clear();
+  for (const NvramSpaceDefinition& space : spaces) {
+    results->push_back(DefineSpace(space.index, space.size, space.attributes,
+                                   space.authorization_value, space.policy));
   }
   return NVRAM_RESULT_SUCCESS;
 }
 
 NvramResult TpmNvramImpl::DestroySpace(uint32_t index) {
+  space_info_.erase(index);
+  space_list_loaded_ = false;
   std::string owner_password;
   if (!GetOwnerPassword(&owner_password)) {
     return NVRAM_RESULT_OPERATION_DISABLED;
   }
-  TpmConnection owner_connection(owner_password);
-  ScopedTssNvStore nv_handle(owner_connection.GetContext());
-  if (!InitializeNvramHandle(index, &nv_handle, &owner_connection)) {
+  TpmConnection* owner_connection = GetOwnerConnection(owner_password);
+  ScopedTssNvStore nv_handle(owner_connection->GetContext());
+  if (!InitializeNvramHandle(index, &nv_handle, owner_connection)) {
     return NVRAM_RESULT_DEVICE_ERROR;
   }
   TSS_RESULT result = Tspi_NV_ReleaseSpace(nv_handle);
   if (TPM_ERROR(result)) {
     TPM_LOG(ERROR, result) << "Could not release NVRAM space: " << index;
-    return MapTpmError(result);
+    return MapTpmError(result, owner_connection);
   }
   return NVRAM_RESULT_SUCCESS;
 }
 
 NvramResult TpmNvramImpl::WriteSpace(uint32_t index,
+                                     uint32_t offset,
                                      const std::string& data,
                                      const std::string& authorization_value) {
+  size_t nvram_size;
   std::vector<NvramSpaceAttribute> attributes;
   NvramResult result =
-      GetSpaceInfo(index, nullptr, nullptr, nullptr, &attributes, nullptr);
+      GetSpaceInfo(index, &nvram_size, nullptr, nullptr, &attributes, nullptr);
   if (result != NVRAM_RESULT_SUCCESS) {
     return result;
   }
+  if (offset > nvram_size || data.size() > nvram_size - offset) {
+    return NVRAM_RESULT_INVALID_PARAMETER;
+  }
   ScopedTssNvStore nv_handle(tpm_connection_.GetContext());
   if (!InitializeNvramHandle(index, &nv_handle, &tpm_connection_)) {
     return NVRAM_RESULT_DEVICE_ERROR;
@@ -233,16 +266,19 @@ NvramResult TpmNvramImpl::WriteSpace(uint32_t index,
     }
   }
   TSS_RESULT tpm_result = Tspi_NV_WriteValue(
-      nv_handle, 0 /* offset */, data.size(),
+      nv_handle, offset, data.size(),
       reinterpret_cast<BYTE*>(const_cast<char*>(data.data())));
   if (TPM_ERROR(tpm_result)) {
     TPM_LOG(ERROR, tpm_result) << "Could not write to NVRAM space: " << index;
-    return MapTpmError(tpm_result);
+    space_info_.erase(index);
+    return MapTpmError(tpm_result, &tpm_connection_);
   }
   return NVRAM_RESULT_SUCCESS;
 }
 
 NvramResult TpmNvramImpl::ReadSpace(uint32_t index,
+                                    uint32_t offset,
+                                    uint32_t size,
                                     std::string* data,
                                     const std::string& authorization_value) {
   CHECK(data);
@@ -253,6 +289,12 @@ NvramResult TpmNvramImpl::ReadSpace(uint32_t index,
   if (result != NVRAM_RESULT_SUCCESS) {
     return result;
   }
+  if (offset > nvram_size || size > nvram_size - offset) {
+    return NVRAM_RESULT_INVALID_PARAMETER;
+  }
+  if (size == 0) {
+    size = nvram_size - offset;
+  }
   ScopedTssNvStore nv_handle(tpm_connection_.GetContext());
   if (!InitializeNvramHandle(index, &nv_handle, &tpm_connection_)) {
     return NVRAM_RESULT_DEVICE_ERROR;
@@ -271,31 +313,31 @@ NvramResult TpmNvramImpl::ReadSpace(uint32_t index,
       break;
     }
   }
-  data->resize(nvram_size);
-  // The Tpm1.2 Specification defines the maximum read size of 128 bytes.
-  // Therefore we have to loop through the data returned.
-  const size_t kMaxDataSize = 128;
-  uint32_t offset = 0;
-  while (offset < nvram_size) {
-    uint32_t chunk_size = std::min(nvram_size - offset, kMaxDataSize);
+  data->resize(size);
+  // The TPM limits how much a single read returns, so loop through the data.
+  const uint32_t max_chunk_size = GetReadChunkSize();
+  uint32_t read = 0;
+  while (read < size) {
+    uint32_t chunk_size = std::min(size - read, max_chunk_size);
     ScopedTssMemory space_data(tpm_connection_.GetContext());
-    TSS_RESULT tpm_result =
-        Tspi_NV_ReadValue(nv_handle, offset, &chunk_size, space_data.ptr());
+    TSS_RESULT tpm_result = Tspi_NV_ReadValue(nv_handle, offset + read,
+                                              &chunk_size, space_data.ptr());
     if (TPM_ERROR(tpm_result)) {
       TPM_LOG(ERROR, tpm_result) << "Could not read from NVRAM space: "
                                  << index;
       data->clear();
-      return MapTpmError(tpm_result);
+      space_info_.erase(index);
+      return MapTpmError(tpm_result, &tpm_connection_);
     }
     if (!space_data.value()) {
       LOG(ERROR) << "No data read from NVRAM space: " << index;
       data->clear();
       return NVRAM_RESULT_DEVICE_ERROR;
     }
-    CHECK_LE((offset + chunk_size), data->size());
-    data->replace(offset, chunk_size,
+    CHECK_LE((read + chunk_size), data->size());
+    data->replace(read, chunk_size,
                   reinterpret_cast<char*>(space_data.value()), chunk_size);
-    offset += chunk_size;
+    read += chunk_size;
   }
   return NVRAM_RESULT_SUCCESS;
 }
@@ -310,6 +352,8 @@ NvramResult TpmNvramImpl::LockSpace(uint32_t index,
   if (result != NVRAM_RESULT_SUCCESS) {
     return result;
   }
+  // The lock state is about to change.
+  space_info_.erase(index);
   if (lock_read) {
     ScopedTssNvStore nv_handle(tpm_connection_.GetContext());
     if (!InitializeNvramHandle(index, &nv_handle, &tpm_connection_)) {
@@ -337,7 +381,7 @@ NvramResult TpmNvramImpl::LockSpace(uint32_t index,
     if (TPM_ERROR(tpm_result)) {
       TPM_LOG(ERROR, tpm_result) << "Could not lock read for NVRAM space: "
                                  << index;
-      return MapTpmError(tpm_result);
+      return MapTpmError(tpm_result, &tpm_connection_);
     }
   }
   if (lock_write) {
@@ -365,13 +409,18 @@ NvramResult TpmNvramImpl::LockSpace(uint32_t index,
     if (TPM_ERROR(tpm_result)) {
       TPM_LOG(ERROR, tpm_result) << "Could not lock write for NVRAM space: "
                                  << index;
-      return MapTpmError(tpm_result);
+      return MapTpmError(tpm_result, &tpm_connection_);
     }
   }
   return NVRAM_RESULT_SUCCESS;
 }
 
 NvramResult TpmNvramImpl::ListSpaces(std::vector<uint32_t>* index_list) {
+  if (space_list_loaded_) {
+    index_list->insert(index_list->end(), space_list_.begin(),
+                       space_list_.end());
+    return NVRAM_RESULT_SUCCESS;
+  }
   uint32_t nv_list_data_length = 0;
   ScopedTssMemory nv_list_data(tpm_connection_.GetContext());
   TSS_RESULT result =
@@ -379,15 +428,18 @@ NvramResult TpmNvramImpl::ListSpaces(std::vector<uint32_t>* index_list) {
                              nullptr, &nv_list_data_length, nv_list_data.ptr());
   if (TPM_ERROR(result)) {
     TPM_LOG(ERROR, result) << "Error calling Tspi_TPM_GetCapability";
-    return MapTpmError(result);
+    return MapTpmError(result, &tpm_connection_);
   }
   // Walk the list and check if the index exists.
   uint32_t* nv_list = reinterpret_cast<uint32_t*>(nv_list_data.value());
   uint32_t nv_list_length = nv_list_data_length / sizeof(uint32_t);
+  space_list_.clear();
   for (uint32_t i = 0; i < nv_list_length; ++i) {
     // TPM data is network byte order.
-    index_list->push_back(ntohl(nv_list[i]));
+    space_list_.push_back(ntohl(nv_list[i]));
   }
+  space_list_loaded_ = true;
+  index_list->insert(index_list->end(), space_list_.begin(), space_list_.end());
   return NVRAM_RESULT_SUCCESS;
 }
 
@@ -398,6 +450,35 @@ NvramResult TpmNvramImpl::GetSpaceInfo(
     bool* is_write_locked,
     std::vector<NvramSpaceAttribute>* attributes,
     NvramSpacePolicy* policy) {
+  auto iter = space_info_.find(index);
+  if (iter == space_info_.end()) {
+    SpaceInfo info;
+    NvramResult result = ReadSpaceInfo(index, &info);
+    if (result != NVRAM_RESULT_SUCCESS) {
+      return result;
+    }
+    iter = space_info_.emplace(index, info).first;
+  }
+  const SpaceInfo& info = iter->second;
+  if (size) {
+    *size = info.size;
+  }
+  if (is_read_locked) {
+    *is_read_locked = info.is_read_locked;
+  }
+  if (is_write_locked) {
+    *is_write_locked = info.is_write_locked;
+  }
+  if (attributes) {
+    *attributes = info.attributes;
+  }
+  if (policy) {
+    *policy = info.policy;
+  }
+  return NVRAM_RESULT_SUCCESS;
+}
+
+NvramResult TpmNvramImpl::ReadSpaceInfo(uint32_t index, SpaceInfo* space_info) {
   UINT32 nv_index_data_length = 0;
   ScopedTssMemory nv_index_data(tpm_connection_.GetContext());
   TSS_RESULT result =
@@ -406,7 +487,7 @@ NvramResult TpmNvramImpl::GetSpaceInfo(
                              &nv_index_data_length, nv_index_data.ptr());
   if (TPM_ERROR(result)) {
     TPM_LOG(ERROR, result) << "Error calling Tspi_TPM_GetCapability";
-    return MapTpmError(result);
+    return MapTpmError(result, &tpm_connection_);
   }
   UINT64 offset = 0;
   Trspi_UnloadBlob_NV_DATA_PUBLIC(&offset, nv_index_data.value(), nullptr);
@@ -422,29 +503,48 @@ NvramResult TpmNvramImpl::GetSpaceInfo(
     TPM_LOG(ERROR, result) << "Error calling Trspi_UnloadBlob_NV_DATA_PUBLIC";
     return NVRAM_RESULT_DEVICE_ERROR;
   }
-  if (size) {
-    *size = info.dataSize;
-  }
-  if (is_read_locked) {
-    *is_read_locked = info.bReadSTClear;
-  }
-  if (is_write_locked) {
-    *is_write_locked = info.bWriteSTClear || info.bWriteDefine;
-  }
-  if (attributes) {
-    MapAttributesFromTpm(info.permission.attributes, attributes);
-  }
-  if (policy) {
-    if (info.pcrInfoWrite.pcrSelection.sizeOfSelect > 0 &&
-        (info.pcrInfoWrite.pcrSelection.pcrSelect[0] & 1) != 0) {
-      *policy = NVRAM_POLICY_PCR0;
-    } else {
-      *policy = NVRAM_POLICY_NONE;
-    }
+  space_info->size = info.dataSize;
+  space_info->is_read_locked = info.bReadSTClear;
+  space_info->is_write_locked = info.bWriteSTClear || info.bWriteDefine;
+  space_info->attributes.clear();
+  MapAttributesFromTpm(info.permission.attributes, &space_info->attributes);
+  if (info.pcrInfoWrite.pcrSelection.sizeOfSelect > 0 &&
+      (info.pcrInfoWrite.pcrSelection.pcrSelect[0] & 1) != 0) {
+    space_info->policy = NVRAM_POLICY_PCR0;
+  } else {
+    space_info->policy = NVRAM_POLICY_NONE;
   }
   return NVRAM_RESULT_SUCCESS;
 }
 
+uint32_t TpmNvramImpl::GetReadChunkSize() {
+  // A TPM has at least room for this much, which is what used to be read.
+  const uint32_t kMinChunkSize = 128;
+  // Room in the buffer for the response header, size and authorization.
+  const uint32_t kResponseOverhead = 64;
+  if (read_chunk_size_ != 0) {
+    return read_chunk_size_;
+  }
+  UINT32 sub_capability = TSS_TPMCAP_PROP_INPUTBUFFERSIZE;
+  UINT32 length = 0;
+  ScopedTssMemory buffer_size_data(tpm_connection_.GetContext());
+  TSS_RESULT result = Tspi_TPM_GetCapability(
+      tpm_connection_.GetTpm(), TSS_TPMCAP_PROPERTY, sizeof(sub_capability),
+      reinterpret_cast<BYTE*>(&sub_capability), &length,
+      buffer_size_data.ptr());
+  if (TPM_ERROR(result) || length != sizeof(UINT32)) {
+    TPM_LOG(WARNING, result) << "Could not get the TPM input buffer size.";
+    return kMinChunkSize;
+  }
+  // The TSS returns the property in host byte order.
+  UINT32 buffer_size = *reinterpret_cast<UINT32*>(buffer_size_data.value());
+  read_chunk_size_ = kMinChunkSize;
+  if (buffer_size > kMinChunkSize + kResponseOverhead) {
+    read_chunk_size_ = buffer_size - kResponseOverhead;
+  }
+  return read_chunk_size_;
+}
+
 bool TpmNvramImpl::InitializeNvramHandle(uint32_t index,
                                          ScopedTssNvStore* nv_handle,
                                          TpmConnection* connection) {
@@ -545,4 +645,13 @@ bool TpmNvramImpl::GetOwnerPassword(std::string* owner_password) {
   return true;
 }
 
+TpmConnection* TpmNvramImpl::GetOwnerConnection(
+    const std::string& owner_password) {
+  if (!owner_connection_ ||
+      owner_connection_->authorization_value() != owner_password) {
+    owner_connection_.reset(new TpmConnection(owner_password));
+  }
+  return owner_connection_.get();
+}
+
 }  // namespace tpm_manager
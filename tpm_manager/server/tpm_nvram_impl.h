@@ -21,7 +21,10 @@
 
 #include <stdint.h>
 
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <base/macros.h>
 #include <trousers/scoped_tss_type.h>
@@ -44,11 +47,16 @@ class TpmNvramImpl : public TpmNvram {
                           const std::vector<NvramSpaceAttribute>& attributes,
                           const std::string& authorization_value,
                           NvramSpacePolicy policy) override;
+  NvramResult DefineSpaces(const std::vector<NvramSpaceDefinition>& spaces,
+                           std::vector<NvramResult>* results) override;
   NvramResult DestroySpace(uint32_t index) override;
   NvramResult WriteSpace(uint32_t index,
+                         uint32_t offset,
                          const std::string& data,
                          const std::string& authorization_value) override;
   NvramResult ReadSpace(uint32_t index,
+                        uint32_t offset,
+                        uint32_t size,
                         std::string* data,
                         const std::string& authorization_value) override;
   NvramResult LockSpace(uint32_t index,
@@ -65,6 +73,23 @@ class TpmNvramImpl : public TpmNvram {
       NvramSpacePolicy* policy) override;
 
  private:
+  // The public information of an NVRAM space as GetSpaceInfo returns it.
+  struct SpaceInfo {
+    size_t size = 0;
+    bool is_read_locked = false;
+    bool is_write_locked = false;
+    std::vector<NvramSpaceAttribute> attributes;
+    NvramSpacePolicy policy = NVRAM_POLICY_NONE;
+  };
+
+  // Reads the public information of the space at |index| from the TPM into
+  // |space_info|.
+  NvramResult ReadSpaceInfo(uint32_t index, SpaceInfo* space_info);
+
+  // Returns how many bytes a single NV read may ask for, derived from the TPM
+  // input buffer size the first time it is known.
+  uint32_t GetReadChunkSize();
+
   // This method creates and initializes the nvram object associated with
   // |handle| at |index|. Returns true on success, else false.
   bool InitializeNvramHandle(uint32_t index,
@@ -90,9 +115,26 @@ class TpmNvramImpl : public TpmNvram {
   // non empty owner_password off disk, else false.
   bool GetOwnerPassword(std::string* owner_password);
 
+  // Returns a connection with |owner_password| set for the TPM object. The
+  // connection is kept for as long as the owner password stays the same.
+  TpmConnection* GetOwnerConnection(const std::string& owner_password);
+
   LocalDataStore* local_data_store_;
   // A default non-owner connection.
   TpmConnection tpm_connection_;
+  // The owner connection from GetOwnerConnection, if any.
+  std::unique_ptr<TpmConnection> owner_connection_;
+  // Space information by NV index, kept across calls. Entries are dropped by
+  // any call from here that could change them and after a failed read or
+  // write. The lock bits that clear at TPM startup only clear on a reboot,
+  // which starts over with an empty map.
+  std::map<uint32_t, SpaceInfo> space_info_;
+  // The indexes of all spaces, valid if |space_list_loaded_|. Only spaces
+  // defined or destroyed from here change the list, and a TPM clear reboots
+  // the device.
+  std::vector<uint32_t> space_list_;
+  bool space_list_loaded_ = false;
+  uint32_t read_chunk_size_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(TpmNvramImpl);
 };
@@ -79,6 +79,25 @@
         'proto_library',
       ]
     },
+    # A load benchmark for tpm_managerd.
+    {
+      'target_name': 'tpm_manager_bench',
+      'type': 'executable',
+      'sources': [
+        'client/tpm_manager_bench.cc',
+      ],
+      'conditions': [
+        ['USE_tpm2 == 1', {
+          'libraries': [
+            '-ltrunks',
+          ],
+        }],
+      ],
+      'dependencies': [
+        'libtpm_manager',
+        'proto_library',
+      ]
+    },
     # A library for server code.
     {
       'target_name': 'server_library',
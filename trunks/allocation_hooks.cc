@@ -0,0 +1,84 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Replaces the global allocation functions so ScopedAllocationTag can count
+// heap allocations. Only binaries which opt into allocation tracking link this;
+// with tracking disabled each allocation costs one extra relaxed atomic load.
+
+#include <stdlib.h>
+
+#include <new>
+
+#include "trunks/allocation_profile.h"
+
+namespace {
+
+void* Allocate(size_t size) {
+  trunks::RecordAllocation(size);
+  void* pointer = malloc(size ? size : 1);
+  if (!pointer) {
+    // Exceptions are disabled, so failing to allocate is fatal.
+    abort();
+  }
+  return pointer;
+}
+
+void* AllocateNoThrow(size_t size) {
+  trunks::RecordAllocation(size);
+  return malloc(size ? size : 1);
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+  return Allocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return AllocateNoThrow(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return AllocateNoThrow(size);
+}
+
+void operator delete(void* pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+  free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+  free(pointer);
+}
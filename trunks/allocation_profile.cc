@@ -0,0 +1,152 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/allocation_profile.h"
+
+#include <atomic>
+
+#include <base/lazy_instance.h>
+#include <base/logging.h>
+#include <base/threading/thread_local.h>
+
+#include "trunks/interface.pb.h"
+#include "trunks/tpm_generated.h"
+
+namespace {
+
+// The offset of the command code in a TPM command header: tag (2 bytes)
+// followed by size (4 bytes).
+const size_t kCommandCodeOffset = 6;
+
+// Counts are kept per standard command code; slot zero counts every other code.
+const size_t kNumCommandSlots = trunks::TPM_CC_LAST - trunks::TPM_CC_FIRST + 2;
+
+struct AllocationCounts {
+  std::atomic<uint64_t> allocations;
+  std::atomic<uint64_t> bytes;
+};
+
+std::atomic<bool> g_tracking_enabled(false);
+
+// Zero-initialized static storage; nothing here may allocate since it is used
+// from operator new.
+AllocationCounts g_counts[trunks::kNumAllocationLayers][kNumCommandSlots];
+
+base::LazyInstance<base::ThreadLocalPointer<trunks::ScopedAllocationTag>>::
+    Leaky g_current_tag = LAZY_INSTANCE_INITIALIZER;
+
+size_t GetCommandSlot(uint32_t command_code) {
+  if (command_code < trunks::TPM_CC_FIRST ||
+      command_code > trunks::TPM_CC_LAST) {
+    return 0;
+  }
+  return command_code - trunks::TPM_CC_FIRST + 1;
+}
+
+}  // namespace
+
+namespace trunks {
+
+ScopedAllocationTag::ScopedAllocationTag(AllocationLayer layer,
+                                         uint32_t command_code) {
+  if (IsAllocationTrackingEnabled()) {
+    Enter(layer, command_code);
+  }
+}
+
+ScopedAllocationTag::ScopedAllocationTag(AllocationLayer layer,
+                                         const std::string& command) {
+  if (!IsAllocationTrackingEnabled()) {
+    return;
+  }
+  uint32_t command_code = 0;
+  if (command.size() >= kCommandCodeOffset + sizeof(command_code)) {
+    for (size_t i = 0; i < sizeof(command_code); ++i) {
+      command_code = (command_code << 8) |
+                     static_cast<uint8_t>(command[kCommandCodeOffset + i]);
+    }
+  }
+  Enter(layer, command_code);
+}
+
+ScopedAllocationTag::~ScopedAllocationTag() {
+  if (active_) {
+    DCHECK_EQ(this, GetCurrent()) << "Allocation tags must nest.";
+    g_current_tag.Pointer()->Set(outer_);
+  }
+}
+
+// static
+ScopedAllocationTag* ScopedAllocationTag::GetCurrent() {
+  return g_current_tag.Pointer()->Get();
+}
+
+void ScopedAllocationTag::Enter(AllocationLayer layer, uint32_t command_code) {
+  outer_ = GetCurrent();
+  layer_ = layer;
+  command_code_ = command_code;
+  if (command_code_ == 0 && outer_) {
+    command_code_ = outer_->command_code_;
+  }
+  active_ = true;
+  g_current_tag.Pointer()->Set(this);
+}
+
+void EnableAllocationTracking(bool enabled) {
+  g_tracking_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsAllocationTrackingEnabled() {
+  return g_tracking_enabled.load(std::memory_order_relaxed);
+}
+
+void RecordAllocation(size_t size) {
+  if (!IsAllocationTrackingEnabled()) {
+    return;
+  }
+  AllocationLayer layer = kAllocationLayerOther;
+  uint32_t command_code = 0;
+  ScopedAllocationTag* tag = ScopedAllocationTag::GetCurrent();
+  if (tag) {
+    layer = tag->layer();
+    command_code = tag->command_code();
+  }
+  AllocationCounts& counts = g_counts[layer][GetCommandSlot(command_code)];
+  counts.allocations.fetch_add(1, std::memory_order_relaxed);
+  counts.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void GetAllocationStats(std::vector<AllocationStats>* stats) {
+  stats->clear();
+  for (int layer = 0; layer < kNumAllocationLayers; ++layer) {
+    for (size_t slot = 0; slot < kNumCommandSlots; ++slot) {
+      const AllocationCounts& counts = g_counts[layer][slot];
+      uint64_t allocations =
+          counts.allocations.load(std::memory_order_relaxed);
+      if (allocations == 0) {
+        continue;
+      }
+      AllocationStats entry;
+      entry.set_source(static_cast<AllocationSource>(layer));
+      entry.set_command_code(slot == 0 ? 0 : TPM_CC_FIRST + slot - 1);
+      entry.set_allocations(allocations);
+      entry.set_bytes(counts.bytes.load(std::memory_order_relaxed));
+      stats->push_back(entry);
+    }
+  }
+}
+
+}  // namespace trunks
@@ -0,0 +1,104 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TRUNKS_ALLOCATION_PROFILE_H_
+#define TRUNKS_ALLOCATION_PROFILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <base/macros.h>
+
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+class AllocationStats;
+
+// The parts of the trunks library heap allocations are attributed to. Values
+// match the AllocationSource enum in interface.proto.
+enum AllocationLayer {
+  // Not made inside any ScopedAllocationTag.
+  kAllocationLayerOther = 0,
+  // Command serialization and response parsing in the generated Tpm code.
+  kAllocationLayerSerialization = 1,
+  // Session HMACs and parameter encryption in authorization delegates.
+  kAllocationLayerAuthorization = 2,
+  // Copying commands and responses in and out of IPC messages.
+  kAllocationLayerTransport = 3,
+  kNumAllocationLayers,
+};
+
+// Attributes the heap allocations made by the current thread while in scope to
+// a layer and a TPM command code. Scopes nest; a scope without a command code
+// inherits that of the enclosing scope, so the allocations of an authorization
+// delegate called during serialization are counted against the command.
+//
+// Allocations are only counted in processes which link the
+// trunks_allocation_hooks library, which replaces operator new, and only once
+// EnableAllocationTracking(true) has been called. Until then a scope costs a
+// single relaxed atomic load.
+//
+// Example:
+//   ScopedAllocationTag tag(kAllocationLayerSerialization, TPM_CC_Startup);
+class TRUNKS_EXPORT ScopedAllocationTag {
+ public:
+  explicit ScopedAllocationTag(AllocationLayer layer,
+                               uint32_t command_code = 0);
+  // Attributes allocations to the command code in the header of |command|.
+  ScopedAllocationTag(AllocationLayer layer, const std::string& command);
+  ~ScopedAllocationTag();
+
+  AllocationLayer layer() const { return layer_; }
+  uint32_t command_code() const { return command_code_; }
+
+  // Returns the innermost active scope of the current thread, or nullptr.
+  static ScopedAllocationTag* GetCurrent();
+
+ private:
+  // Makes this the innermost scope of the current thread.
+  void Enter(AllocationLayer layer, uint32_t command_code);
+
+  AllocationLayer layer_ = kAllocationLayerOther;
+  uint32_t command_code_ = 0;
+  ScopedAllocationTag* outer_ = nullptr;
+  // False if tracking was disabled when this scope was created.
+  bool active_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedAllocationTag);
+};
+
+// Turns allocation tracking on or off for the whole process. Counts are kept
+// while tracking is off.
+TRUNKS_EXPORT void EnableAllocationTracking(bool enabled);
+
+// Returns true if allocation tracking is on.
+TRUNKS_EXPORT bool IsAllocationTrackingEnabled();
+
+// Counts an allocation of |size| bytes against the current thread's innermost
+// ScopedAllocationTag. Called by the allocation hooks; it must not allocate.
+TRUNKS_EXPORT void RecordAllocation(size_t size);
+
+// Fills |stats| with the counts of every layer and command code which has had
+// allocations, ordered by layer and command code.
+TRUNKS_EXPORT void GetAllocationStats(std::vector<AllocationStats>* stats);
+
+}  // namespace trunks
+
+#endif  // TRUNKS_ALLOCATION_PROFILE_H_
@@ -0,0 +1,141 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/allocation_profile.h"
+
+#include <gtest/gtest.h>
+
+#include "trunks/interface.pb.h"
+#include "trunks/tpm_generated.h"
+
+namespace trunks {
+
+class AllocationProfileTest : public testing::Test {
+ public:
+  AllocationProfileTest() {}
+  ~AllocationProfileTest() override {}
+
+  void SetUp() override { EnableAllocationTracking(true); }
+  void TearDown() override { EnableAllocationTracking(false); }
+
+ protected:
+  // Counts are process-wide and never reset, so tests compare the counts of a
+  // |layer| and |command_code| before and after.
+  void GetCounts(AllocationLayer layer,
+                 uint32_t command_code,
+                 uint64_t* allocations,
+                 uint64_t* bytes) {
+    *allocations = 0;
+    *bytes = 0;
+    std::vector<AllocationStats> stats;
+    GetAllocationStats(&stats);
+    for (const auto& entry : stats) {
+      if (entry.source() == static_cast<AllocationSource>(layer) &&
+          entry.command_code() == command_code) {
+        *allocations = entry.allocations();
+        *bytes = entry.bytes();
+      }
+    }
+  }
+};
+
+TEST_F(AllocationProfileTest, CountsTaggedAllocations) {
+  uint64_t allocations, bytes;
+  GetCounts(kAllocationLayerSerialization, TPM_CC_GetRandom, &allocations,
+            &bytes);
+  {
+    ScopedAllocationTag tag(kAllocationLayerSerialization, TPM_CC_GetRandom);
+    EXPECT_EQ(&tag, ScopedAllocationTag::GetCurrent());
+    RecordAllocation(16);
+    RecordAllocation(48);
+  }
+  EXPECT_EQ(nullptr, ScopedAllocationTag::GetCurrent());
+  uint64_t new_allocations, new_bytes;
+  GetCounts(kAllocationLayerSerialization, TPM_CC_GetRandom, &new_allocations,
+            &new_bytes);
+  EXPECT_EQ(allocations + 2, new_allocations);
+  EXPECT_EQ(bytes + 64, new_bytes);
+}
+
+TEST_F(AllocationProfileTest, NestedTagInheritsCommandCode) {
+  uint64_t outer_allocations, outer_bytes;
+  GetCounts(kAllocationLayerSerialization, TPM_CC_Sign, &outer_allocations,
+            &outer_bytes);
+  uint64_t inner_allocations, inner_bytes;
+  GetCounts(kAllocationLayerAuthorization, TPM_CC_Sign, &inner_allocations,
+            &inner_bytes);
+  {
+    ScopedAllocationTag outer(kAllocationLayerSerialization, TPM_CC_Sign);
+    {
+      ScopedAllocationTag inner(kAllocationLayerAuthorization);
+      EXPECT_EQ(TPM_CC_Sign, inner.command_code());
+      RecordAllocation(32);
+    }
+    EXPECT_EQ(&outer, ScopedAllocationTag::GetCurrent());
+    RecordAllocation(8);
+  }
+  uint64_t allocations, bytes;
+  GetCounts(kAllocationLayerSerialization, TPM_CC_Sign, &allocations, &bytes);
+  EXPECT_EQ(outer_allocations + 1, allocations);
+  EXPECT_EQ(outer_bytes + 8, bytes);
+  GetCounts(kAllocationLayerAuthorization, TPM_CC_Sign, &allocations, &bytes);
+  EXPECT_EQ(inner_allocations + 1, allocations);
+  EXPECT_EQ(inner_bytes + 32, bytes);
+}
+
+TEST_F(AllocationProfileTest, CommandCodeFromHeader) {
+  std::string command;
+  Serialize_TPM_ST(TPM_ST_NO_SESSIONS, &command);
+  Serialize_UINT32(10, &command);
+  Serialize_TPM_CC(TPM_CC_PCR_Read, &command);
+  ScopedAllocationTag tag(kAllocationLayerTransport, command);
+  EXPECT_EQ(kAllocationLayerTransport, tag.layer());
+  EXPECT_EQ(TPM_CC_PCR_Read, tag.command_code());
+  ScopedAllocationTag short_tag(kAllocationLayerTransport, std::string("ab"));
+  EXPECT_EQ(0u, short_tag.command_code());
+}
+
+TEST_F(AllocationProfileTest, UntaggedAllocations) {
+  uint64_t allocations, bytes;
+  GetCounts(kAllocationLayerOther, 0, &allocations, &bytes);
+  RecordAllocation(24);
+  uint64_t new_allocations, new_bytes;
+  GetCounts(kAllocationLayerOther, 0, &new_allocations, &new_bytes);
+  // GetCounts may allocate outside of any tag too.
+  EXPECT_LE(allocations + 1, new_allocations);
+  EXPECT_LE(bytes + 24, new_bytes);
+}
+
+TEST_F(AllocationProfileTest, Disabled) {
+  EnableAllocationTracking(false);
+  EXPECT_FALSE(IsAllocationTrackingEnabled());
+  ScopedAllocationTag tag(kAllocationLayerSerialization, TPM_CC_Unseal);
+  EXPECT_EQ(nullptr, ScopedAllocationTag::GetCurrent());
+  EnableAllocationTracking(true);
+  uint64_t allocations, bytes;
+  GetCounts(kAllocationLayerSerialization, TPM_CC_Unseal, &allocations,
+            &bytes);
+  EnableAllocationTracking(false);
+  RecordAllocation(100);
+  EnableAllocationTracking(true);
+  uint64_t new_allocations, new_bytes;
+  GetCounts(kAllocationLayerSerialization, TPM_CC_Unseal, &new_allocations,
+            &new_bytes);
+  EXPECT_EQ(allocations, new_allocations);
+  EXPECT_EQ(bytes, new_bytes);
+}
+
+}  // namespace trunks
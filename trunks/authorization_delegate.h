@@ -17,6 +17,9 @@
 #ifndef TRUNKS_AUTHORIZATION_DELEGATE_H_
 #define TRUNKS_AUTHORIZATION_DELEGATE_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <string>
 
 #include <base/macros.h>
@@ -56,6 +59,33 @@ class AuthorizationDelegate {
   // Decrypts |parameter| if encryption is enabled. Returns true on success.
   virtual bool DecryptResponseParameter(std::string* parameter) = 0;
 
+  // Same as EncryptCommandParameter() and DecryptResponseParameter() but on
+  // the |size| bytes at |data|, which are overwritten with the result. The
+  // generated command code uses these so large parameters are not copied.
+  // Delegates which can work in place should override them; the defaults go
+  // through a temporary string.
+  virtual bool EncryptCommandParameterInPlace(uint8_t* data, size_t size) {
+    std::string parameter(reinterpret_cast<const char*>(data), size);
+    if (!EncryptCommandParameter(&parameter) || parameter.size() != size) {
+      return false;
+    }
+    parameter.copy(reinterpret_cast<char*>(data), size);
+    return true;
+  }
+  virtual bool DecryptResponseParameterInPlace(uint8_t* data, size_t size) {
+    std::string parameter(reinterpret_cast<const char*>(data), size);
+    if (!DecryptResponseParameter(&parameter) || parameter.size() != size) {
+      return false;
+    }
+    parameter.copy(reinterpret_cast<char*>(data), size);
+    return true;
+  }
+
+  // Returns true if this delegate uses the |command_hash| and |response_hash|
+  // values. Computing them is skipped for delegates which return false, in
+  // which case the hashes are passed as empty strings.
+  virtual bool RequiresParameterHashes() const { return true; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(AuthorizationDelegate);
 };
@@ -52,7 +52,9 @@ BackgroundCommandTransceiver::BackgroundCommandTransceiver(
     const scoped_refptr<base::SequencedTaskRunner>& task_runner)
     : next_transceiver_(next_transceiver),
       task_runner_(task_runner),
-      weak_factory_(this) {}
+      weak_factory_(this) {
+  weak_this_ = weak_factory_.GetWeakPtr();
+}
 
 BackgroundCommandTransceiver::~BackgroundCommandTransceiver() {}
 
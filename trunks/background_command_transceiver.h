@@ -63,12 +63,15 @@ class TRUNKS_EXPORT BackgroundCommandTransceiver : public CommandTransceiver {
   void SendCommandTask(const std::string& command,
                        const ResponseCallback& callback);
 
+  // Commands may be sent from any thread, so hand out copies of one weak
+  // pointer instead of minting new ones from |weak_factory_| concurrently.
   base::WeakPtr<BackgroundCommandTransceiver> GetWeakPtr() {
-    return weak_factory_.GetWeakPtr();
+    return weak_this_;
   }
 
   CommandTransceiver* next_transceiver_;
   scoped_refptr<base::SequencedTaskRunner> task_runner_;
+  base::WeakPtr<BackgroundCommandTransceiver> weak_this_;
 
   // Declared last so weak pointers are invalidated first on destruction.
   base::WeakPtrFactory<BackgroundCommandTransceiver> weak_factory_;
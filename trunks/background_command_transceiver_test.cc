@@ -16,6 +16,9 @@
 
 #include "trunks/background_command_transceiver.h"
 
+#include <memory>
+#include <vector>
+
 #include <base/bind.h>
 #include <base/logging.h>
 #include <base/message_loop/message_loop.h>
@@ -104,4 +107,24 @@ TEST_F(BackgroundTransceiverTest, Synchronous) {
   EXPECT_EQ(std::string("test_thread"), output);
 }
 
+TEST_F(BackgroundTransceiverTest, SynchronousFromManyThreads) {
+  trunks::BackgroundCommandTransceiver background_transceiver(
+      &next_transceiver_, test_thread_.task_runner());
+  const int kNumCallers = 4;
+  std::vector<std::unique_ptr<base::Thread>> callers;
+  std::vector<std::string> outputs(kNumCallers, "not_assigned");
+  for (int i = 0; i < kNumCallers; ++i) {
+    callers.emplace_back(new base::Thread("caller"));
+    CHECK(callers.back()->Start());
+    callers.back()->task_runner()->PostTask(
+        FROM_HERE, base::Bind(SendCommandAndWaitAndAssign,
+                              &background_transceiver, &outputs[i]));
+  }
+  for (int i = 0; i < kNumCallers; ++i) {
+    callers[i]->Stop();
+    // Every call was forwarded on the one background thread.
+    EXPECT_EQ(std::string(kTestThreadName), outputs[i]);
+  }
+}
+
 }  // namespace trunks
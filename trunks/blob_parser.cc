@@ -31,6 +31,9 @@ bool BlobParser::SerializeKeyBlob(const TPM2B_PUBLIC& public_info,
   if ((public_info.size == 0) && (private_info.size == 0)) {
     return true;
   }
+  // Both TPM2Bs are a UINT16 size followed by that many bytes; reserve once so
+  // the serializers append without reallocating.
+  key_blob->reserve(2 * sizeof(UINT16) + public_info.size + private_info.size);
   TPM_RC result = Serialize_TPM2B_PUBLIC(public_info, key_blob);
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << "Error serializing public info: " << GetErrorString(result);
@@ -54,13 +57,13 @@ bool BlobParser::ParseKeyBlob(const std::string& key_blob,
     private_info->size = 0;
     return true;
   }
-  std::string mutable_key_blob = key_blob;
-  TPM_RC result = Parse_TPM2B_PUBLIC(&mutable_key_blob, public_info, nullptr);
+  ParseCursor cursor(key_blob);
+  TPM_RC result = Parse_TPM2B_PUBLIC(&cursor, public_info);
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << "Error parsing public info: " << GetErrorString(result);
     return false;
   }
-  result = Parse_TPM2B_PRIVATE(&mutable_key_blob, private_info, nullptr);
+  result = Parse_TPM2B_PRIVATE(&cursor, private_info);
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << "Error parsing private info: " << GetErrorString(result);
     return false;
@@ -74,6 +77,8 @@ bool BlobParser::SerializeCreationBlob(const TPM2B_CREATION_DATA& creation_data,
                                        std::string* creation_blob) {
   CHECK(creation_blob) << "CreationBlob not defined.";
   creation_blob->clear();
+  creation_blob->reserve(2 * sizeof(UINT16) + creation_data.size +
+                         creation_hash.size + sizeof(creation_ticket));
   TPM_RC result = Serialize_TPM2B_CREATION_DATA(creation_data, creation_blob);
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << "Error serializing creation_data: " << GetErrorString(result);
@@ -103,20 +108,18 @@ bool BlobParser::ParseCreationBlob(const std::string& creation_blob,
   if (creation_blob.empty()) {
     return false;
   }
-  std::string mutable_creation_blob = creation_blob;
-  TPM_RC result =
-      Parse_TPM2B_CREATION_DATA(&mutable_creation_blob, creation_data, nullptr);
+  ParseCursor cursor(creation_blob);
+  TPM_RC result = Parse_TPM2B_CREATION_DATA(&cursor, creation_data);
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << "Error parsing creation_data: " << GetErrorString(result);
     return false;
   }
-  result = Parse_TPM2B_DIGEST(&mutable_creation_blob, creation_hash, nullptr);
+  result = Parse_TPM2B_DIGEST(&cursor, creation_hash);
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << "Error parsing creation_hash: " << GetErrorString(result);
     return false;
   }
-  result =
-      Parse_TPMT_TK_CREATION(&mutable_creation_blob, creation_ticket, nullptr);
+  result = Parse_TPMT_TK_CREATION(&cursor, creation_ticket);
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << "Error parsing creation_ticket: " << GetErrorString(result);
     return false;
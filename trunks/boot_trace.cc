@@ -0,0 +1,201 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/boot_trace.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include <base/files/file_util.h>
+#include <base/json/json_writer.h>
+#include <base/lazy_instance.h>
+#include <base/logging.h>
+#include <base/strings/stringprintf.h>
+#include <base/synchronization/lock.h>
+#include <base/threading/thread_local.h>
+#include <base/values.h>
+
+namespace {
+
+// The offset of the command code in a TPM command header: tag (2 bytes)
+// followed by size (4 bytes).
+const size_t kCommandCodeOffset = 6;
+// Bounds the memory a trace takes if it is never written.
+const size_t kMaxBootTraceEvents = 4096;
+
+std::atomic<bool> g_trace_enabled(false);
+std::atomic<uint32_t> g_next_phase_sequence(1);
+
+struct EventLog {
+  base::Lock lock;
+  std::vector<trunks::BootTraceEvent> events;
+};
+
+base::LazyInstance<EventLog>::Leaky g_event_log = LAZY_INSTANCE_INITIALIZER;
+
+base::LazyInstance<base::ThreadLocalPointer<trunks::ScopedBootTracePhase>>::
+    Leaky g_current_phase = LAZY_INSTANCE_INITIALIZER;
+
+void AddEvent(trunks::BootTraceEvent event) {
+  EventLog* log = g_event_log.Pointer();
+  base::AutoLock lock(log->lock);
+  if (log->events.size() < kMaxBootTraceEvents) {
+    log->events.push_back(std::move(event));
+  }
+}
+
+uint64_t ToMicroseconds(base::TimeTicks time) {
+  return (time - base::TimeTicks()).InMicroseconds();
+}
+
+}  // namespace
+
+namespace trunks {
+
+ScopedBootTracePhase::ScopedBootTracePhase(const char* name) : name_(name) {
+  if (!IsBootTraceEnabled()) {
+    return;
+  }
+  start_ = base::TimeTicks::Now();
+  correlation_id_ = (static_cast<uint64_t>(getpid()) << 32) |
+                    g_next_phase_sequence.fetch_add(1);
+  outer_ = GetCurrent();
+  active_ = true;
+  g_current_phase.Pointer()->Set(this);
+}
+
+ScopedBootTracePhase::~ScopedBootTracePhase() {
+  if (!active_) {
+    return;
+  }
+  DCHECK_EQ(this, GetCurrent()) << "Boot trace phases must nest.";
+  g_current_phase.Pointer()->Set(outer_);
+  BootTraceEvent event;
+  event.category = "phase";
+  event.name = name_;
+  event.start = start_;
+  event.duration = base::TimeTicks::Now() - start_;
+  event.correlation_id = correlation_id_;
+  event.thread_id = base::PlatformThread::CurrentId();
+  AddEvent(std::move(event));
+}
+
+// static
+ScopedBootTracePhase* ScopedBootTracePhase::GetCurrent() {
+  return g_current_phase.Pointer()->Get();
+}
+
+void EnableBootTrace(bool enabled) {
+  g_trace_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsBootTraceEnabled() {
+  return g_trace_enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t GetBootTraceCorrelationId() {
+  if (!IsBootTraceEnabled()) {
+    return 0;
+  }
+  ScopedBootTracePhase* phase = ScopedBootTracePhase::GetCurrent();
+  return phase ? phase->correlation_id() : 0;
+}
+
+void RecordBootTraceCommand(const char* category,
+                            const std::string& command,
+                            base::TimeTicks start,
+                            uint64_t correlation_id) {
+  if (!IsBootTraceEnabled()) {
+    return;
+  }
+  uint32_t command_code = 0;
+  if (command.size() >= kCommandCodeOffset + sizeof(command_code)) {
+    for (size_t i = 0; i < sizeof(command_code); ++i) {
+      command_code = (command_code << 8) |
+                     static_cast<uint8_t>(command[kCommandCodeOffset + i]);
+    }
+  }
+  BootTraceEvent event;
+  event.category = category;
+  event.name = base::StringPrintf("TPM_CC 0x%04X", command_code);
+  event.start = start;
+  event.duration = base::TimeTicks::Now() - start;
+  event.correlation_id = correlation_id;
+  event.thread_id = base::PlatformThread::CurrentId();
+  AddEvent(std::move(event));
+}
+
+std::vector<BootTraceEvent> GetBootTraceEvents() {
+  EventLog* log = g_event_log.Pointer();
+  base::AutoLock lock(log->lock);
+  return log->events;
+}
+
+std::string FormatChromeTrace(const std::string& process_name,
+                              const std::vector<BootTraceEvent>& events) {
+  int pid = getpid();
+  std::unique_ptr<base::ListValue> trace_events(new base::ListValue);
+  std::unique_ptr<base::DictionaryValue> metadata(new base::DictionaryValue);
+  metadata->SetString("name", "process_name");
+  metadata->SetString("ph", "M");
+  metadata->SetInteger("pid", pid);
+  metadata->SetString("args.name", process_name);
+  trace_events->Append(std::move(metadata));
+  for (const BootTraceEvent& event : events) {
+    std::unique_ptr<base::DictionaryValue> value(new base::DictionaryValue);
+    value->SetString("name", event.name);
+    value->SetString("cat", event.category);
+    // Complete events carry their own duration.
+    value->SetString("ph", "X");
+    value->SetDouble("ts", static_cast<double>(ToMicroseconds(event.start)));
+    value->SetDouble("dur",
+                     static_cast<double>(event.duration.InMicroseconds()));
+    value->SetInteger("pid", pid);
+    value->SetInteger("tid", static_cast<int>(event.thread_id));
+    if (event.correlation_id) {
+      // JSON numbers cannot hold every 64-bit id.
+      value->SetString(
+          "args.correlation_id",
+          base::StringPrintf("%016llx", static_cast<unsigned long long>(
+                                            event.correlation_id)));
+    }
+    trace_events->Append(std::move(value));
+  }
+  base::DictionaryValue trace;
+  trace.Set("traceEvents", std::move(trace_events));
+  std::string json;
+  base::JSONWriter::Write(trace, &json);
+  return json;
+}
+
+bool WriteBootTrace(const base::FilePath& path,
+                    const std::string& process_name) {
+  EnableBootTrace(false);
+  std::string json = FormatChromeTrace(process_name, GetBootTraceEvents());
+  if (base::WriteFile(path, json.data(), json.size()) !=
+      static_cast<int>(json.size())) {
+    LOG(ERROR) << "Failed to write boot trace to " << path.value();
+    return false;
+  }
+  LOG(INFO) << "Wrote boot trace to " << path.value();
+  return true;
+}
+
+}  // namespace trunks
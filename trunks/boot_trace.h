@@ -0,0 +1,119 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef TRUNKS_BOOT_TRACE_H_
+#define TRUNKS_BOOT_TRACE_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <base/files/file_path.h>
+#include <base/macros.h>
+#include <base/threading/platform_thread.h>
+#include <base/time/time.h>
+
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+// A span of time recorded by the boot trace.
+struct TRUNKS_EXPORT BootTraceEvent {
+  // "phase" for initialization phases, "command" for TPM commands as a client
+  // sent them and "tpm" for the round trips trunksd made to the TPM itself.
+  const char* category = "";
+  std::string name;
+  base::TimeTicks start;
+  base::TimeDelta duration;
+  // Links the commands trunksd received to the client phase which sent them
+  // (see SendCommandRequest.trace_id). Zero if there is no phase.
+  uint64_t correlation_id = 0;
+  base::PlatformThreadId thread_id = 0;
+};
+
+// Records an initialization phase of a daemon while in scope. Scopes nest.
+// TPM commands the thread sends while a phase is active carry the phase's
+// correlation id to trunksd, so a trace of trunksd shows which daemon phase
+// each command was sent for.
+//
+// Phases are only recorded once EnableBootTrace(true) has been called. Until
+// then a scope costs a single relaxed atomic load.
+//
+// Example:
+//   ScopedBootTracePhase phase("TakeOwnership");
+class TRUNKS_EXPORT ScopedBootTracePhase {
+ public:
+  // |name| must outlive the scope; usually it is a literal.
+  explicit ScopedBootTracePhase(const char* name);
+  ~ScopedBootTracePhase();
+
+  uint64_t correlation_id() const { return correlation_id_; }
+
+  // Returns the innermost active phase of the current thread, or nullptr.
+  static ScopedBootTracePhase* GetCurrent();
+
+ private:
+  const char* name_;
+  base::TimeTicks start_;
+  // Unique across processes: the process id and a per-process sequence.
+  uint64_t correlation_id_ = 0;
+  ScopedBootTracePhase* outer_ = nullptr;
+  // False if tracing was disabled when this scope was created.
+  bool active_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedBootTracePhase);
+};
+
+// Turns boot tracing on or off for the whole process. Recorded events are
+// kept while tracing is off.
+TRUNKS_EXPORT void EnableBootTrace(bool enabled);
+
+// Returns true if boot tracing is on.
+TRUNKS_EXPORT bool IsBootTraceEnabled();
+
+// Returns the correlation id of the current thread's innermost phase, or zero
+// if there is none or tracing is off.
+TRUNKS_EXPORT uint64_t GetBootTraceCorrelationId();
+
+// Records a TPM |command| which was sent at |start| and has just completed,
+// named after its command code, in |category|. Does nothing if tracing is off.
+TRUNKS_EXPORT void RecordBootTraceCommand(const char* category,
+                                          const std::string& command,
+                                          base::TimeTicks start,
+                                          uint64_t correlation_id);
+
+// Returns a copy of the events recorded so far, in order of completion. At
+// most a few thousand are kept; later ones are dropped.
+TRUNKS_EXPORT std::vector<BootTraceEvent> GetBootTraceEvents();
+
+// Formats |events| of the current process, called |process_name|, as a JSON
+// trace in the Chrome trace event format, which chrome://tracing and Perfetto
+// load. Timestamps are CLOCK_MONOTONIC microseconds, so traces of different
+// daemons line up when their traceEvents arrays are concatenated.
+TRUNKS_EXPORT std::string FormatChromeTrace(
+    const std::string& process_name,
+    const std::vector<BootTraceEvent>& events);
+
+// Turns boot tracing off and writes the events recorded so far to |path| in
+// the Chrome trace format. Returns true on success.
+TRUNKS_EXPORT bool WriteBootTrace(const base::FilePath& path,
+                                  const std::string& process_name);
+
+}  // namespace trunks
+
+#endif  // TRUNKS_BOOT_TRACE_H_
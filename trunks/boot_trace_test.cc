@@ -0,0 +1,121 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/boot_trace.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// A TPM2_GetRandom command header.
+const char kGetRandomHeader[] = "\x80\x01\x00\x00\x00\x0c\x00\x00\x01\x7b";
+
+}  // namespace
+
+namespace trunks {
+
+class BootTraceTest : public testing::Test {
+ public:
+  BootTraceTest() {}
+  ~BootTraceTest() override {}
+
+  void SetUp() override { EnableBootTrace(true); }
+  void TearDown() override { EnableBootTrace(false); }
+
+ protected:
+  // Events are process-wide and never cleared, so tests look at the events
+  // recorded after |first|.
+  std::vector<BootTraceEvent> GetEventsSince(size_t first) {
+    std::vector<BootTraceEvent> events = GetBootTraceEvents();
+    events.erase(events.begin(), events.begin() + first);
+    return events;
+  }
+
+  std::string GetRandomHeader() {
+    return std::string(kGetRandomHeader, sizeof(kGetRandomHeader) - 1);
+  }
+};
+
+TEST_F(BootTraceTest, RecordsNestedPhases) {
+  size_t first = GetBootTraceEvents().size();
+  uint64_t outer_id = 0;
+  uint64_t inner_id = 0;
+  {
+    ScopedBootTracePhase outer("Outer");
+    outer_id = outer.correlation_id();
+    EXPECT_EQ(&outer, ScopedBootTracePhase::GetCurrent());
+    {
+      ScopedBootTracePhase inner("Inner");
+      inner_id = inner.correlation_id();
+      EXPECT_EQ(&inner, ScopedBootTracePhase::GetCurrent());
+      EXPECT_EQ(inner_id, GetBootTraceCorrelationId());
+    }
+    EXPECT_EQ(&outer, ScopedBootTracePhase::GetCurrent());
+    EXPECT_EQ(outer_id, GetBootTraceCorrelationId());
+  }
+  EXPECT_EQ(nullptr, ScopedBootTracePhase::GetCurrent());
+  EXPECT_EQ(0u, GetBootTraceCorrelationId());
+  EXPECT_NE(0u, outer_id);
+  EXPECT_NE(outer_id, inner_id);
+  std::vector<BootTraceEvent> events = GetEventsSince(first);
+  ASSERT_EQ(2u, events.size());
+  // Events are kept in order of completion.
+  EXPECT_EQ("Inner", events[0].name);
+  EXPECT_EQ(inner_id, events[0].correlation_id);
+  EXPECT_EQ("Outer", events[1].name);
+  EXPECT_STREQ("phase", events[1].category);
+  EXPECT_LE(events[1].start, events[0].start);
+}
+
+TEST_F(BootTraceTest, RecordsCommandsWithCorrelationId) {
+  size_t first = GetBootTraceEvents().size();
+  ScopedBootTracePhase phase("Phase");
+  RecordBootTraceCommand("command", GetRandomHeader(), base::TimeTicks::Now(),
+                         GetBootTraceCorrelationId());
+  std::vector<BootTraceEvent> events = GetEventsSince(first);
+  ASSERT_EQ(1u, events.size());
+  EXPECT_STREQ("command", events[0].category);
+  EXPECT_EQ("TPM_CC 0x017B", events[0].name);
+  EXPECT_EQ(phase.correlation_id(), events[0].correlation_id);
+}
+
+TEST_F(BootTraceTest, DisabledRecordsNothing) {
+  EnableBootTrace(false);
+  size_t first = GetBootTraceEvents().size();
+  {
+    ScopedBootTracePhase phase("Phase");
+    EXPECT_EQ(0u, phase.correlation_id());
+    EXPECT_EQ(0u, GetBootTraceCorrelationId());
+    RecordBootTraceCommand("command", GetRandomHeader(),
+                           base::TimeTicks::Now(), 0);
+  }
+  EXPECT_EQ(first, GetBootTraceEvents().size());
+}
+
+TEST_F(BootTraceTest, FormatsChromeTrace) {
+  size_t first = GetBootTraceEvents().size();
+  {
+    ScopedBootTracePhase phase("Phase");
+  }
+  std::string trace = FormatChromeTrace("trunksd", GetEventsSince(first));
+  EXPECT_NE(std::string::npos, trace.find("\"traceEvents\""));
+  EXPECT_NE(std::string::npos, trace.find("\"trunksd\""));
+  EXPECT_NE(std::string::npos, trace.find("\"Phase\""));
+  EXPECT_NE(std::string::npos, trace.find("\"ph\":\"X\""));
+}
+
+}  // namespace trunks
@@ -0,0 +1,261 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/caching_command_transceiver.h"
+
+#include <base/bind.h>
+#include <base/callback.h>
+#include <base/logging.h>
+
+namespace {
+
+// The size of a TPM command or response header: tag (2 bytes), size (4 bytes)
+// and command or response code (4 bytes).
+const size_t kHeaderSize = 10;
+
+// Bounds memory use. The cached commands are few and repetitive so when the
+// limit is reached it is simplest to start over.
+const size_t kMaxCacheEntries = 64;
+
+// Parses the |tag| and |code| from a command or response |message| header.
+bool ParseHeader(const std::string& message,
+                 trunks::TPM_ST* tag,
+                 trunks::UINT32* code) {
+  std::string buffer = message;
+  trunks::UINT32 size = 0;
+  return trunks::Parse_TPM_ST(&buffer, tag, nullptr) ==
+             trunks::TPM_RC_SUCCESS &&
+         trunks::Parse_UINT32(&buffer, &size, nullptr) ==
+             trunks::TPM_RC_SUCCESS &&
+         trunks::Parse_UINT32(&buffer, code, nullptr) ==
+             trunks::TPM_RC_SUCCESS;
+}
+
+// Parses the 32-bit value at position |index| after the header of a
+// |command|, i.e. a handle or, for a command without handles, a parameter.
+bool ParseWordAfterHeader(const std::string& command,
+                          size_t index,
+                          trunks::UINT32* value) {
+  size_t offset = kHeaderSize + index * sizeof(trunks::UINT32);
+  if (command.size() < offset + sizeof(trunks::UINT32)) {
+    return false;
+  }
+  std::string buffer = command.substr(offset, sizeof(trunks::UINT32));
+  return trunks::Parse_UINT32(&buffer, value, nullptr) ==
+         trunks::TPM_RC_SUCCESS;
+}
+
+// Returns true if a command |code| may change TPM state referenced by cached
+// responses without naming the affected handle in its handle area.
+bool InvalidatesAll(trunks::TPM_CC code) {
+  switch (code) {
+    case trunks::TPM_CC_ChangeEPS:
+    case trunks::TPM_CC_ChangePPS:
+    case trunks::TPM_CC_Clear:
+    case trunks::TPM_CC_EvictControl:
+    case trunks::TPM_CC_HierarchyControl:
+    case trunks::TPM_CC_NV_GlobalWriteLock:
+    case trunks::TPM_CC_Shutdown:
+    case trunks::TPM_CC_Startup:
+      return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+namespace trunks {
+
+CachingCommandTransceiver::CachingCommandTransceiver(
+    CommandTransceiver* next_transceiver)
+    : next_transceiver_(next_transceiver), weak_factory_(this) {}
+
+CachingCommandTransceiver::~CachingCommandTransceiver() {}
+
+void CachingCommandTransceiver::SendCommand(const std::string& command,
+                                            const ResponseCallback& callback) {
+  TPM_HANDLE handle = 0;
+  if (!IsCacheableCommand(command, &handle)) {
+    InvalidateForCommand(command);
+    next_transceiver_->SendCommand(command, callback);
+    return;
+  }
+  auto iter = cache_.find(command);
+  if (iter != cache_.end()) {
+    callback.Run(iter->second.response);
+    return;
+  }
+  next_transceiver_->SendCommand(
+      command, base::Bind(&CachingCommandTransceiver::OnResponse, GetWeakPtr(),
+                          command, handle, callback));
+}
+
+std::string CachingCommandTransceiver::SendCommandAndWait(
+    const std::string& command) {
+  TPM_HANDLE handle = 0;
+  if (!IsCacheableCommand(command, &handle)) {
+    InvalidateForCommand(command);
+    return next_transceiver_->SendCommandAndWait(command);
+  }
+  auto iter = cache_.find(command);
+  if (iter != cache_.end()) {
+    return iter->second.response;
+  }
+  std::string response = next_transceiver_->SendCommandAndWait(command);
+  MaybeCacheResponse(command, handle, response);
+  return response;
+}
+
+void CachingCommandTransceiver::SendCommandForClient(
+    const std::string& client,
+    const std::string& command,
+    const ResponseCallback& callback) {
+  TPM_HANDLE handle = 0;
+  if (IsCacheableCommand(command, &handle)) {
+    // Cacheable commands create no resources so the client does not matter.
+    SendCommand(command, callback);
+    return;
+  }
+  InvalidateForCommand(command);
+  next_transceiver_->SendCommandForClient(client, command, callback);
+}
+
+void CachingCommandTransceiver::OnClientDisconnected(
+    const std::string& client) {
+  next_transceiver_->OnClientDisconnected(client);
+}
+
+// static
+bool CachingCommandTransceiver::IsCacheableCommand(const std::string& command,
+                                                   TPM_HANDLE* handle) {
+  TPM_ST tag = 0;
+  TPM_CC code = 0;
+  // Responses to commands with sessions are bound to the session.
+  if (!ParseHeader(command, &tag, &code) || tag != TPM_ST_NO_SESSIONS) {
+    return false;
+  }
+  switch (code) {
+    case TPM_CC_ReadPublic:
+      // Transient handles are reused for different objects.
+      return ParseWordAfterHeader(command, 0, handle) &&
+             (*handle & HR_RANGE_MASK) == HR_PERSISTENT;
+    case TPM_CC_NV_ReadPublic:
+      return ParseWordAfterHeader(command, 0, handle) &&
+             (*handle & HR_RANGE_MASK) == HR_NV_INDEX;
+    case TPM_CC_GetCapability: {
+      TPM_CAP capability = 0;
+      *handle = 0;
+      return ParseWordAfterHeader(command, 0, &capability) &&
+             (capability == TPM_CAP_ALGS || capability == TPM_CAP_COMMANDS ||
+              capability == TPM_CAP_TPM_PROPERTIES);
+    }
+  }
+  return false;
+}
+
+// static
+bool CachingCommandTransceiver::IsCacheableResponse(
+    const std::string& command,
+    const std::string& response) {
+  TPM_ST tag = 0;
+  TPM_RC response_code = 0;
+  if (!ParseHeader(response, &tag, &response_code) ||
+      response_code != TPM_RC_SUCCESS) {
+    return false;
+  }
+  TPM_CC code = 0;
+  TPM_CAP capability = 0;
+  if (!ParseHeader(command, &tag, &code) || code != TPM_CC_GetCapability ||
+      !ParseWordAfterHeader(command, 0, &capability) ||
+      capability != TPM_CAP_TPM_PROPERTIES) {
+    return true;
+  }
+  // The TPM continues into the next property group when asked for more
+  // properties than a group holds, so the response must be checked.
+  TPMI_YES_NO more_data = NO;
+  TPMS_CAPABILITY_DATA_COMPACT capability_data;
+  if (Tpm::ParseResponse_GetCapability(response, &more_data, &capability_data,
+                                       nullptr) != TPM_RC_SUCCESS ||
+      capability_data.capability != TPM_CAP_TPM_PROPERTIES) {
+    return false;
+  }
+  const TPML_TAGGED_TPM_PROPERTY_COMPACT& properties =
+      capability_data.data.tpm_properties;
+  for (const auto& property : properties.tpm_property) {
+    if (property.property >= PT_VAR) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CachingCommandTransceiver::InvalidateForCommand(
+    const std::string& command) {
+  if (cache_.empty()) {
+    return;
+  }
+  TPM_ST tag = 0;
+  TPM_CC code = 0;
+  if (!ParseHeader(command, &tag, &code)) {
+    // The TPM will reject it.
+    return;
+  }
+  if (InvalidatesAll(code)) {
+    VLOG(1) << "CACHE: Invalidating all entries for command 0x" << std::hex
+            << code;
+    cache_.clear();
+    return;
+  }
+  size_t number_of_handles = GetNumberOfRequestHandles(code);
+  for (size_t i = 0; i < number_of_handles; ++i) {
+    TPM_HANDLE handle = 0;
+    if (!ParseWordAfterHeader(command, i, &handle)) {
+      break;
+    }
+    for (auto iter = cache_.begin(); iter != cache_.end();) {
+      if (iter->second.handle == handle) {
+        iter = cache_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+  }
+}
+
+void CachingCommandTransceiver::MaybeCacheResponse(
+    const std::string& command,
+    TPM_HANDLE handle,
+    const std::string& response) {
+  if (!IsCacheableResponse(command, response)) {
+    return;
+  }
+  if (cache_.size() >= kMaxCacheEntries) {
+    cache_.clear();
+  }
+  CacheEntry& entry = cache_[command];
+  entry.response = response;
+  entry.handle = handle;
+}
+
+void CachingCommandTransceiver::OnResponse(const std::string& command,
+                                           TPM_HANDLE handle,
+                                           const ResponseCallback& callback,
+                                           const std::string& response) {
+  MaybeCacheResponse(command, handle, response);
+  callback.Run(response);
+}
+
+}  // namespace trunks
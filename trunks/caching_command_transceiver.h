@@ -0,0 +1,107 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TRUNKS_CACHING_COMMAND_TRANSCEIVER_H_
+#define TRUNKS_CACHING_COMMAND_TRANSCEIVER_H_
+
+#include "trunks/command_transceiver.h"
+
+#include <map>
+#include <string>
+
+#include <base/macros.h>
+#include <base/memory/weak_ptr.h>
+
+#include "trunks/tpm_generated.h"
+
+namespace trunks {
+
+// Answers repeated side-effect-free commands from a cache instead of sending
+// them to the TPM. Only session-less commands whose responses depend solely on
+// persistent TPM state are cached:
+//   - ReadPublic on a persistent object, e.g. the SRK or the salting key.
+//   - NV_ReadPublic.
+//   - GetCapability for algorithms, commands or fixed TPM properties.
+// Any other command which references a cached handle invalidates the entries
+// for that handle, and commands with broader effects, e.g. Clear or
+// EvictControl, invalidate the whole cache.
+//
+// This class is not thread-safe; in trunksd it runs on the background thread
+// behind the SchedulingCommandTransceiver.
+class CachingCommandTransceiver : public CommandTransceiver {
+ public:
+  // Commands are forwarded to |next_transceiver|, which must outlive this
+  // object.
+  explicit CachingCommandTransceiver(CommandTransceiver* next_transceiver);
+  ~CachingCommandTransceiver() override;
+
+  // CommandTranceiver methods.
+  void SendCommand(const std::string& command,
+                   const ResponseCallback& callback) override;
+  std::string SendCommandAndWait(const std::string& command) override;
+  void SendCommandForClient(const std::string& client,
+                            const std::string& command,
+                            const ResponseCallback& callback) override;
+  void OnClientDisconnected(const std::string& client) override;
+
+ private:
+  struct CacheEntry {
+    std::string response;
+    // The handle the response depends on, or zero if it depends on none.
+    TPM_HANDLE handle;
+  };
+
+  // Returns true if the response to |command| may be cached. On success,
+  // |handle| is set to the handle the response depends on, if any.
+  static bool IsCacheableCommand(const std::string& command,
+                                 TPM_HANDLE* handle);
+
+  // Returns true if a |response| to a cacheable GetCapability |command| only
+  // reports values which cannot change.
+  static bool IsCacheableResponse(const std::string& command,
+                                  const std::string& response);
+
+  // Removes entries which may be stale once |command| has executed.
+  void InvalidateForCommand(const std::string& command);
+
+  // Caches a |response| to |command| if appropriate.
+  void MaybeCacheResponse(const std::string& command,
+                          TPM_HANDLE handle,
+                          const std::string& response);
+
+  // Caches the |response| to a cacheable |command| and runs |callback|.
+  void OnResponse(const std::string& command,
+                  TPM_HANDLE handle,
+                  const ResponseCallback& callback,
+                  const std::string& response);
+
+  base::WeakPtr<CachingCommandTransceiver> GetWeakPtr() {
+    return weak_factory_.GetWeakPtr();
+  }
+
+  CommandTransceiver* next_transceiver_;
+  // Keyed by the raw command bytes.
+  std::map<std::string, CacheEntry> cache_;
+
+  // Declared last so weak pointers are invalidated first on destruction.
+  base::WeakPtrFactory<CachingCommandTransceiver> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(CachingCommandTransceiver);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_CACHING_COMMAND_TRANSCEIVER_H_
@@ -0,0 +1,181 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/caching_command_transceiver.h"
+
+#include <vector>
+
+#include <base/bind.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/mock_command_transceiver.h"
+
+using testing::_;
+using testing::Return;
+
+namespace {
+
+const trunks::TPM_HANDLE kPersistentHandle = trunks::PERSISTENT_FIRST;
+const trunks::TPM_HANDLE kNVIndex = trunks::NV_INDEX_FIRST;
+
+// Creates a session-less command with the given |code| and |words| following
+// the header.
+std::string MakeCommand(trunks::TPM_CC code,
+                        const std::vector<trunks::UINT32>& words) {
+  std::string body;
+  for (trunks::UINT32 word : words) {
+    trunks::Serialize_UINT32(word, &body);
+  }
+  std::string command;
+  trunks::Serialize_TPM_ST(trunks::TPM_ST_NO_SESSIONS, &command);
+  trunks::Serialize_UINT32(10 + body.size(), &command);
+  trunks::Serialize_TPM_CC(code, &command);
+  return command + body;
+}
+
+// Creates a successful GetCapability response reporting a property with the
+// given |property| tag.
+std::string MakePropertyResponse(trunks::TPM_PT property) {
+  trunks::TPMS_CAPABILITY_DATA data;
+  data.capability = trunks::TPM_CAP_TPM_PROPERTIES;
+  data.data.tpm_properties.count = 1;
+  data.data.tpm_properties.tpm_property[0].property = property;
+  data.data.tpm_properties.tpm_property[0].value = 0;
+  std::string body;
+  trunks::Serialize_TPMI_YES_NO(NO, &body);
+  trunks::Serialize_TPMS_CAPABILITY_DATA(data, &body);
+  std::string response;
+  trunks::Serialize_TPM_ST(trunks::TPM_ST_NO_SESSIONS, &response);
+  trunks::Serialize_UINT32(10 + body.size(), &response);
+  trunks::Serialize_TPM_RC(trunks::TPM_RC_SUCCESS, &response);
+  return response + body;
+}
+
+void Assign(std::string* to, const std::string& from) {
+  *to = from;
+}
+
+}  // namespace
+
+namespace trunks {
+
+class CachingCommandTransceiverTest : public testing::Test {
+ public:
+  CachingCommandTransceiverTest() : transceiver_(&next_transceiver_) {}
+  ~CachingCommandTransceiverTest() override {}
+
+ protected:
+  testing::StrictMock<MockCommandTransceiver> next_transceiver_;
+  CachingCommandTransceiver transceiver_;
+};
+
+TEST_F(CachingCommandTransceiverTest, ReadPublicPersistent) {
+  std::string command = MakeCommand(TPM_CC_ReadPublic, {kPersistentHandle});
+  std::string response = CreateErrorResponse(TPM_RC_SUCCESS);
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(response));
+  EXPECT_EQ(response, transceiver_.SendCommandAndWait(command));
+  EXPECT_EQ(response, transceiver_.SendCommandAndWait(command));
+}
+
+TEST_F(CachingCommandTransceiverTest, ReadPublicTransient) {
+  std::string command = MakeCommand(TPM_CC_ReadPublic, {TRANSIENT_FIRST});
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(command))
+      .Times(2)
+      .WillRepeatedly(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  transceiver_.SendCommandAndWait(command);
+  transceiver_.SendCommandAndWait(command);
+}
+
+TEST_F(CachingCommandTransceiverTest, FailureNotCached) {
+  std::string command = MakeCommand(TPM_CC_NV_ReadPublic, {kNVIndex});
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(command))
+      .Times(2)
+      .WillRepeatedly(Return(CreateErrorResponse(TPM_RC_HANDLE)));
+  transceiver_.SendCommandAndWait(command);
+  transceiver_.SendCommandAndWait(command);
+}
+
+TEST_F(CachingCommandTransceiverTest, InvalidateByHandle) {
+  std::string nv_read_public = MakeCommand(TPM_CC_NV_ReadPublic, {kNVIndex});
+  std::string read_public = MakeCommand(TPM_CC_ReadPublic, {kPersistentHandle});
+  std::string nv_write = MakeCommand(TPM_CC_NV_Write, {kNVIndex, kNVIndex});
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(nv_read_public))
+      .Times(2)
+      .WillRepeatedly(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(read_public))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(nv_write))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  transceiver_.SendCommandAndWait(nv_read_public);
+  transceiver_.SendCommandAndWait(read_public);
+  transceiver_.SendCommandAndWait(nv_write);
+  // Only the entry for the NV index is invalidated.
+  transceiver_.SendCommandAndWait(nv_read_public);
+  transceiver_.SendCommandAndWait(read_public);
+}
+
+TEST_F(CachingCommandTransceiverTest, InvalidateAll) {
+  std::string read_public = MakeCommand(TPM_CC_ReadPublic, {kPersistentHandle});
+  std::string evict = MakeCommand(TPM_CC_EvictControl,
+                                  {TPM_RH_OWNER, TRANSIENT_FIRST});
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(read_public))
+      .Times(2)
+      .WillRepeatedly(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(evict))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  transceiver_.SendCommandAndWait(read_public);
+  transceiver_.SendCommandAndWait(evict);
+  transceiver_.SendCommandAndWait(read_public);
+}
+
+TEST_F(CachingCommandTransceiverTest, FixedPropertiesOnly) {
+  std::string fixed = MakeCommand(TPM_CC_GetCapability,
+                                  {TPM_CAP_TPM_PROPERTIES, PT_FIXED, 1});
+  std::string variable = MakeCommand(TPM_CC_GetCapability,
+                                     {TPM_CAP_TPM_PROPERTIES, PT_VAR, 1});
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(fixed))
+      .WillOnce(Return(MakePropertyResponse(PT_FIXED)));
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(variable))
+      .Times(2)
+      .WillRepeatedly(Return(MakePropertyResponse(PT_VAR)));
+  EXPECT_EQ(MakePropertyResponse(PT_FIXED),
+            transceiver_.SendCommandAndWait(fixed));
+  EXPECT_EQ(MakePropertyResponse(PT_FIXED),
+            transceiver_.SendCommandAndWait(fixed));
+  transceiver_.SendCommandAndWait(variable);
+  transceiver_.SendCommandAndWait(variable);
+}
+
+TEST_F(CachingCommandTransceiverTest, Asynchronous) {
+  std::string command = MakeCommand(TPM_CC_ReadPublic, {kPersistentHandle});
+  std::string response = CreateErrorResponse(TPM_RC_SUCCESS);
+  EXPECT_CALL(next_transceiver_, SendCommand(command, _))
+      .WillOnce(testing::WithArg<1>(testing::Invoke(
+          [&response](const CommandTransceiver::ResponseCallback& callback) {
+            callback.Run(response);
+          })));
+  std::string actual;
+  transceiver_.SendCommand(command, base::Bind(Assign, &actual));
+  EXPECT_EQ(response, actual);
+  actual.clear();
+  transceiver_.SendCommand(command, base::Bind(Assign, &actual));
+  EXPECT_EQ(response, actual);
+}
+
+}  // namespace trunks
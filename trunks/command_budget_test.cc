@@ -0,0 +1,244 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Bounds the TPM commands behind common high-level operations. Each workflow
+// runs against a software TPM behind a real ResourceManager, so every count is
+// deterministic: a change which makes an operation cost more commands fails
+// here instead of showing up as latency on devices. When an operation gets
+// cheaper, lower its budget.
+
+#if defined(USE_SIMULATOR)
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/files/scoped_temp_dir.h>
+#include <gtest/gtest.h>
+
+#include "trunks/command_profile.h"
+#include "trunks/error_codes.h"
+#include "trunks/hmac_session.h"
+#include "trunks/resource_manager.h"
+#include "trunks/scoped_key_handle.h"
+#include "trunks/tpm_simulator_pool.h"
+#include "trunks/tpm_utility.h"
+#include "trunks/trunks_factory_impl.h"
+
+namespace {
+
+const char kOwnerPassword[] = "owner";
+// The number of transient objects the reference TPM implementation can hold.
+const size_t kObjectSlots = 3;
+
+}  // namespace
+
+namespace trunks {
+
+// The software TPM, its resource manager and ownership are set up once; each
+// test gets a fresh client factory so no client-side cache carries over.
+class CommandBudgetTest : public testing::Test {
+ public:
+  CommandBudgetTest() = default;
+  ~CommandBudgetTest() override = default;
+
+  static void SetUpTestCase() {
+    data_directory_ = new base::ScopedTempDir();
+    ASSERT_TRUE(data_directory_->CreateUniqueTempDir());
+    pool_ = new TpmSimulatorPool(1, data_directory_->path().value());
+    ASSERT_TRUE(pool_->Init());
+    tpm_factory_ = new TrunksFactoryImpl(pool_->GetInstance(0));
+    ASSERT_TRUE(tpm_factory_->Initialize());
+    resource_manager_ =
+        new ResourceManager(*tpm_factory_, pool_->GetInstance(0));
+    resource_manager_->Initialize();
+    TrunksFactoryImpl factory(resource_manager_);
+    ASSERT_TRUE(factory.Initialize());
+    std::unique_ptr<TpmUtility> utility = factory.GetTpmUtility();
+    ASSERT_EQ(TPM_RC_SUCCESS, utility->TakeOwnership(kOwnerPassword, "", ""));
+    // Key generation is slow on the software TPM; these keys are shared.
+    std::unique_ptr<HmacSession> session = factory.GetHmacSession();
+    ASSERT_EQ(TPM_RC_SUCCESS, session->StartUnboundSession(false));
+    key_blobs_ = new std::vector<std::string>(kObjectSlots + 1);
+    for (std::string& key_blob : *key_blobs_) {
+      ASSERT_EQ(TPM_RC_SUCCESS,
+                utility->CreateRSAKeyPair(
+                    TpmUtility::kSignKey, 2048, 0x10001, "", "", false,
+                    kNoCreationPCR, session->GetDelegate(), &key_blob,
+                    nullptr));
+    }
+  }
+
+  static void TearDownTestCase() {
+    delete key_blobs_;
+    delete resource_manager_;
+    delete tpm_factory_;
+    delete pool_;
+    delete data_directory_;
+  }
+
+  void SetUp() override {
+    factory_.reset(new TrunksFactoryImpl(resource_manager_));
+    ASSERT_TRUE(factory_->Initialize());
+    utility_ = factory_->GetTpmUtility();
+    session_ = factory_->GetHmacSession();
+    ASSERT_EQ(TPM_RC_SUCCESS, session_->StartUnboundSession(false));
+  }
+
+ protected:
+  // Returns the number of commands the resource manager has sent to the TPM,
+  // including the context management it does on behalf of clients.
+  static uint64_t CountTpmCommands() {
+    ResourceManagerStats stats;
+    resource_manager_->GetStats(&stats);
+    uint64_t commands = 0;
+    for (const auto& command : stats.commands()) {
+      commands += command.tpm_round_trips();
+    }
+    return commands;
+  }
+
+  // Checks the commands counted by |profile|, and those sent to the TPM since
+  // |tpm_commands_before|, against the budgets of |operation|.
+  static void ExpectWithinBudget(const std::string& operation,
+                                 const ScopedCommandProfile& profile,
+                                 uint64_t tpm_commands_before,
+                                 uint64_t client_budget,
+                                 uint64_t tpm_budget) {
+    EXPECT_LE(profile.profile().commands, client_budget)
+        << operation << " sent more commands than budgeted.";
+    EXPECT_LE(CountTpmCommands() - tpm_commands_before, tpm_budget)
+        << operation << " took more TPM commands than budgeted.";
+  }
+
+  // Loads the shared key at |index| into |key|.
+  void LoadKey(size_t index, ScopedKeyHandle* key) {
+    ASSERT_EQ(TPM_RC_SUCCESS,
+              utility_->LoadKey((*key_blobs_)[index], session_->GetDelegate(),
+                                key->ptr()));
+  }
+
+  // Signs some data with |key|.
+  void Sign(const ScopedKeyHandle& key) {
+    std::string signature;
+    ASSERT_EQ(TPM_RC_SUCCESS,
+              utility_->Sign(key.get(), TPM_ALG_RSASSA, TPM_ALG_SHA256,
+                             "data", session_->GetDelegate(), &signature));
+  }
+
+  static base::ScopedTempDir* data_directory_;
+  static TpmSimulatorPool* pool_;
+  // Talks to the TPM directly, for the resource manager.
+  static TrunksFactoryImpl* tpm_factory_;
+  static ResourceManager* resource_manager_;
+  static std::vector<std::string>* key_blobs_;
+
+  std::unique_ptr<TrunksFactoryImpl> factory_;
+  std::unique_ptr<TpmUtility> utility_;
+  std::unique_ptr<HmacSession> session_;
+};
+
+base::ScopedTempDir* CommandBudgetTest::data_directory_ = nullptr;
+TpmSimulatorPool* CommandBudgetTest::pool_ = nullptr;
+TrunksFactoryImpl* CommandBudgetTest::tpm_factory_ = nullptr;
+ResourceManager* CommandBudgetTest::resource_manager_ = nullptr;
+std::vector<std::string>* CommandBudgetTest::key_blobs_ = nullptr;
+
+TEST_F(CommandBudgetTest, GenerateRandom) {
+  uint64_t tpm_commands = CountTpmCommands();
+  ScopedCommandProfile profile;
+  std::string random;
+  ASSERT_EQ(TPM_RC_SUCCESS, utility_->GenerateRandom(32, nullptr, &random));
+  // GetRandom.
+  ExpectWithinBudget("GenerateRandom", profile, tpm_commands, 1, 1);
+}
+
+TEST_F(CommandBudgetTest, StartSaltedSession) {
+  uint64_t tpm_commands = CountTpmCommands();
+  ScopedCommandProfile profile;
+  std::unique_ptr<HmacSession> session = factory_->GetHmacSession();
+  ASSERT_EQ(TPM_RC_SUCCESS, session->StartUnboundSession(true));
+  // ReadPublic of the salting key, StartAuthSession.
+  ExpectWithinBudget("StartUnboundSession", profile, tpm_commands, 2, 2);
+}
+
+TEST_F(CommandBudgetTest, CreateKey) {
+  uint64_t tpm_commands = CountTpmCommands();
+  ScopedCommandProfile profile;
+  std::string key_blob;
+  ASSERT_EQ(TPM_RC_SUCCESS,
+            utility_->CreateRSAKeyPair(TpmUtility::kSignKey, 2048, 0x10001, "",
+                                       "", false, kNoCreationPCR,
+                                       session_->GetDelegate(), &key_blob,
+                                       nullptr));
+  // ReadPublic of the SRK, Create.
+  ExpectWithinBudget("CreateRSAKeyPair", profile, tpm_commands, 2, 2);
+}
+
+TEST_F(CommandBudgetTest, LoadKeyAndSign) {
+  uint64_t tpm_commands = CountTpmCommands();
+  ScopedCommandProfile profile;
+  {
+    ScopedKeyHandle key(*factory_);
+    LoadKey(0, &key);
+    Sign(key);
+  }
+  // ReadPublic of the SRK, Load, ReadPublic of the key, Sign, FlushContext.
+  ExpectWithinBudget("LoadKey + Sign", profile, tpm_commands, 5, 5);
+}
+
+TEST_F(CommandBudgetTest, SignWithLoadedKey) {
+  ScopedKeyHandle key(*factory_);
+  LoadKey(0, &key);
+  uint64_t tpm_commands = CountTpmCommands();
+  ScopedCommandProfile profile;
+  Sign(key);
+  // ReadPublic of the key, Sign.
+  ExpectWithinBudget("Sign", profile, tpm_commands, 2, 2);
+}
+
+TEST_F(CommandBudgetTest, LoadKeyAndSignUnderMemoryPressure) {
+  // Fill every object slot, so loading another key needs one evicted.
+  std::vector<std::unique_ptr<ScopedKeyHandle>> loaded_keys;
+  for (size_t i = 0; i < kObjectSlots; ++i) {
+    loaded_keys.emplace_back(new ScopedKeyHandle(*factory_));
+    LoadKey(i, loaded_keys.back().get());
+  }
+  uint64_t tpm_commands = CountTpmCommands();
+  ScopedCommandProfile profile;
+  {
+    ScopedKeyHandle key(*factory_);
+    LoadKey(kObjectSlots, &key);
+    Sign(key);
+  }
+  // The SRK name is known by now: Load, ReadPublic of the key, Sign,
+  // FlushContext. The resource manager saves one key to make room and, if the
+  // TPM also needs a slot for the SRK, retries the Load once after saving
+  // another.
+  ExpectWithinBudget("LoadKey + Sign under memory pressure", profile,
+                     tpm_commands, 4, 7);
+  // Using an evicted key again costs one swap.
+  tpm_commands = CountTpmCommands();
+  ScopedCommandProfile reload_profile;
+  Sign(*loaded_keys[0]);
+  // ReadPublic and Sign, a ContextSave to make room and a ContextLoad.
+  ExpectWithinBudget("Sign with an evicted key", reload_profile, tpm_commands,
+                     2, 4);
+}
+
+}  // namespace trunks
+
+#endif  // USE_SIMULATOR
@@ -0,0 +1,181 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/command_profile.h"
+
+#include <algorithm>
+
+#include <base/bind.h>
+#include <base/callback.h>
+#include <base/lazy_instance.h>
+#include <base/threading/thread_local.h>
+
+namespace {
+
+// The size of a TPM command header: tag (2 bytes), size (4 bytes) and command
+// code (4 bytes).
+const size_t kHeaderSize = 10;
+
+base::LazyInstance<base::ThreadLocalPointer<trunks::ScopedCommandProfile>>::
+    Leaky g_current_profile = LAZY_INSTANCE_INITIALIZER;
+
+// Returns the command code of |command|, or zero if it has no valid header.
+trunks::TPM_CC GetCommandCode(const std::string& command) {
+  if (command.size() < kHeaderSize) {
+    return 0;
+  }
+  std::string buffer = command.substr(6, sizeof(trunks::TPM_CC));
+  trunks::TPM_CC code = 0;
+  if (trunks::Parse_TPM_CC(&buffer, &code, nullptr) !=
+      trunks::TPM_RC_SUCCESS) {
+    return 0;
+  }
+  return code;
+}
+
+}  // namespace
+
+namespace trunks {
+
+CommandProfile::CommandProfile() {}
+
+CommandProfile::~CommandProfile() {}
+
+void CommandProfile::Add(const CommandProfile& other) {
+  commands += other.commands;
+  command_bytes += other.command_bytes;
+  response_bytes += other.response_bytes;
+  tpm_time += other.tpm_time;
+  for (const auto& entry : other.command_codes) {
+    command_codes[entry.first] += entry.second;
+  }
+}
+
+ScopedCommandProfile::ScopedCommandProfile()
+    : outer_(GetCurrent()), weak_factory_(this) {
+  g_current_profile.Pointer()->Set(this);
+}
+
+ScopedCommandProfile::~ScopedCommandProfile() {
+  DCHECK_EQ(this, GetCurrent()) << "Profile scopes must nest.";
+  g_current_profile.Pointer()->Set(outer_);
+  if (outer_) {
+    outer_->profile_.Add(profile_);
+  }
+}
+
+// static
+ScopedCommandProfile* ScopedCommandProfile::GetCurrent() {
+  return g_current_profile.Pointer()->Get();
+}
+
+ProfilingCommandTransceiver::ProfilingCommandTransceiver(
+    CommandTransceiver* next_transceiver)
+    : next_transceiver_(next_transceiver) {}
+
+ProfilingCommandTransceiver::~ProfilingCommandTransceiver() {}
+
+void ProfilingCommandTransceiver::SendCommand(
+    const std::string& command,
+    const ResponseCallback& callback) {
+  ScopedCommandProfile* scope = ScopedCommandProfile::GetCurrent();
+  if (!scope) {
+    next_transceiver_->SendCommand(command, callback);
+    return;
+  }
+  next_transceiver_->SendCommand(
+      command,
+      base::Bind(&ProfilingCommandTransceiver::OnResponse, scope->GetWeakPtr(),
+                 command, base::TimeTicks::Now(), callback));
+}
+
+std::string ProfilingCommandTransceiver::SendCommandAndWait(
+    const std::string& command) {
+  ScopedCommandProfile* scope = ScopedCommandProfile::GetCurrent();
+  if (!scope) {
+    return next_transceiver_->SendCommandAndWait(command);
+  }
+  base::TimeTicks start = base::TimeTicks::Now();
+  std::string response = next_transceiver_->SendCommandAndWait(command);
+  Record(scope, {command}, {response}, base::TimeTicks::Now() - start);
+  return response;
+}
+
+std::vector<std::string> ProfilingCommandTransceiver::SendCommandBatchAndWait(
+    const std::vector<std::string>& commands,
+    bool stop_on_failure) {
+  ScopedCommandProfile* scope = ScopedCommandProfile::GetCurrent();
+  if (!scope) {
+    return next_transceiver_->SendCommandBatchAndWait(commands,
+                                                      stop_on_failure);
+  }
+  base::TimeTicks start = base::TimeTicks::Now();
+  std::vector<std::string> responses =
+      next_transceiver_->SendCommandBatchAndWait(commands, stop_on_failure);
+  // Commands after a failure are not sent.
+  std::vector<std::string> sent(
+      commands.begin(),
+      commands.begin() + std::min(commands.size(), responses.size()));
+  Record(scope, sent, responses, base::TimeTicks::Now() - start);
+  return responses;
+}
+
+std::vector<std::string> ProfilingCommandTransceiver::SendCommandsAndWait(
+    const std::vector<std::string>& commands) {
+  ScopedCommandProfile* scope = ScopedCommandProfile::GetCurrent();
+  if (!scope) {
+    return next_transceiver_->SendCommandsAndWait(commands);
+  }
+  base::TimeTicks start = base::TimeTicks::Now();
+  std::vector<std::string> responses =
+      next_transceiver_->SendCommandsAndWait(commands);
+  Record(scope, commands, responses, base::TimeTicks::Now() - start);
+  return responses;
+}
+
+// static
+void ProfilingCommandTransceiver::Record(
+    ScopedCommandProfile* scope,
+    const std::vector<std::string>& commands,
+    const std::vector<std::string>& responses,
+    base::TimeDelta elapsed) {
+  CommandProfile* profile = &scope->profile_;
+  profile->commands += commands.size();
+  for (const std::string& command : commands) {
+    profile->command_bytes += command.size();
+    ++profile->command_codes[GetCommandCode(command)];
+  }
+  for (const std::string& response : responses) {
+    profile->response_bytes += response.size();
+  }
+  profile->tpm_time += elapsed;
+}
+
+// static
+void ProfilingCommandTransceiver::OnResponse(
+    base::WeakPtr<ScopedCommandProfile> scope,
+    const std::string& command,
+    base::TimeTicks start,
+    const ResponseCallback& callback,
+    const std::string& response) {
+  if (scope) {
+    Record(scope.get(), {command}, {response}, base::TimeTicks::Now() - start);
+  }
+  callback.Run(response);
+}
+
+}  // namespace trunks
@@ -0,0 +1,133 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef TRUNKS_COMMAND_PROFILE_H_
+#define TRUNKS_COMMAND_PROFILE_H_
+
+#include "trunks/command_transceiver.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <base/macros.h>
+#include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
+
+#include "trunks/tpm_generated.h"
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+// The TPM commands sent on behalf of one high-level operation.
+struct TRUNKS_EXPORT CommandProfile {
+  CommandProfile();
+  ~CommandProfile();
+
+  void Add(const CommandProfile& other);
+
+  uint64_t commands = 0;
+  uint64_t command_bytes = 0;
+  uint64_t response_bytes = 0;
+  // The time spent waiting for responses, including IPC and queueing in
+  // trunksd.
+  base::TimeDelta tpm_time;
+  // The number of commands sent, by command code.
+  std::map<TPM_CC, uint64_t> command_codes;
+};
+
+// Counts the TPM commands sent by the current thread while in scope. Scopes
+// nest; when a scope ends its counts are added to the enclosing scope, so an
+// operation's profile includes the operations it is built from.
+//
+// Example:
+//   ScopedCommandProfile profile;
+//   utility->CreateRSAKeyPair(...);
+//   LOG(INFO) << profile.profile().commands << " commands";
+//
+// Only commands sent through a ProfilingCommandTransceiver are counted;
+// TrunksFactoryImpl sends every command through one.
+class TRUNKS_EXPORT ScopedCommandProfile {
+ public:
+  ScopedCommandProfile();
+  ~ScopedCommandProfile();
+
+  const CommandProfile& profile() const { return profile_; }
+
+  // Returns the innermost scope of the current thread, or nullptr.
+  static ScopedCommandProfile* GetCurrent();
+
+ private:
+  friend class ProfilingCommandTransceiver;
+
+  base::WeakPtr<ScopedCommandProfile> GetWeakPtr() {
+    return weak_factory_.GetWeakPtr();
+  }
+
+  CommandProfile profile_;
+  ScopedCommandProfile* outer_;
+
+  // Declared last so weak pointers are invalidated first on destruction.
+  base::WeakPtrFactory<ScopedCommandProfile> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedCommandProfile);
+};
+
+// Adds the commands sent through it to the current thread's
+// ScopedCommandProfile. Commands sent outside any scope cost only a
+// thread-local lookup. The response to an asynchronous command is counted
+// against the scope the command was sent from, if that scope still exists.
+class TRUNKS_EXPORT ProfilingCommandTransceiver : public CommandTransceiver {
+ public:
+  // Commands are forwarded to |next_transceiver|, which must outlive this
+  // object.
+  explicit ProfilingCommandTransceiver(CommandTransceiver* next_transceiver);
+  ~ProfilingCommandTransceiver() override;
+
+  // CommandTransceiver methods.
+  void SendCommand(const std::string& command,
+                   const ResponseCallback& callback) override;
+  std::string SendCommandAndWait(const std::string& command) override;
+  std::vector<std::string> SendCommandBatchAndWait(
+      const std::vector<std::string>& commands,
+      bool stop_on_failure) override;
+  std::vector<std::string> SendCommandsAndWait(
+      const std::vector<std::string>& commands) override;
+
+ private:
+  // Counts |commands| sent and the |responses| received in |elapsed| time
+  // against |scope|.
+  static void Record(ScopedCommandProfile* scope,
+                     const std::vector<std::string>& commands,
+                     const std::vector<std::string>& responses,
+                     base::TimeDelta elapsed);
+
+  // Counts an asynchronous |command| and runs |callback|.
+  static void OnResponse(base::WeakPtr<ScopedCommandProfile> scope,
+                         const std::string& command,
+                         base::TimeTicks start,
+                         const ResponseCallback& callback,
+                         const std::string& response);
+
+  CommandTransceiver* next_transceiver_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProfilingCommandTransceiver);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_COMMAND_PROFILE_H_
@@ -0,0 +1,133 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/command_profile.h"
+
+#include <base/bind.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/mock_command_transceiver.h"
+
+using testing::_;
+using testing::Invoke;
+using testing::Return;
+
+namespace {
+
+// Creates a session-less command with the given |code| and no parameters.
+std::string MakeCommand(trunks::TPM_CC code) {
+  std::string command;
+  trunks::Serialize_TPM_ST(trunks::TPM_ST_NO_SESSIONS, &command);
+  trunks::Serialize_UINT32(10, &command);
+  trunks::Serialize_TPM_CC(code, &command);
+  return command;
+}
+
+void RespondSuccess(
+    const std::string& command,
+    const trunks::CommandTransceiver::ResponseCallback& callback) {
+  callback.Run(trunks::CreateErrorResponse(trunks::TPM_RC_SUCCESS));
+}
+
+void Assign(std::string* to, const std::string& from) {
+  *to = from;
+}
+
+}  // namespace
+
+namespace trunks {
+
+class CommandProfileTest : public testing::Test {
+ public:
+  CommandProfileTest() : transceiver_(&next_transceiver_) {}
+  ~CommandProfileTest() override {}
+
+ protected:
+  testing::StrictMock<MockCommandTransceiver> next_transceiver_;
+  ProfilingCommandTransceiver transceiver_;
+};
+
+TEST_F(CommandProfileTest, NoScope) {
+  std::string command = MakeCommand(TPM_CC_GetRandom);
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  EXPECT_EQ(nullptr, ScopedCommandProfile::GetCurrent());
+  transceiver_.SendCommandAndWait(command);
+}
+
+TEST_F(CommandProfileTest, CountsCommands) {
+  std::string get_random = MakeCommand(TPM_CC_GetRandom);
+  std::string pcr_read = MakeCommand(TPM_CC_PCR_Read);
+  std::string response = CreateErrorResponse(TPM_RC_SUCCESS);
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(_))
+      .WillRepeatedly(Return(response));
+  ScopedCommandProfile scope;
+  transceiver_.SendCommandAndWait(get_random);
+  transceiver_.SendCommandAndWait(get_random);
+  transceiver_.SendCommandAndWait(pcr_read);
+  const CommandProfile& profile = scope.profile();
+  EXPECT_EQ(3u, profile.commands);
+  EXPECT_EQ(get_random.size() * 2 + pcr_read.size(), profile.command_bytes);
+  EXPECT_EQ(response.size() * 3, profile.response_bytes);
+  EXPECT_EQ(2u, profile.command_codes.at(TPM_CC_GetRandom));
+  EXPECT_EQ(1u, profile.command_codes.at(TPM_CC_PCR_Read));
+}
+
+TEST_F(CommandProfileTest, NestedScopes) {
+  std::string command = MakeCommand(TPM_CC_GetRandom);
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(command))
+      .WillRepeatedly(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  ScopedCommandProfile outer;
+  transceiver_.SendCommandAndWait(command);
+  {
+    ScopedCommandProfile inner;
+    EXPECT_EQ(&inner, ScopedCommandProfile::GetCurrent());
+    transceiver_.SendCommandAndWait(command);
+    EXPECT_EQ(1u, inner.profile().commands);
+    EXPECT_EQ(1u, outer.profile().commands);
+  }
+  EXPECT_EQ(&outer, ScopedCommandProfile::GetCurrent());
+  EXPECT_EQ(2u, outer.profile().commands);
+}
+
+TEST_F(CommandProfileTest, AsyncCommand) {
+  std::string command = MakeCommand(TPM_CC_GetRandom);
+  EXPECT_CALL(next_transceiver_, SendCommand(command, _))
+      .WillOnce(Invoke(RespondSuccess));
+  ScopedCommandProfile scope;
+  std::string response;
+  transceiver_.SendCommand(command, base::Bind(Assign, &response));
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_SUCCESS), response);
+  EXPECT_EQ(1u, scope.profile().commands);
+  EXPECT_EQ(response.size(), scope.profile().response_bytes);
+}
+
+TEST_F(CommandProfileTest, Batch) {
+  std::string command = MakeCommand(TPM_CC_GetRandom);
+  // The default batch implementation stops after the first failure.
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_FAILURE)));
+  ScopedCommandProfile scope;
+  std::vector<std::string> responses =
+      transceiver_.SendCommandBatchAndWait({command, command}, true);
+  EXPECT_EQ(1u, responses.size());
+  EXPECT_EQ(1u, scope.profile().commands);
+}
+
+}  // namespace trunks
@@ -0,0 +1,159 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/command_timeout_policy.h"
+
+#include <algorithm>
+
+#include "trunks/interface.pb.h"
+
+namespace {
+
+// The size of a TPM command header: tag (2 bytes), size (4 bytes) and command
+// code (4 bytes).
+const size_t kHeaderSize = 10;
+
+// Returns whether commands with |code| generate keys, whose latency depends on
+// the key type and the TPM's luck in finding primes rather than on anything
+// the latency of past commands says.
+bool IsKeyGeneration(trunks::TPM_CC code) {
+  return code == trunks::TPM_CC_Create || code == trunks::TPM_CC_CreatePrimary;
+}
+
+// Sets |bound_us| to an upper bound in microseconds for the 99.9th percentile
+// of |histogram|. Returns false if the percentile lies in the last bucket,
+// which has no upper bound.
+bool GetTailLatency(const trunks::LatencyHistogram& histogram,
+                    uint64_t* bound_us) {
+  *bound_us = 0;
+  uint64_t count = 0;
+  for (uint64_t bucket : histogram.buckets()) {
+    count += bucket;
+  }
+  uint64_t seen = 0;
+  for (int i = 0; i < histogram.buckets_size(); ++i) {
+    seen += histogram.buckets(i);
+    if (seen * 1000 >= count * 999) {
+      *bound_us = 1ull << i;
+      return i + 1 < histogram.buckets_size();
+    }
+  }
+  // Nothing was counted.
+  return true;
+}
+
+}  // namespace
+
+namespace trunks {
+
+const int CommandTimeoutPolicy::kMaxTimeoutMs;
+const int CommandTimeoutPolicy::kMinTimeoutMs;
+const int CommandTimeoutPolicy::kSafetyFactor;
+const uint64_t CommandTimeoutPolicy::kMinSamples;
+
+CommandTimeoutPolicy::CommandTimeoutPolicy() {}
+
+CommandTimeoutPolicy::CommandTimeoutPolicy(const CommandTimeoutPolicy& other) =
+    default;
+
+CommandTimeoutPolicy::~CommandTimeoutPolicy() {}
+
+void CommandTimeoutPolicy::Learn(const ResourceManagerStats& stats) {
+  timeouts_.clear();
+  for (const auto& command : stats.commands()) {
+    TPM_CC code = command.command_code();
+    if (code == 0 || IsKeyGeneration(code) || command.count() < kMinSamples) {
+      continue;
+    }
+    uint64_t total_us = 0;
+    uint64_t queue_us = 0;
+    if (!GetTailLatency(command.total_latency(), &total_us) ||
+        !GetTailLatency(command.queue_latency(), &queue_us)) {
+      continue;
+    }
+    base::TimeDelta timeout = base::TimeDelta::FromMicroseconds(
+        (total_us + queue_us) * kSafetyFactor);
+    timeout = std::max(timeout,
+                       base::TimeDelta::FromMilliseconds(kMinTimeoutMs));
+    if (timeout < base::TimeDelta::FromMilliseconds(kMaxTimeoutMs)) {
+      timeouts_[code] = timeout;
+    }
+  }
+}
+
+bool CommandTimeoutPolicy::HasLearnedTimeout(TPM_CC code) const {
+  return timeouts_.count(code) > 0;
+}
+
+base::TimeDelta CommandTimeoutPolicy::GetTimeout(TPM_CC code) const {
+  auto iter = timeouts_.find(code);
+  if (iter == timeouts_.end()) {
+    return base::TimeDelta::FromMilliseconds(kMaxTimeoutMs);
+  }
+  return iter->second;
+}
+
+base::TimeDelta CommandTimeoutPolicy::GetCommandTimeout(
+    const std::string& command) const {
+  if (command.size() < kHeaderSize) {
+    return base::TimeDelta::FromMilliseconds(kMaxTimeoutMs);
+  }
+  std::string buffer = command.substr(6, sizeof(TPM_CC));
+  TPM_CC code = 0;
+  if (Parse_TPM_CC(&buffer, &code, nullptr) != TPM_RC_SUCCESS) {
+    return base::TimeDelta::FromMilliseconds(kMaxTimeoutMs);
+  }
+  return GetTimeout(code);
+}
+
+base::TimeDelta CommandTimeoutPolicy::GetBatchTimeout(
+    const std::vector<std::string>& commands) const {
+  base::TimeDelta max_timeout =
+      base::TimeDelta::FromMilliseconds(kMaxTimeoutMs);
+  base::TimeDelta timeout;
+  for (const auto& command : commands) {
+    timeout += GetCommandTimeout(command);
+    if (timeout >= max_timeout) {
+      return max_timeout;
+    }
+  }
+  return timeout;
+}
+
+uint64_t CommandTimeoutPolicy::CountOverdueCommands(
+    const CommandStats& current,
+    const CommandStats* previous) const {
+  auto iter = timeouts_.find(current.command_code());
+  if (iter == timeouts_.end()) {
+    return 0;
+  }
+  int64_t timeout_us = iter->second.InMicroseconds();
+  const LatencyHistogram& histogram = current.total_latency();
+  uint64_t overdue = 0;
+  // Bucket i > 0 counts latencies of at least 2^(i - 1) microseconds.
+  for (int i = 1; i < histogram.buckets_size(); ++i) {
+    if ((1ll << (i - 1)) < timeout_us) {
+      continue;
+    }
+    overdue += histogram.buckets(i);
+    if (previous && i < previous->total_latency().buckets_size()) {
+      overdue -= previous->total_latency().buckets(i);
+    }
+  }
+  return overdue;
+}
+
+}  // namespace trunks
@@ -0,0 +1,87 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TRUNKS_COMMAND_TIMEOUT_POLICY_H_
+#define TRUNKS_COMMAND_TIMEOUT_POLICY_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <base/time/time.h>
+
+#include "trunks/tpm_generated.h"
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+class CommandStats;
+class ResourceManagerStats;
+
+// Derives how long a client waits for trunksd to answer a command from the
+// latencies trunksd measured for its command code, so a hung TPM is noticed
+// in seconds for quick commands. Key generation, and any command code without
+// enough samples or with samples beyond the histogram range, keeps the fixed
+// maximum timeout.
+class TRUNKS_EXPORT CommandTimeoutPolicy {
+ public:
+  // Some TPMs take minutes to generate an RSA key.
+  static const int kMaxTimeoutMs = 5 * 60 * 1000;
+  // Learned timeouts leave room for IPC and scheduling delays.
+  static const int kMinTimeoutMs = 10 * 1000;
+  // Learned timeouts are this multiple of the 99.9th percentile latency.
+  static const int kSafetyFactor = 4;
+  // The number of commands of a code needed before a timeout is learned.
+  static const uint64_t kMinSamples = 1000;
+
+  CommandTimeoutPolicy();
+  CommandTimeoutPolicy(const CommandTimeoutPolicy& other);
+  ~CommandTimeoutPolicy();
+
+  // Replaces the learned timeouts with those derived from |stats|, as returned
+  // by the trunksd GetResourceManagerStats method. The 99.9th percentile of a
+  // command code is the sum of those of its queue and total latencies.
+  void Learn(const ResourceManagerStats& stats);
+
+  // Returns whether a timeout has been learned for |code|.
+  bool HasLearnedTimeout(TPM_CC code) const;
+
+  // Returns the timeout for a command with |code|.
+  base::TimeDelta GetTimeout(TPM_CC code) const;
+
+  // Returns the timeout for the serialized |command|, or the maximum if it has
+  // no valid header.
+  base::TimeDelta GetCommandTimeout(const std::string& command) const;
+
+  // Returns the timeout for |commands| sent one after another: the sum of
+  // their timeouts, at most the maximum.
+  base::TimeDelta GetBatchTimeout(
+      const std::vector<std::string>& commands) const;
+
+  // Returns the number of |current| commands, less those in |previous|, whose
+  // total latency was at least the timeout learned for their code. |previous|
+  // may be null. Counts are only exact to a histogram bucket, so a command is
+  // counted if it fell in a bucket entirely beyond the timeout.
+  uint64_t CountOverdueCommands(const CommandStats& current,
+                                const CommandStats* previous) const;
+
+ private:
+  std::map<TPM_CC, base::TimeDelta> timeouts_;
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_COMMAND_TIMEOUT_POLICY_H_
@@ -0,0 +1,159 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/command_timeout_policy.h"
+
+#include <gtest/gtest.h>
+
+#include "trunks/interface.pb.h"
+
+namespace {
+
+const size_t kNumBuckets = 30;
+
+// Adds |count| commands with |command_code| to |stats|, all with a total
+// latency in |total_bucket| and, unless it is negative, a queue latency in
+// |queue_bucket|.
+void AddCommand(trunks::TPM_CC command_code,
+                uint64_t count,
+                size_t total_bucket,
+                int queue_bucket,
+                trunks::ResourceManagerStats* stats) {
+  trunks::CommandStats* command = stats->add_commands();
+  command->set_command_code(command_code);
+  command->set_count(count);
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    command->mutable_total_latency()->add_buckets(i == total_bucket ? count
+                                                                    : 0);
+    if (queue_bucket >= 0) {
+      command->mutable_queue_latency()->add_buckets(
+          i == static_cast<size_t>(queue_bucket) ? count : 0);
+    }
+  }
+}
+
+// Returns a command header with |command_code|.
+std::string MakeCommand(trunks::TPM_CC command_code) {
+  std::string command;
+  trunks::Serialize_TPM_ST(trunks::TPM_ST_NO_SESSIONS, &command);
+  trunks::Serialize_UINT32(10, &command);
+  trunks::Serialize_TPM_CC(command_code, &command);
+  return command;
+}
+
+}  // namespace
+
+namespace trunks {
+
+TEST(CommandTimeoutPolicyTest, DefaultsToMaximum) {
+  CommandTimeoutPolicy policy;
+  EXPECT_FALSE(policy.HasLearnedTimeout(TPM_CC_PCR_Read));
+  EXPECT_EQ(CommandTimeoutPolicy::kMaxTimeoutMs,
+            policy.GetTimeout(TPM_CC_PCR_Read).InMilliseconds());
+  EXPECT_EQ(CommandTimeoutPolicy::kMaxTimeoutMs,
+            policy.GetCommandTimeout("bad").InMilliseconds());
+}
+
+TEST(CommandTimeoutPolicyTest, LearnsFromTailLatency) {
+  ResourceManagerStats stats;
+  // Total latencies below 2^22 us and queue latencies below 2^20 us.
+  AddCommand(TPM_CC_Sign, 2000, 22, 20, &stats);
+  // Never below the minimum.
+  AddCommand(TPM_CC_PCR_Read, 2000, 10, -1, &stats);
+  CommandTimeoutPolicy policy;
+  policy.Learn(stats);
+  EXPECT_EQ(CommandTimeoutPolicy::kSafetyFactor * ((1 << 22) + (1 << 20)),
+            policy.GetTimeout(TPM_CC_Sign).InMicroseconds());
+  EXPECT_EQ(CommandTimeoutPolicy::kMinTimeoutMs,
+            policy.GetTimeout(TPM_CC_PCR_Read).InMilliseconds());
+  EXPECT_EQ(CommandTimeoutPolicy::kMinTimeoutMs,
+            policy.GetCommandTimeout(MakeCommand(TPM_CC_PCR_Read))
+                .InMilliseconds());
+}
+
+TEST(CommandTimeoutPolicyTest, IgnoresRareOutliers) {
+  ResourceManagerStats stats;
+  AddCommand(TPM_CC_PCR_Read, 2000, 10, -1, &stats);
+  // One in a thousand may be much slower, but not two.
+  LatencyHistogram* histogram =
+      stats.mutable_commands(0)->mutable_total_latency();
+  histogram->set_buckets(10, 1998);
+  histogram->set_buckets(25, 2);
+  CommandTimeoutPolicy policy;
+  policy.Learn(stats);
+  EXPECT_EQ(CommandTimeoutPolicy::kMinTimeoutMs,
+            policy.GetTimeout(TPM_CC_PCR_Read).InMilliseconds());
+  histogram->set_buckets(10, 1997);
+  histogram->set_buckets(25, 3);
+  policy.Learn(stats);
+  EXPECT_EQ(CommandTimeoutPolicy::kSafetyFactor * (1 << 25),
+            policy.GetTimeout(TPM_CC_PCR_Read).InMicroseconds());
+}
+
+TEST(CommandTimeoutPolicyTest, KeepsMaximum) {
+  ResourceManagerStats stats;
+  // Key generation is never learned.
+  AddCommand(TPM_CC_Create, 2000, 10, -1, &stats);
+  AddCommand(TPM_CC_CreatePrimary, 2000, 10, -1, &stats);
+  // Too few samples.
+  AddCommand(TPM_CC_Sign, CommandTimeoutPolicy::kMinSamples - 1, 10, -1,
+             &stats);
+  // Latencies in the unbounded last bucket.
+  AddCommand(TPM_CC_Unseal, 2000, kNumBuckets - 1, -1, &stats);
+  // Timeouts beyond the maximum.
+  AddCommand(TPM_CC_Load, 2000, kNumBuckets - 2, -1, &stats);
+  CommandTimeoutPolicy policy;
+  policy.Learn(stats);
+  for (TPM_CC code : {TPM_CC_Create, TPM_CC_CreatePrimary, TPM_CC_Sign,
+                      TPM_CC_Unseal, TPM_CC_Load}) {
+    EXPECT_FALSE(policy.HasLearnedTimeout(code));
+    EXPECT_EQ(CommandTimeoutPolicy::kMaxTimeoutMs,
+              policy.GetTimeout(code).InMilliseconds());
+  }
+}
+
+TEST(CommandTimeoutPolicyTest, BatchTimeout) {
+  ResourceManagerStats stats;
+  AddCommand(TPM_CC_PCR_Read, 2000, 10, -1, &stats);
+  CommandTimeoutPolicy policy;
+  policy.Learn(stats);
+  std::vector<std::string> commands(3, MakeCommand(TPM_CC_PCR_Read));
+  EXPECT_EQ(3 * CommandTimeoutPolicy::kMinTimeoutMs,
+            policy.GetBatchTimeout(commands).InMilliseconds());
+  commands.push_back(MakeCommand(TPM_CC_Create));
+  EXPECT_EQ(CommandTimeoutPolicy::kMaxTimeoutMs,
+            policy.GetBatchTimeout(commands).InMilliseconds());
+}
+
+TEST(CommandTimeoutPolicyTest, CountOverdueCommands) {
+  ResourceManagerStats stats;
+  AddCommand(TPM_CC_PCR_Read, 2000, 10, -1, &stats);
+  CommandTimeoutPolicy policy;
+  policy.Learn(stats);
+  CommandStats previous = stats.commands(0);
+  CommandStats current = previous;
+  // 2^23 us is under the 10 second timeout, 2^24 us is not.
+  current.mutable_total_latency()->set_buckets(24, 1);
+  current.mutable_total_latency()->set_buckets(25, 2);
+  EXPECT_EQ(2u, policy.CountOverdueCommands(current, nullptr));
+  previous.mutable_total_latency()->set_buckets(25, 1);
+  EXPECT_EQ(1u, policy.CountOverdueCommands(current, &previous));
+  // Nothing is overdue without a learned timeout.
+  current.set_command_code(TPM_CC_Sign);
+  EXPECT_EQ(0u, policy.CountOverdueCommands(current, nullptr));
+}
+
+}  // namespace trunks
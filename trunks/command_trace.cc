@@ -0,0 +1,225 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/command_trace.h"
+
+#include <base/files/file_util.h>
+#include <base/logging.h>
+
+namespace {
+
+const char kTraceMagic[] = "TRKT";
+const trunks::UINT32 kTraceVersion = 1;
+// The size of a record before its command bytes.
+const size_t kRecordHeaderSize = 29;
+// Bounds the command size read from a corrupt trace.
+const trunks::UINT32 kMaxTraceCommandSize = 1 << 16;
+// The size of a TPM command header: tag (2 bytes), size (4 bytes) and command
+// code (4 bytes).
+const size_t kHeaderSize = 10;
+
+// Reads the big-endian 16 or 32-bit value at |offset| of |data|. Returns false
+// if |data| is too short.
+bool ReadUint16(const std::string& data, size_t offset, size_t* value) {
+  if (data.size() < offset + 2) {
+    return false;
+  }
+  *value = (static_cast<uint8_t>(data[offset]) << 8) |
+           static_cast<uint8_t>(data[offset + 1]);
+  return true;
+}
+
+bool ReadUint32(const std::string& data, size_t offset, size_t* value) {
+  size_t high = 0;
+  size_t low = 0;
+  if (!ReadUint16(data, offset, &high) ||
+      !ReadUint16(data, offset + 2, &low)) {
+    return false;
+  }
+  *value = (high << 16) | low;
+  return true;
+}
+
+// Zeroes the payload of the TPM2B at |*offset| of |data| and advances
+// |*offset| past it. Returns false if |data| is too short.
+bool ZeroTpm2b(std::string* data, size_t* offset) {
+  size_t size = 0;
+  if (!ReadUint16(*data, *offset, &size) ||
+      data->size() < *offset + 2 + size) {
+    return false;
+  }
+  data->replace(*offset + 2, size, size, '\0');
+  *offset += 2 + size;
+  return true;
+}
+
+// Returns true if the first parameter of a command |code| is a TPM2B holding
+// an authorization value or private data.
+bool HasSecretFirstParameter(trunks::TPM_CC code) {
+  switch (code) {
+    case trunks::TPM_CC_Create:
+    case trunks::TPM_CC_CreatePrimary:
+    case trunks::TPM_CC_HierarchyChangeAuth:
+    case trunks::TPM_CC_Import:
+    case trunks::TPM_CC_LoadExternal:
+    case trunks::TPM_CC_NV_ChangeAuth:
+    case trunks::TPM_CC_NV_DefineSpace:
+    case trunks::TPM_CC_ObjectChangeAuth:
+      return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+namespace trunks {
+
+std::string RedactCommand(const std::string& command) {
+  std::string redacted = command;
+  size_t tag = 0;
+  size_t code = 0;
+  if (!ReadUint16(command, 0, &tag) || !ReadUint32(command, 6, &code)) {
+    return redacted;
+  }
+  size_t offset = kHeaderSize + 4 * GetNumberOfRequestHandles(code);
+  if (tag == TPM_ST_SESSIONS) {
+    size_t auth_size = 0;
+    if (!ReadUint32(command, offset, &auth_size)) {
+      return redacted;
+    }
+    offset += 4;
+    size_t auth_end = offset + auth_size;
+    // Each session: handle, nonce, attributes and the HMAC or password.
+    while (offset < auth_end) {
+      offset += 4;
+      size_t nonce_size = 0;
+      if (!ReadUint16(command, offset, &nonce_size)) {
+        return redacted;
+      }
+      offset += 2 + nonce_size + 1;
+      if (!ZeroTpm2b(&redacted, &offset)) {
+        return redacted;
+      }
+    }
+    offset = auth_end;
+  }
+  if (HasSecretFirstParameter(code)) {
+    ZeroTpm2b(&redacted, &offset);
+  }
+  return redacted;
+}
+
+TraceWriter::TraceWriter() {}
+
+TraceWriter::~TraceWriter() {}
+
+bool TraceWriter::Open(const base::FilePath& path) {
+  file_.reset(base::OpenFile(path, "wb"));
+  if (!file_) {
+    PLOG(ERROR) << "Failed to create " << path.value();
+    return false;
+  }
+  std::string header(kTraceMagic, 4);
+  Serialize_UINT32(kTraceVersion, &header);
+  return fwrite(header.data(), header.size(), 1, file_.get()) == 1;
+}
+
+bool TraceWriter::Write(const TraceRecord& record) {
+  if (!file_) {
+    return false;
+  }
+  std::string data;
+  Serialize_UINT8(record.type, &data);
+  Serialize_UINT64(record.offset.InMicroseconds(), &data);
+  Serialize_UINT32(record.client_id, &data);
+  Serialize_UINT32(record.response_code, &data);
+  Serialize_UINT32(record.response_size, &data);
+  Serialize_UINT32(record.latency.InMicroseconds(), &data);
+  Serialize_UINT32(record.command.size(), &data);
+  data += record.command;
+  if (fwrite(data.data(), data.size(), 1, file_.get()) != 1) {
+    PLOG(ERROR) << "Failed to write trace record.";
+    file_.reset();
+    return false;
+  }
+  return true;
+}
+
+TraceReader::TraceReader() {}
+
+TraceReader::~TraceReader() {}
+
+bool TraceReader::Open(const base::FilePath& path) {
+  file_.reset(base::OpenFile(path, "rb"));
+  if (!file_) {
+    PLOG(ERROR) << "Failed to open " << path.value();
+    return false;
+  }
+  std::string header;
+  UINT32 version = 0;
+  if (!ReadBytes(8, &header) || header.compare(0, 4, kTraceMagic) != 0) {
+    LOG(ERROR) << path.value() << " is not a trunks trace.";
+    return false;
+  }
+  std::string buffer = header.substr(4);
+  if (Parse_UINT32(&buffer, &version, nullptr) != TPM_RC_SUCCESS ||
+      version != kTraceVersion) {
+    LOG(ERROR) << "Unsupported trace version " << version;
+    return false;
+  }
+  return true;
+}
+
+bool TraceReader::Read(TraceRecord* record) {
+  std::string buffer;
+  if (!file_ || !ReadBytes(kRecordHeaderSize, &buffer)) {
+    return false;
+  }
+  UINT8 type = 0;
+  UINT64 offset_us = 0;
+  UINT32 latency_us = 0;
+  UINT32 command_size = 0;
+  if (Parse_UINT8(&buffer, &type, nullptr) != TPM_RC_SUCCESS ||
+      Parse_UINT64(&buffer, &offset_us, nullptr) != TPM_RC_SUCCESS ||
+      Parse_UINT32(&buffer, &record->client_id, nullptr) != TPM_RC_SUCCESS ||
+      Parse_UINT32(&buffer, &record->response_code, nullptr) !=
+          TPM_RC_SUCCESS ||
+      Parse_UINT32(&buffer, &record->response_size, nullptr) !=
+          TPM_RC_SUCCESS ||
+      Parse_UINT32(&buffer, &latency_us, nullptr) != TPM_RC_SUCCESS ||
+      Parse_UINT32(&buffer, &command_size, nullptr) != TPM_RC_SUCCESS ||
+      (type != TraceRecord::kCommand &&
+       type != TraceRecord::kClientDisconnected) ||
+      command_size > kMaxTraceCommandSize) {
+    LOG(ERROR) << "Corrupt trace record.";
+    return false;
+  }
+  record->type = static_cast<TraceRecord::Type>(type);
+  record->offset = base::TimeDelta::FromMicroseconds(offset_us);
+  record->latency = base::TimeDelta::FromMicroseconds(latency_us);
+  return ReadBytes(command_size, &record->command);
+}
+
+bool TraceReader::ReadBytes(size_t size, std::string* data) {
+  data->resize(size);
+  if (size == 0) {
+    return true;
+  }
+  return fread(&(*data)[0], size, 1, file_.get()) == 1;
+}
+
+}  // namespace trunks
@@ -0,0 +1,107 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef TRUNKS_COMMAND_TRACE_H_
+#define TRUNKS_COMMAND_TRACE_H_
+
+#include <stdio.h>
+
+#include <string>
+
+#include <base/files/file_path.h>
+#include <base/files/scoped_file.h>
+#include <base/macros.h>
+#include <base/time/time.h>
+
+#include "trunks/tpm_generated.h"
+
+namespace trunks {
+
+// One event in a command trace. Commands are recorded as clients sent them,
+// with authorization values and secret parameters zeroed (see
+// RedactCommand). Responses may carry secrets, so only their response code and
+// size are kept.
+struct TraceRecord {
+  enum Type {
+    kCommand = 1,
+    kClientDisconnected = 2,
+  };
+
+  Type type = kCommand;
+  // The time since the trace started.
+  base::TimeDelta offset;
+  // Numbers clients in the order they first sent a command, starting at 1.
+  // Commands sent without client identity use zero.
+  uint32_t client_id = 0;
+  // The rest applies to kCommand records only.
+  std::string command;
+  TPM_RC response_code = TPM_RC_SUCCESS;
+  uint32_t response_size = 0;
+  base::TimeDelta latency;
+};
+
+// Returns a copy of |command| with the authorization values of its sessions
+// and the secret parameters of commands which set authorization values or
+// import private data zeroed. Sizes are kept so the copy still parses and
+// costs the TPM the same work.
+std::string RedactCommand(const std::string& command);
+
+// Appends TraceRecords to a trace file. A trace is a header followed by
+// records serialized as TPM data is, big-endian with length-prefixed command
+// bytes.
+class TraceWriter {
+ public:
+  TraceWriter();
+  ~TraceWriter();
+
+  // Creates or truncates the trace at |path|. Returns true on success.
+  bool Open(const base::FilePath& path);
+
+  // Appends |record|. Returns false if the trace could not be written.
+  bool Write(const TraceRecord& record);
+
+ private:
+  base::ScopedFILE file_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceWriter);
+};
+
+// Reads the TraceRecords of a trace file in order.
+class TraceReader {
+ public:
+  TraceReader();
+  ~TraceReader();
+
+  // Opens the trace at |path| and checks its header. Returns true on success.
+  bool Open(const base::FilePath& path);
+
+  // Reads the next |record|. Returns false at the end of the trace or if it is
+  // corrupt.
+  bool Read(TraceRecord* record);
+
+ private:
+  // Reads exactly |size| bytes into |data|.
+  bool ReadBytes(size_t size, std::string* data);
+
+  base::ScopedFILE file_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceReader);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_COMMAND_TRACE_H_
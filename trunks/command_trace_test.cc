@@ -0,0 +1,120 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/command_trace.h"
+
+#include <base/files/scoped_temp_dir.h>
+#include <gtest/gtest.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/mock_command_transceiver.h"
+#include "trunks/password_authorization_delegate.h"
+#include "trunks/tracing_command_transceiver.h"
+
+using testing::_;
+using testing::Return;
+
+namespace trunks {
+
+TEST(CommandTraceTest, RedactsPasswordsAndNewAuth) {
+  PasswordAuthorizationDelegate delegate("old_secret");
+  std::string command;
+  ASSERT_EQ(TPM_RC_SUCCESS,
+            Tpm::SerializeCommand_HierarchyChangeAuth(
+                TPM_RH_OWNER, "", Make_TPM2B_DIGEST("new_secret"), &command,
+                &delegate));
+  ASSERT_NE(std::string::npos, command.find("old_secret"));
+  ASSERT_NE(std::string::npos, command.find("new_secret"));
+  std::string redacted = RedactCommand(command);
+  EXPECT_EQ(command.size(), redacted.size());
+  EXPECT_EQ(std::string::npos, redacted.find("old_secret"));
+  EXPECT_EQ(std::string::npos, redacted.find("new_secret"));
+  // The header and handle are kept.
+  EXPECT_EQ(command.substr(0, 14), redacted.substr(0, 14));
+}
+
+TEST(CommandTraceTest, KeepsPublicParameters) {
+  std::string command;
+  ASSERT_EQ(TPM_RC_SUCCESS,
+            Tpm::SerializeCommand_GetRandom(16, &command, nullptr));
+  EXPECT_EQ(command, RedactCommand(command));
+  // Malformed commands are returned unchanged.
+  EXPECT_EQ("abc", RedactCommand("abc"));
+}
+
+TEST(CommandTraceTest, WriteAndRead) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath path = temp_dir.path().Append("trace");
+  TraceRecord command;
+  command.offset = base::TimeDelta::FromMicroseconds(1234);
+  command.client_id = 7;
+  command.command = "command";
+  command.response_code = TPM_RC_RETRY;
+  command.response_size = 10;
+  command.latency = base::TimeDelta::FromMicroseconds(42);
+  TraceRecord disconnect;
+  disconnect.type = TraceRecord::kClientDisconnected;
+  disconnect.client_id = 7;
+  {
+    TraceWriter writer;
+    ASSERT_TRUE(writer.Open(path));
+    EXPECT_TRUE(writer.Write(command));
+    EXPECT_TRUE(writer.Write(disconnect));
+  }
+  TraceReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  TraceRecord record;
+  ASSERT_TRUE(reader.Read(&record));
+  EXPECT_EQ(TraceRecord::kCommand, record.type);
+  EXPECT_EQ(command.offset, record.offset);
+  EXPECT_EQ(7u, record.client_id);
+  EXPECT_EQ("command", record.command);
+  EXPECT_EQ(TPM_RC_RETRY, record.response_code);
+  EXPECT_EQ(10u, record.response_size);
+  EXPECT_EQ(command.latency, record.latency);
+  ASSERT_TRUE(reader.Read(&record));
+  EXPECT_EQ(TraceRecord::kClientDisconnected, record.type);
+  EXPECT_FALSE(reader.Read(&record));
+}
+
+TEST(CommandTraceTest, TracingTransceiver) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath path = temp_dir.path().Append("trace");
+  testing::StrictMock<MockCommandTransceiver> next_transceiver;
+  EXPECT_CALL(next_transceiver, SendCommandAndWait("command"))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_LOCKOUT)));
+  {
+    std::unique_ptr<TraceWriter> writer(new TraceWriter());
+    ASSERT_TRUE(writer->Open(path));
+    TracingCommandTransceiver transceiver(&next_transceiver,
+                                          std::move(writer));
+    EXPECT_EQ(CreateErrorResponse(TPM_RC_LOCKOUT),
+              transceiver.SendCommandAndWait("command"));
+  }
+  TraceReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  TraceRecord record;
+  ASSERT_TRUE(reader.Read(&record));
+  EXPECT_EQ("command", record.command);
+  EXPECT_EQ(0u, record.client_id);
+  EXPECT_EQ(TPM_RC_LOCKOUT, record.response_code);
+  EXPECT_FALSE(reader.Read(&record));
+}
+
+}  // namespace trunks
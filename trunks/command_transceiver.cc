@@ -0,0 +1,96 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/command_transceiver.h"
+
+#include <base/callback.h>
+
+#include "trunks/tpm_generated.h"
+
+namespace {
+
+// The offset of the response code in a TPM response header: tag (2 bytes)
+// followed by size (4 bytes).
+const size_t kResponseCodeOffset = 6;
+
+// Returns true if |response| is well-formed enough to carry a response code
+// and the code is TPM_RC_SUCCESS.
+bool IsSuccessResponse(const std::string& response) {
+  if (response.size() < kResponseCodeOffset + sizeof(trunks::TPM_RC)) {
+    return false;
+  }
+  std::string buffer =
+      response.substr(kResponseCodeOffset, sizeof(trunks::TPM_RC));
+  trunks::TPM_RC response_code = 0;
+  if (trunks::Parse_TPM_RC(&buffer, &response_code, nullptr) !=
+      trunks::TPM_RC_SUCCESS) {
+    return false;
+  }
+  return response_code == trunks::TPM_RC_SUCCESS;
+}
+
+}  // namespace
+
+namespace trunks {
+
+void CommandTransceiver::SendCommandBatch(
+    const std::vector<std::string>& commands,
+    bool stop_on_failure,
+    const BatchResponseCallback& callback) {
+  callback.Run(SendCommandBatchAndWait(commands, stop_on_failure));
+}
+
+void CommandTransceiver::SendCommandForClient(
+    const std::string& client,
+    const std::string& command,
+    const ResponseCallback& callback) {
+  SendCommand(command, callback);
+}
+
+std::vector<std::string> CommandTransceiver::SendCommandsAndWait(
+    const std::vector<std::string>& commands) {
+  std::vector<std::string> responses;
+  responses.reserve(commands.size());
+  for (const auto& command : commands) {
+    responses.push_back(SendCommandAndWait(command));
+  }
+  return responses;
+}
+
+void CommandTransceiver::SendScheduledCommandForClient(
+    const std::string& client,
+    const std::string& command,
+    RequestedPriority priority,
+    base::TimeTicks deadline,
+    const ResponseCallback& callback) {
+  SendCommandForClient(client, command, callback);
+}
+
+std::vector<std::string> CommandTransceiver::SendCommandBatchAndWait(
+    const std::vector<std::string>& commands,
+    bool stop_on_failure) {
+  std::vector<std::string> responses;
+  responses.reserve(commands.size());
+  for (const auto& command : commands) {
+    responses.push_back(SendCommandAndWait(command));
+    if (stop_on_failure && !IsSuccessResponse(responses.back())) {
+      break;
+    }
+  }
+  return responses;
+}
+
+}  // namespace trunks
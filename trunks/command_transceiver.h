@@ -18,16 +18,32 @@
 #define TRUNKS_COMMAND_TRANSCEIVER_H_
 
 #include <string>
+#include <vector>
 
 #include <base/callback_forward.h>
+#include <base/time/time.h>
+
+#include "trunks/trunks_export.h"
 
 namespace trunks {
 
 // CommandTransceiver is an interface that sends commands to a TPM device and
 // receives responses. It can operate synchronously or asynchronously.
-class CommandTransceiver {
+class TRUNKS_EXPORT CommandTransceiver {
  public:
   typedef base::Callback<void(const std::string& response)> ResponseCallback;
+  typedef base::Callback<void(const std::vector<std::string>& responses)>
+      BatchResponseCallback;
+
+  // How urgently a client needs a command, from most to least urgent. The
+  // values match CommandPriority in interface.proto.
+  enum RequestedPriority {
+    // Let the transceiver decide based on the command itself.
+    kRequestedPriorityDefault = 0,
+    kRequestedPriorityInteractive,
+    kRequestedPriorityBulk,
+    kRequestedPriorityBackground,
+  };
 
   virtual ~CommandTransceiver() {}
 
@@ -43,6 +59,54 @@ class CommandTransceiver {
   // with a well-formed error response.
   virtual std::string SendCommandAndWait(const std::string& command) = 0;
 
+  // Sends a batch of TPM |commands| asynchronously, in order. Implementations
+  // which serve multiple clients guarantee that no other command is interleaved
+  // with the batch. If |stop_on_failure| is true, commands following the first
+  // command with an unsuccessful response code are not sent. When done,
+  // |callback| is called with one response per command sent. The default
+  // implementation calls SendCommandBatchAndWait.
+  virtual void SendCommandBatch(const std::vector<std::string>& commands,
+                                bool stop_on_failure,
+                                const BatchResponseCallback& callback);
+
+  // Sends a batch of TPM |commands| synchronously. See SendCommandBatch for
+  // details. The default implementation calls SendCommandAndWait for each
+  // command.
+  virtual std::vector<std::string> SendCommandBatchAndWait(
+      const std::vector<std::string>& commands,
+      bool stop_on_failure);
+
+  // Sends independent TPM |commands| synchronously and returns one response
+  // per command, in order. Unlike a batch, other commands may be interleaved
+  // and transceivers may keep several of the commands in flight at once, so
+  // no command may depend on the effects of another. The default
+  // implementation calls SendCommandAndWait for each command.
+  virtual std::vector<std::string> SendCommandsAndWait(
+      const std::vector<std::string>& commands);
+
+  // Sends a TPM |command| asynchronously on behalf of the IPC |client|, an
+  // identifier which is stable for the lifetime of the client's connection.
+  // Transceivers which track per-client resources override this; the default
+  // ignores |client| and calls SendCommand.
+  virtual void SendCommandForClient(const std::string& client,
+                                    const std::string& command,
+                                    const ResponseCallback& callback);
+
+  // Like SendCommandForClient, with scheduling hints from the |client|.
+  // Transceivers which queue commands should prefer commands with a higher
+  // |priority| and, if |deadline| is not null, fail the command with
+  // TRUNKS_RC_DEADLINE_EXCEEDED instead of sending it once |deadline| has
+  // passed. The default ignores the hints and calls SendCommandForClient.
+  virtual void SendScheduledCommandForClient(const std::string& client,
+                                             const std::string& command,
+                                             RequestedPriority priority,
+                                             base::TimeTicks deadline,
+                                             const ResponseCallback& callback);
+
+  // Notifies the transceiver that |client| has gone away so any resources it
+  // still holds can be released. The default does nothing.
+  virtual void OnClientDisconnected(const std::string& client) {}
+
   // Initializes the actual interface, replaced by the derived classes, where
   // needed.
   virtual bool Init() { return true; }
@@ -0,0 +1,97 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/context_store.h"
+
+#include <base/logging.h>
+#include <base/stl_util.h>
+
+namespace trunks {
+
+ContextStore::ContextStore(const base::FilePath& path) : path_(path) {}
+
+ContextStore::~ContextStore() {}
+
+bool ContextStore::Init() {
+  file_.Initialize(path_, base::File::FLAG_CREATE_ALWAYS |
+                              base::File::FLAG_READ | base::File::FLAG_WRITE);
+  if (!file_.IsValid()) {
+    LOG(ERROR) << "Failed to open context store " << path_.value() << ": "
+               << base::File::ErrorToString(file_.error_details());
+    return false;
+  }
+  num_slots_ = 0;
+  free_slots_.clear();
+  return true;
+}
+
+bool ContextStore::Put(const std::string& blob, uint32_t* slot) {
+  if (!file_.IsValid() || blob.size() > kMaxBlobSize) {
+    return false;
+  }
+  uint32_t index = num_slots_;
+  if (!free_slots_.empty()) {
+    index = free_slots_.back();
+  }
+  std::string data;
+  data.reserve(2 + blob.size());
+  data.push_back(static_cast<char>(blob.size() >> 8));
+  data.push_back(static_cast<char>(blob.size()));
+  data.append(blob);
+  if (file_.Write(static_cast<int64_t>(index) * kSlotSize, data.data(),
+                  data.size()) != static_cast<int>(data.size())) {
+    PLOG(ERROR) << "Failed to write context store slot " << index;
+    return false;
+  }
+  if (index == num_slots_) {
+    ++num_slots_;
+  } else {
+    free_slots_.pop_back();
+  }
+  *slot = index;
+  return true;
+}
+
+bool ContextStore::Get(uint32_t slot, std::string* blob) {
+  CHECK_LT(slot, num_slots_);
+  int64_t offset = static_cast<int64_t>(slot) * kSlotSize;
+  char size_bytes[2];
+  if (file_.Read(offset, size_bytes, 2) != 2) {
+    PLOG(ERROR) << "Failed to read context store slot " << slot;
+    return false;
+  }
+  size_t size = (static_cast<uint8_t>(size_bytes[0]) << 8) |
+                static_cast<uint8_t>(size_bytes[1]);
+  if (size > kMaxBlobSize) {
+    LOG(ERROR) << "Corrupt context store slot " << slot;
+    return false;
+  }
+  blob->resize(size);
+  if (size > 0 && file_.Read(offset + 2, base::string_as_array(blob), size) !=
+                      static_cast<int>(size)) {
+    PLOG(ERROR) << "Failed to read context store slot " << slot;
+    return false;
+  }
+  return true;
+}
+
+void ContextStore::Free(uint32_t slot) {
+  CHECK_LT(slot, num_slots_);
+  free_slots_.push_back(slot);
+}
+
+}  // namespace trunks
@@ -0,0 +1,76 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef TRUNKS_CONTEXT_STORE_H_
+#define TRUNKS_CONTEXT_STORE_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <base/files/file.h>
+#include <base/files/file_path.h>
+#include <base/macros.h>
+
+namespace trunks {
+
+// ContextStore keeps saved context blobs out of process memory, in fixed size
+// slots of a file which should be on a tmpfs. Freed slots are reused before the
+// file grows, so it stays as large as the most blobs stored at once. Blobs are
+// copied in and out with pread and pwrite rather than through a mapping so
+// stored blobs never count towards the resident memory of the process.
+class ContextStore {
+ public:
+  // The size of a slot, which holds a 16-bit length and the blob.
+  static const size_t kSlotSize = 2048;
+  // The largest blob which fits in a slot.
+  static const size_t kMaxBlobSize = kSlotSize - 2;
+
+  explicit ContextStore(const base::FilePath& path);
+  ~ContextStore();
+
+  // Creates or truncates the store file. Returns true on success.
+  bool Init();
+
+  // Copies |blob| to a free slot and returns its index in |slot|. Returns false
+  // if |blob| is larger than kMaxBlobSize or cannot be written.
+  bool Put(const std::string& blob, uint32_t* slot);
+
+  // Reads the blob in |slot| into |blob|. Returns false on failure.
+  bool Get(uint32_t slot, std::string* blob);
+
+  // Makes |slot| available to later calls to Put().
+  void Free(uint32_t slot);
+
+  // Returns the number of slots holding a blob.
+  size_t used_slots() const { return num_slots_ - free_slots_.size(); }
+
+ private:
+  base::FilePath path_;
+  base::File file_;
+  // The number of slots the file has grown to.
+  uint32_t num_slots_ = 0;
+  // Slots below |num_slots_| which hold no blob.
+  std::vector<uint32_t> free_slots_;
+
+  DISALLOW_COPY_AND_ASSIGN(ContextStore);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_CONTEXT_STORE_H_
@@ -0,0 +1,101 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/context_store.h"
+
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <gtest/gtest.h>
+
+namespace trunks {
+
+class ContextStoreTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.path().Append("contexts");
+  }
+
+ protected:
+  base::ScopedTempDir temp_dir_;
+  base::FilePath path_;
+};
+
+TEST_F(ContextStoreTest, PutAndGet) {
+  ContextStore store(path_);
+  ASSERT_TRUE(store.Init());
+  uint32_t slot1 = 0;
+  uint32_t slot2 = 0;
+  std::string large(ContextStore::kMaxBlobSize, 'x');
+  ASSERT_TRUE(store.Put("context1", &slot1));
+  ASSERT_TRUE(store.Put(large, &slot2));
+  EXPECT_NE(slot1, slot2);
+  EXPECT_EQ(2u, store.used_slots());
+  std::string blob;
+  ASSERT_TRUE(store.Get(slot1, &blob));
+  EXPECT_EQ("context1", blob);
+  ASSERT_TRUE(store.Get(slot2, &blob));
+  EXPECT_EQ(large, blob);
+  // Blobs which do not fit in a slot are refused.
+  uint32_t slot3 = 0;
+  EXPECT_FALSE(store.Put(large + "x", &slot3));
+  EXPECT_EQ(2u, store.used_slots());
+}
+
+TEST_F(ContextStoreTest, ReusesFreedSlots) {
+  ContextStore store(path_);
+  ASSERT_TRUE(store.Init());
+  uint32_t slot1 = 0;
+  uint32_t slot2 = 0;
+  ASSERT_TRUE(store.Put("context1", &slot1));
+  ASSERT_TRUE(store.Put("context2", &slot2));
+  store.Free(slot1);
+  EXPECT_EQ(1u, store.used_slots());
+  uint32_t slot3 = 0;
+  ASSERT_TRUE(store.Put("context3", &slot3));
+  EXPECT_EQ(slot1, slot3);
+  std::string blob;
+  ASSERT_TRUE(store.Get(slot3, &blob));
+  EXPECT_EQ("context3", blob);
+  ASSERT_TRUE(store.Get(slot2, &blob));
+  EXPECT_EQ("context2", blob);
+  // The file never grew past the two slots in use at once.
+  int64_t file_size = 0;
+  ASSERT_TRUE(base::GetFileSize(path_, &file_size));
+  EXPECT_LE(file_size, static_cast<int64_t>(2 * ContextStore::kSlotSize));
+}
+
+TEST_F(ContextStoreTest, InitTruncates) {
+  ContextStore store(path_);
+  ASSERT_TRUE(store.Init());
+  uint32_t slot = 0;
+  ASSERT_TRUE(store.Put("context", &slot));
+  ASSERT_TRUE(store.Init());
+  EXPECT_EQ(0u, store.used_slots());
+  int64_t file_size = -1;
+  ASSERT_TRUE(base::GetFileSize(path_, &file_size));
+  EXPECT_EQ(0, file_size);
+}
+
+TEST_F(ContextStoreTest, InitFailure) {
+  ContextStore store(temp_dir_.path().Append("missing").Append("contexts"));
+  EXPECT_FALSE(store.Init());
+  uint32_t slot = 0;
+  EXPECT_FALSE(store.Put("context", &slot));
+}
+
+}  // namespace trunks
@@ -31,6 +31,14 @@ constexpr char kTrunksServiceName[] = "org.chromium.Trunks";
 
 // Methods exported by trunks.
 constexpr char kSendCommand[] = "SendCommand";
+constexpr char kSendCommandBatch[] = "SendCommandBatch";
+constexpr char kOpenSharedMemoryChannel[] = "OpenSharedMemoryChannel";
+constexpr char kGetResourceManagerStats[] = "GetResourceManagerStats";
+constexpr char kGetCapabilitySnapshot[] = "GetCapabilitySnapshot";
+constexpr char kGetTelemetry[] = "GetTelemetry";
+
+// Signals emitted by trunks.
+constexpr char kTpmStateChanged[] = "TpmStateChanged";
 
 };  // namespace trunks
 
@@ -29,8 +29,9 @@ const trunks::TPM_RC kFormatOneErrorMask = 0x0BF;
 const trunks::TPM_RC kFormatOneSubjectMask = 0x700;
 const trunks::TPM_RC kLayerMask = 0xFFFFF000;
 
-// Returns a known error code or the empty string if unknown.
-std::string GetErrorStringInternal(trunks::TPM_RC error) {
+// Returns the name of a known error code or nullptr if unknown. The names are
+// string literals, so no lookup allocates.
+const char* GetErrorStringInternal(trunks::TPM_RC error) {
   switch (error) {
     case trunks::TPM_RC_SUCCESS:
       return "TPM_RC_SUCCESS";
@@ -240,6 +241,10 @@ std::string GetErrorStringInternal(trunks::TPM_RC error) {
       return "TRUNKS_RC_IPC_ERROR";
     case trunks::TRUNKS_RC_SESSION_SETUP_ERROR:
       return "TRUNKS_RC_SESSION_SETUP_ERROR";
+    case trunks::TRUNKS_RC_DEADLINE_EXCEEDED:
+      return "TRUNKS_RC_DEADLINE_EXCEEDED";
+    case trunks::TRUNKS_RC_ENVELOPE_LOCKED:
+      return "TRUNKS_RC_ENVELOPE_LOCKED";
     case trunks::TCTI_RC_TRY_AGAIN:
       return "TCTI_RC_TRY_AGAIN";
     case trunks::TCTI_RC_GENERAL_FAILURE:
@@ -295,10 +300,10 @@ std::string GetErrorStringInternal(trunks::TPM_RC error) {
     case trunks::SAPI_RC_BAD_TCTI_STRUCTURE:
       return "SAPI_RC_BAD_TCTI_STRUCTURE";
     default:
-      return std::string();
+      return nullptr;
   }
   NOTREACHED();
-  return std::string();
+  return nullptr;
 }
 
 bool IsFormatOne(trunks::TPM_RC error) {
@@ -310,37 +315,73 @@ bool IsFormatOne(trunks::TPM_RC error) {
 namespace trunks {
 
 std::string GetErrorString(TPM_RC error) {
-  std::string error_string = GetErrorStringInternal(error);
-  if (!error_string.empty()) {
-    return error_string;
+  const char* name = GetErrorStringInternal(error);
+  if (name) {
+    return name;
   }
+  ErrorInfo info = DecodeError(error);
   std::stringstream ss;
+  if (info.from_resource_manager) {
+    ss << "Resource Manager: ";
+  }
+  switch (info.subject) {
+    case ErrorInfo::Subject::kParameter:
+      ss << "Parameter " << info.index << ": ";
+      break;
+    case ErrorInfo::Subject::kSession:
+      ss << "Session " << info.index << ": ";
+      break;
+    case ErrorInfo::Subject::kHandle:
+      ss << "Handle " << info.index << ": ";
+      break;
+    case ErrorInfo::Subject::kNone:
+      break;
+  }
+  if (info.name) {
+    ss << info.name;
+  } else {
+    // Report the error with only the resource manager layer removed.
+    if (info.from_resource_manager) {
+      error &= ~kLayerMask;
+    }
+    ss << "Unknown error: " << error << " (0x" << std::hex << error << ")";
+  }
+  return ss.str();
+}
+
+const char* GetErrorName(TPM_RC error) {
+  return GetErrorStringInternal(error);
+}
+
+ErrorInfo DecodeError(TPM_RC error) {
+  ErrorInfo info;
+  info.name = GetErrorStringInternal(error);
+  info.code = error;
+  if (info.name) {
+    return info;
+  }
   if ((error & kLayerMask) == kResourceManagerTpmErrorBase) {
     error &= ~kLayerMask;
-    error_string = GetErrorStringInternal(error);
-    ss << "Resource Manager: ";
+    info.from_resource_manager = true;
+    info.code = error;
+    info.name = GetErrorStringInternal(error);
   }
   // Check if we have a TPM 'Format-One' response code.
   if (IsFormatOne(error)) {
     if (error & TPM_RC_P) {
-      ss << "Parameter ";
+      info.subject = ErrorInfo::Subject::kParameter;
     } else if (error & TPM_RC_S) {
-      ss << "Session ";
+      info.subject = ErrorInfo::Subject::kSession;
     } else {
-      ss << "Handle ";
+      info.subject = ErrorInfo::Subject::kHandle;
     }
     // Bits 8-10 specify which handle / parameter / session.
-    ss << ((error & kFormatOneSubjectMask) >> 8) << ": ";
+    info.index = (error & kFormatOneSubjectMask) >> 8;
     // Mask out everything but the format bit and error number.
-    error_string = GetErrorStringInternal(error & kFormatOneErrorMask);
-    if (!error_string.empty()) {
-      ss << error_string;
-    }
-  }
-  if (error_string.empty()) {
-    ss << "Unknown error: " << error << " (0x" << std::hex << error << ")";
+    info.code = error & kFormatOneErrorMask;
+    info.name = GetErrorStringInternal(info.code);
   }
-  return ss.str();
+  return info;
 }
 
 TPM_RC GetFormatOneError(TPM_RC error) {
@@ -350,6 +391,21 @@ TPM_RC GetFormatOneError(TPM_RC error) {
   return error;
 }
 
+bool IsSessionNotLoadedError(TPM_RC error) {
+  if ((error & kLayerMask) == kResourceManagerTpmErrorBase) {
+    // The resource manager reports unknown virtual handles without a subject.
+    error &= ~kLayerMask;
+    if (error == TPM_RC_HANDLE) {
+      return true;
+    }
+  }
+  if (error >= TPM_RC_REFERENCE_S0 && error <= TPM_RC_REFERENCE_S6) {
+    return true;
+  }
+  return IsFormatOne(error) && GetFormatOneError(error) == TPM_RC_HANDLE &&
+         (error & TPM_RC_S) != 0 && (error & TPM_RC_P) == 0;
+}
+
 std::string CreateErrorResponse(TPM_RC error_code) {
   const uint32_t kErrorResponseSize = 10;
   std::string response;
@@ -42,6 +42,10 @@ const TPM_RC TRUNKS_RC_WRITE_ERROR = kTrunksErrorBase + 4;
 const TPM_RC TRUNKS_RC_IPC_ERROR = kTrunksErrorBase + 5;
 const TPM_RC TRUNKS_RC_SESSION_SETUP_ERROR = kTrunksErrorBase + 6;
 const TPM_RC TRUNKS_RC_INVALID_TPM_CONFIGURATION = kTrunksErrorBase + 7;
+// A command was not sent because its deadline passed while it was queued.
+const TPM_RC TRUNKS_RC_DEADLINE_EXCEEDED = kTrunksErrorBase + 8;
+// A SecretEnvelope operation needs an unlocked key-encryption key.
+const TPM_RC TRUNKS_RC_ENVELOPE_LOCKED = kTrunksErrorBase + 9;
 
 const TPM_RC TCTI_RC_TRY_AGAIN = kTctiErrorBase + 1;
 const TPM_RC TCTI_RC_GENERAL_FAILURE = kTctiErrorBase + 2;
@@ -75,12 +79,49 @@ const TPM_RC SAPI_RC_BAD_TCTI_STRUCTURE = kSapiErrorBase + 15;
 // Returns a description of |error|.
 TRUNKS_EXPORT std::string GetErrorString(TPM_RC error);
 
+// Returns the name of |error| if it is a known response code, e.g.
+// "TPM_RC_RETRY", or nullptr otherwise. Unlike GetErrorString() this does not
+// allocate, so it is suitable for logging on retry and other hot paths.
+// Format one errors with a subject are not known codes; see DecodeError().
+TRUNKS_EXPORT const char* GetErrorName(TPM_RC error);
+
+// The fields of a response code, see TPM 2.0 Part 2 Section 6.6.
+struct ErrorInfo {
+  // What a format one error refers to.
+  enum class Subject {
+    kNone,
+    kHandle,
+    kParameter,
+    kSession,
+  };
+  // The error with the resource manager layer, P and N bits removed. This can
+  // be compared to TPM_RC_* constant values.
+  TPM_RC code = TPM_RC_SUCCESS;
+  // The name of |code|, or nullptr if it is unknown.
+  const char* name = nullptr;
+  Subject subject = Subject::kNone;
+  // The 1-based handle, parameter or session index, or 0 if not given.
+  int index = 0;
+  // True if the resource manager reported the error on behalf of the TPM.
+  bool from_resource_manager = false;
+};
+
+// Splits |error| into its fields without allocating.
+TRUNKS_EXPORT ErrorInfo DecodeError(TPM_RC error);
+
 // Strips the P and N bits from a 'format one' error. If the given error code
 // is not a format one error, it is returned as is. The error that is returned
 // can be compared to TPM_RC_* constant values. See TPM 2.0 Part 2 Section 6.6
 // for details on format one errors.
 TRUNKS_EXPORT TPM_RC GetFormatOneError(TPM_RC error);
 
+// Returns true if |error| indicates that the session used for a command is no
+// longer loaded: either the TPM reports a bad session handle or a session
+// reference error, or the resource manager no longer knows a handle (e.g. it
+// was restarted). A command failing this way may succeed when retried once
+// with a newly started session.
+TRUNKS_EXPORT bool IsSessionNotLoadedError(TPM_RC error);
+
 // Creates a well-formed response with the given |error_code|.
 TRUNKS_EXPORT std::string CreateErrorResponse(TPM_RC error_code);
 
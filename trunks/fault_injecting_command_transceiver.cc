@@ -0,0 +1,305 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/fault_injecting_command_transceiver.h"
+
+#include <vector>
+
+#include <base/callback.h>
+#include <base/logging.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/threading/platform_thread.h>
+
+#include "trunks/error_codes.h"
+
+namespace {
+
+// The size of a TPM command header: tag (2 bytes), size (4 bytes) and command
+// code (4 bytes).
+const size_t kHeaderSize = 10;
+
+// Parses the command |code| from a |command| header.
+bool ParseCommandCode(const std::string& command, trunks::TPM_CC* code) {
+  if (command.size() < kHeaderSize) {
+    return false;
+  }
+  std::string buffer = command.substr(6, sizeof(trunks::TPM_CC));
+  return trunks::Parse_TPM_CC(&buffer, code, nullptr) ==
+         trunks::TPM_RC_SUCCESS;
+}
+
+// Parses the saved handle from the TPMS_CONTEXT parameter of a ContextLoad
+// |command|. It follows the 64-bit context sequence number.
+bool ParseSavedHandle(const std::string& command, trunks::TPM_HANDLE* handle) {
+  size_t offset = kHeaderSize + sizeof(trunks::UINT64);
+  if (command.size() < offset + sizeof(trunks::TPM_HANDLE)) {
+    return false;
+  }
+  std::string buffer = command.substr(offset, sizeof(trunks::TPM_HANDLE));
+  return trunks::Parse_TPM_HANDLE(&buffer, handle, nullptr) ==
+         trunks::TPM_RC_SUCCESS;
+}
+
+// Parses a latency range in milliseconds, e.g. "20-80" or just "50".
+bool ParseLatencyRange(const std::string& value,
+                       base::TimeDelta* min,
+                       base::TimeDelta* max) {
+  std::vector<std::string> bounds = base::SplitString(
+      value, "-", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL);
+  int64_t min_ms = 0;
+  int64_t max_ms = 0;
+  if (bounds.empty() || bounds.size() > 2 ||
+      !base::StringToInt64(bounds.front(), &min_ms) ||
+      !base::StringToInt64(bounds.back(), &max_ms) || min_ms < 0 ||
+      max_ms < min_ms) {
+    return false;
+  }
+  *min = base::TimeDelta::FromMilliseconds(min_ms);
+  *max = base::TimeDelta::FromMilliseconds(max_ms);
+  return true;
+}
+
+// Maps a warning name used in options to its response code.
+bool ParseWarning(const std::string& name, trunks::TPM_RC* warning) {
+  if (name == "retry") {
+    *warning = trunks::TPM_RC_RETRY;
+  } else if (name == "yielded") {
+    *warning = trunks::TPM_RC_YIELDED;
+  } else if (name == "memory") {
+    *warning = trunks::TPM_RC_MEMORY;
+  } else if (name == "object_memory") {
+    *warning = trunks::TPM_RC_OBJECT_MEMORY;
+  } else if (name == "session_memory") {
+    *warning = trunks::TPM_RC_SESSION_MEMORY;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+namespace trunks {
+
+FaultInjectingCommandTransceiver::FaultInjectingCommandTransceiver(
+    CommandTransceiver* next_transceiver,
+    uint32_t seed)
+    : next_transceiver_(next_transceiver), random_(seed) {}
+
+FaultInjectingCommandTransceiver::~FaultInjectingCommandTransceiver() {}
+
+bool FaultInjectingCommandTransceiver::ParseOptions(
+    const std::string& options) {
+  base::StringPairs pairs;
+  if (!base::SplitStringIntoKeyValuePairs(options, '=', ',', &pairs)) {
+    LOG(ERROR) << "Malformed fault injection options: " << options;
+    return false;
+  }
+  for (const auto& pair : pairs) {
+    const std::string& key = pair.first;
+    const std::string& value = pair.second;
+    TPM_RC warning = TPM_RC_SUCCESS;
+    double rate = 0.0;
+    size_t slots = 0;
+    base::TimeDelta min;
+    base::TimeDelta max;
+    if (ParseWarning(key, &warning)) {
+      if (!base::StringToDouble(value, &rate) || rate < 0.0 || rate > 1.0) {
+        LOG(ERROR) << "Invalid fault rate: " << value;
+        return false;
+      }
+      set_fault_rate(warning, rate);
+    } else if (key == "latency") {
+      if (!ParseLatencyRange(value, &min, &max)) {
+        LOG(ERROR) << "Invalid latency: " << value;
+        return false;
+      }
+      set_default_latency(min, max);
+    } else if (key.compare(0, 8, "latency:") == 0) {
+      uint32_t code = 0;
+      if (!base::HexStringToUInt(key.substr(8), &code) ||
+          !ParseLatencyRange(value, &min, &max)) {
+        LOG(ERROR) << "Invalid command latency: " << key << "=" << value;
+        return false;
+      }
+      set_latency(code, min, max);
+    } else if (key == "object_slots" || key == "session_slots") {
+      if (!base::StringToSizeT(value, &slots)) {
+        LOG(ERROR) << "Invalid slot count: " << value;
+        return false;
+      }
+      if (key == "object_slots") {
+        set_object_slots(slots);
+      } else {
+        set_session_slots(slots);
+      }
+    } else {
+      LOG(ERROR) << "Unknown fault injection option: " << key;
+      return false;
+    }
+  }
+  double total_rate = 0.0;
+  for (const auto& entry : fault_rates_) {
+    total_rate += entry.second;
+  }
+  if (total_rate > 1.0) {
+    LOG(ERROR) << "Fault rates add up to more than 1.";
+    return false;
+  }
+  return true;
+}
+
+void FaultInjectingCommandTransceiver::SendCommand(
+    const std::string& command,
+    const ResponseCallback& callback) {
+  callback.Run(SendCommandAndWait(command));
+}
+
+std::string FaultInjectingCommandTransceiver::SendCommandAndWait(
+    const std::string& command) {
+  // Warnings are returned before the command executes, as a TPM would, so the
+  // caller may simply retry.
+  TPM_RC fault = DrawFault();
+  if (fault == TPM_RC_SUCCESS) {
+    fault = CheckSlots(command);
+  }
+  if (fault != TPM_RC_SUCCESS) {
+    ++injected_fault_count_;
+    VLOG(1) << "Injecting fault: " << GetErrorString(fault);
+    return CreateErrorResponse(fault);
+  }
+  base::TimeDelta latency = DrawLatency(command);
+  if (!latency.is_zero()) {
+    Sleep(latency);
+  }
+  return next_transceiver_->SendCommandAndWait(command);
+}
+
+void FaultInjectingCommandTransceiver::Sleep(base::TimeDelta delay) {
+  base::PlatformThread::Sleep(delay);
+}
+
+TPM_RC FaultInjectingCommandTransceiver::DrawFault() {
+  if (fault_rates_.empty()) {
+    return TPM_RC_SUCCESS;
+  }
+  // A single draw picks at most one warning so the rates stay exact.
+  double draw = std::uniform_real_distribution<double>(0.0, 1.0)(random_);
+  for (const auto& entry : fault_rates_) {
+    if (draw < entry.second) {
+      return entry.first;
+    }
+    draw -= entry.second;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC FaultInjectingCommandTransceiver::CheckSlots(
+    const std::string& command) {
+  if (object_slots_ == 0 && session_slots_ == 0) {
+    return TPM_RC_SUCCESS;
+  }
+  TPM_CC code = 0;
+  if (!ParseCommandCode(command, &code)) {
+    return TPM_RC_SUCCESS;
+  }
+  bool loads_object = false;
+  bool loads_session = false;
+  switch (code) {
+    case TPM_CC_CreatePrimary:
+    case TPM_CC_HashSequenceStart:
+    case TPM_CC_HMAC_Start:
+    case TPM_CC_Load:
+    case TPM_CC_LoadExternal:
+      loads_object = true;
+      break;
+    case TPM_CC_StartAuthSession:
+      loads_session = true;
+      break;
+    case TPM_CC_ContextLoad: {
+      TPM_HANDLE saved_handle = 0;
+      if (ParseSavedHandle(command, &saved_handle)) {
+        TPM_HC range = saved_handle & HR_RANGE_MASK;
+        loads_object = (range == HR_TRANSIENT);
+        loads_session =
+            (range == HR_HMAC_SESSION || range == HR_POLICY_SESSION);
+      }
+      break;
+    }
+  }
+  // The TPM is asked rather than tracking handles here because sessions also
+  // go away when a command completes with continueSession clear.
+  if (loads_object && object_slots_ > 0 &&
+      AreSlotsFull(TRANSIENT_FIRST, object_slots_)) {
+    return TPM_RC_OBJECT_MEMORY;
+  }
+  // Loaded sessions of both kinds are reported in the HMAC session range.
+  if (loads_session && session_slots_ > 0 &&
+      AreSlotsFull(HMAC_SESSION_FIRST, session_slots_)) {
+    return TPM_RC_SESSION_MEMORY;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+bool FaultInjectingCommandTransceiver::AreSlotsFull(TPM_HANDLE first_handle,
+                                                    size_t limit) {
+  std::string command;
+  if (Tpm::SerializeCommand_GetCapability(TPM_CAP_HANDLES, first_handle, limit,
+                                          &command,
+                                          nullptr) != TPM_RC_SUCCESS) {
+    return false;
+  }
+  TPMI_YES_NO more_data = NO;
+  TPMS_CAPABILITY_DATA data;
+  TPM_RC result = Tpm::ParseResponse_GetCapability(
+      next_transceiver_->SendCommandAndWait(command), &more_data, &data,
+      nullptr);
+  if (result != TPM_RC_SUCCESS || data.capability != TPM_CAP_HANDLES) {
+    LOG(WARNING) << "Failed to query loaded handles: "
+                 << GetErrorString(result);
+    return false;
+  }
+  size_t loaded = 0;
+  for (UINT32 i = 0; i < data.data.handles.count; ++i) {
+    if ((data.data.handles.handle[i] & HR_RANGE_MASK) ==
+        (first_handle & HR_RANGE_MASK)) {
+      ++loaded;
+    }
+  }
+  return loaded >= limit;
+}
+
+base::TimeDelta FaultInjectingCommandTransceiver::DrawLatency(
+    const std::string& command) {
+  LatencyRange range = default_latency_;
+  TPM_CC code = 0;
+  if (!latencies_.empty() && ParseCommandCode(command, &code)) {
+    auto iter = latencies_.find(code);
+    if (iter != latencies_.end()) {
+      range = iter->second;
+    }
+  }
+  if (range.max <= range.min) {
+    return range.min;
+  }
+  std::uniform_int_distribution<int64_t> distribution(
+      range.min.InMicroseconds(), range.max.InMicroseconds());
+  return base::TimeDelta::FromMicroseconds(distribution(random_));
+}
+
+}  // namespace trunks
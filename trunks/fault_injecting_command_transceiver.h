@@ -0,0 +1,139 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef TRUNKS_FAULT_INJECTING_COMMAND_TRANSCEIVER_H_
+#define TRUNKS_FAULT_INJECTING_COMMAND_TRANSCEIVER_H_
+
+#include "trunks/command_transceiver.h"
+
+#include <map>
+#include <random>
+#include <string>
+
+#include <base/macros.h>
+#include <base/time/time.h>
+
+#include "trunks/tpm_generated.h"
+
+namespace trunks {
+
+// Makes a fast TPM, typically the simulator, behave like a slow or busy one
+// for capacity testing. Each command may be
+//   - failed with a configured warning, e.g. TPM_RC_RETRY or TPM_RC_YIELDED,
+//     at a configured rate without being sent,
+//   - failed with TPM_RC_OBJECT_MEMORY or TPM_RC_SESSION_MEMORY if it would
+//     load more objects or sessions than the emulated number of slots, or
+//   - delayed by a latency drawn uniformly from a range configured per
+//     command code.
+// Faults are drawn from a seeded generator so runs are reproducible.
+//
+// Commands are sent synchronously; SendCommand does not return until the
+// callback has run. This class is not thread-safe; in trunksd it runs on the
+// background thread in front of the TpmHandle.
+class FaultInjectingCommandTransceiver : public CommandTransceiver {
+ public:
+  // Commands are forwarded to |next_transceiver|, which must outlive this
+  // object.
+  FaultInjectingCommandTransceiver(CommandTransceiver* next_transceiver,
+                                   uint32_t seed);
+  ~FaultInjectingCommandTransceiver() override;
+
+  // Configures this object from comma-separated |options|:
+  //   <warning>=<rate>    fails commands with a warning at a rate in [0, 1];
+  //                       <warning> is one of retry, yielded, memory,
+  //                       object_memory or session_memory.
+  //   latency=<min>-<max> delays every command by <min> to <max> ms.
+  //   latency:<code>=<min>-<max>
+  //                       overrides the latency for a command code, e.g.
+  //                       latency:0x131=500-2000 for CreatePrimary.
+  //   object_slots=<n>    emulates <n> transient object slots.
+  //   session_slots=<n>   emulates <n> session slots.
+  // Returns false if any option is invalid.
+  bool ParseOptions(const std::string& options);
+
+  // Fails commands with |warning| at |rate|, a probability in [0, 1]. The
+  // rates of all warnings must add up to at most 1.
+  void set_fault_rate(TPM_RC warning, double rate) {
+    fault_rates_[warning] = rate;
+  }
+
+  // Delays commands without a latency of their own by |min| to |max|.
+  void set_default_latency(base::TimeDelta min, base::TimeDelta max) {
+    default_latency_ = LatencyRange{min, max};
+  }
+
+  // Delays commands with |command_code| by |min| to |max|.
+  void set_latency(TPM_CC command_code,
+                   base::TimeDelta min,
+                   base::TimeDelta max) {
+    latencies_[command_code] = LatencyRange{min, max};
+  }
+
+  // Limits the number of loaded transient objects and sessions. Zero, the
+  // default, leaves the limit to the TPM.
+  void set_object_slots(size_t slots) { object_slots_ = slots; }
+  void set_session_slots(size_t slots) { session_slots_ = slots; }
+
+  // The number of commands failed by this object, by fault rate or by slot
+  // emulation.
+  size_t injected_fault_count() const { return injected_fault_count_; }
+
+  // CommandTranceiver methods.
+  void SendCommand(const std::string& command,
+                   const ResponseCallback& callback) override;
+  std::string SendCommandAndWait(const std::string& command) override;
+
+ protected:
+  // Blocks the calling thread for |delay|. Tests override this.
+  virtual void Sleep(base::TimeDelta delay);
+
+ private:
+  struct LatencyRange {
+    base::TimeDelta min;
+    base::TimeDelta max;
+  };
+
+  // Returns a warning to fail a command with, or TPM_RC_SUCCESS.
+  TPM_RC DrawFault();
+
+  // Returns TPM_RC_OBJECT_MEMORY or TPM_RC_SESSION_MEMORY if |command| loads
+  // an object or session and all emulated slots of that kind are in use,
+  // otherwise TPM_RC_SUCCESS.
+  TPM_RC CheckSlots(const std::string& command);
+
+  // Returns true if at least |limit| handles in the range starting at
+  // |first_handle| are loaded in the TPM.
+  bool AreSlotsFull(TPM_HANDLE first_handle, size_t limit);
+
+  // Returns the latency to add to |command|.
+  base::TimeDelta DrawLatency(const std::string& command);
+
+  CommandTransceiver* next_transceiver_;
+  std::minstd_rand random_;
+  std::map<TPM_RC, double> fault_rates_;
+  LatencyRange default_latency_;
+  std::map<TPM_CC, LatencyRange> latencies_;
+  size_t object_slots_ = 0;
+  size_t session_slots_ = 0;
+  size_t injected_fault_count_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(FaultInjectingCommandTransceiver);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_FAULT_INJECTING_COMMAND_TRANSCEIVER_H_
@@ -0,0 +1,173 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/fault_injecting_command_transceiver.h"
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/mock_command_transceiver.h"
+
+using testing::_;
+using testing::Return;
+
+namespace {
+
+// Creates a session-less command with the given |code| and |words| following
+// the header.
+std::string MakeCommand(trunks::TPM_CC code,
+                        const std::vector<trunks::UINT32>& words) {
+  std::string body;
+  for (trunks::UINT32 word : words) {
+    trunks::Serialize_UINT32(word, &body);
+  }
+  std::string command;
+  trunks::Serialize_TPM_ST(trunks::TPM_ST_NO_SESSIONS, &command);
+  trunks::Serialize_UINT32(10 + body.size(), &command);
+  trunks::Serialize_TPM_CC(code, &command);
+  return command + body;
+}
+
+// Creates a successful GetCapability response listing |handles|.
+std::string MakeHandlesResponse(
+    const std::vector<trunks::TPM_HANDLE>& handles) {
+  trunks::TPMS_CAPABILITY_DATA data;
+  data.capability = trunks::TPM_CAP_HANDLES;
+  data.data.handles.count = handles.size();
+  for (size_t i = 0; i < handles.size(); ++i) {
+    data.data.handles.handle[i] = handles[i];
+  }
+  std::string body;
+  trunks::Serialize_TPMI_YES_NO(NO, &body);
+  trunks::Serialize_TPMS_CAPABILITY_DATA(data, &body);
+  std::string response;
+  trunks::Serialize_TPM_ST(trunks::TPM_ST_NO_SESSIONS, &response);
+  trunks::Serialize_UINT32(10 + body.size(), &response);
+  trunks::Serialize_TPM_RC(trunks::TPM_RC_SUCCESS, &response);
+  return response + body;
+}
+
+// Records delays instead of sleeping.
+class TestTransceiver : public trunks::FaultInjectingCommandTransceiver {
+ public:
+  explicit TestTransceiver(trunks::CommandTransceiver* next_transceiver)
+      : FaultInjectingCommandTransceiver(next_transceiver, 1) {}
+
+  std::vector<base::TimeDelta> delays;
+
+ protected:
+  void Sleep(base::TimeDelta delay) override { delays.push_back(delay); }
+};
+
+}  // namespace
+
+namespace trunks {
+
+class FaultInjectingCommandTransceiverTest : public testing::Test {
+ public:
+  FaultInjectingCommandTransceiverTest() : transceiver_(&next_transceiver_) {}
+  ~FaultInjectingCommandTransceiverTest() override {}
+
+ protected:
+  testing::StrictMock<MockCommandTransceiver> next_transceiver_;
+  TestTransceiver transceiver_;
+};
+
+TEST_F(FaultInjectingCommandTransceiverTest, PassThrough) {
+  std::string command = MakeCommand(TPM_CC_GetRandom, {});
+  std::string response = CreateErrorResponse(TPM_RC_SUCCESS);
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(response));
+  EXPECT_EQ(response, transceiver_.SendCommandAndWait(command));
+  EXPECT_TRUE(transceiver_.delays.empty());
+  EXPECT_EQ(0u, transceiver_.injected_fault_count());
+}
+
+TEST_F(FaultInjectingCommandTransceiverTest, FaultRate) {
+  std::string command = MakeCommand(TPM_CC_GetRandom, {});
+  transceiver_.set_fault_rate(TPM_RC_RETRY, 1.0);
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_RETRY),
+            transceiver_.SendCommandAndWait(command));
+  transceiver_.set_fault_rate(TPM_RC_RETRY, 0.0);
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_SUCCESS),
+            transceiver_.SendCommandAndWait(command));
+  EXPECT_EQ(1u, transceiver_.injected_fault_count());
+}
+
+TEST_F(FaultInjectingCommandTransceiverTest, Latency) {
+  std::string get_random = MakeCommand(TPM_CC_GetRandom, {});
+  std::string create_primary =
+      MakeCommand(TPM_CC_CreatePrimary, {TPM_RH_OWNER});
+  transceiver_.set_default_latency(base::TimeDelta::FromMilliseconds(10),
+                                   base::TimeDelta::FromMilliseconds(20));
+  transceiver_.set_latency(TPM_CC_CreatePrimary,
+                           base::TimeDelta::FromMilliseconds(500),
+                           base::TimeDelta::FromMilliseconds(500));
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(_))
+      .WillRepeatedly(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  transceiver_.SendCommandAndWait(get_random);
+  transceiver_.SendCommandAndWait(create_primary);
+  ASSERT_EQ(2u, transceiver_.delays.size());
+  EXPECT_LE(base::TimeDelta::FromMilliseconds(10), transceiver_.delays[0]);
+  EXPECT_GE(base::TimeDelta::FromMilliseconds(20), transceiver_.delays[0]);
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(500), transceiver_.delays[1]);
+}
+
+TEST_F(FaultInjectingCommandTransceiverTest, ObjectSlots) {
+  std::string load = MakeCommand(TPM_CC_Load, {TRANSIENT_FIRST});
+  std::string query;
+  ASSERT_EQ(TPM_RC_SUCCESS, Tpm::SerializeCommand_GetCapability(
+                                TPM_CAP_HANDLES, TRANSIENT_FIRST, 2, &query,
+                                nullptr));
+  transceiver_.set_object_slots(2);
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(query))
+      .WillOnce(Return(MakeHandlesResponse({TRANSIENT_FIRST})))
+      .WillOnce(
+          Return(MakeHandlesResponse({TRANSIENT_FIRST, TRANSIENT_FIRST + 1})));
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(load))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_SUCCESS),
+            transceiver_.SendCommandAndWait(load));
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_OBJECT_MEMORY),
+            transceiver_.SendCommandAndWait(load));
+}
+
+TEST_F(FaultInjectingCommandTransceiverTest, SessionSlotsIgnoreObjects) {
+  // Commands which load no session never query the TPM.
+  std::string load = MakeCommand(TPM_CC_Load, {TRANSIENT_FIRST});
+  transceiver_.set_session_slots(1);
+  EXPECT_CALL(next_transceiver_, SendCommandAndWait(load))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  transceiver_.SendCommandAndWait(load);
+}
+
+TEST_F(FaultInjectingCommandTransceiverTest, ParseOptions) {
+  EXPECT_TRUE(transceiver_.ParseOptions(
+      "retry=0.1,yielded=0.05,latency=20-80,latency:0x131=500-2000,"
+      "object_slots=2,session_slots=1"));
+  EXPECT_FALSE(transceiver_.ParseOptions("retry=2"));
+  EXPECT_FALSE(transceiver_.ParseOptions("retry=0.6,yielded=0.6"));
+  EXPECT_FALSE(transceiver_.ParseOptions("latency=80-20"));
+  EXPECT_FALSE(transceiver_.ParseOptions("bogus=1"));
+}
+
+}  // namespace trunks
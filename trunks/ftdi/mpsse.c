@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "trunks/ftdi/support.h"
@@ -223,6 +224,7 @@ void Close(struct mpsse_context* mpsse) {
     ftdi_usb_close(&mpsse->ftdi);
   }
   ftdi_deinit(&mpsse->ftdi);
+  free(mpsse->cmd_buf);
   free(mpsse);
 }
 
@@ -713,7 +715,6 @@ int Write(struct mpsse_context* mpsse, const void* vdata, int size) {
         if (buf) {
           retval = raw_write(mpsse, buf, buf_size);
           n += txsize;
-          free(buf);
 
           if (retval == MPSSE_FAIL) {
             break;
@@ -737,39 +738,64 @@ int Write(struct mpsse_context* mpsse, const void* vdata, int size) {
   return retval;
 }
 
-/* Performs a read. For internal use only; see Read() and ReadBits(). */
-static uint8_t* InternalRead(struct mpsse_context* mpsse, int size) {
-  uint8_t *data = NULL, *buf = NULL;
-  uint8_t sbuf[SPI_RW_SIZE] = {0};
-  int n = 0, rxsize = 0, data_size = 0, retval = 0;
+/*
+ * Writes data over the selected serial protocol. Same as Write().
+ *
+ * @mpsse - MPSSE context pointer.
+ * @data  - Buffer of data to send.
+ * @size  - Size of data.
+ *
+ * Returns MPSSE_OK on success.
+ * Returns MPSSE_FAIL on failure.
+ */
+int FastWrite(struct mpsse_context* mpsse, char* data, int size) {
+  return Write(mpsse, data, size);
+}
 
-  if (is_valid_context(mpsse)) {
-    if (mpsse->mode) {
-      buf = malloc(size);
-      if (buf) {
-        memset(buf, 0, size);
+/*
+ * Reads data over the selected serial protocol into a caller supplied buffer.
+ *
+ * @mpsse - MPSSE context pointer.
+ * @data  - Buffer to store the read data in.
+ * @size  - Number of bytes to read.
+ *
+ * Returns MPSSE_OK on success.
+ * Returns MPSSE_FAIL on failure.
+ */
+int FastRead(struct mpsse_context* mpsse, char* data, int size) {
+  uint8_t* buf = NULL;
+  int n = 0, rxsize = 0, buf_size = 0;
 
-        while (n < size) {
-          rxsize = size - n;
-          if (rxsize > mpsse->xsize) {
-            rxsize = mpsse->xsize;
-          }
+  if (!is_valid_context(mpsse) || !mpsse->mode) {
+    return MPSSE_FAIL;
+  }
 
-          data = build_block_buffer(mpsse, mpsse->rx, sbuf, rxsize, &data_size);
-          if (data) {
-            retval = raw_write(mpsse, data, data_size);
-            free(data);
-
-            if (retval == MPSSE_OK) {
-              n += raw_read(mpsse, buf + n, rxsize);
-            } else {
-              break;
-            }
-          } else {
-            break;
-          }
-        }
-      }
+  while (n < size) {
+    rxsize = size - n;
+    if (rxsize > mpsse->xsize) {
+      rxsize = mpsse->xsize;
+    }
+
+    /* A read command carries no data, so there is nothing to copy in. */
+    buf = build_block_buffer(mpsse, mpsse->rx, NULL, rxsize, &buf_size);
+    if (!buf || raw_write(mpsse, buf, buf_size) != MPSSE_OK ||
+        raw_read(mpsse, (uint8_t*)data + n, rxsize) != rxsize) {
+      return MPSSE_FAIL;
+    }
+    n += rxsize;
+  }
+
+  return MPSSE_OK;
+}
+
+/* Performs a read. For internal use only; see Read() and ReadBits(). */
+static uint8_t* InternalRead(struct mpsse_context* mpsse, int size) {
+  uint8_t* buf = NULL;
+
+  if (is_valid_context(mpsse) && mpsse->mode) {
+    buf = calloc(1, size);
+    if (buf) {
+      FastRead(mpsse, (char*)buf, size);
     }
   }
 
@@ -851,6 +877,63 @@ char ReadBits(struct mpsse_context* mpsse, int size) {
   return bits;
 }
 
+/*
+ * Performs a transfer into |rdata|. For internal use only; see Transfer() and
+ * FastTransfer(). Returns the number of bytes read.
+ */
+static int TransferBlocks(struct mpsse_context* mpsse,
+                          const uint8_t* wdata,
+                          uint8_t* rdata,
+                          int size) {
+  uint8_t* txdata = NULL;
+  int n = 0, data_size = 0, rxsize = 0;
+
+  while (n < size) {
+    /* When sending and recieving, FTDI chips don't seem to like large
+     * data blocks. Limit the size of each block to SPI_TRANSFER_SIZE */
+    rxsize = size - n;
+    if (rxsize > SPI_TRANSFER_SIZE) {
+      rxsize = SPI_TRANSFER_SIZE;
+    }
+
+    txdata = build_block_buffer(mpsse, mpsse->txrx, wdata + n, rxsize,
+                                &data_size);
+    if (!txdata || raw_write(mpsse, txdata, data_size) != MPSSE_OK ||
+        raw_read(mpsse, rdata + n, rxsize) != rxsize) {
+      break;
+    }
+    n += rxsize;
+  }
+
+  return n;
+}
+
+/*
+ * Reads and writes data over the selected serial protocol (SPI only) into a
+ * caller supplied buffer.
+ *
+ * @mpsse - MPSSE context pointer.
+ * @wdata - Buffer containing bytes to write.
+ * @rdata - Buffer to store the read data in.
+ * @size  - Number of bytes to transfer.
+ *
+ * Returns MPSSE_OK on success.
+ * Returns MPSSE_FAIL on failure.
+ */
+int FastTransfer(struct mpsse_context* mpsse,
+                 char* wdata,
+                 char* rdata,
+                 int size) {
+  if (!is_valid_context(mpsse) || mpsse->mode < SPI0 || mpsse->mode > SPI3) {
+    return MPSSE_FAIL;
+  }
+  if (TransferBlocks(mpsse, (const uint8_t*)wdata, (uint8_t*)rdata, size) !=
+      size) {
+    return MPSSE_FAIL;
+  }
+  return MPSSE_OK;
+}
+
 /*
  * Reads and writes data over the selected serial protocol (SPI only).
  *
@@ -867,39 +950,15 @@ swig_string_data Transfer(struct mpsse_context* mpsse, char* data, int size)
 uint8_t* Transfer(struct mpsse_context* mpsse, uint8_t* data, int size)
 #endif
 {
-  uint8_t *txdata = NULL, *buf = NULL;
-  int n = 0, data_size = 0, rxsize = 0, retval = 0;
+  uint8_t* buf = NULL;
+  int n = 0;
 
   if (is_valid_context(mpsse)) {
     /* Make sure we're configured for one of the SPI modes */
     if (mpsse->mode >= SPI0 && mpsse->mode <= SPI3) {
-      buf = malloc(size);
+      buf = calloc(1, size);
       if (buf) {
-        memset(buf, 0, size);
-
-        while (n < size) {
-          /* When sending and recieving, FTDI chips don't seem to like large
-           * data blocks. Limit the size of each block to SPI_TRANSFER_SIZE */
-          rxsize = size - n;
-          if (rxsize > SPI_TRANSFER_SIZE) {
-            rxsize = SPI_TRANSFER_SIZE;
-          }
-
-          txdata = build_block_buffer(mpsse, mpsse->txrx, data + n, rxsize,
-                                      &data_size);
-          if (txdata) {
-            retval = raw_write(mpsse, txdata, data_size);
-            free(txdata);
-
-            if (retval == MPSSE_OK) {
-              n += raw_read(mpsse, (buf + n), rxsize);
-            } else {
-              break;
-            }
-          } else {
-            break;
-          }
-        }
+        n = TransferBlocks(mpsse, (const uint8_t*)data, buf, size);
       }
     }
   }
@@ -1107,6 +1166,62 @@ int ReadPins(struct mpsse_context* mpsse) {
   return (int)val;
 }
 
+/*
+ * Waits until GPIOL1 is driven low, e.g. by an active low interrupt line. The
+ * MPSSE engine itself waits for the pin, so no commands are sent meanwhile.
+ * Not for use in BITBANG mode.
+ *
+ * @mpsse      - MPSSE context pointer.
+ * @timeout_ms - How long to wait.
+ *
+ * Returns MPSSE_OK once the pin is low.
+ * Returns MPSSE_FAIL on failure or timeout.
+ */
+int WaitForGPIOL1Low(struct mpsse_context* mpsse, int timeout_ms) {
+  uint8_t cmd[] = {WAIT_ON_IO_LOW, GET_BITS_LOW, SEND_IMMEDIATE};
+  uint8_t pins = 0;
+  struct timespec now, deadline;
+  int r = 0;
+
+  if (!is_valid_context(mpsse) || !mpsse->mode || mpsse->mode == BITBANG) {
+    return MPSSE_FAIL;
+  }
+  if (raw_write(mpsse, cmd, sizeof(cmd)) != MPSSE_OK) {
+    return MPSSE_FAIL;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeout_ms / 1000;
+  deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  /* While the engine waits each read returns empty after the latency timer. */
+  while ((r = ftdi_read_data(&mpsse->ftdi, &pins, 1)) == 0) {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec > deadline.tv_sec ||
+        (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec)) {
+      break;
+    }
+  }
+  if (r == 1) {
+    return MPSSE_OK;
+  }
+
+  /*
+   * Otherwise the engine would keep waiting and answer a later command with
+   * the pin state. Resetting it loses the MPSSE configuration, so restore it.
+   */
+  ftdi_set_bitmode(&mpsse->ftdi, 0, BITMODE_RESET);
+  ftdi_usb_purge_buffers(&mpsse->ftdi);
+  ftdi_set_bitmode(&mpsse->ftdi, 0, BITMODE_MPSSE);
+  SetClock(mpsse, mpsse->clock);
+  SetMode(mpsse, mpsse->endianess);
+  return MPSSE_FAIL;
+}
+
 /*
  * Checks if a specific pin is high or low. For use in BITBANG mode only.
  *
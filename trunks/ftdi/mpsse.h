@@ -139,6 +139,8 @@ enum mpsse_commands {
   CLOCK_N8_CYCLES_IO_HIGH = 0x9C,
   CLOCK_N8_CYCLES_IO_LOW = 0x9D,
   TRISTATE_IO = 0x9E,
+  WAIT_ON_IO_HIGH = 0x88,
+  WAIT_ON_IO_LOW = 0x89,
 };
 
 enum low_bits_status { STARTED, STOPPED };
@@ -173,6 +175,9 @@ struct mpsse_context {
   uint8_t txrx;
   uint8_t tack;
   uint8_t rack;
+  /* The command buffer reused by every transfer; see build_block_buffer(). */
+  uint8_t* cmd_buf;
+  int cmd_buf_size;
 };
 
 struct mpsse_context* MPSSE(enum modes mode, int freq, int endianess);
@@ -220,6 +225,7 @@ char ReadBits(struct mpsse_context* mpsse, int size);
 int WritePins(struct mpsse_context* mpsse, uint8_t data);
 int ReadPins(struct mpsse_context* mpsse);
 int PinState(struct mpsse_context* mpsse, int pin, int state);
+int WaitForGPIOL1Low(struct mpsse_context* mpsse, int timeout_ms);
 int Tristate(struct mpsse_context* mpsse);
 char Version(void);
 
@@ -235,6 +241,11 @@ swig_string_data Transfer(struct mpsse_context* mpsse, char* data, int size);
 uint8_t* Read(struct mpsse_context* mpsse, int size);
 uint8_t* Transfer(struct mpsse_context* mpsse, uint8_t* data, int size);
 
+/*
+ * Like Write(), Read() and Transfer() but the data read goes to a caller
+ * supplied buffer, so nothing is allocated per call. Return MPSSE_OK or
+ * MPSSE_FAIL.
+ */
 int FastWrite(struct mpsse_context* mpsse, char* data, int size);
 int FastRead(struct mpsse_context* mpsse, char* data, int size);
 int FastTransfer(struct mpsse_context* mpsse,
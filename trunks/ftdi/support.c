@@ -23,6 +23,7 @@
  * Craig Heffner
  * 27 December 2011
  */
+#include <stdlib.h>
 #include <string.h>
 
 #include "trunks/ftdi/support.h"
@@ -87,7 +88,10 @@ int raw_write(struct mpsse_context* mpsse, uint8_t* buf, int size) {
    return (system_clock / ((1 + div) * 2));
  }
 
- /* Builds a buffer of commands + data blocks */
+ /*
+  * Builds a buffer of commands + data blocks. The buffer is kept in the context
+  * and reused by the next call, so callers must not free it.
+  */
  uint8_t* build_block_buffer(struct mpsse_context* mpsse,
                              uint8_t cmd,
                              const uint8_t* data,
@@ -120,10 +124,16 @@ int raw_write(struct mpsse_context* mpsse, uint8_t* buf, int size) {
      total_size += (CMD_SIZE * 3 * num_blocks);
    }
 
-   buf = malloc(total_size);
+   if (mpsse->cmd_buf_size < total_size) {
+     buf = realloc(mpsse->cmd_buf, total_size);
+     if (!buf) {
+       return NULL;
+     }
+     mpsse->cmd_buf = buf;
+     mpsse->cmd_buf_size = total_size;
+   }
+   buf = mpsse->cmd_buf;
    if (buf) {
-     memset(buf, 0, total_size);
-
      for (j = 0; j < num_blocks; j++) {
        dsize = size - k;
        if (dsize > xfer_size) {
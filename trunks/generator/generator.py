@@ -72,6 +72,7 @@ _END
 from __future__ import print_function
 
 import argparse
+import copy
 import re
 import subprocess
 
@@ -79,8 +80,14 @@ import union_selectors
 
 _BASIC_TYPES = ['uint8_t', 'int8_t', 'int', 'uint16_t', 'int16_t',
                 'uint32_t', 'int32_t', 'uint64_t', 'int64_t']
+# The wire size of basic types with a fixed size.
+_FIXED_SIZE_BASIC_TYPES = {'uint8_t': 1, 'int8_t': 1, 'uint16_t': 2,
+                           'int16_t': 2, 'uint32_t': 4, 'int32_t': 4,
+                           'uint64_t': 8, 'int64_t': 8}
 _OUTPUT_FILE_H = 'tpm_generated.h'
 _OUTPUT_FILE_CC = 'tpm_generated.cc'
+_OUTPUT_FILE_BENCHMARK = 'tpm_generated_benchmark.cc'
+_OUTPUT_FILE_FUZZER = 'tpm_generated_fuzzer.cc'
 _COPYRIGHT_HEADER = (
     '//\n'
     '// Copyright (C) 2015 The Android Open Source Project\n'
@@ -107,14 +114,21 @@ _HEADER_FILE_GUARD_FOOTER = """
 #endif  // %(name)s
 """
 _HEADER_FILE_INCLUDES = """
+#include <string.h>
+
+#include <array>
 #include <string>
+#include <vector>
 
 #include <base/callback_forward.h>
 #include <base/macros.h>
+#include <base/sys_byteorder.h>
 
+#include "trunks/tpm2b_util.h"
 #include "trunks/trunks_export.h"
 """
 _IMPLEMENTATION_FILE_INCLUDES = """
+#include <algorithm>
 #include <memory>
 #include <string>
 
@@ -127,17 +141,56 @@ _IMPLEMENTATION_FILE_INCLUDES = """
 #include <base/sys_byteorder.h>
 #include <crypto/secure_hash.h>
 
+#include "trunks/allocation_profile.h"
 #include "trunks/authorization_delegate.h"
 #include "trunks/command_transceiver.h"
 #include "trunks/error_codes.h"
+%(marshal_include)s
+// Tracing every marshalling function is expensive since a single command may
+// marshal hundreds of nested fields, so it is only compiled in when
+// TRUNKS_TRACE_MARSHALLING is defined. Commands themselves are always traced.
+#if defined(TRUNKS_TRACE_MARSHALLING)
+#define TRACE_MARSHALLING() VLOG(3) << __func__
+#else
+#define TRACE_MARSHALLING() static_cast<void>(0)
+#endif
 
 """
 _LOCAL_INCLUDE = """
 #include "trunks/%(filename)s"
 """
+_MARSHAL_INCLUDE = '#include "trunks/tpm_marshal.h"\n'
 _NAMESPACE_BEGIN = """
 namespace trunks {
 """
+_PARSE_HELPERS = """
+namespace {
+
+// Finishes a std::string based parse done with |cursor|. On success the parsed
+// bytes are erased from |buffer| and, if |value_bytes| is not null, appended to
+// |value_bytes|.
+TPM_RC ConsumeParsedBytes(TPM_RC result,
+                          const ParseCursor& cursor,
+                          std::string* buffer,
+                          std::string* value_bytes) {
+  if (result != TPM_RC_SUCCESS) {
+    return result;
+  }
+  if (value_bytes) {
+    value_bytes->append(buffer->data(), cursor.consumed());
+  }
+  buffer->erase(0, cursor.consumed());
+  return TPM_RC_SUCCESS;
+}
+
+// Returns the payload of the serialized TPM2B in |value_bytes|, which follows
+// the two byte size field. Parameter encryption works on the payload in place.
+uint8_t* GetTPM2BPayload(std::string* value_bytes) {
+  return reinterpret_cast<uint8_t*>(base::string_as_array(value_bytes)) + 2;
+}
+
+}  // namespace
+"""
 _NAMESPACE_END = """
 }  // namespace trunks
 """
@@ -146,8 +199,75 @@ class AuthorizationDelegate;
 class CommandTransceiver;
 """
 _FUNCTION_DECLARATIONS = """
+// How long the TPM typically takes to execute a command.
+enum TpmLatencyClass {
+  // Commands which callers typically wait on, e.g. PCR_Read.
+  kTpmLatencyShort,
+  kTpmLatencyNormal,
+  // Commands which may keep the TPM busy for seconds, e.g. key generation.
+  kTpmLatencyLong,
+};
+
+// Static properties of a TPM command for code which handles commands without
+// fully parsing them, e.g. the resource manager.
+struct TpmCommandMetadata {
+  TPM_CC command_code;
+  // The number of handles in the handle area of the command and response.
+  uint8_t request_handles;
+  uint8_t response_handles;
+  // False if the command must be sent with TPM_ST_NO_SESSIONS.
+  bool sessions_allowed;
+  // True if the first command or response parameter is a TPM2B which may
+  // hold a secret, so sessions with parameter encryption encrypt it. Non-secret
+  // TPM2Bs, like the digest passed to Sign, are sent in the clear.
+  bool command_parameter_encryption;
+  bool response_parameter_encryption;
+  // True if the command only reads TPM state so identical commands may share
+  // a single response.
+  bool read_only;
+  TpmLatencyClass latency_class;
+};
+
+// Returns the metadata for |command_code|, or nullptr if it is not a known
+// command. This is a constant time table lookup.
+TRUNKS_EXPORT const TpmCommandMetadata* GetCommandMetadata(TPM_CC command_code);
 TRUNKS_EXPORT size_t GetNumberOfRequestHandles(TPM_CC command_code);
 TRUNKS_EXPORT size_t GetNumberOfResponseHandles(TPM_CC command_code);
+
+// A read position within serialized TPM data. Parse_* functions which take a
+// cursor advance it past the bytes they parse; the bytes are never modified or
+// copied so they must outlive the cursor. The Parse_* functions which take a
+// std::string instead erase the parsed bytes from the front of the string.
+class ParseCursor {
+ public:
+  ParseCursor(const char* data, size_t size)
+      : start_(data), next_(data), end_(data + size) {}
+  explicit ParseCursor(const std::string& bytes)
+      : ParseCursor(bytes.data(), bytes.size()) {}
+
+  // Copies the next |size| bytes to |out| and advances past them. Returns false
+  // without advancing if fewer than |size| bytes remain.
+  bool Read(void* out, size_t size) {
+    if (remaining() < size) {
+      return false;
+    }
+    memcpy(out, next_, size);
+    next_ += size;
+    return true;
+  }
+
+  // The next byte to be read.
+  const char* data() const { return next_; }
+  // The number of bytes left to read.
+  size_t remaining() const { return end_ - next_; }
+  // The number of bytes read since the cursor was created.
+  size_t consumed() const { return next_ - start_; }
+
+ private:
+  const char* start_;
+  const char* next_;
+  const char* end_;
+};
 """
 _CLASS_BEGIN = """
 class TRUNKS_EXPORT Tpm {
@@ -156,6 +276,29 @@ class TRUNKS_EXPORT Tpm {
   explicit Tpm(CommandTransceiver* transceiver) : transceiver_(transceiver) {}
   virtual ~Tpm() {}
 
+  // Sends the serialized |commands| in order, with no other command
+  // interleaved, and returns one response per command sent. Commands after the
+  // first one that fails are not sent.
+  virtual std::vector<std::string> SendCommandBatchAndWait(
+      const std::vector<std::string>& commands);
+
+  // Sends independent serialized |commands|, possibly several at once, and
+  // returns one response per command, in order.
+  virtual std::vector<std::string> SendCommandsAndWait(
+      const std::vector<std::string>& commands);
+
+"""
+_SEND_COMMAND_BATCH_FUNCTION = """
+std::vector<std::string> Tpm::SendCommandBatchAndWait(
+    const std::vector<std::string>& commands) {
+  return transceiver_->SendCommandBatchAndWait(commands,
+                                               true /* stop_on_failure */);
+}
+
+std::vector<std::string> Tpm::SendCommandsAndWait(
+    const std::vector<std::string>& commands) {
+  return transceiver_->SendCommandsAndWait(commands);
+}
 """
 _CLASS_END = """
  private:
@@ -164,9 +307,11 @@ _CLASS_END = """
   DISALLOW_COPY_AND_ASSIGN(Tpm);
 };
 """
-_SERIALIZE_BASIC_TYPE = """
-TPM_RC Serialize_%(type)s(const %(type)s& value, std::string* buffer) {
-  VLOG(3) << __func__;
+_INLINE_FUNCTIONS_COMMENT = """
+// The primitive marshalling functions are defined inline so they can be folded
+// into the generated code which calls them for every field."""
+_INLINE_BASIC_TYPE = """
+inline TPM_RC Serialize_%(type)s(const %(type)s& value, std::string* buffer) {
   %(type)s value_net = value;
   switch (sizeof(%(type)s)) {
     case 2:
@@ -186,15 +331,11 @@ TPM_RC Serialize_%(type)s(const %(type)s& value, std::string* buffer) {
   return TPM_RC_SUCCESS;
 }
 
-TPM_RC Parse_%(type)s(
-    std::string* buffer,
-    %(type)s* value,
-    std::string* value_bytes) {
-  VLOG(3) << __func__;
-  if (buffer->size() < sizeof(%(type)s))
-    return TPM_RC_INSUFFICIENT;
+inline TPM_RC Parse_%(type)s(ParseCursor* cursor, %(type)s* value) {
   %(type)s value_net = 0;
-  memcpy(&value_net, buffer->data(), sizeof(%(type)s));
+  if (!cursor->Read(&value_net, sizeof(%(type)s))) {
+    return TPM_RC_INSUFFICIENT;
+  }
   switch (sizeof(%(type)s)) {
     case 2:
       *value = base::NetToHost16(value_net);
@@ -208,18 +349,64 @@ TPM_RC Parse_%(type)s(
     default:
       *value = value_net;
   }
-  if (value_bytes) {
-    value_bytes->append(buffer->substr(0, sizeof(%(type)s)));
-  }
-  buffer->erase(0, sizeof(%(type)s));
   return TPM_RC_SUCCESS;
 }
+
+// Writes |value| to |buffer| and returns the end of the written bytes.
+inline uint8_t* WriteFixed_%(type)s(%(type)s value, uint8_t* buffer) {
+  %(type)s value_net = value;
+  switch (sizeof(%(type)s)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  memcpy(buffer, &value_net, sizeof(%(type)s));
+  return buffer + sizeof(%(type)s);
+}
+"""
+# Wraps a cursor based parse function for callers which parse from the front of
+# a std::string.
+_PARSE_STRING_FUNCTION = """
+TPM_RC Parse_%(type)s(
+    std::string* buffer,
+    %(type)s* value,
+    std::string* value_bytes) {
+  ParseCursor cursor(*buffer);
+  TPM_RC result = Parse_%(type)s(&cursor, value);
+  return ConsumeParsedBytes(result, cursor, buffer, value_bytes);
+}
+"""
+_INLINE_TYPEDEF = """
+inline TPM_RC Serialize_%(new)s(const %(new)s& value, std::string* buffer) {
+  return Serialize_%(old)s(value, buffer);
+}
+
+inline TPM_RC Parse_%(new)s(ParseCursor* cursor, %(new)s* value) {
+  return Parse_%(old)s(cursor, value);
+}
+"""
+_PARSE_STRING_DECLARATION = """
+TRUNKS_EXPORT TPM_RC Parse_%(type)s(
+    std::string* buffer,
+    %(type)s* value,
+    std::string* value_bytes);
 """
 _SERIALIZE_DECLARATION = """
 TRUNKS_EXPORT TPM_RC Serialize_%(type)s(
     const %(type)s& value,
     std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_%(type)s(
+    ParseCursor* cursor,
+    %(type)s* value);
 TRUNKS_EXPORT TPM_RC Parse_%(type)s(
     std::string* buffer,
     %(type)s* value,
@@ -231,23 +418,304 @@ TRUNKS_EXPORT %(type)s Make_%(type)s(
     const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_%(type)s(
     const %(type)s& tpm2b);
+inline bool Equal_%(type)s(const %(type)s& a, const %(type)s& b) {
+  return TPM2BBuffersEqual(a.%(buffer_name)s, a.size,
+                           b.%(buffer_name)s, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_%(type)s(const %(type)s& tpm2b,
+                                 const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.%(buffer_name)s, tpm2b.size,
+                                 bytes.data(), bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_%(type)s(const %(type)s& tpm2b,
+                                     std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.%(buffer_name)s),
+                 tpm2b.size);
+}
 """
 _COMPLEX_TPM2B_HELPERS_DECLARATION = """
 TRUNKS_EXPORT %(type)s Make_%(type)s(
     const %(inner_type)s& inner);
 """
 
-_HANDLE_COUNT_FUNCTION_START = """
-size_t GetNumberOf%(handle_type)sHandles(TPM_CC command_code) {
-  switch (command_code) {"""
-_HANDLE_COUNT_FUNCTION_CASE = """
-    case %(command_code)s: return %(handle_count)s;"""
-_HANDLE_COUNT_FUNCTION_END = """
-    default: LOG(WARNING) << "Unknown command code: " << command_code;
+# Structures which also get a compact variant, along with every structure they
+# contain which holds a list.
+_COMPACT_ROOTS = ['TPMS_CAPABILITY_DATA']
+_COMPACT_STRUCTURES_COMMENT = """
+// Compact variants of large structures. A list holds only its elements and
+// only the member of a union chosen by the selector is set, so parsing into a
+// compact variant does not touch the worst case size of the structure. Make_*
+// and Expand_* convert to and from the structures used by the Tpm interface.
+"""
+_COMPACT_DECLARATION = """
+TRUNKS_EXPORT TPM_RC Parse_%(type)s_COMPACT(
+    ParseCursor* cursor,
+    %(type)s_COMPACT* value);
+TRUNKS_EXPORT TPM_RC Parse_%(type)s_COMPACT(
+    std::string* buffer,
+    %(type)s_COMPACT* value,
+    std::string* value_bytes);
+TRUNKS_EXPORT %(type)s_COMPACT Make_%(type)s_COMPACT(
+    const %(type)s& value);
+TRUNKS_EXPORT TPM_RC Expand_%(type)s_COMPACT(
+    const %(type)s_COMPACT& value,
+    %(type)s* expanded);
+"""
+_COMPACT_UNION_DECLARATION = """
+TRUNKS_EXPORT TPM_RC Parse_%(type)s_COMPACT(
+    ParseCursor* cursor,
+    %(selector_type)s selector,
+    %(type)s_COMPACT* value);
+TRUNKS_EXPORT %(type)s_COMPACT Make_%(type)s_COMPACT(
+    %(selector_type)s selector,
+    const %(type)s& value);
+TRUNKS_EXPORT TPM_RC Expand_%(type)s_COMPACT(
+    %(selector_type)s selector,
+    const %(type)s_COMPACT& value,
+    %(type)s* expanded);
+"""
+
+# Command properties which cannot be derived from the specification. Keyed by
+# command code constant name.
+_READ_ONLY_COMMANDS = frozenset([
+    'TPM_CC_GetCapability', 'TPM_CC_GetTestResult', 'TPM_CC_NV_ReadPublic',
+    'TPM_CC_PCR_Read', 'TPM_CC_ReadClock', 'TPM_CC_ReadPublic'])
+_SHORT_LATENCY_COMMANDS = frozenset([
+    'TPM_CC_GetCapability', 'TPM_CC_GetRandom', 'TPM_CC_GetTestResult',
+    'TPM_CC_NV_ReadPublic', 'TPM_CC_PCR_Extend', 'TPM_CC_PCR_Read',
+    'TPM_CC_ReadClock', 'TPM_CC_ReadPublic'])
+_LONG_LATENCY_COMMANDS = frozenset([
+    'TPM_CC_Create', 'TPM_CC_CreatePrimary', 'TPM_CC_SelfTest'])
+# Commands whose first command or response parameter is a TPM2B that never
+# holds a secret: digests, nonces, public areas, attestation structures and
+# blobs the TPM already wrapped. Sessions send these in the clear, since
+# encrypting them costs AES on both ends and protects nothing. Parameters not
+# listed here are encrypted whenever the session enables parameter encryption.
+_NON_SECRET_COMMAND_PARAMETERS = frozenset([
+    'TPM_CC_Certify', 'TPM_CC_CertifyCreation', 'TPM_CC_ECDH_ZGen',
+    'TPM_CC_FieldUpgradeData', 'TPM_CC_FieldUpgradeStart',
+    'TPM_CC_GetCommandAuditDigest', 'TPM_CC_GetSessionAuditDigest',
+    'TPM_CC_GetTime', 'TPM_CC_Load', 'TPM_CC_NV_Certify', 'TPM_CC_PCR_Event',
+    'TPM_CC_PCR_SetAuthPolicy', 'TPM_CC_PolicyAuthorize', 'TPM_CC_PolicyCpHash',
+    'TPM_CC_PolicyDuplicationSelect', 'TPM_CC_PolicyNameHash',
+    'TPM_CC_PolicyPCR', 'TPM_CC_PolicySecret', 'TPM_CC_PolicySigned',
+    'TPM_CC_PolicyTicket', 'TPM_CC_Quote', 'TPM_CC_RSA_Decrypt',
+    'TPM_CC_Rewrap', 'TPM_CC_SetPrimaryPolicy', 'TPM_CC_Sign',
+    'TPM_CC_StartAuthSession', 'TPM_CC_VerifySignature',
+    'TPM_CC_ZGen_2Phase'])
+_NON_SECRET_RESPONSE_PARAMETERS = frozenset([
+    'TPM_CC_Certify', 'TPM_CC_CertifyCreation', 'TPM_CC_Create',
+    'TPM_CC_CreatePrimary', 'TPM_CC_FirmwareRead',
+    'TPM_CC_GetCommandAuditDigest', 'TPM_CC_GetSessionAuditDigest',
+    'TPM_CC_GetTestResult', 'TPM_CC_GetTime', 'TPM_CC_Import', 'TPM_CC_Load',
+    'TPM_CC_LoadExternal', 'TPM_CC_MakeCredential', 'TPM_CC_NV_Certify',
+    'TPM_CC_NV_ReadPublic', 'TPM_CC_ObjectChangeAuth',
+    'TPM_CC_PolicyGetDigest', 'TPM_CC_PolicySecret', 'TPM_CC_PolicySigned',
+    'TPM_CC_Quote', 'TPM_CC_RSA_Encrypt', 'TPM_CC_ReadPublic',
+    'TPM_CC_Rewrap', 'TPM_CC_StartAuthSession'])
+
+_COMMAND_METADATA_START = """
+namespace {
+
+// Metadata for every command code from TPM_CC_FIRST to TPM_CC_LAST, indexed by
+// the offset from TPM_CC_FIRST. Unassigned codes have a zero |command_code|.
+constexpr TpmCommandMetadata kCommandMetadata[] = {"""
+_COMMAND_METADATA_ENTRY = """
+    {%(command_code)s, %(request_handles)d, %(response_handles)d,
+     %(sessions_allowed)s, %(command_parameter_encryption)s,
+     %(response_parameter_encryption)s, %(read_only)s, %(latency_class)s},"""
+_COMMAND_METADATA_UNASSIGNED = """
+    {},  // Unassigned."""
+_COMMAND_METADATA_END = """
+};
+
+static_assert(arraysize(kCommandMetadata) == TPM_CC_LAST - TPM_CC_FIRST + 1,
+              "The command metadata table must cover every command code.");
+
+}  // namespace
+
+const TpmCommandMetadata* GetCommandMetadata(TPM_CC command_code) {
+  if (command_code < TPM_CC_FIRST || command_code > TPM_CC_LAST) {
+    return nullptr;
   }
+  const TpmCommandMetadata* metadata =
+      &kCommandMetadata[command_code - TPM_CC_FIRST];
+  return (metadata->command_code == command_code) ? metadata : nullptr;
+}
+"""
+_BENCHMARK_FILE_INCLUDES = """
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include <base/macros.h>
+#include <base/time/time.h>
+
+#include "trunks/tpm_generated.h"
+"""
+_BENCHMARK_FILE_START = """
+// Measures the time and allocations per call of the generated marshalling
+// code. Every command is serialized and a response to it is parsed with each
+// TPM2B argument filled to its capacity. Exits with an error if any call fails.
+
+namespace {
+
+// Counts allocations so each benchmark can report allocations per call.
+size_t g_allocation_count = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+  ++g_allocation_count;
+  void* result = malloc(size);
+  if (!result) {
+    abort();
+  }
+  return result;
+}
+
+void operator delete(void* pointer) noexcept {
+  free(pointer);
+}
+
+namespace trunks {
+namespace {
+
+const int kIterations = 1000;
+// The size of a SHA-256 object name.
+const size_t kHandleNameSize = 34;
+
+// Times kIterations runs of the body of a while (benchmark.Loop()) loop. One
+// untimed run comes first so buffers reused across runs are already allocated.
+class Benchmark {
+ public:
+  explicit Benchmark(const char* name) : name_(name) {}
+
+  bool Loop() {
+    if (iteration_ == 1) {
+      start_allocations_ = g_allocation_count;
+      start_ = base::TimeTicks::Now();
+    } else if (iteration_ > kIterations) {
+      elapsed_ = base::TimeTicks::Now() - start_;
+      allocations_ = g_allocation_count - start_allocations_;
+      return false;
+    }
+    ++iteration_;
+    return true;
+  }
+
+  // Prints the results. Returns false if the last run failed with |rc|.
+  bool Report(TPM_RC rc) {
+    if (rc != TPM_RC_SUCCESS) {
+      printf("%-48s FAILED: 0x%x\\n", name_, rc);
+      return false;
+    }
+    printf("%-48s %10.1f ns/op %8.2f allocs/op\\n", name_,
+           elapsed_.InMicrosecondsF() * 1000 / kIterations,
+           static_cast<double>(allocations_) / kIterations);
+    return true;
+  }
+
+ private:
+  const char* name_;
+  int iteration_ = 0;
+  size_t start_allocations_ = 0;
+  size_t allocations_ = 0;
+  base::TimeTicks start_;
+  base::TimeDelta elapsed_;
+
+  DISALLOW_COPY_AND_ASSIGN(Benchmark);
+};
+
+// Wraps serialized response |parameters| in a successful response header.
+std::string MakeResponse(const std::string& parameters) {
+  std::string response;
+  Serialize_TPM_ST(TPM_ST_NO_SESSIONS, &response);
+  Serialize_UINT32(10 + parameters.size(), &response);
+  Serialize_TPM_RC(TPM_RC_SUCCESS, &response);
+  return response + parameters;
+}
+"""
+_BENCHMARK_FILE_END = """
+}  // namespace
+}  // namespace trunks
+
+int main(int argc, char** argv) {
+  bool success = true;
+  for (auto benchmark : trunks::kBenchmarks) {
+    success = benchmark() && success;
+  }
+  return success ? 0 : 1;
+}
+"""
+_BENCHMARK_TABLE_START = """
+const BenchmarkFunction kBenchmarks[] = {"""
+_BENCHMARK_TABLE_TYPEDEF = """
+typedef bool (*BenchmarkFunction)();
+"""
+_FUZZER_FILE_INCLUDES = """
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <base/macros.h>
+
+#include "trunks/password_authorization_delegate.h"
+#include "trunks/tpm_generated.h"
+"""
+_FUZZER_FILE_START = """
+// A libFuzzer target for every generated parse function. The first two bytes
+// of the input select the function and the rest of the input is parsed.
+
+namespace trunks {
+namespace {
+
+typedef void (*FuzzTarget)(const std::string& input);
+
+template <typename T, TPM_RC (*Parse)(ParseCursor*, T*)>
+void FuzzParse(const std::string& input) {
+  ParseCursor cursor(input);
+  T value;
+  Parse(&cursor, &value);
+}
+"""
+_FUZZER_TABLE_START = """
+const FuzzTarget kFuzzTargets[] = {"""
+_FUZZER_TABLE_PARSE = """
+    &FuzzParse<%(type)s, &Parse_%(type)s>,"""
+_FUZZER_TABLE_RESPONSE = """
+    &FuzzParseResponse_%(method_name)s,"""
+_TABLE_END = """
+};
+"""
+_FUZZER_FILE_END = """
+}  // namespace
+}  // namespace trunks
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (size < 2) {
+    return 0;
+  }
+  std::string input(reinterpret_cast<const char*>(data + 2), size - 2);
+  size_t target = (data[0] << 8) | data[1];
+  trunks::kFuzzTargets[target % arraysize(trunks::kFuzzTargets)](input);
   return 0;
 }
 """
+_HANDLE_COUNT_FUNCTION = """
+size_t GetNumberOf%(handle_type)sHandles(TPM_CC command_code) {
+  const TpmCommandMetadata* metadata = GetCommandMetadata(command_code);
+  if (!metadata) {
+    LOG(WARNING) << "Unknown command code: " << command_code;
+    return 0;
+  }
+  return metadata->%(field)s;
+}
+"""
 
 def FixName(name):
   """Fixes names to conform to Chromium style."""
@@ -283,17 +751,16 @@ class Typedef(object):
 TPM_RC Serialize_%(new)s(
     const %(new)s& value,
     std::string* buffer) {
-  VLOG(3) << __func__;
+  TRACE_MARSHALLING();
   return Serialize_%(old)s(value, buffer);
 }
 """
   _PARSE_FUNCTION = """
 TPM_RC Parse_%(new)s(
-    std::string* buffer,
-    %(new)s* value,
-    std::string* value_bytes) {
-  VLOG(3) << __func__;
-  return Parse_%(old)s(buffer, value, value_bytes);
+    ParseCursor* cursor,
+    %(new)s* value) {
+  TRACE_MARSHALLING();
+  return Parse_%(old)s(cursor, value);
 }
 """
 
@@ -341,7 +808,12 @@ TPM_RC Parse_%(new)s(
                                     'new_type': self.new_type})
     defined_types.add(self.new_type)
 
-  def OutputSerialize(self, out_file, serialized_types, typemap):
+  def IsInline(self):
+    """Returns True if the typedef is marshalled by inline header functions."""
+    return self.old_type in _BASIC_TYPES
+
+  def OutputSerialize(self, out_file, serialized_types, typemap,
+                      table_driven=False):
     """Writes a serialize and parse function for the typedef to |out_file|.
 
     Args:
@@ -349,16 +821,19 @@ TPM_RC Parse_%(new)s(
       serialized_types: A set of types for which serialize and parse functions
         have already been generated.
       typemap: A dict mapping type names to the corresponding object.
+      table_driven: Whether structures use the table driven backend.
     """
     if self.new_type in serialized_types:
       return
     if self.old_type not in serialized_types:
       typemap[self.old_type].OutputSerialize(out_file, serialized_types,
-                                             typemap)
-    out_file.write(self._SERIALIZE_FUNCTION % {'old': self.old_type,
-                                               'new': self.new_type})
-    out_file.write(self._PARSE_FUNCTION % {'old': self.old_type,
-                                           'new': self.new_type})
+                                             typemap, table_driven)
+    if not self.IsInline():
+      out_file.write(self._SERIALIZE_FUNCTION % {'old': self.old_type,
+                                                 'new': self.new_type})
+      out_file.write(self._PARSE_FUNCTION % {'old': self.old_type,
+                                             'new': self.new_type})
+    out_file.write(_PARSE_STRING_FUNCTION % {'type': self.new_type})
     serialized_types.add(self.new_type)
 
 
@@ -426,7 +901,7 @@ TPM_RC Serialize_%(type)s(
     const %(type)s& value,
     std::string* buffer) {
   TPM_RC result = TPM_RC_SUCCESS;
-  VLOG(3) << __func__;
+  TRACE_MARSHALLING();
 """
   _SERIALIZE_FIELD = """
   result = Serialize_%(type)s(value.%(name)s, buffer);
@@ -444,6 +919,13 @@ TPM_RC Serialize_%(type)s(
       return result;
     }
   }
+"""
+  _SERIALIZE_FIELD_BYTE_ARRAY = """
+  if (arraysize(value.%(name)s) < value.%(count)s) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  buffer->append(reinterpret_cast<const char*>(value.%(name)s),
+                 value.%(count)s);
 """
   _SERIALIZE_FIELD_WITH_SELECTOR = """
   result = Serialize_%(type)s(
@@ -469,17 +951,15 @@ TPM_RC Serialize_%(type)s(
 """
   _PARSE_FUNCTION_START = """
 TPM_RC Parse_%(type)s(
-    std::string* buffer,
-    %(type)s* value,
-    std::string* value_bytes) {
+    ParseCursor* cursor,
+    %(type)s* value) {
   TPM_RC result = TPM_RC_SUCCESS;
-  VLOG(3) << __func__;
+  TRACE_MARSHALLING();
 """
   _PARSE_FIELD = """
   result = Parse_%(type)s(
-      buffer,
-      &value->%(name)s,
-      value_bytes);
+      cursor,
+      &value->%(name)s);
   if (result) {
     return result;
   }
@@ -490,20 +970,26 @@ TPM_RC Parse_%(type)s(
   }
   for (uint32_t i = 0; i < value->%(count)s; ++i) {
     result = Parse_%(type)s(
-        buffer,
-        &value->%(name)s[i],
-        value_bytes);
+        cursor,
+        &value->%(name)s[i]);
     if (result) {
       return result;
     }
   }
+"""
+  _PARSE_FIELD_BYTE_ARRAY = """
+  if (arraysize(value->%(name)s) < value->%(count)s) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  if (!cursor->Read(value->%(name)s, value->%(count)s)) {
+    return TPM_RC_INSUFFICIENT;
+  }
 """
   _PARSE_FIELD_WITH_SELECTOR = """
   result = Parse_%(type)s(
-      buffer,
+      cursor,
       value->%(selector_name)s,
-      &value->%(name)s,
-      value_bytes);
+      &value->%(name)s);
   if (result) {
     return result;
   }
@@ -518,7 +1004,7 @@ TPM_RC Serialize_%(union_type)s(
     %(selector_type)s selector,
     std::string* buffer) {
   TPM_RC result = TPM_RC_SUCCESS;
-  VLOG(3) << __func__;
+  TRACE_MARSHALLING();
 """
   _SERIALIZE_UNION_FIELD = """
   if (selector == %(selector_value)s) {
@@ -540,22 +1026,29 @@ TPM_RC Serialize_%(union_type)s(
       }
     }
   }
+"""
+  _SERIALIZE_UNION_FIELD_BYTE_ARRAY = """
+  if (selector == %(selector_value)s) {
+    if (arraysize(value.%(field_name)s) < %(count)s) {
+      return TPM_RC_INSUFFICIENT;
+    }
+    buffer->append(reinterpret_cast<const char*>(value.%(field_name)s),
+                   %(count)s);
+  }
 """
   _PARSE_UNION_FUNCTION_START = """
 TPM_RC Parse_%(union_type)s(
-    std::string* buffer,
+    ParseCursor* cursor,
     %(selector_type)s selector,
-    %(union_type)s* value,
-    std::string* value_bytes) {
+    %(union_type)s* value) {
   TPM_RC result = TPM_RC_SUCCESS;
-  VLOG(3) << __func__;
+  TRACE_MARSHALLING();
 """
   _PARSE_UNION_FIELD = """
   if (selector == %(selector_value)s) {
     result = Parse_%(field_type)s(
-        buffer,
-        &value->%(field_name)s,
-        value_bytes);
+        cursor,
+        &value->%(field_name)s);
     if (result) {
       return result;
     }
@@ -568,14 +1061,23 @@ TPM_RC Parse_%(union_type)s(
     }
     for (uint32_t i = 0; i < %(count)s; ++i) {
       result = Parse_%(field_type)s(
-          buffer,
-          &value->%(field_name)s[i],
-          value_bytes);
+          cursor,
+          &value->%(field_name)s[i]);
       if (result) {
         return result;
       }
     }
   }
+"""
+  _PARSE_UNION_FIELD_BYTE_ARRAY = """
+  if (selector == %(selector_value)s) {
+    if (arraysize(value->%(field_name)s) < %(count)s) {
+      return TPM_RC_INSUFFICIENT;
+    }
+    if (!cursor->Read(value->%(field_name)s, %(count)s)) {
+      return TPM_RC_INSUFFICIENT;
+    }
+  }
 """
   _EMPTY_UNION_CASE = """
   if (selector == %(selector_value)s) {
@@ -587,9 +1089,9 @@ TPM_RC Parse_%(union_type)s(
     const std::string& bytes) {
   %(type)s tpm2b;
   CHECK(bytes.size() <= sizeof(tpm2b.%(buffer_name)s));
-  memset(&tpm2b, 0, sizeof(%(type)s));
   tpm2b.size = bytes.size();
-  memcpy(tpm2b.%(buffer_name)s, bytes.data(), bytes.size());
+  CopyToTPM2BBuffer(bytes.data(), bytes.size(), tpm2b.%(buffer_name)s,
+                    sizeof(tpm2b.%(buffer_name)s));
   return tpm2b;
 }
 
@@ -610,6 +1112,182 @@ std::string StringFrom_%(type)s(
 }
 """
 
+  _MARSHAL_FIELDS_START = """
+const MarshalField kFields_%(type)s[] = {
+"""
+  _MARSHAL_FIELD = """    {MarshalField::%(kind)s, %(width)s, %(reference)s,
+     offsetof(%(type)s, %(name)s), %(stride)s, %(capacity)s, %(descriptor)s},
+"""
+  _MARSHAL_SELECTORS_START = """
+const uint32_t kSelectors_%(type)s[] = {
+"""
+  _MARSHAL_SELECTOR = '    %(selector_value)s,\n'
+  _MARSHAL_TABLE_END = '};\n'
+  _MARSHAL_DESCRIPTOR = """
+const MarshalDescriptor kDescriptor_%(type)s = {
+    %(fields)s, %(field_count)s, %(selectors)s, %(is_sized_structure)s};
+"""
+  _SERIALIZE_WITH_DESCRIPTOR = """
+TPM_RC Serialize_%(type)s(
+    const %(type)s& value,
+    std::string* buffer) {
+  TRACE_MARSHALLING();
+  return SerializeWithDescriptor(kDescriptor_%(type)s, &value, buffer);
+}
+
+TPM_RC Parse_%(type)s(
+    ParseCursor* cursor,
+    %(type)s* value) {
+  TRACE_MARSHALLING();
+  return ParseWithDescriptor(kDescriptor_%(type)s, cursor, value);
+}
+"""
+  _SERIALIZE_UNION_WITH_DESCRIPTOR = """
+TPM_RC Serialize_%(union_type)s(
+    const %(union_type)s& value,
+    %(selector_type)s selector,
+    std::string* buffer) {
+  TRACE_MARSHALLING();
+  return SerializeUnionWithDescriptor(kDescriptor_%(union_type)s, selector,
+                                      &value, buffer);
+}
+
+TPM_RC Parse_%(union_type)s(
+    ParseCursor* cursor,
+    %(selector_type)s selector,
+    %(union_type)s* value) {
+  TRACE_MARSHALLING();
+  return ParseUnionWithDescriptor(kDescriptor_%(union_type)s, selector,
+                                  cursor, value);
+}
+"""
+
+  _COMPACT_STRUCTURE = 'struct %(name)s_COMPACT {\n'
+  _COMPACT_UNION_COMMENT = '// Only the member chosen by the selector is set.\n'
+  _COMPACT_LIST_FIELD = '  std::vector<%(type)s> %(name)s;\n'
+  _PARSE_COMPACT_LIST = """
+  UINT32 count = 0;
+  result = Parse_UINT32(cursor, &count);
+  if (result) {
+    return result;
+  }
+  if (count > %(capacity)s) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  value->%(name)s.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    result = Parse_%(type)s(
+        cursor,
+        &value->%(name)s[i]);
+    if (result) {
+      return result;
+    }
+  }
+"""
+  _PARSE_COMPACT_FIELD_WITH_SELECTOR = """
+  result = Parse_%(type)s_COMPACT(
+      cursor,
+      value->%(selector_name)s,
+      &value->%(name)s);
+  if (result) {
+    return result;
+  }
+"""
+  _MAKE_COMPACT_FUNCTION_START = """
+%(type)s_COMPACT Make_%(type)s_COMPACT(
+    const %(type)s& value) {
+  %(type)s_COMPACT compact;
+"""
+  _MAKE_COMPACT_UNION_FUNCTION_START = """
+%(type)s_COMPACT Make_%(type)s_COMPACT(
+    %(selector_type)s selector,
+    const %(type)s& value) {
+  %(type)s_COMPACT compact;
+"""
+  _MAKE_COMPACT_LIST = """
+  UINT32 count = std::min<UINT32>(value.%(count)s, arraysize(value.%(name)s));
+  compact.%(name)s.assign(value.%(name)s, value.%(name)s + count);
+"""
+  _MAKE_COMPACT_FIELD = """
+  compact.%(name)s = value.%(name)s;
+"""
+  _MAKE_COMPACT_FIELD_COMPACT = """
+  compact.%(name)s = Make_%(type)s_COMPACT(value.%(name)s);
+"""
+  _MAKE_COMPACT_FIELD_WITH_SELECTOR = """
+  compact.%(name)s = Make_%(type)s_COMPACT(
+      value.%(selector_name)s,
+      value.%(name)s);
+"""
+  _MAKE_COMPACT_UNION_FIELD = """
+  if (selector == %(selector_value)s) {
+    compact.%(field_name)s = value.%(field_name)s;
+  }
+"""
+  _MAKE_COMPACT_UNION_FIELD_COMPACT = """
+  if (selector == %(selector_value)s) {
+    compact.%(field_name)s = Make_%(field_type)s_COMPACT(
+        value.%(field_name)s);
+  }
+"""
+  _MAKE_COMPACT_FUNCTION_END = '  return compact;\n}\n'
+  _EXPAND_COMPACT_FUNCTION_START = """
+TPM_RC Expand_%(type)s_COMPACT(
+    const %(type)s_COMPACT& value,
+    %(type)s* expanded) {
+  TPM_RC result = TPM_RC_SUCCESS;
+"""
+  _EXPAND_COMPACT_UNION_FUNCTION_START = """
+TPM_RC Expand_%(type)s_COMPACT(
+    %(selector_type)s selector,
+    const %(type)s_COMPACT& value,
+    %(type)s* expanded) {
+  TPM_RC result = TPM_RC_SUCCESS;
+"""
+  _EXPAND_COMPACT_LIST = """
+  if (value.%(name)s.size() > arraysize(expanded->%(name)s)) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  expanded->%(count)s = value.%(name)s.size();
+  std::copy(value.%(name)s.begin(), value.%(name)s.end(),
+            expanded->%(name)s);
+"""
+  _EXPAND_COMPACT_FIELD = """
+  expanded->%(name)s = value.%(name)s;
+"""
+  _EXPAND_COMPACT_FIELD_COMPACT = """
+  result = Expand_%(type)s_COMPACT(
+      value.%(name)s,
+      &expanded->%(name)s);
+  if (result) {
+    return result;
+  }
+"""
+  _EXPAND_COMPACT_FIELD_WITH_SELECTOR = """
+  result = Expand_%(type)s_COMPACT(
+      value.%(selector_name)s,
+      value.%(name)s,
+      &expanded->%(name)s);
+  if (result) {
+    return result;
+  }
+"""
+  _EXPAND_COMPACT_UNION_FIELD = """
+  if (selector == %(selector_value)s) {
+    expanded->%(field_name)s = value.%(field_name)s;
+  }
+"""
+  _EXPAND_COMPACT_UNION_FIELD_COMPACT = """
+  if (selector == %(selector_value)s) {
+    result = Expand_%(field_type)s_COMPACT(
+        value.%(field_name)s,
+        &expanded->%(field_name)s);
+    if (result) {
+      return result;
+    }
+  }
+"""
+
   def __init__(self, name, is_union):
     """Initializes a Structure instance.
 
@@ -652,10 +1330,29 @@ std::string StringFrom_%(type)s(
     """Returns whether this struct is a TPM2B structure with raw bytes."""
     return self.name.startswith('TPM2B_') and self.fields[1][0] == 'BYTE'
 
+  def GetBufferName(self):
+    """Returns the name of the byte array field of a simple TPM2B struct."""
+    return self._ARRAY_FIELD_RE.search(self.fields[1][1]).group(1)
+
   def IsComplexTPM2B(self):
     """Returns whether this struct is a TPM2B structure with an inner struct."""
     return self.name.startswith('TPM2B_') and self.fields[1][0] != 'BYTE'
 
+  def IsList(self):
+    """Returns whether this struct is a TPML structure with a counted array."""
+    return self.name.startswith('TPML_')
+
+  def _GetListField(self):
+    """Returns the (type, name, capacity) of the array in a TPML structure."""
+    match = self._ARRAY_FIELD_RE.search(self.fields[1][1])
+    return self.fields[1][0], match.group(1), match.group(2)
+
+  def _GetCompactType(self, field_type, compact_types):
+    """Returns the field type to use in the compact variant of this struct."""
+    if field_type in compact_types:
+      return field_type + '_COMPACT'
+    return field_type
+
   def _GetFieldTypes(self):
     """Creates a set which holds all current field types.
 
@@ -683,97 +1380,405 @@ std::string StringFrom_%(type)s(
       out_file.write(self._STRUCTURE_FORWARD % {'name': self.name})
     self._forwarded = True
 
-  def Output(self, out_file, defined_types, typemap):
-    """Writes a structure definition to |out_file|.
+  def Output(self, out_file, defined_types, typemap):
+    """Writes a structure definition to |out_file|.
+
+    Any outstanding dependencies will be defined.
+
+    Args:
+      out_file: The output file.
+      defined_types: A set of types for which definitions have already been
+        generated.
+      typemap: A dict mapping type names to the corresponding object.
+    """
+    if self.name in defined_types:
+      return
+    # Make sure any dependencies are already defined.
+    for field_type in self._GetFieldTypes():
+      if field_type not in defined_types:
+        typemap[field_type].Output(out_file, defined_types, typemap)
+    for required_type in self.depends_on:
+      if required_type not in defined_types:
+        typemap[required_type].Output(out_file, defined_types, typemap)
+    if self.is_union:
+      out_file.write(self._UNION % {'name': self.name})
+    else:
+      out_file.write(self._STRUCTURE % {'name': self.name})
+    for field in self.fields:
+      out_file.write(self._STRUCTURE_FIELD % {'type': field[0],
+                                              'name': field[1]})
+    out_file.write(self._STRUCTURE_END)
+    defined_types.add(self.name)
+
+  def OutputSerialize(self, out_file, serialized_types, typemap,
+                      table_driven=False):
+    """Writes serialize and parse functions for a structure to |out_file|.
+
+    Args:
+      out_file: The output file.
+      serialized_types: A set of types for which serialize and parse functions
+        have already been generated.  This type name of this structure will be
+        added on success.
+      typemap: A dict mapping type names to the corresponding object.
+      table_driven: Whether to describe the structure with a MarshalDescriptor
+        table, marshalled by the shared functions in tpm_marshal.cc, instead of
+        unrolling its serialize and parse functions.
+    """
+    if (self.name in serialized_types or
+        self.name == 'TPMU_NAME' or
+        self.name == 'TPMU_ENCRYPTED_SECRET'):
+      return
+    # Make sure any dependencies already have serialize functions defined.
+    for field_type in self._GetFieldTypes():
+      if field_type not in serialized_types:
+        typemap[field_type].OutputSerialize(out_file, serialized_types,
+                                            typemap, table_driven)
+    if table_driven:
+      self._OutputTableDrivenSerialize(out_file, typemap)
+    elif self.is_union:
+      self._OutputUnionSerialize(out_file)
+    else:
+      self._OutputStructSerialize(out_file)
+    if self.is_union:
+      serialized_types.add(self.name)
+      return
+    out_file.write(_PARSE_STRING_FUNCTION % {'type': self.name})
+    # If this is a TPM2B structure throw in a few convenience functions.
+    if self.IsSimpleTPM2B():
+      out_file.write(self._SIMPLE_TPM2B_HELPERS % {
+          'type': self.name,
+          'buffer_name': self.GetBufferName()})
+    elif self.IsComplexTPM2B():
+      field_type = self.fields[1][0]
+      field_name = self.fields[1][1]
+      out_file.write(self._COMPLEX_TPM2B_HELPERS % {'type': self.name,
+                                                    'inner_type': field_type,
+                                                    'inner_name': field_name})
+    serialized_types.add(self.name)
+
+  def _OutputStructSerialize(self, out_file):
+    """Writes unrolled serialize and parse functions for a struct to |out_file|.
+
+    Args:
+      out_file: The output file.
+    """
+    out_file.write(self._SERIALIZE_FUNCTION_START % {'type': self.name})
+    if self.IsComplexTPM2B():
+      field_type = self.fields[1][0]
+      field_name = self.fields[1][1]
+      out_file.write(self._SERIALIZE_COMPLEX_TPM2B % {'type': field_type,
+                                                      'name': field_name})
+    else:
+      for field in self.fields:
+        if self._ARRAY_FIELD_RE.search(field[1]):
+          if field[0] == 'BYTE':
+            # Byte arrays are copied in bulk rather than one byte at a time.
+            self._OutputArrayField(out_file, field,
+                                   self._SERIALIZE_FIELD_BYTE_ARRAY)
+          else:
+            self._OutputArrayField(out_file, field,
+                                   self._SERIALIZE_FIELD_ARRAY)
+        elif self._UNION_TYPE_RE.search(field[0]):
+          self._OutputUnionField(out_file, field,
+                                 self._SERIALIZE_FIELD_WITH_SELECTOR)
+        else:
+          out_file.write(self._SERIALIZE_FIELD % {'type': field[0],
+                                                  'name': field[1]})
+    out_file.write(self._SERIALIZE_FUNCTION_END)
+    out_file.write(self._PARSE_FUNCTION_START % {'type': self.name})
+    for field in self.fields:
+      if self._ARRAY_FIELD_RE.search(field[1]):
+        if field[0] == 'BYTE':
+          self._OutputArrayField(out_file, field, self._PARSE_FIELD_BYTE_ARRAY)
+        else:
+          self._OutputArrayField(out_file, field, self._PARSE_FIELD_ARRAY)
+      elif self._UNION_TYPE_RE.search(field[0]):
+        self._OutputUnionField(out_file, field, self._PARSE_FIELD_WITH_SELECTOR)
+      else:
+        out_file.write(self._PARSE_FIELD % {'type': field[0],
+                                            'name': field[1]})
+    out_file.write(self._SERIALIZE_FUNCTION_END)
+
+  def _OutputTableDrivenSerialize(self, out_file, typemap):
+    """Writes a MarshalDescriptor and serialize and parse wrappers using it.
+
+    Args:
+      out_file: The output file.
+      typemap: A dict mapping type names to the corresponding object.
+    """
+    fields = []
+    selectors = []
+    if self.is_union:
+      fields_by_name = {f[1]: f for f in self.fields}
+      for selector in union_selectors.GetUnionSelectorValues(self.name):
+        field_name = FixName(union_selectors.GetUnionSelectorField(self.name,
+                                                                   selector))
+        # Selectors without a field marshal nothing, like unknown selectors.
+        if field_name:
+          fields.append(fields_by_name[field_name])
+          selectors.append(selector)
+    else:
+      fields = self.fields
+    values = {'type': self.name,
+              'fields': 'nullptr',
+              'field_count': 0,
+              'selectors': 'nullptr',
+              'is_sized_structure': GetCppBool(self.IsComplexTPM2B())}
+    if fields:
+      out_file.write(self._MARSHAL_FIELDS_START % {'type': self.name})
+      for field in fields:
+        out_file.write(self._MARSHAL_FIELD % self._GetMarshalField(field,
+                                                                   typemap))
+      out_file.write(self._MARSHAL_TABLE_END)
+      values['fields'] = 'kFields_%s' % self.name
+      values['field_count'] = 'arraysize(kFields_%s)' % self.name
+    if selectors:
+      out_file.write(self._MARSHAL_SELECTORS_START % {'type': self.name})
+      for selector in selectors:
+        out_file.write(self._MARSHAL_SELECTOR % {'selector_value': selector})
+      out_file.write(self._MARSHAL_TABLE_END)
+      values['selectors'] = 'kSelectors_%s' % self.name
+    out_file.write(self._MARSHAL_DESCRIPTOR % values)
+    if self.is_union:
+      out_file.write(self._SERIALIZE_UNION_WITH_DESCRIPTOR % {
+          'union_type': self.name,
+          'selector_type': union_selectors.GetUnionSelectorType(self.name)})
+    else:
+      out_file.write(self._SERIALIZE_WITH_DESCRIPTOR % {'type': self.name})
+
+  def _GetMarshalField(self, field, typemap):
+    """Returns the values of the MarshalField which describes |field|.
+
+    Args:
+      field: The field as a (type, name) tuple.
+      typemap: A dict mapping type names to the corresponding object.
+    """
+    field_type, field_name = field
+    values = {'type': self.name,
+              'name': field_name,
+              'width': 0,
+              'reference': -1,
+              'stride': 0,
+              'capacity': 0,
+              'descriptor': 'nullptr'}
+    array_match = self._ARRAY_FIELD_RE.search(field_name)
+    if array_match:
+      values['name'] = array_match.group(1)
+      values['capacity'] = array_match.group(2)
+      # Arrays in unions have a fixed size.
+      if not self.is_union:
+        values['reference'] = self._GetCountFieldIndex(field)
+      if field_type == 'BYTE':
+        values['kind'] = 'kByteArray'
+        return values
+      values['kind'] = 'kArray'
+      values['stride'] = 'sizeof(%s)' % field_type
+    elif self._UNION_TYPE_RE.search(field_type):
+      values['kind'] = 'kUnion'
+      values['reference'] = self._GetSelectorFieldIndex(field)
+      values['descriptor'] = '&kDescriptor_%s' % field_type
+      return values
+    basic_type = GetBasicType(field_type, typemap)
+    if basic_type:
+      assert basic_type in _FIXED_SIZE_BASIC_TYPES, (
+          'Field %s in %s has no fixed size!' % (field_name, self.name))
+      values['width'] = _FIXED_SIZE_BASIC_TYPES[basic_type]
+      values.setdefault('kind', 'kInteger')
+    else:
+      values['descriptor'] = '&kDescriptor_%s' % GetStructureType(field_type,
+                                                                  typemap)
+      values.setdefault('kind', 'kStructure')
+    return values
+
+  def _GetSelectorFieldIndex(self, field):
+    """Returns the index of the field which selects the member of union |field|.
+
+    This requires that a field of an acceptable selector type appear somewhere
+    in the struct.
+
+    Args:
+      field: The union field as a (type, name) tuple.
+    """
+    selector_types = union_selectors.GetUnionSelectorTypes(field[0])
+    for index, selector_field in enumerate(self.fields):
+      if selector_field[0] in selector_types:
+        return index
+    assert False, 'Missing selector for %s in %s!' % (field[1], self.name)
+
+  def _GetCountFieldIndex(self, field):
+    """Returns the index of the field which holds the count of array |field|.
+
+    Args:
+      field: The array field as a (type, name) tuple.
+    """
+    for index, count_field in enumerate(self.fields):
+      assert count_field != field, ('Missing count field for %s in %s!' %
+                                    (field[1], self.name))
+      if self._ARRAY_FIELD_SIZE_RE.search(count_field[1]):
+        return index
+
+  def OutputCompact(self, out_file, defined_types, compact_types, typemap):
+    """Writes the definition of the compact variant of this struct.
 
-    Any outstanding dependencies will be defined.
+    Any compact variants this struct depends on will be defined first.
 
     Args:
       out_file: The output file.
-      defined_types: A set of types for which definitions have already been
+      defined_types: A set of types for which compact variants have already been
         generated.
+      compact_types: A set of the types which have compact variants.
       typemap: A dict mapping type names to the corresponding object.
     """
     if self.name in defined_types:
       return
-    # Make sure any dependencies are already defined.
     for field_type in self._GetFieldTypes():
-      if field_type not in defined_types:
-        typemap[field_type].Output(out_file, defined_types, typemap)
-    for required_type in self.depends_on:
-      if required_type not in defined_types:
-        typemap[required_type].Output(out_file, defined_types, typemap)
+      if field_type in compact_types and field_type not in defined_types:
+        typemap[field_type].OutputCompact(out_file, defined_types,
+                                          compact_types, typemap)
     if self.is_union:
-      out_file.write(self._UNION % {'name': self.name})
+      out_file.write(self._COMPACT_UNION_COMMENT)
+    out_file.write(self._COMPACT_STRUCTURE % {'name': self.name})
+    if self.IsList():
+      element_type, element_name, _ = self._GetListField()
+      out_file.write(self._COMPACT_LIST_FIELD % {'type': element_type,
+                                                 'name': element_name})
     else:
-      out_file.write(self._STRUCTURE % {'name': self.name})
-    for field in self.fields:
-      out_file.write(self._STRUCTURE_FIELD % {'type': field[0],
-                                              'name': field[1]})
+      for field in self.fields:
+        assert not self._ARRAY_FIELD_RE.search(field[1]), (
+            'Array %s in compact %s!' % (field[1], self.name))
+        out_file.write(self._STRUCTURE_FIELD % {
+            'type': self._GetCompactType(field[0], compact_types),
+            'name': field[1]})
     out_file.write(self._STRUCTURE_END)
     defined_types.add(self.name)
 
-  def OutputSerialize(self, out_file, serialized_types, typemap):
-    """Writes serialize and parse functions for a structure to |out_file|.
+  def OutputCompactDeclarations(self, out_file):
+    """Writes declarations for the compact variant functions of this struct.
 
     Args:
       out_file: The output file.
-      serialized_types: A set of types for which serialize and parse functions
-        have already been generated.  This type name of this structure will be
-        added on success.
-      typemap: A dict mapping type names to the corresponding object.
     """
-    if (self.name in serialized_types or
-        self.name == 'TPMU_NAME' or
-        self.name == 'TPMU_ENCRYPTED_SECRET'):
-      return
-    # Make sure any dependencies already have serialize functions defined.
-    for field_type in self._GetFieldTypes():
-      if field_type not in serialized_types:
-        typemap[field_type].OutputSerialize(out_file, serialized_types, typemap)
     if self.is_union:
-      self._OutputUnionSerialize(out_file)
-      serialized_types.add(self.name)
+      out_file.write(_COMPACT_UNION_DECLARATION % {
+          'type': self.name,
+          'selector_type': union_selectors.GetUnionSelectorType(self.name)})
+    else:
+      out_file.write(_COMPACT_DECLARATION % {'type': self.name})
+
+  def OutputCompactSerialize(self, out_file, compact_types):
+    """Writes parse and conversion functions for the compact variant.
+
+    Args:
+      out_file: The output file.
+      compact_types: A set of the types which have compact variants.
+    """
+    if self.is_union:
+      self._OutputCompactUnionSerialize(out_file, compact_types)
       return
-    out_file.write(self._SERIALIZE_FUNCTION_START % {'type': self.name})
-    if self.IsComplexTPM2B():
-      field_type = self.fields[1][0]
-      field_name = self.fields[1][1]
-      out_file.write(self._SERIALIZE_COMPLEX_TPM2B % {'type': field_type,
-                                                      'name': field_name})
+    compact_type = self.name + '_COMPACT'
+    out_file.write(self._PARSE_FUNCTION_START % {'type': compact_type})
+    if self.IsList():
+      element_type, element_name, capacity = self._GetListField()
+      out_file.write(self._PARSE_COMPACT_LIST % {'type': element_type,
+                                                 'name': element_name,
+                                                 'capacity': capacity})
     else:
       for field in self.fields:
-        if self._ARRAY_FIELD_RE.search(field[1]):
-          self._OutputArrayField(out_file, field, self._SERIALIZE_FIELD_ARRAY)
-        elif self._UNION_TYPE_RE.search(field[0]):
+        if self._UNION_TYPE_RE.search(field[0]) and field[0] in compact_types:
           self._OutputUnionField(out_file, field,
-                                 self._SERIALIZE_FIELD_WITH_SELECTOR)
+                                 self._PARSE_COMPACT_FIELD_WITH_SELECTOR)
         else:
-          out_file.write(self._SERIALIZE_FIELD % {'type': field[0],
-                                                  'name': field[1]})
+          out_file.write(self._PARSE_FIELD % {
+              'type': self._GetCompactType(field[0], compact_types),
+              'name': field[1]})
     out_file.write(self._SERIALIZE_FUNCTION_END)
-    out_file.write(self._PARSE_FUNCTION_START % {'type': self.name})
-    for field in self.fields:
-      if self._ARRAY_FIELD_RE.search(field[1]):
-        self._OutputArrayField(out_file, field, self._PARSE_FIELD_ARRAY)
-      elif self._UNION_TYPE_RE.search(field[0]):
-        self._OutputUnionField(out_file, field, self._PARSE_FIELD_WITH_SELECTOR)
+    out_file.write(_PARSE_STRING_FUNCTION % {'type': compact_type})
+    out_file.write(self._MAKE_COMPACT_FUNCTION_START % {'type': self.name})
+    if self.IsList():
+      _, element_name, _ = self._GetListField()
+      out_file.write(self._MAKE_COMPACT_LIST % {'count': self.fields[0][1],
+                                                'name': element_name})
+    else:
+      for field in self.fields:
+        if self._UNION_TYPE_RE.search(field[0]) and field[0] in compact_types:
+          self._OutputUnionField(out_file, field,
+                                 self._MAKE_COMPACT_FIELD_WITH_SELECTOR)
+        elif field[0] in compact_types:
+          out_file.write(self._MAKE_COMPACT_FIELD_COMPACT % {
+              'type': field[0], 'name': field[1]})
+        else:
+          out_file.write(self._MAKE_COMPACT_FIELD % {'name': field[1]})
+    out_file.write(self._MAKE_COMPACT_FUNCTION_END)
+    out_file.write(self._EXPAND_COMPACT_FUNCTION_START % {'type': self.name})
+    if self.IsList():
+      _, element_name, _ = self._GetListField()
+      out_file.write(self._EXPAND_COMPACT_LIST % {'count': self.fields[0][1],
+                                                  'name': element_name})
+    else:
+      for field in self.fields:
+        if self._UNION_TYPE_RE.search(field[0]) and field[0] in compact_types:
+          self._OutputUnionField(out_file, field,
+                                 self._EXPAND_COMPACT_FIELD_WITH_SELECTOR)
+        elif field[0] in compact_types:
+          out_file.write(self._EXPAND_COMPACT_FIELD_COMPACT % {
+              'type': field[0], 'name': field[1]})
+        else:
+          out_file.write(self._EXPAND_COMPACT_FIELD % {'name': field[1]})
+    out_file.write(self._SERIALIZE_FUNCTION_END)
+
+  def _OutputCompactUnionSerialize(self, out_file, compact_types):
+    """Writes parse and conversion functions for the compact variant of a union.
+
+    Args:
+      out_file: The output file.
+      compact_types: A set of the types which have compact variants.
+    """
+    selector_type = union_selectors.GetUnionSelectorType(self.name)
+    selector_values = union_selectors.GetUnionSelectorValues(self.name)
+    field_types = {f[1]: f[0] for f in self.fields}
+    cases = []
+    for selector in selector_values:
+      field_name = FixName(union_selectors.GetUnionSelectorField(self.name,
+                                                                 selector))
+      cases.append((selector, field_name, field_types.get(field_name)))
+    out_file.write(self._PARSE_UNION_FUNCTION_START %
+                   {'union_type': self.name + '_COMPACT',
+                    'selector_type': selector_type})
+    for selector, field_name, field_type in cases:
+      if not field_name:
+        out_file.write(self._EMPTY_UNION_CASE % {'selector_value': selector})
+        continue
+      out_file.write(self._PARSE_UNION_FIELD % {
+          'selector_value': selector,
+          'field_type': self._GetCompactType(field_type, compact_types),
+          'field_name': field_name})
+    out_file.write(self._SERIALIZE_FUNCTION_END)
+    out_file.write(self._MAKE_COMPACT_UNION_FUNCTION_START %
+                   {'type': self.name, 'selector_type': selector_type})
+    for selector, field_name, field_type in cases:
+      if not field_name:
+        continue
+      if field_type in compact_types:
+        code_format = self._MAKE_COMPACT_UNION_FIELD_COMPACT
       else:
-        out_file.write(self._PARSE_FIELD % {'type': field[0],
-                                            'name': field[1]})
+        code_format = self._MAKE_COMPACT_UNION_FIELD
+      out_file.write(code_format % {'selector_value': selector,
+                                    'field_type': field_type,
+                                    'field_name': field_name})
+    out_file.write(self._MAKE_COMPACT_FUNCTION_END)
+    out_file.write(self._EXPAND_COMPACT_UNION_FUNCTION_START %
+                   {'type': self.name, 'selector_type': selector_type})
+    for selector, field_name, field_type in cases:
+      if not field_name:
+        continue
+      if field_type in compact_types:
+        code_format = self._EXPAND_COMPACT_UNION_FIELD_COMPACT
+      else:
+        code_format = self._EXPAND_COMPACT_UNION_FIELD
+      out_file.write(code_format % {'selector_value': selector,
+                                    'field_type': field_type,
+                                    'field_name': field_name})
     out_file.write(self._SERIALIZE_FUNCTION_END)
-    # If this is a TPM2B structure throw in a few convenience functions.
-    if self.IsSimpleTPM2B():
-      field_name = self._ARRAY_FIELD_RE.search(self.fields[1][1]).group(1)
-      out_file.write(self._SIMPLE_TPM2B_HELPERS % {'type': self.name,
-                                                   'buffer_name': field_name})
-    elif self.IsComplexTPM2B():
-      field_type = self.fields[1][0]
-      field_name = self.fields[1][1]
-      out_file.write(self._COMPLEX_TPM2B_HELPERS % {'type': self.name,
-                                                    'inner_type': field_type,
-                                                    'inner_name': field_name})
-    serialized_types.add(self.name)
 
   def _OutputUnionSerialize(self, out_file):
     """Writes serialize and parse functions for a union to |out_file|.
@@ -802,7 +1807,11 @@ std::string StringFrom_%(type)s(
       if array_match:
         field_name = array_match.group(1)
         count = array_match.group(2)
-        out_file.write(self._SERIALIZE_UNION_FIELD_ARRAY %
+        if field_type == 'BYTE':
+          code_format = self._SERIALIZE_UNION_FIELD_BYTE_ARRAY
+        else:
+          code_format = self._SERIALIZE_UNION_FIELD_ARRAY
+        out_file.write(code_format %
                        {'selector_value': selector,
                         'count': count,
                         'field_type': field_type,
@@ -826,7 +1835,11 @@ std::string StringFrom_%(type)s(
       if array_match:
         field_name = array_match.group(1)
         count = array_match.group(2)
-        out_file.write(self._PARSE_UNION_FIELD_ARRAY %
+        if field_type == 'BYTE':
+          code_format = self._PARSE_UNION_FIELD_BYTE_ARRAY
+        else:
+          code_format = self._PARSE_UNION_FIELD_ARRAY
+        out_file.write(code_format %
                        {'selector_value': selector,
                         'count': count,
                         'field_type': field_type,
@@ -849,16 +1862,9 @@ std::string StringFrom_%(type)s(
     Args:
       out_file: The output file.
       field: The union field to be processed as a (type, name) tuple.
-      code_format: Must be (_SERIALIZE|_PARSE)_FIELD_WITH_SELECTOR
+      code_format: Must be one of the *_FIELD_WITH_SELECTOR formats.
     """
-    selector_types = union_selectors.GetUnionSelectorTypes(field[0])
-    selector_name = ''
-    for tmp in self.fields:
-      if tmp[0] in selector_types:
-        selector_name = tmp[1]
-        break
-    assert selector_name, 'Missing selector for %s in %s!' % (field[1],
-                                                              self.name)
+    selector_name = self.fields[self._GetSelectorFieldIndex(field)][1]
     out_file.write(code_format % {'type': field[0],
                                   'selector_name': selector_name,
                                   'name': field[1]})
@@ -876,14 +1882,10 @@ std::string StringFrom_%(type)s(
       code_format: Must be (_SERIALIZE|_PARSE)_FIELD_ARRAY
     """
     field_name = self._ARRAY_FIELD_RE.search(field[1]).group(1)
-    for count_field in self.fields:
-      assert count_field != field, ('Missing count field for %s in %s!' %
-                                    (field[1], self.name))
-      if self._ARRAY_FIELD_SIZE_RE.search(count_field[1]):
-        out_file.write(code_format % {'count': count_field[1],
-                                      'type': field[0],
-                                      'name': field_name})
-        break
+    count_field = self.fields[self._GetCountFieldIndex(field)]
+    out_file.write(code_format % {'count': count_field[1],
+                                  'type': field[0],
+                                  'name': field_name})
 
 
 class Define(object):
@@ -1205,6 +2207,7 @@ class Command(object):
   Attributes:
     name: The command name (e.g. 'TPM2_Startup').
     command_code: The name of the command code constant (e.g. TPM2_CC_Startup).
+    sessions_allowed: False if the command tag must be TPM_ST_NO_SESSIONS.
     request_args: A list to hold command input arguments. Each element is a dict
         and has these keys:
             'type': The argument type.
@@ -1213,6 +2216,8 @@ class Command(object):
             'description': Optional descriptive text for the argument.
     response_args: A list identical in form to request_args but to hold command
         output arguments.
+    fixed_request_size: The size of the command without sessions if every
+        request argument has a fixed size, otherwise None.
   """
 
   _HANDLE_RE = re.compile(r'TPMI_.H_.*')
@@ -1224,14 +2229,44 @@ class Command(object):
       std::string* serialized_command"""
   _PARSE_ARG = """
       const std::string& response"""
+  _FIXED_SIZE_DECLARATIONS = """
+  static const size_t k%(method_name)sCommandSize = %(size)d;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_%(method_name)s(%(method_args)s
+      std::array<uint8_t, k%(method_name)sCommandSize>* command);
+"""
+  _BUILD_FUNCTION_START = """
+void Tpm::BuildCommand_%(method_name)s(%(method_args)s
+    std::array<uint8_t, k%(method_name)sCommandSize>* command) {
+  uint8_t* buffer = command->data();
+  buffer = WriteFixed_uint16_t(TPM_ST_NO_SESSIONS, buffer);
+  buffer = WriteFixed_uint32_t(k%(method_name)sCommandSize, buffer);
+  buffer = WriteFixed_uint32_t(%(command_code)s, buffer);"""
+  _BUILD_ARG = """
+  buffer = WriteFixed_%(basic_type)s(%(name)s, buffer);"""
+  _BUILD_FUNCTION_END = """
+  DCHECK(buffer == command->data() + command->size());
+}
+"""
+  _SERIALIZE_FIXED_SIZE = """
+  if (!authorization_delegate) {
+    std::array<uint8_t, k%(method_name)sCommandSize> command;
+    BuildCommand_%(method_name)s(%(method_arg_names)s&command);
+    serialized_command->assign(reinterpret_cast<const char*>(command.data()),
+                               command.size());
+    VLOG(2) << "Command: " << base::HexEncode(serialized_command->data(),
+                                              serialized_command->size());
+    return TPM_RC_SUCCESS;
+  }"""
   _SERIALIZE_FUNCTION_START = """
 TPM_RC Tpm::SerializeCommand_%(method_name)s(%(method_args)s) {
   VLOG(3) << __func__;
+  ScopedAllocationTag allocation_tag(kAllocationLayerSerialization,
+                                     %(command_code)s);"""
+  _SERIALIZE_FUNCTION_LOCALS = """
   TPM_RC rc = TPM_RC_SUCCESS;
   TPMI_ST_COMMAND_TAG tag = TPM_ST_NO_SESSIONS;
-  UINT32 command_size = 10;  // Header size.
-  std::string handle_section_bytes;
-  std::string parameter_section_bytes;"""
+  UINT32 command_size = 10;  // Header size."""
   _DECLARE_COMMAND_CODE = """
   TPM_CC command_code = %(command_code)s;"""
   _DECLARE_BOOLEAN = """
@@ -1247,30 +2282,31 @@ TPM_RC Tpm::SerializeCommand_%(method_name)s(%(method_args)s) {
   _ENCRYPT_PARAMETER = """
   if (authorization_delegate) {
     // Encrypt just the parameter data, not the size.
-    std::string tmp = %(var_name)s_bytes.substr(2);
-    if (!authorization_delegate->EncryptCommandParameter(&tmp)) {
+    if (!authorization_delegate->EncryptCommandParameterInPlace(
+        GetTPM2BPayload(&%(var_name)s_bytes),
+        %(var_name)s_bytes.size() - 2)) {
       return TRUNKS_RC_ENCRYPTION_FAILED;
     }
-    %(var_name)s_bytes.replace(2, std::string::npos, tmp);
   }"""
   _HASH_START = """
-  std::unique_ptr<crypto::SecureHash> hash(crypto::SecureHash::Create(
-      crypto::SecureHash::SHA256));"""
+      std::unique_ptr<crypto::SecureHash> hash(crypto::SecureHash::Create(
+          crypto::SecureHash::SHA256));"""
   _HASH_UPDATE = """
-  hash->Update(%(var_name)s.data(),
-               %(var_name)s.size());"""
-  _APPEND_COMMAND_HANDLE = """
-  handle_section_bytes += %(var_name)s_bytes;
+      hash->Update(%(var_name)s.data(),
+                   %(var_name)s.size());"""
+  _ADD_COMMAND_SIZE = """
   command_size += %(var_name)s_bytes.size();"""
-  _APPEND_COMMAND_PARAMETER = """
-  parameter_section_bytes += %(var_name)s_bytes;
-  command_size += %(var_name)s_bytes.size();"""
-  _AUTHORIZE_COMMAND = """
-  std::string command_hash(32, 0);
-  hash->Finish(base::string_as_array(&command_hash), command_hash.size());
+  _AUTHORIZE_COMMAND_START = """
   std::string authorization_section_bytes;
   std::string authorization_size_bytes;
   if (authorization_delegate) {
+    // The cpHash is only computed for delegates which use it.
+    std::string command_hash;
+    if (authorization_delegate->RequiresParameterHashes()) {"""
+  _AUTHORIZE_COMMAND = """
+      command_hash.resize(32);
+      hash->Finish(base::string_as_array(&command_hash), command_hash.size());
+    }
     if (!authorization_delegate->GetCommandAuthorization(
         command_hash,
         is_command_parameter_encryption_possible,
@@ -1290,14 +2326,12 @@ TPM_RC Tpm::SerializeCommand_%(method_name)s(%(method_args)s) {
                       authorization_section_bytes.size();
     }
   }"""
+  _SERIALIZE_COMMAND_START = """
+  serialized_command->clear();
+  serialized_command->reserve(command_size);"""
+  _APPEND_COMMAND_BYTES = """
+  serialized_command->append(%(var_name)s);"""
   _SERIALIZE_FUNCTION_END = """
-  *serialized_command = tag_bytes +
-                        command_size_bytes +
-                        command_code_bytes +
-                        handle_section_bytes +
-                        authorization_size_bytes +
-                        authorization_section_bytes +
-                        parameter_section_bytes;
   CHECK(serialized_command->size() == command_size) << "Command size mismatch!";
   VLOG(2) << "Command: " << base::HexEncode(serialized_command->data(),
                                             serialized_command->size());
@@ -1307,6 +2341,8 @@ TPM_RC Tpm::SerializeCommand_%(method_name)s(%(method_args)s) {
   _RESPONSE_PARSER_START = """
 TPM_RC Tpm::ParseResponse_%(method_name)s(%(method_args)s) {
   VLOG(3) << __func__;
+  ScopedAllocationTag allocation_tag(kAllocationLayerSerialization,
+                                     %(command_code)s);
   VLOG(2) << "Response: " << base::HexEncode(response.data(), response.size());
   TPM_RC rc = TPM_RC_SUCCESS;
   std::string buffer(response);"""
@@ -1351,11 +2387,17 @@ TPM_RC Tpm::ParseResponse_%(method_name)s(%(method_args)s) {
     // Keep the parameter section in |buffer|.
     buffer.erase(parameter_section_size);
   }"""
-  _AUTHORIZE_RESPONSE = """
-  std::string response_hash(32, 0);
-  hash->Finish(base::string_as_array(&response_hash), response_hash.size());
+  _AUTHORIZE_RESPONSE_START = """
   if (tag == TPM_ST_SESSIONS) {
     CHECK(authorization_delegate) << "Authorization delegate missing!";
+    // The rpHash is only computed for delegates which use it.
+    std::string response_hash;
+    if (authorization_delegate->RequiresParameterHashes()) {"""
+  _AUTHORIZE_RESPONSE = """
+      response_hash.resize(32);
+      hash->Finish(base::string_as_array(&response_hash),
+                   response_hash.size());
+    }
     if (!authorization_delegate->CheckResponseAuthorization(
         response_hash,
         authorization_section_bytes)) {
@@ -1366,11 +2408,11 @@ TPM_RC Tpm::ParseResponse_%(method_name)s(%(method_args)s) {
   if (tag == TPM_ST_SESSIONS) {
     CHECK(authorization_delegate) << "Authorization delegate missing!";
     // Decrypt just the parameter data, not the size.
-    std::string tmp = %(var_name)s_bytes.substr(2);
-    if (!authorization_delegate->DecryptResponseParameter(&tmp)) {
+    if (!authorization_delegate->DecryptResponseParameterInPlace(
+        GetTPM2BPayload(&%(var_name)s_bytes),
+        %(var_name)s_bytes.size() - 2)) {
       return TRUNKS_RC_ENCRYPTION_FAILED;
     }
-    %(var_name)s_bytes.replace(2, std::string::npos, tmp);
     rc = Parse_%(var_type)s(
         &%(var_name)s_bytes,
         %(var_name)s,
@@ -1399,9 +2441,7 @@ void %(method_name)sResponseParser(
     const Tpm::%(method_name)sResponse& callback,
     AuthorizationDelegate* authorization_delegate,
     const std::string& response) {
-  VLOG(1) << __func__;
-  base::Callback<void(TPM_RC)> error_reporter =
-      base::Bind(%(method_name)sErrorCallback, callback);"""
+  VLOG(1) << __func__;"""
   _DECLARE_ARG_VAR = """
   %(var_type)s %(var_name)s;"""
   _RESPONSE_CALLBACK_END = """
@@ -1409,7 +2449,7 @@ void %(method_name)sResponseParser(
       response,%(method_arg_names_out)s
       authorization_delegate);
   if (rc != TPM_RC_SUCCESS) {
-    error_reporter.Run(rc);
+    %(method_name)sErrorCallback(callback, rc);
     return;
   }
   callback.Run(
@@ -1419,20 +2459,18 @@ void %(method_name)sResponseParser(
   _ASYNC_METHOD = """
 void Tpm::%(method_name)s(%(method_args)s) {
   VLOG(1) << __func__;
-  base::Callback<void(TPM_RC)> error_reporter =
-      base::Bind(%(method_name)sErrorCallback, callback);
-  base::Callback<void(const std::string&)> parser =
-      base::Bind(%(method_name)sResponseParser,
-                 callback,
-                 authorization_delegate);
   std::string command;
   TPM_RC rc = SerializeCommand_%(method_name)s(%(method_arg_names)s
       &command,
       authorization_delegate);
   if (rc != TPM_RC_SUCCESS) {
-    error_reporter.Run(rc);
+    %(method_name)sErrorCallback(callback, rc);
     return;
   }
+  base::Callback<void(const std::string&)> parser =
+      base::Bind(%(method_name)sResponseParser,
+                 callback,
+                 authorization_delegate);
   transceiver_->SendCommand(command, parser);
 }
 """
@@ -1452,6 +2490,46 @@ TPM_RC Tpm::%(method_name)sSync(%(method_args)s) {
       authorization_delegate);
   return rc;
 }
+"""
+
+  _BENCHMARK_FUNCTION_START = """
+bool Benchmark_%(method_name)s() {
+  TPM_RC rc = TPM_RC_SUCCESS;"""
+  _BENCHMARK_VALUE = """
+  %(type)s %(name)s = %(value)s;"""
+  _BENCHMARK_HANDLE_NAME = """
+  std::string %(name)s(kHandleNameSize, 'n');"""
+  _BENCHMARK_SERIALIZE = """
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_%(method_name)s");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_%(method_name)s(%(method_arg_names_in)s
+        &serialized_command,
+        nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;"""
+  _BENCHMARK_SERIALIZE_RESPONSE_ARG = """
+  Serialize_%(type)s(%(value)s, &response_parameters);"""
+  _BENCHMARK_PARSE = """
+  std::string response = MakeResponse(response_parameters);%(response_vars)s
+  Benchmark parse("ParseResponse_%(method_name)s");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_%(method_name)s(
+        response,%(method_arg_names_out)s
+        nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+"""
+  _FUZZ_RESPONSE_FUNCTION_START = """
+void FuzzParseResponse_%(method_name)s(const std::string& response) {"""
+  _FUZZ_RESPONSE_FUNCTION_END = """
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_%(method_name)s(
+      response,%(method_arg_names_out)s
+      &delegate);
+}
 """
 
   def __init__(self, name):
@@ -1464,8 +2542,10 @@ TPM_RC Tpm::%(method_name)sSync(%(method_args)s) {
     """
     self.name = name
     self.command_code = ''
+    self.sessions_allowed = True
     self.request_args = None
     self.response_args = None
+    self.fixed_request_size = None
 
   def OutputDeclarations(self, out_file):
     """Prints method and callback declaration statements for this command.
@@ -1476,6 +2556,41 @@ TPM_RC Tpm::%(method_name)sSync(%(method_args)s) {
     self._OutputCallbackSignature(out_file)
     self._OutputMethodSignatures(out_file)
 
+  def OutputBuildFunction(self, out_file, typemap):
+    """Generates a fixed size command builder, if the command has one.
+
+    Args:
+      out_file: Generated code is written to this file.
+      typemap: A dict mapping type names to the corresponding object.
+    """
+    if self.fixed_request_size is None:
+      return
+    out_file.write(self._BUILD_FUNCTION_START % {
+        'method_name': self._MethodName(),
+        'method_args': self._InputArgList(self.request_args) +
+                       (',' if self.request_args else ''),
+        'command_code': self.command_code})
+    handles, parameters = self._SplitArgs(self.request_args)
+    for arg in handles + parameters:
+      out_file.write(self._BUILD_ARG % {
+          'basic_type': GetBasicType(arg['type'], typemap),
+          'name': arg['name']})
+    out_file.write(self._BUILD_FUNCTION_END)
+
+  def SetFixedRequestSize(self, typemap):
+    """Sets fixed_request_size if every request argument has a fixed size.
+
+    Args:
+      typemap: A dict mapping type names to the corresponding object.
+    """
+    size = 10  # Header size.
+    for arg in self.request_args:
+      basic_type = GetBasicType(arg['type'], typemap)
+      if basic_type not in _FIXED_SIZE_BASIC_TYPES:
+        return
+      size += _FIXED_SIZE_BASIC_TYPES[basic_type]
+    self.fixed_request_size = size
+
   def OutputSerializeFunction(self, out_file):
     """Generates a serialize function for the command inputs.
 
@@ -1484,19 +2599,25 @@ TPM_RC Tpm::%(method_name)sSync(%(method_args)s) {
     """
     # Categorize arguments as either handles or parameters.
     handles, parameters = self._SplitArgs(self.request_args)
-    response_parameters = self._SplitArgs(self.response_args)[1]
     out_file.write(self._SERIALIZE_FUNCTION_START % {
         'method_name': self._MethodName(),
-        'method_args': self._SerializeArgs()})
+        'method_args': self._SerializeArgs(),
+        'command_code': self.command_code})
+    # Commands without sessions and with a fixed size skip the general path.
+    if self.fixed_request_size is not None:
+      out_file.write(self._SERIALIZE_FIXED_SIZE % {
+          'method_name': self._MethodName(),
+          'method_arg_names': self._ArgNameList(self.request_args,
+                                                trailing_comma=True)})
+    out_file.write(self._SERIALIZE_FUNCTION_LOCALS)
     out_file.write(self._DECLARE_COMMAND_CODE % {'command_code':
                                                  self.command_code})
     out_file.write(self._DECLARE_BOOLEAN % {
         'var_name': 'is_command_parameter_encryption_possible',
-        'value': GetCppBool(parameters and IsTPM2B(parameters[0]['type']))})
+        'value': GetCppBool(self.IsCommandParameterEncrypted())})
     out_file.write(self._DECLARE_BOOLEAN % {
         'var_name': 'is_response_parameter_encryption_possible',
-        'value': GetCppBool(response_parameters and
-                            IsTPM2B(response_parameters[0]['type']))})
+        'value': GetCppBool(self.IsResponseParameterEncrypted())})
     # Serialize the command code and all the handles and parameters.
     out_file.write(self._SERIALIZE_LOCAL_VAR % {'var_name': 'command_code',
                                                 'var_type': 'TPM_CC'})
@@ -1504,23 +2625,22 @@ TPM_RC Tpm::%(method_name)sSync(%(method_args)s) {
       out_file.write(self._SERIALIZE_LOCAL_VAR % {'var_name': arg['name'],
                                                   'var_type': arg['type']})
     # Encrypt the first parameter (before doing authorization) if necessary.
-    if parameters and IsTPM2B(parameters[0]['type']):
+    if self.IsCommandParameterEncrypted():
       out_file.write(self._ENCRYPT_PARAMETER % {'var_name':
                                                 parameters[0]['name']})
-    # Compute the command hash and construct handle and parameter sections.
+    # Compute the size of the handle and parameter sections.
+    for arg in handles + parameters:
+      out_file.write(self._ADD_COMMAND_SIZE % {'var_name': arg['name']})
+    # Do authorization based on the command hash, if the delegate uses it.
+    out_file.write(self._AUTHORIZE_COMMAND_START)
     out_file.write(self._HASH_START)
     out_file.write(self._HASH_UPDATE % {'var_name': 'command_code_bytes'})
     for handle in handles:
       out_file.write(self._HASH_UPDATE % {'var_name':
                                           '%s_name' % handle['name']})
-      out_file.write(self._APPEND_COMMAND_HANDLE % {'var_name':
-                                                    handle['name']})
     for parameter in parameters:
       out_file.write(self._HASH_UPDATE % {'var_name':
                                           '%s_bytes' % parameter['name']})
-      out_file.write(self._APPEND_COMMAND_PARAMETER % {'var_name':
-                                                       parameter['name']})
-    # Do authorization based on the hash.
     out_file.write(self._AUTHORIZE_COMMAND)
     # Now that the tag and size are finalized, serialize those.
     out_file.write(self._SERIALIZE_LOCAL_VAR %
@@ -1528,6 +2648,14 @@ TPM_RC Tpm::%(method_name)sSync(%(method_args)s) {
                     'var_type': 'TPMI_ST_COMMAND_TAG'})
     out_file.write(self._SERIALIZE_LOCAL_VAR % {'var_name': 'command_size',
                                                 'var_type': 'UINT32'})
+    # The final size is known so the command is assembled in a single buffer.
+    out_file.write(self._SERIALIZE_COMMAND_START)
+    sections = ['tag_bytes', 'command_size_bytes', 'command_code_bytes']
+    sections += ['%s_bytes' % handle['name'] for handle in handles]
+    sections += ['authorization_size_bytes', 'authorization_section_bytes']
+    sections += ['%s_bytes' % parameter['name'] for parameter in parameters]
+    for section in sections:
+      out_file.write(self._APPEND_COMMAND_BYTES % {'var_name': section})
     out_file.write(self._SERIALIZE_FUNCTION_END)
 
   def OutputParseFunction(self, out_file):
@@ -1538,7 +2666,8 @@ TPM_RC Tpm::%(method_name)sSync(%(method_args)s) {
     """
     out_file.write(self._RESPONSE_PARSER_START % {
         'method_name': self._MethodName(),
-        'method_args': self._ParseArgs()})
+        'method_args': self._ParseArgs(),
+        'command_code': self.command_code})
     # Parse the header -- this should always exist.
     out_file.write(self._PARSE_LOCAL_VAR % {'var_name': 'tag',
                                             'var_type': 'TPM_ST'})
@@ -1561,24 +2690,123 @@ TPM_RC Tpm::%(method_name)sSync(%(method_args)s) {
                                                 'var_type': 'TPM_CC'})
     # Split out the authorization section.
     out_file.write(self._RESPONSE_SECTION_SPLIT)
-    # Compute the response hash.
+    # Check the authorization based on the response hash, if the delegate uses
+    # it.
+    out_file.write(self._AUTHORIZE_RESPONSE_START)
     out_file.write(self._HASH_START)
     out_file.write(self._HASH_UPDATE % {'var_name': 'response_code_bytes'})
     out_file.write(self._HASH_UPDATE % {'var_name': 'command_code_bytes'})
     out_file.write(self._HASH_UPDATE % {'var_name': 'buffer'})
-    # Do authorization related stuff.
     out_file.write(self._AUTHORIZE_RESPONSE)
     # Parse response parameters.
     for arg in parameters:
       out_file.write(self._PARSE_ARG_VAR % {'var_name': arg['name'],
                                             'var_type': arg['type']})
-    if parameters and IsTPM2B(parameters[0]['type']):
+    if self.IsResponseParameterEncrypted():
       out_file.write(self._DECRYPT_PARAMETER % {'var_name':
                                                 parameters[0]['name'],
                                                 'var_type':
                                                 parameters[0]['type']})
     out_file.write(self._RESPONSE_PARSER_END)
 
+  def OutputBenchmark(self, out_file, typemap):
+    """Generates a benchmark for the serialize and parse functions.
+
+    Args:
+      out_file: Generated code is written to this file.
+      typemap: A dict mapping type names to the corresponding object.
+    """
+    out_file.write(self._BENCHMARK_FUNCTION_START % {
+        'method_name': self._MethodName()})
+    for arg in self._RequestArgs():
+      if arg['type'] == 'std::string':
+        out_file.write(self._BENCHMARK_HANDLE_NAME % {'name': arg['name']})
+      else:
+        out_file.write(self._BENCHMARK_VALUE % {
+            'type': arg['type'],
+            'name': arg['name'],
+            'value': GetBenchmarkValue(arg['type'], typemap)})
+    out_file.write(self._BENCHMARK_SERIALIZE % {
+        'method_name': self._MethodName(),
+        'method_arg_names_in': self._ArgNameList(self._RequestArgs(),
+                                                 trailing_comma=True)})
+    for arg in self.response_args:
+      out_file.write(self._BENCHMARK_SERIALIZE_RESPONSE_ARG % {
+          'type': arg['type'],
+          'value': GetBenchmarkValue(arg['type'], typemap)})
+    response_vars = ''.join([self._DECLARE_ARG_VAR % {'var_type': arg['type'],
+                                                      'var_name': arg['name']}
+                             for arg in self.response_args])
+    out_file.write(self._BENCHMARK_PARSE % {
+        'method_name': self._MethodName(),
+        'response_vars': response_vars,
+        'method_arg_names_out': self._ArgNameList(self.response_args,
+                                                  prefix='&',
+                                                  trailing_comma=True)})
+
+  def OutputFuzzTarget(self, out_file):
+    """Generates a fuzz target for the response parse function.
+
+    A password delegate is used so responses with sessions are parsed through
+    to the authorization section.
+
+    Args:
+      out_file: Generated code is written to this file.
+    """
+    out_file.write(self._FUZZ_RESPONSE_FUNCTION_START % {
+        'method_name': self._MethodName()})
+    for arg in self.response_args:
+      out_file.write(self._DECLARE_ARG_VAR % {'var_type': arg['type'],
+                                              'var_name': arg['name']})
+    out_file.write(self._FUZZ_RESPONSE_FUNCTION_END % {
+        'method_name': self._MethodName(),
+        'method_arg_names_out': self._ArgNameList(self.response_args,
+                                                  prefix='&',
+                                                  trailing_comma=True)})
+
+  def OutputCompactDeclarations(self, out_file, compact_types):
+    """Prints a compact response-parse declaration if this command has one.
+
+    Args:
+      out_file: The output file.
+      compact_types: A set of the types which have compact variants.
+    """
+    compact = self._GetCompactCommand(compact_types)
+    if compact:
+      out_file.write('  static TPM_RC ParseResponse_%s(%s);\n' % (
+          compact._MethodName(), compact._ParseArgs()))
+
+  def OutputCompactParseFunction(self, out_file, compact_types):
+    """Generates a parse function for compact variants of the command outputs.
+
+    This is only generated for commands with an output which has a compact
+    variant.
+
+    Args:
+      out_file: Generated code is written to this file.
+      compact_types: A set of the types which have compact variants.
+    """
+    compact = self._GetCompactCommand(compact_types)
+    if compact:
+      compact.OutputParseFunction(out_file)
+
+  def _GetCompactCommand(self, compact_types):
+    """Returns a copy of this command with compact response types, or None.
+
+    Args:
+      compact_types: A set of the types which have compact variants.
+    """
+    if not [arg for arg in self.response_args if arg['type'] in compact_types]:
+      return None
+    compact = copy.copy(self)
+    compact.response_args = []
+    for arg in self.response_args:
+      compact_arg = dict(arg)
+      if arg['type'] in compact_types:
+        compact_arg['type'] = arg['type'] + '_COMPACT'
+      compact.response_args.append(compact_arg)
+    return compact
+
   def OutputMethodImplementation(self, out_file):
     """Generates the implementation of a Tpm class method for this command.
 
@@ -1649,6 +2877,34 @@ TPM_RC Tpm::%(method_name)sSync(%(method_args)s) {
     """Returns the number of output handles for this command."""
     return len(self._SplitArgs(self.response_args)[0])
 
+  def IsCommandParameterEncryptionPossible(self):
+    """Returns True if the first command parameter may be encrypted."""
+    parameters = self._SplitArgs(self.request_args)[1]
+    return bool(parameters and IsTPM2B(parameters[0]['type']))
+
+  def IsResponseParameterEncryptionPossible(self):
+    """Returns True if the first response parameter may be encrypted."""
+    parameters = self._SplitArgs(self.response_args)[1]
+    return bool(parameters and IsTPM2B(parameters[0]['type']))
+
+  def IsCommandParameterEncrypted(self):
+    """Returns True if sessions encrypt the first command parameter."""
+    return (self.IsCommandParameterEncryptionPossible() and
+            self.command_code not in _NON_SECRET_COMMAND_PARAMETERS)
+
+  def IsResponseParameterEncrypted(self):
+    """Returns True if sessions encrypt the first response parameter."""
+    return (self.IsResponseParameterEncryptionPossible() and
+            self.command_code not in _NON_SECRET_RESPONSE_PARAMETERS)
+
+  def GetLatencyClass(self):
+    """Returns the TpmLatencyClass constant name for this command."""
+    if self.command_code in _SHORT_LATENCY_COMMANDS:
+      return 'kTpmLatencyShort'
+    if self.command_code in _LONG_LATENCY_COMMANDS:
+      return 'kTpmLatencyLong'
+    return 'kTpmLatencyNormal'
+
   def _OutputMethodSignatures(self, out_file):
     """Prints method declaration statements for this command.
 
@@ -1660,6 +2916,12 @@ TPM_RC Tpm::%(method_name)sSync(%(method_args)s) {
     """
     out_file.write('  static TPM_RC SerializeCommand_%s(%s);\n' % (
         self._MethodName(), self._SerializeArgs()))
+    if self.fixed_request_size is not None:
+      out_file.write(self._FIXED_SIZE_DECLARATIONS % {
+          'method_name': self._MethodName(),
+          'size': self.fixed_request_size,
+          'method_args': self._InputArgList(self.request_args) +
+                         (',' if self.request_args else '')})
     out_file.write('  static TPM_RC ParseResponse_%s(%s);\n' % (
         self._MethodName(), self._ParseArgs()))
     out_file.write('  virtual void %s(%s);\n' % (self._MethodName(),
@@ -1839,6 +3101,7 @@ class CommandParser(object):
   # Pull the command code from a comment like: _COMMENT TPM_CC_Startup {NV}.
   _COMMENT_CC_RE = re.compile(r'^_COMMENT\s+(TPM_CC_\w+).*$')
   _COMMENT_RE = re.compile(r'^_COMMENT\s+(.*)')
+  _COMMENT_NO_SESSIONS_RE = re.compile(r'^_COMMENT\s+TPM_ST_NO_SESSIONS')
   # Args which are handled internally by the generated method.
   _INTERNAL_ARGS = ('tag', 'Tag', 'commandSize', 'commandCode', 'responseSize',
                     'responseCode', 'returnCode')
@@ -1919,7 +3182,8 @@ class CommandParser(object):
 
     Args:
       cmd: The current Command object. The command_code attribute will be set if
-          such a constant is parsed.
+          such a constant is parsed and sessions_allowed will be cleared if the
+          tag must be TPM_ST_NO_SESSIONS.
 
     Returns:
       A list of arguments in the same form as the Command.request_args and
@@ -1939,6 +3203,8 @@ class CommandParser(object):
       match = self._COMMENT_CC_RE.search(self._line)
       if match:
         cmd.command_code = match.group(1)
+      if arg_name == 'tag' and self._COMMENT_NO_SESSIONS_RE.search(self._line):
+        cmd.sessions_allowed = False
       match = self._COMMENT_RE.search(self._line)
       if match:
         self._NextLine()
@@ -1949,25 +3215,113 @@ class CommandParser(object):
     return args
 
 
-def GenerateHandleCountFunctions(commands, out_file):
-  """Generates the GetNumberOf*Handles functions given a list of commands.
+def GetBasicType(type_name, typemap):
+  """Returns the basic type a typedef resolves to, or None for other types.
 
   Args:
+    type_name: The type to resolve.
+    typemap: A dict mapping type names to the corresponding object.
+  """
+  while type_name not in _BASIC_TYPES:
+    typedef = typemap.get(type_name)
+    if not isinstance(typedef, Typedef):
+      return None
+    type_name = typedef.old_type
+  return type_name
+
+
+def GetStructureType(type_name, typemap):
+  """Returns the structure or union a typedef resolves to.
+
+  Args:
+    type_name: The type to resolve.
+    typemap: A dict mapping type names to the corresponding object.
+  """
+  while isinstance(typemap[type_name], Typedef):
+    type_name = typemap[type_name].old_type
+  return type_name
+
+
+def GetBenchmarkValue(type_name, typemap):
+  """Returns an expression for a benchmark argument of the given type.
+
+  Simple TPM2B structures are filled to their capacity and other types are
+  value-initialized.
+
+  Args:
+    type_name: The argument type.
+    typemap: A dict mapping type names to the corresponding object.
+  """
+  struct = typemap.get(type_name)
+  if isinstance(struct, Structure) and struct.IsSimpleTPM2B():
+    return 'Make_%s(std::string(sizeof(%s::%s), \'a\'))' % (
+        type_name, type_name, struct.GetBufferName())
+  return '%s()' % type_name
+
+
+def GetCompactTypes(typemap):
+  """Returns the names of the structures which get a compact variant.
+
+  These are the _COMPACT_ROOTS, every list they contain and every structure on
+  the way to such a list.
+
+  Args:
+    typemap: A dict mapping type names to the corresponding object.
+  """
+  compact_types = set()
+
+  def _ContainsList(type_name):
+    struct = typemap.get(type_name)
+    if not isinstance(struct, Structure):
+      return False
+    contains_list = struct.IsList()
+    if not contains_list:
+      for field_type in struct._GetFieldTypes():
+        contains_list = _ContainsList(field_type) or contains_list
+    if contains_list:
+      compact_types.add(type_name)
+    return contains_list
+
+  for root in _COMPACT_ROOTS:
+    _ContainsList(root)
+  return compact_types
+
+
+def GenerateCommandMetadata(constants, commands, out_file):
+  """Generates the command metadata table and its lookup functions.
+
+  Args:
+    constants: A list of Constant objects used to find command code values.
     commands: A list of Command objects.
     out_file: The output file.
   """
-  out_file.write(_HANDLE_COUNT_FUNCTION_START % {'handle_type': 'Request'})
-  for command in commands:
-    out_file.write(_HANDLE_COUNT_FUNCTION_CASE %
-                   {'command_code': command.command_code,
-                    'handle_count': command.GetNumberOfRequestHandles()})
-  out_file.write(_HANDLE_COUNT_FUNCTION_END)
-  out_file.write(_HANDLE_COUNT_FUNCTION_START % {'handle_type': 'Response'})
-  for command in commands:
-    out_file.write(_HANDLE_COUNT_FUNCTION_CASE %
-                   {'command_code': command.command_code,
-                    'handle_count': command.GetNumberOfResponseHandles()})
-  out_file.write(_HANDLE_COUNT_FUNCTION_END)
+  values = dict([(constant.name, int(constant.value, 16))
+                 for constant in constants
+                 if constant.name.startswith('TPM_CC_')])
+  commands_by_value = dict([(values[command.command_code], command)
+                            for command in commands])
+  out_file.write(_COMMAND_METADATA_START)
+  for value in range(values['TPM_CC_FIRST'], values['TPM_CC_LAST'] + 1):
+    command = commands_by_value.get(value)
+    if not command:
+      out_file.write(_COMMAND_METADATA_UNASSIGNED)
+      continue
+    out_file.write(_COMMAND_METADATA_ENTRY % {
+        'command_code': command.command_code,
+        'request_handles': command.GetNumberOfRequestHandles(),
+        'response_handles': command.GetNumberOfResponseHandles(),
+        'sessions_allowed': GetCppBool(command.sessions_allowed),
+        'command_parameter_encryption': GetCppBool(
+            command.IsCommandParameterEncrypted()),
+        'response_parameter_encryption': GetCppBool(
+            command.IsResponseParameterEncrypted()),
+        'read_only': GetCppBool(command.command_code in _READ_ONLY_COMMANDS),
+        'latency_class': command.GetLatencyClass()})
+  out_file.write(_COMMAND_METADATA_END)
+  out_file.write(_HANDLE_COUNT_FUNCTION % {'handle_type': 'Request',
+                                           'field': 'request_handles'})
+  out_file.write(_HANDLE_COUNT_FUNCTION % {'handle_type': 'Response',
+                                           'field': 'response_handles'})
 
 
 def GenerateHeader(types, constants, structs, defines, typemap, commands):
@@ -2013,55 +3367,93 @@ def GenerateHeader(types, constants, structs, defines, typemap, commands):
     struct.Output(out_file, defined_types, typemap)
   # Helper function declarations.
   out_file.write(_FUNCTION_DECLARATIONS)
+  # Generate inline primitive serialize / parse functions.
+  out_file.write(_INLINE_FUNCTIONS_COMMENT)
+  for basic_type in _BASIC_TYPES:
+    out_file.write(_INLINE_BASIC_TYPE % {'type': basic_type})
+  for typedef in types:
+    if typedef.IsInline():
+      out_file.write(_INLINE_TYPEDEF % {'old': typedef.old_type,
+                                        'new': typedef.new_type})
   # Generate serialize / parse function declarations.
   for basic_type in _BASIC_TYPES:
-    out_file.write(_SERIALIZE_DECLARATION % {'type': basic_type})
+    out_file.write(_PARSE_STRING_DECLARATION % {'type': basic_type})
   for typedef in types:
-    out_file.write(_SERIALIZE_DECLARATION % {'type': typedef.new_type})
+    if typedef.IsInline():
+      out_file.write(_PARSE_STRING_DECLARATION % {'type': typedef.new_type})
+    else:
+      out_file.write(_SERIALIZE_DECLARATION % {'type': typedef.new_type})
   for struct in structs:
     out_file.write(_SERIALIZE_DECLARATION % {'type': struct.name})
     if struct.IsSimpleTPM2B():
-      out_file.write(_SIMPLE_TPM2B_HELPERS_DECLARATION % {'type': struct.name})
+      out_file.write(_SIMPLE_TPM2B_HELPERS_DECLARATION % {
+          'type': struct.name,
+          'buffer_name': struct.GetBufferName()})
     elif struct.IsComplexTPM2B():
       out_file.write(_COMPLEX_TPM2B_HELPERS_DECLARATION % {
           'type': struct.name,
           'inner_type': struct.fields[1][0]})
+  # Generate compact variants of large structures.
+  compact_types = GetCompactTypes(typemap)
+  compact_structs = [struct for struct in structs
+                     if struct.name in compact_types]
+  out_file.write(_COMPACT_STRUCTURES_COMMENT)
+  defined_compact_types = set()
+  for struct in compact_structs:
+    struct.OutputCompact(out_file, defined_compact_types, compact_types,
+                         typemap)
+  for struct in compact_structs:
+    struct.OutputCompactDeclarations(out_file)
   # Generate a declaration for a 'Tpm' class, which includes one method for
   # every TPM 2.0 command.
   out_file.write(_CLASS_BEGIN)
   for command in commands:
     command.OutputDeclarations(out_file)
+    command.OutputCompactDeclarations(out_file, compact_types)
   out_file.write(_CLASS_END)
   out_file.write(_NAMESPACE_END)
   out_file.write(_HEADER_FILE_GUARD_FOOTER % {'name': guard_name})
   out_file.close()
 
 
-def GenerateImplementation(types, structs, typemap, commands):
+def GenerateImplementation(types, constants, structs, typemap, commands,
+                           table_driven):
   """Generates implementation code for each command.
 
   Args:
     types: A list of Typedef objects.
+    constants: A list of Constant objects.
     structs: A list of Structure objects.
     typemap: A dict mapping type names to the corresponding object.
     commands: A list of Command objects.
+    table_driven: Whether structures are marshalled from MarshalDescriptor
+      tables rather than by unrolled functions.
   """
   out_file = open(_OUTPUT_FILE_CC, 'w')
   out_file.write(_COPYRIGHT_HEADER)
   out_file.write(_LOCAL_INCLUDE % {'filename': _OUTPUT_FILE_H})
-  out_file.write(_IMPLEMENTATION_FILE_INCLUDES)
+  out_file.write(_IMPLEMENTATION_FILE_INCLUDES % {
+      'marshal_include': _MARSHAL_INCLUDE if table_driven else ''})
   out_file.write(_NAMESPACE_BEGIN)
-  GenerateHandleCountFunctions(commands, out_file)
+  out_file.write(_PARSE_HELPERS)
+  GenerateCommandMetadata(constants, commands, out_file)
   serialized_types = set(_BASIC_TYPES)
   for basic_type in _BASIC_TYPES:
-    out_file.write(_SERIALIZE_BASIC_TYPE % {'type': basic_type})
+    out_file.write(_PARSE_STRING_FUNCTION % {'type': basic_type})
   for typedef in types:
-    typedef.OutputSerialize(out_file, serialized_types, typemap)
+    typedef.OutputSerialize(out_file, serialized_types, typemap, table_driven)
   for struct in structs:
-    struct.OutputSerialize(out_file, serialized_types, typemap)
+    struct.OutputSerialize(out_file, serialized_types, typemap, table_driven)
+  compact_types = GetCompactTypes(typemap)
+  for struct in structs:
+    if struct.name in compact_types:
+      struct.OutputCompactSerialize(out_file, compact_types)
+  out_file.write(_SEND_COMMAND_BATCH_FUNCTION)
   for command in commands:
+    command.OutputBuildFunction(out_file, typemap)
     command.OutputSerializeFunction(out_file)
     command.OutputParseFunction(out_file)
+    command.OutputCompactParseFunction(out_file, compact_types)
     command.OutputErrorCallback(out_file)
     command.OutputResponseCallback(out_file)
     command.OutputMethodImplementation(out_file)
@@ -2069,6 +3461,61 @@ def GenerateImplementation(types, structs, typemap, commands):
   out_file.close()
 
 
+def GenerateBenchmark(typemap, commands):
+  """Generates a benchmark for the serialize and parse functions of commands.
+
+  Args:
+    typemap: A dict mapping type names to the corresponding object.
+    commands: A list of Command objects.
+  """
+  out_file = open(_OUTPUT_FILE_BENCHMARK, 'w')
+  out_file.write(_COPYRIGHT_HEADER)
+  out_file.write(_BENCHMARK_FILE_INCLUDES)
+  out_file.write(_BENCHMARK_FILE_START)
+  for command in commands:
+    command.OutputBenchmark(out_file, typemap)
+  out_file.write(_BENCHMARK_TABLE_TYPEDEF)
+  out_file.write(_BENCHMARK_TABLE_START)
+  for command in commands:
+    out_file.write('\n    &Benchmark_%s,' % command._MethodName())
+  out_file.write(_TABLE_END)
+  out_file.write(_BENCHMARK_FILE_END)
+  out_file.close()
+
+
+def GenerateFuzzer(types, structs, typemap, commands):
+  """Generates a fuzz target for every parse function.
+
+  Unions are only parsed as part of the structures which hold their selector.
+
+  Args:
+    types: A list of Typedef objects.
+    structs: A list of Structure objects.
+    typemap: A dict mapping type names to the corresponding object.
+    commands: A list of Command objects.
+  """
+  out_file = open(_OUTPUT_FILE_FUZZER, 'w')
+  out_file.write(_COPYRIGHT_HEADER)
+  out_file.write(_FUZZER_FILE_INCLUDES)
+  out_file.write(_FUZZER_FILE_START)
+  for command in commands:
+    command.OutputFuzzTarget(out_file)
+  parse_types = list(_BASIC_TYPES) + [typedef.new_type for typedef in types]
+  parse_types += [struct.name for struct in structs if not struct.is_union]
+  compact_types = GetCompactTypes(typemap)
+  parse_types += [struct.name + '_COMPACT' for struct in structs
+                  if struct.name in compact_types and not struct.is_union]
+  out_file.write(_FUZZER_TABLE_START)
+  for parse_type in parse_types:
+    out_file.write(_FUZZER_TABLE_PARSE % {'type': parse_type})
+  for command in commands:
+    out_file.write(_FUZZER_TABLE_RESPONSE % {
+        'method_name': command._MethodName()})
+  out_file.write(_TABLE_END)
+  out_file.write(_FUZZER_FILE_END)
+  out_file.close()
+
+
 def FormatFile(filename):
     subprocess.call(['clang-format', '-i', '-style=file', filename])
 
@@ -2082,19 +3529,33 @@ def main():
   Positional Args:
     structures_file: The extracted TPM structures file.
     commands_file: The extracted TPM commands file.
+
+  Optional Args:
+    --table_driven: Describe structures with constant tables marshalled by
+      tpm_marshal.cc instead of unrolling their serialize and parse functions.
+      This trades some marshalling speed for much smaller code.
   """
   parser = argparse.ArgumentParser(description='TPM 2.0 code generator')
   parser.add_argument('structures_file')
   parser.add_argument('commands_file')
+  parser.add_argument('--table_driven', action='store_true',
+                      help='Marshal structures from descriptor tables.')
   args = parser.parse_args()
   structure_parser = StructureParser(open(args.structures_file))
   types, constants, structs, defines, typemap = structure_parser.Parse()
   command_parser = CommandParser(open(args.commands_file))
   commands = command_parser.Parse()
+  for command in commands:
+    command.SetFixedRequestSize(typemap)
   GenerateHeader(types, constants, structs, defines, typemap, commands)
-  GenerateImplementation(types, structs, typemap, commands)
+  GenerateImplementation(types, constants, structs, typemap, commands,
+                         args.table_driven)
+  GenerateBenchmark(typemap, commands)
+  GenerateFuzzer(types, structs, typemap, commands)
   FormatFile(_OUTPUT_FILE_H)
   FormatFile(_OUTPUT_FILE_CC)
+  FormatFile(_OUTPUT_FILE_BENCHMARK)
+  FormatFile(_OUTPUT_FILE_FUZZER)
   print('Processed %d commands.' % len(commands))
 
 
@@ -119,6 +119,39 @@ class TestGenerators(unittest.TestCase):
     self.assertIn('TEST_STRUCT', serialized_types)
     out_file.close()
 
+  def testTableDrivenStructSerialize(self):
+    """Test generation of marshalling tables for structures and unions."""
+    serialized_types = set(['uint8_t', 'uint16_t', 'BYTE', 'FOO', 'BAR',
+                            'TPMI_ALG_SYM_OBJECT'])
+    struct = generator.Structure('TEST_STRUCT', False)
+    struct.fields = [('TPMI_ALG_SYM_OBJECT', 'selector'),
+                     ('TPMU_SYM_MODE', 'mode'),
+                     ('uint8_t', 'sizeOfFoo'),
+                     ('BYTE', 'foo[FOO_MAX]')]
+    union = generator.Structure('TPMU_SYM_MODE', True)
+    union.fields = [('FOO', 'aes'), ('BAR', 'sm4')]
+    typemap = {'TPMU_SYM_MODE': union,
+               'TPMI_ALG_SYM_OBJECT': generator.Typedef('uint16_t',
+                                                        'TPMI_ALG_SYM_OBJECT'),
+               'FOO': generator.Typedef('uint16_t', 'FOO'),
+               'BAR': generator.Typedef('uint16_t', 'BAR')}
+    out_file = StringIO.StringIO()
+    struct.OutputSerialize(out_file, serialized_types, typemap,
+                           table_driven=True)
+    output = out_file.getvalue()
+    self.assertIn('kSelectors_TPMU_SYM_MODE[]', output)
+    self.assertRegexpMatches(output, r'kInteger, 2, -1,\s+'
+                             r'offsetof\(TPMU_SYM_MODE, aes\)')
+    self.assertRegexpMatches(output, r'kUnion, 0, 0,\s+'
+                             r'offsetof\(TEST_STRUCT, mode\).*'
+                             r'&kDescriptor_TPMU_SYM_MODE')
+    self.assertRegexpMatches(output, r'kByteArray, 0, 2,\s+'
+                             r'offsetof\(TEST_STRUCT, foo\), 0, FOO_MAX')
+    self.assertIn('SerializeWithDescriptor(kDescriptor_TEST_STRUCT', output)
+    self.assertNotIn('Serialize_UINT8', output)
+    self.assertIn('TEST_STRUCT', serialized_types)
+    out_file.close()
+
   def testDefine(self):
     """Test generation of preprocessor defines."""
     define = generator.Define('name', 'value')
@@ -227,6 +260,18 @@ class TestParsers(unittest.TestCase):
     self.assertEqual(defines[0].name, 'define_name')
     self.assertEqual(defines[0].value, 'define_value')
 
+  def testCommandParserNoSessions(self):
+    """Test that a TPM_ST_NO_SESSIONS tag is recorded."""
+    input_data = self.FAKE_COMMAND.replace(
+        '_TYPE UINT32\n_NAME commandSize\n',
+        '_TYPE TPMI_ST_COMMAND_TAG\n_NAME tag\n_COMMENT TPM_ST_NO_SESSIONS\n'
+        '_TYPE UINT32\n_NAME commandSize\n', 1)
+    parser = generator.CommandParser(StringIO.StringIO(input_data))
+    commands = parser.Parse()
+    self.assertEqual(len(commands), 1)
+    self.assertFalse(commands[0].sessions_allowed)
+    self.assertEqual(commands[0].request_args[0]['name'], 'input')
+
   def testCommandParserWithBadData(self):
     """Test the command parser with invalid data."""
     input_data = 'bad_data'
@@ -244,6 +289,7 @@ class TestParsers(unittest.TestCase):
     self.assertEqual(len(commands), 1)
     self.assertEqual(commands[0].name, 'TPM2_Test')
     self.assertEqual(commands[0].command_code, 'TPM_CC_Test')
+    self.assertTrue(commands[0].sessions_allowed)
     # We expect the 'commandSize' and 'commandCode' args to be filtered out.
     self.assertEqual(len(commands[0].request_args), 1)
     self.assertEqual(commands[0].request_args[0]['type'], 'UINT16')
@@ -18,10 +18,12 @@
 
 #include <base/logging.h>
 #include <base/stl_util.h>
-#include <crypto/secure_util.h>
 #include <openssl/aes.h>
+#include <openssl/crypto.h>
 #include <openssl/hmac.h>
-#include <openssl/rand.h>
+
+#include "trunks/allocation_profile.h"
+#include "trunks/nonce_pool.h"
 
 namespace trunks {
 
@@ -33,7 +35,6 @@ const uint16_t kNonceMaxSize = 32;
 const uint8_t kDecryptSession = 1 << 5;
 const uint8_t kEncryptSession = 1 << 6;
 const uint8_t kLabelSize = 4;
-const size_t kAesIVSize = 16;
 const uint32_t kTpmBufferSize = 4096;
 
 }  // namespace
@@ -43,18 +44,28 @@ HmacAuthorizationDelegate::HmacAuthorizationDelegate()
       is_parameter_encryption_enabled_(false),
       nonce_generated_(false),
       future_authorization_value_set_(false),
-      use_entity_authorization_for_encryption_only_(false) {
+      use_entity_authorization_for_encryption_only_(false),
+      aes_key_valid_(false) {
   tpm_nonce_.size = 0;
   caller_nonce_.size = 0;
+#if !defined(OPENSSL_IS_BORINGSSL)
+  EVP_CIPHER_CTX_init(&aes_context_);
+#endif
 }
 
-HmacAuthorizationDelegate::~HmacAuthorizationDelegate() {}
+HmacAuthorizationDelegate::~HmacAuthorizationDelegate() {
+#if !defined(OPENSSL_IS_BORINGSSL)
+  EVP_CIPHER_CTX_cleanup(&aes_context_);
+#endif
+  OPENSSL_cleanse(aes_iv_, sizeof(aes_iv_));
+}
 
 bool HmacAuthorizationDelegate::GetCommandAuthorization(
     const std::string& command_hash,
     bool is_command_parameter_encryption_possible,
     bool is_response_parameter_encryption_possible,
     std::string* authorization) {
+  ScopedAllocationTag allocation_tag(kAllocationLayerAuthorization);
   if (!session_handle_) {
     authorization->clear();
     LOG(ERROR) << "Delegate being used before Initialization,";
@@ -82,20 +93,8 @@ bool HmacAuthorizationDelegate::GetCommandAuthorization(
            TPM_RC_SUCCESS)
       << "Error serializing session attributes.";
 
-  std::string hmac_data;
-  std::string hmac_key;
-  if (!use_entity_authorization_for_encryption_only_) {
-    hmac_key = session_key_ + entity_authorization_value_;
-  } else {
-    hmac_key = session_key_;
-  }
-  hmac_data.append(command_hash);
-  hmac_data.append(reinterpret_cast<const char*>(caller_nonce_.buffer),
-                   caller_nonce_.size);
-  hmac_data.append(reinterpret_cast<const char*>(tpm_nonce_.buffer),
-                   tpm_nonce_.size);
-  hmac_data.append(attributes_bytes);
-  std::string digest = HmacSha256(hmac_key, hmac_data);
+  std::string digest = GetAuthorizationHmac()->Compute(
+      command_hash, caller_nonce_, tpm_nonce_, attributes_bytes);
   auth.hmac = Make_TPM2B_DIGEST(digest);
 
   TPM_RC serialize_error = Serialize_TPMS_AUTH_COMMAND(auth, authorization);
@@ -109,6 +108,7 @@ bool HmacAuthorizationDelegate::GetCommandAuthorization(
 bool HmacAuthorizationDelegate::CheckResponseAuthorization(
     const std::string& response_hash,
     const std::string& authorization) {
+  ScopedAllocationTag allocation_tag(kAllocationLayerAuthorization);
   if (!session_handle_) {
     return false;
   }
@@ -137,30 +137,23 @@ bool HmacAuthorizationDelegate::CheckResponseAuthorization(
            TPM_RC_SUCCESS)
       << "Error serializing session attributes.";
 
-  std::string hmac_data;
-  std::string hmac_key;
-  if (!use_entity_authorization_for_encryption_only_) {
+  std::string digest;
+  if (!use_entity_authorization_for_encryption_only_ &&
+      future_authorization_value_set_) {
     // In a special case with TPM2_HierarchyChangeAuth, we need to use the
     // auth_value that was set.
-    if (future_authorization_value_set_) {
-      hmac_key = session_key_ + future_authorization_value_;
-      future_authorization_value_set_ = false;
-    } else {
-      hmac_key = session_key_ + entity_authorization_value_;
-    }
+    PrecomputedHmac future_hmac;
+    future_hmac.SetKey(GetHmacKey(future_authorization_value_));
+    hmac_key_.clear();
+    future_authorization_value_set_ = false;
+    digest = future_hmac.Compute(response_hash, tpm_nonce_, caller_nonce_,
+                                 attributes_bytes);
   } else {
-    hmac_key = session_key_;
+    digest = GetAuthorizationHmac()->Compute(response_hash, tpm_nonce_,
+                                             caller_nonce_, attributes_bytes);
   }
-  hmac_data.append(response_hash);
-  hmac_data.append(reinterpret_cast<const char*>(tpm_nonce_.buffer),
-                   tpm_nonce_.size);
-  hmac_data.append(reinterpret_cast<const char*>(caller_nonce_.buffer),
-                   caller_nonce_.size);
-  hmac_data.append(attributes_bytes);
-  std::string digest = HmacSha256(hmac_key, hmac_data);
   CHECK_EQ(digest.size(), auth_response.hmac.size);
-  if (!crypto::SecureMemEqual(digest.data(), auth_response.hmac.buffer,
-                              digest.size())) {
+  if (!SecureEqual_TPM2B_DIGEST(auth_response.hmac, digest)) {
     LOG(ERROR) << "Authorization response hash did not match expected value.";
     return false;
   }
@@ -170,6 +163,22 @@ bool HmacAuthorizationDelegate::CheckResponseAuthorization(
 bool HmacAuthorizationDelegate::EncryptCommandParameter(
     std::string* parameter) {
   CHECK(parameter);
+  return EncryptCommandParameterInPlace(
+      reinterpret_cast<uint8_t*>(base::string_as_array(parameter)),
+      parameter->size());
+}
+
+bool HmacAuthorizationDelegate::DecryptResponseParameter(
+    std::string* parameter) {
+  CHECK(parameter);
+  return DecryptResponseParameterInPlace(
+      reinterpret_cast<uint8_t*>(base::string_as_array(parameter)),
+      parameter->size());
+}
+
+bool HmacAuthorizationDelegate::EncryptCommandParameterInPlace(uint8_t* data,
+                                                               size_t size) {
+  ScopedAllocationTag allocation_tag(kAllocationLayerAuthorization);
   if (!session_handle_) {
     LOG(ERROR) << __func__ << ": Invalid session handle.";
     return false;
@@ -178,19 +187,19 @@ bool HmacAuthorizationDelegate::EncryptCommandParameter(
     // No parameter encryption enabled.
     return true;
   }
-  if (parameter->size() > kTpmBufferSize) {
+  if (size > kTpmBufferSize) {
     LOG(ERROR) << "Parameter size is too large for TPM decryption.";
     return false;
   }
   RegenerateCallerNonce();
   nonce_generated_ = true;
-  AesOperation(parameter, caller_nonce_, tpm_nonce_, AES_ENCRYPT);
+  AesOperation(data, size, caller_nonce_, tpm_nonce_, AES_ENCRYPT);
   return true;
 }
 
-bool HmacAuthorizationDelegate::DecryptResponseParameter(
-    std::string* parameter) {
-  CHECK(parameter);
+bool HmacAuthorizationDelegate::DecryptResponseParameterInPlace(uint8_t* data,
+                                                                size_t size) {
+  ScopedAllocationTag allocation_tag(kAllocationLayerAuthorization);
   if (!session_handle_) {
     LOG(ERROR) << __func__ << ": Invalid session handle.";
     return false;
@@ -199,11 +208,11 @@ bool HmacAuthorizationDelegate::DecryptResponseParameter(
     // No parameter decryption enabled.
     return true;
   }
-  if (parameter->size() > kTpmBufferSize) {
+  if (size > kTpmBufferSize) {
     LOG(ERROR) << "Parameter size is too large for TPM encryption.";
     return false;
   }
-  AesOperation(parameter, tpm_nonce_, caller_nonce_, AES_DECRYPT);
+  AesOperation(data, size, tpm_nonce_, caller_nonce_, AES_DECRYPT);
   return true;
 }
 
@@ -226,22 +235,37 @@ bool HmacAuthorizationDelegate::InitSession(TPM_HANDLE session_handle,
   if (salt.length() == 0 && bind_auth_value.length() == 0) {
     // SessionKey is set to the empty string for unsalted and
     // unbound sessions.
-    session_key_ = std::string();
+    session_key_.clear();
   } else {
-    session_key_ = CreateKey(bind_auth_value + salt, session_key_label,
-                             tpm_nonce_, caller_nonce_);
+    SecureString key(bind_auth_value);
+    key.append(salt);
+    std::string session_key =
+        CreateKey(key, session_key_label, tpm_nonce_, caller_nonce_);
+    session_key_ = SecureString::TakeString(&session_key);
   }
+  authorization_hmac_.Reset();
+  encryption_hmac_.Reset();
   return true;
 }
 
 void HmacAuthorizationDelegate::set_future_authorization_value(
     const std::string& auth_value) {
-  future_authorization_value_ = auth_value;
+  future_authorization_value_.assign(auth_value);
   future_authorization_value_set_ = true;
 }
 
 std::string HmacAuthorizationDelegate::CreateKey(
-    const std::string& hmac_key,
+    const SecureString& hmac_key,
+    const std::string& label,
+    const TPM2B_NONCE& nonce_newer,
+    const TPM2B_NONCE& nonce_older) {
+  PrecomputedHmac hmac;
+  hmac.SetKey(hmac_key);
+  return CreateKey(&hmac, label, nonce_newer, nonce_older);
+}
+
+std::string HmacAuthorizationDelegate::CreateKey(
+    PrecomputedHmac* hmac,
     const std::string& label,
     const TPM2B_NONCE& nonce_newer,
     const TPM2B_NONCE& nonce_older) {
@@ -256,58 +280,127 @@ std::string HmacAuthorizationDelegate::CreateKey(
   CHECK_EQ(digest_size_bits.size(), sizeof(uint32_t));
   CHECK_EQ(label.size(), kLabelSize);
 
-  std::string data;
-  data.append(counter);
-  data.append(label);
-  data.append(reinterpret_cast<const char*>(nonce_newer.buffer),
-              nonce_newer.size);
-  data.append(reinterpret_cast<const char*>(nonce_older.buffer),
-              nonce_older.size);
-  data.append(digest_size_bits);
-  std::string key = HmacSha256(hmac_key, data);
-  return key;
+  counter.append(label);
+  return hmac->Compute(counter, nonce_newer, nonce_older, digest_size_bits);
+}
+
+HmacAuthorizationDelegate::PrecomputedHmac*
+HmacAuthorizationDelegate::GetAuthorizationHmac() {
+  if (!authorization_hmac_.is_set()) {
+    if (!use_entity_authorization_for_encryption_only_) {
+      authorization_hmac_.SetKey(GetHmacKey(entity_authorization_value_));
+      hmac_key_.clear();
+    } else {
+      authorization_hmac_.SetKey(session_key_);
+    }
+  }
+  return &authorization_hmac_;
+}
+
+const SecureString& HmacAuthorizationDelegate::GetHmacKey(
+    const SecureString& auth_value) {
+  hmac_key_.assign(session_key_.data(), session_key_.size());
+  hmac_key_.append(auth_value);
+  return hmac_key_;
+}
+
+HmacAuthorizationDelegate::PrecomputedHmac::PrecomputedHmac()
+    : is_set_(false) {
+  HMAC_CTX_init(&keyed_context_);
+}
+
+HmacAuthorizationDelegate::PrecomputedHmac::~PrecomputedHmac() {
+  HMAC_CTX_cleanup(&keyed_context_);
+}
+
+void HmacAuthorizationDelegate::PrecomputedHmac::SetKey(
+    const SecureString& key) {
+  CHECK(HMAC_Init_ex(&keyed_context_, key.data(), key.size(), EVP_sha256(),
+                     nullptr));
+  is_set_ = true;
 }
 
-std::string HmacAuthorizationDelegate::HmacSha256(const std::string& key,
-                                                  const std::string& data) {
+std::string HmacAuthorizationDelegate::PrecomputedHmac::Compute(
+    const std::string& prefix,
+    const TPM2B_NONCE& nonce1,
+    const TPM2B_NONCE& nonce2,
+    const std::string& suffix) {
+  CHECK(is_set_);
+  HMAC_CTX context;
+  HMAC_CTX_init(&context);
+  CHECK(HMAC_CTX_copy(&context, &keyed_context_));
+  HMAC_Update(&context, reinterpret_cast<const unsigned char*>(prefix.data()),
+              prefix.size());
+  HMAC_Update(&context, nonce1.buffer, nonce1.size);
+  HMAC_Update(&context, nonce2.buffer, nonce2.size);
+  HMAC_Update(&context, reinterpret_cast<const unsigned char*>(suffix.data()),
+              suffix.size());
   unsigned char digest[EVP_MAX_MD_SIZE];
   unsigned int digest_length;
-  HMAC(EVP_sha256(), key.data(), key.size(),
-       reinterpret_cast<const unsigned char*>(data.data()), data.size(), digest,
-       &digest_length);
+  CHECK(HMAC_Final(&context, digest, &digest_length));
+  HMAC_CTX_cleanup(&context);
   CHECK_EQ(digest_length, kHashDigestSize);
   return std::string(reinterpret_cast<char*>(digest), digest_length);
 }
 
-void HmacAuthorizationDelegate::AesOperation(std::string* parameter,
+void HmacAuthorizationDelegate::AesOperation(uint8_t* data,
+                                             size_t size,
                                              const TPM2B_NONCE& nonce_newer,
                                              const TPM2B_NONCE& nonce_older,
                                              int operation_type) {
-  std::string label("CFB", kLabelSize);
-  std::string compound_key =
-      CreateKey(session_key_ + entity_authorization_value_, label, nonce_newer,
-                nonce_older);
-  CHECK_EQ(compound_key.size(), kAesKeySize + kAesIVSize);
-  unsigned char aes_key[kAesKeySize];
+  if (size == 0) {
+    return;
+  }
+  PrepareAesKey(nonce_newer, nonce_older);
   unsigned char aes_iv[kAesIVSize];
-  memcpy(aes_key, &compound_key[0], kAesKeySize);
-  memcpy(aes_iv, &compound_key[kAesKeySize], kAesIVSize);
-  AES_KEY key;
+  memcpy(aes_iv, aes_iv_, kAesIVSize);
+  // CFB works in place, so no intermediate buffer is needed.
+#if defined(OPENSSL_IS_BORINGSSL)
   int iv_offset = 0;
-  AES_set_encrypt_key(aes_key, kAesKeySize * 8, &key);
-  unsigned char decrypted[kTpmBufferSize];
-  AES_cfb128_encrypt(reinterpret_cast<const unsigned char*>(parameter->data()),
-                     decrypted, parameter->size(), &key, aes_iv, &iv_offset,
+  AES_cfb128_encrypt(data, data, size, &aes_key_, aes_iv, &iv_offset,
                      operation_type);
-  memcpy(base::string_as_array(parameter), decrypted, parameter->size());
+#else
+  int out_length = 0;
+  CHECK(EVP_CipherInit_ex(&aes_context_, nullptr, nullptr, nullptr, aes_iv,
+                          operation_type == AES_ENCRYPT ? 1 : 0));
+  CHECK(EVP_CipherUpdate(&aes_context_, data, &out_length, data, size));
+  CHECK_EQ(static_cast<size_t>(out_length), size);
+#endif
+}
+
+void HmacAuthorizationDelegate::PrepareAesKey(const TPM2B_NONCE& nonce_newer,
+                                              const TPM2B_NONCE& nonce_older) {
+  if (!encryption_hmac_.is_set()) {
+    encryption_hmac_.SetKey(GetHmacKey(entity_authorization_value_));
+    hmac_key_.clear();
+    aes_key_valid_ = false;
+  }
+  if (aes_key_valid_ && Equal_TPM2B_DIGEST(nonce_newer, aes_nonce_newer_) &&
+      Equal_TPM2B_DIGEST(nonce_older, aes_nonce_older_)) {
+    return;
+  }
+  std::string label("CFB", kLabelSize);
+  std::string compound_key =
+      CreateKey(&encryption_hmac_, label, nonce_newer, nonce_older);
+  CHECK_EQ(compound_key.size(), kAesKeySize + kAesIVSize);
+  const unsigned char* aes_key =
+      reinterpret_cast<const unsigned char*>(compound_key.data());
+#if defined(OPENSSL_IS_BORINGSSL)
+  AES_set_encrypt_key(aes_key, kAesKeySize * 8, &aes_key_);
+#else
+  CHECK(EVP_CipherInit_ex(&aes_context_, EVP_aes_128_cfb128(), nullptr,
+                          aes_key, nullptr, 1));
+#endif
+  memcpy(aes_iv_, aes_key + kAesKeySize, kAesIVSize);
+  OPENSSL_cleanse(base::string_as_array(&compound_key), compound_key.size());
+  aes_nonce_newer_ = nonce_newer;
+  aes_nonce_older_ = nonce_older;
+  aes_key_valid_ = true;
 }
 
 void HmacAuthorizationDelegate::RegenerateCallerNonce() {
   CHECK(session_handle_);
-  // RAND_bytes takes a signed number, but since nonce_size is guaranteed to be
-  // less than 32 bytes and greater than 16 we dont have to worry about it.
-  CHECK_EQ(RAND_bytes(caller_nonce_.buffer, caller_nonce_.size), 1)
-      << "Error regnerating a cryptographically random nonce.";
+  GetRandomNonceBytes(caller_nonce_.buffer, caller_nonce_.size);
 }
 
 }  // namespace trunks
@@ -18,12 +18,22 @@
 #define TRUNKS_HMAC_AUTHORIZATION_DELEGATE_H_
 
 #include <string>
+#include <utility>
 
 #include <base/gtest_prod_util.h>
+#include <base/macros.h>
 #include <crypto/secure_hash.h>
 #include <gtest/gtest_prod.h>
+#include <openssl/crypto.h>
+#if defined(OPENSSL_IS_BORINGSSL)
+#include <openssl/aes.h>
+#else
+#include <openssl/evp.h>
+#endif
+#include <openssl/hmac.h>
 
 #include "trunks/authorization_delegate.h"
+#include "trunks/secure_arena.h"
 #include "trunks/tpm_generated.h"
 #include "trunks/trunks_export.h"
 
@@ -31,6 +41,7 @@ namespace trunks {
 
 const uint8_t kContinueSession = 1;
 const size_t kAesKeySize = 16;      // 128 bits is minimum AES key size.
+const size_t kAesIVSize = 16;
 const size_t kHashDigestSize = 32;  // 256 bits is SHA256 digest size.
 
 // HmacAuthorizationDelegate is an implementation of the AuthorizationDelegate
@@ -72,6 +83,8 @@ class TRUNKS_EXPORT HmacAuthorizationDelegate : public AuthorizationDelegate {
                                   const std::string& authorization) override;
   bool EncryptCommandParameter(std::string* parameter) override;
   bool DecryptResponseParameter(std::string* parameter) override;
+  bool EncryptCommandParameterInPlace(uint8_t* data, size_t size) override;
+  bool DecryptResponseParameterInPlace(uint8_t* data, size_t size) override;
 
   // This function is called with the return data of |StartAuthSession|. It
   // will initialize the session to start providing auth information. It can
@@ -91,7 +104,14 @@ class TRUNKS_EXPORT HmacAuthorizationDelegate : public AuthorizationDelegate {
   // computing the HMAC response of TPM2_HierarchyChangeAuth.
   void set_future_authorization_value(const std::string& auth_value);
 
-  std::string future_authorization_value() {
+  // Drops a future authorization value that was set but not yet consumed by a
+  // response.
+  void clear_future_authorization_value() {
+    future_authorization_value_.clear();
+    future_authorization_value_set_ = false;
+  }
+
+  const SecureString& future_authorization_value() const {
     return future_authorization_value_;
   }
 
@@ -99,10 +119,17 @@ class TRUNKS_EXPORT HmacAuthorizationDelegate : public AuthorizationDelegate {
   // This auth_value is then used when generating HMACs and encryption keys.
   // Note: This value will be used for all commands until explicitly reset.
   void set_entity_authorization_value(const std::string& auth_value) {
-    entity_authorization_value_ = auth_value;
+    entity_authorization_value_.assign(auth_value);
+    authorization_hmac_.Reset();
+    encryption_hmac_.Reset();
+  }
+  void set_entity_authorization_value(SecureString auth_value) {
+    entity_authorization_value_ = std::move(auth_value);
+    authorization_hmac_.Reset();
+    encryption_hmac_.Reset();
   }
 
-  std::string entity_authorization_value() const {
+  const SecureString& entity_authorization_value() const {
     return entity_authorization_value_;
   }
 
@@ -110,32 +137,75 @@ class TRUNKS_EXPORT HmacAuthorizationDelegate : public AuthorizationDelegate {
 
   void set_use_entity_authorization_for_encryption_only(bool value) {
     use_entity_authorization_for_encryption_only_ = value;
+    authorization_hmac_.Reset();
   }
 
  protected:
   FRIEND_TEST(HmacAuthorizationDelegateFixture, NonceRegenerationTest);
   FRIEND_TEST(HmacAuthorizationDelegateTest, EncryptDecryptTest);
+  FRIEND_TEST(HmacAuthorizationDelegateTest, LargeParameterEncryptDecrypt);
   FRIEND_TEST(HmacAuthorizationDelegateTest, SessionKeyTest);
 
  private:
+  // HMAC-SHA256 state with the inner and outer key pads already absorbed, so
+  // that each message costs only the compression of the message itself.
+  class PrecomputedHmac {
+   public:
+    PrecomputedHmac();
+    ~PrecomputedHmac();
+
+    bool is_set() const { return is_set_; }
+    void SetKey(const SecureString& key);
+    void Reset() { is_set_ = false; }
+
+    // Returns the HMAC of |prefix| || |nonce1| || |nonce2| || |suffix|, the
+    // message layout shared by authorization HMACs and the TPM KDFa.
+    std::string Compute(const std::string& prefix,
+                        const TPM2B_NONCE& nonce1,
+                        const TPM2B_NONCE& nonce2,
+                        const std::string& suffix);
+
+   private:
+    HMAC_CTX keyed_context_;
+    bool is_set_;
+
+    DISALLOW_COPY_AND_ASSIGN(PrecomputedHmac);
+  };
+
+  // Returns the precomputed HMAC for authorization values, keyed with the
+  // session key and, unless only used for encryption, the entity
+  // authorization value.
+  PrecomputedHmac* GetAuthorizationHmac();
+
+  // Returns |session_key_| || |auth_value| in |hmac_key_|.
+  const SecureString& GetHmacKey(const SecureString& auth_value);
+
   // This method implements the key derivation function used in the TPM.
   // NOTE: It only returns 32 byte keys.
-  std::string CreateKey(const std::string& hmac_key,
+  std::string CreateKey(const SecureString& hmac_key,
+                        const std::string& label,
+                        const TPM2B_NONCE& nonce_newer,
+                        const TPM2B_NONCE& nonce_older);
+  // Same as CreateKey() but using the precomputed state in |hmac|.
+  std::string CreateKey(PrecomputedHmac* hmac,
                         const std::string& label,
                         const TPM2B_NONCE& nonce_newer,
                         const TPM2B_NONCE& nonce_older);
-  // This method performs a FIPS198 HMAC operation on |data| using |key|
-  std::string HmacSha256(const std::string& key, const std::string& data);
   // This method performs an AES operation using a 128 bit key.
   // |operation_type| can be either AES_ENCRYPT or AES_DECRYPT and it
   // determines if the operation is an encryption or decryption.
-  void AesOperation(std::string* parameter,
+  void AesOperation(uint8_t* data,
+                    size_t size,
                     const TPM2B_NONCE& nonce_newer,
                     const TPM2B_NONCE& nonce_older,
                     int operation_type);
+  // Derives the CFB key and IV for the given nonces and sets up the cipher,
+  // unless that was already done for the same nonces and session key.
+  void PrepareAesKey(const TPM2B_NONCE& nonce_newer,
+                     const TPM2B_NONCE& nonce_older);
   // This method regenerates the caller nonce. The new nonce is the same
-  // length as the previous nonce. The buffer is filled with random data using
-  // openssl's |RAND_bytes| function.
+  // length as the previous nonce. The buffer is filled with random data from
+  // the per-thread nonce pool.
   // NOTE: This operation is DESTRUCTIVE, and rewrites the caller_nonce_ field.
   void RegenerateCallerNonce();
 
@@ -144,14 +214,36 @@ class TRUNKS_EXPORT HmacAuthorizationDelegate : public AuthorizationDelegate {
   TPM2B_NONCE tpm_nonce_;
   bool is_parameter_encryption_enabled_;
   bool nonce_generated_;
-  std::string session_key_;
-  std::string entity_authorization_value_;
+  // Secrets are kept in locked memory.
+  SecureString session_key_;
+  SecureString entity_authorization_value_;
   bool future_authorization_value_set_;
-  std::string future_authorization_value_;
+  SecureString future_authorization_value_;
+  // Scratch space for the HMAC keys combining |session_key_| with an
+  // authorization value. Reused so rekeying does not allocate.
+  SecureString hmac_key_;
   // This boolean flag determines if the entity_authorization_value_ is needed
   // when computing the hmac_key to create the authorization hmac. Defaults
   // to false, but policy sessions may set this flag to true.
   bool use_entity_authorization_for_encryption_only_;
+  // Keyed HMAC states derived from |session_key_| and
+  // |entity_authorization_value_|. They are rebuilt lazily after either value
+  // changes.
+  PrecomputedHmac authorization_hmac_;
+  PrecomputedHmac encryption_hmac_;
+  // Parameter encryption key schedule and IV for the nonce pair it was last
+  // derived from. Valid only while |aes_key_valid_| is true and
+  // |encryption_hmac_| has not been reset.
+  bool aes_key_valid_;
+  TPM2B_NONCE aes_nonce_newer_;
+  TPM2B_NONCE aes_nonce_older_;
+  uint8_t aes_iv_[kAesIVSize];
+#if defined(OPENSSL_IS_BORINGSSL)
+  AES_KEY aes_key_;
+#else
+  // Goes through EVP so that AES-NI or ARMv8 crypto extensions are used.
+  EVP_CIPHER_CTX aes_context_;
+#endif
 
   DISALLOW_COPY_AND_ASSIGN(HmacAuthorizationDelegate);
 };
@@ -55,7 +55,7 @@ TEST(HmacAuthorizationDelegateTest, SessionKeyTest) {
       "\xea\x50\xb2\x11\x54\x45\x32\x73"
       "\x47\x38\xef\xb3\x4a\x82\x29\x94",
       kHashDigestSize);
-  EXPECT_EQ(0, expected_key.compare(delegate.session_key_));
+  EXPECT_TRUE(delegate.session_key_.Equals(expected_key));
 }
 
 TEST(HmacAuthorizationDelegateTest, EncryptDecryptTest) {
@@ -90,6 +90,54 @@ TEST(HmacAuthorizationDelegateTest, EncryptDecryptTest) {
   EXPECT_EQ(0, plaintext_parameter.compare(encrypted_parameter));
 }
 
+TEST(HmacAuthorizationDelegateTest, LargeParameterEncryptDecrypt) {
+  HmacAuthorizationDelegate delegate;
+  TPM_HANDLE dummy_handle = HMAC_SESSION_FIRST;
+  TPM2B_NONCE nonce;
+  nonce.size = kAesKeySize;
+  memset(nonce.buffer, 0, nonce.size);
+  ASSERT_TRUE(delegate.InitSession(dummy_handle, nonce, nonce, "salt",
+                                   std::string(), true));
+  std::string plaintext_parameter(2048, 'a');
+  std::string encrypted_parameter(plaintext_parameter);
+  EXPECT_TRUE(delegate.EncryptCommandParameter(&encrypted_parameter));
+  EXPECT_NE(plaintext_parameter, encrypted_parameter);
+  // Decrypting with the nonces swapped recovers the plaintext. The second
+  // operation on the same nonce pair reuses the derived key.
+  delegate.tpm_nonce_ = delegate.caller_nonce_;
+  delegate.caller_nonce_ = nonce;
+  std::string decrypted_parameter(encrypted_parameter);
+  EXPECT_TRUE(delegate.DecryptResponseParameter(&decrypted_parameter));
+  EXPECT_EQ(plaintext_parameter, decrypted_parameter);
+  decrypted_parameter = encrypted_parameter;
+  EXPECT_TRUE(delegate.DecryptResponseParameter(&decrypted_parameter));
+  EXPECT_EQ(plaintext_parameter, decrypted_parameter);
+  // A new entity authorization value changes the key.
+  delegate.set_entity_authorization_value("auth");
+  decrypted_parameter = encrypted_parameter;
+  EXPECT_TRUE(delegate.DecryptResponseParameter(&decrypted_parameter));
+  EXPECT_NE(plaintext_parameter, decrypted_parameter);
+}
+
+TEST(HmacAuthorizationDelegateTest, InPlaceDecryptMatchesString) {
+  HmacAuthorizationDelegate delegate;
+  TPM_HANDLE dummy_handle = HMAC_SESSION_FIRST;
+  TPM2B_NONCE nonce;
+  nonce.size = kAesKeySize;
+  memset(nonce.buffer, 0, nonce.size);
+  ASSERT_TRUE(delegate.InitSession(dummy_handle, nonce, nonce, "salt",
+                                   std::string(), true));
+  std::string parameter(100, 'a');
+  std::string expected(parameter);
+  EXPECT_TRUE(delegate.DecryptResponseParameter(&expected));
+  EXPECT_NE(parameter, expected);
+  // Only the bytes in the span are decrypted.
+  std::string buffer = "xx" + parameter;
+  EXPECT_TRUE(delegate.DecryptResponseParameterInPlace(
+      reinterpret_cast<uint8_t*>(&buffer[2]), parameter.size()));
+  EXPECT_EQ("xx" + expected, buffer);
+}
+
 class HmacAuthorizationDelegateFixture : public testing::Test {
  public:
   HmacAuthorizationDelegateFixture() {}
@@ -195,6 +243,38 @@ TEST_F(HmacAuthorizationDelegateFixture, ResponseAuthTest) {
       delegate_.CheckResponseAuthorization(response_hash, authorization));
 }
 
+TEST_F(HmacAuthorizationDelegateFixture, ResponseAuthTracksEntityAuth) {
+  TPMS_AUTH_RESPONSE auth_response;
+  auth_response.session_attributes = kContinueSession;
+  auth_response.nonce.size = kAesKeySize;
+  memset(auth_response.nonce.buffer, 0, kAesKeySize);
+  auth_response.hmac.size = kHashDigestSize;
+  // Same expected value as in ResponseAuthTest, for an empty entity auth.
+  uint8_t hmac_buffer[kHashDigestSize] = {
+      0x37, 0x69, 0xaf, 0x12, 0xff, 0x4d, 0xbf, 0x44, 0xe5, 0x16, 0xa2,
+      0x2d, 0x1d, 0x05, 0x12, 0xe8, 0xbc, 0x42, 0x51, 0x6d, 0x59, 0xe8,
+      0xbf, 0x40, 0x1e, 0xa3, 0x46, 0xa4, 0xd6, 0x0d, 0xcc, 0xf7};
+  memcpy(auth_response.hmac.buffer, hmac_buffer, kHashDigestSize);
+  std::string response_hash;
+  std::string authorization;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            Serialize_TPMS_AUTH_RESPONSE(auth_response, &authorization));
+  EXPECT_TRUE(
+      delegate_.CheckResponseAuthorization(response_hash, authorization));
+  // The precomputed key must follow changes to the entity authorization.
+  delegate_.set_entity_authorization_value("auth");
+  EXPECT_FALSE(
+      delegate_.CheckResponseAuthorization(response_hash, authorization));
+  delegate_.set_entity_authorization_value("");
+  EXPECT_TRUE(
+      delegate_.CheckResponseAuthorization(response_hash, authorization));
+  // Unless the entity authorization is only used for encryption.
+  delegate_.set_entity_authorization_value("auth");
+  delegate_.set_use_entity_authorization_for_encryption_only(true);
+  EXPECT_TRUE(
+      delegate_.CheckResponseAuthorization(response_hash, authorization));
+}
+
 TEST_F(HmacAuthorizationDelegateFixture, SessionAttributes) {
   const uint8_t kDecryptSession = 1 << 5;
   const uint8_t kEncryptSession = 1 << 6;
@@ -19,6 +19,7 @@
 
 #include <string>
 
+#include <base/callback.h>
 #include <base/macros.h>
 
 #include "trunks/tpm_generated.h"
@@ -31,6 +32,8 @@ class AuthorizationDelegate;
 // authorization and parameter encryption.
 class HmacSession {
  public:
+  typedef base::Callback<void(TPM_RC result)> StartSessionCallback;
+
   HmacSession() {}
   virtual ~HmacSession() {}
 
@@ -51,6 +54,13 @@ class HmacSession {
   // is destroyed or another session is started with a call to Start*Session.
   virtual TPM_RC StartUnboundSession(bool enable_encryption) = 0;
 
+  // Asynchronous version of StartUnboundSession(). |callback| is run with the
+  // result once the session is set up. It is not run if this object is
+  // destroyed first.
+  virtual void StartUnboundSessionAsync(
+      bool enable_encryption,
+      const StartSessionCallback& callback) = 0;
+
   // Sets the current entity authorization value. This can be safely called
   // while the session is active and subsequent commands will use the value.
   virtual void SetEntityAuthorizationValue(const std::string& value) = 0;
@@ -61,6 +71,13 @@ class HmacSession {
   // HierarchyChangeAuth uses the new auth_value.
   virtual void SetFutureAuthorizationValue(const std::string& value) = 0;
 
+  // Checks whether |result|, the response code of a command which used this
+  // session, indicates that the session is no longer loaded. If so the session
+  // is started again with the parameters of the last Start*Session call and
+  // the current entity authorization value is kept. Returns true if the
+  // session was restarted and the command may be retried.
+  virtual bool RestartIfInvalidated(TPM_RC result) = 0;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(HmacSession);
 };
@@ -17,12 +17,17 @@
 #include "trunks/hmac_session_impl.h"
 
 #include <string>
+#include <utility>
 
+#include <base/bind.h>
 #include <base/logging.h>
 #include <base/macros.h>
 #include <base/stl_util.h>
+#include <openssl/crypto.h>
 #include <openssl/rand.h>
 
+#include "trunks/error_codes.h"
+
 namespace trunks {
 
 HmacSessionImpl::HmacSessionImpl(const TrunksFactory& factory)
@@ -45,9 +50,12 @@ TPM_RC HmacSessionImpl::StartBoundSession(
     TPMI_DH_ENTITY bind_entity,
     const std::string& bind_authorization_value,
     bool enable_encryption) {
-  return session_manager_->StartSession(TPM_SE_HMAC, bind_entity,
-                                        bind_authorization_value,
-                                        enable_encryption, &hmac_delegate_);
+  TPM_RC result = session_manager_->StartSession(
+      TPM_SE_HMAC, bind_entity, bind_authorization_value, enable_encryption,
+      &hmac_delegate_);
+  OnSessionStarted(bind_entity, bind_authorization_value, enable_encryption,
+                   result);
+  return result;
 }
 
 TPM_RC HmacSessionImpl::StartUnboundSession(bool enable_encryption) {
@@ -58,6 +66,18 @@ TPM_RC HmacSessionImpl::StartUnboundSession(bool enable_encryption) {
   return StartBoundSession(TPM_RH_NULL, "", enable_encryption);
 }
 
+void HmacSessionImpl::StartUnboundSessionAsync(
+    bool enable_encryption,
+    const StartSessionCallback& callback) {
+  started_ = false;
+  // |session_manager_| drops the callback if it is destroyed, and it does not
+  // outlive this object.
+  session_manager_->StartSessionAsync(
+      TPM_SE_HMAC, TPM_RH_NULL, "", enable_encryption, &hmac_delegate_,
+      base::Bind(&HmacSessionImpl::OnSessionStartedAsync,
+                 base::Unretained(this), enable_encryption, callback));
+}
+
 void HmacSessionImpl::SetEntityAuthorizationValue(const std::string& value) {
   hmac_delegate_.set_entity_authorization_value(value);
 }
@@ -66,4 +86,61 @@ void HmacSessionImpl::SetFutureAuthorizationValue(const std::string& value) {
   hmac_delegate_.set_future_authorization_value(value);
 }
 
+bool HmacSessionImpl::RestartIfInvalidated(TPM_RC result) {
+  if (!started_ || !IsSessionNotLoadedError(result)) {
+    return false;
+  }
+  LOG(INFO) << __func__ << ": Restarting session: " << GetErrorString(result);
+  SecureString entity_authorization_value =
+      hmac_delegate_.entity_authorization_value().Clone();
+  std::string bind_authorization_value = bind_authorization_value_.ToString();
+  TPM_RC start_result = StartBoundSession(
+      bind_entity_, bind_authorization_value, enable_encryption_);
+  OPENSSL_cleanse(base::string_as_array(&bind_authorization_value),
+                  bind_authorization_value.size());
+  if (start_result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Error restarting session: "
+               << GetErrorString(start_result);
+    return false;
+  }
+  hmac_delegate_.set_entity_authorization_value(
+      std::move(entity_authorization_value));
+  return true;
+}
+
+bool HmacSessionImpl::MatchesStartParameters(
+    TPMI_DH_ENTITY bind_entity,
+    const std::string& bind_authorization_value,
+    bool enable_encryption) const {
+  return started_ && bind_entity_ == bind_entity &&
+         enable_encryption_ == enable_encryption &&
+         bind_authorization_value_.Equals(bind_authorization_value);
+}
+
+void HmacSessionImpl::OnSessionStarted(
+    TPMI_DH_ENTITY bind_entity,
+    const std::string& bind_authorization_value,
+    bool enable_encryption,
+    TPM_RC result) {
+  started_ = (result == TPM_RC_SUCCESS);
+  if (started_) {
+    bind_entity_ = bind_entity;
+    bind_authorization_value_.assign(bind_authorization_value);
+    enable_encryption_ = enable_encryption;
+  }
+}
+
+void HmacSessionImpl::OnSessionStartedAsync(
+    bool enable_encryption,
+    const StartSessionCallback& callback,
+    TPM_RC result) {
+  OnSessionStarted(TPM_RH_NULL, "", enable_encryption, result);
+  callback.Run(result);
+}
+
+void HmacSessionImpl::ResetAuthorizationValues() {
+  hmac_delegate_.set_entity_authorization_value("");
+  hmac_delegate_.clear_future_authorization_value();
+}
+
 }  // namespace trunks
@@ -25,6 +25,7 @@
 #include <base/macros.h>
 
 #include "trunks/hmac_authorization_delegate.h"
+#include "trunks/secure_arena.h"
 #include "trunks/session_manager.h"
 #include "trunks/trunks_export.h"
 #include "trunks/trunks_factory.h"
@@ -58,10 +59,34 @@ class TRUNKS_EXPORT HmacSessionImpl : public HmacSession {
                            const std::string& bind_authorization_value,
                            bool enable_encryption) override;
   TPM_RC StartUnboundSession(bool enable_encryption) override;
+  void StartUnboundSessionAsync(bool enable_encryption,
+                                const StartSessionCallback& callback) override;
   void SetEntityAuthorizationValue(const std::string& value) override;
   void SetFutureAuthorizationValue(const std::string& value) override;
+  bool RestartIfInvalidated(TPM_RC result) override;
+
+  // Returns true if this session was started bound to |bind_entity| with
+  // |bind_authorization_value| and with encryption set to |enable_encryption|.
+  bool MatchesStartParameters(TPMI_DH_ENTITY bind_entity,
+                              const std::string& bind_authorization_value,
+                              bool enable_encryption) const;
+
+  // Clears the entity and future authorization values so that the session can
+  // be handed out again for unrelated commands.
+  void ResetAuthorizationValues();
 
  private:
+  // Records the start parameters if |result| indicates success.
+  void OnSessionStarted(TPMI_DH_ENTITY bind_entity,
+                        const std::string& bind_authorization_value,
+                        bool enable_encryption,
+                        TPM_RC result);
+
+  // Runs OnSessionStarted() and then |callback|.
+  void OnSessionStartedAsync(bool enable_encryption,
+                             const StartSessionCallback& callback,
+                             TPM_RC result);
+
   // This factory is only set in the constructor and is used to instantiate
   // The TPM class to forward commands to the TPM chip.
   const TrunksFactory& factory_;
@@ -71,6 +96,12 @@ class TRUNKS_EXPORT HmacSessionImpl : public HmacSession {
   // This object is used to manage the TPM session associated with this
   // HmacSession.
   std::unique_ptr<SessionManager> session_manager_;
+  // The parameters of the last successful Start*Session call. These are used
+  // to restart the session when it is invalidated.
+  bool started_ = false;
+  TPMI_DH_ENTITY bind_entity_ = TPM_RH_NULL;
+  SecureString bind_authorization_value_;
+  bool enable_encryption_ = false;
 
   friend class HmacSessionTest;
   DISALLOW_COPY_AND_ASSIGN(HmacSessionImpl);
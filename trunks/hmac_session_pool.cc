@@ -0,0 +1,233 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/hmac_session_pool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include <base/bind.h>
+#include <base/logging.h>
+
+#include "trunks/error_codes.h"
+
+namespace trunks {
+
+const size_t HmacSessionPool::kMaxIdleSessions;
+const int HmacSessionPool::kDefaultIdleTimeoutSeconds;
+
+HmacSessionPool::HmacSessionPool(const TrunksFactory& factory)
+    : factory_(factory),
+      idle_timeout_(
+          base::TimeDelta::FromSeconds(kDefaultIdleTimeoutSeconds)) {}
+
+HmacSessionPool::~HmacSessionPool() {}
+
+std::unique_ptr<HmacSessionImpl> HmacSessionPool::Acquire(
+    TPMI_DH_ENTITY bind_entity,
+    const std::string& bind_authorization_value,
+    bool enable_encryption,
+    TPM_RC* result) {
+  CHECK(result);
+  std::unique_ptr<HmacSessionImpl> session =
+      AcquireIdle(bind_entity, bind_authorization_value, enable_encryption);
+  if (session) {
+    *result = TPM_RC_SUCCESS;
+    return session;
+  }
+  session = CreateSession();
+  *result = session->StartBoundSession(bind_entity, bind_authorization_value,
+                                       enable_encryption);
+  if (*result != TPM_RC_SUCCESS) {
+    return nullptr;
+  }
+  return session;
+}
+
+std::unique_ptr<HmacSessionImpl> HmacSessionPool::AcquireIdle(
+    TPMI_DH_ENTITY bind_entity,
+    const std::string& bind_authorization_value,
+    bool enable_encryption) {
+  std::unique_ptr<HmacSessionImpl> session;
+  std::vector<IdleSession> expired;
+  {
+    base::AutoLock lock(lock_);
+    TakeExpiredLocked(&expired);
+    // Prefer the most recently released session.
+    for (auto it = idle_sessions_.rbegin(); it != idle_sessions_.rend();
+         ++it) {
+      if (it->session->MatchesStartParameters(
+              bind_entity, bind_authorization_value, enable_encryption)) {
+        session = std::move(it->session);
+        idle_sessions_.erase(std::next(it).base());
+        break;
+      }
+    }
+  }
+  if (session) {
+    session->ResetAuthorizationValues();
+  }
+  return session;
+}
+
+std::unique_ptr<HmacSessionImpl> HmacSessionPool::CreateSession() {
+  return std::unique_ptr<HmacSessionImpl>(new HmacSessionImpl(factory_));
+}
+
+void HmacSessionPool::Release(std::unique_ptr<HmacSessionImpl> session) {
+  if (!session || !session->GetDelegate()) {
+    return;
+  }
+  std::vector<IdleSession> evicted;
+  {
+    base::AutoLock lock(lock_);
+    TakeExpiredLocked(&evicted);
+    if (idle_sessions_.size() >= kMaxIdleSessions) {
+      evicted.push_back(std::move(idle_sessions_.front()));
+      idle_sessions_.erase(idle_sessions_.begin());
+    }
+    IdleSession idle;
+    idle.session = std::move(session);
+    idle.release_time = base::TimeTicks::Now();
+    idle_sessions_.push_back(std::move(idle));
+  }
+  // |evicted| is closed here, outside of the lock, since closing a session
+  // sends a command to the TPM.
+}
+
+size_t HmacSessionPool::idle_size() {
+  base::AutoLock lock(lock_);
+  return idle_sessions_.size();
+}
+
+void HmacSessionPool::set_idle_timeout(base::TimeDelta timeout) {
+  base::AutoLock lock(lock_);
+  idle_timeout_ = timeout;
+}
+
+void HmacSessionPool::TakeExpiredLocked(std::vector<IdleSession>* expired) {
+  if (idle_timeout_.is_max()) {
+    return;
+  }
+  base::TimeTicks now = base::TimeTicks::Now();
+  // Sessions are ordered by release time, so the expired ones come first.
+  auto it = idle_sessions_.begin();
+  while (it != idle_sessions_.end() &&
+         now - it->release_time >= idle_timeout_) {
+    ++it;
+  }
+  std::move(idle_sessions_.begin(), it, std::back_inserter(*expired));
+  idle_sessions_.erase(idle_sessions_.begin(), it);
+}
+
+PooledHmacSession::PooledHmacSession(HmacSessionPool* pool) : pool_(pool) {
+  CHECK(pool_);
+}
+
+PooledHmacSession::~PooledHmacSession() {
+  pool_->Release(std::move(session_));
+}
+
+AuthorizationDelegate* PooledHmacSession::GetDelegate() {
+  if (!session_) {
+    return nullptr;
+  }
+  return session_->GetDelegate();
+}
+
+TPM_RC PooledHmacSession::StartBoundSession(
+    TPMI_DH_ENTITY bind_entity,
+    const std::string& bind_authorization_value,
+    bool enable_encryption) {
+  pool_->Release(std::move(session_));
+  TPM_RC result = TPM_RC_SUCCESS;
+  session_ = pool_->Acquire(bind_entity, bind_authorization_value,
+                            enable_encryption, &result);
+  if (!session_) {
+    return result;
+  }
+  ApplyPendingAuthorizationValues();
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC PooledHmacSession::StartUnboundSession(bool enable_encryption) {
+  return StartBoundSession(TPM_RH_NULL, "", enable_encryption);
+}
+
+void PooledHmacSession::StartUnboundSessionAsync(
+    bool enable_encryption,
+    const StartSessionCallback& callback) {
+  pool_->Release(std::move(session_));
+  session_ = pool_->AcquireIdle(TPM_RH_NULL, "", enable_encryption);
+  if (session_) {
+    ApplyPendingAuthorizationValues();
+    callback.Run(TPM_RC_SUCCESS);
+    return;
+  }
+  session_ = pool_->CreateSession();
+  // The callback is dropped if |session_| is destroyed, so it cannot outlive
+  // this object.
+  session_->StartUnboundSessionAsync(
+      enable_encryption, base::Bind(&PooledHmacSession::OnSessionStarted,
+                                    base::Unretained(this), callback));
+}
+
+void PooledHmacSession::SetEntityAuthorizationValue(const std::string& value) {
+  entity_authorization_value_ = value;
+  if (session_) {
+    session_->SetEntityAuthorizationValue(value);
+  }
+}
+
+void PooledHmacSession::SetFutureAuthorizationValue(const std::string& value) {
+  if (session_) {
+    session_->SetFutureAuthorizationValue(value);
+    return;
+  }
+  future_authorization_value_ = value;
+  future_authorization_value_set_ = true;
+}
+
+bool PooledHmacSession::RestartIfInvalidated(TPM_RC result) {
+  if (!session_) {
+    return false;
+  }
+  return session_->RestartIfInvalidated(result);
+}
+
+void PooledHmacSession::ApplyPendingAuthorizationValues() {
+  session_->SetEntityAuthorizationValue(entity_authorization_value_);
+  if (future_authorization_value_set_) {
+    session_->SetFutureAuthorizationValue(future_authorization_value_);
+    future_authorization_value_set_ = false;
+  }
+}
+
+void PooledHmacSession::OnSessionStarted(const StartSessionCallback& callback,
+                                         TPM_RC result) {
+  if (result != TPM_RC_SUCCESS) {
+    // Destroying the session here would also destroy the callback that is
+    // running, so keep the unstarted session; Release() discards it.
+    callback.Run(result);
+    return;
+  }
+  ApplyPendingAuthorizationValues();
+  callback.Run(TPM_RC_SUCCESS);
+}
+
+}  // namespace trunks
@@ -0,0 +1,154 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef TRUNKS_HMAC_SESSION_POOL_H_
+#define TRUNKS_HMAC_SESSION_POOL_H_
+
+#include "trunks/hmac_session.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/macros.h>
+#include <base/synchronization/lock.h>
+#include <base/time/time.h>
+
+#include "trunks/hmac_session_impl.h"
+#include "trunks/trunks_export.h"
+#include "trunks/trunks_factory.h"
+
+namespace trunks {
+
+// HmacSessionPool keeps salted HMAC sessions alive after their users are done
+// with them so that later operations with the same start parameters can skip
+// the salt encryption and TPM2_StartAuthSession round trip. Idle sessions are
+// keyed by bind entity, bind authorization value and encryption flag. This
+// class is thread-safe; each session is only used by one owner at a time.
+//
+// The pool also spreads concurrent users over sessions: each user holds its
+// own session, so independent authorized commands from several threads never
+// wait on one session's nonce chain. The pool grows with the number of
+// concurrent users and keeps up to kMaxIdleSessions of their sessions once
+// they are done. Sessions left idle for longer than the idle timeout are
+// closed, so the pool shrinks again when concurrency drops.
+class TRUNKS_EXPORT HmacSessionPool {
+ public:
+  // The maximum number of idle sessions kept open. Every idle session holds a
+  // TPM session slot, so this is kept small.
+  static const size_t kMaxIdleSessions = 4;
+  // How long a session stays idle before it is closed, unless changed with
+  // set_idle_timeout().
+  static const int kDefaultIdleTimeoutSeconds = 300;
+
+  // The |factory| must outlive the pool and every session it hands out.
+  explicit HmacSessionPool(const TrunksFactory& factory);
+  ~HmacSessionPool();
+
+  // Returns a started session with the given parameters, reusing an idle one
+  // if possible. The authorization values of a reused session are cleared. On
+  // failure nullptr is returned and |result| holds the start error.
+  std::unique_ptr<HmacSessionImpl> Acquire(
+      TPMI_DH_ENTITY bind_entity,
+      const std::string& bind_authorization_value,
+      bool enable_encryption,
+      TPM_RC* result);
+
+  // Returns an idle session with the given parameters, or nullptr if there is
+  // none. Unlike Acquire() this never sends a command to the TPM.
+  std::unique_ptr<HmacSessionImpl> AcquireIdle(
+      TPMI_DH_ENTITY bind_entity,
+      const std::string& bind_authorization_value,
+      bool enable_encryption);
+
+  // Returns a new, unstarted session which may be released to this pool once
+  // it is started.
+  std::unique_ptr<HmacSessionImpl> CreateSession();
+
+  // Returns a |session| obtained from Acquire() to the pool. Sessions which
+  // are no longer started are closed, as is the oldest idle session if the
+  // pool is full.
+  void Release(std::unique_ptr<HmacSessionImpl> session);
+
+  // Returns the number of idle sessions. Used by tests.
+  size_t idle_size();
+
+  // Idle sessions released at least |timeout| ago are closed the next time the
+  // pool is used. base::TimeDelta::Max() keeps them until the pool is full.
+  void set_idle_timeout(base::TimeDelta timeout);
+
+ private:
+  struct IdleSession {
+    std::unique_ptr<HmacSessionImpl> session;
+    base::TimeTicks release_time;
+  };
+
+  // Moves sessions idle for longer than |idle_timeout_| to |expired|. They are
+  // closed when |expired| is destroyed, which must happen outside of |lock_|.
+  void TakeExpiredLocked(std::vector<IdleSession>* expired);
+
+  const TrunksFactory& factory_;
+  base::Lock lock_;
+  // Ordered from least to most recently released.
+  std::vector<IdleSession> idle_sessions_;
+  base::TimeDelta idle_timeout_;
+
+  DISALLOW_COPY_AND_ASSIGN(HmacSessionPool);
+};
+
+// An HmacSession backed by an HmacSessionPool. Start*Session takes a session
+// from the pool and it is handed back when another session is started or this
+// object is destroyed.
+class TRUNKS_EXPORT PooledHmacSession : public HmacSession {
+ public:
+  // The |pool| must outlive this object.
+  explicit PooledHmacSession(HmacSessionPool* pool);
+  ~PooledHmacSession() override;
+
+  // HmacSession methods.
+  AuthorizationDelegate* GetDelegate() override;
+  TPM_RC StartBoundSession(TPMI_DH_ENTITY bind_entity,
+                           const std::string& bind_authorization_value,
+                           bool enable_encryption) override;
+  TPM_RC StartUnboundSession(bool enable_encryption) override;
+  void StartUnboundSessionAsync(bool enable_encryption,
+                                const StartSessionCallback& callback) override;
+  void SetEntityAuthorizationValue(const std::string& value) override;
+  void SetFutureAuthorizationValue(const std::string& value) override;
+  bool RestartIfInvalidated(TPM_RC result) override;
+
+ private:
+  // Applies authorization values set before the session was started.
+  void ApplyPendingAuthorizationValues();
+
+  // Called when a session created by StartUnboundSessionAsync() is started.
+  void OnSessionStarted(const StartSessionCallback& callback, TPM_RC result);
+
+  HmacSessionPool* pool_;
+  std::unique_ptr<HmacSessionImpl> session_;
+  // Authorization values set before a session was started. They are applied
+  // to the session once it is taken from the pool.
+  std::string entity_authorization_value_;
+  bool future_authorization_value_set_ = false;
+  std::string future_authorization_value_;
+
+  DISALLOW_COPY_AND_ASSIGN(PooledHmacSession);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_HMAC_SESSION_POOL_H_
@@ -0,0 +1,162 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/hmac_session_pool.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/hmac_authorization_delegate.h"
+#include "trunks/mock_session_manager.h"
+#include "trunks/trunks_factory_for_test.h"
+
+using testing::_;
+using testing::NiceMock;
+using testing::Return;
+
+namespace trunks {
+
+class HmacSessionPoolTest : public testing::Test {
+ public:
+  HmacSessionPoolTest() : pool_(factory_) {}
+  ~HmacSessionPoolTest() override {}
+
+  void SetUp() override {
+    factory_.set_session_manager(&mock_session_manager_);
+  }
+
+  std::string GetEntityAuthorization(HmacSession* session) {
+    return static_cast<HmacAuthorizationDelegate*>(session->GetDelegate())
+        ->entity_authorization_value()
+        .ToString();
+  }
+
+ protected:
+  TrunksFactoryForTest factory_;
+  NiceMock<MockSessionManager> mock_session_manager_;
+  HmacSessionPool pool_;
+};
+
+TEST_F(HmacSessionPoolTest, ReusesIdleSession) {
+  EXPECT_CALL(mock_session_manager_,
+              StartSession(TPM_SE_HMAC, TPM_RH_NULL, "", true, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  TPM_RC result = TPM_RC_FAILURE;
+  std::unique_ptr<HmacSessionImpl> session =
+      pool_.Acquire(TPM_RH_NULL, "", true, &result);
+  ASSERT_TRUE(session);
+  EXPECT_EQ(TPM_RC_SUCCESS, result);
+  HmacSessionImpl* raw_session = session.get();
+  pool_.Release(std::move(session));
+  EXPECT_EQ(1u, pool_.idle_size());
+  session = pool_.Acquire(TPM_RH_NULL, "", true, &result);
+  EXPECT_EQ(raw_session, session.get());
+  EXPECT_EQ(TPM_RC_SUCCESS, result);
+  EXPECT_EQ(0u, pool_.idle_size());
+}
+
+TEST_F(HmacSessionPoolTest, DifferentParametersStartNewSession) {
+  EXPECT_CALL(mock_session_manager_, StartSession(_, _, _, _, _))
+      .Times(3)
+      .WillRepeatedly(Return(TPM_RC_SUCCESS));
+  TPM_RC result = TPM_RC_FAILURE;
+  pool_.Release(pool_.Acquire(TPM_RH_NULL, "", true, &result));
+  std::unique_ptr<HmacSessionImpl> session =
+      pool_.Acquire(TPM_RH_NULL, "", false, &result);
+  EXPECT_TRUE(session);
+  session = pool_.Acquire(TPM_RH_OWNER, "password", true, &result);
+  EXPECT_TRUE(session);
+  EXPECT_EQ(1u, pool_.idle_size());
+}
+
+TEST_F(HmacSessionPoolTest, StartFailure) {
+  EXPECT_CALL(mock_session_manager_, StartSession(_, _, _, _, _))
+      .WillOnce(Return(TPM_RC_FAILURE));
+  TPM_RC result = TPM_RC_SUCCESS;
+  EXPECT_FALSE(pool_.Acquire(TPM_RH_NULL, "", true, &result));
+  EXPECT_EQ(TPM_RC_FAILURE, result);
+  EXPECT_EQ(0u, pool_.idle_size());
+}
+
+TEST_F(HmacSessionPoolTest, IdleSessionLimit) {
+  EXPECT_CALL(mock_session_manager_, StartSession(_, _, _, _, _))
+      .WillRepeatedly(Return(TPM_RC_SUCCESS));
+  std::vector<std::unique_ptr<HmacSessionImpl>> sessions;
+  TPM_RC result = TPM_RC_FAILURE;
+  for (size_t i = 0; i <= HmacSessionPool::kMaxIdleSessions; ++i) {
+    sessions.push_back(pool_.Acquire(TPM_RH_NULL, "", true, &result));
+  }
+  for (auto& session : sessions) {
+    pool_.Release(std::move(session));
+  }
+  EXPECT_EQ(HmacSessionPool::kMaxIdleSessions, pool_.idle_size());
+}
+
+TEST_F(HmacSessionPoolTest, IdleSessionTimeout) {
+  EXPECT_CALL(mock_session_manager_, StartSession(_, _, _, _, _))
+      .Times(2)
+      .WillRepeatedly(Return(TPM_RC_SUCCESS));
+  TPM_RC result = TPM_RC_FAILURE;
+  pool_.Release(pool_.Acquire(TPM_RH_NULL, "", true, &result));
+  EXPECT_EQ(1u, pool_.idle_size());
+  // Every idle session has timed out, so a new one is started.
+  pool_.set_idle_timeout(base::TimeDelta());
+  std::unique_ptr<HmacSessionImpl> session =
+      pool_.Acquire(TPM_RH_NULL, "", true, &result);
+  EXPECT_TRUE(session);
+  EXPECT_EQ(0u, pool_.idle_size());
+  // Without a timeout the session is kept.
+  pool_.set_idle_timeout(base::TimeDelta::Max());
+  pool_.Release(std::move(session));
+  session = pool_.Acquire(TPM_RH_NULL, "", true, &result);
+  EXPECT_TRUE(session);
+}
+
+TEST_F(HmacSessionPoolTest, PooledSessionClearsAuthorization) {
+  EXPECT_CALL(mock_session_manager_, StartSession(_, _, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  {
+    PooledHmacSession session(&pool_);
+    EXPECT_EQ(nullptr, session.GetDelegate());
+    session.SetEntityAuthorizationValue("test_auth");
+    EXPECT_EQ(TPM_RC_SUCCESS, session.StartUnboundSession(true));
+    EXPECT_EQ("test_auth", GetEntityAuthorization(&session));
+  }
+  EXPECT_EQ(1u, pool_.idle_size());
+  PooledHmacSession session(&pool_);
+  EXPECT_EQ(TPM_RC_SUCCESS, session.StartUnboundSession(true));
+  EXPECT_EQ("", GetEntityAuthorization(&session));
+}
+
+TEST_F(HmacSessionPoolTest, PooledSessionRestart) {
+  EXPECT_CALL(mock_session_manager_, StartSession(_, _, _, _, _))
+      .Times(2)
+      .WillRepeatedly(Return(TPM_RC_SUCCESS));
+  PooledHmacSession session(&pool_);
+  EXPECT_FALSE(session.RestartIfInvalidated(TPM_RC_REFERENCE_S0));
+  EXPECT_EQ(TPM_RC_SUCCESS, session.StartUnboundSession(true));
+  EXPECT_TRUE(session.RestartIfInvalidated(
+      TPM_RC_HANDLE | kResourceManagerTpmErrorBase));
+  EXPECT_FALSE(session.RestartIfInvalidated(TPM_RC_BAD_AUTH));
+}
+
+}  // namespace trunks
@@ -16,10 +16,12 @@
 
 #include "trunks/hmac_session_impl.h"
 
+#include <base/bind.h>
 #include <base/logging.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "trunks/error_codes.h"
 #include "trunks/mock_session_manager.h"
 #include "trunks/mock_tpm.h"
 #include "trunks/tpm_generated.h"
@@ -32,6 +34,14 @@ using testing::Return;
 using testing::SaveArg;
 using testing::SetArgPointee;
 
+namespace {
+
+void SaveResult(trunks::TPM_RC* result_out, trunks::TPM_RC result) {
+  *result_out = result;
+}
+
+}  // namespace
+
 namespace trunks {
 
 class HmacSessionTest : public testing::Test {
@@ -89,8 +99,7 @@ TEST_F(HmacSessionTest, EntityAuthorizationForwardingTest) {
   std::string test_auth("test_auth");
   session.SetEntityAuthorizationValue(test_auth);
   HmacAuthorizationDelegate* hmac_delegate = GetHmacDelegate(&session);
-  std::string entity_auth = hmac_delegate->entity_authorization_value();
-  EXPECT_EQ(0, test_auth.compare(entity_auth));
+  EXPECT_TRUE(hmac_delegate->entity_authorization_value().Equals(test_auth));
 }
 
 TEST_F(HmacSessionTest, FutureAuthorizationForwardingTest) {
@@ -98,8 +107,66 @@ TEST_F(HmacSessionTest, FutureAuthorizationForwardingTest) {
   std::string test_auth("test_auth");
   session.SetFutureAuthorizationValue(test_auth);
   HmacAuthorizationDelegate* hmac_delegate = GetHmacDelegate(&session);
-  std::string entity_auth = hmac_delegate->future_authorization_value();
-  EXPECT_EQ(0, test_auth.compare(entity_auth));
+  EXPECT_TRUE(hmac_delegate->future_authorization_value().Equals(test_auth));
+}
+
+TEST_F(HmacSessionTest, RestartIfInvalidatedNotStarted) {
+  HmacSessionImpl session(factory_);
+  EXPECT_CALL(mock_session_manager_, StartSession(_, _, _, _, _)).Times(0);
+  EXPECT_FALSE(session.RestartIfInvalidated(TPM_RC_REFERENCE_S0));
+}
+
+TEST_F(HmacSessionTest, RestartIfInvalidatedOtherError) {
+  HmacSessionImpl session(factory_);
+  EXPECT_CALL(mock_session_manager_, StartSession(_, _, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_EQ(TPM_RC_SUCCESS, session.StartUnboundSession(true));
+  EXPECT_FALSE(session.RestartIfInvalidated(TPM_RC_FAILURE));
+  EXPECT_FALSE(session.RestartIfInvalidated(TPM_RC_SUCCESS));
+}
+
+TEST_F(HmacSessionTest, RestartIfInvalidatedSuccess) {
+  HmacSessionImpl session(factory_);
+  TPM_HANDLE bind_entity = TPM_RH_FIRST;
+  EXPECT_CALL(mock_session_manager_,
+              StartSession(TPM_SE_HMAC, bind_entity, "bind_auth", false, _))
+      .Times(3)
+      .WillRepeatedly(Return(TPM_RC_SUCCESS));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            session.StartBoundSession(bind_entity, "bind_auth", false));
+  session.SetEntityAuthorizationValue("test_auth");
+  EXPECT_TRUE(session.RestartIfInvalidated(TPM_RC_REFERENCE_S0));
+  EXPECT_TRUE(
+      GetHmacDelegate(&session)->entity_authorization_value().Equals(
+          "test_auth"));
+  EXPECT_TRUE(session.RestartIfInvalidated(TPM_RC_HANDLE | TPM_RC_S |
+                                           TPM_RC_1));
+}
+
+TEST_F(HmacSessionTest, RestartIfInvalidatedStartFailure) {
+  HmacSessionImpl session(factory_);
+  EXPECT_CALL(mock_session_manager_, StartSession(_, _, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS))
+      .WillOnce(Return(TPM_RC_FAILURE));
+  EXPECT_EQ(TPM_RC_SUCCESS, session.StartUnboundSession(true));
+  EXPECT_FALSE(session.RestartIfInvalidated(TPM_RC_REFERENCE_S0));
+  // The session is no longer considered started.
+  EXPECT_FALSE(session.RestartIfInvalidated(TPM_RC_REFERENCE_S0));
+}
+
+TEST_F(HmacSessionTest, StartUnboundSessionAsync) {
+  HmacSessionImpl session(factory_);
+  SessionManager::StartSessionCallback start_callback;
+  EXPECT_CALL(mock_session_manager_,
+              StartSessionAsync(TPM_SE_HMAC, TPM_RH_NULL, "", true, _, _))
+      .WillOnce(SaveArg<5>(&start_callback));
+  TPM_RC result = TPM_RC_FAILURE;
+  session.StartUnboundSessionAsync(true, base::Bind(&SaveResult, &result));
+  // The session is not restarted before it has been started.
+  EXPECT_FALSE(session.RestartIfInvalidated(TPM_RC_REFERENCE_S0));
+  start_callback.Run(TPM_RC_SUCCESS);
+  EXPECT_EQ(TPM_RC_SUCCESS, result);
+  EXPECT_TRUE(session.MatchesStartParameters(TPM_RH_NULL, "", true));
 }
 
 }  // namespace trunks
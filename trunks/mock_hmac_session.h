@@ -36,8 +36,12 @@ class MockHmacSession : public HmacSession {
                       const std::string& bind_authorization_value,
                       bool enable_encryption));
   MOCK_METHOD1(StartUnboundSession, TPM_RC(bool enable_encryption));
+  MOCK_METHOD2(StartUnboundSessionAsync,
+               void(bool enable_encryption,
+                    const StartSessionCallback& callback));
   MOCK_METHOD1(SetEntityAuthorizationValue, void(const std::string& value));
   MOCK_METHOD1(SetFutureAuthorizationValue, void(const std::string& value));
+  MOCK_METHOD1(RestartIfInvalidated, bool(TPM_RC result));
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MockHmacSession);
@@ -23,6 +23,7 @@
 #include <gmock/gmock.h>
 
 #include "trunks/policy_session.h"
+#include "trunks/policy_template.h"
 
 namespace trunks {
 
@@ -37,12 +38,31 @@ class MockPolicySession : public PolicySession {
                       const std::string& bind_authorization_value,
                       bool enable_encryption));
   MOCK_METHOD1(StartUnboundSession, TPM_RC(bool enable_encryption));
+  MOCK_METHOD2(StartUnboundSessionAsync,
+               void(bool enable_encryption,
+                    const StartSessionCallback& callback));
   MOCK_METHOD1(GetDigest, TPM_RC(std::string*));
   MOCK_METHOD1(PolicyOR, TPM_RC(const std::vector<std::string>&));
   MOCK_METHOD2(PolicyPCR, TPM_RC(uint32_t, const std::string&));
   MOCK_METHOD1(PolicyCommandCode, TPM_RC(TPM_CC));
   MOCK_METHOD0(PolicyAuthValue, TPM_RC());
+  MOCK_METHOD4(PolicyAuthorize,
+               TPM_RC(const std::string&,
+                      const std::string&,
+                      const std::string&,
+                      const TPMT_TK_VERIFIED&));
+  MOCK_METHOD5(PolicySigned,
+               TPM_RC(TPMI_DH_OBJECT,
+                      const std::string&,
+                      const std::string&,
+                      int32_t,
+                      const TPMT_SIGNATURE&));
+  MOCK_METHOD3(PolicySecret,
+               TPM_RC(TPMI_DH_ENTITY,
+                      const std::string&,
+                      AuthorizationDelegate*));
   MOCK_METHOD0(PolicyRestart, TPM_RC());
+  MOCK_METHOD1(ApplyPolicy, TPM_RC(const PolicyTemplate&));
   MOCK_METHOD1(SetEntityAuthorizationValue, void(const std::string&));
 
  private:
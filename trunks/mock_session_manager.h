@@ -38,6 +38,13 @@ class MockSessionManager : public SessionManager {
                       const std::string&,
                       bool,
                       HmacAuthorizationDelegate*));
+  MOCK_METHOD6(StartSessionAsync,
+               void(TPM_SE,
+                    TPMI_DH_ENTITY,
+                    const std::string&,
+                    bool,
+                    HmacAuthorizationDelegate*,
+                    const StartSessionCallback&));
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MockSessionManager);
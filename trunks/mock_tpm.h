@@ -18,6 +18,7 @@
 #define TRUNKS_MOCK_TPM_H_
 
 #include <string>
+#include <vector>
 
 #include <base/callback.h>
 #include <gmock/gmock.h>
@@ -31,6 +32,10 @@ class MockTpm : public Tpm {
   MockTpm();
   ~MockTpm() override;
 
+  MOCK_METHOD1(SendCommandBatchAndWait,
+               std::vector<std::string>(const std::vector<std::string>&));
+  MOCK_METHOD1(SendCommandsAndWait,
+               std::vector<std::string>(const std::vector<std::string>&));
   MOCK_METHOD3(Startup,
                void(const TPM_SU& startup_type,
                     AuthorizationDelegate* authorization_delegate,
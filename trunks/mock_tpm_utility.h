@@ -17,7 +17,9 @@
 #ifndef TRUNKS_MOCK_TPM_UTILITY_H_
 #define TRUNKS_MOCK_TPM_UTILITY_H_
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 
@@ -35,6 +37,7 @@ class MockTpmUtility : public TpmUtility {
   MOCK_METHOD0(Shutdown, void());
   MOCK_METHOD0(InitializeTpm, TPM_RC());
   MOCK_METHOD1(AllocatePCR, TPM_RC(const std::string&));
+  MOCK_METHOD0(PrepareForOwnership, TPM_RC());
   MOCK_METHOD3(TakeOwnership,
                TPM_RC(const std::string&,
                       const std::string&,
@@ -45,6 +48,15 @@ class MockTpmUtility : public TpmUtility {
   MOCK_METHOD3(ExtendPCR,
                TPM_RC(int, const std::string&, AuthorizationDelegate*));
   MOCK_METHOD2(ReadPCR, TPM_RC(int, std::string*));
+  MOCK_METHOD4(ExtendPCRs,
+               TPM_RC(int,
+                      const std::string&,
+                      const std::vector<TPM_ALG_ID>&,
+                      AuthorizationDelegate*));
+  MOCK_METHOD3(ReadPCRs,
+               TPM_RC(const std::vector<int>&,
+                      const std::vector<TPM_ALG_ID>&,
+                      std::map<TPM_ALG_ID, std::vector<std::string>>*));
   MOCK_METHOD6(AsymmetricEncrypt,
                TPM_RC(TPM_HANDLE,
                       TPM_ALG_ID,
@@ -66,6 +78,13 @@ class MockTpmUtility : public TpmUtility {
                       const std::string&,
                       AuthorizationDelegate*,
                       std::string*));
+  MOCK_METHOD6(SignFile,
+               TPM_RC(TPM_HANDLE,
+                      TPM_ALG_ID,
+                      TPM_ALG_ID,
+                      int,
+                      AuthorizationDelegate*,
+                      std::string*));
   MOCK_METHOD6(Verify,
                TPM_RC(TPM_HANDLE,
                       TPM_ALG_ID,
@@ -73,6 +92,7 @@ class MockTpmUtility : public TpmUtility {
                       const std::string&,
                       const std::string&,
                       AuthorizationDelegate*));
+  MOCK_METHOD1(SetUseSoftwarePublicKeyOperations, void(bool));
   MOCK_METHOD2(CertifyCreation, TPM_RC(TPM_HANDLE, const std::string&));
   MOCK_METHOD4(ChangeKeyAuthorizationData,
                TPM_RC(TPM_HANDLE,
@@ -87,6 +107,15 @@ class MockTpmUtility : public TpmUtility {
                       const std::string&,
                       AuthorizationDelegate*,
                       std::string*));
+  MOCK_METHOD8(ImportECCKey,
+               TPM_RC(AsymmetricKeyUsage,
+                      TPMI_ECC_CURVE,
+                      const std::string&,
+                      const std::string&,
+                      const std::string&,
+                      const std::string&,
+                      AuthorizationDelegate*,
+                      std::string*));
   MOCK_METHOD10(CreateRSAKeyPair,
                 TPM_RC(AsymmetricKeyUsage,
                        int,
@@ -98,8 +127,31 @@ class MockTpmUtility : public TpmUtility {
                        AuthorizationDelegate*,
                        std::string*,
                        std::string*));
+  MOCK_METHOD8(PregenerateRSAKeyPairs,
+               TPM_RC(AsymmetricKeyUsage,
+                      int,
+                      uint32_t,
+                      const std::string&,
+                      const std::string&,
+                      bool,
+                      size_t,
+                      AuthorizationDelegate*));
+  MOCK_METHOD9(CreateECCKeyPair,
+               TPM_RC(AsymmetricKeyUsage,
+                      TPMI_ECC_CURVE,
+                      const std::string&,
+                      const std::string&,
+                      bool,
+                      int,
+                      AuthorizationDelegate*,
+                      std::string*,
+                      std::string*));
   MOCK_METHOD3(LoadKey,
                TPM_RC(const std::string&, AuthorizationDelegate*, TPM_HANDLE*));
+  MOCK_METHOD3(LoadKeys,
+               TPM_RC(const std::vector<std::string>&,
+                      AuthorizationDelegate*,
+                      std::vector<TPM_HANDLE>*));
   MOCK_METHOD2(GetKeyName, TPM_RC(TPM_HANDLE, std::string*));
   MOCK_METHOD2(GetKeyPublicArea, TPM_RC(TPM_HANDLE, TPMT_PUBLIC*));
   MOCK_METHOD4(SealData,
@@ -111,9 +163,25 @@ class MockTpmUtility : public TpmUtility {
                TPM_RC(const std::string&,
                       AuthorizationDelegate*,
                       std::string*));
+  MOCK_METHOD1(EnableUnsealCache, void(base::TimeDelta));
   MOCK_METHOD1(StartSession, TPM_RC(HmacSession*));
   MOCK_METHOD3(GetPolicyDigestForPcrValue,
                TPM_RC(int, const std::string&, std::string*));
+  MOCK_METHOD3(GetPolicyDigestForAuthority,
+               TPM_RC(const std::string&, const std::string&, std::string*));
+  MOCK_METHOD5(SignPolicyApproval,
+               TPM_RC(TPM_HANDLE,
+                      const std::string&,
+                      const std::string&,
+                      AuthorizationDelegate*,
+                      std::string*));
+  MOCK_METHOD6(UnsealDataWithApprovedPolicy,
+               TPM_RC(const std::string&,
+                      int,
+                      const std::string&,
+                      const std::string&,
+                      const std::string&,
+                      std::string*));
   MOCK_METHOD6(DefineNVSpace,
                TPM_RC(uint32_t,
                       size_t,
@@ -138,6 +206,19 @@ class MockTpmUtility : public TpmUtility {
                       bool,
                       std::string*,
                       AuthorizationDelegate*));
+  MOCK_METHOD5(WriteNVSpaceInChunks,
+               TPM_RC(uint32_t,
+                      uint32_t,
+                      const std::string&,
+                      bool,
+                      AuthorizationDelegate*));
+  MOCK_METHOD6(ReadNVSpaceInChunks,
+               TPM_RC(uint32_t,
+                      uint32_t,
+                      size_t,
+                      bool,
+                      const NVReadCallback&,
+                      AuthorizationDelegate*));
   MOCK_METHOD2(GetNVSpaceName, TPM_RC(uint32_t, std::string*));
   MOCK_METHOD2(GetNVSpacePublicArea, TPM_RC(uint32_t, TPMS_NV_PUBLIC*));
   MOCK_METHOD1(ListNVSpaces, TPM_RC(std::vector<uint32_t>*));
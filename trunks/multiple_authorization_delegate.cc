@@ -0,0 +1,102 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/multiple_authorization_delegate.h"
+
+#include <base/logging.h>
+
+#include "trunks/tpm_generated.h"
+
+namespace trunks {
+
+void MultipleAuthorizations::AddAuthorizationDelegate(
+    AuthorizationDelegate* delegate) {
+  CHECK(delegate);
+  delegates_.push_back(delegate);
+}
+
+bool MultipleAuthorizations::GetCommandAuthorization(
+    const std::string& command_hash,
+    bool is_command_parameter_encryption_possible,
+    bool is_response_parameter_encryption_possible,
+    std::string* authorization) {
+  std::string combined_authorization;
+  for (AuthorizationDelegate* delegate : delegates_) {
+    std::string delegate_authorization;
+    if (!delegate->GetCommandAuthorization(
+            command_hash, is_command_parameter_encryption_possible,
+            is_response_parameter_encryption_possible,
+            &delegate_authorization)) {
+      return false;
+    }
+    combined_authorization += delegate_authorization;
+  }
+  authorization->append(combined_authorization);
+  return true;
+}
+
+bool MultipleAuthorizations::CheckResponseAuthorization(
+    const std::string& response_hash,
+    const std::string& authorization) {
+  // The response holds one TPMS_AUTH_RESPONSE per command authorization.
+  std::string mutable_authorization = authorization;
+  for (AuthorizationDelegate* delegate : delegates_) {
+    TPMS_AUTH_RESPONSE auth_response;
+    std::string auth_bytes;
+    if (Parse_TPMS_AUTH_RESPONSE(&mutable_authorization, &auth_response,
+                                 &auth_bytes) != TPM_RC_SUCCESS) {
+      LOG(ERROR) << __func__ << ": could not parse authorization response.";
+      return false;
+    }
+    if (!delegate->CheckResponseAuthorization(response_hash, auth_bytes)) {
+      return false;
+    }
+  }
+  if (!mutable_authorization.empty()) {
+    LOG(ERROR) << __func__ << ": unexpected authorization responses.";
+    return false;
+  }
+  return true;
+}
+
+bool MultipleAuthorizations::EncryptCommandParameter(std::string* parameter) {
+  for (AuthorizationDelegate* delegate : delegates_) {
+    if (!delegate->EncryptCommandParameter(parameter)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool MultipleAuthorizations::DecryptResponseParameter(std::string* parameter) {
+  for (AuthorizationDelegate* delegate : delegates_) {
+    if (!delegate->DecryptResponseParameter(parameter)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool MultipleAuthorizations::RequiresParameterHashes() const {
+  for (AuthorizationDelegate* delegate : delegates_) {
+    if (delegate->RequiresParameterHashes()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace trunks
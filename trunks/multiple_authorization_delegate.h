@@ -0,0 +1,62 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TRUNKS_MULTIPLE_AUTHORIZATION_DELEGATE_H_
+#define TRUNKS_MULTIPLE_AUTHORIZATION_DELEGATE_H_
+
+#include <string>
+#include <vector>
+
+#include <base/macros.h>
+
+#include "trunks/authorization_delegate.h"
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+// An authorization delegate for commands with more than one authorized
+// handle, such as TPM2_ActivateCredential. It sends one authorization per
+// added delegate, in the order they were added, which has to match the order
+// of the handles that need authorization. At most one of the delegates may
+// encrypt parameters. The added delegates must outlive this object.
+class TRUNKS_EXPORT MultipleAuthorizations : public AuthorizationDelegate {
+ public:
+  MultipleAuthorizations() = default;
+  ~MultipleAuthorizations() override = default;
+
+  // Adds an authorization delegate for the next authorized handle.
+  void AddAuthorizationDelegate(AuthorizationDelegate* delegate);
+
+  // AuthorizationDelegate methods.
+  bool GetCommandAuthorization(const std::string& command_hash,
+                               bool is_command_parameter_encryption_possible,
+                               bool is_response_parameter_encryption_possible,
+                               std::string* authorization) override;
+  bool CheckResponseAuthorization(const std::string& response_hash,
+                                  const std::string& authorization) override;
+  bool EncryptCommandParameter(std::string* parameter) override;
+  bool DecryptResponseParameter(std::string* parameter) override;
+  bool RequiresParameterHashes() const override;
+
+ private:
+  std::vector<AuthorizationDelegate*> delegates_;
+
+  DISALLOW_COPY_AND_ASSIGN(MultipleAuthorizations);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_MULTIPLE_AUTHORIZATION_DELEGATE_H_
@@ -0,0 +1,84 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/multiple_authorization_delegate.h"
+
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "trunks/mock_authorization_delegate.h"
+#include "trunks/password_authorization_delegate.h"
+
+using testing::_;
+using testing::Return;
+
+namespace trunks {
+
+// A password response authorization: an empty nonce, continueSession and an
+// empty HMAC.
+const char kPasswordResponse[] = "\x00\x00\x01\x00\x00";
+
+TEST(MultipleAuthorizationsTest, ConcatenatesAuthorizations) {
+  PasswordAuthorizationDelegate first("first");
+  PasswordAuthorizationDelegate second("second");
+  MultipleAuthorizations authorizations;
+  authorizations.AddAuthorizationDelegate(&first);
+  authorizations.AddAuthorizationDelegate(&second);
+  std::string first_authorization;
+  ASSERT_TRUE(
+      first.GetCommandAuthorization("", false, false, &first_authorization));
+  std::string second_authorization;
+  ASSERT_TRUE(
+      second.GetCommandAuthorization("", false, false, &second_authorization));
+  std::string authorization;
+  EXPECT_TRUE(
+      authorizations.GetCommandAuthorization("", false, false, &authorization));
+  EXPECT_EQ(first_authorization + second_authorization, authorization);
+  EXPECT_FALSE(authorizations.RequiresParameterHashes());
+}
+
+TEST(MultipleAuthorizationsTest, SplitsResponses) {
+  PasswordAuthorizationDelegate first("first");
+  PasswordAuthorizationDelegate second("second");
+  MultipleAuthorizations authorizations;
+  authorizations.AddAuthorizationDelegate(&first);
+  authorizations.AddAuthorizationDelegate(&second);
+  std::string response(kPasswordResponse, sizeof(kPasswordResponse) - 1);
+  EXPECT_TRUE(
+      authorizations.CheckResponseAuthorization("", response + response));
+  // One response per authorization is required.
+  EXPECT_FALSE(authorizations.CheckResponseAuthorization("", response));
+  EXPECT_FALSE(authorizations.CheckResponseAuthorization(
+      "", response + response + response));
+}
+
+TEST(MultipleAuthorizationsTest, FailsIfAnyDelegateFails) {
+  PasswordAuthorizationDelegate first("first");
+  MockAuthorizationDelegate second;
+  MultipleAuthorizations authorizations;
+  authorizations.AddAuthorizationDelegate(&first);
+  authorizations.AddAuthorizationDelegate(&second);
+  EXPECT_CALL(second, GetCommandAuthorization(_, _, _, _))
+      .WillOnce(Return(false));
+  std::string authorization;
+  EXPECT_FALSE(
+      authorizations.GetCommandAuthorization("", false, false, &authorization));
+  EXPECT_TRUE(authorization.empty());
+}
+
+}  // namespace trunks
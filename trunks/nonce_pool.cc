@@ -0,0 +1,78 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/nonce_pool.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include <base/logging.h>
+#include <base/macros.h>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+namespace {
+
+// Enough for about a hundred SHA-256 sized nonces per refill.
+const size_t kNoncePoolSize = 4096;
+
+class NoncePool {
+ public:
+  NoncePool() = default;
+  ~NoncePool() { OPENSSL_cleanse(buffer_, sizeof(buffer_)); }
+
+  void Take(uint8_t* buffer, size_t size) {
+    if (pid_ != getpid() || kNoncePoolSize - offset_ < size) {
+      Refill();
+    }
+    memcpy(buffer, buffer_ + offset_, size);
+    OPENSSL_cleanse(buffer_ + offset_, size);
+    offset_ += size;
+  }
+
+ private:
+  void Refill() {
+    CHECK_EQ(RAND_bytes(buffer_, sizeof(buffer_)), 1)
+        << "Error refilling the nonce pool.";
+    offset_ = 0;
+    pid_ = getpid();
+  }
+
+  uint8_t buffer_[kNoncePoolSize];
+  // The pool is empty until the first refill.
+  size_t offset_ = kNoncePoolSize;
+  pid_t pid_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(NoncePool);
+};
+
+}  // namespace
+
+namespace trunks {
+
+void GetRandomNonceBytes(uint8_t* buffer, size_t size) {
+  if (size > kNoncePoolSize / 4) {
+    // Large requests would drain the pool; serve them directly.
+    CHECK_EQ(RAND_bytes(buffer, size), 1)
+        << "Error generating cryptographically random bytes.";
+    return;
+  }
+  static thread_local NoncePool pool;
+  pool.Take(buffer, size);
+}
+
+}  // namespace trunks
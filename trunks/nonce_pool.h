@@ -0,0 +1,38 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef TRUNKS_NONCE_POOL_H_
+#define TRUNKS_NONCE_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+// Fills |size| bytes at |buffer| with cryptographically random data. Small
+// requests such as caller nonces are served from a per-thread pool which is
+// refilled with a single RAND_bytes call, so threads issuing many authorized
+// commands rarely contend on the OpenSSL RNG lock. Bytes are handed out at
+// most once and are wiped from the pool as they are taken; the pool is
+// discarded in a forked child so parent and child never share nonces.
+TRUNKS_EXPORT void GetRandomNonceBytes(uint8_t* buffer, size_t size);
+
+}  // namespace trunks
+
+#endif  // TRUNKS_NONCE_POOL_H_
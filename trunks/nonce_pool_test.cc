@@ -0,0 +1,46 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/nonce_pool.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace trunks {
+
+TEST(NoncePoolTest, NoncesAreDistinct) {
+  std::set<std::string> nonces;
+  // Draw enough nonces to force several refills.
+  for (int i = 0; i < 1000; ++i) {
+    uint8_t nonce[32];
+    GetRandomNonceBytes(nonce, sizeof(nonce));
+    std::string nonce_string(nonce, nonce + sizeof(nonce));
+    EXPECT_TRUE(nonces.insert(nonce_string).second);
+  }
+}
+
+TEST(NoncePoolTest, LargeRequest) {
+  std::vector<uint8_t> zeros(10000, 0);
+  std::vector<uint8_t> buffer(zeros);
+  GetRandomNonceBytes(buffer.data(), buffer.size());
+  EXPECT_NE(zeros, buffer);
+}
+
+}  // namespace trunks
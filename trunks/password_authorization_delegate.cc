@@ -24,9 +24,26 @@ namespace trunks {
 
 const uint8_t kContinueSession = 1;
 
+// The only valid response authorization: an empty nonce, continueSession and
+// an empty HMAC.
+const char kExpectedResponseAuthorization[] = "\x00\x00\x01\x00\x00";
+const size_t kExpectedResponseAuthorizationSize =
+    sizeof(kExpectedResponseAuthorization) - 1;
+
 PasswordAuthorizationDelegate::PasswordAuthorizationDelegate(
     const std::string& password) {
   password_ = Make_TPM2B_DIGEST(password);
+  // The authorization area never changes so it is serialized only once.
+  TPMS_AUTH_COMMAND auth;
+  auth.session_handle = TPM_RS_PW;
+  auth.nonce.size = 0;
+  auth.session_attributes = kContinueSession;
+  auth.hmac = password_;
+  if (Serialize_TPMS_AUTH_COMMAND(auth, &command_authorization_) !=
+      TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": could not serialize command auth.";
+    command_authorization_.clear();
+  }
 }
 
 PasswordAuthorizationDelegate::~PasswordAuthorizationDelegate() {}
@@ -36,23 +53,24 @@ bool PasswordAuthorizationDelegate::GetCommandAuthorization(
     bool is_command_parameter_encryption_possible,
     bool is_response_parameter_encryption_possible,
     std::string* authorization) {
-  TPMS_AUTH_COMMAND auth;
-  auth.session_handle = TPM_RS_PW;
-  auth.nonce.size = 0;
-  auth.session_attributes = kContinueSession;
-  auth.hmac = password_;
-
-  TPM_RC serialize_error = Serialize_TPMS_AUTH_COMMAND(auth, authorization);
-  if (serialize_error != TPM_RC_SUCCESS) {
+  if (command_authorization_.empty()) {
     LOG(ERROR) << __func__ << ": could not serialize command auth.";
     return false;
   }
+  authorization->append(command_authorization_);
   return true;
 }
 
 bool PasswordAuthorizationDelegate::CheckResponseAuthorization(
     const std::string& response_hash,
     const std::string& authorization) {
+  if (authorization.size() == kExpectedResponseAuthorizationSize &&
+      authorization.compare(0, std::string::npos,
+                            kExpectedResponseAuthorization,
+                            kExpectedResponseAuthorizationSize) == 0) {
+    return true;
+  }
+  // Parse the unexpected response only to log what is wrong with it.
   TPMS_AUTH_RESPONSE auth_response;
   std::string mutable_auth_string(authorization);
   std::string auth_bytes;
@@ -61,25 +79,16 @@ bool PasswordAuthorizationDelegate::CheckResponseAuthorization(
                                          &auth_bytes);
   if (authorization.size() != auth_bytes.size()) {
     LOG(ERROR) << __func__ << ": Authorization string was of wrong length.";
-    return false;
-  }
-  if (parse_error != TPM_RC_SUCCESS) {
+  } else if (parse_error != TPM_RC_SUCCESS) {
     LOG(ERROR) << __func__ << ": could not parse authorization response.";
-    return false;
-  }
-  if (auth_response.nonce.size != 0) {
+  } else if (auth_response.nonce.size != 0) {
     LOG(ERROR) << __func__ << ": received a non zero length nonce.";
-    return false;
-  }
-  if (auth_response.hmac.size != 0) {
+  } else if (auth_response.hmac.size != 0) {
     LOG(ERROR) << __func__ << ": received a non zero length hmac.";
-    return false;
-  }
-  if (auth_response.session_attributes != kContinueSession) {
+  } else {
     LOG(ERROR) << __func__ << ": received wrong session attributes.";
-    return false;
   }
-  return true;
+  return false;
 }
 
 bool PasswordAuthorizationDelegate::EncryptCommandParameter(
@@ -92,4 +101,21 @@ bool PasswordAuthorizationDelegate::DecryptResponseParameter(
   return true;
 }
 
+bool PasswordAuthorizationDelegate::EncryptCommandParameterInPlace(
+    uint8_t* data,
+    size_t size) {
+  return true;
+}
+
+bool PasswordAuthorizationDelegate::DecryptResponseParameterInPlace(
+    uint8_t* data,
+    size_t size) {
+  return true;
+}
+
+bool PasswordAuthorizationDelegate::RequiresParameterHashes() const {
+  // A password session authorizes with the plain password, never an HMAC.
+  return false;
+}
+
 }  // namespace trunks
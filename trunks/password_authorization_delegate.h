@@ -46,12 +46,17 @@ class TRUNKS_EXPORT PasswordAuthorizationDelegate
                                   const std::string& authorization) override;
   bool EncryptCommandParameter(std::string* parameter) override;
   bool DecryptResponseParameter(std::string* parameter) override;
+  bool EncryptCommandParameterInPlace(uint8_t* data, size_t size) override;
+  bool DecryptResponseParameterInPlace(uint8_t* data, size_t size) override;
+  bool RequiresParameterHashes() const override;
 
  protected:
   FRIEND_TEST(PasswordAuthorizationDelegateTest, NullInitialization);
 
  private:
   TPM2B_AUTH password_;
+  // The serialized TPMS_AUTH_COMMAND sent with every command.
+  std::string command_authorization_;
 
   DISALLOW_COPY_AND_ASSIGN(PasswordAuthorizationDelegate);
 };
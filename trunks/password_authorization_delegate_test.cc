@@ -81,6 +81,30 @@ TEST(PasswordAuthorizationDelegateTest, ParseBadParams) {
   EXPECT_EQ(authorization_result, false);
 }
 
+// This test checks that a response with the right length but the wrong
+// session attributes is rejected.
+TEST(PasswordAuthorizationDelegateTest, ParseWrongAttributes) {
+  std::string auth_response(
+      "\x00\x00"   // nonceTpm = zero length buffer
+      "\x00"       // session_attributes = none
+      "\x00\x00",  // hmac = zero length buffer
+      5);
+  PasswordAuthorizationDelegate delegate("secret");
+  std::string response_hash;
+  EXPECT_FALSE(delegate.CheckResponseAuthorization(response_hash,
+                                                   auth_response));
+}
+
+// This test confirms that repeated calls produce the same authorization.
+TEST(PasswordAuthorizationDelegateTest, RepeatedSerialization) {
+  PasswordAuthorizationDelegate delegate("secret");
+  std::string first;
+  std::string second;
+  EXPECT_TRUE(delegate.GetCommandAuthorization("", false, false, &first));
+  EXPECT_TRUE(delegate.GetCommandAuthorization("", false, false, &second));
+  EXPECT_EQ(first, second);
+}
+
 // This test confirms that after encrypting and decrypting a parameter,
 // we get the original parameter back.
 TEST(PasswordAuthorizationDelegateTest, EncryptDecrypt) {
@@ -20,6 +20,7 @@
 #include <string>
 #include <vector>
 
+#include <base/callback.h>
 #include <base/macros.h>
 
 #include "trunks/tpm_generated.h"
@@ -27,11 +28,14 @@
 namespace trunks {
 
 class AuthorizationDelegate;
+class PolicyTemplate;
 
 // PolicySession is an interface for managing policy backed sessions for
 // authorization and parameter encryption.
 class PolicySession {
  public:
+  typedef base::Callback<void(TPM_RC result)> StartSessionCallback;
+
   PolicySession() {}
   virtual ~PolicySession() {}
 
@@ -52,6 +56,13 @@ class PolicySession {
   // is destroyed or another session is started with a call to Start*Session.
   virtual TPM_RC StartUnboundSession(bool enable_encryption) = 0;
 
+  // Asynchronous version of StartUnboundSession(). |callback| is run with the
+  // result once the session is set up. It is not run if this object is
+  // destroyed first.
+  virtual void StartUnboundSessionAsync(
+      bool enable_encryption,
+      const StartSessionCallback& callback) = 0;
+
   // This method is used to get the current PolicyDigest of the PolicySession.
   virtual TPM_RC GetDigest(std::string* digest) = 0;
 
@@ -74,9 +85,46 @@ class PolicySession {
   // HMAC computation done by the AuthorizationDelegate.
   virtual TPM_RC PolicyAuthValue() = 0;
 
+  // This method replaces the session's policy digest, which has to be
+  // |approved_policy|, with a digest that only depends on |key_name| and
+  // |policy_ref|. Data sealed to that digest can thus be unsealed under any
+  // policy the key approves, without being sealed again. |ticket| is the
+  // result of TPM2_VerifySignature of the key's signature over
+  // SHA256(|approved_policy| || |policy_ref|), with the key loaded in a
+  // hierarchy other than TPM_RH_NULL. Trial sessions do not check |ticket|.
+  virtual TPM_RC PolicyAuthorize(const std::string& approved_policy,
+                                 const std::string& policy_ref,
+                                 const std::string& key_name,
+                                 const TPMT_TK_VERIFIED& ticket) = 0;
+
+  // This method binds the PolicySession to a |signature| by the key loaded at
+  // |auth_object|, named |auth_object_name|. The key signs
+  // SHA256(|expiration| || |policy_ref|), with |expiration| as a big-endian
+  // INT32. The signature is not bound to a session nonce or command, so it can
+  // be used in any session until it expires. Trial sessions do not check
+  // |signature|.
+  virtual TPM_RC PolicySigned(TPMI_DH_OBJECT auth_object,
+                              const std::string& auth_object_name,
+                              const std::string& policy_ref,
+                              int32_t expiration,
+                              const TPMT_SIGNATURE& signature) = 0;
+
+  // This method binds the PolicySession to the authorization of
+  // |auth_entity|, named |auth_entity_name|, for example TPM_RH_ENDORSEMENT.
+  // |delegate| provides the authorization of |auth_entity|. Trial sessions do
+  // not use |delegate|.
+  virtual TPM_RC PolicySecret(TPMI_DH_ENTITY auth_entity,
+                              const std::string& auth_entity_name,
+                              AuthorizationDelegate* delegate) = 0;
+
   // Reset a policy session to its original state.
   virtual TPM_RC PolicyRestart() = 0;
 
+  // Applies every assertion of |policy| to this session. The policy commands
+  // are sent to the TPM as a single batch, so the session's policy digest
+  // matches |policy|.ComputeDigest() after a successful call.
+  virtual TPM_RC ApplyPolicy(const PolicyTemplate& policy) = 0;
+
   // Sets the current entity authorization value. This can be safely called
   // while the session is active and subsequent commands will use the value.
   virtual void SetEntityAuthorizationValue(const std::string& value) = 0;
@@ -26,6 +26,7 @@
 #include <openssl/rand.h>
 
 #include "trunks/error_codes.h"
+#include "trunks/policy_template.h"
 #include "trunks/tpm_generated.h"
 
 namespace trunks {
@@ -72,6 +73,20 @@ TPM_RC PolicySessionImpl::StartUnboundSession(bool enable_encryption) {
   return StartBoundSession(TPM_RH_NULL, "", enable_encryption);
 }
 
+void PolicySessionImpl::StartUnboundSessionAsync(
+    bool enable_encryption,
+    const StartSessionCallback& callback) {
+  hmac_delegate_.set_use_entity_authorization_for_encryption_only(true);
+  if (session_type_ != TPM_SE_POLICY && session_type_ != TPM_SE_TRIAL) {
+    LOG(ERROR) << "Cannot start a session of that type.";
+    callback.Run(SAPI_RC_INVALID_SESSIONS);
+    return;
+  }
+  session_manager_->StartSessionAsync(session_type_, TPM_RH_NULL, "",
+                                      enable_encryption, &hmac_delegate_,
+                                      callback);
+}
+
 TPM_RC PolicySessionImpl::GetDigest(std::string* digest) {
   CHECK(digest);
   TPM2B_DIGEST policy_digest;
@@ -111,16 +126,7 @@ TPM_RC PolicySessionImpl::PolicyOR(const std::vector<std::string>& digests) {
 
 TPM_RC PolicySessionImpl::PolicyPCR(uint32_t pcr_index,
                                     const std::string& pcr_value) {
-  TPML_PCR_SELECTION pcr_select;
-  memset(&pcr_select, 0, sizeof(TPML_PCR_SELECTION));
-  // This process of selecting pcrs is highlighted in TPM 2.0 Library Spec
-  // Part 2 (Section 10.5 - PCR structures).
-  uint8_t pcr_select_index = pcr_index / 8;
-  uint8_t pcr_select_byte = 1 << (pcr_index % 8);
-  pcr_select.count = 1;
-  pcr_select.pcr_selections[0].hash = TPM_ALG_SHA256;
-  pcr_select.pcr_selections[0].sizeof_select = PCR_SELECT_MIN;
-  pcr_select.pcr_selections[0].pcr_select[pcr_select_index] = pcr_select_byte;
+  TPML_PCR_SELECTION pcr_select = PolicyTemplate::GetPCRSelection(pcr_index);
   TPM2B_DIGEST pcr_digest;
   if (pcr_value.empty()) {
     if (session_type_ == TPM_SE_TRIAL) {
@@ -170,8 +176,64 @@ TPM_RC PolicySessionImpl::PolicyAuthValue() {
   return TPM_RC_SUCCESS;
 }
 
+TPM_RC PolicySessionImpl::PolicyAuthorize(const std::string& approved_policy,
+                                          const std::string& policy_ref,
+                                          const std::string& key_name,
+                                          const TPMT_TK_VERIFIED& ticket) {
+  TPM_RC result = factory_.GetTpm()->PolicyAuthorizeSync(
+      session_manager_->GetSessionHandle(),
+      "",  // No policy name is needed as we do no authorization checks.
+      Make_TPM2B_DIGEST(approved_policy), Make_TPM2B_DIGEST(policy_ref),
+      Make_TPM2B_NAME(key_name), ticket, nullptr);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << "Error performing PolicyAuthorize: "
+               << GetErrorString(result);
+    return result;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC PolicySessionImpl::PolicySigned(TPMI_DH_OBJECT auth_object,
+                                       const std::string& auth_object_name,
+                                       const std::string& policy_ref,
+                                       int32_t expiration,
+                                       const TPMT_SIGNATURE& signature) {
+  TPM2B_TIMEOUT timeout;
+  TPMT_TK_AUTH policy_ticket;
+  // The empty nonce and command parameter hash leave the signature unbound to
+  // this session and to any particular command.
+  TPM_RC result = factory_.GetTpm()->PolicySignedSync(
+      auth_object, auth_object_name, session_manager_->GetSessionHandle(),
+      "",  // No policy name is needed as we do no authorization checks.
+      Make_TPM2B_DIGEST(""), Make_TPM2B_DIGEST(""),
+      Make_TPM2B_DIGEST(policy_ref), expiration, signature, &timeout,
+      &policy_ticket, nullptr);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << "Error performing PolicySigned: " << GetErrorString(result);
+    return result;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC PolicySessionImpl::PolicySecret(TPMI_DH_ENTITY auth_entity,
+                                       const std::string& auth_entity_name,
+                                       AuthorizationDelegate* delegate) {
+  TPM2B_TIMEOUT timeout;
+  TPMT_TK_AUTH policy_ticket;
+  TPM_RC result = factory_.GetTpm()->PolicySecretSync(
+      auth_entity, auth_entity_name, session_manager_->GetSessionHandle(),
+      "",  // No policy name is needed as we do no authorization checks.
+      Make_TPM2B_DIGEST(""), Make_TPM2B_DIGEST(""), Make_TPM2B_DIGEST(""), 0,
+      &timeout, &policy_ticket, delegate);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << "Error performing PolicySecret: " << GetErrorString(result);
+    return result;
+  }
+  return TPM_RC_SUCCESS;
+}
+
 TPM_RC PolicySessionImpl::PolicyRestart() {
-  TPM_RC result = factory_.GetTpm()->PolicyAuthValueSync(
+  TPM_RC result = factory_.GetTpm()->PolicyRestartSync(
       session_manager_->GetSessionHandle(),
       "",  // No policy name is needed as we do no authorization checks.
       nullptr);
@@ -179,6 +241,117 @@ TPM_RC PolicySessionImpl::PolicyRestart() {
     LOG(ERROR) << "Error performing PolicyRestart: " << GetErrorString(result);
     return result;
   }
+  // The session no longer includes an authorization value in its HMAC.
+  hmac_delegate_.set_use_entity_authorization_for_encryption_only(true);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC PolicySessionImpl::ApplyPolicy(const PolicyTemplate& policy) {
+  typedef PolicyTemplate::AssertionType AssertionType;
+  const std::vector<PolicyTemplate::Assertion>& assertions =
+      policy.assertions();
+  TPMI_SH_POLICY session_handle = session_manager_->GetSessionHandle();
+  // No policy name is needed as we do no authorization checks.
+  const std::string policy_session_name;
+  std::vector<std::string> commands(assertions.size());
+  for (size_t i = 0; i < assertions.size(); ++i) {
+    const PolicyTemplate::Assertion& assertion = assertions[i];
+    TPM_RC result = TPM_RC_SUCCESS;
+    switch (assertion.type) {
+      case AssertionType::kCommandCode:
+        result = Tpm::SerializeCommand_PolicyCommandCode(
+            session_handle, policy_session_name, assertion.command_code,
+            &commands[i], nullptr);
+        break;
+      case AssertionType::kAuthValue:
+        result = Tpm::SerializeCommand_PolicyAuthValue(
+            session_handle, policy_session_name, &commands[i], nullptr);
+        break;
+      case AssertionType::kPCR: {
+        if (assertion.pcr_value.empty() && session_type_ == TPM_SE_TRIAL) {
+          LOG(ERROR) << "Trial sessions have to define a PCR value.";
+          return SAPI_RC_BAD_PARAMETER;
+        }
+        TPM2B_DIGEST pcr_digest = Make_TPM2B_DIGEST(
+            assertion.pcr_value.empty()
+                ? ""
+                : crypto::SHA256HashString(assertion.pcr_value));
+        result = Tpm::SerializeCommand_PolicyPCR(
+            session_handle, policy_session_name, pcr_digest,
+            PolicyTemplate::GetPCRSelection(assertion.pcr_index),
+            &commands[i], nullptr);
+        break;
+      }
+      case AssertionType::kOR: {
+        if (assertion.digests.size() > arraysize(TPML_DIGEST::digests)) {
+          LOG(ERROR) << "TPM2.0 Spec only allows for up to 8 digests.";
+          return SAPI_RC_BAD_PARAMETER;
+        }
+        TPML_DIGEST tpm_digests;
+        tpm_digests.count = assertion.digests.size();
+        for (size_t j = 0; j < assertion.digests.size(); ++j) {
+          tpm_digests.digests[j] = Make_TPM2B_DIGEST(assertion.digests[j]);
+        }
+        result = Tpm::SerializeCommand_PolicyOR(session_handle,
+                                                policy_session_name,
+                                                tpm_digests, &commands[i],
+                                                nullptr);
+        break;
+      }
+      case AssertionType::kAuthorize:
+      case AssertionType::kSigned:
+      case AssertionType::kSecret:
+        LOG(ERROR) << "PolicyAuthorize, PolicySigned and PolicySecret need a "
+                   << "ticket, signature or authorization and cannot be "
+                   << "applied from a template.";
+        return SAPI_RC_BAD_PARAMETER;
+    }
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << "Error serializing policy assertion " << i << ": "
+                 << GetErrorString(result);
+      return result;
+    }
+  }
+  if (commands.empty()) {
+    return TPM_RC_SUCCESS;
+  }
+  std::vector<std::string> responses =
+      factory_.GetTpm()->SendCommandBatchAndWait(commands);
+  for (size_t i = 0; i < assertions.size(); ++i) {
+    if (i >= responses.size()) {
+      LOG(ERROR) << "Missing response for policy assertion " << i << ".";
+      return TRUNKS_RC_IPC_ERROR;
+    }
+    TPM_RC result = TPM_RC_SUCCESS;
+    switch (assertions[i].type) {
+      case AssertionType::kCommandCode:
+        result = Tpm::ParseResponse_PolicyCommandCode(responses[i], nullptr);
+        break;
+      case AssertionType::kAuthValue:
+        result = Tpm::ParseResponse_PolicyAuthValue(responses[i], nullptr);
+        if (result == TPM_RC_SUCCESS) {
+          hmac_delegate_.set_use_entity_authorization_for_encryption_only(
+              false);
+        }
+        break;
+      case AssertionType::kPCR:
+        result = Tpm::ParseResponse_PolicyPCR(responses[i], nullptr);
+        break;
+      case AssertionType::kOR:
+        result = Tpm::ParseResponse_PolicyOR(responses[i], nullptr);
+        break;
+      case AssertionType::kAuthorize:
+      case AssertionType::kSigned:
+      case AssertionType::kSecret:
+        NOTREACHED();
+        break;
+    }
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << "Error applying policy assertion " << i << ": "
+                 << GetErrorString(result);
+      return result;
+    }
+  }
   return TPM_RC_SUCCESS;
 }
 
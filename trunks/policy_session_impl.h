@@ -55,12 +55,27 @@ class TRUNKS_EXPORT PolicySessionImpl : public PolicySession {
                            const std::string& bind_authorization_value,
                            bool enable_encryption) override;
   TPM_RC StartUnboundSession(bool enable_encryption) override;
+  void StartUnboundSessionAsync(bool enable_encryption,
+                                const StartSessionCallback& callback) override;
   TPM_RC GetDigest(std::string* digest) override;
   TPM_RC PolicyOR(const std::vector<std::string>& digests) override;
   TPM_RC PolicyPCR(uint32_t pcr_index, const std::string& pcr_value) override;
   TPM_RC PolicyCommandCode(TPM_CC command_code) override;
   TPM_RC PolicyAuthValue() override;
+  TPM_RC PolicyAuthorize(const std::string& approved_policy,
+                         const std::string& policy_ref,
+                         const std::string& key_name,
+                         const TPMT_TK_VERIFIED& ticket) override;
+  TPM_RC PolicySigned(TPMI_DH_OBJECT auth_object,
+                      const std::string& auth_object_name,
+                      const std::string& policy_ref,
+                      int32_t expiration,
+                      const TPMT_SIGNATURE& signature) override;
+  TPM_RC PolicySecret(TPMI_DH_ENTITY auth_entity,
+                      const std::string& auth_entity_name,
+                      AuthorizationDelegate* delegate) override;
   TPM_RC PolicyRestart() override;
+  TPM_RC ApplyPolicy(const PolicyTemplate& policy) override;
   void SetEntityAuthorizationValue(const std::string& value) override;
 
  private:
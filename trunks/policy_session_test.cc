@@ -21,17 +21,28 @@
 #include <gtest/gtest.h>
 
 #include "trunks/error_codes.h"
+#include "trunks/mock_authorization_delegate.h"
 #include "trunks/mock_session_manager.h"
 #include "trunks/mock_tpm.h"
+#include "trunks/policy_template.h"
 #include "trunks/tpm_generated.h"
 #include "trunks/trunks_factory_for_test.h"
 
 using testing::_;
+using testing::DoAll;
 using testing::NiceMock;
 using testing::Return;
 using testing::SaveArg;
 using testing::SetArgPointee;
 
+namespace {
+
+// Minimal TPM responses without sessions.
+const char kSuccessResponse[] = "\x80\x01\x00\x00\x00\x0a\x00\x00\x00\x00";
+const char kFailureResponse[] = "\x80\x01\x00\x00\x00\x0a\x00\x00\x01\x01";
+
+}  // namespace
+
 namespace trunks {
 
 class PolicySessionTest : public testing::Test {
@@ -214,13 +225,151 @@ TEST_F(PolicySessionTest, PolicyAuthValueFailure) {
   EXPECT_EQ(TPM_RC_FAILURE, session.PolicyAuthValue());
 }
 
+TEST_F(PolicySessionTest, PolicyAuthorizeSuccess) {
+  PolicySessionImpl session(factory_);
+  TPMT_TK_VERIFIED ticket = {};
+  ticket.tag = TPM_ST_VERIFIED;
+  ticket.hierarchy = TPM_RH_OWNER;
+  TPM2B_DIGEST approved_policy;
+  TPM2B_NONCE policy_ref;
+  TPM2B_NAME key_name;
+  EXPECT_CALL(mock_tpm_, PolicyAuthorizeSync(_, _, _, _, _, _, _))
+      .WillOnce(DoAll(SaveArg<2>(&approved_policy), SaveArg<3>(&policy_ref),
+                      SaveArg<4>(&key_name), Return(TPM_RC_SUCCESS)));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            session.PolicyAuthorize("approved", "ref", "key_name", ticket));
+  EXPECT_EQ("approved", StringFrom_TPM2B_DIGEST(approved_policy));
+  EXPECT_EQ("ref", StringFrom_TPM2B_DIGEST(policy_ref));
+  EXPECT_EQ("key_name", StringFrom_TPM2B_NAME(key_name));
+}
+
+TEST_F(PolicySessionTest, PolicyAuthorizeFailure) {
+  PolicySessionImpl session(factory_);
+  TPMT_TK_VERIFIED ticket = {};
+  EXPECT_CALL(mock_tpm_, PolicyAuthorizeSync(_, _, _, _, _, _, _))
+      .WillOnce(Return(TPM_RC_POLICY_FAIL));
+  EXPECT_EQ(TPM_RC_POLICY_FAIL,
+            session.PolicyAuthorize("approved", "ref", "key_name", ticket));
+}
+
+TEST_F(PolicySessionTest, PolicySignedSuccess) {
+  PolicySessionImpl session(factory_);
+  TPMT_SIGNATURE signature = {};
+  TPM2B_NONCE nonce_tpm;
+  TPM2B_NONCE policy_ref;
+  INT32 expiration = 0;
+  EXPECT_CALL(mock_tpm_,
+              PolicySignedSyncShort(TPM_RH_FIRST, _, _, _, _, _, _, _, _, _))
+      .WillOnce(DoAll(SaveArg<2>(&nonce_tpm), SaveArg<4>(&policy_ref),
+                      SaveArg<5>(&expiration), Return(TPM_RC_SUCCESS)));
+  EXPECT_EQ(TPM_RC_SUCCESS, session.PolicySigned(TPM_RH_FIRST, "name", "ref",
+                                                 -60, signature));
+  EXPECT_EQ(0, nonce_tpm.size);
+  EXPECT_EQ("ref", StringFrom_TPM2B_DIGEST(policy_ref));
+  EXPECT_EQ(-60, expiration);
+}
+
+TEST_F(PolicySessionTest, PolicySignedFailure) {
+  PolicySessionImpl session(factory_);
+  TPMT_SIGNATURE signature = {};
+  EXPECT_CALL(mock_tpm_, PolicySignedSyncShort(_, _, _, _, _, _, _, _, _, _))
+      .WillOnce(Return(TPM_RC_SIGNATURE));
+  EXPECT_EQ(TPM_RC_SIGNATURE,
+            session.PolicySigned(TPM_RH_FIRST, "name", "ref", 0, signature));
+}
+
+TEST_F(PolicySessionTest, PolicySecretSuccess) {
+  PolicySessionImpl session(factory_);
+  MockAuthorizationDelegate delegate;
+  EXPECT_CALL(mock_tpm_, PolicySecretSyncShort(TPM_RH_ENDORSEMENT, _, _, _, _,
+                                               _, _, _, &delegate))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            session.PolicySecret(TPM_RH_ENDORSEMENT, "name", &delegate));
+}
+
+TEST_F(PolicySessionTest, PolicySecretFailure) {
+  PolicySessionImpl session(factory_);
+  EXPECT_CALL(mock_tpm_, PolicySecretSyncShort(_, _, _, _, _, _, _, _, _))
+      .WillOnce(Return(TPM_RC_AUTH_FAIL));
+  EXPECT_EQ(TPM_RC_AUTH_FAIL,
+            session.PolicySecret(TPM_RH_ENDORSEMENT, "name", nullptr));
+}
+
+TEST_F(PolicySessionTest, PolicyRestartSuccess) {
+  PolicySessionImpl session(factory_);
+  EXPECT_CALL(mock_tpm_, PolicyAuthValueSync(_, _, _)).Times(0);
+  EXPECT_CALL(mock_tpm_, PolicyRestartSync(_, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_EQ(TPM_RC_SUCCESS, session.PolicyRestart());
+}
+
+TEST_F(PolicySessionTest, PolicyRestartFailure) {
+  PolicySessionImpl session(factory_);
+  EXPECT_CALL(mock_tpm_, PolicyRestartSync(_, _, _))
+      .WillOnce(Return(TPM_RC_FAILURE));
+  EXPECT_EQ(TPM_RC_FAILURE, session.PolicyRestart());
+}
+
+TEST_F(PolicySessionTest, ApplyPolicySendsOneBatch) {
+  PolicySessionImpl session(factory_);
+  PolicyTemplate policy;
+  policy.AddCommandCode(TPM_CC_NV_Read);
+  policy.AddAuthValue();
+  policy.AddPCR(0, "");
+  std::string success(kSuccessResponse, sizeof(kSuccessResponse) - 1);
+  std::vector<std::string> commands;
+  EXPECT_CALL(mock_tpm_, SendCommandBatchAndWait(_))
+      .WillOnce(DoAll(SaveArg<0>(&commands),
+                      Return(std::vector<std::string>(3, success))));
+  EXPECT_CALL(mock_tpm_, PolicyCommandCodeSync(_, _, _, _)).Times(0);
+  EXPECT_CALL(mock_tpm_, PolicyAuthValueSync(_, _, _)).Times(0);
+  EXPECT_CALL(mock_tpm_, PolicyPCRSync(_, _, _, _, _)).Times(0);
+  EXPECT_EQ(TPM_RC_SUCCESS, session.ApplyPolicy(policy));
+  ASSERT_EQ(3u, commands.size());
+  std::string expected_command;
+  EXPECT_EQ(TPM_RC_SUCCESS, Tpm::SerializeCommand_PolicyAuthValue(
+                                mock_session_manager_.GetSessionHandle(), "",
+                                &expected_command, nullptr));
+  EXPECT_EQ(expected_command, commands[1]);
+}
+
+TEST_F(PolicySessionTest, ApplyPolicyFailure) {
+  PolicySessionImpl session(factory_);
+  PolicyTemplate policy;
+  policy.AddCommandCode(TPM_CC_NV_Read);
+  policy.AddAuthValue();
+  std::vector<std::string> responses;
+  responses.push_back(std::string(kFailureResponse,
+                                  sizeof(kFailureResponse) - 1));
+  EXPECT_CALL(mock_tpm_, SendCommandBatchAndWait(_))
+      .WillOnce(Return(responses));
+  EXPECT_EQ(TPM_RC_FAILURE, session.ApplyPolicy(policy));
+}
+
+TEST_F(PolicySessionTest, ApplyPolicyTrialWithNoPCRValue) {
+  PolicySessionImpl session(factory_, TPM_SE_TRIAL);
+  PolicyTemplate policy;
+  policy.AddPCR(1, "");
+  EXPECT_CALL(mock_tpm_, SendCommandBatchAndWait(_)).Times(0);
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER, session.ApplyPolicy(policy));
+}
+
+TEST_F(PolicySessionTest, ApplyPolicyRejectsAuthorize) {
+  PolicySessionImpl session(factory_);
+  PolicyTemplate policy;
+  policy.AddAuthValue();
+  policy.AddAuthorize("key_name", "");
+  EXPECT_CALL(mock_tpm_, SendCommandBatchAndWait(_)).Times(0);
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER, session.ApplyPolicy(policy));
+}
+
 TEST_F(PolicySessionTest, EntityAuthorizationForwardingTest) {
   PolicySessionImpl session(factory_);
   std::string test_auth("test_auth");
   session.SetEntityAuthorizationValue(test_auth);
   HmacAuthorizationDelegate* hmac_delegate = GetHmacDelegate(&session);
-  std::string entity_auth = hmac_delegate->entity_authorization_value();
-  EXPECT_EQ(0, test_auth.compare(entity_auth));
+  EXPECT_TRUE(hmac_delegate->entity_authorization_value().Equals(test_auth));
 }
 
 }  // namespace trunks
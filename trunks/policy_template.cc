@@ -0,0 +1,200 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/policy_template.h"
+
+#include <string.h>
+
+#include <base/logging.h>
+#include <base/macros.h>
+#include <crypto/sha2.h>
+
+#include "trunks/error_codes.h"
+
+namespace {
+
+// Extends |digest| with the given command code and |data|:
+// digest = H(digest || command_code || data).
+void ExtendPolicyDigest(trunks::TPM_CC command_code,
+                        const std::string& data,
+                        std::string* digest) {
+  std::string command_code_bytes;
+  CHECK_EQ(trunks::Serialize_TPM_CC(command_code, &command_code_bytes),
+           trunks::TPM_RC_SUCCESS);
+  *digest = crypto::SHA256HashString(*digest + command_code_bytes + data);
+}
+
+}  // namespace
+
+namespace trunks {
+
+PolicyTemplate::PolicyTemplate() {}
+
+PolicyTemplate::PolicyTemplate(const PolicyTemplate& other) = default;
+
+PolicyTemplate::~PolicyTemplate() {}
+
+void PolicyTemplate::AddCommandCode(TPM_CC command_code) {
+  Assertion assertion;
+  assertion.type = AssertionType::kCommandCode;
+  assertion.command_code = command_code;
+  assertions_.push_back(assertion);
+}
+
+void PolicyTemplate::AddAuthValue() {
+  Assertion assertion;
+  assertion.type = AssertionType::kAuthValue;
+  assertions_.push_back(assertion);
+}
+
+void PolicyTemplate::AddPCR(uint32_t pcr_index, const std::string& pcr_value) {
+  Assertion assertion;
+  assertion.type = AssertionType::kPCR;
+  assertion.pcr_index = pcr_index;
+  assertion.pcr_value = pcr_value;
+  assertions_.push_back(assertion);
+}
+
+void PolicyTemplate::AddOR(const std::vector<std::string>& digests) {
+  Assertion assertion;
+  assertion.type = AssertionType::kOR;
+  assertion.digests = digests;
+  assertions_.push_back(assertion);
+}
+
+void PolicyTemplate::AddAuthorize(const std::string& key_name,
+                                  const std::string& policy_ref) {
+  Assertion assertion;
+  assertion.type = AssertionType::kAuthorize;
+  assertion.key_name = key_name;
+  assertion.policy_ref = policy_ref;
+  assertions_.push_back(assertion);
+}
+
+void PolicyTemplate::AddSigned(const std::string& key_name,
+                               const std::string& policy_ref) {
+  Assertion assertion;
+  assertion.type = AssertionType::kSigned;
+  assertion.key_name = key_name;
+  assertion.policy_ref = policy_ref;
+  assertions_.push_back(assertion);
+}
+
+void PolicyTemplate::AddSecret(const std::string& entity_name,
+                               const std::string& policy_ref) {
+  Assertion assertion;
+  assertion.type = AssertionType::kSecret;
+  assertion.key_name = entity_name;
+  assertion.policy_ref = policy_ref;
+  assertions_.push_back(assertion);
+}
+
+TPM_RC PolicyTemplate::ComputeDigest(std::string* digest) const {
+  CHECK(digest);
+  std::string policy_digest(crypto::kSHA256Length, 0);
+  TPM_RC result = ExtendDigest(&policy_digest);
+  if (result != TPM_RC_SUCCESS) {
+    return result;
+  }
+  *digest = policy_digest;
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC PolicyTemplate::ExtendDigest(std::string* digest) const {
+  CHECK(digest);
+  std::string policy_digest = *digest;
+  for (const Assertion& assertion : assertions_) {
+    switch (assertion.type) {
+      case AssertionType::kCommandCode: {
+        std::string code_bytes;
+        CHECK_EQ(Serialize_TPM_CC(assertion.command_code, &code_bytes),
+                 TPM_RC_SUCCESS);
+        ExtendPolicyDigest(TPM_CC_PolicyCommandCode, code_bytes,
+                           &policy_digest);
+        break;
+      }
+      case AssertionType::kAuthValue:
+        ExtendPolicyDigest(TPM_CC_PolicyAuthValue, "", &policy_digest);
+        break;
+      case AssertionType::kPCR: {
+        if (assertion.pcr_value.empty()) {
+          LOG(ERROR) << "Computing a PCR policy digest requires a PCR value.";
+          return SAPI_RC_BAD_PARAMETER;
+        }
+        std::string pcr_data;
+        CHECK_EQ(Serialize_TPML_PCR_SELECTION(
+                     GetPCRSelection(assertion.pcr_index), &pcr_data),
+                 TPM_RC_SUCCESS);
+        pcr_data += crypto::SHA256HashString(assertion.pcr_value);
+        ExtendPolicyDigest(TPM_CC_PolicyPCR, pcr_data, &policy_digest);
+        break;
+      }
+      case AssertionType::kOR: {
+        if (assertion.digests.size() < 2 ||
+            assertion.digests.size() > arraysize(TPML_DIGEST::digests)) {
+          LOG(ERROR) << "PolicyOR needs between 2 and 8 digests.";
+          return SAPI_RC_BAD_PARAMETER;
+        }
+        std::string or_data;
+        for (const std::string& branch : assertion.digests) {
+          or_data += branch;
+        }
+        policy_digest.assign(crypto::kSHA256Length, 0);
+        ExtendPolicyDigest(TPM_CC_PolicyOR, or_data, &policy_digest);
+        break;
+      }
+      case AssertionType::kAuthorize:
+        // Like PolicyOR, PolicyAuthorize replaces the approved digest.
+        policy_digest.assign(crypto::kSHA256Length, 0);
+        ExtendPolicyDigest(TPM_CC_PolicyAuthorize, assertion.key_name,
+                           &policy_digest);
+        policy_digest =
+            crypto::SHA256HashString(policy_digest + assertion.policy_ref);
+        break;
+      case AssertionType::kSigned:
+        ExtendPolicyDigest(TPM_CC_PolicySigned, assertion.key_name,
+                           &policy_digest);
+        policy_digest =
+            crypto::SHA256HashString(policy_digest + assertion.policy_ref);
+        break;
+      case AssertionType::kSecret:
+        ExtendPolicyDigest(TPM_CC_PolicySecret, assertion.key_name,
+                           &policy_digest);
+        policy_digest =
+            crypto::SHA256HashString(policy_digest + assertion.policy_ref);
+        break;
+    }
+  }
+  *digest = policy_digest;
+  return TPM_RC_SUCCESS;
+}
+
+TPML_PCR_SELECTION PolicyTemplate::GetPCRSelection(uint32_t pcr_index) {
+  TPML_PCR_SELECTION pcr_select;
+  memset(&pcr_select, 0, sizeof(TPML_PCR_SELECTION));
+  // This process of selecting pcrs is highlighted in TPM 2.0 Library Spec
+  // Part 2 (Section 10.5 - PCR structures).
+  uint8_t pcr_select_index = pcr_index / 8;
+  uint8_t pcr_select_byte = 1 << (pcr_index % 8);
+  pcr_select.count = 1;
+  pcr_select.pcr_selections[0].hash = TPM_ALG_SHA256;
+  pcr_select.pcr_selections[0].sizeof_select = PCR_SELECT_MIN;
+  pcr_select.pcr_selections[0].pcr_select[pcr_select_index] = pcr_select_byte;
+  return pcr_select;
+}
+
+}  // namespace trunks
@@ -0,0 +1,106 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef TRUNKS_POLICY_TEMPLATE_H_
+#define TRUNKS_POLICY_TEMPLATE_H_
+
+#include <string>
+#include <vector>
+
+#include "trunks/tpm_generated.h"
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+// PolicyTemplate describes a sequence of policy assertions. The policy digest
+// it produces can be computed in software, without a trial session, and
+// PolicySession::ApplyPolicy() sends the matching policy commands to a session
+// as a single batch. Example:
+//
+// PolicyTemplate policy;
+// policy.AddCommandCode(TPM_CC_NV_Read);
+// policy.AddAuthValue();
+// std::string digest;
+// policy.ComputeDigest(&digest);
+class TRUNKS_EXPORT PolicyTemplate {
+ public:
+  enum class AssertionType {
+    kCommandCode,
+    kAuthValue,
+    kPCR,
+    kOR,
+    kAuthorize,
+    kSigned,
+    kSecret,
+  };
+
+  struct Assertion {
+    AssertionType type;
+    // For kCommandCode.
+    TPM_CC command_code;
+    // For kPCR. An empty |pcr_value| binds a policy session to the current
+    // value of the PCR; ComputeDigest() requires a value.
+    uint32_t pcr_index;
+    std::string pcr_value;
+    // For kOR.
+    std::vector<std::string> digests;
+    // For kAuthorize, kSigned and kSecret. The name of the authority key or
+    // entity and the policy reference it is used with.
+    std::string key_name;
+    std::string policy_ref;
+  };
+
+  PolicyTemplate();
+  PolicyTemplate(const PolicyTemplate& other);
+  ~PolicyTemplate();
+
+  // These append assertions equivalent to the PolicySession methods of the
+  // same name.
+  void AddCommandCode(TPM_CC command_code);
+  void AddAuthValue();
+  void AddPCR(uint32_t pcr_index, const std::string& pcr_value);
+  void AddOR(const std::vector<std::string>& digests);
+  // These only describe the digest. A TPM policy session also needs a ticket,
+  // signature or authorization for them, so PolicySessionImpl::ApplyPolicy()
+  // rejects them; use PolicySession::PolicyAuthorize(), PolicySigned() and
+  // PolicySecret().
+  void AddAuthorize(const std::string& key_name, const std::string& policy_ref);
+  void AddSigned(const std::string& key_name, const std::string& policy_ref);
+  void AddSecret(const std::string& entity_name, const std::string& policy_ref);
+
+  // Computes the SHA-256 policy digest a session holds after the assertions
+  // have been applied in order, as specified in TPM 2.0 Part 3 Section 23.
+  // Like a trial session, a PolicyOR does not require the current digest to be
+  // one of its branches.
+  TPM_RC ComputeDigest(std::string* digest) const;
+
+  // Applies the assertions in order to the policy |digest| a session already
+  // holds. |digest| is left unchanged on failure.
+  TPM_RC ExtendDigest(std::string* digest) const;
+
+  const std::vector<Assertion>& assertions() const { return assertions_; }
+
+  // Returns the selection of the single SHA-256 bank PCR |pcr_index|.
+  static TPML_PCR_SELECTION GetPCRSelection(uint32_t pcr_index);
+
+ private:
+  std::vector<Assertion> assertions_;
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_POLICY_TEMPLATE_H_
@@ -0,0 +1,176 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/policy_template.h"
+
+#include <string>
+#include <vector>
+
+#include <base/strings/string_number_conversions.h>
+#include <crypto/sha2.h>
+#include <gtest/gtest.h>
+
+#include "trunks/error_codes.h"
+
+namespace trunks {
+
+namespace {
+
+std::string HexToString(const std::string& hex) {
+  std::vector<uint8_t> bytes;
+  CHECK(base::HexStringToBytes(hex, &bytes));
+  return std::string(bytes.begin(), bytes.end());
+}
+
+}  // namespace
+
+TEST(PolicyTemplateTest, EmptyPolicy) {
+  PolicyTemplate policy;
+  std::string digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&digest));
+  EXPECT_EQ(std::string(crypto::kSHA256Length, 0), digest);
+}
+
+TEST(PolicyTemplateTest, AuthValueDigest) {
+  // The well-known digest of a session after TPM2_PolicyAuthValue.
+  PolicyTemplate policy;
+  policy.AddAuthValue();
+  std::string digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&digest));
+  EXPECT_EQ(HexToString("8fcd2169ab92694e0c633f1ab772842b"
+                        "8241bbc20288981fc7ac1eddc1fddb0e"),
+            digest);
+}
+
+TEST(PolicyTemplateTest, CommandCodeDigest) {
+  PolicyTemplate policy;
+  policy.AddCommandCode(TPM_CC_NV_Read);
+  std::string digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&digest));
+  EXPECT_EQ(HexToString("47ce3032d8bad1f3089cb0c09088de43"
+                        "501491d460402b90cd1b7fc0b68ca92f"),
+            digest);
+}
+
+TEST(PolicyTemplateTest, PCRRequiresValue) {
+  PolicyTemplate policy;
+  policy.AddPCR(0, "");
+  std::string digest;
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER, policy.ComputeDigest(&digest));
+  PolicyTemplate other_policy;
+  other_policy.AddPCR(0, "pcr_value");
+  EXPECT_EQ(TPM_RC_SUCCESS, other_policy.ComputeDigest(&digest));
+}
+
+TEST(PolicyTemplateTest, ORDigest) {
+  PolicyTemplate read_policy;
+  read_policy.AddCommandCode(TPM_CC_NV_Read);
+  std::string read_digest;
+  ASSERT_EQ(TPM_RC_SUCCESS, read_policy.ComputeDigest(&read_digest));
+  PolicyTemplate write_policy;
+  write_policy.AddCommandCode(TPM_CC_NV_Write);
+  std::string write_digest;
+  ASSERT_EQ(TPM_RC_SUCCESS, write_policy.ComputeDigest(&write_digest));
+  std::vector<std::string> digests = {read_digest, write_digest};
+  // Both branches lead to the same digest.
+  read_policy.AddOR(digests);
+  write_policy.AddOR(digests);
+  std::string expected_digest = crypto::SHA256HashString(
+      std::string(crypto::kSHA256Length, 0) +
+      HexToString("00000171") + read_digest + write_digest);
+  std::string digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, read_policy.ComputeDigest(&digest));
+  EXPECT_EQ(expected_digest, digest);
+  EXPECT_EQ(TPM_RC_SUCCESS, write_policy.ComputeDigest(&digest));
+  EXPECT_EQ(expected_digest, digest);
+}
+
+TEST(PolicyTemplateTest, ExtendDigest) {
+  PolicyTemplate policy;
+  policy.AddCommandCode(TPM_CC_NV_Read);
+  policy.AddAuthValue();
+  std::string expected_digest;
+  ASSERT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&expected_digest));
+  PolicyTemplate first;
+  first.AddCommandCode(TPM_CC_NV_Read);
+  PolicyTemplate second;
+  second.AddAuthValue();
+  std::string digest(crypto::kSHA256Length, 0);
+  EXPECT_EQ(TPM_RC_SUCCESS, first.ExtendDigest(&digest));
+  EXPECT_EQ(TPM_RC_SUCCESS, second.ExtendDigest(&digest));
+  EXPECT_EQ(expected_digest, digest);
+}
+
+TEST(PolicyTemplateTest, ExtendDigestFailureLeavesDigest) {
+  PolicyTemplate policy;
+  policy.AddAuthValue();
+  policy.AddPCR(0, "");
+  std::string digest(crypto::kSHA256Length, 0);
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER, policy.ExtendDigest(&digest));
+  EXPECT_EQ(std::string(crypto::kSHA256Length, 0), digest);
+}
+
+TEST(PolicyTemplateTest, ORBadParam) {
+  PolicyTemplate policy;
+  policy.AddOR({std::string(crypto::kSHA256Length, 0)});
+  std::string digest;
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER, policy.ComputeDigest(&digest));
+}
+
+TEST(PolicyTemplateTest, AuthorizeDigest) {
+  // PolicyAuthorize discards the approved digest before extending.
+  PolicyTemplate policy;
+  policy.AddAuthValue();
+  policy.AddAuthorize("key_name", "ref");
+  std::string expected_digest = crypto::SHA256HashString(
+      crypto::SHA256HashString(std::string(crypto::kSHA256Length, 0) +
+                               HexToString("0000016a") + "key_name") +
+      "ref");
+  std::string digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&digest));
+  EXPECT_EQ(expected_digest, digest);
+}
+
+TEST(PolicyTemplateTest, SignedDigest) {
+  PolicyTemplate first;
+  first.AddAuthValue();
+  std::string digest;
+  ASSERT_EQ(TPM_RC_SUCCESS, first.ComputeDigest(&digest));
+  std::string expected_digest = crypto::SHA256HashString(
+      crypto::SHA256HashString(digest + HexToString("00000160") + "key_name") +
+      "ref");
+  PolicyTemplate policy;
+  policy.AddAuthValue();
+  policy.AddSigned("key_name", "ref");
+  EXPECT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&digest));
+  EXPECT_EQ(expected_digest, digest);
+}
+
+TEST(PolicyTemplateTest, SecretDigest) {
+  // The default TCG endorsement key policy: PolicySecret(TPM_RH_ENDORSEMENT).
+  std::string endorsement_name;
+  Serialize_TPM_HANDLE(TPM_RH_ENDORSEMENT, &endorsement_name);
+  PolicyTemplate policy;
+  policy.AddSecret(endorsement_name, "");
+  std::string digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&digest));
+  EXPECT_EQ(HexToString("837197674484b3f81a90cc8d46a5d724"
+                        "fd52d76e06520b64f2a1da1b331469aa"),
+            digest);
+}
+
+}  // namespace trunks
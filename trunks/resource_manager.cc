@@ -17,13 +17,21 @@
 #include "trunks/resource_manager.h"
 
 #include <algorithm>
+#include <functional>
+#include <iterator>
 #include <map>
 #include <set>
 #include <string>
 #include <vector>
 
 #include <base/callback.h>
+#include <base/stl_util.h>
+#include <base/files/file_util.h>
+#include <base/files/important_file_writer.h>
+#include <crypto/sha2.h>
+#include <openssl/rand.h>
 
+#include "trunks/boot_trace.h"
 #include "trunks/error_codes.h"
 
 namespace {
@@ -31,8 +39,130 @@ namespace {
 const int kMaxCommandAttempts = 3;
 const size_t kMinimumAuthorizationSize = 9;
 const size_t kMessageHeaderSize = 10;
+// The command code follows the tag and size fields of a command header.
+const size_t kCommandCodeOffset = 6;
 const trunks::TPM_HANDLE kMaxVirtualHandle =
     (trunks::HR_TRANSIENT + trunks::HR_HANDLE_MASK);
+// A flushed virtual handle is not reused until this many others have been
+// flushed after it, unless every handle has been used once already. This makes
+// it unlikely that a stale handle kept by a client refers to another object.
+const size_t kMinFreeVirtualHandles = 64;
+// The TPM holds no more than a few dozen saved sessions at a time so this
+// bound is only reached if callers save contexts which they never load or
+// flush.
+const size_t kMaxExternalContexts = 256;
+// The number of object and session slots PerformIdleMaintenance() keeps free.
+// Most commands need at most one new slot of each kind.
+const trunks::UINT32 kMinFreeObjectSlots = 1;
+const trunks::UINT32 kMinFreeSessionSlots = 1;
+// The most saved sessions refreshed in one idle period, bounding how long a
+// command arriving meanwhile may wait.
+const size_t kMaxSessionRefreshesPerIdle = 4;
+// HandleInfo::context_slot of a context which is not in the context store.
+const uint32_t kNoContextSlot = 0xFFFFFFFF;
+// State file record types. Each record is prefixed with its size.
+const trunks::UINT32 kStateRecordHeader = 1;
+const trunks::UINT32 kStateRecordHandle = 2;
+const trunks::UINT32 kStateRecordRemoved = 3;
+// The state file is compacted after this many appended records.
+const size_t kMaxJournalRecords = 1024;
+// The most sessions kept for reuse after their owners flushed them. Each one
+// still takes a TPM session slot, so this stays below the few slots a TPM has.
+const size_t kMaxParkedSessions = 2;
+// The number of distinct key blobs whose Loads are counted. When full, the
+// least loaded blob is forgotten to make room.
+const size_t kMaxTrackedKeyBlobs = 64;
+// The algorithms trunks uses, self-tested one per housekeeping step.
+const trunks::TPM_ALG_ID kSelfTestAlgorithms[] = {
+    trunks::TPM_ALG_RSA, trunks::TPM_ALG_SHA256, trunks::TPM_ALG_SHA1,
+    trunks::TPM_ALG_HMAC, trunks::TPM_ALG_AES, trunks::TPM_ALG_ECC,
+};
+// How often housekeeping stirs the TPM random number generator, and with how
+// many bytes of host entropy.
+const int kStirRandomIntervalMinutes = 60;
+const size_t kStirRandomBytes = 32;
+
+// Returns the key used for |context_blob| in the context tables.
+std::string GetContextDigest(base::StringPiece context_blob) {
+  return crypto::SHA256HashString(context_blob);
+}
+
+// Returns true if |selection| selects no PCRs.
+bool IsPcrSelectionEmpty(const trunks::TPML_PCR_SELECTION& selection) {
+  for (trunks::UINT32 i = 0; i < selection.count; ++i) {
+    for (trunks::UINT8 j = 0; j < selection.pcr_selections[i].sizeof_select;
+         ++j) {
+      if (selection.pcr_selections[i].pcr_select[j]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Reads big-endian TPM fields from a message without copying it. Every method
+// returns false, leaving the reader unchanged, if the data is too short.
+class MessageReader {
+ public:
+  explicit MessageReader(base::StringPiece data) : data_(data) {}
+
+  bool ReadUint8(trunks::UINT8* value) {
+    trunks::UINT32 wide_value = 0;
+    if (!Read(1, &wide_value)) {
+      return false;
+    }
+    *value = static_cast<trunks::UINT8>(wide_value);
+    return true;
+  }
+
+  bool ReadUint16(trunks::UINT16* value) {
+    trunks::UINT32 wide_value = 0;
+    if (!Read(2, &wide_value)) {
+      return false;
+    }
+    *value = static_cast<trunks::UINT16>(wide_value);
+    return true;
+  }
+
+  bool ReadUint32(trunks::UINT32* value) { return Read(4, value); }
+
+  // Skips a sized buffer, i.e. any TPM2B structure.
+  bool SkipSized() {
+    base::StringPiece buffer;
+    return ReadSized(&buffer);
+  }
+
+  // Reads the contents of a sized buffer, i.e. any TPM2B structure.
+  bool ReadSized(base::StringPiece* buffer) {
+    base::StringPiece saved = data_;
+    trunks::UINT16 size = 0;
+    if (!ReadUint16(&size) || data_.size() < size) {
+      data_ = saved;
+      return false;
+    }
+    *buffer = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return true;
+  }
+
+  base::StringPiece remaining() const { return data_; }
+
+ private:
+  bool Read(size_t num_bytes, trunks::UINT32* value) {
+    if (data_.size() < num_bytes) {
+      return false;
+    }
+    trunks::UINT32 result = 0;
+    for (size_t i = 0; i < num_bytes; ++i) {
+      result = (result << 8) | static_cast<trunks::UINT8>(data_[i]);
+    }
+    data_.remove_prefix(num_bytes);
+    *value = result;
+    return true;
+  }
+
+  base::StringPiece data_;
+};
 
 class ScopedBool {
  public:
@@ -57,40 +187,199 @@ namespace trunks {
 
 ResourceManager::ResourceManager(const TrunksFactory& factory,
                                  CommandTransceiver* next_transceiver)
-    : factory_(factory), next_transceiver_(next_transceiver) {}
+    : factory_(factory), next_transceiver_(next_transceiver) {
+  uint64_t instance = 0;
+  CHECK_EQ(RAND_bytes(reinterpret_cast<uint8_t*>(&instance), sizeof(instance)),
+           1);
+  state_epochs_.set_instance(instance);
+}
 
 ResourceManager::~ResourceManager() {}
 
 void ResourceManager::Initialize() {
+  ScopedBootTracePhase phase("ResourceManager::Initialize");
   // Abort if the TPM is not in a reasonable state and we can't get it into one.
   std::unique_ptr<TpmUtility> tpm_utility = factory_.GetTpmUtility();
-  CHECK_EQ(tpm_utility->Startup(), TPM_RC_SUCCESS);
+  if (idle_housekeeping_) {
+    // Self-tests are left to idle housekeeping.
+    TPM_RC result = factory_.GetTpm()->StartupSync(TPM_SU_CLEAR, nullptr);
+    // TPM_RC_INITIALIZE means it was already started.
+    CHECK(result == TPM_RC_SUCCESS || result == TPM_RC_INITIALIZE)
+        << GetErrorString(result);
+  } else {
+    CHECK_EQ(tpm_utility->Startup(), TPM_RC_SUCCESS);
+  }
   CHECK_EQ(tpm_utility->InitializeTpm(), TPM_RC_SUCCESS);
+  if (!context_spill_file_.empty()) {
+    // Contexts are kept in memory if the store cannot be created.
+    context_store_.reset(new ContextStore(context_spill_file_));
+    if (!context_store_->Init()) {
+      context_store_.reset();
+    }
+  }
+  if (!state_file_.empty()) {
+    ScopedBootTracePhase restore_phase("ResourceManager::RestoreState");
+    if (RestoreState()) {
+      LOG(INFO) << "Restored " << virtual_object_handles_.size()
+                << " objects and " << session_handles_.size()
+                << " sessions.";
+    }
+  }
   // Full control of the TPM is assumed and required. Existing transient object
-  // and session handles are mercilessly flushed.
-  for (UINT32 handle_type :
-       {HR_TRANSIENT, HR_HMAC_SESSION, HR_POLICY_SESSION}) {
-    TPMI_YES_NO more_data = YES;
+  // and session handles not restored above are mercilessly flushed, although
+  // not before they are needed.
+  {
+    ScopedBootTracePhase synchronize_phase(
+        "ResourceManager::SynchronizeWithTpm");
+    SynchronizeWithTpm();
+  }
+  if (!state_file_.empty()) {
+    WriteCheckpoint();
+  }
+  if (pcr_shadow_enabled_) {
+    SeedPcrShadow();
+  }
+}
+
+bool ResourceManager::PerformIdleMaintenance() {
+  // No command is being processed so nothing needs to be retained.
+  MessageInfo idle_info = MessageInfo();
+  FlushPendingHandles();
+  RefreshOldSessions(idle_info);
+  if (idle_eviction_) {
+    FreeIdleSlots(idle_info);
+  }
+  if (context_store_) {
+    SpillIdleContexts();
+  }
+  return idle_housekeeping_ && PerformHousekeepingStep();
+}
+
+bool ResourceManager::PerformHousekeepingStep() {
+  if (next_self_test_ < arraysize(kSelfTestAlgorithms)) {
+    TPML_ALG to_test = {};
+    to_test.count = 1;
+    to_test.algorithms[0] = kSelfTestAlgorithms[next_self_test_++];
+    TPML_ALG to_do_list;
+    TPM_RC result = factory_.GetTpm()->IncrementalSelfTestSync(
+        to_test, &to_do_list, nullptr);
+    // An algorithm the TPM does not implement is reported and skipped.
+    LOG_IF(WARNING, result != TPM_RC_SUCCESS)
+        << "Self-test of algorithm 0x" << std::hex << to_test.algorithms[0]
+        << " failed: " << GetErrorString(result);
+    return true;
+  }
+  base::TimeTicks now = base::TimeTicks::Now();
+  if (last_stir_random_.is_null() ||
+      now - last_stir_random_ >=
+          base::TimeDelta::FromMinutes(kStirRandomIntervalMinutes)) {
+    TPM2B_SENSITIVE_DATA entropy = {};
+    entropy.size = kStirRandomBytes;
+    CHECK_EQ(RAND_bytes(entropy.buffer, entropy.size), 1)
+        << "Error generating entropy for the TPM.";
+    TPM_RC result = factory_.GetTpm()->StirRandomSync(entropy, nullptr);
+    LOG_IF(WARNING, result != TPM_RC_SUCCESS)
+        << "Failed to stir TPM random number generator: "
+        << GetErrorString(result);
+    last_stir_random_ = now;
+  }
+  return false;
+}
+
+void ResourceManager::FreeIdleSlots(const MessageInfo& idle_info) {
+  TPMI_YES_NO more_data = NO;
+  TPMS_CAPABILITY_DATA data;
+  TPM_RC result = factory_.GetTpm()->GetCapabilitySync(
+      TPM_CAP_TPM_PROPERTIES, TPM_PT_HR_LOADED_AVAIL,
+      TPM_PT_HR_TRANSIENT_AVAIL - TPM_PT_HR_LOADED_AVAIL + 1, &more_data, &data,
+      nullptr);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(WARNING) << "Failed to query free TPM slots: "
+                 << GetErrorString(result);
+    return;
+  }
+  UINT32 free_session_slots = kMinFreeSessionSlots;
+  UINT32 free_object_slots = kMinFreeObjectSlots;
+  const TPML_TAGGED_TPM_PROPERTY& properties = data.data.tpm_properties;
+  for (UINT32 i = 0; i < properties.count; ++i) {
+    if (properties.tpm_property[i].property == TPM_PT_HR_LOADED_AVAIL) {
+      free_session_slots = properties.tpm_property[i].value;
+      session_slots_ = CountLoadedSessions() + free_session_slots;
+    } else if (properties.tpm_property[i].property ==
+               TPM_PT_HR_TRANSIENT_AVAIL) {
+      free_object_slots = properties.tpm_property[i].value;
+      // Full control of the TPM is assumed so this is exact.
+      object_slots_ = CountLoadedObjects() + free_object_slots;
+    }
+  }
+  for (; free_object_slots < kMinFreeObjectSlots; ++free_object_slots) {
+    size_t loaded = CountLoadedObjects();
+    if (loaded == 0) {
+      break;
+    }
+    EvictObjects(idle_info, EVICTION_REASON_IDLE);
+    if (CountLoadedObjects() >= loaded) {
+      break;
+    }
+    VLOG(1) << "IDLE_EVICT_OBJECT";
+  }
+  for (; free_session_slots < kMinFreeSessionSlots; ++free_session_slots) {
+    size_t loaded = CountLoadedSessions();
+    if (loaded == 0) {
+      break;
+    }
+    EvictSession(idle_info, EVICTION_REASON_IDLE);
+    if (CountLoadedSessions() >= loaded) {
+      break;
+    }
+    VLOG(1) << "IDLE_EVICT_SESSION";
+  }
+}
+
+void ResourceManager::RefreshOldSessions(const MessageInfo& idle_info) {
+  std::vector<TPM_HANDLE> saved_sessions;
+  for (const auto& item : session_handles_) {
+    if (!item.second.is_loaded) {
+      saved_sessions.push_back(item.first);
+    }
+  }
+  if (saved_sessions.empty()) {
+    return;
+  }
+  if (context_gap_max_ == 0) {
+    TPMI_YES_NO more_data = NO;
     TPMS_CAPABILITY_DATA data;
-    UINT32 handle_range = handle_type;
-    while (more_data) {
-      TPM_RC result = factory_.GetTpm()->GetCapabilitySync(
-          TPM_CAP_HANDLES, handle_range, MAX_CAP_HANDLES, &more_data, &data,
-          nullptr);
-      if (result != TPM_RC_SUCCESS) {
-        LOG(WARNING) << "Failed to query existing handles: "
-                     << GetErrorString(result);
-        break;
-      }
-      const TPML_HANDLE& handle_list = data.data.handles;
-      for (UINT32 i = 0; i < handle_list.count; ++i) {
-        factory_.GetTpm()->FlushContextSync(handle_list.handle[i], nullptr);
-      }
-      if (more_data) {
-        // Adjust the range to be greater than the most recent handle so on the
-        // next query we'll start where we left off.
-        handle_range = handle_list.handle[handle_list.count - 1];
-      }
+    TPM_RC result = factory_.GetTpm()->GetCapabilitySync(
+        TPM_CAP_TPM_PROPERTIES, TPM_PT_CONTEXT_GAP_MAX, 1, &more_data, &data,
+        nullptr);
+    if (result != TPM_RC_SUCCESS || data.data.tpm_properties.count != 1 ||
+        data.data.tpm_properties.tpm_property[0].property !=
+            TPM_PT_CONTEXT_GAP_MAX) {
+      LOG(WARNING) << "Failed to query the context gap limit: "
+                   << GetErrorString(result);
+      return;
+    }
+    context_gap_max_ = data.data.tpm_properties.tpm_property[0].value;
+  }
+  std::sort(saved_sessions.begin(), saved_sessions.end(),
+            [this](TPM_HANDLE a, TPM_HANDLE b) {
+              return (session_handles_[a].context_sequence <
+                      session_handles_[b].context_sequence);
+            });
+  // Sessions are refreshed once they are halfway to the limit so there are
+  // many idle periods in which to catch up before the TPM would fail.
+  size_t attempts = 0;
+  for (TPM_HANDLE handle : saved_sessions) {
+    UINT64 distance =
+        newest_context_sequence_ - session_handles_[handle].context_sequence;
+    if (attempts++ == kMaxSessionRefreshesPerIdle ||
+        distance < context_gap_max_ / 2) {
+      break;
+    }
+    if (RefreshSessionContext(idle_info, handle)) {
+      VLOG(1) << "IDLE_REFRESH_SESSION: " << std::hex << handle;
+      base::AutoLock lock(counters_lock_);
+      ++counters_.session_refreshes;
     }
   }
 }
@@ -101,6 +390,88 @@ void ResourceManager::SendCommand(const std::string& command,
 }
 
 std::string ResourceManager::SendCommandAndWait(const std::string& command) {
+  base::TimeTicks start = base::TimeTicks::Now();
+  command_round_trips_ = 0;
+  command_tpm_time_ = base::TimeDelta();
+  TPM_CC code = 0;
+  std::string response = ProcessCommand(command, &code);
+  base::TimeDelta latency = base::TimeTicks::Now() - start;
+  base::AutoLock lock(counters_lock_);
+  CommandCounts& counts = counters_.commands[code];
+  ++counts.count;
+  counts.tpm_round_trips += command_round_trips_;
+  counts.total_latency.Add(latency);
+  counts.tpm_latency.Add(command_tpm_time_);
+  counters_.active_sessions = session_handles_.size();
+  counters_.parked_sessions = parked_sessions_.size();
+  counters_.loaded_objects = CountLoadedObjects();
+  counters_.loaded_sessions = CountLoadedSessions();
+  counters_.spilled_contexts =
+      context_store_ ? context_store_->used_slots() : 0;
+  return response;
+}
+
+void ResourceManager::GetStateEpochs(TpmStateEpochs* epochs) const {
+  base::AutoLock lock(counters_lock_);
+  *epochs = state_epochs_;
+}
+
+void ResourceManager::AddQueueLatency(const std::string& command,
+                                      base::TimeDelta queue_latency) {
+  // Commands too short to carry a code are counted under zero, as in
+  // SendCommandAndWait().
+  TPM_CC code = 0;
+  if (command.size() >= kMessageHeaderSize) {
+    std::string buffer = command.substr(kCommandCodeOffset, sizeof(TPM_CC));
+    Parse_TPM_CC(&buffer, &code, nullptr);
+  }
+  base::AutoLock lock(counters_lock_);
+  counters_.commands[code].queue_latency.Add(queue_latency);
+}
+
+void ResourceManager::GetStats(ResourceManagerStats* stats) const {
+  stats->Clear();
+  base::AutoLock lock(counters_lock_);
+  for (const auto& item : counters_.commands) {
+    CommandStats* command_stats = stats->add_commands();
+    command_stats->set_command_code(item.first);
+    command_stats->set_count(item.second.count);
+    command_stats->set_tpm_round_trips(item.second.tpm_round_trips);
+    item.second.total_latency.ToProto(command_stats->mutable_total_latency());
+    item.second.tpm_latency.ToProto(command_stats->mutable_tpm_latency());
+    item.second.queue_latency.ToProto(command_stats->mutable_queue_latency());
+  }
+  for (int reason = 0; reason < EvictionReason_ARRAYSIZE; ++reason) {
+    EvictionStats* eviction_stats = stats->add_evictions();
+    eviction_stats->set_reason(static_cast<EvictionReason>(reason));
+    eviction_stats->set_objects(counters_.objects_evicted[reason]);
+    eviction_stats->set_sessions(counters_.sessions_evicted[reason]);
+  }
+  stats->set_context_loads(counters_.context_loads);
+  stats->set_context_saves(counters_.context_saves);
+  stats->set_context_gap_fixes(counters_.context_gap_fixes);
+  stats->set_session_refreshes(counters_.session_refreshes);
+  stats->set_warning_retries(counters_.warning_retries);
+  stats->set_sessions_started(counters_.sessions_started);
+  stats->set_sessions_parked(counters_.sessions_parked);
+  stats->set_sessions_reused(counters_.sessions_reused);
+  stats->set_active_sessions(counters_.active_sessions);
+  stats->set_parked_sessions(counters_.parked_sessions);
+  stats->set_loaded_objects(counters_.loaded_objects);
+  stats->set_loaded_sessions(counters_.loaded_sessions);
+  stats->set_retry_warnings(counters_.retry_warnings);
+  stats->set_yielded_warnings(counters_.yielded_warnings);
+  stats->set_testing_warnings(counters_.testing_warnings);
+  stats->set_key_reloads(counters_.key_reloads);
+  stats->set_hottest_key_loads(counters_.hottest_key_loads);
+  stats->set_shadow_pcr_reads(counters_.shadow_pcr_reads);
+  stats->set_context_spills(counters_.context_spills);
+  stats->set_spilled_context_loads(counters_.spilled_context_loads);
+  stats->set_spilled_contexts(counters_.spilled_contexts);
+}
+
+std::string ResourceManager::ProcessCommand(const std::string& command,
+                                            TPM_CC* code) {
   // Sanitize the |command|. If this succeeds consistency of the command header
   // and the size of all other sections can be assumed.
   MessageInfo command_info;
@@ -108,13 +479,50 @@ std::string ResourceManager::SendCommandAndWait(const std::string& command) {
   if (result != TPM_RC_SUCCESS) {
     return CreateErrorResponse(result);
   }
+  *code = command_info.code;
+  // Every command which creates an object or session returns its handle.
+  if (client_handle_quota_ > 0 && !current_client_.empty() &&
+      GetNumberOfResponseHandles(command_info.code) > 0 &&
+      CountClientHandles(current_client_) >= client_handle_quota_) {
+    LOG(WARNING) << "Client " << current_client_ << " is over its quota.";
+    return CreateErrorResponse(MakeError(TPM_RC_OBJECT_MEMORY, FROM_HERE));
+  }
+  // A parked session, or a reusable one handed to another client, must not be
+  // used by a client which still remembers its handle.
+  for (auto handle : command_info.handles) {
+    if (!IsSessionAccessible(handle)) {
+      return CreateErrorResponse(MakeError(TPM_RC_HANDLE, FROM_HERE));
+    }
+  }
+  for (auto handle : command_info.session_handles) {
+    if (!IsSessionAccessible(handle)) {
+      return CreateErrorResponse(MakeError(TPM_RC_HANDLE, FROM_HERE));
+    }
+  }
   // A special case for FlushContext. It requires special handling because it
   // has a handle as a parameter and because we need to cleanup if it succeeds.
   if (command_info.code == TPM_CC_FlushContext) {
     return ProcessFlushContext(command, command_info);
   }
+  if (pcr_shadow_enabled_) {
+    std::string response;
+    if (command_info.code == TPM_CC_PCR_Read &&
+        ReadPcrShadow(command_info, &response)) {
+      return response;
+    }
+    InvalidatePcrShadow(command_info);
+  }
+  std::string reuse_key;
+  if (command_info.code == TPM_CC_StartAuthSession) {
+    reuse_key = GetSessionReuseKey(command_info);
+    std::string response;
+    if (!reuse_key.empty() && ReuseParkedSession(reuse_key, &response)) {
+      return response;
+    }
+  }
+  MakeRoomForCommand(command_info);
   // Process all the input handles, e.g. map virtual handles.
-  std::vector<TPM_HANDLE> updated_handles;
+  HandleList updated_handles;
   for (auto handle : command_info.handles) {
     TPM_HANDLE tpm_handle;
     result = ProcessInputHandle(command_info, handle, &tpm_handle);
@@ -123,7 +531,8 @@ std::string ResourceManager::SendCommandAndWait(const std::string& command) {
     }
     updated_handles.push_back(tpm_handle);
   }
-  std::string updated_command = ReplaceHandles(command, updated_handles);
+  std::string updated_command = command;
+  ReplaceHandles(updated_handles, &updated_command);
   // Make sure all the required sessions are loaded.
   for (auto handle : command_info.session_handles) {
     result = EnsureSessionIsLoaded(command_info, handle);
@@ -154,7 +563,9 @@ std::string ResourceManager::SendCommandAndWait(const std::string& command) {
   MessageInfo response_info;
   int attempts = 0;
   while (attempts++ < kMaxCommandAttempts) {
+    base::TimeTicks start = base::TimeTicks::Now();
     response = next_transceiver_->SendCommandAndWait(updated_command);
+    RecordTpmRoundTrip(start);
     result = ParseResponse(command_info, response, &response_info);
     if (result != TPM_RC_SUCCESS) {
       return CreateErrorResponse(result);
@@ -163,12 +574,46 @@ std::string ResourceManager::SendCommandAndWait(const std::string& command) {
       // No actionable warnings were handled.
       break;
     }
+    if (attempts < kMaxCommandAttempts) {
+      base::AutoLock lock(counters_lock_);
+      ++counters_.warning_retries;
+    }
+  }
+  CountPassedWarning(response_info.code);
+  if (response_info.code == TPM_RC_SUCCESS) {
+    AdvanceStateEpochs(command_info.code);
+  }
+  if (response_info.code == TPM_RC_SUCCESS &&
+      command_info.code == TPM_CC_Load) {
+    CountKeyLoad(command_info);
+  }
+  if (response_info.code == TPM_RC_SUCCESS && pcr_shadow_enabled_ &&
+      command_info.code == TPM_CC_PCR_Read) {
+    ParseCursor cursor(response_info.parameter_data.data(),
+                       response_info.parameter_data.size());
+    UINT32 pcr_update_counter = 0;
+    TPML_PCR_SELECTION pcr_selection;
+    TPML_DIGEST pcr_values;
+    if (Parse_UINT32(&cursor, &pcr_update_counter) == TPM_RC_SUCCESS &&
+        Parse_TPML_PCR_SELECTION(&cursor, &pcr_selection) == TPM_RC_SUCCESS &&
+        Parse_TPML_DIGEST(&cursor, &pcr_values) == TPM_RC_SUCCESS) {
+      UpdatePcrShadow(pcr_update_counter, pcr_selection, pcr_values);
+    }
   }
   if (response_info.code == TPM_RC_SUCCESS) {
     if (response_info.session_continued.size() !=
         command_info.session_handles.size()) {
       LOG(WARNING) << "Session count mismatch!";
     }
+    // Track the nonceTPM of reusable sessions.
+    for (size_t i = 0; i < command_info.session_handles.size() &&
+                       i < response_info.session_nonces.size();
+         ++i) {
+      auto iter = session_handles_.find(command_info.session_handles[i]);
+      if (iter != session_handles_.end() && !iter->second.reuse_key.empty()) {
+        iter->second.nonce_tpm = response_info.session_nonces[i].as_string();
+      }
+    }
     // Cleanup any sessions that were not continued.
     for (size_t i = 0; i < command_info.session_handles.size(); ++i) {
       if (i < response_info.session_continued.size() &&
@@ -181,19 +626,452 @@ std::string ResourceManager::SendCommandAndWait(const std::string& command) {
     if (command_info.code == TPM_CC_ContextSave) {
       ProcessExternalContextSave(command_info, response_info);
     }
+    // A saved session context can only be loaded once so there is no need to
+    // keep tracking it.
+    if (command_info.code == TPM_CC_ContextLoad) {
+      RemoveExternalContext(GetContextDigest(command_info.parameter_data));
+    }
     // Process all the output handles, which is loosely the inverse of the input
     // handle processing. E.g. virtualize handles.
-    std::vector<TPM_HANDLE> virtual_handles;
+    HandleList virtual_handles;
     for (auto handle : response_info.handles) {
-      virtual_handles.push_back(ProcessOutputHandle(handle));
+      TPM_HANDLE virtual_handle = 0;
+      result = ProcessOutputHandle(handle, &virtual_handle);
+      if (result != TPM_RC_SUCCESS) {
+        return CreateErrorResponse(result);
+      }
+      virtual_handles.push_back(virtual_handle);
+    }
+    ReplaceHandles(virtual_handles, &response);
+    if (command_info.code == TPM_CC_StartAuthSession) {
+      {
+        base::AutoLock lock(counters_lock_);
+        ++counters_.sessions_started;
+      }
+      MessageReader reader(response_info.parameter_data);
+      UINT16 nonce_size = 0;
+      if (!reuse_key.empty() && response_info.handles.size() == 1 &&
+          reader.ReadUint16(&nonce_size) &&
+          reader.remaining().size() >= nonce_size) {
+        HandleInfo& info = session_handles_[response_info.handles[0]];
+        info.reuse_key = reuse_key;
+        info.nonce_tpm = reader.remaining().substr(0, nonce_size).as_string();
+      }
     }
-    response = ReplaceHandles(response, virtual_handles);
   }
   return response;
 }
 
+void ResourceManager::RecordTpmRoundTrip(base::TimeTicks start) {
+  ++command_round_trips_;
+  command_tpm_time_ += base::TimeTicks::Now() - start;
+}
+
+void ResourceManager::SetSavedContext(const TPMS_CONTEXT& context,
+                                      HandleInfo* info) {
+  ReleaseContextSlot(info);
+  info->context.clear();
+  Serialize_TPMS_CONTEXT(context, &info->context);
+  info->context_sequence = context.sequence;
+}
+
+std::string ResourceManager::GetSavedContextBlob(const HandleInfo& info) const {
+  if (info.context_slot == kNoContextSlot) {
+    return info.context;
+  }
+  std::string context_blob;
+  if (!context_store_->Get(info.context_slot, &context_blob)) {
+    LOG(ERROR) << "Failed to read spilled context.";
+    context_blob.clear();
+  }
+  return context_blob;
+}
+
+void ResourceManager::ReleaseContextSlot(HandleInfo* info) {
+  if (info->context_slot != kNoContextSlot) {
+    context_store_->Free(info->context_slot);
+    info->context_slot = kNoContextSlot;
+  }
+}
+
+void ResourceManager::SpillIdleContexts() {
+  base::TimeTicks now = base::TimeTicks::Now();
+  uint64_t spills = 0;
+  for (auto* handles : {&virtual_object_handles_, &session_handles_}) {
+    for (auto& item : *handles) {
+      HandleInfo& info = item.second;
+      if (info.is_loaded || info.context_slot != kNoContextSlot ||
+          info.context.empty() ||
+          now - info.time_of_last_use < context_spill_threshold_) {
+        continue;
+      }
+      if (!context_store_->Put(info.context, &info.context_slot)) {
+        // Oversized contexts simply stay in memory.
+        continue;
+      }
+      // Release the memory rather than just the contents.
+      std::string().swap(info.context);
+      ++spills;
+    }
+  }
+  base::AutoLock lock(counters_lock_);
+  counters_.context_spills += spills;
+  counters_.spilled_contexts = context_store_->used_slots();
+}
+
+std::string ResourceManager::GetBootCounters() {
+  TPMS_TIME_INFO time_info;
+  TPM_RC result = factory_.GetTpm()->ReadClockSync(&time_info, nullptr);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(WARNING) << "Failed to read TPM clock: " << GetErrorString(result);
+    return std::string();
+  }
+  std::string boot_counters;
+  Serialize_UINT32(time_info.clock_info.reset_count, &boot_counters);
+  Serialize_UINT32(time_info.clock_info.restart_count, &boot_counters);
+  return boot_counters;
+}
+
+void ResourceManager::ListTpmHandles(UINT32 handle_range,
+                                     std::set<TPM_HANDLE>* handles) {
+  TPMI_YES_NO more_data = YES;
+  TPMS_CAPABILITY_DATA data;
+  while (more_data) {
+    TPM_RC result = factory_.GetTpm()->GetCapabilitySync(
+        TPM_CAP_HANDLES, handle_range, MAX_CAP_HANDLES, &more_data, &data,
+        nullptr);
+    if (result != TPM_RC_SUCCESS) {
+      LOG(WARNING) << "Failed to query existing handles: "
+                   << GetErrorString(result);
+      break;
+    }
+    const TPML_HANDLE& handle_list = data.data.handles;
+    handles->insert(handle_list.handle, handle_list.handle + handle_list.count);
+    if (more_data && handle_list.count > 0) {
+      // Adjust the range to be greater than the most recent handle so on the
+      // next query we'll start where we left off.
+      handle_range = handle_list.handle[handle_list.count - 1] + 1;
+    } else {
+      more_data = NO;
+    }
+  }
+}
+
+void ResourceManager::SynchronizeWithTpm() {
+  // Loaded sessions are listed in the HMAC session range and saved sessions in
+  // the policy session range, whatever their type.
+  std::set<TPM_HANDLE> loaded_handles;
+  std::set<TPM_HANDLE> saved_sessions;
+  ListTpmHandles(HR_TRANSIENT, &loaded_handles);
+  ListTpmHandles(HR_HMAC_SESSION, &loaded_handles);
+  ListTpmHandles(HR_POLICY_SESSION, &saved_sessions);
+  for (auto iter = virtual_object_handles_.begin();
+       iter != virtual_object_handles_.end();) {
+    if (iter->second.is_loaded &&
+        loaded_handles.count(iter->second.tpm_handle) == 0) {
+      tpm_object_handles_.erase(iter->second.tpm_handle);
+      free_virtual_handles_.push_back(iter->first);
+      iter = virtual_object_handles_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  for (auto iter = session_handles_.begin(); iter != session_handles_.end();) {
+    const std::set<TPM_HANDLE>& expected =
+        iter->second.is_loaded ? loaded_handles : saved_sessions;
+    if (expected.count(iter->first) == 0) {
+      iter = session_handles_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  loaded_handles.insert(saved_sessions.begin(), saved_sessions.end());
+  for (TPM_HANDLE handle : loaded_handles) {
+    if (tpm_object_handles_.count(handle) == 0 &&
+        session_handles_.count(handle) == 0) {
+      pending_flushes_.push_back(handle);
+    }
+  }
+}
+
+bool ResourceManager::FlushPendingHandles() {
+  if (pending_flushes_.empty()) {
+    return false;
+  }
+  std::vector<TPM_HANDLE> handles;
+  std::vector<std::string> commands;
+  for (TPM_HANDLE handle : pending_flushes_) {
+    std::string command;
+    TPM_RC result =
+        Tpm::SerializeCommand_FlushContext(handle, &command, nullptr);
+    if (result != TPM_RC_SUCCESS) {
+      LOG(WARNING) << "Error serializing flush for handle: " << handle
+                   << " : " << GetErrorString(result);
+      continue;
+    }
+    handles.push_back(handle);
+    commands.push_back(command);
+  }
+  pending_flushes_.clear();
+  if (commands.empty()) {
+    return true;
+  }
+  base::TimeTicks start = base::TimeTicks::Now();
+  std::vector<std::string> responses =
+      factory_.GetTpm()->SendCommandsAndWait(commands);
+  RecordTpmRoundTrip(start);
+  for (size_t i = 0; i < handles.size(); ++i) {
+    TPM_RC result = TPM_RC_FAILURE;
+    if (i < responses.size()) {
+      result = Tpm::ParseResponse_FlushContext(responses[i], nullptr);
+    }
+    LOG_IF(WARNING, result != TPM_RC_SUCCESS)
+        << "Failed to flush stale handle " << std::hex << handles[i] << ": "
+        << GetErrorString(result);
+  }
+  VLOG(1) << "Flushed " << handles.size() << " stale handles.";
+  return true;
+}
+
+bool ResourceManager::RestoreState() {
+  std::string state;
+  if (!base::ReadFileToString(state_file_, &state)) {
+    return false;
+  }
+  std::string boot_counters = GetBootCounters();
+  bool header_seen = false;
+  while (!state.empty()) {
+    UINT32 record_size = 0;
+    if (Parse_UINT32(&state, &record_size, nullptr) != TPM_RC_SUCCESS ||
+        record_size > state.size()) {
+      // The last record may be cut short if trunksd died while writing it.
+      LOG(WARNING) << "Ignoring truncated state record.";
+      break;
+    }
+    std::string record = state.substr(0, record_size);
+    state.erase(0, record_size);
+    UINT32 type = 0;
+    TPM_RC result = Parse_UINT32(&record, &type, nullptr);
+    if (result == TPM_RC_SUCCESS && type == kStateRecordHeader) {
+      if (boot_counters.empty() || record != boot_counters) {
+        VLOG(1) << "TPM has restarted, discarding saved state.";
+        break;
+      }
+      header_seen = true;
+      continue;
+    }
+    TPM_HANDLE handle = 0;
+    if (!header_seen || result != TPM_RC_SUCCESS ||
+        Parse_TPM_HANDLE(&record, &handle, nullptr) != TPM_RC_SUCCESS) {
+      LOG(WARNING) << "Malformed state file.";
+      break;
+    }
+    // Drop any existing mapping first; the record describes the whole state.
+    auto object_iter = virtual_object_handles_.find(handle);
+    if (object_iter != virtual_object_handles_.end()) {
+      tpm_object_handles_.erase(object_iter->second.tpm_handle);
+      virtual_object_handles_.erase(object_iter);
+    }
+    session_handles_.erase(handle);
+    if (type == kStateRecordRemoved) {
+      continue;
+    }
+    HandleInfo info;
+    BYTE is_loaded = 0;
+    TPMS_CONTEXT context;
+    std::string context_blob;
+    if (type != kStateRecordHandle ||
+        Parse_BYTE(&record, &is_loaded, nullptr) != TPM_RC_SUCCESS ||
+        Parse_TPM_HANDLE(&record, &info.tpm_handle, nullptr) !=
+            TPM_RC_SUCCESS ||
+        Parse_TPMS_CONTEXT(&record, &context, &context_blob) !=
+            TPM_RC_SUCCESS) {
+      LOG(WARNING) << "Malformed state record.";
+      break;
+    }
+    info.is_loaded = (is_loaded != 0);
+    if (!info.is_loaded) {
+      info.context = context_blob;
+      info.context_sequence = context.sequence;
+    }
+    info.time_of_create = base::TimeTicks::Now();
+    info.time_of_last_use = info.time_of_create;
+    if (IsObjectHandle(handle)) {
+      virtual_object_handles_[handle] = info;
+      if (info.is_loaded) {
+        tpm_object_handles_[info.tpm_handle] = handle;
+      }
+      if (handle == kMaxVirtualHandle) {
+        virtual_handles_wrapped_ = true;
+      } else if (handle >= next_virtual_handle_) {
+        next_virtual_handle_ = handle + 1;
+      }
+    } else if (IsSessionHandle(handle)) {
+      session_handles_[handle] = info;
+      if (!info.is_loaded) {
+        newest_context_sequence_ =
+            std::max(newest_context_sequence_, info.context_sequence);
+      }
+    }
+  }
+  if (!header_seen) {
+    virtual_object_handles_.clear();
+    tpm_object_handles_.clear();
+    session_handles_.clear();
+    next_virtual_handle_ = TRANSIENT_FIRST;
+    virtual_handles_wrapped_ = false;
+  }
+  return header_seen;
+}
+
+void ResourceManager::WriteCheckpoint() {
+  journal_records_ = 0;
+  std::string boot_counters = GetBootCounters();
+  if (boot_counters.empty()) {
+    // Without boot counters the state could never be safely restored.
+    base::DeleteFile(state_file_, false);
+    return;
+  }
+  std::string header;
+  Serialize_UINT32(kStateRecordHeader, &header);
+  header += boot_counters;
+  std::string state;
+  Serialize_UINT32(header.size(), &state);
+  state += header;
+  for (const auto& item : virtual_object_handles_) {
+    state += MakeHandleRecord(item.first);
+  }
+  for (const auto& item : session_handles_) {
+    state += MakeHandleRecord(item.first);
+  }
+  if (!base::ImportantFileWriter::WriteFileAtomically(state_file_, state)) {
+    LOG(WARNING) << "Failed to write state file.";
+    base::DeleteFile(state_file_, false);
+  }
+}
+
+void ResourceManager::JournalHandle(TPM_HANDLE handle) {
+  if (state_file_.empty()) {
+    return;
+  }
+  if (++journal_records_ > kMaxJournalRecords) {
+    WriteCheckpoint();
+    return;
+  }
+  std::string record = MakeHandleRecord(handle);
+  if (!base::AppendToFile(state_file_, record.data(), record.size())) {
+    // A stale file must not be restored. Appending to a missing file creates
+    // one without a header, which is never restored either.
+    LOG(WARNING) << "Failed to update state file.";
+    base::DeleteFile(state_file_, false);
+  }
+}
+
+std::string ResourceManager::MakeHandleRecord(TPM_HANDLE handle) const {
+  const HandleInfo* info = nullptr;
+  auto object_iter = virtual_object_handles_.find(handle);
+  if (object_iter != virtual_object_handles_.end()) {
+    info = &object_iter->second;
+  }
+  auto session_iter = session_handles_.find(handle);
+  // Nobody can use a parked session after a restart, so it is recorded as
+  // removed and flushed when the state is restored.
+  if (session_iter != session_handles_.end() && !session_iter->second.parked) {
+    info = &session_iter->second;
+  }
+  std::string record;
+  if (info) {
+    Serialize_UINT32(kStateRecordHandle, &record);
+    Serialize_TPM_HANDLE(handle, &record);
+    Serialize_BYTE(info->is_loaded ? 1 : 0, &record);
+    Serialize_TPM_HANDLE(info->tpm_handle, &record);
+    std::string context_blob;
+    if (!info->is_loaded) {
+      context_blob = GetSavedContextBlob(*info);
+    }
+    if (context_blob.empty()) {
+      // Loaded handles are recorded with an empty context.
+      TPMS_CONTEXT empty_context;
+      memset(&empty_context, 0, sizeof(empty_context));
+      Serialize_TPMS_CONTEXT(empty_context, &context_blob);
+    }
+    record += context_blob;
+  } else {
+    Serialize_UINT32(kStateRecordRemoved, &record);
+    Serialize_TPM_HANDLE(handle, &record);
+  }
+  std::string framed_record;
+  Serialize_UINT32(record.size(), &framed_record);
+  return framed_record + record;
+}
+
+void ResourceManager::SendCommandForClient(const std::string& client,
+                                           const std::string& command,
+                                           const ResponseCallback& callback) {
+  current_client_ = client;
+  std::string response = SendCommandAndWait(command);
+  current_client_.clear();
+  callback.Run(response);
+}
+
+void ResourceManager::OnClientDisconnected(const std::string& client) {
+  std::vector<TPM_HANDLE> handles;
+  for (const auto& item : virtual_object_handles_) {
+    if (item.second.owner == client) {
+      handles.push_back(item.first);
+    }
+  }
+  for (const auto& item : session_handles_) {
+    if (item.second.owner == client) {
+      handles.push_back(item.first);
+    }
+  }
+  for (TPM_HANDLE handle : handles) {
+    // Saved sessions are flushed by handle too; only saved objects are unknown
+    // to the TPM.
+    if (!IsObjectHandle(handle)) {
+      pending_flushes_.push_back(handle);
+    } else if (virtual_object_handles_[handle].is_loaded) {
+      pending_flushes_.push_back(virtual_object_handles_[handle].tpm_handle);
+    }
+    CleanupFlushedHandle(handle);
+  }
+  VLOG(1) << "CLIENT_DISCONNECTED: " << client << ", released "
+          << handles.size() << " handles.";
+}
+
+void ResourceManager::AddExternalContext(const std::string& external_context) {
+  std::string digest = GetContextDigest(external_context);
+  if (external_contexts_.count(digest) == 0 &&
+      external_contexts_.size() >= kMaxExternalContexts) {
+    auto oldest_iter = std::min_element(
+        external_contexts_.begin(), external_contexts_.end(),
+        [](const std::pair<const std::string, ExternalContext>& a,
+           const std::pair<const std::string, ExternalContext>& b) {
+          return a.second.time_of_save < b.second.time_of_save;
+        });
+    LOG(WARNING) << "Too many external contexts, discarding the oldest.";
+    RemoveExternalContext(oldest_iter->first);
+  }
+  ExternalContext& context = external_contexts_[digest];
+  context.actual_context = external_context;
+  context.time_of_save = base::TimeTicks::Now();
+  actual_context_to_external_[digest] = digest;
+}
+
+void ResourceManager::RemoveExternalContext(
+    const std::string& external_digest) {
+  auto iter = external_contexts_.find(external_digest);
+  if (iter == external_contexts_.end()) {
+    return;
+  }
+  actual_context_to_external_.erase(
+      GetContextDigest(iter->second.actual_context));
+  external_contexts_.erase(iter);
+}
+
 bool ResourceManager::ChooseSessionToEvict(
-    const std::vector<TPM_HANDLE>& sessions_to_retain,
+    const HandleList& sessions_to_retain,
     TPM_HANDLE* session_to_evict) {
   // Build a list of candidates by excluding |sessions_to_retain|.
   std::vector<TPM_HANDLE> candidates;
@@ -209,11 +1087,16 @@ bool ResourceManager::ChooseSessionToEvict(
     LOG(WARNING) << "No sessions to evict.";
     return false;
   }
-  // Choose the candidate with the earliest |time_of_last_use|.
+  // Choose a parked session if there is one, then the candidate with the
+  // earliest |time_of_last_use|.
   auto oldest_iter = std::min_element(
       candidates.begin(), candidates.end(), [this](TPM_HANDLE a, TPM_HANDLE b) {
-        return (session_handles_[a].time_of_last_use <
-                session_handles_[b].time_of_last_use);
+        const HandleInfo& info_a = session_handles_[a];
+        const HandleInfo& info_b = session_handles_[b];
+        if (info_a.parked != info_b.parked) {
+          return info_a.parked;
+        }
+        return info_a.time_of_last_use < info_b.time_of_last_use;
       });
   *session_to_evict = *oldest_iter;
   return true;
@@ -223,9 +1106,12 @@ void ResourceManager::CleanupFlushedHandle(TPM_HANDLE flushed_handle) {
   if (IsObjectHandle(flushed_handle)) {
     // For transient object handles, remove both the actual and virtual handles.
     if (virtual_object_handles_.count(flushed_handle) > 0) {
-      tpm_object_handles_.erase(
-          virtual_object_handles_[flushed_handle].tpm_handle);
+      HandleInfo& info = virtual_object_handles_[flushed_handle];
+      tpm_object_handles_.erase(info.tpm_handle);
+      ReleaseContextSlot(&info);
       virtual_object_handles_.erase(flushed_handle);
+      free_virtual_handles_.push_back(flushed_handle);
+      JournalHandle(flushed_handle);
     }
   } else if (IsSessionHandle(flushed_handle)) {
     auto iter = session_handles_.find(flushed_handle);
@@ -235,30 +1121,96 @@ void ResourceManager::CleanupFlushedHandle(TPM_HANDLE flushed_handle) {
     // For session handles, remove the handle and any associated context data.
     HandleInfo& info = iter->second;
     if (!info.is_loaded) {
-      std::string actual_context_data;
-      Serialize_TPMS_CONTEXT(info.context, &actual_context_data);
-      if (actual_context_to_external_.count(actual_context_data) > 0) {
-        external_context_to_actual_.erase(
-            actual_context_to_external_[actual_context_data]);
-        actual_context_to_external_.erase(actual_context_data);
+      auto context_iter = actual_context_to_external_.find(
+          GetContextDigest(GetSavedContextBlob(info)));
+      if (context_iter != actual_context_to_external_.end()) {
+        RemoveExternalContext(context_iter->second);
       }
+      ReleaseContextSlot(&info);
     }
     session_handles_.erase(flushed_handle);
+    parked_sessions_.erase(std::remove(parked_sessions_.begin(),
+                                       parked_sessions_.end(), flushed_handle),
+                           parked_sessions_.end());
+    JournalHandle(flushed_handle);
     VLOG(1) << "CLEANUP_SESSION: " << std::hex << flushed_handle;
   }
 }
 
-TPM_HANDLE ResourceManager::CreateVirtualHandle() {
-  TPM_HANDLE handle;
-  do {
-    handle = next_virtual_handle_;
+bool ResourceManager::CreateVirtualHandle(TPM_HANDLE* handle) {
+  if (free_virtual_handles_.size() > kMinFreeVirtualHandles ||
+      (virtual_handles_wrapped_ && !free_virtual_handles_.empty())) {
+    *handle = free_virtual_handles_.front();
+    free_virtual_handles_.pop_front();
+    return true;
+  }
+  // Before wrapping every handle from |next_virtual_handle_| up is unused,
+  // except for those restored from the state file.
+  while (!virtual_handles_wrapped_) {
+    *handle = next_virtual_handle_;
     if (next_virtual_handle_ == kMaxVirtualHandle) {
-      next_virtual_handle_ = TRANSIENT_FIRST;
+      virtual_handles_wrapped_ = true;
     } else {
       ++next_virtual_handle_;
     }
-  } while (virtual_object_handles_.count(handle) > 0);
-  return handle;
+    if (virtual_object_handles_.count(*handle) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ResourceManager::MakeRoomForCommand(const MessageInfo& command_info) {
+  size_t objects_to_load = 0;
+  for (auto iter = command_info.handles.begin();
+       iter != command_info.handles.end(); ++iter) {
+    auto handle_iter = virtual_object_handles_.find(*iter);
+    // A handle may appear more than once but is loaded only once.
+    if (handle_iter != virtual_object_handles_.end() &&
+        !handle_iter->second.is_loaded &&
+        std::find(command_info.handles.begin(), iter, *iter) == iter) {
+      ++objects_to_load;
+    }
+  }
+  size_t sessions_to_load = 0;
+  for (auto iter = command_info.session_handles.begin();
+       iter != command_info.session_handles.end(); ++iter) {
+    auto handle_iter = session_handles_.find(*iter);
+    if (handle_iter != session_handles_.end() &&
+        !handle_iter->second.is_loaded &&
+        std::find(command_info.session_handles.begin(), iter, *iter) == iter) {
+      ++sessions_to_load;
+    }
+  }
+  // The slot counts do not include stale handles.
+  if (objects_to_load > 0 || sessions_to_load > 0) {
+    FlushPendingHandles();
+  }
+  // Each eviction saves a context, so everything is saved before anything is
+  // loaded and no load fails for lack of room.
+  if (objects_to_load > 0 && object_slots_ > 0 &&
+      eviction_policy_ != kEvictAll) {
+    size_t loaded = CountLoadedObjects();
+    while (loaded > 0 && loaded + objects_to_load > object_slots_) {
+      EvictObjects(command_info, EVICTION_REASON_BEFORE_LOAD);
+      size_t now_loaded = CountLoadedObjects();
+      if (now_loaded >= loaded) {
+        break;
+      }
+      loaded = now_loaded;
+    }
+  }
+  if (sessions_to_load > 0 && session_slots_ > 0) {
+    size_t loaded = CountLoadedSessions();
+    while (loaded > 0 && loaded + sessions_to_load > session_slots_) {
+      EvictSession(command_info, EVICTION_REASON_BEFORE_LOAD);
+      size_t now_loaded = CountLoadedSessions();
+      if (now_loaded >= loaded) {
+        break;
+      }
+      loaded = now_loaded;
+    }
+  }
 }
 
 TPM_RC ResourceManager::EnsureSessionIsLoaded(const MessageInfo& command_info,
@@ -277,38 +1229,265 @@ TPM_RC ResourceManager::EnsureSessionIsLoaded(const MessageInfo& command_info,
     if (result != TPM_RC_SUCCESS) {
       return result;
     }
+    JournalHandle(session_handle);
     VLOG(1) << "RELOAD_SESSION: " << std::hex << session_handle;
   }
   handle_info.time_of_last_use = base::TimeTicks::Now();
   return TPM_RC_SUCCESS;
 }
 
-void ResourceManager::EvictObjects(const MessageInfo& command_info) {
+size_t ResourceManager::CountClientHandles(const std::string& client) const {
+  auto is_owned =
+      [&client](const std::pair<const TPM_HANDLE, HandleInfo>& item) {
+        return item.second.owner == client;
+      };
+  return std::count_if(virtual_object_handles_.begin(),
+                       virtual_object_handles_.end(), is_owned) +
+         std::count_if(session_handles_.begin(), session_handles_.end(),
+                       is_owned);
+}
+
+void ResourceManager::AdvanceStateEpochs(TPM_CC code) {
+  bool pcrs = false;
+  bool nv_indexes = false;
+  bool hierarchy_auth = false;
+  bool ownership = false;
+  bool persistent_handles = false;
+  switch (code) {
+    case TPM_CC_PCR_Extend:
+    case TPM_CC_PCR_Event:
+    case TPM_CC_PCR_Reset:
+    case TPM_CC_EventSequenceComplete:
+    case TPM_CC_PCR_Allocate:
+      pcrs = true;
+      break;
+    case TPM_CC_Startup:
+      pcrs = true;
+      ownership = true;
+      break;
+    // Writes matter too since the first one sets TPMA_NV_WRITTEN, which
+    // changes the name of the index.
+    case TPM_CC_NV_DefineSpace:
+    case TPM_CC_NV_UndefineSpace:
+    case TPM_CC_NV_UndefineSpaceSpecial:
+    case TPM_CC_NV_Write:
+    case TPM_CC_NV_Increment:
+    case TPM_CC_NV_Extend:
+    case TPM_CC_NV_SetBits:
+    case TPM_CC_NV_WriteLock:
+    case TPM_CC_NV_GlobalWriteLock:
+    case TPM_CC_NV_ReadLock:
+    case TPM_CC_NV_ChangeAuth:
+      nv_indexes = true;
+      break;
+    case TPM_CC_HierarchyChangeAuth:
+      hierarchy_auth = true;
+      ownership = true;
+      break;
+    case TPM_CC_SetPrimaryPolicy:
+      hierarchy_auth = true;
+      break;
+    case TPM_CC_HierarchyControl:
+    case TPM_CC_ClearControl:
+    case TPM_CC_DictionaryAttackLockReset:
+    case TPM_CC_DictionaryAttackParameters:
+      ownership = true;
+      break;
+    case TPM_CC_Clear:
+      nv_indexes = true;
+      hierarchy_auth = true;
+      ownership = true;
+      persistent_handles = true;
+      break;
+    case TPM_CC_ChangeEPS:
+    case TPM_CC_ChangePPS:
+      hierarchy_auth = true;
+      ownership = true;
+      persistent_handles = true;
+      break;
+    case TPM_CC_EvictControl:
+      persistent_handles = true;
+      break;
+    default:
+      return;
+  }
+  TpmStateEpochs epochs;
+  {
+    base::AutoLock lock(counters_lock_);
+    if (pcrs) {
+      state_epochs_.set_pcrs(state_epochs_.pcrs() + 1);
+    }
+    if (nv_indexes) {
+      state_epochs_.set_nv_indexes(state_epochs_.nv_indexes() + 1);
+    }
+    if (hierarchy_auth) {
+      state_epochs_.set_hierarchy_auth(state_epochs_.hierarchy_auth() + 1);
+    }
+    if (ownership) {
+      state_epochs_.set_ownership(state_epochs_.ownership() + 1);
+    }
+    if (persistent_handles) {
+      state_epochs_.set_persistent_handles(state_epochs_.persistent_handles() +
+                                           1);
+    }
+    epochs = state_epochs_;
+  }
+  if (!state_epochs_callback_.is_null()) {
+    state_epochs_callback_.Run(epochs);
+  }
+}
+
+void ResourceManager::CountPassedWarning(TPM_RC code) {
+  base::AutoLock lock(counters_lock_);
+  switch (code) {
+    case TPM_RC_RETRY:
+      ++counters_.retry_warnings;
+      break;
+    case TPM_RC_YIELDED:
+      ++counters_.yielded_warnings;
+      break;
+    case TPM_RC_TESTING:
+      ++counters_.testing_warnings;
+      break;
+    default:
+      break;
+  }
+}
+
+void ResourceManager::CountKeyLoad(const MessageInfo& command_info) {
+  size_t key =
+      std::hash<std::string>()(command_info.parameter_data.as_string());
+  auto it = key_load_counts_.find(key);
+  if (it == key_load_counts_.end()) {
+    if (key_load_counts_.size() >= kMaxTrackedKeyBlobs) {
+      key_load_counts_.erase(std::min_element(
+          key_load_counts_.begin(), key_load_counts_.end(),
+          [](const std::pair<const size_t, uint64_t>& a,
+             const std::pair<const size_t, uint64_t>& b) {
+            return a.second < b.second;
+          }));
+    }
+    it = key_load_counts_.insert(std::make_pair(key, 0)).first;
+  }
+  ++it->second;
+  base::AutoLock lock(counters_lock_);
+  if (it->second > 1) {
+    ++counters_.key_reloads;
+  }
+  counters_.hottest_key_loads =
+      std::max(counters_.hottest_key_loads, it->second);
+}
+
+size_t ResourceManager::CountLoadedObjects() const {
+  return std::count_if(virtual_object_handles_.begin(),
+                       virtual_object_handles_.end(),
+                       [](const std::pair<const TPM_HANDLE, HandleInfo>& item) {
+                         return item.second.is_loaded;
+                       });
+}
+
+size_t ResourceManager::CountLoadedSessions() const {
+  return std::count_if(session_handles_.begin(), session_handles_.end(),
+                       [](const std::pair<const TPM_HANDLE, HandleInfo>& item) {
+                         return item.second.is_loaded;
+                       });
+}
+
+bool ResourceManager::EvictObject(const MessageInfo& command_info,
+                                  EvictionReason reason,
+                                  HandleInfo* info) {
+  TPM_RC result = SaveContext(command_info, info);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(WARNING) << "Failed to save transient object: "
+                 << GetErrorString(result);
+    return false;
+  }
+  base::TimeTicks start = base::TimeTicks::Now();
+  result = factory_.GetTpm()->FlushContextSync(info->tpm_handle, nullptr);
+  RecordTpmRoundTrip(start);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(WARNING) << "Failed to evict transient object: "
+                 << GetErrorString(result);
+    return false;
+  }
+  tpm_object_handles_.erase(info->tpm_handle);
+  VLOG(1) << "EVICT_OBJECT: " << std::hex << info->tpm_handle;
+  base::AutoLock lock(counters_lock_);
+  ++counters_.objects_evicted[reason];
+  return true;
+}
+
+void ResourceManager::EvictObjects(const MessageInfo& command_info,
+                                   EvictionReason reason) {
+  std::vector<TPM_HANDLE> candidates;
   for (auto& item : virtual_object_handles_) {
     HandleInfo& info = item.second;
-    if (!info.is_loaded ||
+    if (info.is_loaded &&
         std::find(command_info.handles.begin(), command_info.handles.end(),
-                  item.first) != command_info.handles.end()) {
-      continue;
+                  item.first) == command_info.handles.end()) {
+      candidates.push_back(item.first);
     }
-    TPM_RC result = SaveContext(command_info, &info);
-    if (result != TPM_RC_SUCCESS) {
-      LOG(WARNING) << "Failed to save transient object: "
-                   << GetErrorString(result);
-      continue;
+  }
+  if (eviction_policy_ == kEvictAll) {
+    for (auto handle : candidates) {
+      EvictObject(command_info, reason, &virtual_object_handles_[handle]);
+      JournalHandle(handle);
     }
-    result = factory_.GetTpm()->FlushContextSync(info.tpm_handle, nullptr);
-    if (result != TPM_RC_SUCCESS) {
-      LOG(WARNING) << "Failed to evict transient object: "
-                   << GetErrorString(result);
-      continue;
+    return;
+  }
+  if (candidates.empty()) {
+    LOG(WARNING) << "No objects to evict.";
+    return;
+  }
+  // Evict from the client holding the most loaded objects so a client loading
+  // many keys swaps out its own objects rather than everyone else's.
+  std::map<std::string, size_t> loaded_per_owner;
+  for (const auto& item : virtual_object_handles_) {
+    if (item.second.is_loaded) {
+      ++loaded_per_owner[item.second.owner];
+    }
+  }
+  std::string heaviest_owner;
+  size_t heaviest_count = 0;
+  for (auto handle : candidates) {
+    const std::string& owner = virtual_object_handles_[handle].owner;
+    if (loaded_per_owner[owner] > heaviest_count) {
+      heaviest_owner = owner;
+      heaviest_count = loaded_per_owner[owner];
+    }
+  }
+  candidates.erase(
+      std::remove_if(candidates.begin(), candidates.end(),
+                     [this, &heaviest_owner](TPM_HANDLE handle) {
+                       return virtual_object_handles_[handle].owner !=
+                              heaviest_owner;
+                     }),
+      candidates.end());
+  // A command needs at most one more object slot, so evicting a single object
+  // is enough. If it isn't the command fails again and another is evicted.
+  auto victim_iter = std::min_element(
+      candidates.begin(), candidates.end(), [this](TPM_HANDLE a, TPM_HANDLE b) {
+        const HandleInfo& info_a = virtual_object_handles_[a];
+        const HandleInfo& info_b = virtual_object_handles_[b];
+        if (eviction_policy_ == kEvictLeastFrequentlyUsed &&
+            info_a.use_count != info_b.use_count) {
+          return info_a.use_count < info_b.use_count;
+        }
+        return info_a.time_of_last_use < info_b.time_of_last_use;
+      });
+  EvictObject(command_info, reason, &virtual_object_handles_[*victim_iter]);
+  JournalHandle(*victim_iter);
+  if (eviction_policy_ == kEvictLeastFrequentlyUsed) {
+    // Decay use counts so objects which were popular long ago do not stay
+    // loaded forever.
+    for (auto& item : virtual_object_handles_) {
+      item.second.use_count /= 2;
     }
-    tpm_object_handles_.erase(info.tpm_handle);
-    VLOG(1) << "EVICT_OBJECT: " << std::hex << info.tpm_handle;
   }
 }
 
-void ResourceManager::EvictSession(const MessageInfo& command_info) {
+void ResourceManager::EvictSession(const MessageInfo& command_info,
+                                   EvictionReason reason) {
   TPM_HANDLE session_to_evict;
   if (!ChooseSessionToEvict(command_info.session_handles, &session_to_evict)) {
     return;
@@ -318,20 +1497,12 @@ void ResourceManager::EvictSession(const MessageInfo& command_info) {
   if (result != TPM_RC_SUCCESS) {
     LOG(WARNING) << "Failed to evict session: " << GetErrorString(result);
   }
+  JournalHandle(session_to_evict);
   VLOG(1) << "EVICT_SESSION: " << std::hex << session_to_evict;
-}
-
-std::vector<TPM_HANDLE> ResourceManager::ExtractHandlesFromBuffer(
-    size_t number_of_handles,
-    std::string* buffer) {
-  std::vector<TPM_HANDLE> handles(number_of_handles);
-  for (size_t i = 0; i < number_of_handles; ++i) {
-    TPM_HANDLE handle;
-    if (TPM_RC_SUCCESS == Parse_TPM_HANDLE(buffer, &handle, nullptr)) {
-      handles[i] = handle;
-    }
+  if (result == TPM_RC_SUCCESS) {
+    base::AutoLock lock(counters_lock_);
+    ++counters_.sessions_evicted[reason];
   }
-  return handles;
 }
 
 void ResourceManager::FixContextGap(const MessageInfo& command_info) {
@@ -349,34 +1520,43 @@ void ResourceManager::FixContextGap(const MessageInfo& command_info) {
                       session_handles_[b].time_of_create);
             });
   for (auto handle : sessions_to_ungap) {
-    HandleInfo& info = session_handles_[handle];
-    // Loading and re-saving allows the TPM to assign a new context counter.
-    std::string old_context_blob;
-    Serialize_TPMS_CONTEXT(info.context, &old_context_blob);
-    TPM_RC result = LoadContext(command_info, &info);
-    if (result != TPM_RC_SUCCESS) {
-      LOG(WARNING) << "Failed to un-gap session (load): "
-                   << GetErrorString(result);
-      continue;
-    }
-    result = SaveContext(command_info, &info);
-    if (result != TPM_RC_SUCCESS) {
-      LOG(WARNING) << "Failed to un-gap session (save): "
-                   << GetErrorString(result);
-      continue;
-    }
-    // If this context is one that we're tracking for external use, update it.
-    auto iter = actual_context_to_external_.find(old_context_blob);
-    if (iter == actual_context_to_external_.end()) {
-      continue;
-    }
-    std::string new_context_blob;
-    Serialize_TPMS_CONTEXT(info.context, &new_context_blob);
-    const std::string& external_context_blob = iter->second;
-    actual_context_to_external_[new_context_blob] = external_context_blob;
-    external_context_to_actual_[external_context_blob] = new_context_blob;
-    actual_context_to_external_.erase(old_context_blob);
+    RefreshSessionContext(command_info, handle);
   }
+  base::AutoLock lock(counters_lock_);
+  ++counters_.context_gap_fixes;
+}
+
+bool ResourceManager::RefreshSessionContext(const MessageInfo& command_info,
+                                            TPM_HANDLE session_handle) {
+  HandleInfo& info = session_handles_[session_handle];
+  // Loading and re-saving allows the TPM to assign a new context counter.
+  std::string old_context_blob = GetSavedContextBlob(info);
+  TPM_RC result = LoadContext(command_info, &info);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(WARNING) << "Failed to un-gap session (load): "
+                 << GetErrorString(result);
+    return false;
+  }
+  result = SaveContext(command_info, &info);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(WARNING) << "Failed to un-gap session (save): "
+                 << GetErrorString(result);
+    return false;
+  }
+  JournalHandle(session_handle);
+  // If this context is one that we're tracking for external use, update it.
+  auto iter =
+      actual_context_to_external_.find(GetContextDigest(old_context_blob));
+  if (iter == actual_context_to_external_.end()) {
+    return true;
+  }
+  std::string new_context_blob = info.context;
+  std::string external_digest = iter->second;
+  actual_context_to_external_.erase(iter);
+  actual_context_to_external_[GetContextDigest(new_context_blob)] =
+      external_digest;
+  external_contexts_[external_digest].actual_context = new_context_blob;
+  return true;
 }
 
 bool ResourceManager::FixWarnings(const MessageInfo& command_info,
@@ -384,6 +1564,14 @@ bool ResourceManager::FixWarnings(const MessageInfo& command_info,
   if ((result & RC_WARN) == 0) {
     return false;
   }
+  // Stale handles are flushed before anything in use is evicted. The warning
+  // is not marked as seen so it can still be fixed by eviction on the retry.
+  if ((result == TPM_RC_OBJECT_MEMORY || result == TPM_RC_OBJECT_HANDLES ||
+       result == TPM_RC_SESSION_MEMORY || result == TPM_RC_SESSION_HANDLES ||
+       result == TPM_RC_MEMORY) &&
+      FlushPendingHandles()) {
+    return true;
+  }
   // This method can be called anytime without tracking whether the current
   // operation is already an attempt to fix a warning. All re-entrance issues
   // are dealt with here using the following rule: Never attempt to fix the same
@@ -401,15 +1589,20 @@ bool ResourceManager::FixWarnings(const MessageInfo& command_info,
       FixContextGap(command_info);
       return true;
     case TPM_RC_OBJECT_MEMORY:
+      // The TPM is full, so it holds exactly as many objects as are loaded.
+      object_slots_ = CountLoadedObjects();
+      EvictObjects(command_info, EVICTION_REASON_TPM_WARNING);
+      return true;
     case TPM_RC_OBJECT_HANDLES:
-      EvictObjects(command_info);
+      EvictObjects(command_info, EVICTION_REASON_TPM_WARNING);
       return true;
     case TPM_RC_SESSION_MEMORY:
-      EvictSession(command_info);
+      session_slots_ = CountLoadedSessions();
+      EvictSession(command_info, EVICTION_REASON_TPM_WARNING);
       return true;
     case TPM_RC_MEMORY:
-      EvictObjects(command_info);
-      EvictSession(command_info);
+      EvictObjects(command_info, EVICTION_REASON_TPM_WARNING);
+      EvictSession(command_info, EVICTION_REASON_TPM_WARNING);
       return true;
     case TPM_RC_SESSION_HANDLES:
       FlushSession(command_info);
@@ -424,8 +1617,10 @@ void ResourceManager::FlushSession(const MessageInfo& command_info) {
   if (!ChooseSessionToEvict(command_info.session_handles, &session_to_flush)) {
     return;
   }
+  base::TimeTicks start = base::TimeTicks::Now();
   TPM_RC result =
       factory_.GetTpm()->FlushContextSync(session_to_flush, nullptr);
+  RecordTpmRoundTrip(start);
   if (result != TPM_RC_SUCCESS) {
     LOG(WARNING) << "Failed to flush session: " << GetErrorString(result);
     return;
@@ -434,12 +1629,12 @@ void ResourceManager::FlushSession(const MessageInfo& command_info) {
 }
 
 std::string ResourceManager::GetActualContextFromExternalContext(
-    const std::string& external_context) {
-  auto iter = external_context_to_actual_.find(external_context);
-  if (iter == external_context_to_actual_.end()) {
-    return external_context;
+    base::StringPiece external_context) {
+  auto iter = external_contexts_.find(GetContextDigest(external_context));
+  if (iter == external_contexts_.end()) {
+    return external_context.as_string();
   }
-  return iter->second;
+  return iter->second.actual_context;
 }
 
 bool ResourceManager::IsObjectHandle(TPM_HANDLE handle) const {
@@ -454,11 +1649,18 @@ bool ResourceManager::IsSessionHandle(TPM_HANDLE handle) const {
 TPM_RC ResourceManager::LoadContext(const MessageInfo& command_info,
                                     HandleInfo* handle_info) {
   CHECK(!handle_info->is_loaded);
+  std::string context_blob = GetSavedContextBlob(*handle_info);
+  TPMS_CONTEXT context;
+  if (Parse_TPMS_CONTEXT(&context_blob, &context, nullptr) != TPM_RC_SUCCESS) {
+    return MakeError(TPM_RC_FAILURE, FROM_HERE);
+  }
   TPM_RC result = TPM_RC_SUCCESS;
   int attempts = 0;
   while (attempts++ < kMaxCommandAttempts) {
+    base::TimeTicks start = base::TimeTicks::Now();
     result = factory_.GetTpm()->ContextLoadSync(
-        handle_info->context, &handle_info->tpm_handle, nullptr);
+        context, &handle_info->tpm_handle, nullptr);
+    RecordTpmRoundTrip(start);
     if (!FixWarnings(command_info, result)) {
       break;
     }
@@ -469,24 +1671,39 @@ TPM_RC ResourceManager::LoadContext(const MessageInfo& command_info,
     return result;
   }
   handle_info->is_loaded = true;
+  bool was_spilled = (handle_info->context_slot != kNoContextSlot);
+  ReleaseContextSlot(handle_info);
+  std::string().swap(handle_info->context);
+  base::AutoLock lock(counters_lock_);
+  ++counters_.context_loads;
+  if (was_spilled) {
+    ++counters_.spilled_context_loads;
+  }
   return result;
 }
 
 TPM_RC ResourceManager::MakeError(TPM_RC tpm_error,
                                   const ::tracked_objects::Location& location) {
-  LOG(ERROR) << "ResourceManager::" << location.function_name() << ":"
-             << location.line_number() << ": " << GetErrorString(tpm_error);
+  // Most errors raised here are plain response codes; log those by name so a
+  // burst of failures doesn't build a description string for each one.
+  const char* error_name = GetErrorName(tpm_error);
+  if (error_name) {
+    LOG(ERROR) << "ResourceManager::" << location.function_name() << ":"
+               << location.line_number() << ": " << error_name;
+  } else {
+    LOG(ERROR) << "ResourceManager::" << location.function_name() << ":"
+               << location.line_number() << ": " << GetErrorString(tpm_error);
+  }
   return tpm_error + kResourceManagerTpmErrorBase;
 }
 
 TPM_RC ResourceManager::ParseCommand(const std::string& command,
                                      MessageInfo* command_info) {
   CHECK(command_info);
-  std::string buffer = command;
-  TPM_ST tag;
-  TPM_RC result = Parse_TPM_ST(&buffer, &tag, nullptr);
-  if (result != TPM_RC_SUCCESS) {
-    return MakeError(result, FROM_HERE);
+  MessageReader reader(command);
+  UINT16 tag = 0;
+  if (!reader.ReadUint16(&tag)) {
+    return MakeError(TPM_RC_INSUFFICIENT, FROM_HERE);
   }
   if (tag != TPM_ST_SESSIONS && tag != TPM_ST_NO_SESSIONS) {
     return MakeError(TPM_RC_TAG, FROM_HERE);
@@ -494,72 +1711,66 @@ TPM_RC ResourceManager::ParseCommand(const std::string& command,
   command_info->has_sessions = (tag == TPM_ST_SESSIONS);
 
   UINT32 size = 0;
-  result = Parse_UINT32(&buffer, &size, nullptr);
-  if (result != TPM_RC_SUCCESS) {
-    return MakeError(result, FROM_HERE);
+  if (!reader.ReadUint32(&size)) {
+    return MakeError(TPM_RC_INSUFFICIENT, FROM_HERE);
   }
   if (size != command.size()) {
     return MakeError(TPM_RC_SIZE, FROM_HERE);
   }
 
-  result = Parse_TPM_CC(&buffer, &command_info->code, nullptr);
-  if (result != TPM_RC_SUCCESS) {
-    return MakeError(result, FROM_HERE);
+  if (!reader.ReadUint32(&command_info->code)) {
+    return MakeError(TPM_RC_INSUFFICIENT, FROM_HERE);
   }
-  if (command_info->code < TPM_CC_FIRST || command_info->code > TPM_CC_LAST) {
+  const TpmCommandMetadata* metadata = GetCommandMetadata(command_info->code);
+  if (!metadata) {
     return MakeError(TPM_RC_COMMAND_CODE, FROM_HERE);
   }
 
-  size_t number_of_handles = GetNumberOfRequestHandles(command_info->code);
-  command_info->handles = ExtractHandlesFromBuffer(number_of_handles, &buffer);
-  if (number_of_handles != command_info->handles.size()) {
+  size_t number_of_handles = metadata->request_handles;
+  if (number_of_handles > HandleList::kCapacity) {
     return MakeError(TPM_RC_SIZE, FROM_HERE);
   }
+  for (size_t i = 0; i < number_of_handles; ++i) {
+    TPM_HANDLE handle = 0;
+    if (!reader.ReadUint32(&handle)) {
+      return MakeError(TPM_RC_SIZE, FROM_HERE);
+    }
+    command_info->handles.push_back(handle);
+  }
   if (command_info->has_sessions) {
     // Sessions exist, so we're expecting a valid authorization size value.
     UINT32 authorization_size = 0;
-    result = Parse_UINT32(&buffer, &authorization_size, nullptr);
-    if (result != TPM_RC_SUCCESS) {
-      return MakeError(result, FROM_HERE);
+    if (!reader.ReadUint32(&authorization_size)) {
+      return MakeError(TPM_RC_INSUFFICIENT, FROM_HERE);
     }
-    if (buffer.size() < authorization_size ||
+    if (reader.remaining().size() < authorization_size ||
         authorization_size < kMinimumAuthorizationSize) {
       return MakeError(TPM_RC_SIZE, FROM_HERE);
     }
-    // Move out the parameter bytes, leaving only the authorization section.
-    command_info->parameter_data = buffer.substr(authorization_size);
-    buffer.erase(authorization_size);
+    // Split off the parameter bytes, leaving only the authorization section.
+    command_info->parameter_data =
+        reader.remaining().substr(authorization_size);
+    MessageReader auth_reader(reader.remaining().substr(0, authorization_size));
     // Parse as many authorization sessions as there are in the section.
-    while (!buffer.empty()) {
-      TPM_HANDLE handle;
-      result = Parse_TPM_HANDLE(&buffer, &handle, nullptr);
-      if (result != TPM_RC_SUCCESS) {
-        return MakeError(result, FROM_HERE);
+    while (!auth_reader.remaining().empty()) {
+      TPM_HANDLE handle = 0;
+      BYTE attributes = 0;
+      if (!auth_reader.ReadUint32(&handle) || !auth_reader.SkipSized() ||
+          !auth_reader.ReadUint8(&attributes) || !auth_reader.SkipSized()) {
+        return MakeError(TPM_RC_INSUFFICIENT, FROM_HERE);
       }
       if (handle != TPM_RS_PW && session_handles_.count(handle) == 0) {
         return MakeError(TPM_RC_HANDLE, FROM_HERE);
       }
-      TPM2B_NONCE nonce;
-      result = Parse_TPM2B_NONCE(&buffer, &nonce, nullptr);
-      if (result != TPM_RC_SUCCESS) {
-        return MakeError(result, FROM_HERE);
-      }
-      BYTE attributes;
-      result = Parse_BYTE(&buffer, &attributes, nullptr);
-      if (result != TPM_RC_SUCCESS) {
-        return MakeError(result, FROM_HERE);
-      }
-      TPM2B_DIGEST authorization;
-      result = Parse_TPM2B_DIGEST(&buffer, &authorization, nullptr);
-      if (result != TPM_RC_SUCCESS) {
-        return MakeError(result, FROM_HERE);
+      if (command_info->session_handles.full()) {
+        return MakeError(TPM_RC_SIZE, FROM_HERE);
       }
       command_info->session_handles.push_back(handle);
       command_info->session_continued.push_back((attributes & 1) == 1);
     }
   } else {
     // No sessions, so all remaining data is parameter data.
-    command_info->parameter_data = buffer;
+    command_info->parameter_data = reader.remaining();
   }
   return TPM_RC_SUCCESS;
 }
@@ -568,11 +1779,10 @@ TPM_RC ResourceManager::ParseResponse(const MessageInfo& command_info,
                                       const std::string& response,
                                       MessageInfo* response_info) {
   CHECK(response_info);
-  std::string buffer = response;
-  TPM_ST tag;
-  TPM_RC result = Parse_TPM_ST(&buffer, &tag, nullptr);
-  if (result != TPM_RC_SUCCESS) {
-    return MakeError(result, FROM_HERE);
+  MessageReader reader(response);
+  UINT16 tag = 0;
+  if (!reader.ReadUint16(&tag)) {
+    return MakeError(TPM_RC_INSUFFICIENT, FROM_HERE);
   }
   if (tag != TPM_ST_SESSIONS && tag != TPM_ST_NO_SESSIONS) {
     return MakeError(TPM_RC_TAG, FROM_HERE);
@@ -580,59 +1790,62 @@ TPM_RC ResourceManager::ParseResponse(const MessageInfo& command_info,
   response_info->has_sessions = (tag == TPM_ST_SESSIONS);
 
   UINT32 size = 0;
-  result = Parse_UINT32(&buffer, &size, nullptr);
-  if (result != TPM_RC_SUCCESS) {
-    return MakeError(result, FROM_HERE);
+  if (!reader.ReadUint32(&size)) {
+    return MakeError(TPM_RC_INSUFFICIENT, FROM_HERE);
   }
   if (size != response.size()) {
     return MakeError(TPM_RC_SIZE, FROM_HERE);
   }
 
-  result = Parse_TPM_RC(&buffer, &response_info->code, nullptr);
-  if (result != TPM_RC_SUCCESS) {
-    return MakeError(result, FROM_HERE);
+  if (!reader.ReadUint32(&response_info->code)) {
+    return MakeError(TPM_RC_INSUFFICIENT, FROM_HERE);
+  }
+  if (response_info->code != TPM_RC_SUCCESS) {
+    // An unsuccessful response carries nothing but the header.
+    return TPM_RC_SUCCESS;
   }
 
   size_t number_of_handles = GetNumberOfResponseHandles(command_info.code);
-  response_info->handles = ExtractHandlesFromBuffer(number_of_handles, &buffer);
-  if (number_of_handles != response_info->handles.size()) {
+  if (number_of_handles > HandleList::kCapacity) {
     return MakeError(TPM_RC_SIZE, FROM_HERE);
   }
+  for (size_t i = 0; i < number_of_handles; ++i) {
+    TPM_HANDLE handle = 0;
+    if (!reader.ReadUint32(&handle)) {
+      return MakeError(TPM_RC_SIZE, FROM_HERE);
+    }
+    response_info->handles.push_back(handle);
+  }
   if (response_info->has_sessions) {
     // Sessions exist, so we're expecting a valid parameter size value.
     UINT32 parameter_size = 0;
-    result = Parse_UINT32(&buffer, &parameter_size, nullptr);
-    if (result != TPM_RC_SUCCESS) {
-      return MakeError(result, FROM_HERE);
+    if (!reader.ReadUint32(&parameter_size)) {
+      return MakeError(TPM_RC_INSUFFICIENT, FROM_HERE);
     }
-    if (buffer.size() < parameter_size) {
+    if (reader.remaining().size() < parameter_size) {
       return MakeError(TPM_RC_SIZE, FROM_HERE);
     }
-    // Move out the parameter bytes, leaving only the authorization section.
-    response_info->parameter_data = buffer.substr(0, parameter_size);
-    buffer.erase(0, parameter_size);
+    // Split off the parameter bytes, leaving only the authorization section.
+    response_info->parameter_data =
+        reader.remaining().substr(0, parameter_size);
+    MessageReader auth_reader(reader.remaining().substr(parameter_size));
     // Parse as many authorization sessions as there are in the section.
-    while (!buffer.empty()) {
-      TPM2B_NONCE nonce;
-      result = Parse_TPM2B_NONCE(&buffer, &nonce, nullptr);
-      if (result != TPM_RC_SUCCESS) {
-        return MakeError(result, FROM_HERE);
+    while (!auth_reader.remaining().empty()) {
+      base::StringPiece nonce;
+      BYTE attributes = 0;
+      if (!auth_reader.ReadSized(&nonce) ||
+          !auth_reader.ReadUint8(&attributes) || !auth_reader.SkipSized()) {
+        return MakeError(TPM_RC_INSUFFICIENT, FROM_HERE);
       }
-      BYTE attributes;
-      result = Parse_BYTE(&buffer, &attributes, nullptr);
-      if (result != TPM_RC_SUCCESS) {
-        return MakeError(result, FROM_HERE);
-      }
-      TPM2B_DIGEST acknowledgement;
-      result = Parse_TPM2B_DIGEST(&buffer, &acknowledgement, nullptr);
-      if (result != TPM_RC_SUCCESS) {
-        return MakeError(result, FROM_HERE);
+      if (response_info->session_continued.full()) {
+        return MakeError(TPM_RC_SIZE, FROM_HERE);
       }
+      response_info->session_nonces.push_back(nonce);
       response_info->session_continued.push_back((attributes & 1) == 1);
     }
   } else {
     // No sessions, so all remaining data is parameter data.
-    response_info->parameter_data = buffer;
+    response_info->parameter_data = reader.remaining();
   }
   return TPM_RC_SUCCESS;
 }
@@ -652,7 +1865,7 @@ void ResourceManager::ProcessExternalContextSave(
   if (!IsSessionHandle(saved_handle)) {
     return;
   }
-  std::string mutable_parameter = response_info.parameter_data;
+  std::string mutable_parameter = response_info.parameter_data.as_string();
   TPMS_CONTEXT context;
   std::string context_blob;
   TPM_RC result =
@@ -661,35 +1874,286 @@ void ResourceManager::ProcessExternalContextSave(
     LOG(WARNING) << "Invalid context save response: " << GetErrorString(result);
     return;
   }
+  newest_context_sequence_ =
+      std::max(newest_context_sequence_, context.sequence);
   auto iter = session_handles_.find(saved_handle);
   if (iter != session_handles_.end()) {
     iter->second.is_loaded = false;
-    iter->second.context = context;
+    SetSavedContext(context, &iter->second);
+    // The caller may load the saved context later, so the session must not
+    // pass to another client.
+    iter->second.reuse_key.clear();
   } else {
     // Unknown handle? Not anymore.
     LOG(WARNING) << "Context for unknown handle.";
     HandleInfo new_handle_info;
     new_handle_info.Init(saved_handle);
     new_handle_info.is_loaded = false;
-    new_handle_info.context = context;
+    SetSavedContext(context, &new_handle_info);
     session_handles_[saved_handle] = new_handle_info;
   }
+  JournalHandle(saved_handle);
   // Use the original context data as the 'external' context data. If this gets
   // virtualized, only the 'actual' context data will change.
-  external_context_to_actual_[context_blob] = context_blob;
-  actual_context_to_external_[context_blob] = context_blob;
+  AddExternalContext(context_blob);
+}
+
+std::string ResourceManager::GetSessionReuseKey(
+    const MessageInfo& command_info) const {
+  CHECK_EQ(command_info.code, TPM_CC_StartAuthSession);
+  // Neither salted (tpmKey) nor bound (bind) sessions qualify: their session
+  // keys are secrets of the client which started them.
+  if (command_info.handles.size() != 2 ||
+      command_info.handles[0] != TPM_RH_NULL ||
+      command_info.handles[1] != TPM_RH_NULL) {
+    return std::string();
+  }
+  MessageReader reader(command_info.parameter_data);
+  base::StringPiece encrypted_salt;
+  UINT8 session_type = 0;
+  if (!reader.SkipSized() || !reader.ReadSized(&encrypted_salt) ||
+      !encrypted_salt.empty()) {
+    return std::string();
+  }
+  // The rest is the session type, symmetric algorithm and session hash.
+  base::StringPiece reuse_key = reader.remaining();
+  if (!reader.ReadUint8(&session_type) || session_type != TPM_SE_HMAC) {
+    return std::string();
+  }
+  return reuse_key.as_string();
+}
+
+void ResourceManager::SeedPcrShadow() {
+  TPMI_YES_NO more_data = NO;
+  TPMS_CAPABILITY_DATA data;
+  TPM_RC result = factory_.GetTpm()->GetCapabilitySync(
+      TPM_CAP_PCRS, 0, 1, &more_data, &data, nullptr);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(WARNING) << "Failed to query PCR banks: " << GetErrorString(result);
+    return;
+  }
+  TPML_PCR_SELECTION pending = data.data.assigned_pcr;
+  for (UINT32 i = 0; i < pending.count; ++i) {
+    pcr_select_sizes_[pending.pcr_selections[i].hash] =
+        pending.pcr_selections[i].sizeof_select;
+  }
+  // Each PCR_Read returns as many of the pending PCRs as fit in a response.
+  while (!IsPcrSelectionEmpty(pending)) {
+    UINT32 pcr_update_counter = 0;
+    TPML_PCR_SELECTION pcr_selection;
+    TPML_DIGEST pcr_values;
+    result = factory_.GetTpm()->PCR_ReadSync(pending, &pcr_update_counter,
+                                             &pcr_selection, &pcr_values,
+                                             nullptr);
+    if (result != TPM_RC_SUCCESS) {
+      LOG(WARNING) << "Failed to read PCRs: " << GetErrorString(result);
+      return;
+    }
+    if (UpdatePcrShadow(pcr_update_counter, pcr_selection, pcr_values) == 0) {
+      break;
+    }
+    for (UINT32 i = 0; i < pcr_selection.count; ++i) {
+      const TPMS_PCR_SELECTION& read = pcr_selection.pcr_selections[i];
+      for (UINT32 j = 0; j < pending.count; ++j) {
+        TPMS_PCR_SELECTION& bank = pending.pcr_selections[j];
+        for (UINT8 k = 0; bank.hash == read.hash && k < PCR_SELECT_MAX; ++k) {
+          bank.pcr_select[k] &= ~read.pcr_select[k];
+        }
+      }
+    }
+  }
+  VLOG(1) << "Shadowing " << pcr_shadow_.size() << " PCRs.";
+}
+
+size_t ResourceManager::UpdatePcrShadow(
+    UINT32 pcr_update_counter,
+    const TPML_PCR_SELECTION& pcr_selection,
+    const TPML_DIGEST& pcr_values) {
+  if (pcr_update_counter_known_ && pcr_update_counter != pcr_update_counter_) {
+    // Some PCR changed without this resource manager noticing.
+    LOG(WARNING) << "Unexpected PCR update, dropping the PCR shadow.";
+    pcr_shadow_.clear();
+  }
+  pcr_update_counter_ = pcr_update_counter;
+  pcr_update_counter_known_ = true;
+  // The values follow the order of the selection.
+  UINT32 value_index = 0;
+  for (UINT32 i = 0; i < pcr_selection.count; ++i) {
+    const TPMS_PCR_SELECTION& bank = pcr_selection.pcr_selections[i];
+    UINT32 select_bits =
+        std::min<UINT32>(bank.sizeof_select, PCR_SELECT_MAX) * 8;
+    for (UINT32 pcr = 0; pcr < select_bits; ++pcr) {
+      if (!(bank.pcr_select[pcr / 8] & (1 << (pcr % 8)))) {
+        continue;
+      }
+      if (value_index >= pcr_values.count) {
+        LOG(WARNING) << "PCR_Read returned too few values.";
+        return value_index;
+      }
+      pcr_shadow_[std::make_pair(bank.hash, pcr)] =
+          pcr_values.digests[value_index++];
+    }
+  }
+  return value_index;
+}
+
+bool ResourceManager::ReadPcrShadow(const MessageInfo& command_info,
+                                    std::string* response) {
+  if (command_info.has_sessions || !pcr_update_counter_known_) {
+    return false;
+  }
+  ParseCursor cursor(command_info.parameter_data.data(),
+                     command_info.parameter_data.size());
+  TPML_PCR_SELECTION pcr_selection;
+  if (Parse_TPML_PCR_SELECTION(&cursor, &pcr_selection) != TPM_RC_SUCCESS ||
+      cursor.remaining() != 0 || pcr_selection.count == 0) {
+    return false;
+  }
+  // Only selections the TPM would return in full and unchanged are answered,
+  // so the response does not depend on how a TPM trims a selection.
+  TPML_DIGEST pcr_values;
+  pcr_values.count = 0;
+  std::set<TPMI_ALG_HASH> banks;
+  for (UINT32 i = 0; i < pcr_selection.count; ++i) {
+    const TPMS_PCR_SELECTION& bank = pcr_selection.pcr_selections[i];
+    auto size_iter = pcr_select_sizes_.find(bank.hash);
+    if (size_iter == pcr_select_sizes_.end() ||
+        size_iter->second != bank.sizeof_select ||
+        !banks.insert(bank.hash).second) {
+      return false;
+    }
+    for (UINT32 pcr = 0; pcr < bank.sizeof_select * 8u; ++pcr) {
+      if (!(bank.pcr_select[pcr / 8] & (1 << (pcr % 8)))) {
+        continue;
+      }
+      auto iter = pcr_shadow_.find(std::make_pair(bank.hash, pcr));
+      if (iter == pcr_shadow_.end() ||
+          pcr_values.count == arraysize(pcr_values.digests)) {
+        return false;
+      }
+      pcr_values.digests[pcr_values.count++] = iter->second;
+    }
+  }
+  std::string parameters;
+  Serialize_UINT32(pcr_update_counter_, &parameters);
+  Serialize_TPML_PCR_SELECTION(pcr_selection, &parameters);
+  Serialize_TPML_DIGEST(pcr_values, &parameters);
+  response->clear();
+  Serialize_TPM_ST(TPM_ST_NO_SESSIONS, response);
+  Serialize_UINT32(kMessageHeaderSize + parameters.size(), response);
+  Serialize_TPM_RC(TPM_RC_SUCCESS, response);
+  response->append(parameters);
+  base::AutoLock lock(counters_lock_);
+  ++counters_.shadow_pcr_reads;
+  return true;
+}
+
+void ResourceManager::InvalidatePcrShadow(const MessageInfo& command_info) {
+  switch (command_info.code) {
+    case TPM_CC_PCR_Extend:
+    case TPM_CC_PCR_Event:
+    case TPM_CC_PCR_Reset:
+    case TPM_CC_EventSequenceComplete:
+      // Only the PCR in the first handle changes, but the update counter may
+      // change too.
+      pcr_update_counter_known_ = false;
+      if (!command_info.handles.empty()) {
+        TPM_HANDLE pcr = command_info.handles[0] - HR_PCR;
+        for (auto iter = pcr_shadow_.begin(); iter != pcr_shadow_.end();) {
+          if (iter->first.second == pcr) {
+            iter = pcr_shadow_.erase(iter);
+          } else {
+            ++iter;
+          }
+        }
+        return;
+      }
+      break;
+    case TPM_CC_PCR_Allocate:
+    case TPM_CC_Startup:
+      pcr_update_counter_known_ = false;
+      break;
+    default:
+      return;
+  }
+  pcr_shadow_.clear();
+}
+
+bool ResourceManager::ReuseParkedSession(const std::string& reuse_key,
+                                         std::string* response) {
+  // Prefer the most recently parked session; it is the most likely to still be
+  // loaded.
+  auto parked_iter = std::find_if(
+      parked_sessions_.rbegin(), parked_sessions_.rend(),
+      [this, &reuse_key](TPM_HANDLE handle) {
+        return session_handles_[handle].reuse_key == reuse_key;
+      });
+  if (parked_iter == parked_sessions_.rend()) {
+    return false;
+  }
+  TPM_HANDLE handle = *parked_iter;
+  parked_sessions_.erase(std::next(parked_iter).base());
+  HandleInfo& info = session_handles_[handle];
+  info.parked = false;
+  info.owner = current_client_;
+  info.time_of_last_use = base::TimeTicks::Now();
+  JournalHandle(handle);
+  {
+    base::AutoLock lock(counters_lock_);
+    ++counters_.sessions_reused;
+  }
+  std::string parameters;
+  Serialize_TPM_HANDLE(handle, &parameters);
+  Serialize_TPM2B_NONCE(Make_TPM2B_DIGEST(info.nonce_tpm), &parameters);
+  response->clear();
+  Serialize_TPM_ST(TPM_ST_NO_SESSIONS, response);
+  Serialize_UINT32(kMessageHeaderSize + parameters.size(), response);
+  Serialize_TPM_RC(TPM_RC_SUCCESS, response);
+  response->append(parameters);
+  VLOG(1) << "REUSE_SESSION: " << std::hex << handle;
+  return true;
+}
+
+bool ResourceManager::ParkSession(TPM_HANDLE session_handle) {
+  auto iter = session_handles_.find(session_handle);
+  if (iter == session_handles_.end() || iter->second.reuse_key.empty() ||
+      iter->second.nonce_tpm.empty() ||
+      parked_sessions_.size() >= kMaxParkedSessions) {
+    return false;
+  }
+  iter->second.parked = true;
+  iter->second.owner.clear();
+  parked_sessions_.push_back(session_handle);
+  JournalHandle(session_handle);
+  {
+    base::AutoLock lock(counters_lock_);
+    ++counters_.sessions_parked;
+  }
+  VLOG(1) << "PARK_SESSION: " << std::hex << session_handle;
+  return true;
+}
+
+bool ResourceManager::IsSessionAccessible(TPM_HANDLE handle) const {
+  auto iter = session_handles_.find(handle);
+  if (iter == session_handles_.end() || iter->second.reuse_key.empty()) {
+    return true;
+  }
+  if (iter->second.parked) {
+    return false;
+  }
+  return current_client_.empty() || iter->second.owner.empty() ||
+         iter->second.owner == current_client_;
 }
 
 std::string ResourceManager::ProcessFlushContext(
     const std::string& command,
     const MessageInfo& command_info) {
-  std::string buffer = command_info.parameter_data;
   // There must be exactly one handle in the parameters section.
-  std::vector<TPM_HANDLE> handles = ExtractHandlesFromBuffer(1, &buffer);
-  if (handles.size() != 1) {
+  MessageReader reader(command_info.parameter_data);
+  TPM_HANDLE handle = 0;
+  if (!reader.ReadUint32(&handle)) {
     return CreateErrorResponse(MakeError(TPM_RC_SIZE, FROM_HERE));
   }
-  TPM_HANDLE handle = handles[0];
   TPM_HANDLE actual_handle = handle;
   if (IsObjectHandle(handle)) {
     auto iter = virtual_object_handles_.find(handle);
@@ -702,6 +2166,10 @@ std::string ResourceManager::ProcessFlushContext(
       return CreateErrorResponse(TPM_RC_SUCCESS);
     }
     actual_handle = iter->second.tpm_handle;
+  } else if (!IsSessionAccessible(handle)) {
+    return CreateErrorResponse(MakeError(TPM_RC_HANDLE, FROM_HERE));
+  } else if (ParkSession(handle)) {
+    return CreateErrorResponse(TPM_RC_SUCCESS);
   }
   // Send a command with the original header but with |actual_handle| as the
   // parameter.
@@ -711,7 +2179,9 @@ std::string ResourceManager::ProcessFlushContext(
       command.substr(0, kMessageHeaderSize) + handle_blob;
   // No need to loop and fix warnings, there are no actionable warnings on when
   // flushing context.
+  base::TimeTicks start = base::TimeTicks::Now();
   std::string response = next_transceiver_->SendCommandAndWait(updated_command);
+  RecordTpmRoundTrip(start);
   MessageInfo response_info;
   TPM_RC result = ParseResponse(command_info, response, &response_info);
   if (result != TPM_RC_SUCCESS) {
@@ -744,70 +2214,89 @@ TPM_RC ResourceManager::ProcessInputHandle(const MessageInfo& command_info,
       return result;
     }
     tpm_object_handles_[handle_info.tpm_handle] = virtual_handle;
+    JournalHandle(virtual_handle);
     VLOG(1) << "RELOAD_OBJECT: " << std::hex << virtual_handle;
   }
+  handle_info.time_of_last_use = base::TimeTicks::Now();
+  ++handle_info.use_count;
   VLOG(1) << "INPUT_HANDLE_REPLACE: " << std::hex << virtual_handle << " -> "
           << std::hex << handle_info.tpm_handle;
   *actual_handle = handle_info.tpm_handle;
   return TPM_RC_SUCCESS;
 }
 
-TPM_HANDLE ResourceManager::ProcessOutputHandle(TPM_HANDLE handle) {
+TPM_RC ResourceManager::ProcessOutputHandle(TPM_HANDLE handle,
+                                            TPM_HANDLE* virtual_handle) {
+  *virtual_handle = handle;
   // Track, but do not virtualize, session handles.
   if (IsSessionHandle(handle)) {
     auto session_handle_iter = session_handles_.find(handle);
     if (session_handle_iter == session_handles_.end()) {
       HandleInfo new_handle_info;
       new_handle_info.Init(handle);
+      new_handle_info.owner = current_client_;
       session_handles_[handle] = new_handle_info;
+      JournalHandle(handle);
       VLOG(1) << "OUTPUT_HANDLE_NEW_SESSION: " << std::hex << handle;
     }
-    return handle;
+    return TPM_RC_SUCCESS;
   }
   // Only transient object handles are virtualized.
   if (!IsObjectHandle(handle)) {
-    return handle;
+    return TPM_RC_SUCCESS;
   }
   auto virtual_handle_iter = tpm_object_handles_.find(handle);
   if (virtual_handle_iter == tpm_object_handles_.end()) {
-    TPM_HANDLE new_virtual_handle = CreateVirtualHandle();
+    TPM_HANDLE new_virtual_handle = 0;
+    if (!CreateVirtualHandle(&new_virtual_handle)) {
+      // The new object cannot be tracked so it must not stay loaded.
+      factory_.GetTpm()->FlushContextSync(handle, nullptr);
+      return MakeError(TPM_RC_OBJECT_HANDLES, FROM_HERE);
+    }
     HandleInfo new_handle_info;
     new_handle_info.Init(handle);
+    new_handle_info.owner = current_client_;
     virtual_object_handles_[new_virtual_handle] = new_handle_info;
     tpm_object_handles_[handle] = new_virtual_handle;
+    JournalHandle(new_virtual_handle);
     VLOG(1) << "OUTPUT_HANDLE_NEW_VIRTUAL: " << std::hex << handle << " -> "
             << std::hex << new_virtual_handle;
-    return new_virtual_handle;
+    *virtual_handle = new_virtual_handle;
+    return TPM_RC_SUCCESS;
   }
   VLOG(1) << "OUTPUT_HANDLE_REPLACE: " << std::hex << handle << " -> "
           << std::hex << virtual_handle_iter->second;
-  return virtual_handle_iter->second;
+  *virtual_handle = virtual_handle_iter->second;
+  return TPM_RC_SUCCESS;
 }
 
-std::string ResourceManager::ReplaceHandles(
-    const std::string& message,
-    const std::vector<TPM_HANDLE>& new_handles) {
-  std::string handles_blob;
-  for (auto handle : new_handles) {
-    CHECK_EQ(Serialize_TPM_HANDLE(handle, &handles_blob), TPM_RC_SUCCESS);
+void ResourceManager::ReplaceHandles(const HandleList& new_handles,
+                                     std::string* message) {
+  CHECK_GE(message->size(),
+           kMessageHeaderSize + new_handles.size() * sizeof(TPM_HANDLE));
+  char* handle_data = base::string_as_array(message) + kMessageHeaderSize;
+  for (TPM_HANDLE handle : new_handles) {
+    // Handles are big-endian on the wire.
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      *handle_data++ = static_cast<char>(handle >> shift);
+    }
   }
-  std::string mutable_message = message;
-  CHECK_GE(message.size(), kMessageHeaderSize + handles_blob.size());
-  return mutable_message.replace(kMessageHeaderSize, handles_blob.size(),
-                                 handles_blob);
 }
 
 TPM_RC ResourceManager::SaveContext(const MessageInfo& command_info,
                                     HandleInfo* handle_info) {
   CHECK(handle_info->is_loaded);
+  TPMS_CONTEXT context;
+  memset(&context, 0, sizeof(context));
   TPM_RC result = TPM_RC_SUCCESS;
   int attempts = 0;
   while (attempts++ < kMaxCommandAttempts) {
     std::string tpm_handle_name;
     Serialize_TPM_HANDLE(handle_info->tpm_handle, &tpm_handle_name);
-    result = factory_.GetTpm()->ContextSaveSync(handle_info->tpm_handle,
-                                                tpm_handle_name,
-                                                &handle_info->context, nullptr);
+    base::TimeTicks start = base::TimeTicks::Now();
+    result = factory_.GetTpm()->ContextSaveSync(
+        handle_info->tpm_handle, tpm_handle_name, &context, nullptr);
+    RecordTpmRoundTrip(start);
     if (!FixWarnings(command_info, result)) {
       break;
     }
@@ -818,13 +2307,42 @@ TPM_RC ResourceManager::SaveContext(const MessageInfo& command_info,
     return result;
   }
   handle_info->is_loaded = false;
+  SetSavedContext(context, handle_info);
+  if (IsSessionHandle(handle_info->tpm_handle)) {
+    newest_context_sequence_ =
+        std::max(newest_context_sequence_, context.sequence);
+  }
+  base::AutoLock lock(counters_lock_);
+  ++counters_.context_saves;
   return result;
 }
 
-ResourceManager::HandleInfo::HandleInfo() : is_loaded(false), tpm_handle(0) {
-  memset(&context, 0, sizeof(TPMS_CONTEXT));
+void ResourceManager::LatencyCounts::Add(base::TimeDelta latency) {
+  size_t bucket = 0;
+  for (int64_t us = latency.InMicroseconds();
+       us > 0 && bucket < kNumLatencyBuckets - 1; us >>= 1) {
+    ++bucket;
+  }
+  ++buckets[bucket];
+  total += latency;
 }
 
+void ResourceManager::LatencyCounts::ToProto(
+    LatencyHistogram* histogram) const {
+  for (size_t i = 0; i < kNumLatencyBuckets; ++i) {
+    histogram->add_buckets(buckets[i]);
+  }
+  histogram->set_total_us(total.InMicroseconds());
+}
+
+ResourceManager::HandleInfo::HandleInfo()
+    : is_loaded(false),
+      tpm_handle(0),
+      context_sequence(0),
+      context_slot(kNoContextSlot),
+      use_count(0),
+      parked(false) {}
+
 void ResourceManager::HandleInfo::Init(TPM_HANDLE handle) {
   tpm_handle = handle;
   is_loaded = true;
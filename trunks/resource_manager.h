@@ -19,15 +19,26 @@
 
 #include "trunks/command_transceiver.h"
 
+#include <deque>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <base/callback.h>
+#include <base/files/file_path.h>
 #include <base/location.h>
+#include <base/logging.h>
 #include <base/macros.h>
+#include <base/strings/string_piece.h>
+#include <base/synchronization/lock.h>
 #include <base/time/time.h>
 
+#include "trunks/context_store.h"
+#include "trunks/interface.pb.h"
 #include "trunks/tpm_generated.h"
 #include "trunks/trunks_factory.h"
 
@@ -35,14 +46,20 @@ namespace trunks {
 
 // The ResourceManager class manages access to limited TPM resources.
 //
-// It is reactive to and synchronous with active TPM commands, it does not
-// perform any background processing. It needs to inspect every TPM command and
+// It is reactive to and synchronous with active TPM commands. The only
+// background processing is the optional PerformIdleMaintenance(), which the
+// owner may call between commands. It needs to inspect every TPM command and
 // reply. It maintains all actual TPM handles and provides its own handles to
 // callers. If a command fails because a resource is not available the resource
 // manager will perform the necessary evictions and run the command again. If a
 // command needs an object that has been evicted, that object will be loaded
 // before the command is sent to the TPM.
 //
+// Unbound, unsalted HMAC sessions carry no secret, so when a client flushes one
+// the resource manager may keep it and answer a later matching
+// StartAuthSession, from any client, with it. Such a session is only usable by
+// the client it was last handed to.
+//
 // In terms of interface the ResourceManager is simply a CommandTranceiver but
 // with the limitation that all calls are synchronous. The SendCommand method
 // is supported but does not return until the callback has been called. Keeping
@@ -50,6 +67,18 @@ namespace trunks {
 // This class works well with a BackgroundCommandTransceiver.
 class ResourceManager : public CommandTransceiver {
  public:
+  // Policies for choosing which transient objects to evict when the TPM runs
+  // out of object memory.
+  enum EvictionPolicy {
+    // Evict every object not needed by the current command.
+    kEvictAll,
+    // Evict one object at a time, the one used least recently.
+    kEvictLeastRecentlyUsed,
+    // Evict one object at a time, the one used least often. Use counts decay
+    // over time and ties are broken by recency.
+    kEvictLeastFrequentlyUsed,
+  };
+
   // The given |factory| will be used to create objects so mocks can be easily
   // injected. This class retains a reference to the factory; the factory must
   // remain valid for the duration of the ResourceManager lifetime. The
@@ -59,22 +88,206 @@ class ResourceManager : public CommandTransceiver {
                   CommandTransceiver* next_transceiver);
   ~ResourceManager() override;
 
+  // Ensures the TPM is started and queues every transient object and session
+  // not restored from the state file to be flushed. Queued handles are flushed
+  // as one batch by PerformIdleMaintenance(), or as soon as a command needs
+  // room in the TPM.
   void Initialize();
 
+  // Enables checkpointing of the handle tables to |path|, which should be on a
+  // tmpfs. Every change is appended to the file so that after trunksd restarts
+  // Initialize() restores virtual object handles, sessions and saved contexts
+  // instead of flushing them, provided the TPM has not been reset or restarted
+  // in the meantime. Must be called before Initialize().
+  void set_state_file(const base::FilePath& path) { state_file_ = path; }
+
+  // Does background work intended to run when no commands are pending:
+  // - Handles queued by Initialize() or OnClientDisconnected() are flushed.
+  // - Saved sessions whose context counter lags far behind the newest are
+  //   reloaded and saved again, a few per call, so the context gap is closed
+  //   long before the TPM reports TPM_RC_CONTEXT_GAP.
+  // - If idle eviction is enabled, the least recently used objects and
+  //   sessions are evicted until a small reserve of slots is free so that
+  //   subsequent commands rarely fail with a memory warning.
+  // - If context spilling is enabled, saved contexts of handles idle for
+  //   longer than the spill threshold are moved to the context store.
+  // - If idle housekeeping is enabled, one step of it is done.
+  // Must not be called while a command is being processed. Returns true if
+  // housekeeping work remains, so the caller should call again when the TPM
+  // is still idle.
+  bool PerformIdleMaintenance();
+
+  // Enables or disables the eviction done by PerformIdleMaintenance(). It is
+  // enabled by default.
+  void set_idle_eviction(bool enabled) { idle_eviction_ = enabled; }
+
+  // Enables or disables idle housekeeping. When enabled, Initialize() skips
+  // the full TPM self-test and PerformIdleMaintenance() instead self-tests the
+  // algorithms trunks uses one at a time, so no client command absorbs a lazy
+  // self-test once traffic starts. It also stirs the TPM random number
+  // generator with host entropy about once an hour. It is disabled by default.
+  // Must be called before Initialize().
+  void set_idle_housekeeping(bool enabled) { idle_housekeeping_ = enabled; }
+
+  // Enables or disables the PCR shadow. When enabled, Initialize() reads every
+  // allocated PCR and PCR_Read commands without sessions are then answered
+  // from that copy whenever it holds all the PCRs requested. Commands which
+  // change PCRs drop the affected values, and the next PCR_Read sent to the
+  // TPM brings them and the update counter up to date again. This is only
+  // correct if every PCR change goes through this resource manager. It is
+  // disabled by default. Must be called before Initialize().
+  void set_pcr_shadow(bool enabled) { pcr_shadow_enabled_ = enabled; }
+
+  // Enables keeping the saved contexts of objects and sessions which have not
+  // been used for |idle_threshold| in a ContextStore at |path|, which should be
+  // on a tmpfs, instead of in memory. PerformIdleMaintenance() moves them there
+  // and they are read back when the handle is next loaded, so memory use does
+  // not grow with the number of idle handles clients hold. Must be called
+  // before Initialize().
+  void set_context_spill(const base::FilePath& path,
+                         base::TimeDelta idle_threshold) {
+    context_spill_file_ = path;
+    context_spill_threshold_ = idle_threshold;
+  }
+
+  // Sets the policy used to evict transient objects. The default is
+  // kEvictLeastRecentlyUsed.
+  void set_eviction_policy(EvictionPolicy policy) { eviction_policy_ = policy; }
+
+  // Limits the number of objects and sessions a single client may hold. A
+  // command which would create another handle for a client at the limit fails
+  // without reaching the TPM. Zero, the default, means no limit. Commands not
+  // sent for a known client are never limited.
+  void set_client_handle_quota(size_t quota) { client_handle_quota_ = quota; }
+
   // CommandTransceiver methods.
   void SendCommand(const std::string& command,
                    const ResponseCallback& callback) override;
 
   std::string SendCommandAndWait(const std::string& command) override;
 
+  // Handles created by the command are owned by |client|. When objects need to
+  // be evicted those of the client with the most loaded objects go first.
+  void SendCommandForClient(const std::string& client,
+                            const std::string& command,
+                            const ResponseCallback& callback) override;
+
+  // Forgets every object and session owned by |client|. Those loaded or saved
+  // in the TPM are queued to be flushed, like the stale handles found by
+  // Initialize().
+  void OnClientDisconnected(const std::string& client) override;
+
+  // Fills |stats| with the counters collected since this object was created.
+  // The session and slot gauges are only current as of the last command
+  // processed.
+  // Unlike the other methods this may be called on any thread.
+  void GetStats(ResourceManagerStats* stats) const;
+
+  // Fills |epochs| with the current TPM state epochs, which advance after each
+  // successful command that may change the corresponding state. Unlike the
+  // other methods this may be called on any thread.
+  void GetStateEpochs(TpmStateEpochs* epochs) const;
+
+  // Sets a |callback| which is run with the new epochs whenever one advances.
+  // It runs on the thread processing commands.
+  void set_state_epochs_callback(
+      const base::Callback<void(const TpmStateEpochs&)>& callback) {
+    state_epochs_callback_ = callback;
+  }
+
+  // Adds the time |command| spent queued before reaching this object to its
+  // command's stats. May be called on any thread.
+  void AddQueueLatency(const std::string& command,
+                       base::TimeDelta queue_latency);
+
  private:
+  // The number of buckets in a LatencyHistogram; the last one counts latencies
+  // of about four and a half minutes and more, so the slowest key generation
+  // still has a bounded bucket.
+  static const size_t kNumLatencyBuckets = 30;
+
+  // Accumulates a LatencyHistogram.
+  struct LatencyCounts {
+    void Add(base::TimeDelta latency);
+    void ToProto(LatencyHistogram* histogram) const;
+
+    uint64_t buckets[kNumLatencyBuckets] = {};
+    base::TimeDelta total;
+  };
+
+  // Accumulates CommandStats for one command code.
+  struct CommandCounts {
+    uint64_t count = 0;
+    uint64_t tpm_round_trips = 0;
+    LatencyCounts total_latency;
+    LatencyCounts tpm_latency;
+    LatencyCounts queue_latency;
+  };
+
+  // Everything reported by GetStats().
+  struct Counters {
+    std::map<TPM_CC, CommandCounts> commands;
+    uint64_t objects_evicted[EvictionReason_ARRAYSIZE] = {};
+    uint64_t sessions_evicted[EvictionReason_ARRAYSIZE] = {};
+    uint64_t context_loads = 0;
+    uint64_t context_saves = 0;
+    uint64_t context_gap_fixes = 0;
+    uint64_t session_refreshes = 0;
+    uint64_t warning_retries = 0;
+    uint64_t sessions_started = 0;
+    uint64_t sessions_parked = 0;
+    uint64_t sessions_reused = 0;
+    uint64_t active_sessions = 0;
+    uint64_t parked_sessions = 0;
+    uint64_t loaded_objects = 0;
+    uint64_t loaded_sessions = 0;
+    uint64_t retry_warnings = 0;
+    uint64_t yielded_warnings = 0;
+    uint64_t testing_warnings = 0;
+    uint64_t key_reloads = 0;
+    uint64_t hottest_key_loads = 0;
+    uint64_t shadow_pcr_reads = 0;
+    uint64_t context_spills = 0;
+    uint64_t spilled_context_loads = 0;
+    uint64_t spilled_contexts = 0;
+  };
+
+  // A TPM message has at most three handles and three authorization sessions so
+  // message details are kept inline instead of in heap allocated vectors.
+  template <typename T>
+  class InlineList {
+   public:
+    static const size_t kCapacity = 3;
+
+    const T* begin() const { return items_; }
+    const T* end() const { return items_ + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == kCapacity; }
+    const T& operator[](size_t index) const { return items_[index]; }
+    // The list must not be full.
+    void push_back(const T& item) {
+      CHECK(!full());
+      items_[size_++] = item;
+    }
+
+   private:
+    T items_[kCapacity] = {};
+    size_t size_ = 0;
+  };
+  using HandleList = InlineList<TPM_HANDLE>;
+
+  // Parsed details of a message. The message must outlive this object since
+  // |parameter_data| refers to it.
   struct MessageInfo {
     bool has_sessions;
     TPM_CC code;  // For a response message this is the TPM_RC response code.
-    std::vector<TPM_HANDLE> handles;
-    std::vector<TPM_HANDLE> session_handles;
-    std::vector<bool> session_continued;
-    std::string parameter_data;
+    HandleList handles;
+    HandleList session_handles;
+    InlineList<bool> session_continued;
+    // For a response message, the nonceTPM of each session.
+    InlineList<base::StringPiece> session_nonces;
+    base::StringPiece parameter_data;
   };
 
   struct HandleInfo {
@@ -85,43 +298,178 @@ class ResourceManager : public CommandTransceiver {
     bool is_loaded;
     // Valid only if |is_loaded| is true.
     TPM_HANDLE tpm_handle;
-    // Valid only if |is_loaded| is false.
-    TPMS_CONTEXT context;
+    // Valid only if |is_loaded| is false: the serialized TPMS_CONTEXT and its
+    // sequence number. |context| is empty while the context is spilled to the
+    // slot |context_slot| of the context store.
+    std::string context;
+    UINT64 context_sequence;
+    uint32_t context_slot;
     // Time when the handle is create.
     base::TimeTicks time_of_create;
     // Time when the handle was last used.
     base::TimeTicks time_of_last_use;
+    // The number of commands which used the handle, decayed on eviction.
+    int use_count;
+    // The client which created the handle, or empty if unknown.
+    std::string owner;
+    // For an unbound, unsalted HMAC session: the StartAuthSession parameters a
+    // request must match to be given this session, and the latest nonceTPM.
+    // Such a session has no secret state so it can pass between clients. Empty
+    // for any other session.
+    std::string reuse_key;
+    std::string nonce_tpm;
+    // Whether the owner flushed the session and it is kept for reuse.
+    bool parked;
+  };
+
+  // A context blob returned to a caller by an external ContextSave.
+  struct ExternalContext {
+    // The context data to actually load in place of the external one.
+    std::string actual_context;
+    // Used to discard the oldest contexts when the table is full.
+    base::TimeTicks time_of_save;
   };
 
+  // Processes a |command| and returns the response. The |code| of the command
+  // is set if it can be parsed.
+  std::string ProcessCommand(const std::string& command, TPM_CC* code);
+
+  // Counts a TPM round trip which started at |start| towards the command being
+  // processed.
+  void RecordTpmRoundTrip(base::TimeTicks start);
+
+  // Starts tracking an |external_context| blob, initially mapped to itself.
+  // If too many are tracked, the oldest is discarded.
+  void AddExternalContext(const std::string& external_context);
+
+  // Stops tracking the external context with the given |external_digest|.
+  void RemoveExternalContext(const std::string& external_digest);
+
+  // Evicts objects and sessions until a small reserve of TPM slots is free.
+  void FreeIdleSlots(const MessageInfo& idle_info);
+
+  // Does the next step of idle housekeeping: one incremental self-test, or
+  // stirring the random number generator when it is due. Returns true if more
+  // steps are pending.
+  bool PerformHousekeepingStep();
+
+  // Refreshes up to a few saved sessions whose context is more than halfway to
+  // the TPM's context gap limit, oldest first.
+  void RefreshOldSessions(const MessageInfo& idle_info);
+
+  // Loads and re-saves a saved session so the TPM assigns it a new context
+  // counter, updating any external context which maps to it. Returns true on
+  // success.
+  bool RefreshSessionContext(const MessageInfo& command_info,
+                             TPM_HANDLE session_handle);
+
+  // Makes |context| the saved context of |info|, releasing any context store
+  // slot it held.
+  void SetSavedContext(const TPMS_CONTEXT& context, HandleInfo* info);
+
+  // Returns the serialized saved context of |info|, reading it from the context
+  // store if it was spilled. Returns an empty string on failure.
+  std::string GetSavedContextBlob(const HandleInfo& info) const;
+
+  // Releases the context store slot of |info|, if it holds one.
+  void ReleaseContextSlot(HandleInfo* info);
+
+  // Moves the saved contexts of handles not used for |context_spill_threshold_|
+  // to the context store.
+  void SpillIdleContexts();
+
+  // Returns the TPM reset and restart counters serialized as a string, or an
+  // empty string on failure. The state file is only valid while these match.
+  std::string GetBootCounters();
+
+  // Adds every handle the TPM lists in the range starting at |handle_range| to
+  // |handles|.
+  void ListTpmHandles(UINT32 handle_range, std::set<TPM_HANDLE>* handles);
+
+  // Reconciles the handle tables with the handles actually present in the TPM:
+  // untracked TPM handles are queued to be flushed and tracked handles which
+  // the TPM no longer has are forgotten.
+  void SynchronizeWithTpm();
+
+  // Sends a TPM2_FlushContext for every handle in |pending_flushes_| as a
+  // single pipelined batch. Returns true if any handle was queued.
+  bool FlushPendingHandles();
+
+  // Replays |state_file_| into the handle tables. Returns true if the file
+  // exists and matches the current TPM boot counters.
+  bool RestoreState();
+
+  // Replaces |state_file_| with a compact snapshot of the handle tables.
+  void WriteCheckpoint();
+
+  // Appends the current state of |handle|, or its removal if it is no longer
+  // tracked, to |state_file_|.
+  void JournalHandle(TPM_HANDLE handle);
+
+  // Returns a state file record describing |handle|.
+  std::string MakeHandleRecord(TPM_HANDLE handle) const;
+
   // Chooses an appropriate session for eviction (or flush) which is not one of
   // |sessions_to_retain| and assigns it to |session_to_evict|. Returns true on
   // success.
-  bool ChooseSessionToEvict(const std::vector<TPM_HANDLE>& sessions_to_retain,
+  bool ChooseSessionToEvict(const HandleList& sessions_to_retain,
                             TPM_HANDLE* session_to_evict);
 
   // Cleans up all references to and information about |flushed_handle|.
   void CleanupFlushedHandle(TPM_HANDLE flushed_handle);
 
-  // Creates a new virtual object handle. If the handle space is exhausted a
-  // valid handle is flushed and re-used.
-  TPM_HANDLE CreateVirtualHandle();
+  // Creates a new virtual object handle in |handle|. Handles which have never
+  // been used are preferred but flushed handles are recycled once enough of
+  // them have accumulated. Returns false if every handle is in use; valid
+  // handles are never taken away.
+  bool CreateVirtualHandle(TPM_HANDLE* handle);
+
+  // Evicts, before anything is loaded for |command_info|, as many objects and
+  // sessions not used by the command as are needed to make room for the ones
+  // it uses which are saved. This is only possible once the number of slots in
+  // the TPM is known; otherwise the TPM reports a warning and FixWarnings()
+  // evicts one at a time.
+  void MakeRoomForCommand(const MessageInfo& command_info);
 
   // Given a session handle, ensures the session is loaded in the TPM.
   TPM_RC EnsureSessionIsLoaded(const MessageInfo& command_info,
                                TPM_HANDLE session_handle);
 
-  // Evicts all loaded objects except those required by |command_info|. The
-  // eviction is best effort; any errors will be ignored.
-  void EvictObjects(const MessageInfo& command_info);
+  // Returns the number of objects and sessions owned by |client|.
+  size_t CountClientHandles(const std::string& client) const;
 
-  // Evicts a session other than those required by |command_info|. The eviction
-  // is best effort; any errors will be ignored.
-  void EvictSession(const MessageInfo& command_info);
+  // Advances the state epochs a successful command with |code| affects.
+  void AdvanceStateEpochs(TPM_CC code);
+
+  // Counts |code| if it is a TPM warning which is passed on to the caller
+  // rather than handled by FixWarnings().
+  void CountPassedWarning(TPM_RC code);
+
+  // Counts a successful Load of the key blob in |command_info| towards the key
+  // reload stats.
+  void CountKeyLoad(const MessageInfo& command_info);
+
+  // Returns the number of transient objects currently loaded in the TPM.
+  size_t CountLoadedObjects() const;
+
+  // Returns the number of sessions currently loaded in the TPM.
+  size_t CountLoadedSessions() const;
 
-  // Returns a list of handles parsed from a given |buffer|. No more than
-  // |number_of_handles| will be parsed.
-  std::vector<TPM_HANDLE> ExtractHandlesFromBuffer(size_t number_of_handles,
-                                                   std::string* buffer);
+  // Saves and flushes the transient object described by |info|. Returns true on
+  // success.
+  bool EvictObject(const MessageInfo& command_info,
+                   EvictionReason reason,
+                   HandleInfo* info);
+
+  // Evicts loaded objects other than those required by |command_info|, as
+  // chosen by the |eviction_policy_|. The eviction is best effort; any errors
+  // will be ignored. The |reason| is only used for statistics.
+  void EvictObjects(const MessageInfo& command_info, EvictionReason reason);
+
+  // Evicts a session other than those required by |command_info|. The eviction
+  // is best effort; any errors will be ignored. The |reason| is only used for
+  // statistics.
+  void EvictSession(const MessageInfo& command_info, EvictionReason reason);
 
   // A context gap may occur when context counters for active sessions drift too
   // far apart for the TPM to manage. Basically, the TPM needs to reassign new
@@ -147,7 +495,7 @@ class ResourceManager : public CommandTransceiver {
   // |external_context| previously returned to the caller. If not found,
   // |external_context| is returned.
   std::string GetActualContextFromExternalContext(
-      const std::string& external_context);
+      base::StringPiece external_context);
 
   // Returns true iff |handle| is a transient object handle.
   bool IsObjectHandle(TPM_HANDLE handle) const;
@@ -182,6 +530,41 @@ class ResourceManager : public CommandTransceiver {
   void ProcessExternalContextSave(const MessageInfo& command_info,
                                   const MessageInfo& response_info);
 
+  // Returns the reuse key of a StartAuthSession command for an unbound,
+  // unsalted HMAC session, or an empty string if the session would not be
+  // reusable.
+  std::string GetSessionReuseKey(const MessageInfo& command_info) const;
+
+  // Hands a parked session matching |reuse_key| to the current client and
+  // fills |response| with a StartAuthSession response for it. Returns false if
+  // no parked session matches.
+  bool ReuseParkedSession(const std::string& reuse_key, std::string* response);
+
+  // Reads every allocated PCR into the PCR shadow.
+  void SeedPcrShadow();
+
+  // Records the PCR values of a successful PCR_Read in the PCR shadow. Returns
+  // the number of values recorded.
+  size_t UpdatePcrShadow(UINT32 pcr_update_counter,
+                         const TPML_PCR_SELECTION& pcr_selection,
+                         const TPML_DIGEST& pcr_values);
+
+  // Fills |response| with a response to the PCR_Read in |command_info| made
+  // from the PCR shadow. Returns false if the command has to be sent to the
+  // TPM.
+  bool ReadPcrShadow(const MessageInfo& command_info, std::string* response);
+
+  // Drops what the command in |command_info| may change from the PCR shadow.
+  void InvalidatePcrShadow(const MessageInfo& command_info);
+
+  // Keeps a reusable session its owner asked to flush. Returns false if the
+  // session has to be flushed instead.
+  bool ParkSession(TPM_HANDLE session_handle);
+
+  // Returns false if |handle| is a reusable session which is parked or owned by
+  // a known client other than the current one.
+  bool IsSessionAccessible(TPM_HANDLE handle) const;
+
   // Process an external flush context |command|.
   std::string ProcessFlushContext(const std::string& command,
                                   const MessageInfo& command_info);
@@ -195,15 +578,16 @@ class ResourceManager : public CommandTransceiver {
                             TPM_HANDLE virtual_handle,
                             TPM_HANDLE* actual_handle);
 
-  // Given a TPM object handle, returns an associated virtual handle, generating
-  // a new one if necessary.
-  TPM_HANDLE ProcessOutputHandle(TPM_HANDLE object_handle);
+  // Given a TPM |object_handle|, finds the associated |virtual_handle|,
+  // generating a new one if necessary. If no virtual handle is available the
+  // object is flushed and an error is returned. Returns TPM_RC_SUCCESS on
+  // success.
+  TPM_RC ProcessOutputHandle(TPM_HANDLE object_handle,
+                             TPM_HANDLE* virtual_handle);
 
-  // Replaces all handles in a given |message| with |new_handles| and returns
-  // the resulting modified message. The modified message is guaranteed to have
-  // the same length as the input message.
-  std::string ReplaceHandles(const std::string& message,
-                             const std::vector<TPM_HANDLE>& new_handles);
+  // Replaces all handles in a given |message| with |new_handles|. The handle
+  // bytes are overwritten in place so the message keeps the same length.
+  void ReplaceHandles(const HandleList& new_handles, std::string* message);
 
   // Saves the context for a session or object handle. On success returns
   // TPM_RC_SUCCESS and ensures |handle_info| holds valid context data.
@@ -212,17 +596,29 @@ class ResourceManager : public CommandTransceiver {
   const TrunksFactory& factory_;
   CommandTransceiver* next_transceiver_ = nullptr;
   TPM_HANDLE next_virtual_handle_ = TRANSIENT_FIRST;
+  // Whether every handle from TRANSIENT_FIRST up has been handed out once, in
+  // which case |next_virtual_handle_| is no longer used.
+  bool virtual_handles_wrapped_ = false;
+  // Flushed virtual handles available for reuse, oldest first.
+  std::deque<TPM_HANDLE> free_virtual_handles_;
 
   // A mapping of known virtual handles to corresponding HandleInfo.
-  std::map<TPM_HANDLE, HandleInfo> virtual_object_handles_;
+  std::unordered_map<TPM_HANDLE, HandleInfo> virtual_object_handles_;
   // A mapping of loaded tpm object handles to the corresponding virtual handle.
-  std::map<TPM_HANDLE, TPM_HANDLE> tpm_object_handles_;
+  std::unordered_map<TPM_HANDLE, TPM_HANDLE> tpm_object_handles_;
   // A mapping of known session handles to corresponding HandleInfo.
-  std::map<TPM_HANDLE, HandleInfo> session_handles_;
-  // A mapping of external context blobs to current context blobs.
-  std::map<std::string, std::string> external_context_to_actual_;
-  // A mapping of actual context blobs to external context blobs.
-  std::map<std::string, std::string> actual_context_to_external_;
+  std::unordered_map<TPM_HANDLE, HandleInfo> session_handles_;
+  // Parked sessions, oldest first.
+  std::deque<TPM_HANDLE> parked_sessions_;
+  // Actual TPM handles no longer tracked which still take up room in the TPM
+  // until FlushPendingHandles() is called. No command can refer to them.
+  std::vector<TPM_HANDLE> pending_flushes_;
+  // Context blobs are about 1KB so the context tables are keyed by a digest of
+  // the blob rather than the blob itself.
+  // A mapping of external context digests to the current actual context.
+  std::unordered_map<std::string, ExternalContext> external_contexts_;
+  // A mapping of actual context digests to external context digests.
+  std::unordered_map<std::string, std::string> actual_context_to_external_;
 
   // The set of warnings already handled in the context of a FixWarnings() call.
   // Tracking this allows us to avoid re-entrance.
@@ -230,6 +626,63 @@ class ResourceManager : public CommandTransceiver {
   // Whether a FixWarnings() call is currently executing.
   bool fixing_warnings_ = false;
 
+  EvictionPolicy eviction_policy_ = kEvictLeastRecentlyUsed;
+  // The number of transient objects the TPM was holding when it last ran out
+  // of object memory, or zero if that has not happened yet. Objects are evicted
+  // ahead of loading a context once this many are loaded, which saves the
+  // round trip of a failed command.
+  size_t object_slots_ = 0;
+  // Like |object_slots_| but for sessions.
+  size_t session_slots_ = 0;
+  bool idle_eviction_ = true;
+  bool idle_housekeeping_ = false;
+  // The index of the next algorithm to self-test during idle housekeeping.
+  size_t next_self_test_ = 0;
+  // When the random number generator was last stirred, or null if never.
+  base::TimeTicks last_stir_random_;
+  bool pcr_shadow_enabled_ = false;
+  // The selection size of each allocated PCR bank. Empty if the PCR shadow is
+  // disabled or could not be seeded.
+  std::map<TPMI_ALG_HASH, UINT8> pcr_select_sizes_;
+  // Known PCR values, keyed by bank and PCR index. They are all current as of
+  // |pcr_update_counter_| if it is known.
+  std::map<std::pair<TPMI_ALG_HASH, UINT32>, TPM2B_DIGEST> pcr_shadow_;
+  bool pcr_update_counter_known_ = false;
+  UINT32 pcr_update_counter_ = 0;
+  // The TPM_PT_CONTEXT_GAP_MAX property, or zero until it is first needed.
+  UINT32 context_gap_max_ = 0;
+  // The highest session context sequence number seen so far.
+  UINT64 newest_context_sequence_ = 0;
+
+  // The client of the command being processed, or empty if unknown.
+  std::string current_client_;
+  size_t client_handle_quota_ = 0;
+
+  // The context store file, or empty if context spilling is disabled.
+  base::FilePath context_spill_file_;
+  base::TimeDelta context_spill_threshold_;
+  // Set up by Initialize() if context spilling is enabled.
+  std::unique_ptr<ContextStore> context_store_;
+
+  // The state file, or empty if checkpointing is disabled.
+  base::FilePath state_file_;
+  // The number of records appended since the last checkpoint.
+  size_t journal_records_ = 0;
+
+  // TPM round trips made for the command being processed and the time they
+  // took.
+  uint64_t command_round_trips_ = 0;
+  base::TimeDelta command_tpm_time_;
+  // Guards |counters_|, which GetStats() reads on another thread.
+  mutable base::Lock counters_lock_;
+  Counters counters_;
+  // The number of successful Loads of recently loaded key blobs, keyed by a
+  // hash of the Load parameters. Used for the key reload stats only.
+  std::map<size_t, uint64_t> key_load_counts_;
+  // Also guarded by |counters_lock_|.
+  TpmStateEpochs state_epochs_;
+  base::Callback<void(const TpmStateEpochs&)> state_epochs_callback_;
+
   DISALLOW_COPY_AND_ASSIGN(ResourceManager);
 };
 
@@ -16,16 +16,21 @@
 
 #include "trunks/resource_manager.h"
 
+#include <algorithm>
+#include <map>
+#include <numeric>
 #include <string>
 #include <vector>
 
 #include <base/bind.h>
+#include <base/files/scoped_temp_dir.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include "trunks/error_codes.h"
 #include "trunks/mock_command_transceiver.h"
 #include "trunks/mock_tpm.h"
+#include "trunks/mock_tpm_utility.h"
 #include "trunks/trunks_factory_for_test.h"
 
 using testing::_;
@@ -33,6 +38,7 @@ using testing::DoAll;
 using testing::Eq;
 using testing::Field;
 using testing::InSequence;
+using testing::NiceMock;
 using testing::Return;
 using testing::ReturnPointee;
 using testing::SetArgumentPointee;
@@ -47,6 +53,11 @@ void Assign(std::string* to, const std::string& from) {
   *to = from;
 }
 
+void CopyEpochs(trunks::TpmStateEpochs* to,
+                const trunks::TpmStateEpochs& from) {
+  *to = from;
+}
+
 class ScopedDisableLogging {
  public:
   ScopedDisableLogging() : original_severity_(logging::GetMinLogLevel()) {
@@ -162,6 +173,24 @@ class ResourceManagerTest : public testing::Test {
     return virtual_handle;
   }
 
+  // Like LoadHandle but the object is loaded on behalf of |client|.
+  TPM_HANDLE LoadHandleForClient(const std::string& client, TPM_HANDLE handle) {
+    std::string command = CreateCommand(TPM_CC_Load, {PERSISTENT_FIRST},
+                                        kNoAuthorization, kNoParameters);
+    std::string response = CreateResponse(TPM_RC_SUCCESS, {handle},
+                                          kNoAuthorization, kNoParameters);
+    EXPECT_CALL(transceiver_, SendCommandAndWait(command))
+        .WillOnce(Return(response));
+    std::string actual_response;
+    resource_manager_.SendCommandForClient(
+        client, command, base::Bind(&Assign, &actual_response));
+    std::string handle_blob = StripHeader(actual_response);
+    TPM_HANDLE virtual_handle;
+    CHECK_EQ(TPM_RC_SUCCESS,
+             Parse_TPM_HANDLE(&handle_blob, &virtual_handle, NULL));
+    return virtual_handle;
+  }
+
   // Causes the resource manager to evict existing object handles.
   void EvictObjects() {
     std::string command = CreateCommand(TPM_CC_Startup, kNoHandles,
@@ -193,6 +222,38 @@ class ResourceManagerTest : public testing::Test {
     ASSERT_EQ(response, actual_response);
   }
 
+  // Builds a StartAuthSession command for an unbound, unsalted HMAC session.
+  std::string CreateReusableSessionCommand() {
+    std::string parameters;
+    Serialize_TPM2B_NONCE(Make_TPM2B_DIGEST(std::string(16, 'N')),
+                          &parameters);
+    Serialize_TPM2B_ENCRYPTED_SECRET(Make_TPM2B_ENCRYPTED_SECRET(""),
+                                     &parameters);
+    Serialize_TPM_SE(TPM_SE_HMAC, &parameters);
+    Serialize_TPM_ALG_ID(TPM_ALG_NULL, &parameters);
+    Serialize_TPM_ALG_ID(TPM_ALG_SHA256, &parameters);
+    return CreateCommand(TPM_CC_StartAuthSession, {TPM_RH_NULL, TPM_RH_NULL},
+                         kNoAuthorization, parameters);
+  }
+
+  // Like StartSession but the session is an unbound, unsalted HMAC session
+  // started by |client|. The TPM returns |nonce_tpm|.
+  void StartReusableSessionForClient(const std::string& client,
+                                     TPM_HANDLE handle,
+                                     const std::string& nonce_tpm) {
+    std::string command = CreateReusableSessionCommand();
+    std::string parameters;
+    Serialize_TPM2B_NONCE(Make_TPM2B_DIGEST(nonce_tpm), &parameters);
+    std::string response = CreateResponse(TPM_RC_SUCCESS, {handle},
+                                          kNoAuthorization, parameters);
+    EXPECT_CALL(transceiver_, SendCommandAndWait(command))
+        .WillOnce(Return(response));
+    std::string actual_response;
+    resource_manager_.SendCommandForClient(
+        client, command, base::Bind(&Assign, &actual_response));
+    ASSERT_EQ(response, actual_response);
+  }
+
   // Causes the resource manager to evict an existing session handle.
   void EvictSession() {
     std::string command = CreateCommand(TPM_CC_Startup, kNoHandles,
@@ -208,6 +269,51 @@ class ResourceManagerTest : public testing::Test {
     resource_manager_.SendCommandAndWait(command);
   }
 
+  // Sets up the TPM queries made by Initialize(). The TPM reports |restarts|
+  // as its restart count and |loaded_object| as the only transient object
+  // loaded, if it is not zero.
+  void ExpectInitialize(UINT32 restarts, TPM_HANDLE loaded_object) {
+    factory_.set_tpm_utility(&tpm_utility_);
+    TPMS_TIME_INFO time_info;
+    memset(&time_info, 0, sizeof(time_info));
+    time_info.clock_info.restart_count = restarts;
+    EXPECT_CALL(tpm_, ReadClockSync(_, _))
+        .WillRepeatedly(
+            DoAll(SetArgumentPointee<0>(time_info), Return(TPM_RC_SUCCESS)));
+    TPMS_CAPABILITY_DATA data;
+    memset(&data, 0, sizeof(data));
+    data.capability = TPM_CAP_HANDLES;
+    EXPECT_CALL(tpm_, GetCapabilitySync(TPM_CAP_HANDLES, _, _, _, _, _))
+        .WillRepeatedly(DoAll(SetArgumentPointee<3>(NO),
+                              SetArgumentPointee<4>(data),
+                              Return(TPM_RC_SUCCESS)));
+    if (loaded_object) {
+      data.data.handles.count = 1;
+      data.data.handles.handle[0] = loaded_object;
+      EXPECT_CALL(tpm_,
+                  GetCapabilitySync(TPM_CAP_HANDLES, HR_TRANSIENT, _, _, _, _))
+          .WillOnce(DoAll(SetArgumentPointee<3>(NO),
+                          SetArgumentPointee<4>(data),
+                          Return(TPM_RC_SUCCESS)));
+    }
+  }
+
+  // Expects |handles| to be flushed as a single batch.
+  void ExpectBatchFlush(const std::vector<TPM_HANDLE>& handles) {
+    std::vector<std::string> commands;
+    std::vector<std::string> responses;
+    for (TPM_HANDLE handle : handles) {
+      std::string command;
+      ASSERT_EQ(TPM_RC_SUCCESS,
+                Tpm::SerializeCommand_FlushContext(handle, &command, nullptr));
+      commands.push_back(command);
+      responses.push_back(CreateResponse(TPM_RC_SUCCESS, kNoHandles,
+                                         kNoAuthorization, kNoParameters));
+    }
+    EXPECT_CALL(tpm_, SendCommandsAndWait(commands))
+        .WillOnce(Return(responses));
+  }
+
   // Creates a TPMS_CONTEXT with the given sequence field.
   TPMS_CONTEXT CreateContext(UINT64 sequence) {
     TPMS_CONTEXT context;
@@ -225,6 +331,7 @@ class ResourceManagerTest : public testing::Test {
 
  protected:
   StrictMock<MockTpm> tpm_;
+  NiceMock<MockTpmUtility> tpm_utility_;
   TrunksFactoryForTest factory_;
   StrictMock<MockCommandTransceiver> transceiver_;
   ResourceManager resource_manager_;
@@ -330,6 +437,30 @@ TEST_F(ResourceManagerTest, VirtualHandleCleanup) {
   EXPECT_EQ(response, actual_response);
 }
 
+TEST_F(ResourceManagerTest, VirtualHandleRecycling) {
+  // More than the 64 handles which are held back before reuse.
+  const int kNumFlushed = 65;
+  std::string response = CreateResponse(TPM_RC_SUCCESS, kNoHandles,
+                                        kNoAuthorization, kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(_))
+      .WillRepeatedly(Return(response));
+  std::vector<TPM_HANDLE> flushed_handles;
+  for (int i = 0; i < kNumFlushed; ++i) {
+    TPM_HANDLE virtual_handle = LoadHandle(kArbitraryObjectHandle);
+    EXPECT_EQ(flushed_handles.end(),
+              std::find(flushed_handles.begin(), flushed_handles.end(),
+                        virtual_handle));
+    std::string parameters;
+    Serialize_TPM_HANDLE(virtual_handle, &parameters);
+    std::string command = CreateCommand(TPM_CC_FlushContext, kNoHandles,
+                                        kNoAuthorization, parameters);
+    EXPECT_EQ(response, resource_manager_.SendCommandAndWait(command));
+    flushed_handles.push_back(virtual_handle);
+  }
+  // Now the handle flushed first is recycled rather than minting a new one.
+  EXPECT_EQ(flushed_handles[0], LoadHandle(kArbitraryObjectHandle));
+}
+
 TEST_F(ResourceManagerTest, VirtualHandleLoadBeforeUse) {
   TPM_HANDLE tpm_handle = kArbitraryObjectHandle;
   TPM_HANDLE virtual_handle = LoadHandle(tpm_handle);
@@ -545,6 +676,7 @@ TEST_F(ResourceManagerTest, EvictWhenSessionInUse) {
 }
 
 TEST_F(ResourceManagerTest, EvictMultipleObjects) {
+  resource_manager_.set_eviction_policy(ResourceManager::kEvictAll);
   const int kNumObjects = 10;
   std::map<TPM_HANDLE, TPM_HANDLE> handles;
   for (int i = 0; i < kNumObjects; ++i) {
@@ -568,6 +700,158 @@ TEST_F(ResourceManagerTest, EvictMultipleObjects) {
   }
 }
 
+TEST_F(ResourceManagerTest, EvictLeastRecentlyUsedObject) {
+  TPM_HANDLE virtual_handle0 = LoadHandle(kArbitraryObjectHandle);
+  LoadHandle(kArbitraryObjectHandle + 1);
+  TPM_HANDLE virtual_handle2 = LoadHandle(kArbitraryObjectHandle + 2);
+  std::string success_response = CreateResponse(
+      TPM_RC_SUCCESS, kNoHandles, kNoAuthorization, kNoParameters);
+  // Use the first object so the second one is the least recently used.
+  std::string command = CreateCommand(TPM_CC_Sign, {virtual_handle0},
+                                      kNoAuthorization, kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(_))
+      .WillOnce(Return(success_response));
+  resource_manager_.SendCommandAndWait(command);
+  // Only the second object is evicted.
+  command = CreateCommand(TPM_CC_Sign, {virtual_handle2}, kNoAuthorization,
+                          kNoParameters);
+  EXPECT_CALL(tpm_, ContextSaveSync(kArbitraryObjectHandle + 1, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(tpm_, FlushContextSync(kArbitraryObjectHandle + 1, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(transceiver_, SendCommandAndWait(_))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_OBJECT_MEMORY)))
+      .WillOnce(Return(success_response));
+  EXPECT_EQ(success_response, resource_manager_.SendCommandAndWait(command));
+}
+
+TEST_F(ResourceManagerTest, EvictBeforeLoadWhenFull) {
+  TPM_HANDLE virtual_handle0 = LoadHandle(kArbitraryObjectHandle);
+  TPM_HANDLE virtual_handle1 = LoadHandle(kArbitraryObjectHandle + 1);
+  std::string success_response = CreateResponse(
+      TPM_RC_SUCCESS, kNoHandles, kNoAuthorization, kNoParameters);
+  // The TPM runs out of memory with two objects loaded; the second is evicted.
+  std::string command = CreateCommand(TPM_CC_Sign, {virtual_handle0},
+                                      kNoAuthorization, kNoParameters);
+  EXPECT_CALL(tpm_, ContextSaveSync(kArbitraryObjectHandle + 1, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(tpm_, FlushContextSync(kArbitraryObjectHandle + 1, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(transceiver_, SendCommandAndWait(_))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_OBJECT_MEMORY)))
+      .WillOnce(Return(success_response));
+  resource_manager_.SendCommandAndWait(command);
+  LoadHandle(kArbitraryObjectHandle + 2);
+  // Using the second object again evicts the first object before loading
+  // instead of waiting for the TPM to fail.
+  command = CreateCommand(TPM_CC_Sign, {virtual_handle1}, kNoAuthorization,
+                          kNoParameters);
+  EXPECT_CALL(tpm_, ContextSaveSync(kArbitraryObjectHandle, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(tpm_, FlushContextSync(kArbitraryObjectHandle, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(tpm_, ContextLoadSync(_, _, _))
+      .WillOnce(DoAll(SetArgumentPointee<1>(kArbitraryObjectHandle + 1),
+                      Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(transceiver_, SendCommandAndWait(_))
+      .WillOnce(Return(success_response));
+  EXPECT_EQ(success_response, resource_manager_.SendCommandAndWait(command));
+}
+
+TEST_F(ResourceManagerTest, EvictSessionBeforeLoadWhenFull) {
+  StartSession(kArbitrarySessionHandle);
+  StartSession(kArbitrarySessionHandle + 1);
+  // The TPM runs out of session memory with two sessions loaded.
+  EvictSession();
+  StartSession(kArbitrarySessionHandle + 2);
+  // Using the evicted session saves another one first instead of waiting for
+  // the TPM to fail.
+  std::string command =
+      CreateCommand(TPM_CC_Startup, kNoHandles,
+                    CreateCommandAuthorization(kArbitrarySessionHandle,
+                                               true),  // continue_session
+                    kNoParameters);
+  std::string response =
+      CreateResponse(TPM_RC_SUCCESS, kNoHandles,
+                     CreateResponseAuthorization(true),  // continue_session
+                     kNoParameters);
+  {
+    InSequence plan;
+    EXPECT_CALL(tpm_, ContextSaveSync(kArbitrarySessionHandle + 1, _, _, _))
+        .WillOnce(Return(TPM_RC_SUCCESS));
+    EXPECT_CALL(tpm_, ContextLoadSync(_, _, _))
+        .WillOnce(Return(TPM_RC_SUCCESS));
+  }
+  EXPECT_CALL(transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(response));
+  EXPECT_EQ(response, resource_manager_.SendCommandAndWait(command));
+}
+
+TEST_F(ResourceManagerTest, IdleMaintenanceFreesObjectSlot) {
+  TPM_HANDLE virtual_handle0 = LoadHandle(kArbitraryObjectHandle);
+  LoadHandle(kArbitraryObjectHandle + 1);
+  std::string success_response = CreateResponse(
+      TPM_RC_SUCCESS, kNoHandles, kNoAuthorization, kNoParameters);
+  std::string command = CreateCommand(TPM_CC_Sign, {virtual_handle0},
+                                      kNoAuthorization, kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(_))
+      .WillOnce(Return(success_response));
+  resource_manager_.SendCommandAndWait(command);
+  // No object slots are free so the least recently used object is evicted.
+  TPMS_CAPABILITY_DATA data;
+  memset(&data, 0, sizeof(data));
+  data.capability = TPM_CAP_TPM_PROPERTIES;
+  data.data.tpm_properties.count = 2;
+  data.data.tpm_properties.tpm_property[0].property = TPM_PT_HR_LOADED_AVAIL;
+  data.data.tpm_properties.tpm_property[0].value = 3;
+  data.data.tpm_properties.tpm_property[1].property =
+      TPM_PT_HR_TRANSIENT_AVAIL;
+  data.data.tpm_properties.tpm_property[1].value = 0;
+  EXPECT_CALL(tpm_, GetCapabilitySync(TPM_CAP_TPM_PROPERTIES,
+                                      TPM_PT_HR_LOADED_AVAIL, _, _, _, _))
+      .WillOnce(DoAll(SetArgumentPointee<4>(data), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(tpm_, ContextSaveSync(kArbitraryObjectHandle + 1, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(tpm_, FlushContextSync(kArbitraryObjectHandle + 1, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  resource_manager_.PerformIdleMaintenance();
+  // With a slot free nothing more is evicted.
+  data.data.tpm_properties.tpm_property[1].value = 1;
+  EXPECT_CALL(tpm_, GetCapabilitySync(TPM_CAP_TPM_PROPERTIES,
+                                      TPM_PT_HR_LOADED_AVAIL, _, _, _, _))
+      .WillOnce(DoAll(SetArgumentPointee<4>(data), Return(TPM_RC_SUCCESS)));
+  resource_manager_.PerformIdleMaintenance();
+}
+
+TEST_F(ResourceManagerTest, EvictLeastFrequentlyUsedObject) {
+  resource_manager_.set_eviction_policy(
+      ResourceManager::kEvictLeastFrequentlyUsed);
+  TPM_HANDLE virtual_handle0 = LoadHandle(kArbitraryObjectHandle);
+  TPM_HANDLE virtual_handle1 = LoadHandle(kArbitraryObjectHandle + 1);
+  TPM_HANDLE virtual_handle2 = LoadHandle(kArbitraryObjectHandle + 2);
+  std::string success_response = CreateResponse(
+      TPM_RC_SUCCESS, kNoHandles, kNoAuthorization, kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(_))
+      .WillRepeatedly(Return(success_response));
+  // The first object is used more often but the second more recently.
+  std::vector<TPM_HANDLE> uses = {virtual_handle0, virtual_handle0,
+                                  virtual_handle1};
+  for (TPM_HANDLE handle : uses) {
+    resource_manager_.SendCommandAndWait(CreateCommand(
+        TPM_CC_Sign, {handle}, kNoAuthorization, kNoParameters));
+  }
+  std::string command = CreateCommand(TPM_CC_Sign, {virtual_handle2},
+                                      kNoAuthorization, kNoParameters);
+  EXPECT_CALL(tpm_, ContextSaveSync(kArbitraryObjectHandle + 1, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(tpm_, FlushContextSync(kArbitraryObjectHandle + 1, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(transceiver_, SendCommandAndWait(_))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_OBJECT_MEMORY)))
+      .WillOnce(Return(success_response));
+  EXPECT_EQ(success_response, resource_manager_.SendCommandAndWait(command));
+}
+
 TEST_F(ResourceManagerTest, EvictMostStaleSession) {
   StartSession(kArbitrarySessionHandle);
   StartSession(kArbitrarySessionHandle + 1);
@@ -646,6 +930,186 @@ TEST_F(ResourceManagerTest, HandleContextGap) {
   EXPECT_EQ(success_response, actual_response);
 }
 
+TEST_F(ResourceManagerTest, IdleMaintenanceRefreshesOldSessions) {
+  resource_manager_.set_idle_eviction(false);
+  // Save three sessions with increasingly recent context counters.
+  const UINT64 kSequences[] = {1, 40, 100};
+  std::string command = CreateCommand(TPM_CC_Startup, kNoHandles,
+                                      kNoAuthorization, kNoParameters);
+  std::string success_response = CreateResponse(
+      TPM_RC_SUCCESS, kNoHandles, kNoAuthorization, kNoParameters);
+  for (int i = 0; i < 3; ++i) {
+    StartSession(kArbitrarySessionHandle + i);
+    EXPECT_CALL(transceiver_, SendCommandAndWait(_))
+        .WillOnce(Return(CreateErrorResponse(TPM_RC_SESSION_MEMORY)))
+        .WillRepeatedly(Return(success_response));
+    EXPECT_CALL(tpm_, ContextSaveSync(kArbitrarySessionHandle + i, _, _, _))
+        .WillOnce(DoAll(SetArgumentPointee<2>(CreateContext(kSequences[i])),
+                        Return(TPM_RC_SUCCESS)));
+    resource_manager_.SendCommandAndWait(command);
+  }
+  TPMS_CAPABILITY_DATA data;
+  memset(&data, 0, sizeof(data));
+  data.capability = TPM_CAP_TPM_PROPERTIES;
+  data.data.tpm_properties.count = 1;
+  data.data.tpm_properties.tpm_property[0].property = TPM_PT_CONTEXT_GAP_MAX;
+  data.data.tpm_properties.tpm_property[0].value = 128;
+  EXPECT_CALL(tpm_, GetCapabilitySync(TPM_CAP_TPM_PROPERTIES,
+                                      TPM_PT_CONTEXT_GAP_MAX, 1, _, _, _))
+      .WillOnce(DoAll(SetArgumentPointee<4>(data), Return(TPM_RC_SUCCESS)));
+  // Only the first session is more than halfway to the gap limit.
+  EXPECT_CALL(tpm_,
+              ContextLoadSync(Field(&TPMS_CONTEXT::sequence, Eq(1u)), _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(tpm_, ContextSaveSync(kArbitrarySessionHandle, _, _, _))
+      .WillOnce(DoAll(SetArgumentPointee<2>(CreateContext(101)),
+                      Return(TPM_RC_SUCCESS)));
+  resource_manager_.PerformIdleMaintenance();
+  // Everything is now within the limit; the property is not queried again.
+  resource_manager_.PerformIdleMaintenance();
+}
+
+TEST_F(ResourceManagerTest, IdleMaintenanceSpillsContexts) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  ExpectInitialize(0, 0);
+  resource_manager_.set_idle_eviction(false);
+  resource_manager_.set_context_spill(temp_dir.path().Append("contexts"),
+                                      base::TimeDelta());
+  resource_manager_.Initialize();
+  TPM_HANDLE virtual_handle = LoadHandle(kArbitraryObjectHandle);
+  std::string command = CreateCommand(TPM_CC_Startup, kNoHandles,
+                                      kNoAuthorization, kNoParameters);
+  std::string success_response = CreateResponse(
+      TPM_RC_SUCCESS, kNoHandles, kNoAuthorization, kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(_))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_OBJECT_MEMORY)))
+      .WillRepeatedly(Return(success_response));
+  EXPECT_CALL(tpm_, ContextSaveSync(kArbitraryObjectHandle, _, _, _))
+      .WillOnce(DoAll(SetArgumentPointee<2>(CreateContext(7)),
+                      Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(tpm_, FlushContextSync(kArbitraryObjectHandle, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  resource_manager_.SendCommandAndWait(command);
+  // The saved context moves to the store while idle.
+  resource_manager_.PerformIdleMaintenance();
+  ResourceManagerStats stats;
+  resource_manager_.GetStats(&stats);
+  EXPECT_EQ(1u, stats.context_spills());
+  EXPECT_EQ(1u, stats.spilled_contexts());
+  // It is read back intact when the object is used again.
+  EXPECT_CALL(tpm_,
+              ContextLoadSync(Field(&TPMS_CONTEXT::sequence, Eq(7u)), _, _))
+      .WillOnce(DoAll(SetArgumentPointee<1>(kArbitraryObjectHandle),
+                      Return(TPM_RC_SUCCESS)));
+  std::string sign_command = CreateCommand(TPM_CC_Sign, {virtual_handle},
+                                           kNoAuthorization, kNoParameters);
+  std::string expected_command =
+      CreateCommand(TPM_CC_Sign, {kArbitraryObjectHandle}, kNoAuthorization,
+                    kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(expected_command))
+      .WillOnce(Return(success_response));
+  EXPECT_EQ(success_response,
+            resource_manager_.SendCommandAndWait(sign_command));
+  resource_manager_.GetStats(&stats);
+  EXPECT_EQ(1u, stats.spilled_context_loads());
+  EXPECT_EQ(0u, stats.spilled_contexts());
+}
+
+TEST_F(ResourceManagerTest, IdleHousekeeping) {
+  resource_manager_.set_idle_eviction(false);
+  resource_manager_.set_idle_housekeeping(true);
+  // Every self-test is done in its own step, then the RNG is stirred once.
+  EXPECT_CALL(tpm_, IncrementalSelfTestSync(_, _, _))
+      .Times(6)
+      .WillRepeatedly(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(tpm_, StirRandomSync(_, _)).WillOnce(Return(TPM_RC_SUCCESS));
+  int steps = 1;
+  while (resource_manager_.PerformIdleMaintenance()) {
+    ++steps;
+  }
+  EXPECT_EQ(7, steps);
+  // Nothing is due again for a while.
+  EXPECT_FALSE(resource_manager_.PerformIdleMaintenance());
+}
+
+TEST_F(ResourceManagerTest, Stats) {
+  StartSession(kArbitrarySessionHandle);
+  EvictSession();
+  ResourceManagerStats stats;
+  resource_manager_.GetStats(&stats);
+  ASSERT_EQ(2, stats.commands_size());
+  // Commands are ordered by code. For Startup the command is sent, a session
+  // is saved, and the command is resent.
+  EXPECT_EQ(TPM_CC_Startup, stats.commands(0).command_code());
+  EXPECT_EQ(1u, stats.commands(0).count());
+  EXPECT_EQ(3u, stats.commands(0).tpm_round_trips());
+  EXPECT_EQ(TPM_CC_StartAuthSession, stats.commands(1).command_code());
+  EXPECT_EQ(1u, stats.commands(1).count());
+  EXPECT_EQ(1u, stats.commands(1).tpm_round_trips());
+  const LatencyHistogram& latency = stats.commands(0).total_latency();
+  EXPECT_EQ(1u, std::accumulate(latency.buckets().begin(),
+                                latency.buckets().end(), 0u));
+  ASSERT_EQ(EvictionReason_ARRAYSIZE, stats.evictions_size());
+  EXPECT_EQ(EVICTION_REASON_TPM_WARNING, stats.evictions(0).reason());
+  EXPECT_EQ(0u, stats.evictions(0).objects());
+  EXPECT_EQ(1u, stats.evictions(0).sessions());
+  EXPECT_EQ(0u, stats.context_loads());
+  EXPECT_EQ(1u, stats.context_saves());
+  EXPECT_EQ(1u, stats.warning_retries());
+}
+
+TEST_F(ResourceManagerTest, KeyReloadStats) {
+  LoadHandle(kArbitraryObjectHandle);
+  LoadHandle(kArbitraryObjectHandle + 1);
+  LoadHandle(kArbitraryObjectHandle + 2);
+  ResourceManagerStats stats;
+  resource_manager_.GetStats(&stats);
+  // The same (empty) blob was loaded three times.
+  EXPECT_EQ(2u, stats.key_reloads());
+  EXPECT_EQ(3u, stats.hottest_key_loads());
+}
+
+TEST_F(ResourceManagerTest, PassedWarningStats) {
+  std::string command = CreateCommand(TPM_CC_Startup, kNoHandles,
+                                      kNoAuthorization, kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_RETRY)))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_RETRY)))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_TESTING)))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_SUCCESS)));
+  for (int i = 0; i < 4; ++i) {
+    resource_manager_.SendCommandAndWait(command);
+  }
+  ResourceManagerStats stats;
+  resource_manager_.GetStats(&stats);
+  EXPECT_EQ(2u, stats.retry_warnings());
+  EXPECT_EQ(0u, stats.yielded_warnings());
+  EXPECT_EQ(1u, stats.testing_warnings());
+  // These warnings are left to the client to handle.
+  EXPECT_EQ(0u, stats.warning_retries());
+  EXPECT_EQ(0u, stats.loaded_objects());
+  EXPECT_EQ(0u, stats.loaded_sessions());
+}
+
+TEST_F(ResourceManagerTest, QueueLatencyStats) {
+  std::string command = CreateCommand(TPM_CC_Startup, kNoHandles,
+                                      kNoAuthorization, kNoParameters);
+  resource_manager_.AddQueueLatency(command,
+                                    base::TimeDelta::FromMicroseconds(100));
+  resource_manager_.AddQueueLatency("", base::TimeDelta::FromMicroseconds(1));
+  ResourceManagerStats stats;
+  resource_manager_.GetStats(&stats);
+  ASSERT_EQ(2, stats.commands_size());
+  // Unparseable commands are counted under code zero.
+  EXPECT_EQ(0u, stats.commands(0).command_code());
+  EXPECT_EQ(1u, stats.commands(0).queue_latency().total_us());
+  EXPECT_EQ(TPM_CC_Startup, stats.commands(1).command_code());
+  EXPECT_EQ(100u, stats.commands(1).queue_latency().total_us());
+  // Queueing alone does not count as processing the command.
+  EXPECT_EQ(0u, stats.commands(1).count());
+}
+
 TEST_F(ResourceManagerTest, ExternalContext) {
   StartSession(kArbitrarySessionHandle);
   // Do an external context save.
@@ -691,6 +1155,11 @@ TEST_F(ResourceManagerTest, ExternalContext) {
       .WillOnce(Return(context_load_response));
   actual_response = resource_manager_.SendCommandAndWait(context_load1);
   EXPECT_EQ(context_load_response, actual_response);
+
+  // Once loaded the external context is no longer tracked.
+  EXPECT_CALL(transceiver_, SendCommandAndWait(context_load1))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_INTEGRITY)));
+  resource_manager_.SendCommandAndWait(context_load1);
 }
 
 TEST_F(ResourceManagerTest, NestedFailures) {
@@ -780,4 +1249,334 @@ TEST_F(ResourceManagerTest, PasswordAuthorization) {
   EXPECT_EQ(response, actual_response);
 }
 
+TEST_F(ResourceManagerTest, TooManySessions) {
+  // The TPM accepts at most three authorization sessions per command.
+  std::string authorization;
+  for (int i = 0; i < 4; ++i) {
+    authorization += CreateCommandAuthorization(TPM_RS_PW, false);
+  }
+  std::string command = CreateCommand(TPM_CC_Startup, kNoHandles,
+                                      authorization, kNoParameters);
+  ScopedDisableLogging no_logging;
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_SIZE | kResourceManagerTpmErrorBase),
+            resource_manager_.SendCommandAndWait(command));
+}
+
+TEST_F(ResourceManagerTest, RestoreStateAfterRestart) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath state_file = temp_dir.path().Append("state");
+  ExpectInitialize(0, 0);
+  resource_manager_.set_state_file(state_file);
+  resource_manager_.Initialize();
+  TPM_HANDLE virtual_handle = LoadHandle(kArbitraryObjectHandle);
+  // A new resource manager finds the object it left loaded in the TPM.
+  ExpectInitialize(0, kArbitraryObjectHandle);
+  ResourceManager restarted(factory_, &transceiver_);
+  restarted.set_state_file(state_file);
+  restarted.Initialize();
+  std::string command = CreateCommand(TPM_CC_Sign, {virtual_handle},
+                                      kNoAuthorization, kNoParameters);
+  std::string expected_command = CreateCommand(
+      TPM_CC_Sign, {kArbitraryObjectHandle}, kNoAuthorization, kNoParameters);
+  std::string response = CreateResponse(TPM_RC_SUCCESS, kNoHandles,
+                                        kNoAuthorization, kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(expected_command))
+      .WillOnce(Return(response));
+  EXPECT_EQ(response, restarted.SendCommandAndWait(command));
+}
+
+TEST_F(ResourceManagerTest, DiscardStateAfterTpmRestart) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath state_file = temp_dir.path().Append("state");
+  ExpectInitialize(0, 0);
+  resource_manager_.set_state_file(state_file);
+  resource_manager_.Initialize();
+  TPM_HANDLE virtual_handle = LoadHandle(kArbitraryObjectHandle);
+  // The TPM restarted so the state is stale and everything is flushed.
+  ExpectInitialize(1, kArbitraryObjectHandle);
+  EXPECT_CALL(tpm_, FlushContextSync(_, _)).Times(0);
+  ResourceManager restarted(factory_, &transceiver_);
+  restarted.set_state_file(state_file);
+  restarted.set_idle_eviction(false);
+  restarted.Initialize();
+  std::string command = CreateCommand(TPM_CC_Sign, {virtual_handle},
+                                      kNoAuthorization, kNoParameters);
+  std::string response =
+      CreateErrorResponse(TPM_RC_HANDLE | kResourceManagerTpmErrorBase);
+  EXPECT_EQ(response, restarted.SendCommandAndWait(command));
+  ExpectBatchFlush({kArbitraryObjectHandle});
+  restarted.PerformIdleMaintenance();
+}
+
+TEST_F(ResourceManagerTest, FlushStaleHandlesBeforeEviction) {
+  ExpectInitialize(0, kArbitraryObjectHandle);
+  resource_manager_.Initialize();
+  LoadHandle(kArbitraryObjectHandle + 1);
+  // The stale handle is flushed on the first memory warning and the command
+  // succeeds on the retry without anything being evicted.
+  std::string command = CreateCommand(TPM_CC_Startup, kNoHandles,
+                                      kNoAuthorization, kNoParameters);
+  std::string response = CreateResponse(TPM_RC_SUCCESS, kNoHandles,
+                                        kNoAuthorization, kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_OBJECT_MEMORY)))
+      .WillOnce(Return(response));
+  ExpectBatchFlush({kArbitraryObjectHandle});
+  EXPECT_CALL(tpm_, ContextSaveSync(_, _, _, _)).Times(0);
+  EXPECT_EQ(response, resource_manager_.SendCommandAndWait(command));
+}
+
+TEST_F(ResourceManagerTest, ClientHandleQuota) {
+  resource_manager_.set_client_handle_quota(1);
+  LoadHandleForClient(":1.1", kArbitraryObjectHandle);
+  // The second load is refused without reaching the TPM.
+  std::string command = CreateCommand(TPM_CC_Load, {PERSISTENT_FIRST},
+                                      kNoAuthorization, kNoParameters);
+  std::string response;
+  resource_manager_.SendCommandForClient(":1.1", command,
+                                         base::Bind(&Assign, &response));
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_OBJECT_MEMORY |
+                                kResourceManagerTpmErrorBase),
+            response);
+  // Other clients have their own quota.
+  LoadHandleForClient(":1.2", kArbitraryObjectHandle + 1);
+}
+
+TEST_F(ResourceManagerTest, FlushOnClientDisconnect) {
+  TPM_HANDLE virtual_handle =
+      LoadHandleForClient(":1.1", kArbitraryObjectHandle);
+  LoadHandleForClient(":1.2", kArbitraryObjectHandle + 1);
+  LoadHandleForClient(":1.3", kArbitraryObjectHandle + 2);
+  EXPECT_CALL(tpm_, FlushContextSync(_, _)).Times(0);
+  resource_manager_.OnClientDisconnected(":1.1");
+  resource_manager_.OnClientDisconnected(":1.3");
+  std::string command = CreateCommand(TPM_CC_Sign, {virtual_handle},
+                                      kNoAuthorization, kNoParameters);
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_HANDLE | kResourceManagerTpmErrorBase),
+            resource_manager_.SendCommandAndWait(command));
+  // Both clients' handles go in one batch.
+  ExpectBatchFlush({kArbitraryObjectHandle, kArbitraryObjectHandle + 2});
+  resource_manager_.set_idle_eviction(false);
+  resource_manager_.PerformIdleMaintenance();
+}
+
+TEST_F(ResourceManagerTest, EvictFromHeaviestClient) {
+  // The other client's object is the least recently used but the client with
+  // more objects loaded loses one of its own.
+  LoadHandleForClient(":1.2", kArbitraryObjectHandle);
+  LoadHandleForClient(":1.1", kArbitraryObjectHandle + 1);
+  TPM_HANDLE virtual_handle2 =
+      LoadHandleForClient(":1.1", kArbitraryObjectHandle + 2);
+  std::string command = CreateCommand(TPM_CC_Sign, {virtual_handle2},
+                                      kNoAuthorization, kNoParameters);
+  std::string success_response = CreateResponse(
+      TPM_RC_SUCCESS, kNoHandles, kNoAuthorization, kNoParameters);
+  EXPECT_CALL(tpm_, ContextSaveSync(kArbitraryObjectHandle + 1, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(tpm_, FlushContextSync(kArbitraryObjectHandle + 1, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(transceiver_, SendCommandAndWait(_))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_OBJECT_MEMORY)))
+      .WillOnce(Return(success_response));
+  EXPECT_EQ(success_response, resource_manager_.SendCommandAndWait(command));
+}
+
+TEST_F(ResourceManagerTest, ReuseUnsaltedSession) {
+  StartReusableSessionForClient(":1.1", kArbitrarySessionHandle,
+                                std::string(32, 'T'));
+  // Using the session updates its nonceTPM to the one in the response.
+  std::string command =
+      CreateCommand(TPM_CC_Startup, kNoHandles,
+                    CreateCommandAuthorization(kArbitrarySessionHandle,
+                                               true),  // continue_session
+                    kNoParameters);
+  std::string response =
+      CreateResponse(TPM_RC_SUCCESS, kNoHandles,
+                     CreateResponseAuthorization(true),  // continue_session
+                     kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(response));
+  std::string actual_response;
+  resource_manager_.SendCommandForClient(":1.1", command,
+                                         base::Bind(&Assign, &actual_response));
+  EXPECT_EQ(response, actual_response);
+  // Flushing parks the session without reaching the TPM.
+  std::string parameters;
+  Serialize_TPM_HANDLE(kArbitrarySessionHandle, &parameters);
+  std::string flush_command = CreateCommand(TPM_CC_FlushContext, kNoHandles,
+                                            kNoAuthorization, parameters);
+  resource_manager_.SendCommandForClient(":1.1", flush_command,
+                                         base::Bind(&Assign, &actual_response));
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_SUCCESS), actual_response);
+  // The former owner can no longer use it.
+  resource_manager_.SendCommandForClient(":1.1", command,
+                                         base::Bind(&Assign, &actual_response));
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_HANDLE | kResourceManagerTpmErrorBase),
+            actual_response);
+  // Another client starting a matching session gets the parked one, with the
+  // latest nonceTPM.
+  resource_manager_.SendCommandForClient(":1.2",
+                                         CreateReusableSessionCommand(),
+                                         base::Bind(&Assign, &actual_response));
+  parameters.clear();
+  Serialize_TPM2B_NONCE(Make_TPM2B_DIGEST(std::string(32, 'A')), &parameters);
+  EXPECT_EQ(CreateResponse(TPM_RC_SUCCESS, {kArbitrarySessionHandle},
+                           kNoAuthorization, parameters),
+            actual_response);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(response));
+  resource_manager_.SendCommandForClient(":1.2", command,
+                                         base::Bind(&Assign, &actual_response));
+  EXPECT_EQ(response, actual_response);
+  ResourceManagerStats stats;
+  resource_manager_.GetStats(&stats);
+  EXPECT_EQ(1u, stats.sessions_started());
+  EXPECT_EQ(1u, stats.sessions_parked());
+  EXPECT_EQ(1u, stats.sessions_reused());
+  EXPECT_EQ(1u, stats.active_sessions());
+  EXPECT_EQ(0u, stats.parked_sessions());
+}
+
+TEST_F(ResourceManagerTest, ParkedSessionIsFlushedFirst) {
+  StartSession(kArbitrarySessionHandle + 1);
+  StartReusableSessionForClient(":1.1", kArbitrarySessionHandle,
+                                std::string(32, 'T'));
+  std::string parameters;
+  Serialize_TPM_HANDLE(kArbitrarySessionHandle, &parameters);
+  std::string actual_response;
+  resource_manager_.SendCommandForClient(
+      ":1.1", CreateCommand(TPM_CC_FlushContext, kNoHandles, kNoAuthorization,
+                            parameters),
+      base::Bind(&Assign, &actual_response));
+  // When the TPM runs out of session handles the parked session goes, even
+  // though it was used more recently.
+  std::string command = CreateCommand(TPM_CC_Startup, kNoHandles,
+                                      kNoAuthorization, kNoParameters);
+  std::string success_response = CreateResponse(
+      TPM_RC_SUCCESS, kNoHandles, kNoAuthorization, kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_SESSION_HANDLES)))
+      .WillOnce(Return(success_response));
+  EXPECT_CALL(tpm_, FlushContextSync(kArbitrarySessionHandle, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_EQ(success_response, resource_manager_.SendCommandAndWait(command));
+  ResourceManagerStats stats;
+  resource_manager_.GetStats(&stats);
+  EXPECT_EQ(0u, stats.parked_sessions());
+}
+
+TEST_F(ResourceManagerTest, PcrShadow) {
+  // The TPM has one bank with PCRs 0 and 1, both of which are read at once.
+  TPML_PCR_SELECTION banks = {};
+  banks.count = 1;
+  banks.pcr_selections[0].hash = TPM_ALG_SHA256;
+  banks.pcr_selections[0].sizeof_select = PCR_SELECT_MAX;
+  banks.pcr_selections[0].pcr_select[0] = 0x3;
+  TPMS_CAPABILITY_DATA data = {};
+  data.capability = TPM_CAP_PCRS;
+  data.data.assigned_pcr = banks;
+  TPML_DIGEST values = {};
+  values.count = 2;
+  values.digests[0] = Make_TPM2B_DIGEST(std::string(32, '0'));
+  values.digests[1] = Make_TPM2B_DIGEST(std::string(32, '1'));
+  ExpectInitialize(0, 0);
+  EXPECT_CALL(tpm_, GetCapabilitySync(TPM_CAP_PCRS, _, _, _, _, _))
+      .WillOnce(DoAll(SetArgumentPointee<3>(NO), SetArgumentPointee<4>(data),
+                      Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(tpm_, PCR_ReadSync(_, _, _, _, _))
+      .WillOnce(DoAll(SetArgumentPointee<1>(5), SetArgumentPointee<2>(banks),
+                      SetArgumentPointee<3>(values), Return(TPM_RC_SUCCESS)));
+  resource_manager_.set_pcr_shadow(true);
+  resource_manager_.Initialize();
+  // PCR 0 is read without the TPM.
+  TPML_PCR_SELECTION selection = banks;
+  selection.pcr_selections[0].pcr_select[0] = 0x1;
+  std::string parameters;
+  Serialize_TPML_PCR_SELECTION(selection, &parameters);
+  std::string read_command = CreateCommand(TPM_CC_PCR_Read, kNoHandles,
+                                           kNoAuthorization, parameters);
+  TPML_DIGEST value = {};
+  value.count = 1;
+  value.digests[0] = values.digests[0];
+  parameters.clear();
+  Serialize_UINT32(5, &parameters);
+  Serialize_TPML_PCR_SELECTION(selection, &parameters);
+  Serialize_TPML_DIGEST(value, &parameters);
+  EXPECT_EQ(CreateResponse(TPM_RC_SUCCESS, kNoHandles, kNoAuthorization,
+                           parameters),
+            resource_manager_.SendCommandAndWait(read_command));
+  // Extending PCR 1 makes the update counter unknown, so the next read goes to
+  // the TPM and updates it.
+  std::string extend_command = CreateCommand(TPM_CC_PCR_Extend, {1},
+                                             kNoAuthorization, kNoParameters);
+  std::string extend_response = CreateResponse(TPM_RC_SUCCESS, kNoHandles,
+                                               kNoAuthorization, kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(extend_command))
+      .WillOnce(Return(extend_response));
+  resource_manager_.SendCommandAndWait(extend_command);
+  parameters.clear();
+  Serialize_UINT32(6, &parameters);
+  Serialize_TPML_PCR_SELECTION(selection, &parameters);
+  Serialize_TPML_DIGEST(value, &parameters);
+  std::string read_response = CreateResponse(TPM_RC_SUCCESS, kNoHandles,
+                                             kNoAuthorization, parameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(read_command))
+      .WillOnce(Return(read_response));
+  EXPECT_EQ(read_response, resource_manager_.SendCommandAndWait(read_command));
+  EXPECT_EQ(read_response, resource_manager_.SendCommandAndWait(read_command));
+  // PCR 1 itself is no longer known.
+  selection.pcr_selections[0].pcr_select[0] = 0x2;
+  parameters.clear();
+  Serialize_TPML_PCR_SELECTION(selection, &parameters);
+  read_command = CreateCommand(TPM_CC_PCR_Read, kNoHandles, kNoAuthorization,
+                               parameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(read_command))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_FAILURE)));
+  resource_manager_.SendCommandAndWait(read_command);
+  ResourceManagerStats stats;
+  resource_manager_.GetStats(&stats);
+  EXPECT_EQ(2u, stats.shadow_pcr_reads());
+}
+
+TEST_F(ResourceManagerTest, StateEpochs) {
+  TpmStateEpochs notified;
+  resource_manager_.set_state_epochs_callback(
+      base::Bind(&CopyEpochs, &notified));
+  TpmStateEpochs initial;
+  resource_manager_.GetStateEpochs(&initial);
+  // A failed command changes nothing.
+  std::string command = CreateCommand(TPM_CC_EvictControl, {TPM_RH_OWNER, 1},
+                                      kNoAuthorization, kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(CreateErrorResponse(TPM_RC_FAILURE)))
+      .WillOnce(Return(CreateResponse(TPM_RC_SUCCESS, kNoHandles,
+                                      kNoAuthorization, kNoParameters)));
+  resource_manager_.SendCommandAndWait(command);
+  TpmStateEpochs epochs;
+  resource_manager_.GetStateEpochs(&epochs);
+  EXPECT_EQ(initial.SerializeAsString(), epochs.SerializeAsString());
+  EXPECT_FALSE(notified.has_instance());
+  resource_manager_.SendCommandAndWait(command);
+  resource_manager_.GetStateEpochs(&epochs);
+  EXPECT_EQ(initial.instance(), epochs.instance());
+  EXPECT_EQ(1u, epochs.persistent_handles());
+  EXPECT_EQ(0u, epochs.nv_indexes());
+  EXPECT_EQ(epochs.SerializeAsString(), notified.SerializeAsString());
+  // Clear affects everything but the PCRs.
+  command = CreateCommand(TPM_CC_Clear, {TPM_RH_LOCKOUT}, kNoAuthorization,
+                          kNoParameters);
+  EXPECT_CALL(transceiver_, SendCommandAndWait(command))
+      .WillOnce(Return(CreateResponse(TPM_RC_SUCCESS, kNoHandles,
+                                      kNoAuthorization, kNoParameters)));
+  resource_manager_.SendCommandAndWait(command);
+  resource_manager_.GetStateEpochs(&epochs);
+  EXPECT_EQ(0u, epochs.pcrs());
+  EXPECT_EQ(1u, epochs.nv_indexes());
+  EXPECT_EQ(1u, epochs.hierarchy_auth());
+  EXPECT_EQ(1u, epochs.ownership());
+  EXPECT_EQ(2u, epochs.persistent_handles());
+}
+
 }  // namespace trunks
@@ -0,0 +1,660 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/scheduling_command_transceiver.h"
+
+#include <algorithm>
+
+#include <base/bind.h>
+#include <base/callback.h>
+#include <base/location.h>
+#include <base/logging.h>
+#include <base/rand_util.h>
+#include <base/single_thread_task_runner.h>
+#include <base/synchronization/waitable_event.h>
+#include <base/threading/thread_task_runner_handle.h>
+#include <base/time/time.h>
+
+#include "trunks/error_codes.h"
+
+namespace {
+
+// The offset of the command code in a TPM command header: tag (2 bytes)
+// followed by size (4 bytes).
+const size_t kCommandCodeOffset = 6;
+
+// A lower priority queue will not be passed over more than this many times in a
+// row. This bounds the latency of lower priority commands under sustained load.
+const int kMaxBypassCount = 8;
+
+// How long the queues must stay empty before the idle callback runs.
+const int kIdleDelayMilliseconds = 200;
+
+// The offset of the response code in a TPM response header.
+const size_t kResponseCodeOffset = 6;
+
+// The retry budget of a command which the TPM answers with warnings, see
+// set_warning_retries().
+const int kMaxWarningRetries = 10;
+const int kMaxWarningDelayMilliseconds = 2000;
+// TPM_RC_RETRY backoff starts at this delay and doubles up to the maximum.
+const int kRetryBaseDelayMilliseconds = 2;
+const int kRetryMaxDelayMilliseconds = 100;
+// TPM_RC_NV_RATE means the TPM throttles NV writes to limit wear, which lasts
+// much longer.
+const int kNVRateBaseDelayMilliseconds = 50;
+const int kNVRateMaxDelayMilliseconds = 1000;
+// Likewise for GetTestResult polls; a self-test takes tens to hundreds of
+// milliseconds.
+const int kSelfTestBaseDelayMilliseconds = 10;
+const int kSelfTestMaxDelayMilliseconds = 200;
+
+// Returns the response code of a |response|, or TPM_RC_SUCCESS if it is too
+// short to have one.
+trunks::TPM_RC GetResponseCode(const std::string& response) {
+  if (response.size() < kResponseCodeOffset + sizeof(trunks::TPM_RC)) {
+    return trunks::TPM_RC_SUCCESS;
+  }
+  std::string buffer =
+      response.substr(kResponseCodeOffset, sizeof(trunks::TPM_RC));
+  trunks::TPM_RC code = trunks::TPM_RC_SUCCESS;
+  trunks::Parse_TPM_RC(&buffer, &code, nullptr);
+  return code;
+}
+
+// Returns the delay before retry number |attempt|, counting from zero: the
+// base delay doubled |attempt| times up to the maximum, then scaled by a
+// random factor between one half and one so that commands which got the
+// warning together do not retry together.
+base::TimeDelta GetBackoffDelay(int base_milliseconds,
+                                int max_milliseconds,
+                                int attempt) {
+  int64_t delay = std::min<int64_t>(
+      static_cast<int64_t>(base_milliseconds) << std::min(attempt, 16),
+      max_milliseconds);
+  delay *= base::Time::kMicrosecondsPerMillisecond;
+  return base::TimeDelta::FromMicroseconds(delay / 2 +
+                                           base::RandGenerator(delay / 2 + 1));
+}
+
+// A simple callback useful when waiting for an asynchronous call.
+template <typename T>
+void AssignAndSignal(T* destination, base::WaitableEvent* event,
+                     const T& source) {
+  *destination = source;
+  event->Signal();
+}
+
+// A callback which posts another |callback| to a given |task_runner|.
+template <typename T>
+void PostCallbackToTaskRunner(
+    const base::Callback<void(const T&)>& callback,
+    const scoped_refptr<base::SingleThreadTaskRunner>& task_runner,
+    const T& response) {
+  base::Closure task = base::Bind(callback, response);
+  task_runner->PostTask(FROM_HERE, task);
+}
+
+}  // namespace
+
+namespace trunks {
+
+SchedulingCommandTransceiver::SchedulingCommandTransceiver(
+    CommandTransceiver* next_transceiver,
+    const scoped_refptr<base::SequencedTaskRunner>& task_runner)
+    : next_transceiver_(next_transceiver),
+      task_runner_(task_runner),
+      weak_factory_(this) {
+  CHECK(task_runner_.get());
+}
+
+SchedulingCommandTransceiver::~SchedulingCommandTransceiver() {}
+
+void SchedulingCommandTransceiver::SendCommand(
+    const std::string& command,
+    const ResponseCallback& callback) {
+  PendingCommand pending;
+  pending.command = command;
+  pending.callback =
+      base::Bind(&PostCallbackToTaskRunner<std::string>, callback,
+                 base::ThreadTaskRunnerHandle::Get());
+  QueueCommand(GetCommandPriority(command), pending);
+}
+
+std::string SchedulingCommandTransceiver::SendCommandAndWait(
+    const std::string& command) {
+  std::string response;
+  base::WaitableEvent response_ready(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  PendingCommand pending;
+  pending.command = command;
+  pending.callback = base::Bind(&AssignAndSignal<std::string>, &response,
+                                &response_ready);
+  QueueCommand(GetCommandPriority(command), pending);
+  response_ready.Wait();
+  return response;
+}
+
+void SchedulingCommandTransceiver::SendCommandBatch(
+    const std::vector<std::string>& commands,
+    bool stop_on_failure,
+    const BatchResponseCallback& callback) {
+  PendingCommand pending;
+  pending.batch = commands;
+  pending.stop_on_failure = stop_on_failure;
+  pending.batch_callback =
+      base::Bind(&PostCallbackToTaskRunner<std::vector<std::string>>, callback,
+                 base::ThreadTaskRunnerHandle::Get());
+  Priority priority = kPriorityInteractive;
+  for (const auto& command : commands) {
+    priority = std::max(priority, GetCommandPriority(command));
+  }
+  QueueCommand(priority, pending);
+}
+
+std::vector<std::string> SchedulingCommandTransceiver::SendCommandBatchAndWait(
+    const std::vector<std::string>& commands,
+    bool stop_on_failure) {
+  std::vector<std::string> responses;
+  base::WaitableEvent responses_ready(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  PendingCommand pending;
+  pending.batch = commands;
+  pending.stop_on_failure = stop_on_failure;
+  pending.batch_callback =
+      base::Bind(&AssignAndSignal<std::vector<std::string>>, &responses,
+                 &responses_ready);
+  Priority priority = kPriorityInteractive;
+  for (const auto& command : commands) {
+    priority = std::max(priority, GetCommandPriority(command));
+  }
+  QueueCommand(priority, pending);
+  responses_ready.Wait();
+  return responses;
+}
+
+void SchedulingCommandTransceiver::SendCommandForClient(
+    const std::string& client,
+    const std::string& command,
+    const ResponseCallback& callback) {
+  PendingCommand pending;
+  pending.command = command;
+  pending.client = client;
+  pending.callback =
+      base::Bind(&PostCallbackToTaskRunner<std::string>, callback,
+                 base::ThreadTaskRunnerHandle::Get());
+  QueueCommand(GetCommandPriority(command), pending);
+}
+
+void SchedulingCommandTransceiver::SendScheduledCommandForClient(
+    const std::string& client,
+    const std::string& command,
+    RequestedPriority priority,
+    base::TimeTicks deadline,
+    const ResponseCallback& callback) {
+  PendingCommand pending;
+  pending.command = command;
+  pending.client = client;
+  pending.deadline = deadline;
+  pending.callback =
+      base::Bind(&PostCallbackToTaskRunner<std::string>, callback,
+                 base::ThreadTaskRunnerHandle::Get());
+  QueueCommand(GetRequestedPriority(priority, command), pending);
+}
+
+void SchedulingCommandTransceiver::OnClientDisconnected(
+    const std::string& client) {
+  // Each dispatch task sends one command, so every command queued before this
+  // task has been sent by the time it runs.
+  task_runner_->PostNonNestableTask(
+      FROM_HERE,
+      base::Bind(&SchedulingCommandTransceiver::NotifyClientDisconnected,
+                 GetWeakPtr(), client));
+}
+
+// static
+SchedulingCommandTransceiver::Priority
+SchedulingCommandTransceiver::GetPriority(TPM_CC code) {
+  const TpmCommandMetadata* metadata = GetCommandMetadata(code);
+  if (!metadata) {
+    return kPriorityBulk;
+  }
+  switch (metadata->latency_class) {
+    case kTpmLatencyShort:
+      return kPriorityInteractive;
+    case kTpmLatencyLong:
+      return kPriorityKeygen;
+    case kTpmLatencyNormal:
+      break;
+  }
+  return kPriorityBulk;
+}
+
+// static
+bool SchedulingCommandTransceiver::IsCoalescible(const std::string& command) {
+  std::string buffer = command;
+  TPM_ST tag = 0;
+  UINT32 size = 0;
+  TPM_CC code = 0;
+  if (Parse_TPM_ST(&buffer, &tag, nullptr) != TPM_RC_SUCCESS ||
+      tag != TPM_ST_NO_SESSIONS ||
+      Parse_UINT32(&buffer, &size, nullptr) != TPM_RC_SUCCESS ||
+      Parse_TPM_CC(&buffer, &code, nullptr) != TPM_RC_SUCCESS) {
+    return false;
+  }
+  const TpmCommandMetadata* metadata = GetCommandMetadata(code);
+  return metadata && metadata->read_only;
+}
+
+// static
+SchedulingCommandTransceiver::Priority
+SchedulingCommandTransceiver::GetCommandPriority(const std::string& command) {
+  if (command.size() < kCommandCodeOffset + sizeof(TPM_CC)) {
+    return kPriorityBulk;
+  }
+  std::string buffer = command.substr(kCommandCodeOffset, sizeof(TPM_CC));
+  TPM_CC code = 0;
+  if (Parse_TPM_CC(&buffer, &code, nullptr) != TPM_RC_SUCCESS) {
+    return kPriorityBulk;
+  }
+  return GetPriority(code);
+}
+
+// static
+SchedulingCommandTransceiver::Priority
+SchedulingCommandTransceiver::GetRequestedPriority(RequestedPriority requested,
+                                                   const std::string& command) {
+  switch (requested) {
+    case kRequestedPriorityInteractive:
+      return kPriorityInteractive;
+    case kRequestedPriorityBulk:
+      return kPriorityBulk;
+    case kRequestedPriorityBackground:
+      return kPriorityBackground;
+    case kRequestedPriorityDefault:
+      break;
+  }
+  return GetCommandPriority(command);
+}
+
+void SchedulingCommandTransceiver::QueueCommand(Priority priority,
+                                                PendingCommand pending) {
+  pending.queued_time = base::TimeTicks::Now();
+  bool rejected = false;
+  {
+    base::AutoLock lock(lock_);
+    bool coalescible =
+        pending.batch_callback.is_null() && IsCoalescible(pending.command);
+    auto coalesced = coalesced_callbacks_.find(pending.command);
+    if (coalescible && coalesced != coalesced_callbacks_.end()) {
+      // The response is produced after this caller arrived so sharing it is
+      // indistinguishable from sending the command again. Joining takes no
+      // queue slot so it is never rejected.
+      coalesced->second.push_back(pending.callback);
+      VLOG(2) << "SCHEDULE: coalesced with " << coalesced->second.size() - 1
+              << " identical commands.";
+      InheritScheduling(pending.command, priority, pending.deadline);
+      return;
+    }
+    if (IsQueueFull(pending.client)) {
+      rejected = true;
+      ++rejected_count_;
+      VLOG(1) << "SCHEDULE: queue full, rejecting command.";
+    } else {
+      ++queued_count_;
+      max_queued_count_ = std::max(max_queued_count_, queued_count_);
+      if (!pending.client.empty()) {
+        ++client_queued_counts_[pending.client];
+      }
+      if (coalescible) {
+        coalesced_callbacks_[pending.command].push_back(pending.callback);
+        PendingCommand shared = pending;
+        shared.callback =
+            base::Bind(&SchedulingCommandTransceiver::OnCoalescedResponse,
+                       GetWeakPtr(), pending.command);
+        queues_[priority].push_back(shared);
+      } else {
+        queues_[priority].push_back(pending);
+      }
+    }
+  }
+  if (rejected) {
+    // Rejected; TPM_RC_RETRY tells the client to back off and try again.
+    std::string response = CreateErrorResponse(TPM_RC_RETRY);
+    if (!pending.batch_callback.is_null()) {
+      pending.batch_callback.Run({response});
+    } else {
+      pending.callback.Run(response);
+    }
+    return;
+  }
+  // Every queued command has exactly one dispatch task but the task itself
+  // picks which command to send, so commands queued while the TPM is busy are
+  // reordered by priority.
+  task_runner_->PostNonNestableTask(
+      FROM_HERE, base::Bind(&SchedulingCommandTransceiver::DispatchNextCommand,
+                            GetWeakPtr()));
+}
+
+void SchedulingCommandTransceiver::DispatchNextCommand() {
+  PendingCommand pending;
+  bool now_idle = true;
+  {
+    base::AutoLock lock(lock_);
+    if (!PopNextCommand(&pending)) {
+      return;
+    }
+    for (const auto& queue : queues_) {
+      now_idle = now_idle && queue.empty();
+    }
+  }
+  if (!pending.deadline.is_null() &&
+      base::TimeTicks::Now() > pending.deadline) {
+    VLOG(1) << "SCHEDULE: deadline exceeded.";
+    std::string response = CreateErrorResponse(TRUNKS_RC_DEADLINE_EXCEEDED);
+    if (!pending.batch_callback.is_null()) {
+      pending.batch_callback.Run({response});
+    } else {
+      pending.callback.Run(response);
+    }
+    return;
+  }
+  ++dispatch_count_;
+  if (!queue_latency_callback_.is_null()) {
+    base::TimeDelta queue_latency =
+        base::TimeTicks::Now() - pending.queued_time;
+    if (pending.batch_callback.is_null()) {
+      queue_latency_callback_.Run(pending.command, queue_latency);
+    }
+    for (const auto& command : pending.batch) {
+      queue_latency_callback_.Run(command, queue_latency);
+    }
+  }
+  ResponseCallback callback = pending.callback;
+  if (warning_retries_) {
+    callback = base::Bind(&SchedulingCommandTransceiver::OnCommandResponse,
+                          GetWeakPtr(), pending);
+  }
+  if (!pending.batch_callback.is_null()) {
+    pending.batch_callback.Run(next_transceiver_->SendCommandBatchAndWait(
+        pending.batch, pending.stop_on_failure));
+  } else if (!pending.client.empty()) {
+    next_transceiver_->SendCommandForClient(pending.client, pending.command,
+                                            callback);
+  } else {
+    next_transceiver_->SendCommand(pending.command, callback);
+  }
+  if (now_idle && !idle_callback_.is_null()) {
+    task_runner_->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&SchedulingCommandTransceiver::OnIdleTimeout, GetWeakPtr(),
+                   dispatch_count_),
+        base::TimeDelta::FromMilliseconds(kIdleDelayMilliseconds));
+  }
+}
+
+void SchedulingCommandTransceiver::OnCommandResponse(
+    const PendingCommand& pending,
+    const std::string& response) {
+  TPM_RC code = GetResponseCode(response);
+  if (code != TPM_RC_RETRY && code != TPM_RC_YIELDED &&
+      code != TPM_RC_TESTING && code != TPM_RC_NV_RATE) {
+    pending.callback.Run(response);
+    return;
+  }
+  PendingCommand retry = pending;
+  base::TimeDelta delay;
+  if (code == TPM_RC_RETRY) {
+    delay = GetBackoffDelay(kRetryBaseDelayMilliseconds,
+                            kRetryMaxDelayMilliseconds, retry.warning_retries);
+  } else if (code == TPM_RC_NV_RATE) {
+    delay = GetBackoffDelay(kNVRateBaseDelayMilliseconds,
+                            kNVRateMaxDelayMilliseconds, retry.warning_retries);
+  } else if (code == TPM_RC_TESTING) {
+    delay =
+        GetBackoffDelay(kSelfTestBaseDelayMilliseconds,
+                        kSelfTestMaxDelayMilliseconds, retry.warning_retries);
+  }
+  if (!ChargeWarningRetry(delay, &retry)) {
+    pending.callback.Run(response);
+    return;
+  }
+  VLOG(1) << "SCHEDULE: retrying after " << GetErrorString(code) << " in "
+          << delay.InMilliseconds() << "ms.";
+  base::Closure task;
+  if (code == TPM_RC_TESTING) {
+    task = base::Bind(&SchedulingCommandTransceiver::PollSelfTest,
+                      GetWeakPtr(), retry, response);
+  } else {
+    task = base::Bind(&SchedulingCommandTransceiver::RequeueCommand,
+                      GetWeakPtr(), retry);
+  }
+  task_runner_->PostDelayedTask(FROM_HERE, task, delay);
+}
+
+bool SchedulingCommandTransceiver::ChargeWarningRetry(
+    base::TimeDelta delay,
+    PendingCommand* pending) {
+  if (pending->warning_retries >= kMaxWarningRetries ||
+      pending->warning_delay + delay >
+          base::TimeDelta::FromMilliseconds(kMaxWarningDelayMilliseconds) ||
+      (!pending->deadline.is_null() &&
+       base::TimeTicks::Now() + delay > pending->deadline)) {
+    VLOG(1) << "SCHEDULE: warning retry budget exhausted.";
+    base::AutoLock lock(lock_);
+    ++retries_exhausted_count_;
+    return false;
+  }
+  ++pending->warning_retries;
+  pending->warning_delay += delay;
+  return true;
+}
+
+void SchedulingCommandTransceiver::PollSelfTest(const PendingCommand& pending,
+                                                const std::string& warning) {
+  {
+    base::AutoLock lock(lock_);
+    ++self_test_poll_count_;
+  }
+  std::string command;
+  Tpm::SerializeCommand_GetTestResult(&command, nullptr);
+  TPM2B_MAX_BUFFER out_data;
+  TPM_RC test_result = TPM_RC_SUCCESS;
+  TPM_RC result = Tpm::ParseResponse_GetTestResult(
+      next_transceiver_->SendCommandAndWait(command), &out_data, &test_result,
+      nullptr);
+  if (result != TPM_RC_SUCCESS || test_result == TPM_RC_FAILURE) {
+    LOG(WARNING) << "TPM self-test failed: "
+                 << GetErrorString(result != TPM_RC_SUCCESS ? result
+                                                            : test_result);
+    pending.callback.Run(warning);
+    return;
+  }
+  if (test_result != TPM_RC_TESTING) {
+    RequeueCommand(pending);
+    return;
+  }
+  PendingCommand retry = pending;
+  base::TimeDelta delay =
+      GetBackoffDelay(kSelfTestBaseDelayMilliseconds,
+                      kSelfTestMaxDelayMilliseconds, retry.warning_retries);
+  if (!ChargeWarningRetry(delay, &retry)) {
+    pending.callback.Run(warning);
+    return;
+  }
+  task_runner_->PostDelayedTask(
+      FROM_HERE, base::Bind(&SchedulingCommandTransceiver::PollSelfTest,
+                            GetWeakPtr(), retry, warning),
+      delay);
+}
+
+void SchedulingCommandTransceiver::RequeueCommand(PendingCommand pending) {
+  pending.queued_time = base::TimeTicks::Now();
+  {
+    base::AutoLock lock(lock_);
+    ++warning_retry_count_;
+    ++queued_count_;
+    max_queued_count_ = std::max(max_queued_count_, queued_count_);
+    if (!pending.client.empty()) {
+      ++client_queued_counts_[pending.client];
+    }
+    queues_[pending.priority].push_back(pending);
+  }
+  task_runner_->PostNonNestableTask(
+      FROM_HERE, base::Bind(&SchedulingCommandTransceiver::DispatchNextCommand,
+                            GetWeakPtr()));
+}
+
+void SchedulingCommandTransceiver::NotifyClientDisconnected(
+    const std::string& client) {
+  next_transceiver_->OnClientDisconnected(client);
+}
+
+void SchedulingCommandTransceiver::OnIdleTimeout(uint64_t dispatch_count) {
+  if (dispatch_count != dispatch_count_) {
+    // Another command was dispatched; it posted its own timeout.
+    return;
+  }
+  VLOG(2) << "SCHEDULE: idle.";
+  if (idle_callback_.Run()) {
+    task_runner_->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&SchedulingCommandTransceiver::OnIdleTimeout, GetWeakPtr(),
+                   dispatch_count_),
+        base::TimeDelta::FromMilliseconds(kIdleDelayMilliseconds));
+  }
+}
+
+void SchedulingCommandTransceiver::GetQueueStats(QueueStats* stats) {
+  base::AutoLock lock(lock_);
+  stats->set_queued_commands(queued_count_);
+  stats->set_max_queued_commands(max_queued_count_);
+  stats->set_rejected_commands(rejected_count_);
+  stats->set_queued_clients(client_queued_counts_.size());
+  stats->set_warning_retries(warning_retry_count_);
+  stats->set_self_test_polls(self_test_poll_count_);
+  stats->set_warning_retries_exhausted(retries_exhausted_count_);
+}
+
+bool SchedulingCommandTransceiver::IsQueueFull(const std::string& client) {
+  lock_.AssertAcquired();
+  if (max_queued_ > 0 && queued_count_ >= max_queued_) {
+    return true;
+  }
+  if (max_queued_per_client_ > 0 && !client.empty()) {
+    auto iter = client_queued_counts_.find(client);
+    if (iter != client_queued_counts_.end() &&
+        iter->second >= max_queued_per_client_) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SchedulingCommandTransceiver::InheritScheduling(
+    const std::string& command,
+    Priority priority,
+    base::TimeTicks deadline) {
+  lock_.AssertAcquired();
+  for (int i = 0; i < kNumPriorities; ++i) {
+    for (auto iter = queues_[i].begin(); iter != queues_[i].end(); ++iter) {
+      if (!iter->batch_callback.is_null() || iter->command != command) {
+        continue;
+      }
+      // A caller without a deadline waits as long as it takes.
+      if (!iter->deadline.is_null()) {
+        iter->deadline = deadline.is_null()
+                             ? base::TimeTicks()
+                             : std::max(iter->deadline, deadline);
+      }
+      if (i > priority) {
+        VLOG(2) << "SCHEDULE: coalesced command raised from priority " << i
+                << " to " << priority;
+        // The dispatch task posted for the command picks it up from its new
+        // queue.
+        queues_[priority].push_back(*iter);
+        queues_[i].erase(iter);
+      }
+      return;
+    }
+  }
+}
+
+void SchedulingCommandTransceiver::OnCoalescedResponse(
+    const std::string& command,
+    const std::string& response) {
+  std::vector<ResponseCallback> callbacks;
+  {
+    base::AutoLock lock(lock_);
+    auto iter = coalesced_callbacks_.find(command);
+    if (iter == coalesced_callbacks_.end()) {
+      return;
+    }
+    callbacks.swap(iter->second);
+    coalesced_callbacks_.erase(iter);
+  }
+  for (const auto& callback : callbacks) {
+    callback.Run(response);
+  }
+}
+
+bool SchedulingCommandTransceiver::PopNextCommand(PendingCommand* pending) {
+  lock_.AssertAcquired();
+  int chosen = -1;
+  // A starved queue is served first, lowest priority first since it has
+  // necessarily been waiting the longest.
+  for (int i = kNumPriorities - 1; i >= 0; --i) {
+    if (!queues_[i].empty() && bypass_count_[i] >= kMaxBypassCount) {
+      chosen = i;
+      break;
+    }
+  }
+  if (chosen < 0) {
+    for (int i = 0; i < kNumPriorities; ++i) {
+      if (!queues_[i].empty()) {
+        chosen = i;
+        break;
+      }
+    }
+  }
+  if (chosen < 0) {
+    return false;
+  }
+  for (int i = 0; i < kNumPriorities; ++i) {
+    if (i == chosen || queues_[i].empty()) {
+      bypass_count_[i] = 0;
+    } else if (i > chosen) {
+      ++bypass_count_[i];
+    }
+  }
+  *pending = queues_[chosen].front();
+  pending->priority = static_cast<Priority>(chosen);
+  queues_[chosen].pop_front();
+  --queued_count_;
+  if (!pending->client.empty()) {
+    auto iter = client_queued_counts_.find(pending->client);
+    if (--iter->second == 0) {
+      client_queued_counts_.erase(iter);
+    }
+  }
+  VLOG(2) << "SCHEDULE: priority " << chosen << ", "
+          << queues_[chosen].size() << " remaining.";
+  return true;
+}
+
+}  // namespace trunks
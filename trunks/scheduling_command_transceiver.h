@@ -0,0 +1,313 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TRUNKS_SCHEDULING_COMMAND_TRANSCEIVER_H_
+#define TRUNKS_SCHEDULING_COMMAND_TRANSCEIVER_H_
+
+#include "trunks/command_transceiver.h"
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <base/callback.h>
+#include <base/macros.h>
+#include <base/memory/ref_counted.h>
+#include <base/memory/weak_ptr.h>
+#include <base/sequenced_task_runner.h>
+#include <base/synchronization/lock.h>
+#include <base/time/time.h>
+
+#include "trunks/interface.pb.h"
+#include "trunks/tpm_generated.h"
+
+namespace trunks {
+
+// Sends commands to another CommandTransceiver on a background thread, like
+// BackgroundCommandTransceiver, but instead of forwarding commands strictly in
+// arrival order it keeps one queue per priority class and always forwards the
+// highest priority pending command next. Commands are still serialized; only
+// one command at a time reaches |next_transceiver|. Response callbacks are
+// called on the original calling thread.
+//
+// This avoids head-of-line blocking where cheap commands like PCR_Read queue up
+// behind a burst of expensive commands like key generation. Clients may also
+// request a priority class and a deadline per command; commands still queued
+// when their deadline passes fail with TRUNKS_RC_DEADLINE_EXCEEDED.
+//
+// Identical unauthenticated read commands, e.g. many clients starting up and
+// reading the salting key, are coalesced: a command which matches one already
+// queued or in flight is not sent again but shares the earlier response. A
+// queued coalesced command inherits the highest priority and the latest
+// deadline of its callers, so joining a background caller never delays an
+// interactive one.
+//
+// Example:
+//   base::Thread background_thread("my thread");
+//   ...
+//   SchedulingCommandTransceiver scheduling_transceiver(
+//       next_transceiver,
+//       background_thread.task_runner());
+//   ...
+//   scheduling_transceiver.SendCommand(my_command, MyCallback);
+class SchedulingCommandTransceiver : public CommandTransceiver {
+ public:
+  // Priority classes in order of decreasing priority.
+  enum Priority {
+    // Short commands which callers typically wait on, e.g. PCR_Read.
+    kPriorityInteractive = 0,
+    // Everything not otherwise classified.
+    kPriorityBulk,
+    // Commands which may keep the TPM busy for seconds, e.g. key generation.
+    kPriorityKeygen,
+    // Work nobody waits on; only sent when requested by the client.
+    kPriorityBackground,
+    kNumPriorities
+  };
+
+  // All commands will be forwarded to |next_transceiver| on |task_runner|,
+  // regardless of whether the synchronous or asynchronous method is used. This
+  // class does not take ownership of |next_transceiver|; it must remain valid
+  // for the lifetime of the object. The |task_runner| must not be nullptr.
+  SchedulingCommandTransceiver(
+      CommandTransceiver* next_transceiver,
+      const scoped_refptr<base::SequencedTaskRunner>& task_runner);
+  ~SchedulingCommandTransceiver() override;
+
+  // CommandTranceiver methods.
+  void SendCommand(const std::string& command,
+                   const ResponseCallback& callback) override;
+  std::string SendCommandAndWait(const std::string& command) override;
+  // A batch is scheduled as a single unit at the lowest priority of any of its
+  // commands and is never interleaved with other commands.
+  void SendCommandBatch(const std::vector<std::string>& commands,
+                        bool stop_on_failure,
+                        const BatchResponseCallback& callback) override;
+  std::vector<std::string> SendCommandBatchAndWait(
+      const std::vector<std::string>& commands,
+      bool stop_on_failure) override;
+  void SendCommandForClient(const std::string& client,
+                            const std::string& command,
+                            const ResponseCallback& callback) override;
+  void SendScheduledCommandForClient(const std::string& client,
+                                     const std::string& command,
+                                     RequestedPriority priority,
+                                     base::TimeTicks deadline,
+                                     const ResponseCallback& callback) override;
+  // The notification is forwarded on |task_runner| after every command already
+  // queued has been dispatched.
+  void OnClientDisconnected(const std::string& client) override;
+
+  // Sets a |callback| to run on |task_runner| once no command has been
+  // dispatched for a short while, e.g. to do housekeeping in the next
+  // transceiver without delaying a command. It runs once per idle period, and
+  // again after the same delay for as long as it returns true to report more
+  // work and no command arrives; a command arriving preempts the remaining
+  // work until the next idle period. Must be called before any command is
+  // sent.
+  typedef base::Callback<bool()> IdleCallback;
+  void set_idle_callback(const IdleCallback& callback) {
+    idle_callback_ = callback;
+  }
+
+  // Sets a |callback| to run on |task_runner| with each command as it is
+  // dispatched and the time it spent queued. Commands of a batch are reported
+  // one by one with the batch's queueing time. Must be called before any
+  // command is sent.
+  typedef base::Callback<void(const std::string& command,
+                              base::TimeDelta queue_latency)>
+      QueueLatencyCallback;
+  void set_queue_latency_callback(const QueueLatencyCallback& callback) {
+    queue_latency_callback_ = callback;
+  }
+
+  // Bounds the number of queued commands, not counting the one in flight, to
+  // |max_queued| in total and |max_queued_per_client| for each client, so a
+  // runaway client cannot push every other client's latency up. A batch counts
+  // as one command and coalesced commands count once. Commands beyond a limit
+  // are answered with TPM_RC_RETRY right away. Zero means no limit, the
+  // default. Must be called before any command is sent.
+  void set_queue_limits(size_t max_queued, size_t max_queued_per_client) {
+    max_queued_ = max_queued;
+    max_queued_per_client_ = max_queued_per_client;
+  }
+
+  // Enables or disables retrying single commands which the TPM answers with
+  // TPM_RC_RETRY, TPM_RC_YIELDED, TPM_RC_NV_RATE or TPM_RC_TESTING. Instead of
+  // passing the warning on, the command goes back to the end of its queue
+  // after a delay, so other commands are sent while it waits:
+  // - TPM_RC_RETRY waits with exponential backoff and jitter.
+  // - TPM_RC_NV_RATE does the same with longer delays, as the TPM throttles
+  //   NV writes for a while.
+  // - TPM_RC_YIELDED does not wait; the TPM only asks for other work first.
+  // - TPM_RC_TESTING polls GetTestResult with backoff until the self-test is
+  //   done, then sends the command again.
+  // Each command has a budget of retries and of total delay and is never
+  // delayed past its deadline; once that runs out the warning is passed on.
+  // Batches are not retried. It is disabled by default. Must be called before
+  // any command is sent.
+  void set_warning_retries(bool enabled) { warning_retries_ = enabled; }
+
+  // Reads the queue depth counters into |stats|. May be called on any thread.
+  void GetQueueStats(QueueStats* stats);
+
+  // Returns the priority class for a given command |code|.
+  static Priority GetPriority(TPM_CC code);
+
+  // Returns true if concurrent identical copies of |command| may share a
+  // single response. This is the case for session-less commands which only
+  // read TPM state.
+  static bool IsCoalescible(const std::string& command);
+
+ private:
+  // Either a single command with |callback| or a batch of commands with
+  // |batch_callback|.
+  struct PendingCommand {
+    std::string command;
+    // The client the command is sent for, or empty if unknown.
+    std::string client;
+    ResponseCallback callback;
+    std::vector<std::string> batch;
+    bool stop_on_failure = false;
+    BatchResponseCallback batch_callback;
+    // When the command was queued.
+    base::TimeTicks queued_time;
+    // The command fails instead of being sent after this time, unless null.
+    base::TimeTicks deadline;
+    // The queue the command was last taken from.
+    Priority priority = kPriorityBulk;
+    // The warning retries and GetTestResult polls made for the command so far
+    // and the time they waited.
+    int warning_retries = 0;
+    base::TimeDelta warning_delay;
+  };
+
+  // Returns the priority class for a raw |command|. Malformed commands are
+  // classified as bulk; the next transceiver is responsible for rejecting them.
+  static Priority GetCommandPriority(const std::string& command);
+
+  // Returns the priority class for a |command| sent with a client |requested|
+  // priority.
+  static Priority GetRequestedPriority(RequestedPriority requested,
+                                       const std::string& command);
+
+  // Queues a |pending| command with the given |priority| and posts a task to
+  // dispatch one command on |task_runner_|. If an identical coalescible
+  // command is already queued or in flight, |pending| waits for its response
+  // instead.
+  void QueueCommand(Priority priority, PendingCommand pending);
+
+  // Gives the queued copy of a coalesced |command| the |priority| and
+  // |deadline| of another caller if they are more urgent or later,
+  // respectively. Does nothing if the command is already in flight. Must be
+  // called with |lock_| held.
+  void InheritScheduling(const std::string& command,
+                         Priority priority,
+                         base::TimeTicks deadline);
+
+  // Runs the callbacks of every caller waiting on a coalesced |command| with
+  // its |response|.
+  void OnCoalescedResponse(const std::string& command,
+                           const std::string& response);
+
+  // Removes the next command to be sent from the queues and sends it to the
+  // |next_transceiver_|. Runs on |task_runner_|.
+  void DispatchNextCommand();
+
+  // Runs the callback of a single |pending| command with its |response|,
+  // unless the response is a warning which set_warning_retries() covers and
+  // the command has retries left, in which case the retry is scheduled. Runs
+  // on |task_runner_|.
+  void OnCommandResponse(const PendingCommand& pending,
+                         const std::string& response);
+
+  // Charges a retry waiting |delay| to the budget of |pending|. Returns false,
+  // leaving |pending| unchanged, if the budget does not cover it.
+  bool ChargeWarningRetry(base::TimeDelta delay, PendingCommand* pending);
+
+  // Asks the TPM whether its self-test is done and requeues |pending| if so,
+  // or polls again later. The |warning| response is passed on if the self-test
+  // failed or the budget runs out. Runs on |task_runner_|.
+  void PollSelfTest(const PendingCommand& pending, const std::string& warning);
+
+  // Puts |pending| back at the end of its queue, bypassing coalescing and the
+  // queue limits, and posts a dispatch task for it. Runs on |task_runner_|.
+  void RequeueCommand(PendingCommand pending);
+
+  // Forwards a client disconnect to |next_transceiver_|. Runs on
+  // |task_runner_|.
+  void NotifyClientDisconnected(const std::string& client);
+
+  // Runs |idle_callback_| if no command was dispatched since
+  // |dispatch_count_| was |dispatch_count|. Runs on |task_runner_|.
+  void OnIdleTimeout(uint64_t dispatch_count);
+
+  // Returns true if a command for |client|, which may be empty, does not fit
+  // in the queues. Must be called with |lock_| held.
+  bool IsQueueFull(const std::string& client);
+
+  // Pops the next command to be sent into |pending|. Returns false if no
+  // commands are queued. Must be called with |lock_| held.
+  bool PopNextCommand(PendingCommand* pending);
+
+  base::WeakPtr<SchedulingCommandTransceiver> GetWeakPtr() {
+    return weak_factory_.GetWeakPtr();
+  }
+
+  CommandTransceiver* next_transceiver_;
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+  IdleCallback idle_callback_;
+  QueueLatencyCallback queue_latency_callback_;
+  // The number of commands dispatched so far. Only accessed on |task_runner_|.
+  uint64_t dispatch_count_ = 0;
+
+  size_t max_queued_ = 0;
+  size_t max_queued_per_client_ = 0;
+  bool warning_retries_ = false;
+
+  // Guards |queues_|, |bypass_count_|, |coalesced_callbacks_| and the queue
+  // counters.
+  base::Lock lock_;
+  // The number of entries in |queues_|, overall and for each client with any.
+  size_t queued_count_ = 0;
+  std::map<std::string, size_t> client_queued_counts_;
+  // The highest |queued_count_| so far.
+  size_t max_queued_count_ = 0;
+  // The number of commands rejected because a queue limit was reached.
+  uint64_t rejected_count_ = 0;
+  // Commands sent again after a warning, GetTestResult polls and commands
+  // whose warning was passed on because their retry budget ran out.
+  uint64_t warning_retry_count_ = 0;
+  uint64_t self_test_poll_count_ = 0;
+  uint64_t retries_exhausted_count_ = 0;
+  std::deque<PendingCommand> queues_[kNumPriorities];
+  // The number of consecutive times a non-empty queue was passed over in favor
+  // of a higher priority queue. Used to bound starvation of lower priorities.
+  int bypass_count_[kNumPriorities] = {};
+  // The callbacks waiting on each coalescible command which is queued or in
+  // flight, keyed by the command.
+  std::map<std::string, std::vector<ResponseCallback>> coalesced_callbacks_;
+
+  // Declared last so weak pointers are invalidated first on destruction.
+  base::WeakPtrFactory<SchedulingCommandTransceiver> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(SchedulingCommandTransceiver);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_SCHEDULING_COMMAND_TRANSCEIVER_H_
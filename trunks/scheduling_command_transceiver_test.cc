@@ -0,0 +1,583 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/scheduling_command_transceiver.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <base/bind.h>
+#include <base/message_loop/message_loop.h>
+#include <base/run_loop.h>
+#include <base/synchronization/waitable_event.h>
+#include <base/threading/thread.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/mock_command_transceiver.h"
+
+using testing::_;
+using testing::Invoke;
+
+namespace {
+
+const char kTestThreadName[] = "test_thread";
+
+std::string MakeCommand(trunks::TPM_CC code) {
+  std::string command;
+  trunks::Serialize_TPM_ST(trunks::TPM_ST_NO_SESSIONS, &command);
+  trunks::Serialize_UINT32(10, &command);
+  trunks::Serialize_TPM_CC(code, &command);
+  return command;
+}
+
+// Builds a GetTestResult response reporting |test_result|.
+std::string MakeTestResultResponse(trunks::TPM_RC test_result) {
+  std::string parameters;
+  trunks::Serialize_UINT16(0, &parameters);
+  trunks::Serialize_TPM_RC(test_result, &parameters);
+  std::string response;
+  trunks::Serialize_TPM_ST(trunks::TPM_ST_NO_SESSIONS, &response);
+  trunks::Serialize_UINT32(10 + parameters.size(), &response);
+  trunks::Serialize_TPM_RC(trunks::TPM_RC_SUCCESS, &response);
+  return response + parameters;
+}
+
+void Append(std::vector<std::string>* responses, const std::string& response) {
+  responses->push_back(response);
+}
+
+void AssignBatch(std::vector<std::string>* to,
+                 const std::vector<std::string>& from) {
+  *to = from;
+}
+
+void Block(base::WaitableEvent* event) {
+  event->Wait();
+}
+
+// An idle callback which reports more work until it ran |*remaining| times.
+bool CountIdleRuns(int* remaining, base::WaitableEvent* done) {
+  if (--*remaining > 0) {
+    return true;
+  }
+  done->Signal();
+  return false;
+}
+
+void RecordQueueLatency(std::vector<std::string>* commands,
+                        std::vector<base::TimeDelta>* latencies,
+                        const std::string& command,
+                        base::TimeDelta latency) {
+  commands->push_back(command);
+  latencies->push_back(latency);
+}
+
+}  // namespace
+
+namespace trunks {
+
+class SchedulingCommandTransceiverTest : public testing::Test {
+ public:
+  SchedulingCommandTransceiverTest() : test_thread_(kTestThreadName) {
+    ON_CALL(next_transceiver_, SendCommand(_, _))
+        .WillByDefault(Invoke(
+            [this](const std::string& command,
+                   const CommandTransceiver::ResponseCallback& callback) {
+              sent_commands_.push_back(command);
+              std::deque<TPM_RC>& warnings = warnings_[command];
+              if (!warnings.empty()) {
+                TPM_RC warning = warnings.front();
+                warnings.pop_front();
+                callback.Run(CreateErrorResponse(warning));
+                return;
+              }
+              callback.Run(command);
+            }));
+    ON_CALL(next_transceiver_, SendCommandAndWait(_))
+        .WillByDefault(Invoke([this](const std::string& command) {
+          sent_commands_.push_back(command);
+          if (command == failing_command_) {
+            return CreateErrorResponse(TPM_RC_FAILURE);
+          }
+          if (!test_results_.empty()) {
+            TPM_RC test_result = test_results_.front();
+            test_results_.pop_front();
+            return MakeTestResultResponse(test_result);
+          }
+          return CreateErrorResponse(TPM_RC_SUCCESS);
+        }));
+    CHECK(test_thread_.Start());
+  }
+  ~SchedulingCommandTransceiverTest() override {}
+
+ protected:
+  base::MessageLoopForIO message_loop_;
+  base::Thread test_thread_;
+  testing::NiceMock<MockCommandTransceiver> next_transceiver_;
+  // Only accessed on |test_thread_| until the thread is idle.
+  std::vector<std::string> sent_commands_;
+  std::string failing_command_;
+  // Warnings sent in response to each command before it succeeds.
+  std::map<std::string, std::deque<TPM_RC>> warnings_;
+  // Responses to GetTestResult, sent with SendCommandAndWait().
+  std::deque<TPM_RC> test_results_;
+};
+
+TEST_F(SchedulingCommandTransceiverTest, GetPriority) {
+  EXPECT_EQ(SchedulingCommandTransceiver::kPriorityInteractive,
+            SchedulingCommandTransceiver::GetPriority(TPM_CC_PCR_Read));
+  EXPECT_EQ(SchedulingCommandTransceiver::kPriorityInteractive,
+            SchedulingCommandTransceiver::GetPriority(TPM_CC_GetCapability));
+  EXPECT_EQ(SchedulingCommandTransceiver::kPriorityBulk,
+            SchedulingCommandTransceiver::GetPriority(TPM_CC_NV_Write));
+  EXPECT_EQ(SchedulingCommandTransceiver::kPriorityKeygen,
+            SchedulingCommandTransceiver::GetPriority(TPM_CC_Create));
+}
+
+TEST_F(SchedulingCommandTransceiverTest, Synchronous) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  std::string command = MakeCommand(TPM_CC_PCR_Read);
+  EXPECT_EQ(command, transceiver.SendCommandAndWait(command));
+}
+
+TEST_F(SchedulingCommandTransceiverTest, IndependentCommands) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  std::vector<std::string> commands = {MakeCommand(TPM_CC_PCR_Read),
+                                       MakeCommand(TPM_CC_ReadPublic)};
+  EXPECT_EQ(commands, transceiver.SendCommandsAndWait(commands));
+}
+
+TEST_F(SchedulingCommandTransceiverTest, PriorityOrder) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  // Keep the background thread busy while commands are queued.
+  base::WaitableEvent unblock(base::WaitableEvent::ResetPolicy::MANUAL,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED);
+  test_thread_.task_runner()->PostTask(FROM_HERE, base::Bind(Block, &unblock));
+  std::vector<std::string> responses;
+  std::string keygen = MakeCommand(TPM_CC_Create);
+  std::string bulk = MakeCommand(TPM_CC_NV_Write);
+  std::string interactive = MakeCommand(TPM_CC_PCR_Read);
+  transceiver.SendCommand(keygen, base::Bind(Append, &responses));
+  transceiver.SendCommand(bulk, base::Bind(Append, &responses));
+  transceiver.SendCommand(interactive, base::Bind(Append, &responses));
+  unblock.Signal();
+  while (responses.size() < 3) {
+    base::RunLoop run_loop;
+    run_loop.RunUntilIdle();
+  }
+  ASSERT_EQ(3u, sent_commands_.size());
+  EXPECT_EQ(interactive, sent_commands_[0]);
+  EXPECT_EQ(bulk, sent_commands_[1]);
+  EXPECT_EQ(keygen, sent_commands_[2]);
+}
+
+TEST_F(SchedulingCommandTransceiverTest, NoStarvation) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  base::WaitableEvent unblock(base::WaitableEvent::ResetPolicy::MANUAL,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED);
+  test_thread_.task_runner()->PostTask(FROM_HERE, base::Bind(Block, &unblock));
+  std::vector<std::string> responses;
+  std::string keygen = MakeCommand(TPM_CC_Create);
+  // Not coalescible, so every copy is sent.
+  std::string interactive = MakeCommand(TPM_CC_PCR_Extend);
+  const size_t kNumInteractive = 20;
+  transceiver.SendCommand(keygen, base::Bind(Append, &responses));
+  for (size_t i = 0; i < kNumInteractive; ++i) {
+    transceiver.SendCommand(interactive, base::Bind(Append, &responses));
+  }
+  unblock.Signal();
+  while (responses.size() < kNumInteractive + 1) {
+    base::RunLoop run_loop;
+    run_loop.RunUntilIdle();
+  }
+  // The keygen command must not wait for every interactive command.
+  ASSERT_EQ(kNumInteractive + 1, sent_commands_.size());
+  EXPECT_NE(keygen, sent_commands_.back());
+}
+
+TEST_F(SchedulingCommandTransceiverTest, RequestedPriority) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  base::WaitableEvent unblock(base::WaitableEvent::ResetPolicy::MANUAL,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED);
+  test_thread_.task_runner()->PostTask(FROM_HERE, base::Bind(Block, &unblock));
+  std::vector<std::string> responses;
+  std::string background = MakeCommand(TPM_CC_PCR_Extend);
+  std::string keygen = MakeCommand(TPM_CC_Create);
+  std::string unseal = MakeCommand(TPM_CC_Unseal);
+  transceiver.SendScheduledCommandForClient(
+      "client", background, CommandTransceiver::kRequestedPriorityBackground,
+      base::TimeTicks(), base::Bind(Append, &responses));
+  transceiver.SendCommand(keygen, base::Bind(Append, &responses));
+  transceiver.SendScheduledCommandForClient(
+      "client", unseal, CommandTransceiver::kRequestedPriorityInteractive,
+      base::TimeTicks(), base::Bind(Append, &responses));
+  unblock.Signal();
+  while (responses.size() < 3) {
+    base::RunLoop run_loop;
+    run_loop.RunUntilIdle();
+  }
+  ASSERT_EQ(3u, sent_commands_.size());
+  EXPECT_EQ(unseal, sent_commands_[0]);
+  EXPECT_EQ(keygen, sent_commands_[1]);
+  EXPECT_EQ(background, sent_commands_[2]);
+}
+
+TEST_F(SchedulingCommandTransceiverTest, DeadlineExceeded) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  base::WaitableEvent unblock(base::WaitableEvent::ResetPolicy::MANUAL,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED);
+  test_thread_.task_runner()->PostTask(FROM_HERE, base::Bind(Block, &unblock));
+  std::vector<std::string> responses;
+  std::string late = MakeCommand(TPM_CC_PCR_Extend);
+  std::string on_time = MakeCommand(TPM_CC_NV_Write);
+  transceiver.SendScheduledCommandForClient(
+      "client", late, CommandTransceiver::kRequestedPriorityDefault,
+      base::TimeTicks::Now() - base::TimeDelta::FromSeconds(1),
+      base::Bind(Append, &responses));
+  transceiver.SendScheduledCommandForClient(
+      "client", on_time, CommandTransceiver::kRequestedPriorityDefault,
+      base::TimeTicks::Now() + base::TimeDelta::FromMinutes(5),
+      base::Bind(Append, &responses));
+  unblock.Signal();
+  while (responses.size() < 2) {
+    base::RunLoop run_loop;
+    run_loop.RunUntilIdle();
+  }
+  EXPECT_EQ(CreateErrorResponse(TRUNKS_RC_DEADLINE_EXCEEDED), responses[0]);
+  EXPECT_EQ(on_time, responses[1]);
+  ASSERT_EQ(1u, sent_commands_.size());
+  EXPECT_EQ(on_time, sent_commands_[0]);
+}
+
+TEST_F(SchedulingCommandTransceiverTest, CoalescedCommandInheritsScheduling) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  base::WaitableEvent unblock(base::WaitableEvent::ResetPolicy::MANUAL,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED);
+  test_thread_.task_runner()->PostTask(FROM_HERE, base::Bind(Block, &unblock));
+  std::vector<std::string> responses;
+  std::string read_public = MakeCommand(TPM_CC_ReadPublic);
+  std::string bulk = MakeCommand(TPM_CC_NV_Write);
+  // An expired background caller is joined by an interactive caller without a
+  // deadline, so the shared command is sent first and not failed.
+  transceiver.SendScheduledCommandForClient(
+      "client", read_public, CommandTransceiver::kRequestedPriorityBackground,
+      base::TimeTicks::Now() - base::TimeDelta::FromSeconds(1),
+      base::Bind(Append, &responses));
+  transceiver.SendCommand(bulk, base::Bind(Append, &responses));
+  transceiver.SendScheduledCommandForClient(
+      "client", read_public, CommandTransceiver::kRequestedPriorityInteractive,
+      base::TimeTicks(), base::Bind(Append, &responses));
+  unblock.Signal();
+  while (responses.size() < 3) {
+    base::RunLoop run_loop;
+    run_loop.RunUntilIdle();
+  }
+  ASSERT_EQ(2u, sent_commands_.size());
+  EXPECT_EQ(read_public, sent_commands_[0]);
+  EXPECT_EQ(bulk, sent_commands_[1]);
+  EXPECT_EQ(2, std::count(responses.begin(), responses.end(), read_public));
+}
+
+TEST_F(SchedulingCommandTransceiverTest, QueueLimits) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  transceiver.set_queue_limits(3, 2);
+  base::WaitableEvent unblock(base::WaitableEvent::ResetPolicy::MANUAL,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED);
+  test_thread_.task_runner()->PostTask(FROM_HERE, base::Bind(Block, &unblock));
+  std::vector<std::string> responses;
+  std::string command = MakeCommand(TPM_CC_PCR_Extend);
+  std::string retry = CreateErrorResponse(TPM_RC_RETRY);
+  // The third command of a client exceeds the per-client limit.
+  for (int i = 0; i < 3; ++i) {
+    transceiver.SendCommandForClient("busy", command,
+                                     base::Bind(Append, &responses));
+  }
+  transceiver.SendCommandForClient("other", command,
+                                   base::Bind(Append, &responses));
+  // The global limit is reached.
+  transceiver.SendCommandForClient("late", command,
+                                   base::Bind(Append, &responses));
+  QueueStats stats;
+  transceiver.GetQueueStats(&stats);
+  EXPECT_EQ(3u, stats.queued_commands());
+  EXPECT_EQ(2u, stats.queued_clients());
+  EXPECT_EQ(2u, stats.rejected_commands());
+  unblock.Signal();
+  while (responses.size() < 5) {
+    base::RunLoop run_loop;
+    run_loop.RunUntilIdle();
+  }
+  EXPECT_EQ(2, std::count(responses.begin(), responses.end(), retry));
+  EXPECT_EQ(3u, sent_commands_.size());
+  transceiver.GetQueueStats(&stats);
+  EXPECT_EQ(0u, stats.queued_commands());
+  EXPECT_EQ(3u, stats.max_queued_commands());
+  EXPECT_EQ(0u, stats.queued_clients());
+}
+
+TEST_F(SchedulingCommandTransceiverTest, WarningsPassedOnByDefault) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  std::string command = MakeCommand(TPM_CC_NV_Write);
+  warnings_[command] = {TPM_RC_RETRY};
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_RETRY),
+            transceiver.SendCommandAndWait(command));
+  EXPECT_EQ(1u, sent_commands_.size());
+}
+
+TEST_F(SchedulingCommandTransceiverTest, RetryWarnings) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  transceiver.set_warning_retries(true);
+  std::string command = MakeCommand(TPM_CC_NV_Write);
+  warnings_[command] = {TPM_RC_RETRY, TPM_RC_YIELDED, TPM_RC_RETRY};
+  EXPECT_EQ(command, transceiver.SendCommandAndWait(command));
+  EXPECT_EQ(4u, sent_commands_.size());
+  QueueStats stats;
+  transceiver.GetQueueStats(&stats);
+  EXPECT_EQ(3u, stats.warning_retries());
+  EXPECT_EQ(0u, stats.warning_retries_exhausted());
+  EXPECT_EQ(0u, stats.queued_commands());
+}
+
+TEST_F(SchedulingCommandTransceiverTest, RetryNVRate) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  transceiver.set_warning_retries(true);
+  std::string command = MakeCommand(TPM_CC_NV_Write);
+  warnings_[command] = {TPM_RC_NV_RATE};
+  EXPECT_EQ(command, transceiver.SendCommandAndWait(command));
+  EXPECT_EQ(2u, sent_commands_.size());
+  QueueStats stats;
+  transceiver.GetQueueStats(&stats);
+  EXPECT_EQ(1u, stats.warning_retries());
+}
+
+TEST_F(SchedulingCommandTransceiverTest, RetryDoesNotBlockOtherCommands) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  transceiver.set_warning_retries(true);
+  base::WaitableEvent unblock(base::WaitableEvent::ResetPolicy::MANUAL,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED);
+  test_thread_.task_runner()->PostTask(FROM_HERE, base::Bind(Block, &unblock));
+  std::vector<std::string> responses;
+  std::string busy = MakeCommand(TPM_CC_NV_Write);
+  std::string other = MakeCommand(TPM_CC_NV_Read);
+  warnings_[busy] = {TPM_RC_RETRY};
+  transceiver.SendCommandForClient("busy", busy,
+                                   base::Bind(Append, &responses));
+  transceiver.SendCommandForClient("other", other,
+                                   base::Bind(Append, &responses));
+  unblock.Signal();
+  while (responses.size() < 2) {
+    base::RunLoop run_loop;
+    run_loop.RunUntilIdle();
+  }
+  EXPECT_EQ(other, responses[0]);
+  EXPECT_EQ(busy, responses[1]);
+  ASSERT_EQ(3u, sent_commands_.size());
+  EXPECT_EQ(busy, sent_commands_[0]);
+  EXPECT_EQ(other, sent_commands_[1]);
+  EXPECT_EQ(busy, sent_commands_[2]);
+}
+
+TEST_F(SchedulingCommandTransceiverTest, WaitForSelfTest) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  transceiver.set_warning_retries(true);
+  std::string command = MakeCommand(TPM_CC_Create);
+  warnings_[command] = {TPM_RC_TESTING};
+  test_results_ = {TPM_RC_TESTING, TPM_RC_SUCCESS};
+  EXPECT_EQ(command, transceiver.SendCommandAndWait(command));
+  ASSERT_EQ(4u, sent_commands_.size());
+  EXPECT_EQ(MakeCommand(TPM_CC_GetTestResult), sent_commands_[1]);
+  EXPECT_EQ(MakeCommand(TPM_CC_GetTestResult), sent_commands_[2]);
+  EXPECT_EQ(command, sent_commands_[3]);
+  QueueStats stats;
+  transceiver.GetQueueStats(&stats);
+  EXPECT_EQ(1u, stats.warning_retries());
+  EXPECT_EQ(2u, stats.self_test_polls());
+}
+
+TEST_F(SchedulingCommandTransceiverTest, SelfTestFailure) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  transceiver.set_warning_retries(true);
+  std::string command = MakeCommand(TPM_CC_Create);
+  warnings_[command] = {TPM_RC_TESTING};
+  test_results_ = {TPM_RC_FAILURE};
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_TESTING),
+            transceiver.SendCommandAndWait(command));
+  EXPECT_EQ(2u, sent_commands_.size());
+}
+
+TEST_F(SchedulingCommandTransceiverTest, RetryBudgetExhausted) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  transceiver.set_warning_retries(true);
+  std::string command = MakeCommand(TPM_CC_NV_Write);
+  warnings_[command] = std::deque<TPM_RC>(20, TPM_RC_YIELDED);
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_YIELDED),
+            transceiver.SendCommandAndWait(command));
+  QueueStats stats;
+  transceiver.GetQueueStats(&stats);
+  EXPECT_EQ(sent_commands_.size() - 1, stats.warning_retries());
+  EXPECT_EQ(1u, stats.warning_retries_exhausted());
+}
+
+TEST_F(SchedulingCommandTransceiverTest, IsCoalescible) {
+  EXPECT_TRUE(SchedulingCommandTransceiver::IsCoalescible(
+      MakeCommand(TPM_CC_ReadPublic)));
+  EXPECT_FALSE(SchedulingCommandTransceiver::IsCoalescible(
+      MakeCommand(TPM_CC_GetRandom)));
+  std::string with_sessions = MakeCommand(TPM_CC_ReadPublic);
+  with_sessions[1] = TPM_ST_SESSIONS & 0xff;
+  EXPECT_FALSE(SchedulingCommandTransceiver::IsCoalescible(with_sessions));
+}
+
+TEST_F(SchedulingCommandTransceiverTest, CoalesceIdenticalReads) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  base::WaitableEvent unblock(base::WaitableEvent::ResetPolicy::MANUAL,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED);
+  test_thread_.task_runner()->PostTask(FROM_HERE, base::Bind(Block, &unblock));
+  std::vector<std::string> responses;
+  std::string read_public = MakeCommand(TPM_CC_ReadPublic);
+  std::string get_random = MakeCommand(TPM_CC_GetRandom);
+  for (int i = 0; i < 3; ++i) {
+    transceiver.SendCommand(read_public, base::Bind(Append, &responses));
+    transceiver.SendCommand(get_random, base::Bind(Append, &responses));
+  }
+  unblock.Signal();
+  while (responses.size() < 6) {
+    base::RunLoop run_loop;
+    run_loop.RunUntilIdle();
+  }
+  // ReadPublic is sent once and every caller gets the response.
+  ASSERT_EQ(4u, sent_commands_.size());
+  EXPECT_EQ(read_public, sent_commands_[0]);
+  EXPECT_EQ(3, std::count(responses.begin(), responses.end(), read_public));
+  // A later identical command is sent again.
+  EXPECT_EQ(read_public, transceiver.SendCommandAndWait(read_public));
+  EXPECT_EQ(5u, sent_commands_.size());
+}
+
+TEST_F(SchedulingCommandTransceiverTest, IdleCallback) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  base::WaitableEvent idle(base::WaitableEvent::ResetPolicy::MANUAL,
+                           base::WaitableEvent::InitialState::NOT_SIGNALED);
+  int remaining = 1;
+  transceiver.set_idle_callback(base::Bind(CountIdleRuns, &remaining, &idle));
+  std::string command = MakeCommand(TPM_CC_PCR_Read);
+  EXPECT_EQ(command, transceiver.SendCommandAndWait(command));
+  idle.Wait();
+  EXPECT_EQ(1u, sent_commands_.size());
+}
+
+TEST_F(SchedulingCommandTransceiverTest, IdleCallbackWithMoreWork) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  base::WaitableEvent done(base::WaitableEvent::ResetPolicy::MANUAL,
+                           base::WaitableEvent::InitialState::NOT_SIGNALED);
+  // Only accessed on |test_thread_|.
+  int remaining = 3;
+  transceiver.set_idle_callback(base::Bind(CountIdleRuns, &remaining, &done));
+  std::string command = MakeCommand(TPM_CC_PCR_Read);
+  EXPECT_EQ(command, transceiver.SendCommandAndWait(command));
+  // The callback keeps running while it reports more work.
+  done.Wait();
+  EXPECT_EQ(0, remaining);
+}
+
+TEST_F(SchedulingCommandTransceiverTest, QueueLatencyCallback) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  // Only accessed on |test_thread_|, which SendCommandAndWait waits for.
+  std::vector<std::string> commands;
+  std::vector<base::TimeDelta> latencies;
+  transceiver.set_queue_latency_callback(
+      base::Bind(RecordQueueLatency, &commands, &latencies));
+  std::string command = MakeCommand(TPM_CC_PCR_Read);
+  std::string bulk = MakeCommand(TPM_CC_NV_Write);
+  base::TimeTicks start = base::TimeTicks::Now();
+  transceiver.SendCommandAndWait(command);
+  transceiver.SendCommandBatchAndWait({bulk, bulk}, false);
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  ASSERT_EQ(3u, commands.size());
+  EXPECT_EQ(command, commands[0]);
+  EXPECT_EQ(bulk, commands[1]);
+  EXPECT_EQ(bulk, commands[2]);
+  EXPECT_EQ(latencies[1], latencies[2]);
+  for (base::TimeDelta latency : latencies) {
+    EXPECT_LE(latency, elapsed);
+  }
+}
+
+TEST_F(SchedulingCommandTransceiverTest, BatchIsNotInterleaved) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  base::WaitableEvent unblock(base::WaitableEvent::ResetPolicy::MANUAL,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED);
+  test_thread_.task_runner()->PostTask(FROM_HERE, base::Bind(Block, &unblock));
+  std::string bulk = MakeCommand(TPM_CC_NV_Write);
+  std::string interactive = MakeCommand(TPM_CC_PCR_Read);
+  std::vector<std::string> batch_responses;
+  std::vector<std::string> responses;
+  transceiver.SendCommandBatch({bulk, bulk, bulk}, false,
+                               base::Bind(AssignBatch, &batch_responses));
+  transceiver.SendCommand(interactive, base::Bind(Append, &responses));
+  unblock.Signal();
+  while (batch_responses.empty() || responses.empty()) {
+    base::RunLoop run_loop;
+    run_loop.RunUntilIdle();
+  }
+  EXPECT_EQ(3u, batch_responses.size());
+  ASSERT_EQ(4u, sent_commands_.size());
+  // The interactive command is reordered ahead of the batch, never into it.
+  EXPECT_EQ(interactive, sent_commands_[0]);
+  EXPECT_EQ(bulk, sent_commands_[1]);
+  EXPECT_EQ(bulk, sent_commands_[3]);
+}
+
+TEST_F(SchedulingCommandTransceiverTest, BatchStopOnFailure) {
+  SchedulingCommandTransceiver transceiver(&next_transceiver_,
+                                           test_thread_.task_runner());
+  std::string good = MakeCommand(TPM_CC_PCR_Read);
+  failing_command_ = MakeCommand(TPM_CC_NV_Read);
+  std::vector<std::string> responses = transceiver.SendCommandBatchAndWait(
+      {good, failing_command_, good}, true);
+  ASSERT_EQ(2u, responses.size());
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_SUCCESS), responses[0]);
+  EXPECT_EQ(CreateErrorResponse(TPM_RC_FAILURE), responses[1]);
+  responses = transceiver.SendCommandBatchAndWait(
+      {good, failing_command_, good}, false);
+  EXPECT_EQ(3u, responses.size());
+}
+
+}  // namespace trunks
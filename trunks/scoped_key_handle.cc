@@ -16,6 +16,8 @@
 
 #include "trunks/scoped_key_handle.h"
 
+#include <string>
+
 #include <base/logging.h>
 
 #include "trunks/error_codes.h"
@@ -28,6 +30,58 @@ const trunks::TPM_HANDLE kInvalidHandle = 0;
 
 namespace trunks {
 
+const size_t HandleFlushQueue::kMaxQueuedHandles;
+
+HandleFlushQueue::HandleFlushQueue(const TrunksFactory& factory)
+    : factory_(factory) {}
+
+HandleFlushQueue::~HandleFlushQueue() {
+  Flush();
+}
+
+void HandleFlushQueue::Add(TPM_HANDLE handle) {
+  handles_.push_back(handle);
+  if (handles_.size() >= kMaxQueuedHandles) {
+    Flush();
+  }
+}
+
+void HandleFlushQueue::Flush() {
+  if (handles_.empty()) {
+    return;
+  }
+  std::vector<TPM_HANDLE> handles;
+  std::vector<std::string> commands;
+  for (TPM_HANDLE handle : handles_) {
+    std::string command;
+    TPM_RC result =
+        Tpm::SerializeCommand_FlushContext(handle, &command, nullptr);
+    if (result) {
+      LOG(WARNING) << "Error serializing flush for handle: " << handle
+                   << " : " << GetErrorString(result);
+      continue;
+    }
+    handles.push_back(handle);
+    commands.push_back(command);
+  }
+  handles_.clear();
+  if (commands.empty()) {
+    return;
+  }
+  std::vector<std::string> responses =
+      factory_.GetTpm()->SendCommandsAndWait(commands);
+  for (size_t i = 0; i < handles.size(); ++i) {
+    TPM_RC result = TPM_RC_FAILURE;
+    if (i < responses.size()) {
+      result = Tpm::ParseResponse_FlushContext(responses[i], nullptr);
+    }
+    if (result) {
+      LOG(WARNING) << "Error closing handle: " << handles[i] << " : "
+                   << GetErrorString(result);
+    }
+  }
+}
+
 ScopedKeyHandle::ScopedKeyHandle(const TrunksFactory& factory)
     : factory_(factory), handle_(kInvalidHandle) {}
 
@@ -68,6 +122,10 @@ TPM_HANDLE ScopedKeyHandle::get() const {
 }
 
 void ScopedKeyHandle::FlushHandleContext(TPM_HANDLE handle) {
+  if (flush_queue_) {
+    flush_queue_->Add(handle);
+    return;
+  }
   TPM_RC result = TPM_RC_SUCCESS;
   result = factory_.GetTpm()->FlushContextSync(handle, nullptr);
   if (result) {
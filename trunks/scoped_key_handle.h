@@ -17,12 +17,41 @@
 #ifndef TRUNKS_SCOPED_KEY_HANDLE_H_
 #define TRUNKS_SCOPED_KEY_HANDLE_H_
 
+#include <vector>
+
 #include "trunks/tpm_generated.h"
 #include "trunks/trunks_export.h"
 #include "trunks/trunks_factory.h"
 
 namespace trunks {
 
+// This class collects handles that no longer need to be loaded and flushes
+// them together, sending one FlushContext command per handle in a single
+// transceiver round trip. Queued handles stay loaded (virtualized by the
+// resource manager) until Flush() is called, the queue reaches
+// kMaxQueuedHandles, or the queue is destroyed.
+class TRUNKS_EXPORT HandleFlushQueue {
+ public:
+  // The maximum number of handles held back before the queue flushes itself.
+  // This keeps deferred contexts well below the resource manager limits.
+  static const size_t kMaxQueuedHandles = 8;
+
+  explicit HandleFlushQueue(const TrunksFactory& factory);
+  virtual ~HandleFlushQueue();
+
+  // Queues |handle| to be flushed later.
+  virtual void Add(TPM_HANDLE handle);
+
+  // Flushes all queued handles.
+  virtual void Flush();
+
+ private:
+  const TrunksFactory& factory_;
+  std::vector<TPM_HANDLE> handles_;
+
+  DISALLOW_COPY_AND_ASSIGN(HandleFlushQueue);
+};
+
 // This class is used to wrap a Key or NV ram handle given by the TPM.
 // It provides a destructor that cleans up TPM resources associated with
 // that handle.
@@ -58,9 +87,17 @@ class TRUNKS_EXPORT ScopedKeyHandle {
   // might be stale.
   virtual TPM_HANDLE get() const;
 
+  // Defers flushing of wrapped handles to |flush_queue| instead of flushing
+  // them synchronously. |flush_queue| must outlive this object. Pass nullptr
+  // to go back to synchronous flushes.
+  void set_flush_queue(HandleFlushQueue* flush_queue) {
+    flush_queue_ = flush_queue;
+  }
+
  private:
   const TrunksFactory& factory_;
   TPM_HANDLE handle_;
+  HandleFlushQueue* flush_queue_ = nullptr;
   void FlushHandleContext(TPM_HANDLE handle);
 
   DISALLOW_COPY_AND_ASSIGN(ScopedKeyHandle);
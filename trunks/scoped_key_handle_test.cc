@@ -29,6 +29,7 @@ using testing::Invoke;
 using testing::NiceMock;
 using testing::Return;
 using testing::SetArgPointee;
+using testing::SizeIs;
 using testing::WithArgs;
 
 namespace trunks {
@@ -89,4 +90,36 @@ TEST_F(ScopedKeyHandleTest, NullReset) {
   EXPECT_EQ(0u, scoped_handle.get());
 }
 
+TEST_F(ScopedKeyHandleTest, DeferredFlush) {
+  std::string response(
+      "\x80\x01\x00\x00\x00\x0A"
+      "\x00\x00\x00\x00",
+      10);
+  HandleFlushQueue flush_queue(factory_);
+  EXPECT_CALL(mock_tpm_, FlushContextSync(_, _)).Times(0);
+  EXPECT_CALL(mock_tpm_, SendCommandsAndWait(SizeIs(2)))
+      .WillOnce(Return(std::vector<std::string>(2, response)));
+  {
+    ScopedKeyHandle first_handle(factory_, TPM_RH_FIRST);
+    first_handle.set_flush_queue(&flush_queue);
+    ScopedKeyHandle second_handle(factory_, TPM_RH_NULL);
+    second_handle.set_flush_queue(&flush_queue);
+  }
+  flush_queue.Flush();
+  // Nothing left to flush.
+  flush_queue.Flush();
+}
+
+TEST_F(ScopedKeyHandleTest, DeferredFlushBounded) {
+  HandleFlushQueue flush_queue(factory_);
+  EXPECT_CALL(mock_tpm_,
+              SendCommandsAndWait(SizeIs(HandleFlushQueue::kMaxQueuedHandles)))
+      .WillOnce(Return(std::vector<std::string>()));
+  for (size_t i = 0; i < HandleFlushQueue::kMaxQueuedHandles; ++i) {
+    ScopedKeyHandle scoped_handle(factory_, TPM_RH_FIRST + i);
+    scoped_handle.set_flush_queue(&flush_queue);
+  }
+  testing::Mock::VerifyAndClearExpectations(&mock_tpm_);
+}
+
 }  // namespace trunks
@@ -0,0 +1,209 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/secret_envelope.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include <base/logging.h>
+#include <base/stl_util.h>
+#include <openssl/aead.h>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/tpm_utility.h"
+
+namespace {
+
+// Wrapped secrets are the random nonce followed by the GCM ciphertext and tag.
+const size_t kNonceSize = 12;
+
+}  // namespace
+
+namespace trunks {
+
+const size_t SecretEnvelope::kKeySize;
+
+SecretEnvelope::SecretEnvelope(const TrunksFactory& factory)
+    : factory_(factory) {}
+
+SecretEnvelope::~SecretEnvelope() {
+  base::AutoLock lock(lock_);
+  WipeKeyLocked();
+}
+
+TPM_RC SecretEnvelope::CreateSealedKey(const std::string& policy_digest,
+                                       AuthorizationDelegate* delegate,
+                                       std::string* sealed_key) {
+  CHECK(sealed_key);
+  std::string kek(kKeySize, 0);
+  CHECK_EQ(RAND_bytes(reinterpret_cast<uint8_t*>(base::string_as_array(&kek)),
+                      kek.size()),
+           1)
+      << "Error generating a cryptographically random key.";
+  TPM_RC result = factory_.GetTpmUtility()->SealData(kek, policy_digest,
+                                                     delegate, sealed_key);
+  OPENSSL_cleanse(base::string_as_array(&kek), kek.size());
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__
+               << ": Error sealing envelope key: " << GetErrorString(result);
+    return result;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC SecretEnvelope::Unlock(const std::string& sealed_key,
+                              AuthorizationDelegate* delegate,
+                              base::TimeDelta lifetime) {
+  base::AutoLock lock(lock_);
+  WipeKeyLocked();
+  std::string kek;
+  TPM_RC result =
+      factory_.GetTpmUtility()->UnsealData(sealed_key, delegate, &kek);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__
+               << ": Error unsealing envelope key: " << GetErrorString(result);
+    return result;
+  }
+  if (kek.size() != kKeySize) {
+    LOG(ERROR) << __func__ << ": Unsealed envelope key has the wrong size.";
+    OPENSSL_cleanse(base::string_as_array(&kek), kek.size());
+    return SAPI_RC_BAD_PARAMETER;
+  }
+  kek_.reset(new uint8_t[kKeySize]);
+  if (mlock(kek_.get(), kKeySize) == 0) {
+    kek_in_locked_memory_ = true;
+  } else {
+    PLOG(WARNING) << __func__ << ": Failed to lock the envelope key in memory";
+  }
+  memcpy(kek_.get(), kek.data(), kKeySize);
+  OPENSSL_cleanse(base::string_as_array(&kek), kek.size());
+  kek_expiration_ = base::TimeTicks::Now() + lifetime;
+  return TPM_RC_SUCCESS;
+}
+
+void SecretEnvelope::Lock() {
+  base::AutoLock lock(lock_);
+  WipeKeyLocked();
+}
+
+bool SecretEnvelope::IsUnlocked() {
+  base::AutoLock lock(lock_);
+  return IsUnlockedLocked();
+}
+
+TPM_RC SecretEnvelope::WrapSecret(const std::string& label,
+                                  const std::string& secret,
+                                  std::string* wrapped_secret) {
+  CHECK(wrapped_secret);
+  base::AutoLock lock(lock_);
+  if (!IsUnlockedLocked()) {
+    return TRUNKS_RC_ENVELOPE_LOCKED;
+  }
+  const EVP_AEAD* aead = EVP_aead_aes_256_gcm();
+  EVP_AEAD_CTX context;
+  if (!EVP_AEAD_CTX_init(&context, aead, kek_.get(), kKeySize,
+                         EVP_AEAD_DEFAULT_TAG_LENGTH, nullptr)) {
+    LOG(ERROR) << __func__ << ": Error setting up AES-GCM.";
+    return TRUNKS_RC_ENCRYPTION_FAILED;
+  }
+  std::string output(kNonceSize + secret.size() + EVP_AEAD_max_overhead(aead),
+                     0);
+  uint8_t* nonce = reinterpret_cast<uint8_t*>(base::string_as_array(&output));
+  CHECK_EQ(RAND_bytes(nonce, kNonceSize), 1)
+      << "Error generating a cryptographically random nonce.";
+  size_t out_length = 0;
+  bool success = EVP_AEAD_CTX_seal(
+      &context, nonce + kNonceSize, &out_length, output.size() - kNonceSize,
+      nonce, kNonceSize, reinterpret_cast<const uint8_t*>(secret.data()),
+      secret.size(), reinterpret_cast<const uint8_t*>(label.data()),
+      label.size());
+  EVP_AEAD_CTX_cleanup(&context);
+  if (!success) {
+    LOG(ERROR) << __func__ << ": Error wrapping secret.";
+    return TRUNKS_RC_ENCRYPTION_FAILED;
+  }
+  output.resize(kNonceSize + out_length);
+  wrapped_secret->swap(output);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC SecretEnvelope::UnwrapSecret(const std::string& label,
+                                    const std::string& wrapped_secret,
+                                    std::string* secret) {
+  CHECK(secret);
+  base::AutoLock lock(lock_);
+  if (!IsUnlockedLocked()) {
+    return TRUNKS_RC_ENVELOPE_LOCKED;
+  }
+  const EVP_AEAD* aead = EVP_aead_aes_256_gcm();
+  if (wrapped_secret.size() < kNonceSize + EVP_AEAD_max_overhead(aead)) {
+    LOG(ERROR) << __func__ << ": Wrapped secret is too short.";
+    return TRUNKS_RC_ENCRYPTION_FAILED;
+  }
+  EVP_AEAD_CTX context;
+  if (!EVP_AEAD_CTX_init(&context, aead, kek_.get(), kKeySize,
+                         EVP_AEAD_DEFAULT_TAG_LENGTH, nullptr)) {
+    LOG(ERROR) << __func__ << ": Error setting up AES-GCM.";
+    return TRUNKS_RC_ENCRYPTION_FAILED;
+  }
+  const uint8_t* nonce =
+      reinterpret_cast<const uint8_t*>(wrapped_secret.data());
+  std::string output(wrapped_secret.size() - kNonceSize, 0);
+  size_t out_length = 0;
+  bool success = EVP_AEAD_CTX_open(
+      &context, reinterpret_cast<uint8_t*>(base::string_as_array(&output)),
+      &out_length, output.size(), nonce, kNonceSize, nonce + kNonceSize,
+      wrapped_secret.size() - kNonceSize,
+      reinterpret_cast<const uint8_t*>(label.data()), label.size());
+  EVP_AEAD_CTX_cleanup(&context);
+  if (!success) {
+    LOG(ERROR) << __func__ << ": Wrapped secret failed authentication.";
+    return TRUNKS_RC_ENCRYPTION_FAILED;
+  }
+  output.resize(out_length);
+  secret->swap(output);
+  OPENSSL_cleanse(base::string_as_array(&output), output.size());
+  return TPM_RC_SUCCESS;
+}
+
+bool SecretEnvelope::IsUnlockedLocked() {
+  if (!kek_) {
+    return false;
+  }
+  if (base::TimeTicks::Now() >= kek_expiration_) {
+    WipeKeyLocked();
+    return false;
+  }
+  return true;
+}
+
+void SecretEnvelope::WipeKeyLocked() {
+  if (!kek_) {
+    return;
+  }
+  OPENSSL_cleanse(kek_.get(), kKeySize);
+  if (kek_in_locked_memory_) {
+    munlock(kek_.get(), kKeySize);
+    kek_in_locked_memory_ = false;
+  }
+  kek_.reset();
+}
+
+}  // namespace trunks
@@ -0,0 +1,111 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef TRUNKS_SECRET_ENVELOPE_H_
+#define TRUNKS_SECRET_ENVELOPE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include <base/macros.h>
+#include <base/synchronization/lock.h>
+#include <base/time/time.h>
+
+#include "trunks/authorization_delegate.h"
+#include "trunks/tpm_generated.h"
+#include "trunks/trunks_export.h"
+#include "trunks/trunks_factory.h"
+
+namespace trunks {
+
+// SecretEnvelope protects many small secrets under one TPM policy with a
+// single TPM operation. A random AES-256 key-encryption key (KEK) is sealed to
+// the TPM once with CreateSealedKey(). Unlock() unseals it with one
+// TpmUtility::UnsealData call and keeps it in locked memory for a bounded
+// lifetime. While it is unlocked, WrapSecret() and UnwrapSecret() protect
+// individual secrets with AES-256-GCM in software, without using the TPM.
+// This class is thread-safe.
+class TRUNKS_EXPORT SecretEnvelope {
+ public:
+  // The size of the KEK in bytes.
+  static const size_t kKeySize = 32;
+
+  // The |factory| must outlive this object.
+  explicit SecretEnvelope(const TrunksFactory& factory);
+  ~SecretEnvelope();
+
+  // Generates a fresh KEK and seals it to the TPM so that it can only be
+  // unsealed by satisfying |policy_digest|. |delegate| authorizes the use of
+  // the storage root key. On success |sealed_key| holds the blob to pass to
+  // Unlock(). The new KEK is not kept unlocked.
+  TPM_RC CreateSealedKey(const std::string& policy_digest,
+                         AuthorizationDelegate* delegate,
+                         std::string* sealed_key);
+
+  // Unseals |sealed_key| with |delegate|, which must satisfy the policy the
+  // KEK was sealed with. The KEK is then kept for |lifetime|. Any KEK that was
+  // already unlocked is wiped first, even if this call fails.
+  TPM_RC Unlock(const std::string& sealed_key,
+                AuthorizationDelegate* delegate,
+                base::TimeDelta lifetime);
+
+  // Wipes the KEK. WrapSecret() and UnwrapSecret() fail until the next
+  // Unlock().
+  void Lock();
+
+  // Returns true if a KEK is unlocked and its lifetime has not run out.
+  bool IsUnlocked();
+
+  // Encrypts and authenticates |secret| with the unlocked KEK. |label| is
+  // authenticated but not encrypted. Use it to bind a wrapped secret to its
+  // purpose, so that one wrapped secret cannot be swapped for another.
+  // Returns TRUNKS_RC_ENVELOPE_LOCKED if no KEK is unlocked.
+  TPM_RC WrapSecret(const std::string& label,
+                    const std::string& secret,
+                    std::string* wrapped_secret);
+
+  // Recovers a secret wrapped by WrapSecret() under the same KEK and |label|.
+  // Returns TRUNKS_RC_ENVELOPE_LOCKED if no KEK is unlocked, and
+  // TRUNKS_RC_ENCRYPTION_FAILED if |wrapped_secret| fails authentication.
+  TPM_RC UnwrapSecret(const std::string& label,
+                      const std::string& wrapped_secret,
+                      std::string* secret);
+
+ private:
+  // Returns true if |kek_| is set and has not expired. An expired KEK is
+  // wiped.
+  bool IsUnlockedLocked();
+  // Wipes, unlocks from memory and drops |kek_|.
+  void WipeKeyLocked();
+
+  const TrunksFactory& factory_;
+  base::Lock lock_;
+  // The unlocked KEK, or null. It has its own allocation, which is mlock()ed
+  // so that the key is never written to swap.
+  std::unique_ptr<uint8_t[]> kek_;
+  bool kek_in_locked_memory_ = false;
+  base::TimeTicks kek_expiration_;
+
+  DISALLOW_COPY_AND_ASSIGN(SecretEnvelope);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_SECRET_ENVELOPE_H_
@@ -0,0 +1,156 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/secret_envelope.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/mock_authorization_delegate.h"
+#include "trunks/mock_tpm_utility.h"
+#include "trunks/trunks_factory_for_test.h"
+
+using testing::_;
+using testing::DoAll;
+using testing::NiceMock;
+using testing::Return;
+using testing::SaveArg;
+using testing::SetArgPointee;
+
+namespace trunks {
+
+class SecretEnvelopeTest : public testing::Test {
+ public:
+  SecretEnvelopeTest() : envelope_(factory_) {}
+  ~SecretEnvelopeTest() override {}
+
+  void SetUp() override { factory_.set_tpm_utility(&mock_tpm_utility_); }
+
+ protected:
+  // Seals a fresh KEK and unlocks it for |lifetime|.
+  void CreateAndUnlock(base::TimeDelta lifetime) {
+    std::string kek;
+    EXPECT_CALL(mock_tpm_utility_, SealData(_, "policy", &mock_delegate_, _))
+        .WillOnce(DoAll(SaveArg<0>(&kek), SetArgPointee<3>("sealed"),
+                        Return(TPM_RC_SUCCESS)));
+    std::string sealed_key;
+    ASSERT_EQ(TPM_RC_SUCCESS, envelope_.CreateSealedKey(
+                                  "policy", &mock_delegate_, &sealed_key));
+    EXPECT_EQ("sealed", sealed_key);
+    EXPECT_EQ(SecretEnvelope::kKeySize, kek.size());
+    EXPECT_CALL(mock_tpm_utility_, UnsealData("sealed", &mock_delegate_, _))
+        .WillOnce(DoAll(SetArgPointee<2>(kek), Return(TPM_RC_SUCCESS)));
+    ASSERT_EQ(TPM_RC_SUCCESS,
+              envelope_.Unlock(sealed_key, &mock_delegate_, lifetime));
+  }
+
+  TrunksFactoryForTest factory_;
+  NiceMock<MockTpmUtility> mock_tpm_utility_;
+  NiceMock<MockAuthorizationDelegate> mock_delegate_;
+  SecretEnvelope envelope_;
+};
+
+TEST_F(SecretEnvelopeTest, WrapUnwrapRoundTrip) {
+  CreateAndUnlock(base::TimeDelta::FromHours(1));
+  EXPECT_TRUE(envelope_.IsUnlocked());
+  std::string wrapped_secret;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            envelope_.WrapSecret("label", "secret", &wrapped_secret));
+  EXPECT_EQ(std::string::npos, wrapped_secret.find("secret"));
+  std::string other_wrapped_secret;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            envelope_.WrapSecret("label", "secret", &other_wrapped_secret));
+  EXPECT_NE(wrapped_secret, other_wrapped_secret);
+  std::string secret;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            envelope_.UnwrapSecret("label", wrapped_secret, &secret));
+  EXPECT_EQ("secret", secret);
+}
+
+TEST_F(SecretEnvelopeTest, UnwrapWrongLabel) {
+  CreateAndUnlock(base::TimeDelta::FromHours(1));
+  std::string wrapped_secret;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            envelope_.WrapSecret("label", "secret", &wrapped_secret));
+  std::string secret;
+  EXPECT_EQ(TRUNKS_RC_ENCRYPTION_FAILED,
+            envelope_.UnwrapSecret("other", wrapped_secret, &secret));
+}
+
+TEST_F(SecretEnvelopeTest, UnwrapTampered) {
+  CreateAndUnlock(base::TimeDelta::FromHours(1));
+  std::string wrapped_secret;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            envelope_.WrapSecret("label", "secret", &wrapped_secret));
+  wrapped_secret[wrapped_secret.size() / 2] ^= 1;
+  std::string secret;
+  EXPECT_EQ(TRUNKS_RC_ENCRYPTION_FAILED,
+            envelope_.UnwrapSecret("label", wrapped_secret, &secret));
+  EXPECT_EQ(TRUNKS_RC_ENCRYPTION_FAILED,
+            envelope_.UnwrapSecret("label", "short", &secret));
+}
+
+TEST_F(SecretEnvelopeTest, WrapWhileLocked) {
+  std::string wrapped_secret;
+  EXPECT_FALSE(envelope_.IsUnlocked());
+  EXPECT_EQ(TRUNKS_RC_ENVELOPE_LOCKED,
+            envelope_.WrapSecret("label", "secret", &wrapped_secret));
+  CreateAndUnlock(base::TimeDelta::FromHours(1));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            envelope_.WrapSecret("label", "secret", &wrapped_secret));
+  envelope_.Lock();
+  EXPECT_FALSE(envelope_.IsUnlocked());
+  std::string secret;
+  EXPECT_EQ(TRUNKS_RC_ENVELOPE_LOCKED,
+            envelope_.UnwrapSecret("label", wrapped_secret, &secret));
+}
+
+TEST_F(SecretEnvelopeTest, KeyExpires) {
+  CreateAndUnlock(base::TimeDelta());
+  EXPECT_FALSE(envelope_.IsUnlocked());
+  std::string wrapped_secret;
+  EXPECT_EQ(TRUNKS_RC_ENVELOPE_LOCKED,
+            envelope_.WrapSecret("label", "secret", &wrapped_secret));
+}
+
+TEST_F(SecretEnvelopeTest, CreateSealedKeyFails) {
+  EXPECT_CALL(mock_tpm_utility_, SealData(_, _, _, _))
+      .WillOnce(Return(TPM_RC_FAILURE));
+  std::string sealed_key;
+  EXPECT_EQ(TPM_RC_FAILURE,
+            envelope_.CreateSealedKey("policy", &mock_delegate_, &sealed_key));
+}
+
+TEST_F(SecretEnvelopeTest, UnlockFails) {
+  EXPECT_CALL(mock_tpm_utility_, UnsealData(_, _, _))
+      .WillOnce(Return(TPM_RC_POLICY_FAIL));
+  EXPECT_EQ(TPM_RC_POLICY_FAIL,
+            envelope_.Unlock("sealed", &mock_delegate_,
+                             base::TimeDelta::FromHours(1)));
+  EXPECT_FALSE(envelope_.IsUnlocked());
+}
+
+TEST_F(SecretEnvelopeTest, UnlockBadKeySize) {
+  EXPECT_CALL(mock_tpm_utility_, UnsealData(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>("short"), Return(TPM_RC_SUCCESS)));
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER,
+            envelope_.Unlock("sealed", &mock_delegate_,
+                             base::TimeDelta::FromHours(1)));
+  EXPECT_FALSE(envelope_.IsUnlocked());
+}
+
+}  // namespace trunks
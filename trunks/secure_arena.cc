@@ -0,0 +1,240 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/secure_arena.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include <utility>
+
+#include <base/lazy_instance.h>
+#include <base/logging.h>
+#include <base/stl_util.h>
+#include <crypto/secure_util.h>
+#include <openssl/crypto.h>
+
+namespace {
+
+base::LazyInstance<trunks::SecureArena>::Leaky g_arena =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+namespace trunks {
+
+// Sized for session keys and authorization values, HMAC keys combining both,
+// and serialized key material.
+const size_t SecureArena::kSizeClasses[] = {32, 64, 256, 1024};
+const size_t SecureArena::kNumSizeClasses = arraysize(kSizeClasses);
+
+SecureArena::SecureArena(size_t bytes_per_class)
+    : bytes_per_class_(bytes_per_class), free_slots_(kNumSizeClasses) {
+  region_size_ = bytes_per_class_ * kNumSizeClasses;
+  void* region = mmap(nullptr, region_size_, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED) {
+    PLOG(ERROR) << "Failed to map secure memory; using the heap.";
+    region_size_ = 0;
+    return;
+  }
+  region_ = static_cast<char*>(region);
+  if (mlock(region_, region_size_) == 0) {
+    is_locked_ = true;
+  } else {
+    PLOG(WARNING) << "Failed to lock secure memory; it may be swapped out";
+  }
+#if defined(MADV_DONTDUMP)
+  madvise(region_, region_size_, MADV_DONTDUMP);
+#endif
+  for (size_t i = 0; i < kNumSizeClasses; ++i) {
+    uint32_t num_slots = bytes_per_class_ / kSizeClasses[i];
+    free_slots_[i].reserve(num_slots);
+    // Hand out the lowest slots first.
+    for (uint32_t slot = num_slots; slot > 0; --slot) {
+      free_slots_[i].push_back(slot - 1);
+    }
+  }
+}
+
+SecureArena::~SecureArena() {
+  if (region_) {
+    OPENSSL_cleanse(region_, region_size_);
+    munmap(region_, region_size_);
+  }
+}
+
+// static
+SecureArena* SecureArena::GetInstance() {
+  return g_arena.Pointer();
+}
+
+char* SecureArena::Allocate(size_t size, size_t* capacity) {
+  DCHECK_GT(size, 0u);
+  size_t size_class = GetSizeClass(size);
+  {
+    base::AutoLock lock(lock_);
+    if (size_class < kNumSizeClasses && !free_slots_[size_class].empty()) {
+      uint32_t slot = free_slots_[size_class].back();
+      free_slots_[size_class].pop_back();
+      ++used_slots_;
+      *capacity = kSizeClasses[size_class];
+      return region_ + size_class * bytes_per_class_ +
+             slot * kSizeClasses[size_class];
+    }
+    ++heap_fallbacks_;
+  }
+  *capacity = size;
+  return new char[size];
+}
+
+void SecureArena::Free(char* block, size_t capacity) {
+  if (!block) {
+    return;
+  }
+  OPENSSL_cleanse(block, capacity);
+  if (block < region_ || block >= region_ + region_size_) {
+    delete[] block;
+    return;
+  }
+  size_t size_class = (block - region_) / bytes_per_class_;
+  DCHECK_EQ(kSizeClasses[size_class], capacity);
+  uint32_t slot =
+      (block - region_ - size_class * bytes_per_class_) / capacity;
+  base::AutoLock lock(lock_);
+  free_slots_[size_class].push_back(slot);
+  --used_slots_;
+}
+
+size_t SecureArena::used_slots() const {
+  base::AutoLock lock(lock_);
+  return used_slots_;
+}
+
+uint64_t SecureArena::heap_fallbacks() const {
+  base::AutoLock lock(lock_);
+  return heap_fallbacks_;
+}
+
+// static
+size_t SecureArena::GetSizeClass(size_t size) {
+  for (size_t i = 0; i < kNumSizeClasses; ++i) {
+    if (size <= kSizeClasses[i]) {
+      return i;
+    }
+  }
+  return kNumSizeClasses;
+}
+
+SecureString::SecureString() {}
+
+SecureString::SecureString(const char* data, size_t size) {
+  assign(data, size);
+}
+
+SecureString::SecureString(const std::string& value) {
+  assign(value);
+}
+
+SecureString::SecureString(SecureString&& other)
+    : data_(other.data_), size_(other.size_), capacity_(other.capacity_) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+  other.capacity_ = 0;
+}
+
+SecureString& SecureString::operator=(SecureString&& other) {
+  if (this != &other) {
+    Release();
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+  }
+  return *this;
+}
+
+SecureString::~SecureString() {
+  Release();
+}
+
+// static
+SecureString SecureString::TakeString(std::string* value) {
+  SecureString secure_value(*value);
+  OPENSSL_cleanse(base::string_as_array(value), value->size());
+  value->clear();
+  return secure_value;
+}
+
+void SecureString::assign(const char* data, size_t size) {
+  clear();
+  append(data, size);
+}
+
+void SecureString::append(const char* data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  Reserve(size_ + size);
+  memcpy(data_ + size_, data, size);
+  size_ += size;
+}
+
+void SecureString::clear() {
+  if (data_) {
+    OPENSSL_cleanse(data_, size_);
+  }
+  size_ = 0;
+}
+
+bool SecureString::Equals(const std::string& value) const {
+  return size_ == value.size() &&
+         crypto::SecureMemEqual(data(), value.data(), size_);
+}
+
+SecureString SecureString::Clone() const {
+  return SecureString(data(), size_);
+}
+
+std::string SecureString::ToString() const {
+  return std::string(data(), size_);
+}
+
+void SecureString::Reserve(size_t capacity) {
+  if (capacity <= capacity_) {
+    return;
+  }
+  size_t new_capacity = 0;
+  char* new_data =
+      SecureArena::GetInstance()->Allocate(capacity, &new_capacity);
+  if (size_) {
+    memcpy(new_data, data_, size_);
+  }
+  size_t size = size_;
+  Release();
+  data_ = new_data;
+  size_ = size;
+  capacity_ = new_capacity;
+}
+
+void SecureString::Release() {
+  SecureArena::GetInstance()->Free(data_, capacity_);
+  data_ = nullptr;
+  size_ = 0;
+  capacity_ = 0;
+}
+
+}  // namespace trunks
@@ -0,0 +1,150 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef TRUNKS_SECURE_ARENA_H_
+#define TRUNKS_SECURE_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <base/macros.h>
+#include <base/synchronization/lock.h>
+
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+// SecureArena hands out small blocks of memory for secrets from a region that
+// is mapped and mlock()ed once, so secrets are never written to swap or core
+// dumps and holding one does not cost a heap allocation. Blocks come in a few
+// size classes, each with a fixed number of slots. Requests that are larger
+// than the largest class, or find their class full, fall back to the heap.
+// Every block is wiped when it is freed. This class is thread-safe.
+class TRUNKS_EXPORT SecureArena {
+ public:
+  // The block sizes handed out, smallest first.
+  static const size_t kSizeClasses[];
+  static const size_t kNumSizeClasses;
+  // The default reservation for each size class: 64 KiB of locked memory in
+  // total, which is within the default RLIMIT_MEMLOCK.
+  static const size_t kDefaultBytesPerClass = 16 * 1024;
+
+  // Reserves |bytes_per_class| bytes for each size class.
+  explicit SecureArena(size_t bytes_per_class = kDefaultBytesPerClass);
+  ~SecureArena();
+
+  // Returns the arena used by SecureString. It is never destroyed.
+  static SecureArena* GetInstance();
+
+  // Returns a block of at least |size| bytes and sets |capacity| to its actual
+  // size. |size| must not be zero.
+  char* Allocate(size_t size, size_t* capacity);
+
+  // Wipes and frees a block returned by Allocate() with |capacity|.
+  void Free(char* block, size_t capacity);
+
+  // Returns true if the region is locked in memory. If mlock() fails, e.g.
+  // because of RLIMIT_MEMLOCK, the region is still used.
+  bool is_locked() const { return is_locked_; }
+
+  // The number of arena slots in use and of blocks which had to come from the
+  // heap instead, since the arena was created.
+  size_t used_slots() const;
+  uint64_t heap_fallbacks() const;
+
+ private:
+  // Returns the size class of blocks up to |size| bytes, or kNumSizeClasses.
+  static size_t GetSizeClass(size_t size);
+
+  size_t bytes_per_class_;
+  char* region_ = nullptr;
+  size_t region_size_ = 0;
+  bool is_locked_ = false;
+  mutable base::Lock lock_;
+  // The free slot indices of each size class. Reserved up front so freeing a
+  // block never allocates.
+  std::vector<std::vector<uint32_t>> free_slots_;
+  size_t used_slots_ = 0;
+  uint64_t heap_fallbacks_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(SecureArena);
+};
+
+// SecureString holds a secret, like an authorization value or a session key,
+// in SecureArena memory. It cannot be copied, only moved or explicitly
+// Clone()d, and its memory is wiped whenever it is released. Storage is kept
+// on assignment if it is large enough, so reusing a SecureString does not
+// allocate.
+//
+// Example:
+//   SecureString password = SecureString::TakeString(&proto_field);
+//   hmac.SetKey(password);
+class TRUNKS_EXPORT SecureString {
+ public:
+  SecureString();
+  SecureString(const char* data, size_t size);
+  explicit SecureString(const std::string& value);
+  SecureString(SecureString&& other);
+  SecureString& operator=(SecureString&& other);
+  ~SecureString();
+
+  // Copies |*value| and wipes it.
+  static SecureString TakeString(std::string* value);
+
+  // Never null, so an empty value can still be used as a key.
+  const char* data() const { return data_ ? data_ : ""; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  void assign(const char* data, size_t size);
+  void assign(const std::string& value) { assign(value.data(), value.size()); }
+  void append(const char* data, size_t size);
+  void append(const std::string& value) { append(value.data(), value.size()); }
+  void append(const SecureString& value) {
+    append(value.data(), value.size());
+  }
+  // Wipes the value. The storage is kept for reuse.
+  void clear();
+
+  // Returns true if the values are equal, in time independent of the content.
+  bool Equals(const std::string& value) const;
+
+  SecureString Clone() const;
+
+  // Returns an ordinary copy for interfaces which need a std::string. The
+  // caller is responsible for wiping it.
+  std::string ToString() const;
+
+ private:
+  // Grows the storage to at least |capacity| bytes, keeping the value.
+  void Reserve(size_t capacity);
+  // Wipes and frees the storage.
+  void Release();
+
+  char* data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(SecureString);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_SECURE_ARENA_H_
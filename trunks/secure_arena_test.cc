@@ -0,0 +1,114 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/secure_arena.h"
+
+#include <string.h>
+
+#include <utility>
+
+#include <gtest/gtest.h>
+
+namespace trunks {
+
+TEST(SecureArenaTest, AllocatesFromSizeClasses) {
+  SecureArena arena(1024);
+  size_t capacity = 0;
+  char* block = arena.Allocate(20, &capacity);
+  ASSERT_NE(nullptr, block);
+  EXPECT_EQ(SecureArena::kSizeClasses[0], capacity);
+  EXPECT_EQ(1u, arena.used_slots());
+  char* larger_block = arena.Allocate(100, &capacity);
+  EXPECT_EQ(SecureArena::kSizeClasses[2], capacity);
+  EXPECT_EQ(2u, arena.used_slots());
+  arena.Free(larger_block, capacity);
+  arena.Free(block, SecureArena::kSizeClasses[0]);
+  EXPECT_EQ(0u, arena.used_slots());
+  EXPECT_EQ(0u, arena.heap_fallbacks());
+}
+
+TEST(SecureArenaTest, ReusesFreedSlots) {
+  SecureArena arena(1024);
+  size_t capacity = 0;
+  char* block = arena.Allocate(32, &capacity);
+  memset(block, 0xAA, capacity);
+  arena.Free(block, capacity);
+  char* reused_block = arena.Allocate(32, &capacity);
+  EXPECT_EQ(block, reused_block);
+  // Freed blocks are wiped.
+  for (size_t i = 0; i < capacity; ++i) {
+    EXPECT_EQ(0, reused_block[i]);
+  }
+  arena.Free(reused_block, capacity);
+}
+
+TEST(SecureArenaTest, FallsBackToHeap) {
+  const size_t kLargestClass =
+      SecureArena::kSizeClasses[SecureArena::kNumSizeClasses - 1];
+  // One slot of the largest class.
+  SecureArena arena(kLargestClass);
+  size_t capacity = 0;
+  size_t too_large = kLargestClass + 1;
+  char* block = arena.Allocate(too_large, &capacity);
+  EXPECT_EQ(too_large, capacity);
+  EXPECT_EQ(1u, arena.heap_fallbacks());
+  arena.Free(block, capacity);
+  size_t slot_capacity = 0;
+  char* slot_block = arena.Allocate(1000, &slot_capacity);
+  EXPECT_EQ(1u, arena.used_slots());
+  // The class is full now.
+  char* full_block = arena.Allocate(1000, &capacity);
+  EXPECT_EQ(1000u, capacity);
+  EXPECT_EQ(2u, arena.heap_fallbacks());
+  arena.Free(full_block, capacity);
+  arena.Free(slot_block, slot_capacity);
+  EXPECT_EQ(0u, arena.used_slots());
+}
+
+TEST(SecureStringTest, AssignAndAppend) {
+  SecureString value;
+  EXPECT_TRUE(value.empty());
+  EXPECT_NE(nullptr, value.data());
+  value.assign("session");
+  value.append(std::string("_key"));
+  EXPECT_EQ(11u, value.size());
+  EXPECT_TRUE(value.Equals("session_key"));
+  EXPECT_FALSE(value.Equals("session_kez"));
+  EXPECT_EQ("session_key", value.ToString());
+  value.clear();
+  EXPECT_TRUE(value.empty());
+}
+
+TEST(SecureStringTest, MovesWithoutCopying) {
+  SecureString value(std::string("password"));
+  const char* data = value.data();
+  SecureString moved(std::move(value));
+  EXPECT_EQ(data, moved.data());
+  EXPECT_TRUE(value.empty());
+  SecureString clone = moved.Clone();
+  EXPECT_NE(moved.data(), clone.data());
+  EXPECT_TRUE(clone.Equals("password"));
+}
+
+TEST(SecureStringTest, TakeStringWipesSource) {
+  std::string password("owner_password");
+  SecureString value = SecureString::TakeString(&password);
+  EXPECT_TRUE(password.empty());
+  EXPECT_TRUE(value.Equals("owner_password"));
+}
+
+}  // namespace trunks
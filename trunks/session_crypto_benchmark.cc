@@ -0,0 +1,369 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Measures the client-side cost of HMAC sessions: command and response
+// authorization, parameter encryption and salt encryption. No TPM is needed.
+//
+// With --baseline=<file>, each result is compared with the ns/op recorded for
+// it in <file>, as printed by an earlier run, and the run fails if any is more
+// than --tolerance percent (default 20) slower.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <base/command_line.h>
+#include <base/files/file_util.h>
+#include <base/logging.h>
+#include <base/macros.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/strings/stringprintf.h>
+#include <base/time/time.h>
+#include <openssl/hmac.h>
+#include <openssl/sha.h>
+
+#include "trunks/command_transceiver.h"
+#include "trunks/hmac_authorization_delegate.h"
+#include "trunks/session_manager_impl.h"
+#include "trunks/tpm_generated.h"
+
+namespace {
+
+// Counts allocations so each benchmark can report allocations per call.
+size_t g_allocation_count = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+  ++g_allocation_count;
+  void* result = malloc(size);
+  if (!result) {
+    abort();
+  }
+  return result;
+}
+
+void operator delete(void* pointer) noexcept {
+  free(pointer);
+}
+
+namespace trunks {
+namespace {
+
+const int kIterations = 1000;
+const char kEntityAuthorization[] = "entity_auth";
+const TPMA_SESSION kContinueSession = 1;
+// Parameter sizes typical of authorization values, sealed secrets and large
+// NV writes.
+const size_t kParameterSizes[] = {32, 256, 1024};
+
+// Times kIterations runs of the body of a while (benchmark.Loop()) loop. One
+// untimed run comes first so buffers reused across runs are already allocated.
+class Benchmark {
+ public:
+  explicit Benchmark(const std::string& name) : name_(name) {}
+
+  bool Loop() {
+    if (iteration_ == 1) {
+      start_allocations_ = g_allocation_count;
+      start_ = base::TimeTicks::Now();
+    } else if (iteration_ > kIterations) {
+      elapsed_ = base::TimeTicks::Now() - start_;
+      allocations_ = g_allocation_count - start_allocations_;
+      return false;
+    }
+    ++iteration_;
+    return true;
+  }
+
+  // Prints the results. Returns false if the last run failed.
+  bool Report(bool success) {
+    if (!success) {
+      printf("%-48s FAILED\n", name_.c_str());
+      return false;
+    }
+    printf("%-48s %10.1f ns/op %8.2f allocs/op\n", name_.c_str(),
+           GetNanosecondsPerOp(),
+           static_cast<double>(allocations_) / kIterations);
+    return true;
+  }
+
+  const std::string& name() const { return name_; }
+  double GetNanosecondsPerOp() const {
+    return elapsed_.InMicrosecondsF() * 1000 / kIterations;
+  }
+
+ private:
+  const std::string name_;
+  int iteration_ = 0;
+  size_t start_allocations_ = 0;
+  size_t allocations_ = 0;
+  base::TimeTicks start_;
+  base::TimeDelta elapsed_;
+
+  DISALLOW_COPY_AND_ASSIGN(Benchmark);
+};
+
+// The ns/op of every reported benchmark, by name.
+std::map<std::string, double> g_results;
+
+bool Report(Benchmark* benchmark, bool success) {
+  if (success) {
+    g_results[benchmark->name()] = benchmark->GetNanosecondsPerOp();
+  }
+  return benchmark->Report(success);
+}
+
+TPM2B_NONCE MakeNonce(char value) {
+  return Make_TPM2B_DIGEST(std::string(kAesKeySize, value));
+}
+
+// Starts an unsalted, unbound session, whose session key is empty, with
+// parameter encryption enabled.
+bool InitDelegate(HmacAuthorizationDelegate* delegate) {
+  if (!delegate->InitSession(HMAC_SESSION_FIRST, MakeNonce('t'),
+                             MakeNonce('c'), "", "", true)) {
+    return false;
+  }
+  delegate->set_entity_authorization_value(kEntityAuthorization);
+  return true;
+}
+
+bool Benchmark_GetCommandAuthorization() {
+  HmacAuthorizationDelegate delegate;
+  bool success = InitDelegate(&delegate);
+  std::string command_hash(kHashDigestSize, 'h');
+  std::string authorization;
+  Benchmark benchmark("GetCommandAuthorization");
+  while (benchmark.Loop()) {
+    success = delegate.GetCommandAuthorization(command_hash, true, true,
+                                               &authorization) &&
+              success;
+  }
+  return Report(&benchmark, success);
+}
+
+bool Benchmark_CheckResponseAuthorization() {
+  HmacAuthorizationDelegate delegate;
+  bool success = InitDelegate(&delegate);
+  // The session key is empty so the response HMAC is keyed with the entity
+  // authorization value alone.
+  std::string response_hash(kHashDigestSize, 'r');
+  TPM2B_NONCE tpm_nonce = MakeNonce('T');
+  TPM2B_NONCE caller_nonce = MakeNonce('c');
+  std::string attributes;
+  Serialize_TPMA_SESSION(kContinueSession, &attributes);
+  std::string hmac_input = response_hash;
+  hmac_input.append(tpm_nonce.buffer, tpm_nonce.buffer + tpm_nonce.size);
+  hmac_input.append(caller_nonce.buffer,
+                    caller_nonce.buffer + caller_nonce.size);
+  hmac_input += attributes;
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_length = 0;
+  HMAC(EVP_sha256(), kEntityAuthorization, strlen(kEntityAuthorization),
+       reinterpret_cast<const unsigned char*>(hmac_input.data()),
+       hmac_input.size(), digest, &digest_length);
+  TPMS_AUTH_RESPONSE auth_response;
+  auth_response.nonce = tpm_nonce;
+  auth_response.session_attributes = kContinueSession;
+  auth_response.hmac = Make_TPM2B_DIGEST(
+      std::string(reinterpret_cast<char*>(digest), digest_length));
+  std::string authorization;
+  Serialize_TPMS_AUTH_RESPONSE(auth_response, &authorization);
+  Benchmark benchmark("CheckResponseAuthorization");
+  while (benchmark.Loop()) {
+    success =
+        delegate.CheckResponseAuthorization(response_hash, authorization) &&
+        success;
+  }
+  return Report(&benchmark, success);
+}
+
+bool Benchmark_ParameterEncryption() {
+  bool success = true;
+  for (size_t size : kParameterSizes) {
+    HmacAuthorizationDelegate delegate;
+    bool result = InitDelegate(&delegate);
+    std::string parameter(size, 'p');
+    Benchmark encrypt(
+        base::StringPrintf("EncryptCommandParameter/%zu", size));
+    while (encrypt.Loop()) {
+      result = delegate.EncryptCommandParameter(&parameter) && result;
+    }
+    success = Report(&encrypt, result) && success;
+    Benchmark decrypt(
+        base::StringPrintf("DecryptResponseParameter/%zu", size));
+    while (decrypt.Loop()) {
+      result = delegate.DecryptResponseParameter(&parameter) && result;
+    }
+    success = Report(&decrypt, result) && success;
+  }
+  return success;
+}
+
+// Returns an RSA-2048 salting key public area. Public-key operations do not
+// depend on the modulus being a product of primes, so a fixed odd value
+// stands in for a real key.
+TPMT_PUBLIC GetRSASaltingKey() {
+  std::string modulus(256, '\x5a');
+  modulus[0] = '\xc3';
+  modulus[255] = '\x01';
+  TPMT_PUBLIC public_area = {};
+  public_area.type = TPM_ALG_RSA;
+  public_area.name_alg = TPM_ALG_SHA256;
+  public_area.parameters.rsa_detail.symmetric.algorithm = TPM_ALG_NULL;
+  public_area.parameters.rsa_detail.scheme.scheme = TPM_ALG_NULL;
+  public_area.parameters.rsa_detail.key_bits = 2048;
+  public_area.unique.rsa = Make_TPM2B_PUBLIC_KEY_RSA(modulus);
+  return public_area;
+}
+
+// Returns an ECC NIST P-256 salting key public area. The base point of the
+// curve is a valid public key.
+TPMT_PUBLIC GetECCSaltingKey() {
+  std::vector<uint8_t> x;
+  std::vector<uint8_t> y;
+  CHECK(base::HexStringToBytes(
+      "6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296", &x));
+  CHECK(base::HexStringToBytes(
+      "4FE342E2FE1A7F9B8EE7EB4A7C0F9E162BCE33576B315ECECBB6406837BF51F5", &y));
+  TPMT_PUBLIC public_area = {};
+  public_area.type = TPM_ALG_ECC;
+  public_area.name_alg = TPM_ALG_SHA256;
+  public_area.parameters.ecc_detail.symmetric.algorithm = TPM_ALG_NULL;
+  public_area.parameters.ecc_detail.scheme.scheme = TPM_ALG_NULL;
+  public_area.parameters.ecc_detail.curve_id = TPM_ECC_NIST_P256;
+  public_area.parameters.ecc_detail.kdf.scheme = TPM_ALG_NULL;
+  public_area.unique.ecc.x =
+      Make_TPM2B_ECC_PARAMETER(std::string(x.begin(), x.end()));
+  public_area.unique.ecc.y =
+      Make_TPM2B_ECC_PARAMETER(std::string(y.begin(), y.end()));
+  return public_area;
+}
+
+// Answers ReadPublic with |public_area| so SaltingKeyCache can load the
+// salting key.
+class SaltingKeyTransceiver : public CommandTransceiver {
+ public:
+  explicit SaltingKeyTransceiver(const TPMT_PUBLIC& public_area)
+      : public_area_(public_area) {}
+  ~SaltingKeyTransceiver() override {}
+
+  void SendCommand(const std::string& command,
+                   const ResponseCallback& callback) override {
+    callback.Run(SendCommandAndWait(command));
+  }
+
+  std::string SendCommandAndWait(const std::string& command) override {
+    std::string parameters;
+    Serialize_TPM2B_PUBLIC(Make_TPM2B_PUBLIC(public_area_), &parameters);
+    Serialize_TPM2B_NAME(Make_TPM2B_NAME(""), &parameters);
+    Serialize_TPM2B_NAME(Make_TPM2B_NAME(""), &parameters);
+    std::string response;
+    Serialize_TPM_ST(TPM_ST_NO_SESSIONS, &response);
+    Serialize_UINT32(10 + parameters.size(), &response);
+    Serialize_TPM_RC(TPM_RC_SUCCESS, &response);
+    return response + parameters;
+  }
+
+ private:
+  const TPMT_PUBLIC public_area_;
+
+  DISALLOW_COPY_AND_ASSIGN(SaltingKeyTransceiver);
+};
+
+bool Benchmark_EncryptSalt(const std::string& name,
+                           const TPMT_PUBLIC& salting_key) {
+  SaltingKeyTransceiver transceiver(salting_key);
+  Tpm tpm(&transceiver);
+  SaltingKeyCache cache;
+  std::string salt;
+  std::string encrypted_salt;
+  bool used_cached_key = false;
+  TPM_RC result = TPM_RC_SUCCESS;
+  // The untimed first run loads the key into the cache.
+  Benchmark benchmark(name);
+  while (benchmark.Loop()) {
+    result = cache.CreateSalt(&tpm, &salt, &encrypted_salt, &used_cached_key);
+  }
+  return Report(&benchmark, result == TPM_RC_SUCCESS && used_cached_key);
+}
+
+// Compares the results with the ns/op in |baseline_path|. Returns false if any
+// is more than |tolerance| percent slower.
+bool CheckBaseline(const base::FilePath& baseline_path, double tolerance) {
+  std::string baseline;
+  if (!base::ReadFileToString(baseline_path, &baseline)) {
+    LOG(ERROR) << "Failed to read " << baseline_path.value();
+    return false;
+  }
+  bool success = true;
+  for (const std::string& line : base::SplitString(
+           baseline, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    std::vector<std::string> fields = base::SplitString(
+        line, " ", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+    double baseline_ns = 0;
+    if (fields.size() < 2 || !base::StringToDouble(fields[1], &baseline_ns)) {
+      continue;
+    }
+    auto iter = g_results.find(fields[0]);
+    if (iter == g_results.end()) {
+      continue;
+    }
+    if (iter->second > baseline_ns * (1 + tolerance / 100)) {
+      printf("REGRESSION: %s %.1f ns/op, baseline %.1f ns/op\n",
+             fields[0].c_str(), iter->second, baseline_ns);
+      success = false;
+    }
+  }
+  return success;
+}
+
+}  // namespace
+}  // namespace trunks
+
+int main(int argc, char** argv) {
+  base::CommandLine::Init(argc, argv);
+  base::CommandLine* cl = base::CommandLine::ForCurrentProcess();
+  bool success = trunks::Benchmark_GetCommandAuthorization();
+  success = trunks::Benchmark_CheckResponseAuthorization() && success;
+  success = trunks::Benchmark_ParameterEncryption() && success;
+  success = trunks::Benchmark_EncryptSalt("EncryptSalt",
+                                          trunks::GetRSASaltingKey()) &&
+            success;
+  success = trunks::Benchmark_EncryptSalt("EncryptSalt/ECC",
+                                          trunks::GetECCSaltingKey()) &&
+            success;
+  if (cl->HasSwitch("baseline")) {
+    double tolerance = 20;
+    if (cl->HasSwitch("tolerance") &&
+        !base::StringToDouble(cl->GetSwitchValueASCII("tolerance"),
+                              &tolerance)) {
+      LOG(ERROR) << "Invalid tolerance.";
+      return 1;
+    }
+    success = trunks::CheckBaseline(cl->GetSwitchValuePath("baseline"),
+                                    tolerance) &&
+              success;
+  }
+  return success ? 0 : 1;
+}
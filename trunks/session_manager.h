@@ -19,6 +19,8 @@
 
 #include <string>
 
+#include <base/callback.h>
+
 #include "trunks/hmac_authorization_delegate.h"
 #include "trunks/tpm_generated.h"
 #include "trunks/trunks_export.h"
@@ -40,6 +42,8 @@ const trunks::TPM_HANDLE kUninitializedHandle = 0;
 // TPM_HANDLE session_handle = session_manager->GetSessionHandle();
 class TRUNKS_EXPORT SessionManager {
  public:
+  typedef base::Callback<void(TPM_RC result)> StartSessionCallback;
+
   SessionManager() {}
   virtual ~SessionManager() {}
 
@@ -63,6 +67,20 @@ class TRUNKS_EXPORT SessionManager {
                               bool enable_encryption,
                               HmacAuthorizationDelegate* delegate) = 0;
 
+  // Asynchronous version of StartSession(). The TPM2_StartAuthSession command
+  // is sent without blocking and |callback| is run with the result once the
+  // session is set up. The salt is still encrypted before this method
+  // returns, which reads the salting key from the TPM if it is not cached.
+  // |delegate| must stay valid until |callback| runs, and no other session
+  // may be started on this instance in the meantime. |callback| is not run
+  // if this instance is destroyed first.
+  virtual void StartSessionAsync(TPM_SE session_type,
+                                 TPMI_DH_ENTITY bind_entity,
+                                 const std::string& bind_authorization_value,
+                                 bool enable_encryption,
+                                 HmacAuthorizationDelegate* delegate,
+                                 const StartSessionCallback& callback) = 0;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(SessionManager);
 };
@@ -16,15 +16,24 @@
 
 #include "trunks/session_manager_impl.h"
 
+#include <algorithm>
 #include <string>
+#include <utility>
 
+#include <base/bind.h>
 #include <base/logging.h>
 #include <base/stl_util.h>
 #include <crypto/openssl_util.h>
+#include <crypto/sha2.h>
 #include <openssl/bio.h>
 #include <openssl/bn.h>
+#include <openssl/crypto.h>
+#include <openssl/ec.h>
+#include <openssl/ec_key.h>
+#include <openssl/ecdh.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
+#include <openssl/nid.h>
 #if defined(OPENSSL_IS_BORINGSSL)
 #include <openssl/mem.h>
 #endif
@@ -32,12 +41,22 @@
 #include <openssl/rsa.h>
 
 #include "trunks/error_codes.h"
+#include "trunks/nonce_pool.h"
 #include "trunks/tpm_generated.h"
 #include "trunks/tpm_utility.h"
 
 namespace {
 const size_t kWellKnownExponent = 0x10001;
 
+// Size of a NIST P-256 coordinate, which is the only ECC salting key curve.
+const size_t kECCCoordinateSize = 32;
+
+// Label for RSAES-OAEP and for the ECDH key derivation, including the
+// terminating zero. Defined in TPM2.0 Part1 Architecture, Annex B.10.2 and
+// Annex C.6.1.
+const char kSaltLabel[] = "SECRET";
+const size_t kSaltLabelSize = sizeof(kSaltLabel);
+
 std::string GetOpenSSLError() {
   BIO* bio = BIO_new(BIO_s_mem());
   ERR_print_errors(bio);
@@ -47,108 +66,188 @@ std::string GetOpenSSLError() {
   BIO_free(bio);
   return error_string;
 }
+
+// Parameter encryption uses AES-128 in CFB mode.
+trunks::TPMT_SYM_DEF GetSymmetricAlgorithm() {
+  trunks::TPMT_SYM_DEF symmetric_algorithm;
+  symmetric_algorithm.algorithm = trunks::TPM_ALG_AES;
+  symmetric_algorithm.key_bits.aes = 128;
+  symmetric_algorithm.mode.aes = trunks::TPM_ALG_CFB;
+  return symmetric_algorithm;
+}
 }  // namespace
 
 namespace trunks {
 
-SessionManagerImpl::SessionManagerImpl(const TrunksFactory& factory)
-    : factory_(factory), session_handle_(kUninitializedHandle) {
-  crypto::EnsureOpenSSLInit();
+const size_t SaltingKeyCache::kMaxPregeneratedSalts;
+
+SaltingKeyCache::SaltingKeyCache() {}
+
+SaltingKeyCache::~SaltingKeyCache() {
+  base::AutoLock lock(lock_);
+  ClearSaltsLocked();
 }
 
-SessionManagerImpl::~SessionManagerImpl() {
-  CloseSession();
+TPM_RC SaltingKeyCache::CreateSalt(Tpm* tpm,
+                                   std::string* salt,
+                                   std::string* encrypted_salt,
+                                   bool* used_cached_key) {
+  base::AutoLock lock(lock_);
+  *used_cached_key = IsLoadedLocked();
+  if (!IsLoadedLocked()) {
+    TPM_RC result = LoadLocked(tpm);
+    if (result != TPM_RC_SUCCESS) {
+      return result;
+    }
+  }
+  return CreateSaltLocked(salt, encrypted_salt);
 }
 
-void SessionManagerImpl::CloseSession() {
-  if (session_handle_ == kUninitializedHandle) {
-    return;
+TPM_RC SaltingKeyCache::PregenerateSalts(Tpm* tpm, size_t count) {
+  base::AutoLock lock(lock_);
+  if (!IsLoadedLocked()) {
+    TPM_RC result = LoadLocked(tpm);
+    if (result != TPM_RC_SUCCESS) {
+      return result;
+    }
   }
-  TPM_RC result = factory_.GetTpm()->FlushContextSync(session_handle_, nullptr);
-  if (result != TPM_RC_SUCCESS) {
-    LOG(WARNING) << "Error closing tpm session: " << GetErrorString(result);
+  count = std::min(count, kMaxPregeneratedSalts);
+  while (pregenerated_salts_.size() < count) {
+    PregeneratedSalt pregenerated;
+    TPM_RC result =
+        CreateSaltLocked(&pregenerated.salt, &pregenerated.encrypted_salt);
+    if (result != TPM_RC_SUCCESS) {
+      return result;
+    }
+    pregenerated_salts_.push_back(std::move(pregenerated));
   }
-  session_handle_ = kUninitializedHandle;
+  return TPM_RC_SUCCESS;
 }
 
-TPM_RC SessionManagerImpl::StartSession(
-    TPM_SE session_type,
-    TPMI_DH_ENTITY bind_entity,
-    const std::string& bind_authorization_value,
-    bool enable_encryption,
-    HmacAuthorizationDelegate* delegate) {
-  CHECK(delegate);
-  // If we already have an active session, close it.
-  CloseSession();
-
-  std::string salt(SHA256_DIGEST_SIZE, 0);
-  unsigned char* salt_buffer =
-      reinterpret_cast<unsigned char*>(base::string_as_array(&salt));
-  CHECK_EQ(RAND_bytes(salt_buffer, salt.size()), 1)
-      << "Error generating a cryptographically random salt.";
-  // First we encrypt the cryptographically secure salt using PKCS1_OAEP
-  // padded RSA public key encryption. This is specified in TPM2.0
-  // Part1 Architecture, Appendix B.10.2.
-  std::string encrypted_salt;
-  TPM_RC salt_result = EncryptSalt(salt, &encrypted_salt);
-  if (salt_result != TPM_RC_SUCCESS) {
-    LOG(ERROR) << "Error encrypting salt: " << GetErrorString(salt_result);
-    return salt_result;
+bool SaltingKeyCache::TakeSalt(std::string* salt,
+                               std::string* encrypted_salt) {
+  base::AutoLock lock(lock_);
+  if (pregenerated_salts_.empty()) {
+    return false;
   }
+  PregeneratedSalt& pregenerated = pregenerated_salts_.back();
+  salt->assign(pregenerated.salt);
+  encrypted_salt->assign(pregenerated.encrypted_salt);
+  OPENSSL_cleanse(base::string_as_array(&pregenerated.salt),
+                  pregenerated.salt.size());
+  pregenerated_salts_.pop_back();
+  return true;
+}
 
-  TPM2B_ENCRYPTED_SECRET encrypted_secret =
-      Make_TPM2B_ENCRYPTED_SECRET(encrypted_salt);
-  // Then we use TPM2_StartAuthSession to start a HMAC session with the TPM.
-  // The tpm returns the tpm_nonce and the session_handle referencing the
-  // created session.
-  TPMI_ALG_HASH hash_algorithm = TPM_ALG_SHA256;
-  TPMT_SYM_DEF symmetric_algorithm;
-  symmetric_algorithm.algorithm = TPM_ALG_AES;
-  symmetric_algorithm.key_bits.aes = 128;
-  symmetric_algorithm.mode.aes = TPM_ALG_CFB;
+bool SaltingKeyCache::IsLoadedLocked() const {
+  return encrypt_context_ || ecc_salting_key_;
+}
 
-  TPM2B_NONCE nonce_caller;
-  TPM2B_NONCE nonce_tpm;
-  // We use sha1_digest_size here because that is the minimum length
-  // needed for the nonce.
-  nonce_caller.size = SHA1_DIGEST_SIZE;
-  CHECK_EQ(RAND_bytes(nonce_caller.buffer, nonce_caller.size), 1)
-      << "Error generating a cryptographically random nonce.";
+TPM_RC SaltingKeyCache::CreateSaltLocked(std::string* salt,
+                                         std::string* encrypted_salt) {
+  if (ecc_salting_key_) {
+    return CreateECCSaltLocked(salt, encrypted_salt);
+  }
+  return CreateRSASaltLocked(salt, encrypted_salt);
+}
 
-  Tpm* tpm = factory_.GetTpm();
-  // The TPM2 command below needs no authorization. This is why we can use
-  // the empty string "", when referring to the handle names for the salting
-  // key and the bind entity.
-  TPM_RC tpm_result = tpm->StartAuthSessionSync(
-      kSaltingKey,
-      "",  // salt_handle_name.
-      bind_entity,
-      "",  // bind_entity_name.
-      nonce_caller, encrypted_secret, session_type, symmetric_algorithm,
-      hash_algorithm, &session_handle_, &nonce_tpm,
-      nullptr);  // No Authorization.
-  if (tpm_result) {
-    LOG(ERROR) << "Error creating an authorization session: "
-               << GetErrorString(tpm_result);
-    return tpm_result;
+TPM_RC SaltingKeyCache::CreateRSASaltLocked(std::string* salt,
+                                            std::string* encrypted_salt) {
+  salt->assign(SHA256_DIGEST_SIZE, 0);
+  CHECK_EQ(RAND_bytes(reinterpret_cast<unsigned char*>(
+                          base::string_as_array(salt)),
+                      salt->size()),
+           1)
+      << "Error generating a cryptographically random salt.";
+  size_t out_length = EVP_PKEY_size(salting_key_.get());
+  encrypted_salt->resize(out_length);
+  if (!EVP_PKEY_encrypt(
+          encrypt_context_.get(),
+          reinterpret_cast<uint8_t*>(base::string_as_array(encrypted_salt)),
+          &out_length, reinterpret_cast<const uint8_t*>(salt->data()),
+          salt->size())) {
+    LOG(ERROR) << "Error encrypting salt: " << GetOpenSSLError();
+    return TRUNKS_RC_SESSION_SETUP_ERROR;
   }
-  bool hmac_result =
-      delegate->InitSession(session_handle_, nonce_tpm, nonce_caller, salt,
-                            bind_authorization_value, enable_encryption);
-  if (!hmac_result) {
-    LOG(ERROR) << "Failed to initialize an authorization session delegate.";
-    return TPM_RC_FAILURE;
+  encrypted_salt->resize(out_length);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC SaltingKeyCache::CreateECCSaltLocked(std::string* salt,
+                                            std::string* encrypted_salt) {
+  const EC_GROUP* group = EC_KEY_get0_group(ecc_salting_key_.get());
+  bssl::UniquePtr<EC_KEY> ephemeral_key(EC_KEY_new());
+  if (!ephemeral_key || !EC_KEY_set_group(ephemeral_key.get(), group) ||
+      !EC_KEY_generate_key(ephemeral_key.get())) {
+    LOG(ERROR) << "Error generating ephemeral key: " << GetOpenSSLError();
+    return TRUNKS_RC_SESSION_SETUP_ERROR;
   }
+  bssl::UniquePtr<BIGNUM> x(BN_new());
+  bssl::UniquePtr<BIGNUM> y(BN_new());
+  std::string ephemeral_x(kECCCoordinateSize, 0);
+  std::string ephemeral_y(kECCCoordinateSize, 0);
+  // Z is the x coordinate of the shared point, padded to the field size.
+  std::string z(kECCCoordinateSize, 0);
+  if (!x || !y ||
+      !EC_POINT_get_affine_coordinates_GFp(
+          group, EC_KEY_get0_public_key(ephemeral_key.get()), x.get(),
+          y.get(), nullptr) ||
+      !BN_bn2bin_padded(
+          reinterpret_cast<uint8_t*>(base::string_as_array(&ephemeral_x)),
+          ephemeral_x.size(), x.get()) ||
+      !BN_bn2bin_padded(
+          reinterpret_cast<uint8_t*>(base::string_as_array(&ephemeral_y)),
+          ephemeral_y.size(), y.get()) ||
+      ECDH_compute_key(base::string_as_array(&z), z.size(),
+                       EC_KEY_get0_public_key(ecc_salting_key_.get()),
+                       ephemeral_key.get(),
+                       nullptr) != static_cast<int>(z.size())) {
+    LOG(ERROR) << "Error computing shared secret: " << GetOpenSSLError();
+    return TRUNKS_RC_SESSION_SETUP_ERROR;
+  }
+  // KDFe(SHA256, Z, "SECRET", QeU.x, QsV.x, 256) needs a single round, with
+  // the counter set to 1.
+  const char kCounter[] = {0, 0, 0, 1};
+  std::string kdf_input(kCounter, sizeof(kCounter));
+  kdf_input += z;
+  kdf_input += std::string(kSaltLabel, kSaltLabelSize);
+  kdf_input += ephemeral_x;
+  kdf_input += ecc_salting_key_x_;
+  *salt = crypto::SHA256HashString(kdf_input);
+  OPENSSL_cleanse(base::string_as_array(&z), z.size());
+  OPENSSL_cleanse(base::string_as_array(&kdf_input), kdf_input.size());
+  // The encrypted secret is the marshaled ephemeral public point.
+  TPMS_ECC_POINT point;
+  point.x = Make_TPM2B_ECC_PARAMETER(ephemeral_x);
+  point.y = Make_TPM2B_ECC_PARAMETER(ephemeral_y);
+  encrypted_salt->clear();
+  Serialize_TPMS_ECC_POINT(point, encrypted_salt);
   return TPM_RC_SUCCESS;
 }
 
-TPM_RC SessionManagerImpl::EncryptSalt(const std::string& salt,
-                                       std::string* encrypted_salt) {
+void SaltingKeyCache::Invalidate() {
+  base::AutoLock lock(lock_);
+  encrypt_context_.reset();
+  salting_key_.reset();
+  ecc_salting_key_.reset();
+  ecc_salting_key_x_.clear();
+  ClearSaltsLocked();
+}
+
+void SaltingKeyCache::ClearSaltsLocked() {
+  for (PregeneratedSalt& pregenerated : pregenerated_salts_) {
+    OPENSSL_cleanse(base::string_as_array(&pregenerated.salt),
+                    pregenerated.salt.size());
+  }
+  pregenerated_salts_.clear();
+}
+
+TPM_RC SaltingKeyCache::LoadLocked(Tpm* tpm) {
   TPM2B_NAME out_name;
   TPM2B_NAME qualified_name;
   TPM2B_PUBLIC public_data;
   public_data.public_area.unique.rsa.size = 0;
-  TPM_RC result = factory_.GetTpm()->ReadPublicSync(
+  TPM_RC result = tpm->ReadPublicSync(
       kSaltingKey, "" /*object_handle_name (not used)*/, &public_data,
       &out_name, &qualified_name, nullptr /*authorization_delegate*/);
   if (result != TPM_RC_SUCCESS) {
@@ -156,8 +255,14 @@ TPM_RC SessionManagerImpl::EncryptSalt(const std::string& salt,
                << GetErrorString(result);
     return result;
   }
-  if (public_data.public_area.type != TPM_ALG_RSA ||
-      public_data.public_area.unique.rsa.size != 256) {
+  if (public_data.public_area.type == TPM_ALG_ECC) {
+    return LoadECCKeyLocked(public_data.public_area);
+  }
+  return LoadRSAKeyLocked(public_data.public_area);
+}
+
+TPM_RC SaltingKeyCache::LoadRSAKeyLocked(const TPMT_PUBLIC& public_area) {
+  if (public_area.type != TPM_ALG_RSA || public_area.unique.rsa.size != 256) {
     LOG(ERROR) << "Invalid salting key attributes.";
     return TRUNKS_RC_SESSION_SETUP_ERROR;
   }
@@ -169,8 +274,8 @@ TPM_RC SessionManagerImpl::EncryptSalt(const std::string& salt,
   }
   BN_set_word(salting_key_rsa->e, kWellKnownExponent);
   salting_key_rsa->n =
-      BN_bin2bn(public_data.public_area.unique.rsa.buffer,
-                public_data.public_area.unique.rsa.size, nullptr);
+      BN_bin2bn(public_area.unique.rsa.buffer, public_area.unique.rsa.size,
+                nullptr);
   if (!salting_key_rsa->n) {
     LOG(ERROR) << "Error setting public area of rsa key: " << GetOpenSSLError();
     return TRUNKS_RC_SESSION_SETUP_ERROR;
@@ -180,13 +285,9 @@ TPM_RC SessionManagerImpl::EncryptSalt(const std::string& salt,
     LOG(ERROR) << "Error setting up EVP_PKEY: " << GetOpenSSLError();
     return TRUNKS_RC_SESSION_SETUP_ERROR;
   }
-  // Label for RSAES-OAEP. Defined in TPM2.0 Part1 Architecture,
-  // Appendix B.10.2.
-  const size_t kOaepLabelSize = 7;
-  const char kOaepLabelValue[] = "SECRET\0";
   // EVP_PKEY_CTX_set0_rsa_oaep_label takes ownership so we need to malloc.
-  uint8_t* oaep_label = static_cast<uint8_t*>(OPENSSL_malloc(kOaepLabelSize));
-  memcpy(oaep_label, kOaepLabelValue, kOaepLabelSize);
+  uint8_t* oaep_label = static_cast<uint8_t*>(OPENSSL_malloc(kSaltLabelSize));
+  memcpy(oaep_label, kSaltLabel, kSaltLabelSize);
   bssl::UniquePtr<EVP_PKEY_CTX> salt_encrypt_context(
       EVP_PKEY_CTX_new(salting_key.get(), nullptr));
   if (!EVP_PKEY_encrypt_init(salt_encrypt_context.get()) ||
@@ -195,23 +296,255 @@ TPM_RC SessionManagerImpl::EncryptSalt(const std::string& salt,
       !EVP_PKEY_CTX_set_rsa_oaep_md(salt_encrypt_context.get(), EVP_sha256()) ||
       !EVP_PKEY_CTX_set_rsa_mgf1_md(salt_encrypt_context.get(), EVP_sha256()) ||
       !EVP_PKEY_CTX_set0_rsa_oaep_label(salt_encrypt_context.get(), oaep_label,
-                                        kOaepLabelSize)) {
+                                        kSaltLabelSize)) {
     LOG(ERROR) << "Error setting up salt encrypt context: "
                << GetOpenSSLError();
     return TRUNKS_RC_SESSION_SETUP_ERROR;
   }
-  size_t out_length = EVP_PKEY_size(salting_key.get());
-  encrypted_salt->resize(out_length);
-  if (!EVP_PKEY_encrypt(
-          salt_encrypt_context.get(),
-          reinterpret_cast<uint8_t*>(base::string_as_array(encrypted_salt)),
-          &out_length, reinterpret_cast<const uint8_t*>(salt.data()),
-          salt.size())) {
-    LOG(ERROR) << "Error encrypting salt: " << GetOpenSSLError();
+  salting_key_ = std::move(salting_key);
+  encrypt_context_ = std::move(salt_encrypt_context);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC SaltingKeyCache::LoadECCKeyLocked(const TPMT_PUBLIC& public_area) {
+  if (public_area.parameters.ecc_detail.curve_id != TPM_ECC_NIST_P256 ||
+      public_area.unique.ecc.x.size != kECCCoordinateSize ||
+      public_area.unique.ecc.y.size != kECCCoordinateSize) {
+    LOG(ERROR) << "Invalid salting key attributes.";
     return TRUNKS_RC_SESSION_SETUP_ERROR;
   }
-  encrypted_salt->resize(out_length);
+  bssl::UniquePtr<EC_KEY> salting_key(
+      EC_KEY_new_by_curve_name(NID_X9_62_prime256v1));
+  bssl::UniquePtr<BIGNUM> x(BN_bin2bn(public_area.unique.ecc.x.buffer,
+                                      public_area.unique.ecc.x.size, nullptr));
+  bssl::UniquePtr<BIGNUM> y(BN_bin2bn(public_area.unique.ecc.y.buffer,
+                                      public_area.unique.ecc.y.size, nullptr));
+  // This also checks that the point is on the curve.
+  if (!salting_key || !x || !y ||
+      !EC_KEY_set_public_key_affine_coordinates(salting_key.get(), x.get(),
+                                                y.get())) {
+    LOG(ERROR) << "Error setting public area of ecc key: " << GetOpenSSLError();
+    return TRUNKS_RC_SESSION_SETUP_ERROR;
+  }
+  ecc_salting_key_ = std::move(salting_key);
+  ecc_salting_key_x_ = StringFrom_TPM2B_ECC_PARAMETER(public_area.unique.ecc.x);
   return TPM_RC_SUCCESS;
 }
 
+SessionManagerImpl::SessionManagerImpl(const TrunksFactory& factory)
+    : factory_(factory),
+      session_handle_(kUninitializedHandle),
+      own_salting_key_cache_(new SaltingKeyCache()),
+      salting_key_cache_(own_salting_key_cache_.get()) {
+  crypto::EnsureOpenSSLInit();
+}
+
+SessionManagerImpl::SessionManagerImpl(const TrunksFactory& factory,
+                                       SaltingKeyCache* salting_key_cache)
+    : factory_(factory),
+      session_handle_(kUninitializedHandle),
+      salting_key_cache_(salting_key_cache) {
+  CHECK(salting_key_cache_);
+  crypto::EnsureOpenSSLInit();
+}
+
+SessionManagerImpl::~SessionManagerImpl() {
+  CloseSession();
+}
+
+void SessionManagerImpl::CloseSession() {
+  if (session_handle_ == kUninitializedHandle) {
+    return;
+  }
+  TPM_RC result = factory_.GetTpm()->FlushContextSync(session_handle_, nullptr);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(WARNING) << "Error closing tpm session: " << GetErrorString(result);
+  }
+  session_handle_ = kUninitializedHandle;
+}
+
+TPM_RC SessionManagerImpl::StartSession(
+    TPM_SE session_type,
+    TPMI_DH_ENTITY bind_entity,
+    const std::string& bind_authorization_value,
+    bool enable_encryption,
+    HmacAuthorizationDelegate* delegate) {
+  CHECK(delegate);
+  // If we already have an active session, close it.
+  CloseSession();
+
+  TPM2B_NONCE nonce_caller;
+  TPM2B_NONCE nonce_tpm;
+  // We use sha1_digest_size here because that is the minimum length
+  // needed for the nonce.
+  nonce_caller.size = SHA1_DIGEST_SIZE;
+  GetRandomNonceBytes(nonce_caller.buffer, nonce_caller.size);
+
+  std::string salt;
+  bool used_cached_key = false;
+  TPM_RC tpm_result = StartAuthSession(session_type, bind_entity, nonce_caller,
+                                       &salt, &nonce_tpm, &used_cached_key);
+  if (tpm_result != TPM_RC_SUCCESS && used_cached_key) {
+    // The salting key is recreated when the TPM is cleared, so a cached key
+    // may be stale. Reload it and try once more.
+    LOG(WARNING) << "Retrying session start with a reloaded salting key: "
+                 << GetErrorString(tpm_result);
+    salting_key_cache_->Invalidate();
+    tpm_result = StartAuthSession(session_type, bind_entity, nonce_caller,
+                                  &salt, &nonce_tpm, &used_cached_key);
+  }
+  if (tpm_result != TPM_RC_SUCCESS) {
+    return tpm_result;
+  }
+  bool hmac_result =
+      delegate->InitSession(session_handle_, nonce_tpm, nonce_caller, salt,
+                            bind_authorization_value, enable_encryption);
+  if (!hmac_result) {
+    LOG(ERROR) << "Failed to initialize an authorization session delegate.";
+    return TPM_RC_FAILURE;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+void SessionManagerImpl::StartSessionAsync(
+    TPM_SE session_type,
+    TPMI_DH_ENTITY bind_entity,
+    const std::string& bind_authorization_value,
+    bool enable_encryption,
+    HmacAuthorizationDelegate* delegate,
+    const StartSessionCallback& callback) {
+  CHECK(delegate);
+  // If we already have an active session, close it.
+  CloseSession();
+
+  AsyncStart start;
+  start.session_type = session_type;
+  start.bind_entity = bind_entity;
+  start.bind_authorization_value = bind_authorization_value;
+  start.enable_encryption = enable_encryption;
+  start.delegate = delegate;
+  start.nonce_caller.size = SHA1_DIGEST_SIZE;
+  GetRandomNonceBytes(start.nonce_caller.buffer, start.nonce_caller.size);
+  start.used_cached_key = false;
+  start.retried = false;
+  start.callback = callback;
+  SendStartAuthSession(std::move(start));
+}
+
+TPM_RC SessionManagerImpl::EncryptNewSalt(
+    std::string* salt,
+    TPM2B_ENCRYPTED_SECRET* encrypted_secret,
+    bool* used_cached_key) {
+  std::string encrypted_salt;
+  if (salting_key_cache_->TakeSalt(salt, &encrypted_salt)) {
+    // The salt was encrypted to the cached key.
+    *used_cached_key = true;
+    *encrypted_secret = Make_TPM2B_ENCRYPTED_SECRET(encrypted_salt);
+    return TPM_RC_SUCCESS;
+  }
+  // The salt is either a random value encrypted with RSA-OAEP or the result
+  // of an ECDH key exchange, depending on the salting key.
+  TPM_RC salt_result = salting_key_cache_->CreateSalt(
+      factory_.GetTpm(), salt, &encrypted_salt, used_cached_key);
+  if (salt_result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << "Error encrypting salt: " << GetErrorString(salt_result);
+    return salt_result;
+  }
+  *encrypted_secret = Make_TPM2B_ENCRYPTED_SECRET(encrypted_salt);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC SessionManagerImpl::StartAuthSession(TPM_SE session_type,
+                                            TPMI_DH_ENTITY bind_entity,
+                                            const TPM2B_NONCE& nonce_caller,
+                                            std::string* salt,
+                                            TPM2B_NONCE* nonce_tpm,
+                                            bool* used_cached_key) {
+  TPM2B_ENCRYPTED_SECRET encrypted_secret;
+  TPM_RC salt_result =
+      EncryptNewSalt(salt, &encrypted_secret, used_cached_key);
+  if (salt_result != TPM_RC_SUCCESS) {
+    return salt_result;
+  }
+  // Then we use TPM2_StartAuthSession to start a HMAC session with the TPM.
+  // The tpm returns the tpm_nonce and the session_handle referencing the
+  // created session.
+  // The TPM2 command below needs no authorization. This is why we can use
+  // the empty string "", when referring to the handle names for the salting
+  // key and the bind entity.
+  TPM_RC tpm_result = factory_.GetTpm()->StartAuthSessionSync(
+      kSaltingKey,
+      "",  // salt_handle_name.
+      bind_entity,
+      "",  // bind_entity_name.
+      nonce_caller, encrypted_secret, session_type, GetSymmetricAlgorithm(),
+      TPM_ALG_SHA256, &session_handle_, nonce_tpm,
+      nullptr);  // No Authorization.
+  if (tpm_result) {
+    LOG(ERROR) << "Error creating an authorization session: "
+               << GetErrorString(tpm_result);
+    return tpm_result;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+void SessionManagerImpl::SendStartAuthSession(AsyncStart start) {
+  TPM2B_ENCRYPTED_SECRET encrypted_secret;
+  TPM_RC salt_result = EncryptNewSalt(&start.salt, &encrypted_secret,
+                                      &start.used_cached_key);
+  if (salt_result != TPM_RC_SUCCESS) {
+    start.callback.Run(salt_result);
+    return;
+  }
+  TPM2B_NONCE nonce_caller = start.nonce_caller;
+  TPM_SE session_type = start.session_type;
+  TPMI_DH_ENTITY bind_entity = start.bind_entity;
+  // A session started after this object is gone is not flushed here; the
+  // resource manager flushes it when the client goes away.
+  factory_.GetTpm()->StartAuthSession(
+      kSaltingKey,
+      "",  // salt_handle_name.
+      bind_entity,
+      "",  // bind_entity_name.
+      nonce_caller, encrypted_secret, session_type, GetSymmetricAlgorithm(),
+      TPM_ALG_SHA256,
+      nullptr,  // No Authorization.
+      base::Bind(&SessionManagerImpl::OnStartAuthSession,
+                 weak_factory_.GetWeakPtr(), std::move(start)));
+}
+
+void SessionManagerImpl::OnStartAuthSession(
+    const AsyncStart& start,
+    TPM_RC result,
+    const TPMI_SH_AUTH_SESSION& session_handle,
+    const TPM2B_NONCE& nonce_tpm) {
+  if (result != TPM_RC_SUCCESS && start.used_cached_key && !start.retried) {
+    // The salting key is recreated when the TPM is cleared, so a cached key
+    // may be stale. Reload it and try once more.
+    LOG(WARNING) << "Retrying session start with a reloaded salting key: "
+                 << GetErrorString(result);
+    salting_key_cache_->Invalidate();
+    AsyncStart retry = start;
+    retry.retried = true;
+    SendStartAuthSession(std::move(retry));
+    return;
+  }
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << "Error creating an authorization session: "
+               << GetErrorString(result);
+    start.callback.Run(result);
+    return;
+  }
+  session_handle_ = session_handle;
+  if (!start.delegate->InitSession(session_handle_, nonce_tpm,
+                                   start.nonce_caller, start.salt,
+                                   start.bind_authorization_value,
+                                   start.enable_encryption)) {
+    LOG(ERROR) << "Failed to initialize an authorization session delegate.";
+    start.callback.Run(TPM_RC_FAILURE);
+    return;
+  }
+  start.callback.Run(TPM_RC_SUCCESS);
+}
+
 }  // namespace trunks
@@ -19,15 +19,98 @@
 
 #include "trunks/session_manager.h"
 
+#include <memory>
 #include <string>
+#include <vector>
 
+#include <base/macros.h>
+#include <base/memory/weak_ptr.h>
+#include <base/synchronization/lock.h>
 #include <gtest/gtest_prod.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
 
 #include "trunks/tpm_generated.h"
+#include "trunks/trunks_export.h"
 #include "trunks/trunks_factory.h"
 
 namespace trunks {
 
+// Caches the public area of the salting key together with what is needed to
+// encrypt salts to it, so that starting a salted session only needs the
+// TPM2_StartAuthSession round trip. The salting key is either RSA-2048, with
+// salts encrypted by RSA-OAEP, or ECC NIST P-256, with salts derived by
+// one-pass ECDH as in TPM2.0 Part 1 Architecture, Annex C.6.1. The key is read
+// and validated on first use and reloaded after Invalidate(). Salts can also
+// be generated and encrypted ahead of time, when the caller is otherwise idle,
+// so the public-key work is off the session setup path. This class is
+// thread-safe.
+class TRUNKS_EXPORT SaltingKeyCache {
+ public:
+  SaltingKeyCache();
+  ~SaltingKeyCache();
+
+  // Creates a fresh salt for the salting key and returns it in |salt|, with
+  // the encrypted secret to send in TPM2_StartAuthSession in
+  // |encrypted_salt|. For an ECC key the salt comes out of the key exchange,
+  // so it cannot be chosen by the caller. The key is read using |tpm| if it
+  // is not cached. |used_cached_key| is set to true if the key was already
+  // cached before this call.
+  TPM_RC CreateSalt(Tpm* tpm,
+                    std::string* salt,
+                    std::string* encrypted_salt,
+                    bool* used_cached_key);
+
+  // Generates random salts and encrypts them until |count| are pregenerated,
+  // up to kMaxPregeneratedSalts. The key is read using |tpm| if it is not
+  // cached.
+  TPM_RC PregenerateSalts(Tpm* tpm, size_t count);
+
+  // Takes a pregenerated salt and copies it to |salt| and its encryption to
+  // |encrypted_salt|. Returns false if none is left.
+  bool TakeSalt(std::string* salt, std::string* encrypted_salt);
+
+  // Drops the cached key and any salts encrypted to it. Call this when the
+  // salting key may have been recreated, e.g. after the TPM was cleared.
+  void Invalidate();
+
+  static const size_t kMaxPregeneratedSalts = 16;
+
+ private:
+  struct PregeneratedSalt {
+    std::string salt;
+    std::string encrypted_salt;
+  };
+
+  // Reads the salting key public area and prepares |encrypt_context_| or
+  // |ecc_salting_key_|, depending on the key type.
+  TPM_RC LoadLocked(Tpm* tpm);
+  TPM_RC LoadRSAKeyLocked(const TPMT_PUBLIC& public_area);
+  TPM_RC LoadECCKeyLocked(const TPMT_PUBLIC& public_area);
+  bool IsLoadedLocked() const;
+  TPM_RC CreateSaltLocked(std::string* salt, std::string* encrypted_salt);
+  // Encrypts a random |salt| with RSA-OAEP, as specified in TPM2.0 Part 1
+  // Architecture, Annex B.10.2.
+  TPM_RC CreateRSASaltLocked(std::string* salt, std::string* encrypted_salt);
+  // Derives |salt| from an ephemeral key pair, as specified in TPM2.0 Part 1
+  // Architecture, Annex C.6.1. |encrypted_salt| is the ephemeral public point.
+  TPM_RC CreateECCSaltLocked(std::string* salt, std::string* encrypted_salt);
+  // Wipes and drops every pregenerated salt.
+  void ClearSaltsLocked();
+
+  base::Lock lock_;
+  // Set when the salting key is an RSA key.
+  bssl::UniquePtr<EVP_PKEY> salting_key_;
+  bssl::UniquePtr<EVP_PKEY_CTX> encrypt_context_;
+  // Set when the salting key is an ECC key, together with the x coordinate
+  // of its public point, which goes into every salt derivation.
+  bssl::UniquePtr<EC_KEY> ecc_salting_key_;
+  std::string ecc_salting_key_x_;
+  std::vector<PregeneratedSalt> pregenerated_salts_;
+
+  DISALLOW_COPY_AND_ASSIGN(SaltingKeyCache);
+};
+
 // This class is used to keep track of a TPM session. Each instance of this
 // class is used to account for one instance of a TPM session. Currently
 // this class is used by AuthorizationSession instances to keep track of TPM
@@ -35,6 +118,10 @@ namespace trunks {
 class TRUNKS_EXPORT SessionManagerImpl : public SessionManager {
  public:
   explicit SessionManagerImpl(const TrunksFactory& factory);
+  // Uses |salting_key_cache| instead of a cache private to this instance. The
+  // cache is not owned and must outlive this object.
+  SessionManagerImpl(const TrunksFactory& factory,
+                     SaltingKeyCache* salting_key_cache);
   ~SessionManagerImpl() override;
 
   TPM_HANDLE GetSessionHandle() const override { return session_handle_; }
@@ -44,13 +131,52 @@ class TRUNKS_EXPORT SessionManagerImpl : public SessionManager {
                       const std::string& bind_authorization_value,
                       bool enable_encryption,
                       HmacAuthorizationDelegate* delegate) override;
+  void StartSessionAsync(TPM_SE session_type,
+                         TPMI_DH_ENTITY bind_entity,
+                         const std::string& bind_authorization_value,
+                         bool enable_encryption,
+                         HmacAuthorizationDelegate* delegate,
+                         const StartSessionCallback& callback) override;
 
  private:
-  // This function is used to encrypt a plaintext salt |salt|, using RSA
-  // public encrypt with the SaltingKey PKCS1_OAEP padding. It follows the
-  // specification defined in TPM2.0 Part 1 Architecture, Appendix B.10.2.
-  // The encrypted salt is stored in the out parameter |encrypted_salt|.
-  TPM_RC EncryptSalt(const std::string& salt, std::string* encrypted_salt);
+  // The parameters of an asynchronous session start, carried from the
+  // TPM2_StartAuthSession request to its response.
+  struct AsyncStart {
+    TPM_SE session_type;
+    TPMI_DH_ENTITY bind_entity;
+    std::string bind_authorization_value;
+    bool enable_encryption;
+    HmacAuthorizationDelegate* delegate;
+    TPM2B_NONCE nonce_caller;
+    std::string salt;
+    bool used_cached_key;
+    bool retried;
+    StartSessionCallback callback;
+  };
+
+  // Takes a pregenerated salt or creates a fresh one for the salting key. The
+  // plaintext salt is returned in |salt|.
+  TPM_RC EncryptNewSalt(std::string* salt,
+                        TPM2B_ENCRYPTED_SECRET* encrypted_secret,
+                        bool* used_cached_key);
+
+  // Encrypts a fresh salt and issues TPM2_StartAuthSession. On success the
+  // plaintext salt and the TPM nonce are returned in |salt| and |nonce_tpm|.
+  TPM_RC StartAuthSession(TPM_SE session_type,
+                          TPMI_DH_ENTITY bind_entity,
+                          const TPM2B_NONCE& nonce_caller,
+                          std::string* salt,
+                          TPM2B_NONCE* nonce_tpm,
+                          bool* used_cached_key);
+
+  // Encrypts a fresh salt and sends TPM2_StartAuthSession without waiting
+  // for the response, which is handled by OnStartAuthSession().
+  void SendStartAuthSession(AsyncStart start);
+
+  void OnStartAuthSession(const AsyncStart& start,
+                          TPM_RC result,
+                          const TPMI_SH_AUTH_SESSION& session_handle,
+                          const TPM2B_NONCE& nonce_tpm);
 
   // This factory is only set in the constructor and is used to instantiate
   // The TPM class to forward commands to the TPM chip.
@@ -61,6 +187,12 @@ class TRUNKS_EXPORT SessionManagerImpl : public SessionManager {
   // the session handle, so that we can clean it up when this class is
   // destroyed.
   TPM_HANDLE session_handle_;
+  // Used when no shared cache is given to the constructor.
+  std::unique_ptr<SaltingKeyCache> own_salting_key_cache_;
+  SaltingKeyCache* salting_key_cache_;
+
+  // Declared last so that weak pointers are invalidated first.
+  base::WeakPtrFactory<SessionManagerImpl> weak_factory_{this};
 
   friend class SessionManagerTest;
   DISALLOW_COPY_AND_ASSIGN(SessionManagerImpl);
@@ -18,10 +18,17 @@
 
 #include <vector>
 
+#include <base/bind.h>
 #include <base/logging.h>
 #include <base/strings/string_number_conversions.h>
+#include <crypto/sha2.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ec_key.h>
+#include <openssl/ecdh.h>
+#include <openssl/nid.h>
 
 #include "trunks/error_codes.h"
 #include "trunks/mock_tpm.h"
@@ -33,8 +40,17 @@ using testing::_;
 using testing::DoAll;
 using testing::NiceMock;
 using testing::Return;
+using testing::SaveArg;
 using testing::SetArgPointee;
 
+namespace {
+
+void SaveResult(trunks::TPM_RC* result_out, trunks::TPM_RC result) {
+  *result_out = result;
+}
+
+}  // namespace
+
 namespace trunks {
 
 class SessionManagerTest : public testing::Test {
@@ -164,4 +180,203 @@ TEST_F(SessionManagerTest, StartSessionBadNonce) {
                                 session_type, handle, "", false, delegate_));
 }
 
+TEST_F(SessionManagerTest, SharedCacheReadsSaltingKeyOnce) {
+  TPM2B_PUBLIC public_data;
+  public_data.public_area.type = TPM_ALG_RSA;
+  public_data.public_area.unique.rsa = GetValidRSAPublicKey();
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(kSaltingKey, _, _, _, _, nullptr))
+      .WillOnce(DoAll(SetArgPointee<2>(public_data), Return(TPM_RC_SUCCESS)));
+  TPM2B_NONCE nonce;
+  nonce.size = 20;
+  EXPECT_CALL(mock_tpm_,
+              StartAuthSessionSyncShort(_, TPM_RH_NULL, _, _, _, _, _, _, _, _))
+      .Times(2)
+      .WillRepeatedly(DoAll(SetArgPointee<8>(nonce), Return(TPM_RC_SUCCESS)));
+  SaltingKeyCache cache;
+  SessionManagerImpl first(factory_, &cache);
+  SessionManagerImpl second(factory_, &cache);
+  EXPECT_EQ(TPM_RC_SUCCESS, first.StartSession(TPM_SE_HMAC, TPM_RH_NULL, "",
+                                               false, delegate_));
+  EXPECT_EQ(TPM_RC_SUCCESS, second.StartSession(TPM_SE_HMAC, TPM_RH_NULL, "",
+                                                false, delegate_));
+}
+
+TEST_F(SessionManagerTest, PregeneratedSaltIsUsed) {
+  TPM2B_PUBLIC public_data;
+  public_data.public_area.type = TPM_ALG_RSA;
+  public_data.public_area.unique.rsa = GetValidRSAPublicKey();
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(kSaltingKey, _, _, _, _, nullptr))
+      .WillOnce(DoAll(SetArgPointee<2>(public_data), Return(TPM_RC_SUCCESS)));
+  SaltingKeyCache cache;
+  EXPECT_EQ(TPM_RC_SUCCESS, cache.PregenerateSalts(&mock_tpm_, 2));
+  std::string salt;
+  std::string encrypted_salt;
+  EXPECT_TRUE(cache.TakeSalt(&salt, &encrypted_salt));
+  EXPECT_EQ(32u, salt.size());
+  EXPECT_EQ(256u, encrypted_salt.size());
+  TPM2B_ENCRYPTED_SECRET encrypted_secret;
+  TPM2B_NONCE nonce;
+  nonce.size = 20;
+  EXPECT_CALL(mock_tpm_,
+              StartAuthSessionSyncShort(_, TPM_RH_NULL, _, _, _, _, _, _, _, _))
+      .WillOnce(DoAll(SaveArg<3>(&encrypted_secret), SetArgPointee<8>(nonce),
+                      Return(TPM_RC_SUCCESS)));
+  SessionManagerImpl session_manager(factory_, &cache);
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            session_manager.StartSession(TPM_SE_HMAC, TPM_RH_NULL, "", false,
+                                         delegate_));
+  // The session used the remaining pregenerated salt.
+  EXPECT_FALSE(cache.TakeSalt(&salt, &encrypted_salt));
+  EXPECT_EQ(256u, encrypted_secret.size);
+  cache.PregenerateSalts(&mock_tpm_, 1);
+  cache.Invalidate();
+  EXPECT_FALSE(cache.TakeSalt(&salt, &encrypted_salt));
+}
+
+TEST_F(SessionManagerTest, ECCSaltingKeyDerivesSalt) {
+  bssl::UniquePtr<EC_KEY> key(EC_KEY_new_by_curve_name(NID_X9_62_prime256v1));
+  ASSERT_TRUE(EC_KEY_generate_key(key.get()));
+  bssl::UniquePtr<BIGNUM> x(BN_new());
+  bssl::UniquePtr<BIGNUM> y(BN_new());
+  ASSERT_TRUE(EC_POINT_get_affine_coordinates_GFp(
+      EC_KEY_get0_group(key.get()), EC_KEY_get0_public_key(key.get()),
+      x.get(), y.get(), nullptr));
+  TPM2B_PUBLIC public_data;
+  public_data.public_area.type = TPM_ALG_ECC;
+  public_data.public_area.parameters.ecc_detail.curve_id = TPM_ECC_NIST_P256;
+  public_data.public_area.unique.ecc.x.size = 32;
+  BN_bn2bin_padded(public_data.public_area.unique.ecc.x.buffer, 32, x.get());
+  public_data.public_area.unique.ecc.y.size = 32;
+  BN_bn2bin_padded(public_data.public_area.unique.ecc.y.buffer, 32, y.get());
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(kSaltingKey, _, _, _, _, nullptr))
+      .WillOnce(DoAll(SetArgPointee<2>(public_data), Return(TPM_RC_SUCCESS)));
+  SaltingKeyCache cache;
+  std::string salt;
+  std::string encrypted_salt;
+  bool used_cached_key = true;
+  EXPECT_EQ(TPM_RC_SUCCESS, cache.CreateSalt(&mock_tpm_, &salt, &encrypted_salt,
+                                             &used_cached_key));
+  EXPECT_FALSE(used_cached_key);
+  // Recover the salt the way the TPM does, from the ephemeral point.
+  TPMS_ECC_POINT point;
+  ASSERT_EQ(TPM_RC_SUCCESS,
+            Parse_TPMS_ECC_POINT(&encrypted_salt, &point, nullptr));
+  EXPECT_TRUE(encrypted_salt.empty());
+  const EC_GROUP* group = EC_KEY_get0_group(key.get());
+  bssl::UniquePtr<EC_POINT> ephemeral_point(EC_POINT_new(group));
+  bssl::UniquePtr<BIGNUM> ephemeral_x(
+      BN_bin2bn(point.x.buffer, point.x.size, nullptr));
+  bssl::UniquePtr<BIGNUM> ephemeral_y(
+      BN_bin2bn(point.y.buffer, point.y.size, nullptr));
+  ASSERT_TRUE(EC_POINT_set_affine_coordinates_GFp(
+      group, ephemeral_point.get(), ephemeral_x.get(), ephemeral_y.get(),
+      nullptr));
+  std::string z(32, 0);
+  ASSERT_EQ(32, ECDH_compute_key(&z[0], z.size(), ephemeral_point.get(),
+                                 key.get(), nullptr));
+  std::string kdf_input("\0\0\0\1", 4);
+  kdf_input += z;
+  kdf_input += std::string("SECRET", 7);
+  kdf_input += StringFrom_TPM2B_ECC_PARAMETER(point.x);
+  kdf_input +=
+      StringFrom_TPM2B_ECC_PARAMETER(public_data.public_area.unique.ecc.x);
+  EXPECT_EQ(crypto::SHA256HashString(kdf_input), salt);
+  // Each salt uses a fresh ephemeral key.
+  EXPECT_EQ(TPM_RC_SUCCESS, cache.CreateSalt(&mock_tpm_, &salt, &encrypted_salt,
+                                             &used_cached_key));
+  EXPECT_TRUE(used_cached_key);
+  EXPECT_NE(crypto::SHA256HashString(kdf_input), salt);
+}
+
+TEST_F(SessionManagerTest, StaleSaltingKeyIsReloaded) {
+  TPM2B_PUBLIC public_data;
+  public_data.public_area.type = TPM_ALG_RSA;
+  public_data.public_area.unique.rsa = GetValidRSAPublicKey();
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(kSaltingKey, _, _, _, _, nullptr))
+      .Times(2)
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(public_data), Return(TPM_RC_SUCCESS)));
+  TPM2B_NONCE nonce;
+  nonce.size = 20;
+  EXPECT_CALL(mock_tpm_,
+              StartAuthSessionSyncShort(_, TPM_RH_NULL, _, _, _, _, _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<8>(nonce), Return(TPM_RC_SUCCESS)))
+      .WillOnce(Return(TPM_RC_VALUE))
+      .WillOnce(DoAll(SetArgPointee<8>(nonce), Return(TPM_RC_SUCCESS)));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            session_manager_.StartSession(TPM_SE_HMAC, TPM_RH_NULL, "", false,
+                                          delegate_));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            session_manager_.StartSession(TPM_SE_HMAC, TPM_RH_NULL, "", false,
+                                          delegate_));
+}
+
+TEST_F(SessionManagerTest, StartSessionAsyncSuccess) {
+  TPM2B_PUBLIC public_data;
+  public_data.public_area.type = TPM_ALG_RSA;
+  public_data.public_area.unique.rsa = GetValidRSAPublicKey();
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(kSaltingKey, _, _, _, _, nullptr))
+      .WillOnce(DoAll(SetArgPointee<2>(public_data), Return(TPM_RC_SUCCESS)));
+  Tpm::StartAuthSessionResponse response;
+  EXPECT_CALL(mock_tpm_,
+              StartAuthSessionShort(_, TPM_RH_NULL, _, _, TPM_SE_HMAC, _, _,
+                                    nullptr, _))
+      .WillOnce(SaveArg<8>(&response));
+  TPM_RC result = TPM_RC_FAILURE;
+  session_manager_.StartSessionAsync(TPM_SE_HMAC, TPM_RH_NULL, "", false,
+                                     delegate_,
+                                     base::Bind(&SaveResult, &result));
+  EXPECT_EQ(TPM_RC_FAILURE, result);
+  EXPECT_EQ(kUninitializedHandle, session_manager_.GetSessionHandle());
+  TPM_HANDLE handle = HMAC_SESSION_FIRST;
+  TPM2B_NONCE nonce;
+  nonce.size = 20;
+  response.Run(TPM_RC_SUCCESS, handle, nonce);
+  EXPECT_EQ(TPM_RC_SUCCESS, result);
+  EXPECT_EQ(handle, session_manager_.GetSessionHandle());
+}
+
+TEST_F(SessionManagerTest, StartSessionAsyncFailure) {
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(kSaltingKey, _, _, _, _, nullptr))
+      .WillOnce(Return(TPM_RC_FAILURE));
+  EXPECT_CALL(mock_tpm_, StartAuthSessionShort(_, _, _, _, _, _, _, _, _))
+      .Times(0);
+  TPM_RC result = TPM_RC_SUCCESS;
+  session_manager_.StartSessionAsync(TPM_SE_HMAC, TPM_RH_NULL, "", false,
+                                     delegate_,
+                                     base::Bind(&SaveResult, &result));
+  EXPECT_EQ(TPM_RC_FAILURE, result);
+}
+
+TEST_F(SessionManagerTest, StartSessionAsyncReloadsStaleSaltingKey) {
+  TPM2B_PUBLIC public_data;
+  public_data.public_area.type = TPM_ALG_RSA;
+  public_data.public_area.unique.rsa = GetValidRSAPublicKey();
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(kSaltingKey, _, _, _, _, nullptr))
+      .Times(2)
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(public_data), Return(TPM_RC_SUCCESS)));
+  TPM2B_NONCE nonce;
+  nonce.size = 20;
+  EXPECT_CALL(mock_tpm_,
+              StartAuthSessionSyncShort(_, TPM_RH_NULL, _, _, _, _, _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<8>(nonce), Return(TPM_RC_SUCCESS)));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            session_manager_.StartSession(TPM_SE_HMAC, TPM_RH_NULL, "", false,
+                                          delegate_));
+  Tpm::StartAuthSessionResponse first_response;
+  Tpm::StartAuthSessionResponse second_response;
+  EXPECT_CALL(mock_tpm_, StartAuthSessionShort(_, _, _, _, _, _, _, _, _))
+      .WillOnce(SaveArg<8>(&first_response))
+      .WillOnce(SaveArg<8>(&second_response));
+  TPM_RC result = TPM_RC_FAILURE;
+  session_manager_.StartSessionAsync(TPM_SE_HMAC, TPM_RH_NULL, "", false,
+                                     delegate_,
+                                     base::Bind(&SaveResult, &result));
+  first_response.Run(TPM_RC_VALUE, 0, nonce);
+  EXPECT_EQ(TPM_RC_FAILURE, result);
+  second_response.Run(TPM_RC_SUCCESS, HMAC_SESSION_FIRST, nonce);
+  EXPECT_EQ(TPM_RC_SUCCESS, result);
+}
+
 }  // namespace trunks
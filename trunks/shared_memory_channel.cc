@@ -0,0 +1,155 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/shared_memory_channel.h"
+
+#include <fcntl.h>
+#include <linux/memfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <base/bind.h>
+#include <base/location.h>
+#include <base/logging.h>
+#include <base/posix/eintr_wrapper.h>
+#include <base/threading/thread_task_runner_handle.h>
+
+#include "trunks/error_codes.h"
+
+namespace {
+
+const char kSharedChannelMemoryName[] = "trunks_channel";
+const int kRequiredSeals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+const int kInvalidFileDescriptor = -1;
+
+}  // namespace
+
+namespace trunks {
+
+int CreateSharedChannelMemory() {
+  int fd = syscall(__NR_memfd_create, kSharedChannelMemoryName,
+                   MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0) {
+    PLOG(ERROR) << "Failed to create shared channel memory.";
+    return kInvalidFileDescriptor;
+  }
+  if (HANDLE_EINTR(ftruncate(fd, sizeof(SharedChannelBuffer))) != 0 ||
+      fcntl(fd, F_ADD_SEALS, kRequiredSeals) != 0) {
+    PLOG(ERROR) << "Failed to size shared channel memory.";
+    IGNORE_EINTR(close(fd));
+    return kInvalidFileDescriptor;
+  }
+  return fd;
+}
+
+SharedChannelBuffer* MapSharedChannelMemory(int memory_fd) {
+  // Without seals the peer could shrink the memory and fault us with SIGBUS.
+  int seals = fcntl(memory_fd, F_GET_SEALS);
+  if (seals < 0 || (seals & kRequiredSeals) != kRequiredSeals) {
+    LOG(ERROR) << "Shared channel memory is not sealed.";
+    return nullptr;
+  }
+  struct stat memory_stat;
+  if (fstat(memory_fd, &memory_stat) != 0 ||
+      memory_stat.st_size != sizeof(SharedChannelBuffer)) {
+    LOG(ERROR) << "Shared channel memory has an unexpected size.";
+    return nullptr;
+  }
+  void* address = mmap(nullptr, sizeof(SharedChannelBuffer),
+                       PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd, 0);
+  if (address == MAP_FAILED) {
+    PLOG(ERROR) << "Failed to map shared channel memory.";
+    return nullptr;
+  }
+  return static_cast<SharedChannelBuffer*>(address);
+}
+
+void UnmapSharedChannelMemory(SharedChannelBuffer* buffer) {
+  if (buffer) {
+    munmap(buffer, sizeof(SharedChannelBuffer));
+  }
+}
+
+SharedMemoryChannelService::SharedMemoryChannelService(
+    int memory_fd,
+    int doorbell_fd,
+    const std::string& client,
+    CommandTransceiver* transceiver,
+    const base::Closure& disconnect_callback)
+    : memory_fd_(memory_fd),
+      doorbell_fd_(doorbell_fd),
+      client_(client),
+      transceiver_(transceiver),
+      disconnect_callback_(disconnect_callback),
+      weak_factory_(this) {}
+
+SharedMemoryChannelService::~SharedMemoryChannelService() {
+  doorbell_watcher_.StopWatchingFileDescriptor();
+  UnmapSharedChannelMemory(buffer_);
+  IGNORE_EINTR(close(memory_fd_));
+  IGNORE_EINTR(close(doorbell_fd_));
+}
+
+bool SharedMemoryChannelService::Init() {
+  buffer_ = MapSharedChannelMemory(memory_fd_);
+  if (!buffer_) {
+    return false;
+  }
+  return base::MessageLoopForIO::current()->WatchFileDescriptor(
+      doorbell_fd_, true /* persistent */, base::MessageLoopForIO::WATCH_READ,
+      &doorbell_watcher_, this);
+}
+
+void SharedMemoryChannelService::OnFileCanReadWithoutBlocking(int fd) {
+  char doorbell;
+  if (HANDLE_EINTR(read(doorbell_fd_, &doorbell, 1)) != 1) {
+    VLOG(1) << "Shared memory channel closed by client.";
+    doorbell_watcher_.StopWatchingFileDescriptor();
+    base::ThreadTaskRunnerHandle::Get()->PostTask(FROM_HERE,
+                                                  disconnect_callback_);
+    return;
+  }
+  // The client can modify shared memory at any time so the size is read once
+  // and the command is copied out before it is validated or used.
+  uint32_t size = buffer_->command.size;
+  if (size == 0 || size > kSharedChannelMaxFrameSize) {
+    LOG(ERROR) << "Shared memory channel: Invalid command size: " << size;
+    OnResponse(CreateErrorResponse(SAPI_RC_BAD_PARAMETER));
+    return;
+  }
+  std::string command(reinterpret_cast<const char*>(buffer_->command.data),
+                      size);
+  transceiver_->SendCommandForClient(
+      client_, command,
+      base::Bind(&SharedMemoryChannelService::OnResponse, GetWeakPtr()));
+}
+
+void SharedMemoryChannelService::OnResponse(const std::string& response) {
+  if (response.size() > kSharedChannelMaxFrameSize) {
+    OnResponse(CreateErrorResponse(SAPI_RC_INSUFFICIENT_BUFFER));
+    return;
+  }
+  memcpy(buffer_->response.data, response.data(), response.size());
+  buffer_->response.size = response.size();
+  char doorbell = 0;
+  if (HANDLE_EINTR(write(doorbell_fd_, &doorbell, 1)) != 1) {
+    PLOG(WARNING) << "Shared memory channel: Failed to notify client.";
+  }
+}
+
+}  // namespace trunks
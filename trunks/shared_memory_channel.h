@@ -0,0 +1,114 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TRUNKS_SHARED_MEMORY_CHANNEL_H_
+#define TRUNKS_SHARED_MEMORY_CHANNEL_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include <base/callback.h>
+#include <base/macros.h>
+#include <base/memory/weak_ptr.h>
+#include <base/message_loop/message_loop.h>
+
+#include "trunks/command_transceiver.h"
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+// The largest command or response frame which fits in a shared channel. This
+// matches the TPM buffer size used by TpmHandle.
+const uint32_t kSharedChannelMaxFrameSize = 4096;
+
+// A single TPM command or response.
+struct SharedChannelFrame {
+  uint32_t size;
+  uint8_t data[kSharedChannelMaxFrameSize];
+};
+
+// The layout of the memory shared between a client and trunksd. A channel
+// carries one command at a time: the client writes |command| and rings the
+// doorbell, trunksd writes |response| and rings the doorbell back.
+struct SharedChannelBuffer {
+  SharedChannelFrame command;
+  SharedChannelFrame response;
+};
+
+// Creates a sealed memfd sized for a SharedChannelBuffer. Returns the file
+// descriptor or -1 on failure. The caller takes ownership.
+TRUNKS_EXPORT int CreateSharedChannelMemory();
+
+// Validates and maps memory created by CreateSharedChannelMemory. Returns
+// nullptr if |memory_fd| is not suitable, e.g. the size is not sealed. The
+// caller must unmap the result with UnmapSharedChannelMemory.
+TRUNKS_EXPORT SharedChannelBuffer* MapSharedChannelMemory(int memory_fd);
+
+// Unmaps a |buffer| returned by MapSharedChannelMemory.
+TRUNKS_EXPORT void UnmapSharedChannelMemory(SharedChannelBuffer* buffer);
+
+// The trunksd end of a shared memory channel. Commands written by the client
+// are forwarded to a CommandTransceiver and the responses are written back to
+// shared memory. The doorbell is a connected socket so a client exiting is
+// noticed as a hangup. This class must be used on a thread with a
+// MessageLoopForIO.
+class SharedMemoryChannelService : public base::MessageLoopForIO::Watcher {
+ public:
+  // Takes ownership of |memory_fd| and |doorbell_fd|. Commands are sent to
+  // |transceiver| on behalf of |client|; the |transceiver| must outlive this
+  // object. The |disconnect_callback| is posted to the current thread when the
+  // client hangs up; it is safe to delete this object from the callback.
+  SharedMemoryChannelService(int memory_fd,
+                             int doorbell_fd,
+                             const std::string& client,
+                             CommandTransceiver* transceiver,
+                             const base::Closure& disconnect_callback);
+  ~SharedMemoryChannelService() override;
+
+  // Maps the shared memory and starts watching the doorbell. Returns true on
+  // success.
+  bool Init();
+
+  // base::MessageLoopForIO::Watcher methods.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override {}
+
+ private:
+  // Writes a |response| to shared memory and rings the doorbell.
+  void OnResponse(const std::string& response);
+
+  base::WeakPtr<SharedMemoryChannelService> GetWeakPtr() {
+    return weak_factory_.GetWeakPtr();
+  }
+
+  int memory_fd_;
+  int doorbell_fd_;
+  std::string client_;
+  CommandTransceiver* transceiver_;
+  base::Closure disconnect_callback_;
+  SharedChannelBuffer* buffer_ = nullptr;
+  base::MessageLoopForIO::FileDescriptorWatcher doorbell_watcher_;
+
+  // Declared last so weak pointers are invalidated first on destruction.
+  base::WeakPtrFactory<SharedMemoryChannelService> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedMemoryChannelService);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_SHARED_MEMORY_CHANNEL_H_
@@ -0,0 +1,138 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/shared_memory_channel.h"
+
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <base/bind.h>
+#include <base/message_loop/message_loop.h>
+#include <base/run_loop.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/mock_command_transceiver.h"
+
+using testing::_;
+using testing::Invoke;
+using testing::StrictMock;
+
+namespace {
+
+void SetTrue(bool* value) {
+  *value = true;
+}
+
+}  // namespace
+
+namespace trunks {
+
+class SharedMemoryChannelTest : public testing::Test {
+ public:
+  SharedMemoryChannelTest() {}
+  ~SharedMemoryChannelTest() override {}
+
+  void SetUp() override {
+    int sockets[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets));
+    client_doorbell_fd_ = sockets[0];
+    client_memory_fd_ = CreateSharedChannelMemory();
+    ASSERT_GE(client_memory_fd_, 0);
+    client_buffer_ = MapSharedChannelMemory(client_memory_fd_);
+    ASSERT_TRUE(client_buffer_);
+    service_.reset(new SharedMemoryChannelService(
+        dup(client_memory_fd_), sockets[1], ":1.1", &transceiver_,
+        base::Bind(SetTrue, &disconnected_)));
+    ASSERT_TRUE(service_->Init());
+  }
+
+  void TearDown() override {
+    service_.reset();
+    UnmapSharedChannelMemory(client_buffer_);
+    close(client_memory_fd_);
+    if (client_doorbell_fd_ >= 0) {
+      close(client_doorbell_fd_);
+    }
+  }
+
+ protected:
+  // Writes a |command| to shared memory and rings the doorbell.
+  void SendCommand(const std::string& command) {
+    memcpy(client_buffer_->command.data, command.data(), command.size());
+    client_buffer_->command.size = command.size();
+    char doorbell = 0;
+    ASSERT_EQ(1, write(client_doorbell_fd_, &doorbell, 1));
+  }
+
+  std::string GetResponse() {
+    char doorbell;
+    EXPECT_EQ(1, read(client_doorbell_fd_, &doorbell, 1));
+    return std::string(
+        reinterpret_cast<const char*>(client_buffer_->response.data),
+        client_buffer_->response.size);
+  }
+
+  base::MessageLoopForIO message_loop_;
+  StrictMock<MockCommandTransceiver> transceiver_;
+  std::unique_ptr<SharedMemoryChannelService> service_;
+  int client_memory_fd_ = -1;
+  int client_doorbell_fd_ = -1;
+  SharedChannelBuffer* client_buffer_ = nullptr;
+  bool disconnected_ = false;
+};
+
+TEST_F(SharedMemoryChannelTest, RoundTrip) {
+  EXPECT_CALL(transceiver_, SendCommand("command", _))
+      .WillOnce(Invoke(
+          [](const std::string& command,
+             const CommandTransceiver::ResponseCallback& callback) {
+            callback.Run("response");
+          }));
+  SendCommand("command");
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ("response", GetResponse());
+}
+
+TEST_F(SharedMemoryChannelTest, BadCommandSize) {
+  client_buffer_->command.size = kSharedChannelMaxFrameSize + 1;
+  char doorbell = 0;
+  ASSERT_EQ(1, write(client_doorbell_fd_, &doorbell, 1));
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(CreateErrorResponse(SAPI_RC_BAD_PARAMETER), GetResponse());
+}
+
+TEST_F(SharedMemoryChannelTest, Disconnect) {
+  close(client_doorbell_fd_);
+  client_doorbell_fd_ = -1;
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(disconnected_);
+}
+
+TEST_F(SharedMemoryChannelTest, UnsealedMemory) {
+  // Plain files can't be sealed so they are always rejected.
+  char path[] = "/tmp/trunks_channel_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  unlink(path);
+  ASSERT_EQ(0, ftruncate(fd, sizeof(SharedChannelBuffer)));
+  EXPECT_EQ(nullptr, MapSharedChannelMemory(fd));
+  close(fd);
+}
+
+}  // namespace trunks
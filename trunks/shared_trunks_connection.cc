@@ -0,0 +1,205 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/shared_trunks_connection.h"
+
+#include <utility>
+
+#include <base/bind.h>
+#include <base/lazy_instance.h>
+#include <base/location.h>
+#include <base/logging.h>
+#include <base/message_loop/message_loop.h>
+#include <base/synchronization/waitable_event.h>
+
+#include "trunks/background_command_transceiver.h"
+#if defined(USE_BINDER_IPC)
+#include "trunks/trunks_binder_proxy.h"
+#else
+#include "trunks/trunks_dbus_proxy.h"
+#endif
+
+namespace {
+
+const char kIpcThreadName[] = "trunks_shared_ipc";
+
+struct Registry {
+  base::Lock lock;
+  // Not owned, so the connection closes with its last user.
+  std::weak_ptr<trunks::SharedTrunksConnection> connection;
+  trunks::SharedTrunksConnection::TransceiverFactory transceiver_factory;
+};
+
+base::LazyInstance<Registry>::Leaky g_registry = LAZY_INSTANCE_INITIALIZER;
+
+void RunAndSignal(const base::Closure& task, base::WaitableEvent* done) {
+  task.Run();
+  done->Signal();
+}
+
+// Runs |task| on the IPC thread and waits for it to finish.
+void RunOnThreadAndWait(
+    const scoped_refptr<base::SingleThreadTaskRunner>& task_runner,
+    const base::Closure& task) {
+  base::WaitableEvent done(base::WaitableEvent::ResetPolicy::MANUAL,
+                           base::WaitableEvent::InitialState::NOT_SIGNALED);
+  task_runner->PostTask(FROM_HERE, base::Bind(&RunAndSignal, task, &done));
+  done.Wait();
+}
+
+void InitTransceiver(trunks::CommandTransceiver* transceiver, bool* result) {
+  *result = transceiver->Init();
+}
+
+#if !defined(USE_BINDER_IPC)
+void GetCapabilitySnapshotOnIpcThread(trunks::TrunksDBusProxy* proxy,
+                                      trunks::CapabilitySnapshot* snapshot,
+                                      bool* result) {
+  *result = proxy->GetCapabilitySnapshot(snapshot);
+}
+
+void LearnCommandTimeoutsOnIpcThread(trunks::TrunksDBusProxy* proxy) {
+  proxy->LearnCommandTimeouts();
+}
+
+void GetLastStateEpochsOnIpcThread(const trunks::TrunksDBusProxy* proxy,
+                                   trunks::TpmStateEpochs* epochs,
+                                   bool* result) {
+  *result = proxy->GetLastStateEpochs(epochs);
+}
+#endif
+
+}  // namespace
+
+namespace trunks {
+
+SharedTrunksConnection::SharedTrunksConnection(
+    std::unique_ptr<CommandTransceiver> transceiver,
+    TrunksDBusProxy* dbus_proxy)
+    : ipc_thread_(kIpcThreadName),
+      transceiver_(std::move(transceiver)),
+      dbus_proxy_(dbus_proxy) {
+  // The D-Bus proxy watches its connection from the thread it runs on.
+  CHECK(ipc_thread_.StartWithOptions(
+      base::Thread::Options(base::MessageLoop::TYPE_IO, 0)))
+      << "Failed to start the shared trunks IPC thread.";
+  background_transceiver_.reset(new BackgroundCommandTransceiver(
+      transceiver_.get(), ipc_thread_.task_runner()));
+}
+
+SharedTrunksConnection::~SharedTrunksConnection() {
+  DCHECK(!ipc_thread_.task_runner()->BelongsToCurrentThread());
+  background_transceiver_.reset();
+  // The proxy has to be shut down on the thread it was initialized on.
+  dbus_proxy_ = nullptr;
+  ipc_thread_.task_runner()->DeleteSoon(FROM_HERE, transceiver_.release());
+  ipc_thread_.Stop();
+}
+
+// static
+std::shared_ptr<SharedTrunksConnection> SharedTrunksConnection::Get() {
+  Registry& registry = g_registry.Get();
+  base::AutoLock lock(registry.lock);
+  std::shared_ptr<SharedTrunksConnection> connection =
+      registry.connection.lock();
+  if (connection) {
+    return connection;
+  }
+  std::unique_ptr<CommandTransceiver> transceiver;
+  TrunksDBusProxy* dbus_proxy = nullptr;
+  if (!registry.transceiver_factory.is_null()) {
+    transceiver = registry.transceiver_factory.Run();
+  } else {
+#if defined(USE_BINDER_IPC)
+    transceiver.reset(new TrunksBinderProxy());
+#else
+    dbus_proxy = new TrunksDBusProxy();
+    transceiver.reset(dbus_proxy);
+#endif
+  }
+  connection.reset(
+      new SharedTrunksConnection(std::move(transceiver), dbus_proxy));
+  registry.connection = connection;
+  return connection;
+}
+
+// static
+void SharedTrunksConnection::SetTransceiverFactoryForTesting(
+    const TransceiverFactory& factory) {
+  Registry& registry = g_registry.Get();
+  base::AutoLock lock(registry.lock);
+  registry.transceiver_factory = factory;
+}
+
+bool SharedTrunksConnection::Initialize() {
+  // Held across the IPC so concurrent callers wait for the first one instead
+  // of initializing the proxy again.
+  base::AutoLock lock(lock_);
+  if (initialized_) {
+    return true;
+  }
+  RunOnThreadAndWait(ipc_thread_.task_runner(),
+                     base::Bind(&InitTransceiver, transceiver_.get(),
+                                &initialized_));
+  if (!initialized_) {
+    LOG(WARNING) << "Failed to initialize the shared trunks IPC proxy; "
+                 << "trunksd is not ready.";
+    return false;
+  }
+#if !defined(USE_BINDER_IPC)
+  if (dbus_proxy_) {
+    RunOnThreadAndWait(ipc_thread_.task_runner(),
+                       base::Bind(&GetCapabilitySnapshotOnIpcThread,
+                                  dbus_proxy_, &snapshot_, &have_snapshot_));
+    RunOnThreadAndWait(
+        ipc_thread_.task_runner(),
+        base::Bind(&LearnCommandTimeoutsOnIpcThread, dbus_proxy_));
+  }
+#endif
+  return true;
+}
+
+bool SharedTrunksConnection::GetCapabilitySnapshot(
+    CapabilitySnapshot* snapshot) const {
+  base::AutoLock lock(lock_);
+  if (!have_snapshot_) {
+    return false;
+  }
+  *snapshot = snapshot_;
+  return true;
+}
+
+bool SharedTrunksConnection::GetLastStateEpochs(
+    TpmStateEpochs* epochs) const {
+#if defined(USE_BINDER_IPC)
+  return false;
+#else
+  {
+    base::AutoLock lock(lock_);
+    if (!initialized_ || !dbus_proxy_) {
+      return false;
+    }
+  }
+  // The proxy records the epochs on the IPC thread.
+  bool result = false;
+  RunOnThreadAndWait(ipc_thread_.task_runner(),
+                     base::Bind(&GetLastStateEpochsOnIpcThread, dbus_proxy_,
+                                epochs, &result));
+  return result;
+#endif
+}
+
+}  // namespace trunks
@@ -0,0 +1,97 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TRUNKS_SHARED_TRUNKS_CONNECTION_H_
+#define TRUNKS_SHARED_TRUNKS_CONNECTION_H_
+
+#include <memory>
+
+#include <base/callback.h>
+#include <base/macros.h>
+#include <base/synchronization/lock.h>
+#include <base/threading/thread.h>
+
+#include "trunks/command_transceiver.h"
+#include "trunks/interface.pb.h"
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+class TrunksDBusProxy;
+
+// SharedTrunksConnection is the one connection to trunksd shared by every
+// TrunksFactoryImpl of a process which calls UseSharedConnection(). The IPC
+// proxy runs on a dedicated thread and commands may be sent through
+// transceiver() from any thread. The connection lives as long as a factory
+// holds it; the next Get() after the last release opens a new one. This class
+// is thread-safe.
+class TRUNKS_EXPORT SharedTrunksConnection {
+ public:
+  using TransceiverFactory =
+      base::Callback<std::unique_ptr<CommandTransceiver>()>;
+
+  ~SharedTrunksConnection();
+
+  // Returns the connection of this process, creating it if no one holds it.
+  static std::shared_ptr<SharedTrunksConnection> Get();
+
+  // Connections created after this call use a transceiver made by |factory|
+  // instead of the default IPC proxy. A null |factory| restores the default.
+  static void SetTransceiverFactoryForTesting(
+      const TransceiverFactory& factory);
+
+  // Initializes the proxy the first time it is called, and again after a
+  // failure. Returns true once the connection is up.
+  bool Initialize();
+
+  // Copies the capability snapshot fetched from trunksd by Initialize() to
+  // |snapshot|, so later factories skip the round trip. Returns false when no
+  // snapshot is available.
+  bool GetCapabilitySnapshot(CapabilitySnapshot* snapshot) const;
+
+  // Returns the state epochs of the most recent response, as
+  // TrunksFactory::GetLastStateEpochs().
+  bool GetLastStateEpochs(TpmStateEpochs* epochs) const;
+
+  // The transceiver through which commands are sent. It is thread-safe.
+  CommandTransceiver* transceiver() const {
+    return background_transceiver_.get();
+  }
+
+ private:
+  // |dbus_proxy| is |transceiver| if it is the D-Bus proxy, or null.
+  SharedTrunksConnection(std::unique_ptr<CommandTransceiver> transceiver,
+                         TrunksDBusProxy* dbus_proxy);
+
+  // The proxy is initialized, used and destroyed on this thread.
+  base::Thread ipc_thread_;
+  std::unique_ptr<CommandTransceiver> transceiver_;
+  TrunksDBusProxy* dbus_proxy_;
+  // Forwards commands from any thread to |ipc_thread_|.
+  std::unique_ptr<CommandTransceiver> background_transceiver_;
+
+  // Guards the members below.
+  mutable base::Lock lock_;
+  bool initialized_ = false;
+  bool have_snapshot_ = false;
+  CapabilitySnapshot snapshot_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedTrunksConnection);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_SHARED_TRUNKS_CONNECTION_H_
@@ -0,0 +1,158 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/shared_trunks_connection.h"
+
+#include <memory>
+#include <string>
+
+#include <base/bind.h>
+#include <base/location.h>
+#include <base/memory/ptr_util.h>
+#include <base/threading/platform_thread.h>
+#include <base/threading/thread.h>
+#include <gtest/gtest.h>
+
+#include "trunks/command_transceiver.h"
+#include "trunks/trunks_factory_impl.h"
+
+namespace {
+
+// Answers every command with the name of the thread it was sent on.
+class FakeTransceiver : public trunks::CommandTransceiver {
+ public:
+  FakeTransceiver(int* init_count, bool init_result)
+      : init_count_(init_count), init_result_(init_result) {}
+  ~FakeTransceiver() override {}
+
+  bool Init() override {
+    ++*init_count_;
+    return init_result_;
+  }
+
+  void SendCommand(const std::string& command,
+                   const ResponseCallback& callback) override {
+    callback.Run(SendCommandAndWait(command));
+  }
+
+  std::string SendCommandAndWait(const std::string& command) override {
+    return std::string(base::PlatformThread::GetName());
+  }
+
+ private:
+  int* init_count_;
+  bool init_result_;
+};
+
+std::unique_ptr<trunks::CommandTransceiver> CreateFakeTransceiver(
+    int* create_count,
+    int* init_count,
+    bool init_result) {
+  ++*create_count;
+  return base::MakeUnique<FakeTransceiver>(init_count, init_result);
+}
+
+void SendCommandAndAssign(trunks::CommandTransceiver* transceiver,
+                          std::string* output) {
+  *output = transceiver->SendCommandAndWait("test");
+}
+
+}  // namespace
+
+namespace trunks {
+
+class SharedTrunksConnectionTest : public testing::Test {
+ public:
+  ~SharedTrunksConnectionTest() override {
+    SharedTrunksConnection::SetTransceiverFactoryForTesting(
+        SharedTrunksConnection::TransceiverFactory());
+  }
+
+ protected:
+  void UseFakeTransceiver(bool init_result) {
+    SharedTrunksConnection::SetTransceiverFactoryForTesting(
+        base::Bind(&CreateFakeTransceiver, &create_count_, &init_count_,
+                   init_result));
+  }
+
+  int create_count_ = 0;
+  int init_count_ = 0;
+};
+
+TEST_F(SharedTrunksConnectionTest, SameConnectionWhileHeld) {
+  UseFakeTransceiver(true);
+  std::shared_ptr<SharedTrunksConnection> first = SharedTrunksConnection::Get();
+  std::shared_ptr<SharedTrunksConnection> second =
+      SharedTrunksConnection::Get();
+  EXPECT_EQ(first.get(), second.get());
+  EXPECT_EQ(1, create_count_);
+  first.reset();
+  second.reset();
+  std::shared_ptr<SharedTrunksConnection> third = SharedTrunksConnection::Get();
+  ASSERT_TRUE(third);
+  EXPECT_EQ(2, create_count_);
+}
+
+TEST_F(SharedTrunksConnectionTest, InitializeOnce) {
+  UseFakeTransceiver(true);
+  std::shared_ptr<SharedTrunksConnection> connection =
+      SharedTrunksConnection::Get();
+  EXPECT_TRUE(connection->Initialize());
+  EXPECT_TRUE(connection->Initialize());
+  EXPECT_EQ(1, init_count_);
+  CapabilitySnapshot snapshot;
+  EXPECT_FALSE(connection->GetCapabilitySnapshot(&snapshot));
+}
+
+TEST_F(SharedTrunksConnectionTest, InitializeRetriesAfterFailure) {
+  UseFakeTransceiver(false);
+  std::shared_ptr<SharedTrunksConnection> connection =
+      SharedTrunksConnection::Get();
+  EXPECT_FALSE(connection->Initialize());
+  EXPECT_FALSE(connection->Initialize());
+  EXPECT_EQ(2, init_count_);
+}
+
+TEST_F(SharedTrunksConnectionTest, SendFromAnyThread) {
+  UseFakeTransceiver(true);
+  std::shared_ptr<SharedTrunksConnection> connection =
+      SharedTrunksConnection::Get();
+  ASSERT_TRUE(connection->Initialize());
+  EXPECT_EQ("trunks_shared_ipc",
+            connection->transceiver()->SendCommandAndWait("test"));
+  base::Thread thread("test_thread");
+  ASSERT_TRUE(thread.Start());
+  std::string output;
+  thread.task_runner()->PostTask(
+      FROM_HERE, base::Bind(&SendCommandAndAssign, connection->transceiver(),
+                            &output));
+  thread.Stop();
+  EXPECT_EQ("trunks_shared_ipc", output);
+}
+
+TEST_F(SharedTrunksConnectionTest, FactoriesShareConnection) {
+  UseFakeTransceiver(true);
+  TrunksFactoryImpl first;
+  first.UseSharedConnection();
+  TrunksFactoryImpl second;
+  second.UseSharedConnection();
+  EXPECT_TRUE(first.Initialize());
+  EXPECT_TRUE(second.Initialize());
+  EXPECT_EQ(1, create_count_);
+  EXPECT_EQ(1, init_count_);
+}
+
+}  // namespace trunks
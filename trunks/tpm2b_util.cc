@@ -0,0 +1,31 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/tpm2b_util.h"
+
+#include <crypto/secure_util.h>
+
+namespace trunks {
+
+bool TPM2BBuffersSecureEqual(const void* a,
+                             size_t a_size,
+                             const void* b,
+                             size_t b_size) {
+  // Sizes are public, only the contents need a constant time comparison.
+  return a_size == b_size && crypto::SecureMemEqual(a, b, a_size);
+}
+
+}  // namespace trunks
@@ -0,0 +1,60 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TRUNKS_TPM2B_UTIL_H_
+#define TRUNKS_TPM2B_UTIL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+// Byte buffer operations behind the generated TPM2B helpers, e.g.
+// Make_TPM2B_DIGEST and Equal_TPM2B_DIGEST. Each works on a whole buffer at
+// once rather than a byte at a time.
+
+// Copies |size| bytes of |data| into a TPM2B |buffer| which holds |capacity|
+// bytes and zeroes the rest of the buffer. The caller must check that |size|
+// does not exceed |capacity|.
+inline void CopyToTPM2BBuffer(const void* data,
+                              size_t size,
+                              void* buffer,
+                              size_t capacity) {
+  memcpy(buffer, data, size);
+  memset(static_cast<uint8_t*>(buffer) + size, 0, capacity - size);
+}
+
+// Returns true if the buffers have the same size and contents.
+inline bool TPM2BBuffersEqual(const void* a,
+                              size_t a_size,
+                              const void* b,
+                              size_t b_size) {
+  return a_size == b_size && memcmp(a, b, a_size) == 0;
+}
+
+// Like TPM2BBuffersEqual but the time taken does not depend on the contents,
+// so this should be used for secrets like HMACs and authorization values.
+TRUNKS_EXPORT bool TPM2BBuffersSecureEqual(const void* a,
+                                           size_t a_size,
+                                           const void* b,
+                                           size_t b_size);
+
+}  // namespace trunks
+
+#endif  // TRUNKS_TPM2B_UTIL_H_
@@ -19,11 +19,17 @@
 #ifndef TRUNKS_TPM_GENERATED_H_
 #define TRUNKS_TPM_GENERATED_H_
 
+#include <string.h>
+
+#include <array>
 #include <string>
+#include <vector>
 
 #include <base/callback_forward.h>
 #include <base/macros.h>
+#include <base/sys_byteorder.h>
 
+#include "trunks/tpm2b_util.h"
 #include "trunks/trunks_export.h"
 
 namespace trunks {
@@ -1652,126 +1658,779 @@ struct TPM2B_CREATION_DATA {
   TPMS_CREATION_DATA creation_data;
 };
 
+// How long the TPM typically takes to execute a command.
+enum TpmLatencyClass {
+  // Commands which callers typically wait on, e.g. PCR_Read.
+  kTpmLatencyShort,
+  kTpmLatencyNormal,
+  // Commands which may keep the TPM busy for seconds, e.g. key generation.
+  kTpmLatencyLong,
+};
+
+// Static properties of a TPM command for code which handles commands without
+// fully parsing them, e.g. the resource manager.
+struct TpmCommandMetadata {
+  TPM_CC command_code;
+  // The number of handles in the handle area of the command and response.
+  uint8_t request_handles;
+  uint8_t response_handles;
+  // False if the command must be sent with TPM_ST_NO_SESSIONS.
+  bool sessions_allowed;
+  // True if the first command or response parameter is a TPM2B which may
+  // hold a secret, so sessions with parameter encryption encrypt it. Non-secret
+  // TPM2Bs, like the digest passed to Sign, are sent in the clear.
+  bool command_parameter_encryption;
+  bool response_parameter_encryption;
+  // True if the command only reads TPM state so identical commands may share
+  // a single response.
+  bool read_only;
+  TpmLatencyClass latency_class;
+};
+
+// Returns the metadata for |command_code|, or nullptr if it is not a known
+// command. This is a constant time table lookup.
+TRUNKS_EXPORT const TpmCommandMetadata* GetCommandMetadata(TPM_CC command_code);
 TRUNKS_EXPORT size_t GetNumberOfRequestHandles(TPM_CC command_code);
 TRUNKS_EXPORT size_t GetNumberOfResponseHandles(TPM_CC command_code);
 
-TRUNKS_EXPORT TPM_RC Serialize_uint8_t(const uint8_t& value,
-                                       std::string* buffer);
+// A read position within serialized TPM data. Parse_* functions which take a
+// cursor advance it past the bytes they parse; the bytes are never modified or
+// copied so they must outlive the cursor. The Parse_* functions which take a
+// std::string instead erase the parsed bytes from the front of the string.
+class ParseCursor {
+ public:
+  ParseCursor(const char* data, size_t size)
+      : start_(data), next_(data), end_(data + size) {}
+  explicit ParseCursor(const std::string& bytes)
+      : ParseCursor(bytes.data(), bytes.size()) {}
+
+  // Copies the next |size| bytes to |out| and advances past them. Returns false
+  // without advancing if fewer than |size| bytes remain.
+  bool Read(void* out, size_t size) {
+    if (remaining() < size) {
+      return false;
+    }
+    memcpy(out, next_, size);
+    next_ += size;
+    return true;
+  }
+
+  // The next byte to be read.
+  const char* data() const { return next_; }
+  // The number of bytes left to read.
+  size_t remaining() const { return end_ - next_; }
+  // The number of bytes read since the cursor was created.
+  size_t consumed() const { return next_ - start_; }
+
+ private:
+  const char* start_;
+  const char* next_;
+  const char* end_;
+};
+
+// The primitive marshalling functions are defined inline so they can be folded
+// into the generated code which calls them for every field.
+inline TPM_RC Serialize_uint8_t(const uint8_t& value, std::string* buffer) {
+  uint8_t value_net = value;
+  switch (sizeof(uint8_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  const char* value_bytes = reinterpret_cast<const char*>(&value_net);
+  buffer->append(value_bytes, sizeof(uint8_t));
+  return TPM_RC_SUCCESS;
+}
+
+inline TPM_RC Parse_uint8_t(ParseCursor* cursor, uint8_t* value) {
+  uint8_t value_net = 0;
+  if (!cursor->Read(&value_net, sizeof(uint8_t))) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  switch (sizeof(uint8_t)) {
+    case 2:
+      *value = base::NetToHost16(value_net);
+      break;
+    case 4:
+      *value = base::NetToHost32(value_net);
+      break;
+    case 8:
+      *value = base::NetToHost64(value_net);
+      break;
+    default:
+      *value = value_net;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+// Writes |value| to |buffer| and returns the end of the written bytes.
+inline uint8_t* WriteFixed_uint8_t(uint8_t value, uint8_t* buffer) {
+  uint8_t value_net = value;
+  switch (sizeof(uint8_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  memcpy(buffer, &value_net, sizeof(uint8_t));
+  return buffer + sizeof(uint8_t);
+}
+
+inline TPM_RC Serialize_int8_t(const int8_t& value, std::string* buffer) {
+  int8_t value_net = value;
+  switch (sizeof(int8_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  const char* value_bytes = reinterpret_cast<const char*>(&value_net);
+  buffer->append(value_bytes, sizeof(int8_t));
+  return TPM_RC_SUCCESS;
+}
+
+inline TPM_RC Parse_int8_t(ParseCursor* cursor, int8_t* value) {
+  int8_t value_net = 0;
+  if (!cursor->Read(&value_net, sizeof(int8_t))) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  switch (sizeof(int8_t)) {
+    case 2:
+      *value = base::NetToHost16(value_net);
+      break;
+    case 4:
+      *value = base::NetToHost32(value_net);
+      break;
+    case 8:
+      *value = base::NetToHost64(value_net);
+      break;
+    default:
+      *value = value_net;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+// Writes |value| to |buffer| and returns the end of the written bytes.
+inline uint8_t* WriteFixed_int8_t(int8_t value, uint8_t* buffer) {
+  int8_t value_net = value;
+  switch (sizeof(int8_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  memcpy(buffer, &value_net, sizeof(int8_t));
+  return buffer + sizeof(int8_t);
+}
+
+inline TPM_RC Serialize_int(const int& value, std::string* buffer) {
+  int value_net = value;
+  switch (sizeof(int)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  const char* value_bytes = reinterpret_cast<const char*>(&value_net);
+  buffer->append(value_bytes, sizeof(int));
+  return TPM_RC_SUCCESS;
+}
+
+inline TPM_RC Parse_int(ParseCursor* cursor, int* value) {
+  int value_net = 0;
+  if (!cursor->Read(&value_net, sizeof(int))) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  switch (sizeof(int)) {
+    case 2:
+      *value = base::NetToHost16(value_net);
+      break;
+    case 4:
+      *value = base::NetToHost32(value_net);
+      break;
+    case 8:
+      *value = base::NetToHost64(value_net);
+      break;
+    default:
+      *value = value_net;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+// Writes |value| to |buffer| and returns the end of the written bytes.
+inline uint8_t* WriteFixed_int(int value, uint8_t* buffer) {
+  int value_net = value;
+  switch (sizeof(int)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  memcpy(buffer, &value_net, sizeof(int));
+  return buffer + sizeof(int);
+}
+
+inline TPM_RC Serialize_uint16_t(const uint16_t& value, std::string* buffer) {
+  uint16_t value_net = value;
+  switch (sizeof(uint16_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  const char* value_bytes = reinterpret_cast<const char*>(&value_net);
+  buffer->append(value_bytes, sizeof(uint16_t));
+  return TPM_RC_SUCCESS;
+}
+
+inline TPM_RC Parse_uint16_t(ParseCursor* cursor, uint16_t* value) {
+  uint16_t value_net = 0;
+  if (!cursor->Read(&value_net, sizeof(uint16_t))) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  switch (sizeof(uint16_t)) {
+    case 2:
+      *value = base::NetToHost16(value_net);
+      break;
+    case 4:
+      *value = base::NetToHost32(value_net);
+      break;
+    case 8:
+      *value = base::NetToHost64(value_net);
+      break;
+    default:
+      *value = value_net;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+// Writes |value| to |buffer| and returns the end of the written bytes.
+inline uint8_t* WriteFixed_uint16_t(uint16_t value, uint8_t* buffer) {
+  uint16_t value_net = value;
+  switch (sizeof(uint16_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  memcpy(buffer, &value_net, sizeof(uint16_t));
+  return buffer + sizeof(uint16_t);
+}
+
+inline TPM_RC Serialize_int16_t(const int16_t& value, std::string* buffer) {
+  int16_t value_net = value;
+  switch (sizeof(int16_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  const char* value_bytes = reinterpret_cast<const char*>(&value_net);
+  buffer->append(value_bytes, sizeof(int16_t));
+  return TPM_RC_SUCCESS;
+}
+
+inline TPM_RC Parse_int16_t(ParseCursor* cursor, int16_t* value) {
+  int16_t value_net = 0;
+  if (!cursor->Read(&value_net, sizeof(int16_t))) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  switch (sizeof(int16_t)) {
+    case 2:
+      *value = base::NetToHost16(value_net);
+      break;
+    case 4:
+      *value = base::NetToHost32(value_net);
+      break;
+    case 8:
+      *value = base::NetToHost64(value_net);
+      break;
+    default:
+      *value = value_net;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+// Writes |value| to |buffer| and returns the end of the written bytes.
+inline uint8_t* WriteFixed_int16_t(int16_t value, uint8_t* buffer) {
+  int16_t value_net = value;
+  switch (sizeof(int16_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  memcpy(buffer, &value_net, sizeof(int16_t));
+  return buffer + sizeof(int16_t);
+}
+
+inline TPM_RC Serialize_uint32_t(const uint32_t& value, std::string* buffer) {
+  uint32_t value_net = value;
+  switch (sizeof(uint32_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  const char* value_bytes = reinterpret_cast<const char*>(&value_net);
+  buffer->append(value_bytes, sizeof(uint32_t));
+  return TPM_RC_SUCCESS;
+}
+
+inline TPM_RC Parse_uint32_t(ParseCursor* cursor, uint32_t* value) {
+  uint32_t value_net = 0;
+  if (!cursor->Read(&value_net, sizeof(uint32_t))) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  switch (sizeof(uint32_t)) {
+    case 2:
+      *value = base::NetToHost16(value_net);
+      break;
+    case 4:
+      *value = base::NetToHost32(value_net);
+      break;
+    case 8:
+      *value = base::NetToHost64(value_net);
+      break;
+    default:
+      *value = value_net;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+// Writes |value| to |buffer| and returns the end of the written bytes.
+inline uint8_t* WriteFixed_uint32_t(uint32_t value, uint8_t* buffer) {
+  uint32_t value_net = value;
+  switch (sizeof(uint32_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  memcpy(buffer, &value_net, sizeof(uint32_t));
+  return buffer + sizeof(uint32_t);
+}
+
+inline TPM_RC Serialize_int32_t(const int32_t& value, std::string* buffer) {
+  int32_t value_net = value;
+  switch (sizeof(int32_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  const char* value_bytes = reinterpret_cast<const char*>(&value_net);
+  buffer->append(value_bytes, sizeof(int32_t));
+  return TPM_RC_SUCCESS;
+}
+
+inline TPM_RC Parse_int32_t(ParseCursor* cursor, int32_t* value) {
+  int32_t value_net = 0;
+  if (!cursor->Read(&value_net, sizeof(int32_t))) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  switch (sizeof(int32_t)) {
+    case 2:
+      *value = base::NetToHost16(value_net);
+      break;
+    case 4:
+      *value = base::NetToHost32(value_net);
+      break;
+    case 8:
+      *value = base::NetToHost64(value_net);
+      break;
+    default:
+      *value = value_net;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+// Writes |value| to |buffer| and returns the end of the written bytes.
+inline uint8_t* WriteFixed_int32_t(int32_t value, uint8_t* buffer) {
+  int32_t value_net = value;
+  switch (sizeof(int32_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  memcpy(buffer, &value_net, sizeof(int32_t));
+  return buffer + sizeof(int32_t);
+}
+
+inline TPM_RC Serialize_uint64_t(const uint64_t& value, std::string* buffer) {
+  uint64_t value_net = value;
+  switch (sizeof(uint64_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  const char* value_bytes = reinterpret_cast<const char*>(&value_net);
+  buffer->append(value_bytes, sizeof(uint64_t));
+  return TPM_RC_SUCCESS;
+}
+
+inline TPM_RC Parse_uint64_t(ParseCursor* cursor, uint64_t* value) {
+  uint64_t value_net = 0;
+  if (!cursor->Read(&value_net, sizeof(uint64_t))) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  switch (sizeof(uint64_t)) {
+    case 2:
+      *value = base::NetToHost16(value_net);
+      break;
+    case 4:
+      *value = base::NetToHost32(value_net);
+      break;
+    case 8:
+      *value = base::NetToHost64(value_net);
+      break;
+    default:
+      *value = value_net;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+// Writes |value| to |buffer| and returns the end of the written bytes.
+inline uint8_t* WriteFixed_uint64_t(uint64_t value, uint8_t* buffer) {
+  uint64_t value_net = value;
+  switch (sizeof(uint64_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  memcpy(buffer, &value_net, sizeof(uint64_t));
+  return buffer + sizeof(uint64_t);
+}
+
+inline TPM_RC Serialize_int64_t(const int64_t& value, std::string* buffer) {
+  int64_t value_net = value;
+  switch (sizeof(int64_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  const char* value_bytes = reinterpret_cast<const char*>(&value_net);
+  buffer->append(value_bytes, sizeof(int64_t));
+  return TPM_RC_SUCCESS;
+}
+
+inline TPM_RC Parse_int64_t(ParseCursor* cursor, int64_t* value) {
+  int64_t value_net = 0;
+  if (!cursor->Read(&value_net, sizeof(int64_t))) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  switch (sizeof(int64_t)) {
+    case 2:
+      *value = base::NetToHost16(value_net);
+      break;
+    case 4:
+      *value = base::NetToHost32(value_net);
+      break;
+    case 8:
+      *value = base::NetToHost64(value_net);
+      break;
+    default:
+      *value = value_net;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+// Writes |value| to |buffer| and returns the end of the written bytes.
+inline uint8_t* WriteFixed_int64_t(int64_t value, uint8_t* buffer) {
+  int64_t value_net = value;
+  switch (sizeof(int64_t)) {
+    case 2:
+      value_net = base::HostToNet16(value);
+      break;
+    case 4:
+      value_net = base::HostToNet32(value);
+      break;
+    case 8:
+      value_net = base::HostToNet64(value);
+      break;
+    default:
+      break;
+  }
+  memcpy(buffer, &value_net, sizeof(int64_t));
+  return buffer + sizeof(int64_t);
+}
+
+inline TPM_RC Serialize_UINT8(const UINT8& value, std::string* buffer) {
+  return Serialize_uint8_t(value, buffer);
+}
+
+inline TPM_RC Parse_UINT8(ParseCursor* cursor, UINT8* value) {
+  return Parse_uint8_t(cursor, value);
+}
+
+inline TPM_RC Serialize_BYTE(const BYTE& value, std::string* buffer) {
+  return Serialize_uint8_t(value, buffer);
+}
+
+inline TPM_RC Parse_BYTE(ParseCursor* cursor, BYTE* value) {
+  return Parse_uint8_t(cursor, value);
+}
+
+inline TPM_RC Serialize_INT8(const INT8& value, std::string* buffer) {
+  return Serialize_int8_t(value, buffer);
+}
+
+inline TPM_RC Parse_INT8(ParseCursor* cursor, INT8* value) {
+  return Parse_int8_t(cursor, value);
+}
+
+inline TPM_RC Serialize_BOOL(const BOOL& value, std::string* buffer) {
+  return Serialize_int(value, buffer);
+}
+
+inline TPM_RC Parse_BOOL(ParseCursor* cursor, BOOL* value) {
+  return Parse_int(cursor, value);
+}
+
+inline TPM_RC Serialize_UINT16(const UINT16& value, std::string* buffer) {
+  return Serialize_uint16_t(value, buffer);
+}
+
+inline TPM_RC Parse_UINT16(ParseCursor* cursor, UINT16* value) {
+  return Parse_uint16_t(cursor, value);
+}
+
+inline TPM_RC Serialize_INT16(const INT16& value, std::string* buffer) {
+  return Serialize_int16_t(value, buffer);
+}
+
+inline TPM_RC Parse_INT16(ParseCursor* cursor, INT16* value) {
+  return Parse_int16_t(cursor, value);
+}
+
+inline TPM_RC Serialize_UINT32(const UINT32& value, std::string* buffer) {
+  return Serialize_uint32_t(value, buffer);
+}
+
+inline TPM_RC Parse_UINT32(ParseCursor* cursor, UINT32* value) {
+  return Parse_uint32_t(cursor, value);
+}
+
+inline TPM_RC Serialize_INT32(const INT32& value, std::string* buffer) {
+  return Serialize_int32_t(value, buffer);
+}
+
+inline TPM_RC Parse_INT32(ParseCursor* cursor, INT32* value) {
+  return Parse_int32_t(cursor, value);
+}
+
+inline TPM_RC Serialize_UINT64(const UINT64& value, std::string* buffer) {
+  return Serialize_uint64_t(value, buffer);
+}
+
+inline TPM_RC Parse_UINT64(ParseCursor* cursor, UINT64* value) {
+  return Parse_uint64_t(cursor, value);
+}
+
+inline TPM_RC Serialize_INT64(const INT64& value, std::string* buffer) {
+  return Serialize_int64_t(value, buffer);
+}
+
+inline TPM_RC Parse_INT64(ParseCursor* cursor, INT64* value) {
+  return Parse_int64_t(cursor, value);
+}
 
 TRUNKS_EXPORT TPM_RC Parse_uint8_t(std::string* buffer,
                                    uint8_t* value,
                                    std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_int8_t(const int8_t& value, std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_int8_t(std::string* buffer,
                                   int8_t* value,
                                   std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_int(const int& value, std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_int(std::string* buffer,
                                int* value,
                                std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_uint16_t(const uint16_t& value,
-                                        std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_uint16_t(std::string* buffer,
                                     uint16_t* value,
                                     std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_int16_t(const int16_t& value,
-                                       std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_int16_t(std::string* buffer,
                                    int16_t* value,
                                    std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_uint32_t(const uint32_t& value,
-                                        std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_uint32_t(std::string* buffer,
                                     uint32_t* value,
                                     std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_int32_t(const int32_t& value,
-                                       std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_int32_t(std::string* buffer,
                                    int32_t* value,
                                    std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_uint64_t(const uint64_t& value,
-                                        std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_uint64_t(std::string* buffer,
                                     uint64_t* value,
                                     std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_int64_t(const int64_t& value,
-                                       std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_int64_t(std::string* buffer,
                                    int64_t* value,
                                    std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_UINT8(const UINT8& value, std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_UINT8(std::string* buffer,
                                  UINT8* value,
                                  std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_BYTE(const BYTE& value, std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_BYTE(std::string* buffer,
                                 BYTE* value,
                                 std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_INT8(const INT8& value, std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_INT8(std::string* buffer,
                                 INT8* value,
                                 std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_BOOL(const BOOL& value, std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_BOOL(std::string* buffer,
                                 BOOL* value,
                                 std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_UINT16(const UINT16& value, std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_UINT16(std::string* buffer,
                                   UINT16* value,
                                   std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_INT16(const INT16& value, std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_INT16(std::string* buffer,
                                  INT16* value,
                                  std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_UINT32(const UINT32& value, std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_UINT32(std::string* buffer,
                                   UINT32* value,
                                   std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_INT32(const INT32& value, std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_INT32(std::string* buffer,
                                  INT32* value,
                                  std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_UINT64(const UINT64& value, std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_UINT64(std::string* buffer,
                                   UINT64* value,
                                   std::string* value_bytes);
 
-TRUNKS_EXPORT TPM_RC Serialize_INT64(const INT64& value, std::string* buffer);
-
 TRUNKS_EXPORT TPM_RC Parse_INT64(std::string* buffer,
                                  INT64* value,
                                  std::string* value_bytes);
@@ -1779,6 +2438,8 @@ TRUNKS_EXPORT TPM_RC Parse_INT64(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM_ALGORITHM_ID(const TPM_ALGORITHM_ID& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_ALGORITHM_ID(ParseCursor* cursor,
+                                            TPM_ALGORITHM_ID* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_ALGORITHM_ID(std::string* buffer,
                                             TPM_ALGORITHM_ID* value,
                                             std::string* value_bytes);
@@ -1787,6 +2448,9 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPM_MODIFIER_INDICATOR(const TPM_MODIFIER_INDICATOR& value,
                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_MODIFIER_INDICATOR(
+    ParseCursor* cursor,
+    TPM_MODIFIER_INDICATOR* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_MODIFIER_INDICATOR(std::string* buffer,
                                                   TPM_MODIFIER_INDICATOR* value,
                                                   std::string* value_bytes);
@@ -1795,6 +2459,9 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPM_AUTHORIZATION_SIZE(const TPM_AUTHORIZATION_SIZE& value,
                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_AUTHORIZATION_SIZE(
+    ParseCursor* cursor,
+    TPM_AUTHORIZATION_SIZE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_AUTHORIZATION_SIZE(std::string* buffer,
                                                   TPM_AUTHORIZATION_SIZE* value,
                                                   std::string* value_bytes);
@@ -1803,6 +2470,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPM_PARAMETER_SIZE(const TPM_PARAMETER_SIZE& value,
                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_PARAMETER_SIZE(ParseCursor* cursor,
+                                              TPM_PARAMETER_SIZE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_PARAMETER_SIZE(std::string* buffer,
                                               TPM_PARAMETER_SIZE* value,
                                               std::string* value_bytes);
@@ -1810,6 +2479,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPM_PARAMETER_SIZE(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM_KEY_SIZE(const TPM_KEY_SIZE& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_KEY_SIZE(ParseCursor* cursor,
+                                        TPM_KEY_SIZE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_KEY_SIZE(std::string* buffer,
                                         TPM_KEY_SIZE* value,
                                         std::string* value_bytes);
@@ -1817,6 +2488,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPM_KEY_SIZE(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM_KEY_BITS(const TPM_KEY_BITS& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_KEY_BITS(ParseCursor* cursor,
+                                        TPM_KEY_BITS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_KEY_BITS(std::string* buffer,
                                         TPM_KEY_BITS* value,
                                         std::string* value_bytes);
@@ -1824,6 +2497,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPM_KEY_BITS(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM_HANDLE(const TPM_HANDLE& value,
                                           std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_HANDLE(ParseCursor* cursor, TPM_HANDLE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_HANDLE(std::string* buffer,
                                       TPM_HANDLE* value,
                                       std::string* value_bytes);
@@ -1831,6 +2505,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPM_HANDLE(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_NONCE(const TPM2B_NONCE& value,
                                            std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_NONCE(ParseCursor* cursor, TPM2B_NONCE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_NONCE(std::string* buffer,
                                        TPM2B_NONCE* value,
                                        std::string* value_bytes);
@@ -1838,6 +2513,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPM2B_NONCE(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_AUTH(const TPM2B_AUTH& value,
                                           std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_AUTH(ParseCursor* cursor, TPM2B_AUTH* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_AUTH(std::string* buffer,
                                       TPM2B_AUTH* value,
                                       std::string* value_bytes);
@@ -1845,6 +2521,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPM2B_AUTH(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_OPERAND(const TPM2B_OPERAND& value,
                                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_OPERAND(ParseCursor* cursor,
+                                         TPM2B_OPERAND* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_OPERAND(std::string* buffer,
                                          TPM2B_OPERAND* value,
                                          std::string* value_bytes);
@@ -1852,6 +2530,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPM2B_OPERAND(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_SCHEME_HMAC(const TPMS_SCHEME_HMAC& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_HMAC(ParseCursor* cursor,
+                                            TPMS_SCHEME_HMAC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_HMAC(std::string* buffer,
                                             TPMS_SCHEME_HMAC* value,
                                             std::string* value_bytes);
@@ -1860,6 +2540,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_SCHEME_RSASSA(const TPMS_SCHEME_RSASSA& value,
                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_RSASSA(ParseCursor* cursor,
+                                              TPMS_SCHEME_RSASSA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_RSASSA(std::string* buffer,
                                               TPMS_SCHEME_RSASSA* value,
                                               std::string* value_bytes);
@@ -1868,6 +2550,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_SCHEME_RSAPSS(const TPMS_SCHEME_RSAPSS& value,
                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_RSAPSS(ParseCursor* cursor,
+                                              TPMS_SCHEME_RSAPSS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_RSAPSS(std::string* buffer,
                                               TPMS_SCHEME_RSAPSS* value,
                                               std::string* value_bytes);
@@ -1875,6 +2559,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_RSAPSS(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_SCHEME_ECDSA(const TPMS_SCHEME_ECDSA& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_ECDSA(ParseCursor* cursor,
+                                             TPMS_SCHEME_ECDSA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_ECDSA(std::string* buffer,
                                              TPMS_SCHEME_ECDSA* value,
                                              std::string* value_bytes);
@@ -1882,6 +2568,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_ECDSA(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_SCHEME_SM2(const TPMS_SCHEME_SM2& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_SM2(ParseCursor* cursor,
+                                           TPMS_SCHEME_SM2* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_SM2(std::string* buffer,
                                            TPMS_SCHEME_SM2* value,
                                            std::string* value_bytes);
@@ -1890,6 +2578,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_SCHEME_ECSCHNORR(const TPMS_SCHEME_ECSCHNORR& value,
                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_ECSCHNORR(ParseCursor* cursor,
+                                                 TPMS_SCHEME_ECSCHNORR* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_ECSCHNORR(std::string* buffer,
                                                  TPMS_SCHEME_ECSCHNORR* value,
                                                  std::string* value_bytes);
@@ -1897,6 +2587,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_ECSCHNORR(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_YES_NO(const TPMI_YES_NO& value,
                                            std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_YES_NO(ParseCursor* cursor, TPMI_YES_NO* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_YES_NO(std::string* buffer,
                                        TPMI_YES_NO* value,
                                        std::string* value_bytes);
@@ -1904,6 +2595,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_YES_NO(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_DH_OBJECT(const TPMI_DH_OBJECT& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_OBJECT(ParseCursor* cursor,
+                                          TPMI_DH_OBJECT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_OBJECT(std::string* buffer,
                                           TPMI_DH_OBJECT* value,
                                           std::string* value_bytes);
@@ -1912,6 +2605,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMI_DH_PERSISTENT(const TPMI_DH_PERSISTENT& value,
                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_PERSISTENT(ParseCursor* cursor,
+                                              TPMI_DH_PERSISTENT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_PERSISTENT(std::string* buffer,
                                               TPMI_DH_PERSISTENT* value,
                                               std::string* value_bytes);
@@ -1919,6 +2614,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_PERSISTENT(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_DH_ENTITY(const TPMI_DH_ENTITY& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_ENTITY(ParseCursor* cursor,
+                                          TPMI_DH_ENTITY* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_ENTITY(std::string* buffer,
                                           TPMI_DH_ENTITY* value,
                                           std::string* value_bytes);
@@ -1926,6 +2623,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_ENTITY(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_DH_PCR(const TPMI_DH_PCR& value,
                                            std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_PCR(ParseCursor* cursor, TPMI_DH_PCR* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_PCR(std::string* buffer,
                                        TPMI_DH_PCR* value,
                                        std::string* value_bytes);
@@ -1934,6 +2632,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMI_SH_AUTH_SESSION(const TPMI_SH_AUTH_SESSION& value,
                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_SH_AUTH_SESSION(ParseCursor* cursor,
+                                                TPMI_SH_AUTH_SESSION* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_SH_AUTH_SESSION(std::string* buffer,
                                                 TPMI_SH_AUTH_SESSION* value,
                                                 std::string* value_bytes);
@@ -1941,6 +2641,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_SH_AUTH_SESSION(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_SH_HMAC(const TPMI_SH_HMAC& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_SH_HMAC(ParseCursor* cursor,
+                                        TPMI_SH_HMAC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_SH_HMAC(std::string* buffer,
                                         TPMI_SH_HMAC* value,
                                         std::string* value_bytes);
@@ -1948,6 +2650,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_SH_HMAC(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_SH_POLICY(const TPMI_SH_POLICY& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_SH_POLICY(ParseCursor* cursor,
+                                          TPMI_SH_POLICY* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_SH_POLICY(std::string* buffer,
                                           TPMI_SH_POLICY* value,
                                           std::string* value_bytes);
@@ -1955,6 +2659,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_SH_POLICY(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_DH_CONTEXT(const TPMI_DH_CONTEXT& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_CONTEXT(ParseCursor* cursor,
+                                           TPMI_DH_CONTEXT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_CONTEXT(std::string* buffer,
                                            TPMI_DH_CONTEXT* value,
                                            std::string* value_bytes);
@@ -1962,6 +2668,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_DH_CONTEXT(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_RH_HIERARCHY(const TPMI_RH_HIERARCHY& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_HIERARCHY(ParseCursor* cursor,
+                                             TPMI_RH_HIERARCHY* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_HIERARCHY(std::string* buffer,
                                              TPMI_RH_HIERARCHY* value,
                                              std::string* value_bytes);
@@ -1969,6 +2677,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_HIERARCHY(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_RH_ENABLES(const TPMI_RH_ENABLES& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_ENABLES(ParseCursor* cursor,
+                                           TPMI_RH_ENABLES* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_ENABLES(std::string* buffer,
                                            TPMI_RH_ENABLES* value,
                                            std::string* value_bytes);
@@ -1977,6 +2687,9 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMI_RH_HIERARCHY_AUTH(const TPMI_RH_HIERARCHY_AUTH& value,
                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_HIERARCHY_AUTH(
+    ParseCursor* cursor,
+    TPMI_RH_HIERARCHY_AUTH* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_HIERARCHY_AUTH(std::string* buffer,
                                                   TPMI_RH_HIERARCHY_AUTH* value,
                                                   std::string* value_bytes);
@@ -1984,6 +2697,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_HIERARCHY_AUTH(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_RH_PLATFORM(const TPMI_RH_PLATFORM& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_PLATFORM(ParseCursor* cursor,
+                                            TPMI_RH_PLATFORM* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_PLATFORM(std::string* buffer,
                                             TPMI_RH_PLATFORM* value,
                                             std::string* value_bytes);
@@ -1991,6 +2706,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_PLATFORM(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_RH_OWNER(const TPMI_RH_OWNER& value,
                                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_OWNER(ParseCursor* cursor,
+                                         TPMI_RH_OWNER* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_OWNER(std::string* buffer,
                                          TPMI_RH_OWNER* value,
                                          std::string* value_bytes);
@@ -1999,6 +2716,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMI_RH_ENDORSEMENT(const TPMI_RH_ENDORSEMENT& value,
                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_ENDORSEMENT(ParseCursor* cursor,
+                                               TPMI_RH_ENDORSEMENT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_ENDORSEMENT(std::string* buffer,
                                                TPMI_RH_ENDORSEMENT* value,
                                                std::string* value_bytes);
@@ -2006,6 +2725,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_ENDORSEMENT(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_RH_PROVISION(const TPMI_RH_PROVISION& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_PROVISION(ParseCursor* cursor,
+                                             TPMI_RH_PROVISION* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_PROVISION(std::string* buffer,
                                              TPMI_RH_PROVISION* value,
                                              std::string* value_bytes);
@@ -2013,6 +2734,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_PROVISION(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_RH_CLEAR(const TPMI_RH_CLEAR& value,
                                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_CLEAR(ParseCursor* cursor,
+                                         TPMI_RH_CLEAR* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_CLEAR(std::string* buffer,
                                          TPMI_RH_CLEAR* value,
                                          std::string* value_bytes);
@@ -2020,6 +2743,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_CLEAR(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_RH_NV_AUTH(const TPMI_RH_NV_AUTH& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_NV_AUTH(ParseCursor* cursor,
+                                           TPMI_RH_NV_AUTH* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_NV_AUTH(std::string* buffer,
                                            TPMI_RH_NV_AUTH* value,
                                            std::string* value_bytes);
@@ -2027,6 +2752,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_NV_AUTH(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_RH_LOCKOUT(const TPMI_RH_LOCKOUT& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_LOCKOUT(ParseCursor* cursor,
+                                           TPMI_RH_LOCKOUT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_LOCKOUT(std::string* buffer,
                                            TPMI_RH_LOCKOUT* value,
                                            std::string* value_bytes);
@@ -2034,6 +2761,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_LOCKOUT(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_RH_NV_INDEX(const TPMI_RH_NV_INDEX& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_NV_INDEX(ParseCursor* cursor,
+                                            TPMI_RH_NV_INDEX* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_NV_INDEX(std::string* buffer,
                                             TPMI_RH_NV_INDEX* value,
                                             std::string* value_bytes);
@@ -2041,6 +2770,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_RH_NV_INDEX(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_ALG_HASH(const TPMI_ALG_HASH& value,
                                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_HASH(ParseCursor* cursor,
+                                         TPMI_ALG_HASH* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_HASH(std::string* buffer,
                                          TPMI_ALG_HASH* value,
                                          std::string* value_bytes);
@@ -2048,6 +2779,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_HASH(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_ALG_ASYM(const TPMI_ALG_ASYM& value,
                                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_ASYM(ParseCursor* cursor,
+                                         TPMI_ALG_ASYM* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_ASYM(std::string* buffer,
                                          TPMI_ALG_ASYM* value,
                                          std::string* value_bytes);
@@ -2055,6 +2788,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_ASYM(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_ALG_SYM(const TPMI_ALG_SYM& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_SYM(ParseCursor* cursor,
+                                        TPMI_ALG_SYM* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_SYM(std::string* buffer,
                                         TPMI_ALG_SYM* value,
                                         std::string* value_bytes);
@@ -2063,6 +2798,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMI_ALG_SYM_OBJECT(const TPMI_ALG_SYM_OBJECT& value,
                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_SYM_OBJECT(ParseCursor* cursor,
+                                               TPMI_ALG_SYM_OBJECT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_SYM_OBJECT(std::string* buffer,
                                                TPMI_ALG_SYM_OBJECT* value,
                                                std::string* value_bytes);
@@ -2070,6 +2807,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_SYM_OBJECT(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_ALG_SYM_MODE(const TPMI_ALG_SYM_MODE& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_SYM_MODE(ParseCursor* cursor,
+                                             TPMI_ALG_SYM_MODE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_SYM_MODE(std::string* buffer,
                                              TPMI_ALG_SYM_MODE* value,
                                              std::string* value_bytes);
@@ -2077,6 +2816,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_SYM_MODE(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_ALG_KDF(const TPMI_ALG_KDF& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_KDF(ParseCursor* cursor,
+                                        TPMI_ALG_KDF* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_KDF(std::string* buffer,
                                         TPMI_ALG_KDF* value,
                                         std::string* value_bytes);
@@ -2085,6 +2826,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMI_ALG_SIG_SCHEME(const TPMI_ALG_SIG_SCHEME& value,
                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_SIG_SCHEME(ParseCursor* cursor,
+                                               TPMI_ALG_SIG_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_SIG_SCHEME(std::string* buffer,
                                                TPMI_ALG_SIG_SCHEME* value,
                                                std::string* value_bytes);
@@ -2093,6 +2836,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMI_ECC_KEY_EXCHANGE(const TPMI_ECC_KEY_EXCHANGE& value,
                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ECC_KEY_EXCHANGE(ParseCursor* cursor,
+                                                 TPMI_ECC_KEY_EXCHANGE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ECC_KEY_EXCHANGE(std::string* buffer,
                                                  TPMI_ECC_KEY_EXCHANGE* value,
                                                  std::string* value_bytes);
@@ -2101,6 +2846,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMI_ST_COMMAND_TAG(const TPMI_ST_COMMAND_TAG& value,
                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ST_COMMAND_TAG(ParseCursor* cursor,
+                                               TPMI_ST_COMMAND_TAG* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ST_COMMAND_TAG(std::string* buffer,
                                                TPMI_ST_COMMAND_TAG* value,
                                                std::string* value_bytes);
@@ -2108,6 +2855,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_ST_COMMAND_TAG(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_ST_ATTEST(const TPMI_ST_ATTEST& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ST_ATTEST(ParseCursor* cursor,
+                                          TPMI_ST_ATTEST* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ST_ATTEST(std::string* buffer,
                                           TPMI_ST_ATTEST* value,
                                           std::string* value_bytes);
@@ -2115,6 +2864,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_ST_ATTEST(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_AES_KEY_BITS(const TPMI_AES_KEY_BITS& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_AES_KEY_BITS(ParseCursor* cursor,
+                                             TPMI_AES_KEY_BITS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_AES_KEY_BITS(std::string* buffer,
                                              TPMI_AES_KEY_BITS* value,
                                              std::string* value_bytes);
@@ -2122,6 +2873,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_AES_KEY_BITS(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_SM4_KEY_BITS(const TPMI_SM4_KEY_BITS& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_SM4_KEY_BITS(ParseCursor* cursor,
+                                             TPMI_SM4_KEY_BITS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_SM4_KEY_BITS(std::string* buffer,
                                              TPMI_SM4_KEY_BITS* value,
                                              std::string* value_bytes);
@@ -2139,6 +2892,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMI_ALG_ASYM_SCHEME(const TPMI_ALG_ASYM_SCHEME& value,
                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_ASYM_SCHEME(ParseCursor* cursor,
+                                                TPMI_ALG_ASYM_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_ASYM_SCHEME(std::string* buffer,
                                                 TPMI_ALG_ASYM_SCHEME* value,
                                                 std::string* value_bytes);
@@ -2147,6 +2902,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMI_ALG_RSA_SCHEME(const TPMI_ALG_RSA_SCHEME& value,
                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_RSA_SCHEME(ParseCursor* cursor,
+                                               TPMI_ALG_RSA_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_RSA_SCHEME(std::string* buffer,
                                                TPMI_ALG_RSA_SCHEME* value,
                                                std::string* value_bytes);
@@ -2155,6 +2912,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMI_ALG_RSA_DECRYPT(const TPMI_ALG_RSA_DECRYPT& value,
                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_RSA_DECRYPT(ParseCursor* cursor,
+                                                TPMI_ALG_RSA_DECRYPT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_RSA_DECRYPT(std::string* buffer,
                                                 TPMI_ALG_RSA_DECRYPT* value,
                                                 std::string* value_bytes);
@@ -2162,6 +2921,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_RSA_DECRYPT(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_RSA_KEY_BITS(const TPMI_RSA_KEY_BITS& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_RSA_KEY_BITS(ParseCursor* cursor,
+                                             TPMI_RSA_KEY_BITS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_RSA_KEY_BITS(std::string* buffer,
                                              TPMI_RSA_KEY_BITS* value,
                                              std::string* value_bytes);
@@ -2170,6 +2931,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMI_ALG_ECC_SCHEME(const TPMI_ALG_ECC_SCHEME& value,
                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_ECC_SCHEME(ParseCursor* cursor,
+                                               TPMI_ALG_ECC_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_ECC_SCHEME(std::string* buffer,
                                                TPMI_ALG_ECC_SCHEME* value,
                                                std::string* value_bytes);
@@ -2177,6 +2940,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_ECC_SCHEME(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_ECC_CURVE(const TPMI_ECC_CURVE& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ECC_CURVE(ParseCursor* cursor,
+                                          TPMI_ECC_CURVE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ECC_CURVE(std::string* buffer,
                                           TPMI_ECC_CURVE* value,
                                           std::string* value_bytes);
@@ -2184,6 +2949,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_ECC_CURVE(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMI_ALG_PUBLIC(const TPMI_ALG_PUBLIC& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_PUBLIC(ParseCursor* cursor,
+                                           TPMI_ALG_PUBLIC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_PUBLIC(std::string* buffer,
                                            TPMI_ALG_PUBLIC* value,
                                            std::string* value_bytes);
@@ -2191,6 +2958,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMI_ALG_PUBLIC(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMA_ALGORITHM(const TPMA_ALGORITHM& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMA_ALGORITHM(ParseCursor* cursor,
+                                          TPMA_ALGORITHM* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMA_ALGORITHM(std::string* buffer,
                                           TPMA_ALGORITHM* value,
                                           std::string* value_bytes);
@@ -2198,6 +2967,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPMA_ALGORITHM(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMA_OBJECT(const TPMA_OBJECT& value,
                                            std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMA_OBJECT(ParseCursor* cursor, TPMA_OBJECT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMA_OBJECT(std::string* buffer,
                                        TPMA_OBJECT* value,
                                        std::string* value_bytes);
@@ -2205,6 +2975,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMA_OBJECT(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMA_SESSION(const TPMA_SESSION& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMA_SESSION(ParseCursor* cursor,
+                                        TPMA_SESSION* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMA_SESSION(std::string* buffer,
                                         TPMA_SESSION* value,
                                         std::string* value_bytes);
@@ -2212,6 +2984,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMA_SESSION(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMA_LOCALITY(const TPMA_LOCALITY& value,
                                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMA_LOCALITY(ParseCursor* cursor,
+                                         TPMA_LOCALITY* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMA_LOCALITY(std::string* buffer,
                                          TPMA_LOCALITY* value,
                                          std::string* value_bytes);
@@ -2219,6 +2993,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMA_LOCALITY(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMA_PERMANENT(const TPMA_PERMANENT& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMA_PERMANENT(ParseCursor* cursor,
+                                          TPMA_PERMANENT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMA_PERMANENT(std::string* buffer,
                                           TPMA_PERMANENT* value,
                                           std::string* value_bytes);
@@ -2227,6 +3003,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMA_STARTUP_CLEAR(const TPMA_STARTUP_CLEAR& value,
                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMA_STARTUP_CLEAR(ParseCursor* cursor,
+                                              TPMA_STARTUP_CLEAR* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMA_STARTUP_CLEAR(std::string* buffer,
                                               TPMA_STARTUP_CLEAR* value,
                                               std::string* value_bytes);
@@ -2234,6 +3012,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPMA_STARTUP_CLEAR(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMA_MEMORY(const TPMA_MEMORY& value,
                                            std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMA_MEMORY(ParseCursor* cursor, TPMA_MEMORY* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMA_MEMORY(std::string* buffer,
                                        TPMA_MEMORY* value,
                                        std::string* value_bytes);
@@ -2241,6 +3020,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPMA_MEMORY(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMA_CC(const TPMA_CC& value,
                                        std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMA_CC(ParseCursor* cursor, TPMA_CC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMA_CC(std::string* buffer,
                                    TPMA_CC* value,
                                    std::string* value_bytes);
@@ -2248,6 +3028,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMA_CC(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM_NV_INDEX(const TPM_NV_INDEX& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_NV_INDEX(ParseCursor* cursor,
+                                        TPM_NV_INDEX* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_NV_INDEX(std::string* buffer,
                                         TPM_NV_INDEX* value,
                                         std::string* value_bytes);
@@ -2255,6 +3037,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPM_NV_INDEX(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMA_NV(const TPMA_NV& value,
                                        std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMA_NV(ParseCursor* cursor, TPMA_NV* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMA_NV(std::string* buffer,
                                    TPMA_NV* value,
                                    std::string* value_bytes);
@@ -2262,6 +3045,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPMA_NV(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM_SPEC(const TPM_SPEC& value,
                                         std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_SPEC(ParseCursor* cursor, TPM_SPEC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_SPEC(std::string* buffer,
                                     TPM_SPEC* value,
                                     std::string* value_bytes);
@@ -2269,6 +3053,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPM_SPEC(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM_GENERATED(const TPM_GENERATED& value,
                                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_GENERATED(ParseCursor* cursor,
+                                         TPM_GENERATED* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_GENERATED(std::string* buffer,
                                          TPM_GENERATED* value,
                                          std::string* value_bytes);
@@ -2276,6 +3062,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPM_GENERATED(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM_ALG_ID(const TPM_ALG_ID& value,
                                           std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_ALG_ID(ParseCursor* cursor, TPM_ALG_ID* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_ALG_ID(std::string* buffer,
                                       TPM_ALG_ID* value,
                                       std::string* value_bytes);
@@ -2283,18 +3070,22 @@ TRUNKS_EXPORT TPM_RC Parse_TPM_ALG_ID(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM_ECC_CURVE(const TPM_ECC_CURVE& value,
                                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_ECC_CURVE(ParseCursor* cursor,
+                                         TPM_ECC_CURVE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_ECC_CURVE(std::string* buffer,
                                          TPM_ECC_CURVE* value,
                                          std::string* value_bytes);
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM_CC(const TPM_CC& value, std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_CC(ParseCursor* cursor, TPM_CC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_CC(std::string* buffer,
                                   TPM_CC* value,
                                   std::string* value_bytes);
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM_RC(const TPM_RC& value, std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_RC(ParseCursor* cursor, TPM_RC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_RC(std::string* buffer,
                                   TPM_RC* value,
                                   std::string* value_bytes);
@@ -2302,30 +3093,36 @@ TRUNKS_EXPORT TPM_RC Parse_TPM_RC(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM_CLOCK_ADJUST(const TPM_CLOCK_ADJUST& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_CLOCK_ADJUST(ParseCursor* cursor,
+                                            TPM_CLOCK_ADJUST* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_CLOCK_ADJUST(std::string* buffer,
                                             TPM_CLOCK_ADJUST* value,
                                             std::string* value_bytes);
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM_EO(const TPM_EO& value, std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_EO(ParseCursor* cursor, TPM_EO* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_EO(std::string* buffer,
                                   TPM_EO* value,
                                   std::string* value_bytes);
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM_ST(const TPM_ST& value, std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_ST(ParseCursor* cursor, TPM_ST* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_ST(std::string* buffer,
                                   TPM_ST* value,
                                   std::string* value_bytes);
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM_SU(const TPM_SU& value, std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_SU(ParseCursor* cursor, TPM_SU* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_SU(std::string* buffer,
                                   TPM_SU* value,
                                   std::string* value_bytes);
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM_SE(const TPM_SE& value, std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_SE(ParseCursor* cursor, TPM_SE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_SE(std::string* buffer,
                                   TPM_SE* value,
                                   std::string* value_bytes);
@@ -2333,12 +3130,14 @@ TRUNKS_EXPORT TPM_RC Parse_TPM_SE(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM_CAP(const TPM_CAP& value,
                                        std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_CAP(ParseCursor* cursor, TPM_CAP* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_CAP(std::string* buffer,
                                    TPM_CAP* value,
                                    std::string* value_bytes);
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM_PT(const TPM_PT& value, std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_PT(ParseCursor* cursor, TPM_PT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_PT(std::string* buffer,
                                   TPM_PT* value,
                                   std::string* value_bytes);
@@ -2346,30 +3145,35 @@ TRUNKS_EXPORT TPM_RC Parse_TPM_PT(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM_PT_PCR(const TPM_PT_PCR& value,
                                           std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_PT_PCR(ParseCursor* cursor, TPM_PT_PCR* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_PT_PCR(std::string* buffer,
                                       TPM_PT_PCR* value,
                                       std::string* value_bytes);
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM_PS(const TPM_PS& value, std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_PS(ParseCursor* cursor, TPM_PS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_PS(std::string* buffer,
                                   TPM_PS* value,
                                   std::string* value_bytes);
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM_HT(const TPM_HT& value, std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_HT(ParseCursor* cursor, TPM_HT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_HT(std::string* buffer,
                                   TPM_HT* value,
                                   std::string* value_bytes);
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM_RH(const TPM_RH& value, std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_RH(ParseCursor* cursor, TPM_RH* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_RH(std::string* buffer,
                                   TPM_RH* value,
                                   std::string* value_bytes);
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM_HC(const TPM_HC& value, std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM_HC(ParseCursor* cursor, TPM_HC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM_HC(std::string* buffer,
                                   TPM_HC* value,
                                   std::string* value_bytes);
@@ -2386,6 +3190,7 @@ Parse_TPMS_ALGORITHM_DESCRIPTION(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_HA(const TPMT_HA& value,
                                        std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_HA(ParseCursor* cursor, TPMT_HA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_HA(std::string* buffer,
                                    TPMT_HA* value,
                                    std::string* value_bytes);
@@ -2393,36 +3198,84 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_HA(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_DIGEST(const TPM2B_DIGEST& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_DIGEST(ParseCursor* cursor,
+                                        TPM2B_DIGEST* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_DIGEST(std::string* buffer,
                                         TPM2B_DIGEST* value,
                                         std::string* value_bytes);
 
 TRUNKS_EXPORT TPM2B_DIGEST Make_TPM2B_DIGEST(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_DIGEST(const TPM2B_DIGEST& tpm2b);
+inline bool Equal_TPM2B_DIGEST(const TPM2B_DIGEST& a, const TPM2B_DIGEST& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_DIGEST(const TPM2B_DIGEST& tpm2b,
+                                     const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_DIGEST(const TPM2B_DIGEST& tpm2b,
+                                         std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_DATA(const TPM2B_DATA& value,
                                           std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_DATA(ParseCursor* cursor, TPM2B_DATA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_DATA(std::string* buffer,
                                       TPM2B_DATA* value,
                                       std::string* value_bytes);
 
 TRUNKS_EXPORT TPM2B_DATA Make_TPM2B_DATA(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_DATA(const TPM2B_DATA& tpm2b);
+inline bool Equal_TPM2B_DATA(const TPM2B_DATA& a, const TPM2B_DATA& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_DATA(const TPM2B_DATA& tpm2b,
+                                   const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_DATA(const TPM2B_DATA& tpm2b,
+                                       std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_EVENT(const TPM2B_EVENT& value,
                                            std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_EVENT(ParseCursor* cursor, TPM2B_EVENT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_EVENT(std::string* buffer,
                                        TPM2B_EVENT* value,
                                        std::string* value_bytes);
 
 TRUNKS_EXPORT TPM2B_EVENT Make_TPM2B_EVENT(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_EVENT(const TPM2B_EVENT& tpm2b);
+inline bool Equal_TPM2B_EVENT(const TPM2B_EVENT& a, const TPM2B_EVENT& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_EVENT(const TPM2B_EVENT& tpm2b,
+                                    const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_EVENT(const TPM2B_EVENT& tpm2b,
+                                        std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_MAX_BUFFER(const TPM2B_MAX_BUFFER& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_MAX_BUFFER(ParseCursor* cursor,
+                                            TPM2B_MAX_BUFFER* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_MAX_BUFFER(std::string* buffer,
                                             TPM2B_MAX_BUFFER* value,
                                             std::string* value_bytes);
@@ -2430,11 +3283,28 @@ TRUNKS_EXPORT TPM_RC Parse_TPM2B_MAX_BUFFER(std::string* buffer,
 TRUNKS_EXPORT TPM2B_MAX_BUFFER Make_TPM2B_MAX_BUFFER(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_MAX_BUFFER(
     const TPM2B_MAX_BUFFER& tpm2b);
+inline bool Equal_TPM2B_MAX_BUFFER(const TPM2B_MAX_BUFFER& a,
+                                   const TPM2B_MAX_BUFFER& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_MAX_BUFFER(const TPM2B_MAX_BUFFER& tpm2b,
+                                         const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_MAX_BUFFER(const TPM2B_MAX_BUFFER& tpm2b,
+                                             std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC
 Serialize_TPM2B_MAX_NV_BUFFER(const TPM2B_MAX_NV_BUFFER& value,
                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_MAX_NV_BUFFER(ParseCursor* cursor,
+                                               TPM2B_MAX_NV_BUFFER* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_MAX_NV_BUFFER(std::string* buffer,
                                                TPM2B_MAX_NV_BUFFER* value,
                                                std::string* value_bytes);
@@ -2443,40 +3313,105 @@ TRUNKS_EXPORT TPM2B_MAX_NV_BUFFER
 Make_TPM2B_MAX_NV_BUFFER(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_MAX_NV_BUFFER(
     const TPM2B_MAX_NV_BUFFER& tpm2b);
+inline bool Equal_TPM2B_MAX_NV_BUFFER(const TPM2B_MAX_NV_BUFFER& a,
+                                      const TPM2B_MAX_NV_BUFFER& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_MAX_NV_BUFFER(const TPM2B_MAX_NV_BUFFER& tpm2b,
+                                            const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_MAX_NV_BUFFER(
+    const TPM2B_MAX_NV_BUFFER& tpm2b,
+    std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_TIMEOUT(const TPM2B_TIMEOUT& value,
                                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_TIMEOUT(ParseCursor* cursor,
+                                         TPM2B_TIMEOUT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_TIMEOUT(std::string* buffer,
                                          TPM2B_TIMEOUT* value,
                                          std::string* value_bytes);
 
 TRUNKS_EXPORT TPM2B_TIMEOUT Make_TPM2B_TIMEOUT(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_TIMEOUT(const TPM2B_TIMEOUT& tpm2b);
+inline bool Equal_TPM2B_TIMEOUT(const TPM2B_TIMEOUT& a,
+                                const TPM2B_TIMEOUT& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_TIMEOUT(const TPM2B_TIMEOUT& tpm2b,
+                                      const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_TIMEOUT(const TPM2B_TIMEOUT& tpm2b,
+                                          std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_IV(const TPM2B_IV& value,
                                         std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_IV(ParseCursor* cursor, TPM2B_IV* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_IV(std::string* buffer,
                                     TPM2B_IV* value,
                                     std::string* value_bytes);
 
 TRUNKS_EXPORT TPM2B_IV Make_TPM2B_IV(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_IV(const TPM2B_IV& tpm2b);
+inline bool Equal_TPM2B_IV(const TPM2B_IV& a, const TPM2B_IV& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_IV(const TPM2B_IV& tpm2b,
+                                 const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_IV(const TPM2B_IV& tpm2b,
+                                     std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_NAME(const TPM2B_NAME& value,
                                           std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_NAME(ParseCursor* cursor, TPM2B_NAME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_NAME(std::string* buffer,
                                       TPM2B_NAME* value,
                                       std::string* value_bytes);
 
 TRUNKS_EXPORT TPM2B_NAME Make_TPM2B_NAME(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_NAME(const TPM2B_NAME& tpm2b);
+inline bool Equal_TPM2B_NAME(const TPM2B_NAME& a, const TPM2B_NAME& b) {
+  return TPM2BBuffersEqual(a.name, a.size, b.name, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_NAME(const TPM2B_NAME& tpm2b,
+                                   const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.name, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_NAME(const TPM2B_NAME& tpm2b,
+                                       std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.name), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_PCR_SELECT(const TPMS_PCR_SELECT& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_PCR_SELECT(ParseCursor* cursor,
+                                           TPMS_PCR_SELECT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_PCR_SELECT(std::string* buffer,
                                            TPMS_PCR_SELECT* value,
                                            std::string* value_bytes);
@@ -2485,6 +3420,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_PCR_SELECTION(const TPMS_PCR_SELECTION& value,
                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_PCR_SELECTION(ParseCursor* cursor,
+                                              TPMS_PCR_SELECTION* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_PCR_SELECTION(std::string* buffer,
                                               TPMS_PCR_SELECTION* value,
                                               std::string* value_bytes);
@@ -2492,6 +3429,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_PCR_SELECTION(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_TK_CREATION(const TPMT_TK_CREATION& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_TK_CREATION(ParseCursor* cursor,
+                                            TPMT_TK_CREATION* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_TK_CREATION(std::string* buffer,
                                             TPMT_TK_CREATION* value,
                                             std::string* value_bytes);
@@ -2499,6 +3438,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_TK_CREATION(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_TK_VERIFIED(const TPMT_TK_VERIFIED& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_TK_VERIFIED(ParseCursor* cursor,
+                                            TPMT_TK_VERIFIED* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_TK_VERIFIED(std::string* buffer,
                                             TPMT_TK_VERIFIED* value,
                                             std::string* value_bytes);
@@ -2506,6 +3447,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_TK_VERIFIED(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_TK_AUTH(const TPMT_TK_AUTH& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_TK_AUTH(ParseCursor* cursor,
+                                        TPMT_TK_AUTH* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_TK_AUTH(std::string* buffer,
                                         TPMT_TK_AUTH* value,
                                         std::string* value_bytes);
@@ -2513,6 +3456,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_TK_AUTH(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_TK_HASHCHECK(const TPMT_TK_HASHCHECK& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_TK_HASHCHECK(ParseCursor* cursor,
+                                             TPMT_TK_HASHCHECK* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_TK_HASHCHECK(std::string* buffer,
                                              TPMT_TK_HASHCHECK* value,
                                              std::string* value_bytes);
@@ -2520,6 +3465,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_TK_HASHCHECK(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_ALG_PROPERTY(const TPMS_ALG_PROPERTY& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_ALG_PROPERTY(ParseCursor* cursor,
+                                             TPMS_ALG_PROPERTY* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_ALG_PROPERTY(std::string* buffer,
                                              TPMS_ALG_PROPERTY* value,
                                              std::string* value_bytes);
@@ -2528,6 +3475,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_TAGGED_PROPERTY(const TPMS_TAGGED_PROPERTY& value,
                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_TAGGED_PROPERTY(ParseCursor* cursor,
+                                                TPMS_TAGGED_PROPERTY* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_TAGGED_PROPERTY(std::string* buffer,
                                                 TPMS_TAGGED_PROPERTY* value,
                                                 std::string* value_bytes);
@@ -2536,6 +3485,9 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_TAGGED_PCR_SELECT(const TPMS_TAGGED_PCR_SELECT& value,
                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_TAGGED_PCR_SELECT(
+    ParseCursor* cursor,
+    TPMS_TAGGED_PCR_SELECT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_TAGGED_PCR_SELECT(std::string* buffer,
                                                   TPMS_TAGGED_PCR_SELECT* value,
                                                   std::string* value_bytes);
@@ -2543,6 +3495,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_TAGGED_PCR_SELECT(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPML_CC(const TPML_CC& value,
                                        std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPML_CC(ParseCursor* cursor, TPML_CC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPML_CC(std::string* buffer,
                                    TPML_CC* value,
                                    std::string* value_bytes);
@@ -2550,6 +3503,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPML_CC(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPML_CCA(const TPML_CCA& value,
                                         std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPML_CCA(ParseCursor* cursor, TPML_CCA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPML_CCA(std::string* buffer,
                                     TPML_CCA* value,
                                     std::string* value_bytes);
@@ -2557,6 +3511,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPML_CCA(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPML_ALG(const TPML_ALG& value,
                                         std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPML_ALG(ParseCursor* cursor, TPML_ALG* value);
 TRUNKS_EXPORT TPM_RC Parse_TPML_ALG(std::string* buffer,
                                     TPML_ALG* value,
                                     std::string* value_bytes);
@@ -2564,6 +3519,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPML_ALG(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPML_HANDLE(const TPML_HANDLE& value,
                                            std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPML_HANDLE(ParseCursor* cursor, TPML_HANDLE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPML_HANDLE(std::string* buffer,
                                        TPML_HANDLE* value,
                                        std::string* value_bytes);
@@ -2571,6 +3527,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPML_HANDLE(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPML_DIGEST(const TPML_DIGEST& value,
                                            std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPML_DIGEST(ParseCursor* cursor, TPML_DIGEST* value);
 TRUNKS_EXPORT TPM_RC Parse_TPML_DIGEST(std::string* buffer,
                                        TPML_DIGEST* value,
                                        std::string* value_bytes);
@@ -2579,6 +3536,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPML_DIGEST_VALUES(const TPML_DIGEST_VALUES& value,
                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPML_DIGEST_VALUES(ParseCursor* cursor,
+                                              TPML_DIGEST_VALUES* value);
 TRUNKS_EXPORT TPM_RC Parse_TPML_DIGEST_VALUES(std::string* buffer,
                                               TPML_DIGEST_VALUES* value,
                                               std::string* value_bytes);
@@ -2587,6 +3546,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPM2B_DIGEST_VALUES(const TPM2B_DIGEST_VALUES& value,
                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_DIGEST_VALUES(ParseCursor* cursor,
+                                               TPM2B_DIGEST_VALUES* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_DIGEST_VALUES(std::string* buffer,
                                                TPM2B_DIGEST_VALUES* value,
                                                std::string* value_bytes);
@@ -2595,11 +3556,29 @@ TRUNKS_EXPORT TPM2B_DIGEST_VALUES
 Make_TPM2B_DIGEST_VALUES(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_DIGEST_VALUES(
     const TPM2B_DIGEST_VALUES& tpm2b);
+inline bool Equal_TPM2B_DIGEST_VALUES(const TPM2B_DIGEST_VALUES& a,
+                                      const TPM2B_DIGEST_VALUES& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_DIGEST_VALUES(const TPM2B_DIGEST_VALUES& tpm2b,
+                                            const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_DIGEST_VALUES(
+    const TPM2B_DIGEST_VALUES& tpm2b,
+    std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC
 Serialize_TPML_PCR_SELECTION(const TPML_PCR_SELECTION& value,
                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPML_PCR_SELECTION(ParseCursor* cursor,
+                                              TPML_PCR_SELECTION* value);
 TRUNKS_EXPORT TPM_RC Parse_TPML_PCR_SELECTION(std::string* buffer,
                                               TPML_PCR_SELECTION* value,
                                               std::string* value_bytes);
@@ -2607,6 +3586,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPML_PCR_SELECTION(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPML_ALG_PROPERTY(const TPML_ALG_PROPERTY& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPML_ALG_PROPERTY(ParseCursor* cursor,
+                                             TPML_ALG_PROPERTY* value);
 TRUNKS_EXPORT TPM_RC Parse_TPML_ALG_PROPERTY(std::string* buffer,
                                              TPML_ALG_PROPERTY* value,
                                              std::string* value_bytes);
@@ -2632,6 +3613,8 @@ Parse_TPML_TAGGED_PCR_PROPERTY(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPML_ECC_CURVE(const TPML_ECC_CURVE& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPML_ECC_CURVE(ParseCursor* cursor,
+                                          TPML_ECC_CURVE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPML_ECC_CURVE(std::string* buffer,
                                           TPML_ECC_CURVE* value,
                                           std::string* value_bytes);
@@ -2640,6 +3623,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_CAPABILITY_DATA(const TPMS_CAPABILITY_DATA& value,
                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_CAPABILITY_DATA(ParseCursor* cursor,
+                                                TPMS_CAPABILITY_DATA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_CAPABILITY_DATA(std::string* buffer,
                                                 TPMS_CAPABILITY_DATA* value,
                                                 std::string* value_bytes);
@@ -2647,6 +3632,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_CAPABILITY_DATA(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_CLOCK_INFO(const TPMS_CLOCK_INFO& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_CLOCK_INFO(ParseCursor* cursor,
+                                           TPMS_CLOCK_INFO* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_CLOCK_INFO(std::string* buffer,
                                            TPMS_CLOCK_INFO* value,
                                            std::string* value_bytes);
@@ -2654,6 +3641,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_CLOCK_INFO(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_TIME_INFO(const TPMS_TIME_INFO& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_TIME_INFO(ParseCursor* cursor,
+                                          TPMS_TIME_INFO* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_TIME_INFO(std::string* buffer,
                                           TPMS_TIME_INFO* value,
                                           std::string* value_bytes);
@@ -2662,6 +3651,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_TIME_ATTEST_INFO(const TPMS_TIME_ATTEST_INFO& value,
                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_TIME_ATTEST_INFO(ParseCursor* cursor,
+                                                 TPMS_TIME_ATTEST_INFO* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_TIME_ATTEST_INFO(std::string* buffer,
                                                  TPMS_TIME_ATTEST_INFO* value,
                                                  std::string* value_bytes);
@@ -2669,6 +3660,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_TIME_ATTEST_INFO(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_CERTIFY_INFO(const TPMS_CERTIFY_INFO& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_CERTIFY_INFO(ParseCursor* cursor,
+                                             TPMS_CERTIFY_INFO* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_CERTIFY_INFO(std::string* buffer,
                                              TPMS_CERTIFY_INFO* value,
                                              std::string* value_bytes);
@@ -2676,6 +3669,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_CERTIFY_INFO(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_QUOTE_INFO(const TPMS_QUOTE_INFO& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_QUOTE_INFO(ParseCursor* cursor,
+                                           TPMS_QUOTE_INFO* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_QUOTE_INFO(std::string* buffer,
                                            TPMS_QUOTE_INFO* value,
                                            std::string* value_bytes);
@@ -2702,6 +3697,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_CREATION_INFO(const TPMS_CREATION_INFO& value,
                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_CREATION_INFO(ParseCursor* cursor,
+                                              TPMS_CREATION_INFO* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_CREATION_INFO(std::string* buffer,
                                               TPMS_CREATION_INFO* value,
                                               std::string* value_bytes);
@@ -2710,6 +3707,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_NV_CERTIFY_INFO(const TPMS_NV_CERTIFY_INFO& value,
                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_NV_CERTIFY_INFO(ParseCursor* cursor,
+                                                TPMS_NV_CERTIFY_INFO* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_NV_CERTIFY_INFO(std::string* buffer,
                                                 TPMS_NV_CERTIFY_INFO* value,
                                                 std::string* value_bytes);
@@ -2717,6 +3716,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_NV_CERTIFY_INFO(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_ATTEST(const TPMS_ATTEST& value,
                                            std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_ATTEST(ParseCursor* cursor, TPMS_ATTEST* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_ATTEST(std::string* buffer,
                                        TPMS_ATTEST* value,
                                        std::string* value_bytes);
@@ -2724,16 +3724,36 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_ATTEST(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_ATTEST(const TPM2B_ATTEST& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_ATTEST(ParseCursor* cursor,
+                                        TPM2B_ATTEST* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_ATTEST(std::string* buffer,
                                         TPM2B_ATTEST* value,
                                         std::string* value_bytes);
 
 TRUNKS_EXPORT TPM2B_ATTEST Make_TPM2B_ATTEST(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_ATTEST(const TPM2B_ATTEST& tpm2b);
+inline bool Equal_TPM2B_ATTEST(const TPM2B_ATTEST& a, const TPM2B_ATTEST& b) {
+  return TPM2BBuffersEqual(a.attestation_data, a.size, b.attestation_data,
+                           b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_ATTEST(const TPM2B_ATTEST& tpm2b,
+                                     const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.attestation_data, tpm2b.size,
+                                 bytes.data(), bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_ATTEST(const TPM2B_ATTEST& tpm2b,
+                                         std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.attestation_data),
+                 tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_AUTH_COMMAND(const TPMS_AUTH_COMMAND& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_AUTH_COMMAND(ParseCursor* cursor,
+                                             TPMS_AUTH_COMMAND* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_AUTH_COMMAND(std::string* buffer,
                                              TPMS_AUTH_COMMAND* value,
                                              std::string* value_bytes);
@@ -2742,6 +3762,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_AUTH_RESPONSE(const TPMS_AUTH_RESPONSE& value,
                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_AUTH_RESPONSE(ParseCursor* cursor,
+                                              TPMS_AUTH_RESPONSE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_AUTH_RESPONSE(std::string* buffer,
                                               TPMS_AUTH_RESPONSE* value,
                                               std::string* value_bytes);
@@ -2749,6 +3771,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_AUTH_RESPONSE(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_SYM_DEF(const TPMT_SYM_DEF& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_SYM_DEF(ParseCursor* cursor,
+                                        TPMT_SYM_DEF* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_SYM_DEF(std::string* buffer,
                                         TPMT_SYM_DEF* value,
                                         std::string* value_bytes);
@@ -2757,6 +3781,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMT_SYM_DEF_OBJECT(const TPMT_SYM_DEF_OBJECT& value,
                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_SYM_DEF_OBJECT(ParseCursor* cursor,
+                                               TPMT_SYM_DEF_OBJECT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_SYM_DEF_OBJECT(std::string* buffer,
                                                TPMT_SYM_DEF_OBJECT* value,
                                                std::string* value_bytes);
@@ -2764,17 +3790,36 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_SYM_DEF_OBJECT(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_SYM_KEY(const TPM2B_SYM_KEY& value,
                                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_SYM_KEY(ParseCursor* cursor,
+                                         TPM2B_SYM_KEY* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_SYM_KEY(std::string* buffer,
                                          TPM2B_SYM_KEY* value,
                                          std::string* value_bytes);
 
 TRUNKS_EXPORT TPM2B_SYM_KEY Make_TPM2B_SYM_KEY(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_SYM_KEY(const TPM2B_SYM_KEY& tpm2b);
+inline bool Equal_TPM2B_SYM_KEY(const TPM2B_SYM_KEY& a,
+                                const TPM2B_SYM_KEY& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_SYM_KEY(const TPM2B_SYM_KEY& tpm2b,
+                                      const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_SYM_KEY(const TPM2B_SYM_KEY& tpm2b,
+                                          std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_SYMCIPHER_PARMS(const TPMS_SYMCIPHER_PARMS& value,
                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SYMCIPHER_PARMS(ParseCursor* cursor,
+                                                TPMS_SYMCIPHER_PARMS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SYMCIPHER_PARMS(std::string* buffer,
                                                 TPMS_SYMCIPHER_PARMS* value,
                                                 std::string* value_bytes);
@@ -2783,6 +3828,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPM2B_SENSITIVE_DATA(const TPM2B_SENSITIVE_DATA& value,
                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_SENSITIVE_DATA(ParseCursor* cursor,
+                                                TPM2B_SENSITIVE_DATA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_SENSITIVE_DATA(std::string* buffer,
                                                 TPM2B_SENSITIVE_DATA* value,
                                                 std::string* value_bytes);
@@ -2791,11 +3838,29 @@ TRUNKS_EXPORT TPM2B_SENSITIVE_DATA
 Make_TPM2B_SENSITIVE_DATA(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_SENSITIVE_DATA(
     const TPM2B_SENSITIVE_DATA& tpm2b);
+inline bool Equal_TPM2B_SENSITIVE_DATA(const TPM2B_SENSITIVE_DATA& a,
+                                       const TPM2B_SENSITIVE_DATA& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_SENSITIVE_DATA(const TPM2B_SENSITIVE_DATA& tpm2b,
+                                             const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_SENSITIVE_DATA(
+    const TPM2B_SENSITIVE_DATA& tpm2b,
+    std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_SENSITIVE_CREATE(const TPMS_SENSITIVE_CREATE& value,
                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SENSITIVE_CREATE(ParseCursor* cursor,
+                                                 TPMS_SENSITIVE_CREATE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SENSITIVE_CREATE(std::string* buffer,
                                                  TPMS_SENSITIVE_CREATE* value,
                                                  std::string* value_bytes);
@@ -2804,6 +3869,9 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPM2B_SENSITIVE_CREATE(const TPM2B_SENSITIVE_CREATE& value,
                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_SENSITIVE_CREATE(
+    ParseCursor* cursor,
+    TPM2B_SENSITIVE_CREATE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_SENSITIVE_CREATE(std::string* buffer,
                                                   TPM2B_SENSITIVE_CREATE* value,
                                                   std::string* value_bytes);
@@ -2815,6 +3883,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_SCHEME_SIGHASH(const TPMS_SCHEME_SIGHASH& value,
                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_SIGHASH(ParseCursor* cursor,
+                                               TPMS_SCHEME_SIGHASH* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_SIGHASH(std::string* buffer,
                                                TPMS_SCHEME_SIGHASH* value,
                                                std::string* value_bytes);
@@ -2822,6 +3892,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_SIGHASH(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_SCHEME_XOR(const TPMS_SCHEME_XOR& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_XOR(ParseCursor* cursor,
+                                           TPMS_SCHEME_XOR* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_XOR(std::string* buffer,
                                            TPMS_SCHEME_XOR* value,
                                            std::string* value_bytes);
@@ -2830,6 +3902,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMT_KEYEDHASH_SCHEME(const TPMT_KEYEDHASH_SCHEME& value,
                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_KEYEDHASH_SCHEME(ParseCursor* cursor,
+                                                 TPMT_KEYEDHASH_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_KEYEDHASH_SCHEME(std::string* buffer,
                                                  TPMT_KEYEDHASH_SCHEME* value,
                                                  std::string* value_bytes);
@@ -2837,6 +3911,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_KEYEDHASH_SCHEME(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_SCHEME_ECDAA(const TPMS_SCHEME_ECDAA& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_ECDAA(ParseCursor* cursor,
+                                             TPMS_SCHEME_ECDAA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_ECDAA(std::string* buffer,
                                              TPMS_SCHEME_ECDAA* value,
                                              std::string* value_bytes);
@@ -2844,6 +3920,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_ECDAA(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_SIG_SCHEME(const TPMT_SIG_SCHEME& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_SIG_SCHEME(ParseCursor* cursor,
+                                           TPMT_SIG_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_SIG_SCHEME(std::string* buffer,
                                            TPMT_SIG_SCHEME* value,
                                            std::string* value_bytes);
@@ -2851,6 +3929,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_SIG_SCHEME(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_SCHEME_OAEP(const TPMS_SCHEME_OAEP& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_OAEP(ParseCursor* cursor,
+                                            TPMS_SCHEME_OAEP* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_OAEP(std::string* buffer,
                                             TPMS_SCHEME_OAEP* value,
                                             std::string* value_bytes);
@@ -2858,6 +3938,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_OAEP(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_SCHEME_ECDH(const TPMS_SCHEME_ECDH& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_ECDH(ParseCursor* cursor,
+                                            TPMS_SCHEME_ECDH* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_ECDH(std::string* buffer,
                                             TPMS_SCHEME_ECDH* value,
                                             std::string* value_bytes);
@@ -2865,6 +3947,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_ECDH(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_SCHEME_MGF1(const TPMS_SCHEME_MGF1& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_MGF1(ParseCursor* cursor,
+                                            TPMS_SCHEME_MGF1* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_MGF1(std::string* buffer,
                                             TPMS_SCHEME_MGF1* value,
                                             std::string* value_bytes);
@@ -2881,6 +3965,8 @@ Parse_TPMS_SCHEME_KDF1_SP800_56a(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_SCHEME_KDF2(const TPMS_SCHEME_KDF2& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_KDF2(ParseCursor* cursor,
+                                            TPMS_SCHEME_KDF2* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SCHEME_KDF2(std::string* buffer,
                                             TPMS_SCHEME_KDF2* value,
                                             std::string* value_bytes);
@@ -2897,6 +3983,8 @@ Parse_TPMS_SCHEME_KDF1_SP800_108(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_KDF_SCHEME(const TPMT_KDF_SCHEME& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_KDF_SCHEME(ParseCursor* cursor,
+                                           TPMT_KDF_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_KDF_SCHEME(std::string* buffer,
                                            TPMT_KDF_SCHEME* value,
                                            std::string* value_bytes);
@@ -2904,6 +3992,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_KDF_SCHEME(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_ASYM_SCHEME(const TPMT_ASYM_SCHEME& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_ASYM_SCHEME(ParseCursor* cursor,
+                                            TPMT_ASYM_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_ASYM_SCHEME(std::string* buffer,
                                             TPMT_ASYM_SCHEME* value,
                                             std::string* value_bytes);
@@ -2911,6 +4001,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_ASYM_SCHEME(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_RSA_SCHEME(const TPMT_RSA_SCHEME& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_RSA_SCHEME(ParseCursor* cursor,
+                                           TPMT_RSA_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_RSA_SCHEME(std::string* buffer,
                                            TPMT_RSA_SCHEME* value,
                                            std::string* value_bytes);
@@ -2918,6 +4010,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_RSA_SCHEME(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_RSA_DECRYPT(const TPMT_RSA_DECRYPT& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_RSA_DECRYPT(ParseCursor* cursor,
+                                            TPMT_RSA_DECRYPT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_RSA_DECRYPT(std::string* buffer,
                                             TPMT_RSA_DECRYPT* value,
                                             std::string* value_bytes);
@@ -2926,6 +4020,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPM2B_PUBLIC_KEY_RSA(const TPM2B_PUBLIC_KEY_RSA& value,
                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_PUBLIC_KEY_RSA(ParseCursor* cursor,
+                                                TPM2B_PUBLIC_KEY_RSA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_PUBLIC_KEY_RSA(std::string* buffer,
                                                 TPM2B_PUBLIC_KEY_RSA* value,
                                                 std::string* value_bytes);
@@ -2934,11 +4030,29 @@ TRUNKS_EXPORT TPM2B_PUBLIC_KEY_RSA
 Make_TPM2B_PUBLIC_KEY_RSA(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_PUBLIC_KEY_RSA(
     const TPM2B_PUBLIC_KEY_RSA& tpm2b);
+inline bool Equal_TPM2B_PUBLIC_KEY_RSA(const TPM2B_PUBLIC_KEY_RSA& a,
+                                       const TPM2B_PUBLIC_KEY_RSA& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_PUBLIC_KEY_RSA(const TPM2B_PUBLIC_KEY_RSA& tpm2b,
+                                             const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_PUBLIC_KEY_RSA(
+    const TPM2B_PUBLIC_KEY_RSA& tpm2b,
+    std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC
 Serialize_TPM2B_PRIVATE_KEY_RSA(const TPM2B_PRIVATE_KEY_RSA& value,
                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_PRIVATE_KEY_RSA(ParseCursor* cursor,
+                                                 TPM2B_PRIVATE_KEY_RSA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_PRIVATE_KEY_RSA(std::string* buffer,
                                                  TPM2B_PRIVATE_KEY_RSA* value,
                                                  std::string* value_bytes);
@@ -2947,11 +4061,30 @@ TRUNKS_EXPORT TPM2B_PRIVATE_KEY_RSA
 Make_TPM2B_PRIVATE_KEY_RSA(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_PRIVATE_KEY_RSA(
     const TPM2B_PRIVATE_KEY_RSA& tpm2b);
+inline bool Equal_TPM2B_PRIVATE_KEY_RSA(const TPM2B_PRIVATE_KEY_RSA& a,
+                                        const TPM2B_PRIVATE_KEY_RSA& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_PRIVATE_KEY_RSA(
+    const TPM2B_PRIVATE_KEY_RSA& tpm2b,
+    const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_PRIVATE_KEY_RSA(
+    const TPM2B_PRIVATE_KEY_RSA& tpm2b,
+    std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC
 Serialize_TPM2B_ECC_PARAMETER(const TPM2B_ECC_PARAMETER& value,
                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_ECC_PARAMETER(ParseCursor* cursor,
+                                               TPM2B_ECC_PARAMETER* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_ECC_PARAMETER(std::string* buffer,
                                                TPM2B_ECC_PARAMETER* value,
                                                std::string* value_bytes);
@@ -2960,10 +4093,28 @@ TRUNKS_EXPORT TPM2B_ECC_PARAMETER
 Make_TPM2B_ECC_PARAMETER(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_ECC_PARAMETER(
     const TPM2B_ECC_PARAMETER& tpm2b);
+inline bool Equal_TPM2B_ECC_PARAMETER(const TPM2B_ECC_PARAMETER& a,
+                                      const TPM2B_ECC_PARAMETER& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_ECC_PARAMETER(const TPM2B_ECC_PARAMETER& tpm2b,
+                                            const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_ECC_PARAMETER(
+    const TPM2B_ECC_PARAMETER& tpm2b,
+    std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_ECC_POINT(const TPMS_ECC_POINT& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_ECC_POINT(ParseCursor* cursor,
+                                          TPMS_ECC_POINT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_ECC_POINT(std::string* buffer,
                                           TPMS_ECC_POINT* value,
                                           std::string* value_bytes);
@@ -2971,6 +4122,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_ECC_POINT(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_ECC_POINT(const TPM2B_ECC_POINT& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_ECC_POINT(ParseCursor* cursor,
+                                           TPM2B_ECC_POINT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_ECC_POINT(std::string* buffer,
                                            TPM2B_ECC_POINT* value,
                                            std::string* value_bytes);
@@ -2980,6 +4133,8 @@ TRUNKS_EXPORT TPM2B_ECC_POINT Make_TPM2B_ECC_POINT(const TPMS_ECC_POINT& inner);
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_ECC_SCHEME(const TPMT_ECC_SCHEME& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_ECC_SCHEME(ParseCursor* cursor,
+                                           TPMT_ECC_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_ECC_SCHEME(std::string* buffer,
                                            TPMT_ECC_SCHEME* value,
                                            std::string* value_bytes);
@@ -2997,6 +4152,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_SIGNATURE_RSASSA(const TPMS_SIGNATURE_RSASSA& value,
                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SIGNATURE_RSASSA(ParseCursor* cursor,
+                                                 TPMS_SIGNATURE_RSASSA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SIGNATURE_RSASSA(std::string* buffer,
                                                  TPMS_SIGNATURE_RSASSA* value,
                                                  std::string* value_bytes);
@@ -3005,6 +4162,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_SIGNATURE_RSAPSS(const TPMS_SIGNATURE_RSAPSS& value,
                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SIGNATURE_RSAPSS(ParseCursor* cursor,
+                                                 TPMS_SIGNATURE_RSAPSS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SIGNATURE_RSAPSS(std::string* buffer,
                                                  TPMS_SIGNATURE_RSAPSS* value,
                                                  std::string* value_bytes);
@@ -3013,6 +4172,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_SIGNATURE_ECDSA(const TPMS_SIGNATURE_ECDSA& value,
                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_SIGNATURE_ECDSA(ParseCursor* cursor,
+                                                TPMS_SIGNATURE_ECDSA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_SIGNATURE_ECDSA(std::string* buffer,
                                                 TPMS_SIGNATURE_ECDSA* value,
                                                 std::string* value_bytes);
@@ -3020,6 +4181,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_SIGNATURE_ECDSA(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_SIGNATURE(const TPMT_SIGNATURE& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_SIGNATURE(ParseCursor* cursor,
+                                          TPMT_SIGNATURE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_SIGNATURE(std::string* buffer,
                                           TPMT_SIGNATURE* value,
                                           std::string* value_bytes);
@@ -3028,6 +4191,9 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPM2B_ENCRYPTED_SECRET(const TPM2B_ENCRYPTED_SECRET& value,
                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_ENCRYPTED_SECRET(
+    ParseCursor* cursor,
+    TPM2B_ENCRYPTED_SECRET* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_ENCRYPTED_SECRET(std::string* buffer,
                                                   TPM2B_ENCRYPTED_SECRET* value,
                                                   std::string* value_bytes);
@@ -3036,11 +4202,30 @@ TRUNKS_EXPORT TPM2B_ENCRYPTED_SECRET
 Make_TPM2B_ENCRYPTED_SECRET(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_ENCRYPTED_SECRET(
     const TPM2B_ENCRYPTED_SECRET& tpm2b);
+inline bool Equal_TPM2B_ENCRYPTED_SECRET(const TPM2B_ENCRYPTED_SECRET& a,
+                                         const TPM2B_ENCRYPTED_SECRET& b) {
+  return TPM2BBuffersEqual(a.secret, a.size, b.secret, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_ENCRYPTED_SECRET(
+    const TPM2B_ENCRYPTED_SECRET& tpm2b,
+    const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.secret, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_ENCRYPTED_SECRET(
+    const TPM2B_ENCRYPTED_SECRET& tpm2b,
+    std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.secret), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_KEYEDHASH_PARMS(const TPMS_KEYEDHASH_PARMS& value,
                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_KEYEDHASH_PARMS(ParseCursor* cursor,
+                                                TPMS_KEYEDHASH_PARMS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_KEYEDHASH_PARMS(std::string* buffer,
                                                 TPMS_KEYEDHASH_PARMS* value,
                                                 std::string* value_bytes);
@@ -3048,6 +4233,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_KEYEDHASH_PARMS(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_ASYM_PARMS(const TPMS_ASYM_PARMS& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_ASYM_PARMS(ParseCursor* cursor,
+                                           TPMS_ASYM_PARMS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_ASYM_PARMS(std::string* buffer,
                                            TPMS_ASYM_PARMS* value,
                                            std::string* value_bytes);
@@ -3055,6 +4242,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_ASYM_PARMS(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_RSA_PARMS(const TPMS_RSA_PARMS& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_RSA_PARMS(ParseCursor* cursor,
+                                          TPMS_RSA_PARMS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_RSA_PARMS(std::string* buffer,
                                           TPMS_RSA_PARMS* value,
                                           std::string* value_bytes);
@@ -3062,6 +4251,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_RSA_PARMS(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_ECC_PARMS(const TPMS_ECC_PARMS& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_ECC_PARMS(ParseCursor* cursor,
+                                          TPMS_ECC_PARMS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_ECC_PARMS(std::string* buffer,
                                           TPMS_ECC_PARMS* value,
                                           std::string* value_bytes);
@@ -3069,6 +4260,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_ECC_PARMS(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_PUBLIC_PARMS(const TPMT_PUBLIC_PARMS& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_PUBLIC_PARMS(ParseCursor* cursor,
+                                             TPMT_PUBLIC_PARMS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_PUBLIC_PARMS(std::string* buffer,
                                              TPMT_PUBLIC_PARMS* value,
                                              std::string* value_bytes);
@@ -3076,6 +4269,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_PUBLIC_PARMS(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_PUBLIC(const TPMT_PUBLIC& value,
                                            std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_PUBLIC(ParseCursor* cursor, TPMT_PUBLIC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_PUBLIC(std::string* buffer,
                                        TPMT_PUBLIC* value,
                                        std::string* value_bytes);
@@ -3083,6 +4277,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_PUBLIC(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_PUBLIC(const TPM2B_PUBLIC& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_PUBLIC(ParseCursor* cursor,
+                                        TPM2B_PUBLIC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_PUBLIC(std::string* buffer,
                                         TPM2B_PUBLIC* value,
                                         std::string* value_bytes);
@@ -3102,10 +4298,30 @@ TRUNKS_EXPORT TPM2B_PRIVATE_VENDOR_SPECIFIC
 Make_TPM2B_PRIVATE_VENDOR_SPECIFIC(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_PRIVATE_VENDOR_SPECIFIC(
     const TPM2B_PRIVATE_VENDOR_SPECIFIC& tpm2b);
+inline bool Equal_TPM2B_PRIVATE_VENDOR_SPECIFIC(
+    const TPM2B_PRIVATE_VENDOR_SPECIFIC& a,
+    const TPM2B_PRIVATE_VENDOR_SPECIFIC& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_PRIVATE_VENDOR_SPECIFIC(
+    const TPM2B_PRIVATE_VENDOR_SPECIFIC& tpm2b,
+    const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_PRIVATE_VENDOR_SPECIFIC(
+    const TPM2B_PRIVATE_VENDOR_SPECIFIC& tpm2b,
+    std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPMT_SENSITIVE(const TPMT_SENSITIVE& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMT_SENSITIVE(ParseCursor* cursor,
+                                          TPMT_SENSITIVE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMT_SENSITIVE(std::string* buffer,
                                           TPMT_SENSITIVE* value,
                                           std::string* value_bytes);
@@ -3113,6 +4329,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMT_SENSITIVE(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_SENSITIVE(const TPM2B_SENSITIVE& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_SENSITIVE(ParseCursor* cursor,
+                                           TPM2B_SENSITIVE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_SENSITIVE(std::string* buffer,
                                            TPM2B_SENSITIVE* value,
                                            std::string* value_bytes);
@@ -3122,6 +4340,7 @@ TRUNKS_EXPORT TPM2B_SENSITIVE Make_TPM2B_SENSITIVE(const TPMT_SENSITIVE& inner);
 TRUNKS_EXPORT TPM_RC Serialize__PRIVATE(const _PRIVATE& value,
                                         std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse__PRIVATE(ParseCursor* cursor, _PRIVATE* value);
 TRUNKS_EXPORT TPM_RC Parse__PRIVATE(std::string* buffer,
                                     _PRIVATE* value,
                                     std::string* value_bytes);
@@ -3129,16 +4348,34 @@ TRUNKS_EXPORT TPM_RC Parse__PRIVATE(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_PRIVATE(const TPM2B_PRIVATE& value,
                                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_PRIVATE(ParseCursor* cursor,
+                                         TPM2B_PRIVATE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_PRIVATE(std::string* buffer,
                                          TPM2B_PRIVATE* value,
                                          std::string* value_bytes);
 
 TRUNKS_EXPORT TPM2B_PRIVATE Make_TPM2B_PRIVATE(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_PRIVATE(const TPM2B_PRIVATE& tpm2b);
+inline bool Equal_TPM2B_PRIVATE(const TPM2B_PRIVATE& a,
+                                const TPM2B_PRIVATE& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_PRIVATE(const TPM2B_PRIVATE& tpm2b,
+                                      const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_PRIVATE(const TPM2B_PRIVATE& tpm2b,
+                                          std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize__ID_OBJECT(const _ID_OBJECT& value,
                                           std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse__ID_OBJECT(ParseCursor* cursor, _ID_OBJECT* value);
 TRUNKS_EXPORT TPM_RC Parse__ID_OBJECT(std::string* buffer,
                                       _ID_OBJECT* value,
                                       std::string* value_bytes);
@@ -3146,6 +4383,8 @@ TRUNKS_EXPORT TPM_RC Parse__ID_OBJECT(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_ID_OBJECT(const TPM2B_ID_OBJECT& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_ID_OBJECT(ParseCursor* cursor,
+                                           TPM2B_ID_OBJECT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_ID_OBJECT(std::string* buffer,
                                            TPM2B_ID_OBJECT* value,
                                            std::string* value_bytes);
@@ -3153,10 +4392,27 @@ TRUNKS_EXPORT TPM_RC Parse_TPM2B_ID_OBJECT(std::string* buffer,
 TRUNKS_EXPORT TPM2B_ID_OBJECT Make_TPM2B_ID_OBJECT(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_ID_OBJECT(
     const TPM2B_ID_OBJECT& tpm2b);
+inline bool Equal_TPM2B_ID_OBJECT(const TPM2B_ID_OBJECT& a,
+                                  const TPM2B_ID_OBJECT& b) {
+  return TPM2BBuffersEqual(a.credential, a.size, b.credential, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_ID_OBJECT(const TPM2B_ID_OBJECT& tpm2b,
+                                        const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.credential, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_ID_OBJECT(const TPM2B_ID_OBJECT& tpm2b,
+                                            std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.credential), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_NV_PUBLIC(const TPMS_NV_PUBLIC& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_NV_PUBLIC(ParseCursor* cursor,
+                                          TPMS_NV_PUBLIC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_NV_PUBLIC(std::string* buffer,
                                           TPMS_NV_PUBLIC* value,
                                           std::string* value_bytes);
@@ -3164,6 +4420,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMS_NV_PUBLIC(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPM2B_NV_PUBLIC(const TPM2B_NV_PUBLIC& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_NV_PUBLIC(ParseCursor* cursor,
+                                           TPM2B_NV_PUBLIC* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_NV_PUBLIC(std::string* buffer,
                                            TPM2B_NV_PUBLIC* value,
                                            std::string* value_bytes);
@@ -3183,10 +4441,29 @@ TRUNKS_EXPORT TPM2B_CONTEXT_SENSITIVE
 Make_TPM2B_CONTEXT_SENSITIVE(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_CONTEXT_SENSITIVE(
     const TPM2B_CONTEXT_SENSITIVE& tpm2b);
+inline bool Equal_TPM2B_CONTEXT_SENSITIVE(const TPM2B_CONTEXT_SENSITIVE& a,
+                                          const TPM2B_CONTEXT_SENSITIVE& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_CONTEXT_SENSITIVE(
+    const TPM2B_CONTEXT_SENSITIVE& tpm2b,
+    const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_CONTEXT_SENSITIVE(
+    const TPM2B_CONTEXT_SENSITIVE& tpm2b,
+    std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_CONTEXT_DATA(const TPMS_CONTEXT_DATA& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_CONTEXT_DATA(ParseCursor* cursor,
+                                             TPMS_CONTEXT_DATA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_CONTEXT_DATA(std::string* buffer,
                                              TPMS_CONTEXT_DATA* value,
                                              std::string* value_bytes);
@@ -3195,6 +4472,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPM2B_CONTEXT_DATA(const TPM2B_CONTEXT_DATA& value,
                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_CONTEXT_DATA(ParseCursor* cursor,
+                                              TPM2B_CONTEXT_DATA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_CONTEXT_DATA(std::string* buffer,
                                               TPM2B_CONTEXT_DATA* value,
                                               std::string* value_bytes);
@@ -3203,10 +4482,27 @@ TRUNKS_EXPORT TPM2B_CONTEXT_DATA
 Make_TPM2B_CONTEXT_DATA(const std::string& bytes);
 TRUNKS_EXPORT std::string StringFrom_TPM2B_CONTEXT_DATA(
     const TPM2B_CONTEXT_DATA& tpm2b);
+inline bool Equal_TPM2B_CONTEXT_DATA(const TPM2B_CONTEXT_DATA& a,
+                                     const TPM2B_CONTEXT_DATA& b) {
+  return TPM2BBuffersEqual(a.buffer, a.size, b.buffer, b.size);
+}
+// Compares in constant time; use this for secrets.
+inline bool SecureEqual_TPM2B_CONTEXT_DATA(const TPM2B_CONTEXT_DATA& tpm2b,
+                                           const std::string& bytes) {
+  return TPM2BBuffersSecureEqual(tpm2b.buffer, tpm2b.size, bytes.data(),
+                                 bytes.size());
+}
+// Appends the bytes to |buffer| without a temporary string.
+inline void AppendBytesFrom_TPM2B_CONTEXT_DATA(const TPM2B_CONTEXT_DATA& tpm2b,
+                                               std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(tpm2b.buffer), tpm2b.size);
+}
 
 TRUNKS_EXPORT TPM_RC Serialize_TPMS_CONTEXT(const TPMS_CONTEXT& value,
                                             std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_CONTEXT(ParseCursor* cursor,
+                                        TPMS_CONTEXT* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_CONTEXT(std::string* buffer,
                                         TPMS_CONTEXT* value,
                                         std::string* value_bytes);
@@ -3215,6 +4511,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMS_CREATION_DATA(const TPMS_CREATION_DATA& value,
                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMS_CREATION_DATA(ParseCursor* cursor,
+                                              TPMS_CREATION_DATA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMS_CREATION_DATA(std::string* buffer,
                                               TPMS_CREATION_DATA* value,
                                               std::string* value_bytes);
@@ -3223,6 +4521,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPM2B_CREATION_DATA(const TPM2B_CREATION_DATA& value,
                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPM2B_CREATION_DATA(ParseCursor* cursor,
+                                               TPM2B_CREATION_DATA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPM2B_CREATION_DATA(std::string* buffer,
                                                TPM2B_CREATION_DATA* value,
                                                std::string* value_bytes);
@@ -3233,6 +4533,7 @@ Make_TPM2B_CREATION_DATA(const TPMS_CREATION_DATA& inner);
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_HA(const TPMU_HA& value,
                                        std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_HA(ParseCursor* cursor, TPMU_HA* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_HA(std::string* buffer,
                                    TPMU_HA* value,
                                    std::string* value_bytes);
@@ -3240,6 +4541,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPMU_HA(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_NAME(const TPMU_NAME& value,
                                          std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_NAME(ParseCursor* cursor, TPMU_NAME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_NAME(std::string* buffer,
                                      TPMU_NAME* value,
                                      std::string* value_bytes);
@@ -3247,6 +4549,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMU_NAME(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_CAPABILITIES(const TPMU_CAPABILITIES& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_CAPABILITIES(ParseCursor* cursor,
+                                             TPMU_CAPABILITIES* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_CAPABILITIES(std::string* buffer,
                                              TPMU_CAPABILITIES* value,
                                              std::string* value_bytes);
@@ -3254,6 +4558,7 @@ TRUNKS_EXPORT TPM_RC Parse_TPMU_CAPABILITIES(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_ATTEST(const TPMU_ATTEST& value,
                                            std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_ATTEST(ParseCursor* cursor, TPMU_ATTEST* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_ATTEST(std::string* buffer,
                                        TPMU_ATTEST* value,
                                        std::string* value_bytes);
@@ -3261,6 +4566,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMU_ATTEST(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_SYM_KEY_BITS(const TPMU_SYM_KEY_BITS& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_SYM_KEY_BITS(ParseCursor* cursor,
+                                             TPMU_SYM_KEY_BITS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_SYM_KEY_BITS(std::string* buffer,
                                              TPMU_SYM_KEY_BITS* value,
                                              std::string* value_bytes);
@@ -3268,6 +4575,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMU_SYM_KEY_BITS(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_SYM_MODE(const TPMU_SYM_MODE& value,
                                              std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_SYM_MODE(ParseCursor* cursor,
+                                         TPMU_SYM_MODE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_SYM_MODE(std::string* buffer,
                                          TPMU_SYM_MODE* value,
                                          std::string* value_bytes);
@@ -3276,6 +4585,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMU_SCHEME_KEYEDHASH(const TPMU_SCHEME_KEYEDHASH& value,
                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_SCHEME_KEYEDHASH(ParseCursor* cursor,
+                                                 TPMU_SCHEME_KEYEDHASH* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_SCHEME_KEYEDHASH(std::string* buffer,
                                                  TPMU_SCHEME_KEYEDHASH* value,
                                                  std::string* value_bytes);
@@ -3283,6 +4594,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMU_SCHEME_KEYEDHASH(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_SIG_SCHEME(const TPMU_SIG_SCHEME& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_SIG_SCHEME(ParseCursor* cursor,
+                                           TPMU_SIG_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_SIG_SCHEME(std::string* buffer,
                                            TPMU_SIG_SCHEME* value,
                                            std::string* value_bytes);
@@ -3290,6 +4603,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMU_SIG_SCHEME(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_KDF_SCHEME(const TPMU_KDF_SCHEME& value,
                                                std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_KDF_SCHEME(ParseCursor* cursor,
+                                           TPMU_KDF_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_KDF_SCHEME(std::string* buffer,
                                            TPMU_KDF_SCHEME* value,
                                            std::string* value_bytes);
@@ -3297,6 +4612,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMU_KDF_SCHEME(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_ASYM_SCHEME(const TPMU_ASYM_SCHEME& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_ASYM_SCHEME(ParseCursor* cursor,
+                                            TPMU_ASYM_SCHEME* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_ASYM_SCHEME(std::string* buffer,
                                             TPMU_ASYM_SCHEME* value,
                                             std::string* value_bytes);
@@ -3304,6 +4621,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMU_ASYM_SCHEME(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_SIGNATURE(const TPMU_SIGNATURE& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_SIGNATURE(ParseCursor* cursor,
+                                          TPMU_SIGNATURE* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_SIGNATURE(std::string* buffer,
                                           TPMU_SIGNATURE* value,
                                           std::string* value_bytes);
@@ -3312,6 +4631,8 @@ TRUNKS_EXPORT TPM_RC
 Serialize_TPMU_ENCRYPTED_SECRET(const TPMU_ENCRYPTED_SECRET& value,
                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_ENCRYPTED_SECRET(ParseCursor* cursor,
+                                                 TPMU_ENCRYPTED_SECRET* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_ENCRYPTED_SECRET(std::string* buffer,
                                                  TPMU_ENCRYPTED_SECRET* value,
                                                  std::string* value_bytes);
@@ -3319,6 +4640,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMU_ENCRYPTED_SECRET(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_PUBLIC_ID(const TPMU_PUBLIC_ID& value,
                                               std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_PUBLIC_ID(ParseCursor* cursor,
+                                          TPMU_PUBLIC_ID* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_PUBLIC_ID(std::string* buffer,
                                           TPMU_PUBLIC_ID* value,
                                           std::string* value_bytes);
@@ -3326,6 +4649,8 @@ TRUNKS_EXPORT TPM_RC Parse_TPMU_PUBLIC_ID(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_PUBLIC_PARMS(const TPMU_PUBLIC_PARMS& value,
                                                  std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_PUBLIC_PARMS(ParseCursor* cursor,
+                                             TPMU_PUBLIC_PARMS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_PUBLIC_PARMS(std::string* buffer,
                                              TPMU_PUBLIC_PARMS* value,
                                              std::string* value_bytes);
@@ -3342,21 +4667,211 @@ Parse_TPMU_SENSITIVE_COMPOSITE(std::string* buffer,
 TRUNKS_EXPORT TPM_RC Serialize_TPMU_SYM_DETAILS(const TPMU_SYM_DETAILS& value,
                                                 std::string* buffer);
 
+TRUNKS_EXPORT TPM_RC Parse_TPMU_SYM_DETAILS(ParseCursor* cursor,
+                                            TPMU_SYM_DETAILS* value);
 TRUNKS_EXPORT TPM_RC Parse_TPMU_SYM_DETAILS(std::string* buffer,
                                             TPMU_SYM_DETAILS* value,
                                             std::string* value_bytes);
 
+// Compact variants of large structures. A list holds only its elements and
+// only the member of a union chosen by the selector is set, so parsing into a
+// compact variant does not touch the worst case size of the structure. Make_*
+// and Expand_* convert to and from the structures used by the Tpm interface.
+struct TPML_CC_COMPACT {
+  std::vector<TPM_CC> command_codes;
+};
+
+struct TPML_CCA_COMPACT {
+  std::vector<TPMA_CC> command_attributes;
+};
+
+struct TPML_HANDLE_COMPACT {
+  std::vector<TPM_HANDLE> handle;
+};
+
+struct TPML_PCR_SELECTION_COMPACT {
+  std::vector<TPMS_PCR_SELECTION> pcr_selections;
+};
+
+struct TPML_ALG_PROPERTY_COMPACT {
+  std::vector<TPMS_ALG_PROPERTY> alg_properties;
+};
+
+struct TPML_TAGGED_TPM_PROPERTY_COMPACT {
+  std::vector<TPMS_TAGGED_PROPERTY> tpm_property;
+};
+
+struct TPML_TAGGED_PCR_PROPERTY_COMPACT {
+  std::vector<TPMS_TAGGED_PCR_SELECT> pcr_property;
+};
+
+struct TPML_ECC_CURVE_COMPACT {
+  std::vector<TPM_ECC_CURVE> ecc_curves;
+};
+
+// Only the member chosen by the selector is set.
+struct TPMU_CAPABILITIES_COMPACT {
+  TPML_ALG_PROPERTY_COMPACT algorithms;
+  TPML_HANDLE_COMPACT handles;
+  TPML_CCA_COMPACT command;
+  TPML_CC_COMPACT pp_commands;
+  TPML_CC_COMPACT audit_commands;
+  TPML_PCR_SELECTION_COMPACT assigned_pcr;
+  TPML_TAGGED_TPM_PROPERTY_COMPACT tpm_properties;
+  TPML_TAGGED_PCR_PROPERTY_COMPACT pcr_properties;
+  TPML_ECC_CURVE_COMPACT ecc_curves;
+};
+
+struct TPMS_CAPABILITY_DATA_COMPACT {
+  TPM_CAP capability;
+  TPMU_CAPABILITIES_COMPACT data;
+};
+
+TRUNKS_EXPORT TPM_RC Parse_TPML_CC_COMPACT(ParseCursor* cursor,
+                                           TPML_CC_COMPACT* value);
+TRUNKS_EXPORT TPM_RC Parse_TPML_CC_COMPACT(std::string* buffer,
+                                           TPML_CC_COMPACT* value,
+                                           std::string* value_bytes);
+TRUNKS_EXPORT TPML_CC_COMPACT Make_TPML_CC_COMPACT(const TPML_CC& value);
+TRUNKS_EXPORT TPM_RC Expand_TPML_CC_COMPACT(const TPML_CC_COMPACT& value,
+                                            TPML_CC* expanded);
+
+TRUNKS_EXPORT TPM_RC Parse_TPML_CCA_COMPACT(ParseCursor* cursor,
+                                            TPML_CCA_COMPACT* value);
+TRUNKS_EXPORT TPM_RC Parse_TPML_CCA_COMPACT(std::string* buffer,
+                                            TPML_CCA_COMPACT* value,
+                                            std::string* value_bytes);
+TRUNKS_EXPORT TPML_CCA_COMPACT Make_TPML_CCA_COMPACT(const TPML_CCA& value);
+TRUNKS_EXPORT TPM_RC Expand_TPML_CCA_COMPACT(const TPML_CCA_COMPACT& value,
+                                             TPML_CCA* expanded);
+
+TRUNKS_EXPORT TPM_RC Parse_TPML_HANDLE_COMPACT(ParseCursor* cursor,
+                                               TPML_HANDLE_COMPACT* value);
+TRUNKS_EXPORT TPM_RC Parse_TPML_HANDLE_COMPACT(std::string* buffer,
+                                               TPML_HANDLE_COMPACT* value,
+                                               std::string* value_bytes);
+TRUNKS_EXPORT TPML_HANDLE_COMPACT Make_TPML_HANDLE_COMPACT(
+    const TPML_HANDLE& value);
+TRUNKS_EXPORT TPM_RC Expand_TPML_HANDLE_COMPACT(
+    const TPML_HANDLE_COMPACT& value,
+    TPML_HANDLE* expanded);
+
+TRUNKS_EXPORT TPM_RC Parse_TPML_PCR_SELECTION_COMPACT(
+    ParseCursor* cursor,
+    TPML_PCR_SELECTION_COMPACT* value);
+TRUNKS_EXPORT TPM_RC Parse_TPML_PCR_SELECTION_COMPACT(
+    std::string* buffer,
+    TPML_PCR_SELECTION_COMPACT* value,
+    std::string* value_bytes);
+TRUNKS_EXPORT TPML_PCR_SELECTION_COMPACT Make_TPML_PCR_SELECTION_COMPACT(
+    const TPML_PCR_SELECTION& value);
+TRUNKS_EXPORT TPM_RC Expand_TPML_PCR_SELECTION_COMPACT(
+    const TPML_PCR_SELECTION_COMPACT& value,
+    TPML_PCR_SELECTION* expanded);
+
+TRUNKS_EXPORT TPM_RC Parse_TPML_ALG_PROPERTY_COMPACT(
+    ParseCursor* cursor,
+    TPML_ALG_PROPERTY_COMPACT* value);
+TRUNKS_EXPORT TPM_RC Parse_TPML_ALG_PROPERTY_COMPACT(
+    std::string* buffer,
+    TPML_ALG_PROPERTY_COMPACT* value,
+    std::string* value_bytes);
+TRUNKS_EXPORT TPML_ALG_PROPERTY_COMPACT Make_TPML_ALG_PROPERTY_COMPACT(
+    const TPML_ALG_PROPERTY& value);
+TRUNKS_EXPORT TPM_RC Expand_TPML_ALG_PROPERTY_COMPACT(
+    const TPML_ALG_PROPERTY_COMPACT& value,
+    TPML_ALG_PROPERTY* expanded);
+
+TRUNKS_EXPORT TPM_RC Parse_TPML_TAGGED_TPM_PROPERTY_COMPACT(
+    ParseCursor* cursor,
+    TPML_TAGGED_TPM_PROPERTY_COMPACT* value);
+TRUNKS_EXPORT TPM_RC Parse_TPML_TAGGED_TPM_PROPERTY_COMPACT(
+    std::string* buffer,
+    TPML_TAGGED_TPM_PROPERTY_COMPACT* value,
+    std::string* value_bytes);
+TRUNKS_EXPORT TPML_TAGGED_TPM_PROPERTY_COMPACT
+Make_TPML_TAGGED_TPM_PROPERTY_COMPACT(const TPML_TAGGED_TPM_PROPERTY& value);
+TRUNKS_EXPORT TPM_RC Expand_TPML_TAGGED_TPM_PROPERTY_COMPACT(
+    const TPML_TAGGED_TPM_PROPERTY_COMPACT& value,
+    TPML_TAGGED_TPM_PROPERTY* expanded);
+
+TRUNKS_EXPORT TPM_RC Parse_TPML_TAGGED_PCR_PROPERTY_COMPACT(
+    ParseCursor* cursor,
+    TPML_TAGGED_PCR_PROPERTY_COMPACT* value);
+TRUNKS_EXPORT TPM_RC Parse_TPML_TAGGED_PCR_PROPERTY_COMPACT(
+    std::string* buffer,
+    TPML_TAGGED_PCR_PROPERTY_COMPACT* value,
+    std::string* value_bytes);
+TRUNKS_EXPORT TPML_TAGGED_PCR_PROPERTY_COMPACT
+Make_TPML_TAGGED_PCR_PROPERTY_COMPACT(const TPML_TAGGED_PCR_PROPERTY& value);
+TRUNKS_EXPORT TPM_RC Expand_TPML_TAGGED_PCR_PROPERTY_COMPACT(
+    const TPML_TAGGED_PCR_PROPERTY_COMPACT& value,
+    TPML_TAGGED_PCR_PROPERTY* expanded);
+
+TRUNKS_EXPORT TPM_RC Parse_TPML_ECC_CURVE_COMPACT(
+    ParseCursor* cursor,
+    TPML_ECC_CURVE_COMPACT* value);
+TRUNKS_EXPORT TPM_RC Parse_TPML_ECC_CURVE_COMPACT(std::string* buffer,
+                                                  TPML_ECC_CURVE_COMPACT* value,
+                                                  std::string* value_bytes);
+TRUNKS_EXPORT TPML_ECC_CURVE_COMPACT Make_TPML_ECC_CURVE_COMPACT(
+    const TPML_ECC_CURVE& value);
+TRUNKS_EXPORT TPM_RC Expand_TPML_ECC_CURVE_COMPACT(
+    const TPML_ECC_CURVE_COMPACT& value,
+    TPML_ECC_CURVE* expanded);
+
+TRUNKS_EXPORT TPM_RC Parse_TPMU_CAPABILITIES_COMPACT(
+    ParseCursor* cursor,
+    TPM_CAP selector,
+    TPMU_CAPABILITIES_COMPACT* value);
+TRUNKS_EXPORT TPMU_CAPABILITIES_COMPACT Make_TPMU_CAPABILITIES_COMPACT(
+    TPM_CAP selector,
+    const TPMU_CAPABILITIES& value);
+TRUNKS_EXPORT TPM_RC Expand_TPMU_CAPABILITIES_COMPACT(
+    TPM_CAP selector,
+    const TPMU_CAPABILITIES_COMPACT& value,
+    TPMU_CAPABILITIES* expanded);
+
+TRUNKS_EXPORT TPM_RC Parse_TPMS_CAPABILITY_DATA_COMPACT(
+    ParseCursor* cursor,
+    TPMS_CAPABILITY_DATA_COMPACT* value);
+TRUNKS_EXPORT TPM_RC Parse_TPMS_CAPABILITY_DATA_COMPACT(
+    std::string* buffer,
+    TPMS_CAPABILITY_DATA_COMPACT* value,
+    std::string* value_bytes);
+TRUNKS_EXPORT TPMS_CAPABILITY_DATA_COMPACT Make_TPMS_CAPABILITY_DATA_COMPACT(
+    const TPMS_CAPABILITY_DATA& value);
+TRUNKS_EXPORT TPM_RC Expand_TPMS_CAPABILITY_DATA_COMPACT(
+    const TPMS_CAPABILITY_DATA_COMPACT& value,
+    TPMS_CAPABILITY_DATA* expanded);
+
 class TRUNKS_EXPORT Tpm {
  public:
   // Does not take ownership of |transceiver|.
   explicit Tpm(CommandTransceiver* transceiver) : transceiver_(transceiver) {}
   virtual ~Tpm() {}
 
+  // Sends the serialized |commands| in order, with no other command
+  // interleaved, and returns one response per command sent. Commands after the
+  // first one that fails are not sent.
+  virtual std::vector<std::string> SendCommandBatchAndWait(
+      const std::vector<std::string>& commands);
+
+  // Sends independent serialized |commands|, possibly several at once, and
+  // returns one response per command, in order.
+  virtual std::vector<std::string> SendCommandsAndWait(
+      const std::vector<std::string>& commands);
+
   typedef base::Callback<void(TPM_RC response_code)> StartupResponse;
   static TPM_RC SerializeCommand_Startup(
       const TPM_SU& startup_type,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kStartupCommandSize = 12;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_Startup(
+      const TPM_SU& startup_type,
+      std::array<uint8_t, kStartupCommandSize>* command);
   static TPM_RC ParseResponse_Startup(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -3370,6 +4885,11 @@ class TRUNKS_EXPORT Tpm {
       const TPM_SU& shutdown_type,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kShutdownCommandSize = 12;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_Shutdown(
+      const TPM_SU& shutdown_type,
+      std::array<uint8_t, kShutdownCommandSize>* command);
   static TPM_RC ParseResponse_Shutdown(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -3383,6 +4903,11 @@ class TRUNKS_EXPORT Tpm {
       const TPMI_YES_NO& full_test,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kSelfTestCommandSize = 11;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_SelfTest(
+      const TPMI_YES_NO& full_test,
+      std::array<uint8_t, kSelfTestCommandSize>* command);
   static TPM_RC ParseResponse_SelfTest(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -3416,6 +4941,10 @@ class TRUNKS_EXPORT Tpm {
   static TPM_RC SerializeCommand_GetTestResult(
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kGetTestResultCommandSize = 10;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_GetTestResult(
+      std::array<uint8_t, kGetTestResultCommandSize>* command);
   static TPM_RC ParseResponse_GetTestResult(
       const std::string& response,
       TPM2B_MAX_BUFFER* out_data,
@@ -3478,6 +5007,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& session_handle_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kPolicyRestartCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_PolicyRestart(
+      const TPMI_SH_POLICY& session_handle,
+      std::array<uint8_t, kPolicyRestartCommandSize>* command);
   static TPM_RC ParseResponse_PolicyRestart(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -3599,6 +5133,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& object_handle_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kReadPublicCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_ReadPublic(
+      const TPMI_DH_OBJECT& object_handle,
+      std::array<uint8_t, kReadPublicCommandSize>* command);
   static TPM_RC ParseResponse_ReadPublic(
       const std::string& response,
       TPM2B_PUBLIC* out_public,
@@ -3686,6 +5225,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& item_handle_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kUnsealCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_Unseal(
+      const TPMI_DH_OBJECT& item_handle,
+      std::array<uint8_t, kUnsealCommandSize>* command);
   static TPM_RC ParseResponse_Unseal(
       const std::string& response,
       TPM2B_SENSITIVE_DATA* out_data,
@@ -3906,6 +5450,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& key_handle_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kECDH_KeyGenCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_ECDH_KeyGen(
+      const TPMI_DH_OBJECT& key_handle,
+      std::array<uint8_t, kECDH_KeyGenCommandSize>* command);
   static TPM_RC ParseResponse_ECDH_KeyGen(
       const std::string& response,
       TPM2B_ECC_POINT* z_point,
@@ -3950,6 +5499,11 @@ class TRUNKS_EXPORT Tpm {
       const TPMI_ECC_CURVE& curve_id,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kECC_ParametersCommandSize = 12;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_ECC_Parameters(
+      const TPMI_ECC_CURVE& curve_id,
+      std::array<uint8_t, kECC_ParametersCommandSize>* command);
   static TPM_RC ParseResponse_ECC_Parameters(
       const std::string& response,
       TPMS_ALGORITHM_DETAIL_ECC* parameters,
@@ -4091,6 +5645,11 @@ class TRUNKS_EXPORT Tpm {
       const UINT16& bytes_requested,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kGetRandomCommandSize = 12;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_GetRandom(
+      const UINT16& bytes_requested,
+      std::array<uint8_t, kGetRandomCommandSize>* command);
   static TPM_RC ParseResponse_GetRandom(
       const std::string& response,
       TPM2B_DIGEST* random_bytes,
@@ -4520,6 +6079,12 @@ class TRUNKS_EXPORT Tpm {
       const TPMI_ECC_CURVE& curve_id,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kEC_EphemeralCommandSize = 16;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_EC_Ephemeral(
+      const UINT32& param_size,
+      const TPMI_ECC_CURVE& curve_id,
+      std::array<uint8_t, kEC_EphemeralCommandSize>* command);
   static TPM_RC ParseResponse_EC_Ephemeral(
       const std::string& response,
       UINT32* param_size_out,
@@ -4774,6 +6339,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& pcr_handle_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kPCR_ResetCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_PCR_Reset(
+      const TPMI_DH_PCR& pcr_handle,
+      std::array<uint8_t, kPCR_ResetCommandSize>* command);
   static TPM_RC ParseResponse_PCR_Reset(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -4951,6 +6521,12 @@ class TRUNKS_EXPORT Tpm {
       const TPMA_LOCALITY& locality,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kPolicyLocalityCommandSize = 15;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_PolicyLocality(
+      const TPMI_SH_POLICY& policy_session,
+      const TPMA_LOCALITY& locality,
+      std::array<uint8_t, kPolicyLocalityCommandSize>* command);
   static TPM_RC ParseResponse_PolicyLocality(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5034,6 +6610,12 @@ class TRUNKS_EXPORT Tpm {
       const TPM_CC& code,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kPolicyCommandCodeCommandSize = 18;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_PolicyCommandCode(
+      const TPMI_SH_POLICY& policy_session,
+      const TPM_CC& code,
+      std::array<uint8_t, kPolicyCommandCodeCommandSize>* command);
   static TPM_RC ParseResponse_PolicyCommandCode(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5054,6 +6636,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& policy_session_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kPolicyPhysicalPresenceCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_PolicyPhysicalPresence(
+      const TPMI_SH_POLICY& policy_session,
+      std::array<uint8_t, kPolicyPhysicalPresenceCommandSize>* command);
   static TPM_RC ParseResponse_PolicyPhysicalPresence(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5169,6 +6756,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& policy_session_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kPolicyAuthValueCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_PolicyAuthValue(
+      const TPMI_SH_POLICY& policy_session,
+      std::array<uint8_t, kPolicyAuthValueCommandSize>* command);
   static TPM_RC ParseResponse_PolicyAuthValue(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5186,6 +6778,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& policy_session_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kPolicyPasswordCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_PolicyPassword(
+      const TPMI_SH_POLICY& policy_session,
+      std::array<uint8_t, kPolicyPasswordCommandSize>* command);
   static TPM_RC ParseResponse_PolicyPassword(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5205,6 +6802,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& policy_session_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kPolicyGetDigestCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_PolicyGetDigest(
+      const TPMI_SH_POLICY& policy_session,
+      std::array<uint8_t, kPolicyGetDigestCommandSize>* command);
   static TPM_RC ParseResponse_PolicyGetDigest(
       const std::string& response,
       TPM2B_DIGEST* policy_digest,
@@ -5225,6 +6827,12 @@ class TRUNKS_EXPORT Tpm {
       const TPMI_YES_NO& written_set,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kPolicyNvWrittenCommandSize = 15;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_PolicyNvWritten(
+      const TPMI_SH_POLICY& policy_session,
+      const TPMI_YES_NO& written_set,
+      std::array<uint8_t, kPolicyNvWrittenCommandSize>* command);
   static TPM_RC ParseResponse_PolicyNvWritten(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5294,6 +6902,13 @@ class TRUNKS_EXPORT Tpm {
       const TPMI_YES_NO& state,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kHierarchyControlCommandSize = 19;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_HierarchyControl(
+      const TPMI_RH_HIERARCHY& auth_handle,
+      const TPMI_RH_ENABLES& enable,
+      const TPMI_YES_NO& state,
+      std::array<uint8_t, kHierarchyControlCommandSize>* command);
   static TPM_RC ParseResponse_HierarchyControl(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5338,6 +6953,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& auth_handle_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kChangePPSCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_ChangePPS(
+      const TPMI_RH_PLATFORM& auth_handle,
+      std::array<uint8_t, kChangePPSCommandSize>* command);
   static TPM_RC ParseResponse_ChangePPS(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5354,6 +6974,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& auth_handle_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kChangeEPSCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_ChangeEPS(
+      const TPMI_RH_PLATFORM& auth_handle,
+      std::array<uint8_t, kChangeEPSCommandSize>* command);
   static TPM_RC ParseResponse_ChangeEPS(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5370,6 +6995,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& auth_handle_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kClearCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_Clear(
+      const TPMI_RH_CLEAR& auth_handle,
+      std::array<uint8_t, kClearCommandSize>* command);
   static TPM_RC ParseResponse_Clear(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5387,6 +7017,12 @@ class TRUNKS_EXPORT Tpm {
       const TPMI_YES_NO& disable,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kClearControlCommandSize = 15;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_ClearControl(
+      const TPMI_RH_CLEAR& auth,
+      const TPMI_YES_NO& disable,
+      std::array<uint8_t, kClearControlCommandSize>* command);
   static TPM_RC ParseResponse_ClearControl(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5429,6 +7065,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& lock_handle_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kDictionaryAttackLockResetCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_DictionaryAttackLockReset(
+      const TPMI_RH_LOCKOUT& lock_handle,
+      std::array<uint8_t, kDictionaryAttackLockResetCommandSize>* command);
   static TPM_RC ParseResponse_DictionaryAttackLockReset(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5451,6 +7092,14 @@ class TRUNKS_EXPORT Tpm {
       const UINT32& lockout_recovery,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kDictionaryAttackParametersCommandSize = 26;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_DictionaryAttackParameters(
+      const TPMI_RH_LOCKOUT& lock_handle,
+      const UINT32& new_max_tries,
+      const UINT32& new_recovery_time,
+      const UINT32& lockout_recovery,
+      std::array<uint8_t, kDictionaryAttackParametersCommandSize>* command);
   static TPM_RC ParseResponse_DictionaryAttackParameters(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5498,6 +7147,12 @@ class TRUNKS_EXPORT Tpm {
       const UINT32& algorithm_set,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kSetAlgorithmSetCommandSize = 18;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_SetAlgorithmSet(
+      const TPMI_RH_PLATFORM& auth_handle,
+      const UINT32& algorithm_set,
+      std::array<uint8_t, kSetAlgorithmSetCommandSize>* command);
   static TPM_RC ParseResponse_SetAlgorithmSet(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5568,6 +7223,11 @@ class TRUNKS_EXPORT Tpm {
       const UINT32& sequence_number,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kFirmwareReadCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_FirmwareRead(
+      const UINT32& sequence_number,
+      std::array<uint8_t, kFirmwareReadCommandSize>* command);
   static TPM_RC ParseResponse_FirmwareRead(
       const std::string& response,
       TPM2B_MAX_BUFFER* fu_data,
@@ -5587,6 +7247,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& save_handle_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kContextSaveCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_ContextSave(
+      const TPMI_DH_CONTEXT& save_handle,
+      std::array<uint8_t, kContextSaveCommandSize>* command);
   static TPM_RC ParseResponse_ContextSave(
       const std::string& response,
       TPMS_CONTEXT* context,
@@ -5621,6 +7286,11 @@ class TRUNKS_EXPORT Tpm {
       const TPMI_DH_CONTEXT& flush_handle,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kFlushContextCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_FlushContext(
+      const TPMI_DH_CONTEXT& flush_handle,
+      std::array<uint8_t, kFlushContextCommandSize>* command);
   static TPM_RC ParseResponse_FlushContext(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5639,6 +7309,13 @@ class TRUNKS_EXPORT Tpm {
       const TPMI_DH_PERSISTENT& persistent_handle,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kEvictControlCommandSize = 22;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_EvictControl(
+      const TPMI_RH_PROVISION& auth,
+      const TPMI_DH_OBJECT& object_handle,
+      const TPMI_DH_PERSISTENT& persistent_handle,
+      std::array<uint8_t, kEvictControlCommandSize>* command);
   static TPM_RC ParseResponse_EvictControl(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5662,6 +7339,10 @@ class TRUNKS_EXPORT Tpm {
   static TPM_RC SerializeCommand_ReadClock(
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kReadClockCommandSize = 10;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_ReadClock(
+      std::array<uint8_t, kReadClockCommandSize>* command);
   static TPM_RC ParseResponse_ReadClock(
       const std::string& response,
       TPMS_TIME_INFO* current_time,
@@ -5677,6 +7358,12 @@ class TRUNKS_EXPORT Tpm {
       const UINT64& new_time,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kClockSetCommandSize = 22;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_ClockSet(
+      const TPMI_RH_PROVISION& auth,
+      const UINT64& new_time,
+      std::array<uint8_t, kClockSetCommandSize>* command);
   static TPM_RC ParseResponse_ClockSet(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5696,6 +7383,12 @@ class TRUNKS_EXPORT Tpm {
       const TPM_CLOCK_ADJUST& rate_adjust,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kClockRateAdjustCommandSize = 15;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_ClockRateAdjust(
+      const TPMI_RH_PROVISION& auth,
+      const TPM_CLOCK_ADJUST& rate_adjust,
+      std::array<uint8_t, kClockRateAdjustCommandSize>* command);
   static TPM_RC ParseResponse_ClockRateAdjust(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5719,6 +7412,13 @@ class TRUNKS_EXPORT Tpm {
       const UINT32& property_count,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kGetCapabilityCommandSize = 22;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_GetCapability(
+      const TPM_CAP& capability,
+      const UINT32& property,
+      const UINT32& property_count,
+      std::array<uint8_t, kGetCapabilityCommandSize>* command);
   static TPM_RC ParseResponse_GetCapability(
       const std::string& response,
       TPMI_YES_NO* more_data,
@@ -5736,6 +7436,11 @@ class TRUNKS_EXPORT Tpm {
       TPMI_YES_NO* more_data,
       TPMS_CAPABILITY_DATA* capability_data,
       AuthorizationDelegate* authorization_delegate);
+  static TPM_RC ParseResponse_GetCapability(
+      const std::string& response,
+      TPMI_YES_NO* more_data,
+      TPMS_CAPABILITY_DATA_COMPACT* capability_data,
+      AuthorizationDelegate* authorization_delegate);
   typedef base::Callback<void(TPM_RC response_code)> TestParmsResponse;
   static TPM_RC SerializeCommand_TestParms(
       const TPMT_PUBLIC_PARMS& parameters,
@@ -5780,6 +7485,12 @@ class TRUNKS_EXPORT Tpm {
       const std::string& nv_index_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kNV_UndefineSpaceCommandSize = 18;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_NV_UndefineSpace(
+      const TPMI_RH_PROVISION& auth_handle,
+      const TPMI_RH_NV_INDEX& nv_index,
+      std::array<uint8_t, kNV_UndefineSpaceCommandSize>* command);
   static TPM_RC ParseResponse_NV_UndefineSpace(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5804,6 +7515,12 @@ class TRUNKS_EXPORT Tpm {
       const std::string& platform_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kNV_UndefineSpaceSpecialCommandSize = 18;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_NV_UndefineSpaceSpecial(
+      const TPMI_RH_NV_INDEX& nv_index,
+      const TPMI_RH_PLATFORM& platform,
+      std::array<uint8_t, kNV_UndefineSpaceSpecialCommandSize>* command);
   static TPM_RC ParseResponse_NV_UndefineSpaceSpecial(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5829,6 +7546,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& nv_index_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kNV_ReadPublicCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_NV_ReadPublic(
+      const TPMI_RH_NV_INDEX& nv_index,
+      std::array<uint8_t, kNV_ReadPublicCommandSize>* command);
   static TPM_RC ParseResponse_NV_ReadPublic(
       const std::string& response,
       TPM2B_NV_PUBLIC* nv_public,
@@ -5880,6 +7602,12 @@ class TRUNKS_EXPORT Tpm {
       const std::string& nv_index_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kNV_IncrementCommandSize = 18;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_NV_Increment(
+      const TPMI_RH_NV_AUTH& auth_handle,
+      const TPMI_RH_NV_INDEX& nv_index,
+      std::array<uint8_t, kNV_IncrementCommandSize>* command);
   static TPM_RC ParseResponse_NV_Increment(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5929,6 +7657,13 @@ class TRUNKS_EXPORT Tpm {
       const UINT64& bits,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kNV_SetBitsCommandSize = 26;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_NV_SetBits(
+      const TPMI_RH_NV_AUTH& auth_handle,
+      const TPMI_RH_NV_INDEX& nv_index,
+      const UINT64& bits,
+      std::array<uint8_t, kNV_SetBitsCommandSize>* command);
   static TPM_RC ParseResponse_NV_SetBits(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5953,6 +7688,12 @@ class TRUNKS_EXPORT Tpm {
       const std::string& nv_index_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kNV_WriteLockCommandSize = 18;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_NV_WriteLock(
+      const TPMI_RH_NV_AUTH& auth_handle,
+      const TPMI_RH_NV_INDEX& nv_index,
+      std::array<uint8_t, kNV_WriteLockCommandSize>* command);
   static TPM_RC ParseResponse_NV_WriteLock(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5974,6 +7715,11 @@ class TRUNKS_EXPORT Tpm {
       const std::string& auth_handle_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kNV_GlobalWriteLockCommandSize = 14;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_NV_GlobalWriteLock(
+      const TPMI_RH_PROVISION& auth_handle,
+      std::array<uint8_t, kNV_GlobalWriteLockCommandSize>* command);
   static TPM_RC ParseResponse_NV_GlobalWriteLock(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
@@ -5997,6 +7743,14 @@ class TRUNKS_EXPORT Tpm {
       const UINT16& offset,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kNV_ReadCommandSize = 22;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_NV_Read(
+      const TPMI_RH_NV_AUTH& auth_handle,
+      const TPMI_RH_NV_INDEX& nv_index,
+      const UINT16& size,
+      const UINT16& offset,
+      std::array<uint8_t, kNV_ReadCommandSize>* command);
   static TPM_RC ParseResponse_NV_Read(
       const std::string& response,
       TPM2B_MAX_NV_BUFFER* data,
@@ -6025,6 +7779,12 @@ class TRUNKS_EXPORT Tpm {
       const std::string& nv_index_name,
       std::string* serialized_command,
       AuthorizationDelegate* authorization_delegate);
+  static const size_t kNV_ReadLockCommandSize = 18;
+  // Writes the command without sessions and without allocating.
+  static void BuildCommand_NV_ReadLock(
+      const TPMI_RH_NV_AUTH& auth_handle,
+      const TPMI_RH_NV_INDEX& nv_index,
+      std::array<uint8_t, kNV_ReadLockCommandSize>* command);
   static TPM_RC ParseResponse_NV_ReadLock(
       const std::string& response,
       AuthorizationDelegate* authorization_delegate);
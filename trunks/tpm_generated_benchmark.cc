@@ -0,0 +1,3092 @@
+//
+// Copyright (C) 2015 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// THIS CODE IS GENERATED - DO NOT MODIFY!
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include <base/macros.h>
+#include <base/time/time.h>
+
+#include "trunks/tpm_generated.h"
+
+// Measures the time and allocations per call of the generated marshalling
+// code. Every command is serialized and a response to it is parsed with each
+// TPM2B argument filled to its capacity. Exits with an error if any call fails.
+
+namespace {
+
+// Counts allocations so each benchmark can report allocations per call.
+size_t g_allocation_count = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+  ++g_allocation_count;
+  void* result = malloc(size);
+  if (!result) {
+    abort();
+  }
+  return result;
+}
+
+void operator delete(void* pointer) noexcept {
+  free(pointer);
+}
+
+namespace trunks {
+namespace {
+
+const int kIterations = 1000;
+// The size of a SHA-256 object name.
+const size_t kHandleNameSize = 34;
+
+// Times kIterations runs of the body of a while (benchmark.Loop()) loop. One
+// untimed run comes first so buffers reused across runs are already allocated.
+class Benchmark {
+ public:
+  explicit Benchmark(const char* name) : name_(name) {}
+
+  bool Loop() {
+    if (iteration_ == 1) {
+      start_allocations_ = g_allocation_count;
+      start_ = base::TimeTicks::Now();
+    } else if (iteration_ > kIterations) {
+      elapsed_ = base::TimeTicks::Now() - start_;
+      allocations_ = g_allocation_count - start_allocations_;
+      return false;
+    }
+    ++iteration_;
+    return true;
+  }
+
+  // Prints the results. Returns false if the last run failed with |rc|.
+  bool Report(TPM_RC rc) {
+    if (rc != TPM_RC_SUCCESS) {
+      printf("%-48s FAILED: 0x%x\n", name_, rc);
+      return false;
+    }
+    printf("%-48s %10.1f ns/op %8.2f allocs/op\n", name_,
+           elapsed_.InMicrosecondsF() * 1000 / kIterations,
+           static_cast<double>(allocations_) / kIterations);
+    return true;
+  }
+
+ private:
+  const char* name_;
+  int iteration_ = 0;
+  size_t start_allocations_ = 0;
+  size_t allocations_ = 0;
+  base::TimeTicks start_;
+  base::TimeDelta elapsed_;
+
+  DISALLOW_COPY_AND_ASSIGN(Benchmark);
+};
+
+// Wraps serialized response |parameters| in a successful response header.
+std::string MakeResponse(const std::string& parameters) {
+  std::string response;
+  Serialize_TPM_ST(TPM_ST_NO_SESSIONS, &response);
+  Serialize_UINT32(10 + parameters.size(), &response);
+  Serialize_TPM_RC(TPM_RC_SUCCESS, &response);
+  return response + parameters;
+}
+
+bool Benchmark_Startup() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPM_SU startup_type = TPM_SU();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Startup");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Startup(startup_type, &serialized_command,
+                                       nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_Startup");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Startup(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Shutdown() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPM_SU shutdown_type = TPM_SU();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Shutdown");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Shutdown(shutdown_type, &serialized_command,
+                                        nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_Shutdown");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Shutdown(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_SelfTest() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_YES_NO full_test = TPMI_YES_NO();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_SelfTest");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_SelfTest(full_test, &serialized_command,
+                                        nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_SelfTest");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_SelfTest(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_IncrementalSelfTest() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPML_ALG to_test = TPML_ALG();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_IncrementalSelfTest");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_IncrementalSelfTest(to_test, &serialized_command,
+                                                   nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPML_ALG(TPML_ALG(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPML_ALG to_do_list;
+  Benchmark parse("ParseResponse_IncrementalSelfTest");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_IncrementalSelfTest(response, &to_do_list, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_GetTestResult() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_GetTestResult");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_GetTestResult(&serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_MAX_BUFFER(
+      Make_TPM2B_MAX_BUFFER(std::string(sizeof(TPM2B_MAX_BUFFER::buffer), 'a')),
+      &response_parameters);
+  Serialize_TPM_RC(TPM_RC(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_MAX_BUFFER out_data;
+  TPM_RC test_result;
+  Benchmark parse("ParseResponse_GetTestResult");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_GetTestResult(response, &out_data, &test_result,
+                                          nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_StartAuthSession() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT tpm_key = TPMI_DH_OBJECT();
+  std::string tpm_key_name(kHandleNameSize, 'n');
+  TPMI_DH_ENTITY bind = TPMI_DH_ENTITY();
+  std::string bind_name(kHandleNameSize, 'n');
+  TPM2B_NONCE nonce_caller = TPM2B_NONCE();
+  TPM2B_ENCRYPTED_SECRET encrypted_salt = Make_TPM2B_ENCRYPTED_SECRET(
+      std::string(sizeof(TPM2B_ENCRYPTED_SECRET::secret), 'a'));
+  TPM_SE session_type = TPM_SE();
+  TPMT_SYM_DEF symmetric = TPMT_SYM_DEF();
+  TPMI_ALG_HASH auth_hash = TPMI_ALG_HASH();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_StartAuthSession");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_StartAuthSession(tpm_key, tpm_key_name, bind,
+                                                bind_name, nonce_caller,
+                                                encrypted_salt, session_type,
+                                                symmetric, auth_hash,
+                                                &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPMI_SH_AUTH_SESSION(TPMI_SH_AUTH_SESSION(), &response_parameters);
+  Serialize_TPM2B_NONCE(TPM2B_NONCE(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPMI_SH_AUTH_SESSION session_handle;
+  TPM2B_NONCE nonce_tpm;
+  Benchmark parse("ParseResponse_StartAuthSession");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_StartAuthSession(response, &session_handle,
+                                             &nonce_tpm, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyRestart() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY session_handle = TPMI_SH_POLICY();
+  std::string session_handle_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyRestart");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyRestart(session_handle,
+                                             session_handle_name,
+                                             &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyRestart");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyRestart(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Create() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT parent_handle = TPMI_DH_OBJECT();
+  std::string parent_handle_name(kHandleNameSize, 'n');
+  TPM2B_SENSITIVE_CREATE in_sensitive = TPM2B_SENSITIVE_CREATE();
+  TPM2B_PUBLIC in_public = TPM2B_PUBLIC();
+  TPM2B_DATA outside_info =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  TPML_PCR_SELECTION creation_pcr = TPML_PCR_SELECTION();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Create");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Create(parent_handle, parent_handle_name,
+                                      in_sensitive, in_public, outside_info,
+                                      creation_pcr, &serialized_command,
+                                      nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_PRIVATE(
+      Make_TPM2B_PRIVATE(std::string(sizeof(TPM2B_PRIVATE::buffer), 'a')),
+      &response_parameters);
+  Serialize_TPM2B_PUBLIC(TPM2B_PUBLIC(), &response_parameters);
+  Serialize_TPM2B_CREATION_DATA(TPM2B_CREATION_DATA(), &response_parameters);
+  Serialize_TPM2B_DIGEST(
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a')),
+      &response_parameters);
+  Serialize_TPMT_TK_CREATION(TPMT_TK_CREATION(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_PRIVATE out_private;
+  TPM2B_PUBLIC out_public;
+  TPM2B_CREATION_DATA creation_data;
+  TPM2B_DIGEST creation_hash;
+  TPMT_TK_CREATION creation_ticket;
+  Benchmark parse("ParseResponse_Create");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Create(response, &out_private, &out_public,
+                                   &creation_data, &creation_hash,
+                                   &creation_ticket, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Load() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT parent_handle = TPMI_DH_OBJECT();
+  std::string parent_handle_name(kHandleNameSize, 'n');
+  TPM2B_PRIVATE in_private =
+      Make_TPM2B_PRIVATE(std::string(sizeof(TPM2B_PRIVATE::buffer), 'a'));
+  TPM2B_PUBLIC in_public = TPM2B_PUBLIC();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Load");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Load(parent_handle, parent_handle_name,
+                                    in_private, in_public, &serialized_command,
+                                    nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM_HANDLE(TPM_HANDLE(), &response_parameters);
+  Serialize_TPM2B_NAME(
+      Make_TPM2B_NAME(std::string(sizeof(TPM2B_NAME::name), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM_HANDLE object_handle;
+  TPM2B_NAME name;
+  Benchmark parse("ParseResponse_Load");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Load(response, &object_handle, &name, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_LoadExternal() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPM2B_SENSITIVE in_private = TPM2B_SENSITIVE();
+  TPM2B_PUBLIC in_public = TPM2B_PUBLIC();
+  TPMI_RH_HIERARCHY hierarchy = TPMI_RH_HIERARCHY();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_LoadExternal");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_LoadExternal(in_private, in_public, hierarchy,
+                                            &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM_HANDLE(TPM_HANDLE(), &response_parameters);
+  Serialize_TPM2B_NAME(
+      Make_TPM2B_NAME(std::string(sizeof(TPM2B_NAME::name), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM_HANDLE object_handle;
+  TPM2B_NAME name;
+  Benchmark parse("ParseResponse_LoadExternal");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_LoadExternal(response, &object_handle, &name,
+                                         nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ReadPublic() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT object_handle = TPMI_DH_OBJECT();
+  std::string object_handle_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ReadPublic");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ReadPublic(object_handle, object_handle_name,
+                                          &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_PUBLIC(TPM2B_PUBLIC(), &response_parameters);
+  Serialize_TPM2B_NAME(
+      Make_TPM2B_NAME(std::string(sizeof(TPM2B_NAME::name), 'a')),
+      &response_parameters);
+  Serialize_TPM2B_NAME(
+      Make_TPM2B_NAME(std::string(sizeof(TPM2B_NAME::name), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_PUBLIC out_public;
+  TPM2B_NAME name;
+  TPM2B_NAME qualified_name;
+  Benchmark parse("ParseResponse_ReadPublic");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ReadPublic(response, &out_public, &name,
+                                       &qualified_name, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ActivateCredential() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT activate_handle = TPMI_DH_OBJECT();
+  std::string activate_handle_name(kHandleNameSize, 'n');
+  TPMI_DH_OBJECT key_handle = TPMI_DH_OBJECT();
+  std::string key_handle_name(kHandleNameSize, 'n');
+  TPM2B_ID_OBJECT credential_blob = Make_TPM2B_ID_OBJECT(
+      std::string(sizeof(TPM2B_ID_OBJECT::credential), 'a'));
+  TPM2B_ENCRYPTED_SECRET secret = Make_TPM2B_ENCRYPTED_SECRET(
+      std::string(sizeof(TPM2B_ENCRYPTED_SECRET::secret), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ActivateCredential");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ActivateCredential(activate_handle,
+                                                  activate_handle_name,
+                                                  key_handle, key_handle_name,
+                                                  credential_blob, secret,
+                                                  &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_DIGEST(
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_DIGEST cert_info;
+  Benchmark parse("ParseResponse_ActivateCredential");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ActivateCredential(response, &cert_info, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_MakeCredential() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT handle = TPMI_DH_OBJECT();
+  std::string handle_name(kHandleNameSize, 'n');
+  TPM2B_DIGEST credential =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  TPM2B_NAME object_name =
+      Make_TPM2B_NAME(std::string(sizeof(TPM2B_NAME::name), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_MakeCredential");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_MakeCredential(handle, handle_name, credential,
+                                              object_name, &serialized_command,
+                                              nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_ID_OBJECT(
+      Make_TPM2B_ID_OBJECT(std::string(sizeof(TPM2B_ID_OBJECT::credential), 'a')),
+      &response_parameters);
+  Serialize_TPM2B_ENCRYPTED_SECRET(
+      Make_TPM2B_ENCRYPTED_SECRET(std::string(sizeof(TPM2B_ENCRYPTED_SECRET::secret), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_ID_OBJECT credential_blob;
+  TPM2B_ENCRYPTED_SECRET secret;
+  Benchmark parse("ParseResponse_MakeCredential");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_MakeCredential(response, &credential_blob, &secret,
+                                           nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Unseal() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT item_handle = TPMI_DH_OBJECT();
+  std::string item_handle_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Unseal");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Unseal(item_handle, item_handle_name,
+                                      &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_SENSITIVE_DATA(
+      Make_TPM2B_SENSITIVE_DATA(std::string(sizeof(TPM2B_SENSITIVE_DATA::buffer), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_SENSITIVE_DATA out_data;
+  Benchmark parse("ParseResponse_Unseal");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Unseal(response, &out_data, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ObjectChangeAuth() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT object_handle = TPMI_DH_OBJECT();
+  std::string object_handle_name(kHandleNameSize, 'n');
+  TPMI_DH_OBJECT parent_handle = TPMI_DH_OBJECT();
+  std::string parent_handle_name(kHandleNameSize, 'n');
+  TPM2B_AUTH new_auth = TPM2B_AUTH();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ObjectChangeAuth");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ObjectChangeAuth(object_handle,
+                                                object_handle_name,
+                                                parent_handle,
+                                                parent_handle_name, new_auth,
+                                                &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_PRIVATE(
+      Make_TPM2B_PRIVATE(std::string(sizeof(TPM2B_PRIVATE::buffer), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_PRIVATE out_private;
+  Benchmark parse("ParseResponse_ObjectChangeAuth");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ObjectChangeAuth(response, &out_private, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Duplicate() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT object_handle = TPMI_DH_OBJECT();
+  std::string object_handle_name(kHandleNameSize, 'n');
+  TPMI_DH_OBJECT new_parent_handle = TPMI_DH_OBJECT();
+  std::string new_parent_handle_name(kHandleNameSize, 'n');
+  TPM2B_DATA encryption_key_in =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  TPMT_SYM_DEF_OBJECT symmetric_alg = TPMT_SYM_DEF_OBJECT();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Duplicate");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Duplicate(object_handle, object_handle_name,
+                                         new_parent_handle,
+                                         new_parent_handle_name,
+                                         encryption_key_in, symmetric_alg,
+                                         &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_DATA(
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a')),
+      &response_parameters);
+  Serialize_TPM2B_PRIVATE(
+      Make_TPM2B_PRIVATE(std::string(sizeof(TPM2B_PRIVATE::buffer), 'a')),
+      &response_parameters);
+  Serialize_TPM2B_ENCRYPTED_SECRET(
+      Make_TPM2B_ENCRYPTED_SECRET(std::string(sizeof(TPM2B_ENCRYPTED_SECRET::secret), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_DATA encryption_key_out;
+  TPM2B_PRIVATE duplicate;
+  TPM2B_ENCRYPTED_SECRET out_sym_seed;
+  Benchmark parse("ParseResponse_Duplicate");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Duplicate(response, &encryption_key_out, &duplicate,
+                                      &out_sym_seed, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Rewrap() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT old_parent = TPMI_DH_OBJECT();
+  std::string old_parent_name(kHandleNameSize, 'n');
+  TPMI_DH_OBJECT new_parent = TPMI_DH_OBJECT();
+  std::string new_parent_name(kHandleNameSize, 'n');
+  TPM2B_PRIVATE in_duplicate =
+      Make_TPM2B_PRIVATE(std::string(sizeof(TPM2B_PRIVATE::buffer), 'a'));
+  TPM2B_NAME name = Make_TPM2B_NAME(std::string(sizeof(TPM2B_NAME::name), 'a'));
+  TPM2B_ENCRYPTED_SECRET in_sym_seed = Make_TPM2B_ENCRYPTED_SECRET(
+      std::string(sizeof(TPM2B_ENCRYPTED_SECRET::secret), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Rewrap");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Rewrap(old_parent, old_parent_name, new_parent,
+                                      new_parent_name, in_duplicate, name,
+                                      in_sym_seed, &serialized_command,
+                                      nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_PRIVATE(
+      Make_TPM2B_PRIVATE(std::string(sizeof(TPM2B_PRIVATE::buffer), 'a')),
+      &response_parameters);
+  Serialize_TPM2B_ENCRYPTED_SECRET(
+      Make_TPM2B_ENCRYPTED_SECRET(std::string(sizeof(TPM2B_ENCRYPTED_SECRET::secret), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_PRIVATE out_duplicate;
+  TPM2B_ENCRYPTED_SECRET out_sym_seed;
+  Benchmark parse("ParseResponse_Rewrap");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Rewrap(response, &out_duplicate, &out_sym_seed,
+                                   nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Import() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT parent_handle = TPMI_DH_OBJECT();
+  std::string parent_handle_name(kHandleNameSize, 'n');
+  TPM2B_DATA encryption_key =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  TPM2B_PUBLIC object_public = TPM2B_PUBLIC();
+  TPM2B_PRIVATE duplicate =
+      Make_TPM2B_PRIVATE(std::string(sizeof(TPM2B_PRIVATE::buffer), 'a'));
+  TPM2B_ENCRYPTED_SECRET in_sym_seed = Make_TPM2B_ENCRYPTED_SECRET(
+      std::string(sizeof(TPM2B_ENCRYPTED_SECRET::secret), 'a'));
+  TPMT_SYM_DEF_OBJECT symmetric_alg = TPMT_SYM_DEF_OBJECT();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Import");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Import(parent_handle, parent_handle_name,
+                                      encryption_key, object_public, duplicate,
+                                      in_sym_seed, symmetric_alg,
+                                      &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_PRIVATE(
+      Make_TPM2B_PRIVATE(std::string(sizeof(TPM2B_PRIVATE::buffer), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_PRIVATE out_private;
+  Benchmark parse("ParseResponse_Import");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Import(response, &out_private, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_RSA_Encrypt() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT key_handle = TPMI_DH_OBJECT();
+  std::string key_handle_name(kHandleNameSize, 'n');
+  TPM2B_PUBLIC_KEY_RSA message = Make_TPM2B_PUBLIC_KEY_RSA(
+      std::string(sizeof(TPM2B_PUBLIC_KEY_RSA::buffer), 'a'));
+  TPMT_RSA_DECRYPT in_scheme = TPMT_RSA_DECRYPT();
+  TPM2B_DATA label =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_RSA_Encrypt");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_RSA_Encrypt(key_handle, key_handle_name, message,
+                                           in_scheme, label,
+                                           &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_PUBLIC_KEY_RSA(
+      Make_TPM2B_PUBLIC_KEY_RSA(std::string(sizeof(TPM2B_PUBLIC_KEY_RSA::buffer), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_PUBLIC_KEY_RSA out_data;
+  Benchmark parse("ParseResponse_RSA_Encrypt");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_RSA_Encrypt(response, &out_data, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_RSA_Decrypt() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT key_handle = TPMI_DH_OBJECT();
+  std::string key_handle_name(kHandleNameSize, 'n');
+  TPM2B_PUBLIC_KEY_RSA cipher_text = Make_TPM2B_PUBLIC_KEY_RSA(
+      std::string(sizeof(TPM2B_PUBLIC_KEY_RSA::buffer), 'a'));
+  TPMT_RSA_DECRYPT in_scheme = TPMT_RSA_DECRYPT();
+  TPM2B_DATA label =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_RSA_Decrypt");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_RSA_Decrypt(key_handle, key_handle_name,
+                                           cipher_text, in_scheme, label,
+                                           &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_PUBLIC_KEY_RSA(
+      Make_TPM2B_PUBLIC_KEY_RSA(std::string(sizeof(TPM2B_PUBLIC_KEY_RSA::buffer), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_PUBLIC_KEY_RSA message;
+  Benchmark parse("ParseResponse_RSA_Decrypt");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_RSA_Decrypt(response, &message, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ECDH_KeyGen() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT key_handle = TPMI_DH_OBJECT();
+  std::string key_handle_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ECDH_KeyGen");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ECDH_KeyGen(key_handle, key_handle_name,
+                                           &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_ECC_POINT(TPM2B_ECC_POINT(), &response_parameters);
+  Serialize_TPM2B_ECC_POINT(TPM2B_ECC_POINT(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_ECC_POINT z_point;
+  TPM2B_ECC_POINT pub_point;
+  Benchmark parse("ParseResponse_ECDH_KeyGen");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ECDH_KeyGen(response, &z_point, &pub_point,
+                                        nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ECDH_ZGen() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT key_handle = TPMI_DH_OBJECT();
+  std::string key_handle_name(kHandleNameSize, 'n');
+  TPM2B_ECC_POINT in_point = TPM2B_ECC_POINT();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ECDH_ZGen");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ECDH_ZGen(key_handle, key_handle_name, in_point,
+                                         &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_ECC_POINT(TPM2B_ECC_POINT(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_ECC_POINT out_point;
+  Benchmark parse("ParseResponse_ECDH_ZGen");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ECDH_ZGen(response, &out_point, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ECC_Parameters() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_ECC_CURVE curve_id = TPMI_ECC_CURVE();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ECC_Parameters");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ECC_Parameters(curve_id, &serialized_command,
+                                              nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPMS_ALGORITHM_DETAIL_ECC(TPMS_ALGORITHM_DETAIL_ECC(),
+                                      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPMS_ALGORITHM_DETAIL_ECC parameters;
+  Benchmark parse("ParseResponse_ECC_Parameters");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ECC_Parameters(response, &parameters, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ZGen_2Phase() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT key_a = TPMI_DH_OBJECT();
+  std::string key_a_name(kHandleNameSize, 'n');
+  TPM2B_ECC_POINT in_qs_b = TPM2B_ECC_POINT();
+  TPM2B_ECC_POINT in_qe_b = TPM2B_ECC_POINT();
+  TPMI_ECC_KEY_EXCHANGE in_scheme = TPMI_ECC_KEY_EXCHANGE();
+  UINT16 counter = UINT16();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ZGen_2Phase");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ZGen_2Phase(key_a, key_a_name, in_qs_b, in_qe_b,
+                                           in_scheme, counter,
+                                           &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_ECC_POINT(TPM2B_ECC_POINT(), &response_parameters);
+  Serialize_TPM2B_ECC_POINT(TPM2B_ECC_POINT(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_ECC_POINT out_z1;
+  TPM2B_ECC_POINT out_z2;
+  Benchmark parse("ParseResponse_ZGen_2Phase");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ZGen_2Phase(response, &out_z1, &out_z2, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_EncryptDecrypt() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT key_handle = TPMI_DH_OBJECT();
+  std::string key_handle_name(kHandleNameSize, 'n');
+  TPMI_YES_NO decrypt = TPMI_YES_NO();
+  TPMI_ALG_SYM_MODE mode = TPMI_ALG_SYM_MODE();
+  TPM2B_IV iv_in = Make_TPM2B_IV(std::string(sizeof(TPM2B_IV::buffer), 'a'));
+  TPM2B_MAX_BUFFER in_data =
+      Make_TPM2B_MAX_BUFFER(std::string(sizeof(TPM2B_MAX_BUFFER::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_EncryptDecrypt");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_EncryptDecrypt(key_handle, key_handle_name,
+                                              decrypt, mode, iv_in, in_data,
+                                              &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_MAX_BUFFER(
+      Make_TPM2B_MAX_BUFFER(std::string(sizeof(TPM2B_MAX_BUFFER::buffer), 'a')),
+      &response_parameters);
+  Serialize_TPM2B_IV(Make_TPM2B_IV(std::string(sizeof(TPM2B_IV::buffer), 'a')),
+                     &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_MAX_BUFFER out_data;
+  TPM2B_IV iv_out;
+  Benchmark parse("ParseResponse_EncryptDecrypt");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_EncryptDecrypt(response, &out_data, &iv_out,
+                                           nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Hash() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPM2B_MAX_BUFFER data =
+      Make_TPM2B_MAX_BUFFER(std::string(sizeof(TPM2B_MAX_BUFFER::buffer), 'a'));
+  TPMI_ALG_HASH hash_alg = TPMI_ALG_HASH();
+  TPMI_RH_HIERARCHY hierarchy = TPMI_RH_HIERARCHY();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Hash");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Hash(data, hash_alg, hierarchy,
+                                    &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_DIGEST(
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a')),
+      &response_parameters);
+  Serialize_TPMT_TK_HASHCHECK(TPMT_TK_HASHCHECK(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_DIGEST out_hash;
+  TPMT_TK_HASHCHECK validation;
+  Benchmark parse("ParseResponse_Hash");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Hash(response, &out_hash, &validation, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_HMAC() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT handle = TPMI_DH_OBJECT();
+  std::string handle_name(kHandleNameSize, 'n');
+  TPM2B_MAX_BUFFER buffer =
+      Make_TPM2B_MAX_BUFFER(std::string(sizeof(TPM2B_MAX_BUFFER::buffer), 'a'));
+  TPMI_ALG_HASH hash_alg = TPMI_ALG_HASH();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_HMAC");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_HMAC(handle, handle_name, buffer, hash_alg,
+                                    &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_DIGEST(
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_DIGEST out_hmac;
+  Benchmark parse("ParseResponse_HMAC");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_HMAC(response, &out_hmac, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_GetRandom() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  UINT16 bytes_requested = UINT16();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_GetRandom");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_GetRandom(bytes_requested, &serialized_command,
+                                         nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_DIGEST(
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_DIGEST random_bytes;
+  Benchmark parse("ParseResponse_GetRandom");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_GetRandom(response, &random_bytes, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_StirRandom() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPM2B_SENSITIVE_DATA in_data = Make_TPM2B_SENSITIVE_DATA(
+      std::string(sizeof(TPM2B_SENSITIVE_DATA::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_StirRandom");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_StirRandom(in_data, &serialized_command,
+                                          nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_StirRandom");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_StirRandom(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_HMAC_Start() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT handle = TPMI_DH_OBJECT();
+  std::string handle_name(kHandleNameSize, 'n');
+  TPM2B_AUTH auth = TPM2B_AUTH();
+  TPMI_ALG_HASH hash_alg = TPMI_ALG_HASH();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_HMAC_Start");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_HMAC_Start(handle, handle_name, auth, hash_alg,
+                                          &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPMI_DH_OBJECT(TPMI_DH_OBJECT(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPMI_DH_OBJECT sequence_handle;
+  Benchmark parse("ParseResponse_HMAC_Start");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_HMAC_Start(response, &sequence_handle, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_HashSequenceStart() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPM2B_AUTH auth = TPM2B_AUTH();
+  TPMI_ALG_HASH hash_alg = TPMI_ALG_HASH();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_HashSequenceStart");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_HashSequenceStart(auth, hash_alg,
+                                                 &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPMI_DH_OBJECT(TPMI_DH_OBJECT(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPMI_DH_OBJECT sequence_handle;
+  Benchmark parse("ParseResponse_HashSequenceStart");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_HashSequenceStart(response, &sequence_handle,
+                                              nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_SequenceUpdate() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT sequence_handle = TPMI_DH_OBJECT();
+  std::string sequence_handle_name(kHandleNameSize, 'n');
+  TPM2B_MAX_BUFFER buffer =
+      Make_TPM2B_MAX_BUFFER(std::string(sizeof(TPM2B_MAX_BUFFER::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_SequenceUpdate");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_SequenceUpdate(sequence_handle,
+                                              sequence_handle_name, buffer,
+                                              &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_SequenceUpdate");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_SequenceUpdate(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_SequenceComplete() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT sequence_handle = TPMI_DH_OBJECT();
+  std::string sequence_handle_name(kHandleNameSize, 'n');
+  TPM2B_MAX_BUFFER buffer =
+      Make_TPM2B_MAX_BUFFER(std::string(sizeof(TPM2B_MAX_BUFFER::buffer), 'a'));
+  TPMI_RH_HIERARCHY hierarchy = TPMI_RH_HIERARCHY();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_SequenceComplete");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_SequenceComplete(sequence_handle,
+                                                sequence_handle_name, buffer,
+                                                hierarchy, &serialized_command,
+                                                nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_DIGEST(
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a')),
+      &response_parameters);
+  Serialize_TPMT_TK_HASHCHECK(TPMT_TK_HASHCHECK(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_DIGEST result;
+  TPMT_TK_HASHCHECK validation;
+  Benchmark parse("ParseResponse_SequenceComplete");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_SequenceComplete(response, &result, &validation,
+                                             nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_EventSequenceComplete() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_PCR pcr_handle = TPMI_DH_PCR();
+  std::string pcr_handle_name(kHandleNameSize, 'n');
+  TPMI_DH_OBJECT sequence_handle = TPMI_DH_OBJECT();
+  std::string sequence_handle_name(kHandleNameSize, 'n');
+  TPM2B_MAX_BUFFER buffer =
+      Make_TPM2B_MAX_BUFFER(std::string(sizeof(TPM2B_MAX_BUFFER::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_EventSequenceComplete");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_EventSequenceComplete(pcr_handle,
+                                                     pcr_handle_name,
+                                                     sequence_handle,
+                                                     sequence_handle_name,
+                                                     buffer,
+                                                     &serialized_command,
+                                                     nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPML_DIGEST_VALUES(TPML_DIGEST_VALUES(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPML_DIGEST_VALUES results;
+  Benchmark parse("ParseResponse_EventSequenceComplete");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_EventSequenceComplete(response, &results, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Certify() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT object_handle = TPMI_DH_OBJECT();
+  std::string object_handle_name(kHandleNameSize, 'n');
+  TPMI_DH_OBJECT sign_handle = TPMI_DH_OBJECT();
+  std::string sign_handle_name(kHandleNameSize, 'n');
+  TPM2B_DATA qualifying_data =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  TPMT_SIG_SCHEME in_scheme = TPMT_SIG_SCHEME();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Certify");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Certify(object_handle, object_handle_name,
+                                       sign_handle, sign_handle_name,
+                                       qualifying_data, in_scheme,
+                                       &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_ATTEST(
+      Make_TPM2B_ATTEST(std::string(sizeof(TPM2B_ATTEST::attestation_data), 'a')),
+      &response_parameters);
+  Serialize_TPMT_SIGNATURE(TPMT_SIGNATURE(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_ATTEST certify_info;
+  TPMT_SIGNATURE signature;
+  Benchmark parse("ParseResponse_Certify");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Certify(response, &certify_info, &signature,
+                                    nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_CertifyCreation() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT sign_handle = TPMI_DH_OBJECT();
+  std::string sign_handle_name(kHandleNameSize, 'n');
+  TPMI_DH_OBJECT object_handle = TPMI_DH_OBJECT();
+  std::string object_handle_name(kHandleNameSize, 'n');
+  TPM2B_DATA qualifying_data =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  TPM2B_DIGEST creation_hash =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  TPMT_SIG_SCHEME in_scheme = TPMT_SIG_SCHEME();
+  TPMT_TK_CREATION creation_ticket = TPMT_TK_CREATION();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_CertifyCreation");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_CertifyCreation(sign_handle, sign_handle_name,
+                                               object_handle,
+                                               object_handle_name,
+                                               qualifying_data, creation_hash,
+                                               in_scheme, creation_ticket,
+                                               &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_ATTEST(
+      Make_TPM2B_ATTEST(std::string(sizeof(TPM2B_ATTEST::attestation_data), 'a')),
+      &response_parameters);
+  Serialize_TPMT_SIGNATURE(TPMT_SIGNATURE(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_ATTEST certify_info;
+  TPMT_SIGNATURE signature;
+  Benchmark parse("ParseResponse_CertifyCreation");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_CertifyCreation(response, &certify_info, &signature,
+                                            nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Quote() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT sign_handle = TPMI_DH_OBJECT();
+  std::string sign_handle_name(kHandleNameSize, 'n');
+  TPM2B_DATA qualifying_data =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  TPMT_SIG_SCHEME in_scheme = TPMT_SIG_SCHEME();
+  TPML_PCR_SELECTION pcrselect = TPML_PCR_SELECTION();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Quote");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Quote(sign_handle, sign_handle_name,
+                                     qualifying_data, in_scheme, pcrselect,
+                                     &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_ATTEST(
+      Make_TPM2B_ATTEST(std::string(sizeof(TPM2B_ATTEST::attestation_data), 'a')),
+      &response_parameters);
+  Serialize_TPMT_SIGNATURE(TPMT_SIGNATURE(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_ATTEST quoted;
+  TPMT_SIGNATURE signature;
+  Benchmark parse("ParseResponse_Quote");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Quote(response, &quoted, &signature, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_GetSessionAuditDigest() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_ENDORSEMENT privacy_admin_handle = TPMI_RH_ENDORSEMENT();
+  std::string privacy_admin_handle_name(kHandleNameSize, 'n');
+  TPMI_DH_OBJECT sign_handle = TPMI_DH_OBJECT();
+  std::string sign_handle_name(kHandleNameSize, 'n');
+  TPMI_SH_HMAC session_handle = TPMI_SH_HMAC();
+  std::string session_handle_name(kHandleNameSize, 'n');
+  TPM2B_DATA qualifying_data =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  TPMT_SIG_SCHEME in_scheme = TPMT_SIG_SCHEME();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_GetSessionAuditDigest");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_GetSessionAuditDigest(privacy_admin_handle,
+                                                     privacy_admin_handle_name,
+                                                     sign_handle,
+                                                     sign_handle_name,
+                                                     session_handle,
+                                                     session_handle_name,
+                                                     qualifying_data, in_scheme,
+                                                     &serialized_command,
+                                                     nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_ATTEST(
+      Make_TPM2B_ATTEST(std::string(sizeof(TPM2B_ATTEST::attestation_data), 'a')),
+      &response_parameters);
+  Serialize_TPMT_SIGNATURE(TPMT_SIGNATURE(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_ATTEST audit_info;
+  TPMT_SIGNATURE signature;
+  Benchmark parse("ParseResponse_GetSessionAuditDigest");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_GetSessionAuditDigest(response, &audit_info,
+                                                  &signature, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_GetCommandAuditDigest() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_ENDORSEMENT privacy_handle = TPMI_RH_ENDORSEMENT();
+  std::string privacy_handle_name(kHandleNameSize, 'n');
+  TPMI_DH_OBJECT sign_handle = TPMI_DH_OBJECT();
+  std::string sign_handle_name(kHandleNameSize, 'n');
+  TPM2B_DATA qualifying_data =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  TPMT_SIG_SCHEME in_scheme = TPMT_SIG_SCHEME();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_GetCommandAuditDigest");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_GetCommandAuditDigest(privacy_handle,
+                                                     privacy_handle_name,
+                                                     sign_handle,
+                                                     sign_handle_name,
+                                                     qualifying_data, in_scheme,
+                                                     &serialized_command,
+                                                     nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_ATTEST(
+      Make_TPM2B_ATTEST(std::string(sizeof(TPM2B_ATTEST::attestation_data), 'a')),
+      &response_parameters);
+  Serialize_TPMT_SIGNATURE(TPMT_SIGNATURE(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_ATTEST audit_info;
+  TPMT_SIGNATURE signature;
+  Benchmark parse("ParseResponse_GetCommandAuditDigest");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_GetCommandAuditDigest(response, &audit_info,
+                                                  &signature, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_GetTime() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_ENDORSEMENT privacy_admin_handle = TPMI_RH_ENDORSEMENT();
+  std::string privacy_admin_handle_name(kHandleNameSize, 'n');
+  TPMI_DH_OBJECT sign_handle = TPMI_DH_OBJECT();
+  std::string sign_handle_name(kHandleNameSize, 'n');
+  TPM2B_DATA qualifying_data =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  TPMT_SIG_SCHEME in_scheme = TPMT_SIG_SCHEME();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_GetTime");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_GetTime(privacy_admin_handle,
+                                       privacy_admin_handle_name, sign_handle,
+                                       sign_handle_name, qualifying_data,
+                                       in_scheme, &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_ATTEST(
+      Make_TPM2B_ATTEST(std::string(sizeof(TPM2B_ATTEST::attestation_data), 'a')),
+      &response_parameters);
+  Serialize_TPMT_SIGNATURE(TPMT_SIGNATURE(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_ATTEST time_info;
+  TPMT_SIGNATURE signature;
+  Benchmark parse("ParseResponse_GetTime");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_GetTime(response, &time_info, &signature, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Commit() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT sign_handle = TPMI_DH_OBJECT();
+  std::string sign_handle_name(kHandleNameSize, 'n');
+  UINT32 param_size = UINT32();
+  TPM2B_ECC_POINT p1 = TPM2B_ECC_POINT();
+  TPM2B_SENSITIVE_DATA s2 = Make_TPM2B_SENSITIVE_DATA(
+      std::string(sizeof(TPM2B_SENSITIVE_DATA::buffer), 'a'));
+  TPM2B_ECC_PARAMETER y2 = Make_TPM2B_ECC_PARAMETER(
+      std::string(sizeof(TPM2B_ECC_PARAMETER::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Commit");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Commit(sign_handle, sign_handle_name, param_size,
+                                      p1, s2, y2, &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_UINT32(UINT32(), &response_parameters);
+  Serialize_TPM2B_ECC_POINT(TPM2B_ECC_POINT(), &response_parameters);
+  Serialize_TPM2B_ECC_POINT(TPM2B_ECC_POINT(), &response_parameters);
+  Serialize_TPM2B_ECC_POINT(TPM2B_ECC_POINT(), &response_parameters);
+  Serialize_UINT16(UINT16(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  UINT32 param_size_out;
+  TPM2B_ECC_POINT k;
+  TPM2B_ECC_POINT l;
+  TPM2B_ECC_POINT e;
+  UINT16 counter;
+  Benchmark parse("ParseResponse_Commit");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Commit(response, &param_size_out, &k, &l, &e,
+                                   &counter, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_EC_Ephemeral() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  UINT32 param_size = UINT32();
+  TPMI_ECC_CURVE curve_id = TPMI_ECC_CURVE();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_EC_Ephemeral");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_EC_Ephemeral(param_size, curve_id,
+                                            &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_UINT32(UINT32(), &response_parameters);
+  Serialize_TPM2B_ECC_POINT(TPM2B_ECC_POINT(), &response_parameters);
+  Serialize_UINT16(UINT16(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  UINT32 param_size_out;
+  TPM2B_ECC_POINT q;
+  UINT16 counter;
+  Benchmark parse("ParseResponse_EC_Ephemeral");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_EC_Ephemeral(response, &param_size_out, &q,
+                                         &counter, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_VerifySignature() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT key_handle = TPMI_DH_OBJECT();
+  std::string key_handle_name(kHandleNameSize, 'n');
+  TPM2B_DIGEST digest =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  TPMT_SIGNATURE signature = TPMT_SIGNATURE();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_VerifySignature");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_VerifySignature(key_handle, key_handle_name,
+                                               digest, signature,
+                                               &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPMT_TK_VERIFIED(TPMT_TK_VERIFIED(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPMT_TK_VERIFIED validation;
+  Benchmark parse("ParseResponse_VerifySignature");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_VerifySignature(response, &validation, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Sign() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT key_handle = TPMI_DH_OBJECT();
+  std::string key_handle_name(kHandleNameSize, 'n');
+  TPM2B_DIGEST digest =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  TPMT_SIG_SCHEME in_scheme = TPMT_SIG_SCHEME();
+  TPMT_TK_HASHCHECK validation = TPMT_TK_HASHCHECK();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Sign");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Sign(key_handle, key_handle_name, digest,
+                                    in_scheme, validation, &serialized_command,
+                                    nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPMT_SIGNATURE(TPMT_SIGNATURE(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPMT_SIGNATURE signature;
+  Benchmark parse("ParseResponse_Sign");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Sign(response, &signature, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_SetCommandCodeAuditStatus() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PROVISION auth = TPMI_RH_PROVISION();
+  std::string auth_name(kHandleNameSize, 'n');
+  TPMI_ALG_HASH audit_alg = TPMI_ALG_HASH();
+  TPML_CC set_list = TPML_CC();
+  TPML_CC clear_list = TPML_CC();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_SetCommandCodeAuditStatus");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_SetCommandCodeAuditStatus(auth, auth_name,
+                                                         audit_alg, set_list,
+                                                         clear_list,
+                                                         &serialized_command,
+                                                         nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_SetCommandCodeAuditStatus");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_SetCommandCodeAuditStatus(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PCR_Extend() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_PCR pcr_handle = TPMI_DH_PCR();
+  std::string pcr_handle_name(kHandleNameSize, 'n');
+  TPML_DIGEST_VALUES digests = TPML_DIGEST_VALUES();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PCR_Extend");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PCR_Extend(pcr_handle, pcr_handle_name, digests,
+                                          &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PCR_Extend");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PCR_Extend(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PCR_Event() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_PCR pcr_handle = TPMI_DH_PCR();
+  std::string pcr_handle_name(kHandleNameSize, 'n');
+  TPM2B_EVENT event_data =
+      Make_TPM2B_EVENT(std::string(sizeof(TPM2B_EVENT::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PCR_Event");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PCR_Event(pcr_handle, pcr_handle_name,
+                                         event_data, &serialized_command,
+                                         nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPML_DIGEST_VALUES(TPML_DIGEST_VALUES(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPML_DIGEST_VALUES digests;
+  Benchmark parse("ParseResponse_PCR_Event");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PCR_Event(response, &digests, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PCR_Read() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPML_PCR_SELECTION pcr_selection_in = TPML_PCR_SELECTION();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PCR_Read");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PCR_Read(pcr_selection_in, &serialized_command,
+                                        nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_UINT32(UINT32(), &response_parameters);
+  Serialize_TPML_PCR_SELECTION(TPML_PCR_SELECTION(), &response_parameters);
+  Serialize_TPML_DIGEST(TPML_DIGEST(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  UINT32 pcr_update_counter;
+  TPML_PCR_SELECTION pcr_selection_out;
+  TPML_DIGEST pcr_values;
+  Benchmark parse("ParseResponse_PCR_Read");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PCR_Read(response, &pcr_update_counter,
+                                     &pcr_selection_out, &pcr_values, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PCR_Allocate() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PLATFORM auth_handle = TPMI_RH_PLATFORM();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPML_PCR_SELECTION pcr_allocation = TPML_PCR_SELECTION();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PCR_Allocate");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PCR_Allocate(auth_handle, auth_handle_name,
+                                            pcr_allocation, &serialized_command,
+                                            nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPMI_YES_NO(TPMI_YES_NO(), &response_parameters);
+  Serialize_UINT32(UINT32(), &response_parameters);
+  Serialize_UINT32(UINT32(), &response_parameters);
+  Serialize_UINT32(UINT32(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPMI_YES_NO allocation_success;
+  UINT32 max_pcr;
+  UINT32 size_needed;
+  UINT32 size_available;
+  Benchmark parse("ParseResponse_PCR_Allocate");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PCR_Allocate(response, &allocation_success,
+                                         &max_pcr, &size_needed,
+                                         &size_available, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PCR_SetAuthPolicy() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PLATFORM auth_handle = TPMI_RH_PLATFORM();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_DH_PCR pcr_num = TPMI_DH_PCR();
+  std::string pcr_num_name(kHandleNameSize, 'n');
+  TPM2B_DIGEST auth_policy =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  TPMI_ALG_HASH policy_digest = TPMI_ALG_HASH();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PCR_SetAuthPolicy");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PCR_SetAuthPolicy(auth_handle, auth_handle_name,
+                                                 pcr_num, pcr_num_name,
+                                                 auth_policy, policy_digest,
+                                                 &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PCR_SetAuthPolicy");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PCR_SetAuthPolicy(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PCR_SetAuthValue() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_PCR pcr_handle = TPMI_DH_PCR();
+  std::string pcr_handle_name(kHandleNameSize, 'n');
+  TPM2B_DIGEST auth =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PCR_SetAuthValue");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PCR_SetAuthValue(pcr_handle, pcr_handle_name,
+                                                auth, &serialized_command,
+                                                nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PCR_SetAuthValue");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PCR_SetAuthValue(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PCR_Reset() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_PCR pcr_handle = TPMI_DH_PCR();
+  std::string pcr_handle_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PCR_Reset");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PCR_Reset(pcr_handle, pcr_handle_name,
+                                         &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PCR_Reset");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PCR_Reset(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicySigned() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT auth_object = TPMI_DH_OBJECT();
+  std::string auth_object_name(kHandleNameSize, 'n');
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPM2B_NONCE nonce_tpm = TPM2B_NONCE();
+  TPM2B_DIGEST cp_hash_a =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  TPM2B_NONCE policy_ref = TPM2B_NONCE();
+  INT32 expiration = INT32();
+  TPMT_SIGNATURE auth = TPMT_SIGNATURE();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicySigned");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicySigned(auth_object, auth_object_name,
+                                            policy_session, policy_session_name,
+                                            nonce_tpm, cp_hash_a, policy_ref,
+                                            expiration, auth,
+                                            &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_TIMEOUT(
+      Make_TPM2B_TIMEOUT(std::string(sizeof(TPM2B_TIMEOUT::buffer), 'a')),
+      &response_parameters);
+  Serialize_TPMT_TK_AUTH(TPMT_TK_AUTH(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_TIMEOUT timeout;
+  TPMT_TK_AUTH policy_ticket;
+  Benchmark parse("ParseResponse_PolicySigned");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicySigned(response, &timeout, &policy_ticket,
+                                         nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicySecret() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_ENTITY auth_handle = TPMI_DH_ENTITY();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPM2B_NONCE nonce_tpm = TPM2B_NONCE();
+  TPM2B_DIGEST cp_hash_a =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  TPM2B_NONCE policy_ref = TPM2B_NONCE();
+  INT32 expiration = INT32();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicySecret");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicySecret(auth_handle, auth_handle_name,
+                                            policy_session, policy_session_name,
+                                            nonce_tpm, cp_hash_a, policy_ref,
+                                            expiration, &serialized_command,
+                                            nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_TIMEOUT(
+      Make_TPM2B_TIMEOUT(std::string(sizeof(TPM2B_TIMEOUT::buffer), 'a')),
+      &response_parameters);
+  Serialize_TPMT_TK_AUTH(TPMT_TK_AUTH(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_TIMEOUT timeout;
+  TPMT_TK_AUTH policy_ticket;
+  Benchmark parse("ParseResponse_PolicySecret");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicySecret(response, &timeout, &policy_ticket,
+                                         nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyTicket() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPM2B_TIMEOUT timeout =
+      Make_TPM2B_TIMEOUT(std::string(sizeof(TPM2B_TIMEOUT::buffer), 'a'));
+  TPM2B_DIGEST cp_hash_a =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  TPM2B_NONCE policy_ref = TPM2B_NONCE();
+  TPM2B_NAME auth_name =
+      Make_TPM2B_NAME(std::string(sizeof(TPM2B_NAME::name), 'a'));
+  TPMT_TK_AUTH ticket = TPMT_TK_AUTH();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyTicket");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyTicket(policy_session, policy_session_name,
+                                            timeout, cp_hash_a, policy_ref,
+                                            auth_name, ticket,
+                                            &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyTicket");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyTicket(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyOR() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPML_DIGEST p_hash_list = TPML_DIGEST();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyOR");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyOR(policy_session, policy_session_name,
+                                        p_hash_list, &serialized_command,
+                                        nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyOR");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyOR(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyPCR() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPM2B_DIGEST pcr_digest =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  TPML_PCR_SELECTION pcrs = TPML_PCR_SELECTION();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyPCR");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyPCR(policy_session, policy_session_name,
+                                         pcr_digest, pcrs, &serialized_command,
+                                         nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyPCR");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyPCR(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyLocality() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPMA_LOCALITY locality = TPMA_LOCALITY();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyLocality");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyLocality(policy_session,
+                                              policy_session_name, locality,
+                                              &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyLocality");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyLocality(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyNV() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_NV_AUTH auth_handle = TPMI_RH_NV_AUTH();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPM2B_OPERAND operand_b = TPM2B_OPERAND();
+  UINT16 offset = UINT16();
+  TPM_EO operation = TPM_EO();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyNV");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyNV(auth_handle, auth_handle_name, nv_index,
+                                        nv_index_name, policy_session,
+                                        policy_session_name, operand_b, offset,
+                                        operation, &serialized_command,
+                                        nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyNV");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyNV(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyCounterTimer() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPM2B_OPERAND operand_b = TPM2B_OPERAND();
+  UINT16 offset = UINT16();
+  TPM_EO operation = TPM_EO();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyCounterTimer");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyCounterTimer(policy_session,
+                                                  policy_session_name,
+                                                  operand_b, offset, operation,
+                                                  &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyCounterTimer");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyCounterTimer(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyCommandCode() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPM_CC code = TPM_CC();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyCommandCode");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyCommandCode(policy_session,
+                                                 policy_session_name, code,
+                                                 &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyCommandCode");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyCommandCode(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyPhysicalPresence() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyPhysicalPresence");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyPhysicalPresence(policy_session,
+                                                      policy_session_name,
+                                                      &serialized_command,
+                                                      nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyPhysicalPresence");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyPhysicalPresence(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyCpHash() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPM2B_DIGEST cp_hash_a =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyCpHash");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyCpHash(policy_session, policy_session_name,
+                                            cp_hash_a, &serialized_command,
+                                            nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyCpHash");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyCpHash(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyNameHash() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPM2B_DIGEST name_hash =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyNameHash");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyNameHash(policy_session,
+                                              policy_session_name, name_hash,
+                                              &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyNameHash");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyNameHash(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyDuplicationSelect() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPM2B_NAME object_name =
+      Make_TPM2B_NAME(std::string(sizeof(TPM2B_NAME::name), 'a'));
+  TPM2B_NAME new_parent_name =
+      Make_TPM2B_NAME(std::string(sizeof(TPM2B_NAME::name), 'a'));
+  TPMI_YES_NO include_object = TPMI_YES_NO();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyDuplicationSelect");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyDuplicationSelect(policy_session,
+                                                       policy_session_name,
+                                                       object_name,
+                                                       new_parent_name,
+                                                       include_object,
+                                                       &serialized_command,
+                                                       nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyDuplicationSelect");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyDuplicationSelect(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyAuthorize() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPM2B_DIGEST approved_policy =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  TPM2B_NONCE policy_ref = TPM2B_NONCE();
+  TPM2B_NAME key_sign =
+      Make_TPM2B_NAME(std::string(sizeof(TPM2B_NAME::name), 'a'));
+  TPMT_TK_VERIFIED check_ticket = TPMT_TK_VERIFIED();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyAuthorize");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyAuthorize(policy_session,
+                                               policy_session_name,
+                                               approved_policy, policy_ref,
+                                               key_sign, check_ticket,
+                                               &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyAuthorize");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyAuthorize(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyAuthValue() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyAuthValue");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyAuthValue(policy_session,
+                                               policy_session_name,
+                                               &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyAuthValue");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyAuthValue(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyPassword() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyPassword");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyPassword(policy_session,
+                                              policy_session_name,
+                                              &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyPassword");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyPassword(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyGetDigest() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyGetDigest");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyGetDigest(policy_session,
+                                               policy_session_name,
+                                               &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_DIGEST(
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_DIGEST policy_digest;
+  Benchmark parse("ParseResponse_PolicyGetDigest");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyGetDigest(response, &policy_digest, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PolicyNvWritten() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_SH_POLICY policy_session = TPMI_SH_POLICY();
+  std::string policy_session_name(kHandleNameSize, 'n');
+  TPMI_YES_NO written_set = TPMI_YES_NO();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PolicyNvWritten");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PolicyNvWritten(policy_session,
+                                               policy_session_name, written_set,
+                                               &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PolicyNvWritten");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PolicyNvWritten(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_CreatePrimary() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_HIERARCHY primary_handle = TPMI_RH_HIERARCHY();
+  std::string primary_handle_name(kHandleNameSize, 'n');
+  TPM2B_SENSITIVE_CREATE in_sensitive = TPM2B_SENSITIVE_CREATE();
+  TPM2B_PUBLIC in_public = TPM2B_PUBLIC();
+  TPM2B_DATA outside_info =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  TPML_PCR_SELECTION creation_pcr = TPML_PCR_SELECTION();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_CreatePrimary");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_CreatePrimary(primary_handle,
+                                             primary_handle_name, in_sensitive,
+                                             in_public, outside_info,
+                                             creation_pcr, &serialized_command,
+                                             nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM_HANDLE(TPM_HANDLE(), &response_parameters);
+  Serialize_TPM2B_PUBLIC(TPM2B_PUBLIC(), &response_parameters);
+  Serialize_TPM2B_CREATION_DATA(TPM2B_CREATION_DATA(), &response_parameters);
+  Serialize_TPM2B_DIGEST(
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a')),
+      &response_parameters);
+  Serialize_TPMT_TK_CREATION(TPMT_TK_CREATION(), &response_parameters);
+  Serialize_TPM2B_NAME(
+      Make_TPM2B_NAME(std::string(sizeof(TPM2B_NAME::name), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM_HANDLE object_handle;
+  TPM2B_PUBLIC out_public;
+  TPM2B_CREATION_DATA creation_data;
+  TPM2B_DIGEST creation_hash;
+  TPMT_TK_CREATION creation_ticket;
+  TPM2B_NAME name;
+  Benchmark parse("ParseResponse_CreatePrimary");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_CreatePrimary(response, &object_handle, &out_public,
+                                          &creation_data, &creation_hash,
+                                          &creation_ticket, &name, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_HierarchyControl() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_HIERARCHY auth_handle = TPMI_RH_HIERARCHY();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_RH_ENABLES enable = TPMI_RH_ENABLES();
+  TPMI_YES_NO state = TPMI_YES_NO();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_HierarchyControl");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_HierarchyControl(auth_handle, auth_handle_name,
+                                                enable, state,
+                                                &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_HierarchyControl");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_HierarchyControl(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_SetPrimaryPolicy() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_HIERARCHY auth_handle = TPMI_RH_HIERARCHY();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPM2B_DIGEST auth_policy =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  TPMI_ALG_HASH hash_alg = TPMI_ALG_HASH();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_SetPrimaryPolicy");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_SetPrimaryPolicy(auth_handle, auth_handle_name,
+                                                auth_policy, hash_alg,
+                                                &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_SetPrimaryPolicy");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_SetPrimaryPolicy(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ChangePPS() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PLATFORM auth_handle = TPMI_RH_PLATFORM();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ChangePPS");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ChangePPS(auth_handle, auth_handle_name,
+                                         &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_ChangePPS");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ChangePPS(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ChangeEPS() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PLATFORM auth_handle = TPMI_RH_PLATFORM();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ChangeEPS");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ChangeEPS(auth_handle, auth_handle_name,
+                                         &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_ChangeEPS");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ChangeEPS(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_Clear() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_CLEAR auth_handle = TPMI_RH_CLEAR();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_Clear");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_Clear(auth_handle, auth_handle_name,
+                                     &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_Clear");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_Clear(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ClearControl() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_CLEAR auth = TPMI_RH_CLEAR();
+  std::string auth_name(kHandleNameSize, 'n');
+  TPMI_YES_NO disable = TPMI_YES_NO();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ClearControl");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ClearControl(auth, auth_name, disable,
+                                            &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_ClearControl");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ClearControl(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_HierarchyChangeAuth() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_HIERARCHY_AUTH auth_handle = TPMI_RH_HIERARCHY_AUTH();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPM2B_AUTH new_auth = TPM2B_AUTH();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_HierarchyChangeAuth");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_HierarchyChangeAuth(auth_handle,
+                                                   auth_handle_name, new_auth,
+                                                   &serialized_command,
+                                                   nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_HierarchyChangeAuth");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_HierarchyChangeAuth(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_DictionaryAttackLockReset() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_LOCKOUT lock_handle = TPMI_RH_LOCKOUT();
+  std::string lock_handle_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_DictionaryAttackLockReset");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_DictionaryAttackLockReset(lock_handle,
+                                                         lock_handle_name,
+                                                         &serialized_command,
+                                                         nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_DictionaryAttackLockReset");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_DictionaryAttackLockReset(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_DictionaryAttackParameters() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_LOCKOUT lock_handle = TPMI_RH_LOCKOUT();
+  std::string lock_handle_name(kHandleNameSize, 'n');
+  UINT32 new_max_tries = UINT32();
+  UINT32 new_recovery_time = UINT32();
+  UINT32 lockout_recovery = UINT32();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_DictionaryAttackParameters");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_DictionaryAttackParameters(lock_handle,
+                                                          lock_handle_name,
+                                                          new_max_tries,
+                                                          new_recovery_time,
+                                                          lockout_recovery,
+                                                          &serialized_command,
+                                                          nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_DictionaryAttackParameters");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_DictionaryAttackParameters(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_PP_Commands() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PLATFORM auth = TPMI_RH_PLATFORM();
+  std::string auth_name(kHandleNameSize, 'n');
+  TPML_CC set_list = TPML_CC();
+  TPML_CC clear_list = TPML_CC();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_PP_Commands");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_PP_Commands(auth, auth_name, set_list,
+                                           clear_list, &serialized_command,
+                                           nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_PP_Commands");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_PP_Commands(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_SetAlgorithmSet() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PLATFORM auth_handle = TPMI_RH_PLATFORM();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  UINT32 algorithm_set = UINT32();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_SetAlgorithmSet");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_SetAlgorithmSet(auth_handle, auth_handle_name,
+                                               algorithm_set,
+                                               &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_SetAlgorithmSet");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_SetAlgorithmSet(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_FieldUpgradeStart() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PLATFORM authorization = TPMI_RH_PLATFORM();
+  std::string authorization_name(kHandleNameSize, 'n');
+  TPMI_DH_OBJECT key_handle = TPMI_DH_OBJECT();
+  std::string key_handle_name(kHandleNameSize, 'n');
+  TPM2B_DIGEST fu_digest =
+      Make_TPM2B_DIGEST(std::string(sizeof(TPM2B_DIGEST::buffer), 'a'));
+  TPMT_SIGNATURE manifest_signature = TPMT_SIGNATURE();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_FieldUpgradeStart");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_FieldUpgradeStart(authorization,
+                                                 authorization_name, key_handle,
+                                                 key_handle_name, fu_digest,
+                                                 manifest_signature,
+                                                 &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_FieldUpgradeStart");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_FieldUpgradeStart(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_FieldUpgradeData() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPM2B_MAX_BUFFER fu_data =
+      Make_TPM2B_MAX_BUFFER(std::string(sizeof(TPM2B_MAX_BUFFER::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_FieldUpgradeData");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_FieldUpgradeData(fu_data, &serialized_command,
+                                                nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPMT_HA(TPMT_HA(), &response_parameters);
+  Serialize_TPMT_HA(TPMT_HA(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPMT_HA next_digest;
+  TPMT_HA first_digest;
+  Benchmark parse("ParseResponse_FieldUpgradeData");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_FieldUpgradeData(response, &next_digest,
+                                             &first_digest, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_FirmwareRead() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  UINT32 sequence_number = UINT32();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_FirmwareRead");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_FirmwareRead(sequence_number,
+                                            &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_MAX_BUFFER(
+      Make_TPM2B_MAX_BUFFER(std::string(sizeof(TPM2B_MAX_BUFFER::buffer), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_MAX_BUFFER fu_data;
+  Benchmark parse("ParseResponse_FirmwareRead");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_FirmwareRead(response, &fu_data, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ContextSave() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_CONTEXT save_handle = TPMI_DH_CONTEXT();
+  std::string save_handle_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ContextSave");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ContextSave(save_handle, save_handle_name,
+                                           &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPMS_CONTEXT(TPMS_CONTEXT(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPMS_CONTEXT context;
+  Benchmark parse("ParseResponse_ContextSave");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ContextSave(response, &context, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ContextLoad() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMS_CONTEXT context = TPMS_CONTEXT();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ContextLoad");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ContextLoad(context, &serialized_command,
+                                           nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPMI_DH_CONTEXT(TPMI_DH_CONTEXT(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPMI_DH_CONTEXT loaded_handle;
+  Benchmark parse("ParseResponse_ContextLoad");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ContextLoad(response, &loaded_handle, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_FlushContext() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_CONTEXT flush_handle = TPMI_DH_CONTEXT();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_FlushContext");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_FlushContext(flush_handle, &serialized_command,
+                                            nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_FlushContext");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_FlushContext(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_EvictControl() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PROVISION auth = TPMI_RH_PROVISION();
+  std::string auth_name(kHandleNameSize, 'n');
+  TPMI_DH_OBJECT object_handle = TPMI_DH_OBJECT();
+  std::string object_handle_name(kHandleNameSize, 'n');
+  TPMI_DH_PERSISTENT persistent_handle = TPMI_DH_PERSISTENT();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_EvictControl");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_EvictControl(auth, auth_name, object_handle,
+                                            object_handle_name,
+                                            persistent_handle,
+                                            &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_EvictControl");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_EvictControl(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ReadClock() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ReadClock");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ReadClock(&serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPMS_TIME_INFO(TPMS_TIME_INFO(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPMS_TIME_INFO current_time;
+  Benchmark parse("ParseResponse_ReadClock");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ReadClock(response, &current_time, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ClockSet() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PROVISION auth = TPMI_RH_PROVISION();
+  std::string auth_name(kHandleNameSize, 'n');
+  UINT64 new_time = UINT64();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ClockSet");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ClockSet(auth, auth_name, new_time,
+                                        &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_ClockSet");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ClockSet(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_ClockRateAdjust() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PROVISION auth = TPMI_RH_PROVISION();
+  std::string auth_name(kHandleNameSize, 'n');
+  TPM_CLOCK_ADJUST rate_adjust = TPM_CLOCK_ADJUST();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_ClockRateAdjust");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_ClockRateAdjust(auth, auth_name, rate_adjust,
+                                               &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_ClockRateAdjust");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_ClockRateAdjust(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_GetCapability() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPM_CAP capability = TPM_CAP();
+  UINT32 property = UINT32();
+  UINT32 property_count = UINT32();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_GetCapability");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_GetCapability(capability, property,
+                                             property_count,
+                                             &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPMI_YES_NO(TPMI_YES_NO(), &response_parameters);
+  Serialize_TPMS_CAPABILITY_DATA(TPMS_CAPABILITY_DATA(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPMI_YES_NO more_data;
+  TPMS_CAPABILITY_DATA capability_data;
+  Benchmark parse("ParseResponse_GetCapability");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_GetCapability(response, &more_data,
+                                          &capability_data, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_TestParms() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMT_PUBLIC_PARMS parameters = TPMT_PUBLIC_PARMS();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_TestParms");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_TestParms(parameters, &serialized_command,
+                                         nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_TestParms");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_TestParms(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_DefineSpace() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PROVISION auth_handle = TPMI_RH_PROVISION();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPM2B_AUTH auth = TPM2B_AUTH();
+  TPM2B_NV_PUBLIC public_info = TPM2B_NV_PUBLIC();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_DefineSpace");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_DefineSpace(auth_handle, auth_handle_name,
+                                              auth, public_info,
+                                              &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_NV_DefineSpace");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_DefineSpace(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_UndefineSpace() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PROVISION auth_handle = TPMI_RH_PROVISION();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_UndefineSpace");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_UndefineSpace(auth_handle, auth_handle_name,
+                                                nv_index, nv_index_name,
+                                                &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_NV_UndefineSpace");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_UndefineSpace(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_UndefineSpaceSpecial() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  TPMI_RH_PLATFORM platform = TPMI_RH_PLATFORM();
+  std::string platform_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_UndefineSpaceSpecial");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_UndefineSpaceSpecial(nv_index, nv_index_name,
+                                                       platform, platform_name,
+                                                       &serialized_command,
+                                                       nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_NV_UndefineSpaceSpecial");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_UndefineSpaceSpecial(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_ReadPublic() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_ReadPublic");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_ReadPublic(nv_index, nv_index_name,
+                                             &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_NV_PUBLIC(TPM2B_NV_PUBLIC(), &response_parameters);
+  Serialize_TPM2B_NAME(
+      Make_TPM2B_NAME(std::string(sizeof(TPM2B_NAME::name), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_NV_PUBLIC nv_public;
+  TPM2B_NAME nv_name;
+  Benchmark parse("ParseResponse_NV_ReadPublic");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_ReadPublic(response, &nv_public, &nv_name,
+                                          nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_Write() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_NV_AUTH auth_handle = TPMI_RH_NV_AUTH();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  TPM2B_MAX_NV_BUFFER data = Make_TPM2B_MAX_NV_BUFFER(
+      std::string(sizeof(TPM2B_MAX_NV_BUFFER::buffer), 'a'));
+  UINT16 offset = UINT16();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_Write");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_Write(auth_handle, auth_handle_name, nv_index,
+                                        nv_index_name, data, offset,
+                                        &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_NV_Write");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_Write(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_Increment() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_NV_AUTH auth_handle = TPMI_RH_NV_AUTH();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_Increment");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_Increment(auth_handle, auth_handle_name,
+                                            nv_index, nv_index_name,
+                                            &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_NV_Increment");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_Increment(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_Extend() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_NV_AUTH auth_handle = TPMI_RH_NV_AUTH();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  TPM2B_MAX_NV_BUFFER data = Make_TPM2B_MAX_NV_BUFFER(
+      std::string(sizeof(TPM2B_MAX_NV_BUFFER::buffer), 'a'));
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_Extend");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_Extend(auth_handle, auth_handle_name,
+                                         nv_index, nv_index_name, data,
+                                         &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_NV_Extend");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_Extend(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_SetBits() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_NV_AUTH auth_handle = TPMI_RH_NV_AUTH();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  UINT64 bits = UINT64();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_SetBits");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_SetBits(auth_handle, auth_handle_name,
+                                          nv_index, nv_index_name, bits,
+                                          &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_NV_SetBits");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_SetBits(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_WriteLock() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_NV_AUTH auth_handle = TPMI_RH_NV_AUTH();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_WriteLock");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_WriteLock(auth_handle, auth_handle_name,
+                                            nv_index, nv_index_name,
+                                            &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_NV_WriteLock");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_WriteLock(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_GlobalWriteLock() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_PROVISION auth_handle = TPMI_RH_PROVISION();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_GlobalWriteLock");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_GlobalWriteLock(auth_handle, auth_handle_name,
+                                                  &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_NV_GlobalWriteLock");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_GlobalWriteLock(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_Read() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_NV_AUTH auth_handle = TPMI_RH_NV_AUTH();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  UINT16 size = UINT16();
+  UINT16 offset = UINT16();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_Read");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_Read(auth_handle, auth_handle_name, nv_index,
+                                       nv_index_name, size, offset,
+                                       &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_MAX_NV_BUFFER(
+      Make_TPM2B_MAX_NV_BUFFER(std::string(sizeof(TPM2B_MAX_NV_BUFFER::buffer), 'a')),
+      &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_MAX_NV_BUFFER data;
+  Benchmark parse("ParseResponse_NV_Read");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_Read(response, &data, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_ReadLock() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_NV_AUTH auth_handle = TPMI_RH_NV_AUTH();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_ReadLock");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_ReadLock(auth_handle, auth_handle_name,
+                                           nv_index, nv_index_name,
+                                           &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_NV_ReadLock");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_ReadLock(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_ChangeAuth() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  TPM2B_AUTH new_auth = TPM2B_AUTH();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_ChangeAuth");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_ChangeAuth(nv_index, nv_index_name, new_auth,
+                                             &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  std::string response = MakeResponse(response_parameters);
+  Benchmark parse("ParseResponse_NV_ChangeAuth");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_ChangeAuth(response, nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+bool Benchmark_NV_Certify() {
+  TPM_RC rc = TPM_RC_SUCCESS;
+  TPMI_DH_OBJECT sign_handle = TPMI_DH_OBJECT();
+  std::string sign_handle_name(kHandleNameSize, 'n');
+  TPMI_RH_NV_AUTH auth_handle = TPMI_RH_NV_AUTH();
+  std::string auth_handle_name(kHandleNameSize, 'n');
+  TPMI_RH_NV_INDEX nv_index = TPMI_RH_NV_INDEX();
+  std::string nv_index_name(kHandleNameSize, 'n');
+  TPM2B_DATA qualifying_data =
+      Make_TPM2B_DATA(std::string(sizeof(TPM2B_DATA::buffer), 'a'));
+  TPMT_SIG_SCHEME in_scheme = TPMT_SIG_SCHEME();
+  UINT16 size = UINT16();
+  UINT16 offset = UINT16();
+  std::string serialized_command;
+  Benchmark serialize("SerializeCommand_NV_Certify");
+  while (serialize.Loop()) {
+    rc = Tpm::SerializeCommand_NV_Certify(sign_handle, sign_handle_name,
+                                          auth_handle, auth_handle_name,
+                                          nv_index, nv_index_name,
+                                          qualifying_data, in_scheme, size,
+                                          offset, &serialized_command, nullptr);
+  }
+  bool success = serialize.Report(rc);
+  std::string response_parameters;
+  Serialize_TPM2B_ATTEST(
+      Make_TPM2B_ATTEST(std::string(sizeof(TPM2B_ATTEST::attestation_data), 'a')),
+      &response_parameters);
+  Serialize_TPMT_SIGNATURE(TPMT_SIGNATURE(), &response_parameters);
+  std::string response = MakeResponse(response_parameters);
+  TPM2B_ATTEST certify_info;
+  TPMT_SIGNATURE signature;
+  Benchmark parse("ParseResponse_NV_Certify");
+  while (parse.Loop()) {
+    rc = Tpm::ParseResponse_NV_Certify(response, &certify_info, &signature,
+                                       nullptr);
+  }
+  return parse.Report(rc) && success;
+}
+
+typedef bool (*BenchmarkFunction)();
+
+const BenchmarkFunction kBenchmarks[] = {
+    &Benchmark_Startup,
+    &Benchmark_Shutdown,
+    &Benchmark_SelfTest,
+    &Benchmark_IncrementalSelfTest,
+    &Benchmark_GetTestResult,
+    &Benchmark_StartAuthSession,
+    &Benchmark_PolicyRestart,
+    &Benchmark_Create,
+    &Benchmark_Load,
+    &Benchmark_LoadExternal,
+    &Benchmark_ReadPublic,
+    &Benchmark_ActivateCredential,
+    &Benchmark_MakeCredential,
+    &Benchmark_Unseal,
+    &Benchmark_ObjectChangeAuth,
+    &Benchmark_Duplicate,
+    &Benchmark_Rewrap,
+    &Benchmark_Import,
+    &Benchmark_RSA_Encrypt,
+    &Benchmark_RSA_Decrypt,
+    &Benchmark_ECDH_KeyGen,
+    &Benchmark_ECDH_ZGen,
+    &Benchmark_ECC_Parameters,
+    &Benchmark_ZGen_2Phase,
+    &Benchmark_EncryptDecrypt,
+    &Benchmark_Hash,
+    &Benchmark_HMAC,
+    &Benchmark_GetRandom,
+    &Benchmark_StirRandom,
+    &Benchmark_HMAC_Start,
+    &Benchmark_HashSequenceStart,
+    &Benchmark_SequenceUpdate,
+    &Benchmark_SequenceComplete,
+    &Benchmark_EventSequenceComplete,
+    &Benchmark_Certify,
+    &Benchmark_CertifyCreation,
+    &Benchmark_Quote,
+    &Benchmark_GetSessionAuditDigest,
+    &Benchmark_GetCommandAuditDigest,
+    &Benchmark_GetTime,
+    &Benchmark_Commit,
+    &Benchmark_EC_Ephemeral,
+    &Benchmark_VerifySignature,
+    &Benchmark_Sign,
+    &Benchmark_SetCommandCodeAuditStatus,
+    &Benchmark_PCR_Extend,
+    &Benchmark_PCR_Event,
+    &Benchmark_PCR_Read,
+    &Benchmark_PCR_Allocate,
+    &Benchmark_PCR_SetAuthPolicy,
+    &Benchmark_PCR_SetAuthValue,
+    &Benchmark_PCR_Reset,
+    &Benchmark_PolicySigned,
+    &Benchmark_PolicySecret,
+    &Benchmark_PolicyTicket,
+    &Benchmark_PolicyOR,
+    &Benchmark_PolicyPCR,
+    &Benchmark_PolicyLocality,
+    &Benchmark_PolicyNV,
+    &Benchmark_PolicyCounterTimer,
+    &Benchmark_PolicyCommandCode,
+    &Benchmark_PolicyPhysicalPresence,
+    &Benchmark_PolicyCpHash,
+    &Benchmark_PolicyNameHash,
+    &Benchmark_PolicyDuplicationSelect,
+    &Benchmark_PolicyAuthorize,
+    &Benchmark_PolicyAuthValue,
+    &Benchmark_PolicyPassword,
+    &Benchmark_PolicyGetDigest,
+    &Benchmark_PolicyNvWritten,
+    &Benchmark_CreatePrimary,
+    &Benchmark_HierarchyControl,
+    &Benchmark_SetPrimaryPolicy,
+    &Benchmark_ChangePPS,
+    &Benchmark_ChangeEPS,
+    &Benchmark_Clear,
+    &Benchmark_ClearControl,
+    &Benchmark_HierarchyChangeAuth,
+    &Benchmark_DictionaryAttackLockReset,
+    &Benchmark_DictionaryAttackParameters,
+    &Benchmark_PP_Commands,
+    &Benchmark_SetAlgorithmSet,
+    &Benchmark_FieldUpgradeStart,
+    &Benchmark_FieldUpgradeData,
+    &Benchmark_FirmwareRead,
+    &Benchmark_ContextSave,
+    &Benchmark_ContextLoad,
+    &Benchmark_FlushContext,
+    &Benchmark_EvictControl,
+    &Benchmark_ReadClock,
+    &Benchmark_ClockSet,
+    &Benchmark_ClockRateAdjust,
+    &Benchmark_GetCapability,
+    &Benchmark_TestParms,
+    &Benchmark_NV_DefineSpace,
+    &Benchmark_NV_UndefineSpace,
+    &Benchmark_NV_UndefineSpaceSpecial,
+    &Benchmark_NV_ReadPublic,
+    &Benchmark_NV_Write,
+    &Benchmark_NV_Increment,
+    &Benchmark_NV_Extend,
+    &Benchmark_NV_SetBits,
+    &Benchmark_NV_WriteLock,
+    &Benchmark_NV_GlobalWriteLock,
+    &Benchmark_NV_Read,
+    &Benchmark_NV_ReadLock,
+    &Benchmark_NV_ChangeAuth,
+    &Benchmark_NV_Certify,
+};
+
+}  // namespace
+}  // namespace trunks
+
+int main(int argc, char** argv) {
+  bool success = true;
+  for (auto benchmark : trunks::kBenchmarks) {
+    success = benchmark() && success;
+  }
+  return success ? 0 : 1;
+}
@@ -0,0 +1,1044 @@
+//
+// Copyright (C) 2015 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// THIS CODE IS GENERATED - DO NOT MODIFY!
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <base/macros.h>
+
+#include "trunks/password_authorization_delegate.h"
+#include "trunks/tpm_generated.h"
+
+// A libFuzzer target for every generated parse function. The first two bytes
+// of the input select the function and the rest of the input is parsed.
+
+namespace trunks {
+namespace {
+
+typedef void (*FuzzTarget)(const std::string& input);
+
+template <typename T, TPM_RC (*Parse)(ParseCursor*, T*)>
+void FuzzParse(const std::string& input) {
+  ParseCursor cursor(input);
+  T value;
+  Parse(&cursor, &value);
+}
+
+void FuzzParseResponse_Startup(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Startup(response, &delegate);
+}
+
+void FuzzParseResponse_Shutdown(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Shutdown(response, &delegate);
+}
+
+void FuzzParseResponse_SelfTest(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_SelfTest(response, &delegate);
+}
+
+void FuzzParseResponse_IncrementalSelfTest(const std::string& response) {
+  TPML_ALG to_do_list;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_IncrementalSelfTest(response, &to_do_list, &delegate);
+}
+
+void FuzzParseResponse_GetTestResult(const std::string& response) {
+  TPM2B_MAX_BUFFER out_data;
+  TPM_RC test_result;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_GetTestResult(response, &out_data, &test_result,
+                                   &delegate);
+}
+
+void FuzzParseResponse_StartAuthSession(const std::string& response) {
+  TPMI_SH_AUTH_SESSION session_handle;
+  TPM2B_NONCE nonce_tpm;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_StartAuthSession(response, &session_handle, &nonce_tpm,
+                                      &delegate);
+}
+
+void FuzzParseResponse_PolicyRestart(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyRestart(response, &delegate);
+}
+
+void FuzzParseResponse_Create(const std::string& response) {
+  TPM2B_PRIVATE out_private;
+  TPM2B_PUBLIC out_public;
+  TPM2B_CREATION_DATA creation_data;
+  TPM2B_DIGEST creation_hash;
+  TPMT_TK_CREATION creation_ticket;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Create(response, &out_private, &out_public, &creation_data,
+                            &creation_hash, &creation_ticket, &delegate);
+}
+
+void FuzzParseResponse_Load(const std::string& response) {
+  TPM_HANDLE object_handle;
+  TPM2B_NAME name;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Load(response, &object_handle, &name, &delegate);
+}
+
+void FuzzParseResponse_LoadExternal(const std::string& response) {
+  TPM_HANDLE object_handle;
+  TPM2B_NAME name;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_LoadExternal(response, &object_handle, &name, &delegate);
+}
+
+void FuzzParseResponse_ReadPublic(const std::string& response) {
+  TPM2B_PUBLIC out_public;
+  TPM2B_NAME name;
+  TPM2B_NAME qualified_name;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ReadPublic(response, &out_public, &name, &qualified_name,
+                                &delegate);
+}
+
+void FuzzParseResponse_ActivateCredential(const std::string& response) {
+  TPM2B_DIGEST cert_info;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ActivateCredential(response, &cert_info, &delegate);
+}
+
+void FuzzParseResponse_MakeCredential(const std::string& response) {
+  TPM2B_ID_OBJECT credential_blob;
+  TPM2B_ENCRYPTED_SECRET secret;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_MakeCredential(response, &credential_blob, &secret,
+                                    &delegate);
+}
+
+void FuzzParseResponse_Unseal(const std::string& response) {
+  TPM2B_SENSITIVE_DATA out_data;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Unseal(response, &out_data, &delegate);
+}
+
+void FuzzParseResponse_ObjectChangeAuth(const std::string& response) {
+  TPM2B_PRIVATE out_private;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ObjectChangeAuth(response, &out_private, &delegate);
+}
+
+void FuzzParseResponse_Duplicate(const std::string& response) {
+  TPM2B_DATA encryption_key_out;
+  TPM2B_PRIVATE duplicate;
+  TPM2B_ENCRYPTED_SECRET out_sym_seed;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Duplicate(response, &encryption_key_out, &duplicate,
+                               &out_sym_seed, &delegate);
+}
+
+void FuzzParseResponse_Rewrap(const std::string& response) {
+  TPM2B_PRIVATE out_duplicate;
+  TPM2B_ENCRYPTED_SECRET out_sym_seed;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Rewrap(response, &out_duplicate, &out_sym_seed, &delegate);
+}
+
+void FuzzParseResponse_Import(const std::string& response) {
+  TPM2B_PRIVATE out_private;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Import(response, &out_private, &delegate);
+}
+
+void FuzzParseResponse_RSA_Encrypt(const std::string& response) {
+  TPM2B_PUBLIC_KEY_RSA out_data;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_RSA_Encrypt(response, &out_data, &delegate);
+}
+
+void FuzzParseResponse_RSA_Decrypt(const std::string& response) {
+  TPM2B_PUBLIC_KEY_RSA message;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_RSA_Decrypt(response, &message, &delegate);
+}
+
+void FuzzParseResponse_ECDH_KeyGen(const std::string& response) {
+  TPM2B_ECC_POINT z_point;
+  TPM2B_ECC_POINT pub_point;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ECDH_KeyGen(response, &z_point, &pub_point, &delegate);
+}
+
+void FuzzParseResponse_ECDH_ZGen(const std::string& response) {
+  TPM2B_ECC_POINT out_point;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ECDH_ZGen(response, &out_point, &delegate);
+}
+
+void FuzzParseResponse_ECC_Parameters(const std::string& response) {
+  TPMS_ALGORITHM_DETAIL_ECC parameters;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ECC_Parameters(response, &parameters, &delegate);
+}
+
+void FuzzParseResponse_ZGen_2Phase(const std::string& response) {
+  TPM2B_ECC_POINT out_z1;
+  TPM2B_ECC_POINT out_z2;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ZGen_2Phase(response, &out_z1, &out_z2, &delegate);
+}
+
+void FuzzParseResponse_EncryptDecrypt(const std::string& response) {
+  TPM2B_MAX_BUFFER out_data;
+  TPM2B_IV iv_out;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_EncryptDecrypt(response, &out_data, &iv_out, &delegate);
+}
+
+void FuzzParseResponse_Hash(const std::string& response) {
+  TPM2B_DIGEST out_hash;
+  TPMT_TK_HASHCHECK validation;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Hash(response, &out_hash, &validation, &delegate);
+}
+
+void FuzzParseResponse_HMAC(const std::string& response) {
+  TPM2B_DIGEST out_hmac;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_HMAC(response, &out_hmac, &delegate);
+}
+
+void FuzzParseResponse_GetRandom(const std::string& response) {
+  TPM2B_DIGEST random_bytes;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_GetRandom(response, &random_bytes, &delegate);
+}
+
+void FuzzParseResponse_StirRandom(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_StirRandom(response, &delegate);
+}
+
+void FuzzParseResponse_HMAC_Start(const std::string& response) {
+  TPMI_DH_OBJECT sequence_handle;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_HMAC_Start(response, &sequence_handle, &delegate);
+}
+
+void FuzzParseResponse_HashSequenceStart(const std::string& response) {
+  TPMI_DH_OBJECT sequence_handle;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_HashSequenceStart(response, &sequence_handle, &delegate);
+}
+
+void FuzzParseResponse_SequenceUpdate(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_SequenceUpdate(response, &delegate);
+}
+
+void FuzzParseResponse_SequenceComplete(const std::string& response) {
+  TPM2B_DIGEST result;
+  TPMT_TK_HASHCHECK validation;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_SequenceComplete(response, &result, &validation,
+                                      &delegate);
+}
+
+void FuzzParseResponse_EventSequenceComplete(const std::string& response) {
+  TPML_DIGEST_VALUES results;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_EventSequenceComplete(response, &results, &delegate);
+}
+
+void FuzzParseResponse_Certify(const std::string& response) {
+  TPM2B_ATTEST certify_info;
+  TPMT_SIGNATURE signature;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Certify(response, &certify_info, &signature, &delegate);
+}
+
+void FuzzParseResponse_CertifyCreation(const std::string& response) {
+  TPM2B_ATTEST certify_info;
+  TPMT_SIGNATURE signature;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_CertifyCreation(response, &certify_info, &signature,
+                                     &delegate);
+}
+
+void FuzzParseResponse_Quote(const std::string& response) {
+  TPM2B_ATTEST quoted;
+  TPMT_SIGNATURE signature;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Quote(response, &quoted, &signature, &delegate);
+}
+
+void FuzzParseResponse_GetSessionAuditDigest(const std::string& response) {
+  TPM2B_ATTEST audit_info;
+  TPMT_SIGNATURE signature;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_GetSessionAuditDigest(response, &audit_info, &signature,
+                                           &delegate);
+}
+
+void FuzzParseResponse_GetCommandAuditDigest(const std::string& response) {
+  TPM2B_ATTEST audit_info;
+  TPMT_SIGNATURE signature;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_GetCommandAuditDigest(response, &audit_info, &signature,
+                                           &delegate);
+}
+
+void FuzzParseResponse_GetTime(const std::string& response) {
+  TPM2B_ATTEST time_info;
+  TPMT_SIGNATURE signature;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_GetTime(response, &time_info, &signature, &delegate);
+}
+
+void FuzzParseResponse_Commit(const std::string& response) {
+  UINT32 param_size_out;
+  TPM2B_ECC_POINT k;
+  TPM2B_ECC_POINT l;
+  TPM2B_ECC_POINT e;
+  UINT16 counter;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Commit(response, &param_size_out, &k, &l, &e, &counter,
+                            &delegate);
+}
+
+void FuzzParseResponse_EC_Ephemeral(const std::string& response) {
+  UINT32 param_size_out;
+  TPM2B_ECC_POINT q;
+  UINT16 counter;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_EC_Ephemeral(response, &param_size_out, &q, &counter,
+                                  &delegate);
+}
+
+void FuzzParseResponse_VerifySignature(const std::string& response) {
+  TPMT_TK_VERIFIED validation;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_VerifySignature(response, &validation, &delegate);
+}
+
+void FuzzParseResponse_Sign(const std::string& response) {
+  TPMT_SIGNATURE signature;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Sign(response, &signature, &delegate);
+}
+
+void FuzzParseResponse_SetCommandCodeAuditStatus(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_SetCommandCodeAuditStatus(response, &delegate);
+}
+
+void FuzzParseResponse_PCR_Extend(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PCR_Extend(response, &delegate);
+}
+
+void FuzzParseResponse_PCR_Event(const std::string& response) {
+  TPML_DIGEST_VALUES digests;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PCR_Event(response, &digests, &delegate);
+}
+
+void FuzzParseResponse_PCR_Read(const std::string& response) {
+  UINT32 pcr_update_counter;
+  TPML_PCR_SELECTION pcr_selection_out;
+  TPML_DIGEST pcr_values;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PCR_Read(response, &pcr_update_counter, &pcr_selection_out,
+                              &pcr_values, &delegate);
+}
+
+void FuzzParseResponse_PCR_Allocate(const std::string& response) {
+  TPMI_YES_NO allocation_success;
+  UINT32 max_pcr;
+  UINT32 size_needed;
+  UINT32 size_available;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PCR_Allocate(response, &allocation_success, &max_pcr,
+                                  &size_needed, &size_available, &delegate);
+}
+
+void FuzzParseResponse_PCR_SetAuthPolicy(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PCR_SetAuthPolicy(response, &delegate);
+}
+
+void FuzzParseResponse_PCR_SetAuthValue(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PCR_SetAuthValue(response, &delegate);
+}
+
+void FuzzParseResponse_PCR_Reset(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PCR_Reset(response, &delegate);
+}
+
+void FuzzParseResponse_PolicySigned(const std::string& response) {
+  TPM2B_TIMEOUT timeout;
+  TPMT_TK_AUTH policy_ticket;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicySigned(response, &timeout, &policy_ticket,
+                                  &delegate);
+}
+
+void FuzzParseResponse_PolicySecret(const std::string& response) {
+  TPM2B_TIMEOUT timeout;
+  TPMT_TK_AUTH policy_ticket;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicySecret(response, &timeout, &policy_ticket,
+                                  &delegate);
+}
+
+void FuzzParseResponse_PolicyTicket(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyTicket(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyOR(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyOR(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyPCR(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyPCR(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyLocality(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyLocality(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyNV(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyNV(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyCounterTimer(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyCounterTimer(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyCommandCode(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyCommandCode(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyPhysicalPresence(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyPhysicalPresence(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyCpHash(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyCpHash(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyNameHash(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyNameHash(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyDuplicationSelect(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyDuplicationSelect(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyAuthorize(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyAuthorize(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyAuthValue(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyAuthValue(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyPassword(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyPassword(response, &delegate);
+}
+
+void FuzzParseResponse_PolicyGetDigest(const std::string& response) {
+  TPM2B_DIGEST policy_digest;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyGetDigest(response, &policy_digest, &delegate);
+}
+
+void FuzzParseResponse_PolicyNvWritten(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PolicyNvWritten(response, &delegate);
+}
+
+void FuzzParseResponse_CreatePrimary(const std::string& response) {
+  TPM_HANDLE object_handle;
+  TPM2B_PUBLIC out_public;
+  TPM2B_CREATION_DATA creation_data;
+  TPM2B_DIGEST creation_hash;
+  TPMT_TK_CREATION creation_ticket;
+  TPM2B_NAME name;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_CreatePrimary(response, &object_handle, &out_public,
+                                   &creation_data, &creation_hash,
+                                   &creation_ticket, &name, &delegate);
+}
+
+void FuzzParseResponse_HierarchyControl(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_HierarchyControl(response, &delegate);
+}
+
+void FuzzParseResponse_SetPrimaryPolicy(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_SetPrimaryPolicy(response, &delegate);
+}
+
+void FuzzParseResponse_ChangePPS(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ChangePPS(response, &delegate);
+}
+
+void FuzzParseResponse_ChangeEPS(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ChangeEPS(response, &delegate);
+}
+
+void FuzzParseResponse_Clear(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_Clear(response, &delegate);
+}
+
+void FuzzParseResponse_ClearControl(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ClearControl(response, &delegate);
+}
+
+void FuzzParseResponse_HierarchyChangeAuth(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_HierarchyChangeAuth(response, &delegate);
+}
+
+void FuzzParseResponse_DictionaryAttackLockReset(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_DictionaryAttackLockReset(response, &delegate);
+}
+
+void FuzzParseResponse_DictionaryAttackParameters(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_DictionaryAttackParameters(response, &delegate);
+}
+
+void FuzzParseResponse_PP_Commands(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_PP_Commands(response, &delegate);
+}
+
+void FuzzParseResponse_SetAlgorithmSet(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_SetAlgorithmSet(response, &delegate);
+}
+
+void FuzzParseResponse_FieldUpgradeStart(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_FieldUpgradeStart(response, &delegate);
+}
+
+void FuzzParseResponse_FieldUpgradeData(const std::string& response) {
+  TPMT_HA next_digest;
+  TPMT_HA first_digest;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_FieldUpgradeData(response, &next_digest, &first_digest,
+                                      &delegate);
+}
+
+void FuzzParseResponse_FirmwareRead(const std::string& response) {
+  TPM2B_MAX_BUFFER fu_data;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_FirmwareRead(response, &fu_data, &delegate);
+}
+
+void FuzzParseResponse_ContextSave(const std::string& response) {
+  TPMS_CONTEXT context;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ContextSave(response, &context, &delegate);
+}
+
+void FuzzParseResponse_ContextLoad(const std::string& response) {
+  TPMI_DH_CONTEXT loaded_handle;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ContextLoad(response, &loaded_handle, &delegate);
+}
+
+void FuzzParseResponse_FlushContext(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_FlushContext(response, &delegate);
+}
+
+void FuzzParseResponse_EvictControl(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_EvictControl(response, &delegate);
+}
+
+void FuzzParseResponse_ReadClock(const std::string& response) {
+  TPMS_TIME_INFO current_time;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ReadClock(response, &current_time, &delegate);
+}
+
+void FuzzParseResponse_ClockSet(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ClockSet(response, &delegate);
+}
+
+void FuzzParseResponse_ClockRateAdjust(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_ClockRateAdjust(response, &delegate);
+}
+
+void FuzzParseResponse_GetCapability(const std::string& response) {
+  TPMI_YES_NO more_data;
+  TPMS_CAPABILITY_DATA capability_data;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_GetCapability(response, &more_data, &capability_data,
+                                   &delegate);
+}
+
+void FuzzParseResponse_TestParms(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_TestParms(response, &delegate);
+}
+
+void FuzzParseResponse_NV_DefineSpace(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_DefineSpace(response, &delegate);
+}
+
+void FuzzParseResponse_NV_UndefineSpace(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_UndefineSpace(response, &delegate);
+}
+
+void FuzzParseResponse_NV_UndefineSpaceSpecial(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_UndefineSpaceSpecial(response, &delegate);
+}
+
+void FuzzParseResponse_NV_ReadPublic(const std::string& response) {
+  TPM2B_NV_PUBLIC nv_public;
+  TPM2B_NAME nv_name;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_ReadPublic(response, &nv_public, &nv_name, &delegate);
+}
+
+void FuzzParseResponse_NV_Write(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_Write(response, &delegate);
+}
+
+void FuzzParseResponse_NV_Increment(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_Increment(response, &delegate);
+}
+
+void FuzzParseResponse_NV_Extend(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_Extend(response, &delegate);
+}
+
+void FuzzParseResponse_NV_SetBits(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_SetBits(response, &delegate);
+}
+
+void FuzzParseResponse_NV_WriteLock(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_WriteLock(response, &delegate);
+}
+
+void FuzzParseResponse_NV_GlobalWriteLock(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_GlobalWriteLock(response, &delegate);
+}
+
+void FuzzParseResponse_NV_Read(const std::string& response) {
+  TPM2B_MAX_NV_BUFFER data;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_Read(response, &data, &delegate);
+}
+
+void FuzzParseResponse_NV_ReadLock(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_ReadLock(response, &delegate);
+}
+
+void FuzzParseResponse_NV_ChangeAuth(const std::string& response) {
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_ChangeAuth(response, &delegate);
+}
+
+void FuzzParseResponse_NV_Certify(const std::string& response) {
+  TPM2B_ATTEST certify_info;
+  TPMT_SIGNATURE signature;
+  PasswordAuthorizationDelegate delegate("");
+  Tpm::ParseResponse_NV_Certify(response, &certify_info, &signature, &delegate);
+}
+
+const FuzzTarget kFuzzTargets[] = {
+    &FuzzParse<uint8_t, &Parse_uint8_t>,
+    &FuzzParse<int8_t, &Parse_int8_t>,
+    &FuzzParse<int, &Parse_int>,
+    &FuzzParse<uint16_t, &Parse_uint16_t>,
+    &FuzzParse<int16_t, &Parse_int16_t>,
+    &FuzzParse<uint32_t, &Parse_uint32_t>,
+    &FuzzParse<int32_t, &Parse_int32_t>,
+    &FuzzParse<uint64_t, &Parse_uint64_t>,
+    &FuzzParse<int64_t, &Parse_int64_t>,
+    &FuzzParse<UINT8, &Parse_UINT8>,
+    &FuzzParse<BYTE, &Parse_BYTE>,
+    &FuzzParse<INT8, &Parse_INT8>,
+    &FuzzParse<BOOL, &Parse_BOOL>,
+    &FuzzParse<UINT16, &Parse_UINT16>,
+    &FuzzParse<INT16, &Parse_INT16>,
+    &FuzzParse<UINT32, &Parse_UINT32>,
+    &FuzzParse<INT32, &Parse_INT32>,
+    &FuzzParse<UINT64, &Parse_UINT64>,
+    &FuzzParse<INT64, &Parse_INT64>,
+    &FuzzParse<TPM_ALGORITHM_ID, &Parse_TPM_ALGORITHM_ID>,
+    &FuzzParse<TPM_MODIFIER_INDICATOR, &Parse_TPM_MODIFIER_INDICATOR>,
+    &FuzzParse<TPM_AUTHORIZATION_SIZE, &Parse_TPM_AUTHORIZATION_SIZE>,
+    &FuzzParse<TPM_PARAMETER_SIZE, &Parse_TPM_PARAMETER_SIZE>,
+    &FuzzParse<TPM_KEY_SIZE, &Parse_TPM_KEY_SIZE>,
+    &FuzzParse<TPM_KEY_BITS, &Parse_TPM_KEY_BITS>,
+    &FuzzParse<TPM_HANDLE, &Parse_TPM_HANDLE>,
+    &FuzzParse<TPM2B_NONCE, &Parse_TPM2B_NONCE>,
+    &FuzzParse<TPM2B_AUTH, &Parse_TPM2B_AUTH>,
+    &FuzzParse<TPM2B_OPERAND, &Parse_TPM2B_OPERAND>,
+    &FuzzParse<TPMS_SCHEME_HMAC, &Parse_TPMS_SCHEME_HMAC>,
+    &FuzzParse<TPMS_SCHEME_RSASSA, &Parse_TPMS_SCHEME_RSASSA>,
+    &FuzzParse<TPMS_SCHEME_RSAPSS, &Parse_TPMS_SCHEME_RSAPSS>,
+    &FuzzParse<TPMS_SCHEME_ECDSA, &Parse_TPMS_SCHEME_ECDSA>,
+    &FuzzParse<TPMS_SCHEME_SM2, &Parse_TPMS_SCHEME_SM2>,
+    &FuzzParse<TPMS_SCHEME_ECSCHNORR, &Parse_TPMS_SCHEME_ECSCHNORR>,
+    &FuzzParse<TPMI_YES_NO, &Parse_TPMI_YES_NO>,
+    &FuzzParse<TPMI_DH_OBJECT, &Parse_TPMI_DH_OBJECT>,
+    &FuzzParse<TPMI_DH_PERSISTENT, &Parse_TPMI_DH_PERSISTENT>,
+    &FuzzParse<TPMI_DH_ENTITY, &Parse_TPMI_DH_ENTITY>,
+    &FuzzParse<TPMI_DH_PCR, &Parse_TPMI_DH_PCR>,
+    &FuzzParse<TPMI_SH_AUTH_SESSION, &Parse_TPMI_SH_AUTH_SESSION>,
+    &FuzzParse<TPMI_SH_HMAC, &Parse_TPMI_SH_HMAC>,
+    &FuzzParse<TPMI_SH_POLICY, &Parse_TPMI_SH_POLICY>,
+    &FuzzParse<TPMI_DH_CONTEXT, &Parse_TPMI_DH_CONTEXT>,
+    &FuzzParse<TPMI_RH_HIERARCHY, &Parse_TPMI_RH_HIERARCHY>,
+    &FuzzParse<TPMI_RH_ENABLES, &Parse_TPMI_RH_ENABLES>,
+    &FuzzParse<TPMI_RH_HIERARCHY_AUTH, &Parse_TPMI_RH_HIERARCHY_AUTH>,
+    &FuzzParse<TPMI_RH_PLATFORM, &Parse_TPMI_RH_PLATFORM>,
+    &FuzzParse<TPMI_RH_OWNER, &Parse_TPMI_RH_OWNER>,
+    &FuzzParse<TPMI_RH_ENDORSEMENT, &Parse_TPMI_RH_ENDORSEMENT>,
+    &FuzzParse<TPMI_RH_PROVISION, &Parse_TPMI_RH_PROVISION>,
+    &FuzzParse<TPMI_RH_CLEAR, &Parse_TPMI_RH_CLEAR>,
+    &FuzzParse<TPMI_RH_NV_AUTH, &Parse_TPMI_RH_NV_AUTH>,
+    &FuzzParse<TPMI_RH_LOCKOUT, &Parse_TPMI_RH_LOCKOUT>,
+    &FuzzParse<TPMI_RH_NV_INDEX, &Parse_TPMI_RH_NV_INDEX>,
+    &FuzzParse<TPM_ALG_ID, &Parse_TPM_ALG_ID>,
+    &FuzzParse<TPMI_ALG_HASH, &Parse_TPMI_ALG_HASH>,
+    &FuzzParse<TPMI_ALG_ASYM, &Parse_TPMI_ALG_ASYM>,
+    &FuzzParse<TPMI_ALG_SYM, &Parse_TPMI_ALG_SYM>,
+    &FuzzParse<TPMI_ALG_SYM_OBJECT, &Parse_TPMI_ALG_SYM_OBJECT>,
+    &FuzzParse<TPMI_ALG_SYM_MODE, &Parse_TPMI_ALG_SYM_MODE>,
+    &FuzzParse<TPMI_ALG_KDF, &Parse_TPMI_ALG_KDF>,
+    &FuzzParse<TPMI_ALG_SIG_SCHEME, &Parse_TPMI_ALG_SIG_SCHEME>,
+    &FuzzParse<TPMI_ECC_KEY_EXCHANGE, &Parse_TPMI_ECC_KEY_EXCHANGE>,
+    &FuzzParse<TPM_ST, &Parse_TPM_ST>,
+    &FuzzParse<TPMI_ST_COMMAND_TAG, &Parse_TPMI_ST_COMMAND_TAG>,
+    &FuzzParse<TPMI_ST_ATTEST, &Parse_TPMI_ST_ATTEST>,
+    &FuzzParse<TPMI_AES_KEY_BITS, &Parse_TPMI_AES_KEY_BITS>,
+    &FuzzParse<TPMI_SM4_KEY_BITS, &Parse_TPMI_SM4_KEY_BITS>,
+    &FuzzParse<TPMI_ALG_KEYEDHASH_SCHEME, &Parse_TPMI_ALG_KEYEDHASH_SCHEME>,
+    &FuzzParse<TPMI_ALG_ASYM_SCHEME, &Parse_TPMI_ALG_ASYM_SCHEME>,
+    &FuzzParse<TPMI_ALG_RSA_SCHEME, &Parse_TPMI_ALG_RSA_SCHEME>,
+    &FuzzParse<TPMI_ALG_RSA_DECRYPT, &Parse_TPMI_ALG_RSA_DECRYPT>,
+    &FuzzParse<TPMI_RSA_KEY_BITS, &Parse_TPMI_RSA_KEY_BITS>,
+    &FuzzParse<TPMI_ALG_ECC_SCHEME, &Parse_TPMI_ALG_ECC_SCHEME>,
+    &FuzzParse<TPM_ECC_CURVE, &Parse_TPM_ECC_CURVE>,
+    &FuzzParse<TPMI_ECC_CURVE, &Parse_TPMI_ECC_CURVE>,
+    &FuzzParse<TPMI_ALG_PUBLIC, &Parse_TPMI_ALG_PUBLIC>,
+    &FuzzParse<TPMA_ALGORITHM, &Parse_TPMA_ALGORITHM>,
+    &FuzzParse<TPMA_OBJECT, &Parse_TPMA_OBJECT>,
+    &FuzzParse<TPMA_SESSION, &Parse_TPMA_SESSION>,
+    &FuzzParse<TPMA_LOCALITY, &Parse_TPMA_LOCALITY>,
+    &FuzzParse<TPMA_PERMANENT, &Parse_TPMA_PERMANENT>,
+    &FuzzParse<TPMA_STARTUP_CLEAR, &Parse_TPMA_STARTUP_CLEAR>,
+    &FuzzParse<TPMA_MEMORY, &Parse_TPMA_MEMORY>,
+    &FuzzParse<TPM_CC, &Parse_TPM_CC>,
+    &FuzzParse<TPMA_CC, &Parse_TPMA_CC>,
+    &FuzzParse<TPM_NV_INDEX, &Parse_TPM_NV_INDEX>,
+    &FuzzParse<TPMA_NV, &Parse_TPMA_NV>,
+    &FuzzParse<TPM_SPEC, &Parse_TPM_SPEC>,
+    &FuzzParse<TPM_GENERATED, &Parse_TPM_GENERATED>,
+    &FuzzParse<TPM_RC, &Parse_TPM_RC>,
+    &FuzzParse<TPM_CLOCK_ADJUST, &Parse_TPM_CLOCK_ADJUST>,
+    &FuzzParse<TPM_EO, &Parse_TPM_EO>,
+    &FuzzParse<TPM_SU, &Parse_TPM_SU>,
+    &FuzzParse<TPM_SE, &Parse_TPM_SE>,
+    &FuzzParse<TPM_CAP, &Parse_TPM_CAP>,
+    &FuzzParse<TPM_PT, &Parse_TPM_PT>,
+    &FuzzParse<TPM_PT_PCR, &Parse_TPM_PT_PCR>,
+    &FuzzParse<TPM_PS, &Parse_TPM_PS>,
+    &FuzzParse<TPM_HT, &Parse_TPM_HT>,
+    &FuzzParse<TPM_RH, &Parse_TPM_RH>,
+    &FuzzParse<TPM_HC, &Parse_TPM_HC>,
+    &FuzzParse<TPMS_ALGORITHM_DESCRIPTION, &Parse_TPMS_ALGORITHM_DESCRIPTION>,
+    &FuzzParse<TPMT_HA, &Parse_TPMT_HA>,
+    &FuzzParse<TPM2B_DIGEST, &Parse_TPM2B_DIGEST>,
+    &FuzzParse<TPM2B_DATA, &Parse_TPM2B_DATA>,
+    &FuzzParse<TPM2B_EVENT, &Parse_TPM2B_EVENT>,
+    &FuzzParse<TPM2B_MAX_BUFFER, &Parse_TPM2B_MAX_BUFFER>,
+    &FuzzParse<TPM2B_MAX_NV_BUFFER, &Parse_TPM2B_MAX_NV_BUFFER>,
+    &FuzzParse<TPM2B_TIMEOUT, &Parse_TPM2B_TIMEOUT>,
+    &FuzzParse<TPM2B_IV, &Parse_TPM2B_IV>,
+    &FuzzParse<TPM2B_NAME, &Parse_TPM2B_NAME>,
+    &FuzzParse<TPMS_PCR_SELECT, &Parse_TPMS_PCR_SELECT>,
+    &FuzzParse<TPMS_PCR_SELECTION, &Parse_TPMS_PCR_SELECTION>,
+    &FuzzParse<TPMT_TK_CREATION, &Parse_TPMT_TK_CREATION>,
+    &FuzzParse<TPMT_TK_VERIFIED, &Parse_TPMT_TK_VERIFIED>,
+    &FuzzParse<TPMT_TK_AUTH, &Parse_TPMT_TK_AUTH>,
+    &FuzzParse<TPMT_TK_HASHCHECK, &Parse_TPMT_TK_HASHCHECK>,
+    &FuzzParse<TPMS_ALG_PROPERTY, &Parse_TPMS_ALG_PROPERTY>,
+    &FuzzParse<TPMS_TAGGED_PROPERTY, &Parse_TPMS_TAGGED_PROPERTY>,
+    &FuzzParse<TPMS_TAGGED_PCR_SELECT, &Parse_TPMS_TAGGED_PCR_SELECT>,
+    &FuzzParse<TPML_CC, &Parse_TPML_CC>,
+    &FuzzParse<TPML_CCA, &Parse_TPML_CCA>,
+    &FuzzParse<TPML_ALG, &Parse_TPML_ALG>,
+    &FuzzParse<TPML_HANDLE, &Parse_TPML_HANDLE>,
+    &FuzzParse<TPML_DIGEST, &Parse_TPML_DIGEST>,
+    &FuzzParse<TPML_DIGEST_VALUES, &Parse_TPML_DIGEST_VALUES>,
+    &FuzzParse<TPM2B_DIGEST_VALUES, &Parse_TPM2B_DIGEST_VALUES>,
+    &FuzzParse<TPML_PCR_SELECTION, &Parse_TPML_PCR_SELECTION>,
+    &FuzzParse<TPML_ALG_PROPERTY, &Parse_TPML_ALG_PROPERTY>,
+    &FuzzParse<TPML_TAGGED_TPM_PROPERTY, &Parse_TPML_TAGGED_TPM_PROPERTY>,
+    &FuzzParse<TPML_TAGGED_PCR_PROPERTY, &Parse_TPML_TAGGED_PCR_PROPERTY>,
+    &FuzzParse<TPML_ECC_CURVE, &Parse_TPML_ECC_CURVE>,
+    &FuzzParse<TPMS_CAPABILITY_DATA, &Parse_TPMS_CAPABILITY_DATA>,
+    &FuzzParse<TPMS_CLOCK_INFO, &Parse_TPMS_CLOCK_INFO>,
+    &FuzzParse<TPMS_TIME_INFO, &Parse_TPMS_TIME_INFO>,
+    &FuzzParse<TPMS_TIME_ATTEST_INFO, &Parse_TPMS_TIME_ATTEST_INFO>,
+    &FuzzParse<TPMS_CERTIFY_INFO, &Parse_TPMS_CERTIFY_INFO>,
+    &FuzzParse<TPMS_QUOTE_INFO, &Parse_TPMS_QUOTE_INFO>,
+    &FuzzParse<TPMS_COMMAND_AUDIT_INFO, &Parse_TPMS_COMMAND_AUDIT_INFO>,
+    &FuzzParse<TPMS_SESSION_AUDIT_INFO, &Parse_TPMS_SESSION_AUDIT_INFO>,
+    &FuzzParse<TPMS_CREATION_INFO, &Parse_TPMS_CREATION_INFO>,
+    &FuzzParse<TPMS_NV_CERTIFY_INFO, &Parse_TPMS_NV_CERTIFY_INFO>,
+    &FuzzParse<TPMS_ATTEST, &Parse_TPMS_ATTEST>,
+    &FuzzParse<TPM2B_ATTEST, &Parse_TPM2B_ATTEST>,
+    &FuzzParse<TPMS_AUTH_COMMAND, &Parse_TPMS_AUTH_COMMAND>,
+    &FuzzParse<TPMS_AUTH_RESPONSE, &Parse_TPMS_AUTH_RESPONSE>,
+    &FuzzParse<TPMT_SYM_DEF, &Parse_TPMT_SYM_DEF>,
+    &FuzzParse<TPMT_SYM_DEF_OBJECT, &Parse_TPMT_SYM_DEF_OBJECT>,
+    &FuzzParse<TPM2B_SYM_KEY, &Parse_TPM2B_SYM_KEY>,
+    &FuzzParse<TPMS_SYMCIPHER_PARMS, &Parse_TPMS_SYMCIPHER_PARMS>,
+    &FuzzParse<TPM2B_SENSITIVE_DATA, &Parse_TPM2B_SENSITIVE_DATA>,
+    &FuzzParse<TPMS_SENSITIVE_CREATE, &Parse_TPMS_SENSITIVE_CREATE>,
+    &FuzzParse<TPM2B_SENSITIVE_CREATE, &Parse_TPM2B_SENSITIVE_CREATE>,
+    &FuzzParse<TPMS_SCHEME_SIGHASH, &Parse_TPMS_SCHEME_SIGHASH>,
+    &FuzzParse<TPMS_SCHEME_XOR, &Parse_TPMS_SCHEME_XOR>,
+    &FuzzParse<TPMT_KEYEDHASH_SCHEME, &Parse_TPMT_KEYEDHASH_SCHEME>,
+    &FuzzParse<TPMS_SCHEME_ECDAA, &Parse_TPMS_SCHEME_ECDAA>,
+    &FuzzParse<TPMT_SIG_SCHEME, &Parse_TPMT_SIG_SCHEME>,
+    &FuzzParse<TPMS_SCHEME_OAEP, &Parse_TPMS_SCHEME_OAEP>,
+    &FuzzParse<TPMS_SCHEME_ECDH, &Parse_TPMS_SCHEME_ECDH>,
+    &FuzzParse<TPMS_SCHEME_MGF1, &Parse_TPMS_SCHEME_MGF1>,
+    &FuzzParse<TPMS_SCHEME_KDF1_SP800_56a, &Parse_TPMS_SCHEME_KDF1_SP800_56a>,
+    &FuzzParse<TPMS_SCHEME_KDF2, &Parse_TPMS_SCHEME_KDF2>,
+    &FuzzParse<TPMS_SCHEME_KDF1_SP800_108, &Parse_TPMS_SCHEME_KDF1_SP800_108>,
+    &FuzzParse<TPMT_KDF_SCHEME, &Parse_TPMT_KDF_SCHEME>,
+    &FuzzParse<TPMT_ASYM_SCHEME, &Parse_TPMT_ASYM_SCHEME>,
+    &FuzzParse<TPMT_RSA_SCHEME, &Parse_TPMT_RSA_SCHEME>,
+    &FuzzParse<TPMT_RSA_DECRYPT, &Parse_TPMT_RSA_DECRYPT>,
+    &FuzzParse<TPM2B_PUBLIC_KEY_RSA, &Parse_TPM2B_PUBLIC_KEY_RSA>,
+    &FuzzParse<TPM2B_PRIVATE_KEY_RSA, &Parse_TPM2B_PRIVATE_KEY_RSA>,
+    &FuzzParse<TPM2B_ECC_PARAMETER, &Parse_TPM2B_ECC_PARAMETER>,
+    &FuzzParse<TPMS_ECC_POINT, &Parse_TPMS_ECC_POINT>,
+    &FuzzParse<TPM2B_ECC_POINT, &Parse_TPM2B_ECC_POINT>,
+    &FuzzParse<TPMT_ECC_SCHEME, &Parse_TPMT_ECC_SCHEME>,
+    &FuzzParse<TPMS_ALGORITHM_DETAIL_ECC, &Parse_TPMS_ALGORITHM_DETAIL_ECC>,
+    &FuzzParse<TPMS_SIGNATURE_RSASSA, &Parse_TPMS_SIGNATURE_RSASSA>,
+    &FuzzParse<TPMS_SIGNATURE_RSAPSS, &Parse_TPMS_SIGNATURE_RSAPSS>,
+    &FuzzParse<TPMS_SIGNATURE_ECDSA, &Parse_TPMS_SIGNATURE_ECDSA>,
+    &FuzzParse<TPMT_SIGNATURE, &Parse_TPMT_SIGNATURE>,
+    &FuzzParse<TPM2B_ENCRYPTED_SECRET, &Parse_TPM2B_ENCRYPTED_SECRET>,
+    &FuzzParse<TPMS_KEYEDHASH_PARMS, &Parse_TPMS_KEYEDHASH_PARMS>,
+    &FuzzParse<TPMS_ASYM_PARMS, &Parse_TPMS_ASYM_PARMS>,
+    &FuzzParse<TPMS_RSA_PARMS, &Parse_TPMS_RSA_PARMS>,
+    &FuzzParse<TPMS_ECC_PARMS, &Parse_TPMS_ECC_PARMS>,
+    &FuzzParse<TPMT_PUBLIC_PARMS, &Parse_TPMT_PUBLIC_PARMS>,
+    &FuzzParse<TPMT_PUBLIC, &Parse_TPMT_PUBLIC>,
+    &FuzzParse<TPM2B_PUBLIC, &Parse_TPM2B_PUBLIC>,
+    &FuzzParse<TPM2B_PRIVATE_VENDOR_SPECIFIC,
+               &Parse_TPM2B_PRIVATE_VENDOR_SPECIFIC>,
+    &FuzzParse<TPMT_SENSITIVE, &Parse_TPMT_SENSITIVE>,
+    &FuzzParse<TPM2B_SENSITIVE, &Parse_TPM2B_SENSITIVE>,
+    &FuzzParse<_PRIVATE, &Parse__PRIVATE>,
+    &FuzzParse<TPM2B_PRIVATE, &Parse_TPM2B_PRIVATE>,
+    &FuzzParse<_ID_OBJECT, &Parse__ID_OBJECT>,
+    &FuzzParse<TPM2B_ID_OBJECT, &Parse_TPM2B_ID_OBJECT>,
+    &FuzzParse<TPMS_NV_PUBLIC, &Parse_TPMS_NV_PUBLIC>,
+    &FuzzParse<TPM2B_NV_PUBLIC, &Parse_TPM2B_NV_PUBLIC>,
+    &FuzzParse<TPM2B_CONTEXT_SENSITIVE, &Parse_TPM2B_CONTEXT_SENSITIVE>,
+    &FuzzParse<TPMS_CONTEXT_DATA, &Parse_TPMS_CONTEXT_DATA>,
+    &FuzzParse<TPM2B_CONTEXT_DATA, &Parse_TPM2B_CONTEXT_DATA>,
+    &FuzzParse<TPMS_CONTEXT, &Parse_TPMS_CONTEXT>,
+    &FuzzParse<TPMS_CREATION_DATA, &Parse_TPMS_CREATION_DATA>,
+    &FuzzParse<TPM2B_CREATION_DATA, &Parse_TPM2B_CREATION_DATA>,
+    &FuzzParse<TPML_CC_COMPACT, &Parse_TPML_CC_COMPACT>,
+    &FuzzParse<TPML_CCA_COMPACT, &Parse_TPML_CCA_COMPACT>,
+    &FuzzParse<TPML_HANDLE_COMPACT, &Parse_TPML_HANDLE_COMPACT>,
+    &FuzzParse<TPML_PCR_SELECTION_COMPACT, &Parse_TPML_PCR_SELECTION_COMPACT>,
+    &FuzzParse<TPML_ALG_PROPERTY_COMPACT, &Parse_TPML_ALG_PROPERTY_COMPACT>,
+    &FuzzParse<TPML_TAGGED_TPM_PROPERTY_COMPACT,
+               &Parse_TPML_TAGGED_TPM_PROPERTY_COMPACT>,
+    &FuzzParse<TPML_TAGGED_PCR_PROPERTY_COMPACT,
+               &Parse_TPML_TAGGED_PCR_PROPERTY_COMPACT>,
+    &FuzzParse<TPML_ECC_CURVE_COMPACT, &Parse_TPML_ECC_CURVE_COMPACT>,
+    &FuzzParse<TPMS_CAPABILITY_DATA_COMPACT,
+               &Parse_TPMS_CAPABILITY_DATA_COMPACT>,
+    &FuzzParseResponse_Startup,
+    &FuzzParseResponse_Shutdown,
+    &FuzzParseResponse_SelfTest,
+    &FuzzParseResponse_IncrementalSelfTest,
+    &FuzzParseResponse_GetTestResult,
+    &FuzzParseResponse_StartAuthSession,
+    &FuzzParseResponse_PolicyRestart,
+    &FuzzParseResponse_Create,
+    &FuzzParseResponse_Load,
+    &FuzzParseResponse_LoadExternal,
+    &FuzzParseResponse_ReadPublic,
+    &FuzzParseResponse_ActivateCredential,
+    &FuzzParseResponse_MakeCredential,
+    &FuzzParseResponse_Unseal,
+    &FuzzParseResponse_ObjectChangeAuth,
+    &FuzzParseResponse_Duplicate,
+    &FuzzParseResponse_Rewrap,
+    &FuzzParseResponse_Import,
+    &FuzzParseResponse_RSA_Encrypt,
+    &FuzzParseResponse_RSA_Decrypt,
+    &FuzzParseResponse_ECDH_KeyGen,
+    &FuzzParseResponse_ECDH_ZGen,
+    &FuzzParseResponse_ECC_Parameters,
+    &FuzzParseResponse_ZGen_2Phase,
+    &FuzzParseResponse_EncryptDecrypt,
+    &FuzzParseResponse_Hash,
+    &FuzzParseResponse_HMAC,
+    &FuzzParseResponse_GetRandom,
+    &FuzzParseResponse_StirRandom,
+    &FuzzParseResponse_HMAC_Start,
+    &FuzzParseResponse_HashSequenceStart,
+    &FuzzParseResponse_SequenceUpdate,
+    &FuzzParseResponse_SequenceComplete,
+    &FuzzParseResponse_EventSequenceComplete,
+    &FuzzParseResponse_Certify,
+    &FuzzParseResponse_CertifyCreation,
+    &FuzzParseResponse_Quote,
+    &FuzzParseResponse_GetSessionAuditDigest,
+    &FuzzParseResponse_GetCommandAuditDigest,
+    &FuzzParseResponse_GetTime,
+    &FuzzParseResponse_Commit,
+    &FuzzParseResponse_EC_Ephemeral,
+    &FuzzParseResponse_VerifySignature,
+    &FuzzParseResponse_Sign,
+    &FuzzParseResponse_SetCommandCodeAuditStatus,
+    &FuzzParseResponse_PCR_Extend,
+    &FuzzParseResponse_PCR_Event,
+    &FuzzParseResponse_PCR_Read,
+    &FuzzParseResponse_PCR_Allocate,
+    &FuzzParseResponse_PCR_SetAuthPolicy,
+    &FuzzParseResponse_PCR_SetAuthValue,
+    &FuzzParseResponse_PCR_Reset,
+    &FuzzParseResponse_PolicySigned,
+    &FuzzParseResponse_PolicySecret,
+    &FuzzParseResponse_PolicyTicket,
+    &FuzzParseResponse_PolicyOR,
+    &FuzzParseResponse_PolicyPCR,
+    &FuzzParseResponse_PolicyLocality,
+    &FuzzParseResponse_PolicyNV,
+    &FuzzParseResponse_PolicyCounterTimer,
+    &FuzzParseResponse_PolicyCommandCode,
+    &FuzzParseResponse_PolicyPhysicalPresence,
+    &FuzzParseResponse_PolicyCpHash,
+    &FuzzParseResponse_PolicyNameHash,
+    &FuzzParseResponse_PolicyDuplicationSelect,
+    &FuzzParseResponse_PolicyAuthorize,
+    &FuzzParseResponse_PolicyAuthValue,
+    &FuzzParseResponse_PolicyPassword,
+    &FuzzParseResponse_PolicyGetDigest,
+    &FuzzParseResponse_PolicyNvWritten,
+    &FuzzParseResponse_CreatePrimary,
+    &FuzzParseResponse_HierarchyControl,
+    &FuzzParseResponse_SetPrimaryPolicy,
+    &FuzzParseResponse_ChangePPS,
+    &FuzzParseResponse_ChangeEPS,
+    &FuzzParseResponse_Clear,
+    &FuzzParseResponse_ClearControl,
+    &FuzzParseResponse_HierarchyChangeAuth,
+    &FuzzParseResponse_DictionaryAttackLockReset,
+    &FuzzParseResponse_DictionaryAttackParameters,
+    &FuzzParseResponse_PP_Commands,
+    &FuzzParseResponse_SetAlgorithmSet,
+    &FuzzParseResponse_FieldUpgradeStart,
+    &FuzzParseResponse_FieldUpgradeData,
+    &FuzzParseResponse_FirmwareRead,
+    &FuzzParseResponse_ContextSave,
+    &FuzzParseResponse_ContextLoad,
+    &FuzzParseResponse_FlushContext,
+    &FuzzParseResponse_EvictControl,
+    &FuzzParseResponse_ReadClock,
+    &FuzzParseResponse_ClockSet,
+    &FuzzParseResponse_ClockRateAdjust,
+    &FuzzParseResponse_GetCapability,
+    &FuzzParseResponse_TestParms,
+    &FuzzParseResponse_NV_DefineSpace,
+    &FuzzParseResponse_NV_UndefineSpace,
+    &FuzzParseResponse_NV_UndefineSpaceSpecial,
+    &FuzzParseResponse_NV_ReadPublic,
+    &FuzzParseResponse_NV_Write,
+    &FuzzParseResponse_NV_Increment,
+    &FuzzParseResponse_NV_Extend,
+    &FuzzParseResponse_NV_SetBits,
+    &FuzzParseResponse_NV_WriteLock,
+    &FuzzParseResponse_NV_GlobalWriteLock,
+    &FuzzParseResponse_NV_Read,
+    &FuzzParseResponse_NV_ReadLock,
+    &FuzzParseResponse_NV_ChangeAuth,
+    &FuzzParseResponse_NV_Certify,
+};
+
+}  // namespace
+}  // namespace trunks
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (size < 2) {
+    return 0;
+  }
+  std::string input(reinterpret_cast<const char*>(data + 2), size - 2);
+  size_t target = (data[0] << 8) | data[1];
+  trunks::kFuzzTargets[target % arraysize(trunks::kFuzzTargets)](input);
+  return 0;
+}
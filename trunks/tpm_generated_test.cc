@@ -31,6 +31,7 @@ using testing::DoAll;
 using testing::Invoke;
 using testing::Return;
 using testing::SetArgPointee;
+using testing::SizeIs;
 using testing::StrictMock;
 using testing::WithArg;
 
@@ -89,6 +90,179 @@ TEST(GeneratorTest, ParseBufferOverflow) {
             Parse_TPM2B_MAX_BUFFER(&malformed2, &tmp, nullptr));
 }
 
+TEST(GeneratorTest, ParseWithCursor) {
+  TPML_PCR_SELECTION selection;
+  memset(&selection, 0, sizeof(selection));
+  selection.count = 2;
+  selection.pcr_selections[0].hash = TPM_ALG_SHA1;
+  selection.pcr_selections[0].sizeof_select = 1;
+  selection.pcr_selections[1].hash = TPM_ALG_SHA256;
+  selection.pcr_selections[1].sizeof_select = 3;
+  selection.pcr_selections[1].pcr_select[2] = 0x80;
+  std::string buffer;
+  ASSERT_EQ(TPM_RC_SUCCESS, Serialize_TPML_PCR_SELECTION(selection, &buffer));
+  const std::string serialized = buffer + "trailing";
+  ParseCursor cursor(serialized);
+  TPML_PCR_SELECTION parsed;
+  memset(&parsed, 0, sizeof(parsed));
+  ASSERT_EQ(TPM_RC_SUCCESS, Parse_TPML_PCR_SELECTION(&cursor, &parsed));
+  EXPECT_EQ(buffer.size(), cursor.consumed());
+  EXPECT_EQ("trailing", std::string(cursor.data(), cursor.remaining()));
+  EXPECT_EQ(0, memcmp(&selection, &parsed, sizeof(selection)));
+  // A truncated structure fails without consuming a legacy buffer.
+  std::string truncated = buffer.substr(0, buffer.size() - 1);
+  EXPECT_EQ(TPM_RC_INSUFFICIENT,
+            Parse_TPML_PCR_SELECTION(&truncated, &parsed, nullptr));
+  EXPECT_EQ(buffer.size() - 1, truncated.size());
+}
+
+TEST(GeneratorTest, ParseCompact) {
+  TPMS_CAPABILITY_DATA data;
+  memset(&data, 0, sizeof(data));
+  data.capability = TPM_CAP_HANDLES;
+  data.data.handles.count = 2;
+  data.data.handles.handle[0] = 0x80000000;
+  data.data.handles.handle[1] = 0x80000001;
+  std::string buffer;
+  ASSERT_EQ(TPM_RC_SUCCESS, Serialize_TPMS_CAPABILITY_DATA(data, &buffer));
+  ParseCursor cursor(buffer);
+  TPMS_CAPABILITY_DATA_COMPACT compact;
+  ASSERT_EQ(TPM_RC_SUCCESS,
+            Parse_TPMS_CAPABILITY_DATA_COMPACT(&cursor, &compact));
+  EXPECT_EQ(0u, cursor.remaining());
+  EXPECT_EQ(TPM_CAP_HANDLES, compact.capability);
+  EXPECT_EQ(std::vector<TPM_HANDLE>({0x80000000, 0x80000001}),
+            compact.data.handles.handle);
+  EXPECT_TRUE(compact.data.tpm_properties.tpm_property.empty());
+  TPMS_CAPABILITY_DATA expanded;
+  memset(&expanded, 0, sizeof(expanded));
+  ASSERT_EQ(TPM_RC_SUCCESS,
+            Expand_TPMS_CAPABILITY_DATA_COMPACT(compact, &expanded));
+  EXPECT_EQ(0, memcmp(&data, &expanded, sizeof(data)));
+  compact = Make_TPMS_CAPABILITY_DATA_COMPACT(data);
+  EXPECT_EQ(2u, compact.data.handles.handle.size());
+  // A count larger than the structure could hold is rejected.
+  compact.data.handles.handle.resize(MAX_CAP_HANDLES + 1);
+  EXPECT_EQ(TPM_RC_INSUFFICIENT,
+            Expand_TPMS_CAPABILITY_DATA_COMPACT(compact, &expanded));
+}
+
+TEST(GeneratorTest, SimpleTPM2BHelpers) {
+  TPM2B_DIGEST digest = Make_TPM2B_DIGEST("abc");
+  EXPECT_EQ(3u, digest.size);
+  // The unused part of the buffer is zeroed.
+  for (size_t i = digest.size; i < sizeof(digest.buffer); ++i) {
+    EXPECT_EQ(0, digest.buffer[i]);
+  }
+  EXPECT_TRUE(Equal_TPM2B_DIGEST(digest, Make_TPM2B_DIGEST("abc")));
+  EXPECT_FALSE(Equal_TPM2B_DIGEST(digest, Make_TPM2B_DIGEST("abd")));
+  EXPECT_FALSE(Equal_TPM2B_DIGEST(digest, Make_TPM2B_DIGEST("ab")));
+  EXPECT_TRUE(SecureEqual_TPM2B_DIGEST(digest, "abc"));
+  EXPECT_FALSE(SecureEqual_TPM2B_DIGEST(digest, "abd"));
+  EXPECT_FALSE(SecureEqual_TPM2B_DIGEST(digest, "abcd"));
+  std::string buffer("x");
+  AppendBytesFrom_TPM2B_DIGEST(digest, &buffer);
+  EXPECT_EQ("xabc", buffer);
+  EXPECT_EQ("abc", StringFrom_TPM2B_DIGEST(digest));
+}
+
+// A delegate which does not use the cpHash or rpHash, like a password
+// delegate.
+class HashlessAuthorizationDelegate : public MockAuthorizationDelegate {
+ public:
+  bool RequiresParameterHashes() const override { return false; }
+};
+
+TEST(GeneratorTest, CommandHashOnlyWhenRequired) {
+  std::string command;
+  StrictMock<MockAuthorizationDelegate> hmac_authorization;
+  EXPECT_CALL(hmac_authorization,
+              GetCommandAuthorization(SizeIs(32), _, _, _))
+      .WillOnce(Return(true));
+  EXPECT_EQ(TPM_RC_SUCCESS, Tpm::SerializeCommand_Startup(
+                                TPM_SU_CLEAR, &command, &hmac_authorization));
+  StrictMock<HashlessAuthorizationDelegate> password_authorization;
+  EXPECT_CALL(password_authorization,
+              GetCommandAuthorization(std::string(), _, _, _))
+      .WillOnce(Return(true));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            Tpm::SerializeCommand_Startup(TPM_SU_CLEAR, &command,
+                                          &password_authorization));
+}
+
+TEST(GeneratorTest, FixedSizeCommand) {
+  const uint8_t kExpected[] = {0x80, 0x01, 0x00, 0x00, 0x00, 0x0e, 0x00,
+                               0x00, 0x01, 0x65, 0x80, 0x00, 0x00, 0x01};
+  std::array<uint8_t, Tpm::kFlushContextCommandSize> command;
+  ASSERT_EQ(sizeof(kExpected), command.size());
+  Tpm::BuildCommand_FlushContext(0x80000001, &command);
+  EXPECT_EQ(0, memcmp(kExpected, command.data(), sizeof(kExpected)));
+  // Without a delegate the builder is used; with one that adds no sessions the
+  // general path must produce the same bytes.
+  std::string expected(reinterpret_cast<const char*>(kExpected),
+                       sizeof(kExpected));
+  std::string serialized_command;
+  EXPECT_EQ(TPM_RC_SUCCESS, Tpm::SerializeCommand_FlushContext(
+                                0x80000001, &serialized_command, nullptr));
+  EXPECT_EQ(expected, serialized_command);
+  StrictMock<HashlessAuthorizationDelegate> password_authorization;
+  EXPECT_CALL(password_authorization, GetCommandAuthorization(_, _, _, _))
+      .WillOnce(Return(true));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            Tpm::SerializeCommand_FlushContext(
+                0x80000001, &serialized_command, &password_authorization));
+  EXPECT_EQ(expected, serialized_command);
+}
+
+TEST(GeneratorTest, CommandMetadata) {
+  const TpmCommandMetadata* metadata = GetCommandMetadata(TPM_CC_NV_Write);
+  ASSERT_TRUE(metadata);
+  EXPECT_EQ(TPM_CC_NV_Write, metadata->command_code);
+  EXPECT_EQ(2, metadata->request_handles);
+  EXPECT_EQ(0, metadata->response_handles);
+  EXPECT_TRUE(metadata->sessions_allowed);
+  EXPECT_TRUE(metadata->command_parameter_encryption);
+  EXPECT_FALSE(metadata->read_only);
+  metadata = GetCommandMetadata(TPM_CC_CreatePrimary);
+  ASSERT_TRUE(metadata);
+  EXPECT_EQ(1, metadata->response_handles);
+  EXPECT_EQ(kTpmLatencyLong, metadata->latency_class);
+  metadata = GetCommandMetadata(TPM_CC_PCR_Read);
+  ASSERT_TRUE(metadata);
+  EXPECT_TRUE(metadata->read_only);
+  EXPECT_EQ(kTpmLatencyShort, metadata->latency_class);
+  metadata = GetCommandMetadata(TPM_CC_Startup);
+  ASSERT_TRUE(metadata);
+  EXPECT_FALSE(metadata->sessions_allowed);
+  // Unassigned and out of range command codes.
+  EXPECT_FALSE(GetCommandMetadata(0x123));
+  EXPECT_FALSE(GetCommandMetadata(TPM_CC_FIRST - 1));
+  EXPECT_FALSE(GetCommandMetadata(TPM_CC_LAST + 1));
+}
+
+TEST(GeneratorTest, ParameterEncryptionOnlyForSecrets) {
+  // The auth value passed to NV_DefineSpace and the data read by NV_Read are
+  // secrets.
+  const TpmCommandMetadata* metadata =
+      GetCommandMetadata(TPM_CC_NV_DefineSpace);
+  ASSERT_TRUE(metadata);
+  EXPECT_TRUE(metadata->command_parameter_encryption);
+  metadata = GetCommandMetadata(TPM_CC_NV_Read);
+  ASSERT_TRUE(metadata);
+  EXPECT_TRUE(metadata->response_parameter_encryption);
+  // A digest to sign, a quote and a public area are not.
+  metadata = GetCommandMetadata(TPM_CC_Sign);
+  ASSERT_TRUE(metadata);
+  EXPECT_FALSE(metadata->command_parameter_encryption);
+  metadata = GetCommandMetadata(TPM_CC_Quote);
+  ASSERT_TRUE(metadata);
+  EXPECT_FALSE(metadata->command_parameter_encryption);
+  EXPECT_FALSE(metadata->response_parameter_encryption);
+  metadata = GetCommandMetadata(TPM_CC_ReadPublic);
+  ASSERT_TRUE(metadata);
+  EXPECT_FALSE(metadata->response_parameter_encryption);
+}
+
 TEST(GeneratorTest, SynchronousCommand) {
   // A hand-rolled TPM2_Startup command.
   std::string expected_command(
@@ -383,19 +557,19 @@ TEST_F(CommandFlowTest, SimpleCommandFlowWithError) {
 // - input handles
 // - authorization
 // - multiple input and output parameters
-// - parameter encryption and decryption
+// - parameters which hold no secrets, so they are never encrypted
 TEST_F(CommandFlowTest, FullCommandFlow) {
   // A hand-rolled TPM2_Certify command.
   std::string auth_in(10, 'A');
   std::string auth_out(20, 'B');
   std::string user_data(
       "\x00\x0C"
-      "ct_user_data",
+      "pt_user_data",
       14);
   std::string scheme("\x00\x10", 2);  // scheme=TPM_ALG_NULL
   std::string signed_data(
       "\x00\x0E"
-      "ct_signed_data",
+      "pt_signed_data",
       16);
   std::string signature(
       "\x00\x14"    // sig_scheme=RSASSA
@@ -424,14 +598,10 @@ TEST_F(CommandFlowTest, FullCommandFlow) {
   EXPECT_CALL(transceiver, SendCommand(expected_command, _))
       .WillOnce(WithArg<1>(Invoke(PostResponse(command_response))));
   StrictMock<MockAuthorizationDelegate> authorization;
-  EXPECT_CALL(authorization, GetCommandAuthorization(_, _, _, _))
+  EXPECT_CALL(authorization, GetCommandAuthorization(_, false, false, _))
       .WillOnce(DoAll(SetArgPointee<3>(auth_in), Return(true)));
   EXPECT_CALL(authorization, CheckResponseAuthorization(_, auth_out))
       .WillOnce(Return(true));
-  EXPECT_CALL(authorization, EncryptCommandParameter(_))
-      .WillOnce(Invoke(Encryptor("pt_user_data", "ct_user_data")));
-  EXPECT_CALL(authorization, DecryptResponseParameter(_))
-      .WillOnce(Invoke(Encryptor("ct_signed_data", "pt_signed_data")));
 
   TPMT_SIG_SCHEME null_scheme;
   null_scheme.scheme = TPM_ALG_NULL;
@@ -447,4 +617,50 @@ TEST_F(CommandFlowTest, FullCommandFlow) {
   EXPECT_EQ("signature", signature_);
 }
 
+// The new auth value passed to HierarchyChangeAuth is a secret, so it is
+// encrypted.
+TEST_F(CommandFlowTest, EncryptedCommandFlow) {
+  std::string auth_in(10, 'A');
+  std::string auth_out(20, 'B');
+  std::string new_auth(
+      "\x00\x0D"
+      "ct_auth_value",
+      15);
+  std::string expected_command(
+      "\x80\x02"           // tag=TPM_ST_SESSIONS
+      "\x00\x00\x00\x2B"   // size=43
+      "\x00\x00\x01\x29"   // code=TPM_CC_HierarchyChangeAuth
+      "\x40\x00\x00\x01"   // @authHandle=TPM_RH_OWNER
+      "\x00\x00\x00\x0A",  // auth_size=10
+      18);
+  expected_command += auth_in + new_auth;
+  std::string command_response(
+      "\x80\x02"           // tag=TPM_ST_SESSIONS
+      "\x00\x00\x00\x22"   // size=34
+      "\x00\x00\x00\x00"   // code=TPM_RC_SUCCESS
+      "\x00\x00\x00\x00",  // param_size=0
+      14);
+  command_response += auth_out;
+
+  StrictMock<MockCommandTransceiver> transceiver;
+  EXPECT_CALL(transceiver, SendCommand(expected_command, _))
+      .WillOnce(WithArg<1>(Invoke(PostResponse(command_response))));
+  StrictMock<MockAuthorizationDelegate> authorization;
+  EXPECT_CALL(authorization, GetCommandAuthorization(_, true, false, _))
+      .WillOnce(DoAll(SetArgPointee<3>(auth_in), Return(true)));
+  EXPECT_CALL(authorization, CheckResponseAuthorization(_, auth_out))
+      .WillOnce(Return(true));
+  EXPECT_CALL(authorization, EncryptCommandParameter(_))
+      .WillOnce(Invoke(Encryptor("pt_auth_value", "ct_auth_value")));
+
+  Tpm tpm(&transceiver);
+  response_code_ = TPM_RC_FAILURE;
+  tpm.HierarchyChangeAuth(
+      TPM_RH_OWNER, "owner", Make_TPM2B_DIGEST("pt_auth_value"),
+      &authorization,
+      base::Bind(&CommandFlowTest::StartupCallback, base::Unretained(this)));
+  Run();
+  EXPECT_EQ(TPM_RC_SUCCESS, response_code_);
+}
+
 }  // namespace trunks
@@ -16,31 +16,55 @@
 
 #include "trunks/tpm_handle.h"
 
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 
 #include <base/callback.h>
 #include <base/logging.h>
 #include <base/posix/eintr_wrapper.h>
+#include <base/stl_util.h>
+
+#include "trunks/boot_trace.h"
 
 namespace {
 
-const char kTpmDevice[] = "/dev/tpm0";
+const char kDefaultTpmDevice[] = "/dev/tpm0";
+// Older kernels expose the cancel attribute on the device, newer ones on the
+// class. Neither is guaranteed to exist.
+const char* const kTpmCancelPaths[] = {
+    "/sys/class/tpm/tpm0/device/cancel", "/sys/class/tpm/tpm0/cancel",
+};
 const uint32_t kTpmBufferSize = 4096;
 const int kInvalidFileDescriptor = -1;
+// Long enough for the slowest RSA key generation we have observed.
+const int kDefaultCommandTimeoutSeconds = 120;
+// How long to wait for the driver to return a cancelled command.
+const int kCancelGracePeriodMilliseconds = 1000;
 
 }  // namespace
 
 namespace trunks {
 
-TpmHandle::TpmHandle() : fd_(kInvalidFileDescriptor) {}
+TpmHandle::TpmHandle() : TpmHandle(kDefaultTpmDevice) {}
+
+TpmHandle::TpmHandle(const std::string& device_path)
+    : device_path_(device_path),
+      fd_(kInvalidFileDescriptor),
+      cancel_fd_(kInvalidFileDescriptor),
+      command_timeout_(
+          base::TimeDelta::FromSeconds(kDefaultCommandTimeoutSeconds)) {}
 
 TpmHandle::~TpmHandle() {
+  if (cancel_fd_ != kInvalidFileDescriptor) {
+    IGNORE_EINTR(close(cancel_fd_));
+  }
   int result = IGNORE_EINTR(close(fd_));
   if (result == -1) {
-    PLOG(ERROR) << "TPM: couldn't close " << kTpmDevice;
+    PLOG(ERROR) << "TPM: couldn't close " << device_path_;
   }
-  LOG(INFO) << "TPM: " << kTpmDevice << " closed successfully";
+  LOG(INFO) << "TPM: " << device_path_ << " closed successfully";
 }
 
 bool TpmHandle::Init() {
@@ -48,12 +72,21 @@ bool TpmHandle::Init() {
     VLOG(1) << "Tpm already initialized.";
     return true;
   }
-  fd_ = HANDLE_EINTR(open(kTpmDevice, O_RDWR));
+  fd_ = HANDLE_EINTR(open(device_path_.c_str(), O_RDWR | O_NONBLOCK));
   if (fd_ == kInvalidFileDescriptor) {
-    PLOG(ERROR) << "TPM: Error opening tpm0 file descriptor at " << kTpmDevice;
+    PLOG(ERROR) << "TPM: Error opening file descriptor at " << device_path_;
     return false;
   }
-  LOG(INFO) << "TPM: " << kTpmDevice << " opened successfully";
+  // The cancel attribute is only writable by root so it is opened here, before
+  // privileges are dropped.
+  for (const char* cancel_path : kTpmCancelPaths) {
+    cancel_fd_ = HANDLE_EINTR(open(cancel_path, O_WRONLY));
+    if (cancel_fd_ != kInvalidFileDescriptor) {
+      VLOG(1) << "TPM: Using " << cancel_path << " to cancel commands.";
+      break;
+    }
+  }
+  LOG(INFO) << "TPM: " << device_path_ << " opened successfully";
   return true;
 }
 
@@ -64,10 +97,12 @@ void TpmHandle::SendCommand(const std::string& command,
 
 std::string TpmHandle::SendCommandAndWait(const std::string& command) {
   std::string response;
+  base::TimeTicks start = base::TimeTicks::Now();
   TPM_RC result = SendCommandInternal(command, &response);
   if (result != TPM_RC_SUCCESS) {
     response = CreateErrorResponse(result);
   }
+  RecordBootTraceCommand("tpm", command, start, GetBootTraceCorrelationId());
   return response;
 }
 
@@ -84,14 +119,64 @@ TPM_RC TpmHandle::SendCommandInternal(const std::string& command,
                << command.length();
     return TRUNKS_RC_WRITE_ERROR;
   }
-  char response_buf[kTpmBufferSize];
-  result = HANDLE_EINTR(read(fd_, response_buf, kTpmBufferSize));
+  if (!WaitForResponse(command_timeout_)) {
+    LOG(ERROR) << "TPM: No response within "
+               << command_timeout_.InSeconds() << " seconds.";
+    CancelCommand();
+    return TCTI_RC_NO_RESPONSE;
+  }
+  // Read directly into the |response| storage rather than a stack buffer so
+  // the response bytes are not copied again before they leave this class.
+  response->resize(kTpmBufferSize);
+  result = HANDLE_EINTR(read(fd_, string_as_array(response), kTpmBufferSize));
   if (result < 0) {
     PLOG(ERROR) << "TPM: Error reading from TPM handle.";
+    response->clear();
     return TRUNKS_RC_READ_ERROR;
   }
-  response->assign(response_buf, static_cast<size_t>(result));
+  response->resize(static_cast<size_t>(result));
   return TPM_RC_SUCCESS;
 }
 
+bool TpmHandle::WaitForResponse(base::TimeDelta timeout) {
+  base::TimeTicks deadline = base::TimeTicks::Now() + timeout;
+  while (true) {
+    base::TimeDelta remaining = deadline - base::TimeTicks::Now();
+    if (remaining < base::TimeDelta()) {
+      return false;
+    }
+    struct pollfd poll_fd = {fd_, POLLIN, 0};
+    int result = poll(&poll_fd, 1, remaining.InMilliseconds());
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0) {
+      PLOG(ERROR) << "TPM: Error polling TPM handle.";
+      return false;
+    }
+    // A result of zero is a timeout. Errors on the descriptor are left for
+    // read() to report.
+    return result > 0;
+  }
+}
+
+void TpmHandle::CancelCommand() {
+  if (cancel_fd_ == kInvalidFileDescriptor) {
+    LOG(WARNING) << "TPM: Command cancellation is not supported.";
+    return;
+  }
+  if (lseek(cancel_fd_, 0, SEEK_SET) != 0 ||
+      HANDLE_EINTR(write(cancel_fd_, "1", 1)) != 1) {
+    PLOG(WARNING) << "TPM: Error cancelling command.";
+    return;
+  }
+  // Drain the response to the cancelled command so the driver will accept the
+  // next command.
+  if (WaitForResponse(
+          base::TimeDelta::FromMilliseconds(kCancelGracePeriodMilliseconds))) {
+    char discard[kTpmBufferSize];
+    HANDLE_EINTR(read(fd_, discard, kTpmBufferSize));
+  }
+}
+
 }  // namespace trunks
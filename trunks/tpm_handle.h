@@ -21,6 +21,9 @@
 
 #include <string>
 
+#include <base/macros.h>
+#include <base/time/time.h>
+
 #include "trunks/error_codes.h"
 
 namespace trunks {
@@ -30,13 +33,22 @@ namespace trunks {
 // until a response is received and the callback has been called. Command and
 // response data are opaque to this class; it performs no validation.
 //
+// The device is opened in non-blocking mode and responses are awaited with
+// poll() so a TPM that does not respond within the command timeout does not
+// wedge the caller. On timeout the command is cancelled via the kernel's sysfs
+// cancel attribute, when available, and an error response is returned.
+//
 // Example:
 //   TpmHandle handle;
 //   if (!handle.Init()) {...}
 //   std::string response = handle.SendCommandAndWait(command);
 class TpmHandle : public CommandTransceiver {
  public:
+  // Uses the default device, /dev/tpm0.
   TpmHandle();
+  // Uses the device at |device_path|, e.g. the kernel resource manager at
+  // /dev/tpmrm0.
+  explicit TpmHandle(const std::string& device_path);
   ~TpmHandle() override;
 
   // Initializes a TpmHandle instance. This method must be called successfully
@@ -48,12 +60,28 @@ class TpmHandle : public CommandTransceiver {
                    const ResponseCallback& callback) override;
   std::string SendCommandAndWait(const std::string& command) override;
 
+  // Sets the maximum time to wait for a response to a single command.
+  void set_command_timeout(base::TimeDelta timeout) {
+    command_timeout_ = timeout;
+  }
+
  private:
   // Writes a |command| to /dev/tpm0 and reads the |response|. Returns
   // TPM_RC_SUCCESS on success.
   TPM_RC SendCommandInternal(const std::string& command, std::string* response);
 
-  int fd_;  // A file descriptor for /dev/tpm0.
+  // Waits until a response can be read from |fd_| or |timeout| expires.
+  // Returns true if a response is ready.
+  bool WaitForResponse(base::TimeDelta timeout);
+
+  // Asks the kernel driver to cancel the command currently being processed and
+  // discards its response, if any.
+  void CancelCommand();
+
+  const std::string device_path_;
+  int fd_;  // A file descriptor for |device_path_|.
+  int cancel_fd_;  // A file descriptor for the sysfs cancel attribute.
+  base::TimeDelta command_timeout_;
 
   DISALLOW_COPY_AND_ASSIGN(TpmHandle);
 };
@@ -0,0 +1,299 @@
+//
+// Copyright (C) 2015 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/tpm_marshal.h"
+
+#include <string.h>
+
+#include <base/logging.h>
+
+namespace trunks {
+
+namespace {
+
+// Returns the host integer of |width| bytes at |data|.
+uint64_t LoadInteger(const char* data, size_t width) {
+  switch (width) {
+    case 1:
+      return *reinterpret_cast<const uint8_t*>(data);
+    case 2: {
+      uint16_t value;
+      memcpy(&value, data, sizeof(value));
+      return value;
+    }
+    case 4: {
+      uint32_t value;
+      memcpy(&value, data, sizeof(value));
+      return value;
+    }
+    case 8: {
+      uint64_t value;
+      memcpy(&value, data, sizeof(value));
+      return value;
+    }
+  }
+  NOTREACHED() << "Invalid integer width " << width;
+  return 0;
+}
+
+// Stores |value| as a host integer of |width| bytes at |data|.
+void StoreInteger(uint64_t value, size_t width, char* data) {
+  switch (width) {
+    case 1:
+      *reinterpret_cast<uint8_t*>(data) = static_cast<uint8_t>(value);
+      return;
+    case 2: {
+      uint16_t narrow = static_cast<uint16_t>(value);
+      memcpy(data, &narrow, sizeof(narrow));
+      return;
+    }
+    case 4: {
+      uint32_t narrow = static_cast<uint32_t>(value);
+      memcpy(data, &narrow, sizeof(narrow));
+      return;
+    }
+    case 8:
+      memcpy(data, &value, sizeof(value));
+      return;
+  }
+  NOTREACHED() << "Invalid integer width " << width;
+}
+
+void AppendInteger(uint64_t value, size_t width, std::string* buffer) {
+  char bytes[sizeof(uint64_t)];
+  for (size_t i = 0; i < width; ++i) {
+    bytes[width - 1 - i] = static_cast<char>(value >> (8 * i));
+  }
+  buffer->append(bytes, width);
+}
+
+TPM_RC ReadInteger(ParseCursor* cursor, size_t width, uint64_t* value) {
+  uint8_t bytes[sizeof(uint64_t)];
+  if (!cursor->Read(bytes, width)) {
+    return TPM_RC_INSUFFICIENT;
+  }
+  *value = 0;
+  for (size_t i = 0; i < width; ++i) {
+    *value = (*value << 8) | bytes[i];
+  }
+  return TPM_RC_SUCCESS;
+}
+
+// Returns the value of the integer field |field| refers to, i.e. the element
+// count of an array or the selector of a union, in the structure at |value|.
+// Arrays without a count field hold |capacity| elements.
+uint64_t GetReferencedValue(const MarshalDescriptor& descriptor,
+                            const char* value,
+                            const MarshalField& field) {
+  if (field.reference < 0) {
+    return field.capacity;
+  }
+  DCHECK_LT(static_cast<size_t>(field.reference), descriptor.field_count);
+  const MarshalField& referenced = descriptor.fields[field.reference];
+  DCHECK_EQ(MarshalField::kInteger, referenced.kind);
+  return LoadInteger(value + referenced.offset, referenced.width);
+}
+
+// Serializes a single array element of |field| at |data|.
+TPM_RC SerializeElement(const MarshalField& field,
+                        const char* data,
+                        std::string* buffer) {
+  if (field.descriptor) {
+    return SerializeWithDescriptor(*field.descriptor, data, buffer);
+  }
+  AppendInteger(LoadInteger(data, field.width), field.width, buffer);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC ParseElement(const MarshalField& field,
+                    ParseCursor* cursor,
+                    char* data) {
+  if (field.descriptor) {
+    return ParseWithDescriptor(*field.descriptor, cursor, data);
+  }
+  uint64_t integer = 0;
+  TPM_RC result = ReadInteger(cursor, field.width, &integer);
+  if (result) {
+    return result;
+  }
+  StoreInteger(integer, field.width, data);
+  return TPM_RC_SUCCESS;
+}
+
+// Serializes |field| of the structure or union at |value|. |descriptor|
+// describes |value| and is used to find count and selector fields.
+TPM_RC SerializeField(const MarshalDescriptor& descriptor,
+                      const char* value,
+                      const MarshalField& field,
+                      std::string* buffer) {
+  const char* data = value + field.offset;
+  switch (field.kind) {
+    case MarshalField::kInteger:
+      AppendInteger(LoadInteger(data, field.width), field.width, buffer);
+      return TPM_RC_SUCCESS;
+    case MarshalField::kStructure:
+      return SerializeWithDescriptor(*field.descriptor, data, buffer);
+    case MarshalField::kUnion:
+      return SerializeUnionWithDescriptor(
+          *field.descriptor, GetReferencedValue(descriptor, value, field),
+          data, buffer);
+    case MarshalField::kByteArray: {
+      uint64_t count = GetReferencedValue(descriptor, value, field);
+      if (count > field.capacity) {
+        return TPM_RC_INSUFFICIENT;
+      }
+      buffer->append(data, count);
+      return TPM_RC_SUCCESS;
+    }
+    case MarshalField::kArray: {
+      uint64_t count = GetReferencedValue(descriptor, value, field);
+      if (count > field.capacity) {
+        return TPM_RC_INSUFFICIENT;
+      }
+      for (uint64_t i = 0; i < count; ++i) {
+        TPM_RC result =
+            SerializeElement(field, data + i * field.stride, buffer);
+        if (result) {
+          return result;
+        }
+      }
+      return TPM_RC_SUCCESS;
+    }
+  }
+  NOTREACHED() << "Invalid field kind " << static_cast<int>(field.kind);
+  return TPM_RC_FAILURE;
+}
+
+TPM_RC ParseField(const MarshalDescriptor& descriptor,
+                  const MarshalField& field,
+                  ParseCursor* cursor,
+                  char* value) {
+  char* data = value + field.offset;
+  switch (field.kind) {
+    case MarshalField::kInteger:
+      return ParseElement(field, cursor, data);
+    case MarshalField::kStructure:
+      return ParseWithDescriptor(*field.descriptor, cursor, data);
+    case MarshalField::kUnion:
+      return ParseUnionWithDescriptor(
+          *field.descriptor, GetReferencedValue(descriptor, value, field),
+          cursor, data);
+    case MarshalField::kByteArray: {
+      uint64_t count = GetReferencedValue(descriptor, value, field);
+      if (count > field.capacity) {
+        return TPM_RC_INSUFFICIENT;
+      }
+      if (!cursor->Read(data, count)) {
+        return TPM_RC_INSUFFICIENT;
+      }
+      return TPM_RC_SUCCESS;
+    }
+    case MarshalField::kArray: {
+      uint64_t count = GetReferencedValue(descriptor, value, field);
+      if (count > field.capacity) {
+        return TPM_RC_INSUFFICIENT;
+      }
+      for (uint64_t i = 0; i < count; ++i) {
+        TPM_RC result = ParseElement(field, cursor, data + i * field.stride);
+        if (result) {
+          return result;
+        }
+      }
+      return TPM_RC_SUCCESS;
+    }
+  }
+  NOTREACHED() << "Invalid field kind " << static_cast<int>(field.kind);
+  return TPM_RC_FAILURE;
+}
+
+// Returns the field of the union |descriptor| chosen by |selector|, or nullptr
+// if the selector has no field.
+const MarshalField* GetUnionField(const MarshalDescriptor& descriptor,
+                                  uint32_t selector) {
+  for (size_t i = 0; i < descriptor.field_count; ++i) {
+    if (descriptor.selectors[i] == selector) {
+      return &descriptor.fields[i];
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TPM_RC SerializeWithDescriptor(const MarshalDescriptor& descriptor,
+                               const void* value,
+                               std::string* buffer) {
+  const char* bytes = reinterpret_cast<const char*>(value);
+  if (descriptor.is_sized_structure) {
+    // The size is that of the serialized structure, not the size field.
+    DCHECK_EQ(2u, descriptor.field_count);
+    std::string field_bytes;
+    TPM_RC result =
+        SerializeField(descriptor, bytes, descriptor.fields[1], &field_bytes);
+    if (result) {
+      return result;
+    }
+    AppendInteger(field_bytes.size(), sizeof(UINT16), buffer);
+    buffer->append(field_bytes);
+    return TPM_RC_SUCCESS;
+  }
+  for (size_t i = 0; i < descriptor.field_count; ++i) {
+    TPM_RC result =
+        SerializeField(descriptor, bytes, descriptor.fields[i], buffer);
+    if (result) {
+      return result;
+    }
+  }
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC ParseWithDescriptor(const MarshalDescriptor& descriptor,
+                           ParseCursor* cursor,
+                           void* value) {
+  char* bytes = reinterpret_cast<char*>(value);
+  for (size_t i = 0; i < descriptor.field_count; ++i) {
+    TPM_RC result = ParseField(descriptor, descriptor.fields[i], cursor, bytes);
+    if (result) {
+      return result;
+    }
+  }
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC SerializeUnionWithDescriptor(const MarshalDescriptor& descriptor,
+                                    uint32_t selector,
+                                    const void* value,
+                                    std::string* buffer) {
+  const MarshalField* field = GetUnionField(descriptor, selector);
+  if (!field) {
+    return TPM_RC_SUCCESS;
+  }
+  return SerializeField(descriptor, reinterpret_cast<const char*>(value),
+                        *field, buffer);
+}
+
+TPM_RC ParseUnionWithDescriptor(const MarshalDescriptor& descriptor,
+                                uint32_t selector,
+                                ParseCursor* cursor,
+                                void* value) {
+  const MarshalField* field = GetUnionField(descriptor, selector);
+  if (!field) {
+    return TPM_RC_SUCCESS;
+  }
+  return ParseField(descriptor, *field, cursor, reinterpret_cast<char*>(value));
+}
+
+}  // namespace trunks
@@ -0,0 +1,105 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TRUNKS_TPM_MARSHAL_H_
+#define TRUNKS_TPM_MARSHAL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "trunks/tpm_generated.h"
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+struct MarshalDescriptor;
+
+// Describes how one field of a TPM structure, or one member of a TPM union, is
+// serialized and parsed. The table driven backend of generator.py emits a
+// constant table of these for every structure and union in place of unrolled
+// serialize and parse functions.
+struct MarshalField {
+  enum Kind : uint8_t {
+    // A big-endian integer of |width| bytes.
+    kInteger,
+    // A structure described by |descriptor|.
+    kStructure,
+    // A union described by |descriptor|. The selector is the integer field at
+    // index |reference| of the enclosing structure.
+    kUnion,
+    // An array of at most |capacity| bytes.
+    kByteArray,
+    // An array of at most |capacity| elements, |stride| bytes apart. Elements
+    // are structures described by |descriptor| or, if it is null, integers of
+    // |width| bytes.
+    kArray,
+  };
+
+  Kind kind;
+  uint8_t width;
+  // For arrays in a structure, the index of the integer field which holds the
+  // number of elements. Arrays in a union always hold |capacity| elements and
+  // have a |reference| of -1.
+  int8_t reference;
+  // The offset of the field from the start of the structure or union.
+  uint32_t offset;
+  uint32_t stride;
+  uint32_t capacity;
+  const MarshalDescriptor* descriptor;
+};
+
+// Describes a TPM structure or union as a table of fields.
+struct MarshalDescriptor {
+  const MarshalField* fields;
+  size_t field_count;
+  // For unions, the selector value of each field. Selectors without a field
+  // marshal nothing. Null for structures.
+  const uint32_t* selectors;
+  // True for a TPM2B which holds a structure rather than bytes. Its size field
+  // is computed from the serialized structure instead of being read from the
+  // value.
+  bool is_sized_structure;
+};
+
+// Serializes the structure at |value| described by |descriptor| and appends it
+// to |buffer|.
+TRUNKS_EXPORT TPM_RC SerializeWithDescriptor(
+    const MarshalDescriptor& descriptor,
+    const void* value,
+    std::string* buffer);
+
+// Parses a structure described by |descriptor| from |cursor| into |value|.
+TRUNKS_EXPORT TPM_RC ParseWithDescriptor(const MarshalDescriptor& descriptor,
+                                         ParseCursor* cursor,
+                                         void* value);
+
+// Like the functions above, for the member of a union chosen by |selector|.
+TRUNKS_EXPORT TPM_RC SerializeUnionWithDescriptor(
+    const MarshalDescriptor& descriptor,
+    uint32_t selector,
+    const void* value,
+    std::string* buffer);
+TRUNKS_EXPORT TPM_RC ParseUnionWithDescriptor(
+    const MarshalDescriptor& descriptor,
+    uint32_t selector,
+    ParseCursor* cursor,
+    void* value);
+
+}  // namespace trunks
+
+#endif  // TRUNKS_TPM_MARSHAL_H_
@@ -0,0 +1,209 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/tpm_marshal.h"
+
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+namespace trunks {
+
+namespace {
+
+// Hand-written descriptors of the kind generator.py --table_driven emits.
+const MarshalField kPcrSelectionFields[] = {
+    {MarshalField::kInteger, 2, -1, offsetof(TPMS_PCR_SELECTION, hash), 0, 0,
+     nullptr},
+    {MarshalField::kInteger, 1, -1,
+     offsetof(TPMS_PCR_SELECTION, sizeof_select), 0, 0, nullptr},
+    {MarshalField::kByteArray, 0, 1, offsetof(TPMS_PCR_SELECTION, pcr_select),
+     0, PCR_SELECT_MAX, nullptr},
+};
+const MarshalDescriptor kPcrSelectionDescriptor = {
+    kPcrSelectionFields, arraysize(kPcrSelectionFields), nullptr, false};
+
+const MarshalField kPcrSelectionListFields[] = {
+    {MarshalField::kInteger, 4, -1, offsetof(TPML_PCR_SELECTION, count), 0, 0,
+     nullptr},
+    {MarshalField::kArray, 0, 0, offsetof(TPML_PCR_SELECTION, pcr_selections),
+     sizeof(TPMS_PCR_SELECTION), HASH_COUNT, &kPcrSelectionDescriptor},
+};
+const MarshalDescriptor kPcrSelectionListDescriptor = {
+    kPcrSelectionListFields, arraysize(kPcrSelectionListFields), nullptr,
+    false};
+
+const MarshalField kHaFields[] = {
+    {MarshalField::kByteArray, 0, -1, offsetof(TPMU_HA, sha1), 0,
+     SHA1_DIGEST_SIZE, nullptr},
+    {MarshalField::kByteArray, 0, -1, offsetof(TPMU_HA, sha256), 0,
+     SHA256_DIGEST_SIZE, nullptr},
+};
+const uint32_t kHaSelectors[] = {
+    TPM_ALG_SHA1, TPM_ALG_SHA256,
+};
+const MarshalDescriptor kHaDescriptor = {kHaFields, arraysize(kHaFields),
+                                         kHaSelectors, false};
+
+const MarshalField kTaggedHaFields[] = {
+    {MarshalField::kInteger, 2, -1, offsetof(TPMT_HA, hash_alg), 0, 0,
+     nullptr},
+    {MarshalField::kUnion, 0, 0, offsetof(TPMT_HA, digest), 0, 0,
+     &kHaDescriptor},
+};
+const MarshalDescriptor kTaggedHaDescriptor = {
+    kTaggedHaFields, arraysize(kTaggedHaFields), nullptr, false};
+
+const MarshalField kEccParameterFields[] = {
+    {MarshalField::kInteger, 2, -1, offsetof(TPM2B_ECC_PARAMETER, size), 0, 0,
+     nullptr},
+    {MarshalField::kByteArray, 0, 0, offsetof(TPM2B_ECC_PARAMETER, buffer), 0,
+     MAX_ECC_KEY_BYTES, nullptr},
+};
+const MarshalDescriptor kEccParameterDescriptor = {
+    kEccParameterFields, arraysize(kEccParameterFields), nullptr, false};
+
+const MarshalField kEccPointFields[] = {
+    {MarshalField::kStructure, 0, -1, offsetof(TPMS_ECC_POINT, x), 0, 0,
+     &kEccParameterDescriptor},
+    {MarshalField::kStructure, 0, -1, offsetof(TPMS_ECC_POINT, y), 0, 0,
+     &kEccParameterDescriptor},
+};
+const MarshalDescriptor kEccPointDescriptor = {
+    kEccPointFields, arraysize(kEccPointFields), nullptr, false};
+
+const MarshalField kSizedEccPointFields[] = {
+    {MarshalField::kInteger, 2, -1, offsetof(TPM2B_ECC_POINT, size), 0, 0,
+     nullptr},
+    {MarshalField::kStructure, 0, -1, offsetof(TPM2B_ECC_POINT, point), 0, 0,
+     &kEccPointDescriptor},
+};
+const MarshalDescriptor kSizedEccPointDescriptor = {
+    kSizedEccPointFields, arraysize(kSizedEccPointFields), nullptr, true};
+
+TPML_PCR_SELECTION MakePcrSelectionList() {
+  TPML_PCR_SELECTION list;
+  memset(&list, 0, sizeof(list));
+  list.count = 2;
+  list.pcr_selections[0].hash = TPM_ALG_SHA1;
+  list.pcr_selections[0].sizeof_select = 3;
+  list.pcr_selections[0].pcr_select[0] = 0x81;
+  list.pcr_selections[1].hash = TPM_ALG_SHA256;
+  list.pcr_selections[1].sizeof_select = 1;
+  list.pcr_selections[1].pcr_select[0] = 0x7f;
+  return list;
+}
+
+}  // namespace
+
+// The descriptors must produce the same bytes as the unrolled functions.
+TEST(TpmMarshalTest, ArraysMatchUnrolledCode) {
+  TPML_PCR_SELECTION list = MakePcrSelectionList();
+  std::string expected;
+  ASSERT_EQ(TPM_RC_SUCCESS, Serialize_TPML_PCR_SELECTION(list, &expected));
+  std::string serialized;
+  ASSERT_EQ(TPM_RC_SUCCESS, SerializeWithDescriptor(kPcrSelectionListDescriptor,
+                                                    &list, &serialized));
+  EXPECT_EQ(expected, serialized);
+
+  TPML_PCR_SELECTION parsed;
+  memset(&parsed, 0, sizeof(parsed));
+  ParseCursor cursor(serialized);
+  ASSERT_EQ(TPM_RC_SUCCESS,
+            ParseWithDescriptor(kPcrSelectionListDescriptor, &cursor, &parsed));
+  EXPECT_EQ(0u, cursor.remaining());
+  EXPECT_EQ(0, memcmp(&list, &parsed, sizeof(list)));
+}
+
+TEST(TpmMarshalTest, UnionsMatchUnrolledCode) {
+  TPMT_HA digest;
+  memset(&digest, 0, sizeof(digest));
+  digest.hash_alg = TPM_ALG_SHA256;
+  memset(digest.digest.sha256, 'a', SHA256_DIGEST_SIZE);
+  std::string expected;
+  ASSERT_EQ(TPM_RC_SUCCESS, Serialize_TPMT_HA(digest, &expected));
+  std::string serialized;
+  ASSERT_EQ(TPM_RC_SUCCESS,
+            SerializeWithDescriptor(kTaggedHaDescriptor, &digest, &serialized));
+  EXPECT_EQ(expected, serialized);
+  EXPECT_EQ(2u + SHA256_DIGEST_SIZE, serialized.size());
+
+  TPMT_HA parsed;
+  memset(&parsed, 0, sizeof(parsed));
+  ParseCursor cursor(serialized);
+  ASSERT_EQ(TPM_RC_SUCCESS,
+            ParseWithDescriptor(kTaggedHaDescriptor, &cursor, &parsed));
+  EXPECT_EQ(0, memcmp(&digest, &parsed, sizeof(digest)));
+
+  // A selector without a member only marshals the selector.
+  digest.hash_alg = TPM_ALG_NULL;
+  serialized.clear();
+  ASSERT_EQ(TPM_RC_SUCCESS,
+            SerializeWithDescriptor(kTaggedHaDescriptor, &digest, &serialized));
+  EXPECT_EQ(std::string("\x00\x10", 2), serialized);
+}
+
+TEST(TpmMarshalTest, SizedStructureMatchesUnrolledCode) {
+  TPMS_ECC_POINT point;
+  memset(&point, 0, sizeof(point));
+  point.x = Make_TPM2B_ECC_PARAMETER("x_coordinate");
+  point.y = Make_TPM2B_ECC_PARAMETER("y");
+  // The size is computed when serializing, so the size field is ignored.
+  TPM2B_ECC_POINT sized_point = Make_TPM2B_ECC_POINT(point);
+  sized_point.size = 0;
+  std::string expected;
+  ASSERT_EQ(TPM_RC_SUCCESS, Serialize_TPM2B_ECC_POINT(sized_point, &expected));
+  std::string serialized;
+  ASSERT_EQ(TPM_RC_SUCCESS, SerializeWithDescriptor(kSizedEccPointDescriptor,
+                                                    &sized_point, &serialized));
+  EXPECT_EQ(expected, serialized);
+  EXPECT_EQ(std::string("\x00\x11", 2), serialized.substr(0, 2));
+}
+
+TEST(TpmMarshalTest, RejectsCountsAboveCapacity) {
+  TPML_PCR_SELECTION list = MakePcrSelectionList();
+  list.pcr_selections[1].sizeof_select = PCR_SELECT_MAX + 1;
+  std::string serialized;
+  EXPECT_EQ(TPM_RC_INSUFFICIENT,
+            SerializeWithDescriptor(kPcrSelectionListDescriptor, &list,
+                                    &serialized));
+  list.count = HASH_COUNT + 1;
+  serialized.clear();
+  EXPECT_EQ(TPM_RC_INSUFFICIENT,
+            SerializeWithDescriptor(kPcrSelectionListDescriptor, &list,
+                                    &serialized));
+
+  // A list which claims more selections than it can hold.
+  std::string too_many("\x00\x00\x00\x04", 4);
+  ParseCursor cursor(too_many);
+  EXPECT_EQ(TPM_RC_INSUFFICIENT,
+            ParseWithDescriptor(kPcrSelectionListDescriptor, &cursor, &list));
+}
+
+TEST(TpmMarshalTest, RejectsTruncatedInput) {
+  TPML_PCR_SELECTION list = MakePcrSelectionList();
+  std::string serialized;
+  ASSERT_EQ(TPM_RC_SUCCESS, SerializeWithDescriptor(kPcrSelectionListDescriptor,
+                                                    &list, &serialized));
+  for (size_t size = 0; size < serialized.size(); ++size) {
+    ParseCursor cursor(serialized.data(), size);
+    EXPECT_EQ(TPM_RC_INSUFFICIENT,
+              ParseWithDescriptor(kPcrSelectionListDescriptor, &cursor, &list))
+        << size;
+  }
+}
+
+}  // namespace trunks
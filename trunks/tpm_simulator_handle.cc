@@ -34,16 +34,26 @@ extern "C" {
 
 #include "trunks/error_codes.h"
 
+namespace {
+
+const char kDefaultDataDirectory[] = "/data/misc/trunksd";
+
+}  // namespace
+
 namespace trunks {
 
-TpmSimulatorHandle::TpmSimulatorHandle() {}
+TpmSimulatorHandle::TpmSimulatorHandle()
+    : TpmSimulatorHandle(kDefaultDataDirectory) {}
+
+TpmSimulatorHandle::TpmSimulatorHandle(const std::string& data_directory)
+    : data_directory_(data_directory) {}
 
 TpmSimulatorHandle::~TpmSimulatorHandle() {}
 
 bool TpmSimulatorHandle::Init() {
 #if defined(USE_SIMULATOR)
   // Initialize TPM.
-  CHECK_EQ(chdir("/data/misc/trunksd"), 0);
+  CHECK_EQ(chdir(data_directory_.c_str()), 0);
   TPM_Manufacture(TRUE);
   _plat__SetNvAvail();
   _plat__Signal_PowerOn();
@@ -38,6 +38,9 @@ namespace trunks {
 class TpmSimulatorHandle : public CommandTransceiver {
  public:
   TpmSimulatorHandle();
+  // Keeps simulator state, e.g. NV data, in |data_directory|. The simulator
+  // uses global state so only one instance may be initialized per process.
+  explicit TpmSimulatorHandle(const std::string& data_directory);
   ~TpmSimulatorHandle() override;
 
   // Initializes a TpmSimulatorHandle instance. This method must be called
@@ -50,6 +53,7 @@ class TpmSimulatorHandle : public CommandTransceiver {
   std::string SendCommandAndWait(const std::string& command) override;
 
  private:
+  std::string data_directory_;
   std::vector<unsigned char> command_buffer;
   DISALLOW_COPY_AND_ASSIGN(TpmSimulatorHandle);
 };
@@ -0,0 +1,285 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/tpm_simulator_pool.h"
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <base/bind.h>
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/logging.h>
+#include <base/memory/ptr_util.h>
+#include <base/posix/eintr_wrapper.h>
+#include <base/stl_util.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/synchronization/lock.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/tpm_simulator_handle.h"
+
+namespace {
+
+// Commands and responses are limited to the TPM buffer size.
+const uint32_t kMaxFrameSize = 4096;
+
+// Writes a size-prefixed |data| frame to a socket. Uses send() so a child
+// which has exited results in an error rather than SIGPIPE.
+bool WriteFrame(int fd, const std::string& data) {
+  uint32_t size = data.size();
+  std::string frame(reinterpret_cast<const char*>(&size), sizeof(size));
+  frame.append(data);
+  size_t sent = 0;
+  while (sent < frame.size()) {
+    ssize_t result = HANDLE_EINTR(
+        send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL));
+    if (result <= 0) {
+      return false;
+    }
+    sent += result;
+  }
+  return true;
+}
+
+// Reads a frame written by WriteFrame into |data|.
+bool ReadFrame(int fd, std::string* data) {
+  uint32_t size = 0;
+  if (!base::ReadFromFD(fd, reinterpret_cast<char*>(&size), sizeof(size)) ||
+      size > kMaxFrameSize) {
+    return false;
+  }
+  data->resize(size);
+  return size == 0 || base::ReadFromFD(fd, string_as_array(data), size);
+}
+
+std::unique_ptr<trunks::CommandTransceiver> CreateSimulator(
+    const std::string& data_directory,
+    size_t index) {
+  base::FilePath path =
+      base::FilePath(data_directory).Append(base::SizeTToString(index));
+  if (!base::CreateDirectory(path)) {
+    LOG(ERROR) << "Failed to create simulator directory: " << path.value();
+    return nullptr;
+  }
+  return base::MakeUnique<trunks::TpmSimulatorHandle>(path.value());
+}
+
+// Forks a worker which serves commands from the parent on |fd| with a copy of
+// |transceiver| until the parent closes the socket. Returns the worker's pid,
+// or -1 on failure.
+pid_t StartWorker(int fd, trunks::CommandTransceiver* transceiver) {
+  pid_t pid = fork();
+  if (pid != 0) {
+    PLOG_IF(ERROR, pid < 0) << "Failed to fork simulator worker.";
+    return pid;
+  }
+  // An empty frame tells the parent this instance is ready.
+  std::string command;
+  if (!WriteFrame(fd, command)) {
+    _exit(1);
+  }
+  while (ReadFrame(fd, &command)) {
+    if (!WriteFrame(fd, transceiver->SendCommandAndWait(command))) {
+      break;
+    }
+  }
+  _exit(0);
+}
+
+void StopWorker(pid_t pid) {
+  kill(pid, SIGKILL);
+  HANDLE_EINTR(waitpid(pid, nullptr, 0));
+}
+
+// Initializes and provisions an instance and keeps it as a template for
+// workers, starting a new one for each reset requested by the parent on
+// |control_fd|. Runs in the child process and never returns.
+void RunInstance(int fd,
+                 int control_fd,
+                 const trunks::TpmSimulatorPool::InstanceFactory& factory,
+                 const trunks::TpmSimulatorPool::Provisioner& provisioner,
+                 size_t index) {
+  std::unique_ptr<trunks::CommandTransceiver> transceiver = factory.Run(index);
+  if (!transceiver || !transceiver->Init()) {
+    LOG(ERROR) << "Failed to initialize simulator instance " << index;
+    _exit(1);
+  }
+  if (!provisioner.is_null() && !provisioner.Run(transceiver.get())) {
+    LOG(ERROR) << "Failed to provision simulator instance " << index;
+    _exit(1);
+  }
+  pid_t worker = StartWorker(fd, transceiver.get());
+  if (worker < 0) {
+    _exit(1);
+  }
+  // Every frame on |control_fd| asks for a reset; an empty one acknowledges
+  // it. The new worker reports ready on |fd| as the first one did.
+  std::string request;
+  while (ReadFrame(control_fd, &request)) {
+    StopWorker(worker);
+    worker = StartWorker(fd, transceiver.get());
+    if (worker < 0) {
+      _exit(1);
+    }
+    if (!WriteFrame(control_fd, std::string())) {
+      break;
+    }
+  }
+  StopWorker(worker);
+  _exit(0);
+}
+
+}  // namespace
+
+namespace trunks {
+
+// The parent end of a connection to one child process.
+class TpmSimulatorPool::Instance : public CommandTransceiver {
+ public:
+  Instance(pid_t pid, int fd, int control_fd)
+      : pid_(pid), fd_(fd), control_fd_(control_fd) {}
+  ~Instance() override {
+    // The child stops its worker and exits once it sees the sockets close.
+    IGNORE_EINTR(close(fd_));
+    IGNORE_EINTR(close(control_fd_));
+    HANDLE_EINTR(waitpid(pid_, nullptr, 0));
+  }
+
+  // Waits for the child to report that it is initialized.
+  bool WaitUntilReady() {
+    std::string ready;
+    return ReadFrame(fd_, &ready) && ready.empty();
+  }
+
+  // Has the child replace its worker with one forked from the provisioned
+  // state, then waits for the new worker.
+  bool Reset() {
+    base::AutoLock lock(lock_);
+    std::string ack;
+    if (!WriteFrame(control_fd_, std::string()) ||
+        !ReadFrame(control_fd_, &ack) || !WaitUntilReady()) {
+      LOG(ERROR) << "Simulator process " << pid_ << " failed to reset.";
+      return false;
+    }
+    return true;
+  }
+
+  int fd() const { return fd_; }
+  int control_fd() const { return control_fd_; }
+
+  // CommandTransceiver methods.
+  bool Init() override { return true; }
+  void SendCommand(const std::string& command,
+                   const ResponseCallback& callback) override {
+    callback.Run(SendCommandAndWait(command));
+  }
+  std::string SendCommandAndWait(const std::string& command) override {
+    base::AutoLock lock(lock_);
+    std::string response;
+    if (!WriteFrame(fd_, command) || !ReadFrame(fd_, &response)) {
+      LOG(ERROR) << "Simulator process " << pid_ << " is not responding.";
+      return CreateErrorResponse(TCTI_RC_GENERAL_FAILURE);
+    }
+    return response;
+  }
+
+ private:
+  pid_t pid_;
+  int fd_;
+  int control_fd_;
+  // Keeps command and response frames from concurrent callers in order.
+  base::Lock lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(Instance);
+};
+
+TpmSimulatorPool::TpmSimulatorPool(size_t num_instances,
+                                   const std::string& data_directory)
+    : TpmSimulatorPool(num_instances,
+                       base::Bind(&CreateSimulator, data_directory)) {}
+
+TpmSimulatorPool::TpmSimulatorPool(size_t num_instances,
+                                   const InstanceFactory& factory)
+    : num_instances_(num_instances), factory_(factory) {}
+
+TpmSimulatorPool::~TpmSimulatorPool() {}
+
+bool TpmSimulatorPool::Init() {
+  if (!instances_.empty()) {
+    return true;
+  }
+  for (size_t i = 0; i < num_instances_; ++i) {
+    int fds[2];
+    int control_fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+      PLOG(ERROR) << "Failed to create simulator socket.";
+      instances_.clear();
+      return false;
+    }
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, control_fds) != 0) {
+      PLOG(ERROR) << "Failed to create simulator socket.";
+      IGNORE_EINTR(close(fds[0]));
+      IGNORE_EINTR(close(fds[1]));
+      instances_.clear();
+      return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+      PLOG(ERROR) << "Failed to fork simulator process.";
+      for (int fd : {fds[0], fds[1], control_fds[0], control_fds[1]}) {
+        IGNORE_EINTR(close(fd));
+      }
+      instances_.clear();
+      return false;
+    }
+    if (pid == 0) {
+      IGNORE_EINTR(close(fds[0]));
+      IGNORE_EINTR(close(control_fds[0]));
+      for (const auto& instance : instances_) {
+        IGNORE_EINTR(close(instance->fd()));
+        IGNORE_EINTR(close(instance->control_fd()));
+      }
+      RunInstance(fds[1], control_fds[1], factory_, provisioner_, i);
+    }
+    IGNORE_EINTR(close(fds[1]));
+    IGNORE_EINTR(close(control_fds[1]));
+    instances_.emplace_back(new Instance(pid, fds[0], control_fds[0]));
+  }
+  // All children initialize concurrently; only now wait for them.
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    if (!instances_[i]->WaitUntilReady()) {
+      LOG(ERROR) << "Simulator instance " << i << " failed to start.";
+      instances_.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+CommandTransceiver* TpmSimulatorPool::GetInstance(size_t index) {
+  CHECK_LT(index, instances_.size());
+  return instances_[index].get();
+}
+
+bool TpmSimulatorPool::ResetInstance(size_t index) {
+  CHECK_LT(index, instances_.size());
+  return instances_[index]->Reset();
+}
+
+}  // namespace trunks
@@ -0,0 +1,113 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TRUNKS_TPM_SIMULATOR_POOL_H_
+#define TRUNKS_TPM_SIMULATOR_POOL_H_
+
+#include <sys/types.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/callback.h>
+#include <base/macros.h>
+
+#include "trunks/command_transceiver.h"
+
+namespace trunks {
+
+// Runs a number of independent software TPMs, each in its own child process,
+// and exposes each one as a CommandTransceiver. The simulator keeps its state
+// in globals so a process can only host one; with a pool, tests which need a
+// fresh TPM can run in parallel, each with a TrunksFactoryImpl wrapping its
+// own instance. Every instance keeps its NV data in a separate subdirectory.
+//
+// Each child initializes its instance, runs the provisioner if one is set and
+// then forks a worker process which serves commands. ResetInstance() replaces
+// the worker with a new fork, which starts over with the simulator NV and
+// volatile state as they were after provisioning. That takes about as long as
+// a fork, rather than the seconds a TPM2_Startup, ownership and key creation
+// take in the simulator.
+//
+// Init() forks, so it must be called before any threads are started.
+//
+// Example:
+//   TpmSimulatorPool pool(4, "/tmp/simulators");
+//   pool.set_provisioner(base::Bind(&StartupAndTakeOwnership));
+//   if (!pool.Init()) {...}
+//   TrunksFactoryImpl factory(pool.GetInstance(i));
+//   factory.Initialize();
+//   ...
+//   pool.ResetInstance(i);
+class TpmSimulatorPool {
+ public:
+  // Creates the transceiver to run in the child process for a given instance
+  // |index|. The transceiver will be initialized in the child.
+  using InstanceFactory =
+      base::Callback<std::unique_ptr<CommandTransceiver>(size_t index)>;
+
+  // Brings an initialized |transceiver| to the state every test should start
+  // from, e.g. by sending TPM2_Startup and taking ownership. Runs in the child
+  // process, which later forks, so it must not leave threads running. Returns
+  // true on success.
+  using Provisioner = base::Callback<bool(CommandTransceiver* transceiver)>;
+
+  // Runs |num_instances| TpmSimulatorHandle instances, instance i keeping its
+  // state in |data_directory|/i.
+  TpmSimulatorPool(size_t num_instances, const std::string& data_directory);
+  // Runs |num_instances| transceivers created by |factory|. Useful for
+  // testing.
+  TpmSimulatorPool(size_t num_instances, const InstanceFactory& factory);
+  // Closes every instance and waits for the child processes to exit.
+  ~TpmSimulatorPool();
+
+  // Sets a |provisioner| for Init() to run on every instance. Must be called
+  // before Init().
+  void set_provisioner(const Provisioner& provisioner) {
+    provisioner_ = provisioner;
+  }
+
+  // Starts a child process for each instance. Returns true on success.
+  bool Init();
+
+  // Returns the number of instances in the pool.
+  size_t size() const { return instances_.size(); }
+
+  // Returns the transceiver for the instance at |index|. The pool retains
+  // ownership. Each returned transceiver is thread-safe but commands sent to
+  // one instance are serialized.
+  CommandTransceiver* GetInstance(size_t index);
+
+  // Restores the instance at |index| to its state right after initialization
+  // and provisioning. The instance's transceiver stays valid. Returns true on
+  // success.
+  bool ResetInstance(size_t index);
+
+ private:
+  class Instance;
+
+  size_t num_instances_;
+  InstanceFactory factory_;
+  Provisioner provisioner_;
+  std::vector<std::unique_ptr<Instance>> instances_;
+
+  DISALLOW_COPY_AND_ASSIGN(TpmSimulatorPool);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_TPM_SIMULATOR_POOL_H_
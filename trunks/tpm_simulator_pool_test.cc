@@ -0,0 +1,126 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/tpm_simulator_pool.h"
+
+#include <base/bind.h>
+#include <base/memory/ptr_util.h>
+#include <base/strings/string_number_conversions.h>
+#include <gtest/gtest.h>
+
+#include "trunks/error_codes.h"
+
+namespace {
+
+// Tags every response with the index of the instance which handled it.
+class FakeInstance : public trunks::CommandTransceiver {
+ public:
+  FakeInstance(size_t index, bool init_result)
+      : index_(index), init_result_(init_result) {}
+  ~FakeInstance() override {}
+
+  bool Init() override { return init_result_; }
+  void SendCommand(const std::string& command,
+                   const ResponseCallback& callback) override {
+    callback.Run(SendCommandAndWait(command));
+  }
+  std::string SendCommandAndWait(const std::string& command) override {
+    return base::SizeTToString(index_) + ":" + command;
+  }
+
+ private:
+  size_t index_;
+  bool init_result_;
+};
+
+std::unique_ptr<trunks::CommandTransceiver> CreateFakeInstance(
+    bool init_result,
+    size_t index) {
+  return base::MakeUnique<FakeInstance>(index, init_result);
+}
+
+// Responds with every command it has seen so far.
+class StatefulInstance : public trunks::CommandTransceiver {
+ public:
+  StatefulInstance() {}
+  ~StatefulInstance() override {}
+
+  bool Init() override { return true; }
+  void SendCommand(const std::string& command,
+                   const ResponseCallback& callback) override {
+    callback.Run(SendCommandAndWait(command));
+  }
+  std::string SendCommandAndWait(const std::string& command) override {
+    history_ += command;
+    return history_;
+  }
+
+ private:
+  std::string history_;
+};
+
+std::unique_ptr<trunks::CommandTransceiver> CreateStatefulInstance(
+    size_t index) {
+  return base::MakeUnique<StatefulInstance>();
+}
+
+bool Provision(bool result, trunks::CommandTransceiver* transceiver) {
+  transceiver->SendCommandAndWait("p;");
+  return result;
+}
+
+}  // namespace
+
+namespace trunks {
+
+TEST(TpmSimulatorPoolTest, InstancesAreIndependent) {
+  TpmSimulatorPool pool(3, base::Bind(&CreateFakeInstance, true));
+  ASSERT_TRUE(pool.Init());
+  ASSERT_EQ(3u, pool.size());
+  EXPECT_EQ("2:command", pool.GetInstance(2)->SendCommandAndWait("command"));
+  EXPECT_EQ("0:command", pool.GetInstance(0)->SendCommandAndWait("command"));
+  EXPECT_EQ("1:", pool.GetInstance(1)->SendCommandAndWait(""));
+}
+
+TEST(TpmSimulatorPoolTest, InitFailure) {
+  TpmSimulatorPool pool(2, base::Bind(&CreateFakeInstance, false));
+  EXPECT_FALSE(pool.Init());
+  EXPECT_EQ(0u, pool.size());
+}
+
+TEST(TpmSimulatorPoolTest, ResetInstance) {
+  TpmSimulatorPool pool(2, base::Bind(&CreateStatefulInstance));
+  pool.set_provisioner(base::Bind(&Provision, true));
+  ASSERT_TRUE(pool.Init());
+  CommandTransceiver* instance = pool.GetInstance(0);
+  EXPECT_EQ("p;a;", instance->SendCommandAndWait("a;"));
+  EXPECT_EQ("p;a;b;", instance->SendCommandAndWait("b;"));
+  EXPECT_EQ("p;c;", pool.GetInstance(1)->SendCommandAndWait("c;"));
+  ASSERT_TRUE(pool.ResetInstance(0));
+  EXPECT_EQ("p;d;", instance->SendCommandAndWait("d;"));
+  ASSERT_TRUE(pool.ResetInstance(0));
+  EXPECT_EQ("p;e;", instance->SendCommandAndWait("e;"));
+  EXPECT_EQ("p;c;f;", pool.GetInstance(1)->SendCommandAndWait("f;"));
+}
+
+TEST(TpmSimulatorPoolTest, ProvisionFailure) {
+  TpmSimulatorPool pool(2, base::Bind(&CreateStatefulInstance));
+  pool.set_provisioner(base::Bind(&Provision, false));
+  EXPECT_FALSE(pool.Init());
+  EXPECT_EQ(0u, pool.size());
+}
+
+}  // namespace trunks
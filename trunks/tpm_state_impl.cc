@@ -20,6 +20,7 @@
 #include <brillo/bind_lambda.h>
 
 #include "trunks/error_codes.h"
+#include "trunks/interface.pb.h"
 #include "trunks/tpm_generated.h"
 #include "trunks/trunks_factory.h"
 
@@ -41,10 +42,85 @@ const trunks::TPMA_STARTUP_CLEAR kOrderlyShutdownMask = 1U << 31;
 
 namespace trunks {
 
-TpmStateImpl::TpmStateImpl(const TrunksFactory& factory) : factory_(factory) {}
+bool TpmPropertyCache::GetFixedProperties(
+    std::map<TPM_PT, uint32_t>* properties) {
+  base::AutoLock lock(lock_);
+  if (!has_fixed_properties_) {
+    return false;
+  }
+  *properties = fixed_properties_;
+  return true;
+}
+
+void TpmPropertyCache::SetFixedProperties(
+    const std::map<TPM_PT, uint32_t>& properties) {
+  base::AutoLock lock(lock_);
+  fixed_properties_ = properties;
+  has_fixed_properties_ = true;
+}
+
+bool TpmPropertyCache::GetAlgorithmProperties(
+    std::map<TPM_ALG_ID, TPMA_ALGORITHM>* properties) {
+  base::AutoLock lock(lock_);
+  if (!has_algorithm_properties_) {
+    return false;
+  }
+  *properties = algorithm_properties_;
+  return true;
+}
+
+void TpmPropertyCache::SetAlgorithmProperties(
+    const std::map<TPM_ALG_ID, TPMA_ALGORITHM>& properties) {
+  base::AutoLock lock(lock_);
+  algorithm_properties_ = properties;
+  has_algorithm_properties_ = true;
+}
+
+bool TpmPropertyCache::ExportSnapshot(CapabilitySnapshot* snapshot) {
+  base::AutoLock lock(lock_);
+  if (!has_fixed_properties_ || !has_algorithm_properties_) {
+    return false;
+  }
+  snapshot->Clear();
+  for (const auto& property : fixed_properties_) {
+    TpmPropertyValue* value = snapshot->add_fixed_properties();
+    value->set_property(property.first);
+    value->set_value(property.second);
+  }
+  for (const auto& algorithm : algorithm_properties_) {
+    AlgorithmPropertyValue* value = snapshot->add_algorithm_properties();
+    value->set_algorithm(algorithm.first);
+    value->set_properties(algorithm.second);
+  }
+  return true;
+}
+
+void TpmPropertyCache::ImportSnapshot(const CapabilitySnapshot& snapshot) {
+  std::map<TPM_PT, uint32_t> fixed_properties;
+  for (const auto& value : snapshot.fixed_properties()) {
+    fixed_properties[value.property()] = value.value();
+  }
+  std::map<TPM_ALG_ID, TPMA_ALGORITHM> algorithm_properties;
+  for (const auto& value : snapshot.algorithm_properties()) {
+    algorithm_properties[value.algorithm()] = value.properties();
+  }
+  SetFixedProperties(fixed_properties);
+  SetAlgorithmProperties(algorithm_properties);
+}
+
+TpmStateImpl::TpmStateImpl(const TrunksFactory& factory)
+    : factory_(factory),
+      own_property_cache_(new TpmPropertyCache()),
+      property_cache_(own_property_cache_.get()) {}
+
+TpmStateImpl::TpmStateImpl(const TrunksFactory& factory,
+                           TpmPropertyCache* property_cache)
+    : factory_(factory), property_cache_(property_cache) {
+  CHECK(property_cache_);
+}
 
 TPM_RC TpmStateImpl::Initialize() {
-  TPM_RC result = CacheTpmProperties();
+  TPM_RC result = QueryTpmProperties(PT_VAR, &tpm_properties_);
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << "Failed to query TPM properties: " << GetErrorString(result);
     return result;
@@ -54,12 +130,6 @@ TPM_RC TpmStateImpl::Initialize() {
     LOG(ERROR) << "Required properties missing!";
     return TRUNKS_RC_INVALID_TPM_CONFIGURATION;
   }
-
-  result = CacheAlgorithmProperties();
-  if (result != TPM_RC_SUCCESS) {
-    LOG(ERROR) << "Failed to query TPM algorithms: " << GetErrorString(result);
-    return result;
-  }
   initialized_ = true;
   return TPM_RC_SUCCESS;
 }
@@ -123,13 +193,11 @@ bool TpmStateImpl::WasShutdownOrderly() {
 }
 
 bool TpmStateImpl::IsRSASupported() {
-  CHECK(initialized_);
-  return (algorithm_properties_.count(TPM_ALG_RSA) > 0);
+  return GetAlgorithmProperties(TPM_ALG_RSA, nullptr);
 }
 
 bool TpmStateImpl::IsECCSupported() {
-  CHECK(initialized_);
-  return (algorithm_properties_.count(TPM_ALG_ECC) > 0);
+  return GetAlgorithmProperties(TPM_ALG_ECC, nullptr);
 }
 
 uint32_t TpmStateImpl::GetLockoutCounter() {
@@ -168,11 +236,19 @@ uint32_t TpmStateImpl::GetMaxNVSize() {
 
 bool TpmStateImpl::GetTpmProperty(TPM_PT property, uint32_t* value) {
   CHECK(initialized_);
-  if (tpm_properties_.count(property) == 0) {
+  std::map<TPM_PT, uint32_t>* properties = &tpm_properties_;
+  if (property >= PT_FIXED && property < PT_VAR) {
+    if (!LoadFixedProperties()) {
+      return false;
+    }
+    properties = &fixed_properties_;
+  }
+  auto it = properties->find(property);
+  if (it == properties->end()) {
     return false;
   }
   if (value) {
-    *value = tpm_properties_[property];
+    *value = it->second;
   }
   return true;
 }
@@ -180,7 +256,8 @@ bool TpmStateImpl::GetTpmProperty(TPM_PT property, uint32_t* value) {
 bool TpmStateImpl::GetAlgorithmProperties(TPM_ALG_ID algorithm,
                                           TPMA_ALGORITHM* properties) {
   CHECK(initialized_);
-  if (algorithm_properties_.count(algorithm) == 0) {
+  if (!LoadAlgorithmProperties() ||
+      algorithm_properties_.count(algorithm) == 0) {
     return false;
   }
   if (properties) {
@@ -223,9 +300,12 @@ TPM_RC TpmStateImpl::GetCapability(const CapabilityCallback& callback,
   return TPM_RC_SUCCESS;
 }
 
-TPM_RC TpmStateImpl::CacheTpmProperties() {
+TPM_RC TpmStateImpl::QueryTpmProperties(
+    TPM_PT first_property,
+    std::map<TPM_PT, uint32_t>* properties) {
   CapabilityCallback callback = base::Bind(
-      [](TpmStateImpl* impl, const TPMU_CAPABILITIES& capability_data) {
+      [](std::map<TPM_PT, uint32_t>* properties,
+         const TPMU_CAPABILITIES& capability_data) {
         uint32_t next_property = 0;
         for (uint32_t i = 0;
              i < capability_data.tpm_properties.count && i < MAX_TPM_PROPERTIES;
@@ -234,41 +314,69 @@ TPM_RC TpmStateImpl::CacheTpmProperties() {
               capability_data.tpm_properties.tpm_property[i];
           VLOG(1) << "TPM Property 0x" << std::hex << property.property
                   << " = 0x" << property.value;
-          impl->tpm_properties_[property.property] = property.value;
+          (*properties)[property.property] = property.value;
           next_property = property.property + 1;
         }
         return next_property;
-      }, base::Unretained(this));
-  if (tpm_properties_.empty()) {
-    TPM_RC result = GetCapability(callback, TPM_CAP_TPM_PROPERTIES, PT_FIXED,
-                                  MAX_TPM_PROPERTIES);
+      }, base::Unretained(properties));
+  return GetCapability(callback, TPM_CAP_TPM_PROPERTIES, first_property,
+                       MAX_TPM_PROPERTIES);
+}
+
+bool TpmStateImpl::LoadFixedProperties() {
+  if (fixed_properties_loaded_) {
+    return true;
+  }
+  if (!property_cache_->GetFixedProperties(&fixed_properties_)) {
+    std::map<TPM_PT, uint32_t> properties;
+    TPM_RC result = QueryTpmProperties(PT_FIXED, &properties);
     if (result != TPM_RC_SUCCESS) {
-      return result;
+      LOG(ERROR) << "Failed to query fixed TPM properties: "
+                 << GetErrorString(result);
+      return false;
     }
+    // The TPM may continue into the PT_VAR group, whose values would go stale.
+    properties.erase(properties.lower_bound(PT_VAR), properties.end());
+    property_cache_->SetFixedProperties(properties);
+    fixed_properties_.swap(properties);
   }
-  return GetCapability(callback, TPM_CAP_TPM_PROPERTIES, PT_VAR,
-                       MAX_TPM_PROPERTIES);
+  fixed_properties_loaded_ = true;
+  return true;
 }
 
-TPM_RC TpmStateImpl::CacheAlgorithmProperties() {
-  CapabilityCallback callback = base::Bind(
-      [](TpmStateImpl* impl, const TPMU_CAPABILITIES& capability_data) {
-        uint32_t next_property = 0;
-        for (uint32_t i = 0;
-             i < capability_data.algorithms.count && i < MAX_CAP_ALGS; ++i) {
-          const TPMS_ALG_PROPERTY& property =
-              capability_data.algorithms.alg_properties[i];
-          VLOG(1) << "Algorithm Properties 0x" << std::hex << property.alg
-                  << " = 0x" << property.alg_properties;
-          impl->algorithm_properties_[property.alg] = property.alg_properties;
-          next_property = property.alg + 1;
-        }
-        return next_property;
-      }, base::Unretained(this));
-  if (algorithm_properties_.empty()) {
-    return GetCapability(callback, TPM_CAP_ALGS, TPM_ALG_FIRST, MAX_CAP_ALGS);
+bool TpmStateImpl::LoadAlgorithmProperties() {
+  if (algorithm_properties_loaded_) {
+    return true;
   }
-  return TPM_RC_SUCCESS;
+  if (!property_cache_->GetAlgorithmProperties(&algorithm_properties_)) {
+    std::map<TPM_ALG_ID, TPMA_ALGORITHM> properties;
+    CapabilityCallback callback = base::Bind(
+        [](std::map<TPM_ALG_ID, TPMA_ALGORITHM>* properties,
+           const TPMU_CAPABILITIES& capability_data) {
+          uint32_t next_property = 0;
+          for (uint32_t i = 0;
+               i < capability_data.algorithms.count && i < MAX_CAP_ALGS; ++i) {
+            const TPMS_ALG_PROPERTY& property =
+                capability_data.algorithms.alg_properties[i];
+            VLOG(1) << "Algorithm Properties 0x" << std::hex << property.alg
+                    << " = 0x" << property.alg_properties;
+            (*properties)[property.alg] = property.alg_properties;
+            next_property = property.alg + 1;
+          }
+          return next_property;
+        }, base::Unretained(&properties));
+    TPM_RC result =
+        GetCapability(callback, TPM_CAP_ALGS, TPM_ALG_FIRST, MAX_CAP_ALGS);
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << "Failed to query TPM algorithms: "
+                 << GetErrorString(result);
+      return false;
+    }
+    property_cache_->SetAlgorithmProperties(properties);
+    algorithm_properties_.swap(properties);
+  }
+  algorithm_properties_loaded_ = true;
+  return true;
 }
 
 }  // namespace trunks
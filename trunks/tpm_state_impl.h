@@ -20,21 +20,68 @@
 #include "trunks/tpm_state.h"
 
 #include <map>
+#include <memory>
 
 #include <base/callback.h>
 #include <base/macros.h>
+#include <base/synchronization/lock.h>
 
 #include "trunks/tpm_generated.h"
 #include "trunks/trunks_export.h"
 
 namespace trunks {
 
+class CapabilitySnapshot;
 class TrunksFactory;
 
+// Holds the TPM properties which do not change while the TPM is running: the
+// PT_FIXED group of TPM properties and the algorithm properties. They are
+// queried by the first TpmStateImpl which needs them and shared by every
+// TpmStateImpl that uses the same cache. This class is thread-safe.
+class TRUNKS_EXPORT TpmPropertyCache {
+ public:
+  TpmPropertyCache() = default;
+  ~TpmPropertyCache() = default;
+
+  // Copies the cached fixed properties to |properties|. Returns false if they
+  // have not been cached yet.
+  bool GetFixedProperties(std::map<TPM_PT, uint32_t>* properties);
+  void SetFixedProperties(const std::map<TPM_PT, uint32_t>& properties);
+
+  // Copies the cached algorithm properties to |properties|. Returns false if
+  // they have not been cached yet.
+  bool GetAlgorithmProperties(
+      std::map<TPM_ALG_ID, TPMA_ALGORITHM>* properties);
+  void SetAlgorithmProperties(
+      const std::map<TPM_ALG_ID, TPMA_ALGORITHM>& properties);
+
+  // Copies every cached property to |snapshot|, e.g. to hand them to another
+  // process. Returns false if the fixed or algorithm properties have not been
+  // cached yet.
+  bool ExportSnapshot(CapabilitySnapshot* snapshot);
+  // Caches the properties in a |snapshot| from ExportSnapshot.
+  void ImportSnapshot(const CapabilitySnapshot& snapshot);
+
+ private:
+  base::Lock lock_;
+  bool has_fixed_properties_ = false;
+  std::map<TPM_PT, uint32_t> fixed_properties_;
+  bool has_algorithm_properties_ = false;
+  std::map<TPM_ALG_ID, TPMA_ALGORITHM> algorithm_properties_;
+
+  DISALLOW_COPY_AND_ASSIGN(TpmPropertyCache);
+};
+
 // TpmStateImpl is the default implementation of the TpmState interface.
+// Initialize() only queries the PT_VAR group of TPM properties; fixed and
+// algorithm properties are queried on first use and kept in a
+// TpmPropertyCache.
 class TRUNKS_EXPORT TpmStateImpl : public TpmState {
  public:
   explicit TpmStateImpl(const TrunksFactory& factory);
+  // Uses |property_cache| instead of a cache private to this instance. The
+  // cache is not owned and must outlive this object.
+  TpmStateImpl(const TrunksFactory& factory, TpmPropertyCache* property_cache);
   ~TpmStateImpl() override = default;
 
   // TpmState methods.
@@ -70,14 +117,27 @@ class TRUNKS_EXPORT TpmStateImpl : public TpmState {
                        TPM_CAP capability,
                        uint32_t property,
                        uint32_t max_properties_per_call);
-  // Queries TPM properties and populates tpm_properties_.
-  TPM_RC CacheTpmProperties();
-  // Queries algorithm properties and populates algorithm_properties_.
-  TPM_RC CacheAlgorithmProperties();
+  // Queries the TPM properties of the group starting at |first_property| and
+  // stores them in |properties|.
+  TPM_RC QueryTpmProperties(TPM_PT first_property,
+                            std::map<TPM_PT, uint32_t>* properties);
+  // Populates fixed_properties_ from the cache or the TPM if needed. Returns
+  // false if the properties are not available.
+  bool LoadFixedProperties();
+  // Populates algorithm_properties_ from the cache or the TPM if needed.
+  // Returns false if the properties are not available.
+  bool LoadAlgorithmProperties();
 
   const TrunksFactory& factory_;
+  // Used when no shared cache is given to the constructor.
+  std::unique_ptr<TpmPropertyCache> own_property_cache_;
+  TpmPropertyCache* property_cache_;
   bool initialized_{false};
+  // The PT_VAR group, refreshed by every Initialize() call.
   std::map<TPM_PT, uint32_t> tpm_properties_;
+  bool fixed_properties_loaded_{false};
+  std::map<TPM_PT, uint32_t> fixed_properties_;
+  bool algorithm_properties_loaded_{false};
   std::map<TPM_ALG_ID, TPMA_ALGORITHM> algorithm_properties_;
 
   DISALLOW_COPY_AND_ASSIGN(TpmStateImpl);
@@ -17,6 +17,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "trunks/interface.pb.h"
 #include "trunks/mock_tpm.h"
 #include "trunks/tpm_generated.h"
 #include "trunks/tpm_state_impl.h"
@@ -362,4 +363,71 @@ TEST_F(TpmStateTest, InitFailOnFailedTPMCommand) {
   EXPECT_EQ(TPM_RC_FAILURE, tpm_state.Initialize());
 }
 
+TEST_F(TpmStateTest, FixedPropertiesQueriedOnFirstUse) {
+  TpmStateImpl tpm_state(factory_);
+  EXPECT_CALL(mock_tpm_,
+              GetCapabilitySync(TPM_CAP_TPM_PROPERTIES, PT_FIXED, _, _, _, _))
+      .Times(0);
+  EXPECT_CALL(mock_tpm_, GetCapabilitySync(TPM_CAP_ALGS, _, _, _, _, _))
+      .Times(0);
+  ASSERT_EQ(TPM_RC_SUCCESS, tpm_state.Initialize());
+  testing::Mock::VerifyAndClearExpectations(&mock_tpm_);
+  EXPECT_CALL(mock_tpm_, GetCapabilitySync(_, _, _, _, _, _))
+      .WillRepeatedly(Invoke(this, &TpmStateTest::FakeGetCapability));
+  EXPECT_CALL(mock_tpm_,
+              GetCapabilitySync(TPM_CAP_TPM_PROPERTIES, PT_FIXED, _, _, _, _))
+      .WillOnce(Invoke(this, &TpmStateTest::FakeGetCapability));
+  EXPECT_EQ(2048u, tpm_state.GetMaxNVSize());
+  EXPECT_EQ(2048u, tpm_state.GetMaxNVSize());
+}
+
+TEST_F(TpmStateTest, SharedCacheQueriesFixedPropertiesOnce) {
+  TpmPropertyCache cache;
+  EXPECT_CALL(mock_tpm_,
+              GetCapabilitySync(TPM_CAP_TPM_PROPERTIES, PT_FIXED, _, _, _, _))
+      .WillOnce(Invoke(this, &TpmStateTest::FakeGetCapability));
+  EXPECT_CALL(mock_tpm_,
+              GetCapabilitySync(TPM_CAP_ALGS, TPM_ALG_FIRST, _, _, _, _))
+      .WillOnce(Invoke(this, &TpmStateTest::FakeGetCapability));
+  {
+    TpmStateImpl tpm_state(factory_, &cache);
+    ASSERT_EQ(TPM_RC_SUCCESS, tpm_state.Initialize());
+    EXPECT_TRUE(tpm_state.IsRSASupported());
+    EXPECT_EQ(2048u, tpm_state.GetMaxNVSize());
+  }
+  // Volatile properties are still queried by every instance.
+  fake_tpm_properties_[TPM_PT_LOCKOUT_COUNTER] = 3;
+  TpmStateImpl tpm_state(factory_, &cache);
+  ASSERT_EQ(TPM_RC_SUCCESS, tpm_state.Initialize());
+  EXPECT_TRUE(tpm_state.IsECCSupported());
+  EXPECT_EQ(2048u, tpm_state.GetMaxNVSize());
+  EXPECT_EQ(3u, tpm_state.GetLockoutCounter());
+}
+
+TEST_F(TpmStateTest, ImportedSnapshotAvoidsQueries) {
+  TpmPropertyCache cache;
+  CapabilitySnapshot snapshot;
+  EXPECT_FALSE(cache.ExportSnapshot(&snapshot));
+  {
+    TpmStateImpl tpm_state(factory_, &cache);
+    ASSERT_EQ(TPM_RC_SUCCESS, tpm_state.Initialize());
+    EXPECT_TRUE(tpm_state.IsRSASupported());
+    EXPECT_EQ(2048u, tpm_state.GetMaxNVSize());
+  }
+  ASSERT_TRUE(cache.ExportSnapshot(&snapshot));
+  // A cache in another process imports the snapshot instead of querying.
+  TpmPropertyCache imported_cache;
+  imported_cache.ImportSnapshot(snapshot);
+  EXPECT_CALL(mock_tpm_,
+              GetCapabilitySync(TPM_CAP_TPM_PROPERTIES, PT_FIXED, _, _, _, _))
+      .Times(0);
+  EXPECT_CALL(mock_tpm_, GetCapabilitySync(TPM_CAP_ALGS, _, _, _, _, _))
+      .Times(0);
+  TpmStateImpl tpm_state(factory_, &imported_cache);
+  ASSERT_EQ(TPM_RC_SUCCESS, tpm_state.Initialize());
+  EXPECT_TRUE(tpm_state.IsRSASupported());
+  EXPECT_TRUE(tpm_state.IsECCSupported());
+  EXPECT_EQ(2048u, tpm_state.GetMaxNVSize());
+}
+
 }  // namespace trunks
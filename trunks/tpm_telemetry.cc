@@ -0,0 +1,202 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/tpm_telemetry.h"
+
+#include <map>
+
+#include <base/bind.h>
+#include <base/location.h>
+#include <base/logging.h>
+#include <base/threading/thread_task_runner_handle.h>
+
+#include "trunks/command_timeout_policy.h"
+#include "trunks/error_codes.h"
+#include "trunks/tpm_generated.h"
+
+namespace {
+
+// Returns the number of objects and sessions evicted for any reason.
+uint64_t CountEvictions(const trunks::ResourceManagerStats& stats) {
+  uint64_t evictions = 0;
+  for (const auto& eviction : stats.evictions()) {
+    evictions += eviction.objects() + eviction.sessions();
+  }
+  return evictions;
+}
+
+}  // namespace
+
+namespace trunks {
+
+const char TpmTelemetry::kTelemetryClient[] = "trunksd-telemetry";
+
+TpmTelemetry::TpmTelemetry(const ResourceManager* resource_manager,
+                           SchedulingCommandTransceiver* scheduler,
+                           CommandTransceiver* transceiver,
+                           size_t capacity)
+    : resource_manager_(resource_manager),
+      scheduler_(scheduler),
+      transceiver_(transceiver),
+      capacity_(capacity) {
+  DCHECK_GT(capacity_, 0u);
+}
+
+void TpmTelemetry::Start(base::TimeDelta interval) {
+  interval_ = interval;
+  base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+      FROM_HERE, base::Bind(&TpmTelemetry::OnSampleTimer, GetWeakPtr()),
+      interval_);
+}
+
+void TpmTelemetry::TakeSample() {
+  std::string command;
+  TPM_RC result = Tpm::SerializeCommand_GetCapability(
+      TPM_CAP_TPM_PROPERTIES, TPM_PT_LOCKOUT_COUNTER, 1, &command, nullptr);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << "Failed to serialize lockout counter query: "
+               << GetErrorString(result);
+    OnLockoutCounterResponse(CreateErrorResponse(result));
+    return;
+  }
+  // The lockout counter changes while the TPM is running, so this is never
+  // answered from the response cache.
+  transceiver_->SendScheduledCommandForClient(
+      kTelemetryClient, command,
+      CommandTransceiver::kRequestedPriorityBackground, base::TimeTicks(),
+      base::Bind(&TpmTelemetry::OnLockoutCounterResponse, GetWeakPtr()));
+}
+
+void TpmTelemetry::AddSample(base::Time time,
+                             const ResourceManagerStats& stats,
+                             const QueueStats& queue_stats,
+                             const uint32_t* lockout_counter) {
+  TelemetrySample sample;
+  sample.set_time_ms((time - base::Time::UnixEpoch()).InMilliseconds());
+  if (!last_time_.is_null()) {
+    sample.set_interval_ms((time - last_time_).InMilliseconds());
+  }
+  std::map<uint32_t, const CommandStats*> last_commands;
+  for (const auto& command : last_stats_.commands()) {
+    last_commands[command.command_code()] = &command;
+  }
+  CommandTimeoutPolicy timeout_policy;
+  timeout_policy.Learn(last_stats_);
+  uint64_t overdue_commands = 0;
+  for (const auto& command : stats.commands()) {
+    uint64_t count = command.count();
+    uint64_t tpm_us = command.tpm_latency().total_us();
+    uint64_t total_us = command.total_latency().total_us();
+    const CommandStats* last_command = nullptr;
+    auto iter = last_commands.find(command.command_code());
+    if (iter != last_commands.end()) {
+      last_command = iter->second;
+      count -= last_command->count();
+      tpm_us -= last_command->tpm_latency().total_us();
+      total_us -= last_command->total_latency().total_us();
+    }
+    if (count == 0) {
+      continue;
+    }
+    overdue_commands +=
+        timeout_policy.CountOverdueCommands(command, last_command);
+    CommandTelemetry* command_telemetry = sample.add_commands();
+    command_telemetry->set_command_code(command.command_code());
+    command_telemetry->set_count(count);
+    command_telemetry->set_tpm_us(tpm_us);
+    command_telemetry->set_total_us(total_us);
+  }
+  sample.set_loaded_objects(stats.loaded_objects());
+  sample.set_loaded_sessions(stats.loaded_sessions());
+  sample.set_retry_warnings(stats.retry_warnings() -
+                            last_stats_.retry_warnings());
+  sample.set_yielded_warnings(stats.yielded_warnings() -
+                              last_stats_.yielded_warnings());
+  sample.set_testing_warnings(stats.testing_warnings() -
+                              last_stats_.testing_warnings());
+  sample.set_warning_retries(stats.warning_retries() -
+                             last_stats_.warning_retries());
+  sample.set_evictions(CountEvictions(stats) - CountEvictions(last_stats_));
+  if (lockout_counter) {
+    sample.set_lockout_counter(*lockout_counter);
+    if (has_last_lockout_counter_) {
+      sample.set_lockout_counter_change(
+          static_cast<int64_t>(*lockout_counter) - last_lockout_counter_);
+      if (*lockout_counter > last_lockout_counter_) {
+        LOG(WARNING) << "TPM lockout counter increased to "
+                     << *lockout_counter;
+      }
+    }
+    has_last_lockout_counter_ = true;
+    last_lockout_counter_ = *lockout_counter;
+  }
+  sample.set_queued_commands(queue_stats.queued_commands());
+  sample.set_rejected_commands(queue_stats.rejected_commands() -
+                               last_queue_stats_.rejected_commands());
+  sample.set_overdue_commands(overdue_commands);
+  LOG_IF(WARNING, overdue_commands > 0)
+      << overdue_commands << " TPM commands took longer than their timeout.";
+  last_time_ = time;
+  last_stats_ = stats;
+  last_queue_stats_ = queue_stats;
+  samples_.push_back(sample);
+  while (samples_.size() > capacity_) {
+    samples_.pop_front();
+  }
+}
+
+void TpmTelemetry::GetSamples(size_t max_samples,
+                              std::vector<TelemetrySample>* samples) const {
+  size_t first = 0;
+  if (max_samples > 0 && max_samples < samples_.size()) {
+    first = samples_.size() - max_samples;
+  }
+  samples->assign(samples_.begin() + first, samples_.end());
+}
+
+void TpmTelemetry::OnSampleTimer() {
+  TakeSample();
+  base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+      FROM_HERE, base::Bind(&TpmTelemetry::OnSampleTimer, GetWeakPtr()),
+      interval_);
+}
+
+void TpmTelemetry::OnLockoutCounterResponse(const std::string& response) {
+  ResourceManagerStats stats;
+  if (resource_manager_) {
+    resource_manager_->GetStats(&stats);
+  }
+  QueueStats queue_stats;
+  if (scheduler_) {
+    scheduler_->GetQueueStats(&queue_stats);
+  }
+  TPMI_YES_NO more_data = NO;
+  TPMS_CAPABILITY_DATA data;
+  TPM_RC result =
+      Tpm::ParseResponse_GetCapability(response, &more_data, &data, nullptr);
+  const TPML_TAGGED_TPM_PROPERTY& properties = data.data.tpm_properties;
+  if (result == TPM_RC_SUCCESS &&
+      data.capability == TPM_CAP_TPM_PROPERTIES && properties.count > 0 &&
+      properties.tpm_property[0].property == TPM_PT_LOCKOUT_COUNTER) {
+    AddSample(base::Time::Now(), stats, queue_stats,
+              &properties.tpm_property[0].value);
+    return;
+  }
+  VLOG(1) << "Failed to query the lockout counter: " << GetErrorString(result);
+  AddSample(base::Time::Now(), stats, queue_stats, nullptr);
+}
+
+}  // namespace trunks
@@ -0,0 +1,112 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TRUNKS_TPM_TELEMETRY_H_
+#define TRUNKS_TPM_TELEMETRY_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <base/macros.h>
+#include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
+
+#include "trunks/command_transceiver.h"
+#include "trunks/interface.pb.h"
+#include "trunks/resource_manager.h"
+#include "trunks/scheduling_command_transceiver.h"
+
+namespace trunks {
+
+// Periodically samples the health and performance counters of the trunksd
+// pipeline into a ring buffer of TelemetrySamples: per-command TPM time,
+// resource manager slot occupancy, the TPM warnings passed to clients, the
+// dictionary attack lockout counter and the command queue depth. Keeping the
+// recent history in trunksd lets clients look at what led up to a problem
+// without having watched for it.
+//
+// This class must be used on a single thread with a message loop; in trunksd
+// that is the IPC thread.
+class TpmTelemetry {
+ public:
+  // The identifier lockout counter queries are sent for.
+  static const char kTelemetryClient[];
+
+  // Counters are read from |resource_manager| and |scheduler|; either may be
+  // null, in which case the signals it provides are reported as zero. The
+  // lockout counter is queried through |transceiver| with background priority.
+  // This class does not take ownership of any of them. At most |capacity|
+  // samples are kept; older ones are dropped.
+  TpmTelemetry(const ResourceManager* resource_manager,
+               SchedulingCommandTransceiver* scheduler,
+               CommandTransceiver* transceiver,
+               size_t capacity);
+  ~TpmTelemetry() = default;
+
+  // Takes a sample every |interval|, the first one |interval| from now.
+  void Start(base::TimeDelta interval);
+
+  // Takes one sample. It is recorded once the lockout counter query has been
+  // answered.
+  void TakeSample();
+
+  // Records a sample at |time| from the current |stats| and |queue_stats|.
+  // Counts are reported as the change since the previous sample, or since
+  // startup for the first one. The lockout counter is left out if
+  // |lockout_counter| is null. Exposed for testing.
+  void AddSample(base::Time time,
+                 const ResourceManagerStats& stats,
+                 const QueueStats& queue_stats,
+                 const uint32_t* lockout_counter);
+
+  // Fills |samples|, oldest first, with the last |max_samples| samples, or with
+  // all of them if |max_samples| is zero.
+  void GetSamples(size_t max_samples,
+                  std::vector<TelemetrySample>* samples) const;
+
+ private:
+  // Takes a sample and posts the next call.
+  void OnSampleTimer();
+
+  // Records a sample once the lockout counter query returned |response|.
+  void OnLockoutCounterResponse(const std::string& response);
+
+  base::WeakPtr<TpmTelemetry> GetWeakPtr() {
+    return weak_factory_.GetWeakPtr();
+  }
+
+  const ResourceManager* resource_manager_;
+  SchedulingCommandTransceiver* scheduler_;
+  CommandTransceiver* transceiver_;
+  const size_t capacity_;
+  base::TimeDelta interval_;
+  std::deque<TelemetrySample> samples_;
+  // The counters of the previous sample, which counts are relative to.
+  base::Time last_time_;
+  ResourceManagerStats last_stats_;
+  QueueStats last_queue_stats_;
+  bool has_last_lockout_counter_ = false;
+  uint32_t last_lockout_counter_ = 0;
+
+  // Declared last so weak pointers are invalidated first on destruction.
+  base::WeakPtrFactory<TpmTelemetry> weak_factory_{this};
+  DISALLOW_COPY_AND_ASSIGN(TpmTelemetry);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_TPM_TELEMETRY_H_
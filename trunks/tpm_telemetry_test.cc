@@ -0,0 +1,201 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/tpm_telemetry.h"
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/mock_command_transceiver.h"
+
+using testing::_;
+using testing::Invoke;
+using testing::WithArg;
+
+namespace {
+
+// Creates a successful GetCapability response reporting |lockout_counter|.
+std::string MakeLockoutCounterResponse(trunks::UINT32 lockout_counter) {
+  trunks::TPMS_CAPABILITY_DATA data;
+  data.capability = trunks::TPM_CAP_TPM_PROPERTIES;
+  data.data.tpm_properties.count = 1;
+  data.data.tpm_properties.tpm_property[0].property =
+      trunks::TPM_PT_LOCKOUT_COUNTER;
+  data.data.tpm_properties.tpm_property[0].value = lockout_counter;
+  std::string body;
+  trunks::Serialize_TPMI_YES_NO(NO, &body);
+  trunks::Serialize_TPMS_CAPABILITY_DATA(data, &body);
+  std::string response;
+  trunks::Serialize_TPM_ST(trunks::TPM_ST_NO_SESSIONS, &response);
+  trunks::Serialize_UINT32(10 + body.size(), &response);
+  trunks::Serialize_TPM_RC(trunks::TPM_RC_SUCCESS, &response);
+  return response + body;
+}
+
+// Adds counters for |command_code| to |stats|.
+void AddCommand(trunks::TPM_CC command_code,
+                uint64_t count,
+                uint64_t tpm_us,
+                trunks::ResourceManagerStats* stats) {
+  trunks::CommandStats* command = stats->add_commands();
+  command->set_command_code(command_code);
+  command->set_count(count);
+  command->mutable_tpm_latency()->set_total_us(tpm_us);
+  command->mutable_total_latency()->set_total_us(tpm_us + count);
+}
+
+// Counts |count| total latencies in |bucket| of the histogram of |command|.
+void AddTotalLatency(size_t bucket,
+                     uint64_t count,
+                     trunks::CommandStats* command) {
+  trunks::LatencyHistogram* histogram = command->mutable_total_latency();
+  while (histogram->buckets_size() < 30) {
+    histogram->add_buckets(0);
+  }
+  histogram->set_buckets(bucket, histogram->buckets(bucket) + count);
+}
+
+}  // namespace
+
+namespace trunks {
+
+class TpmTelemetryTest : public testing::Test {
+ public:
+  TpmTelemetryTest() : telemetry_(nullptr, nullptr, &transceiver_, 3) {}
+  ~TpmTelemetryTest() override = default;
+
+  // Answers lockout counter queries with |response|.
+  void RespondWith(const std::string& response) {
+    EXPECT_CALL(transceiver_, SendCommand(_, _))
+        .WillOnce(WithArg<1>(Invoke(
+            [response](const CommandTransceiver::ResponseCallback& callback) {
+              callback.Run(response);
+            })));
+  }
+
+ protected:
+  testing::StrictMock<MockCommandTransceiver> transceiver_;
+  TpmTelemetry telemetry_;
+};
+
+TEST_F(TpmTelemetryTest, CountsAreDeltas) {
+  base::Time start = base::Time::Now();
+  ResourceManagerStats stats;
+  AddCommand(TPM_CC_Sign, 2, 100, &stats);
+  AddCommand(TPM_CC_Load, 1, 50, &stats);
+  stats.set_retry_warnings(1);
+  EvictionStats* eviction = stats.add_evictions();
+  eviction->set_objects(2);
+  QueueStats queue_stats;
+  queue_stats.set_rejected_commands(4);
+  uint32_t lockout_counter = 1;
+  telemetry_.AddSample(start, stats, queue_stats, &lockout_counter);
+
+  // Load was not used again; Sign was used three more times.
+  stats.mutable_commands(0)->set_count(5);
+  stats.mutable_commands(0)->mutable_tpm_latency()->set_total_us(400);
+  stats.set_retry_warnings(3);
+  stats.set_loaded_objects(2);
+  eviction->set_sessions(1);
+  queue_stats.set_queued_commands(7);
+  queue_stats.set_rejected_commands(5);
+  lockout_counter = 3;
+  telemetry_.AddSample(start + base::TimeDelta::FromSeconds(30), stats,
+                       queue_stats, &lockout_counter);
+
+  std::vector<TelemetrySample> samples;
+  telemetry_.GetSamples(0, &samples);
+  ASSERT_EQ(2u, samples.size());
+  // The first sample counts everything since startup.
+  EXPECT_FALSE(samples[0].has_interval_ms());
+  EXPECT_EQ(2, samples[0].commands_size());
+  EXPECT_EQ(2u, samples[0].evictions());
+  EXPECT_FALSE(samples[0].has_lockout_counter_change());
+  const TelemetrySample& sample = samples[1];
+  EXPECT_EQ(30000, sample.interval_ms());
+  EXPECT_EQ(30000, sample.time_ms() - samples[0].time_ms());
+  ASSERT_EQ(1, sample.commands_size());
+  EXPECT_EQ(TPM_CC_Sign, sample.commands(0).command_code());
+  EXPECT_EQ(3u, sample.commands(0).count());
+  EXPECT_EQ(300u, sample.commands(0).tpm_us());
+  EXPECT_EQ(2u, sample.retry_warnings());
+  EXPECT_EQ(2u, sample.loaded_objects());
+  EXPECT_EQ(1u, sample.evictions());
+  EXPECT_EQ(3u, sample.lockout_counter());
+  EXPECT_EQ(2, sample.lockout_counter_change());
+  EXPECT_EQ(7u, sample.queued_commands());
+  EXPECT_EQ(1u, sample.rejected_commands());
+}
+
+TEST_F(TpmTelemetryTest, RingBuffer) {
+  base::Time start = base::Time::Now();
+  for (int i = 0; i < 5; ++i) {
+    telemetry_.AddSample(start + base::TimeDelta::FromSeconds(i),
+                         ResourceManagerStats(), QueueStats(), nullptr);
+  }
+  std::vector<TelemetrySample> samples;
+  telemetry_.GetSamples(0, &samples);
+  ASSERT_EQ(3u, samples.size());
+  EXPECT_EQ(2000, samples[0].time_ms() -
+                      (start - base::Time::UnixEpoch()).InMilliseconds());
+  telemetry_.GetSamples(1, &samples);
+  ASSERT_EQ(1u, samples.size());
+  EXPECT_EQ(4000, samples[0].time_ms() -
+                      (start - base::Time::UnixEpoch()).InMilliseconds());
+}
+
+TEST_F(TpmTelemetryTest, CountsOverdueCommands) {
+  base::Time start = base::Time::Now();
+  ResourceManagerStats stats;
+  AddCommand(TPM_CC_PCR_Read, 1000, 1000, &stats);
+  // About a millisecond each, so the learned timeout is the minimum.
+  AddTotalLatency(10, 1000, stats.mutable_commands(0));
+  telemetry_.AddSample(start, stats, QueueStats(), nullptr);
+  // Two more took at least 16 seconds and one took 2 seconds.
+  stats.mutable_commands(0)->set_count(1003);
+  AddTotalLatency(25, 2, stats.mutable_commands(0));
+  AddTotalLatency(21, 1, stats.mutable_commands(0));
+  telemetry_.AddSample(start + base::TimeDelta::FromSeconds(30), stats,
+                       QueueStats(), nullptr);
+  std::vector<TelemetrySample> samples;
+  telemetry_.GetSamples(0, &samples);
+  ASSERT_EQ(2u, samples.size());
+  // Nothing was learned before the first sample.
+  EXPECT_EQ(0u, samples[0].overdue_commands());
+  EXPECT_EQ(2u, samples[1].overdue_commands());
+}
+
+TEST_F(TpmTelemetryTest, QueriesLockoutCounter) {
+  RespondWith(MakeLockoutCounterResponse(5));
+  telemetry_.TakeSample();
+  RespondWith(CreateErrorResponse(TPM_RC_RETRY));
+  telemetry_.TakeSample();
+  RespondWith(MakeLockoutCounterResponse(4));
+  telemetry_.TakeSample();
+  std::vector<TelemetrySample> samples;
+  telemetry_.GetSamples(0, &samples);
+  ASSERT_EQ(3u, samples.size());
+  EXPECT_EQ(5u, samples[0].lockout_counter());
+  // A failed query leaves the counter out but does not lose the sample.
+  EXPECT_FALSE(samples[1].has_lockout_counter());
+  EXPECT_EQ(4u, samples[2].lockout_counter());
+  EXPECT_EQ(-1, samples[2].lockout_counter_change());
+}
+
+}  // namespace trunks
@@ -17,10 +17,13 @@
 #ifndef TRUNKS_TPM_UTILITY_H_
 #define TRUNKS_TPM_UTILITY_H_
 
+#include <map>
 #include <string>
 #include <vector>
 
+#include <base/callback.h>
 #include <base/macros.h>
+#include <base/time/time.h>
 
 #include "trunks/hmac_session.h"
 #include "trunks/tpm_generated.h"
@@ -42,6 +45,9 @@ class TRUNKS_EXPORT TpmUtility {
  public:
   enum AsymmetricKeyUsage { kDecryptKey, kSignKey, kDecryptAndSignKey };
 
+  // Receives the data read by ReadNVSpaceInChunks(), one chunk at a time.
+  typedef base::Callback<void(const std::string& chunk)> NVReadCallback;
+
   TpmUtility() {}
   virtual ~TpmUtility() {}
 
@@ -70,6 +76,13 @@ class TRUNKS_EXPORT TpmUtility {
   // NOTE: This command needs platform authorization and PP assertion.
   virtual TPM_RC AllocatePCR(const std::string& platform_password) = 0;
 
+  // Synchronously does the parts of taking ownership that need none of the
+  // final passwords: the owner hierarchy gets a well-known password and the
+  // storage root and salting keys are created. This is where most of the time
+  // goes, so it can be done ahead of TakeOwnership, which skips whatever has
+  // already been done.
+  virtual TPM_RC PrepareForOwnership() = 0;
+
   // Synchronously takes ownership of the TPM with the given passwords as
   // authorization values.
   virtual TPM_RC TakeOwnership(const std::string& owner_password,
@@ -99,6 +112,26 @@ class TRUNKS_EXPORT TpmUtility {
   // in |pcr_value|. NOTE: it assumes we are using SHA256 as our hash alg.
   virtual TPM_RC ReadPCR(int pcr_index, std::string* pcr_value) = 0;
 
+  // This method extends the pcr specified by |pcr_index| in each of the
+  // |hash_algs| banks with the hash of |extend_data| computed with the
+  // algorithm of that bank, using a single TPM2_PCR_Extend. Only
+  // TPM_ALG_SHA1 and TPM_ALG_SHA256 banks are supported.
+  // |delegate| specifies an optional authorization delegate to be used.
+  virtual TPM_RC ExtendPCRs(int pcr_index,
+                            const std::string& extend_data,
+                            const std::vector<TPM_ALG_ID>& hash_algs,
+                            AuthorizationDelegate* delegate) = 0;
+
+  // This method reads the pcrs specified by |pcr_indexes| from each of the
+  // |hash_algs| banks. On success |pcr_values| maps each bank to the values of
+  // the pcrs in the order of |pcr_indexes|. The selection is sent as one
+  // bitmap and TPM2_PCR_Read is only repeated for the pcrs the TPM did not
+  // return, which it does for more than 8 digests.
+  virtual TPM_RC ReadPCRs(
+      const std::vector<int>& pcr_indexes,
+      const std::vector<TPM_ALG_ID>& hash_algs,
+      std::map<TPM_ALG_ID, std::vector<std::string>>* pcr_values) = 0;
+
   // This method performs an encryption operation using a LOADED RSA key
   // referrenced by its handle |key_handle|. The |plaintext| is then encrypted
   // to give us the |ciphertext|. |scheme| refers to the encryption scheme
@@ -127,8 +160,10 @@ class TRUNKS_EXPORT TpmUtility {
   // and uses it to sign the hash of |plaintext|. The signature produced is
   // returned using the |signature| argument. |scheme| is used to specify the
   // signature scheme used. By default it is TPM_ALG_RSASSA, but TPM_ALG_RSAPPS
-  // can be specified. |hash_alg| is the algorithm used in the signing
-  // operation. It is by default TPM_ALG_SHA256.
+  // can be specified. For ECC keys the scheme is TPM_ALG_ECDSA, and the
+  // signature is returned as r || s, each padded to the size of the curve.
+  // |hash_alg| is the algorithm used in the signing operation. It is by
+  // default TPM_ALG_SHA256.
   // |delegate| is an AuthorizationDelegate used to authorize this command.
   virtual TPM_RC Sign(TPM_HANDLE key_handle,
                       TPM_ALG_ID scheme,
@@ -137,12 +172,23 @@ class TRUNKS_EXPORT TpmUtility {
                       AuthorizationDelegate* delegate,
                       std::string* signature) = 0;
 
+  // Like Sign, but signs the hash of the contents of the file open at |fd|.
+  // The file is memory-mapped and hashed in place rather than read into a
+  // string. |fd| is not closed, and its file offset is left unchanged.
+  virtual TPM_RC SignFile(TPM_HANDLE key_handle,
+                          TPM_ALG_ID scheme,
+                          TPM_ALG_ID hash_alg,
+                          int fd,
+                          AuthorizationDelegate* delegate,
+                          std::string* signature) = 0;
+
   // This method verifies that the signature produced on the plaintext was
   // performed by |key_handle|. |scheme| and |hash| refer to the signature
   // scheme used to sign the hash of |plaintext| and produce the signature.
   // This value is by default TPM_ALG_RSASSA with TPM_ALG_SHA256 but can take
   // the value of TPM_ALG_RSAPPS with other hash algorithms supported by the
-  // tpm. Returns TPM_RC_SUCCESS when the signature is correct.
+  // tpm. ECC keys take TPM_ALG_ECDSA and a signature in the format produced
+  // by Sign. Returns TPM_RC_SUCCESS when the signature is correct.
   // |delegate| specifies an optional authorization delegate to be used.
   virtual TPM_RC Verify(TPM_HANDLE key_handle,
                         TPM_ALG_ID scheme,
@@ -151,6 +197,13 @@ class TRUNKS_EXPORT TpmUtility {
                         const std::string& signature,
                         AuthorizationDelegate* delegate) = 0;
 
+  // When |enabled|, AsymmetricEncrypt and Verify read the key's public area
+  // from the TPM and do the RSA operation in software instead of sending
+  // TPM2_RSA_Encrypt or TPM2_VerifySignature. Neither needs the private key,
+  // so the result is the same while the TPM is kept free for other work.
+  // Disabled by default.
+  virtual void SetUseSoftwarePublicKeyOperations(bool enabled) = 0;
+
   // This method is used to check if a key was created in the TPM. |key_handle|
   // refers to a loaded Tpm2.0 object, and |creation_blob| is the blob
   // generated when the object was created. Returns TPM_RC_SUCCESS iff the
@@ -181,6 +234,20 @@ class TRUNKS_EXPORT TpmUtility {
                               AuthorizationDelegate* delegate,
                               std::string* key_blob) = 0;
 
+  // This method imports an external ECC key of |key_type| on the curve
+  // |curve_id| into the TPM. |public_point_x|, |public_point_y| and
+  // |private_value| are interpreted as raw bytes in big-endian order. If the
+  // out argument |key_blob| is not null, it is populated with the imported
+  // key, which can then be loaded into the TPM.
+  virtual TPM_RC ImportECCKey(AsymmetricKeyUsage key_type,
+                              TPMI_ECC_CURVE curve_id,
+                              const std::string& public_point_x,
+                              const std::string& public_point_y,
+                              const std::string& private_value,
+                              const std::string& password,
+                              AuthorizationDelegate* delegate,
+                              std::string* key_blob) = 0;
+
   // This method uses the TPM to generates an RSA key of type |key_type|.
   // |modulus_bits| is used to specify the size of the modulus, and
   // |public_exponent| specifies the exponent of the key. After this function
@@ -207,6 +274,34 @@ class TRUNKS_EXPORT TpmUtility {
                                   std::string* key_blob,
                                   std::string* creation_blob) = 0;
 
+  // Creates RSA keys with the given parameters until |num_keys| of them are
+  // set aside for later CreateRSAKeyPair calls that use the same parameters
+  // and kNoCreationPCR. Each key costs a full TPM2_Create, so this is meant to
+  // be called when the TPM is otherwise idle.
+  virtual TPM_RC PregenerateRSAKeyPairs(AsymmetricKeyUsage key_type,
+                                        int modulus_bits,
+                                        uint32_t public_exponent,
+                                        const std::string& password,
+                                        const std::string& policy_digest,
+                                        bool use_only_policy_authorization,
+                                        size_t num_keys,
+                                        AuthorizationDelegate* delegate) = 0;
+
+  // Like CreateRSAKeyPair, but generates an ECC key of type |key_type| on the
+  // curve |curve_id|. ECC keys are much cheaper for the TPM to generate than
+  // RSA keys, so they are not pooled. The key is created under the RSA
+  // storage root key, so it can be loaded with LoadKey. Returns
+  // TPM_RC_ASYMMETRIC if the TPM does not support ECC.
+  virtual TPM_RC CreateECCKeyPair(AsymmetricKeyUsage key_type,
+                                  TPMI_ECC_CURVE curve_id,
+                                  const std::string& password,
+                                  const std::string& policy_digest,
+                                  bool use_only_policy_authorization,
+                                  int creation_pcr_index,
+                                  AuthorizationDelegate* delegate,
+                                  std::string* key_blob,
+                                  std::string* creation_blob) = 0;
+
   // This method loads a pregenerated TPM key into the TPM. |key_blob| contains
   // the blob returned by a key creation function. The loaded key's handle is
   // returned using |key_handle|.
@@ -214,6 +309,15 @@ class TRUNKS_EXPORT TpmUtility {
                          AuthorizationDelegate* delegate,
                          TPM_HANDLE* key_handle) = 0;
 
+  // Loads several pregenerated keys under the storage root key. All of
+  // |key_blobs| are parsed before anything is sent to the TPM, and the parent
+  // name is looked up once for the whole batch. On success |key_handles|
+  // holds one handle per blob, in order. On failure every key loaded by this
+  // call is flushed again and |key_handles| is left empty.
+  virtual TPM_RC LoadKeys(const std::vector<std::string>& key_blobs,
+                          AuthorizationDelegate* delegate,
+                          std::vector<TPM_HANDLE>* key_handles) = 0;
+
   // This function sets |name| to the name of the object referenced by
   // |handle|. This function only works on Transient and Permanent objects.
   virtual TPM_RC GetKeyName(TPM_HANDLE handle, std::string* name) = 0;
@@ -235,6 +339,15 @@ class TRUNKS_EXPORT TpmUtility {
                             AuthorizationDelegate* delegate,
                             std::string* unsealed_data) = 0;
 
+  // Makes UnsealData remember what it unseals for |ttl|, so unsealing the
+  // same blob again needs no TPM commands. Cached secrets are only wiped
+  // early by ExtendPCR, ExtendPCRs and Clear on this instance; extends by
+  // other TPM clients are not seen. Cached secrets are returned without
+  // satisfying the blob's policy again, so only enable this for blobs whose
+  // policy every caller of this instance would satisfy. A zero |ttl|, the
+  // default, disables and clears the cache.
+  virtual void EnableUnsealCache(base::TimeDelta ttl) = 0;
+
   // This method sets up a given HmacSession with parameter encryption set to
   // true. Returns an TPM_RC_SUCCESS on success.
   virtual TPM_RC StartSession(HmacSession* session) = 0;
@@ -246,6 +359,39 @@ class TRUNKS_EXPORT TpmUtility {
                                             const std::string& pcr_value,
                                             std::string* policy_digest) = 0;
 
+  // These methods seal data to a policy authority instead of to exact PCR
+  // values, so that a PCR change only needs a new signed approval rather
+  // than re-sealing every blob. The authority is a 2048-bit RSA key with the
+  // public modulus |authority_modulus| and the default exponent, which signs
+  // approvals with RSASSA-PKCS1-v1_5 and SHA-256.
+  //
+  // Computes the |policy_digest| to pass to SealData so that the data can be
+  // unsealed under any policy the authority approves with |policy_ref|.
+  virtual TPM_RC GetPolicyDigestForAuthority(
+      const std::string& authority_modulus,
+      const std::string& policy_ref,
+      std::string* policy_digest) = 0;
+
+  // Signs an approval of |approved_policy| for |policy_ref| with the authority
+  // key loaded at |authority_key_handle|. For new PCR values the approved
+  // policy is computed with GetPolicyDigestForPcrValue.
+  virtual TPM_RC SignPolicyApproval(TPM_HANDLE authority_key_handle,
+                                    const std::string& approved_policy,
+                                    const std::string& policy_ref,
+                                    AuthorizationDelegate* delegate,
+                                    std::string* approval_signature) = 0;
+
+  // Unseals |sealed_data| that was sealed to GetPolicyDigestForAuthority.
+  // |approval_signature| has to approve the policy that binds to the current
+  // value of the PCR at |pcr_index|.
+  virtual TPM_RC UnsealDataWithApprovedPolicy(
+      const std::string& sealed_data,
+      int pcr_index,
+      const std::string& authority_modulus,
+      const std::string& policy_ref,
+      const std::string& approval_signature,
+      std::string* unsealed_data) = 0;
+
   // This method defines a non-volatile storage area in the TPM, referenced
   // by |index| of size |num_bytes|. This command needs owner authorization.
   // The |attributes| of the space must be specified as a combination of
@@ -295,6 +441,24 @@ class TRUNKS_EXPORT TpmUtility {
                              std::string* nvram_data,
                              AuthorizationDelegate* delegate) = 0;
 
+  // These methods work like WriteNVSpace() and ReadNVSpace() but split the
+  // data into TPM2_NV_Write / TPM2_NV_Read commands no larger than the TPM's
+  // TPM_PT_NV_BUFFER_MAX, so any amount of data can be accessed. Every chunk
+  // is authorized with |delegate|, which therefore must not be a policy
+  // session; those are reset by each command. The read passes the data to
+  // |callback| chunk by chunk, in order, instead of collecting it in memory.
+  virtual TPM_RC WriteNVSpaceInChunks(uint32_t index,
+                                      uint32_t offset,
+                                      const std::string& nvram_data,
+                                      bool using_owner_authorization,
+                                      AuthorizationDelegate* delegate) = 0;
+  virtual TPM_RC ReadNVSpaceInChunks(uint32_t index,
+                                     uint32_t offset,
+                                     size_t num_bytes,
+                                     bool using_owner_authorization,
+                                     const NVReadCallback& callback,
+                                     AuthorizationDelegate* delegate) = 0;
+
   // This function sets |name| to the name of the non-volatile space referenced
   // by |index|.
   virtual TPM_RC GetNVSpaceName(uint32_t index, std::string* name) = 0;
@@ -16,16 +16,32 @@
 
 #include "trunks/tpm_utility_impl.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
 #include <memory>
+#include <utility>
 
+#include <base/files/file.h>
+#include <base/files/memory_mapped_file.h>
 #include <base/logging.h>
+#include <base/posix/eintr_wrapper.h>
 #include <base/sha1.h>
 #include <base/stl_util.h>
 #include <crypto/openssl_util.h>
 #include <crypto/secure_hash.h>
 #include <crypto/sha2.h>
 #include <openssl/aes.h>
+#include <openssl/bn.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#if defined(OPENSSL_IS_BORINGSSL)
+#include <openssl/mem.h>
+#endif
 #include <openssl/rand.h>
+#include <openssl/rsa.h>
 
 #include "trunks/authorization_delegate.h"
 #include "trunks/blob_parser.h"
@@ -33,6 +49,7 @@
 #include "trunks/hmac_authorization_delegate.h"
 #include "trunks/hmac_session.h"
 #include "trunks/policy_session.h"
+#include "trunks/policy_template.h"
 #include "trunks/scoped_key_handle.h"
 #include "trunks/tpm_constants.h"
 #include "trunks/tpm_state.h"
@@ -68,16 +85,136 @@ std::string HashString(const std::string& plaintext,
   return std::string();
 }
 
+// Returns the OpenSSL digest for |hash_alg|, or nullptr if it is not
+// supported.
+const EVP_MD* GetOpenSSLDigest(trunks::TPM_ALG_ID hash_alg) {
+  switch (hash_alg) {
+    case trunks::TPM_ALG_SHA1:
+      return EVP_sha1();
+    case trunks::TPM_ALG_SHA256:
+      return EVP_sha256();
+  }
+  return nullptr;
+}
+
+// Builds an OpenSSL public key from the RSA |public_area| of a TPM object.
+bssl::UniquePtr<EVP_PKEY> GetRSAPublicKey(
+    const trunks::TPMT_PUBLIC& public_area) {
+  // An exponent of zero selects the default exponent.
+  uint32_t exponent = public_area.parameters.rsa_detail.exponent;
+  if (exponent == 0) {
+    exponent = 0x10001;
+  }
+  bssl::UniquePtr<RSA> rsa(RSA_new());
+  rsa->e = BN_new();
+  if (!rsa->e || !BN_set_word(rsa->e, exponent)) {
+    return nullptr;
+  }
+  rsa->n = BN_bin2bn(public_area.unique.rsa.buffer, public_area.unique.rsa.size,
+                     nullptr);
+  if (!rsa->n) {
+    return nullptr;
+  }
+  bssl::UniquePtr<EVP_PKEY> key(EVP_PKEY_new());
+  if (!EVP_PKEY_set1_RSA(key.get(), rsa.get())) {
+    return nullptr;
+  }
+  return key;
+}
+
+// Returns the size in bytes of a coordinate on |curve_id|, which is also the
+// size of each half of an ECDSA signature, or 0 if the curve is unknown.
+size_t GetECCParameterSize(trunks::TPMI_ECC_CURVE curve_id) {
+  switch (curve_id) {
+    case trunks::TPM_ECC_NIST_P192:
+      return 24;
+    case trunks::TPM_ECC_NIST_P224:
+      return 28;
+    case trunks::TPM_ECC_NIST_P256:
+    case trunks::TPM_ECC_BN_P256:
+    case trunks::TPM_ECC_SM2_P256:
+      return 32;
+    case trunks::TPM_ECC_NIST_P384:
+      return 48;
+    case trunks::TPM_ECC_NIST_P521:
+      return 66;
+    case trunks::TPM_ECC_BN_P638:
+      return 80;
+  }
+  return 0;
+}
+
+// Returns true if no pcr is selected in any bank of |selection|.
+bool IsPCRSelectionEmpty(const trunks::TPML_PCR_SELECTION& selection) {
+  for (uint32_t i = 0; i < selection.count; ++i) {
+    for (uint8_t j = 0; j < selection.pcr_selections[i].sizeof_select; ++j) {
+      if (selection.pcr_selections[i].pcr_select[j]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Returns the bank of |selection| for |hash_alg|, or nullptr if there is none.
+trunks::TPMS_PCR_SELECTION* FindPCRSelection(
+    trunks::TPMI_ALG_HASH hash_alg,
+    trunks::TPML_PCR_SELECTION* selection) {
+  for (uint32_t i = 0; i < selection->count; ++i) {
+    if (selection->pcr_selections[i].hash == hash_alg) {
+      return &selection->pcr_selections[i];
+    }
+  }
+  return nullptr;
+}
+
 }  // namespace
 
 namespace trunks {
 
+bool RSAKeyPool::Take(const std::string& entry,
+                      std::string* key_blob,
+                      std::string* creation_blob) {
+  base::AutoLock lock(lock_);
+  auto iter = keys_.find(entry);
+  if (iter == keys_.end() || iter->second.empty()) {
+    return false;
+  }
+  *key_blob = iter->second.back().key_blob;
+  *creation_blob = iter->second.back().creation_blob;
+  iter->second.pop_back();
+  return true;
+}
+
+void RSAKeyPool::Add(const std::string& entry,
+                     const std::string& key_blob,
+                     const std::string& creation_blob) {
+  base::AutoLock lock(lock_);
+  keys_[entry].push_back({key_blob, creation_blob});
+}
+
+size_t RSAKeyPool::GetCount(const std::string& entry) {
+  base::AutoLock lock(lock_);
+  auto iter = keys_.find(entry);
+  return iter == keys_.end() ? 0 : iter->second.size();
+}
+
 TpmUtilityImpl::TpmUtilityImpl(const TrunksFactory& factory)
-    : factory_(factory) {
+    : factory_(factory),
+      own_key_pool_(new RSAKeyPool()),
+      key_pool_(own_key_pool_.get()) {
+  crypto::EnsureOpenSSLInit();
+}
+
+TpmUtilityImpl::TpmUtilityImpl(const TrunksFactory& factory,
+                               RSAKeyPool* key_pool)
+    : factory_(factory), key_pool_(key_pool) {
   crypto::EnsureOpenSSLInit();
 }
 
-TpmUtilityImpl::~TpmUtilityImpl() {}
+TpmUtilityImpl::~TpmUtilityImpl() {
+  ClearUnsealCache();
+}
 
 TPM_RC TpmUtilityImpl::Startup() {
   TPM_RC result = TPM_RC_SUCCESS;
@@ -98,6 +235,11 @@ TPM_RC TpmUtilityImpl::Startup() {
 
 TPM_RC TpmUtilityImpl::Clear() {
   TPM_RC result = TPM_RC_SUCCESS;
+  // A clear removes owner objects and NV spaces, so nothing cached about
+  // them stays valid.
+  object_public_area_map_.clear();
+  nvram_public_area_map_.clear();
+  ClearUnsealCache();
   std::unique_ptr<AuthorizationDelegate> password_delegate(
       factory_.GetPasswordAuthorization(""));
   result = factory_.GetTpm()->ClearSync(TPM_RH_PLATFORM,
@@ -245,13 +387,10 @@ TPM_RC TpmUtilityImpl::AllocatePCR(const std::string& platform_password) {
   return TPM_RC_SUCCESS;
 }
 
-TPM_RC TpmUtilityImpl::TakeOwnership(const std::string& owner_password,
-                                     const std::string& endorsement_password,
-                                     const std::string& lockout_password) {
+TPM_RC TpmUtilityImpl::PrepareForOwnership() {
   // First we set the storage hierarchy authorization to the well know default
   // password.
-  TPM_RC result = TPM_RC_SUCCESS;
-  result = SetKnownOwnerPassword(kWellKnownPassword);
+  TPM_RC result = SetKnownOwnerPassword(kWellKnownPassword);
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << __func__ << ": Error injecting known password: "
                << GetErrorString(result);
@@ -270,6 +409,16 @@ TPM_RC TpmUtilityImpl::TakeOwnership(const std::string& owner_password,
                << ": Error creating salting key: " << GetErrorString(result);
     return result;
   }
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC TpmUtilityImpl::TakeOwnership(const std::string& owner_password,
+                                     const std::string& endorsement_password,
+                                     const std::string& lockout_password) {
+  TPM_RC result = PrepareForOwnership();
+  if (result != TPM_RC_SUCCESS) {
+    return result;
+  }
 
   std::unique_ptr<HmacSession> session = factory_.GetHmacSession();
   result = session->StartUnboundSession(true);
@@ -331,6 +480,7 @@ TPM_RC TpmUtilityImpl::GenerateRandom(size_t num_bytes,
   CHECK(random_data);
   size_t bytes_left = num_bytes;
   random_data->clear();
+  random_data->reserve(num_bytes);
   TPM_RC rc;
   TPM2B_DIGEST digest;
   while (bytes_left > 0) {
@@ -339,7 +489,7 @@ TPM_RC TpmUtilityImpl::GenerateRandom(size_t num_bytes,
       LOG(ERROR) << __func__ << ": Error getting random data from tpm.";
       return rc;
     }
-    random_data->append(StringFrom_TPM2B_DIGEST(digest));
+    AppendBytesFrom_TPM2B_DIGEST(digest, random_data);
     bytes_left -= digest.size;
   }
   CHECK_EQ(random_data->size(), num_bytes);
@@ -349,17 +499,46 @@ TPM_RC TpmUtilityImpl::GenerateRandom(size_t num_bytes,
 TPM_RC TpmUtilityImpl::ExtendPCR(int pcr_index,
                                  const std::string& extend_data,
                                  AuthorizationDelegate* delegate) {
+  return ExtendPCRs(pcr_index, extend_data, {TPM_ALG_SHA256}, delegate);
+}
+
+TPM_RC TpmUtilityImpl::ReadPCR(int pcr_index, std::string* pcr_value) {
+  std::map<TPM_ALG_ID, std::vector<std::string>> pcr_values;
+  TPM_RC rc = ReadPCRs({pcr_index}, {TPM_ALG_SHA256}, &pcr_values);
+  if (rc) {
+    return rc;
+  }
+  pcr_value->assign(pcr_values[TPM_ALG_SHA256][0]);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC TpmUtilityImpl::ExtendPCRs(int pcr_index,
+                                  const std::string& extend_data,
+                                  const std::vector<TPM_ALG_ID>& hash_algs,
+                                  AuthorizationDelegate* delegate) {
+  // Secrets sealed to the old PCR value may no longer be unsealable.
+  ClearUnsealCache();
   if (pcr_index < 0 || pcr_index >= IMPLEMENTATION_PCR) {
     LOG(ERROR) << __func__ << ": Using a PCR index that isn't implemented.";
     return TPM_RC_FAILURE;
   }
+  TPML_DIGEST_VALUES digests;
+  if (hash_algs.empty() || hash_algs.size() > arraysize(digests.digests)) {
+    LOG(ERROR) << __func__ << ": Invalid number of PCR banks.";
+    return SAPI_RC_BAD_PARAMETER;
+  }
+  digests.count = hash_algs.size();
+  for (size_t i = 0; i < hash_algs.size(); ++i) {
+    if (hash_algs[i] != TPM_ALG_SHA1 && hash_algs[i] != TPM_ALG_SHA256) {
+      LOG(ERROR) << __func__ << ": Unsupported PCR bank: " << hash_algs[i];
+      return SAPI_RC_BAD_PARAMETER;
+    }
+    std::string digest = HashString(extend_data, hash_algs[i]);
+    digests.digests[i].hash_alg = hash_algs[i];
+    memcpy(&digests.digests[i].digest, digest.data(), digest.size());
+  }
   TPM_HANDLE pcr_handle = HR_PCR + pcr_index;
   std::string pcr_name = NameFromHandle(pcr_handle);
-  TPML_DIGEST_VALUES digests;
-  digests.count = 1;
-  digests.digests[0].hash_alg = TPM_ALG_SHA256;
-  crypto::SHA256HashString(extend_data, digests.digests[0].digest.sha256,
-                           crypto::kSHA256Length);
   std::unique_ptr<AuthorizationDelegate> empty_password_delegate =
       factory_.GetPasswordAuthorization("");
   if (!delegate) {
@@ -369,38 +548,85 @@ TPM_RC TpmUtilityImpl::ExtendPCR(int pcr_index,
                                            delegate);
 }
 
-TPM_RC TpmUtilityImpl::ReadPCR(int pcr_index, std::string* pcr_value) {
-  TPML_PCR_SELECTION pcr_select_in;
-  uint32_t pcr_update_counter;
-  TPML_PCR_SELECTION pcr_select_out;
-  TPML_DIGEST pcr_values;
+TPM_RC TpmUtilityImpl::ReadPCRs(
+    const std::vector<int>& pcr_indexes,
+    const std::vector<TPM_ALG_ID>& hash_algs,
+    std::map<TPM_ALG_ID, std::vector<std::string>>* pcr_values) {
+  CHECK(pcr_values);
   // This process of selecting pcrs is highlighted in TPM 2.0 Library Spec
   // Part 2 (Section 10.5 - PCR structures).
-  uint8_t pcr_select_index = pcr_index / 8;
-  uint8_t pcr_select_byte = 1 << (pcr_index % 8);
-  pcr_select_in.count = 1;
-  pcr_select_in.pcr_selections[0].hash = TPM_ALG_SHA256;
-  pcr_select_in.pcr_selections[0].sizeof_select = PCR_SELECT_MIN;
-  pcr_select_in.pcr_selections[0].pcr_select[pcr_select_index] =
-      pcr_select_byte;
-
-  TPM_RC rc =
-      factory_.GetTpm()->PCR_ReadSync(pcr_select_in, &pcr_update_counter,
-                                      &pcr_select_out, &pcr_values, nullptr);
-  if (rc) {
-    LOG(INFO) << __func__
-              << ": Error trying to read a pcr: " << GetErrorString(rc);
-    return rc;
+  TPML_PCR_SELECTION pending;
+  memset(&pending, 0, sizeof(pending));
+  if (hash_algs.empty() ||
+      hash_algs.size() > arraysize(pending.pcr_selections)) {
+    LOG(ERROR) << __func__ << ": Invalid number of PCR banks.";
+    return SAPI_RC_BAD_PARAMETER;
   }
-  if (pcr_select_out.count != 1 ||
-      pcr_select_out.pcr_selections[0].sizeof_select < (pcr_select_index + 1) ||
-      pcr_select_out.pcr_selections[0].pcr_select[pcr_select_index] !=
-          pcr_select_byte) {
-    LOG(ERROR) << __func__ << ": TPM did not return the requested PCR";
-    return TPM_RC_FAILURE;
+  pending.count = hash_algs.size();
+  for (size_t i = 0; i < hash_algs.size(); ++i) {
+    pending.pcr_selections[i].hash = hash_algs[i];
+    pending.pcr_selections[i].sizeof_select = PCR_SELECT_MAX;
+    for (int pcr_index : pcr_indexes) {
+      if (pcr_index < 0 || pcr_index >= IMPLEMENTATION_PCR) {
+        LOG(ERROR) << __func__ << ": Using a PCR index that isn't implemented.";
+        return SAPI_RC_BAD_PARAMETER;
+      }
+      pending.pcr_selections[i].pcr_select[pcr_index / 8] |=
+          1 << (pcr_index % 8);
+    }
+  }
+
+  std::map<TPM_ALG_ID, std::map<int, std::string>> values;
+  while (!pcr_indexes.empty() && !IsPCRSelectionEmpty(pending)) {
+    uint32_t pcr_update_counter;
+    TPML_PCR_SELECTION pcr_select_out;
+    memset(&pcr_select_out, 0, sizeof(pcr_select_out));
+    TPML_DIGEST digests;
+    memset(&digests, 0, sizeof(digests));
+    TPM_RC rc = factory_.GetTpm()->PCR_ReadSync(
+        pending, &pcr_update_counter, &pcr_select_out, &digests, nullptr);
+    if (rc) {
+      LOG(INFO) << __func__
+                << ": Error trying to read a pcr: " << GetErrorString(rc);
+      return rc;
+    }
+    // The digests follow the order of the selection the TPM reports, which
+    // is the part of |pending| it could fit in the response.
+    uint32_t digest_index = 0;
+    for (uint32_t i = 0; i < pcr_select_out.count && i < HASH_COUNT; ++i) {
+      const TPMS_PCR_SELECTION& selection = pcr_select_out.pcr_selections[i];
+      TPMS_PCR_SELECTION* requested =
+          FindPCRSelection(selection.hash, &pending);
+      int select_bits =
+          std::min<int>(selection.sizeof_select, PCR_SELECT_MAX) * 8;
+      for (int pcr_index = 0; pcr_index < select_bits; ++pcr_index) {
+        uint8_t bit = 1 << (pcr_index % 8);
+        if (!(selection.pcr_select[pcr_index / 8] & bit)) {
+          continue;
+        }
+        if (!requested || !(requested->pcr_select[pcr_index / 8] & bit) ||
+            digest_index >= digests.count) {
+          LOG(ERROR) << __func__ << ": TPM returned an unexpected PCR.";
+          return TPM_RC_FAILURE;
+        }
+        requested->pcr_select[pcr_index / 8] &= ~bit;
+        values[selection.hash][pcr_index] =
+            StringFrom_TPM2B_DIGEST(digests.digests[digest_index++]);
+      }
+    }
+    if (digest_index == 0) {
+      LOG(ERROR) << __func__ << ": TPM did not return the requested PCR";
+      return TPM_RC_FAILURE;
+    }
+  }
+
+  pcr_values->clear();
+  for (TPM_ALG_ID hash_alg : hash_algs) {
+    std::vector<std::string>& bank_values = (*pcr_values)[hash_alg];
+    for (int pcr_index : pcr_indexes) {
+      bank_values.push_back(values[hash_alg][pcr_index]);
+    }
   }
-  CHECK_GE(pcr_values.count, 1U);
-  pcr_value->assign(StringFrom_TPM2B_DIGEST(pcr_values.digests[0]));
   return TPM_RC_SUCCESS;
 }
 
@@ -441,6 +667,9 @@ TPM_RC TpmUtilityImpl::AsymmetricEncrypt(TPM_HANDLE key_handle,
                << ": Cannot use RSAES for encryption with a restricted key";
     return SAPI_RC_BAD_PARAMETER;
   }
+  if (use_software_public_key_operations_) {
+    return SoftwareEncrypt(public_area, in_scheme, plaintext, ciphertext);
+  }
   std::string key_name;
   result = ComputeKeyName(public_area, &key_name);
   if (result != TPM_RC_SUCCESS) {
@@ -537,75 +766,55 @@ TPM_RC TpmUtilityImpl::Sign(TPM_HANDLE key_handle,
                             const std::string& plaintext,
                             AuthorizationDelegate* delegate,
                             std::string* signature) {
-  TPMT_SIG_SCHEME in_scheme;
   if (hash_alg == TPM_ALG_NULL) {
     hash_alg = TPM_ALG_SHA256;
   }
-  if (scheme == TPM_ALG_RSAPSS) {
-    in_scheme.scheme = TPM_ALG_RSAPSS;
-    in_scheme.details.rsapss.hash_alg = hash_alg;
-  } else if (scheme == TPM_ALG_RSASSA || scheme == TPM_ALG_NULL) {
-    in_scheme.scheme = TPM_ALG_RSASSA;
-    in_scheme.details.rsassa.hash_alg = hash_alg;
-  } else {
-    LOG(ERROR) << __func__ << ": Invalid Signing scheme used.";
-    return SAPI_RC_BAD_PARAMETER;
-  }
-  TPM_RC result;
-  if (delegate == nullptr) {
-    result = SAPI_RC_INVALID_SESSIONS;
-    LOG(ERROR) << __func__
-               << ": This method needs a valid authorization delegate: "
-               << GetErrorString(result);
-    return result;
+  return SignDigest(key_handle, scheme, hash_alg,
+                    HashString(plaintext, hash_alg), delegate, signature);
+}
+
+TPM_RC TpmUtilityImpl::SignFile(TPM_HANDLE key_handle,
+                                TPM_ALG_ID scheme,
+                                TPM_ALG_ID hash_alg,
+                                int fd,
+                                AuthorizationDelegate* delegate,
+                                std::string* signature) {
+  if (hash_alg == TPM_ALG_NULL) {
+    hash_alg = TPM_ALG_SHA256;
   }
-  TPMT_PUBLIC public_area;
-  result = GetKeyPublicArea(key_handle, &public_area);
-  if (result) {
-    LOG(ERROR) << __func__ << ": Error finding public area for: " << key_handle;
-    return result;
-  } else if (public_area.type != TPM_ALG_RSA) {
-    LOG(ERROR) << __func__ << ": Key handle given is not an RSA key";
-    return SAPI_RC_BAD_PARAMETER;
-  } else if ((public_area.object_attributes & kSign) == 0) {
-    LOG(ERROR) << __func__ << ": Key handle given is not a signging key";
+  const EVP_MD* digest_type = GetOpenSSLDigest(hash_alg);
+  if (!digest_type) {
+    LOG(ERROR) << __func__ << ": Unsupported hash algorithm.";
     return SAPI_RC_BAD_PARAMETER;
-  } else if ((public_area.object_attributes & kRestricted) != 0) {
-    LOG(ERROR) << __func__ << ": Key handle references a restricted key";
-    return SAPI_RC_BAD_PARAMETER;
-  }
-
-  std::string key_name;
-  result = ComputeKeyName(public_area, &key_name);
-  if (result) {
-    LOG(ERROR) << __func__ << ": Error computing key name for: " << key_handle;
-    return result;
   }
-  std::string digest = HashString(plaintext, hash_alg);
-  TPM2B_DIGEST tpm_digest = Make_TPM2B_DIGEST(digest);
-  TPMT_SIGNATURE signature_out;
-  TPMT_TK_HASHCHECK validation;
-  validation.tag = TPM_ST_HASHCHECK;
-  validation.hierarchy = TPM_RH_NULL;
-  validation.digest.size = 0;
-  result =
-      factory_.GetTpm()->SignSync(key_handle, key_name, tpm_digest, in_scheme,
-                                  validation, &signature_out, delegate);
-  if (result) {
-    LOG(ERROR) << __func__
-               << ": Error signing digest: " << GetErrorString(result);
-    return result;
+  base::File file(HANDLE_EINTR(dup(fd)));
+  if (!file.IsValid()) {
+    PLOG(ERROR) << __func__ << ": Error duplicating file descriptor";
+    return SAPI_RC_BAD_PARAMETER;
   }
-  if (scheme == TPM_ALG_RSAPSS) {
-    signature->resize(signature_out.signature.rsapss.sig.size);
-    signature->assign(
-        StringFrom_TPM2B_PUBLIC_KEY_RSA(signature_out.signature.rsapss.sig));
-  } else {
-    signature->resize(signature_out.signature.rsassa.sig.size);
-    signature->assign(
-        StringFrom_TPM2B_PUBLIC_KEY_RSA(signature_out.signature.rsassa.sig));
+  // The file is hashed straight from the mapping, so large files are never
+  // copied into memory. mmap() refuses empty files, which hash as "".
+  base::MemoryMappedFile mapped_file;
+  const uint8_t* data = nullptr;
+  size_t length = 0;
+  if (file.GetLength() > 0) {
+    if (!mapped_file.Initialize(std::move(file))) {
+      LOG(ERROR) << __func__ << ": Error mapping file to sign.";
+      return SAPI_RC_BAD_PARAMETER;
+    }
+    data = mapped_file.data();
+    length = mapped_file.length();
+  }
+  uint8_t digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_length = 0;
+  if (!EVP_Digest(data, length, digest, &digest_length, digest_type,
+                  nullptr)) {
+    LOG(ERROR) << __func__ << ": Error hashing file to sign.";
+    return TPM_RC_FAILURE;
   }
-  return TPM_RC_SUCCESS;
+  return SignDigest(key_handle, scheme, hash_alg,
+                    std::string(reinterpret_cast<char*>(digest), digest_length),
+                    delegate, signature);
 }
 
 TPM_RC TpmUtilityImpl::Verify(TPM_HANDLE key_handle,
@@ -619,8 +828,9 @@ TPM_RC TpmUtilityImpl::Verify(TPM_HANDLE key_handle,
   if (return_code) {
     LOG(ERROR) << __func__ << ": Error finding public area for: " << key_handle;
     return return_code;
-  } else if (public_area.type != TPM_ALG_RSA) {
-    LOG(ERROR) << __func__ << ": Key handle given is not an RSA key";
+  } else if (public_area.type != TPM_ALG_RSA &&
+             public_area.type != TPM_ALG_ECC) {
+    LOG(ERROR) << __func__ << ": Key handle given is not an RSA or ECC key";
     return SAPI_RC_BAD_PARAMETER;
   } else if ((public_area.object_attributes & kSign) == 0) {
     LOG(ERROR) << __func__ << ": Key handle given is not a signing key";
@@ -635,7 +845,25 @@ TPM_RC TpmUtilityImpl::Verify(TPM_HANDLE key_handle,
   }
 
   TPMT_SIGNATURE signature_in;
-  if (scheme == TPM_ALG_RSAPSS) {
+  if (public_area.type == TPM_ALG_ECC) {
+    if (scheme != TPM_ALG_NULL && scheme != TPM_ALG_ECDSA) {
+      LOG(ERROR) << __func__ << ": Invalid scheme used to verify signature.";
+      return SAPI_RC_BAD_PARAMETER;
+    }
+    // The signature is r || s, with both halves the same size.
+    size_t half_size = signature.size() / 2;
+    if (signature.empty() || signature.size() % 2 != 0 ||
+        half_size > MAX_ECC_KEY_BYTES) {
+      LOG(ERROR) << __func__ << ": Malformed ECDSA signature.";
+      return SAPI_RC_BAD_PARAMETER;
+    }
+    signature_in.sig_alg = TPM_ALG_ECDSA;
+    signature_in.signature.ecdsa.hash = hash_alg;
+    signature_in.signature.ecdsa.signature_r =
+        Make_TPM2B_ECC_PARAMETER(signature.substr(0, half_size));
+    signature_in.signature.ecdsa.signature_s =
+        Make_TPM2B_ECC_PARAMETER(signature.substr(half_size));
+  } else if (scheme == TPM_ALG_RSAPSS) {
     signature_in.sig_alg = TPM_ALG_RSAPSS;
     signature_in.signature.rsapss.hash = hash_alg;
     signature_in.signature.rsapss.sig = Make_TPM2B_PUBLIC_KEY_RSA(signature);
@@ -647,6 +875,11 @@ TPM_RC TpmUtilityImpl::Verify(TPM_HANDLE key_handle,
     LOG(ERROR) << __func__ << ": Invalid scheme used to verify signature.";
     return SAPI_RC_BAD_PARAMETER;
   }
+  // Only RSA is verified in software; ECDSA goes to the TPM.
+  if (use_software_public_key_operations_ && public_area.type == TPM_ALG_RSA) {
+    return SoftwareVerify(public_area, signature_in.sig_alg, hash_alg,
+                          plaintext, signature);
+  }
   std::string key_name;
   TPMT_TK_VERIFIED verified;
   std::string digest = HashString(plaintext, hash_alg);
@@ -664,6 +897,10 @@ TPM_RC TpmUtilityImpl::Verify(TPM_HANDLE key_handle,
   return TPM_RC_SUCCESS;
 }
 
+void TpmUtilityImpl::SetUseSoftwarePublicKeyOperations(bool enabled) {
+  use_software_public_key_operations_ = enabled;
+}
+
 TPM_RC TpmUtilityImpl::CertifyCreation(TPM_HANDLE key_handle,
                                        const std::string& creation_blob) {
   TPM2B_CREATION_DATA creation_data;
@@ -769,20 +1006,67 @@ TPM_RC TpmUtilityImpl::ImportRSAKey(AsymmetricKeyUsage key_type,
   }
   TPMT_PUBLIC public_area = CreateDefaultPublicArea(TPM_ALG_RSA);
   public_area.object_attributes = kUserWithAuth | kNoDA;
-  switch (key_type) {
-    case AsymmetricKeyUsage::kDecryptKey:
-      public_area.object_attributes |= kDecrypt;
-      break;
-    case AsymmetricKeyUsage::kSignKey:
-      public_area.object_attributes |= kSign;
-      break;
-    case AsymmetricKeyUsage::kDecryptAndSignKey:
-      public_area.object_attributes |= (kSign | kDecrypt);
-      break;
-  }
+  SetKeyUsageAttributes(key_type, &public_area);
   public_area.parameters.rsa_detail.key_bits = modulus.size() * 8;
   public_area.parameters.rsa_detail.exponent = public_exponent;
   public_area.unique.rsa = Make_TPM2B_PUBLIC_KEY_RSA(modulus);
+  TPMT_SENSITIVE in_sensitive;
+  in_sensitive.sensitive_type = TPM_ALG_RSA;
+  in_sensitive.auth_value = Make_TPM2B_DIGEST(password);
+  in_sensitive.seed_value = Make_TPM2B_DIGEST("");
+  in_sensitive.sensitive.rsa = Make_TPM2B_PRIVATE_KEY_RSA(prime_factor);
+  return ImportKey(parent_name, public_area, in_sensitive, delegate, key_blob);
+}
+
+TPM_RC TpmUtilityImpl::ImportECCKey(AsymmetricKeyUsage key_type,
+                                    TPMI_ECC_CURVE curve_id,
+                                    const std::string& public_point_x,
+                                    const std::string& public_point_y,
+                                    const std::string& private_value,
+                                    const std::string& password,
+                                    AuthorizationDelegate* delegate,
+                                    std::string* key_blob) {
+  TPM_RC result;
+  if (delegate == nullptr) {
+    result = SAPI_RC_INVALID_SESSIONS;
+    LOG(ERROR) << __func__
+               << ": This method needs a valid authorization delegate: "
+               << GetErrorString(result);
+    return result;
+  }
+  if (public_point_x.size() > MAX_ECC_KEY_BYTES ||
+      public_point_y.size() > MAX_ECC_KEY_BYTES ||
+      private_value.size() > MAX_ECC_KEY_BYTES) {
+    LOG(ERROR) << __func__ << ": ECC key parameters are too large.";
+    return SAPI_RC_BAD_PARAMETER;
+  }
+  std::string parent_name;
+  result = GetKeyName(kRSAStorageRootKey, &parent_name);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Error getting Key name for RSA-SRK: "
+               << GetErrorString(result);
+    return result;
+  }
+  TPMT_PUBLIC public_area = CreateDefaultPublicArea(TPM_ALG_ECC);
+  public_area.object_attributes = kUserWithAuth | kNoDA;
+  SetKeyUsageAttributes(key_type, &public_area);
+  public_area.parameters.ecc_detail.curve_id = curve_id;
+  public_area.unique.ecc.x = Make_TPM2B_ECC_PARAMETER(public_point_x);
+  public_area.unique.ecc.y = Make_TPM2B_ECC_PARAMETER(public_point_y);
+  TPMT_SENSITIVE in_sensitive;
+  in_sensitive.sensitive_type = TPM_ALG_ECC;
+  in_sensitive.auth_value = Make_TPM2B_DIGEST(password);
+  in_sensitive.seed_value = Make_TPM2B_DIGEST("");
+  in_sensitive.sensitive.ecc = Make_TPM2B_ECC_PARAMETER(private_value);
+  return ImportKey(parent_name, public_area, in_sensitive, delegate, key_blob);
+}
+
+TPM_RC TpmUtilityImpl::ImportKey(const std::string& parent_name,
+                                 const TPMT_PUBLIC& public_area,
+                                 const TPMT_SENSITIVE& in_sensitive,
+                                 AuthorizationDelegate* delegate,
+                                 std::string* key_blob) {
+  TPM_RC result;
   TPM2B_DATA encryption_key;
   encryption_key.size = kAesKeySize;
   CHECK_EQ(RAND_bytes(encryption_key.buffer, encryption_key.size), 1)
@@ -793,11 +1077,6 @@ TPM_RC TpmUtilityImpl::ImportRSAKey(AsymmetricKeyUsage key_type,
   symmetric_alg.algorithm = TPM_ALG_AES;
   symmetric_alg.key_bits.aes = kAesKeySize * 8;
   symmetric_alg.mode.aes = TPM_ALG_CFB;
-  TPMT_SENSITIVE in_sensitive;
-  in_sensitive.sensitive_type = TPM_ALG_RSA;
-  in_sensitive.auth_value = Make_TPM2B_DIGEST(password);
-  in_sensitive.seed_value = Make_TPM2B_DIGEST("");
-  in_sensitive.sensitive.rsa = Make_TPM2B_PRIVATE_KEY_RSA(prime_factor);
   TPM2B_PRIVATE private_data;
   result = EncryptPrivateData(in_sensitive, public_area, &private_data,
                               &encryption_key);
@@ -851,81 +1130,137 @@ TPM_RC TpmUtilityImpl::CreateRSAKeyPair(AsymmetricKeyUsage key_type,
                << GetErrorString(result);
     return result;
   }
-  TPMT_PUBLIC public_area = CreateDefaultPublicArea(TPM_ALG_RSA);
-  public_area.auth_policy = Make_TPM2B_DIGEST(policy_digest);
-  public_area.object_attributes |=
-      (kSensitiveDataOrigin | kUserWithAuth | kNoDA);
-  switch (key_type) {
-    case AsymmetricKeyUsage::kDecryptKey:
-      public_area.object_attributes |= kDecrypt;
-      break;
-    case AsymmetricKeyUsage::kSignKey:
-      public_area.object_attributes |= kSign;
-      break;
-    case AsymmetricKeyUsage::kDecryptAndSignKey:
-      public_area.object_attributes |= (kSign | kDecrypt);
-      break;
-  }
-  if (use_only_policy_authorization && !policy_digest.empty()) {
-    public_area.object_attributes |= kAdminWithPolicy;
-    public_area.object_attributes &= (~kUserWithAuth);
-  }
-  public_area.parameters.rsa_detail.key_bits = modulus_bits;
-  public_area.parameters.rsa_detail.exponent = public_exponent;
-  TPML_PCR_SELECTION creation_pcrs = {};
+  TPMT_PUBLIC public_area =
+      CreateRSAKeyTemplate(key_type, modulus_bits, public_exponent,
+                           policy_digest, use_only_policy_authorization);
   if (creation_pcr_index == kNoCreationPCR) {
-    creation_pcrs.count = 0;
-  } else if (creation_pcr_index < 0 ||
-             creation_pcr_index > (PCR_SELECT_MIN * 8)) {
-    LOG(ERROR) << __func__
-               << ": Creation PCR index is not within the allocated bank.";
-    return SAPI_RC_BAD_PARAMETER;
-  } else {
-    creation_pcrs.count = 1;
-    creation_pcrs.pcr_selections[0].hash = TPM_ALG_SHA256;
-    creation_pcrs.pcr_selections[0].sizeof_select = PCR_SELECT_MIN;
-    creation_pcrs.pcr_selections[0].pcr_select[creation_pcr_index / 8] =
-        1 << (creation_pcr_index % 8);
+    std::string pool_entry =
+        GetRSAKeyPoolEntry(parent_name, public_area, password);
+    std::string pooled_creation_blob;
+    if (key_pool_->Take(pool_entry, key_blob, &pooled_creation_blob)) {
+      if (creation_blob) {
+        *creation_blob = pooled_creation_blob;
+      }
+      return TPM_RC_SUCCESS;
+    }
   }
-  TPMS_SENSITIVE_CREATE sensitive;
-  sensitive.user_auth = Make_TPM2B_DIGEST(password);
-  sensitive.data = Make_TPM2B_SENSITIVE_DATA("");
-  TPM2B_SENSITIVE_CREATE sensitive_create =
-      Make_TPM2B_SENSITIVE_CREATE(sensitive);
-  TPM2B_DATA outside_info = Make_TPM2B_DATA("");
-  TPM2B_PUBLIC out_public;
-  out_public.size = 0;
-  TPM2B_PRIVATE out_private;
-  out_private.size = 0;
-  TPM2B_CREATION_DATA creation_data;
-  TPM2B_DIGEST creation_hash;
-  TPMT_TK_CREATION creation_ticket;
-  result = factory_.GetTpm()->CreateSync(
-      kRSAStorageRootKey, parent_name, sensitive_create,
-      Make_TPM2B_PUBLIC(public_area), outside_info, creation_pcrs, &out_private,
-      &out_public, &creation_data, &creation_hash, &creation_ticket, delegate);
+  TPML_PCR_SELECTION creation_pcrs;
+  result = GetCreationPCRSelection(creation_pcr_index, &creation_pcrs);
   if (result != TPM_RC_SUCCESS) {
-    LOG(ERROR) << __func__
-               << ": Error creating RSA key: " << GetErrorString(result);
     return result;
   }
-  if (!factory_.GetBlobParser()->SerializeKeyBlob(out_public, out_private,
-                                                  key_blob)) {
-    return SAPI_RC_BAD_TCTI_STRUCTURE;
-  }
-  if (creation_blob) {
-    if (!factory_.GetBlobParser()->SerializeCreationBlob(
-            creation_data, creation_hash, creation_ticket, creation_blob)) {
-      return SAPI_RC_BAD_TCTI_STRUCTURE;
-    }
+  return CreateKey(parent_name, public_area, password, creation_pcrs, delegate,
+                   key_blob, creation_blob);
+}
+
+TPM_RC TpmUtilityImpl::PregenerateRSAKeyPairs(
+    AsymmetricKeyUsage key_type,
+    int modulus_bits,
+    uint32_t public_exponent,
+    const std::string& password,
+    const std::string& policy_digest,
+    bool use_only_policy_authorization,
+    size_t num_keys,
+    AuthorizationDelegate* delegate) {
+  TPM_RC result;
+  if (delegate == nullptr) {
+    result = SAPI_RC_INVALID_SESSIONS;
+    LOG(ERROR) << __func__
+               << ": This method needs a valid authorization delegate: "
+               << GetErrorString(result);
+    return result;
+  }
+  std::string parent_name;
+  result = GetKeyName(kRSAStorageRootKey, &parent_name);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Error getting Key name for RSA-SRK: "
+               << GetErrorString(result);
+    return result;
+  }
+  TPMT_PUBLIC public_area =
+      CreateRSAKeyTemplate(key_type, modulus_bits, public_exponent,
+                           policy_digest, use_only_policy_authorization);
+  std::string pool_entry =
+      GetRSAKeyPoolEntry(parent_name, public_area, password);
+  TPML_PCR_SELECTION creation_pcrs = {};
+  while (key_pool_->GetCount(pool_entry) < num_keys) {
+    std::string key_blob;
+    std::string creation_blob;
+    result = CreateKey(parent_name, public_area, password, creation_pcrs,
+                       delegate, &key_blob, &creation_blob);
+    if (result != TPM_RC_SUCCESS) {
+      return result;
+    }
+    key_pool_->Add(pool_entry, key_blob, creation_blob);
   }
   return TPM_RC_SUCCESS;
 }
 
+TPM_RC TpmUtilityImpl::CreateECCKeyPair(AsymmetricKeyUsage key_type,
+                                        TPMI_ECC_CURVE curve_id,
+                                        const std::string& password,
+                                        const std::string& policy_digest,
+                                        bool use_only_policy_authorization,
+                                        int creation_pcr_index,
+                                        AuthorizationDelegate* delegate,
+                                        std::string* key_blob,
+                                        std::string* creation_blob) {
+  CHECK(key_blob);
+  TPM_RC result;
+  if (delegate == nullptr) {
+    result = SAPI_RC_INVALID_SESSIONS;
+    LOG(ERROR) << __func__
+               << ": This method needs a valid authorization delegate: "
+               << GetErrorString(result);
+    return result;
+  }
+  std::unique_ptr<TpmState> tpm_state(factory_.GetTpmState());
+  result = tpm_state->Initialize();
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": " << GetErrorString(result);
+    return result;
+  }
+  if (!tpm_state->IsECCSupported()) {
+    LOG(ERROR) << __func__ << ": ECC is not supported by the TPM.";
+    return TPM_RC_ASYMMETRIC;
+  }
+  std::string parent_name;
+  result = GetKeyName(kRSAStorageRootKey, &parent_name);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Error getting Key name for RSA-SRK: "
+               << GetErrorString(result);
+    return result;
+  }
+  TPML_PCR_SELECTION creation_pcrs;
+  result = GetCreationPCRSelection(creation_pcr_index, &creation_pcrs);
+  if (result != TPM_RC_SUCCESS) {
+    return result;
+  }
+  TPMT_PUBLIC public_area = CreateKeyTemplate(
+      TPM_ALG_ECC, key_type, policy_digest, use_only_policy_authorization);
+  public_area.parameters.ecc_detail.curve_id = curve_id;
+  return CreateKey(parent_name, public_area, password, creation_pcrs, delegate,
+                   key_blob, creation_blob);
+}
+
 TPM_RC TpmUtilityImpl::LoadKey(const std::string& key_blob,
                                AuthorizationDelegate* delegate,
                                TPM_HANDLE* key_handle) {
   CHECK(key_handle);
+  std::vector<TPM_HANDLE> key_handles;
+  TPM_RC result = LoadKeys({key_blob}, delegate, &key_handles);
+  if (result != TPM_RC_SUCCESS) {
+    return result;
+  }
+  *key_handle = key_handles[0];
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC TpmUtilityImpl::LoadKeys(const std::vector<std::string>& key_blobs,
+                                AuthorizationDelegate* delegate,
+                                std::vector<TPM_HANDLE>* key_handles) {
+  CHECK(key_handles);
+  key_handles->clear();
   TPM_RC result;
   if (delegate == nullptr) {
     result = SAPI_RC_INVALID_SESSIONS;
@@ -934,6 +1269,17 @@ TPM_RC TpmUtilityImpl::LoadKey(const std::string& key_blob,
                << GetErrorString(result);
     return result;
   }
+  // Parse everything first so a malformed blob fails the batch before any
+  // TPM object slots are used.
+  std::vector<TPM2B_PUBLIC> in_public(key_blobs.size());
+  std::vector<TPM2B_PRIVATE> in_private(key_blobs.size());
+  for (size_t i = 0; i < key_blobs.size(); ++i) {
+    if (!factory_.GetBlobParser()->ParseKeyBlob(key_blobs[i], &in_public[i],
+                                                &in_private[i])) {
+      LOG(ERROR) << __func__ << ": Error parsing key blob " << i;
+      return SAPI_RC_BAD_TCTI_STRUCTURE;
+    }
+  }
   std::string parent_name;
   result = GetKeyName(kRSAStorageRootKey, &parent_name);
   if (result != TPM_RC_SUCCESS) {
@@ -941,20 +1287,24 @@ TPM_RC TpmUtilityImpl::LoadKey(const std::string& key_blob,
                << ": Error getting parent key name: " << GetErrorString(result);
     return result;
   }
-  TPM2B_PUBLIC in_public;
-  TPM2B_PRIVATE in_private;
-  if (!factory_.GetBlobParser()->ParseKeyBlob(key_blob, &in_public,
-                                              &in_private)) {
-    return SAPI_RC_BAD_TCTI_STRUCTURE;
+  // Keys loaded so far are flushed again if a later load fails.
+  std::vector<std::unique_ptr<ScopedKeyHandle>> loaded_keys;
+  for (size_t i = 0; i < key_blobs.size(); ++i) {
+    std::unique_ptr<ScopedKeyHandle> key(new ScopedKeyHandle(factory_));
+    TPM2B_NAME key_name;
+    key_name.size = 0;
+    result = factory_.GetTpm()->LoadSync(kRSAStorageRootKey, parent_name,
+                                         in_private[i], in_public[i],
+                                         key->ptr(), &key_name, delegate);
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << __func__ << ": Error loading key " << i << ": "
+                 << GetErrorString(result);
+      return result;
+    }
+    loaded_keys.push_back(std::move(key));
   }
-  TPM2B_NAME key_name;
-  key_name.size = 0;
-  result =
-      factory_.GetTpm()->LoadSync(kRSAStorageRootKey, parent_name, in_private,
-                                  in_public, key_handle, &key_name, delegate);
-  if (result != TPM_RC_SUCCESS) {
-    LOG(ERROR) << __func__ << ": Error loading key: " << GetErrorString(result);
-    return result;
+  for (auto& key : loaded_keys) {
+    key_handles->push_back(key->release());
   }
   return TPM_RC_SUCCESS;
 }
@@ -981,6 +1331,11 @@ TPM_RC TpmUtilityImpl::GetKeyName(TPM_HANDLE handle, std::string* name) {
 TPM_RC TpmUtilityImpl::GetKeyPublicArea(TPM_HANDLE handle,
                                         TPMT_PUBLIC* public_data) {
   CHECK(public_data);
+  auto it = object_public_area_map_.find(handle);
+  if (it != object_public_area_map_.end()) {
+    *public_data = it->second;
+    return TPM_RC_SUCCESS;
+  }
   TPM2B_NAME out_name;
   TPM2B_PUBLIC public_area;
   TPM2B_NAME qualified_name;
@@ -993,6 +1348,11 @@ TPM_RC TpmUtilityImpl::GetKeyPublicArea(TPM_HANDLE handle,
     return return_code;
   }
   *public_data = public_area.public_area;
+  // Transient handles are reused once flushed, but a persistent handle keeps
+  // naming the same object until it is evicted.
+  if ((handle >> HR_SHIFT) == TPM_HT_PERSISTENT) {
+    object_public_area_map_[handle] = *public_data;
+  }
   return TPM_RC_SUCCESS;
 }
 
@@ -1064,6 +1424,20 @@ TPM_RC TpmUtilityImpl::UnsealData(const std::string& sealed_data,
                << GetErrorString(result);
     return result;
   }
+  std::string cache_key;
+  if (!unseal_cache_ttl_.is_zero()) {
+    cache_key = crypto::SHA256HashString(sealed_data);
+    auto it = unseal_cache_.find(cache_key);
+    if (it != unseal_cache_.end()) {
+      if (base::TimeTicks::Now() < it->second.expiration) {
+        *unsealed_data = it->second.data;
+        return TPM_RC_SUCCESS;
+      }
+      OPENSSL_cleanse(base::string_as_array(&it->second.data),
+                      it->second.data.size());
+      unseal_cache_.erase(it);
+    }
+  }
   TPM_HANDLE object_handle;
   std::unique_ptr<AuthorizationDelegate> password_delegate =
       factory_.GetPasswordAuthorization("");
@@ -1090,9 +1464,21 @@ TPM_RC TpmUtilityImpl::UnsealData(const std::string& sealed_data,
     return result;
   }
   *unsealed_data = StringFrom_TPM2B_SENSITIVE_DATA(out_data);
+  if (!unseal_cache_ttl_.is_zero()) {
+    UnsealCacheEntry& entry = unseal_cache_[cache_key];
+    entry.data = *unsealed_data;
+    entry.expiration = base::TimeTicks::Now() + unseal_cache_ttl_;
+  }
   return TPM_RC_SUCCESS;
 }
 
+void TpmUtilityImpl::EnableUnsealCache(base::TimeDelta ttl) {
+  unseal_cache_ttl_ = ttl;
+  if (ttl.is_zero()) {
+    ClearUnsealCache();
+  }
+}
+
 TPM_RC TpmUtilityImpl::StartSession(HmacSession* session) {
   TPM_RC result = session->StartUnboundSession(true /* enable_encryption */);
   if (result != TPM_RC_SUCCESS) {
@@ -1108,13 +1494,7 @@ TPM_RC TpmUtilityImpl::GetPolicyDigestForPcrValue(int pcr_index,
                                                   const std::string& pcr_value,
                                                   std::string* policy_digest) {
   CHECK(policy_digest);
-  std::unique_ptr<PolicySession> session = factory_.GetTrialSession();
-  TPM_RC result = session->StartUnboundSession(false);
-  if (result != TPM_RC_SUCCESS) {
-    LOG(ERROR) << __func__ << ": Error starting unbound trial session: "
-               << GetErrorString(result);
-    return result;
-  }
+  TPM_RC result;
   std::string mutable_pcr_value;
   if (pcr_value.empty()) {
     result = ReadPCR(pcr_index, &mutable_pcr_value);
@@ -1126,6 +1506,19 @@ TPM_RC TpmUtilityImpl::GetPolicyDigestForPcrValue(int pcr_index,
   } else {
     mutable_pcr_value = pcr_value;
   }
+  auto key = std::make_pair(pcr_index, mutable_pcr_value);
+  auto iter = pcr_policy_digests_.find(key);
+  if (iter != pcr_policy_digests_.end()) {
+    *policy_digest = iter->second;
+    return TPM_RC_SUCCESS;
+  }
+  std::unique_ptr<PolicySession> session = factory_.GetTrialSession();
+  result = session->StartUnboundSession(false);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Error starting unbound trial session: "
+               << GetErrorString(result);
+    return result;
+  }
   result = session->PolicyPCR(pcr_index, mutable_pcr_value);
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << __func__ << ": Error restricting policy to PCR value: "
@@ -1138,9 +1531,118 @@ TPM_RC TpmUtilityImpl::GetPolicyDigestForPcrValue(int pcr_index,
                << ": Error getting policy digest: " << GetErrorString(result);
     return result;
   }
+  pcr_policy_digests_[key] = *policy_digest;
   return TPM_RC_SUCCESS;
 }
 
+TPM_RC TpmUtilityImpl::GetPolicyDigestForAuthority(
+    const std::string& authority_modulus,
+    const std::string& policy_ref,
+    std::string* policy_digest) {
+  CHECK(policy_digest);
+  std::string key_name;
+  TPM_RC result =
+      ComputeKeyName(CreateAuthorityPublicArea(authority_modulus), &key_name);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Error computing authority key name: "
+               << GetErrorString(result);
+    return result;
+  }
+  PolicyTemplate policy;
+  policy.AddAuthorize(key_name, policy_ref);
+  return policy.ComputeDigest(policy_digest);
+}
+
+TPM_RC TpmUtilityImpl::SignPolicyApproval(TPM_HANDLE authority_key_handle,
+                                          const std::string& approved_policy,
+                                          const std::string& policy_ref,
+                                          AuthorizationDelegate* delegate,
+                                          std::string* approval_signature) {
+  CHECK(approval_signature);
+  // TPM2_PolicyAuthorize checks a signature over
+  // SHA256(approved_policy || policy_ref).
+  return Sign(authority_key_handle, TPM_ALG_RSASSA, TPM_ALG_SHA256,
+              approved_policy + policy_ref, delegate, approval_signature);
+}
+
+TPM_RC TpmUtilityImpl::UnsealDataWithApprovedPolicy(
+    const std::string& sealed_data,
+    int pcr_index,
+    const std::string& authority_modulus,
+    const std::string& policy_ref,
+    const std::string& approval_signature,
+    std::string* unsealed_data) {
+  CHECK(unsealed_data);
+  std::unique_ptr<PolicySession> session = factory_.GetPolicySession();
+  TPM_RC result = session->StartUnboundSession(true);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Error starting policy session: "
+               << GetErrorString(result);
+    return result;
+  }
+  result = session->PolicyPCR(pcr_index, "");
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Error restricting policy to PCR value: "
+               << GetErrorString(result);
+    return result;
+  }
+  std::string approved_policy;
+  result = session->GetDigest(&approved_policy);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__
+               << ": Error getting policy digest: " << GetErrorString(result);
+    return result;
+  }
+  // The ticket from TPM2_VerifySignature only satisfies PolicyAuthorize if
+  // the key is not in the null hierarchy, so the public key is loaded in the
+  // owner hierarchy.
+  TPMT_PUBLIC public_area = CreateAuthorityPublicArea(authority_modulus);
+  std::string key_name;
+  result = ComputeKeyName(public_area, &key_name);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Error computing authority key name: "
+               << GetErrorString(result);
+    return result;
+  }
+  TPM2B_SENSITIVE in_private;
+  in_private.size = 0;
+  TPM_HANDLE key_handle;
+  TPM2B_NAME loaded_name;
+  result = factory_.GetTpm()->LoadExternalSync(
+      in_private, Make_TPM2B_PUBLIC(public_area), TPM_RH_OWNER, &key_handle,
+      &loaded_name, nullptr);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Error loading authority key: "
+               << GetErrorString(result);
+    return result;
+  }
+  ScopedKeyHandle authority_key(factory_, key_handle);
+  TPMT_SIGNATURE signature;
+  signature.sig_alg = TPM_ALG_RSASSA;
+  signature.signature.rsassa.hash = TPM_ALG_SHA256;
+  signature.signature.rsassa.sig =
+      Make_TPM2B_PUBLIC_KEY_RSA(approval_signature);
+  TPMT_TK_VERIFIED ticket;
+  result = factory_.GetTpm()->VerifySignatureSync(
+      authority_key.get(), key_name,
+      Make_TPM2B_DIGEST(
+          crypto::SHA256HashString(approved_policy + policy_ref)),
+      signature, &ticket, nullptr);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Policy approval does not verify: "
+               << GetErrorString(result);
+    return result;
+  }
+  result = session->PolicyAuthorize(approved_policy, policy_ref, key_name,
+                                    ticket);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": Error authorizing approved policy: "
+               << GetErrorString(result);
+    return result;
+  }
+  return UnsealData(sealed_data, session->GetDelegate(), unsealed_data);
+}
+
 TPM_RC TpmUtilityImpl::DefineNVSpace(uint32_t index,
                                      size_t num_bytes,
                                      TPMA_NV attributes,
@@ -1237,18 +1739,15 @@ TPM_RC TpmUtilityImpl::LockNVSpace(uint32_t index,
                << GetErrorString(result);
     return result;
   }
+  uint32_t nv_index;
   std::string nv_name;
-  result = GetNVSpaceName(index, &nv_name);
+  TPMI_RH_NV_AUTH auth_target;
+  std::string auth_target_name;
+  result = GetNVAccessTarget(index, using_owner_authorization, &nv_index,
+                             &nv_name, &auth_target, &auth_target_name);
   if (result != TPM_RC_SUCCESS) {
     return result;
   }
-  uint32_t nv_index = NV_INDEX_FIRST + index;
-  TPMI_RH_NV_AUTH auth_target = nv_index;
-  std::string auth_target_name = nv_name;
-  if (using_owner_authorization) {
-    auth_target = TPM_RH_OWNER;
-    auth_target_name = NameFromHandle(TPM_RH_OWNER);
-  }
   auto it = nvram_public_area_map_.find(index);
   if (lock_read) {
     result = factory_.GetTpm()->NV_ReadLockSync(auth_target, auth_target_name,
@@ -1297,18 +1796,15 @@ TPM_RC TpmUtilityImpl::WriteNVSpace(uint32_t index,
                << GetErrorString(result);
     return result;
   }
+  uint32_t nv_index;
   std::string nv_name;
-  result = GetNVSpaceName(index, &nv_name);
+  TPMI_RH_NV_AUTH auth_target;
+  std::string auth_target_name;
+  result = GetNVAccessTarget(index, using_owner_authorization, &nv_index,
+                             &nv_name, &auth_target, &auth_target_name);
   if (result != TPM_RC_SUCCESS) {
     return result;
   }
-  uint32_t nv_index = NV_INDEX_FIRST + index;
-  TPMI_RH_NV_AUTH auth_target = nv_index;
-  std::string auth_target_name = nv_name;
-  if (using_owner_authorization) {
-    auth_target = TPM_RH_OWNER;
-    auth_target_name = NameFromHandle(TPM_RH_OWNER);
-  }
   if (extend) {
     result = factory_.GetTpm()->NV_ExtendSync(
         auth_target, auth_target_name, nv_index, nv_name,
@@ -1350,18 +1846,15 @@ TPM_RC TpmUtilityImpl::ReadNVSpace(uint32_t index,
                << GetErrorString(result);
     return result;
   }
+  uint32_t nv_index;
   std::string nv_name;
-  result = GetNVSpaceName(index, &nv_name);
+  TPMI_RH_NV_AUTH auth_target;
+  std::string auth_target_name;
+  result = GetNVAccessTarget(index, using_owner_authorization, &nv_index,
+                             &nv_name, &auth_target, &auth_target_name);
   if (result != TPM_RC_SUCCESS) {
     return result;
   }
-  uint32_t nv_index = NV_INDEX_FIRST + index;
-  TPMI_RH_NV_AUTH auth_target = nv_index;
-  std::string auth_target_name = nv_name;
-  if (using_owner_authorization) {
-    auth_target = TPM_RH_OWNER;
-    auth_target_name = NameFromHandle(TPM_RH_OWNER);
-  }
   TPM2B_MAX_NV_BUFFER data_buffer;
   data_buffer.size = 0;
   result = factory_.GetTpm()->NV_ReadSync(auth_target, auth_target_name,
@@ -1376,6 +1869,105 @@ TPM_RC TpmUtilityImpl::ReadNVSpace(uint32_t index,
   return TPM_RC_SUCCESS;
 }
 
+TPM_RC TpmUtilityImpl::WriteNVSpaceInChunks(uint32_t index,
+                                            uint32_t offset,
+                                            const std::string& nvram_data,
+                                            bool using_owner_authorization,
+                                            AuthorizationDelegate* delegate) {
+  TPM_RC result;
+  if (index > kMaxNVSpaceIndex) {
+    result = SAPI_RC_BAD_PARAMETER;
+    LOG(ERROR) << __func__
+               << ": Cannot write to non-volatile space with the given index: "
+               << GetErrorString(result);
+    return result;
+  }
+  uint32_t nv_index;
+  std::string nv_name;
+  TPMI_RH_NV_AUTH auth_target;
+  std::string auth_target_name;
+  result = GetNVAccessTarget(index, using_owner_authorization, &nv_index,
+                             &nv_name, &auth_target, &auth_target_name);
+  if (result != TPM_RC_SUCCESS) {
+    return result;
+  }
+  const size_t chunk_size = GetNVBufferMax();
+  for (size_t written = 0; written < nvram_data.size();
+       written += chunk_size) {
+    result = factory_.GetTpm()->NV_WriteSync(
+        auth_target, auth_target_name, nv_index, nv_name,
+        Make_TPM2B_MAX_NV_BUFFER(nvram_data.substr(written, chunk_size)),
+        offset + written, delegate);
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << __func__ << ": Error writing to non-volatile space at "
+                 << "offset " << offset + written << ": "
+                 << GetErrorString(result);
+      return result;
+    }
+    // The name of the index changes once it is first written.
+    auto it = nvram_public_area_map_.find(index);
+    if (it != nvram_public_area_map_.end() &&
+        !(it->second.attributes & TPMA_NV_WRITTEN)) {
+      it->second.attributes |= TPMA_NV_WRITTEN;
+      result = GetNVSpaceName(index, &nv_name);
+      if (result != TPM_RC_SUCCESS) {
+        return result;
+      }
+      if (!using_owner_authorization) {
+        auth_target_name = nv_name;
+      }
+    }
+  }
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC TpmUtilityImpl::ReadNVSpaceInChunks(uint32_t index,
+                                           uint32_t offset,
+                                           size_t num_bytes,
+                                           bool using_owner_authorization,
+                                           const NVReadCallback& callback,
+                                           AuthorizationDelegate* delegate) {
+  TPM_RC result;
+  if (index > kMaxNVSpaceIndex) {
+    result = SAPI_RC_BAD_PARAMETER;
+    LOG(ERROR) << __func__
+               << ": Cannot read from non-volatile space with the given index: "
+               << GetErrorString(result);
+    return result;
+  }
+  uint32_t nv_index;
+  std::string nv_name;
+  TPMI_RH_NV_AUTH auth_target;
+  std::string auth_target_name;
+  result = GetNVAccessTarget(index, using_owner_authorization, &nv_index,
+                             &nv_name, &auth_target, &auth_target_name);
+  if (result != TPM_RC_SUCCESS) {
+    return result;
+  }
+  const size_t max_chunk_size = GetNVBufferMax();
+  for (size_t read = 0; read < num_bytes;) {
+    uint16_t chunk_size = std::min(num_bytes - read, max_chunk_size);
+    TPM2B_MAX_NV_BUFFER data_buffer;
+    data_buffer.size = 0;
+    result = factory_.GetTpm()->NV_ReadSync(
+        auth_target, auth_target_name, nv_index, nv_name, chunk_size,
+        offset + read, &data_buffer, delegate);
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << __func__ << ": Error reading from non-volatile space at "
+                 << "offset " << offset + read << ": "
+                 << GetErrorString(result);
+      return result;
+    }
+    if (data_buffer.size != chunk_size) {
+      LOG(ERROR) << __func__ << ": Short read from non-volatile space.";
+      return TPM_RC_FAILURE;
+    }
+    callback.Run(StringFrom_TPM2B_MAX_NV_BUFFER(data_buffer));
+    read += chunk_size;
+  }
+  return TPM_RC_SUCCESS;
+}
+
 TPM_RC TpmUtilityImpl::GetNVSpaceName(uint32_t index, std::string* name) {
   TPM_RC result;
   if (index > kMaxNVSpaceIndex) {
@@ -1472,6 +2064,41 @@ TPM_RC TpmUtilityImpl::ResetDictionaryAttackLock(
       TPM_RH_LOCKOUT, NameFromHandle(TPM_RH_LOCKOUT), delegate);
 }
 
+uint32_t TpmUtilityImpl::GetNVBufferMax() {
+  if (nv_buffer_max_ == 0) {
+    uint32_t value = 0;
+    std::unique_ptr<TpmState> tpm_state(factory_.GetTpmState());
+    if (tpm_state->Initialize() == TPM_RC_SUCCESS &&
+        tpm_state->GetTpmProperty(TPM_PT_NV_BUFFER_MAX, &value) && value) {
+      nv_buffer_max_ = std::min<uint32_t>(value, MAX_NV_BUFFER_SIZE);
+    } else {
+      LOG(WARNING) << __func__ << ": Using the default NV buffer size.";
+      nv_buffer_max_ = MAX_NV_BUFFER_SIZE;
+    }
+  }
+  return nv_buffer_max_;
+}
+
+TPM_RC TpmUtilityImpl::GetNVAccessTarget(uint32_t index,
+                                         bool using_owner_authorization,
+                                         uint32_t* nv_index,
+                                         std::string* nv_name,
+                                         TPMI_RH_NV_AUTH* auth_target,
+                                         std::string* auth_target_name) {
+  TPM_RC result = GetNVSpaceName(index, nv_name);
+  if (result != TPM_RC_SUCCESS) {
+    return result;
+  }
+  *nv_index = NV_INDEX_FIRST + index;
+  *auth_target = *nv_index;
+  *auth_target_name = *nv_name;
+  if (using_owner_authorization) {
+    *auth_target = TPM_RH_OWNER;
+    *auth_target_name = NameFromHandle(TPM_RH_OWNER);
+  }
+  return TPM_RC_SUCCESS;
+}
+
 TPM_RC TpmUtilityImpl::SetKnownOwnerPassword(
     const std::string& known_owner_password) {
   std::unique_ptr<TpmState> tpm_state(factory_.GetTpmState());
@@ -1563,7 +2190,7 @@ TPM_RC TpmUtilityImpl::CreateStorageRootKeys(
   }
 
   // Do it again for ECC.
-  if (tpm_state->IsRSASupported()) {
+  if (tpm_state->IsECCSupported()) {
     bool exists = false;
     result = DoesPersistentKeyExist(kECCStorageRootKey, &exists);
     if (result) {
@@ -1624,7 +2251,15 @@ TPM_RC TpmUtilityImpl::CreateSaltingKey(const std::string& owner_password) {
                << GetErrorString(result);
     return result;
   }
-  TPMT_PUBLIC public_area = CreateDefaultPublicArea(TPM_ALG_RSA);
+  std::unique_ptr<TpmState> tpm_state(factory_.GetTpmState());
+  result = tpm_state->Initialize();
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__ << ": " << GetErrorString(result);
+    return result;
+  }
+  // SaltingKeyCache derives salts for ECC keys with SHA-256 on NIST P-256.
+  TPMT_PUBLIC public_area = CreateDefaultPublicArea(
+      tpm_state->IsECCSupported() ? TPM_ALG_ECC : TPM_ALG_RSA);
   public_area.name_alg = TPM_ALG_SHA256;
   public_area.object_attributes |=
       kSensitiveDataOrigin | kUserWithAuth | kNoDA | kDecrypt;
@@ -1683,6 +2318,340 @@ TPM_RC TpmUtilityImpl::CreateSaltingKey(const std::string& owner_password) {
   return TPM_RC_SUCCESS;
 }
 
+void TpmUtilityImpl::ClearUnsealCache() {
+  for (auto& entry : unseal_cache_) {
+    OPENSSL_cleanse(base::string_as_array(&entry.second.data),
+                    entry.second.data.size());
+  }
+  unseal_cache_.clear();
+}
+
+TPM_RC TpmUtilityImpl::SignDigest(TPM_HANDLE key_handle,
+                                  TPM_ALG_ID scheme,
+                                  TPM_ALG_ID hash_alg,
+                                  const std::string& digest,
+                                  AuthorizationDelegate* delegate,
+                                  std::string* signature) {
+  if (scheme != TPM_ALG_RSAPSS && scheme != TPM_ALG_RSASSA &&
+      scheme != TPM_ALG_ECDSA && scheme != TPM_ALG_NULL) {
+    LOG(ERROR) << __func__ << ": Invalid Signing scheme used.";
+    return SAPI_RC_BAD_PARAMETER;
+  }
+  TPM_RC result;
+  if (delegate == nullptr) {
+    result = SAPI_RC_INVALID_SESSIONS;
+    LOG(ERROR) << __func__
+               << ": This method needs a valid authorization delegate: "
+               << GetErrorString(result);
+    return result;
+  }
+  TPMT_PUBLIC public_area;
+  result = GetKeyPublicArea(key_handle, &public_area);
+  if (result) {
+    LOG(ERROR) << __func__ << ": Error finding public area for: " << key_handle;
+    return result;
+  } else if (public_area.type != TPM_ALG_RSA &&
+             public_area.type != TPM_ALG_ECC) {
+    LOG(ERROR) << __func__ << ": Key handle given is not an RSA or ECC key";
+    return SAPI_RC_BAD_PARAMETER;
+  } else if ((public_area.object_attributes & kSign) == 0) {
+    LOG(ERROR) << __func__ << ": Key handle given is not a signging key";
+    return SAPI_RC_BAD_PARAMETER;
+  } else if ((public_area.object_attributes & kRestricted) != 0) {
+    LOG(ERROR) << __func__ << ": Key handle references a restricted key";
+    return SAPI_RC_BAD_PARAMETER;
+  }
+  TPMT_SIG_SCHEME in_scheme;
+  if (public_area.type == TPM_ALG_ECC) {
+    if (scheme != TPM_ALG_ECDSA && scheme != TPM_ALG_NULL) {
+      LOG(ERROR) << __func__ << ": ECC keys only sign with ECDSA.";
+      return SAPI_RC_BAD_PARAMETER;
+    }
+    in_scheme.scheme = TPM_ALG_ECDSA;
+    in_scheme.details.ecdsa.hash_alg = hash_alg;
+  } else if (scheme == TPM_ALG_RSAPSS) {
+    in_scheme.scheme = TPM_ALG_RSAPSS;
+    in_scheme.details.rsapss.hash_alg = hash_alg;
+  } else if (scheme == TPM_ALG_RSASSA || scheme == TPM_ALG_NULL) {
+    in_scheme.scheme = TPM_ALG_RSASSA;
+    in_scheme.details.rsassa.hash_alg = hash_alg;
+  } else {
+    LOG(ERROR) << __func__ << ": RSA keys cannot sign with ECDSA.";
+    return SAPI_RC_BAD_PARAMETER;
+  }
+
+  std::string key_name;
+  result = ComputeKeyName(public_area, &key_name);
+  if (result) {
+    LOG(ERROR) << __func__ << ": Error computing key name for: " << key_handle;
+    return result;
+  }
+  TPM2B_DIGEST tpm_digest = Make_TPM2B_DIGEST(digest);
+  TPMT_SIGNATURE signature_out;
+  TPMT_TK_HASHCHECK validation;
+  validation.tag = TPM_ST_HASHCHECK;
+  validation.hierarchy = TPM_RH_NULL;
+  validation.digest.size = 0;
+  result =
+      factory_.GetTpm()->SignSync(key_handle, key_name, tpm_digest, in_scheme,
+                                  validation, &signature_out, delegate);
+  if (result) {
+    LOG(ERROR) << __func__
+               << ": Error signing digest: " << GetErrorString(result);
+    return result;
+  }
+  if (in_scheme.scheme == TPM_ALG_ECDSA) {
+    // Pad r and s to the curve size so that callers can split r || s.
+    size_t half_size =
+        GetECCParameterSize(public_area.parameters.ecc_detail.curve_id);
+    std::string r = StringFrom_TPM2B_ECC_PARAMETER(
+        signature_out.signature.ecdsa.signature_r);
+    std::string s = StringFrom_TPM2B_ECC_PARAMETER(
+        signature_out.signature.ecdsa.signature_s);
+    half_size = std::max(half_size, std::max(r.size(), s.size()));
+    signature->assign(half_size - r.size(), '\0');
+    signature->append(r);
+    signature->append(half_size - s.size(), '\0');
+    signature->append(s);
+  } else if (scheme == TPM_ALG_RSAPSS) {
+    signature->resize(signature_out.signature.rsapss.sig.size);
+    signature->assign(
+        StringFrom_TPM2B_PUBLIC_KEY_RSA(signature_out.signature.rsapss.sig));
+  } else {
+    signature->resize(signature_out.signature.rsassa.sig.size);
+    signature->assign(
+        StringFrom_TPM2B_PUBLIC_KEY_RSA(signature_out.signature.rsassa.sig));
+  }
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC TpmUtilityImpl::SoftwareEncrypt(const TPMT_PUBLIC& public_area,
+                                       const TPMT_RSA_DECRYPT& scheme,
+                                       const std::string& plaintext,
+                                       std::string* ciphertext) {
+  bssl::UniquePtr<EVP_PKEY> key = GetRSAPublicKey(public_area);
+  if (!key) {
+    LOG(ERROR) << __func__ << ": Error building RSA public key.";
+    return TPM_RC_FAILURE;
+  }
+  bssl::UniquePtr<EVP_PKEY_CTX> context(EVP_PKEY_CTX_new(key.get(), nullptr));
+  if (!context || !EVP_PKEY_encrypt_init(context.get())) {
+    LOG(ERROR) << __func__ << ": Error setting up encrypt context.";
+    return TPM_RC_FAILURE;
+  }
+  if (scheme.scheme == TPM_ALG_OAEP) {
+    const EVP_MD* digest = GetOpenSSLDigest(scheme.details.oaep.hash_alg);
+    if (!digest) {
+      LOG(ERROR) << __func__ << ": Unsupported OAEP hash algorithm.";
+      return SAPI_RC_BAD_PARAMETER;
+    }
+    if (!EVP_PKEY_CTX_set_rsa_padding(context.get(), RSA_PKCS1_OAEP_PADDING) ||
+        !EVP_PKEY_CTX_set_rsa_oaep_md(context.get(), digest) ||
+        !EVP_PKEY_CTX_set_rsa_mgf1_md(context.get(), digest)) {
+      LOG(ERROR) << __func__ << ": Error setting up OAEP padding.";
+      return TPM_RC_FAILURE;
+    }
+  } else if (!EVP_PKEY_CTX_set_rsa_padding(context.get(),
+                                           RSA_PKCS1_PADDING)) {
+    LOG(ERROR) << __func__ << ": Error setting up RSAES padding.";
+    return TPM_RC_FAILURE;
+  }
+  size_t out_length = EVP_PKEY_size(key.get());
+  ciphertext->resize(out_length);
+  if (!EVP_PKEY_encrypt(
+          context.get(),
+          reinterpret_cast<uint8_t*>(base::string_as_array(ciphertext)),
+          &out_length, reinterpret_cast<const uint8_t*>(plaintext.data()),
+          plaintext.size())) {
+    LOG(ERROR) << __func__ << ": Error performing RSA encrypt: "
+               << ERR_error_string(ERR_get_error(), nullptr);
+    ciphertext->clear();
+    return SAPI_RC_BAD_PARAMETER;
+  }
+  ciphertext->resize(out_length);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC TpmUtilityImpl::SoftwareVerify(const TPMT_PUBLIC& public_area,
+                                      TPM_ALG_ID scheme,
+                                      TPM_ALG_ID hash_alg,
+                                      const std::string& plaintext,
+                                      const std::string& signature) {
+  const EVP_MD* digest_type = GetOpenSSLDigest(hash_alg);
+  if (!digest_type) {
+    LOG(ERROR) << __func__ << ": Unsupported hash algorithm.";
+    return SAPI_RC_BAD_PARAMETER;
+  }
+  bssl::UniquePtr<EVP_PKEY> key = GetRSAPublicKey(public_area);
+  if (!key) {
+    LOG(ERROR) << __func__ << ": Error building RSA public key.";
+    return TPM_RC_FAILURE;
+  }
+  bssl::UniquePtr<EVP_PKEY_CTX> context(EVP_PKEY_CTX_new(key.get(), nullptr));
+  if (!context || !EVP_PKEY_verify_init(context.get()) ||
+      !EVP_PKEY_CTX_set_signature_md(context.get(), digest_type)) {
+    LOG(ERROR) << __func__ << ": Error setting up verify context.";
+    return TPM_RC_FAILURE;
+  }
+  if (scheme == TPM_ALG_RSAPSS) {
+    // The TPM chooses the PSS salt length, so recover it from the signature.
+    if (!EVP_PKEY_CTX_set_rsa_padding(context.get(), RSA_PKCS1_PSS_PADDING) ||
+        !EVP_PKEY_CTX_set_rsa_pss_saltlen(context.get(), -2)) {
+      LOG(ERROR) << __func__ << ": Error setting up PSS padding.";
+      return TPM_RC_FAILURE;
+    }
+  } else if (!EVP_PKEY_CTX_set_rsa_padding(context.get(),
+                                           RSA_PKCS1_PADDING)) {
+    LOG(ERROR) << __func__ << ": Error setting up RSASSA padding.";
+    return TPM_RC_FAILURE;
+  }
+  std::string digest = HashString(plaintext, hash_alg);
+  if (EVP_PKEY_verify(context.get(),
+                      reinterpret_cast<const uint8_t*>(signature.data()),
+                      signature.size(),
+                      reinterpret_cast<const uint8_t*>(digest.data()),
+                      digest.size()) != 1) {
+    ERR_clear_error();
+    LOG(WARNING) << __func__ << ": Incorrect signature for given digest.";
+    return TPM_RC_SIGNATURE;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+void TpmUtilityImpl::SetKeyUsageAttributes(AsymmetricKeyUsage key_type,
+                                           TPMT_PUBLIC* public_area) {
+  switch (key_type) {
+    case AsymmetricKeyUsage::kDecryptKey:
+      public_area->object_attributes |= kDecrypt;
+      break;
+    case AsymmetricKeyUsage::kSignKey:
+      public_area->object_attributes |= kSign;
+      break;
+    case AsymmetricKeyUsage::kDecryptAndSignKey:
+      public_area->object_attributes |= (kSign | kDecrypt);
+      break;
+  }
+}
+
+TPMT_PUBLIC TpmUtilityImpl::CreateKeyTemplate(
+    TPM_ALG_ID key_alg,
+    AsymmetricKeyUsage key_type,
+    const std::string& policy_digest,
+    bool use_only_policy_authorization) {
+  TPMT_PUBLIC public_area = CreateDefaultPublicArea(key_alg);
+  public_area.auth_policy = Make_TPM2B_DIGEST(policy_digest);
+  public_area.object_attributes |=
+      (kSensitiveDataOrigin | kUserWithAuth | kNoDA);
+  SetKeyUsageAttributes(key_type, &public_area);
+  if (use_only_policy_authorization && !policy_digest.empty()) {
+    public_area.object_attributes |= kAdminWithPolicy;
+    public_area.object_attributes &= (~kUserWithAuth);
+  }
+  return public_area;
+}
+
+TPM_RC TpmUtilityImpl::GetCreationPCRSelection(
+    int creation_pcr_index,
+    TPML_PCR_SELECTION* creation_pcrs) {
+  *creation_pcrs = {};
+  if (creation_pcr_index == kNoCreationPCR) {
+    creation_pcrs->count = 0;
+    return TPM_RC_SUCCESS;
+  }
+  if (creation_pcr_index < 0 || creation_pcr_index > (PCR_SELECT_MIN * 8)) {
+    LOG(ERROR) << __func__
+               << ": Creation PCR index is not within the allocated bank.";
+    return SAPI_RC_BAD_PARAMETER;
+  }
+  creation_pcrs->count = 1;
+  creation_pcrs->pcr_selections[0].hash = TPM_ALG_SHA256;
+  creation_pcrs->pcr_selections[0].sizeof_select = PCR_SELECT_MIN;
+  creation_pcrs->pcr_selections[0].pcr_select[creation_pcr_index / 8] =
+      1 << (creation_pcr_index % 8);
+  return TPM_RC_SUCCESS;
+}
+
+TPMT_PUBLIC TpmUtilityImpl::CreateRSAKeyTemplate(
+    AsymmetricKeyUsage key_type,
+    int modulus_bits,
+    uint32_t public_exponent,
+    const std::string& policy_digest,
+    bool use_only_policy_authorization) {
+  TPMT_PUBLIC public_area = CreateKeyTemplate(
+      TPM_ALG_RSA, key_type, policy_digest, use_only_policy_authorization);
+  public_area.parameters.rsa_detail.key_bits = modulus_bits;
+  public_area.parameters.rsa_detail.exponent = public_exponent;
+  return public_area;
+}
+
+std::string TpmUtilityImpl::GetRSAKeyPoolEntry(const std::string& parent_name,
+                                               const TPMT_PUBLIC& public_area,
+                                               const std::string& password) {
+  // The parent name ties pooled keys to the current storage root key, and
+  // only a hash of the password is kept.
+  std::string entry = parent_name;
+  std::string serialized_public_area;
+  Serialize_TPMT_PUBLIC(public_area, &serialized_public_area);
+  entry += serialized_public_area;
+  entry += crypto::SHA256HashString(password);
+  return entry;
+}
+
+TPM_RC TpmUtilityImpl::CreateKey(const std::string& parent_name,
+                                 const TPMT_PUBLIC& public_area,
+                                 const std::string& password,
+                                 const TPML_PCR_SELECTION& creation_pcrs,
+                                 AuthorizationDelegate* delegate,
+                                 std::string* key_blob,
+                                 std::string* creation_blob) {
+  TPMS_SENSITIVE_CREATE sensitive;
+  sensitive.user_auth = Make_TPM2B_DIGEST(password);
+  sensitive.data = Make_TPM2B_SENSITIVE_DATA("");
+  TPM2B_SENSITIVE_CREATE sensitive_create =
+      Make_TPM2B_SENSITIVE_CREATE(sensitive);
+  TPM2B_DATA outside_info = Make_TPM2B_DATA("");
+  TPM2B_PUBLIC out_public;
+  out_public.size = 0;
+  TPM2B_PRIVATE out_private;
+  out_private.size = 0;
+  TPM2B_CREATION_DATA creation_data;
+  TPM2B_DIGEST creation_hash;
+  TPMT_TK_CREATION creation_ticket;
+  TPM_RC result = factory_.GetTpm()->CreateSync(
+      kRSAStorageRootKey, parent_name, sensitive_create,
+      Make_TPM2B_PUBLIC(public_area), outside_info, creation_pcrs, &out_private,
+      &out_public, &creation_data, &creation_hash, &creation_ticket, delegate);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << __func__
+               << ": Error creating key: " << GetErrorString(result);
+    return result;
+  }
+  if (!factory_.GetBlobParser()->SerializeKeyBlob(out_public, out_private,
+                                                  key_blob)) {
+    return SAPI_RC_BAD_TCTI_STRUCTURE;
+  }
+  if (creation_blob) {
+    if (!factory_.GetBlobParser()->SerializeCreationBlob(
+            creation_data, creation_hash, creation_ticket, creation_blob)) {
+      return SAPI_RC_BAD_TCTI_STRUCTURE;
+    }
+  }
+  return TPM_RC_SUCCESS;
+}
+
+TPMT_PUBLIC TpmUtilityImpl::CreateAuthorityPublicArea(
+    const std::string& modulus) {
+  TPMT_PUBLIC public_area = CreateDefaultPublicArea(TPM_ALG_RSA);
+  // A public key loaded with TPM2_LoadExternal cannot be fixed to the TPM.
+  public_area.object_attributes = kSign | kUserWithAuth | kNoDA;
+  public_area.parameters.rsa_detail.scheme.scheme = TPM_ALG_RSASSA;
+  public_area.parameters.rsa_detail.scheme.details.rsassa.hash_alg =
+      TPM_ALG_SHA256;
+  public_area.parameters.rsa_detail.key_bits = modulus.size() * 8;
+  public_area.unique.rsa = Make_TPM2B_PUBLIC_KEY_RSA(modulus);
+  return public_area;
+}
+
 TPMT_PUBLIC TpmUtilityImpl::CreateDefaultPublicArea(TPM_ALG_ID key_alg) {
   TPMT_PUBLIC public_area;
   public_area.name_alg = TPM_ALG_SHA256;
@@ -1697,6 +2666,8 @@ TPMT_PUBLIC TpmUtilityImpl::CreateDefaultPublicArea(TPM_ALG_ID key_alg) {
     public_area.unique.rsa = Make_TPM2B_PUBLIC_KEY_RSA("");
   } else if (key_alg == TPM_ALG_ECC) {
     public_area.type = TPM_ALG_ECC;
+    public_area.parameters.ecc_detail.symmetric.algorithm = TPM_ALG_NULL;
+    public_area.parameters.ecc_detail.scheme.scheme = TPM_ALG_NULL;
     public_area.parameters.ecc_detail.curve_id = TPM_ECC_NIST_P256;
     public_area.parameters.ecc_detail.kdf.scheme = TPM_ALG_NULL;
     public_area.unique.ecc.x = Make_TPM2B_ECC_PARAMETER("");
@@ -1811,33 +2782,37 @@ TPM_RC TpmUtilityImpl::EncryptPrivateData(const TPMT_SENSITIVE& sensitive_area,
                << ": Error computing object name: " << GetErrorString(result);
     return result;
   }
-  TPM2B_DIGEST inner_integrity = Make_TPM2B_DIGEST(
-      crypto::SHA256HashString(serialized_sensitive_data + object_name));
-  std::string serialized_inner_integrity;
-  result = Serialize_TPM2B_DIGEST(inner_integrity, &serialized_inner_integrity);
+  // The integrity digest is hashed in place and the private area is built and
+  // encrypted in a single buffer, so bulk imports don't pay for the
+  // intermediate concatenations.
+  TPM2B_DIGEST inner_integrity;
+  inner_integrity.size = crypto::kSHA256Length;
+  std::unique_ptr<crypto::SecureHash> hash(
+      crypto::SecureHash::Create(crypto::SecureHash::SHA256));
+  hash->Update(serialized_sensitive_data.data(),
+               serialized_sensitive_data.size());
+  hash->Update(object_name.data(), object_name.size());
+  hash->Finish(inner_integrity.buffer, inner_integrity.size);
+  std::string private_data_string;
+  private_data_string.reserve(sizeof(UINT16) + inner_integrity.size +
+                              serialized_sensitive_data.size());
+  result = Serialize_TPM2B_DIGEST(inner_integrity, &private_data_string);
   if (result != TPM_RC_SUCCESS) {
     LOG(ERROR) << __func__ << ": Error serializing inner integrity: "
                << GetErrorString(result);
     return result;
   }
-  std::string unencrypted_private_data =
-      serialized_inner_integrity + serialized_sensitive_data;
+  private_data_string.append(serialized_sensitive_data);
   AES_KEY key;
   AES_set_encrypt_key(encryption_key->buffer, kAesKeySize * 8, &key);
-  std::string private_data_string(unencrypted_private_data.size(), 0);
   int iv_in = 0;
   unsigned char iv[MAX_AES_BLOCK_SIZE_BYTES] = {0};
-  AES_cfb128_encrypt(
-      reinterpret_cast<const unsigned char*>(unencrypted_private_data.data()),
-      reinterpret_cast<unsigned char*>(
-          base::string_as_array(&private_data_string)),
-      unencrypted_private_data.size(), &key, iv, &iv_in, AES_ENCRYPT);
+  unsigned char* private_data_bytes = reinterpret_cast<unsigned char*>(
+      base::string_as_array(&private_data_string));
+  AES_cfb128_encrypt(private_data_bytes, private_data_bytes,
+                     private_data_string.size(), &key, iv, &iv_in,
+                     AES_ENCRYPT);
   *encrypted_private_data = Make_TPM2B_PRIVATE(private_data_string);
-  if (result != TPM_RC_SUCCESS) {
-    LOG(ERROR) << __func__
-               << ": Error making private area: " << GetErrorString(result);
-    return result;
-  }
   return TPM_RC_SUCCESS;
 }
 
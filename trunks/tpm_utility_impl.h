@@ -20,10 +20,14 @@
 #include "trunks/tpm_utility.h"
 
 #include <map>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <base/macros.h>
+#include <base/synchronization/lock.h>
+#include <base/time/time.h>
 #include <gtest/gtest_prod.h>
 
 #include "trunks/trunks_export.h"
@@ -33,10 +37,48 @@ namespace trunks {
 class AuthorizationDelegate;
 class TrunksFactory;
 
+// Holds RSA keys created ahead of time by
+// TpmUtility::PregenerateRSAKeyPairs, so that CreateRSAKeyPair can hand one
+// out without a TPM2_Create. Keys are kept as blobs, so a pooled key uses no
+// TPM object slot. Each pool entry names one key template; TpmUtilityImpl
+// builds it from the parent name, the public area and a hash of the key
+// password. This class is thread-safe.
+class TRUNKS_EXPORT RSAKeyPool {
+ public:
+  RSAKeyPool() = default;
+  ~RSAKeyPool() = default;
+
+  // Removes a key created for |entry| from the pool and copies its blobs to
+  // |key_blob| and |creation_blob|. Returns false if none is pooled.
+  bool Take(const std::string& entry,
+            std::string* key_blob,
+            std::string* creation_blob);
+  void Add(const std::string& entry,
+           const std::string& key_blob,
+           const std::string& creation_blob);
+  // Returns the number of keys pooled for |entry|.
+  size_t GetCount(const std::string& entry);
+
+ private:
+  struct KeyBlobs {
+    std::string key_blob;
+    std::string creation_blob;
+  };
+
+  base::Lock lock_;
+  std::map<std::string, std::vector<KeyBlobs>> keys_;
+
+  DISALLOW_COPY_AND_ASSIGN(RSAKeyPool);
+};
+
 // A default implementation of TpmUtility.
 class TRUNKS_EXPORT TpmUtilityImpl : public TpmUtility {
  public:
   explicit TpmUtilityImpl(const TrunksFactory& factory);
+  // Takes and stores pregenerated keys in |key_pool| instead of a pool
+  // private to this instance. The pool is not owned and must outlive this
+  // object.
+  TpmUtilityImpl(const TrunksFactory& factory, RSAKeyPool* key_pool);
   ~TpmUtilityImpl() override;
 
   // TpmUtility methods.
@@ -45,6 +87,7 @@ class TRUNKS_EXPORT TpmUtilityImpl : public TpmUtility {
   void Shutdown() override;
   TPM_RC InitializeTpm() override;
   TPM_RC AllocatePCR(const std::string& platform_password) override;
+  TPM_RC PrepareForOwnership() override;
   TPM_RC TakeOwnership(const std::string& owner_password,
                        const std::string& endorsement_password,
                        const std::string& lockout_password) override;
@@ -57,6 +100,14 @@ class TRUNKS_EXPORT TpmUtilityImpl : public TpmUtility {
                    const std::string& extend_data,
                    AuthorizationDelegate* delegate) override;
   TPM_RC ReadPCR(int pcr_index, std::string* pcr_value) override;
+  TPM_RC ExtendPCRs(int pcr_index,
+                    const std::string& extend_data,
+                    const std::vector<TPM_ALG_ID>& hash_algs,
+                    AuthorizationDelegate* delegate) override;
+  TPM_RC ReadPCRs(
+      const std::vector<int>& pcr_indexes,
+      const std::vector<TPM_ALG_ID>& hash_algs,
+      std::map<TPM_ALG_ID, std::vector<std::string>>* pcr_values) override;
   TPM_RC AsymmetricEncrypt(TPM_HANDLE key_handle,
                            TPM_ALG_ID scheme,
                            TPM_ALG_ID hash_alg,
@@ -75,12 +126,19 @@ class TRUNKS_EXPORT TpmUtilityImpl : public TpmUtility {
               const std::string& plaintext,
               AuthorizationDelegate* delegate,
               std::string* signature) override;
+  TPM_RC SignFile(TPM_HANDLE key_handle,
+                  TPM_ALG_ID scheme,
+                  TPM_ALG_ID hash_alg,
+                  int fd,
+                  AuthorizationDelegate* delegate,
+                  std::string* signature) override;
   TPM_RC Verify(TPM_HANDLE key_handle,
                 TPM_ALG_ID scheme,
                 TPM_ALG_ID hash_alg,
                 const std::string& plaintext,
                 const std::string& signature,
                 AuthorizationDelegate* delegate) override;
+  void SetUseSoftwarePublicKeyOperations(bool enabled) override;
   TPM_RC CertifyCreation(TPM_HANDLE key_handle,
                          const std::string& creation_blob) override;
   TPM_RC ChangeKeyAuthorizationData(TPM_HANDLE key_handle,
@@ -94,6 +152,14 @@ class TRUNKS_EXPORT TpmUtilityImpl : public TpmUtility {
                       const std::string& password,
                       AuthorizationDelegate* delegate,
                       std::string* key_blob) override;
+  TPM_RC ImportECCKey(AsymmetricKeyUsage key_type,
+                      TPMI_ECC_CURVE curve_id,
+                      const std::string& public_point_x,
+                      const std::string& public_point_y,
+                      const std::string& private_value,
+                      const std::string& password,
+                      AuthorizationDelegate* delegate,
+                      std::string* key_blob) override;
   TPM_RC CreateRSAKeyPair(AsymmetricKeyUsage key_type,
                           int modulus_bits,
                           uint32_t public_exponent,
@@ -104,9 +170,29 @@ class TRUNKS_EXPORT TpmUtilityImpl : public TpmUtility {
                           AuthorizationDelegate* delegate,
                           std::string* key_blob,
                           std::string* creation_blob) override;
+  TPM_RC PregenerateRSAKeyPairs(AsymmetricKeyUsage key_type,
+                                int modulus_bits,
+                                uint32_t public_exponent,
+                                const std::string& password,
+                                const std::string& policy_digest,
+                                bool use_only_policy_authorization,
+                                size_t num_keys,
+                                AuthorizationDelegate* delegate) override;
+  TPM_RC CreateECCKeyPair(AsymmetricKeyUsage key_type,
+                          TPMI_ECC_CURVE curve_id,
+                          const std::string& password,
+                          const std::string& policy_digest,
+                          bool use_only_policy_authorization,
+                          int creation_pcr_index,
+                          AuthorizationDelegate* delegate,
+                          std::string* key_blob,
+                          std::string* creation_blob) override;
   TPM_RC LoadKey(const std::string& key_blob,
                  AuthorizationDelegate* delegate,
                  TPM_HANDLE* key_handle) override;
+  TPM_RC LoadKeys(const std::vector<std::string>& key_blobs,
+                  AuthorizationDelegate* delegate,
+                  std::vector<TPM_HANDLE>* key_handles) override;
   TPM_RC GetKeyName(TPM_HANDLE handle, std::string* name) override;
   TPM_RC GetKeyPublicArea(TPM_HANDLE handle, TPMT_PUBLIC* public_data) override;
   TPM_RC SealData(const std::string& data_to_seal,
@@ -116,10 +202,25 @@ class TRUNKS_EXPORT TpmUtilityImpl : public TpmUtility {
   TPM_RC UnsealData(const std::string& sealed_data,
                     AuthorizationDelegate* delegate,
                     std::string* unsealed_data) override;
+  void EnableUnsealCache(base::TimeDelta ttl) override;
   TPM_RC StartSession(HmacSession* session) override;
   TPM_RC GetPolicyDigestForPcrValue(int pcr_index,
                                     const std::string& pcr_value,
                                     std::string* policy_digest) override;
+  TPM_RC GetPolicyDigestForAuthority(const std::string& authority_modulus,
+                                     const std::string& policy_ref,
+                                     std::string* policy_digest) override;
+  TPM_RC SignPolicyApproval(TPM_HANDLE authority_key_handle,
+                            const std::string& approved_policy,
+                            const std::string& policy_ref,
+                            AuthorizationDelegate* delegate,
+                            std::string* approval_signature) override;
+  TPM_RC UnsealDataWithApprovedPolicy(const std::string& sealed_data,
+                                      int pcr_index,
+                                      const std::string& authority_modulus,
+                                      const std::string& policy_ref,
+                                      const std::string& approval_signature,
+                                      std::string* unsealed_data) override;
   TPM_RC DefineNVSpace(uint32_t index,
                        size_t num_bytes,
                        TPMA_NV attributes,
@@ -145,6 +246,17 @@ class TRUNKS_EXPORT TpmUtilityImpl : public TpmUtility {
                      bool using_owner_authorization,
                      std::string* nvram_data,
                      AuthorizationDelegate* delegate) override;
+  TPM_RC WriteNVSpaceInChunks(uint32_t index,
+                              uint32_t offset,
+                              const std::string& nvram_data,
+                              bool using_owner_authorization,
+                              AuthorizationDelegate* delegate) override;
+  TPM_RC ReadNVSpaceInChunks(uint32_t index,
+                             uint32_t offset,
+                             size_t num_bytes,
+                             bool using_owner_authorization,
+                             const NVReadCallback& callback,
+                             AuthorizationDelegate* delegate) override;
   TPM_RC GetNVSpaceName(uint32_t index, std::string* name) override;
   TPM_RC GetNVSpacePublicArea(uint32_t index,
                               TPMS_NV_PUBLIC* public_data) override;
@@ -160,7 +272,44 @@ class TRUNKS_EXPORT TpmUtilityImpl : public TpmUtility {
   friend class TpmUtilityTest;
 
   const TrunksFactory& factory_;
+  std::unique_ptr<RSAKeyPool> own_key_pool_;
+  RSAKeyPool* key_pool_;
   std::map<uint32_t, TPMS_NV_PUBLIC> nvram_public_area_map_;
+  // Public areas of persistent objects read by GetKeyPublicArea. Object
+  // public areas, and so their names, never change; the map is cleared with
+  // the TPM.
+  std::map<TPM_HANDLE, TPMT_PUBLIC> object_public_area_map_;
+  // The TPM_PT_NV_BUFFER_MAX property, or 0 if it has not been queried yet.
+  uint32_t nv_buffer_max_ = 0;
+  // Trial-session policy digests keyed by PCR index and PCR value. The digest
+  // depends only on the key, so entries never go stale.
+  std::map<std::pair<int, std::string>, std::string> pcr_policy_digests_;
+  bool use_software_public_key_operations_ = false;
+
+  struct UnsealCacheEntry {
+    std::string data;
+    base::TimeTicks expiration;
+  };
+  // Unsealed secrets keyed by the SHA-256 digest of their sealed blob. Empty
+  // unless EnableUnsealCache() was called with a non-zero TTL.
+  std::map<std::string, UnsealCacheEntry> unseal_cache_;
+  base::TimeDelta unseal_cache_ttl_;
+
+  // Wipes and drops every cached unsealed secret.
+  void ClearUnsealCache();
+
+  // Returns the largest amount of data a single TPM2_NV_Read or TPM2_NV_Write
+  // can transfer.
+  uint32_t GetNVBufferMax();
+
+  // Resolves the handles and names used to access the non-volatile space
+  // referenced by |index|.
+  TPM_RC GetNVAccessTarget(uint32_t index,
+                           bool using_owner_authorization,
+                           uint32_t* nv_index,
+                           std::string* nv_name,
+                           TPMI_RH_NV_AUTH* auth_target,
+                           std::string* auth_target_name);
 
   // This method sets a known owner password in the TPM_RH_OWNER hierarchy.
   TPM_RC SetKnownOwnerPassword(const std::string& known_owner_password);
@@ -171,9 +320,11 @@ class TRUNKS_EXPORT TpmUtilityImpl : public TpmUtility {
   // with an empty authorization value until the TPM is cleared.
   TPM_RC CreateStorageRootKeys(const std::string& owner_password);
 
-  // This method creates an RSA decryption key to be used for salting sessions.
-  // This method also makes the salting key permanent under the storage
-  // hierarchy.
+  // This method creates a decryption key to be used for salting sessions. The
+  // key is ECC NIST P-256 if the TPM supports ECC, since the TPM recovers ECDH
+  // salts much faster than RSA-OAEP ones, and RSA-2048 otherwise. An existing
+  // salting key is kept whatever its type. This method also makes the salting
+  // key permanent under the storage hierarchy.
   TPM_RC CreateSaltingKey(const std::string& owner_password);
 
   // This method returns a partially filled TPMT_PUBLIC strucutre,
@@ -182,6 +333,77 @@ class TRUNKS_EXPORT TpmUtilityImpl : public TpmUtility {
   // parameters.
   TPMT_PUBLIC CreateDefaultPublicArea(TPM_ALG_ID key_alg);
 
+  // Signs |digest|, a |hash_alg| digest computed by the caller, with the
+  // unrestricted key at |key_handle|.
+  TPM_RC SignDigest(TPM_HANDLE key_handle,
+                    TPM_ALG_ID scheme,
+                    TPM_ALG_ID hash_alg,
+                    const std::string& digest,
+                    AuthorizationDelegate* delegate,
+                    std::string* signature);
+
+  // Encrypts |plaintext| with the RSA key in |public_area| using OpenSSL.
+  TPM_RC SoftwareEncrypt(const TPMT_PUBLIC& public_area,
+                         const TPMT_RSA_DECRYPT& scheme,
+                         const std::string& plaintext,
+                         std::string* ciphertext);
+
+  // Verifies |signature| over |plaintext| with the RSA key in |public_area|
+  // using OpenSSL. |scheme| is TPM_ALG_RSASSA or TPM_ALG_RSAPSS.
+  TPM_RC SoftwareVerify(const TPMT_PUBLIC& public_area,
+                        TPM_ALG_ID scheme,
+                        TPM_ALG_ID hash_alg,
+                        const std::string& plaintext,
+                        const std::string& signature);
+
+  // Sets the kSign and kDecrypt attributes of |public_area| for |key_type|.
+  void SetKeyUsageAttributes(AsymmetricKeyUsage key_type,
+                             TPMT_PUBLIC* public_area);
+
+  // Returns the public template of a |key_alg| key created by the TPM, with
+  // the given usage and authorization policy.
+  TPMT_PUBLIC CreateKeyTemplate(TPM_ALG_ID key_alg,
+                                AsymmetricKeyUsage key_type,
+                                const std::string& policy_digest,
+                                bool use_only_policy_authorization);
+
+  // Fills |creation_pcrs| with the single SHA-256 pcr |creation_pcr_index|,
+  // or with nothing for kNoCreationPCR.
+  TPM_RC GetCreationPCRSelection(int creation_pcr_index,
+                                 TPML_PCR_SELECTION* creation_pcrs);
+
+  // Returns the public template of an RSA key with the given parameters.
+  TPMT_PUBLIC CreateRSAKeyTemplate(AsymmetricKeyUsage key_type,
+                                   int modulus_bits,
+                                   uint32_t public_exponent,
+                                   const std::string& policy_digest,
+                                   bool use_only_policy_authorization);
+
+  // Returns the RSAKeyPool entry for keys created under the storage root key
+  // named |parent_name| from |public_area| and |password|.
+  std::string GetRSAKeyPoolEntry(const std::string& parent_name,
+                                 const TPMT_PUBLIC& public_area,
+                                 const std::string& password);
+
+  // Creates a key from |public_area| under the storage root key and
+  // serializes it to |key_blob| and, if not null, |creation_blob|.
+  TPM_RC CreateKey(const std::string& parent_name,
+                   const TPMT_PUBLIC& public_area,
+                   const std::string& password,
+                   const TPML_PCR_SELECTION& creation_pcrs,
+                   AuthorizationDelegate* delegate,
+                   std::string* key_blob,
+                   std::string* creation_blob);
+
+  // Imports the external key described by |public_area| and |in_sensitive|
+  // under the storage root key named |parent_name|, and serializes the
+  // result to |key_blob| if it is not null.
+  TPM_RC ImportKey(const std::string& parent_name,
+                   const TPMT_PUBLIC& public_area,
+                   const TPMT_SENSITIVE& in_sensitive,
+                   AuthorizationDelegate* delegate,
+                   std::string* key_blob);
+
   // Sets TPM |hierarchy| authorization to |password| using |authorization|.
   TPM_RC SetHierarchyAuthorization(TPMI_RH_HIERARCHY_AUTH hierarchy,
                                    const std::string& password,
@@ -191,6 +413,10 @@ class TRUNKS_EXPORT TpmUtilityImpl : public TpmUtility {
   // platform |authorization|.
   TPM_RC DisablePlatformHierarchy(AuthorizationDelegate* authorization);
 
+  // Returns the public area of a policy authority key with the RSA
+  // |modulus|. See GetPolicyDigestForAuthority.
+  TPMT_PUBLIC CreateAuthorityPublicArea(const std::string& modulus);
+
   // Given a public area, this method computes the object name. Following
   // TPM2.0 Specification Part 1 section 16,
   // object_name = HashAlg || Hash(public_area);
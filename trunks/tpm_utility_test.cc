@@ -14,11 +14,23 @@
 // limitations under the License.
 //
 
+#include <base/bind.h>
+#include <base/files/file.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <base/logging.h>
+#include <base/sha1.h>
 #include <base/stl_util.h>
 #include <crypto/sha2.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <openssl/aes.h>
+#include <openssl/bn.h>
+#include <openssl/evp.h>
+#if defined(OPENSSL_IS_BORINGSSL)
+#include <openssl/mem.h>
+#endif
+#include <openssl/rsa.h>
 
 #include "trunks/error_codes.h"
 #include "trunks/hmac_authorization_delegate.h"
@@ -28,17 +40,42 @@
 #include "trunks/mock_policy_session.h"
 #include "trunks/mock_tpm.h"
 #include "trunks/mock_tpm_state.h"
+#include "trunks/policy_template.h"
 #include "trunks/tpm_constants.h"
 #include "trunks/tpm_utility_impl.h"
 #include "trunks/trunks_factory_for_test.h"
 
 using testing::_;
 using testing::DoAll;
+using testing::InSequence;
 using testing::NiceMock;
 using testing::Return;
 using testing::SaveArg;
 using testing::SetArgPointee;
 
+namespace {
+
+void AppendChunk(std::vector<std::string>* chunks, const std::string& chunk) {
+  chunks->push_back(chunk);
+}
+
+// Generates an RSA key and fills |public_area| with its public part.
+bssl::UniquePtr<RSA> CreateTestRSAKey(trunks::TPMA_OBJECT attributes,
+                                      trunks::TPM2B_PUBLIC* public_area) {
+  bssl::UniquePtr<RSA> rsa(RSA_new());
+  bssl::UniquePtr<BIGNUM> exponent(BN_new());
+  CHECK(BN_set_word(exponent.get(), RSA_F4));
+  CHECK(RSA_generate_key_ex(rsa.get(), 2048, exponent.get(), nullptr));
+  memset(public_area, 0, sizeof(*public_area));
+  public_area->public_area.type = trunks::TPM_ALG_RSA;
+  public_area->public_area.object_attributes = attributes;
+  public_area->public_area.unique.rsa.size =
+      BN_bn2bin(rsa->n, public_area->public_area.unique.rsa.buffer);
+  return rsa;
+}
+
+}  // namespace
+
 namespace trunks {
 
 // A test fixture for TpmUtility tests.
@@ -52,6 +89,7 @@ class TpmUtilityTest : public testing::Test {
     factory_.set_tpm(&mock_tpm_);
     factory_.set_hmac_session(&mock_hmac_session_);
     factory_.set_trial_session(&mock_trial_session_);
+    factory_.set_policy_session(&mock_policy_session_);
   }
 
   TPM_RC ComputeKeyName(const TPMT_PUBLIC& public_area,
@@ -141,6 +179,7 @@ class TpmUtilityTest : public testing::Test {
   NiceMock<MockAuthorizationDelegate> mock_authorization_delegate_;
   NiceMock<MockHmacSession> mock_hmac_session_;
   NiceMock<MockPolicySession> mock_trial_session_;
+  NiceMock<MockPolicySession> mock_policy_session_;
   TpmUtilityImpl utility_;
 };
 
@@ -288,6 +327,27 @@ TEST_F(TpmUtilityTest, TakeOwnershipSuccess) {
             utility_.TakeOwnership("owner", "endorsement", "lockout"));
 }
 
+TEST_F(TpmUtilityTest, PrepareForOwnershipSuccess) {
+  EXPECT_CALL(mock_tpm_state_, IsOwnerPasswordSet())
+      .WillRepeatedly(Return(false));
+  // Only the owner hierarchy gets the well-known password.
+  EXPECT_CALL(mock_tpm_, HierarchyChangeAuthSync(TPM_RH_OWNER, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_tpm_, HierarchyChangeAuthSync(TPM_RH_ENDORSEMENT, _, _, _))
+      .Times(0);
+  EXPECT_CALL(mock_tpm_, HierarchyChangeAuthSync(TPM_RH_LOCKOUT, _, _, _))
+      .Times(0);
+  EXPECT_EQ(TPM_RC_SUCCESS, utility_.PrepareForOwnership());
+}
+
+TEST_F(TpmUtilityTest, PrepareForOwnershipFailure) {
+  EXPECT_CALL(mock_tpm_state_, IsOwnerPasswordSet())
+      .WillRepeatedly(Return(false));
+  EXPECT_CALL(mock_tpm_, HierarchyChangeAuthSync(TPM_RH_OWNER, _, _, _))
+      .WillRepeatedly(Return(TPM_RC_FAILURE));
+  EXPECT_EQ(TPM_RC_FAILURE, utility_.PrepareForOwnership());
+}
+
 TEST_F(TpmUtilityTest, TakeOwnershipOwnershipDone) {
   EXPECT_EQ(TPM_RC_SUCCESS,
             utility_.TakeOwnership("owner", "endorsement", "lockout"));
@@ -463,6 +523,165 @@ TEST_F(TpmUtilityTest, ReadPCRBadReturn) {
   EXPECT_EQ(TPM_RC_FAILURE, utility_.ReadPCR(1, &pcr_value));
 }
 
+TEST_F(TpmUtilityTest, ReadPCRsRequestsMissingPCRsAgain) {
+  std::vector<int> pcr_indexes;
+  for (int i = 0; i < 10; ++i) {
+    pcr_indexes.push_back(i);
+  }
+  // The first response holds PCRs 0-7, the second PCRs 8 and 9.
+  TPML_PCR_SELECTION first_select;
+  memset(&first_select, 0, sizeof(first_select));
+  first_select.count = 1;
+  first_select.pcr_selections[0].hash = TPM_ALG_SHA256;
+  first_select.pcr_selections[0].sizeof_select = PCR_SELECT_MIN;
+  first_select.pcr_selections[0].pcr_select[0] = 0xff;
+  TPML_DIGEST first_values;
+  first_values.count = 8;
+  for (int i = 0; i < 8; ++i) {
+    first_values.digests[i] = Make_TPM2B_DIGEST(std::string(1, 'a' + i));
+  }
+  TPML_PCR_SELECTION second_select = first_select;
+  second_select.pcr_selections[0].pcr_select[0] = 0;
+  second_select.pcr_selections[0].pcr_select[1] = 0x03;
+  TPML_DIGEST second_values;
+  second_values.count = 2;
+  second_values.digests[0] = Make_TPM2B_DIGEST("i");
+  second_values.digests[1] = Make_TPM2B_DIGEST("j");
+  TPML_PCR_SELECTION first_request;
+  TPML_PCR_SELECTION second_request;
+  EXPECT_CALL(mock_tpm_, PCR_ReadSync(_, _, _, _, _))
+      .WillOnce(DoAll(SaveArg<0>(&first_request),
+                      SetArgPointee<2>(first_select),
+                      SetArgPointee<3>(first_values), Return(TPM_RC_SUCCESS)))
+      .WillOnce(DoAll(SaveArg<0>(&second_request),
+                      SetArgPointee<2>(second_select),
+                      SetArgPointee<3>(second_values),
+                      Return(TPM_RC_SUCCESS)));
+  std::map<TPM_ALG_ID, std::vector<std::string>> pcr_values;
+  EXPECT_EQ(TPM_RC_SUCCESS, utility_.ReadPCRs(pcr_indexes, {TPM_ALG_SHA256},
+                                              &pcr_values));
+  EXPECT_EQ(0xff, first_request.pcr_selections[0].pcr_select[0]);
+  EXPECT_EQ(0x03, first_request.pcr_selections[0].pcr_select[1]);
+  EXPECT_EQ(0, second_request.pcr_selections[0].pcr_select[0]);
+  EXPECT_EQ(0x03, second_request.pcr_selections[0].pcr_select[1]);
+  std::vector<std::string> expected = {"a", "b", "c", "d", "e",
+                                       "f", "g", "h", "i", "j"};
+  EXPECT_EQ(expected, pcr_values[TPM_ALG_SHA256]);
+}
+
+TEST_F(TpmUtilityTest, ReadPCRsMultipleBanks) {
+  TPML_PCR_SELECTION pcr_select;
+  memset(&pcr_select, 0, sizeof(pcr_select));
+  pcr_select.count = 2;
+  pcr_select.pcr_selections[0].hash = TPM_ALG_SHA1;
+  pcr_select.pcr_selections[0].sizeof_select = PCR_SELECT_MIN;
+  pcr_select.pcr_selections[0].pcr_select[0] = 0x05;
+  pcr_select.pcr_selections[1] = pcr_select.pcr_selections[0];
+  pcr_select.pcr_selections[1].hash = TPM_ALG_SHA256;
+  TPML_DIGEST pcr_values;
+  pcr_values.count = 4;
+  pcr_values.digests[0] = Make_TPM2B_DIGEST("sha1_0");
+  pcr_values.digests[1] = Make_TPM2B_DIGEST("sha1_2");
+  pcr_values.digests[2] = Make_TPM2B_DIGEST("sha256_0");
+  pcr_values.digests[3] = Make_TPM2B_DIGEST("sha256_2");
+  EXPECT_CALL(mock_tpm_, PCR_ReadSync(_, _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(pcr_select),
+                      SetArgPointee<3>(pcr_values), Return(TPM_RC_SUCCESS)));
+  std::map<TPM_ALG_ID, std::vector<std::string>> values;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.ReadPCRs({2, 0}, {TPM_ALG_SHA1, TPM_ALG_SHA256},
+                              &values));
+  EXPECT_EQ((std::vector<std::string>{"sha1_2", "sha1_0"}),
+            values[TPM_ALG_SHA1]);
+  EXPECT_EQ((std::vector<std::string>{"sha256_2", "sha256_0"}),
+            values[TPM_ALG_SHA256]);
+}
+
+TEST_F(TpmUtilityTest, ReadPCRsUnexpectedPCR) {
+  TPML_PCR_SELECTION pcr_select;
+  memset(&pcr_select, 0, sizeof(pcr_select));
+  pcr_select.count = 1;
+  pcr_select.pcr_selections[0].hash = TPM_ALG_SHA256;
+  pcr_select.pcr_selections[0].sizeof_select = PCR_SELECT_MIN;
+  pcr_select.pcr_selections[0].pcr_select[0] = 0x02;
+  TPML_DIGEST pcr_values;
+  pcr_values.count = 1;
+  pcr_values.digests[0] = Make_TPM2B_DIGEST("value");
+  EXPECT_CALL(mock_tpm_, PCR_ReadSync(_, _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(pcr_select),
+                      SetArgPointee<3>(pcr_values), Return(TPM_RC_SUCCESS)));
+  std::map<TPM_ALG_ID, std::vector<std::string>> values;
+  EXPECT_EQ(TPM_RC_FAILURE,
+            utility_.ReadPCRs({0}, {TPM_ALG_SHA256}, &values));
+}
+
+TEST_F(TpmUtilityTest, ReadPCRsBadParam) {
+  std::map<TPM_ALG_ID, std::vector<std::string>> values;
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER,
+            utility_.ReadPCRs({IMPLEMENTATION_PCR}, {TPM_ALG_SHA256},
+                              &values));
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER, utility_.ReadPCRs({0}, {}, &values));
+}
+
+TEST_F(TpmUtilityTest, ExtendPCRsMultipleBanks) {
+  TPML_DIGEST_VALUES digests;
+  EXPECT_CALL(mock_tpm_, PCR_ExtendSync(HR_PCR + 2, _, _, _))
+      .WillOnce(DoAll(SaveArg<2>(&digests), Return(TPM_RC_SUCCESS)));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.ExtendPCRs(2, "data", {TPM_ALG_SHA1, TPM_ALG_SHA256},
+                                nullptr));
+  EXPECT_EQ(2u, digests.count);
+  EXPECT_EQ(TPM_ALG_SHA1, digests.digests[0].hash_alg);
+  std::string sha1 = base::SHA1HashString("data");
+  EXPECT_EQ(0, memcmp(sha1.data(), digests.digests[0].digest.sha1,
+                      sha1.size()));
+  EXPECT_EQ(TPM_ALG_SHA256, digests.digests[1].hash_alg);
+  std::string sha256 = crypto::SHA256HashString("data");
+  EXPECT_EQ(0, memcmp(sha256.data(), digests.digests[1].digest.sha256,
+                      sha256.size()));
+}
+
+TEST_F(TpmUtilityTest, ExtendPCRsUnsupportedBank) {
+  EXPECT_CALL(mock_tpm_, PCR_ExtendSync(_, _, _, _)).Times(0);
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER,
+            utility_.ExtendPCRs(2, "data", {TPM_ALG_SHA384}, nullptr));
+}
+
+TEST_F(TpmUtilityTest, AsymmetricEncryptInSoftware) {
+  TPM_HANDLE key_handle = TRANSIENT_FIRST;
+  TPM2B_PUBLIC public_area;
+  bssl::UniquePtr<RSA> rsa = CreateTestRSAKey(kDecrypt, &public_area);
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(key_handle, _, _, _, _, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(public_area), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_, RSA_EncryptSync(_, _, _, _, _, _, _)).Times(0);
+  utility_.SetUseSoftwarePublicKeyOperations(true);
+  std::string plaintext("plaintext");
+  std::string ciphertext;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.AsymmetricEncrypt(key_handle, TPM_ALG_NULL, TPM_ALG_NULL,
+                                       plaintext, nullptr, &ciphertext));
+  // Decrypt with the private key the way the TPM would: OAEP with SHA-256
+  // for both the label hash and MGF1.
+  bssl::UniquePtr<EVP_PKEY> key(EVP_PKEY_new());
+  ASSERT_TRUE(EVP_PKEY_set1_RSA(key.get(), rsa.get()));
+  bssl::UniquePtr<EVP_PKEY_CTX> context(EVP_PKEY_CTX_new(key.get(), nullptr));
+  ASSERT_TRUE(EVP_PKEY_decrypt_init(context.get()));
+  ASSERT_TRUE(
+      EVP_PKEY_CTX_set_rsa_padding(context.get(), RSA_PKCS1_OAEP_PADDING));
+  ASSERT_TRUE(EVP_PKEY_CTX_set_rsa_oaep_md(context.get(), EVP_sha256()));
+  ASSERT_TRUE(EVP_PKEY_CTX_set_rsa_mgf1_md(context.get(), EVP_sha256()));
+  std::string decrypted(ciphertext.size(), 0);
+  size_t decrypted_length = decrypted.size();
+  ASSERT_TRUE(EVP_PKEY_decrypt(
+      context.get(),
+      reinterpret_cast<uint8_t*>(base::string_as_array(&decrypted)),
+      &decrypted_length, reinterpret_cast<const uint8_t*>(ciphertext.data()),
+      ciphertext.size()));
+  decrypted.resize(decrypted_length);
+  EXPECT_EQ(plaintext, decrypted);
+}
+
 TEST_F(TpmUtilityTest, AsymmetricEncryptSuccess) {
   TPM_HANDLE key_handle;
   std::string plaintext;
@@ -703,6 +922,37 @@ TEST_F(TpmUtilityTest, AsymmetricDecryptSchemeForward) {
   EXPECT_EQ(scheme.scheme, TPM_ALG_RSAES);
 }
 
+TEST_F(TpmUtilityTest, SignFileSuccess) {
+  TPM_HANDLE key_handle = TRANSIENT_FIRST;
+  std::string contents(100000, 'a');
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath path = temp_dir.path().Append("log");
+  ASSERT_EQ(static_cast<int>(contents.size()),
+            base::WriteFile(path, contents.data(), contents.size()));
+  base::File file(path, base::File::FLAG_OPEN | base::File::FLAG_READ);
+  ASSERT_TRUE(file.IsValid());
+  TPM2B_PUBLIC public_area;
+  public_area.public_area.type = TPM_ALG_RSA;
+  public_area.public_area.object_attributes = kSign;
+  public_area.public_area.auth_policy.size = 0;
+  public_area.public_area.unique.rsa.size = 0;
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(key_handle, _, _, _, _, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(public_area), Return(TPM_RC_SUCCESS)));
+  TPM2B_DIGEST tpm_digest;
+  EXPECT_CALL(mock_tpm_, SignSync(key_handle, _, _, _, _, _,
+                                  &mock_authorization_delegate_))
+      .WillOnce(DoAll(SaveArg<2>(&tpm_digest), Return(TPM_RC_SUCCESS)));
+  std::string signature;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.SignFile(key_handle, TPM_ALG_NULL, TPM_ALG_NULL,
+                              file.GetPlatformFile(),
+                              &mock_authorization_delegate_, &signature));
+  EXPECT_EQ(crypto::SHA256HashString(contents),
+            StringFrom_TPM2B_DIGEST(tpm_digest));
+}
+
 TEST_F(TpmUtilityTest, SignSuccess) {
   TPM_HANDLE key_handle;
   std::string password("password");
@@ -885,6 +1135,97 @@ TEST_F(TpmUtilityTest, SignSchemeForward) {
   EXPECT_EQ(scheme.details.rsapss.hash_alg, TPM_ALG_SHA1);
 }
 
+TEST_F(TpmUtilityTest, SignECDSAPadsSignature) {
+  TPM_HANDLE key_handle = 0;
+  std::string digest(32, 'a');
+  TPMT_SIGNATURE signature_out;
+  signature_out.signature.ecdsa.signature_r =
+      Make_TPM2B_ECC_PARAMETER(std::string(31, 'r'));
+  signature_out.signature.ecdsa.signature_s =
+      Make_TPM2B_ECC_PARAMETER(std::string(32, 's'));
+  std::string signature;
+  TPM2B_PUBLIC public_area;
+  TPMT_SIG_SCHEME scheme;
+  public_area.public_area.type = TPM_ALG_ECC;
+  public_area.public_area.object_attributes = kSign;
+  public_area.public_area.parameters.ecc_detail.curve_id = TPM_ECC_NIST_P256;
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(key_handle, _, _, _, _, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(public_area), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_, SignSync(key_handle, _, _, _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<5>(signature_out), SaveArg<3>(&scheme),
+                      Return(TPM_RC_SUCCESS)));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.Sign(key_handle, TPM_ALG_NULL, TPM_ALG_NULL, digest,
+                          &mock_authorization_delegate_, &signature));
+  EXPECT_EQ(scheme.scheme, TPM_ALG_ECDSA);
+  EXPECT_EQ(scheme.details.ecdsa.hash_alg, TPM_ALG_SHA256);
+  EXPECT_EQ(std::string(1, '\0') + std::string(31, 'r') + std::string(32, 's'),
+            signature);
+}
+
+TEST_F(TpmUtilityTest, SignECDSARejectsRSAKey) {
+  TPM_HANDLE key_handle = 0;
+  std::string digest(32, 'a');
+  std::string signature;
+  TPM2B_PUBLIC public_area;
+  public_area.public_area.type = TPM_ALG_RSA;
+  public_area.public_area.object_attributes = kSign;
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(key_handle, _, _, _, _, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(public_area), Return(TPM_RC_SUCCESS)));
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER,
+            utility_.Sign(key_handle, TPM_ALG_ECDSA, TPM_ALG_NULL, digest,
+                          &mock_authorization_delegate_, &signature));
+}
+
+TEST_F(TpmUtilityTest, VerifyInSoftware) {
+  TPM_HANDLE key_handle = TRANSIENT_FIRST;
+  TPM2B_PUBLIC public_area;
+  bssl::UniquePtr<RSA> rsa = CreateTestRSAKey(kSign, &public_area);
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(key_handle, _, _, _, _, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(public_area), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_, VerifySignatureSync(_, _, _, _, _, _)).Times(0);
+  std::string plaintext("plaintext");
+  std::string digest = crypto::SHA256HashString(plaintext);
+  std::string signature(RSA_size(rsa.get()), 0);
+  unsigned int signature_length = 0;
+  ASSERT_TRUE(RSA_sign(
+      NID_sha256, reinterpret_cast<const uint8_t*>(digest.data()),
+      digest.size(),
+      reinterpret_cast<uint8_t*>(base::string_as_array(&signature)),
+      &signature_length, rsa.get()));
+  signature.resize(signature_length);
+  utility_.SetUseSoftwarePublicKeyOperations(true);
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.Verify(key_handle, TPM_ALG_NULL, TPM_ALG_NULL, plaintext,
+                            signature, nullptr));
+  signature[0] ^= 1;
+  EXPECT_EQ(TPM_RC_SIGNATURE,
+            utility_.Verify(key_handle, TPM_ALG_NULL, TPM_ALG_NULL, plaintext,
+                            signature, nullptr));
+}
+
+TEST_F(TpmUtilityTest, GetKeyPublicAreaCachesPersistentHandles) {
+  TPM2B_PUBLIC public_area;
+  public_area.public_area.type = TPM_ALG_RSA;
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(kRSAStorageRootKey, _, _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(public_area), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(TRANSIENT_FIRST, _, _, _, _, _))
+      .Times(2)
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(public_area), Return(TPM_RC_SUCCESS)));
+  TPMT_PUBLIC public_data;
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(TPM_RC_SUCCESS,
+              utility_.GetKeyPublicArea(kRSAStorageRootKey, &public_data));
+    EXPECT_EQ(TPM_ALG_RSA, public_data.type);
+    EXPECT_EQ(TPM_RC_SUCCESS,
+              utility_.GetKeyPublicArea(TRANSIENT_FIRST, &public_data));
+  }
+}
+
 TEST_F(TpmUtilityTest, VerifySuccess) {
   TPM_HANDLE key_handle;
   std::string digest(32, 'a');
@@ -1034,6 +1375,36 @@ TEST_F(TpmUtilityTest, VerifySchemeForward) {
   EXPECT_EQ(signature_in.signature.rsassa.hash, TPM_ALG_SHA1);
 }
 
+TEST_F(TpmUtilityTest, VerifyECDSASplitsSignature) {
+  TPM_HANDLE key_handle = 0;
+  std::string digest(32, 'a');
+  std::string signature = std::string(32, 'r') + std::string(32, 's');
+  TPM2B_PUBLIC public_area;
+  TPMT_SIGNATURE signature_in;
+  public_area.public_area.type = TPM_ALG_ECC;
+  public_area.public_area.object_attributes = kSign;
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(key_handle, _, _, _, _, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(public_area), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_, VerifySignatureSync(key_handle, _, _, _, _, _))
+      .WillOnce(DoAll(SaveArg<3>(&signature_in), Return(TPM_RC_SUCCESS)));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.Verify(key_handle, TPM_ALG_ECDSA, TPM_ALG_NULL, digest,
+                            signature, nullptr));
+  EXPECT_EQ(signature_in.sig_alg, TPM_ALG_ECDSA);
+  EXPECT_EQ(signature_in.signature.ecdsa.hash, TPM_ALG_SHA256);
+  EXPECT_EQ(std::string(32, 'r'),
+            StringFrom_TPM2B_ECC_PARAMETER(
+                signature_in.signature.ecdsa.signature_r));
+  EXPECT_EQ(std::string(32, 's'),
+            StringFrom_TPM2B_ECC_PARAMETER(
+                signature_in.signature.ecdsa.signature_s));
+  // An odd length cannot be split into r and s.
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER,
+            utility_.Verify(key_handle, TPM_ALG_ECDSA, TPM_ALG_NULL, digest,
+                            signature + "x", nullptr));
+}
+
 TEST_F(TpmUtilityTest, CertifyCreationSuccess) {
   TPM_HANDLE key_handle = 42;
   std::string creation_blob;
@@ -1230,6 +1601,31 @@ TEST_F(TpmUtilityTest, ImportRSAKeyParserFail) {
                                   &mock_authorization_delegate_, &key_blob));
 }
 
+TEST_F(TpmUtilityTest, ImportECCKeySuccess) {
+  std::string point_x(32, 'x');
+  std::string point_y(32, 'y');
+  std::string private_value(32, 'p');
+  TPM2B_PUBLIC public_data;
+  EXPECT_CALL(mock_tpm_, ImportSync(kRSAStorageRootKey, _, _, _, _, _, _, _,
+                                    &mock_authorization_delegate_))
+      .WillOnce(DoAll(SaveArg<3>(&public_data), Return(TPM_RC_SUCCESS)));
+  std::string key_blob;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.ImportECCKey(TpmUtility::AsymmetricKeyUsage::kSignKey,
+                                  TPM_ECC_NIST_P256, point_x, point_y,
+                                  private_value, "password",
+                                  &mock_authorization_delegate_, &key_blob));
+  EXPECT_EQ(TPM_ALG_ECC, public_data.public_area.type);
+  EXPECT_EQ(public_data.public_area.object_attributes & kSign, kSign);
+  EXPECT_EQ(public_data.public_area.object_attributes & kDecrypt, 0u);
+  EXPECT_EQ(TPM_ECC_NIST_P256,
+            public_data.public_area.parameters.ecc_detail.curve_id);
+  EXPECT_EQ(point_x, StringFrom_TPM2B_ECC_PARAMETER(
+                         public_data.public_area.unique.ecc.x));
+  EXPECT_EQ(point_y, StringFrom_TPM2B_ECC_PARAMETER(
+                         public_data.public_area.unique.ecc.y));
+}
+
 TEST_F(TpmUtilityTest, CreateRSAKeyPairSuccess) {
   TPM2B_PUBLIC public_area;
   TPML_PCR_SELECTION creation_pcrs;
@@ -1353,6 +1749,104 @@ TEST_F(TpmUtilityTest, CreateRSAKeyPairCreationParserFail) {
                 &mock_authorization_delegate_, &key_blob, &creation_blob));
 }
 
+TEST_F(TpmUtilityTest, CreateRSAKeyPairUsesPregeneratedKey) {
+  EXPECT_CALL(mock_tpm_, CreateSyncShort(kRSAStorageRootKey, _, _, _, _, _, _,
+                                         _, _, &mock_authorization_delegate_))
+      .Times(2)
+      .WillRepeatedly(Return(TPM_RC_SUCCESS));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.PregenerateRSAKeyPairs(
+                TpmUtility::AsymmetricKeyUsage::kSignKey, 2048, 0x10001,
+                "password", "", false, 2, &mock_authorization_delegate_));
+  // The pool is already full.
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.PregenerateRSAKeyPairs(
+                TpmUtility::AsymmetricKeyUsage::kSignKey, 2048, 0x10001,
+                "password", "", false, 2, &mock_authorization_delegate_));
+  testing::Mock::VerifyAndClearExpectations(&mock_tpm_);
+  EXPECT_CALL(mock_tpm_, CreateSyncShort(_, _, _, _, _, _, _, _, _, _))
+      .Times(0);
+  std::string key_blob;
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(TPM_RC_SUCCESS,
+              utility_.CreateRSAKeyPair(
+                  TpmUtility::AsymmetricKeyUsage::kSignKey, 2048, 0x10001,
+                  "password", "", false, kNoCreationPCR,
+                  &mock_authorization_delegate_, &key_blob, nullptr));
+  }
+  testing::Mock::VerifyAndClearExpectations(&mock_tpm_);
+  // The pool is empty again.
+  EXPECT_CALL(mock_tpm_, CreateSyncShort(_, _, _, _, _, _, _, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.CreateRSAKeyPair(
+                TpmUtility::AsymmetricKeyUsage::kSignKey, 2048, 0x10001,
+                "password", "", false, kNoCreationPCR,
+                &mock_authorization_delegate_, &key_blob, nullptr));
+}
+
+TEST_F(TpmUtilityTest, CreateRSAKeyPairIgnoresMismatchedPregeneratedKey) {
+  EXPECT_CALL(mock_tpm_, CreateSyncShort(_, _, _, _, _, _, _, _, _, _))
+      .Times(3)
+      .WillRepeatedly(Return(TPM_RC_SUCCESS));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.PregenerateRSAKeyPairs(
+                TpmUtility::AsymmetricKeyUsage::kSignKey, 2048, 0x10001,
+                "password", "", false, 1, &mock_authorization_delegate_));
+  std::string key_blob;
+  // A different password needs a different key.
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.CreateRSAKeyPair(
+                TpmUtility::AsymmetricKeyUsage::kSignKey, 2048, 0x10001,
+                "other", "", false, kNoCreationPCR,
+                &mock_authorization_delegate_, &key_blob, nullptr));
+  // Keys bound to a creation PCR are never pooled.
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.CreateRSAKeyPair(
+                TpmUtility::AsymmetricKeyUsage::kSignKey, 2048, 0x10001,
+                "password", "", false, 2, &mock_authorization_delegate_,
+                &key_blob, nullptr));
+}
+
+TEST_F(TpmUtilityTest, CreateECCKeyPairSuccess) {
+  TPM2B_PUBLIC public_area;
+  TPML_PCR_SELECTION creation_pcrs;
+  EXPECT_CALL(mock_tpm_, CreateSyncShort(kRSAStorageRootKey, _, _, _, _, _, _,
+                                         _, _, &mock_authorization_delegate_))
+      .WillOnce(DoAll(SaveArg<2>(&public_area), SaveArg<3>(&creation_pcrs),
+                      Return(TPM_RC_SUCCESS)));
+  std::string key_blob;
+  std::string policy_digest(32, 'a');
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.CreateECCKeyPair(
+                TpmUtility::AsymmetricKeyUsage::kSignKey, TPM_ECC_NIST_P256,
+                "password", policy_digest, true, kNoCreationPCR,
+                &mock_authorization_delegate_, &key_blob, nullptr));
+  EXPECT_EQ(TPM_ALG_ECC, public_area.public_area.type);
+  EXPECT_EQ(public_area.public_area.object_attributes & kSign, kSign);
+  EXPECT_EQ(public_area.public_area.object_attributes & kDecrypt, 0u);
+  EXPECT_EQ(public_area.public_area.object_attributes & kUserWithAuth, 0u);
+  EXPECT_EQ(public_area.public_area.object_attributes & kAdminWithPolicy,
+            kAdminWithPolicy);
+  EXPECT_EQ(TPM_ECC_NIST_P256,
+            public_area.public_area.parameters.ecc_detail.curve_id);
+  EXPECT_EQ(TPM_ALG_NULL,
+            public_area.public_area.parameters.ecc_detail.scheme.scheme);
+  EXPECT_EQ(0u, creation_pcrs.count);
+}
+
+TEST_F(TpmUtilityTest, CreateECCKeyPairNotSupported) {
+  EXPECT_CALL(mock_tpm_state_, IsECCSupported()).WillRepeatedly(Return(false));
+  EXPECT_CALL(mock_tpm_, CreateSyncShort(_, _, _, _, _, _, _, _, _, _))
+      .Times(0);
+  std::string key_blob;
+  EXPECT_EQ(TPM_RC_ASYMMETRIC,
+            utility_.CreateECCKeyPair(
+                TpmUtility::AsymmetricKeyUsage::kSignKey, TPM_ECC_NIST_P256,
+                "password", "", false, kNoCreationPCR,
+                &mock_authorization_delegate_, &key_blob, nullptr));
+}
+
 TEST_F(TpmUtilityTest, LoadKeySuccess) {
   TPM_HANDLE key_handle = TPM_RH_FIRST;
   TPM_HANDLE loaded_handle;
@@ -1393,6 +1887,53 @@ TEST_F(TpmUtilityTest, LoadKeyParserFail) {
       utility_.LoadKey(key_blob, &mock_authorization_delegate_, &key_handle));
 }
 
+TEST_F(TpmUtilityTest, LoadKeysSuccess) {
+  std::vector<std::string> key_blobs = {"blob1", "blob2"};
+  EXPECT_CALL(mock_blob_parser_, ParseKeyBlob(_, _, _)).Times(2);
+  EXPECT_CALL(mock_tpm_, LoadSync(kRSAStorageRootKey, _, _, _, _, _,
+                                  &mock_authorization_delegate_))
+      .WillOnce(
+          DoAll(SetArgPointee<4>(TRANSIENT_FIRST), Return(TPM_RC_SUCCESS)))
+      .WillOnce(
+          DoAll(SetArgPointee<4>(TRANSIENT_FIRST + 1), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_, FlushContextSync(_, _)).Times(0);
+  std::vector<TPM_HANDLE> key_handles;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.LoadKeys(key_blobs, &mock_authorization_delegate_,
+                              &key_handles));
+  ASSERT_EQ(2u, key_handles.size());
+  EXPECT_EQ(TRANSIENT_FIRST, key_handles[0]);
+  EXPECT_EQ(TRANSIENT_FIRST + 1, key_handles[1]);
+}
+
+TEST_F(TpmUtilityTest, LoadKeysFlushesOnFailure) {
+  std::vector<std::string> key_blobs = {"blob1", "blob2"};
+  EXPECT_CALL(mock_tpm_, LoadSync(_, _, _, _, _, _, _))
+      .WillOnce(
+          DoAll(SetArgPointee<4>(TRANSIENT_FIRST), Return(TPM_RC_SUCCESS)))
+      .WillOnce(Return(TPM_RC_FAILURE));
+  EXPECT_CALL(mock_tpm_, FlushContextSync(TRANSIENT_FIRST, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  std::vector<TPM_HANDLE> key_handles;
+  EXPECT_EQ(TPM_RC_FAILURE,
+            utility_.LoadKeys(key_blobs, &mock_authorization_delegate_,
+                              &key_handles));
+  EXPECT_TRUE(key_handles.empty());
+}
+
+TEST_F(TpmUtilityTest, LoadKeysParserFailLoadsNothing) {
+  std::vector<std::string> key_blobs = {"blob1", "blob2"};
+  EXPECT_CALL(mock_blob_parser_, ParseKeyBlob(_, _, _))
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(mock_blob_parser_, ParseKeyBlob("blob2", _, _))
+      .WillOnce(Return(false));
+  EXPECT_CALL(mock_tpm_, LoadSync(_, _, _, _, _, _, _)).Times(0);
+  std::vector<TPM_HANDLE> key_handles;
+  EXPECT_EQ(SAPI_RC_BAD_TCTI_STRUCTURE,
+            utility_.LoadKeys(key_blobs, &mock_authorization_delegate_,
+                              &key_handles));
+}
+
 TEST_F(TpmUtilityTest, SealedDataSuccess) {
   std::string data_to_seal("seal_data");
   std::string sealed_data;
@@ -1464,6 +2005,40 @@ TEST_F(TpmUtilityTest, UnsealDataSuccess) {
   EXPECT_EQ(unsealed_data, tpm_unsealed_data);
 }
 
+TEST_F(TpmUtilityTest, UnsealDataCache) {
+  std::string sealed_data("sealed");
+  std::string tpm_unsealed_data("password");
+  TPM_HANDLE object_handle = 42;
+  TPM2B_PUBLIC public_data;
+  public_data.public_area.auth_policy.size = 0;
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(_, _, _, _, _, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(public_data), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_, LoadSync(_, _, _, _, _, _, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<4>(object_handle), Return(TPM_RC_SUCCESS)));
+  TPM2B_SENSITIVE_DATA out_data = Make_TPM2B_SENSITIVE_DATA(tpm_unsealed_data);
+  // Unsealed once before and once after the PCR extend.
+  EXPECT_CALL(mock_tpm_, UnsealSync(object_handle, _, _, _))
+      .Times(2)
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(out_data), Return(TPM_RC_SUCCESS)));
+  utility_.EnableUnsealCache(base::TimeDelta::FromHours(1));
+  std::string unsealed_data;
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(TPM_RC_SUCCESS,
+              utility_.UnsealData(sealed_data, &mock_authorization_delegate_,
+                                  &unsealed_data));
+    EXPECT_EQ(tpm_unsealed_data, unsealed_data);
+  }
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.ExtendPCR(1, "data", &mock_authorization_delegate_));
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.UnsealData(sealed_data, &mock_authorization_delegate_,
+                                &unsealed_data));
+  EXPECT_EQ(tpm_unsealed_data, unsealed_data);
+}
+
 TEST_F(TpmUtilityTest, UnsealDataBadDelegate) {
   std::string sealed_data;
   std::string unsealed_data;
@@ -1558,6 +2133,23 @@ TEST_F(TpmUtilityTest, GetPolicyDigestForPcrValueSuccessWithPcrValue) {
   EXPECT_EQ(pcr_value, tpm_pcr_value);
 }
 
+TEST_F(TpmUtilityTest, GetPolicyDigestForPcrValueCached) {
+  int index = 5;
+  std::string pcr_value("pcr_value");
+  EXPECT_CALL(mock_trial_session_, StartUnboundSession(false)).Times(1);
+  EXPECT_CALL(mock_trial_session_, PolicyPCR(index, pcr_value)).Times(1);
+  EXPECT_CALL(mock_trial_session_, GetDigest(_))
+      .WillOnce(DoAll(SetArgPointee<0>(std::string("digest")),
+                      Return(TPM_RC_SUCCESS)));
+  std::string policy_digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, utility_.GetPolicyDigestForPcrValue(
+                                index, pcr_value, &policy_digest));
+  std::string cached_policy_digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, utility_.GetPolicyDigestForPcrValue(
+                                index, pcr_value, &cached_policy_digest));
+  EXPECT_EQ("digest", cached_policy_digest);
+}
+
 TEST_F(TpmUtilityTest, GetPolicyDigestForPcrValueBadSession) {
   int index = 5;
   std::string pcr_value("value");
@@ -1587,6 +2179,123 @@ TEST_F(TpmUtilityTest, GetPolicyDigestForPcrValueBadPcr) {
                                 index, pcr_value, &policy_digest));
 }
 
+TEST_F(TpmUtilityTest, GetPolicyDigestForAuthority) {
+  std::string modulus(256, 'a');
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(_, _, _, _, _, _)).Times(0);
+  std::string policy_digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, utility_.GetPolicyDigestForAuthority(
+                                modulus, "ref", &policy_digest));
+  EXPECT_EQ(crypto::kSHA256Length, policy_digest.size());
+  std::string other_policy_digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, utility_.GetPolicyDigestForAuthority(
+                                std::string(256, 'b'), "ref",
+                                &other_policy_digest));
+  EXPECT_NE(policy_digest, other_policy_digest);
+  EXPECT_EQ(TPM_RC_SUCCESS, utility_.GetPolicyDigestForAuthority(
+                                modulus, "other", &other_policy_digest));
+  EXPECT_NE(policy_digest, other_policy_digest);
+}
+
+TEST_F(TpmUtilityTest, SignPolicyApproval) {
+  TPM_HANDLE key_handle = TPM_RH_FIRST;
+  TPM2B_PUBLIC public_area;
+  public_area.public_area.type = TPM_ALG_RSA;
+  public_area.public_area.object_attributes = kSign;
+  public_area.public_area.auth_policy.size = 0;
+  public_area.public_area.unique.rsa.size = 0;
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(key_handle, _, _, _, _, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(public_area), Return(TPM_RC_SUCCESS)));
+  TPMT_SIGNATURE signature_out;
+  signature_out.signature.rsassa.sig = Make_TPM2B_PUBLIC_KEY_RSA("approval");
+  TPM2B_DIGEST digest;
+  TPMT_SIG_SCHEME scheme;
+  EXPECT_CALL(mock_tpm_, SignSync(key_handle, _, _, _, _, _, _))
+      .WillOnce(DoAll(SaveArg<2>(&digest), SaveArg<3>(&scheme),
+                      SetArgPointee<5>(signature_out), Return(TPM_RC_SUCCESS)));
+  std::string signature;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.SignPolicyApproval(key_handle, "approved", "ref",
+                                        &mock_authorization_delegate_,
+                                        &signature));
+  EXPECT_EQ("approval", signature);
+  EXPECT_EQ(crypto::SHA256HashString("approvedref"),
+            StringFrom_TPM2B_DIGEST(digest));
+  EXPECT_EQ(TPM_ALG_RSASSA, scheme.scheme);
+}
+
+TEST_F(TpmUtilityTest, UnsealDataWithApprovedPolicySuccess) {
+  std::string modulus(256, 'a');
+  int index = 5;
+  EXPECT_CALL(mock_policy_session_, PolicyPCR(index, ""))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_policy_session_, GetDigest(_))
+      .WillOnce(DoAll(SetArgPointee<0>(std::string("approved")),
+                      Return(TPM_RC_SUCCESS)));
+  TPM_HANDLE key_handle = 43;
+  EXPECT_CALL(mock_tpm_, LoadExternalSync(_, _, TPM_RH_OWNER, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<3>(key_handle), Return(TPM_RC_SUCCESS)));
+  TPM2B_DIGEST verified_digest;
+  TPMT_SIGNATURE signature;
+  TPMT_TK_VERIFIED ticket = {};
+  ticket.tag = TPM_ST_VERIFIED;
+  ticket.hierarchy = TPM_RH_OWNER;
+  EXPECT_CALL(mock_tpm_, VerifySignatureSync(key_handle, _, _, _, _, _))
+      .WillOnce(DoAll(SaveArg<2>(&verified_digest), SaveArg<3>(&signature),
+                      SetArgPointee<4>(ticket), Return(TPM_RC_SUCCESS)));
+  std::string key_name;
+  EXPECT_CALL(mock_policy_session_, PolicyAuthorize("approved", "ref", _, _))
+      .WillOnce(DoAll(SaveArg<2>(&key_name), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_, FlushContextSync(key_handle, _))
+      .WillOnce(Return(TPM_RC_SUCCESS));
+  EXPECT_CALL(mock_policy_session_, GetDelegate())
+      .WillRepeatedly(Return(&mock_authorization_delegate_));
+  TPM_HANDLE object_handle = 42;
+  TPM2B_PUBLIC public_data;
+  public_data.public_area.auth_policy.size = 0;
+  EXPECT_CALL(mock_tpm_, ReadPublicSync(_, _, _, _, _, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<2>(public_data), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_, LoadSync(_, _, _, _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<4>(object_handle), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_, UnsealSync(object_handle, _, _,
+                                    &mock_authorization_delegate_))
+      .WillOnce(DoAll(SetArgPointee<2>(Make_TPM2B_SENSITIVE_DATA("secret")),
+                      Return(TPM_RC_SUCCESS)));
+  std::string unsealed_data;
+  EXPECT_EQ(TPM_RC_SUCCESS, utility_.UnsealDataWithApprovedPolicy(
+                                "sealed", index, modulus, "ref", "approval",
+                                &unsealed_data));
+  EXPECT_EQ("secret", unsealed_data);
+  EXPECT_EQ(crypto::SHA256HashString("approvedref"),
+            StringFrom_TPM2B_DIGEST(verified_digest));
+  EXPECT_EQ(TPM_ALG_RSASSA, signature.sig_alg);
+  EXPECT_EQ("approval",
+            StringFrom_TPM2B_PUBLIC_KEY_RSA(signature.signature.rsassa.sig));
+  // The session ends up with the digest the data was sealed to.
+  PolicyTemplate policy;
+  policy.AddAuthorize(key_name, "ref");
+  std::string expected_digest;
+  ASSERT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&expected_digest));
+  std::string policy_digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, utility_.GetPolicyDigestForAuthority(
+                                modulus, "ref", &policy_digest));
+  EXPECT_EQ(expected_digest, policy_digest);
+}
+
+TEST_F(TpmUtilityTest, UnsealDataWithApprovedPolicyBadApproval) {
+  EXPECT_CALL(mock_tpm_, LoadExternalSync(_, _, _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<3>(43), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_, VerifySignatureSync(_, _, _, _, _, _))
+      .WillOnce(Return(TPM_RC_SIGNATURE));
+  EXPECT_CALL(mock_policy_session_, PolicyAuthorize(_, _, _, _)).Times(0);
+  EXPECT_CALL(mock_tpm_, UnsealSync(_, _, _, _)).Times(0);
+  std::string unsealed_data;
+  EXPECT_EQ(TPM_RC_SIGNATURE, utility_.UnsealDataWithApprovedPolicy(
+                                  "sealed", 5, std::string(256, 'a'), "ref",
+                                  "approval", &unsealed_data));
+}
+
 TEST_F(TpmUtilityTest, GetPolicyDigestForPcrValueBadDigest) {
   int index = 5;
   std::string pcr_value("value");
@@ -1871,6 +2580,78 @@ TEST_F(TpmUtilityTest, ReadNVSpaceFailure) {
                                  &mock_authorization_delegate_));
 }
 
+TEST_F(TpmUtilityTest, WriteNVSpaceInChunksSuccess) {
+  uint32_t index = 53;
+  uint32_t nv_index = NV_INDEX_FIRST + index;
+  EXPECT_CALL(mock_tpm_state_, GetTpmProperty(TPM_PT_NV_BUFFER_MAX, _))
+      .WillRepeatedly(DoAll(SetArgPointee<1>(16), Return(true)));
+  std::string nvram_data(40, 'a');
+  {
+    InSequence sequence;
+    EXPECT_CALL(mock_tpm_, NV_WriteSync(nv_index, _, nv_index, _, _, 5,
+                                        &mock_authorization_delegate_))
+        .WillOnce(Return(TPM_RC_SUCCESS));
+    EXPECT_CALL(mock_tpm_, NV_WriteSync(nv_index, _, nv_index, _, _, 21,
+                                        &mock_authorization_delegate_))
+        .WillOnce(Return(TPM_RC_SUCCESS));
+    EXPECT_CALL(mock_tpm_, NV_WriteSync(nv_index, _, nv_index, _, _, 37,
+                                        &mock_authorization_delegate_))
+        .WillOnce(Return(TPM_RC_SUCCESS));
+  }
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.WriteNVSpaceInChunks(index, 5, nvram_data, false,
+                                          &mock_authorization_delegate_));
+}
+
+TEST_F(TpmUtilityTest, WriteNVSpaceInChunksFailure) {
+  uint32_t index = 53;
+  EXPECT_CALL(mock_tpm_state_, GetTpmProperty(TPM_PT_NV_BUFFER_MAX, _))
+      .WillRepeatedly(DoAll(SetArgPointee<1>(16), Return(true)));
+  EXPECT_CALL(mock_tpm_, NV_WriteSync(TPM_RH_OWNER, _, _, _, _, _, _))
+      .WillOnce(Return(TPM_RC_SUCCESS))
+      .WillOnce(Return(TPM_RC_FAILURE));
+  EXPECT_EQ(TPM_RC_FAILURE,
+            utility_.WriteNVSpaceInChunks(index, 0, std::string(40, 'a'), true,
+                                          &mock_authorization_delegate_));
+}
+
+TEST_F(TpmUtilityTest, ReadNVSpaceInChunksSuccess) {
+  uint32_t index = 53;
+  uint32_t nv_index = NV_INDEX_FIRST + index;
+  EXPECT_CALL(mock_tpm_state_, GetTpmProperty(TPM_PT_NV_BUFFER_MAX, _))
+      .WillRepeatedly(DoAll(SetArgPointee<1>(16), Return(true)));
+  {
+    InSequence sequence;
+    EXPECT_CALL(mock_tpm_, NV_ReadSync(nv_index, _, nv_index, _, 16, 0, _,
+                                       &mock_authorization_delegate_))
+        .WillOnce(DoAll(SetArgPointee<6>(Make_TPM2B_MAX_NV_BUFFER(
+                            std::string(16, 'a'))),
+                        Return(TPM_RC_SUCCESS)));
+    EXPECT_CALL(mock_tpm_, NV_ReadSync(nv_index, _, nv_index, _, 4, 16, _,
+                                       &mock_authorization_delegate_))
+        .WillOnce(DoAll(SetArgPointee<6>(Make_TPM2B_MAX_NV_BUFFER("bbbb")),
+                        Return(TPM_RC_SUCCESS)));
+  }
+  std::vector<std::string> chunks;
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            utility_.ReadNVSpaceInChunks(index, 0, 20, false,
+                                         base::Bind(&AppendChunk, &chunks),
+                                         &mock_authorization_delegate_));
+  EXPECT_EQ((std::vector<std::string>{std::string(16, 'a'), "bbbb"}), chunks);
+}
+
+TEST_F(TpmUtilityTest, ReadNVSpaceInChunksShortRead) {
+  EXPECT_CALL(mock_tpm_, NV_ReadSync(_, _, _, _, 20, 0, _, _))
+      .WillOnce(DoAll(SetArgPointee<6>(Make_TPM2B_MAX_NV_BUFFER("short")),
+                      Return(TPM_RC_SUCCESS)));
+  std::vector<std::string> chunks;
+  EXPECT_EQ(TPM_RC_FAILURE,
+            utility_.ReadNVSpaceInChunks(53, 0, 20, false,
+                                         base::Bind(&AppendChunk, &chunks),
+                                         &mock_authorization_delegate_));
+  EXPECT_TRUE(chunks.empty());
+}
+
 TEST_F(TpmUtilityTest, GetNVSpaceNameSuccess) {
   uint32_t index = 53;
   uint32_t nvram_index = NV_INDEX_FIRST + index;
@@ -1971,6 +2752,22 @@ TEST_F(TpmUtilityTest, SaltingKeySuccess) {
   EXPECT_EQ(TPM_ALG_SHA256, public_area.public_area.name_alg);
 }
 
+TEST_F(TpmUtilityTest, SaltingKeyType) {
+  TPM2B_PUBLIC public_area;
+  EXPECT_CALL(mock_tpm_, CreateSyncShort(_, _, _, _, _, _, _, _, _, _))
+      .WillRepeatedly(DoAll(SaveArg<2>(&public_area), Return(TPM_RC_SUCCESS)));
+  EXPECT_CALL(mock_tpm_state_, IsECCSupported())
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+  EXPECT_EQ(TPM_RC_SUCCESS, CreateSaltingKey("password"));
+  EXPECT_EQ(TPM_ALG_ECC, public_area.public_area.type);
+  EXPECT_EQ(TPM_ECC_NIST_P256,
+            public_area.public_area.parameters.ecc_detail.curve_id);
+  EXPECT_EQ(kDecrypt, public_area.public_area.object_attributes & kDecrypt);
+  EXPECT_EQ(TPM_RC_SUCCESS, CreateSaltingKey("password"));
+  EXPECT_EQ(TPM_ALG_RSA, public_area.public_area.type);
+}
+
 TEST_F(TpmUtilityTest, SaltingKeyConsistency) {
   TPM_HANDLE test_handle = 42;
   EXPECT_CALL(mock_tpm_, LoadSync(_, _, _, _, _, _, _))
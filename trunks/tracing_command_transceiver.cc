@@ -0,0 +1,185 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/tracing_command_transceiver.h"
+
+#include <algorithm>
+
+#include <base/bind.h>
+#include <base/callback.h>
+#include <base/logging.h>
+
+namespace {
+
+// Returns the response code of a |response|, or TPM_RC_FAILURE if it is
+// malformed.
+trunks::TPM_RC GetResponseCode(const std::string& response) {
+  if (response.size() < 10) {
+    return trunks::TPM_RC_FAILURE;
+  }
+  std::string buffer = response.substr(6, sizeof(trunks::TPM_RC));
+  trunks::TPM_RC code = trunks::TPM_RC_FAILURE;
+  trunks::Parse_TPM_RC(&buffer, &code, nullptr);
+  return code;
+}
+
+}  // namespace
+
+namespace trunks {
+
+TracingCommandTransceiver::TracingCommandTransceiver(
+    CommandTransceiver* next_transceiver,
+    std::unique_ptr<TraceWriter> writer)
+    : next_transceiver_(next_transceiver),
+      trace_start_(base::TimeTicks::Now()),
+      writer_(std::move(writer)),
+      weak_factory_(this) {}
+
+TracingCommandTransceiver::~TracingCommandTransceiver() {}
+
+void TracingCommandTransceiver::SendCommand(const std::string& command,
+                                            const ResponseCallback& callback) {
+  next_transceiver_->SendCommand(
+      command, base::Bind(&TracingCommandTransceiver::OnResponse, GetWeakPtr(),
+                          0, command, base::TimeTicks::Now(), callback));
+}
+
+std::string TracingCommandTransceiver::SendCommandAndWait(
+    const std::string& command) {
+  base::TimeTicks start = base::TimeTicks::Now();
+  std::string response = next_transceiver_->SendCommandAndWait(command);
+  RecordCommand(0, command, start, response);
+  return response;
+}
+
+void TracingCommandTransceiver::SendCommandBatch(
+    const std::vector<std::string>& commands,
+    bool stop_on_failure,
+    const BatchResponseCallback& callback) {
+  next_transceiver_->SendCommandBatch(
+      commands, stop_on_failure,
+      base::Bind(&TracingCommandTransceiver::OnBatchResponse, GetWeakPtr(),
+                 commands, base::TimeTicks::Now(), callback));
+}
+
+std::vector<std::string> TracingCommandTransceiver::SendCommandBatchAndWait(
+    const std::vector<std::string>& commands,
+    bool stop_on_failure) {
+  base::TimeTicks start = base::TimeTicks::Now();
+  std::vector<std::string> responses =
+      next_transceiver_->SendCommandBatchAndWait(commands, stop_on_failure);
+  RecordCommands(0, commands, start, responses);
+  return responses;
+}
+
+void TracingCommandTransceiver::SendCommandForClient(
+    const std::string& client,
+    const std::string& command,
+    const ResponseCallback& callback) {
+  next_transceiver_->SendCommandForClient(
+      client, command,
+      base::Bind(&TracingCommandTransceiver::OnResponse, GetWeakPtr(),
+                 GetClientId(client), command, base::TimeTicks::Now(),
+                 callback));
+}
+
+void TracingCommandTransceiver::SendScheduledCommandForClient(
+    const std::string& client,
+    const std::string& command,
+    RequestedPriority priority,
+    base::TimeTicks deadline,
+    const ResponseCallback& callback) {
+  next_transceiver_->SendScheduledCommandForClient(
+      client, command, priority, deadline,
+      base::Bind(&TracingCommandTransceiver::OnResponse, GetWeakPtr(),
+                 GetClientId(client), command, base::TimeTicks::Now(),
+                 callback));
+}
+
+void TracingCommandTransceiver::OnClientDisconnected(
+    const std::string& client) {
+  {
+    base::AutoLock lock(lock_);
+    auto iter = client_ids_.find(client);
+    if (iter != client_ids_.end()) {
+      TraceRecord record;
+      record.type = TraceRecord::kClientDisconnected;
+      record.offset = base::TimeTicks::Now() - trace_start_;
+      record.client_id = iter->second;
+      writer_->Write(record);
+      client_ids_.erase(iter);
+    }
+  }
+  next_transceiver_->OnClientDisconnected(client);
+}
+
+uint32_t TracingCommandTransceiver::GetClientId(const std::string& client) {
+  base::AutoLock lock(lock_);
+  auto iter = client_ids_.find(client);
+  if (iter != client_ids_.end()) {
+    return iter->second;
+  }
+  uint32_t id = next_client_id_++;
+  client_ids_[client] = id;
+  return id;
+}
+
+void TracingCommandTransceiver::RecordCommand(uint32_t client_id,
+                                              const std::string& command,
+                                              base::TimeTicks start,
+                                              const std::string& response) {
+  TraceRecord record;
+  record.type = TraceRecord::kCommand;
+  record.offset = start - trace_start_;
+  record.client_id = client_id;
+  record.command = RedactCommand(command);
+  record.response_code = GetResponseCode(response);
+  record.response_size = response.size();
+  record.latency = base::TimeTicks::Now() - start;
+  base::AutoLock lock(lock_);
+  writer_->Write(record);
+}
+
+void TracingCommandTransceiver::RecordCommands(
+    uint32_t client_id,
+    const std::vector<std::string>& commands,
+    base::TimeTicks start,
+    const std::vector<std::string>& responses) {
+  for (size_t i = 0; i < std::min(commands.size(), responses.size()); ++i) {
+    RecordCommand(client_id, commands[i], start, responses[i]);
+  }
+}
+
+void TracingCommandTransceiver::OnResponse(uint32_t client_id,
+                                           const std::string& command,
+                                           base::TimeTicks start,
+                                           const ResponseCallback& callback,
+                                           const std::string& response) {
+  RecordCommand(client_id, command, start, response);
+  callback.Run(response);
+}
+
+void TracingCommandTransceiver::OnBatchResponse(
+    const std::vector<std::string>& commands,
+    base::TimeTicks start,
+    const BatchResponseCallback& callback,
+    const std::vector<std::string>& responses) {
+  RecordCommands(0, commands, start, responses);
+  callback.Run(responses);
+}
+
+}  // namespace trunks
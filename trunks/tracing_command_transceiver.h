@@ -0,0 +1,120 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef TRUNKS_TRACING_COMMAND_TRANSCEIVER_H_
+#define TRUNKS_TRACING_COMMAND_TRANSCEIVER_H_
+
+#include "trunks/command_transceiver.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/macros.h>
+#include <base/memory/weak_ptr.h>
+#include <base/synchronization/lock.h>
+#include <base/time/time.h>
+
+#include "trunks/command_trace.h"
+
+namespace trunks {
+
+// Records the commands clients send, their timing and the client which sent
+// them to a trace for trunks_replay. Commands are redacted before they are
+// written. In trunksd this sits directly behind the IPC service so each
+// command is recorded as the client sent it, with virtual handles.
+//
+// Asynchronous responses must arrive on the thread which sent the command;
+// synchronous commands may be sent from any thread.
+class TracingCommandTransceiver : public CommandTransceiver {
+ public:
+  // Commands are forwarded to |next_transceiver|, which must outlive this
+  // object, and recorded with |writer|.
+  TracingCommandTransceiver(CommandTransceiver* next_transceiver,
+                            std::unique_ptr<TraceWriter> writer);
+  ~TracingCommandTransceiver() override;
+
+  // CommandTransceiver methods.
+  void SendCommand(const std::string& command,
+                   const ResponseCallback& callback) override;
+  std::string SendCommandAndWait(const std::string& command) override;
+  void SendCommandBatch(const std::vector<std::string>& commands,
+                        bool stop_on_failure,
+                        const BatchResponseCallback& callback) override;
+  std::vector<std::string> SendCommandBatchAndWait(
+      const std::vector<std::string>& commands,
+      bool stop_on_failure) override;
+  void SendCommandForClient(const std::string& client,
+                            const std::string& command,
+                            const ResponseCallback& callback) override;
+  void SendScheduledCommandForClient(const std::string& client,
+                                     const std::string& command,
+                                     RequestedPriority priority,
+                                     base::TimeTicks deadline,
+                                     const ResponseCallback& callback) override;
+  void OnClientDisconnected(const std::string& client) override;
+
+ private:
+  // Returns the trace id of |client|, assigning one on first use.
+  uint32_t GetClientId(const std::string& client);
+
+  // Records |command| from |client_id|, sent at |start|, and its |response|.
+  void RecordCommand(uint32_t client_id,
+                     const std::string& command,
+                     base::TimeTicks start,
+                     const std::string& response);
+
+  // Records |commands| and the |responses| received for them. Commands after a
+  // failure in a batch have no response and are not recorded.
+  void RecordCommands(uint32_t client_id,
+                      const std::vector<std::string>& commands,
+                      base::TimeTicks start,
+                      const std::vector<std::string>& responses);
+
+  void OnResponse(uint32_t client_id,
+                  const std::string& command,
+                  base::TimeTicks start,
+                  const ResponseCallback& callback,
+                  const std::string& response);
+  void OnBatchResponse(const std::vector<std::string>& commands,
+                       base::TimeTicks start,
+                       const BatchResponseCallback& callback,
+                       const std::vector<std::string>& responses);
+
+  base::WeakPtr<TracingCommandTransceiver> GetWeakPtr() {
+    return weak_factory_.GetWeakPtr();
+  }
+
+  CommandTransceiver* next_transceiver_;
+  const base::TimeTicks trace_start_;
+
+  // Guards the members below.
+  base::Lock lock_;
+  std::unique_ptr<TraceWriter> writer_;
+  std::map<std::string, uint32_t> client_ids_;
+  uint32_t next_client_id_ = 1;
+
+  // Declared last so weak pointers are invalidated first on destruction.
+  base::WeakPtrFactory<TracingCommandTransceiver> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(TracingCommandTransceiver);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_TRACING_COMMAND_TRANSCEIVER_H_
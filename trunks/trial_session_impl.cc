@@ -0,0 +1,146 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/trial_session_impl.h"
+
+#include <base/logging.h>
+#include <crypto/sha2.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/policy_template.h"
+
+namespace trunks {
+
+TrialSessionImpl::TrialSessionImpl() {}
+
+TrialSessionImpl::~TrialSessionImpl() {}
+
+AuthorizationDelegate* TrialSessionImpl::GetDelegate() {
+  return nullptr;
+}
+
+TPM_RC TrialSessionImpl::StartBoundSession(
+    TPMI_DH_ENTITY bind_entity,
+    const std::string& bind_authorization_value,
+    bool enable_encryption) {
+  // Binding only affects session keys, never the policy digest.
+  return StartUnboundSession(enable_encryption);
+}
+
+TPM_RC TrialSessionImpl::StartUnboundSession(bool enable_encryption) {
+  policy_digest_.assign(crypto::kSHA256Length, 0);
+  return TPM_RC_SUCCESS;
+}
+
+void TrialSessionImpl::StartUnboundSessionAsync(
+    bool enable_encryption,
+    const StartSessionCallback& callback) {
+  // Nothing is sent to the TPM so the session is ready right away.
+  callback.Run(StartUnboundSession(enable_encryption));
+}
+
+TPM_RC TrialSessionImpl::GetDigest(std::string* digest) {
+  CHECK(digest);
+  if (policy_digest_.empty()) {
+    LOG(ERROR) << "Trial session has not been started.";
+    return SAPI_RC_INVALID_SESSIONS;
+  }
+  *digest = policy_digest_;
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC TrialSessionImpl::PolicyOR(const std::vector<std::string>& digests) {
+  PolicyTemplate policy;
+  policy.AddOR(digests);
+  return ApplyPolicy(policy);
+}
+
+TPM_RC TrialSessionImpl::PolicyPCR(uint32_t pcr_index,
+                                   const std::string& pcr_value) {
+  if (pcr_value.empty()) {
+    LOG(ERROR) << "Trial sessions have to define a PCR value.";
+    return SAPI_RC_BAD_PARAMETER;
+  }
+  PolicyTemplate policy;
+  policy.AddPCR(pcr_index, pcr_value);
+  return ApplyPolicy(policy);
+}
+
+TPM_RC TrialSessionImpl::PolicyCommandCode(TPM_CC command_code) {
+  PolicyTemplate policy;
+  policy.AddCommandCode(command_code);
+  return ApplyPolicy(policy);
+}
+
+TPM_RC TrialSessionImpl::PolicyAuthValue() {
+  PolicyTemplate policy;
+  policy.AddAuthValue();
+  return ApplyPolicy(policy);
+}
+
+TPM_RC TrialSessionImpl::PolicyAuthorize(const std::string& approved_policy,
+                                         const std::string& policy_ref,
+                                         const std::string& key_name,
+                                         const TPMT_TK_VERIFIED& ticket) {
+  PolicyTemplate policy;
+  policy.AddAuthorize(key_name, policy_ref);
+  return ApplyPolicy(policy);
+}
+
+TPM_RC TrialSessionImpl::PolicySigned(TPMI_DH_OBJECT auth_object,
+                                      const std::string& auth_object_name,
+                                      const std::string& policy_ref,
+                                      int32_t expiration,
+                                      const TPMT_SIGNATURE& signature) {
+  PolicyTemplate policy;
+  policy.AddSigned(auth_object_name, policy_ref);
+  return ApplyPolicy(policy);
+}
+
+TPM_RC TrialSessionImpl::PolicySecret(TPMI_DH_ENTITY auth_entity,
+                                      const std::string& auth_entity_name,
+                                      AuthorizationDelegate* delegate) {
+  PolicyTemplate policy;
+  policy.AddSecret(auth_entity_name, "");
+  return ApplyPolicy(policy);
+}
+
+TPM_RC TrialSessionImpl::PolicyRestart() {
+  if (policy_digest_.empty()) {
+    LOG(ERROR) << "Trial session has not been started.";
+    return SAPI_RC_INVALID_SESSIONS;
+  }
+  policy_digest_.assign(crypto::kSHA256Length, 0);
+  return TPM_RC_SUCCESS;
+}
+
+TPM_RC TrialSessionImpl::ApplyPolicy(const PolicyTemplate& policy) {
+  if (policy_digest_.empty()) {
+    LOG(ERROR) << "Trial session has not been started.";
+    return SAPI_RC_INVALID_SESSIONS;
+  }
+  TPM_RC result = policy.ExtendDigest(&policy_digest_);
+  if (result != TPM_RC_SUCCESS) {
+    LOG(ERROR) << "Error extending trial policy: " << GetErrorString(result);
+    return result;
+  }
+  return TPM_RC_SUCCESS;
+}
+
+void TrialSessionImpl::SetEntityAuthorizationValue(const std::string& value) {}
+
+}  // namespace trunks
@@ -0,0 +1,82 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef TRUNKS_TRIAL_SESSION_IMPL_H_
+#define TRUNKS_TRIAL_SESSION_IMPL_H_
+
+#include "trunks/policy_session.h"
+
+#include <string>
+#include <vector>
+
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+// This class implements the PolicySession interface for trial sessions
+// entirely in software. It computes the same policy digest a TPM_SE_TRIAL
+// session would, without occupying a TPM session slot or sending any command
+// to the TPM. A trial session cannot authorize commands, so GetDelegate()
+// returns nullptr.
+// TrialSessionImpl session;
+// session.StartUnboundSession(false);
+// session.PolicyPCR(pcr_index, pcr_value);
+// session.GetDigest(&policy_digest);
+class TRUNKS_EXPORT TrialSessionImpl : public PolicySession {
+ public:
+  TrialSessionImpl();
+  ~TrialSessionImpl() override;
+
+  // PolicySession methods
+  AuthorizationDelegate* GetDelegate() override;
+  TPM_RC StartBoundSession(TPMI_DH_ENTITY bind_entity,
+                           const std::string& bind_authorization_value,
+                           bool enable_encryption) override;
+  TPM_RC StartUnboundSession(bool enable_encryption) override;
+  void StartUnboundSessionAsync(bool enable_encryption,
+                                const StartSessionCallback& callback) override;
+  TPM_RC GetDigest(std::string* digest) override;
+  TPM_RC PolicyOR(const std::vector<std::string>& digests) override;
+  TPM_RC PolicyPCR(uint32_t pcr_index, const std::string& pcr_value) override;
+  TPM_RC PolicyCommandCode(TPM_CC command_code) override;
+  TPM_RC PolicyAuthValue() override;
+  TPM_RC PolicyAuthorize(const std::string& approved_policy,
+                         const std::string& policy_ref,
+                         const std::string& key_name,
+                         const TPMT_TK_VERIFIED& ticket) override;
+  TPM_RC PolicySigned(TPMI_DH_OBJECT auth_object,
+                      const std::string& auth_object_name,
+                      const std::string& policy_ref,
+                      int32_t expiration,
+                      const TPMT_SIGNATURE& signature) override;
+  TPM_RC PolicySecret(TPMI_DH_ENTITY auth_entity,
+                      const std::string& auth_entity_name,
+                      AuthorizationDelegate* delegate) override;
+  TPM_RC PolicyRestart() override;
+  TPM_RC ApplyPolicy(const PolicyTemplate& policy) override;
+  void SetEntityAuthorizationValue(const std::string& value) override;
+
+ private:
+  // The policy digest of the session, or empty when no session is started.
+  std::string policy_digest_;
+
+  DISALLOW_COPY_AND_ASSIGN(TrialSessionImpl);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_TRIAL_SESSION_IMPL_H_
@@ -0,0 +1,129 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "trunks/trial_session_impl.h"
+
+#include <string>
+#include <vector>
+
+#include <crypto/sha2.h>
+#include <gtest/gtest.h>
+
+#include "trunks/error_codes.h"
+#include "trunks/policy_template.h"
+
+namespace trunks {
+
+TEST(TrialSessionTest, NotStarted) {
+  TrialSessionImpl session;
+  std::string digest;
+  EXPECT_EQ(SAPI_RC_INVALID_SESSIONS, session.GetDigest(&digest));
+  EXPECT_EQ(SAPI_RC_INVALID_SESSIONS, session.PolicyAuthValue());
+  EXPECT_EQ(nullptr, session.GetDelegate());
+}
+
+TEST(TrialSessionTest, MatchesPolicyTemplate) {
+  TrialSessionImpl session;
+  ASSERT_EQ(TPM_RC_SUCCESS, session.StartUnboundSession(false));
+  EXPECT_EQ(TPM_RC_SUCCESS, session.PolicyCommandCode(TPM_CC_Sign));
+  EXPECT_EQ(TPM_RC_SUCCESS, session.PolicyAuthValue());
+  EXPECT_EQ(TPM_RC_SUCCESS, session.PolicyPCR(2, "pcr_value"));
+  std::string digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, session.GetDigest(&digest));
+
+  PolicyTemplate policy;
+  policy.AddCommandCode(TPM_CC_Sign);
+  policy.AddAuthValue();
+  policy.AddPCR(2, "pcr_value");
+  std::string expected_digest;
+  ASSERT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&expected_digest));
+  EXPECT_EQ(expected_digest, digest);
+}
+
+TEST(TrialSessionTest, PolicyAuthorizeAndSigned) {
+  TrialSessionImpl session;
+  ASSERT_EQ(TPM_RC_SUCCESS, session.StartUnboundSession(false));
+  EXPECT_EQ(TPM_RC_SUCCESS, session.PolicyPCR(2, "pcr_value"));
+  // Trial sessions neither check the ticket nor the signature.
+  TPMT_TK_VERIFIED ticket = {};
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            session.PolicyAuthorize("approved", "ref", "authority", ticket));
+  TPMT_SIGNATURE signature = {};
+  EXPECT_EQ(TPM_RC_SUCCESS,
+            session.PolicySigned(TPM_RH_NULL, "signer", "ref2", 0, signature));
+  std::string digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, session.GetDigest(&digest));
+
+  PolicyTemplate policy;
+  policy.AddAuthorize("authority", "ref");
+  policy.AddSigned("signer", "ref2");
+  std::string expected_digest;
+  ASSERT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&expected_digest));
+  EXPECT_EQ(expected_digest, digest);
+}
+
+TEST(TrialSessionTest, PolicySecret) {
+  TrialSessionImpl session;
+  ASSERT_EQ(TPM_RC_SUCCESS, session.StartUnboundSession(false));
+  EXPECT_EQ(TPM_RC_SUCCESS, session.PolicySecret(TPM_RH_ENDORSEMENT, "entity",
+                                                 nullptr));
+  std::string digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, session.GetDigest(&digest));
+
+  PolicyTemplate policy;
+  policy.AddSecret("entity", "");
+  std::string expected_digest;
+  ASSERT_EQ(TPM_RC_SUCCESS, policy.ComputeDigest(&expected_digest));
+  EXPECT_EQ(expected_digest, digest);
+}
+
+TEST(TrialSessionTest, PolicyOR) {
+  TrialSessionImpl session;
+  ASSERT_EQ(TPM_RC_SUCCESS, session.StartUnboundSession(false));
+  std::vector<std::string> digests = {std::string(crypto::kSHA256Length, 1),
+                                      std::string(crypto::kSHA256Length, 2)};
+  EXPECT_EQ(TPM_RC_SUCCESS, session.PolicyOR(digests));
+  std::string digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, session.GetDigest(&digest));
+  std::string or_code("\x00\x00\x01\x71", 4);
+  EXPECT_EQ(crypto::SHA256HashString(std::string(crypto::kSHA256Length, 0) +
+                                     or_code + digests[0] + digests[1]),
+            digest);
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER,
+            session.PolicyOR(std::vector<std::string>(9, digest)));
+}
+
+TEST(TrialSessionTest, PolicyPCRRequiresValue) {
+  TrialSessionImpl session;
+  ASSERT_EQ(TPM_RC_SUCCESS, session.StartUnboundSession(false));
+  EXPECT_EQ(SAPI_RC_BAD_PARAMETER, session.PolicyPCR(0, ""));
+  std::string digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, session.GetDigest(&digest));
+  EXPECT_EQ(std::string(crypto::kSHA256Length, 0), digest);
+}
+
+TEST(TrialSessionTest, PolicyRestart) {
+  TrialSessionImpl session;
+  ASSERT_EQ(TPM_RC_SUCCESS, session.StartUnboundSession(false));
+  EXPECT_EQ(TPM_RC_SUCCESS, session.PolicyAuthValue());
+  EXPECT_EQ(TPM_RC_SUCCESS, session.PolicyRestart());
+  std::string digest;
+  EXPECT_EQ(TPM_RC_SUCCESS, session.GetDigest(&digest));
+  EXPECT_EQ(std::string(crypto::kSHA256Length, 0), digest);
+}
+
+}  // namespace trunks
@@ -48,20 +48,37 @@
       'target_name': 'trunks',
       'type': 'shared_library',
       'sources': [
+        'allocation_profile.cc',
         'background_command_transceiver.cc',
         'blob_parser.cc',
+        'boot_trace.cc',
+        'command_profile.cc',
+        'command_timeout_policy.cc',
+        'command_transceiver.cc',
         'error_codes.cc',
         'hmac_authorization_delegate.cc',
         'hmac_session_impl.cc',
+        'hmac_session_pool.cc',
+        'multiple_authorization_delegate.cc',
+        'nonce_pool.cc',
         'password_authorization_delegate.cc',
         'policy_session_impl.cc',
+        'policy_template.cc',
         'session_manager_impl.cc',
         'scoped_key_handle.cc',
+        'secret_envelope.cc',
+        'secure_arena.cc',
+        'shared_memory_channel.cc',
+        'shared_trunks_connection.cc',
+        'tpm2b_util.cc',
         'tpm_generated.cc',
+        'tpm_marshal.cc',
         'tpm_state_impl.cc',
         'tpm_utility_impl.cc',
+        'trial_session_impl.cc',
         'trunks_factory_impl.cc',
         'trunks_dbus_proxy.cc',
+        'trunks_shared_memory_proxy.cc',
       ],
       'dependencies': [
         'interface_proto',
@@ -83,6 +100,18 @@
         ],
       ],
     },
+    {
+      # Replaces operator new to count allocations. Only linked into binaries
+      # which report them.
+      'target_name': 'trunks_allocation_hooks',
+      'type': 'static_library',
+      'sources': [
+        'allocation_hooks.cc',
+      ],
+      'dependencies': [
+        'trunks',
+      ],
+    },
     {
       'target_name': 'trunks_test',
       'type': 'static_library',
@@ -111,18 +140,85 @@
         'trunks',
       ],
     },
+    {
+      'target_name': 'trunks_bench',
+      'type': 'executable',
+      'sources': [
+        'trunks_bench.cc',
+      ],
+      'dependencies': [
+        'trunks',
+        'trunks_allocation_hooks',
+      ],
+    },
+    {
+      'target_name': 'trunks_replay',
+      'type': 'executable',
+      'sources': [
+        'trunks_replay.cc',
+      ],
+      'dependencies': [
+        'trunks',
+        'trunksd_lib',
+      ],
+    },
+    {
+      'target_name': 'trunks_marshal_bench',
+      'type': 'executable',
+      'sources': [
+        'tpm_generated_benchmark.cc',
+      ],
+      'dependencies': [
+        'trunks',
+      ],
+    },
+    {
+      'target_name': 'trunks_session_bench',
+      'type': 'executable',
+      'sources': [
+        'session_crypto_benchmark.cc',
+      ],
+      'dependencies': [
+        'trunks',
+      ],
+    },
     {
       'target_name': 'trunksd_lib',
       'type': 'static_library',
       'sources': [
+        'caching_command_transceiver.cc',
+        'command_trace.cc',
+        'context_store.cc',
+        'fault_injecting_command_transceiver.cc',
         'resource_manager.cc',
+        'scheduling_command_transceiver.cc',
         'tpm_handle.cc',
         'tpm_simulator_handle.cc',
+        'tpm_simulator_pool.cc',
+        'tpm_telemetry.cc',
+        'tracing_command_transceiver.cc',
         'trunks_dbus_service.cc',
       ],
       'dependencies': [
         'interface_proto',
       ],
+      'conditions': [
+        ['USE_tpm2_simulator == 1', {
+          'defines': [
+            'USE_SIMULATOR',
+          ],
+          'direct_dependent_settings': {
+            'defines': [
+              'USE_SIMULATOR',
+            ],
+          },
+          'link_settings': {
+            'libraries': [
+              '-ltpm2',
+            ],
+          },
+        }],
+      ],
     },
     {
       'target_name': 'trunksd',
@@ -138,6 +234,7 @@
       'dependencies': [
         'interface_proto',
         'trunks',
+        'trunks_allocation_hooks',
         'trunksd_lib',
       ],
       'conditions': [
@@ -158,17 +255,39 @@
           'type': 'executable',
           'includes': ['../../../../platform2/common-mk/common_test.gypi'],
           'sources': [
+            'allocation_profile_test.cc',
             'background_command_transceiver_test.cc',
+            'boot_trace_test.cc',
+            'caching_command_transceiver_test.cc',
+            'command_budget_test.cc',
+            'command_profile_test.cc',
+            'command_timeout_policy_test.cc',
+            'command_trace_test.cc',
+            'context_store_test.cc',
+            'fault_injecting_command_transceiver_test.cc',
             'hmac_authorization_delegate_test.cc',
+            'hmac_session_pool_test.cc',
             'hmac_session_test.cc',
+            'multiple_authorization_delegate_test.cc',
+            'nonce_pool_test.cc',
             'password_authorization_delegate_test.cc',
             'policy_session_test.cc',
+            'policy_template_test.cc',
             'resource_manager_test.cc',
+            'scheduling_command_transceiver_test.cc',
             'scoped_key_handle_test.cc',
+            'secret_envelope_test.cc',
+            'secure_arena_test.cc',
             'session_manager_test.cc',
+            'shared_memory_channel_test.cc',
+            'shared_trunks_connection_test.cc',
             'tpm_generated_test.cc',
+            'tpm_marshal_test.cc',
+            'tpm_simulator_pool_test.cc',
             'tpm_state_test.cc',
+            'tpm_telemetry_test.cc',
             'tpm_utility_test.cc',
+            'trial_session_test.cc',
             'trunks_testrunner.cc',
           ],
           'dependencies': [
@@ -179,5 +298,20 @@
         },
       ],
     }],
+    ['USE_fuzzer == 1', {
+      'targets': [
+        {
+          'target_name': 'trunks_tpm_generated_fuzzer',
+          'type': 'executable',
+          'includes': ['../../../../platform2/common-mk/common_fuzzer.gypi'],
+          'sources': [
+            'tpm_generated_fuzzer.cc',
+          ],
+          'dependencies': [
+            'trunks',
+          ],
+        },
+      ],
+    }],
   ],
 }
@@ -0,0 +1,646 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// trunks_bench measures TPM throughput and latency through trunksd. Several
+// clients, each with its own trunksd connection and thread, run a weighted mix
+// of operations for a fixed time. The TPM behind trunksd decides what is
+// measured: the real TPM, the simulator (trunksd --simulator) or an emulated
+// slow TPM (trunksd --simulator --fault_injection=...).
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <base/bind.h>
+#include <base/command_line.h>
+#include <base/logging.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/strings/stringprintf.h>
+#include <base/synchronization/waitable_event.h>
+#include <base/threading/thread.h>
+#include <base/time/time.h>
+#include <brillo/syslog_logging.h>
+
+#include "trunks/allocation_profile.h"
+#include "trunks/error_codes.h"
+#include "trunks/hmac_session.h"
+#include "trunks/interface.pb.h"
+#include "trunks/policy_session.h"
+#include "trunks/scoped_key_handle.h"
+#include "trunks/tpm_utility.h"
+#include "trunks/trunks_dbus_proxy.h"
+#include "trunks/trunks_factory_impl.h"
+
+namespace trunks {
+namespace {
+
+const char kDefaultWorkload[] =
+    "pcr_read:4,pcr_extend:1,sign:1,decrypt:1,seal:1,unseal:1,session:1";
+const int kDefaultDurationSeconds = 10;
+// PCR 16 is the debug PCR; extending it affects no policy.
+const int kExtendPcr = 16;
+// Data is sealed to the current value of a PCR which is not extended after
+// boot.
+const int kSealPcr = 0;
+// NV indexes used by the nv_read and nv_write operations, one per client.
+const uint32_t kNvIndexBase = 0x100;
+const size_t kNvDataSize = 32;
+const char kKeyAuthorization[] = "bench";
+
+enum Operation {
+  kPcrRead,
+  kPcrExtend,
+  kSign,
+  kDecrypt,
+  kSeal,
+  kUnseal,
+  kNvRead,
+  kNvWrite,
+  kSessionChurn,
+  kNumOperations,
+};
+
+const char* const kOperationNames[kNumOperations] = {
+    "pcr_read", "pcr_extend", "sign",     "decrypt", "seal",
+    "unseal",   "nv_read",    "nv_write", "session",
+};
+
+void PrintUsage() {
+  puts("Usage: trunks_bench [options]");
+  puts("  --clients=<N> - Concurrent clients, 1 by default.");
+  puts("  --duration=<seconds> - How long to run, 10 by default.");
+  puts("  --workload=<op>:<weight>,... - The operation mix. Operations:");
+  puts("      pcr_read, pcr_extend, sign, decrypt, seal, unseal, session,");
+  puts("      nv_read and nv_write. The default is:");
+  printf("      %s\n", kDefaultWorkload);
+  puts("  --owner_password=<password> - Needed for nv_read and nv_write.");
+  puts("  --seed=<N> - Seeds the operation mix, 1 by default.");
+  puts("  --json - Prints results as JSON.");
+  puts("  --allocations - Prints the heap allocations of each command and");
+  puts("      layer during the run to stderr.");
+}
+
+// Parses a |workload| into one weight per operation. Returns false if it names
+// an unknown operation or has no positive weight.
+bool ParseWorkload(const std::string& workload, std::vector<int>* weights) {
+  weights->assign(kNumOperations, 0);
+  base::StringPairs pairs;
+  if (!base::SplitStringIntoKeyValuePairs(workload, ':', ',', &pairs)) {
+    return false;
+  }
+  int total = 0;
+  for (const auto& pair : pairs) {
+    const char* const* name = std::find(
+        kOperationNames, kOperationNames + kNumOperations, pair.first);
+    int weight = 0;
+    if (name == kOperationNames + kNumOperations ||
+        !base::StringToInt(pair.second, &weight) || weight < 0) {
+      LOG(ERROR) << "Invalid workload entry: " << pair.first;
+      return false;
+    }
+    (*weights)[name - kOperationNames] = weight;
+    total += weight;
+  }
+  return total > 0;
+}
+
+// Counts the commands a client sends to trunksd.
+class CountingTransceiver : public CommandTransceiver {
+ public:
+  explicit CountingTransceiver(CommandTransceiver* next_transceiver)
+      : next_transceiver_(next_transceiver) {}
+  ~CountingTransceiver() override {}
+
+  uint64_t command_count() const { return command_count_; }
+
+  // CommandTransceiver methods.
+  void SendCommand(const std::string& command,
+                   const ResponseCallback& callback) override {
+    ++command_count_;
+    next_transceiver_->SendCommand(command, callback);
+  }
+  std::string SendCommandAndWait(const std::string& command) override {
+    ++command_count_;
+    return next_transceiver_->SendCommandAndWait(command);
+  }
+
+ private:
+  CommandTransceiver* next_transceiver_;
+  uint64_t command_count_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingTransceiver);
+};
+
+// The measurements for one operation.
+struct OperationResults {
+  std::vector<base::TimeDelta> latencies;
+  uint64_t failures = 0;
+  uint64_t commands = 0;
+
+  void Merge(const OperationResults& other) {
+    latencies.insert(latencies.end(), other.latencies.begin(),
+                     other.latencies.end());
+    failures += other.failures;
+    commands += other.commands;
+  }
+};
+
+// Runs operations over its own trunksd connection. Every method must be called
+// on the same thread.
+class BenchmarkClient {
+ public:
+  BenchmarkClient(int id,
+                  const std::vector<int>& weights,
+                  const std::string& owner_password,
+                  uint32_t seed)
+      : id_(id),
+        weights_(weights),
+        owner_password_(owner_password),
+        random_(seed + id),
+        choose_operation_(weights.begin(), weights.end()) {}
+
+  // Connects to trunksd and creates the keys, sealed data and NV space the
+  // workload needs. Sets |*success| and signals |done|.
+  void SetUp(bool* success, base::WaitableEvent* done) {
+    *success = SetUpInternal();
+    done->Signal();
+  }
+
+  // Runs randomly chosen operations until |end_time|.
+  void Run(base::TimeTicks end_time) {
+    while (base::TimeTicks::Now() < end_time) {
+      Operation operation =
+          static_cast<Operation>(choose_operation_(random_));
+      uint64_t start_count = counter_->command_count();
+      base::TimeTicks start = base::TimeTicks::Now();
+      TPM_RC result = RunOperation(operation);
+      OperationResults* results = &results_[operation];
+      if (result != TPM_RC_SUCCESS) {
+        VLOG(1) << kOperationNames[operation]
+                << " failed: " << GetErrorString(result);
+        ++results->failures;
+        continue;
+      }
+      results->latencies.push_back(base::TimeTicks::Now() - start);
+      results->commands += counter_->command_count() - start_count;
+    }
+  }
+
+  // Releases what SetUp created.
+  void TearDown() {
+    if (nv_defined_) {
+      session_->SetEntityAuthorizationValue(owner_password_);
+      TPM_RC result =
+          utility_->DestroyNVSpace(nv_index_, session_->GetDelegate());
+      if (result != TPM_RC_SUCCESS) {
+        LOG(WARNING) << "Error destroying NV space: "
+                     << GetErrorString(result);
+      }
+    }
+    sign_key_.reset();
+    decrypt_key_.reset();
+    session_.reset();
+    utility_.reset();
+    factory_.reset();
+    counter_.reset();
+    // The connection is closed on the thread which opened it.
+    proxy_.reset();
+  }
+
+  const OperationResults& results(Operation operation) const {
+    return results_[operation];
+  }
+
+ private:
+  bool SetUpInternal() {
+    proxy_.reset(new TrunksDBusProxy);
+    if (!proxy_->Init()) {
+      LOG(ERROR) << "Client " << id_ << ": failed to connect to trunksd.";
+      return false;
+    }
+    counter_.reset(new CountingTransceiver(proxy_.get()));
+    factory_.reset(new TrunksFactoryImpl(counter_.get()));
+    if (!factory_->Initialize()) {
+      LOG(ERROR) << "Client " << id_ << ": failed to initialize factory.";
+      return false;
+    }
+    utility_ = factory_->GetTpmUtility();
+    session_ = factory_->GetHmacSession();
+    TPM_RC result = utility_->StartSession(session_.get());
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << "Error starting session: " << GetErrorString(result);
+      return false;
+    }
+    if (weights_[kSign] > 0 &&
+        !CreateKey(TpmUtility::AsymmetricKeyUsage::kSignKey, &sign_key_)) {
+      return false;
+    }
+    if (weights_[kDecrypt] > 0) {
+      if (!CreateKey(TpmUtility::AsymmetricKeyUsage::kDecryptKey,
+                     &decrypt_key_)) {
+        return false;
+      }
+      session_->SetEntityAuthorizationValue("");
+      result = utility_->AsymmetricEncrypt(
+          decrypt_key_->get(), TPM_ALG_NULL, TPM_ALG_NULL, "plaintext",
+          session_->GetDelegate(), &ciphertext_);
+      if (result != TPM_RC_SUCCESS) {
+        LOG(ERROR) << "Error encrypting: " << GetErrorString(result);
+        return false;
+      }
+    }
+    if (weights_[kSeal] > 0 || weights_[kUnseal] > 0) {
+      result =
+          utility_->GetPolicyDigestForPcrValue(kSealPcr, "", &policy_digest_);
+      if (result == TPM_RC_SUCCESS) {
+        result = utility_->SealData("sealed", policy_digest_,
+                                    session_->GetDelegate(), &sealed_data_);
+      }
+      if (result != TPM_RC_SUCCESS) {
+        LOG(ERROR) << "Error sealing data: " << GetErrorString(result);
+        return false;
+      }
+    }
+    if (weights_[kNvRead] > 0 || weights_[kNvWrite] > 0) {
+      if (owner_password_.empty()) {
+        LOG(ERROR) << "NV operations need --owner_password.";
+        return false;
+      }
+      nv_index_ = kNvIndexBase + id_;
+      session_->SetEntityAuthorizationValue(owner_password_);
+      result = utility_->DefineNVSpace(
+          nv_index_, kNvDataSize, TPMA_NV_OWNERWRITE | TPMA_NV_AUTHREAD, "",
+          "", session_->GetDelegate());
+      if (result != TPM_RC_SUCCESS) {
+        LOG(ERROR) << "Error defining NV space: " << GetErrorString(result);
+        return false;
+      }
+      nv_defined_ = true;
+      result = utility_->WriteNVSpace(nv_index_, 0,
+                                      std::string(kNvDataSize, 'a'), true,
+                                      false, session_->GetDelegate());
+      if (result != TPM_RC_SUCCESS) {
+        LOG(ERROR) << "Error writing NV space: " << GetErrorString(result);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Creates and loads a 2048-bit RSA key of the given |usage|.
+  bool CreateKey(TpmUtility::AsymmetricKeyUsage usage,
+                 std::unique_ptr<ScopedKeyHandle>* key) {
+    std::string key_blob;
+    TPM_RC result = utility_->CreateRSAKeyPair(
+        usage, 2048, 0x10001, kKeyAuthorization, "",
+        false,  // use_only_policy_authorization
+        kNoCreationPCR, session_->GetDelegate(), &key_blob, nullptr);
+    TPM_HANDLE handle = 0;
+    if (result == TPM_RC_SUCCESS) {
+      result = utility_->LoadKey(key_blob, session_->GetDelegate(), &handle);
+    }
+    if (result != TPM_RC_SUCCESS) {
+      LOG(ERROR) << "Error creating key: " << GetErrorString(result);
+      return false;
+    }
+    key->reset(new ScopedKeyHandle(*factory_, handle));
+    return true;
+  }
+
+  TPM_RC RunOperation(Operation operation) {
+    std::string output;
+    switch (operation) {
+      case kPcrRead:
+        return utility_->ReadPCR(kExtendPcr, &output);
+      case kPcrExtend:
+        return utility_->ExtendPCR(kExtendPcr, "bench",
+                                   session_->GetDelegate());
+      case kSign:
+        session_->SetEntityAuthorizationValue(kKeyAuthorization);
+        return utility_->Sign(sign_key_->get(), TPM_ALG_NULL, TPM_ALG_NULL,
+                              std::string(32, 'a'), session_->GetDelegate(),
+                              &output);
+      case kDecrypt:
+        session_->SetEntityAuthorizationValue(kKeyAuthorization);
+        return utility_->AsymmetricDecrypt(
+            decrypt_key_->get(), TPM_ALG_NULL, TPM_ALG_NULL, ciphertext_,
+            session_->GetDelegate(), &output);
+      case kSeal:
+        return utility_->SealData("sealed", policy_digest_,
+                                  session_->GetDelegate(), &output);
+      case kUnseal: {
+        std::unique_ptr<PolicySession> policy_session =
+            factory_->GetPolicySession();
+        TPM_RC result = policy_session->StartUnboundSession(false);
+        if (result == TPM_RC_SUCCESS) {
+          result = policy_session->PolicyPCR(kSealPcr, "");
+        }
+        if (result == TPM_RC_SUCCESS) {
+          result = utility_->UnsealData(
+              sealed_data_, policy_session->GetDelegate(), &output);
+        }
+        return result;
+      }
+      case kNvRead:
+        session_->SetEntityAuthorizationValue("");
+        return utility_->ReadNVSpace(nv_index_, 0, kNvDataSize, false,
+                                     &output, session_->GetDelegate());
+      case kNvWrite:
+        session_->SetEntityAuthorizationValue(owner_password_);
+        return utility_->WriteNVSpace(nv_index_, 0,
+                                      std::string(kNvDataSize, 'b'), true,
+                                      false, session_->GetDelegate());
+      case kSessionChurn:
+        return factory_->GetHmacSession()->StartUnboundSession(true);
+      case kNumOperations:
+        break;
+    }
+    return TPM_RC_FAILURE;
+  }
+
+  const int id_;
+  const std::vector<int> weights_;
+  const std::string owner_password_;
+  std::minstd_rand random_;
+  std::discrete_distribution<int> choose_operation_;
+  std::unique_ptr<TrunksDBusProxy> proxy_;
+  std::unique_ptr<CountingTransceiver> counter_;
+  std::unique_ptr<TrunksFactoryImpl> factory_;
+  std::unique_ptr<TpmUtility> utility_;
+  std::unique_ptr<HmacSession> session_;
+  std::unique_ptr<ScopedKeyHandle> sign_key_;
+  std::unique_ptr<ScopedKeyHandle> decrypt_key_;
+  std::string ciphertext_;
+  std::string policy_digest_;
+  std::string sealed_data_;
+  uint32_t nv_index_ = 0;
+  bool nv_defined_ = false;
+  OperationResults results_[kNumOperations];
+
+  DISALLOW_COPY_AND_ASSIGN(BenchmarkClient);
+};
+
+// Returns the TPM round trips trunksd has made so far, or zero if its
+// statistics are unavailable.
+uint64_t GetTpmRoundTrips() {
+  TrunksDBusProxy proxy;
+  ResourceManagerStats stats;
+  QueueStats queue_stats;
+  if (!proxy.Init() ||
+      !proxy.GetResourceManagerStats(&stats, &queue_stats, nullptr)) {
+    LOG(WARNING) << "Failed to read trunksd statistics.";
+    return 0;
+  }
+  uint64_t round_trips = 0;
+  for (const auto& command : stats.commands()) {
+    round_trips += command.tpm_round_trips();
+  }
+  return round_trips;
+}
+
+// Prints the allocations counted in this process to stderr, per layer and
+// command code.
+void PrintAllocations() {
+  std::vector<AllocationStats> allocations;
+  GetAllocationStats(&allocations);
+  fprintf(stderr, "%-31s %-10s %12s %14s\n", "layer", "command",
+          "allocations", "bytes");
+  for (const auto& entry : allocations) {
+    fprintf(stderr, "%-31s 0x%08x %12llu %14llu\n",
+            AllocationSource_Name(entry.source()).c_str(), entry.command_code(),
+            static_cast<unsigned long long>(entry.allocations()),
+            static_cast<unsigned long long>(entry.bytes()));
+  }
+}
+
+// Returns the |percentile| of sorted |latencies| in microseconds.
+int64_t GetPercentile(const std::vector<base::TimeDelta>& latencies,
+                      int percentile) {
+  if (latencies.empty()) {
+    return 0;
+  }
+  size_t index = std::min(latencies.size() - 1,
+                          latencies.size() * percentile / 100);
+  return latencies[index].InMicroseconds();
+}
+
+// Formats the |results| of a run of |elapsed| time with |clients| clients.
+// |tpm_round_trips| is the number trunksd reported for the run.
+std::string FormatResults(const OperationResults* results,
+                          int clients,
+                          base::TimeDelta elapsed,
+                          uint64_t tpm_round_trips,
+                          bool json) {
+  double seconds = elapsed.InSecondsF();
+  uint64_t total_ops = 0;
+  for (int i = 0; i < kNumOperations; ++i) {
+    total_ops += results[i].latencies.size();
+  }
+  double round_trips_per_op =
+      total_ops ? static_cast<double>(tpm_round_trips) / total_ops : 0.0;
+  std::string output;
+  if (json) {
+    base::StringAppendF(&output,
+                        "{\"clients\": %d, \"duration_s\": %.3f, "
+                        "\"total_ops\": %llu, \"ops_per_sec\": %.2f, "
+                        "\"tpm_round_trips_per_op\": %.2f, \"operations\": {",
+                        clients, seconds,
+                        static_cast<unsigned long long>(total_ops),
+                        total_ops / seconds, round_trips_per_op);
+  } else {
+    base::StringAppendF(&output, "%-10s %8s %8s %10s %10s %10s %8s %8s\n",
+                        "operation", "count", "failed", "ops/s", "p50_us",
+                        "p95_us", "p99_us", "cmds/op");
+  }
+  bool first = true;
+  for (int i = 0; i < kNumOperations; ++i) {
+    const OperationResults& result = results[i];
+    size_t count = result.latencies.size();
+    if (count == 0 && result.failures == 0) {
+      continue;
+    }
+    double commands_per_op =
+        count ? static_cast<double>(result.commands) / count : 0.0;
+    if (json) {
+      base::StringAppendF(
+          &output,
+          "%s\"%s\": {\"count\": %zu, \"failures\": %llu, "
+          "\"ops_per_sec\": %.2f, \"p50_us\": %lld, \"p95_us\": %lld, "
+          "\"p99_us\": %lld, \"commands_per_op\": %.2f}",
+          first ? "" : ", ", kOperationNames[i], count,
+          static_cast<unsigned long long>(result.failures), count / seconds,
+          static_cast<long long>(GetPercentile(result.latencies, 50)),
+          static_cast<long long>(GetPercentile(result.latencies, 95)),
+          static_cast<long long>(GetPercentile(result.latencies, 99)),
+          commands_per_op);
+    } else {
+      base::StringAppendF(
+          &output, "%-10s %8zu %8llu %10.2f %10lld %10lld %8lld %8.2f\n",
+          kOperationNames[i], count,
+          static_cast<unsigned long long>(result.failures), count / seconds,
+          static_cast<long long>(GetPercentile(result.latencies, 50)),
+          static_cast<long long>(GetPercentile(result.latencies, 95)),
+          static_cast<long long>(GetPercentile(result.latencies, 99)),
+          commands_per_op);
+    }
+    first = false;
+  }
+  if (json) {
+    output += "}}\n";
+  } else {
+    base::StringAppendF(&output,
+                        "%d clients, %.1f s: %llu ops, %.2f ops/s, "
+                        "%.2f TPM round trips/op\n",
+                        clients, seconds,
+                        static_cast<unsigned long long>(total_ops),
+                        total_ops / seconds, round_trips_per_op);
+  }
+  return output;
+}
+
+int RunBenchmark(base::CommandLine* cl) {
+  int clients = 1;
+  int duration = kDefaultDurationSeconds;
+  uint32_t seed = 1;
+  std::vector<int> weights;
+  std::string workload = kDefaultWorkload;
+  if (cl->HasSwitch("workload")) {
+    workload = cl->GetSwitchValueASCII("workload");
+  }
+  if ((cl->HasSwitch("clients") &&
+       !base::StringToInt(cl->GetSwitchValueASCII("clients"), &clients)) ||
+      clients < 1 ||
+      (cl->HasSwitch("duration") &&
+       !base::StringToInt(cl->GetSwitchValueASCII("duration"), &duration)) ||
+      duration < 1 ||
+      (cl->HasSwitch("seed") &&
+       !base::StringToUint(cl->GetSwitchValueASCII("seed"), &seed)) ||
+      !ParseWorkload(workload, &weights)) {
+    PrintUsage();
+    return -1;
+  }
+  std::string owner_password = cl->GetSwitchValueASCII("owner_password");
+
+  std::vector<std::unique_ptr<base::Thread>> threads;
+  std::vector<std::unique_ptr<BenchmarkClient>> bench_clients;
+  std::vector<std::unique_ptr<base::WaitableEvent>> ready;
+  std::unique_ptr<bool[]> setup_ok(new bool[clients]);
+  for (int i = 0; i < clients; ++i) {
+    threads.emplace_back(
+        new base::Thread(base::StringPrintf("bench_client_%d", i)));
+    CHECK(threads.back()->Start()) << "Failed to start client thread.";
+    bench_clients.emplace_back(
+        new BenchmarkClient(i, weights, owner_password, seed));
+    ready.emplace_back(new base::WaitableEvent(
+        base::WaitableEvent::ResetPolicy::MANUAL,
+        base::WaitableEvent::InitialState::NOT_SIGNALED));
+    threads.back()->task_runner()->PostTask(
+        FROM_HERE,
+        base::Bind(&BenchmarkClient::SetUp,
+                   base::Unretained(bench_clients.back().get()),
+                   &setup_ok[i], ready.back().get()));
+  }
+  // Key creation is slow so the clock starts once every client is ready.
+  bool all_ok = true;
+  for (int i = 0; i < clients; ++i) {
+    ready[i]->Wait();
+    all_ok = all_ok && setup_ok[i];
+  }
+  uint64_t start_round_trips = 0;
+  base::TimeTicks start = base::TimeTicks::Now();
+  if (all_ok) {
+    start_round_trips = GetTpmRoundTrips();
+    EnableAllocationTracking(cl->HasSwitch("allocations"));
+    start = base::TimeTicks::Now();
+    base::TimeTicks end_time =
+        start + base::TimeDelta::FromSeconds(duration);
+    for (int i = 0; i < clients; ++i) {
+      threads[i]->task_runner()->PostTask(
+          FROM_HERE, base::Bind(&BenchmarkClient::Run,
+                                base::Unretained(bench_clients[i].get()),
+                                end_time));
+    }
+  }
+  // Each client thread signals once its Run task is done.
+  std::vector<std::unique_ptr<base::WaitableEvent>> finished;
+  for (int i = 0; i < clients; ++i) {
+    finished.emplace_back(new base::WaitableEvent(
+        base::WaitableEvent::ResetPolicy::MANUAL,
+        base::WaitableEvent::InitialState::NOT_SIGNALED));
+    threads[i]->task_runner()->PostTask(
+        FROM_HERE, base::Bind(&base::WaitableEvent::Signal,
+                              base::Unretained(finished.back().get())));
+  }
+  for (int i = 0; i < clients; ++i) {
+    finished[i]->Wait();
+  }
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  EnableAllocationTracking(false);
+  uint64_t tpm_round_trips = 0;
+  if (all_ok) {
+    uint64_t end_round_trips = GetTpmRoundTrips();
+    if (end_round_trips >= start_round_trips) {
+      tpm_round_trips = end_round_trips - start_round_trips;
+    }
+  }
+  // Stopping a thread waits for the tasks posted to it.
+  OperationResults results[kNumOperations];
+  for (int i = 0; i < clients; ++i) {
+    threads[i]->task_runner()->PostTask(
+        FROM_HERE, base::Bind(&BenchmarkClient::TearDown,
+                              base::Unretained(bench_clients[i].get())));
+    threads[i]->Stop();
+    for (int op = 0; op < kNumOperations; ++op) {
+      results[op].Merge(
+          bench_clients[i]->results(static_cast<Operation>(op)));
+    }
+  }
+  if (!all_ok) {
+    LOG(ERROR) << "Benchmark setup failed.";
+    return -1;
+  }
+  for (int op = 0; op < kNumOperations; ++op) {
+    std::sort(results[op].latencies.begin(), results[op].latencies.end());
+  }
+  fputs(FormatResults(results, clients, elapsed, tpm_round_trips,
+                      cl->HasSwitch("json"))
+            .c_str(),
+        stdout);
+  if (cl->HasSwitch("allocations")) {
+    PrintAllocations();
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace trunks
+
+int main(int argc, char** argv) {
+  base::CommandLine::Init(argc, argv);
+  brillo::InitLog(brillo::kLogToStderr);
+  base::CommandLine* cl = base::CommandLine::ForCurrentProcess();
+  if (cl->HasSwitch("help")) {
+    trunks::PrintUsage();
+    return 0;
+  }
+  return trunks::RunBenchmark(cl);
+}
@@ -16,9 +16,12 @@
 
 #include "trunks/trunks_binder_proxy.h"
 
+#include <map>
+
 #include <base/bind.h>
 #include <base/callback.h>
 #include <base/logging.h>
+#include <base/synchronization/lock.h>
 #include <binderwrapper/binder_wrapper.h>
 #include <utils/Errors.h>
 
@@ -28,36 +31,69 @@
 #include "trunks/error_codes.h"
 #include "interface.pb.h"
 
-namespace {
+namespace trunks {
 
-// Implements ITrunksClient and forwards response data to a ResponseCallback.
-class ResponseObserver : public android::trunks::BnTrunksClient {
+// Implements ITrunksClient and forwards each response to the callback of the
+// command with the same tag.
+class TrunksBinderProxy::CompletionQueue
+    : public android::trunks::BnTrunksClient {
  public:
-  explicit ResponseObserver(
-      const trunks::CommandTransceiver::ResponseCallback& callback)
-      : callback_(callback) {}
+  CompletionQueue() = default;
+  ~CompletionQueue() override = default;
+
+  // Registers the |callback| of a new command and returns its tag.
+  uint64_t Add(const ResponseCallback& callback) {
+    base::AutoLock lock(lock_);
+    uint64_t tag = next_tag_++;
+    callbacks_[tag] = callback;
+    return tag;
+  }
+
+  // Removes the callback of a command which could not be sent.
+  void Remove(uint64_t tag) {
+    base::AutoLock lock(lock_);
+    callbacks_.erase(tag);
+  }
 
   // ITrunksClient interface.
   android::binder::Status OnCommandResponse(
       const std::vector<uint8_t>& response_proto_data) override {
-    trunks::SendCommandResponse response_proto;
+    SendCommandResponse response_proto;
     if (!response_proto.ParseFromArray(response_proto_data.data(),
                                        response_proto_data.size())) {
+      // The response cannot be matched to a command; its caller will wait
+      // until the proxy is destroyed.
       LOG(ERROR) << "TrunksBinderProxy: Bad response data.";
-      callback_.Run(
-          trunks::CreateErrorResponse(trunks::SAPI_RC_MALFORMED_RESPONSE));
+      return android::binder::Status::ok();
     }
-    callback_.Run(response_proto.response());
+    ResponseCallback callback;
+    {
+      base::AutoLock lock(lock_);
+      auto iter = callbacks_.find(response_proto.tag());
+      if (iter == callbacks_.end()) {
+        LOG(ERROR) << "TrunksBinderProxy: Unexpected response.";
+        return android::binder::Status::ok();
+      }
+      callback = iter->second;
+      callbacks_.erase(iter);
+    }
+    callback.Run(response_proto.response());
     return android::binder::Status::ok();
   }
 
  private:
-  trunks::CommandTransceiver::ResponseCallback callback_;
+  base::Lock lock_;
+  // Tag zero is reserved for responses without a tag.
+  uint64_t next_tag_ = 1;
+  std::map<uint64_t, ResponseCallback> callbacks_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompletionQueue);
 };
 
-}  // namespace
+TrunksBinderProxy::TrunksBinderProxy()
+    : completion_queue_(new CompletionQueue()) {}
 
-namespace trunks {
+TrunksBinderProxy::~TrunksBinderProxy() {}
 
 bool TrunksBinderProxy::Init() {
   android::sp<android::IBinder> service_binder =
@@ -75,19 +111,22 @@ void TrunksBinderProxy::SendCommand(const std::string& command,
                                     const ResponseCallback& callback) {
   SendCommandRequest command_proto;
   command_proto.set_command(command);
+  uint64_t tag = completion_queue_->Add(callback);
+  command_proto.set_tag(tag);
   std::vector<uint8_t> command_proto_data;
   command_proto_data.resize(command_proto.ByteSize());
   if (!command_proto.SerializeToArray(command_proto_data.data(),
                                       command_proto_data.size())) {
     LOG(ERROR) << "TrunksBinderProxy: Failed to serialize protobuf.";
+    completion_queue_->Remove(tag);
     callback.Run(CreateErrorResponse(TRUNKS_RC_IPC_ERROR));
     return;
   }
-  android::sp<ResponseObserver> observer(new ResponseObserver(callback));
   android::binder::Status status =
-      trunks_service_->SendCommand(command_proto_data, observer);
+      trunks_service_->SendCommand(command_proto_data, completion_queue_);
   if (!status.isOk()) {
     LOG(ERROR) << "TrunksBinderProxy: Binder error: " << status.toString8();
+    completion_queue_->Remove(tag);
     callback.Run(CreateErrorResponse(TRUNKS_RC_IPC_ERROR));
     return;
   }
@@ -119,4 +158,36 @@ std::string TrunksBinderProxy::SendCommandAndWait(const std::string& command) {
   return response_proto.response();
 }
 
+std::vector<std::string> TrunksBinderProxy::SendCommandBatchAndWait(
+    const std::vector<std::string>& commands,
+    bool stop_on_failure) {
+  SendCommandBatchRequest batch_proto;
+  for (const auto& command : commands) {
+    batch_proto.add_commands(command);
+  }
+  batch_proto.set_stop_on_failure(stop_on_failure);
+  std::vector<uint8_t> batch_proto_data;
+  batch_proto_data.resize(batch_proto.ByteSize());
+  if (!batch_proto.SerializeToArray(batch_proto_data.data(),
+                                    batch_proto_data.size())) {
+    LOG(ERROR) << "TrunksBinderProxy: Failed to serialize protobuf.";
+    return {CreateErrorResponse(TRUNKS_RC_IPC_ERROR)};
+  }
+  std::vector<uint8_t> response_proto_data;
+  android::binder::Status status = trunks_service_->SendCommandBatchAndWait(
+      batch_proto_data, &response_proto_data);
+  if (!status.isOk()) {
+    LOG(ERROR) << "TrunksBinderProxy: Binder error: " << status.toString8();
+    return {CreateErrorResponse(TRUNKS_RC_IPC_ERROR)};
+  }
+  trunks::SendCommandBatchResponse response_proto;
+  if (!response_proto.ParseFromArray(response_proto_data.data(),
+                                     response_proto_data.size())) {
+    LOG(ERROR) << "TrunksBinderProxy: Bad response data.";
+    return {trunks::CreateErrorResponse(trunks::SAPI_RC_MALFORMED_RESPONSE)};
+  }
+  return std::vector<std::string>(response_proto.responses().begin(),
+                                  response_proto.responses().end());
+}
+
 }  // namespace trunks
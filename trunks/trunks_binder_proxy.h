@@ -18,6 +18,7 @@
 #define TRUNKS_TRUNKS_BINDER_PROXY_H_
 
 #include <string>
+#include <vector>
 
 #include <base/macros.h>
 
@@ -30,10 +31,14 @@ namespace trunks {
 // TrunksBinderProxy is a CommandTransceiver implementation that forwards all
 // commands to the trunksd binder daemon. See TrunksBinderService for details on
 // how the commands are handled once they reach trunksd.
+//
+// Asynchronous commands are pipelined: SendCommand returns once trunksd has the
+// command, so any number may be in flight. Their responses all arrive at one
+// completion queue which matches them to callbacks by tag.
 class TRUNKS_EXPORT TrunksBinderProxy : public CommandTransceiver {
  public:
-  TrunksBinderProxy() = default;
-  ~TrunksBinderProxy() override = default;
+  TrunksBinderProxy();
+  ~TrunksBinderProxy() override;
 
   // Initializes the client. Returns true on success.
   bool Init() override;
@@ -43,9 +48,16 @@ class TRUNKS_EXPORT TrunksBinderProxy : public CommandTransceiver {
   void SendCommand(const std::string& command,
                    const ResponseCallback& callback) override;
   std::string SendCommandAndWait(const std::string& command) override;
+  std::vector<std::string> SendCommandBatchAndWait(
+      const std::vector<std::string>& commands,
+      bool stop_on_failure) override;
 
  private:
+  class CompletionQueue;
+
   android::sp<android::trunks::ITrunks> trunks_service_;
+  // Receives the responses to asynchronous commands.
+  android::sp<CompletionQueue> completion_queue_;
 
   DISALLOW_COPY_AND_ASSIGN(TrunksBinderProxy);
 };
@@ -19,6 +19,11 @@
 #include <sysexits.h>
 
 #include <base/bind.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/threading/thread_task_runner_handle.h>
+#include <base/time/time.h>
+#include <binder/IPCThreadState.h>
+#include <binder/ProcessState.h>
 #include <binderwrapper/binder_wrapper.h>
 
 #include "trunks/binder_interface.h"
@@ -28,28 +33,75 @@
 
 namespace {
 
-// If |command| is a valid command protobuf, provides the |command_data| and
+// Binder threads in addition to the main thread. Each synchronous call keeps
+// one busy until its command completes.
+const size_t kBinderThreadCount = 4;
+
+// If |command| is a valid command protobuf, provides it as |request_proto| and
 // returns true. Otherwise, returns false.
 bool ParseCommandProto(const std::vector<uint8_t>& command,
-                       std::string* command_data) {
-  trunks::SendCommandRequest request_proto;
-  if (!request_proto.ParseFromArray(command.data(), command.size()) ||
-      !request_proto.has_command() || request_proto.command().empty()) {
+                       trunks::SendCommandRequest* request_proto) {
+  if (!request_proto->ParseFromArray(command.data(), command.size()) ||
+      !request_proto->has_command() || request_proto->command().empty()) {
     return false;
   }
-  *command_data = request_proto.command();
   return true;
 }
 
+// Posts |task| to |task_runner|, e.g. to handle a binder death notification
+// received on a binder thread on the main thread instead.
+void PostTaskCallback(
+    const scoped_refptr<base::SingleThreadTaskRunner>& task_runner,
+    const base::Closure& task) {
+  task_runner->PostTask(FROM_HERE, task);
+}
+
 void CreateResponseProto(const std::string& data,
+                         uint64_t tag,
                          std::vector<uint8_t>* response) {
   trunks::SendCommandResponse response_proto;
   response_proto.set_response(data);
+  if (tag) {
+    response_proto.set_tag(tag);
+  }
   response->resize(response_proto.ByteSize());
   CHECK(response_proto.SerializeToArray(response->data(), response->size()))
       << "TrunksBinderService: Failed to serialize protobuf.";
 }
 
+// If |batch_request| is a valid batch request protobuf, provides the
+// |commands| and |stop_on_failure| flag and returns true. Otherwise, returns
+// false.
+bool ParseBatchRequestProto(const std::vector<uint8_t>& batch_request,
+                            std::vector<std::string>* commands,
+                            bool* stop_on_failure) {
+  trunks::SendCommandBatchRequest request_proto;
+  if (!request_proto.ParseFromArray(batch_request.data(),
+                                    batch_request.size())) {
+    return false;
+  }
+  for (const auto& command : request_proto.commands()) {
+    if (command.empty()) {
+      return false;
+    }
+    commands->push_back(command);
+  }
+  *stop_on_failure = request_proto.stop_on_failure();
+  return true;
+}
+
+void CreateBatchResponseProto(const std::vector<std::string>& responses,
+                              std::vector<uint8_t>* batch_response) {
+  trunks::SendCommandBatchResponse response_proto;
+  for (const auto& response : responses) {
+    response_proto.add_responses(response);
+  }
+  batch_response->resize(response_proto.ByteSize());
+  CHECK(response_proto.SerializeToArray(batch_response->data(),
+                                        batch_response->size()))
+      << "TrunksBinderService: Failed to serialize protobuf.";
+}
+
 }  // namespace
 
 namespace trunks {
@@ -61,6 +113,9 @@ int TrunksBinderService::OnInit() {
     return EX_UNAVAILABLE;
   }
   binder_ = new BinderServiceInternal(this);
+  android::ProcessState::self()->setThreadPoolMaxThreadCount(
+      kBinderThreadCount);
+  android::ProcessState::self()->startThreadPool();
   if (!android::BinderWrapper::Get()->RegisterService(
           kTrunksServiceName, android::IInterface::asBinder(binder_))) {
     LOG(ERROR) << "TrunksBinderService: RegisterService failed.";
@@ -72,29 +127,91 @@ int TrunksBinderService::OnInit() {
 
 TrunksBinderService::BinderServiceInternal::BinderServiceInternal(
     TrunksBinderService* service)
-    : service_(service) {}
+    : service_(service),
+      task_runner_(base::ThreadTaskRunnerHandle::Get()),
+      weak_this_(weak_factory_.GetWeakPtr()) {}
 
 android::binder::Status TrunksBinderService::BinderServiceInternal::SendCommand(
     const std::vector<uint8_t>& command,
     const android::sp<android::trunks::ITrunksClient>& client) {
-  auto callback =
-      base::Bind(&TrunksBinderService::BinderServiceInternal::OnResponse,
-                 GetWeakPtr(), client);
-  std::string command_data;
-  if (!ParseCommandProto(command, &command_data)) {
+  // This may run on any binder thread. Decode here and leave only queueing
+  // to the main thread.
+  SendCommandRequest request_proto;
+  if (!ParseCommandProto(command, &request_proto)) {
     LOG(ERROR) << "TrunksBinderService: Bad command data.";
-    callback.Run(CreateErrorResponse(SAPI_RC_BAD_PARAMETER));
+    task_runner_->PostTask(
+        FROM_HERE,
+        base::Bind(&TrunksBinderService::BinderServiceInternal::OnResponse,
+                   weak_this_, client, request_proto.tag(),
+                   CreateErrorResponse(SAPI_RC_BAD_PARAMETER)));
     return android::binder::Status::ok();
   }
-  service_->transceiver_->SendCommand(command_data, callback);
+  // The calling pid is stable while the process is alive, and the client is
+  // watched so it is not reused for a new process without a disconnect.
+  std::string client_id = "pid:" + base::IntToString(
+      android::IPCThreadState::self()->getCallingPid());
+  task_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&TrunksBinderService::BinderServiceInternal::QueueCommand,
+                 weak_this_, client_id, request_proto, client));
   return android::binder::Status::ok();
 }
 
+void TrunksBinderService::BinderServiceInternal::QueueCommand(
+    const std::string& client_id,
+    const SendCommandRequest& command,
+    const android::sp<android::trunks::ITrunksClient>& client) {
+  WatchClient(client_id, android::IInterface::asBinder(client));
+  base::TimeTicks deadline;
+  if (command.has_deadline_ms()) {
+    deadline = base::TimeTicks::Now() +
+               base::TimeDelta::FromMilliseconds(command.deadline_ms());
+  }
+  service_->transceiver_->SendScheduledCommandForClient(
+      client_id, command.command(),
+      static_cast<CommandTransceiver::RequestedPriority>(command.priority()),
+      deadline,
+      base::Bind(&TrunksBinderService::BinderServiceInternal::OnResponse,
+                 GetWeakPtr(), client, command.tag()));
+}
+
+void TrunksBinderService::BinderServiceInternal::WatchClient(
+    const std::string& client_id,
+    const android::sp<android::IBinder>& client) {
+  if (client_binders_.count(client_id) > 0) {
+    return;
+  }
+  if (!android::BinderWrapper::Get()->RegisterForDeathNotifications(
+          client,
+          base::Bind(
+              &PostTaskCallback, task_runner_,
+              base::Bind(
+                  &TrunksBinderService::BinderServiceInternal::OnClientDied,
+                  GetWeakPtr(), client_id)))) {
+    LOG(WARNING) << "TrunksBinderService: Failed to watch " << client_id;
+    return;
+  }
+  client_binders_[client_id] = client;
+}
+
+void TrunksBinderService::BinderServiceInternal::OnClientDied(
+    const std::string& client_id) {
+  auto iter = client_binders_.find(client_id);
+  if (iter == client_binders_.end()) {
+    return;
+  }
+  android::BinderWrapper::Get()->UnregisterForDeathNotifications(iter->second);
+  client_binders_.erase(iter);
+  VLOG(1) << "TrunksBinderService: Client died: " << client_id;
+  service_->transceiver_->OnClientDisconnected(client_id);
+}
+
 void TrunksBinderService::BinderServiceInternal::OnResponse(
     const android::sp<android::trunks::ITrunksClient>& client,
+    uint64_t tag,
     const std::string& response) {
   std::vector<uint8_t> binder_response;
-  CreateResponseProto(response, &binder_response);
+  CreateResponseProto(response, tag, &binder_response);
   android::binder::Status status = client->OnCommandResponse(binder_response);
   if (!status.isOk()) {
     LOG(ERROR) << "TrunksBinderService: Failed to send response to client: "
@@ -106,14 +223,35 @@ android::binder::Status
 TrunksBinderService::BinderServiceInternal::SendCommandAndWait(
     const std::vector<uint8_t>& command,
     std::vector<uint8_t>* response) {
-  std::string command_data;
-  if (!ParseCommandProto(command, &command_data)) {
+  // This blocks only the binder thread it runs on.
+  SendCommandRequest request_proto;
+  if (!ParseCommandProto(command, &request_proto)) {
     LOG(ERROR) << "TrunksBinderService: Bad command data.";
-    CreateResponseProto(CreateErrorResponse(SAPI_RC_BAD_PARAMETER), response);
+    CreateResponseProto(CreateErrorResponse(SAPI_RC_BAD_PARAMETER), 0,
+                        response);
+    return android::binder::Status::ok();
+  }
+  CreateResponseProto(
+      service_->transceiver_->SendCommandAndWait(request_proto.command()), 0,
+      response);
+  return android::binder::Status::ok();
+}
+
+android::binder::Status
+TrunksBinderService::BinderServiceInternal::SendCommandBatchAndWait(
+    const std::vector<uint8_t>& batch_request,
+    std::vector<uint8_t>* batch_response) {
+  std::vector<std::string> commands;
+  bool stop_on_failure = false;
+  if (!ParseBatchRequestProto(batch_request, &commands, &stop_on_failure)) {
+    LOG(ERROR) << "TrunksBinderService: Bad batch data.";
+    CreateBatchResponseProto({CreateErrorResponse(SAPI_RC_BAD_PARAMETER)},
+                             batch_response);
     return android::binder::Status::ok();
   }
-  CreateResponseProto(service_->transceiver_->SendCommandAndWait(command_data),
-                      response);
+  CreateBatchResponseProto(service_->transceiver_->SendCommandBatchAndWait(
+                               commands, stop_on_failure),
+                           batch_response);
   return android::binder::Status::ok();
 }
 
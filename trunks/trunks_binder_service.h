@@ -17,18 +17,30 @@
 #ifndef TRUNKS_TRUNKS_BINDER_SERVICE_H_
 #define TRUNKS_TRUNKS_BINDER_SERVICE_H_
 
+#include <map>
+#include <string>
+
+#include <base/memory/ref_counted.h>
 #include <base/memory/weak_ptr.h>
+#include <base/single_thread_task_runner.h>
 #include <brillo/binder_watcher.h>
 #include <brillo/daemons/daemon.h>
 
 #include "android/trunks/BnTrunks.h"
 #include "trunks/command_transceiver.h"
+#include "interface.pb.h"
 
 namespace trunks {
 
 // TrunksBinderService registers for and handles all incoming binder calls for
 // the trunksd system daemon.
 //
+// Incoming transactions are served by a binder thread pool in addition to the
+// main thread, so decoding a request and marshalling a reply for one client
+// never waits for another client's command, including a synchronous command
+// which blocks its binder thread until the TPM responds. Asynchronous commands
+// are queued on the main thread and their responses are sent from there.
+//
 // Example Usage:
 //
 // TrunksBinderService service;
@@ -39,8 +51,10 @@ class TrunksBinderService : public brillo::Daemon {
   TrunksBinderService() = default;
   ~TrunksBinderService() override = default;
 
-  // The |transceiver| will be the target of all incoming TPM commands. This
-  // class does not take ownership of |transceiver|.
+  // The |transceiver| will be the target of all incoming TPM commands. Its
+  // synchronous methods are called on binder threads and must be thread-safe;
+  // the other methods are called on the main thread. This class does not take
+  // ownership of |transceiver|.
   void set_transceiver(CommandTransceiver* transceiver) {
     transceiver_ = transceiver;
   }
@@ -62,9 +76,29 @@ class TrunksBinderService : public brillo::Daemon {
     android::binder::Status SendCommandAndWait(
         const std::vector<uint8_t>& command,
         std::vector<uint8_t>* response) override;
+    android::binder::Status SendCommandBatchAndWait(
+        const std::vector<uint8_t>& batch_request,
+        std::vector<uint8_t>* batch_response) override;
 
    private:
+    // Keeps a reference to the |client| binder of the process identified by
+    // |client_id| so its death is noticed.
+    void WatchClient(const std::string& client_id,
+                     const android::sp<android::IBinder>& client);
+
+    // Releases the resources held by the process identified by |client_id|.
+    // Runs on the main thread.
+    void OnClientDied(const std::string& client_id);
+
+    // Queues an asynchronous |command| for the process identified by
+    // |client_id|. Runs on the main thread.
+    void QueueCommand(
+        const std::string& client_id,
+        const SendCommandRequest& command,
+        const android::sp<android::trunks::ITrunksClient>& client);
+
     void OnResponse(const android::sp<android::trunks::ITrunksClient>& client,
+                    uint64_t tag,
                     const std::string& response);
 
     base::WeakPtr<BinderServiceInternal> GetWeakPtr() {
@@ -72,9 +106,16 @@ class TrunksBinderService : public brillo::Daemon {
     }
 
     TrunksBinderService* service_;
+    // The main thread, where asynchronous commands are queued.
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner_;
+    // A binder from each calling process, by client id. Binder death is only
+    // signaled when the owning process exits.
+    std::map<std::string, android::sp<android::IBinder>> client_binders_;
 
     // Declared last so weak pointers are invalidated first on destruction.
     base::WeakPtrFactory<BinderServiceInternal> weak_factory_{this};
+    // Bound on the main thread for binder threads to post tasks with.
+    base::WeakPtr<BinderServiceInternal> weak_this_;
   };
 
   CommandTransceiver* transceiver_ = nullptr;
@@ -17,15 +17,31 @@
 // trunks_client is a command line tool that supports various TPM operations. It
 // does not provide direct access to the trunksd D-Bus interface.
 
+#include <fcntl.h>
 #include <stdio.h>
+#include <sys/file.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <memory>
 #include <string>
+#include <vector>
 
+#include <base/bind.h>
 #include <base/command_line.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_file.h>
+#include <base/json/json_reader.h>
 #include <base/logging.h>
+#include <base/posix/eintr_wrapper.h>
 #include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/strings/stringprintf.h>
+#include <base/threading/thread.h>
+#include <base/time/time.h>
 #include <brillo/syslog_logging.h>
 
+#include "trunks/command_profile.h"
 #include "trunks/error_codes.h"
 #include "trunks/hmac_session.h"
 #include "trunks/password_authorization_delegate.h"
@@ -35,6 +51,10 @@
 #include "trunks/tpm_utility.h"
 #include "trunks/trunks_client_test.h"
 #include "trunks/trunks_factory_impl.h"
+#if !defined(USE_BINDER_IPC)
+#include "trunks/interface.pb.h"
+#include "trunks/trunks_dbus_proxy.h"
+#endif
 
 namespace {
 
@@ -42,6 +62,13 @@ using trunks::CommandTransceiver;
 using trunks::TrunksFactory;
 using trunks::TrunksFactoryImpl;
 
+// The NV index used by the regression test. Concurrent test clients use the
+// indexes following it.
+const uint32_t kRegressionTestNvIndex = 1;
+// Serializes the PCR-sensitive part of concurrent tests across threads and
+// processes.
+const char kPcrLockFile[] = "/tmp/.trunks_client_pcr.lock";
+
 void PrintUsage() {
   puts("Options:");
   puts("  --allocate_pcr - Configures PCR 0-15 under the SHA256 bank.");
@@ -55,9 +82,62 @@ void PrintUsage() {
   puts("                      need owner permissions.");
   puts("  --startup - Performs startup and self-tests.");
   puts("  --status - Prints TPM status information.");
+  puts("  --stats - Prints per-command statistics collected by trunksd.");
+  puts("  --telemetry - Prints the TPM health samples trunksd took recently.");
   puts("  --stress_test - Runs some basic stress tests.");
+  puts("  --profile - Prints the TPM commands used by common operations.");
+  puts("  --concurrent_test - Runs SignTest, DecryptTest, SealedDataTest,");
+  puts("                      ManyKeysTest and, if owner_password is");
+  puts("                      supplied, NvramTest from many connections at");
+  puts("                      once. Use --processes=<N>, --threads=<N> and");
+  puts("                      --iterations=<N>; the defaults are 2, 4 and 5.");
   puts("  --read_pcr --index=<N> - Reads a PCR and prints the value.");
   puts("  --extend_pcr --index=<N> --value=<value> - Extends a PCR.");
+  puts("  --batch=<file> - Runs the operations listed in a file, or stdin if");
+  puts("                   it is '-', using one connection to trunksd. Each");
+  puts("                   line is a JSON array of the options of one");
+  puts("                   operation, e.g. [\"--read_pcr\", \"--index=0\"].");
+  puts("                   Stops at the first operation which fails.");
+}
+
+// Reads the operations of a batch file at |path|, or stdin if it is "-". Each
+// non-empty line is a JSON array of the arguments an operation would be given
+// on the command line, which are parsed as if they followed |program|.
+// Returns false if the file cannot be read or a line is malformed.
+bool ReadBatch(const std::string& path,
+               const base::FilePath& program,
+               std::vector<base::CommandLine>* operations) {
+  std::string contents;
+  if (!base::ReadFileToString(
+          base::FilePath(path == "-" ? "/dev/stdin" : path), &contents)) {
+    LOG(ERROR) << "Failed to read batch file " << path;
+    return false;
+  }
+  int line_number = 0;
+  for (const std::string& line : base::SplitString(
+           contents, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL)) {
+    ++line_number;
+    if (line.empty()) {
+      continue;
+    }
+    std::unique_ptr<base::Value> value = base::JSONReader::Read(line);
+    base::ListValue* args = nullptr;
+    if (!value || !value->GetAsList(&args)) {
+      LOG(ERROR) << "Batch line " << line_number << " is not a JSON array.";
+      return false;
+    }
+    base::CommandLine::StringVector argv = {program.value()};
+    for (size_t i = 0; i < args->GetSize(); ++i) {
+      std::string arg;
+      if (!args->GetString(i, &arg)) {
+        LOG(ERROR) << "Batch line " << line_number << " has a non-string.";
+        return false;
+      }
+      argv.push_back(arg);
+    }
+    operations->emplace_back(argv);
+  }
+  return true;
 }
 
 std::string HexEncode(const std::string& bytes) {
@@ -134,6 +214,247 @@ int DumpStatus(const TrunksFactory& factory) {
   return 0;
 }
 
+#if !defined(USE_BINDER_IPC)
+// Returns the mean of |histogram| in microseconds.
+uint64_t GetMeanLatency(const trunks::LatencyHistogram& histogram,
+                        uint64_t count) {
+  return count ? histogram.total_us() / count : 0;
+}
+
+// Returns an upper bound in microseconds for the 99th percentile of
+// |histogram|.
+uint64_t GetTailLatency(const trunks::LatencyHistogram& histogram,
+                        uint64_t count) {
+  uint64_t seen = 0;
+  for (int i = 0; i < histogram.buckets_size(); ++i) {
+    seen += histogram.buckets(i);
+    if (seen * 100 >= count * 99) {
+      return 1ull << i;
+    }
+  }
+  return 0;
+}
+
+int DumpStats() {
+  trunks::TrunksDBusProxy proxy;
+  trunks::ResourceManagerStats stats;
+  trunks::QueueStats queue_stats;
+  std::vector<trunks::AllocationStats> allocations;
+  if (!proxy.Init() ||
+      !proxy.GetResourceManagerStats(&stats, &queue_stats, &allocations)) {
+    LOG(ERROR) << "Failed to read trunksd statistics.";
+    return -1;
+  }
+  printf("%-10s %8s %8s %10s %10s %10s %10s %10s %10s\n", "command", "count",
+         "tpm_io", "queue_us", "queue_p99", "total_us", "total_p99", "tpm_us",
+         "tpm_p99");
+  for (const auto& command : stats.commands()) {
+    uint64_t count = command.count();
+    printf("0x%08x %8llu %8llu %10llu %10llu %10llu %10llu %10llu %10llu\n",
+           command.command_code(), static_cast<unsigned long long>(count),
+           static_cast<unsigned long long>(command.tpm_round_trips()),
+           static_cast<unsigned long long>(
+               GetMeanLatency(command.queue_latency(), count)),
+           static_cast<unsigned long long>(
+               GetTailLatency(command.queue_latency(), count)),
+           static_cast<unsigned long long>(
+               GetMeanLatency(command.total_latency(), count)),
+           static_cast<unsigned long long>(
+               GetTailLatency(command.total_latency(), count)),
+           static_cast<unsigned long long>(
+               GetMeanLatency(command.tpm_latency(), count)),
+           static_cast<unsigned long long>(
+               GetTailLatency(command.tpm_latency(), count)));
+  }
+  printf("Context loads: %llu\n",
+         static_cast<unsigned long long>(stats.context_loads()));
+  printf("Context saves: %llu\n",
+         static_cast<unsigned long long>(stats.context_saves()));
+  printf("Queued commands: %llu (max %llu, %llu clients)\n",
+         static_cast<unsigned long long>(queue_stats.queued_commands()),
+         static_cast<unsigned long long>(queue_stats.max_queued_commands()),
+         static_cast<unsigned long long>(queue_stats.queued_clients()));
+  printf("Rejected commands: %llu\n",
+         static_cast<unsigned long long>(queue_stats.rejected_commands()));
+  printf("Warning retries: %llu (%llu self-test polls, %llu exhausted)\n",
+         static_cast<unsigned long long>(queue_stats.warning_retries()),
+         static_cast<unsigned long long>(queue_stats.self_test_polls()),
+         static_cast<unsigned long long>(
+             queue_stats.warning_retries_exhausted()));
+  if (!allocations.empty()) {
+    printf("%-31s %-10s %12s %14s\n", "layer", "command", "allocations",
+           "bytes");
+    for (const auto& entry : allocations) {
+      printf("%-31s 0x%08x %12llu %14llu\n",
+             trunks::AllocationSource_Name(entry.source()).c_str(),
+             entry.command_code(),
+             static_cast<unsigned long long>(entry.allocations()),
+             static_cast<unsigned long long>(entry.bytes()));
+    }
+  }
+  return 0;
+}
+
+int DumpTelemetry() {
+  trunks::TrunksDBusProxy proxy;
+  std::vector<trunks::TelemetrySample> samples;
+  if (!proxy.Init() || !proxy.GetTelemetry(0, &samples)) {
+    LOG(ERROR) << "Failed to read trunksd telemetry.";
+    return -1;
+  }
+  printf("%-19s %7s %8s %9s %7s %7s %7s %7s %8s %7s %8s\n", "time",
+         "objects", "sessions", "evictions", "retry", "yielded", "testing",
+         "queued", "rejected", "overdue", "lockout");
+  for (const auto& sample : samples) {
+    base::Time::Exploded time;
+    (base::Time::UnixEpoch() +
+     base::TimeDelta::FromMilliseconds(sample.time_ms()))
+        .UTCExplode(&time);
+    std::string lockout = "-";
+    if (sample.has_lockout_counter()) {
+      lockout = base::StringPrintf(
+          "%u%+d", sample.lockout_counter(),
+          static_cast<int>(sample.lockout_counter_change()));
+    }
+    printf("%04d-%02d-%02d %02d:%02d:%02d %7llu %8llu %9llu %7llu %7llu %7llu "
+           "%7llu %8llu %7llu %8s\n",
+           time.year, time.month, time.day_of_month, time.hour, time.minute,
+           time.second,
+           static_cast<unsigned long long>(sample.loaded_objects()),
+           static_cast<unsigned long long>(sample.loaded_sessions()),
+           static_cast<unsigned long long>(sample.evictions()),
+           static_cast<unsigned long long>(sample.retry_warnings()),
+           static_cast<unsigned long long>(sample.yielded_warnings()),
+           static_cast<unsigned long long>(sample.testing_warnings()),
+           static_cast<unsigned long long>(sample.queued_commands()),
+           static_cast<unsigned long long>(sample.rejected_commands()),
+           static_cast<unsigned long long>(sample.overdue_commands()),
+           lockout.c_str());
+    for (const auto& command : sample.commands()) {
+      printf("  0x%08x %8llu commands, %10llu us on the TPM\n",
+             command.command_code(),
+             static_cast<unsigned long long>(command.count()),
+             static_cast<unsigned long long>(command.tpm_us()));
+    }
+  }
+  return 0;
+}
+#endif
+
+// Prints a row of the --profile table for |operation|.
+void PrintProfile(const char* operation,
+                  const trunks::CommandProfile& profile,
+                  trunks::TPM_RC result) {
+  std::string codes;
+  for (const auto& entry : profile.command_codes) {
+    codes += base::StringPrintf(" %x", entry.first);
+    if (entry.second > 1) {
+      codes += base::StringPrintf(
+          "x%llu", static_cast<unsigned long long>(entry.second));
+    }
+  }
+  printf("%-18s %4llu %9llu %9llu %9lld %s%s\n", operation,
+         static_cast<unsigned long long>(profile.commands),
+         static_cast<unsigned long long>(profile.command_bytes),
+         static_cast<unsigned long long>(profile.response_bytes),
+         static_cast<long long>(profile.tpm_time.InMicroseconds()),
+         result ? "FAILED " : "", codes.c_str());
+}
+
+// Runs common TpmUtility operations and prints the TPM commands, bytes and
+// time each one costs.
+int ProfileOperations(const TrunksFactory& factory) {
+  using trunks::ScopedCommandProfile;
+  using trunks::TPM_RC;
+  // The debug PCR, which no policy depends on.
+  const int kPcrIndex = 16;
+  std::unique_ptr<trunks::TpmUtility> utility = factory.GetTpmUtility();
+  std::unique_ptr<trunks::HmacSession> session = factory.GetHmacSession();
+  printf("%-18s %4s %9s %9s %9s %s\n", "operation", "cmds", "cmd_bytes",
+         "rsp_bytes", "tpm_us", "command codes");
+  TPM_RC result;
+  {
+    ScopedCommandProfile profile;
+    result = utility->StartSession(session.get());
+    PrintProfile("StartSession", profile.profile(), result);
+  }
+  if (result) {
+    return result;
+  }
+  {
+    ScopedCommandProfile profile;
+    std::string random;
+    result = utility->GenerateRandom(32, nullptr, &random);
+    PrintProfile("GenerateRandom", profile.profile(), result);
+  }
+  {
+    ScopedCommandProfile profile;
+    std::string value;
+    result = utility->ReadPCR(kPcrIndex, &value);
+    PrintProfile("ReadPCR", profile.profile(), result);
+  }
+  {
+    ScopedCommandProfile profile;
+    result = utility->ExtendPCR(kPcrIndex, "profile", session->GetDelegate());
+    PrintProfile("ExtendPCR", profile.profile(), result);
+  }
+  std::string key_blob;
+  {
+    ScopedCommandProfile profile;
+    result = utility->CreateRSAKeyPair(
+        trunks::TpmUtility::AsymmetricKeyUsage::kSignKey, 2048, 0x10001,
+        "profile", "", false, trunks::kNoCreationPCR, session->GetDelegate(),
+        &key_blob, nullptr);
+    PrintProfile("CreateRSAKeyPair", profile.profile(), result);
+  }
+  if (result == trunks::TPM_RC_SUCCESS) {
+    trunks::TPM_HANDLE key_handle = 0;
+    {
+      ScopedCommandProfile profile;
+      result = utility->LoadKey(key_blob, session->GetDelegate(), &key_handle);
+      PrintProfile("LoadKey", profile.profile(), result);
+    }
+    if (result == trunks::TPM_RC_SUCCESS) {
+      trunks::ScopedKeyHandle scoped_key(factory, key_handle);
+      session->SetEntityAuthorizationValue("profile");
+      ScopedCommandProfile profile;
+      std::string signature;
+      result = utility->Sign(key_handle, trunks::TPM_ALG_NULL,
+                             trunks::TPM_ALG_NULL, std::string(32, 'a'),
+                             session->GetDelegate(), &signature);
+      PrintProfile("Sign", profile.profile(), result);
+    }
+  }
+  session->SetEntityAuthorizationValue("");
+  std::string policy_digest;
+  std::string sealed_data;
+  {
+    ScopedCommandProfile profile;
+    result = utility->GetPolicyDigestForPcrValue(kPcrIndex, "", &policy_digest);
+    if (result == trunks::TPM_RC_SUCCESS) {
+      result = utility->SealData("profile", policy_digest,
+                                 session->GetDelegate(), &sealed_data);
+    }
+    PrintProfile("SealData", profile.profile(), result);
+  }
+  if (result == trunks::TPM_RC_SUCCESS) {
+    ScopedCommandProfile profile;
+    std::unique_ptr<trunks::PolicySession> policy_session =
+        factory.GetPolicySession();
+    std::string unsealed_data;
+    result = policy_session->StartUnboundSession(false);
+    if (result == trunks::TPM_RC_SUCCESS) {
+      result = policy_session->PolicyPCR(kPcrIndex, "");
+    }
+    if (result == trunks::TPM_RC_SUCCESS) {
+      result = utility->UnsealData(sealed_data, policy_session->GetDelegate(),
+                                   &unsealed_data);
+    }
+    PrintProfile("UnsealData", profile.profile(), result);
+  }
+  return 0;
+}
+
 int ReadPCR(const TrunksFactory& factory, int index) {
   std::unique_ptr<trunks::TpmUtility> tpm_utility = factory.GetTpmUtility();
   std::string value;
@@ -158,21 +479,142 @@ int ExtendPCR(const TrunksFactory& factory,
   return 0;
 }
 
-}  // namespace
-
-int main(int argc, char** argv) {
-  base::CommandLine::Init(argc, argv);
-  brillo::InitLog(brillo::kLogToStderr);
-  base::CommandLine* cl = base::CommandLine::ForCurrentProcess();
-  if (cl->HasSwitch("help")) {
-    puts("Trunks Client: A command line tool to access the TPM.");
-    PrintUsage();
-    return 0;
+// Holds an exclusive lock on |kPcrLockFile| while in scope. The lock is taken
+// through a new open file description so it also excludes other threads of
+// this process.
+class ScopedPcrLock {
+ public:
+  ScopedPcrLock()
+      : fd_(HANDLE_EINTR(open(kPcrLockFile, O_RDWR | O_CREAT | O_CLOEXEC,
+                              0600))) {
+    if (!fd_.is_valid() || HANDLE_EINTR(flock(fd_.get(), LOCK_EX)) != 0) {
+      PLOG(WARNING) << "Failed to lock " << kPcrLockFile;
+    }
   }
 
+ private:
+  base::ScopedFD fd_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedPcrLock);
+};
+
+// The outcome of the scenarios run by one concurrent test client.
+struct ClientResult {
+  int passed = 0;
+  int failed = 0;
+};
+
+// Runs the concurrent test scenarios |iterations| times over a new trunksd
+// connection. NvramTest runs only if |owner_password| is not empty, using
+// |nv_index|.
+void RunConcurrentClient(int client_id,
+                         int iterations,
+                         const std::string& owner_password,
+                         uint32_t nv_index,
+                         ClientResult* result) {
   TrunksFactoryImpl factory;
-  CHECK(factory.Initialize()) << "Failed to initialize trunks factory.";
+  if (!factory.Initialize()) {
+    LOG(ERROR) << "Client " << client_id << ": failed to initialize factory.";
+    ++result->failed;
+    return;
+  }
+  trunks::TrunksClientTest test(factory);
+  auto record = [client_id, result](const char* name, bool passed) {
+    if (passed) {
+      ++result->passed;
+    } else {
+      LOG(ERROR) << "Client " << client_id << ": " << name << " failed.";
+      ++result->failed;
+    }
+  };
+  for (int i = 0; i < iterations; ++i) {
+    record("SignTest", test.SignTest());
+    record("DecryptTest", test.DecryptTest());
+    {
+      // SealedDataTest extends the PCR its data is sealed to, which would
+      // make the unseal of a concurrent run fail.
+      ScopedPcrLock lock;
+      record("SealedDataTest", test.SealedDataTest());
+    }
+    record("ManyKeysTest", test.ManyKeysTest());
+    if (!owner_password.empty()) {
+      record("NvramTest", test.NvramTest(owner_password, nv_index));
+    }
+  }
+}
+
+// Runs |threads| concurrent test clients in this process, the |process|th of
+// the test. Returns true if every scenario passed.
+bool RunConcurrentProcess(int process,
+                          int threads,
+                          int iterations,
+                          const std::string& owner_password) {
+  std::vector<std::unique_ptr<base::Thread>> client_threads;
+  std::vector<ClientResult> results(threads);
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < threads; ++i) {
+    int client_id = process * threads + i;
+    client_threads.emplace_back(
+        new base::Thread(base::StringPrintf("client_%d", client_id)));
+    CHECK(client_threads.back()->Start()) << "Failed to start thread.";
+    client_threads.back()->task_runner()->PostTask(
+        FROM_HERE,
+        base::Bind(&RunConcurrentClient, client_id, iterations,
+                   owner_password, kRegressionTestNvIndex + 1 + client_id,
+                   &results[i]));
+  }
+  ClientResult total;
+  for (int i = 0; i < threads; ++i) {
+    client_threads[i]->Stop();
+    total.passed += results[i].passed;
+    total.failed += results[i].failed;
+  }
+  double seconds = (base::TimeTicks::Now() - start).InSecondsF();
+  printf("process %d: %d passed, %d failed in %.1f s (%.2f scenarios/s)\n",
+         process, total.passed, total.failed, seconds,
+         seconds > 0 ? (total.passed + total.failed) / seconds : 0.0);
+  return total.failed == 0;
+}
 
+// Forks |processes| processes running |threads| concurrent test clients each.
+// This must run before this process connects to trunksd. Returns zero if every
+// scenario passed.
+int RunConcurrentTest(int processes,
+                      int threads,
+                      int iterations,
+                      const std::string& owner_password) {
+  std::vector<pid_t> children;
+  for (int i = 0; i < processes; ++i) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      PLOG(ERROR) << "fork";
+      break;
+    }
+    if (pid == 0) {
+      _exit(RunConcurrentProcess(i, threads, iterations, owner_password)
+                ? 0
+                : 1);
+    }
+    children.push_back(pid);
+  }
+  bool passed = children.size() == static_cast<size_t>(processes);
+  for (pid_t pid : children) {
+    int status = 0;
+    if (HANDLE_EINTR(waitpid(pid, &status, 0)) != pid || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      passed = false;
+    }
+  }
+  if (!passed) {
+    LOG(ERROR) << "Concurrent test failed.";
+    return -1;
+  }
+  LOG(INFO) << "Concurrent test passed.";
+  return 0;
+}
+
+// Runs the operation selected by the options in |cl|. Returns zero on success.
+int RunOperation(const base::CommandLine* cl, const TrunksFactory& factory) {
   if (cl->HasSwitch("status")) {
     return DumpStatus(factory);
   }
@@ -246,7 +688,7 @@ int main(int argc, char** argv) {
     if (cl->HasSwitch("owner_password")) {
       std::string owner_password = cl->GetSwitchValueASCII("owner_password");
       LOG(INFO) << "Running NVRAM test.";
-      if (!test.NvramTest(owner_password)) {
+      if (!test.NvramTest(owner_password, kRegressionTestNvIndex)) {
         LOG(ERROR) << "Error running NvramTest.";
         return -1;
       }
@@ -254,6 +696,9 @@ int main(int argc, char** argv) {
     LOG(INFO) << "All tests were run successfully.";
     return 0;
   }
+  if (cl->HasSwitch("profile")) {
+    return ProfileOperations(factory);
+  }
   if (cl->HasSwitch("stress_test")) {
     LOG(INFO) << "Running stress tests.";
     trunks::TrunksClientTest test(factory);
@@ -279,3 +724,68 @@ int main(int argc, char** argv) {
   PrintUsage();
   return -1;
 }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  base::CommandLine::Init(argc, argv);
+  brillo::InitLog(brillo::kLogToStderr);
+  base::CommandLine* cl = base::CommandLine::ForCurrentProcess();
+  if (cl->HasSwitch("help")) {
+    puts("Trunks Client: A command line tool to access the TPM.");
+    PrintUsage();
+    return 0;
+  }
+
+#if !defined(USE_BINDER_IPC)
+  if (cl->HasSwitch("stats")) {
+    return DumpStats();
+  }
+  if (cl->HasSwitch("telemetry")) {
+    return DumpTelemetry();
+  }
+#endif
+  if (cl->HasSwitch("concurrent_test")) {
+    int processes = 2;
+    int threads = 4;
+    int iterations = 5;
+    if ((cl->HasSwitch("processes") &&
+         !base::StringToInt(cl->GetSwitchValueASCII("processes"),
+                            &processes)) ||
+        (cl->HasSwitch("threads") &&
+         !base::StringToInt(cl->GetSwitchValueASCII("threads"), &threads)) ||
+        (cl->HasSwitch("iterations") &&
+         !base::StringToInt(cl->GetSwitchValueASCII("iterations"),
+                            &iterations)) ||
+        processes < 1 || threads < 1 || iterations < 1) {
+      puts("Invalid options!");
+      PrintUsage();
+      return -1;
+    }
+    return RunConcurrentTest(processes, threads, iterations,
+                             cl->GetSwitchValueASCII("owner_password"));
+  }
+
+  // Batch operations share one factory, and so one trunksd connection.
+  std::vector<base::CommandLine> operations;
+  if (cl->HasSwitch("batch") &&
+      !ReadBatch(cl->GetSwitchValueASCII("batch"), cl->GetProgram(),
+                 &operations)) {
+    return -1;
+  }
+
+  TrunksFactoryImpl factory;
+  CHECK(factory.Initialize()) << "Failed to initialize trunks factory.";
+
+  if (cl->HasSwitch("batch")) {
+    for (size_t i = 0; i < operations.size(); ++i) {
+      int result = RunOperation(&operations[i], factory);
+      if (result != 0) {
+        LOG(ERROR) << "Batch operation " << i + 1 << " failed: " << result;
+        return result;
+      }
+    }
+    return 0;
+  }
+  return RunOperation(cl, factory);
+}
@@ -814,7 +814,8 @@ bool TrunksClientTest::PolicyOrTest() {
   return true;
 }
 
-bool TrunksClientTest::NvramTest(const std::string& owner_password) {
+bool TrunksClientTest::NvramTest(const std::string& owner_password,
+                                 uint32_t index) {
   std::unique_ptr<TpmUtility> utility = factory_.GetTpmUtility();
   std::unique_ptr<HmacSession> session = factory_.GetHmacSession();
   TPM_RC result = session->StartUnboundSession(true /* enable encryption */);
@@ -822,7 +823,6 @@ bool TrunksClientTest::NvramTest(const std::string& owner_password) {
     LOG(ERROR) << "Error starting hmac session: " << GetErrorString(result);
     return false;
   }
-  uint32_t index = 1;
   session->SetEntityAuthorizationValue(owner_password);
   std::string nv_data("nv_data");
   TPMA_NV attributes = TPMA_NV_OWNERWRITE | TPMA_NV_AUTHREAD |
@@ -90,9 +90,10 @@ class TrunksClientTest {
   bool PolicyOrTest();
 
   // This test verfies that we can create, write, read, lock and delete
-  // NV spaces in the TPM.
+  // NV spaces in the TPM. It uses the NV space at |index|, which must not be
+  // defined yet, so concurrent runs of this test need distinct indexes.
   // NOTE: This test needs the |owner_password| to work.
-  bool NvramTest(const std::string& owner_password);
+  bool NvramTest(const std::string& owner_password, uint32_t index);
 
   // This test uses many key handles simultaneously.
   bool ManyKeysTest();
@@ -17,20 +17,35 @@
 #include "trunks/trunks_dbus_proxy.h"
 
 #include <base/bind.h>
+#include <base/run_loop.h>
+#include <base/threading/thread_task_runner_handle.h>
 #include <brillo/bind_lambda.h>
 #include <brillo/dbus/dbus_method_invoker.h>
+#include <brillo/dbus/dbus_signal_handler.h>
+#include <dbus/file_descriptor.h>
 
+#include "trunks/allocation_profile.h"
+#include "trunks/boot_trace.h"
 #include "trunks/dbus_interface.h"
 #include "trunks/error_codes.h"
 #include "trunks/interface.pb.h"
 
 namespace {
 
-// Use a five minute timeout because some commands on some TPM hardware can take
-// a very long time. If a few lengthy operations are already in the queue, a
-// subsequent command needs to wait for all of them. Timeouts are always
-// possible but under normal conditions 5 minutes seems to be plenty.
-const int kDBusMaxTimeout = 5 * 60 * 1000;
+// The size of a TPM command header, which holds the command code.
+const size_t kHeaderSize = 10;
+
+// Stores one of several pipelined responses and runs |quit_closure| once
+// |pending| reaches zero.
+void StorePipelinedResponse(std::string* destination,
+                            size_t* pending,
+                            const base::Closure& quit_closure,
+                            const std::string& response) {
+  *destination = response;
+  if (--*pending == 0) {
+    quit_closure.Run();
+  }
+}
 
 }  // namespace
 
@@ -59,19 +74,42 @@ void TrunksDBusProxy::SendCommand(const std::string& command,
   if (origin_thread_id_ != base::PlatformThread::CurrentId()) {
     LOG(ERROR) << "Error TrunksDBusProxy cannot be shared by multiple threads.";
     callback.Run(CreateErrorResponse(TRUNKS_RC_IPC_ERROR));
+    return;
   }
+  ScopedAllocationTag allocation_tag(kAllocationLayerTransport, command);
   SendCommandRequest tpm_command_proto;
   tpm_command_proto.set_command(command);
-  auto on_success = [callback](const SendCommandResponse& response) {
+  tpm_command_proto.set_device_id(device_id_);
+  tpm_command_proto.set_priority(static_cast<CommandPriority>(priority_));
+  if (!deadline_.is_zero()) {
+    tpm_command_proto.set_deadline_ms(deadline_.InMilliseconds());
+  }
+  uint64_t trace_id = GetBootTraceCorrelationId();
+  if (trace_id) {
+    tpm_command_proto.set_trace_id(trace_id);
+  }
+  base::WeakPtr<TrunksDBusProxy> weak_this = GetWeakPtr();
+  // Only the header is needed to name the command in the boot trace.
+  std::string header = command.substr(0, kHeaderSize);
+  base::TimeTicks start = base::TimeTicks::Now();
+  auto on_success = [callback, weak_this, header, start,
+                     trace_id](const SendCommandResponse& response) {
+    RecordBootTraceCommand("command", header, start, trace_id);
+    if (weak_this) {
+      weak_this->RecordStateEpochs(response);
+    }
     callback.Run(response.response());
   };
-  auto on_error = [callback](brillo::Error* error) {
+  int timeout_ms = timeout_policy_.GetCommandTimeout(command).InMilliseconds();
+  auto on_error = [callback, timeout_ms](brillo::Error* error) {
+    LOG(ERROR) << "TrunksProxy failed to send command with a " << timeout_ms
+               << " ms timeout: " << error->GetMessage();
     SendCommandResponse response;
     response.set_response(CreateErrorResponse(SAPI_RC_NO_RESPONSE_RECEIVED));
     callback.Run(response.response());
   };
   brillo::dbus_utils::CallMethodWithTimeout(
-      kDBusMaxTimeout, object_proxy_, trunks::kTrunksInterface,
+      timeout_ms, object_proxy_, trunks::kTrunksInterface,
       trunks::kSendCommand, base::Bind(on_success), base::Bind(on_error),
       tpm_command_proto);
 }
@@ -81,17 +119,31 @@ std::string TrunksDBusProxy::SendCommandAndWait(const std::string& command) {
     LOG(ERROR) << "Error TrunksDBusProxy cannot be shared by multiple threads.";
     return CreateErrorResponse(TRUNKS_RC_IPC_ERROR);
   }
+  ScopedAllocationTag allocation_tag(kAllocationLayerTransport, command);
   SendCommandRequest tpm_command_proto;
   tpm_command_proto.set_command(command);
+  tpm_command_proto.set_device_id(device_id_);
+  tpm_command_proto.set_priority(static_cast<CommandPriority>(priority_));
+  if (!deadline_.is_zero()) {
+    tpm_command_proto.set_deadline_ms(deadline_.InMilliseconds());
+  }
+  uint64_t trace_id = GetBootTraceCorrelationId();
+  if (trace_id) {
+    tpm_command_proto.set_trace_id(trace_id);
+  }
   brillo::ErrorPtr error;
+  base::TimeTicks start = base::TimeTicks::Now();
   std::unique_ptr<dbus::Response> dbus_response =
       brillo::dbus_utils::CallMethodAndBlockWithTimeout(
-          kDBusMaxTimeout, object_proxy_, trunks::kTrunksInterface,
-          trunks::kSendCommand, &error, tpm_command_proto);
+          timeout_policy_.GetCommandTimeout(command).InMilliseconds(),
+          object_proxy_, trunks::kTrunksInterface, trunks::kSendCommand,
+          &error, tpm_command_proto);
+  RecordBootTraceCommand("command", command, start, trace_id);
   SendCommandResponse tpm_response_proto;
   if (dbus_response.get() &&
       brillo::dbus_utils::ExtractMethodCallResults(dbus_response.get(), &error,
                                                    &tpm_response_proto)) {
+    RecordStateEpochs(tpm_response_proto);
     return tpm_response_proto.response();
   } else {
     LOG(ERROR) << "TrunksProxy could not parse response: "
@@ -100,4 +152,204 @@ std::string TrunksDBusProxy::SendCommandAndWait(const std::string& command) {
   }
 }
 
+std::vector<std::string> TrunksDBusProxy::SendCommandBatchAndWait(
+    const std::vector<std::string>& commands,
+    bool stop_on_failure) {
+  if (origin_thread_id_ != base::PlatformThread::CurrentId()) {
+    LOG(ERROR) << "Error TrunksDBusProxy cannot be shared by multiple threads.";
+    return {CreateErrorResponse(TRUNKS_RC_IPC_ERROR)};
+  }
+  SendCommandBatchRequest tpm_batch_proto;
+  for (const auto& command : commands) {
+    tpm_batch_proto.add_commands(command);
+  }
+  tpm_batch_proto.set_stop_on_failure(stop_on_failure);
+  tpm_batch_proto.set_device_id(device_id_);
+  brillo::ErrorPtr error;
+  std::unique_ptr<dbus::Response> dbus_response =
+      brillo::dbus_utils::CallMethodAndBlockWithTimeout(
+          timeout_policy_.GetBatchTimeout(commands).InMilliseconds(),
+          object_proxy_, trunks::kTrunksInterface, trunks::kSendCommandBatch,
+          &error, tpm_batch_proto);
+  SendCommandBatchResponse tpm_response_proto;
+  if (!dbus_response.get() ||
+      !brillo::dbus_utils::ExtractMethodCallResults(dbus_response.get(), &error,
+                                                    &tpm_response_proto)) {
+    LOG(ERROR) << "TrunksProxy could not parse batch response: "
+               << error->GetMessage();
+    return {CreateErrorResponse(SAPI_RC_MALFORMED_RESPONSE)};
+  }
+  return std::vector<std::string>(tpm_response_proto.responses().begin(),
+                                  tpm_response_proto.responses().end());
+}
+
+std::vector<std::string> TrunksDBusProxy::SendCommandsAndWait(
+    const std::vector<std::string>& commands) {
+  if (!base::ThreadTaskRunnerHandle::IsSet()) {
+    return CommandTransceiver::SendCommandsAndWait(commands);
+  }
+  // Every call has its own D-Bus serial, so each response finds its command
+  // in whatever order trunksd answers.
+  std::vector<std::string> responses(commands.size());
+  size_t pending = commands.size();
+  base::RunLoop run_loop;
+  for (size_t i = 0; i < commands.size(); ++i) {
+    SendCommand(commands[i],
+                base::Bind(&StorePipelinedResponse, &responses[i], &pending,
+                           run_loop.QuitClosure()));
+  }
+  if (pending > 0) {
+    run_loop.Run();
+  }
+  return responses;
+}
+
+bool TrunksDBusProxy::OpenSharedMemoryChannel(int memory_fd, int doorbell_fd) {
+  if (origin_thread_id_ != base::PlatformThread::CurrentId()) {
+    LOG(ERROR) << "Error TrunksDBusProxy cannot be shared by multiple threads.";
+    return false;
+  }
+  dbus::FileDescriptor memory_fd_arg(memory_fd);
+  memory_fd_arg.CheckValidity();
+  dbus::FileDescriptor doorbell_fd_arg(doorbell_fd);
+  doorbell_fd_arg.CheckValidity();
+  brillo::ErrorPtr error;
+  std::unique_ptr<dbus::Response> dbus_response =
+      brillo::dbus_utils::CallMethodAndBlock(
+          object_proxy_, trunks::kTrunksInterface,
+          trunks::kOpenSharedMemoryChannel, &error, memory_fd_arg,
+          doorbell_fd_arg);
+  // The dbus::FileDescriptor arguments must not close the caller's fds.
+  memory_fd_arg.TakeValue();
+  doorbell_fd_arg.TakeValue();
+  if (!dbus_response.get() ||
+      !brillo::dbus_utils::ExtractMethodCallResults(dbus_response.get(),
+                                                    &error)) {
+    LOG(ERROR) << "TrunksProxy failed to open shared memory channel: "
+               << (error ? error->GetMessage() : "no response");
+    return false;
+  }
+  return true;
+}
+
+bool TrunksDBusProxy::GetResourceManagerStats(
+    ResourceManagerStats* stats,
+    QueueStats* queue_stats,
+    std::vector<AllocationStats>* allocations) {
+  if (origin_thread_id_ != base::PlatformThread::CurrentId()) {
+    LOG(ERROR) << "Error TrunksDBusProxy cannot be shared by multiple threads.";
+    return false;
+  }
+  GetResourceManagerStatsRequest request;
+  brillo::ErrorPtr error;
+  std::unique_ptr<dbus::Response> dbus_response =
+      brillo::dbus_utils::CallMethodAndBlock(
+          object_proxy_, trunks::kTrunksInterface,
+          trunks::kGetResourceManagerStats, &error, request);
+  GetResourceManagerStatsResponse reply;
+  if (!dbus_response.get() ||
+      !brillo::dbus_utils::ExtractMethodCallResults(dbus_response.get(),
+                                                    &error, &reply)) {
+    LOG(ERROR) << "TrunksProxy failed to get resource manager stats: "
+               << (error ? error->GetMessage() : "no response");
+    return false;
+  }
+  *stats = reply.stats();
+  if (queue_stats) {
+    *queue_stats = reply.queue_stats();
+  }
+  if (allocations) {
+    allocations->assign(reply.allocations().begin(),
+                        reply.allocations().end());
+  }
+  return true;
+}
+
+bool TrunksDBusProxy::LearnCommandTimeouts() {
+  ResourceManagerStats stats;
+  if (!GetResourceManagerStats(&stats, nullptr, nullptr)) {
+    return false;
+  }
+  timeout_policy_.Learn(stats);
+  return true;
+}
+
+bool TrunksDBusProxy::GetCapabilitySnapshot(CapabilitySnapshot* snapshot) {
+  if (origin_thread_id_ != base::PlatformThread::CurrentId()) {
+    LOG(ERROR) << "Error TrunksDBusProxy cannot be shared by multiple threads.";
+    return false;
+  }
+  GetCapabilitySnapshotRequest request;
+  brillo::ErrorPtr error;
+  std::unique_ptr<dbus::Response> dbus_response =
+      brillo::dbus_utils::CallMethodAndBlock(
+          object_proxy_, trunks::kTrunksInterface,
+          trunks::kGetCapabilitySnapshot, &error, request);
+  GetCapabilitySnapshotResponse reply;
+  if (!dbus_response.get() ||
+      !brillo::dbus_utils::ExtractMethodCallResults(dbus_response.get(),
+                                                    &error, &reply)) {
+    VLOG(1) << "TrunksProxy failed to get capability snapshot: "
+            << (error ? error->GetMessage() : "no response");
+    return false;
+  }
+  *snapshot = reply.snapshot();
+  return true;
+}
+
+bool TrunksDBusProxy::GetTelemetry(uint32_t max_samples,
+                                   std::vector<TelemetrySample>* samples) {
+  if (origin_thread_id_ != base::PlatformThread::CurrentId()) {
+    LOG(ERROR) << "Error TrunksDBusProxy cannot be shared by multiple threads.";
+    return false;
+  }
+  GetTelemetryRequest request;
+  request.set_max_samples(max_samples);
+  brillo::ErrorPtr error;
+  std::unique_ptr<dbus::Response> dbus_response =
+      brillo::dbus_utils::CallMethodAndBlock(object_proxy_,
+                                             trunks::kTrunksInterface,
+                                             trunks::kGetTelemetry, &error,
+                                             request);
+  GetTelemetryResponse reply;
+  if (!dbus_response.get() ||
+      !brillo::dbus_utils::ExtractMethodCallResults(dbus_response.get(),
+                                                    &error, &reply)) {
+    LOG(ERROR) << "TrunksProxy failed to get telemetry: "
+               << (error ? error->GetMessage() : "no response");
+    return false;
+  }
+  samples->assign(reply.samples().begin(), reply.samples().end());
+  return true;
+}
+
+bool TrunksDBusProxy::GetLastStateEpochs(TpmStateEpochs* epochs) const {
+  if (!last_state_epochs_) {
+    return false;
+  }
+  *epochs = *last_state_epochs_;
+  return true;
+}
+
+void TrunksDBusProxy::ListenForStateChanges(
+    const base::Callback<void(const TpmStateEpochs&)>& callback) {
+  auto on_connected = [](const std::string& interface_name,
+                         const std::string& signal_name, bool success) {
+    LOG_IF(ERROR, !success) << "Failed to connect to " << signal_name;
+  };
+  brillo::dbus_utils::ConnectToSignal(object_proxy_, kTrunksInterface,
+                                      kTpmStateChanged, callback,
+                                      base::Bind(on_connected));
+}
+
+void TrunksDBusProxy::RecordStateEpochs(const SendCommandResponse& response) {
+  if (!response.has_epochs()) {
+    return;
+  }
+  if (!last_state_epochs_) {
+    last_state_epochs_.reset(new TpmStateEpochs);
+  }
+  *last_state_epochs_ = response.epochs();
+}
+
 }  // namespace trunks
@@ -17,18 +17,31 @@
 #ifndef TRUNKS_TRUNKS_DBUS_PROXY_H_
 #define TRUNKS_TRUNKS_DBUS_PROXY_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 
+#include <base/callback.h>
 #include <base/memory/weak_ptr.h>
 #include <base/threading/platform_thread.h>
+#include <base/time/time.h>
 #include <dbus/bus.h>
 #include <dbus/object_proxy.h>
 
+#include "trunks/command_timeout_policy.h"
 #include "trunks/command_transceiver.h"
 #include "trunks/trunks_export.h"
 
 namespace trunks {
 
+class AllocationStats;
+class CapabilitySnapshot;
+class QueueStats;
+class ResourceManagerStats;
+class SendCommandResponse;
+class TelemetrySample;
+class TpmStateEpochs;
+
 // TrunksDBusProxy is a CommandTransceiver implementation that forwards all
 // commands to the trunksd D-Bus daemon. See TrunksDBusService for details on
 // how the commands are handled once they reach trunksd. A TrunksDBusProxy
@@ -41,12 +54,79 @@ class TRUNKS_EXPORT TrunksDBusProxy : public CommandTransceiver {
   // Initializes the D-Bus client. Returns true on success.
   bool Init() override;
 
+  // Sends commands to the TPM with the given |device_id| instead of the
+  // primary TPM. See SendCommandRequest for how devices are numbered.
+  void set_device_id(uint32_t device_id) { device_id_ = device_id; }
+
+  // Asks trunksd to schedule single commands with the given |priority|.
+  void set_priority(RequestedPriority priority) { priority_ = priority; }
+
+  // Asks trunksd to fail single commands with TRUNKS_RC_DEADLINE_EXCEEDED
+  // instead of sending them if they are still queued after |deadline|. A zero
+  // |deadline|, the default, means commands wait as long as it takes.
+  void set_deadline(base::TimeDelta deadline) { deadline_ = deadline; }
+
   // CommandTransceiver methods.
   void SendCommand(const std::string& command,
                    const ResponseCallback& callback) override;
   std::string SendCommandAndWait(const std::string& command) override;
+  std::vector<std::string> SendCommandBatchAndWait(
+      const std::vector<std::string>& commands,
+      bool stop_on_failure) override;
+  // Keeps every command in flight at once when this thread has a message loop
+  // to receive the responses with; it runs until every response arrived.
+  std::vector<std::string> SendCommandsAndWait(
+      const std::vector<std::string>& commands) override;
+
+  // Asks trunksd to serve commands over a shared memory channel. The
+  // |memory_fd| must come from CreateSharedChannelMemory and |doorbell_fd| is
+  // trunksd's end of a connected socket pair. Ownership is not taken; trunksd
+  // receives duplicates. Returns true on success.
+  bool OpenSharedMemoryChannel(int memory_fd, int doorbell_fd);
+
+  // Reads the counters collected by the trunksd resource manager into |stats|
+  // and, unless |queue_stats| is nullptr, those of its command queues into
+  // |queue_stats|. Unless |allocations| is nullptr, it receives the heap
+  // allocations trunksd attributed to each command, which is empty unless
+  // trunksd runs with allocation tracking. Returns false on failure, including
+  // when trunksd runs without its own resource manager.
+  bool GetResourceManagerStats(ResourceManagerStats* stats,
+                               QueueStats* queue_stats,
+                               std::vector<AllocationStats>* allocations);
+
+  // Reads the fixed TPM capabilities trunksd queried at startup into
+  // |snapshot|. Returns false on failure, including when trunksd has not
+  // finished querying them.
+  bool GetCapabilitySnapshot(CapabilitySnapshot* snapshot);
+
+  // Reads the last |max_samples| telemetry samples trunksd took, oldest first,
+  // or all of them if |max_samples| is zero. Returns false on failure,
+  // including when trunksd runs without telemetry.
+  bool GetTelemetry(uint32_t max_samples,
+                    std::vector<TelemetrySample>* samples);
+
+  // Replaces the per-command timeouts with ones learned from the latencies
+  // trunksd measured, see CommandTimeoutPolicy. Until this is called, or if it
+  // fails, every command has the maximum timeout. Returns false on failure,
+  // including when trunksd runs without its own resource manager.
+  bool LearnCommandTimeouts();
+
+  const CommandTimeoutPolicy& timeout_policy() const { return timeout_policy_; }
+
+  // Copies the TPM state epochs trunksd returned with the latest response to
+  // a single command into |epochs|. Returns false if none came with one, e.g.
+  // when trunksd runs without its own resource manager.
+  bool GetLastStateEpochs(TpmStateEpochs* epochs) const;
+
+  // Runs |callback| with the new epochs whenever trunksd signals that the TPM
+  // state changed, so cached state can be dropped without polling.
+  void ListenForStateChanges(
+      const base::Callback<void(const TpmStateEpochs&)>& callback);
 
  private:
+  // Keeps the epochs which came with |response|, if any.
+  void RecordStateEpochs(const SendCommandResponse& response);
+
   base::WeakPtr<TrunksDBusProxy> GetWeakPtr() {
     return weak_factory_.GetWeakPtr();
   }
@@ -54,6 +134,11 @@ class TRUNKS_EXPORT TrunksDBusProxy : public CommandTransceiver {
   base::PlatformThreadId origin_thread_id_;
   scoped_refptr<dbus::Bus> bus_;
   dbus::ObjectProxy* object_proxy_;
+  uint32_t device_id_ = 0;
+  RequestedPriority priority_ = kRequestedPriorityDefault;
+  base::TimeDelta deadline_;
+  CommandTimeoutPolicy timeout_policy_;
+  std::unique_ptr<TpmStateEpochs> last_state_epochs_;
 
   // Declared last so weak pointers are invalidated first on destruction.
   base::WeakPtrFactory<TrunksDBusProxy> weak_factory_;
@@ -16,20 +16,39 @@
 
 #include "trunks/trunks_dbus_service.h"
 
+#include <fcntl.h>
+
 #include <base/bind.h>
+#include <base/threading/thread_task_runner_handle.h>
+#include <base/time/time.h>
 #include <brillo/bind_lambda.h>
+#include <brillo/errors/error_codes.h>
+#include <dbus/dbus-protocol.h>
 
+#include "trunks/allocation_profile.h"
+#include "trunks/boot_trace.h"
 #include "trunks/dbus_interface.h"
 #include "trunks/error_codes.h"
 #include "trunks/interface.pb.h"
 
+namespace {
+
+// Bounds the resources a misbehaving client can reserve in trunksd.
+const size_t kMaxSharedMemoryChannels = 64;
+
+// The size of a TPM command header, which holds the command code.
+const size_t kHeaderSize = 10;
+
+}  // namespace
+
 namespace trunks {
 
 using brillo::dbus_utils::AsyncEventSequencer;
 using brillo::dbus_utils::DBusMethodResponse;
 
 TrunksDBusService::TrunksDBusService()
-    : brillo::DBusServiceDaemon(trunks::kTrunksServiceName) {}
+    : brillo::DBusServiceDaemon(trunks::kTrunksServiceName),
+      task_runner_(base::ThreadTaskRunnerHandle::Get()) {}
 
 void TrunksDBusService::RegisterDBusObjectsAsync(
     AsyncEventSequencer* sequencer) {
@@ -37,8 +56,24 @@ void TrunksDBusService::RegisterDBusObjectsAsync(
       nullptr, bus_, dbus::ObjectPath(kTrunksServicePath)));
   brillo::dbus_utils::DBusInterface* dbus_interface =
       trunks_dbus_object_->AddOrGetInterface(kTrunksInterface);
-  dbus_interface->AddMethodHandler(kSendCommand, base::Unretained(this),
-                                   &TrunksDBusService::HandleSendCommand);
+  dbus_interface->AddMethodHandlerWithMessage(
+      kSendCommand, base::Unretained(this),
+      &TrunksDBusService::HandleSendCommand);
+  dbus_interface->AddMethodHandler(kSendCommandBatch, base::Unretained(this),
+                                   &TrunksDBusService::HandleSendCommandBatch);
+  dbus_interface->AddMethodHandlerWithMessage(
+      kOpenSharedMemoryChannel, base::Unretained(this),
+      &TrunksDBusService::HandleOpenSharedMemoryChannel);
+  dbus_interface->AddMethodHandler(
+      kGetResourceManagerStats, base::Unretained(this),
+      &TrunksDBusService::HandleGetResourceManagerStats);
+  dbus_interface->AddMethodHandler(
+      kGetCapabilitySnapshot, base::Unretained(this),
+      &TrunksDBusService::HandleGetCapabilitySnapshot);
+  dbus_interface->AddMethodHandler(kGetTelemetry, base::Unretained(this),
+                                   &TrunksDBusService::HandleGetTelemetry);
+  state_changed_signal_ =
+      dbus_interface->RegisterSignal<TpmStateEpochs>(kTpmStateChanged);
   trunks_dbus_object_->RegisterAsync(
       sequencer->GetHandler("Failed to register D-Bus object.", true));
 }
@@ -46,27 +81,261 @@ void TrunksDBusService::RegisterDBusObjectsAsync(
 void TrunksDBusService::HandleSendCommand(
     std::unique_ptr<DBusMethodResponse<const SendCommandResponse&>>
         response_sender,
+    dbus::Message* message,
     const SendCommandRequest& request) {
   // Convert |response_sender| to a shared_ptr so |transceiver_| can safely
   // copy the callback.
   using SharedResponsePointer =
       std::shared_ptr<DBusMethodResponse<const SendCommandResponse&>>;
-  // A callback that constructs the response protobuf and sends it.
-  auto callback = [](const SharedResponsePointer& response,
+  // A callback that constructs the response protobuf and sends it. The
+  // epochs are read after the command was processed so they reflect it.
+  auto callback = [](const ResourceManager* resource_manager,
+                     const SharedResponsePointer& response,
                      const std::string& response_from_tpm) {
     SendCommandResponse tpm_response_proto;
     tpm_response_proto.set_response(response_from_tpm);
+    if (resource_manager) {
+      resource_manager->GetStateEpochs(tpm_response_proto.mutable_epochs());
+    }
     response->Return(tpm_response_proto);
   };
   if (!request.has_command() || request.command().empty()) {
     LOG(ERROR) << "TrunksDBusService: Invalid request.";
-    callback(SharedResponsePointer(std::move(response_sender)),
+    callback(nullptr, SharedResponsePointer(std::move(response_sender)),
+             CreateErrorResponse(SAPI_RC_BAD_PARAMETER));
+    return;
+  }
+  CommandTransceiver* transceiver = GetTransceiver(request.device_id());
+  if (!transceiver) {
+    LOG(ERROR) << "TrunksDBusService: Unknown device: " << request.device_id();
+    callback(nullptr, SharedResponsePointer(std::move(response_sender)),
              CreateErrorResponse(SAPI_RC_BAD_PARAMETER));
     return;
   }
-  transceiver_->SendCommand(
-      request.command(),
+  // The resource manager only tracks the primary TPM.
+  const ResourceManager* resource_manager =
+      request.device_id() == 0 ? resource_manager_ : nullptr;
+  base::TimeTicks deadline;
+  if (request.has_deadline_ms()) {
+    deadline = base::TimeTicks::Now() +
+               base::TimeDelta::FromMilliseconds(request.deadline_ms());
+  }
+  WatchClient(message->GetSender());
+  CommandTransceiver::ResponseCallback reply =
+      base::Bind(callback, resource_manager,
+                 SharedResponsePointer(std::move(response_sender)));
+  if (IsBootTraceEnabled()) {
+    // Records the command from receipt to response, under the client phase
+    // which sent it.
+    auto traced_callback = [](
+        const CommandTransceiver::ResponseCallback& reply,
+        const std::string& header, base::TimeTicks start, uint64_t trace_id,
+        const std::string& response_from_tpm) {
+      RecordBootTraceCommand("command", header, start, trace_id);
+      reply.Run(response_from_tpm);
+    };
+    reply = base::Bind(traced_callback, reply,
+                       request.command().substr(0, kHeaderSize),
+                       base::TimeTicks::Now(), request.trace_id());
+  }
+  // The request was decoded on the D-Bus thread and |transceiver| only
+  // queues the command for the TPM thread, so decoding the next request
+  // overlaps with the TPM executing this one. Handle translation stays on the
+  // TPM thread because it depends on the responses to earlier commands.
+  transceiver->SendScheduledCommandForClient(
+      message->GetSender(), request.command(),
+      static_cast<CommandTransceiver::RequestedPriority>(request.priority()),
+      deadline, reply);
+}
+
+void TrunksDBusService::HandleSendCommandBatch(
+    std::unique_ptr<DBusMethodResponse<const SendCommandBatchResponse&>>
+        response_sender,
+    const SendCommandBatchRequest& request) {
+  using SharedResponsePointer =
+      std::shared_ptr<DBusMethodResponse<const SendCommandBatchResponse&>>;
+  auto callback = [](const SharedResponsePointer& response,
+                     const std::vector<std::string>& responses_from_tpm) {
+    SendCommandBatchResponse tpm_response_proto;
+    for (const auto& response_from_tpm : responses_from_tpm) {
+      tpm_response_proto.add_responses(response_from_tpm);
+    }
+    response->Return(tpm_response_proto);
+  };
+  std::vector<std::string> commands;
+  for (const auto& command : request.commands()) {
+    if (command.empty()) {
+      LOG(ERROR) << "TrunksDBusService: Invalid batch request.";
+      callback(SharedResponsePointer(std::move(response_sender)),
+               {CreateErrorResponse(SAPI_RC_BAD_PARAMETER)});
+      return;
+    }
+    commands.push_back(command);
+  }
+  CommandTransceiver* transceiver = GetTransceiver(request.device_id());
+  if (!transceiver) {
+    LOG(ERROR) << "TrunksDBusService: Unknown device: " << request.device_id();
+    callback(SharedResponsePointer(std::move(response_sender)),
+             {CreateErrorResponse(SAPI_RC_BAD_PARAMETER)});
+    return;
+  }
+  transceiver->SendCommandBatch(
+      commands, request.stop_on_failure(),
       base::Bind(callback, SharedResponsePointer(std::move(response_sender))));
 }
 
+void TrunksDBusService::HandleOpenSharedMemoryChannel(
+    std::unique_ptr<DBusMethodResponse<>> response_sender,
+    dbus::Message* message,
+    const dbus::FileDescriptor& memory_fd,
+    const dbus::FileDescriptor& doorbell_fd) {
+  if (shared_channels_.size() >= kMaxSharedMemoryChannels) {
+    response_sender->ReplyWithError(FROM_HERE, brillo::errors::dbus::kDomain,
+                                    DBUS_ERROR_LIMITS_EXCEEDED,
+                                    "Too many shared memory channels.");
+    return;
+  }
+  // The D-Bus message owns the received descriptors; keep duplicates.
+  int channel_memory_fd = fcntl(memory_fd.value(), F_DUPFD_CLOEXEC, 0);
+  int channel_doorbell_fd = fcntl(doorbell_fd.value(), F_DUPFD_CLOEXEC, 0);
+  int channel_id = next_channel_id_++;
+  std::unique_ptr<SharedMemoryChannelService> channel(
+      new SharedMemoryChannelService(
+          channel_memory_fd, channel_doorbell_fd, message->GetSender(),
+          transceiver_,
+          base::Bind(&TrunksDBusService::CloseSharedMemoryChannel,
+                     GetWeakPtr(), channel_id)));
+  if (channel_memory_fd < 0 || channel_doorbell_fd < 0 || !channel->Init()) {
+    LOG(ERROR) << "TrunksDBusService: Invalid shared memory channel.";
+    response_sender->ReplyWithError(FROM_HERE, brillo::errors::dbus::kDomain,
+                                    DBUS_ERROR_INVALID_ARGS,
+                                    "Invalid shared memory channel.");
+    return;
+  }
+  WatchClient(message->GetSender());
+  shared_channels_[channel_id] = std::move(channel);
+  VLOG(1) << "Opened shared memory channel " << channel_id;
+  response_sender->Return();
+}
+
+void TrunksDBusService::HandleGetResourceManagerStats(
+    std::unique_ptr<DBusMethodResponse<const GetResourceManagerStatsResponse&>>
+        response_sender,
+    const GetResourceManagerStatsRequest& request) {
+  if (!resource_manager_) {
+    response_sender->ReplyWithError(FROM_HERE, brillo::errors::dbus::kDomain,
+                                    DBUS_ERROR_NOT_SUPPORTED,
+                                    "The resource manager is not in use.");
+    return;
+  }
+  GetResourceManagerStatsResponse reply;
+  resource_manager_->GetStats(reply.mutable_stats());
+  if (scheduler_) {
+    scheduler_->GetQueueStats(reply.mutable_queue_stats());
+  }
+  if (IsAllocationTrackingEnabled()) {
+    std::vector<AllocationStats> allocations;
+    GetAllocationStats(&allocations);
+    for (const auto& entry : allocations) {
+      *reply.add_allocations() = entry;
+    }
+  }
+  response_sender->Return(reply);
+}
+
+CommandTransceiver* TrunksDBusService::GetTransceiver(uint32_t device_id) {
+  if (device_id == 0) {
+    return transceiver_;
+  }
+  auto iter = device_transceivers_.find(device_id);
+  if (iter == device_transceivers_.end()) {
+    return nullptr;
+  }
+  return iter->second;
+}
+
+void TrunksDBusService::HandleGetCapabilitySnapshot(
+    std::unique_ptr<DBusMethodResponse<const GetCapabilitySnapshotResponse&>>
+        response_sender,
+    const GetCapabilitySnapshotRequest& request) {
+  GetCapabilitySnapshotResponse reply;
+  if (!property_cache_ ||
+      !property_cache_->ExportSnapshot(reply.mutable_snapshot())) {
+    // Clients fall back to querying the TPM themselves.
+    response_sender->ReplyWithError(FROM_HERE, brillo::errors::dbus::kDomain,
+                                    DBUS_ERROR_NOT_SUPPORTED,
+                                    "No capability snapshot is available.");
+    return;
+  }
+  response_sender->Return(reply);
+}
+
+void TrunksDBusService::HandleGetTelemetry(
+    std::unique_ptr<DBusMethodResponse<const GetTelemetryResponse&>>
+        response_sender,
+    const GetTelemetryRequest& request) {
+  if (!telemetry_) {
+    response_sender->ReplyWithError(FROM_HERE, brillo::errors::dbus::kDomain,
+                                    DBUS_ERROR_NOT_SUPPORTED,
+                                    "Telemetry is not enabled.");
+    return;
+  }
+  std::vector<TelemetrySample> samples;
+  telemetry_->GetSamples(request.max_samples(), &samples);
+  GetTelemetryResponse reply;
+  for (const auto& sample : samples) {
+    *reply.add_samples() = sample;
+  }
+  response_sender->Return(reply);
+}
+
+void TrunksDBusService::NotifyTpmStateChanged(const TpmStateEpochs& epochs) {
+  // Weak pointers may only be made on the D-Bus thread. This object outlives
+  // the message loop the task is posted to.
+  task_runner_->PostTask(FROM_HERE,
+                         base::Bind(&TrunksDBusService::SendTpmStateChanged,
+                                    base::Unretained(this), epochs));
+}
+
+void TrunksDBusService::SendTpmStateChanged(const TpmStateEpochs& epochs) {
+  auto signal = state_changed_signal_.lock();
+  if (signal) {
+    signal->Send(epochs);
+  }
+}
+
+void TrunksDBusService::CloseSharedMemoryChannel(int channel_id) {
+  shared_channels_.erase(channel_id);
+  VLOG(1) << "Closed shared memory channel " << channel_id;
+}
+
+void TrunksDBusService::WatchClient(const std::string& client) {
+  if (client.empty() || client_watchers_.count(client) > 0) {
+    return;
+  }
+  base::Callback<void(const std::string&)> watcher = base::Bind(
+      &TrunksDBusService::OnClientOwnerChanged, GetWeakPtr(), client);
+  client_watchers_[client] = watcher;
+  bus_->ListenForServiceOwnerChange(client, watcher);
+}
+
+void TrunksDBusService::OnClientOwnerChanged(const std::string& client,
+                                             const std::string& new_owner) {
+  // A unique name is never reassigned, so any change means it is gone.
+  if (!new_owner.empty()) {
+    return;
+  }
+  auto iter = client_watchers_.find(client);
+  if (iter == client_watchers_.end()) {
+    return;
+  }
+  bus_->UnlistenForServiceOwnerChange(client, iter->second);
+  client_watchers_.erase(iter);
+  VLOG(1) << "Client disconnected: " << client;
+  transceiver_->OnClientDisconnected(client);
+  for (const auto& device : device_transceivers_) {
+    device.second->OnClientDisconnected(client);
+  }
+}
+
 }  // namespace trunks
@@ -17,16 +17,25 @@
 #ifndef TRUNKS_TRUNKS_DBUS_SERVICE_H_
 #define TRUNKS_TRUNKS_DBUS_SERVICE_H_
 
+#include <map>
 #include <memory>
 #include <string>
 
 #include <base/memory/weak_ptr.h>
+#include <base/single_thread_task_runner.h>
 #include <brillo/daemons/dbus_daemon.h>
 #include <brillo/dbus/dbus_method_response.h>
 #include <brillo/dbus/dbus_object.h>
+#include <dbus/file_descriptor.h>
+#include <dbus/message.h>
 
 #include "trunks/command_transceiver.h"
 #include "trunks/interface.pb.h"
+#include "trunks/resource_manager.h"
+#include "trunks/scheduling_command_transceiver.h"
+#include "trunks/shared_memory_channel.h"
+#include "trunks/tpm_telemetry.h"
+#include "trunks/tpm_state_impl.h"
 
 namespace trunks {
 
@@ -49,23 +58,129 @@ class TrunksDBusService : public brillo::DBusServiceDaemon {
     transceiver_ = transceiver;
   }
 
+  // Makes |transceiver| the target of commands for the additional TPM with
+  // the given |device_id|, which must not be 0. Each device has its own
+  // pipeline so commands to different devices can execute in parallel. This
+  // class does not take ownership of |transceiver|.
+  void set_device_transceiver(uint32_t device_id,
+                              CommandTransceiver* transceiver) {
+    device_transceivers_[device_id] = transceiver;
+  }
+
+  // The |resource_manager| answers 'GetResourceManagerStats' calls. If it is
+  // not set, e.g. because the kernel manages TPM resources, those calls fail.
+  // This class does not take ownership of |resource_manager|.
+  void set_resource_manager(const ResourceManager* resource_manager) {
+    resource_manager_ = resource_manager;
+  }
+
+  // The |scheduler| provides the queue counters of 'GetResourceManagerStats'
+  // replies. This class does not take ownership of |scheduler|.
+  void set_scheduler(SchedulingCommandTransceiver* scheduler) {
+    scheduler_ = scheduler;
+  }
+
+  // The |property_cache| answers 'GetCapabilitySnapshot' calls once it holds
+  // every fixed property. This class does not take ownership of
+  // |property_cache|.
+  void set_property_cache(TpmPropertyCache* property_cache) {
+    property_cache_ = property_cache;
+  }
+
+  // The |telemetry| answers 'GetTelemetry' calls; if it is not set those calls
+  // fail. This class does not take ownership of |telemetry|.
+  void set_telemetry(const TpmTelemetry* telemetry) { telemetry_ = telemetry; }
+
+  // Emits the 'TpmStateChanged' signal with the new |epochs|. May be called on
+  // any thread.
+  void NotifyTpmStateChanged(const TpmStateEpochs& epochs);
+
  protected:
   // Exports D-Bus methods.
   void RegisterDBusObjectsAsync(
       brillo::dbus_utils::AsyncEventSequencer* sequencer) override;
 
  private:
-  // Handles calls to the 'SendCommand' method.
+  // Handles calls to the 'SendCommand' method. The sender of the |message| is
+  // the client the command is sent for.
   void HandleSendCommand(std::unique_ptr<brillo::dbus_utils::DBusMethodResponse<
                              const SendCommandResponse&>> response_sender,
+                         dbus::Message* message,
                          const SendCommandRequest& request);
 
+  // Handles calls to the 'SendCommandBatch' method.
+  void HandleSendCommandBatch(
+      std::unique_ptr<brillo::dbus_utils::DBusMethodResponse<
+          const SendCommandBatchResponse&>> response_sender,
+      const SendCommandBatchRequest& request);
+
+  // Handles calls to the 'OpenSharedMemoryChannel' method.
+  void HandleOpenSharedMemoryChannel(
+      std::unique_ptr<brillo::dbus_utils::DBusMethodResponse<>>
+          response_sender,
+      dbus::Message* message,
+      const dbus::FileDescriptor& memory_fd,
+      const dbus::FileDescriptor& doorbell_fd);
+
+  // Handles calls to the 'GetResourceManagerStats' method.
+  void HandleGetResourceManagerStats(
+      std::unique_ptr<brillo::dbus_utils::DBusMethodResponse<
+          const GetResourceManagerStatsResponse&>> response_sender,
+      const GetResourceManagerStatsRequest& request);
+
+  // Returns the transceiver for |device_id|, or nullptr if there is no such
+  // device.
+  CommandTransceiver* GetTransceiver(uint32_t device_id);
+
+  // Handles calls to the 'GetCapabilitySnapshot' method.
+  void HandleGetCapabilitySnapshot(
+      std::unique_ptr<brillo::dbus_utils::DBusMethodResponse<
+          const GetCapabilitySnapshotResponse&>> response_sender,
+      const GetCapabilitySnapshotRequest& request);
+
+  // Handles calls to the 'GetTelemetry' method.
+  void HandleGetTelemetry(
+      std::unique_ptr<brillo::dbus_utils::DBusMethodResponse<
+          const GetTelemetryResponse&>> response_sender,
+      const GetTelemetryRequest& request);
+
+  // Sends the 'TpmStateChanged' signal on the D-Bus thread.
+  void SendTpmStateChanged(const TpmStateEpochs& epochs);
+
+  // Destroys the shared memory channel with the given |channel_id|.
+  void CloseSharedMemoryChannel(int channel_id);
+
+  // Starts watching the unique bus name of a |client| so the transceiver can
+  // be told when it disconnects.
+  void WatchClient(const std::string& client);
+
+  // Called when the owner of a watched |client| name changes to |new_owner|,
+  // which is empty once the client has disconnected.
+  void OnClientOwnerChanged(const std::string& client,
+                            const std::string& new_owner);
+
   base::WeakPtr<TrunksDBusService> GetWeakPtr() {
     return weak_factory_.GetWeakPtr();
   }
 
   std::unique_ptr<brillo::dbus_utils::DBusObject> trunks_dbus_object_;
+  std::weak_ptr<brillo::dbus_utils::DBusSignal<TpmStateEpochs>>
+      state_changed_signal_;
+  // The D-Bus thread.
+  scoped_refptr<base::SingleThreadTaskRunner> task_runner_;
   CommandTransceiver* transceiver_ = nullptr;
+  // Transceivers of the additional TPM devices, by device id.
+  std::map<uint32_t, CommandTransceiver*> device_transceivers_;
+  const ResourceManager* resource_manager_ = nullptr;
+  TpmPropertyCache* property_cache_ = nullptr;
+  SchedulingCommandTransceiver* scheduler_ = nullptr;
+  const TpmTelemetry* telemetry_ = nullptr;
+  // Open shared memory channels by channel id.
+  std::map<int, std::unique_ptr<SharedMemoryChannelService>> shared_channels_;
+  int next_channel_id_ = 0;
+  // Owner change callbacks of watched clients, by unique bus name.
+  std::map<std::string, base::Callback<void(const std::string&)>>
+      client_watchers_;
 
   // Declared last so weak pointers are invalidated first on destruction.
   base::WeakPtrFactory<TrunksDBusService> weak_factory_{this};
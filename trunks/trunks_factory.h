@@ -34,6 +34,7 @@
 namespace trunks {
 
 class Tpm;
+class TpmStateEpochs;
 
 // TrunksFactory is an interface to act as a factory for trunks objects. This
 // mechanism assists in injecting mocks for testing.
@@ -66,12 +67,21 @@ class TRUNKS_EXPORT TrunksFactory {
   // Returns a PolicySession instance. The caller takes ownership.
   virtual std::unique_ptr<PolicySession> GetPolicySession() const = 0;
 
-  // Returns a TrialSession instance. The caller takes ownership.
+  // Returns a TrialSession instance. The caller takes ownership. A trial
+  // session only computes a policy digest and may be implemented without
+  // sending any command to the TPM.
   virtual std::unique_ptr<PolicySession> GetTrialSession() const = 0;
 
   // Returns a BlobParser instance. The caller takes ownership.
   virtual std::unique_ptr<BlobParser> GetBlobParser() const = 0;
 
+  // Copies the TPM state epochs trunksd returned with the latest response to
+  // a command sent through this factory into |epochs|. A caller can compare
+  // them with the epochs it saw when it cached TPM state. Returns false if
+  // they are not known, e.g. when trunksd runs without its own resource
+  // manager.
+  virtual bool GetLastStateEpochs(TpmStateEpochs* epochs) const = 0;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(TrunksFactory);
 };
@@ -24,6 +24,7 @@
 #include "trunks/authorization_delegate.h"
 #include "trunks/blob_parser.h"
 #include "trunks/hmac_session.h"
+#include "trunks/interface.pb.h"
 #include "trunks/mock_blob_parser.h"
 #include "trunks/mock_hmac_session.h"
 #include "trunks/mock_policy_session.h"
@@ -130,6 +131,10 @@ class TpmUtilityForwarder : public TpmUtility {
     return target_->AllocatePCR(platform_password);
   }
 
+  TPM_RC PrepareForOwnership() override {
+    return target_->PrepareForOwnership();
+  }
+
   TPM_RC TakeOwnership(const std::string& owner_password,
                        const std::string& endorsement_password,
                        const std::string& lockout_password) override {
@@ -158,6 +163,20 @@ class TpmUtilityForwarder : public TpmUtility {
     return target_->ReadPCR(pcr_index, pcr_value);
   }
 
+  TPM_RC ExtendPCRs(int pcr_index,
+                    const std::string& extend_data,
+                    const std::vector<TPM_ALG_ID>& hash_algs,
+                    AuthorizationDelegate* delegate) override {
+    return target_->ExtendPCRs(pcr_index, extend_data, hash_algs, delegate);
+  }
+
+  TPM_RC ReadPCRs(
+      const std::vector<int>& pcr_indexes,
+      const std::vector<TPM_ALG_ID>& hash_algs,
+      std::map<TPM_ALG_ID, std::vector<std::string>>* pcr_values) override {
+    return target_->ReadPCRs(pcr_indexes, hash_algs, pcr_values);
+  }
+
   TPM_RC AsymmetricEncrypt(TPM_HANDLE key_handle,
                            TPM_ALG_ID scheme,
                            TPM_ALG_ID hash_alg,
@@ -188,6 +207,16 @@ class TpmUtilityForwarder : public TpmUtility {
                          signature);
   }
 
+  TPM_RC SignFile(TPM_HANDLE key_handle,
+                  TPM_ALG_ID scheme,
+                  TPM_ALG_ID hash_alg,
+                  int fd,
+                  AuthorizationDelegate* delegate,
+                  std::string* signature) override {
+    return target_->SignFile(key_handle, scheme, hash_alg, fd, delegate,
+                             signature);
+  }
+
   TPM_RC Verify(TPM_HANDLE key_handle,
                 TPM_ALG_ID scheme,
                 TPM_ALG_ID hash_alg,
@@ -198,6 +227,10 @@ class TpmUtilityForwarder : public TpmUtility {
                            delegate);
   }
 
+  void SetUseSoftwarePublicKeyOperations(bool enabled) override {
+    target_->SetUseSoftwarePublicKeyOperations(enabled);
+  }
+
   TPM_RC CertifyCreation(TPM_HANDLE key_handle,
                          const std::string& creation_blob) override {
     return target_->CertifyCreation(key_handle, creation_blob);
@@ -222,6 +255,19 @@ class TpmUtilityForwarder : public TpmUtility {
                                  prime_factor, password, delegate, key_blob);
   }
 
+  TPM_RC ImportECCKey(AsymmetricKeyUsage key_type,
+                      TPMI_ECC_CURVE curve_id,
+                      const std::string& public_point_x,
+                      const std::string& public_point_y,
+                      const std::string& private_value,
+                      const std::string& password,
+                      AuthorizationDelegate* delegate,
+                      std::string* key_blob) override {
+    return target_->ImportECCKey(key_type, curve_id, public_point_x,
+                                 public_point_y, private_value, password,
+                                 delegate, key_blob);
+  }
+
   TPM_RC CreateRSAKeyPair(AsymmetricKeyUsage key_type,
                           int modulus_bits,
                           uint32_t public_exponent,
@@ -238,12 +284,46 @@ class TpmUtilityForwarder : public TpmUtility {
         creation_blob);
   }
 
+  TPM_RC PregenerateRSAKeyPairs(AsymmetricKeyUsage key_type,
+                                int modulus_bits,
+                                uint32_t public_exponent,
+                                const std::string& password,
+                                const std::string& policy_digest,
+                                bool use_only_policy_authorization,
+                                size_t num_keys,
+                                AuthorizationDelegate* delegate) override {
+    return target_->PregenerateRSAKeyPairs(
+        key_type, modulus_bits, public_exponent, password, policy_digest,
+        use_only_policy_authorization, num_keys, delegate);
+  }
+
+  TPM_RC CreateECCKeyPair(AsymmetricKeyUsage key_type,
+                          TPMI_ECC_CURVE curve_id,
+                          const std::string& password,
+                          const std::string& policy_digest,
+                          bool use_only_policy_authorization,
+                          int creation_pcr_index,
+                          AuthorizationDelegate* delegate,
+                          std::string* key_blob,
+                          std::string* creation_blob) override {
+    return target_->CreateECCKeyPair(
+        key_type, curve_id, password, policy_digest,
+        use_only_policy_authorization, creation_pcr_index, delegate, key_blob,
+        creation_blob);
+  }
+
   TPM_RC LoadKey(const std::string& key_blob,
                  AuthorizationDelegate* delegate,
                  TPM_HANDLE* key_handle) override {
     return target_->LoadKey(key_blob, delegate, key_handle);
   }
 
+  TPM_RC LoadKeys(const std::vector<std::string>& key_blobs,
+                  AuthorizationDelegate* delegate,
+                  std::vector<TPM_HANDLE>* key_handles) override {
+    return target_->LoadKeys(key_blobs, delegate, key_handles);
+  }
+
   TPM_RC GetKeyName(TPM_HANDLE handle, std::string* name) override {
     return target_->GetKeyName(handle, name);
   }
@@ -267,6 +347,10 @@ class TpmUtilityForwarder : public TpmUtility {
     return target_->UnsealData(sealed_data, delegate, unsealed_data);
   }
 
+  void EnableUnsealCache(base::TimeDelta ttl) override {
+    target_->EnableUnsealCache(ttl);
+  }
+
   TPM_RC StartSession(HmacSession* session) override {
     return target_->StartSession(session);
   }
@@ -278,6 +362,34 @@ class TpmUtilityForwarder : public TpmUtility {
                                                policy_digest);
   }
 
+  TPM_RC GetPolicyDigestForAuthority(const std::string& authority_modulus,
+                                     const std::string& policy_ref,
+                                     std::string* policy_digest) override {
+    return target_->GetPolicyDigestForAuthority(authority_modulus, policy_ref,
+                                                policy_digest);
+  }
+
+  TPM_RC SignPolicyApproval(TPM_HANDLE authority_key_handle,
+                            const std::string& approved_policy,
+                            const std::string& policy_ref,
+                            AuthorizationDelegate* delegate,
+                            std::string* approval_signature) override {
+    return target_->SignPolicyApproval(authority_key_handle, approved_policy,
+                                       policy_ref, delegate,
+                                       approval_signature);
+  }
+
+  TPM_RC UnsealDataWithApprovedPolicy(const std::string& sealed_data,
+                                      int pcr_index,
+                                      const std::string& authority_modulus,
+                                      const std::string& policy_ref,
+                                      const std::string& approval_signature,
+                                      std::string* unsealed_data) override {
+    return target_->UnsealDataWithApprovedPolicy(
+        sealed_data, pcr_index, authority_modulus, policy_ref,
+        approval_signature, unsealed_data);
+  }
+
   TPM_RC DefineNVSpace(uint32_t index,
                        size_t num_bytes,
                        TPMA_NV attributes,
@@ -323,6 +435,26 @@ class TpmUtilityForwarder : public TpmUtility {
                                 delegate);
   }
 
+  TPM_RC WriteNVSpaceInChunks(uint32_t index,
+                              uint32_t offset,
+                              const std::string& nvram_data,
+                              bool using_owner_authorization,
+                              AuthorizationDelegate* delegate) override {
+    return target_->WriteNVSpaceInChunks(index, offset, nvram_data,
+                                         using_owner_authorization, delegate);
+  }
+
+  TPM_RC ReadNVSpaceInChunks(uint32_t index,
+                             uint32_t offset,
+                             size_t num_bytes,
+                             bool using_owner_authorization,
+                             const NVReadCallback& callback,
+                             AuthorizationDelegate* delegate) override {
+    return target_->ReadNVSpaceInChunks(index, offset, num_bytes,
+                                        using_owner_authorization, callback,
+                                        delegate);
+  }
+
   TPM_RC GetNVSpaceName(uint32_t index, std::string* name) override {
     return target_->GetNVSpaceName(index, name);
   }
@@ -382,6 +514,18 @@ class AuthorizationDelegateForwarder : public AuthorizationDelegate {
     return target_->DecryptResponseParameter(parameter);
   }
 
+  bool EncryptCommandParameterInPlace(uint8_t* data, size_t size) override {
+    return target_->EncryptCommandParameterInPlace(data, size);
+  }
+
+  bool DecryptResponseParameterInPlace(uint8_t* data, size_t size) override {
+    return target_->DecryptResponseParameterInPlace(data, size);
+  }
+
+  bool RequiresParameterHashes() const override {
+    return target_->RequiresParameterHashes();
+  }
+
  private:
   AuthorizationDelegate* target_;
 };
@@ -408,6 +552,17 @@ class SessionManagerForwarder : public SessionManager {
                                  delegate);
   }
 
+  void StartSessionAsync(TPM_SE session_type,
+                         TPMI_DH_ENTITY bind_entity,
+                         const std::string& bind_authorization_value,
+                         bool enable_encryption,
+                         HmacAuthorizationDelegate* delegate,
+                         const StartSessionCallback& callback) override {
+    target_->StartSessionAsync(session_type, bind_entity,
+                               bind_authorization_value, enable_encryption,
+                               delegate, callback);
+  }
+
  private:
   SessionManager* target_;
 };
@@ -433,6 +588,11 @@ class HmacSessionForwarder : public HmacSession {
     return target_->StartUnboundSession(enable_encryption);
   }
 
+  void StartUnboundSessionAsync(bool enable_encryption,
+                                const StartSessionCallback& callback) override {
+    target_->StartUnboundSessionAsync(enable_encryption, callback);
+  }
+
   void SetEntityAuthorizationValue(const std::string& value) override {
     return target_->SetEntityAuthorizationValue(value);
   }
@@ -441,6 +601,10 @@ class HmacSessionForwarder : public HmacSession {
     return target_->SetFutureAuthorizationValue(value);
   }
 
+  bool RestartIfInvalidated(TPM_RC result) override {
+    return target_->RestartIfInvalidated(result);
+  }
+
  private:
   HmacSession* target_;
 };
@@ -466,6 +630,11 @@ class PolicySessionForwarder : public PolicySession {
     return target_->StartUnboundSession(enable_encryption);
   }
 
+  void StartUnboundSessionAsync(bool enable_encryption,
+                                const StartSessionCallback& callback) override {
+    target_->StartUnboundSessionAsync(enable_encryption, callback);
+  }
+
   TPM_RC GetDigest(std::string* digest) override {
     return target_->GetDigest(digest);
   }
@@ -484,8 +653,35 @@ class PolicySessionForwarder : public PolicySession {
 
   TPM_RC PolicyAuthValue() override { return target_->PolicyAuthValue(); }
 
+  TPM_RC PolicyAuthorize(const std::string& approved_policy,
+                         const std::string& policy_ref,
+                         const std::string& key_name,
+                         const TPMT_TK_VERIFIED& ticket) override {
+    return target_->PolicyAuthorize(approved_policy, policy_ref, key_name,
+                                    ticket);
+  }
+
+  TPM_RC PolicySigned(TPMI_DH_OBJECT auth_object,
+                      const std::string& auth_object_name,
+                      const std::string& policy_ref,
+                      int32_t expiration,
+                      const TPMT_SIGNATURE& signature) override {
+    return target_->PolicySigned(auth_object, auth_object_name, policy_ref,
+                                 expiration, signature);
+  }
+
+  TPM_RC PolicySecret(TPMI_DH_ENTITY auth_entity,
+                      const std::string& auth_entity_name,
+                      AuthorizationDelegate* delegate) override {
+    return target_->PolicySecret(auth_entity, auth_entity_name, delegate);
+  }
+
   TPM_RC PolicyRestart() override { return target_->PolicyRestart(); }
 
+  TPM_RC ApplyPolicy(const PolicyTemplate& policy) override {
+    return target_->ApplyPolicy(policy);
+  }
+
   void SetEntityAuthorizationValue(const std::string& value) override {
     return target_->SetEntityAuthorizationValue(value);
   }
@@ -594,4 +790,12 @@ std::unique_ptr<BlobParser> TrunksFactoryForTest::GetBlobParser() const {
   return base::MakeUnique<BlobParserForwarder>(blob_parser_);
 }
 
+bool TrunksFactoryForTest::GetLastStateEpochs(TpmStateEpochs* epochs) const {
+  if (!state_epochs_) {
+    return false;
+  }
+  *epochs = *state_epochs_;
+  return true;
+}
+
 }  // namespace trunks
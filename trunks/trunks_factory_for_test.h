@@ -43,6 +43,7 @@ class PolicySession;
 class SessionManager;
 class Tpm;
 class TpmState;
+class TpmStateEpochs;
 class TpmUtility;
 
 // A factory implementation for testing. Custom instances can be injected. If no
@@ -71,6 +72,7 @@ class TRUNKS_EXPORT TrunksFactoryForTest : public TrunksFactory {
   std::unique_ptr<PolicySession> GetPolicySession() const override;
   std::unique_ptr<PolicySession> GetTrialSession() const override;
   std::unique_ptr<BlobParser> GetBlobParser() const override;
+  bool GetLastStateEpochs(TpmStateEpochs* epochs) const override;
 
   // Mutators to inject custom mocks.
   void set_tpm(Tpm* tpm) { tpm_ = tpm; }
@@ -101,6 +103,11 @@ class TRUNKS_EXPORT TrunksFactoryForTest : public TrunksFactory {
 
   void set_blob_parser(BlobParser* blob_parser) { blob_parser_ = blob_parser; }
 
+  // GetLastStateEpochs() copies |state_epochs| if set, or fails.
+  void set_state_epochs(const TpmStateEpochs* state_epochs) {
+    state_epochs_ = state_epochs;
+  }
+
  private:
   std::unique_ptr<MockTpm> default_tpm_;
   Tpm* tpm_;
@@ -121,6 +128,7 @@ class TRUNKS_EXPORT TrunksFactoryForTest : public TrunksFactory {
   PolicySession* trial_session_;
   std::unique_ptr<MockBlobParser> default_blob_parser_;
   BlobParser* blob_parser_;
+  const TpmStateEpochs* state_epochs_ = nullptr;
 
   DISALLOW_COPY_AND_ASSIGN(TrunksFactoryForTest);
 };
@@ -16,47 +16,171 @@
 
 #include "trunks/trunks_factory_impl.h"
 
+#include <base/bind.h>
+#include <base/location.h>
 #include <base/logging.h>
 #include <base/memory/ptr_util.h>
+#include <base/message_loop/message_loop.h>
+#include <base/synchronization/waitable_event.h>
 
+#include "trunks/background_command_transceiver.h"
 #include "trunks/blob_parser.h"
-#include "trunks/hmac_session_impl.h"
+#include "trunks/command_profile.h"
 #include "trunks/password_authorization_delegate.h"
 #include "trunks/policy_session_impl.h"
 #include "trunks/session_manager_impl.h"
+#include "trunks/shared_trunks_connection.h"
 #include "trunks/tpm_generated.h"
 #include "trunks/tpm_state_impl.h"
 #include "trunks/tpm_utility_impl.h"
+#include "trunks/trial_session_impl.h"
 #if defined(USE_BINDER_IPC)
 #include "trunks/trunks_binder_proxy.h"
 #else
+#include "trunks/interface.pb.h"
 #include "trunks/trunks_dbus_proxy.h"
+#include "trunks/trunks_shared_memory_proxy.h"
 #endif
 
+namespace {
+
+const char kIpcThreadName[] = "trunks_ipc";
+
+void RunAndSignal(const base::Closure& task, base::WaitableEvent* done) {
+  task.Run();
+  done->Signal();
+}
+
+// Runs |task| on |thread| and waits for it to finish.
+void RunOnThreadAndWait(base::Thread* thread, const base::Closure& task) {
+  base::WaitableEvent done(base::WaitableEvent::ResetPolicy::MANUAL,
+                           base::WaitableEvent::InitialState::NOT_SIGNALED);
+  thread->task_runner()->PostTask(FROM_HERE,
+                                  base::Bind(&RunAndSignal, task, &done));
+  done.Wait();
+}
+
+void InitTransceiver(trunks::CommandTransceiver* transceiver, bool* result) {
+  *result = transceiver->Init();
+}
+
+#if !defined(USE_BINDER_IPC)
+void GetCapabilitySnapshotOnIpcThread(trunks::TrunksDBusProxy* proxy,
+                                      trunks::CapabilitySnapshot* snapshot,
+                                      bool* result) {
+  *result = proxy->GetCapabilitySnapshot(snapshot);
+}
+
+void LearnCommandTimeoutsOnIpcThread(trunks::TrunksDBusProxy* proxy) {
+  proxy->LearnCommandTimeouts();
+}
+
+void GetLastStateEpochsOnIpcThread(const trunks::TrunksDBusProxy* proxy,
+                                   trunks::TpmStateEpochs* epochs,
+                                   bool* result) {
+  *result = proxy->GetLastStateEpochs(epochs);
+}
+#endif
+
+}  // namespace
+
 namespace trunks {
 
-TrunksFactoryImpl::TrunksFactoryImpl() {
+TrunksFactoryImpl::TrunksFactoryImpl()
+    : TrunksFactoryImpl(Transport::kDefault) {}
+
+TrunksFactoryImpl::TrunksFactoryImpl(Transport transport)
+    : transport_(transport) {
 #if defined(USE_BINDER_IPC)
+  LOG_IF(WARNING, transport == Transport::kSharedMemory)
+      << "Shared memory transport is not supported with Binder.";
   default_transceiver_.reset(new TrunksBinderProxy());
 #else
-  default_transceiver_.reset(new TrunksDBusProxy());
+  if (transport == Transport::kSharedMemory) {
+    default_transceiver_.reset(new TrunksSharedMemoryProxy());
+  } else {
+    dbus_proxy_ = new TrunksDBusProxy();
+    default_transceiver_.reset(dbus_proxy_);
+  }
 #endif
   transceiver_ = default_transceiver_.get();
+  salting_key_cache_.reset(new SaltingKeyCache());
+  tpm_property_cache_.reset(new TpmPropertyCache());
+  rsa_key_pool_.reset(new RSAKeyPool());
+  hmac_session_pool_.reset(new HmacSessionPool(*this));
 }
 
 TrunksFactoryImpl::TrunksFactoryImpl(CommandTransceiver* transceiver) {
   transceiver_ = transceiver;
+  salting_key_cache_.reset(new SaltingKeyCache());
+  tpm_property_cache_.reset(new TpmPropertyCache());
+  rsa_key_pool_.reset(new RSAKeyPool());
+  hmac_session_pool_.reset(new HmacSessionPool(*this));
+}
+
+TrunksFactoryImpl::~TrunksFactoryImpl() {
+  if (ipc_thread_) {
+    // Pooled sessions are flushed through the IPC thread, and the proxy has to
+    // be shut down on the thread it was initialized on.
+    hmac_session_pool_.reset();
+    ipc_thread_->task_runner()->DeleteSoon(FROM_HERE,
+                                           default_transceiver_.release());
+    dbus_proxy_ = nullptr;
+    ipc_thread_->Stop();
+  }
 }
 
-TrunksFactoryImpl::~TrunksFactoryImpl() {}
+void TrunksFactoryImpl::EnableMultithreadedAccess() {
+  DCHECK(!initialized_) << "Must be called before Initialize().";
+  if (!default_transceiver_ || ipc_thread_) {
+    return;
+  }
+  ipc_thread_.reset(new base::Thread(kIpcThreadName));
+  // The D-Bus proxy watches its connection from the thread it runs on.
+  CHECK(ipc_thread_->StartWithOptions(
+      base::Thread::Options(base::MessageLoop::TYPE_IO, 0)))
+      << "Failed to start the trunks IPC thread.";
+  ipc_thread_transceiver_.reset(new BackgroundCommandTransceiver(
+      default_transceiver_.get(), ipc_thread_->task_runner()));
+}
+
+void TrunksFactoryImpl::UseSharedConnection() {
+  DCHECK(!initialized_) << "Must be called before Initialize().";
+  if (!default_transceiver_ || ipc_thread_) {
+    return;
+  }
+  if (transport_ != Transport::kDefault) {
+    LOG(INFO) << "The shared memory transport does not share its connection.";
+    return;
+  }
+  shared_connection_ = SharedTrunksConnection::Get();
+  dbus_proxy_ = nullptr;
+  default_transceiver_.reset();
+  transceiver_ = shared_connection_->transceiver();
+}
 
 bool TrunksFactoryImpl::Initialize() {
   if (initialized_) {
     return true;
   }
-  tpm_.reset(new Tpm(transceiver_));
-  if (transceiver_ != default_transceiver_.get()) {
+  CommandTransceiver* next_transceiver = ipc_thread_transceiver_
+                                             ? ipc_thread_transceiver_.get()
+                                             : transceiver_;
+  profiling_transceiver_.reset(
+      new ProfilingCommandTransceiver(next_transceiver));
+  tpm_.reset(new Tpm(profiling_transceiver_.get()));
+  if (shared_connection_) {
+    initialized_ = shared_connection_->Initialize();
+  } else if (transceiver_ != default_transceiver_.get()) {
     initialized_ = true;
+  } else if (ipc_thread_) {
+    RunOnThreadAndWait(
+        ipc_thread_.get(),
+        base::Bind(&InitTransceiver, transceiver_, &initialized_));
+    if (!initialized_) {
+      LOG(WARNING) << "Failed to initialize the trunks IPC proxy; "
+                   << "trunksd is not ready.";
+    }
   } else {
     initialized_ = transceiver_->Init();
     if (!initialized_) {
@@ -64,6 +188,30 @@ bool TrunksFactoryImpl::Initialize() {
                    << "trunksd is not ready.";
     }
   }
+#if !defined(USE_BINDER_IPC)
+  // One call replaces the GetCapability round trips TpmState would otherwise
+  // make; without a snapshot the properties are queried on first use.
+  CapabilitySnapshot snapshot;
+  bool have_snapshot = false;
+  if (initialized_ && shared_connection_) {
+    have_snapshot = shared_connection_->GetCapabilitySnapshot(&snapshot);
+  } else if (initialized_ && dbus_proxy_) {
+    if (ipc_thread_) {
+      RunOnThreadAndWait(ipc_thread_.get(),
+                         base::Bind(&GetCapabilitySnapshotOnIpcThread,
+                                    dbus_proxy_, &snapshot, &have_snapshot));
+      RunOnThreadAndWait(
+          ipc_thread_.get(),
+          base::Bind(&LearnCommandTimeoutsOnIpcThread, dbus_proxy_));
+    } else {
+      have_snapshot = dbus_proxy_->GetCapabilitySnapshot(&snapshot);
+      dbus_proxy_->LearnCommandTimeouts();
+    }
+  }
+  if (have_snapshot) {
+    tpm_property_cache_->ImportSnapshot(snapshot);
+  }
+#endif
   return initialized_;
 }
 
@@ -72,11 +220,11 @@ Tpm* TrunksFactoryImpl::GetTpm() const {
 }
 
 std::unique_ptr<TpmState> TrunksFactoryImpl::GetTpmState() const {
-  return base::MakeUnique<TpmStateImpl>(*this);
+  return base::MakeUnique<TpmStateImpl>(*this, tpm_property_cache_.get());
 }
 
 std::unique_ptr<TpmUtility> TrunksFactoryImpl::GetTpmUtility() const {
-  return base::MakeUnique<TpmUtilityImpl>(*this);
+  return base::MakeUnique<TpmUtilityImpl>(*this, rsa_key_pool_.get());
 }
 
 std::unique_ptr<AuthorizationDelegate>
@@ -85,11 +233,11 @@ TrunksFactoryImpl::GetPasswordAuthorization(const std::string& password) const {
 }
 
 std::unique_ptr<SessionManager> TrunksFactoryImpl::GetSessionManager() const {
-  return base::MakeUnique<SessionManagerImpl>(*this);
+  return base::MakeUnique<SessionManagerImpl>(*this, salting_key_cache_.get());
 }
 
 std::unique_ptr<HmacSession> TrunksFactoryImpl::GetHmacSession() const {
-  return base::MakeUnique<HmacSessionImpl>(*this);
+  return base::MakeUnique<PooledHmacSession>(hmac_session_pool_.get());
 }
 
 std::unique_ptr<PolicySession> TrunksFactoryImpl::GetPolicySession() const {
@@ -97,7 +245,29 @@ std::unique_ptr<PolicySession> TrunksFactoryImpl::GetPolicySession() const {
 }
 
 std::unique_ptr<PolicySession> TrunksFactoryImpl::GetTrialSession() const {
-  return base::MakeUnique<PolicySessionImpl>(*this, TPM_SE_TRIAL);
+  return base::MakeUnique<TrialSessionImpl>();
+}
+
+bool TrunksFactoryImpl::GetLastStateEpochs(TpmStateEpochs* epochs) const {
+#if defined(USE_BINDER_IPC)
+  return false;
+#else
+  if (initialized_ && shared_connection_) {
+    return shared_connection_->GetLastStateEpochs(epochs);
+  }
+  if (!initialized_ || !dbus_proxy_) {
+    return false;
+  }
+  if (ipc_thread_) {
+    // The proxy records the epochs on the IPC thread.
+    bool result = false;
+    RunOnThreadAndWait(ipc_thread_.get(),
+                       base::Bind(&GetLastStateEpochsOnIpcThread, dbus_proxy_,
+                                  epochs, &result));
+    return result;
+  }
+  return dbus_proxy_->GetLastStateEpochs(epochs);
+#endif
 }
 
 std::unique_ptr<BlobParser> TrunksFactoryImpl::GetBlobParser() const {
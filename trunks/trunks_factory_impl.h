@@ -23,23 +23,48 @@
 #include <string>
 
 #include <base/macros.h>
+#include <base/threading/thread.h>
 
 #include "trunks/command_transceiver.h"
+#include "trunks/hmac_session_pool.h"
+#include "trunks/session_manager_impl.h"
+#include "trunks/tpm_state_impl.h"
+#include "trunks/tpm_utility_impl.h"
 #include "trunks/trunks_export.h"
 
 namespace trunks {
 
+class ProfilingCommandTransceiver;
+class SharedTrunksConnection;
+class TrunksDBusProxy;
+
 // TrunksFactoryImpl is the default TrunksFactory implementation. This class is
 // thread-safe with the exception of Initialize() but created objects are not
-// necessarily thread-safe. Example usage:
+// necessarily thread-safe. The IPC proxies are bound to the thread they were
+// initialized on, so by default GetTpm() may only be used on the thread which
+// called Initialize(). Call EnableMultithreadedAccess() before Initialize() to
+// share one connection, and one Tpm, between threads, or UseSharedConnection()
+// to share one connection between all factories of a process. Example usage:
 //
 // TrunksFactoryImpl factory;
 // factory.Initialize(true /*failure_is_fatal*/);
 // Tpm* tpm = factory.GetTpm();
 class TRUNKS_EXPORT TrunksFactoryImpl : public TrunksFactory {
  public:
+  // The IPC transport used to reach trunksd.
+  enum class Transport {
+    // D-Bus or Binder depending on the platform.
+    kDefault,
+    // Shared memory negotiated over D-Bus. Falls back to kDefault where shared
+    // memory channels are not supported.
+    kSharedMemory,
+  };
+
   // Uses an IPC proxy as the default CommandTransceiver.
   TrunksFactoryImpl();
+  // Uses an IPC proxy for the given |transport| as the default
+  // CommandTransceiver.
+  explicit TrunksFactoryImpl(Transport transport);
   // TrunksFactoryImpl does not take ownership of |transceiver|. This
   // transceiver is forwarded down to the Tpm instance maintained by
   // this factory. It is assumed that the |transceiver| is already initialized.
@@ -50,6 +75,24 @@ class TRUNKS_EXPORT TrunksFactoryImpl : public TrunksFactory {
   // Returns true on success.
   bool Initialize();
 
+  // Runs the default IPC proxy on a dedicated thread so the Tpm returned by
+  // GetTpm() can be called concurrently from any thread. Synchronous commands
+  // block the calling thread only; asynchronous callbacks run on the thread
+  // which sent the command, which must have a task runner. Commands from all
+  // threads share the one connection to trunksd. Has no effect on a factory
+  // created with an external transceiver. Must be called before Initialize().
+  void EnableMultithreadedAccess();
+
+  // Sends commands through the SharedTrunksConnection of this process instead
+  // of a connection of its own, so factories created by different components
+  // of a daemon share one proxy, IPC thread and capability snapshot. The Tpm
+  // returned by GetTpm() can be called from any thread, as with
+  // EnableMultithreadedAccess(). Has no effect on a factory created with an
+  // external transceiver or after EnableMultithreadedAccess(); the shared
+  // memory transport keeps its own connection. Must be called before
+  // Initialize().
+  void UseSharedConnection();
+
   // TrunksFactory methods.
   Tpm* GetTpm() const override;
   std::unique_ptr<TpmState> GetTpmState() const override;
@@ -61,11 +104,48 @@ class TRUNKS_EXPORT TrunksFactoryImpl : public TrunksFactory {
   std::unique_ptr<PolicySession> GetPolicySession() const override;
   std::unique_ptr<PolicySession> GetTrialSession() const override;
   std::unique_ptr<BlobParser> GetBlobParser() const override;
+  bool GetLastStateEpochs(TpmStateEpochs* epochs) const override;
+
+  // The cache of fixed TPM properties shared by every TpmState created by this
+  // factory.
+  TpmPropertyCache* tpm_property_cache() const {
+    return tpm_property_cache_.get();
+  }
+
+  // The salting key cache shared by every session manager created by this
+  // factory. Callers can pregenerate salts on it while idle.
+  SaltingKeyCache* salting_key_cache() const {
+    return salting_key_cache_.get();
+  }
 
  private:
   std::unique_ptr<CommandTransceiver> default_transceiver_;
+  // The D-Bus proxy if it is the default transceiver, used to fetch the
+  // capability snapshot of trunksd.
+  TrunksDBusProxy* dbus_proxy_ = nullptr;
   CommandTransceiver* transceiver_;
+  // Owns the default transceiver when multithreaded access is enabled; the
+  // transceiver is initialized, used and destroyed on this thread.
+  std::unique_ptr<base::Thread> ipc_thread_;
+  // Forwards commands from any thread to |ipc_thread_|.
+  std::unique_ptr<CommandTransceiver> ipc_thread_transceiver_;
+  // Set by UseSharedConnection(). Declared before the Tpm so the connection
+  // outlives everything sending commands through it.
+  std::shared_ptr<SharedTrunksConnection> shared_connection_;
+  // Sits in front of |transceiver_| so ScopedCommandProfile sees every command
+  // sent through this factory.
+  std::unique_ptr<ProfilingCommandTransceiver> profiling_transceiver_;
   std::unique_ptr<Tpm> tpm_;
+  // Shared by all session managers created by this factory.
+  std::unique_ptr<SaltingKeyCache> salting_key_cache_;
+  // Shared by all TpmState instances created by this factory.
+  std::unique_ptr<TpmPropertyCache> tpm_property_cache_;
+  // Shared by all TpmUtility instances created by this factory.
+  std::unique_ptr<RSAKeyPool> rsa_key_pool_;
+  // Sessions handed out by GetHmacSession() are taken from and returned to
+  // this pool. Declared last so idle sessions are closed first.
+  std::unique_ptr<HmacSessionPool> hmac_session_pool_;
+  Transport transport_ = Transport::kDefault;
   bool initialized_ = false;
 
   DISALLOW_COPY_AND_ASSIGN(TrunksFactoryImpl);
@@ -15,22 +15,60 @@
 //
 
 #include <algorithm>
-#include <ctime>
 #include <string>
 #include <unistd.h>
 
 #include <base/logging.h>
+#include <base/time/time.h>
 
 #include "trunks/tpm_generated.h"
 #include "trunks/trunks_ftdi_spi.h"
 
 // Assorted TPM2 registers for interface type FIFO.
 #define TPM_ACCESS_REG 0
+#define TPM_INT_ENABLE_REG 0x08
+#define TPM_INT_STATUS_REG 0x10
 #define TPM_STS_REG 0x18
 #define TPM_DATA_FIFO_REG 0x24
 #define TPM_DID_VID_REG 0xf00
 #define TPM_RID_REG 0xf04
 
+namespace {
+
+// The TPM over SPI protocol limits a single transaction to 64 bytes of data.
+const size_t kMaxSpiTransactionSize = 64;
+
+// Status polling first spins this many times without sleeping, since most
+// commands complete within a few USB round trips, then backs off
+// exponentially up to the maximum interval.
+const int kPollSpinCount = 16;
+const int kMinPollIntervalUs = 500;
+const int kMaxPollIntervalUs = 10000;
+
+// How long to wait for the TPM to report a non-zero burst count.
+const int kBurstCountTimeoutMs = 1000;
+
+// SPI clock rates tried once the TPM has been identified at ONE_MHZ, fastest
+// first, and the number of DID/VID reads which have to match at a rate.
+const int kSpiClockRates[] = {THIRTY_MHZ, FIFTEEN_MHZ, TEN_MHZ, SIX_MHZ,
+                              TWO_MHZ};
+const int kClockCheckReads = 8;
+
+// Vendor ID of cr50, which needs a pause between SPI transactions.
+// TODO(vbendeb): remove this once cr50 SPS TPM driver performance is fixed.
+const uint16_t kCr50VendorId = 0x1ae0;
+const int kCr50TransactionDelayUs = 10000;
+
+// Sleeps before the given polling |attempt|, starting from zero.
+void PollDelay(int attempt) {
+  if (attempt < kPollSpinCount)
+    return;
+  int shift = std::min(attempt - kPollSpinCount, 5);
+  usleep(std::min(kMinPollIntervalUs << shift, kMaxPollIntervalUs));
+}
+
+}  // namespace
+
 namespace trunks {
 
 // Locality management bits (in TPM_ACCESS_REG)
@@ -58,6 +96,13 @@ enum TpmStsBits {
   responseRetry = (1 << 1),
 };
 
+// Bits of TPM_INT_ENABLE_REG and TPM_INT_STATUS_REG.
+enum TpmIntBits {
+  globalIntEnable = (1u << 31),
+  typePolarityLowLevel = (1 << 3),
+  dataAvailInt = (1 << 0),
+};
+
 // SPI frame header for TPM transactions is 4 bytes in size, it is described
 // in section "6.4.6 Spi Bit Protocol" of the TCG issued "TPM Profile (PTP)
 // Specification Revision 00.43.
@@ -65,6 +110,14 @@ struct SpiFrameHeader {
   unsigned char body[4];
 };
 
+TrunksFtdiSpi::TrunksFtdiSpi()
+    : mpsse_(NULL),
+      locality_(0),
+      transaction_delay_us_(kCr50TransactionDelayUs),
+      did_vid_(0),
+      clock_index_(arraysize(kSpiClockRates)),
+      use_interrupt_(false) {}
+
 TrunksFtdiSpi::~TrunksFtdiSpi() {
   if (mpsse_)
     Close(mpsse_);
@@ -80,27 +133,20 @@ bool TrunksFtdiSpi::WriteTpmSts(uint32_t status) {
   return FtdiWriteReg(TPM_STS_REG, sizeof(status), &status);
 }
 
-void TrunksFtdiSpi::StartTransaction(bool read_write,
+void TrunksFtdiSpi::BuildFrameHeader(bool read_write,
                                      size_t bytes,
-                                     unsigned addr) {
-  unsigned char* response;
-  SpiFrameHeader header;
-
-  usleep(10000);  // give it 10 ms. TODO(vbendeb): remove this once
-                  // cr50 SPS TPM driver performance is fixed.
-
+                                     unsigned addr,
+                                     uint8_t* header) {
   // The first byte of the frame header encodes the transaction type (read or
   // write) and size (set to lenth - 1).
-  header.body[0] = (read_write ? 0x80 : 0) | 0x40 | (bytes - 1);
+  header[0] = (read_write ? 0x80 : 0) | 0x40 | (bytes - 1);
 
   // The rest of the frame header is the internal address in the TPM
   for (int i = 0; i < 3; i++)
-    header.body[i + 1] = (addr >> (8 * (2 - i))) & 0xff;
-
-  Start(mpsse_);
-
-  response = Transfer(mpsse_, header.body, sizeof(header.body));
+    header[i + 1] = (addr >> (8 * (2 - i))) & 0xff;
+}
 
+void TrunksFtdiSpi::WaitForFlowControl() {
   // The TCG TPM over SPI specification itroduces the notion of SPI flow
   // control (Section "6.4.5 Flow Control" of the TCG issued "TPM Profile
   // (PTP) Specification Revision 00.43).
@@ -111,14 +157,30 @@ void TrunksFtdiSpi::StartTransaction(bool read_write,
   // this case the master is supposed to start polling the line, byte at time,
   // until the last bit in the received byte (transferred during the last
   // clock of the byte) is set to 1.
-  while (!(response[3] & 1)) {
-    unsigned char* poll_state;
-
-    poll_state = Read(mpsse_, 1);
-    response[3] = *poll_state;
-    free(poll_state);
+  char state = 0;
+  while (!(state & 1)) {
+    if (FastRead(mpsse_, &state, 1) != MPSSE_OK)
+      return;
   }
-  free(response);
+}
+
+void TrunksFtdiSpi::StartTransaction(bool read_write,
+                                     size_t bytes,
+                                     unsigned addr) {
+  char response[sizeof(SpiFrameHeader)];
+  SpiFrameHeader header;
+
+  if (transaction_delay_us_)
+    usleep(transaction_delay_us_);
+
+  BuildFrameHeader(read_write, bytes, addr, header.body);
+
+  Start(mpsse_);
+
+  if (FastTransfer(mpsse_, reinterpret_cast<char*>(header.body), response,
+                   sizeof(header.body)) == MPSSE_OK &&
+      !(response[3] & 1))
+    WaitForFlowControl();
 }
 
 bool TrunksFtdiSpi::FtdiWriteReg(unsigned reg_number,
@@ -128,7 +190,7 @@ bool TrunksFtdiSpi::FtdiWriteReg(unsigned reg_number,
     return false;
 
   StartTransaction(false, bytes, reg_number + locality_ * 0x10000);
-  Write(mpsse_, buffer, bytes);
+  FastWrite(mpsse_, static_cast<char*>(const_cast<void*>(buffer)), bytes);
   Stop(mpsse_);
   return true;
 }
@@ -136,20 +198,120 @@ bool TrunksFtdiSpi::FtdiWriteReg(unsigned reg_number,
 bool TrunksFtdiSpi::FtdiReadReg(unsigned reg_number,
                                 size_t bytes,
                                 void* buffer) {
-  unsigned char* value;
+  uint8_t frame[sizeof(SpiFrameHeader) + kMaxSpiTransactionSize] = {};
+  uint8_t response[sizeof(frame)];
+  size_t frame_size = sizeof(SpiFrameHeader) + bytes;
 
-  if (!mpsse_)
+  if (!mpsse_ || !bytes || bytes > kMaxSpiTransactionSize)
     return false;
 
-  StartTransaction(true, bytes, reg_number + locality_ * 0x10000);
-  value = Read(mpsse_, bytes);
+  if (transaction_delay_us_)
+    usleep(transaction_delay_us_);
+
+  BuildFrameHeader(true, bytes, reg_number + locality_ * 0x10000, frame);
+
+  Start(mpsse_);
+
+  // Clock out the header and the register contents in a single USB round
+  // trip. Unless the TPM stalls, the bytes following the header are the
+  // register contents. If it does stall, the wait state bytes precede the
+  // byte with the last bit set, and the contents follow that.
+  if (FastTransfer(mpsse_, reinterpret_cast<char*>(frame),
+                   reinterpret_cast<char*>(response),
+                   frame_size) != MPSSE_OK) {
+    Stop(mpsse_);
+    return false;
+  }
+  size_t offset = sizeof(SpiFrameHeader) - 1;
+  while (offset < frame_size && !(response[offset] & 1))
+    offset++;
+  if (offset == frame_size)
+    WaitForFlowControl();
+  else
+    offset++;
+
+  size_t received = frame_size - offset;
   if (buffer)
-    memcpy(buffer, value, bytes);
-  free(value);
+    memcpy(buffer, response + offset, received);
+
+  if (received < bytes) {
+    // Read the rest straight into |buffer|, or into the spent response frame
+    // if the caller does not want the contents.
+    char* rest = buffer ? static_cast<char*>(buffer) + received
+                        : reinterpret_cast<char*>(response);
+    FastRead(mpsse_, rest, bytes - received);
+  }
   Stop(mpsse_);
   return true;
 }
 
+bool TrunksFtdiSpi::WriteFifo(const uint8_t* data, size_t size) {
+  size_t handled_so_far = 0;
+  int attempt = 0;
+  base::TimeTicks deadline;
+
+  while (handled_so_far < size) {
+    size_t burst_count = GetBurstCount();
+    if (!burst_count) {
+      if (!attempt) {
+        deadline = base::TimeTicks::Now() +
+                   base::TimeDelta::FromMilliseconds(kBurstCountTimeoutMs);
+      } else if (base::TimeTicks::Now() >= deadline) {
+        LOG(ERROR) << "timed out waiting for burst count";
+        return false;
+      }
+      PollDelay(attempt++);
+      continue;
+    }
+    attempt = 0;
+    // The burst count is the number of bytes the TPM accepts without further
+    // flow control, so all of it is sent before the status is read again.
+    size_t burst_end = std::min(size, handled_so_far + burst_count);
+    while (handled_so_far < burst_end) {
+      size_t transaction_size =
+          std::min(burst_end - handled_so_far, kMaxSpiTransactionSize);
+      VLOG(1) << "will transfer " << transaction_size << " bytes";
+      if (!FtdiWriteReg(TPM_DATA_FIFO_REG, transaction_size,
+                        data + handled_so_far))
+        return false;
+      handled_so_far += transaction_size;
+    }
+  }
+  return true;
+}
+
+bool TrunksFtdiSpi::ReadFifo(uint8_t* data, size_t size) {
+  size_t handled_so_far = 0;
+  int attempt = 0;
+  base::TimeTicks deadline;
+
+  while (handled_so_far < size) {
+    size_t burst_count = GetBurstCount();
+    if (!burst_count) {
+      if (!attempt) {
+        deadline = base::TimeTicks::Now() +
+                   base::TimeDelta::FromMilliseconds(kBurstCountTimeoutMs);
+      } else if (base::TimeTicks::Now() >= deadline) {
+        LOG(ERROR) << "timed out waiting for burst count";
+        return false;
+      }
+      PollDelay(attempt++);
+      continue;
+    }
+    attempt = 0;
+    size_t burst_end = std::min(size, handled_so_far + burst_count);
+    while (handled_so_far < burst_end) {
+      size_t transaction_size =
+          std::min(burst_end - handled_so_far, kMaxSpiTransactionSize);
+      if (!FtdiReadReg(TPM_DATA_FIFO_REG, transaction_size,
+                       data + handled_so_far))
+        return false;
+      handled_so_far += transaction_size;
+    }
+  }
+  return true;
+}
+
 size_t TrunksFtdiSpi::GetBurstCount(void) {
   uint32_t status;
 
@@ -180,6 +342,11 @@ bool TrunksFtdiSpi::Init() {
     LOG(ERROR) << "unknown did_vid: 0x" << std::hex << did_vid;
     return false;
   }
+  // Only cr50 needs the pause between transactions.
+  if (vid != kCr50VendorId)
+    transaction_delay_us_ = 0;
+  did_vid_ = did_vid;
+  NegotiateClock();
 
   // Try claiming locality zero.
   FtdiReadReg(TPM_ACCESS_REG, sizeof(cmd), &cmd);
@@ -207,9 +374,68 @@ bool TrunksFtdiSpi::Init() {
   printf("Connected to device vid:did:rid of %4.4x:%4.4x:%2.2x\n",
          did_vid & 0xffff, did_vid >> 16, cmd);
 
+  if (use_interrupt_ && !EnableInterrupt()) {
+    LOG(WARNING) << "failed to enable the TPM interrupt, polling instead";
+    use_interrupt_ = false;
+  }
   return true;
 }
 
+void TrunksFtdiSpi::ApplyClock() {
+  SetClock(mpsse_, clock_index_ < arraysize(kSpiClockRates)
+                       ? kSpiClockRates[clock_index_]
+                       : ONE_MHZ);
+}
+
+bool TrunksFtdiSpi::CheckClock() {
+  for (int i = 0; i < kClockCheckReads; i++) {
+    uint32_t did_vid = 0;
+    if (!FtdiReadReg(TPM_DID_VID_REG, sizeof(did_vid), &did_vid) ||
+        did_vid != did_vid_)
+      return false;
+  }
+  return true;
+}
+
+void TrunksFtdiSpi::NegotiateClock() {
+  for (clock_index_ = 0; clock_index_ < arraysize(kSpiClockRates);
+       clock_index_++) {
+    ApplyClock();
+    if (CheckClock())
+      break;
+  }
+  if (clock_index_ == arraysize(kSpiClockRates))
+    ApplyClock();
+  LOG(INFO) << "SPI clock set to " << GetClock(mpsse_) << " Hz";
+}
+
+void TrunksFtdiSpi::LowerClock() {
+  while (clock_index_ < arraysize(kSpiClockRates)) {
+    clock_index_++;
+    ApplyClock();
+    if (CheckClock())
+      break;
+  }
+  LOG(WARNING) << "framing error, SPI clock lowered to " << GetClock(mpsse_)
+               << " Hz";
+}
+
+bool TrunksFtdiSpi::EnableInterrupt() {
+  uint32_t enable = globalIntEnable | typePolarityLowLevel | dataAvailInt;
+  uint32_t readback = 0;
+  if (!FtdiWriteReg(TPM_INT_ENABLE_REG, sizeof(enable), &enable) ||
+      !FtdiReadReg(TPM_INT_ENABLE_REG, sizeof(readback), &readback))
+    return false;
+  return (readback & enable) == enable;
+}
+
+bool TrunksFtdiSpi::WaitForInterrupt(int timeout_ms) {
+  if (WaitForGPIOL1Low(mpsse_, timeout_ms) == MPSSE_OK)
+    return true;
+  LOG(ERROR) << "timed out waiting for the TPM interrupt";
+  return false;
+}
+
 void TrunksFtdiSpi::SendCommand(const std::string& command,
                                 const ResponseCallback& callback) {
   printf("%s invoked\n", __func__);
@@ -219,25 +445,29 @@ bool TrunksFtdiSpi::WaitForStatus(uint32_t statusMask,
                                   uint32_t statusExpected,
                                   int timeout_ms) {
   uint32_t status;
-  time_t target_time;
-
-  target_time = time(NULL) + timeout_ms / 1000;
-  do {
-    usleep(10000);  // 10 ms polling period.
-    if (time(NULL) >= target_time) {
+  base::TimeTicks deadline =
+      base::TimeTicks::Now() + base::TimeDelta::FromMilliseconds(timeout_ms);
+
+  // The TPM raises PIRQ# once data is available, so status is only read
+  // afterwards. Polling takes over if the interrupt does not come.
+  if (use_interrupt_ && (statusExpected & dataAvail))
+    WaitForInterrupt(timeout_ms);
+
+  for (int attempt = 0;; attempt++) {
+    if (ReadTpmSts(&status) && (status & statusMask) == statusExpected)
+      return true;
+    if (base::TimeTicks::Now() >= deadline) {
       LOG(ERROR) << "failed to get expected status " << std::hex
                  << statusExpected;
       return false;
     }
-    ReadTpmSts(&status);
-  } while ((status & statusMask) != statusExpected);
-  return true;
+    PollDelay(attempt);
+  }
 }
 
 std::string TrunksFtdiSpi::SendCommandAndWait(const std::string& command) {
   uint32_t status;
   uint32_t expected_status_bits;
-  size_t transaction_size, handled_so_far(0);
 
   std::string rv("");
 
@@ -247,22 +477,18 @@ std::string TrunksFtdiSpi::SendCommandAndWait(const std::string& command) {
   }
 
   WriteTpmSts(commandReady);
+  if (use_interrupt_) {
+    // Interrupt status bits are cleared by writing ones. This deasserts
+    // PIRQ# until the response to this command is available.
+    uint32_t clear = dataAvailInt;
+    FtdiWriteReg(TPM_INT_STATUS_REG, sizeof(clear), &clear);
+  }
 
   // No need to wait for the sts.Expect bit to be set, at least with the
-  // 15d1:001b device, let's just write the command into FIFO, not exceeding
-  // the minimum of the two values - burst_count and 64 (which is the protocol
-  // limitation)
-  do {
-    transaction_size = std::min(
-        std::min(command.size() - handled_so_far, GetBurstCount()), (size_t)64);
-
-    if (transaction_size) {
-      LOG(INFO) << "will transfer " << transaction_size << " bytes";
-      FtdiWriteReg(TPM_DATA_FIFO_REG, transaction_size,
-                   command.c_str() + handled_so_far);
-      handled_so_far += transaction_size;
-    }
-  } while (handled_so_far != command.size());
+  // 15d1:001b device, let's just write the command into FIFO.
+  if (!WriteFifo(reinterpret_cast<const uint8_t*>(command.data()),
+                 command.size()))
+    return rv;
 
   // And tell the device it can start processing it.
   WriteTpmSts(tpmGo);
@@ -290,6 +516,7 @@ std::string TrunksFtdiSpi::SendCommandAndWait(const std::string& command) {
   if ((payload_size < 10) || (payload_size > MAX_RESPONSE_SIZE)) {
     // Something must be wrong...
     LOG(ERROR) << "Bad total payload size value: " << payload_size;
+    LowerClock();
     return rv;
   }
 
@@ -298,25 +525,19 @@ std::string TrunksFtdiSpi::SendCommandAndWait(const std::string& command) {
   // Let's read all but the last byte in the FIFO to make sure the status
   // register is showing correct flow control bits: 'more data' until the last
   // byte and then 'no more data' once the last byte is read.
-  handled_so_far = 0;
   payload_size = payload_size - sizeof(data_header) - 1;
   // Allow room for the last byte too.
   uint8_t* payload = new uint8_t[payload_size + 1];
-  do {
-    transaction_size = std::min(
-        std::min(payload_size - handled_so_far, GetBurstCount()), (size_t)64);
-
-    if (transaction_size) {
-      FtdiReadReg(TPM_DATA_FIFO_REG, transaction_size,
-                  payload + handled_so_far);
-      handled_so_far += transaction_size;
-    }
-  } while (handled_so_far != payload_size);
+  if (!ReadFifo(payload, payload_size)) {
+    delete[] payload;
+    return rv;
+  }
 
   // Verify that there is still data to come.
   ReadTpmSts(&status);
   if ((status & expected_status_bits) != expected_status_bits) {
     LOG(ERROR) << "unexpected status 0x" << std::hex << status;
+    LowerClock();
     delete[] payload;
     return rv;
   }
@@ -328,6 +549,7 @@ std::string TrunksFtdiSpi::SendCommandAndWait(const std::string& command) {
   ReadTpmSts(&status);
   if ((status & expected_status_bits) != stsValid) {
     LOG(ERROR) << "unexpected status 0x" << std::hex << status;
+    LowerClock();
     delete[] payload;
     return rv;
   }
@@ -34,7 +34,7 @@ namespace trunks {
 // commands to the SPI over FTDI interface directly to a TPM chip.
 class TRUNKS_EXPORT TrunksFtdiSpi : public CommandTransceiver {
  public:
-  TrunksFtdiSpi() : mpsse_(NULL), locality_(0) {}
+  TrunksFtdiSpi();
   ~TrunksFtdiSpi() override;
 
   // CommandTransceiver methods.
@@ -43,9 +43,39 @@ class TRUNKS_EXPORT TrunksFtdiSpi : public CommandTransceiver {
                    const ResponseCallback& callback) override;
   std::string SendCommandAndWait(const std::string& command) override;
 
+  // Makes the driver wait for the TPM interrupt, PIRQ#, instead of polling
+  // the status register while a command executes. PIRQ# must be wired to
+  // GPIOL1 of the FTDI chip. Must be called before Init().
+  void set_use_interrupt(bool enabled) { use_interrupt_ = enabled; }
+
  private:
   struct mpsse_context* mpsse_;
   unsigned locality_;  // Set at initialization.
+  // Pause before each SPI transaction. Only needed by cr50, cleared at
+  // initialization for other devices.
+  int transaction_delay_us_;
+  // The DID/VID register value read at the initial clock rate.
+  uint32_t did_vid_;
+  // The index of the current SPI clock rate in kSpiClockRates, or the number
+  // of rates for the initial rate.
+  size_t clock_index_;
+  bool use_interrupt_;
+
+  // Raise the SPI clock to the fastest rate at which CheckClock() passes,
+  // staying at the initial rate if none does.
+  void NegotiateClock();
+  // Step the SPI clock down to the next rate which passes CheckClock(), after
+  // a framing error.
+  void LowerClock();
+  // Set the SPI clock to the rate at |clock_index_|.
+  void ApplyClock();
+  // Return true if the DID/VID register reads back as |did_vid_| a few times
+  // in a row at the current clock rate.
+  bool CheckClock();
+  // Enable the TPM data available interrupt. Return true on success.
+  bool EnableInterrupt();
+  // Wait up to |timeout_ms| for PIRQ#. Return true once it is asserted.
+  bool WaitForInterrupt(int timeout_ms);
 
   // Read a TPM register into the passed in buffer, where 'bytes' the width of
   // the register. Return true on success, false on failure.
@@ -53,6 +83,20 @@ class TRUNKS_EXPORT TrunksFtdiSpi : public CommandTransceiver {
   // Write a TPM register from the passed in buffer, where 'bytes' the width of
   // the register. Return true on success, false on failure.
   bool FtdiWriteReg(unsigned reg_number, size_t bytes, const void* buffer);
+  // Write |size| bytes to the data FIFO, sending the full burst count reported
+  // by the TPM before polling the status again.
+  bool WriteFifo(const uint8_t* data, size_t size);
+  // Read |size| bytes from the data FIFO, using the full reported burst count.
+  bool ReadFifo(uint8_t* data, size_t size);
+  // Fill in the 4 byte SPI frame |header| for a read/write transaction, see
+  // StartTransaction() for the meaning of the other arguments.
+  void BuildFrameHeader(bool read_write,
+                        size_t bytes,
+                        unsigned addr,
+                        uint8_t* header);
+  // Poll the bus until the TPM signals the end of the flow control wait
+  // state.
+  void WaitForFlowControl();
   // Generate a proper SPI frame for read/write transaction, read_write set to
   // true for read transactions, the size of the transaction is passed as
   // 'bytes', addr is the internal TPM address space address (accounting for
@@ -66,7 +110,7 @@ class TRUNKS_EXPORT TrunksFtdiSpi : public CommandTransceiver {
   bool ReadTpmSts(uint32_t* status);
   bool WriteTpmSts(uint32_t status);
   // Poll status register until the required value is read or the timeout
-  // expires.
+  // expires. Polling spins briefly and then backs off.
   bool WaitForStatus(uint32_t statusMask,
                      uint32_t statusExpected,
                      int timeout_ms = 10000);
@@ -95,6 +139,7 @@ class TRUNKS_EXPORT TrunksFtdiSpi : public CommandTransceiver {
   std::string SendCommandAndWait(const std::string& command) {
     return std::string("");
   }
+  void set_use_interrupt(bool enabled) {}
 };
 
 }  // namespace trunks
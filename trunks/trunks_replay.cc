@@ -0,0 +1,198 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// trunks_replay sends the commands of a trace recorded by trunksd
+// --trace_file to a TPM through a resource manager of its own, as trunksd
+// would, and compares response codes and latencies with the recording.
+//
+// Traces are redacted, so commands authorized by an HMAC session or a
+// non-empty password fail on replay. Failed authorizations count towards
+// dictionary attack lockout, which is why the simulator is the default.
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/at_exit.h>
+#include <base/bind.h>
+#include <base/command_line.h>
+#include <base/logging.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/stringprintf.h>
+#include <base/threading/platform_thread.h>
+#include <base/time/time.h>
+#include <brillo/syslog_logging.h>
+
+#include "trunks/command_trace.h"
+#include "trunks/error_codes.h"
+#include "trunks/resource_manager.h"
+#include "trunks/tpm_handle.h"
+#include "trunks/tpm_simulator_handle.h"
+#include "trunks/trunks_factory_impl.h"
+
+namespace trunks {
+namespace {
+
+void PrintUsage() {
+  puts("Usage: trunks_replay --trace=<path> [options]");
+  puts("  --speed=<factor> - Replays <factor> times faster than recorded;");
+  puts("                     0 sends commands back to back. Default: 1.");
+  puts("  --tpm_device=<path> - Replays against a TPM device instead of the");
+  puts("                        simulator.");
+  puts("  --eviction_policy=lru|lfu|all - The resource manager policy.");
+}
+
+void Assign(std::string* to, const std::string& from) {
+  *to = from;
+}
+
+// Returns the |percentile| of sorted |latencies| in microseconds.
+int64_t GetPercentile(const std::vector<base::TimeDelta>& latencies,
+                      int percentile) {
+  if (latencies.empty()) {
+    return 0;
+  }
+  size_t index = std::min(latencies.size() - 1,
+                          latencies.size() * percentile / 100);
+  return latencies[index].InMicroseconds();
+}
+
+// Returns the response code of a |response|, or TPM_RC_FAILURE if it is
+// malformed.
+TPM_RC GetResponseCode(const std::string& response) {
+  if (response.size() < 10) {
+    return TPM_RC_FAILURE;
+  }
+  std::string buffer = response.substr(6, sizeof(TPM_RC));
+  TPM_RC code = TPM_RC_FAILURE;
+  Parse_TPM_RC(&buffer, &code, nullptr);
+  return code;
+}
+
+int Replay(base::CommandLine* cl) {
+  double speed = 1.0;
+  if (!cl->HasSwitch("trace") ||
+      (cl->HasSwitch("speed") &&
+       !base::StringToDouble(cl->GetSwitchValueASCII("speed"), &speed)) ||
+      speed < 0.0) {
+    PrintUsage();
+    return -1;
+  }
+  TraceReader reader;
+  if (!reader.Open(cl->GetSwitchValuePath("trace"))) {
+    return -1;
+  }
+  std::unique_ptr<CommandTransceiver> handle;
+  if (cl->HasSwitch("tpm_device")) {
+    LOG(WARNING) << "Replaying against "
+                 << cl->GetSwitchValueASCII("tpm_device");
+    handle.reset(new TpmHandle(cl->GetSwitchValueASCII("tpm_device")));
+  } else {
+    handle.reset(new TpmSimulatorHandle());
+  }
+  CHECK(handle->Init()) << "Error initializing TPM communication.";
+  TrunksFactoryImpl factory(handle.get());
+  CHECK(factory.Initialize()) << "Failed to initialize trunks factory.";
+  ResourceManager resource_manager(factory, handle.get());
+  std::string eviction_policy = cl->GetSwitchValueASCII("eviction_policy");
+  if (eviction_policy == "all") {
+    resource_manager.set_eviction_policy(ResourceManager::kEvictAll);
+  } else if (eviction_policy == "lfu") {
+    resource_manager.set_eviction_policy(
+        ResourceManager::kEvictLeastFrequentlyUsed);
+  } else if (!eviction_policy.empty() && eviction_policy != "lru") {
+    LOG(WARNING) << "Unknown eviction policy: " << eviction_policy;
+  }
+  resource_manager.Initialize();
+
+  std::vector<base::TimeDelta> recorded_latencies;
+  std::vector<base::TimeDelta> replayed_latencies;
+  uint64_t mismatches = 0;
+  base::TimeDelta trace_duration;
+  base::TimeTicks start = base::TimeTicks::Now();
+  TraceRecord record;
+  while (reader.Read(&record)) {
+    if (speed > 0.0) {
+      base::TimeTicks due =
+          start + base::TimeDelta::FromMicroseconds(
+                      record.offset.InMicroseconds() / speed);
+      base::TimeTicks now = base::TimeTicks::Now();
+      if (due > now) {
+        base::PlatformThread::Sleep(due - now);
+      }
+    }
+    trace_duration = record.offset + record.latency;
+    std::string client = base::StringPrintf("replay:%u", record.client_id);
+    if (record.type == TraceRecord::kClientDisconnected) {
+      resource_manager.OnClientDisconnected(client);
+      continue;
+    }
+    std::string response;
+    base::TimeTicks sent = base::TimeTicks::Now();
+    if (record.client_id) {
+      resource_manager.SendCommandForClient(client, record.command,
+                                            base::Bind(&Assign, &response));
+    } else {
+      response = resource_manager.SendCommandAndWait(record.command);
+    }
+    replayed_latencies.push_back(base::TimeTicks::Now() - sent);
+    recorded_latencies.push_back(record.latency);
+    TPM_RC result = GetResponseCode(response);
+    if (result != record.response_code) {
+      ++mismatches;
+      VLOG(1) << "Response mismatch: recorded "
+              << GetErrorString(record.response_code) << ", replayed "
+              << GetErrorString(result);
+    }
+  }
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  std::sort(recorded_latencies.begin(), recorded_latencies.end());
+  std::sort(replayed_latencies.begin(), replayed_latencies.end());
+  printf("%zu commands, %llu response code mismatches\n",
+         replayed_latencies.size(),
+         static_cast<unsigned long long>(mismatches));
+  printf("%-9s %10s %10s %10s %10s\n", "", "duration_s", "p50_us", "p95_us",
+         "p99_us");
+  printf("%-9s %10.2f %10lld %10lld %10lld\n", "recorded",
+         trace_duration.InSecondsF(),
+         static_cast<long long>(GetPercentile(recorded_latencies, 50)),
+         static_cast<long long>(GetPercentile(recorded_latencies, 95)),
+         static_cast<long long>(GetPercentile(recorded_latencies, 99)));
+  printf("%-9s %10.2f %10lld %10lld %10lld\n", "replayed", elapsed.InSecondsF(),
+         static_cast<long long>(GetPercentile(replayed_latencies, 50)),
+         static_cast<long long>(GetPercentile(replayed_latencies, 95)),
+         static_cast<long long>(GetPercentile(replayed_latencies, 99)));
+  return 0;
+}
+
+}  // namespace
+}  // namespace trunks
+
+int main(int argc, char** argv) {
+  base::AtExitManager at_exit;
+  base::CommandLine::Init(argc, argv);
+  brillo::InitLog(brillo::kLogToStderr);
+  base::CommandLine* cl = base::CommandLine::ForCurrentProcess();
+  if (cl->HasSwitch("help")) {
+    trunks::PrintUsage();
+    return 0;
+  }
+  return trunks::Replay(cl);
+}
@@ -0,0 +1,144 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "trunks/trunks_shared_memory_proxy.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <base/callback.h>
+#include <base/logging.h>
+#include <base/posix/eintr_wrapper.h>
+
+#include "trunks/error_codes.h"
+
+namespace {
+
+// Matches the D-Bus timeout used by TrunksDBusProxy.
+const int kResponseTimeoutMilliseconds = 5 * 60 * 1000;
+const int kInvalidFileDescriptor = -1;
+
+}  // namespace
+
+namespace trunks {
+
+TrunksSharedMemoryProxy::TrunksSharedMemoryProxy()
+    : memory_fd_(kInvalidFileDescriptor),
+      doorbell_fd_(kInvalidFileDescriptor) {}
+
+TrunksSharedMemoryProxy::~TrunksSharedMemoryProxy() {
+  CloseChannel();
+}
+
+bool TrunksSharedMemoryProxy::Init() {
+  if (!dbus_proxy_.Init()) {
+    return false;
+  }
+  memory_fd_ = CreateSharedChannelMemory();
+  if (memory_fd_ == kInvalidFileDescriptor) {
+    return false;
+  }
+  buffer_ = MapSharedChannelMemory(memory_fd_);
+  if (!buffer_) {
+    CloseChannel();
+    return false;
+  }
+  int sockets[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) != 0) {
+    PLOG(ERROR) << "TrunksSharedMemoryProxy: Failed to create doorbell.";
+    CloseChannel();
+    return false;
+  }
+  doorbell_fd_ = sockets[0];
+  bool opened = dbus_proxy_.OpenSharedMemoryChannel(memory_fd_, sockets[1]);
+  IGNORE_EINTR(close(sockets[1]));
+  if (!opened) {
+    LOG(WARNING) << "TrunksSharedMemoryProxy: Falling back to D-Bus.";
+    CloseChannel();
+  }
+  // The D-Bus proxy is usable either way.
+  return true;
+}
+
+void TrunksSharedMemoryProxy::SendCommand(const std::string& command,
+                                          const ResponseCallback& callback) {
+  callback.Run(SendCommandAndWait(command));
+}
+
+std::string TrunksSharedMemoryProxy::SendCommandAndWait(
+    const std::string& command) {
+  if (!buffer_ || command.size() > kSharedChannelMaxFrameSize) {
+    return dbus_proxy_.SendCommandAndWait(command);
+  }
+  std::string response;
+  TPM_RC result = SendCommandInternal(command, &response);
+  if (result != TPM_RC_SUCCESS) {
+    // The state of the channel is unknown; don't use it again.
+    CloseChannel();
+    response = CreateErrorResponse(result);
+  }
+  return response;
+}
+
+std::vector<std::string> TrunksSharedMemoryProxy::SendCommandBatchAndWait(
+    const std::vector<std::string>& commands,
+    bool stop_on_failure) {
+  return dbus_proxy_.SendCommandBatchAndWait(commands, stop_on_failure);
+}
+
+TPM_RC TrunksSharedMemoryProxy::SendCommandInternal(const std::string& command,
+                                                    std::string* response) {
+  memcpy(buffer_->command.data, command.data(), command.size());
+  buffer_->command.size = command.size();
+  char doorbell = 0;
+  if (HANDLE_EINTR(write(doorbell_fd_, &doorbell, 1)) != 1) {
+    PLOG(ERROR) << "TrunksSharedMemoryProxy: Failed to ring doorbell.";
+    return TRUNKS_RC_WRITE_ERROR;
+  }
+  struct pollfd poll_fd = {doorbell_fd_, POLLIN, 0};
+  int result = HANDLE_EINTR(poll(&poll_fd, 1, kResponseTimeoutMilliseconds));
+  if (result <= 0) {
+    LOG(ERROR) << "TrunksSharedMemoryProxy: No response.";
+    return SAPI_RC_NO_RESPONSE_RECEIVED;
+  }
+  if (HANDLE_EINTR(read(doorbell_fd_, &doorbell, 1)) != 1) {
+    LOG(ERROR) << "TrunksSharedMemoryProxy: Channel closed by trunksd.";
+    return TRUNKS_RC_READ_ERROR;
+  }
+  uint32_t size = buffer_->response.size;
+  if (size > kSharedChannelMaxFrameSize) {
+    return SAPI_RC_MALFORMED_RESPONSE;
+  }
+  response->assign(reinterpret_cast<const char*>(buffer_->response.data),
+                   size);
+  return TPM_RC_SUCCESS;
+}
+
+void TrunksSharedMemoryProxy::CloseChannel() {
+  UnmapSharedChannelMemory(buffer_);
+  buffer_ = nullptr;
+  if (memory_fd_ != kInvalidFileDescriptor) {
+    IGNORE_EINTR(close(memory_fd_));
+    memory_fd_ = kInvalidFileDescriptor;
+  }
+  if (doorbell_fd_ != kInvalidFileDescriptor) {
+    IGNORE_EINTR(close(doorbell_fd_));
+    doorbell_fd_ = kInvalidFileDescriptor;
+  }
+}
+
+}  // namespace trunks
@@ -0,0 +1,74 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef TRUNKS_TRUNKS_SHARED_MEMORY_PROXY_H_
+#define TRUNKS_TRUNKS_SHARED_MEMORY_PROXY_H_
+
+#include <string>
+
+#include <base/macros.h>
+
+#include "trunks/command_transceiver.h"
+#include "trunks/shared_memory_channel.h"
+#include "trunks/trunks_dbus_proxy.h"
+#include "trunks/trunks_export.h"
+
+namespace trunks {
+
+// TrunksSharedMemoryProxy is a CommandTransceiver implementation that sends
+// raw command frames to trunksd through shared memory instead of D-Bus. The
+// channel is negotiated once over D-Bus in Init(); after that a command costs
+// one memory copy and a doorbell write in each direction. Commands which do not
+// fit in a frame, and batches, are sent over D-Bus as usual. Like
+// TrunksDBusProxy, an instance must be used in only one thread. The SendCommand
+// method is supported but does not return until the callback has been called.
+class TRUNKS_EXPORT TrunksSharedMemoryProxy : public CommandTransceiver {
+ public:
+  TrunksSharedMemoryProxy();
+  ~TrunksSharedMemoryProxy() override;
+
+  // Initializes the D-Bus client and opens the shared memory channel. Returns
+  // true on success.
+  bool Init() override;
+
+  // CommandTransceiver methods.
+  void SendCommand(const std::string& command,
+                   const ResponseCallback& callback) override;
+  std::string SendCommandAndWait(const std::string& command) override;
+  std::vector<std::string> SendCommandBatchAndWait(
+      const std::vector<std::string>& commands,
+      bool stop_on_failure) override;
+
+ private:
+  // Sends a |command| through the shared memory channel and waits for the
+  // |response|. Returns TPM_RC_SUCCESS on success.
+  TPM_RC SendCommandInternal(const std::string& command, std::string* response);
+
+  // Closes the channel; subsequent commands are sent over D-Bus.
+  void CloseChannel();
+
+  TrunksDBusProxy dbus_proxy_;
+  int memory_fd_;
+  // The client end of the doorbell socket pair.
+  int doorbell_fd_;
+  SharedChannelBuffer* buffer_ = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(TrunksSharedMemoryProxy);
+};
+
+}  // namespace trunks
+
+#endif  // TRUNKS_TRUNKS_SHARED_MEMORY_PROXY_H_
@@ -16,18 +16,33 @@
 
 #include <sysexits.h>
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <base/at_exit.h>
 #include <base/bind.h>
 #include <base/command_line.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/strings/stringprintf.h>
 #include <base/threading/thread.h>
 #include <brillo/minijail/minijail.h>
 #include <brillo/syslog_logging.h>
 #include <brillo/userdb_utils.h>
 
-#include "trunks/background_command_transceiver.h"
+#include "trunks/allocation_profile.h"
+#include "trunks/boot_trace.h"
+#include "trunks/caching_command_transceiver.h"
+#include "trunks/fault_injecting_command_transceiver.h"
 #include "trunks/resource_manager.h"
+#include "trunks/scheduling_command_transceiver.h"
 #include "trunks/tpm_handle.h"
 #include "trunks/tpm_simulator_handle.h"
+#include "trunks/tpm_state.h"
+#include "trunks/tpm_telemetry.h"
+#include "trunks/tpm_utility.h"
+#include "trunks/tracing_command_transceiver.h"
 #if defined(USE_BINDER_IPC)
 #include "trunks/trunks_binder_service.h"
 #else
@@ -48,6 +63,58 @@ const char kTrunksSeccompPath[] =
 const char kTrunksSeccompPath[] = "/usr/share/policy/trunksd-seccomp.policy";
 #endif
 const char kBackgroundThreadName[] = "trunksd_background_thread";
+const char kTpmResourceManagerDevice[] = "/dev/tpmrm0";
+// Queue limits of the command scheduler, overridable with
+// --max_queued_commands and --max_queued_commands_per_client. Zero disables a
+// limit.
+const size_t kDefaultMaxQueuedCommands = 1024;
+const size_t kDefaultMaxQueuedCommandsPerClient = 256;
+// How often TPM health telemetry is sampled, overridable with
+// --telemetry_interval=<seconds> where zero disables it, and how many samples
+// are kept: four hours' worth.
+const int kDefaultTelemetryIntervalSeconds = 60;
+const size_t kTelemetrySamples = 240;
+// How long a handle stays unused before --context_spill_file takes its saved
+// context out of memory, overridable with --context_spill_idle=<seconds>.
+const int kDefaultContextSpillIdleSeconds = 60;
+// How long after startup --boot_trace=<path> records before it writes the
+// trace. This covers tpm_managerd and attestationd starting up.
+const int kBootTraceWindowSeconds = 120;
+
+// The command pipeline of an additional TPM device. Each device has its own
+// resource manager and thread, so commands to different devices execute in
+// parallel.
+struct DevicePipeline {
+  explicit DevicePipeline(const std::string& device_path)
+      : handle(device_path),
+        thread(base::StringPrintf("%s_%s", kBackgroundThreadName,
+                                  device_path.c_str())) {}
+
+  trunks::TpmHandle handle;
+  base::Thread thread;
+  std::unique_ptr<trunks::TrunksFactoryImpl> factory;
+  std::unique_ptr<trunks::ResourceManager> resource_manager;
+  std::unique_ptr<trunks::SchedulingCommandTransceiver> transceiver;
+};
+
+// Connects and starts the pipeline of an additional device. The device handle
+// must already be open.
+void StartDevicePipeline(DevicePipeline* device) {
+  CHECK(device->thread.Start()) << "Failed to start device thread.";
+  device->factory.reset(new trunks::TrunksFactoryImpl(&device->handle));
+  CHECK(device->factory->Initialize()) << "Failed to initialize factory.";
+  device->resource_manager.reset(
+      new trunks::ResourceManager(*device->factory, &device->handle));
+  device->thread.task_runner()->PostNonNestableTask(
+      FROM_HERE,
+      base::Bind(&trunks::ResourceManager::Initialize,
+                 base::Unretained(device->resource_manager.get())));
+  device->transceiver.reset(new trunks::SchedulingCommandTransceiver(
+      device->resource_manager.get(), device->thread.task_runner()));
+  device->transceiver->set_idle_callback(
+      base::Bind(&trunks::ResourceManager::PerformIdleMaintenance,
+                 base::Unretained(device->resource_manager.get())));
+}
 
 void InitMinijailSandbox() {
   uid_t trunks_uid;
@@ -67,6 +134,30 @@ void InitMinijailSandbox() {
       << "trunksd was not able to drop group privilege.";
 }
 
+// Brings the TPM into a usable state when the in-kernel resource manager is
+// used. This is the subset of ResourceManager::Initialize() which does not
+// involve managing handles.
+void InitializeTpmWithoutResourceManager(trunks::TrunksFactory* factory) {
+  trunks::ScopedBootTracePhase phase("InitializeTpmWithoutResourceManager");
+  std::unique_ptr<trunks::TpmUtility> tpm_utility = factory->GetTpmUtility();
+  CHECK_EQ(tpm_utility->Startup(), trunks::TPM_RC_SUCCESS);
+  CHECK_EQ(tpm_utility->InitializeTpm(), trunks::TPM_RC_SUCCESS);
+}
+
+// Queries the fixed TPM capabilities into the property cache of |factory| so
+// clients can fetch them with one GetCapabilitySnapshot call.
+void QueryCapabilitySnapshot(trunks::TrunksFactory* factory) {
+  trunks::ScopedBootTracePhase phase("QueryCapabilitySnapshot");
+  std::unique_ptr<trunks::TpmState> tpm_state = factory->GetTpmState();
+  if (tpm_state->Initialize() != trunks::TPM_RC_SUCCESS) {
+    LOG(WARNING) << "Failed to query TPM capabilities.";
+    return;
+  }
+  // Any fixed property and algorithm loads its whole group.
+  tpm_state->GetTpmProperty(trunks::TPM_PT_FAMILY_INDICATOR, nullptr);
+  tpm_state->IsRSASupported();
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -77,6 +168,16 @@ int main(int argc, char** argv) {
     flags |= brillo::kLogToStderr;
   }
   brillo::InitLog(flags);
+  // Allocation counts are reported with the resource manager statistics.
+  // Binaries built without the allocation hooks report none.
+  if (cl->HasSwitch("allocation_tracking")) {
+    trunks::EnableAllocationTracking(true);
+  }
+  // Records the startup phases and TPM commands of trunksd and of the clients
+  // which send them, in the Chrome trace event format.
+  if (cl->HasSwitch("boot_trace")) {
+    trunks::EnableBootTrace(true);
+  }
 
 // Create a service instance before anything else so objects like
 // AtExitManager exist.
@@ -87,22 +188,66 @@ int main(int argc, char** argv) {
 #endif
 
   // Chain together command transceivers:
-  //   [IPC] --> BackgroundCommandTransceiver
+  //   [IPC] --> SchedulingCommandTransceiver
+  //         --> CachingCommandTransceiver
   //         --> ResourceManager
   //         --> TpmHandle
   //         --> [TPM]
+  // With --tpmrm the kernel manages TPM resources so the ResourceManager is
+  // skipped and the CachingCommandTransceiver talks to /dev/tpmrm0. The cache
+  // can be disabled with --no_response_cache, and the scheduler's retries of
+  // TPM_RC_RETRY, TPM_RC_YIELDED and TPM_RC_TESTING with
+  // --no_warning_retries.
   trunks::CommandTransceiver* low_level_transceiver;
+  bool use_kernel_resource_manager = false;
   if (cl->HasSwitch("ftdi")) {
     LOG(INFO) << "Sending commands to FTDI SPI.";
-    low_level_transceiver = new trunks::TrunksFtdiSpi();
+    trunks::TrunksFtdiSpi* ftdi = new trunks::TrunksFtdiSpi();
+    // PIRQ# wired to GPIOL1 replaces status polling.
+    ftdi->set_use_interrupt(cl->HasSwitch("ftdi_pirq"));
+    low_level_transceiver = ftdi;
   } else if (cl->HasSwitch("simulator")) {
     LOG(INFO) << "Sending commands to simulator.";
     low_level_transceiver = new trunks::TpmSimulatorHandle();
+  } else if (cl->HasSwitch("tpmrm")) {
+    LOG(INFO) << "Sending commands to kernel resource manager.";
+    low_level_transceiver = new trunks::TpmHandle(kTpmResourceManagerDevice);
+    use_kernel_resource_manager = true;
   } else {
     low_level_transceiver = new trunks::TpmHandle();
   }
   CHECK(low_level_transceiver->Init())
       << "Error initializing TPM communication.";
+  // Emulates a slow or busy TPM for capacity testing, typically on top of
+  // the simulator. See FaultInjectingCommandTransceiver::ParseOptions.
+  std::unique_ptr<trunks::FaultInjectingCommandTransceiver> fault_injection;
+  if (cl->HasSwitch("fault_injection")) {
+    uint32_t seed = 1;
+    if (cl->HasSwitch("fault_injection_seed") &&
+        !base::StringToUint(cl->GetSwitchValueASCII("fault_injection_seed"),
+                            &seed)) {
+      LOG(WARNING) << "Invalid fault injection seed.";
+    }
+    fault_injection.reset(new trunks::FaultInjectingCommandTransceiver(
+        low_level_transceiver, seed));
+    CHECK(fault_injection->ParseOptions(
+        cl->GetSwitchValueASCII("fault_injection")))
+        << "Invalid fault injection options.";
+    LOG(WARNING) << "Injecting TPM faults and latency.";
+    low_level_transceiver = fault_injection.get();
+  }
+  // Additional TPMs, e.g. vTPMs, are served as devices 1, 2, ... in the order
+  // given. They always use the trunksd resource manager.
+  std::vector<std::unique_ptr<DevicePipeline>> extra_devices;
+  for (const std::string& path : base::SplitString(
+           cl->GetSwitchValueASCII("extra_tpm_devices"), ",",
+           base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    LOG(INFO) << "Sending device " << extra_devices.size() + 1
+              << " commands to " << path;
+    extra_devices.emplace_back(new DevicePipeline(path));
+    CHECK(extra_devices.back()->handle.Init())
+        << "Error initializing TPM communication with " << path;
+  }
   // This needs to be *after* opening the TPM handle and *before* starting the
   // background thread.
   InitMinijailSandbox();
@@ -111,12 +256,151 @@ int main(int argc, char** argv) {
   trunks::TrunksFactoryImpl factory(low_level_transceiver);
   CHECK(factory.Initialize()) << "Failed to initialize trunks factory.";
   trunks::ResourceManager resource_manager(factory, low_level_transceiver);
+  std::string eviction_policy = cl->GetSwitchValueASCII("eviction_policy");
+  if (eviction_policy == "all") {
+    resource_manager.set_eviction_policy(trunks::ResourceManager::kEvictAll);
+  } else if (eviction_policy == "lfu") {
+    resource_manager.set_eviction_policy(
+        trunks::ResourceManager::kEvictLeastFrequentlyUsed);
+  } else if (!eviction_policy.empty() && eviction_policy != "lru") {
+    LOG(WARNING) << "Unknown eviction policy: " << eviction_policy;
+  }
+  // The state file lets virtual handles survive a trunksd restart. It should be
+  // on a tmpfs; it is ignored anyway once the TPM resets or restarts.
+  if (cl->HasSwitch("resource_manager_state")) {
+    resource_manager.set_state_file(
+        cl->GetSwitchValuePath("resource_manager_state"));
+  }
+  // Keeps the contexts of idle handles in a file, which should be on a tmpfs,
+  // so memory use does not grow with the number of handles clients hold.
+  if (cl->HasSwitch("context_spill_file")) {
+    int spill_idle = kDefaultContextSpillIdleSeconds;
+    if (cl->HasSwitch("context_spill_idle") &&
+        !base::StringToInt(cl->GetSwitchValueASCII("context_spill_idle"),
+                           &spill_idle)) {
+      LOG(WARNING) << "Invalid context spill idle time.";
+      spill_idle = kDefaultContextSpillIdleSeconds;
+    }
+    resource_manager.set_context_spill(
+        cl->GetSwitchValuePath("context_spill_file"),
+        base::TimeDelta::FromSeconds(spill_idle));
+  }
+  if (cl->HasSwitch("client_handle_quota")) {
+    size_t quota = 0;
+    if (base::StringToSizeT(cl->GetSwitchValueASCII("client_handle_quota"),
+                            &quota)) {
+      resource_manager.set_client_handle_quota(quota);
+    } else {
+      LOG(WARNING) << "Invalid client handle quota.";
+    }
+  }
+  // Defers self-tests to idle periods and stirs the TPM RNG while idle.
+  resource_manager.set_idle_housekeeping(cl->HasSwitch("idle_housekeeping"));
+  // Answers PCR reads from a copy kept in trunksd.
+  resource_manager.set_pcr_shadow(cl->HasSwitch("pcr_shadow"));
+  trunks::CommandTransceiver* tpm_transceiver = &resource_manager;
+  if (use_kernel_resource_manager) {
+    background_thread.task_runner()->PostNonNestableTask(
+        FROM_HERE, base::Bind(&InitializeTpmWithoutResourceManager,
+                              base::Unretained(&factory)));
+    tpm_transceiver = low_level_transceiver;
+  } else {
+    background_thread.task_runner()->PostNonNestableTask(
+        FROM_HERE, base::Bind(&trunks::ResourceManager::Initialize,
+                              base::Unretained(&resource_manager)));
+  }
   background_thread.task_runner()->PostNonNestableTask(
-      FROM_HERE, base::Bind(&trunks::ResourceManager::Initialize,
-                            base::Unretained(&resource_manager)));
-  trunks::BackgroundCommandTransceiver background_transceiver(
-      &resource_manager, background_thread.task_runner());
-  service.set_transceiver(&background_transceiver);
+      FROM_HERE,
+      base::Bind(&QueryCapabilitySnapshot, base::Unretained(&factory)));
+  if (trunks::IsBootTraceEnabled()) {
+    background_thread.task_runner()->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(base::IgnoreResult(&trunks::WriteBootTrace),
+                   cl->GetSwitchValuePath("boot_trace"),
+                   std::string("trunksd")),
+        base::TimeDelta::FromSeconds(kBootTraceWindowSeconds));
+  }
+#if !defined(USE_BINDER_IPC)
+  service.set_property_cache(factory.tpm_property_cache());
+#endif
+  trunks::CachingCommandTransceiver caching_transceiver(tpm_transceiver);
+  if (!cl->HasSwitch("no_response_cache")) {
+    tpm_transceiver = &caching_transceiver;
+  }
+  trunks::SchedulingCommandTransceiver scheduling_transceiver(
+      tpm_transceiver, background_thread.task_runner());
+  size_t max_queued = kDefaultMaxQueuedCommands;
+  size_t max_queued_per_client = kDefaultMaxQueuedCommandsPerClient;
+  if (cl->HasSwitch("max_queued_commands") &&
+      !base::StringToSizeT(cl->GetSwitchValueASCII("max_queued_commands"),
+                           &max_queued)) {
+    LOG(WARNING) << "Invalid queue limit.";
+    max_queued = kDefaultMaxQueuedCommands;
+  }
+  if (cl->HasSwitch("max_queued_commands_per_client") &&
+      !base::StringToSizeT(
+          cl->GetSwitchValueASCII("max_queued_commands_per_client"),
+          &max_queued_per_client)) {
+    LOG(WARNING) << "Invalid per-client queue limit.";
+    max_queued_per_client = kDefaultMaxQueuedCommandsPerClient;
+  }
+  scheduling_transceiver.set_queue_limits(max_queued, max_queued_per_client);
+  scheduling_transceiver.set_warning_retries(
+      !cl->HasSwitch("no_warning_retries"));
+  if (!use_kernel_resource_manager) {
+    resource_manager.set_idle_eviction(cl->HasSwitch("background_swapping"));
+    scheduling_transceiver.set_idle_callback(
+        base::Bind(&trunks::ResourceManager::PerformIdleMaintenance,
+                   base::Unretained(&resource_manager)));
+    scheduling_transceiver.set_queue_latency_callback(
+        base::Bind(&trunks::ResourceManager::AddQueueLatency,
+                   base::Unretained(&resource_manager)));
+#if !defined(USE_BINDER_IPC)
+    service.set_resource_manager(&resource_manager);
+    service.set_scheduler(&scheduling_transceiver);
+    resource_manager.set_state_epochs_callback(
+        base::Bind(&trunks::TrunksDBusService::NotifyTpmStateChanged,
+                   base::Unretained(&service)));
+#endif
+  }
+  // Records client commands for trunks_replay. Recording from trunksd startup
+  // lets a replay allocate the same virtual handles.
+  trunks::CommandTransceiver* service_transceiver = &scheduling_transceiver;
+  std::unique_ptr<trunks::TracingCommandTransceiver> tracing_transceiver;
+  if (cl->HasSwitch("trace_file")) {
+    std::unique_ptr<trunks::TraceWriter> writer(new trunks::TraceWriter());
+    if (writer->Open(cl->GetSwitchValuePath("trace_file"))) {
+      LOG(WARNING) << "Recording TPM commands.";
+      tracing_transceiver.reset(new trunks::TracingCommandTransceiver(
+          &scheduling_transceiver, std::move(writer)));
+      service_transceiver = tracing_transceiver.get();
+    }
+  }
+  service.set_transceiver(service_transceiver);
+#if !defined(USE_BINDER_IPC)
+  std::unique_ptr<trunks::TpmTelemetry> telemetry;
+  int telemetry_interval = kDefaultTelemetryIntervalSeconds;
+  if (cl->HasSwitch("telemetry_interval") &&
+      !base::StringToInt(cl->GetSwitchValueASCII("telemetry_interval"),
+                         &telemetry_interval)) {
+    LOG(WARNING) << "Invalid telemetry interval.";
+    telemetry_interval = kDefaultTelemetryIntervalSeconds;
+  }
+  if (telemetry_interval > 0) {
+    // Lockout counter queries bypass the trace; they are not client commands.
+    telemetry.reset(new trunks::TpmTelemetry(
+        use_kernel_resource_manager ? nullptr : &resource_manager,
+        &scheduling_transceiver, &scheduling_transceiver, kTelemetrySamples));
+    telemetry->Start(base::TimeDelta::FromSeconds(telemetry_interval));
+    service.set_telemetry(telemetry.get());
+  }
+#endif
+  for (size_t i = 0; i < extra_devices.size(); ++i) {
+    StartDevicePipeline(extra_devices[i].get());
+#if !defined(USE_BINDER_IPC)
+    service.set_device_transceiver(i + 1, extra_devices[i]->transceiver.get());
+#endif
+  }
   LOG(INFO) << "Trunks service started.";
   return service.Run();
 }